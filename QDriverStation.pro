@@ -33,6 +33,12 @@ QT += quick
 QT += purchasing
 QT += quickcontrols2
 
+#-------------------------------------------------------------------------------
+# Compile the QML files ahead of time (qmlcachegen)
+#-------------------------------------------------------------------------------
+
+CONFIG += qtquickcompiler
+
 #-------------------------------------------------------------------------------
 # Make options
 #-------------------------------------------------------------------------------
@@ -59,8 +65,24 @@ include ($$PWD/lib/LibDS/wrappers/Qt/LibDS-Qt.pri)
 # Import QML, resources and source code
 #-------------------------------------------------------------------------------
 
+HEADERS += \
+    $$PWD/src/BackgroundService.h \
+    $$PWD/src/CameraView.h \
+    $$PWD/src/FrameStatistics.h \
+    $$PWD/src/JoystickBridge.h \
+    $$PWD/src/PersistentSettings.h \
+    $$PWD/src/TelemetryChart.h \
+    $$PWD/src/TouchJoystick.h
+
 SOURCES += \
-    $$PWD/src/main.cpp
+    $$PWD/src/main.cpp \
+    $$PWD/src/BackgroundService.cpp \
+    $$PWD/src/CameraView.cpp \
+    $$PWD/src/FrameStatistics.cpp \
+    $$PWD/src/JoystickBridge.cpp \
+    $$PWD/src/PersistentSettings.cpp \
+    $$PWD/src/TelemetryChart.cpp \
+    $$PWD/src/TouchJoystick.cpp
 
 RESOURCES += \
     $$PWD/qml/qml.qrc \
@@ -75,4 +97,6 @@ OTHER_FILES += \
 
 DISTFILES += \
     $$PWD/etc/deploy/android/AndroidManifest.xml \
-    $$PWD/etc/deploy/android/res/values/libs.xml
+    $$PWD/etc/deploy/android/res/values/libs.xml \
+    $$PWD/etc/deploy/android/src/org/qjoysticks/QJoysticksActivity.java \
+    $$PWD/etc/deploy/android/src/org/qdriverstation/DriverStationService.java
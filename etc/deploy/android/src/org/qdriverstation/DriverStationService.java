@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+package org.qdriverstation;
+
+import android.app.Service;
+import android.app.Notification;
+import android.app.PendingIntent;
+import android.content.Intent;
+import android.content.Context;
+import android.os.IBinder;
+import android.os.PowerManager;
+import android.net.wifi.WifiManager;
+
+/**
+ * Keeps the driver station running at full speed while the robot is
+ * connected, even if the screen is off or another application is shown.
+ *
+ * The service runs in the foreground (so that the process is not throttled
+ * or killed), holds a partial wake lock (so that the CPU, and with it the
+ * 50 Hz LibDS event loop, does not sleep during Doze) and a high-performance
+ * Wi-Fi lock (so that the radio does not enter its power save mode, which
+ * delays the received packets by up to a beacon interval).
+ */
+public class DriverStationService extends Service {
+    private static final int NOTIFICATION_ID = 5050;
+    private static final String LOCK_TAG = "QDriverStation:RobotComms";
+
+    private PowerManager.WakeLock m_wakeLock;
+    private WifiManager.WifiLock m_wifiLock;
+
+    /**
+     * Starts the service (if it is not running), called by the native code
+     * when the robot communications are established
+     */
+    public static void start (Context context) {
+        context.startService (new Intent (context, DriverStationService.class));
+    }
+
+    /**
+     * Stops the service and releases its locks, called by the native code
+     * some time after the robot communications are lost
+     */
+    public static void stop (Context context) {
+        context.stopService (new Intent (context, DriverStationService.class));
+    }
+
+    @Override
+    public void onCreate() {
+        super.onCreate();
+
+        PowerManager power = (PowerManager) getSystemService (Context.POWER_SERVICE);
+        m_wakeLock = power.newWakeLock (PowerManager.PARTIAL_WAKE_LOCK, LOCK_TAG);
+        m_wakeLock.setReferenceCounted (false);
+        m_wakeLock.acquire();
+
+        WifiManager wifi = (WifiManager) getApplicationContext().getSystemService (Context.WIFI_SERVICE);
+        m_wifiLock = wifi.createWifiLock (WifiManager.WIFI_MODE_FULL_HIGH_PERF, LOCK_TAG);
+        m_wifiLock.setReferenceCounted (false);
+        m_wifiLock.acquire();
+
+        startForeground (NOTIFICATION_ID, createNotification());
+    }
+
+    @Override
+    public int onStartCommand (Intent intent, int flags, int startId) {
+        return START_NOT_STICKY;
+    }
+
+    @Override
+    public void onDestroy() {
+        stopForeground (true);
+
+        if (m_wifiLock.isHeld())
+            m_wifiLock.release();
+        if (m_wakeLock.isHeld())
+            m_wakeLock.release();
+
+        super.onDestroy();
+    }
+
+    @Override
+    public IBinder onBind (Intent intent) {
+        return null;
+    }
+
+    /**
+     * Creates the ongoing notification of the service, which brings the
+     * driver station back when it is tapped
+     */
+    private Notification createNotification() {
+        Intent intent = getPackageManager().getLaunchIntentForPackage (getPackageName());
+        PendingIntent pending = PendingIntent.getActivity (this, 0, intent, 0);
+
+        Notification.Builder builder = new Notification.Builder (this)
+            .setContentTitle ("QDriverStation")
+            .setContentText ("Connected to the robot")
+            .setSmallIcon (getApplicationInfo().icon)
+            .setContentIntent (pending)
+            .setOngoing (true);
+
+        return builder.build();
+    }
+}
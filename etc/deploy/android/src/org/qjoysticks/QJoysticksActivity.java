@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+package org.qjoysticks;
+
+import android.os.Handler;
+import android.os.HandlerThread;
+import android.content.Context;
+import android.view.KeyEvent;
+import android.view.InputDevice;
+import android.view.MotionEvent;
+import android.hardware.input.InputManager;
+
+import org.qtproject.qt5.android.bindings.QtActivity;
+
+/**
+ * Forwards the gamepad events to the native Android_Joystick class of
+ * QJoysticks, without going through the Qt event loop.
+ *
+ * The gamepads are announced by an input device listener that runs in a
+ * dedicated looper thread, the input events are forwarded from the UI thread
+ * as soon as they are dispatched to the activity.
+ */
+public class QJoysticksActivity extends QtActivity
+    implements InputManager.InputDeviceListener {
+    /*
+     * Axes reported for each gamepad, in the order used by the SDL game
+     * controllers (left stick, right stick and triggers)
+     */
+    private static final int[] AXES = {
+        MotionEvent.AXIS_X,
+        MotionEvent.AXIS_Y,
+        MotionEvent.AXIS_Z,
+        MotionEvent.AXIS_RZ,
+        MotionEvent.AXIS_LTRIGGER,
+        MotionEvent.AXIS_RTRIGGER,
+    };
+
+    /*
+     * Buttons reported for each gamepad, in the order used by the SDL game
+     * controllers
+     */
+    private static final int[] BUTTONS = {
+        KeyEvent.KEYCODE_BUTTON_A,
+        KeyEvent.KEYCODE_BUTTON_B,
+        KeyEvent.KEYCODE_BUTTON_X,
+        KeyEvent.KEYCODE_BUTTON_Y,
+        KeyEvent.KEYCODE_BUTTON_SELECT,
+        KeyEvent.KEYCODE_BUTTON_MODE,
+        KeyEvent.KEYCODE_BUTTON_START,
+        KeyEvent.KEYCODE_BUTTON_THUMBL,
+        KeyEvent.KEYCODE_BUTTON_THUMBR,
+        KeyEvent.KEYCODE_BUTTON_L1,
+        KeyEvent.KEYCODE_BUTTON_R1,
+    };
+
+    private volatile boolean m_enabled = false;
+    private final float[] m_axes = new float[AXES.length];
+
+    private Handler m_handler;
+    private HandlerThread m_thread;
+    private InputManager m_inputManager;
+
+    /*
+     * Implemented by Android_Joystick, the methods are registered when the
+     * native library creates the QJoysticks system
+     */
+    private static native void nativeDeviceAdded (int id, String name,
+                                                  int axes, int buttons);
+    private static native void nativeDeviceRemoved (int id);
+    private static native void nativeMotionEvent (int id, float[] axes,
+                                                  int angle);
+    private static native void nativeButtonEvent (int id, int button,
+                                                  boolean pressed);
+
+    /**
+     * Starts the looper thread and registers the attached gamepads, called
+     * by the native code once the native methods are registered
+     */
+    public void startGamepadInput() {
+        if (m_thread != null)
+            return;
+
+        m_thread = new HandlerThread ("QJoysticks Input");
+        m_thread.start();
+        m_handler = new Handler (m_thread.getLooper());
+
+        m_inputManager = (InputManager) getSystemService (Context.INPUT_SERVICE);
+        m_inputManager.registerInputDeviceListener (this, m_handler);
+
+        m_handler.post (new Runnable() {
+            @Override
+            public void run() {
+                for (int id : InputDevice.getDeviceIds())
+                    onInputDeviceAdded (id);
+
+                m_enabled = true;
+            }
+        });
+    }
+
+    /**
+     * Stops forwarding the gamepad events, called by the native code before
+     * the QJoysticks system is destroyed
+     */
+    public void stopGamepadInput() {
+        m_enabled = false;
+
+        if (m_thread != null) {
+            m_inputManager.unregisterInputDeviceListener (this);
+            m_thread.quit();
+            m_thread = null;
+        }
+    }
+
+    @Override
+    public void onInputDeviceAdded (int id) {
+        InputDevice device = InputDevice.getDevice (id);
+        if (isGamepad (device))
+            nativeDeviceAdded (id, device.getName(), AXES.length, BUTTONS.length);
+    }
+
+    @Override
+    public void onInputDeviceRemoved (int id) {
+        nativeDeviceRemoved (id);
+    }
+
+    @Override
+    public void onInputDeviceChanged (int id) {}
+
+    @Override
+    public boolean dispatchGenericMotionEvent (MotionEvent event) {
+        if (m_enabled && isGamepad (event.getDevice())
+                && event.getAction() == MotionEvent.ACTION_MOVE) {
+            for (int i = 0; i < AXES.length; ++i)
+                m_axes[i] = event.getAxisValue (AXES[i]);
+
+            float x = event.getAxisValue (MotionEvent.AXIS_HAT_X);
+            float y = event.getAxisValue (MotionEvent.AXIS_HAT_Y);
+
+            nativeMotionEvent (event.getDeviceId(), m_axes, getHatAngle (x, y));
+            return true;
+        }
+
+        return super.dispatchGenericMotionEvent (event);
+    }
+
+    @Override
+    public boolean dispatchKeyEvent (KeyEvent event) {
+        if (m_enabled && isGamepad (event.getDevice())) {
+            int button = getButton (event.getKeyCode());
+            if (button >= 0) {
+                if (event.getRepeatCount() == 0)
+                    nativeButtonEvent (event.getDeviceId(), button,
+                                       event.getAction() == KeyEvent.ACTION_DOWN);
+
+                return true;
+            }
+        }
+
+        return super.dispatchKeyEvent (event);
+    }
+
+    /**
+     * Returns true if the given device is a gamepad or a joystick
+     */
+    private static boolean isGamepad (InputDevice device) {
+        if (device == null)
+            return false;
+
+        int sources = device.getSources();
+        return (sources & InputDevice.SOURCE_GAMEPAD) == InputDevice.SOURCE_GAMEPAD
+               || (sources & InputDevice.SOURCE_JOYSTICK) == InputDevice.SOURCE_JOYSTICK;
+    }
+
+    /**
+     * Returns the index of the given key code in the reported buttons
+     */
+    private static int getButton (int keyCode) {
+        for (int i = 0; i < BUTTONS.length; ++i)
+            if (BUTTONS[i] == keyCode)
+                return i;
+
+        return -1;
+    }
+
+    /**
+     * Converts the hat axes to a POV angle (-1 when the hat is centered)
+     */
+    private static int getHatAngle (float x, float y) {
+        int h = Math.round (x);
+        int v = Math.round (y);
+
+        if (h == 0 && v == 0)
+            return -1;
+
+        double angle = Math.toDegrees (Math.atan2 (h, -v));
+        return (int) ((angle + 360) % 360);
+    }
+}
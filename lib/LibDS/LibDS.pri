@@ -1,11 +1,87 @@
 INCLUDEPATH += $$PWD/include
 
-!macx* {
+# Windows builds use the native threading primitives (see DS_Thread.h)
+unix:!macx* {
     LIBS += -pthread
 }
 
 win32* {
-    LIBS += -lws2_32
+    LIBS += -lws2_32 -lwinmm
+}
+
+# shm_open() is in librt on older glibc versions
+linux:!android {
+    LIBS += -lrt
+}
+
+# dlopen() is used to load protocol modules
+unix:!macx {
+    LIBS += -ldl
+}
+
+CONFIG (debug, debug|release) {
+    DEFINES += DS_TRACK_MEMORY
+}
+
+# Embedded profile (e.g. Raspberry Pi pit stations or small DS boxes), every
+# block is taken from a static pool instead of the heap, the buffers and the
+# thread stacks are smaller and unused code is stripped at link time. With
+# one context, the LibDS runs in 4 threads and uses ~145 KB of its 192 KB
+# pool (see DS_GetStaticPoolStats() and the README)
+libds_embedded {
+    CONFIG += libds_static_frc_2015
+
+    DEFINES += DS_STATIC_MEMORY
+    DEFINES += DS_THREAD_STACK_SIZE=65536
+    DEFINES += DS_RESOLVER_THREADS=1
+    DEFINES += DS_SOCKET_SLOTS=2
+    DEFINES += DS_EVENT_QUEUE_SIZE=64
+    DEFINES += DS_NETCONSOLE_ARENA_SIZE=16384
+    DEFINES += DS_NETCONSOLE_MAX_LINES=256
+    DEFINES += DS_NETCONSOLE_LINE_SIZE=1024
+    DEFINES += DS_NETCONSOLE_MESSAGE_SLOTS=8
+    DEFINES += DS_NETCONSOLE_MESSAGE_SIZE=256
+    DEFINES += DS_NETCONSOLE_SEND_QUEUE_SIZE=2048
+    DEFINES += DS_ROBOT_MESSAGES_MAX=16
+    DEFINES += DS_ROBOT_MESSAGE_SIZE=128
+    DEFINES += DS_DASHBOARD_MAX_ENTRIES=32
+    DEFINES += DS_DASHBOARD_TEXT_SIZE=64
+
+    QMAKE_CFLAGS_RELEASE -= -O2
+    QMAKE_CFLAGS_RELEASE += -Os
+    QMAKE_CFLAGS += -ffunction-sections -fdata-sections
+
+    !macx* {
+        QMAKE_LFLAGS += -Wl,--gc-sections
+    }
+}
+
+# Call the FRC 2015/2016 packet functions directly (instead of through the
+# function pointers of DS_Protocol), so that they can be inlined in the
+# event loop, e.g. for embedded builds. Other protocols still work.
+libds_static_frc_2015 {
+    CONFIG += ltcg
+    DEFINES += DS_STATIC_FRC_2015
+}
+
+# Leave built-in protocols out of the library (e.g. for constrained targets),
+# protocols can still be registered at runtime (see DS_Registry.h)
+libds_no_frc_2014 {
+    DEFINES += DS_NO_FRC_2014
+}
+
+libds_no_frc_2016 {
+    DEFINES += DS_NO_FRC_2016
+}
+
+libds_no_frc_2020 {
+    DEFINES += DS_NO_FRC_2020
+}
+
+# Compile the trace instrumentation (see DS_Trace.h), the recorded events
+# can be saved as a Chrome trace with DS_SaveTrace()
+libds_trace {
+    DEFINES += DS_ENABLE_TRACE
 }
 
 HEADERS += \
@@ -13,6 +89,7 @@ HEADERS += \
     $$PWD/include/DS_Config.h \
     $$PWD/include/DS_Events.h \
     $$PWD/include/DS_Joysticks.h \
+    $$PWD/include/DS_Macro.h \
     $$PWD/include/DS_Types.h \
     $$PWD/include/DS_Utils.h \
     $$PWD/include/LibDS.h \
@@ -21,18 +98,39 @@ HEADERS += \
     $$PWD/include/DS_Protocol.h \
     $$PWD/include/DS_DefaultProtocols.h \
     $$PWD/include/DS_Timer.h \
+    $$PWD/include/DS_Thread.h \
     $$PWD/include/DS_Queue.h \
-    $$PWD/include/DS_String.h
+    $$PWD/include/DS_String.h \
+    $$PWD/include/DS_Packet.h \
+    $$PWD/include/DS_Reader.h \
+    $$PWD/include/DS_Registry.h \
+    $$PWD/include/DS_Atomic.h \
+    $$PWD/include/DS_Histogram.h \
+    $$PWD/include/DS_Context.h \
+    $$PWD/include/DS_NetConsole.h \
+    $$PWD/include/DS_Messages.h \
+    $$PWD/include/DS_Capture.h \
+    $$PWD/include/DS_Telemetry.h \
+    $$PWD/include/DS_Metrics.h \
+    $$PWD/include/DS_Bandwidth.h \
+    $$PWD/include/DS_Brownout.h \
+    $$PWD/include/DS_History.h \
+    $$PWD/include/DS_Lifecycle.h \
+    $$PWD/include/DS_Match.h \
+    $$PWD/include/DS_Evdev.h \
+    $$PWD/include/DS_SelfTest.h \
+    $$PWD/include/DS_Dashboard.h \
+    $$PWD/include/DS_Stats.h \
+    $$PWD/include/DS_Trace.h
 
 SOURCES += \
-    $$PWD/src/protocols/frc_2014.c \
     $$PWD/src/protocols/frc_2015.c \
-    $$PWD/src/protocols/frc_2016.c \
     $$PWD/src/client.c \
     $$PWD/src/config.c \
     $$PWD/src/events.c \
     $$PWD/src/init.c \
     $$PWD/src/joysticks.c \
+    $$PWD/src/macro.c \
     $$PWD/src/protocols.c \
     $$PWD/src/socket.c \
     $$PWD/src/utils.c \
@@ -40,11 +138,40 @@ SOURCES += \
     $$PWD/src/array.c \
     $$PWD/src/timer.c \
     $$PWD/src/queue.c \
-    $$PWD/src/string.c
-    
-include ($$PWD/lib/Socky/Socky.pri)
+    $$PWD/src/string.c \
+    $$PWD/src/packet.c \
+    $$PWD/src/registry.c \
+    $$PWD/src/histogram.c \
+    $$PWD/src/context.c \
+    $$PWD/src/memory.c \
+    $$PWD/src/netconsole.c \
+    $$PWD/src/messages.c \
+    $$PWD/src/thread.c \
+    $$PWD/src/capture.c \
+    $$PWD/src/pcapng.c \
+    $$PWD/src/telemetry.c \
+    $$PWD/src/metrics.c \
+    $$PWD/src/bandwidth.c \
+    $$PWD/src/brownout.c \
+    $$PWD/src/history.c \
+    $$PWD/src/lifecycle.c \
+    $$PWD/src/match.c \
+    $$PWD/src/evdev.c \
+    $$PWD/src/selftest.c \
+    $$PWD/src/dashboard.c \
+    $$PWD/src/stats.c \
+    $$PWD/src/trace.c
+
+!libds_no_frc_2014 {
+    SOURCES += $$PWD/src/protocols/frc_2014.c
+}
 
-win32-msvc* {
-    #LIBS += -l
-    include ($$PWD/lib/pthread-win32/pthread-win32.pri)
+!libds_no_frc_2016 {
+    SOURCES += $$PWD/src/protocols/frc_2016.c
 }
+
+!libds_no_frc_2020 {
+    SOURCES += $$PWD/src/protocols/frc_2020.c
+}
+    
+include ($$PWD/lib/Socky/Socky.pri)
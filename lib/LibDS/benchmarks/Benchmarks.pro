@@ -0,0 +1,37 @@
+#-------------------------------------------------------------------------------
+# Remove Qt dependency
+#-------------------------------------------------------------------------------
+
+CONFIG += console
+
+CONFIG -= qt
+CONFIG -= app_bundle
+
+DEFINES -= UNICODE QT_LARGEFILE_SUPPORT
+
+#-------------------------------------------------------------------------------
+# Deploy options
+#-------------------------------------------------------------------------------
+
+TARGET = libds-bench
+
+#-------------------------------------------------------------------------------
+# Include libraries
+#-------------------------------------------------------------------------------
+
+include ($$PWD/../LibDS.pri)
+
+unix:!macx* {
+    LIBS += -pthread
+}
+
+win32* {
+    LIBS += -lws2_32
+}
+
+#-------------------------------------------------------------------------------
+# Import source code
+#-------------------------------------------------------------------------------
+
+SOURCES += \
+    $$PWD/src/main.c
@@ -0,0 +1,441 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Microbenchmarks for the LibDS hot paths (packet encoding/decoding, string,
+ * queue, array and checksum functions). Each benchmark reports the average time per
+ * operation and the number of heap allocations per operation. The precision
+ * of the 1 ms sleeps and timed waits used by the event loop is reported too.
+ *
+ * Allocations are counted by interposing malloc/calloc/realloc, which is only
+ * supported with glibc, on other platforms the allocation column reads "n/a".
+ */
+
+#include <LibDS.h>
+#include <DS_Array.h>
+#include <DS_Queue.h>
+#include <DS_Config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Allocation counter
+ */
+#if defined __GLIBC__
+    #define COUNT_ALLOCS 1
+
+    extern void* __libc_malloc (size_t size);
+    extern void* __libc_calloc (size_t count, size_t size);
+    extern void* __libc_realloc (void* ptr, size_t size);
+
+    static volatile size_t allocations = 0;
+
+    void* malloc (size_t size)
+    {
+        ++allocations;
+        return __libc_malloc (size);
+    }
+
+    void* calloc (size_t count, size_t size)
+    {
+        ++allocations;
+        return __libc_calloc (count, size);
+    }
+
+    void* realloc (void* ptr, size_t size)
+    {
+        ++allocations;
+        return __libc_realloc (ptr, size);
+    }
+#else
+    #define COUNT_ALLOCS 0
+    static volatile size_t allocations = 0;
+#endif
+
+/*
+ * Benchmark parameters
+ */
+#define ITERATIONS   200000
+#define WARMUP_ITERS 1000
+#define TIMING_ITERS 200
+
+/*
+ * Sink used to keep the compiler from optimizing benchmark bodies away
+ */
+static volatile uint32_t sink = 0;
+
+/*
+ * Shared state for the benchmark bodies
+ */
+static DS_Protocol protocol;
+static DS_String robot_response;
+static DS_String crc_buffer;
+static char netconsole_ascii [1024];
+static char netconsole_utf8 [1024];
+static DS_Queue queue;
+static DS_Array array;
+static DS_Cond wait_cond = DS_COND_INITIALIZER;
+static DS_Mutex wait_mutex = DS_MUTEX_INITIALIZER;
+
+/**
+ * Runs the given benchmark \a body for \a iterations times and prints the
+ * average time and number of heap allocations per operation
+ */
+static void run (const char* name, void (*body) (void), int iterations)
+{
+    int i;
+
+    /* Warm up caches and lazy initializations */
+    for (i = 0; i < WARMUP_ITERS; ++i)
+        body();
+
+    /* Measure */
+    size_t allocs = allocations;
+    uint64_t start = DS_GetTimeUs();
+    for (i = 0; i < iterations; ++i)
+        body();
+    uint64_t elapsed = DS_GetTimeUs() - start;
+    allocs = allocations - allocs;
+
+    /* Discard events generated by the protocol functions */
+    DS_Event event;
+    while (DS_PollEvent (&event));
+
+    /* Print results */
+    if (COUNT_ALLOCS)
+        printf ("%-36s %10.1f ns/op %8.2f allocs/op\n", name,
+                elapsed * 1e3 / iterations, (double) allocs / iterations);
+    else
+        printf ("%-36s %10.1f ns/op %8s allocs/op\n", name,
+                elapsed * 1e3 / iterations, "n/a");
+}
+
+/**
+ * Runs the given 1 ms wait \a body for \a iterations times and prints the
+ * average and worst duration of the wait (without a raised timer period,
+ * Windows rounds these waits up to 15.6 ms)
+ */
+static void run_timing (const char* name, void (*body) (void), int iterations)
+{
+    int i;
+    uint64_t total = 0;
+    uint64_t worst = 0;
+
+    for (i = 0; i < iterations; ++i) {
+        uint64_t start = DS_GetTimeUs();
+        body();
+        uint64_t elapsed = DS_GetTimeUs() - start;
+
+        total += elapsed;
+        if (elapsed > worst)
+            worst = elapsed;
+    }
+
+    printf ("%-36s %10.3f ms avg %8.3f ms max\n", name,
+            (double) total / iterations / 1e3, (double) worst / 1e3);
+}
+
+/**
+ * Registers \a count joysticks with 6 axes, 1 hat and 12 buttons, and
+ * gives them some non-trivial values
+ */
+static void set_joysticks (int count)
+{
+    int i, j;
+
+    DS_JoysticksReset();
+    for (i = 0; i < count; ++i) {
+        DS_JoysticksAdd (6, 1, 12);
+
+        for (j = 0; j < 6; ++j)
+            DS_SetJoystickAxis (i, j, (float) (j - 3) / 3.0f);
+        for (j = 0; j < 12; ++j)
+            DS_SetJoystickButton (i, j, j % 3 == 0);
+
+        DS_SetJoystickHat (i, 0, 90);
+    }
+}
+
+/**
+ * Generates a robot packet with the current protocol
+ */
+static void bench_create_robot_packet (void)
+{
+    if (protocol.write_robot_packet) {
+        uint8_t buffer[DS_PACKET_MAX_SIZE];
+
+        DS_Packet packet;
+        DS_PacketInit (&packet, buffer, sizeof (buffer));
+        protocol.write_robot_packet (&packet);
+        sink += (uint32_t) packet.len;
+    }
+
+    else if (protocol.create_robot_packet) {
+        DS_String data = protocol.create_robot_packet();
+        sink += (uint32_t) DS_StrLen (&data);
+        DS_StrRmBuf (&data);
+    }
+}
+
+/**
+ * Interprets a canned robot response with the current protocol
+ */
+static void bench_read_robot_packet (void)
+{
+    sink += (uint32_t) protocol.read_robot_packet (&robot_response);
+}
+
+/**
+ * Appends a full packet worth of bytes to a string
+ */
+static void bench_str_append (void)
+{
+    int i;
+    DS_String string = DS_StrNewLen (0);
+
+    for (i = 0; i < 64; ++i)
+        DS_StrAppend (&string, (uint8_t) i);
+
+    sink += (uint32_t) DS_StrLen (&string);
+    DS_StrRmBuf (&string);
+}
+
+/**
+ * Formats a robot address in a stack buffer
+ */
+static void bench_str_format_buf (void)
+{
+    char address [64];
+    sink += (uint32_t) DS_StrFormatBuf (address, sizeof (address),
+                                        "roboRIO-%d-FRC.local", (int) (sink & 0xfff));
+}
+
+/**
+ * Pushes and pops an item from the queue
+ */
+static void bench_queue_push_pop (void)
+{
+    uint32_t item = sink;
+    DS_QueuePush (&queue, &item);
+    sink += *((uint32_t*) DS_QueueGetFirst (&queue));
+    DS_QueuePop (&queue);
+}
+
+/**
+ * Fills the array with the state of six joysticks and clears it, which
+ * reuses the storage of the previous iteration
+ */
+static void bench_array_fill_clear (void)
+{
+    int i;
+    DS_JoystickState state;
+
+    memset (&state, 0, sizeof (state));
+    for (i = 0; i < 6; ++i)
+        DS_ArrayInsert (&array, &state);
+
+    sink += (uint32_t) array.used;
+    DS_ArrayClear (&array);
+}
+
+/**
+ * Updates every value of a controller (6 axes, 12 buttons and 1 hat) with
+ * one call per value
+ */
+static void bench_set_joystick_values (void)
+{
+    int i;
+    const int phase = (int) (sink & 1);
+
+    for (i = 0; i < 6; ++i)
+        DS_SetJoystickAxis (0, i, phase ? 0.5f : -0.5f);
+    for (i = 0; i < 12; ++i)
+        DS_SetJoystickButton (0, i, (i + phase) % 2);
+
+    DS_SetJoystickHat (0, 0, phase ? 90 : 270);
+    ++sink;
+}
+
+/**
+ * Updates every value of a controller with a single publication
+ */
+static void bench_set_joystick_state (void)
+{
+    int i;
+    float axes [6];
+    const int phase = (int) (sink & 1);
+    const int hat = phase ? 90 : 270;
+
+    for (i = 0; i < 6; ++i)
+        axes [i] = phase ? 0.5f : -0.5f;
+
+    DS_SetJoystickState (0, axes, 6, phase ? 0xAAA : 0x555, &hat, 1);
+    ++sink;
+}
+
+/**
+ * Stores a 1024-byte NetConsole datagram (16 lines of printable ASCII)
+ */
+static void bench_netconsole_ascii (void)
+{
+    DS_NetConsoleAppend (netconsole_ascii, sizeof (netconsole_ascii));
+    sink += (uint32_t) netconsole_ascii [0];
+}
+
+/**
+ * Stores a 1024-byte NetConsole datagram with UTF-8 text, tabs and CRLF
+ * line endings, which must be cleaned before it is stored
+ */
+static void bench_netconsole_utf8 (void)
+{
+    DS_NetConsoleAppend (netconsole_utf8, sizeof (netconsole_utf8));
+    sink += (uint32_t) netconsole_utf8 [0];
+}
+
+/**
+ * Fills the NetConsole datagrams used by the benchmarks
+ */
+static void init_netconsole_data (void)
+{
+    int i;
+    const char* utf8 = "\tTemp: 42 \xC2\xB0""C \xE2\x86\x92 OK\r\n";
+    const size_t utf8_len = strlen (utf8);
+
+    for (i = 0; i < (int) sizeof (netconsole_ascii); ++i)
+        netconsole_ascii [i] = (i % 64 == 63) ? '\n' : (char) ('a' + i % 26);
+
+    for (i = 0; i < (int) sizeof (netconsole_utf8); ++i)
+        netconsole_utf8 [i] = utf8 [i % utf8_len];
+}
+
+/**
+ * Calculates the checksum of a 1024-byte datagram
+ */
+static void bench_sleep (void)
+{
+    DS_Sleep (1);
+}
+
+static void bench_timed_wait (void)
+{
+    DS_MutexLock (&wait_mutex);
+    DS_TimedWait (&wait_cond, &wait_mutex, 1);
+    DS_MutexUnlock (&wait_mutex);
+}
+
+static void bench_crc32 (void)
+{
+    sink += DS_CRC32 (crc_buffer.buf, DS_StrLen (&crc_buffer));
+}
+
+/**
+ * Runs the encode/decode benchmarks of the given \a proto with
+ * 0, 1, 3 and 6 joysticks
+ */
+static void bench_protocol (DS_Protocol proto, int response_size)
+{
+    int i;
+    char name[64];
+    const int counts[] = { 0, 1, 3, 6 };
+
+    protocol = proto;
+    char* proto_name = DS_StrToChar (&protocol.name);
+
+    /* Build a plausible robot response (12.50 V, robot code present) */
+    robot_response = DS_StrNewLen (response_size);
+    DS_StrSetChar (&robot_response, 4, 0x20);
+    DS_StrSetChar (&robot_response, 5, 0x0c);
+    DS_StrSetChar (&robot_response, 6, 0x80);
+
+    for (i = 0; i < (int) (sizeof (counts) / sizeof (counts[0])); ++i) {
+        set_joysticks (counts[i]);
+        snprintf (name, sizeof (name), "%s create_robot_packet (%d js)",
+                  proto_name, counts[i]);
+        run (name, &bench_create_robot_packet, ITERATIONS);
+    }
+
+    snprintf (name, sizeof (name), "%s read_robot_packet", proto_name);
+    run (name, &bench_read_robot_packet, ITERATIONS);
+
+    DS_StrRmBuf (&robot_response);
+    DS_FREE (proto_name);
+}
+
+/**
+ * Main entry point of the application
+ */
+int main (void)
+{
+    /* Initialize the DS, but do not load any protocol (no sockets) */
+    DS_Init();
+    CFG_SetRobotEnabled (1);
+    CFG_SetControlMode (DS_CONTROL_TELEOPERATED);
+
+    /* Protocol benchmarks */
+    bench_protocol (DS_GetProtocolFRC_2014(), 1024);
+    bench_protocol (DS_GetProtocolFRC_2015(), 8);
+    bench_protocol (DS_GetProtocolFRC_2016(), 8);
+    DS_JoysticksReset();
+
+    /* Joystick update benchmarks */
+    set_joysticks (1);
+    run ("DS_SetJoystick* (1 js, 19 values)", &bench_set_joystick_values, ITERATIONS);
+    run ("DS_SetJoystickState (1 js)", &bench_set_joystick_state, ITERATIONS);
+    DS_JoysticksReset();
+
+    /* NetConsole benchmarks */
+    init_netconsole_data();
+    DS_SetNetConsoleMessageEvents (0);
+    run ("DS_NetConsoleAppend (1 KiB ASCII)", &bench_netconsole_ascii, ITERATIONS);
+    run ("DS_NetConsoleAppend (1 KiB UTF-8)", &bench_netconsole_utf8, ITERATIONS);
+    DS_NetConsoleClear();
+
+    /* String benchmarks */
+    run ("DS_StrAppend (64 bytes)", &bench_str_append, ITERATIONS);
+    run ("DS_StrFormatBuf (robot address)", &bench_str_format_buf, ITERATIONS);
+
+    /* Queue benchmarks */
+    DS_QueueInit (&queue, 16, sizeof (uint32_t));
+    run ("DS_QueuePush/DS_QueuePop", &bench_queue_push_pop, ITERATIONS);
+    DS_QueueFree (&queue);
+
+    /* Array benchmarks */
+    DS_ArrayInit (&array, 0, sizeof (DS_JoystickState));
+    run ("DS_ArrayInsert (6 js)/DS_ArrayClear", &bench_array_fill_clear, ITERATIONS);
+    DS_ArrayFree (&array);
+
+    /* Checksum benchmarks */
+    crc_buffer = DS_StrNewLen (1024);
+    run ("DS_CRC32 (1024 bytes)", &bench_crc32, ITERATIONS);
+    DS_StrRmBuf (&crc_buffer);
+
+    /* Timing benchmarks */
+    run_timing ("DS_Sleep (1 ms)", &bench_sleep, TIMING_ITERS);
+    run_timing ("DS_TimedWait (1 ms)", &bench_timed_wait, TIMING_ITERS);
+
+    /* Close the DS */
+    DS_Close();
+    return EXIT_SUCCESS;
+}
@@ -35,6 +35,9 @@ win32* {
 # Include libraries
 #-------------------------------------------------------------------------------
 
+# Uncomment to bind the FRC 2015/2016 protocol at compile time (embedded builds)
+#CONFIG += libds_static_frc_2015
+
 include ($$PWD/../../LibDS.pri)
 include ($$PWD/lib/sdl/SDL.pri)
 
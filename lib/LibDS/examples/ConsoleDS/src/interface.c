@@ -26,6 +26,7 @@
 #include <stdlib.h>
 #include <curses.h>
 
+#include <DS_Timer.h>
 #include <DS_Utils.h>
 #include <DS_String.h>
 #include <DS_Client.h>
@@ -37,6 +38,22 @@
 #define ENABLED  "Enabled"
 #define DISABLED "Disabled"
 
+/*
+ * Minimum time between two screen updates (about 30 frames per second)
+ */
+#define FRAME_INTERVAL 33
+
+/*
+ * Windows that need to be re-drawn in the next frame
+ */
+#define WIN_VOLTAGE 0x01
+#define WIN_ROBOTIP 0x02
+#define WIN_RSTATUS 0x04
+#define WIN_CONSOLE 0x08
+#define WIN_STATUS  0x10
+#define WIN_BOTTOM  0x20
+#define WIN_ALL     0x3f
+
 /*
  * Define windows
  */
@@ -48,6 +65,12 @@ static WINDOW* voltage_win = NULL;
 static WINDOW* robot_status = NULL;
 static WINDOW* bottom_window = NULL;
 
+/*
+ * Dirty window mask and the time of the last screen update
+ */
+static int dirty = WIN_ALL;
+static uint64_t last_frame = 0;
+
 /*
  * Define window elements
  */
@@ -87,6 +110,16 @@ static void update_label (DS_String* string)
     }
 }
 
+/**
+ * Writes the given \a string at the given position of the \a win, the
+ * string is written directly from its buffer to avoid a copy per frame
+ */
+static void draw_string (WINDOW* win, int y, int x, const DS_String* string)
+{
+    if (win && string && string->buf)
+        mvwaddnstr (win, y, x, string->buf, (int) string->len);
+}
+
 /**
  * Sets the default label texts
  */
@@ -107,11 +140,28 @@ static void init_strings (void)
 }
 
 /**
- * Creates the base windows of the application
+ * Deletes the label texts
  */
-static void draw_windows (void)
+static void close_strings (void)
+{
+    DS_StrRmBuf (&can_str);
+    DS_StrRmBuf (&cpu_str);
+    DS_StrRmBuf (&ram_str);
+    DS_StrRmBuf (&disk_str);
+    DS_StrRmBuf (&robot_ip);
+    DS_StrRmBuf (&voltage_str);
+    DS_StrRmBuf (&console_str);
+    DS_StrRmBuf (&rstatus_str);
+    DS_StrRmBuf (&stick_check_str);
+    DS_StrRmBuf (&rcode_check_str);
+    DS_StrRmBuf (&robot_check_str);
+}
+
+/**
+ * Deletes the child windows
+ */
+static void delete_windows (void)
 {
-    /* Delete the windows */
     delwin (robotip_win);
     delwin (console_win);
     delwin (status_info);
@@ -119,6 +169,22 @@ static void draw_windows (void)
     delwin (robot_status);
     delwin (bottom_window);
 
+    robotip_win = NULL;
+    console_win = NULL;
+    status_info = NULL;
+    voltage_win = NULL;
+    robot_status = NULL;
+    bottom_window = NULL;
+}
+
+/**
+ * Creates the child windows to fit the current terminal size, this is only
+ * done on startup and when the terminal is resized
+ */
+static void create_windows (void)
+{
+    delete_windows();
+
     /* Set window sizing */
     int top_height = 3;
     int bottom_height = 3;
@@ -137,62 +203,84 @@ static void draw_windows (void)
     /* Create botttom window */
     bottom_window = newwin (bottom_height, COLS, LINES - bottom_height, 0);
 
-    /* Draw borders */
-    wborder (voltage_win,   0, 0, 0, 0, 0, 0, 0, 0);
-    wborder (robot_status,  0, 0, 0, 0, 0, 0, 0, 0);
-    wborder (robotip_win,   0, 0, 0, 0, 0, 0, 0, 0);
-    wborder (console_win,   0, 0, 0, 0, 0, 0, 0, 0);
-    wborder (status_info,   0, 0, 0, 0, 0, 0, 0, 0);
-    wborder (bottom_window, 0, 0, 0, 0, 0, 0, 0, 0);
+    dirty = WIN_ALL;
+}
+
+/**
+ * Clears the given \a win and draws its border, the window is then
+ * ready to receive its elements
+ */
+static int begin_window (WINDOW* win)
+{
+    if (!win)
+        return 0;
 
-    /* Add top window elements */
-    mvwaddstr (console_win,  1, 2, DS_StrToChar (&console_str));
-    mvwaddstr (robotip_win,  1, 2, DS_StrToChar (&robot_ip));
-    mvwaddstr (robot_status, 1, 2, DS_StrToChar (&rstatus_str));
+    werase (win);
+    wborder (win, 0, 0, 0, 0, 0, 0, 0, 0);
+    return 1;
+}
 
+/**
+ * Re-draws the windows that changed since the last frame and copies them
+ * to the virtual screen, windows that did not change are left untouched
+ */
+static void draw_windows (void)
+{
     /* Add voltage elements */
-    mvwaddstr (voltage_win,  1,  2, "Voltage:");
-    mvwaddstr (voltage_win,  1, 11, DS_StrToChar (&voltage_str));
+    if ((dirty & WIN_VOLTAGE) && begin_window (voltage_win)) {
+        mvwaddstr (voltage_win, 1, 2, "Voltage:");
+        draw_string (voltage_win, 1, 11, &voltage_str);
+        wnoutrefresh (voltage_win);
+    }
 
-    /* Add status panel elements */
-    mvwaddstr (status_info, 1, 2, "STATUS:");
-    mvwaddstr (status_info, 3, 2, DS_StrToChar (&robot_check_str));
-    mvwaddstr (status_info, 4, 2, DS_StrToChar (&rcode_check_str));
-    mvwaddstr (status_info, 5, 2, DS_StrToChar (&stick_check_str));
-    mvwaddstr (status_info, 3, 6, "Robot Comms");
-    mvwaddstr (status_info, 4, 6, "Robot Code");
-    mvwaddstr (status_info, 5, 6, "Joysticks");
+    /* Add robot address elements */
+    if ((dirty & WIN_ROBOTIP) && begin_window (robotip_win)) {
+        draw_string (robotip_win, 1, 2, &robot_ip);
+        wnoutrefresh (robotip_win);
+    }
 
     /* Add robot status elements */
-    mvwaddstr (status_info,  7, 2, "ROBOT STATUS:");
-    mvwaddstr (status_info,  9, 2, "CAN:");
-    mvwaddstr (status_info, 10, 2, "CPU:");
-    mvwaddstr (status_info, 11, 2, "RAM:");
-    mvwaddstr (status_info, 12, 2, "Disk:");
-    mvwaddstr (status_info,  9, 8, DS_StrToChar (&can_str));
-    mvwaddstr (status_info, 10, 8, DS_StrToChar (&cpu_str));
-    mvwaddstr (status_info, 11, 8, DS_StrToChar (&ram_str));
-    mvwaddstr (status_info, 12, 8, DS_StrToChar (&disk_str));
+    if ((dirty & WIN_RSTATUS) && begin_window (robot_status)) {
+        draw_string (robot_status, 1, 2, &rstatus_str);
+        wnoutrefresh (robot_status);
+    }
 
-    /* Add bottom bar labels */
-    mvwaddstr (bottom_window, 1, 2,  "Quit (q)");
-    mvwaddstr (bottom_window, 1, 13, "Set enabled (e,d)");
-    mvwaddstr (bottom_window, 1, 34, "Set Control Mode (o,a,t)");
-    mvwaddstr (bottom_window, 1, 62, "More Options (m)");
-}
+    /* Add console elements */
+    if ((dirty & WIN_CONSOLE) && begin_window (console_win)) {
+        draw_string (console_win, 1, 2, &console_str);
+        wnoutrefresh (console_win);
+    }
 
-/**
- * Refreshes the contents of each window
- */
-static void refresh_windows (void)
-{
-    wnoutrefresh (window);
-    wnoutrefresh (robotip_win);
-    wnoutrefresh (console_win);
-    wnoutrefresh (status_info);
-    wnoutrefresh (voltage_win);
-    wnoutrefresh (robot_status);
-    wnoutrefresh (bottom_window);
+    /* Add status panel elements */
+    if ((dirty & WIN_STATUS) && begin_window (status_info)) {
+        mvwaddstr (status_info, 1, 2, "STATUS:");
+        draw_string (status_info, 3, 2, &robot_check_str);
+        draw_string (status_info, 4, 2, &rcode_check_str);
+        draw_string (status_info, 5, 2, &stick_check_str);
+        mvwaddstr (status_info, 3, 6, "Robot Comms");
+        mvwaddstr (status_info, 4, 6, "Robot Code");
+        mvwaddstr (status_info, 5, 6, "Joysticks");
+
+        mvwaddstr (status_info,  7, 2, "ROBOT STATUS:");
+        mvwaddstr (status_info,  9, 2, "CAN:");
+        mvwaddstr (status_info, 10, 2, "CPU:");
+        mvwaddstr (status_info, 11, 2, "RAM:");
+        mvwaddstr (status_info, 12, 2, "Disk:");
+        draw_string (status_info,  9, 8, &can_str);
+        draw_string (status_info, 10, 8, &cpu_str);
+        draw_string (status_info, 11, 8, &ram_str);
+        draw_string (status_info, 12, 8, &disk_str);
+        wnoutrefresh (status_info);
+    }
+
+    /* Add bottom bar labels */
+    if ((dirty & WIN_BOTTOM) && begin_window (bottom_window)) {
+        mvwaddstr (bottom_window, 1, 2,  "Quit (q)");
+        mvwaddstr (bottom_window, 1, 13, "Set enabled (e,d)");
+        mvwaddstr (bottom_window, 1, 34, "Set Control Mode (o,a,t)");
+        mvwaddstr (bottom_window, 1, 62, "More Options (m)");
+        wnoutrefresh (bottom_window);
+    }
 }
 
 /**
@@ -222,8 +310,11 @@ void init_interface (void)
     noecho();
     curs_set (0);
     keypad (window, 1);
+    nodelay (window, 1);
 
     clear();
+    wnoutrefresh (window);
+    create_windows();
 }
 
 /**
@@ -231,9 +322,9 @@ void init_interface (void)
  */
 void close_interface (void)
 {
-    delwin (window);
+    delete_windows();
     endwin();
-    refresh();
+    close_strings();
 
 #if defined __WIN32
     system ("CLS");
@@ -243,13 +334,47 @@ void close_interface (void)
 }
 
 /**
- * Re-draws the user interface
+ * Re-creates the windows after the terminal has been resized
+ */
+void resize_interface (void)
+{
+    clear();
+    wnoutrefresh (window);
+    create_windows();
+}
+
+/**
+ * Returns the number of milliseconds to wait before the next call to
+ * \c update_interface() can draw a frame, or \c -1 if nothing needs to
+ * be re-drawn (in which case the application can sleep until an event)
+ */
+int interface_wait_time (void)
+{
+    if (!dirty)
+        return -1;
+
+    uint64_t elapsed = DS_GetTimeMs() - last_frame;
+    if (elapsed >= FRAME_INTERVAL)
+        return 0;
+
+    return FRAME_INTERVAL - (int) elapsed;
+}
+
+/**
+ * Re-draws the windows that changed since the last frame, the screen is
+ * updated at most once every \c FRAME_INTERVAL milliseconds so that bursts
+ * of events are coalesced into a single frame
  */
 void update_interface (void)
 {
-    refresh();
+    if (interface_wait_time() != 0)
+        return;
+
     draw_windows();
-    refresh_windows();
+    doupdate();
+
+    dirty = 0;
+    last_frame = DS_GetTimeMs();
 }
 
 /**
@@ -260,6 +385,7 @@ void update_status_label (void)
 {
     DS_StrRmBuf (&rstatus_str);
     rstatus_str = DS_StrNew (DS_GetStatusString());
+    dirty |= WIN_RSTATUS;
 }
 
 /**
@@ -270,6 +396,7 @@ void set_can (const int can)
     DS_StrRmBuf (&can_str);
     can_str = DS_StrFormat ("%d %%", can);
     update_label (&can_str);
+    dirty |= WIN_STATUS;
 }
 
 /**
@@ -280,6 +407,7 @@ void set_cpu (const int cpu)
     DS_StrRmBuf (&cpu_str);
     cpu_str = DS_StrFormat ("%d %%", cpu);
     update_label (&cpu_str);
+    dirty |= WIN_STATUS;
 }
 
 /**
@@ -290,6 +418,7 @@ void set_ram (const int ram)
     DS_StrRmBuf (&ram_str);
     ram_str = DS_StrFormat ("%d %%", ram);
     update_label (&ram_str);
+    dirty |= WIN_STATUS;
 }
 
 /**
@@ -300,6 +429,7 @@ void set_disk (const int disk)
     DS_StrRmBuf (&disk_str);
     disk_str = DS_StrFormat ("%d %%", disk);
     update_label (&disk_str);
+    dirty |= WIN_STATUS;
 }
 
 /**
@@ -308,6 +438,7 @@ void set_disk (const int disk)
 void set_robot_code (const int code)
 {
     set_checked (&rcode_check_str, code);
+    dirty |= WIN_STATUS;
 }
 
 /**
@@ -315,9 +446,12 @@ void set_robot_code (const int code)
  */
 void set_robot_comms (const int comms)
 {
+    char* address = DS_GetAppliedRobotAddress();
     DS_StrRmBuf (&robot_ip);
-    robot_ip = DS_StrNew (DS_GetAppliedRobotAddress());
+    robot_ip = DS_StrNew (address);
+    DS_FREE (address);
     set_checked (&robot_check_str, comms);
+    dirty |= WIN_STATUS | WIN_ROBOTIP;
 }
 
 /**
@@ -328,6 +462,7 @@ void set_voltage (const double voltage)
     DS_StrRmBuf (&voltage_str);
     voltage_str = DS_StrFormat ("%f V", voltage);
     update_label (&voltage_str);
+    dirty |= WIN_VOLTAGE;
 }
 
 /**
@@ -336,4 +471,5 @@ void set_voltage (const double voltage)
 void set_has_joysticks (const int joysticks)
 {
     set_checked (&stick_check_str, joysticks);
+    dirty |= WIN_STATUS;
 }
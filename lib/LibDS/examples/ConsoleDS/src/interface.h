@@ -29,7 +29,9 @@ extern "C" {
 
 extern void init_interface (void);
 extern void close_interface (void);
+extern void resize_interface (void);
 extern void update_interface (void);
+extern int interface_wait_time (void);
 extern void update_status_label (void);
 
 extern void set_can (const int can);
@@ -20,204 +20,261 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
-#include "interface.h"
+#include "joystick.h"
 
 #include <SDL.h>
 #include <LibDS.h>
 #include <stdio.h>
-#include <pthread.h>
+#include <stdlib.h>
 
-#define INVALID_ID     -1
 #define SDL_AXIS_RANGE 0x8000
 
-/**
- * Allows the \c update_joysticks() function to know if its
- * safe to check for new SDL events
+/*
+ * Packet period (in msecs) used when no protocol is loaded, and the longest
+ * time that the input thread waits before checking if it must stop
  */
-static int initialized = 0;
+#define DEFAULT_PERIOD 20
+#define MAX_WAIT       100
 
-/**
- * SDL2 does not adjust the joystick IDs with the 'real' USB
- * ID's, which causes a lot of trouble when updating the
- * joystick values with the Driver Station
+/*
+ * The SDL joysticks are read by a dedicated input thread, which takes a
+ * snapshot of every controller once per robot packet period and publishes
+ * each one with a single DS_SetJoystickState() call. The thread is woken by
+ * a schedule of the LibDS timer thread (see DS_Schedule()), so the snapshots
+ * follow the same clock as the robot packets. The evdev backend is read by
+ * the LibDS itself, on its socket reactor.
+ */
+static int evdev = 0;
+static int running = 0;
+static int schedule = 0;
+static unsigned int periods = 0;
+static DS_Thread thread;
+static DS_Mutex mutex = DS_MUTEX_INITIALIZER;
+static DS_Cond cond = DS_COND_INITIALIZER;
+
+/*
+ * Joysticks opened by the input thread, in the order of the DS joysticks
  */
-static int joystick_tracker = -1;
+static int count = 0;
+static SDL_Joystick* joysticks [DS_MAX_JOYSTICKS];
 
 /**
- * Calculates the dynamic ID of the given joystick
+ * Returns the angle of the given SDL hat \a value, or \c -1 if the hat is
+ * not pressed
  */
-static int get_id (const int id)
+static int hat_angle (const Uint8 value)
 {
-    int joystick = id;
-    joystick = abs (joystick_tracker - (joystick + 1));
+    switch (value) {
+    case SDL_HAT_RIGHTUP:
+        return 45;
+    case SDL_HAT_RIGHTDOWN:
+        return 135;
+    case SDL_HAT_LEFTDOWN:
+        return 225;
+    case SDL_HAT_LEFTUP:
+        return 315;
+    case SDL_HAT_UP:
+        return 0;
+    case SDL_HAT_RIGHT:
+        return 90;
+    case SDL_HAT_DOWN:
+        return 180;
+    case SDL_HAT_LEFT:
+        return 270;
+    default:
+        return -1;
+    }
+}
 
-    if (joystick >= SDL_NumJoysticks())
-        joystick -= 1;
+/**
+ * Closes the joysticks opened by \c open_devices()
+ */
+static void close_devices (void)
+{
+    int i;
+    for (i = 0; i < count; ++i)
+        SDL_JoystickClose (joysticks [i]);
 
-    return joystick;
+    count = 0;
 }
 
 /**
- * Registers all the detected SDL joysticks with the Driver Station
+ * Opens all the attached joysticks and registers them with the Driver Station
  */
-static void register_joysticks (void)
+static void open_devices (void)
 {
+    int i;
+    SDL_Joystick* joystick;
+
+    close_devices();
     DS_JoysticksReset();
 
-    int i;
-    for (i = 0; i < SDL_NumJoysticks(); ++i) {
-        SDL_Joystick* joystick = SDL_JoystickOpen (i);
+    for (i = 0; i < SDL_NumJoysticks() && count < DS_MAX_JOYSTICKS; ++i) {
+        joystick = SDL_JoystickOpen (i);
+        if (!joystick)
+            continue;
 
-        if (joystick) {
-            DS_JoysticksAdd (SDL_JoystickNumAxes (joystick),
-                             SDL_JoystickNumHats (joystick),
-                             SDL_JoystickNumButtons (joystick));
-        }
+        joysticks [count++] = joystick;
+        DS_JoysticksAdd (DS_Min (SDL_JoystickNumAxes (joystick), DS_MAX_JOYSTICK_AXES),
+                         DS_Min (SDL_JoystickNumHats (joystick), DS_MAX_JOYSTICK_HATS),
+                         DS_Min (SDL_JoystickNumButtons (joystick), DS_MAX_JOYSTICK_BUTTONS));
     }
 }
 
 /**
- * Extracts the hat/POV information from the given \a event
- * and updates the state of the Driver Station joysticks
+ * Returns \c 1 if a joystick was attached or removed since the joysticks
+ * were opened
  */
-static void process_hat_event (SDL_Event* event)
+static int devices_changed (void)
 {
-    if (!event)
-        return;
-
-    int angle = 0;
-    int hat = event->jhat.hat;
-    int joystick = get_id (event->jhat.which);
+    int i;
+    if (DS_Min (SDL_NumJoysticks(), DS_MAX_JOYSTICKS) != count)
+        return 1;
 
-    switch (event->jhat.value) {
-    case SDL_HAT_RIGHTUP:
-        angle = 45;
-        break;
-    case SDL_HAT_RIGHTDOWN:
-        angle = 135;
-        break;
-    case SDL_HAT_LEFTDOWN:
-        angle = 225;
-        break;
-    case SDL_HAT_LEFTUP:
-        angle = 315;
-        break;
-    case SDL_HAT_UP:
-        angle = 0;
-        break;
-    case SDL_HAT_RIGHT:
-        angle = 90;
-        break;
-    case SDL_HAT_DOWN:
-        angle = 180;
-        break;
-    case SDL_HAT_LEFT:
-        angle = 270;
-        break;
-    default:
-        angle = -1;
-        break;
+    for (i = 0; i < count; ++i) {
+        if (!SDL_JoystickGetAttached (joysticks [i]))
+            return 1;
     }
 
-    if (joystick > INVALID_ID)
-        DS_SetJoystickHat (joystick, hat, angle);
+    return 0;
 }
 
 /**
- * Extracts the axis information from the given \a event and updates
- * the state of the Driver Station joysticks
+ * Takes a snapshot of every joystick and publishes it to the Driver Station
  */
-static void process_axis_event (SDL_Event* event)
+static void publish_states (void)
 {
-    if (!event)
-        return;
+    int i, j;
+    int num_axes;
+    int num_hats;
+    int num_buttons;
+    uint32_t buttons;
+    SDL_Joystick* joystick;
+    int hats [DS_MAX_JOYSTICK_HATS];
+    float axes [DS_MAX_JOYSTICK_AXES];
 
-    int axis = event->jaxis.axis;
-    int joystick = get_id (event->jaxis.which);
-    double value = ((double) (event->jaxis.value)) / SDL_AXIS_RANGE;
+    for (i = 0; i < count; ++i) {
+        joystick = joysticks [i];
+        num_axes = DS_Min (SDL_JoystickNumAxes (joystick), DS_MAX_JOYSTICK_AXES);
+        num_hats = DS_Min (SDL_JoystickNumHats (joystick), DS_MAX_JOYSTICK_HATS);
+        num_buttons = DS_Min (SDL_JoystickNumButtons (joystick), DS_MAX_JOYSTICK_BUTTONS);
 
-    if (joystick > INVALID_ID)
-        DS_SetJoystickAxis (joystick, axis, value);
+        for (j = 0; j < num_axes; ++j)
+            axes [j] = (float) SDL_JoystickGetAxis (joystick, j) / SDL_AXIS_RANGE;
+
+        for (j = 0; j < num_hats; ++j)
+            hats [j] = hat_angle (SDL_JoystickGetHat (joystick, j));
+
+        buttons = 0;
+        for (j = 0; j < num_buttons; ++j) {
+            if (SDL_JoystickGetButton (joystick, j))
+                buttons |= (uint32_t) 1 << j;
+        }
+
+        DS_SetJoystickState (i, axes, num_axes, buttons, hats, num_hats);
+    }
 }
 
 /**
- * Extracts the button information from the given \a event
- * and updates the state of the Driver Station joysticks
+ * Called by the LibDS timer thread once per packet period, wakes up the
+ * input thread
  */
-static void process_button_event (SDL_Event* event)
+static void on_packet_period (void* data)
 {
-    if (!event)
-        return;
-
-    int button = event->jbutton.button;
-    int joystick = get_id (event->jbutton.which);
-    int pressed = (event->jbutton.state == SDL_PRESSED);
+    (void) data;
 
-    if (joystick > INVALID_ID)
-        DS_SetJoystickButton (joystick, button, pressed);
+    DS_MutexLock (&mutex);
+    ++periods;
+    DS_CondSignal (&cond);
+    DS_MutexUnlock (&mutex);
 }
 
 /**
- * Initializes SDL in another thread (to avoid slowing down the startup time)
+ * Input thread, reads and publishes the joysticks once per packet period
+ * until \c close_joysticks() is called
  */
-void init_joysticks (void)
+static void* run_input (void* data)
 {
-    if (SDL_Init (SDL_INIT_JOYSTICK) == 0) {
-        initialized = 1;
-        SDL_JoystickEventState (SDL_ENABLE);
-    }
+    unsigned int handled = 0;
+    (void) data;
 
-    else {
-        printf ("Cannot initialize SDL!");
-        exit (EXIT_FAILURE);
+    DS_MutexLock (&mutex);
+    while (running) {
+        if (periods == handled) {
+            DS_TimedWait (&cond, &mutex, MAX_WAIT);
+            continue;
+        }
+
+        handled = periods;
+        DS_MutexUnlock (&mutex);
+
+        SDL_JoystickUpdate();
+        if (devices_changed())
+            open_devices();
+
+        publish_states();
+
+        DS_MutexLock (&mutex);
     }
+    DS_MutexUnlock (&mutex);
+
+    close_devices();
+    return NULL;
 }
 
 /**
- * Instructs the SDL library to begin closing down
+ * Starts the SDL input thread, or the evdev backend of the LibDS if
+ * \a use_evdev is set (SDL is used if the backend cannot be started).
+ *
+ * This must be called after the protocol is configured, the joysticks are
+ * read once per robot packet period of the protocol.
  */
-void close_joysticks (void)
+void init_joysticks (const int use_evdev)
 {
-    int i;
-    for (i = 0; i < SDL_NumJoysticks(); ++i)
-        SDL_JoystickClose (SDL_JoystickOpen (i));
+    int period = DEFAULT_PERIOD;
+    DS_Protocol* protocol = DS_CurrentProtocol();
 
-    SDL_Quit();
+    if (use_evdev && DS_EvdevStart()) {
+        evdev = 1;
+        return;
+    }
+
+    if (SDL_Init (SDL_INIT_JOYSTICK) != 0) {
+        printf ("Cannot initialize SDL!");
+        exit (EXIT_FAILURE);
+    }
+
+    /* The joysticks are polled, there is no need to queue their events */
+    SDL_JoystickEventState (SDL_IGNORE);
+
+    if (protocol && protocol->robot_interval > 0)
+        period = protocol->robot_interval;
+
+    running = 1;
+    if (DS_CreateThread (&thread, "ConsoleDS input", &run_input, NULL) != 0) {
+        printf ("Cannot start the input thread!");
+        exit (EXIT_FAILURE);
+    }
+
+    schedule = DS_Schedule (period, &on_packet_period, NULL);
 }
 
 /**
- * Queries for new SDL joystick events and updates the
- * Driver Station with the new joystick information.
+ * Stops the input thread and closes SDL, this must be called before the
+ * LibDS is closed
  */
-void update_joysticks (void)
+void close_joysticks (void)
 {
-    if (!initialized)
+    if (evdev)
         return;
 
-    SDL_Event event;
-    while (SDL_PollEvent (&event)) {
-        switch (event.type) {
-        case SDL_JOYDEVICEADDED:
-            ++joystick_tracker;
-            register_joysticks();
-            break;
-        case SDL_JOYDEVICEREMOVED:
-            register_joysticks();
-            break;
-        case SDL_JOYAXISMOTION:
-            process_axis_event (&event);
-            break;
-        case SDL_JOYHATMOTION:
-            process_hat_event (&event);
-            break;
-        case SDL_JOYBUTTONDOWN:
-            process_button_event (&event);
-            break;
-        case SDL_JOYBUTTONUP:
-            process_button_event (&event);
-            break;
-        default:
-            break;
-        }
-    }
+    DS_Unschedule (schedule);
+
+    DS_MutexLock (&mutex);
+    running = 0;
+    DS_CondSignal (&cond);
+    DS_MutexUnlock (&mutex);
+
+    DS_JoinThread (thread);
+    SDL_Quit();
 }
@@ -27,9 +27,8 @@
 extern "C" {
 #endif
 
-extern void init_joysticks (void);
+extern void init_joysticks (const int use_evdev);
 extern void close_joysticks (void);
-extern void update_joysticks (void);
 
 #ifdef __cplusplus
 }
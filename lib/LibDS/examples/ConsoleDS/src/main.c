@@ -26,107 +26,181 @@
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <pthread.h>
+#include <string.h>
+
+#if defined _WIN32
+    #include <windows.h>
+#else
+    #include <unistd.h>
+    #include <sys/select.h>
+#endif
 
 #include "joystick.h"
 #include "interface.h"
 
+/*
+ * Events displayed by the interface, the other events are not queued
+ */
+#define INTERFACE_EVENTS (DS_EVENT_MASK (DS_JOYSTICK_COUNT_CHANGED)  | \
+                          DS_EVENT_MASK (DS_ROBOT_VOLTAGE_CHANGED)   | \
+                          DS_EVENT_MASK (DS_ROBOT_CAN_UTIL_CHANGED)  | \
+                          DS_EVENT_MASK (DS_ROBOT_CPU_INFO_CHANGED)  | \
+                          DS_EVENT_MASK (DS_ROBOT_RAM_INFO_CHANGED)  | \
+                          DS_EVENT_MASK (DS_ROBOT_DISK_INFO_CHANGED) | \
+                          DS_EVENT_MASK (DS_STATUS_STRING_CHANGED)   | \
+                          DS_EVENT_MASK (DS_ROBOT_COMMS_CHANGED)     | \
+                          DS_EVENT_MASK (DS_ROBOT_CODE_CHANGED))
+
 static int running = 1;
 static void process_events();
-static void* get_user_input();
+static void process_input();
+static void wait_for_activity();
+static void on_event (const DS_Event* event, void* data);
 
 /**
- * Main entry point of the application
+ * Main entry point of the application, the \c --evdev option reads the
+ * joysticks with the evdev backend of the LibDS (Linux only) instead of SDL
  */
-int main()
+int main (int argc, char* argv[])
 {
+    int i;
+    int use_evdev = 0;
+    for (i = 1; i < argc; ++i) {
+        if (strcmp (argv [i], "--evdev") == 0)
+            use_evdev = 1;
+    }
+
     /* Initialize the DS (and its event loop) */
     DS_Init();
 
+    /* Only receive the events that are displayed */
+    DS_SetEventMask (0);
+    DS_Subscribe (INTERFACE_EVENTS, &on_event, NULL, DS_DELIVER_QUEUED);
+
     /* Connect to the FRC simulator (or OpenRIO Sim) */
     DS_SetCustomRobotAddress ("127.0.0.1");
 
-    /* Initialize the application modules */
-    init_joysticks();
-    init_interface();
-
-    /* Get user input from a different thread */
-    pthread_t user_input_thread;
-    pthread_create (&user_input_thread, NULL, &get_user_input, NULL);
-
     /* Load the FRC 2016 communication protocol */
     DS_Protocol frc2016 = DS_GetProtocolFRC_2016();
     DS_ConfigureProtocol (&frc2016);
 
+    /* Initialize the application modules (the joysticks are read once per
+     * packet period of the protocol, by their own thread) */
+    init_joysticks (use_evdev);
+    init_interface();
+
     /* Run the application's event loop (unrelated to DS) */
     while (running) {
+        wait_for_activity();
+        process_input();
         process_events();
         update_interface();
-        update_joysticks();
-        DS_Sleep (20);
     }
 
-    /* Close the DS and the application modules */
+    /* Close the application modules and the DS */
+    close_joysticks();
     DS_Close();
     close_interface();
-    close_joysticks();
 
     /* Exit the application */
     return EXIT_SUCCESS;
 }
 
+/**
+ * Blocks until the LibDS has new events, the user presses a key or the next
+ * frame can be drawn (whichever is first). The application does not use any
+ * CPU while it waits, the joysticks are read by the input thread.
+ */
+static void wait_for_activity()
+{
+    int timeout = interface_wait_time();
+
+#if defined _WIN32
+    HANDLE handles [2];
+    handles [0] = (HANDLE) DS_GetEventHandle();
+    handles [1] = GetStdHandle (STD_INPUT_HANDLE);
+    WaitForMultipleObjects (2, handles, FALSE,
+                            timeout < 0 ? INFINITE : (DWORD) timeout);
+#else
+    fd_set set;
+    struct timeval tv;
+    int events = DS_GetEventHandle();
+
+    FD_ZERO (&set);
+    FD_SET (STDIN_FILENO, &set);
+    if (events >= 0)
+        FD_SET (events, &set);
+
+    tv.tv_sec = timeout / 1000;
+    tv.tv_usec = (timeout % 1000) * 1000;
+    select (DS_Max (events, STDIN_FILENO) + 1, &set, NULL, NULL,
+            timeout < 0 ? NULL : &tv);
+#endif
+}
+
 /**
  * Checks if the LibDS has any new events and displays them
- * on the console screen.
+ * on the console screen (through \c on_event()).
  */
 static void process_events()
 {
-    DS_Event event;
-    while (DS_PollEvent (&event)) {
-        switch (event.type) {
-        case DS_JOYSTICK_COUNT_CHANGED:
-            set_has_joysticks (DS_GetJoystickCount());
-            break;
-        case DS_NETCONSOLE_NEW_MESSAGE:
-            break;
-        case DS_ROBOT_VOLTAGE_CHANGED:
-            set_voltage (event.robot.voltage);
-            break;
-        case DS_ROBOT_CAN_UTIL_CHANGED:
-            set_can (event.robot.can_util);
-            break;
-        case DS_ROBOT_CPU_INFO_CHANGED:
-            set_cpu (event.robot.cpu_usage);
-            break;
-        case DS_ROBOT_RAM_INFO_CHANGED:
-            set_ram (event.robot.ram_usage);
-            break;
-        case DS_ROBOT_DISK_INFO_CHANGED:
-            set_disk (event.robot.disk_usage);
-            break;
-        case DS_STATUS_STRING_CHANGED:
-            update_status_label();
-            break;
-        case DS_ROBOT_COMMS_CHANGED:
-            set_robot_comms (event.robot.connected);
-            break;
-        case DS_ROBOT_CODE_CHANGED:
-            set_robot_code (event.robot.code);
-            break;
-        default:
-            break;
-        }
+    DS_DispatchEvents();
+}
+
+/**
+ * Displays the given \a event on the console screen
+ */
+static void on_event (const DS_Event* event, void* data)
+{
+    (void) data;
+
+    switch (event->type) {
+    case DS_JOYSTICK_COUNT_CHANGED:
+        set_has_joysticks (DS_GetJoystickCount());
+        break;
+    case DS_ROBOT_VOLTAGE_CHANGED:
+        set_voltage (event->robot.voltage);
+        break;
+    case DS_ROBOT_CAN_UTIL_CHANGED:
+        set_can (event->robot.can_util);
+        break;
+    case DS_ROBOT_CPU_INFO_CHANGED:
+        set_cpu (event->robot.cpu_usage);
+        break;
+    case DS_ROBOT_RAM_INFO_CHANGED:
+        set_ram (event->robot.ram_usage);
+        break;
+    case DS_ROBOT_DISK_INFO_CHANGED:
+        set_disk (event->robot.disk_usage);
+        break;
+    case DS_STATUS_STRING_CHANGED:
+        update_status_label();
+        break;
+    case DS_ROBOT_COMMS_CHANGED:
+        set_robot_comms (event->robot.connected);
+        break;
+    case DS_ROBOT_CODE_CHANGED:
+        set_robot_code (event->robot.code);
+        break;
+    default:
+        break;
     }
 }
 
 /**
- * Checks if the user has pressed any key on the keyboard and
+ * Reads all the keys pressed by the user (without blocking) and
  * reacts to the given user input
  */
-static void* get_user_input()
+static void process_input()
 {
-    while (running) {
-        switch (tolower (getch())) {
+    int key;
+    while ((key = getch()) != ERR) {
+        if (key == KEY_RESIZE) {
+            resize_interface();
+            continue;
+        }
+
+        switch (tolower (key)) {
         case 'q':
             running = 0;
             break;
@@ -152,11 +226,5 @@ static void* get_user_input()
             DS_SetEmergencyStopped (1);
             break;
         }
-
-        DS_Sleep (20);
     }
-
-    pthread_exit (0);
-    return NULL;
 }
-
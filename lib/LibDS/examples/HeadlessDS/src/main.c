@@ -0,0 +1,647 @@
+/*
+ * Copyright (C) 2015-2016 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <LibDS.h>
+
+#include <poll.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <strings.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+
+#define MAX_CLIENTS    16
+#define LINE_SIZE      512
+#define CONSOLE_LINES  32
+#define DEFAULT_SOCKET "/tmp/libds.sock"
+
+/**
+ * A connected control client
+ */
+typedef struct {
+    int fd;                /**< Socket descriptor, -1 if the slot is free */
+    size_t len;            /**< Number of bytes in \a line */
+    char line [LINE_SIZE]; /**< Incomplete command line */
+    int events;            /**< 1 if the client receives event lines */
+    int interval;          /**< Telemetry interval (in ms), 0 to disable */
+    uint64_t next;         /**< Time (in ms) of the next telemetry line */
+} Client;
+
+static int running = 1;
+static Client clients [MAX_CLIENTS];
+
+/**
+ * Stops the daemon when the user presses CTRL+C (or when it is killed)
+ */
+static void on_signal (int signal)
+{
+    (void) signal;
+    running = 0;
+}
+
+/**
+ * Prints the command line usage of the application
+ */
+static void print_usage (const char* name)
+{
+    printf ("Usage: %s [options]\n", name);
+    printf ("  -s path     Control socket path (default %s)\n", DEFAULT_SOCKET);
+    printf ("  -t team     Team number\n");
+    printf ("  -p protocol Protocol: 2014, 2015, 2016 or 2020 (default 2016)\n");
+    printf ("  -r address  Custom robot address\n");
+}
+
+/**
+ * Returns the readable name of the given control \a mode
+ */
+static const char* mode_name (const DS_ControlMode mode)
+{
+    switch (mode) {
+    case DS_CONTROL_TEST:
+        return "test";
+    case DS_CONTROL_AUTONOMOUS:
+        return "auto";
+    default:
+        return "teleop";
+    }
+}
+
+/**
+ * Loads the communication protocol of the given FRC \a year
+ *
+ * \returns 1 on success, 0 if the year is not supported
+ */
+static int load_protocol (const int year)
+{
+    DS_Protocol protocol;
+
+    if (year == 2014)
+        protocol = DS_GetProtocolFRC_2014();
+    else if (year == 2015)
+        protocol = DS_GetProtocolFRC_2015();
+    else if (year == 2016)
+        protocol = DS_GetProtocolFRC_2016();
+    else if (year == 2020)
+        protocol = DS_GetProtocolFRC_2020();
+    else
+        return 0;
+
+    DS_ConfigureProtocol (&protocol);
+    return 1;
+}
+
+/**
+ * Sends the given null-terminated \a text to the client, a client that does
+ * not read its data (so that its socket buffer is full) is disconnected, so
+ * that it never blocks the daemon
+ */
+static void send_text (Client* client, const char* text)
+{
+    size_t len = strlen (text);
+
+    if (client->fd < 0)
+        return;
+
+    if (send (client->fd, text, len, 0) != (ssize_t) len) {
+        close (client->fd);
+        client->fd = -1;
+    }
+}
+
+/**
+ * Sends the given \a text to every client that receives event lines
+ */
+static void broadcast_event (const char* text)
+{
+    int i;
+    for (i = 0; i < MAX_CLIENTS; ++i) {
+        if (clients [i].fd >= 0 && clients [i].events)
+            send_text (&clients [i], text);
+    }
+}
+
+/**
+ * Writes a telemetry line with the current DS and robot state to \a buf, the
+ * round-trip times are given in milliseconds
+ */
+static void format_status (char* buf, const size_t size)
+{
+    DS_LossInfo loss = DS_GetRobotLossInfo();
+    DS_LatencyInfo latency = DS_GetRobotLatencyInfo();
+
+    snprintf (buf, size,
+              "status team=%d comms=%d code=%d enabled=%d estop=%d mode=%s "
+              "voltage=%.2f cpu=%d ram=%d disk=%d can=%d fms=%d radio=%d "
+              "rtt_p50=%.1f rtt_p99=%.1f loss=%d text=%s\n",
+              DS_GetTeamNumber(),
+              DS_GetRobotCommunications(),
+              DS_GetRobotCode(),
+              DS_GetRobotEnabled(),
+              DS_GetEmergencyStopped(),
+              mode_name (DS_GetControlMode()),
+              DS_GetRobotVoltage(),
+              DS_GetRobotCPUUsage(),
+              DS_GetRobotRAMUsage(),
+              DS_GetRobotDiskUsage(),
+              DS_GetRobotCANUtilization(),
+              DS_GetFMSCommunications(),
+              DS_GetRadioCommunications(),
+              latency.round_trip.p50 / 1000.0,
+              latency.round_trip.p99 / 1000.0,
+              loss.percent,
+              DS_GetStatusString());
+}
+
+/**
+ * Executes the given command \a line of a client and sends the reply
+ * (\c ok, \c error or the requested data)
+ */
+static void run_command (Client* client, char* line)
+{
+    char reply [LINE_SIZE];
+    char* command = strtok (line, " \t\r");
+    char* arg = strtok (NULL, " \t\r");
+    char* arg2 = strtok (NULL, " \t\r");
+
+    /* Empty line */
+    if (!command)
+        return;
+
+    /* Enable or disable the robot */
+    if (strcasecmp (command, "enable") == 0)
+        DS_SetRobotEnabled (1);
+    else if (strcasecmp (command, "disable") == 0)
+        DS_SetRobotEnabled (0);
+
+    /* Emergency stop (the robot must be rebooted to clear it) */
+    else if (strcasecmp (command, "estop") == 0)
+        DS_SetEmergencyStopped (1);
+
+    /* Change the control mode (the robot is disabled first) */
+    else if (strcasecmp (command, "mode") == 0 && arg) {
+        DS_ControlMode mode;
+        if (strcasecmp (arg, "teleop") == 0)
+            mode = DS_CONTROL_TELEOPERATED;
+        else if (strcasecmp (arg, "auto") == 0)
+            mode = DS_CONTROL_AUTONOMOUS;
+        else if (strcasecmp (arg, "test") == 0)
+            mode = DS_CONTROL_TEST;
+        else {
+            send_text (client, "error unknown mode\n");
+            return;
+        }
+
+        DS_SetRobotEnabled (0);
+        DS_SetControlMode (mode);
+    }
+
+    /* Change the team number */
+    else if (strcasecmp (command, "team") == 0 && arg)
+        DS_SetTeamNumber (atoi (arg));
+
+    /* Change the protocol */
+    else if (strcasecmp (command, "protocol") == 0 && arg) {
+        if (!load_protocol (atoi (arg))) {
+            send_text (client, "error unknown protocol\n");
+            return;
+        }
+    }
+
+    /* Change the robot address (no address restores the default) */
+    else if (strcasecmp (command, "robot") == 0)
+        DS_SetCustomRobotAddress (arg ? arg : "");
+
+    /* Change the alliance station */
+    else if (strcasecmp (command, "station") == 0 && arg && arg2) {
+        int position = atoi (arg2);
+        if (position < 1 || position > 3 ||
+            (strcasecmp (arg, "red") != 0 && strcasecmp (arg, "blue") != 0)) {
+            send_text (client, "error unknown station\n");
+            return;
+        }
+
+        DS_SetAlliance (strcasecmp (arg, "red") == 0 ? DS_ALLIANCE_RED :
+                        DS_ALLIANCE_BLUE);
+        DS_SetPosition ((DS_Position) (DS_POSITION_1 + position - 1));
+    }
+
+    /* Reboot the robot or restart its code */
+    else if (strcasecmp (command, "reboot") == 0)
+        DS_RebootRobot();
+    else if (strcasecmp (command, "restart-code") == 0)
+        DS_RestartRobotCode();
+
+    /* Send the current state */
+    else if (strcasecmp (command, "status") == 0) {
+        format_status (reply, sizeof (reply));
+        send_text (client, reply);
+        return;
+    }
+
+    /* Send the current state periodically (0 to stop) */
+    else if (strcasecmp (command, "subscribe") == 0 && arg) {
+        client->interval = DS_Max (atoi (arg), 0);
+        client->next = DS_GetTimeMs();
+    }
+
+    /* Send (or stop sending) event and NetConsole lines */
+    else if (strcasecmp (command, "events") == 0 && arg)
+        client->events = (strcasecmp (arg, "on") == 0);
+
+    /* Close the connection */
+    else if (strcasecmp (command, "quit") == 0) {
+        close (client->fd);
+        client->fd = -1;
+        return;
+    }
+
+    /* Stop the daemon */
+    else if (strcasecmp (command, "shutdown") == 0)
+        running = 0;
+
+    /* Unknown command (or missing argument) */
+    else {
+        send_text (client, "error unknown command\n");
+        return;
+    }
+
+    send_text (client, "ok\n");
+}
+
+/**
+ * Reads the available data of the given client and executes each complete
+ * command line. The client is disconnected when it closes its socket or if
+ * a line is longer than \c LINE_SIZE
+ */
+static void read_client (Client* client)
+{
+    char* start;
+    char* end;
+    ssize_t bytes;
+
+    bytes = recv (client->fd, client->line + client->len,
+                  sizeof (client->line) - client->len - 1, 0);
+
+    if (bytes <= 0 || client->len + bytes >= sizeof (client->line) - 1) {
+        close (client->fd);
+        client->fd = -1;
+        return;
+    }
+
+    client->len += bytes;
+    client->line [client->len] = '\0';
+
+    /* Run the complete lines */
+    start = client->line;
+    while (client->fd >= 0 && (end = strchr (start, '\n')) != NULL) {
+        *end = '\0';
+        run_command (client, start);
+        start = end + 1;
+    }
+
+    /* Keep the incomplete line */
+    if (client->fd >= 0) {
+        client->len = strlen (start);
+        memmove (client->line, start, client->len + 1);
+    }
+}
+
+/**
+ * Accepts a new control client (or rejects it if there are too many)
+ */
+static void accept_client (const int server)
+{
+    int i;
+    int fd = accept (server, NULL, NULL);
+
+    if (fd < 0)
+        return;
+
+    for (i = 0; i < MAX_CLIENTS; ++i) {
+        if (clients [i].fd < 0) {
+            fcntl (fd, F_SETFL, fcntl (fd, F_GETFL, 0) | O_NONBLOCK);
+            memset (&clients [i], 0, sizeof (Client));
+            clients [i].fd = fd;
+            return;
+        }
+    }
+
+    close (fd);
+}
+
+/**
+ * Sends the NetConsole lines that were received since the last call to the
+ * clients that receive event lines
+ */
+static void send_console_lines (uint64_t* cursor)
+{
+    int i;
+    int count;
+    char text [DS_NETCONSOLE_LINE_SIZE + 16];
+    static DS_NetConsoleLine lines [CONSOLE_LINES];
+    static char buffer [CONSOLE_LINES * 128 + DS_NETCONSOLE_LINE_SIZE];
+
+    do {
+        count = DS_NetConsoleRead (cursor, lines, CONSOLE_LINES,
+                                   buffer, sizeof (buffer));
+        for (i = 0; i < count; ++i) {
+            snprintf (text, sizeof (text), "console %s\n", lines [i].text);
+            broadcast_event (text);
+        }
+    } while (count == CONSOLE_LINES);
+}
+
+/**
+ * Converts the DS events into event lines and sends them to the clients
+ */
+static void process_events (uint64_t* console_cursor)
+{
+    DS_Event event;
+    char text [64];
+
+    while (DS_PollEvent (&event)) {
+        text [0] = '\0';
+
+        switch (event.type) {
+        case DS_FMS_COMMS_CHANGED:
+            snprintf (text, sizeof (text), "event fms %d\n",
+                      event.fms.connected);
+            break;
+        case DS_RADIO_COMMS_CHANGED:
+            snprintf (text, sizeof (text), "event radio %d\n",
+                      event.radio.connected);
+            break;
+        case DS_ROBOT_COMMS_CHANGED:
+            snprintf (text, sizeof (text), "event comms %d\n",
+                      event.robot.connected);
+            break;
+        case DS_ROBOT_CODE_CHANGED:
+            snprintf (text, sizeof (text), "event code %d\n",
+                      event.robot.code);
+            break;
+        case DS_ROBOT_ENABLED_CHANGED:
+            snprintf (text, sizeof (text), "event enabled %d\n",
+                      event.robot.enabled);
+            break;
+        case DS_ROBOT_MODE_CHANGED:
+            snprintf (text, sizeof (text), "event mode %s\n",
+                      mode_name (event.robot.mode));
+            break;
+        case DS_ROBOT_ESTOP_CHANGED:
+            snprintf (text, sizeof (text), "event estop %d\n",
+                      event.robot.estopped);
+            break;
+        case DS_ROBOT_REBOOTED:
+            snprintf (text, sizeof (text), "event rebooted\n");
+            break;
+        case DS_ROBOT_BROWNOUT_WARNING:
+            snprintf (text, sizeof (text), "event brownout %d %.2f %d\n",
+                      event.brownout.warning, event.brownout.voltage,
+                      event.brownout.time_to_brownout);
+            break;
+        case DS_NETCONSOLE_NEW_LINES:
+            send_console_lines (console_cursor);
+            break;
+        default:
+            break;
+        }
+
+        if (text [0])
+            broadcast_event (text);
+    }
+}
+
+/**
+ * Sends a telemetry line to each subscribed client whose interval elapsed
+ *
+ * \returns the time (in ms) until the next telemetry line, or -1 if no
+ *          client is subscribed
+ */
+static int send_telemetry (void)
+{
+    int i;
+    int wait = -1;
+    int formatted = 0;
+    char status [LINE_SIZE];
+    uint64_t now = DS_GetTimeMs();
+
+    for (i = 0; i < MAX_CLIENTS; ++i) {
+        Client* client = &clients [i];
+        if (client->fd < 0 || client->interval <= 0)
+            continue;
+
+        /* Send the state (formatted once for all clients) */
+        if (now >= client->next) {
+            if (!formatted) {
+                format_status (status, sizeof (status));
+                formatted = 1;
+            }
+
+            client->next += client->interval;
+            if (client->next <= now)
+                client->next = now + client->interval;
+
+            send_text (client, status);
+            if (client->fd < 0)
+                continue;
+        }
+
+        wait = (wait < 0) ? (int) (client->next - now) :
+               DS_Min (wait, (int) (client->next - now));
+    }
+
+    return wait;
+}
+
+/**
+ * Creates the control socket at the given \a path, only the user that runs
+ * the daemon can connect to it
+ *
+ * \returns the socket descriptor or \c -1 on failure
+ */
+static int open_server (const char* path)
+{
+    int sock;
+    mode_t mask;
+    struct sockaddr_un addr;
+
+    if (strlen (path) >= sizeof (addr.sun_path))
+        return -1;
+
+    sock = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0)
+        return -1;
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sun_family = AF_UNIX;
+    memcpy (addr.sun_path, path, strlen (path));
+
+    /* Remove the socket of a previous instance */
+    unlink (path);
+
+    mask = umask (0077);
+    if (bind (sock, (struct sockaddr*) &addr, sizeof (addr)) != 0 ||
+        listen (sock, MAX_CLIENTS) != 0) {
+        umask (mask);
+        close (sock);
+        return -1;
+    }
+
+    umask (mask);
+    return sock;
+}
+
+/**
+ * Main entry point of the application
+ */
+int main (int argc, char** argv)
+{
+    int i;
+    int count;
+    int server;
+    int timeout;
+    int team = 0;
+    int year = 2016;
+    const char* robot = NULL;
+    const char* path = DEFAULT_SOCKET;
+    uint64_t console_cursor = 0;
+    struct pollfd fds [MAX_CLIENTS + 2];
+    Client* owners [MAX_CLIENTS + 2];
+
+    /* Read the command line options */
+    for (i = 1; i < argc; ++i) {
+        if (argv [i][0] == '-' && i + 1 < argc) {
+            switch (argv [i][1]) {
+            case 's':
+                path = argv [++i];
+                break;
+            case 't':
+                team = atoi (argv [++i]);
+                break;
+            case 'p':
+                year = atoi (argv [++i]);
+                break;
+            case 'r':
+                robot = argv [++i];
+                break;
+            default:
+                print_usage (argv [0]);
+                return EXIT_FAILURE;
+            }
+        }
+
+        else {
+            print_usage (argv [0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* Create the control socket */
+    server = open_server (path);
+    if (server < 0) {
+        printf ("Cannot create control socket %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    /* Initialize the DS */
+    DS_Init();
+    DS_SetNetConsoleMessageEvents (0);
+    DS_SetEventOverflowPolicy (DS_EVENTS_COALESCE);
+
+    /* Use the default addresses of the team (instead of the fall-back
+     * address of the LibDS), unless the robot address is given */
+    if (team > 0)
+        DS_SetTeamNumber (team);
+
+    DS_SetCustomRadioAddress ("");
+    DS_SetCustomRobotAddress (robot ? robot : "");
+
+    if (!load_protocol (year)) {
+        print_usage (argv [0]);
+        DS_Close();
+        close (server);
+        unlink (path);
+        return EXIT_FAILURE;
+    }
+
+    /* Stop with CTRL+C, and never die when a client disconnects */
+    signal (SIGINT, on_signal);
+    signal (SIGTERM, on_signal);
+    signal (SIGPIPE, SIG_IGN);
+
+    for (i = 0; i < MAX_CLIENTS; ++i)
+        clients [i].fd = -1;
+
+    printf ("Listening on %s\n", path);
+
+    while (running) {
+        /* Wait for commands, DS events or the next telemetry line */
+        count = 0;
+        fds [count].fd = server;
+        fds [count].events = POLLIN;
+        owners [count++] = NULL;
+        fds [count].fd = DS_GetEventHandle();
+        fds [count].events = POLLIN;
+        owners [count++] = NULL;
+
+        for (i = 0; i < MAX_CLIENTS; ++i) {
+            if (clients [i].fd >= 0) {
+                fds [count].fd = clients [i].fd;
+                fds [count].events = POLLIN;
+                owners [count++] = &clients [i];
+            }
+        }
+
+        timeout = send_telemetry();
+        if (poll (fds, count, timeout) < 0)
+            continue;
+
+        /* Handle the new connections, events and commands */
+        if (fds [0].revents & POLLIN)
+            accept_client (server);
+
+        if (fds [1].revents & POLLIN)
+            process_events (&console_cursor);
+
+        for (i = 2; i < count; ++i) {
+            if (owners [i]->fd >= 0 && fds [i].revents)
+                read_client (owners [i]);
+        }
+    }
+
+    /* Disconnect the clients and close the DS */
+    for (i = 0; i < MAX_CLIENTS; ++i) {
+        if (clients [i].fd >= 0)
+            close (clients [i].fd);
+    }
+
+    close (server);
+    unlink (path);
+    DS_Close();
+
+    return EXIT_SUCCESS;
+}
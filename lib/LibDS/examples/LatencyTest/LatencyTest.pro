@@ -0,0 +1,30 @@
+#-------------------------------------------------------------------------------
+# Remove Qt dependency
+#-------------------------------------------------------------------------------
+
+CONFIG += console
+
+CONFIG -= qt
+CONFIG -= app_bundle
+
+DEFINES -= UNICODE QT_LARGEFILE_SUPPORT
+
+#-------------------------------------------------------------------------------
+# Deploy options
+#-------------------------------------------------------------------------------
+
+TARGET = latency-test
+
+#-------------------------------------------------------------------------------
+# Include libraries
+#-------------------------------------------------------------------------------
+
+include ($$PWD/../../LibDS.pri)
+
+#-------------------------------------------------------------------------------
+# Import source code
+#-------------------------------------------------------------------------------
+
+SOURCES += \
+    $$PWD/src/main.c
+
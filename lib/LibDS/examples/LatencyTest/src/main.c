@@ -0,0 +1,465 @@
+/*
+ * Copyright (C) 2015-2016 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <LibDS.h>
+#include <DS_Histogram.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#define PACKET_SIZE    2048
+#define WAIT_TIMEOUT   500
+#define HISTOGRAM_ROWS 20
+
+/**
+ * Options given by the user in the command line
+ */
+typedef struct {
+    int year;       /**< Protocol year (2014, 2015 or 2016) */
+    int samples;    /**< Number of input changes to inject */
+    int early_gap;  /**< Early robot packet gap, negative to keep default */
+    int use_axis;   /**< 1 to inject axis changes instead of button presses */
+} Options;
+
+/**
+ * State shared between the injection loop and the capture thread
+ */
+static struct {
+    int running;                      /**< 0 when capture thread must quit */
+    int year;                         /**< Protocol year */
+    int socket;                       /**< Loopback capture socket */
+    int reply_port;                   /**< Port of the DS robot socket */
+    int skip_head;                    /**< Leading bytes ignored in compare */
+    int skip_tail;                    /**< Trailing bytes ignored in compare */
+    uint64_t injected;                /**< Injection time, 0 if not waiting */
+    uint64_t latency;                 /**< Last measured latency (in usecs) */
+    int last_len;                     /**< Length of last captured packet */
+    int reference_len;                /**< Length of \c reference */
+    char last [PACKET_SIZE];          /**< Last captured robot packet */
+    char reference [PACKET_SIZE];     /**< Packet before the injection */
+    pthread_mutex_t mutex;
+} capture;
+
+/**
+ * Prints the command line usage of the application
+ */
+static void print_usage (const char* name)
+{
+    printf ("Usage: %s [-p year] [-n samples] [-g gap] [-a]\n", name);
+    printf ("  -p  Protocol to test: 2014, 2015 or 2016 (default 2016)\n");
+    printf ("  -n  Number of input changes to inject (default 500)\n");
+    printf ("  -g  Early robot packet gap in ms, 0 disables early sends\n");
+    printf ("  -a  Inject axis changes instead of button presses\n");
+}
+
+/**
+ * Reads the command line arguments into the given \a options
+ *
+ * \returns 1 if the arguments are valid, 0 otherwise
+ */
+static int parse_options (int argc, char** argv, Options* options)
+{
+    int i;
+
+    options->year = 2016;
+    options->samples = 500;
+    options->early_gap = -1;
+    options->use_axis = 0;
+
+    for (i = 1; i < argc; ++i) {
+        if (strcmp (argv [i], "-a") == 0)
+            options->use_axis = 1;
+
+        else if (i + 1 < argc && strcmp (argv [i], "-p") == 0)
+            options->year = atoi (argv [++i]);
+
+        else if (i + 1 < argc && strcmp (argv [i], "-n") == 0)
+            options->samples = atoi (argv [++i]);
+
+        else if (i + 1 < argc && strcmp (argv [i], "-g") == 0)
+            options->early_gap = atoi (argv [++i]);
+
+        else
+            return 0;
+    }
+
+    if (options->year < 2014 || options->year > 2016)
+        return 0;
+
+    return options->samples > 0;
+}
+
+/**
+ * Returns the communication protocol that matches the given \a year
+ */
+static DS_Protocol get_protocol (const int year)
+{
+    if (year == 2014)
+        return DS_GetProtocolFRC_2014();
+
+    if (year == 2015)
+        return DS_GetProtocolFRC_2015();
+
+    return DS_GetProtocolFRC_2016();
+}
+
+/**
+ * Returns 1 if the \a packet differs from the reference packet, the sequence
+ * number (and checksum) bytes are not compared, since they change with
+ * every sent packet
+ */
+static int packet_changed (const char* packet, const int len)
+{
+    int end = len - capture.skip_tail;
+
+    if (len != capture.reference_len)
+        return 1;
+
+    if (end <= capture.skip_head)
+        return 0;
+
+    return memcmp (packet + capture.skip_head,
+                   capture.reference + capture.skip_head,
+                   end - capture.skip_head) != 0;
+}
+
+/**
+ * Answers the given robot \a packet like a robot with code and a charged
+ * battery would, this keeps the robot communications alive, so that the DS
+ * can be enabled (the joystick values are only sent while enabled)
+ */
+static void send_reply (const char* packet)
+{
+    int len;
+    struct sockaddr_in addr;
+    char reply [1024];
+
+    memset (reply, 0, sizeof (reply));
+
+    /* 2014 protocol: no e-stop, 12 volts, fixed packet size */
+    if (capture.year == 2014) {
+        reply [0] = 0x40;
+        reply [1] = 0x12;
+        len = 1024;
+    }
+
+    /* 2015/2016 protocols: echo the index, robot has code, 12 volts */
+    else {
+        reply [0] = packet [0];
+        reply [1] = packet [1];
+        reply [2] = 0x01;
+        reply [4] = 0x20;
+        reply [5] = 12;
+        len = 8;
+    }
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons (capture.reply_port);
+    addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    sendto (capture.socket, reply, len, 0, (struct sockaddr*) &addr,
+            sizeof (addr));
+}
+
+/**
+ * Receives the robot packets sent by the LibDS, timestamps them and checks
+ * if they are the first packets to reflect an injected input change
+ */
+static void* run_capture (void* ptr)
+{
+    int len;
+    uint64_t now;
+    char packet [PACKET_SIZE];
+    (void) ptr;
+
+    while (capture.running) {
+        len = (int) recv (capture.socket, packet, sizeof (packet), 0);
+        now = DS_GetTimeUs();
+
+        if (len <= 0)
+            continue;
+
+        pthread_mutex_lock (&capture.mutex);
+
+        /* Check if this is the first packet with the new input */
+        if (capture.injected && packet_changed (packet, len)) {
+            capture.latency = now - capture.injected;
+            capture.injected = 0;
+        }
+
+        /* Keep a copy of the packet for the next injection */
+        memcpy (capture.last, packet, len);
+        capture.last_len = len;
+
+        pthread_mutex_unlock (&capture.mutex);
+
+        /* Reply after taking the time, so that it is not measured */
+        send_reply (packet);
+    }
+
+    return NULL;
+}
+
+/**
+ * Creates a UDP socket bound to the robot port of the given \a protocol
+ * on the loopback interface
+ *
+ * \returns 1 on success, 0 on failure
+ */
+static int open_capture_socket (const DS_Protocol* protocol)
+{
+    struct timeval timeout;
+    struct sockaddr_in addr;
+
+    capture.socket = socket (AF_INET, SOCK_DGRAM, 0);
+    if (capture.socket < 0)
+        return 0;
+
+    /* Listen on the port that the DS sends robot packets to */
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons (protocol->robot_socket.out_port);
+    addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    if (bind (capture.socket, (struct sockaddr*) &addr, sizeof (addr)) != 0) {
+        close (capture.socket);
+        return 0;
+    }
+
+    /* Allow the capture thread to check if it should quit */
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 100 * 1000;
+    setsockopt (capture.socket, SOL_SOCKET, SO_RCVTIMEO,
+                &timeout, sizeof (timeout));
+
+    return 1;
+}
+
+/**
+ * Changes the state of the first joystick, the time is taken before the
+ * LibDS is notified, so that the measured latency includes the cost of
+ * the \c DS_SetJoystick* functions
+ */
+static void inject_input (const int sample, const int use_axis)
+{
+    pthread_mutex_lock (&capture.mutex);
+    memcpy (capture.reference, capture.last, capture.last_len);
+    capture.reference_len = capture.last_len;
+    capture.latency = 0;
+    capture.injected = DS_GetTimeUs();
+    pthread_mutex_unlock (&capture.mutex);
+
+    /* Button 0 is not used, the 2014 protocol encodes it as a zero value */
+    if (use_axis)
+        DS_SetJoystickAxis (0, 0, (sample % 2) ? -0.9 : 0.9);
+    else
+        DS_SetJoystickButton (0, 1, (sample % 2) == 0);
+}
+
+/**
+ * Waits until the capture thread receives a packet with the injected
+ * input change
+ *
+ * \returns the measured latency (in usecs), or 0 if no packet arrived
+ */
+static uint64_t wait_for_packet (void)
+{
+    uint64_t latency = 0;
+    uint64_t start = DS_GetTimeMs();
+
+    while (!latency && DS_GetTimeMs() - start < WAIT_TIMEOUT) {
+        DS_Sleep (1);
+
+        pthread_mutex_lock (&capture.mutex);
+        latency = capture.latency;
+        pthread_mutex_unlock (&capture.mutex);
+    }
+
+    pthread_mutex_lock (&capture.mutex);
+    capture.injected = 0;
+    pthread_mutex_unlock (&capture.mutex);
+
+    return latency;
+}
+
+/**
+ * Prints the percentiles and a text histogram of the measured \a values
+ */
+static void print_results (const uint32_t* values, const int count,
+                           const int lost, const DS_Histogram* histogram)
+{
+    int i;
+    int row;
+    int peak;
+    int width;
+    uint32_t min;
+    int rows [HISTOGRAM_ROWS];
+
+    printf ("\nSamples: %d (%d without a matching packet)\n", count, lost);
+    if (count <= 0)
+        return;
+
+    /* Print the percentiles */
+    min = values [0];
+    for (i = 1; i < count; ++i)
+        if (values [i] < min)
+            min = values [i];
+
+    printf ("  min    %8.3f ms\n", min / 1000.0);
+    printf ("  p50    %8.3f ms\n", DS_HistogramPercentile (histogram, 50) / 1000.0);
+    printf ("  p90    %8.3f ms\n", DS_HistogramPercentile (histogram, 90) / 1000.0);
+    printf ("  p99    %8.3f ms\n", DS_HistogramPercentile (histogram, 99) / 1000.0);
+    printf ("  p99.9  %8.3f ms\n", DS_HistogramPercentile (histogram, 99.9) / 1000.0);
+    printf ("  max    %8.3f ms\n\n", histogram->max / 1000.0);
+
+    /* Distribute the values in linear buckets */
+    memset (rows, 0, sizeof (rows));
+    width = (int) (histogram->max / HISTOGRAM_ROWS) + 1;
+    for (i = 0; i < count; ++i)
+        ++rows [values [i] / width];
+
+    peak = 1;
+    for (row = 0; row < HISTOGRAM_ROWS; ++row)
+        if (rows [row] > peak)
+            peak = rows [row];
+
+    /* Draw the histogram */
+    for (row = 0; row < HISTOGRAM_ROWS; ++row) {
+        printf ("  %7.2f - %7.2f ms %6d |",
+                (row * width) / 1000.0, ((row + 1) * width) / 1000.0,
+                rows [row]);
+
+        for (i = 0; i < (rows [row] * 50) / peak; ++i)
+            printf ("#");
+
+        printf ("\n");
+    }
+}
+
+/**
+ * Main entry point of the application
+ */
+int main (int argc, char** argv)
+{
+    int i;
+    int lost = 0;
+    int count = 0;
+    Options options;
+    uint64_t latency;
+    uint32_t* values;
+    DS_Protocol protocol;
+    DS_Histogram histogram;
+    pthread_t capture_thread;
+
+    /* Read the command line options */
+    if (!parse_options (argc, argv, &options)) {
+        print_usage (argv [0]);
+        return EXIT_FAILURE;
+    }
+
+    /* Listen for robot packets before the DS starts sending them */
+    protocol = get_protocol (options.year);
+    if (!open_capture_socket (&protocol)) {
+        printf ("Cannot bind to port %d\n", protocol.robot_socket.out_port);
+        return EXIT_FAILURE;
+    }
+
+    /* The 2014 protocol adds a CRC32 checksum to the end of the packet */
+    capture.running = 1;
+    capture.year = options.year;
+    capture.reply_port = protocol.robot_socket.in_port;
+    capture.skip_head = 2;
+    capture.skip_tail = (options.year == 2014) ? 4 : 0;
+    pthread_mutex_init (&capture.mutex, NULL);
+    pthread_create (&capture_thread, NULL, &run_capture, NULL);
+
+    /* Initialize the DS and send robot packets to the capture socket */
+    DS_Init();
+    DS_ConfigureProtocol (&protocol);
+    DS_SetCustomRobotAddress ("127.0.0.1");
+    if (options.early_gap >= 0)
+        DS_SetEarlyRobotPacketGap (options.early_gap);
+
+    /* Register a virtual joystick */
+    DS_JoysticksReset();
+    DS_JoysticksAdd (protocol.max_axis_count,
+                     protocol.max_hat_count,
+                     protocol.max_button_count);
+
+    /* Wait for the robot communications and enable the robot */
+    for (i = 0; i < 50 && !DS_GetCanBeEnabled(); ++i)
+        DS_Sleep (100);
+
+    if (!DS_GetCanBeEnabled()) {
+        printf ("Cannot establish robot communications\n");
+        capture.running = 0;
+        pthread_join (capture_thread, NULL);
+        close (capture.socket);
+        DS_Close();
+        return EXIT_FAILURE;
+    }
+
+    DS_SetControlMode (DS_CONTROL_TELEOPERATED);
+    DS_SetRobotEnabled (1);
+    DS_Sleep (500);
+
+    printf ("Testing FRC %d protocol with %d %s changes...\n", options.year,
+            options.samples, options.use_axis ? "axis" : "button");
+
+    /* Inject the input changes and measure the input-to-wire latency */
+    DS_HistogramReset (&histogram);
+    values = (uint32_t*) calloc (options.samples, sizeof (uint32_t));
+    for (i = 0; i < options.samples; ++i) {
+        /* Do not phase-lock the injections with the packet interval */
+        DS_Sleep (protocol.robot_interval / 2 +
+                  rand() % (protocol.robot_interval + 1));
+
+        inject_input (i, options.use_axis);
+        latency = wait_for_packet();
+
+        if (latency > 0) {
+            values [count++] = (uint32_t) latency;
+            DS_HistogramRecord (&histogram, (uint32_t) latency);
+        }
+
+        else
+            ++lost;
+    }
+
+    /* Stop the capture thread and the DS */
+    capture.running = 0;
+    pthread_join (capture_thread, NULL);
+    close (capture.socket);
+    DS_Close();
+
+    /* Show the results */
+    print_results (values, count, lost, &histogram);
+    free (values);
+
+    return EXIT_SUCCESS;
+}
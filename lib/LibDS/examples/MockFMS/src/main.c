@@ -0,0 +1,433 @@
+/*
+ * Copyright (C) 2015-2016 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <LibDS.h>
+#include <DS_Histogram.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define MAX_STATIONS 32
+#define PACKET_SIZE  2048
+
+/*
+ * FMS control flags of the 2015 protocol (see src/protocols/frc_2015.c)
+ */
+static const uint8_t cEnabled       = 0x04;
+static const uint8_t cAutonomous    = 0x02;
+static const uint8_t cTeleoperated  = 0x00;
+static const uint8_t cEmergencyStop = 0x80;
+
+/**
+ * A step of the match timeline
+ */
+typedef struct {
+    const char* name;  /**< Name of the match period */
+    int enabled;       /**< 1 if the robots are enabled in this period */
+    uint8_t mode;      /**< Control mode flags sent to the DS */
+    int duration;      /**< Duration of the period (in msecs) */
+} Period;
+
+/**
+ * State and statistics of a driven DS
+ */
+typedef struct {
+    struct sockaddr_in addr;  /**< DS address (FMS input port) */
+    int station;              /**< Alliance station code (0-5) */
+    int team;                 /**< Team number reported by the DS */
+    int online;               /**< 1 if the DS has sent any packet */
+    int enabled;              /**< Last enabled state reported by the DS */
+    int estopped;             /**< 1 if the DS reports an e-stop */
+    int waiting;              /**< 1 while a command is not honored yet */
+    uint64_t command_time;    /**< Time (in usecs) of the last command */
+    unsigned long received;   /**< Received DS packets */
+    int commands;             /**< Number of enable/disable commands */
+    int missed;               /**< Commands not honored before the next one */
+    DS_Histogram histogram;   /**< Command latencies (in usecs) */
+} Station;
+
+static int running = 1;
+static int station_count = 0;
+static Station stations [MAX_STATIONS];
+
+/**
+ * Stops the mock FMS when the user presses CTRL+C
+ */
+static void on_signal (int signal)
+{
+    (void) signal;
+    running = 0;
+}
+
+/**
+ * Prints the command line usage of the application
+ */
+static void print_usage (const char* name)
+{
+    printf ("Usage: %s [options] address [address...]\n", name);
+    printf ("  -m count Number of matches (default 1)\n");
+    printf ("  -A secs  Duration of the autonomous period (default 15)\n");
+    printf ("  -T secs  Duration of the teleoperated period (default 135)\n");
+    printf ("  -P secs  Pause before and between the match periods (default 3)\n");
+    printf ("  -i ms    FMS packet interval (default 500)\n");
+}
+
+/**
+ * Registers a DS with the given \a address, the DS is assigned to the next
+ * alliance station (Red 1-3, then Blue 1-3)
+ *
+ * \returns 1 on success, 0 if the address is invalid
+ */
+static int add_station (const char* address, const int port)
+{
+    Station* station;
+
+    if (station_count >= MAX_STATIONS)
+        return 0;
+
+    station = &stations [station_count];
+    memset (station, 0, sizeof (Station));
+    station->addr.sin_family = AF_INET;
+    station->addr.sin_port = htons (port);
+    if (inet_pton (AF_INET, address, &station->addr.sin_addr) != 1)
+        return 0;
+
+    station->station = station_count % 6;
+    DS_HistogramReset (&station->histogram);
+
+    ++station_count;
+    return 1;
+}
+
+/**
+ * Returns the readable name of the given alliance \a station code
+ */
+static const char* station_name (const int station)
+{
+    static const char* names [] = {
+        "Red 1", "Red 2", "Red 3", "Blue 1", "Blue 2", "Blue 3"
+    };
+
+    return names [station % 6];
+}
+
+/**
+ * Creates a UDP socket bound to the given \a port on all interfaces
+ *
+ * \returns the socket descriptor or \c -1 on failure
+ */
+static int open_socket (const int port)
+{
+    int sock;
+    struct sockaddr_in addr;
+
+    sock = socket (AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0)
+        return sock;
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons (port);
+    addr.sin_addr.s_addr = htonl (INADDR_ANY);
+    if (bind (sock, (struct sockaddr*) &addr, sizeof (addr)) != 0) {
+        close (sock);
+        return -1;
+    }
+
+    return sock;
+}
+
+/**
+ * Sends a FMS packet with the given \a period to every DS. The packet
+ * contains the control code, the alliance station of each DS, the match
+ * number and the remaining time of the period.
+ */
+static void send_packets (const int sock, const Period* period,
+                          const int match, const int remaining)
+{
+    int i;
+    uint8_t packet [22];
+    static uint16_t index = 0;
+
+    memset (packet, 0, sizeof (packet));
+
+    /* Add packet index, version and control code */
+    packet [0] = (index >> 8) & 0xff;
+    packet [1] = (index & 0xff);
+    packet [2] = 0x00;
+    packet [3] = period->mode | (period->enabled ? cEnabled : 0x00);
+
+    /* Add tournament level (practice), match and play numbers */
+    packet [6] = 0x01;
+    packet [7] = (match >> 8) & 0xff;
+    packet [8] = (match & 0xff);
+    packet [9] = 0x01;
+
+    /* Add remaining time (in seconds) */
+    packet [20] = (remaining >> 8) & 0xff;
+    packet [21] = (remaining & 0xff);
+
+    /* Send the packet to each DS with its alliance station */
+    for (i = 0; i < station_count; ++i) {
+        packet [5] = (uint8_t) stations [i].station;
+        sendto (sock, packet, sizeof (packet), 0,
+                (struct sockaddr*) &stations [i].addr,
+                sizeof (stations [i].addr));
+    }
+
+    ++index;
+}
+
+/**
+ * Starts measuring the time that each DS needs to honor the enabled state
+ * of the given \a period
+ */
+static void send_command (const Period* period)
+{
+    int i;
+    uint64_t now = DS_GetTimeUs();
+
+    for (i = 0; i < station_count; ++i) {
+        Station* station = &stations [i];
+
+        /* The DS has not honored the previous command */
+        if (station->waiting)
+            ++station->missed;
+
+        /* Nothing to measure if the DS is already in the given state */
+        station->waiting = station->online && station->enabled != period->enabled;
+        station->command_time = now;
+
+        if (station->waiting)
+            ++station->commands;
+    }
+}
+
+/**
+ * Reads a DS-to-FMS packet and checks if the DS has honored the last
+ * enable/disable command
+ *
+ * \returns 1 if a packet was read
+ */
+static int read_packet (const int sock, const Period* period)
+{
+    int i;
+    int len;
+    uint8_t control;
+    uint64_t latency;
+    socklen_t addr_len;
+    struct sockaddr_in addr;
+    uint8_t packet [PACKET_SIZE];
+
+    /* Read the DS packet */
+    addr_len = sizeof (addr);
+    len = (int) recvfrom (sock, packet, sizeof (packet), 0,
+                          (struct sockaddr*) &addr, &addr_len);
+    if (len < 8)
+        return 0;
+
+    /* Find the DS that sent the packet */
+    for (i = 0; i < station_count; ++i) {
+        Station* station = &stations [i];
+        if (station->addr.sin_addr.s_addr != addr.sin_addr.s_addr)
+            continue;
+
+        /* Read the control code and team number */
+        control = packet [3];
+        station->team = (packet [4] << 8) | packet [5];
+        station->enabled = (control & cEnabled) != 0;
+        station->estopped = (control & cEmergencyStop) != 0;
+        station->online = 1;
+        ++station->received;
+
+        /* Measure the time until the DS reports the new state */
+        if (station->waiting && station->enabled == period->enabled) {
+            latency = DS_GetTimeUs() - station->command_time;
+            DS_HistogramRecord (&station->histogram, (uint32_t) latency);
+            station->waiting = 0;
+        }
+
+        return 1;
+    }
+
+    return 1;
+}
+
+/**
+ * Prints the command latency statistics of every DS
+ */
+static void print_results (void)
+{
+    int i;
+
+    printf ("\n%-16s %-7s %5s %8s %8s %6s %9s %9s %9s\n",
+            "Address", "Station", "Team", "Packets", "Commands", "Missed",
+            "p50 (ms)", "p99 (ms)", "max (ms)");
+
+    for (i = 0; i < station_count; ++i) {
+        Station* station = &stations [i];
+        const DS_Histogram* histogram = &station->histogram;
+
+        printf ("%-16s %-7s %5d %8lu %8d %6d %9.1f %9.1f %9.1f\n",
+                inet_ntoa (station->addr.sin_addr),
+                station_name (station->station),
+                station->team,
+                station->received,
+                station->commands,
+                station->missed + station->waiting,
+                DS_HistogramPercentile (histogram, 50) / 1000.0,
+                DS_HistogramPercentile (histogram, 99) / 1000.0,
+                histogram->max / 1000.0);
+    }
+}
+
+/**
+ * Main entry point of the application
+ */
+int main (int argc, char** argv)
+{
+    int i;
+    int sock;
+    int match;
+    int period;
+    int matches = 1;
+    int interval = 500;
+    int auto_time = 15;
+    int teleop_time = 135;
+    int pause_time = 3;
+    int remaining;
+    uint64_t now;
+    uint64_t wake;
+    uint64_t period_end;
+    uint64_t next_packet;
+    DS_Protocol protocol;
+    struct timeval timeout;
+    fd_set set;
+
+    /* Get the FMS ports from the protocol definition */
+    protocol = DS_GetProtocolFRC_2015();
+
+    /* Read the command line options and the DS addresses */
+    for (i = 1; i < argc; ++i) {
+        if (argv [i][0] == '-' && i + 1 < argc) {
+            switch (argv [i][1]) {
+            case 'm':
+                matches = atoi (argv [++i]);
+                break;
+            case 'A':
+                auto_time = atoi (argv [++i]);
+                break;
+            case 'T':
+                teleop_time = atoi (argv [++i]);
+                break;
+            case 'P':
+                pause_time = atoi (argv [++i]);
+                break;
+            case 'i':
+                interval = atoi (argv [++i]);
+                break;
+            default:
+                print_usage (argv [0]);
+                return EXIT_FAILURE;
+            }
+        }
+
+        else if (!add_station (argv [i], protocol.fms_socket.in_port)) {
+            print_usage (argv [0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (station_count <= 0 || matches <= 0 || interval <= 0) {
+        print_usage (argv [0]);
+        return EXIT_FAILURE;
+    }
+
+    /* Define the match timeline */
+    Period timeline [] = {
+        { "Pre-match",    0, cAutonomous,   pause_time  * 1000 },
+        { "Autonomous",   1, cAutonomous,   auto_time   * 1000 },
+        { "Pause",        0, cTeleoperated, pause_time  * 1000 },
+        { "Teleoperated", 1, cTeleoperated, teleop_time * 1000 },
+        { "Post-match",   0, cTeleoperated, pause_time  * 1000 },
+    };
+    const int periods = sizeof (timeline) / sizeof (Period);
+
+    /* Listen for the DS packets */
+    sock = open_socket (protocol.fms_socket.out_port);
+    if (sock < 0) {
+        printf ("Cannot bind to port %d\n", protocol.fms_socket.out_port);
+        return EXIT_FAILURE;
+    }
+
+    /* Stop with CTRL+C */
+    signal (SIGINT, on_signal);
+    signal (SIGTERM, on_signal);
+
+    for (match = 1; match <= matches && running; ++match) {
+        for (period = 0; period < periods && running; ++period) {
+            const Period* current = &timeline [period];
+
+            printf ("Match %d: %s\n", match, current->name);
+
+            /* Send the new period immediately */
+            now = DS_GetTimeUs();
+            period_end = now + (uint64_t) current->duration * 1000;
+            send_command (current);
+            next_packet = now;
+
+            while (running && (now = DS_GetTimeUs()) < period_end) {
+                /* Send the periodic FMS packets */
+                if (now >= next_packet) {
+                    remaining = (int) ((period_end - now) / 1000000);
+                    send_packets (sock, current, match, remaining);
+                    next_packet += (uint64_t) interval * 1000;
+                }
+
+                /* Wait for a DS packet or for the next FMS packet */
+                wake = DS_Min (next_packet, period_end);
+                timeout.tv_sec = (long) ((wake - now) / 1000000);
+                timeout.tv_usec = (long) ((wake - now) % 1000000);
+
+                FD_ZERO (&set);
+                FD_SET (sock, &set);
+                if (select (sock + 1, &set, NULL, NULL, &timeout) > 0)
+                    read_packet (sock, current);
+            }
+        }
+    }
+
+    /* Show the results */
+    print_results();
+    close (sock);
+
+    return EXIT_SUCCESS;
+}
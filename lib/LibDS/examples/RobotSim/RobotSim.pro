@@ -0,0 +1,34 @@
+#-------------------------------------------------------------------------------
+# Remove Qt dependency
+#-------------------------------------------------------------------------------
+
+CONFIG += console
+
+CONFIG -= qt
+CONFIG -= app_bundle
+
+DEFINES -= UNICODE QT_LARGEFILE_SUPPORT
+
+#-------------------------------------------------------------------------------
+# Deploy options
+#-------------------------------------------------------------------------------
+
+TARGET = robot-sim
+
+#-------------------------------------------------------------------------------
+# Include libraries
+#-------------------------------------------------------------------------------
+
+include ($$PWD/../../LibDS.pri)
+
+#-------------------------------------------------------------------------------
+# Import source code
+#-------------------------------------------------------------------------------
+
+HEADERS += \
+    $$PWD/src/robot.h
+
+SOURCES += \
+    $$PWD/src/main.c \
+    $$PWD/src/robot.c
+
@@ -0,0 +1,483 @@
+/*
+ * Copyright (C) 2015-2016 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <LibDS.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "robot.h"
+
+#define PACKET_SIZE 2048
+#define REPLY_SIZE  1024
+#define QUEUE_SIZE  256
+
+/**
+ * Network impairments and NetConsole settings given in the command line
+ */
+typedef struct {
+    int loss;          /**< Percentage of replies that are dropped */
+    int latency;       /**< Delay of every reply (in msecs) */
+    int jitter;        /**< Maximum random delay added to a reply (in msecs) */
+    int reorder;       /**< Percentage of replies that are held back */
+    int console_rate;  /**< NetConsole lines per second, 0 to disable */
+} Options;
+
+/**
+ * A reply that waits in the queue until its delay is over
+ */
+typedef struct {
+    int len;                         /**< Size of the reply */
+    uint64_t due;                    /**< Time (in usecs) to send the reply */
+    struct sockaddr_in addr;         /**< DS address */
+    uint8_t data [REPLY_SIZE];       /**< The reply */
+} PendingReply;
+
+/**
+ * Simulator counters, printed once per second
+ */
+typedef struct {
+    unsigned long received;   /**< Received DS packets */
+    unsigned long sent;       /**< Sent replies */
+    unsigned long lost;       /**< Dropped replies */
+    unsigned long reordered;  /**< Held back replies */
+    unsigned long overflows;  /**< Replies dropped due to a full queue */
+    unsigned long lines;      /**< Sent NetConsole lines */
+} Counters;
+
+static int running = 1;
+static int queue_count = 0;
+static Counters counters;
+static PendingReply queue [QUEUE_SIZE];
+
+/**
+ * Stops the simulator when the user presses CTRL+C
+ */
+static void on_signal (int signal)
+{
+    (void) signal;
+    running = 0;
+}
+
+/**
+ * Prints the command line usage of the application
+ */
+static void print_usage (const char* name)
+{
+    printf ("Usage: %s [options]\n", name);
+    printf ("  -p year  Protocol to simulate: 2014, 2015 or 2016 (default 2016)\n");
+    printf ("  -v volts Battery voltage (default 12.5)\n");
+    printf ("  -n       Simulate a robot without code\n");
+    printf ("  -c pct   CPU usage (default 25)\n");
+    printf ("  -m pct   RAM usage (default 40)\n");
+    printf ("  -d pct   Disk usage (default 30)\n");
+    printf ("  -b pct   CAN utilization (default 10)\n");
+    printf ("  -l pct   Percentage of lost replies (default 0)\n");
+    printf ("  -t ms    Latency of every reply (default 0)\n");
+    printf ("  -j ms    Maximum random jitter of every reply (default 0)\n");
+    printf ("  -o pct   Percentage of reordered replies (default 0)\n");
+    printf ("  -r rate  NetConsole lines per second (default 0)\n");
+}
+
+/**
+ * Returns \c 1 with the given \a percent probability
+ */
+static int chance (const int percent)
+{
+    return percent > 0 && (rand() % 100) < percent;
+}
+
+/**
+ * Reads the command line arguments into the given \a robot and \a options
+ *
+ * \returns 1 if the arguments are valid, 0 otherwise
+ */
+static int parse_options (int argc, char** argv, Robot* robot, Options* options)
+{
+    int i;
+    char flag;
+
+    robot->year = 2016;
+    robot->has_code = 1;
+    robot->voltage = 12.5;
+    robot->cpu_usage = 25;
+    robot->ram_usage = 40;
+    robot->disk_usage = 30;
+    robot->can_util = 10;
+    memset (options, 0, sizeof (Options));
+
+    for (i = 1; i < argc; ++i) {
+        if (argv [i][0] != '-' || strlen (argv [i]) != 2)
+            return 0;
+
+        /* Options without a value */
+        flag = argv [i][1];
+        if (flag == 'n') {
+            robot->has_code = 0;
+            continue;
+        }
+
+        /* All other options require a value */
+        if (i + 1 >= argc)
+            return 0;
+
+        ++i;
+        switch (flag) {
+        case 'p':
+            robot->year = atoi (argv [i]);
+            break;
+        case 'v':
+            robot->voltage = (float) atof (argv [i]);
+            break;
+        case 'c':
+            robot->cpu_usage = atoi (argv [i]);
+            break;
+        case 'm':
+            robot->ram_usage = atoi (argv [i]);
+            break;
+        case 'd':
+            robot->disk_usage = atoi (argv [i]);
+            break;
+        case 'b':
+            robot->can_util = atoi (argv [i]);
+            break;
+        case 'l':
+            options->loss = atoi (argv [i]);
+            break;
+        case 't':
+            options->latency = atoi (argv [i]);
+            break;
+        case 'j':
+            options->jitter = atoi (argv [i]);
+            break;
+        case 'o':
+            options->reorder = atoi (argv [i]);
+            break;
+        case 'r':
+            options->console_rate = atoi (argv [i]);
+            break;
+        default:
+            return 0;
+        }
+    }
+
+    return robot->year >= 2014 && robot->year <= 2016;
+}
+
+/**
+ * Returns the communication protocol that matches the given \a year
+ */
+static DS_Protocol get_protocol (const int year)
+{
+    if (year == 2014)
+        return DS_GetProtocolFRC_2014();
+
+    if (year == 2015)
+        return DS_GetProtocolFRC_2015();
+
+    return DS_GetProtocolFRC_2016();
+}
+
+/**
+ * Creates a UDP socket bound to the given \a port on all interfaces
+ *
+ * \returns the socket descriptor or \c -1 on failure
+ */
+static int open_socket (const int port)
+{
+    int sock;
+    struct sockaddr_in addr;
+
+    sock = socket (AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0 || port <= 0)
+        return sock;
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons (port);
+    addr.sin_addr.s_addr = htonl (INADDR_ANY);
+    if (bind (sock, (struct sockaddr*) &addr, sizeof (addr)) != 0) {
+        close (sock);
+        return -1;
+    }
+
+    return sock;
+}
+
+/**
+ * Adds the given \a reply to the queue, it will be sent to the DS at
+ * \a address when its \a delay (in usecs) is over
+ */
+static void queue_reply (const uint8_t* reply, const int len,
+                         const struct sockaddr_in* address,
+                         const uint64_t delay)
+{
+    PendingReply* pending;
+
+    if (queue_count >= QUEUE_SIZE) {
+        ++counters.overflows;
+        return;
+    }
+
+    pending = &queue [queue_count++];
+    pending->len = len;
+    pending->addr = *address;
+    pending->due = DS_GetTimeUs() + delay;
+    memcpy (pending->data, reply, len);
+}
+
+/**
+ * Sends the queued replies whose delay is over, replies that are due at the
+ * same time are sent in the order in which they were queued
+ *
+ * \returns the time (in usecs) at which the next reply is due, or \c 0 if
+ *          the queue is empty
+ */
+static uint64_t send_replies (const int sock)
+{
+    int i = 0;
+    uint64_t next = 0;
+    uint64_t now = DS_GetTimeUs();
+
+    while (i < queue_count) {
+        PendingReply* pending = &queue [i];
+
+        /* Reply is not due yet */
+        if (pending->due > now) {
+            if (!next || pending->due < next)
+                next = pending->due;
+
+            ++i;
+            continue;
+        }
+
+        /* Send the reply and remove it from the queue (keeping the order) */
+        sendto (sock, pending->data, pending->len, 0,
+                (struct sockaddr*) &pending->addr, sizeof (pending->addr));
+
+        ++counters.sent;
+        memmove (pending, pending + 1,
+                 (queue_count - i - 1) * sizeof (PendingReply));
+        --queue_count;
+    }
+
+    return next;
+}
+
+/**
+ * Reads a DS packet, generates the robot reply and applies the configured
+ * loss, latency, jitter and reordering before queueing it
+ *
+ * \returns 1 if a packet was read
+ */
+static int read_packet (const int sock, const int reply_port,
+                        const int interval, const Options* options,
+                        struct sockaddr_in* ds_address)
+{
+    int len;
+    int reply_len;
+    uint64_t delay;
+    socklen_t addr_len;
+    struct sockaddr_in addr;
+    uint8_t packet [PACKET_SIZE];
+    uint8_t reply [REPLY_SIZE];
+
+    /* Read the DS packet */
+    addr_len = sizeof (addr);
+    len = (int) recvfrom (sock, packet, sizeof (packet), 0,
+                          (struct sockaddr*) &addr, &addr_len);
+    if (len <= 0)
+        return 0;
+
+    /* Replies are sent to the robot input port of the DS */
+    ++counters.received;
+    addr.sin_port = htons (reply_port);
+    *ds_address = addr;
+
+    /* Generate the reply (the robot may be rebooting) */
+    reply_len = robot_reply (packet, len, reply, sizeof (reply));
+    if (reply_len <= 0)
+        return 1;
+
+    /* Simulate packet loss */
+    if (chance (options->loss)) {
+        ++counters.lost;
+        return 1;
+    }
+
+    /* Simulate latency and jitter */
+    delay = (uint64_t) options->latency * 1000;
+    if (options->jitter > 0)
+        delay += (uint64_t) (rand() % (options->jitter * 1000 + 1));
+
+    /* Hold back the reply, so that it arrives after the next one */
+    if (chance (options->reorder)) {
+        delay += (uint64_t) interval * 2000;
+        ++counters.reordered;
+    }
+
+    queue_reply (reply, reply_len, &addr, delay);
+    return 1;
+}
+
+/**
+ * Sends a NetConsole line to the DS at the given \a address
+ */
+static void send_console_line (const int sock, const int port,
+                               const struct sockaddr_in* ds_address)
+{
+    int len;
+    char line [128];
+    struct sockaddr_in addr = *ds_address;
+
+    len = snprintf (line, sizeof (line),
+                    "[RobotSim] Message %lu, simulated robot output\n",
+                    counters.lines);
+
+    addr.sin_port = htons (port);
+    sendto (sock, line, len, 0, (struct sockaddr*) &addr, sizeof (addr));
+    ++counters.lines;
+}
+
+/**
+ * Prints the simulator counters and the state requested by the DS
+ */
+static void print_status (void)
+{
+    RobotStatus status = robot_status();
+
+    printf ("RX %lu TX %lu lost %lu reordered %lu overflows %lu "
+            "NetConsole %lu | %s%s%s\n",
+            counters.received, counters.sent, counters.lost,
+            counters.reordered, counters.overflows, counters.lines,
+            status.enabled ? "enabled" : "disabled",
+            status.estopped ? ", e-stopped" : "",
+            status.rebooting ? ", rebooting" : "");
+}
+
+/**
+ * Main entry point of the application
+ */
+int main (int argc, char** argv)
+{
+    Robot robot;
+    int have_ds = 0;
+    Options options;
+    int console_port;
+    int robot_socket;
+    int console_socket;
+    uint64_t now;
+    uint64_t wake;
+    uint64_t next_reply;
+    uint64_t next_line = 0;
+    uint64_t next_status = 0;
+    uint64_t line_interval = 0;
+    DS_Protocol protocol;
+    struct timeval timeout;
+    struct sockaddr_in ds_address;
+    fd_set set;
+
+    /* Read the command line options */
+    if (!parse_options (argc, argv, &robot, &options)) {
+        print_usage (argv [0]);
+        return EXIT_FAILURE;
+    }
+
+    /* Get the ports and intervals from the protocol definition */
+    protocol = get_protocol (robot.year);
+    console_port = protocol.netconsole_socket.disabled ?
+                   0 : protocol.netconsole_socket.in_port;
+    if (options.console_rate > 0 && console_port > 0)
+        line_interval = 1000000 / options.console_rate;
+
+    /* Open the robot and NetConsole sockets */
+    robot_socket = open_socket (protocol.robot_socket.out_port);
+    console_socket = open_socket (0);
+    if (robot_socket < 0 || console_socket < 0) {
+        printf ("Cannot bind to port %d\n", protocol.robot_socket.out_port);
+        return EXIT_FAILURE;
+    }
+
+    /* Stop with CTRL+C */
+    signal (SIGINT, on_signal);
+    signal (SIGTERM, on_signal);
+
+    init_robot (&robot);
+    printf ("Simulating a FRC %d robot on port %d...\n", robot.year,
+            protocol.robot_socket.out_port);
+
+    while (running) {
+        /* Send the replies that are due */
+        next_reply = send_replies (robot_socket);
+        now = DS_GetTimeUs();
+
+        /* Send the NetConsole lines that are due (without bursts) */
+        if (line_interval && have_ds) {
+            if (next_line + line_interval < now)
+                next_line = now;
+
+            while (next_line <= now) {
+                send_console_line (console_socket, console_port, &ds_address);
+                next_line += line_interval;
+            }
+        }
+
+        /* Print the status once per second */
+        if (now >= next_status) {
+            print_status();
+            next_status = now + 1000000;
+        }
+
+        /* Wait for a DS packet or for the next timed event */
+        wake = next_status;
+        if (next_reply && next_reply < wake)
+            wake = next_reply;
+        if (line_interval && have_ds && next_line < wake)
+            wake = next_line;
+
+        timeout.tv_sec = (long) ((wake - now) / 1000000);
+        timeout.tv_usec = (long) ((wake - now) % 1000000);
+
+        FD_ZERO (&set);
+        FD_SET (robot_socket, &set);
+        if (select (robot_socket + 1, &set, NULL, NULL, &timeout) > 0) {
+            if (read_packet (robot_socket, protocol.robot_socket.in_port,
+                             protocol.robot_interval, &options, &ds_address))
+                have_ds = 1;
+        }
+    }
+
+    /* Print the final counters and close the sockets */
+    print_status();
+    close (robot_socket);
+    close (console_socket);
+
+    return EXIT_SUCCESS;
+}
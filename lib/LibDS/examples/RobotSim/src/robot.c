@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2015-2016 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "robot.h"
+
+#include <LibDS.h>
+#include <string.h>
+
+/*
+ * Time (in msecs) that the simulated robot needs to reboot or to restart
+ * its code when the DS asks it to
+ */
+#define REBOOT_TIME  5000
+#define RESTART_TIME 2000
+
+/*
+ * Robot-side flags of the 2014 protocol (see src/protocols/frc_2014.c)
+ */
+static const uint8_t c14_Enabled        = 0x20;
+static const uint8_t c14_RebootRobot    = 0x80;
+static const uint8_t c14_EStopOff       = 0x40;
+
+/*
+ * Robot-side flags and tags of the 2015 protocol (see frc_2015.c)
+ */
+static const uint8_t c15_Enabled        = 0x04;
+static const uint8_t c15_EmergencyStop  = 0x80;
+static const uint8_t c15_RequestReboot  = 0x08;
+static const uint8_t c15_RequestRestart = 0x04;
+static const uint8_t c15_TagGeneral     = 0x01;
+static const uint8_t c15_RobotHasCode   = 0x20;
+static const uint8_t c15_TagCANInfo     = 0x0e;
+static const uint8_t c15_TagCPUInfo     = 0x05;
+static const uint8_t c15_TagRAMInfo     = 0x06;
+static const uint8_t c15_TagDiskInfo    = 0x04;
+
+/*
+ * Nominal roboRIO memory and storage sizes, the DS calculates the usage
+ * percentages from the reported free space
+ */
+static const double cRoboRIORAMSize     = 256.0 * 1024 * 1024;
+static const double cRoboRIODiskSize    = 512.0 * 1024 * 1024;
+
+/*
+ * Simulated robot configuration and state
+ */
+static Robot robot;
+static RobotStatus status;
+static uint64_t reboot_end = 0;
+static uint64_t restart_end = 0;
+
+/**
+ * Writes the given \a value in big-endian order
+ */
+static void encode_u32 (uint8_t* bytes, const uint32_t value)
+{
+    bytes [0] = (value >> 24) & 0xff;
+    bytes [1] = (value >> 16) & 0xff;
+    bytes [2] = (value >> 8) & 0xff;
+    bytes [3] = (value & 0xff);
+}
+
+/**
+ * Writes the given \a value as a big-endian IEEE-754 float
+ */
+static void encode_float (uint8_t* bytes, const float value)
+{
+    uint32_t bits;
+    memcpy (&bits, &value, sizeof (bits));
+    encode_u32 (bytes, bits);
+}
+
+/**
+ * Returns the free space that corresponds to the given \a usage
+ * percentage of \a total
+ */
+static uint32_t free_space (const int usage, const double total)
+{
+    return (uint32_t) (total * (100 - DS_Min (DS_Max (usage, 0), 100)) / 100);
+}
+
+/**
+ * Returns \c 1 if the robot code is running
+ */
+static int code_running (void)
+{
+    return robot.has_code && DS_GetTimeMs() >= restart_end;
+}
+
+/**
+ * Builds a 2014 (cRIO) reply, the voltage is encoded with the inverse of the
+ * 'rule of three' used by the DS and the reply is always 1024 bytes long
+ */
+static int reply_2014 (const uint8_t* packet, const int len,
+                       uint8_t* reply, const int max)
+{
+    int upper;
+    int lower;
+    uint8_t control;
+
+    if (len < 1024 || max < 1024)
+        return 0;
+
+    /* Read the DS control code */
+    control = packet [2];
+    status.enabled = (control & c14_Enabled) != 0;
+    status.estopped = (control & c14_EStopOff) == 0;
+
+    /* Reboot the robot if the DS asks for it */
+    if (control & c14_RebootRobot) {
+        reboot_end = DS_GetTimeMs() + REBOOT_TIME;
+        return 0;
+    }
+
+    /* Encode the voltage */
+    upper = (int) robot.voltage;
+    lower = (int) ((robot.voltage - upper) * 0xff);
+    memset (reply, 0, 1024);
+    reply [0] = status.estopped ? 0x00 : c14_EStopOff;
+    reply [1] = (uint8_t) DS_Min ((upper * 0x12 + 11) / 12, 0xff);
+    reply [2] = (uint8_t) DS_Min ((lower * 0x12 + 11) / 12, 0xff);
+
+    return 1024;
+}
+
+/**
+ * Appends an extended tag with the given \a id and \a size (payload size)
+ * to the \a reply, returns the offset of the tag payload
+ */
+static int add_tag (uint8_t* reply, int* len, const uint8_t id, const int size)
+{
+    int offset = *len + 2;
+
+    reply [*len] = (uint8_t) (size + 1);
+    reply [*len + 1] = id;
+    memset (reply + offset, 0, size);
+    *len += size + 2;
+
+    return offset;
+}
+
+/**
+ * Builds a 2015/2016 (roboRIO) reply, which echoes the packet index and the
+ * control code and is followed by the CAN, CPU, RAM and disk tags
+ */
+static int reply_2015 (const uint8_t* packet, const int len,
+                       uint8_t* reply, const int max)
+{
+    int pos;
+    int size = 0;
+    uint8_t control;
+    uint8_t request;
+
+    if (len < 6 || max < 128)
+        return 0;
+
+    /* Read the DS control and request codes */
+    control = packet [3];
+    request = packet [4];
+    status.enabled = (control & c15_Enabled) != 0;
+    status.estopped = (control & c15_EmergencyStop) != 0;
+
+    /* Reboot the robot or restart the code if the DS asks for it */
+    if (request == c15_RequestReboot) {
+        reboot_end = DS_GetTimeMs() + REBOOT_TIME;
+        return 0;
+    }
+
+    else if (request == c15_RequestRestart && code_running())
+        restart_end = DS_GetTimeMs() + RESTART_TIME;
+
+    /* Add the general data */
+    reply [size++] = packet [0];
+    reply [size++] = packet [1];
+    reply [size++] = c15_TagGeneral;
+    reply [size++] = control;
+    reply [size++] = code_running() ? c15_RobotHasCode : 0x00;
+    reply [size++] = (uint8_t) robot.voltage;
+    reply [size++] = (uint8_t) ((robot.voltage - (int) robot.voltage) * 0xff);
+    reply [size++] = 0x00;
+
+    /* Add CAN utilization (bus off, TX full and error counters are zero) */
+    pos = add_tag (reply, &size, c15_TagCANInfo, 14);
+    encode_float (reply + pos, (float) robot.can_util);
+
+    /* Add the CPU load (two CPUs, the load is the first value of each CPU) */
+    pos = add_tag (reply, &size, c15_TagCPUInfo, 4 + 2 * 16);
+    encode_float (reply + pos, 2);
+    encode_float (reply + pos + 4, (float) robot.cpu_usage);
+    encode_float (reply + pos + 20, (float) robot.cpu_usage);
+
+    /* Add the free RAM */
+    pos = add_tag (reply, &size, c15_TagRAMInfo, 8);
+    encode_u32 (reply + pos, 4096);
+    encode_u32 (reply + pos + 4, free_space (robot.ram_usage, cRoboRIORAMSize));
+
+    /* Add the free disk space */
+    pos = add_tag (reply, &size, c15_TagDiskInfo, 8);
+    encode_u32 (reply + pos, 4096);
+    encode_u32 (reply + pos + 4, free_space (robot.disk_usage, cRoboRIODiskSize));
+
+    return size;
+}
+
+/**
+ * Configures the simulated robot
+ */
+void init_robot (const Robot* config)
+{
+    if (config)
+        robot = *config;
+
+    reboot_end = 0;
+    restart_end = 0;
+    memset (&status, 0, sizeof (status));
+}
+
+/**
+ * Returns \c 1 if the robot answers packets, \c 0 while it reboots
+ */
+int robot_online (void)
+{
+    return DS_GetTimeMs() >= reboot_end;
+}
+
+/**
+ * Returns the state requested by the DS in its last packet
+ */
+RobotStatus robot_status (void)
+{
+    status.rebooting = !robot_online();
+    return status;
+}
+
+/**
+ * Interprets the given DS \a packet and writes the robot reply to the
+ * \a reply buffer
+ *
+ * \returns the length of the reply, or \c 0 if the robot does not answer
+ *          (e.g. the packet is invalid or the robot is rebooting)
+ */
+int robot_reply (const uint8_t* packet, const int len,
+                 uint8_t* reply, const int max)
+{
+    if (!packet || !reply || !robot_online())
+        return 0;
+
+    if (robot.year == 2014)
+        return reply_2014 (packet, len, reply, max);
+
+    return reply_2015 (packet, len, reply, max);
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2015-2016 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _ROBOT_SIM_ROBOT_H
+#define _ROBOT_SIM_ROBOT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * Simulated robot state, which is reported to the DS in every reply
+ */
+typedef struct {
+    int year;        /**< Protocol year (2014, 2015 or 2016) */
+    int has_code;    /**< 1 if the robot code is running */
+    float voltage;   /**< Battery voltage */
+    int cpu_usage;   /**< CPU usage percentage (2015/2016 only) */
+    int ram_usage;   /**< RAM usage percentage (2015/2016 only) */
+    int disk_usage;  /**< Disk usage percentage (2015/2016 only) */
+    int can_util;    /**< CAN bus utilization (2015/2016 only) */
+} Robot;
+
+/**
+ * Summary of the last DS packet, used to print the simulator status
+ */
+typedef struct {
+    int enabled;     /**< 1 if the DS wants the robot to be enabled */
+    int estopped;    /**< 1 if the DS wants the robot to be e-stopped */
+    int rebooting;   /**< 1 while the robot simulates a reboot */
+} RobotStatus;
+
+extern void init_robot (const Robot* robot);
+extern int robot_online (void);
+extern RobotStatus robot_status (void);
+extern int robot_reply (const uint8_t* packet, const int len,
+                        uint8_t* reply, const int max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
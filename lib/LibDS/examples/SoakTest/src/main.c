@@ -0,0 +1,612 @@
+/*
+ * Copyright (C) 2015-2016 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <LibDS.h>
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#if defined __APPLE__
+    #include <mach/mach.h>
+#endif
+
+#define TICK_INTERVAL    20
+#define WARMUP_SECS      300
+#define FLOOD_LINES      2000
+#define FLOOD_MESSAGES   200
+#define READ_LINES       64
+#define RSS_DRIFT        10
+
+/**
+ * Options given by the user in the command line
+ */
+typedef struct {
+    double hours;         /**< Duration of the test */
+    int sample_secs;      /**< Interval between two samples */
+    int protocol_secs;    /**< Interval between two protocol switches */
+    int address_secs;     /**< Interval between two robot address changes */
+    int joystick_secs;    /**< Interval between two joystick hot-plugs */
+    int flood_secs;       /**< Interval between two NetConsole floods */
+    const char* output;   /**< CSV file with the samples */
+    int virtual_clock;    /**< Run on the virtual clock (faster than real time) */
+} Options;
+
+/**
+ * Resource usage and timing of the DS at a given time
+ */
+typedef struct {
+    double time;          /**< Seconds since the start of the test */
+    double rss_kb;        /**< Resident memory (in KB) */
+    double threads;       /**< Threads of the process */
+    double fds;           /**< Open file descriptors */
+    double late_p50;      /**< Median robot send lateness (in usecs) */
+    double late_p99;      /**< 99th percentile of the send lateness */
+    double late_max;      /**< Largest send lateness */
+    double queue_depth;   /**< Events waiting in the queue */
+    double queue_peak;    /**< Largest queue depth since the last sample */
+    double dropped;       /**< Events dropped since the last sample */
+    double lines_lost;    /**< NetConsole lines lost since the last sample */
+} Sample;
+
+/**
+ * Metrics of a sample that are checked for drift
+ */
+typedef struct {
+    const char* name;     /**< Name of the metric */
+    size_t offset;        /**< Offset of the metric in a \c Sample */
+    int leak;             /**< 1 if any growth is reported as a leak */
+} Metric;
+
+static const Metric metrics [] = {
+    { "rss_kb",      offsetof (Sample, rss_kb),      0 },
+    { "threads",     offsetof (Sample, threads),     1 },
+    { "fds",         offsetof (Sample, fds),         1 },
+    { "late_p50",    offsetof (Sample, late_p50),    0 },
+    { "late_p99",    offsetof (Sample, late_p99),    0 },
+    { "late_max",    offsetof (Sample, late_max),    0 },
+    { "queue_depth", offsetof (Sample, queue_depth), 0 },
+    { "queue_peak",  offsetof (Sample, queue_peak),  0 },
+};
+
+/**
+ * Protocols loaded in turn during the test
+ */
+static DS_Protocol (*protocols []) (void) = {
+    &DS_GetProtocolFRC_2016,
+    &DS_GetProtocolFRC_2015,
+    &DS_GetProtocolFRC_2020,
+    &DS_GetProtocolFRC_2014,
+};
+
+/**
+ * Robot addresses applied in turn during the test (an empty string selects
+ * the default address of the protocol, which is resolved with mDNS)
+ */
+static const char* addresses [] = {
+    "127.0.0.1",
+    "localhost",
+    "",
+};
+
+static int running = 1;
+static size_t sample_count = 0;
+static size_t sample_capacity = 0;
+static Sample* samples = NULL;
+static DS_Protocol protocol;  /**< Copy of the loaded protocol (its name
+                                   belongs to the LibDS) */
+
+/**
+ * Stops the test when the user presses CTRL+C
+ */
+static void on_signal (int signal)
+{
+    (void) signal;
+    running = 0;
+}
+
+/**
+ * Prints the command line usage of the application
+ */
+static void print_usage (const char* name)
+{
+    printf ("Usage: %s [-h hours] [-s secs] [-p secs] [-a secs] [-j secs] "
+            "[-f secs] [-o file] [-c clock]\n", name);
+    printf ("  -h  Duration of the test in hours (default 12)\n");
+    printf ("  -s  Interval between two samples in seconds (default 60)\n");
+    printf ("  -p  Interval between protocol switches (default 600)\n");
+    printf ("  -a  Interval between robot address changes (default 300)\n");
+    printf ("  -j  Interval between joystick hot-plugs (default 30)\n");
+    printf ("  -f  Interval between NetConsole floods (default 120)\n");
+    printf ("  -o  CSV file with the samples (default soak.csv)\n");
+    printf ("  -c  'real' or 'virtual', the virtual clock is advanced by each "
+            "tick instead\n      of sleeping, so the test runs faster than "
+            "real time (default real)\n");
+}
+
+/**
+ * Reads the command line arguments into the given \a options
+ *
+ * \returns 1 if the arguments are valid, 0 otherwise
+ */
+static int parse_options (int argc, char** argv, Options* options)
+{
+    int i;
+
+    options->hours = 12;
+    options->sample_secs = 60;
+    options->protocol_secs = 600;
+    options->address_secs = 300;
+    options->joystick_secs = 30;
+    options->flood_secs = 120;
+    options->output = "soak.csv";
+    options->virtual_clock = 0;
+
+    for (i = 1; i + 1 < argc; i += 2) {
+        if (strcmp (argv [i], "-h") == 0)
+            options->hours = atof (argv [i + 1]);
+        else if (strcmp (argv [i], "-s") == 0)
+            options->sample_secs = atoi (argv [i + 1]);
+        else if (strcmp (argv [i], "-p") == 0)
+            options->protocol_secs = atoi (argv [i + 1]);
+        else if (strcmp (argv [i], "-a") == 0)
+            options->address_secs = atoi (argv [i + 1]);
+        else if (strcmp (argv [i], "-j") == 0)
+            options->joystick_secs = atoi (argv [i + 1]);
+        else if (strcmp (argv [i], "-f") == 0)
+            options->flood_secs = atoi (argv [i + 1]);
+        else if (strcmp (argv [i], "-o") == 0)
+            options->output = argv [i + 1];
+        else if (strcmp (argv [i], "-c") == 0 &&
+                 strcmp (argv [i + 1], "real") == 0)
+            options->virtual_clock = 0;
+        else if (strcmp (argv [i], "-c") == 0 &&
+                 strcmp (argv [i + 1], "virtual") == 0)
+            options->virtual_clock = 1;
+        else
+            return 0;
+    }
+
+    return i == argc && options->hours > 0 && options->sample_secs > 0 &&
+           options->protocol_secs > 0 && options->address_secs > 0 &&
+           options->joystick_secs > 0 && options->flood_secs > 0;
+}
+
+/**
+ * Obtains the resident memory and the number of threads of the process
+ */
+static void get_process_usage (double* rss_kb, double* threads)
+{
+    *rss_kb = 0;
+    *threads = 0;
+
+#if defined __APPLE__
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    mach_task_basic_info_data_t info;
+    thread_act_array_t list;
+    mach_msg_type_number_t list_count;
+
+    if (task_info (mach_task_self(), MACH_TASK_BASIC_INFO,
+                   (task_info_t) &info, &count) == KERN_SUCCESS)
+        *rss_kb = info.resident_size / 1024.0;
+
+    if (task_threads (mach_task_self(), &list, &list_count) == KERN_SUCCESS) {
+        *threads = list_count;
+        vm_deallocate (mach_task_self(), (vm_address_t) list,
+                       list_count * sizeof (thread_act_t));
+    }
+#else
+    char line [256];
+    FILE* file = fopen ("/proc/self/status", "r");
+
+    if (!file)
+        return;
+
+    while (fgets (line, sizeof (line), file)) {
+        if (strncmp (line, "VmRSS:", 6) == 0)
+            *rss_kb = atof (line + 6);
+        else if (strncmp (line, "Threads:", 8) == 0)
+            *threads = atof (line + 8);
+    }
+
+    fclose (file);
+#endif
+}
+
+/**
+ * Returns the number of open file descriptors of the process
+ */
+static double get_fd_count (void)
+{
+    int count = 0;
+    struct dirent* entry;
+
+#if defined __APPLE__
+    DIR* dir = opendir ("/dev/fd");
+#else
+    DIR* dir = opendir ("/proc/self/fd");
+#endif
+
+    if (!dir)
+        return 0;
+
+    while ((entry = readdir (dir)) != NULL) {
+        if (entry->d_name [0] != '.')
+            ++count;
+    }
+
+    closedir (dir);
+
+    /* Do not count the descriptor of the directory itself */
+    return count > 0 ? count - 1 : 0;
+}
+
+/**
+ * Takes a sample of the resource usage and timing of the DS and writes it
+ * to the given CSV \a file
+ */
+static void take_sample (const double time, FILE* file)
+{
+    Sample sample;
+    DS_InternalStats stats;
+    DS_LatencyInfo latency = DS_GetRobotLatencyInfo();
+
+    DS_GetInternalStats (&stats);
+    DS_ResetInternalStats();
+
+    sample.time = time;
+    get_process_usage (&sample.rss_kb, &sample.threads);
+    sample.fds = get_fd_count();
+    sample.late_p50 = latency.lateness.p50;
+    sample.late_p99 = latency.lateness.p99;
+    sample.late_max = latency.lateness.max;
+    sample.queue_depth = stats.events.queue_depth;
+    sample.queue_peak = stats.events.high_water;
+    sample.dropped = stats.events.dropped;
+    sample.lines_lost = stats.netconsole.lines_lost;
+
+    /* Grow the sample list geometrically, the test can run for days */
+    if (sample_count == sample_capacity) {
+        sample_capacity = sample_capacity ? sample_capacity * 2 : 64;
+        samples = (Sample*) realloc (samples, sample_capacity * sizeof (Sample));
+        if (!samples) {
+            printf ("Out of memory\n");
+            exit (EXIT_FAILURE);
+        }
+    }
+
+    samples [sample_count++] = sample;
+
+    fprintf (file, "%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f\n",
+             sample.time, sample.rss_kb, sample.threads, sample.fds,
+             sample.late_p50, sample.late_p99, sample.late_max,
+             sample.queue_depth, sample.queue_peak, sample.dropped,
+             sample.lines_lost);
+    fflush (file);
+
+    printf ("[%6.2f h] RSS %.0f KB, %.0f threads, %.0f fds, lateness "
+            "p50/p99/max %.0f/%.0f/%.0f us, queue %.0f (peak %.0f)\n",
+            time / 3600, sample.rss_kb, sample.threads, sample.fds,
+            sample.late_p50, sample.late_p99, sample.late_max,
+            sample.queue_depth, sample.queue_peak);
+}
+
+/**
+ * Loads the next protocol of the rotation
+ */
+static void switch_protocol (const int index)
+{
+    protocol = protocols [index % (sizeof (protocols) / sizeof (protocols [0]))]();
+    DS_ConfigureProtocol (&protocol);
+
+    DS_SetControlMode (DS_CONTROL_TELEOPERATED);
+    DS_SetRobotEnabled (1);
+}
+
+/**
+ * Detaches every joystick and attaches a random number of them, like a
+ * driver that plugs and unplugs controllers
+ */
+static void hotplug_joysticks (void)
+{
+    int i;
+    int count = rand() % (DS_Max (protocol.max_joysticks, 1) + 1);
+
+    DS_JoysticksReset();
+    for (i = 0; i < count; ++i)
+        DS_JoysticksAdd (protocol.max_axis_count,
+                         protocol.max_hat_count,
+                         protocol.max_button_count);
+}
+
+/**
+ * Moves the axes and toggles the buttons of the attached joysticks
+ */
+static void move_joysticks (const int tick)
+{
+    int i;
+
+    for (i = 0; i < DS_GetJoystickCount(); ++i) {
+        if (DS_GetJoystickNumAxes (i) > 0)
+            DS_SetJoystickAxis (i, tick % DS_GetJoystickNumAxes (i),
+                                ((tick + i * 20) % 200 - 100) / 100.0f);
+
+        if (DS_GetJoystickNumButtons (i) > 0)
+            DS_SetJoystickButton (i, tick % DS_GetJoystickNumButtons (i),
+                                  (tick / 10) % 2);
+    }
+}
+
+/**
+ * Adds a burst of NetConsole lines (as if the robot printed a stack trace)
+ * and queues a burst of outgoing NetConsole messages
+ */
+static void flood_netconsole (void)
+{
+    int i;
+    char line [128];
+
+    for (i = 0; i < FLOOD_LINES; ++i) {
+        int len = snprintf (line, sizeof (line),
+                            "Soak test line %d of the NetConsole flood\n", i);
+        DS_NetConsoleAppend (line, (size_t) len);
+    }
+
+    for (i = 0; i < FLOOD_MESSAGES; ++i) {
+        snprintf (line, sizeof (line), "Soak test message %d", i);
+        DS_SendNetConsoleMessage (line);
+    }
+}
+
+/**
+ * Reads the new NetConsole lines, like an application that displays them
+ */
+static void read_netconsole (uint64_t* cursor)
+{
+    char buffer [DS_NETCONSOLE_LINE_SIZE * 4];
+    DS_NetConsoleLine lines [READ_LINES];
+
+    while (DS_NetConsoleRead (cursor, lines, READ_LINES,
+                              buffer, sizeof (buffer)) > 0);
+}
+
+/**
+ * Returns the median of the given \a metric of the samples in the given
+ * range, or \c 0 if the range is empty
+ */
+static double median (const Metric* metric, const size_t first,
+                      const size_t last)
+{
+    size_t i;
+    size_t j;
+    size_t count = last - first;
+    double result = 0;
+    double* values = (double*) calloc (count ? count : 1, sizeof (double));
+
+    if (!values || count == 0) {
+        free (values);
+        return 0;
+    }
+
+    /* Insertion sort, there are a few hundred samples at most */
+    for (i = 0; i < count; ++i) {
+        double value = *(double*) ((char*) &samples [first + i] +
+                                   metric->offset);
+        for (j = i; j > 0 && values [j - 1] > value; --j)
+            values [j] = values [j - 1];
+
+        values [j] = value;
+    }
+
+    result = values [count / 2];
+    free (values);
+    return result;
+}
+
+/**
+ * Returns the least-squares slope (per hour) of the given \a metric of the
+ * samples in the given range
+ */
+static double slope (const Metric* metric, const size_t first,
+                     const size_t last)
+{
+    size_t i;
+    double n = (double) (last - first);
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+
+    for (i = first; i < last; ++i) {
+        double x = samples [i].time / 3600;
+        double y = *(double*) ((char*) &samples [i] + metric->offset);
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+
+    if (n < 2 || n * sxx - sx * sx == 0)
+        return 0;
+
+    return (n * sxy - sx * sy) / (n * sxx - sx * sx);
+}
+
+/**
+ * Compares the start and the end of the test for each metric and prints the
+ * drift report
+ *
+ * \returns the number of metrics that drifted
+ */
+static int report_drift (void)
+{
+    size_t i;
+    int drifts = 0;
+    size_t first = 0;
+    size_t window;
+    double dropped = 0;
+    double lines_lost = 0;
+    double warmup = WARMUP_SECS;
+
+    /* Skip the samples of the warm-up period (at most a tenth of the test) */
+    if (sample_count > 0 && samples [sample_count - 1].time / 10 < warmup)
+        warmup = samples [sample_count - 1].time / 10;
+
+    while (first < sample_count && samples [first].time < warmup)
+        ++first;
+
+    if (sample_count - first < 4) {
+        printf ("\nNot enough samples after the warm-up to report drift\n");
+        return 0;
+    }
+
+    /* Compare the first and the last quarter of the remaining samples */
+    window = (sample_count - first) / 4;
+
+    printf ("\n%-12s %12s %12s %14s\n", "Metric", "Start", "End", "Slope (/h)");
+    for (i = 0; i < sizeof (metrics) / sizeof (metrics [0]); ++i) {
+        const Metric* metric = &metrics [i];
+        double start = median (metric, first, first + window);
+        double end = median (metric, sample_count - window, sample_count);
+        int drift = 0;
+
+        /* Threads and file descriptors must not grow, memory within limits */
+        if (metric->leak)
+            drift = end > start;
+        else if (metric->offset == offsetof (Sample, rss_kb))
+            drift = end > start * (1 + RSS_DRIFT / 100.0);
+
+        printf ("%-12s %12.0f %12.0f %+14.2f%s\n", metric->name, start, end,
+                slope (metric, first, sample_count), drift ? "  DRIFT" : "");
+        drifts += drift;
+    }
+
+    for (i = 0; i < sample_count; ++i) {
+        dropped += samples [i].dropped;
+        lines_lost += samples [i].lines_lost;
+    }
+
+    printf ("\nEvents dropped: %.0f, NetConsole lines lost: %.0f\n",
+            dropped, lines_lost);
+
+    return drifts;
+}
+
+int main (int argc, char** argv)
+{
+    int tick = 0;
+    int drifts = 0;
+    FILE* file = NULL;
+    Options options;
+    DS_Event event;
+    uint64_t start;
+    uint64_t elapsed;
+    uint64_t cursor = 0;
+    uint64_t next_sample = 0;
+    uint64_t next_protocol = 0;
+    uint64_t next_address = 0;
+    uint64_t next_joystick = 0;
+    uint64_t next_flood = 0;
+    int protocol_index = 0;
+    int address_index = 0;
+
+    /* Read the command line options */
+    if (!parse_options (argc, argv, &options)) {
+        print_usage (argv [0]);
+        return EXIT_FAILURE;
+    }
+
+    /* Open the CSV file */
+    file = fopen (options.output, "w");
+    if (!file) {
+        printf ("Cannot open %s\n", options.output);
+        return EXIT_FAILURE;
+    }
+
+    fprintf (file, "time,rss_kb,threads,fds,late_p50,late_p99,late_max,"
+             "queue_depth,queue_peak,dropped,lines_lost\n");
+
+    signal (SIGINT, on_signal);
+    signal (SIGTERM, on_signal);
+
+    /* Initialize the DS */
+    DS_Init();
+    DS_SetVirtualClock (options.virtual_clock);
+    start = DS_GetTimeMs();
+
+    printf ("Soak test for %.1f hours, samples are written to %s\n",
+            options.hours, options.output);
+
+    /* Drive the DS until the test is over (or the user quits) */
+    while (running) {
+        elapsed = DS_GetTimeMs() - start;
+        if (elapsed >= (uint64_t) (options.hours * 3600 * 1000))
+            break;
+
+        if (elapsed >= next_protocol) {
+            switch_protocol (protocol_index++);
+            next_protocol += options.protocol_secs * 1000;
+        }
+
+        if (elapsed >= next_address) {
+            DS_SetCustomRobotAddress (addresses [address_index++ % 3]);
+            next_address += options.address_secs * 1000;
+        }
+
+        if (elapsed >= next_joystick) {
+            hotplug_joysticks();
+            next_joystick += options.joystick_secs * 1000;
+        }
+
+        if (elapsed >= next_flood) {
+            flood_netconsole();
+            next_flood += options.flood_secs * 1000;
+        }
+
+        if (elapsed >= next_sample) {
+            take_sample (elapsed / 1000.0, file);
+            next_sample += options.sample_secs * 1000;
+        }
+
+        /* Behave like a DS application */
+        move_joysticks (tick++);
+        read_netconsole (&cursor);
+        while (DS_PollEvent (&event));
+
+        if (options.virtual_clock)
+            DS_AdvanceClock (TICK_INTERVAL * 1000);
+        else
+            DS_Sleep (TICK_INTERVAL);
+    }
+
+    /* Stop the DS and report the drift */
+    DS_Close();
+    fclose (file);
+
+    drifts = report_drift();
+    free (samples);
+
+    return drifts > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,47 @@
+#-------------------------------------------------------------------------------
+# Remove Qt dependency
+#-------------------------------------------------------------------------------
+
+CONFIG += console
+
+CONFIG -= qt
+CONFIG -= app_bundle
+
+DEFINES -= UNICODE QT_LARGEFILE_SUPPORT
+
+#-------------------------------------------------------------------------------
+# Deploy options
+#-------------------------------------------------------------------------------
+
+TARGET = libds-fuzz
+
+#-------------------------------------------------------------------------------
+# libFuzzer build (requires clang), use "qmake CONFIG+=libfuzzer"
+#-------------------------------------------------------------------------------
+
+libfuzzer {
+    DEFINES += LIBDS_LIBFUZZER
+    QMAKE_CFLAGS += -fsanitize=fuzzer,address,undefined
+    QMAKE_LFLAGS += -fsanitize=fuzzer,address,undefined
+}
+
+#-------------------------------------------------------------------------------
+# Include libraries
+#-------------------------------------------------------------------------------
+
+include ($$PWD/../LibDS.pri)
+
+unix:!macx* {
+    LIBS += -pthread
+}
+
+win32* {
+    LIBS += -lws2_32
+}
+
+#-------------------------------------------------------------------------------
+# Import source code
+#-------------------------------------------------------------------------------
+
+SOURCES += \
+    $$PWD/src/main.c
@@ -0,0 +1,281 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Fuzzing and throughput harness for the protocol decoders, which read
+ * untrusted network data.
+ *
+ * The first byte of each input selects the decoder (the FMS packet, robot
+ * packet or robot stream decoder of the 2014, 2015, 2016 or 2020 protocol),
+ * the rest of the input is given to the decoder as a received packet:
+ *
+ *   - Build with "CONFIG+=libfuzzer" (clang) to obtain a libFuzzer binary
+ *   - Build with an AFL compiler (e.g. "QMAKE_CC=afl-clang-fast") to obtain
+ *     a binary that decodes the files given as arguments (or stdin), which
+ *     can also be used to replay a corpus or a crash
+ *   - Run "libds-fuzz --throughput <2014|2015|2016|2020> <capture>" to decode
+ *     every received FMS and robot packet of a capture file (see
+ *     DS_StartCapture()) in a loop and report the packets decoded per second
+ */
+
+#include <LibDS.h>
+#include <DS_Config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Number of protocols, decoders of each protocol and minimum duration of a
+ * throughput run
+ */
+#define PROTOCOL_COUNT   4
+#define DECODER_COUNT    3
+#define MIN_DURATION_US  1000000ULL
+
+/*
+ * Decoders of a protocol
+ */
+#define DECODER_FMS      0
+#define DECODER_ROBOT    1
+#define DECODER_STREAM   2
+
+/*
+ * Protocols whose decoders are tested
+ */
+static int initialized = 0;
+static DS_Protocol protocols [PROTOCOL_COUNT];
+static const char* protocol_names [PROTOCOL_COUNT] = {
+    "2014", "2015", "2016", "2020"
+};
+
+/*
+ * Sink used to keep the compiler from optimizing the decoders away
+ */
+static volatile int sink = 0;
+
+/**
+ * Initializes the DS (without loading a protocol, so no sockets are opened)
+ * and the protocols whose decoders are tested
+ */
+static void init (void)
+{
+    if (initialized)
+        return;
+
+    DS_Init();
+    protocols [0] = DS_GetProtocolFRC_2014();
+    protocols [1] = DS_GetProtocolFRC_2015();
+    protocols [2] = DS_GetProtocolFRC_2016();
+    protocols [3] = DS_GetProtocolFRC_2020();
+    initialized = 1;
+}
+
+/**
+ * Gives the \a size bytes of \a data to the given \a decoder of the given
+ * \a protocol. The data is not copied, so that reads past the end of the
+ * packet are detected by the sanitizers.
+ */
+static void decode (const DS_Protocol* protocol, const int decoder,
+                    const uint8_t* data, const size_t size)
+{
+    DS_Event event;
+    DS_String packet;
+
+    packet.buf = (char*) data;
+    packet.len = size;
+    packet.cap = 0;
+
+    if (decoder == DECODER_ROBOT)
+        sink += protocol->read_robot_packet (&packet);
+    else if (decoder == DECODER_FMS)
+        sink += protocol->read_fms_packet (&packet);
+    else if (protocol->read_robot_stream)
+        sink += protocol->read_robot_stream (&packet);
+
+    /* Discard events generated by the decoders */
+    while (DS_PollEvent (&event));
+}
+
+/**
+ * Entry point of libFuzzer (and of the AFL/replay mode), the first byte
+ * selects the decoder and the rest of the input is the packet
+ */
+int LLVMFuzzerTestOneInput (const uint8_t* data, size_t size)
+{
+    init();
+
+    if (size < 1)
+        return 0;
+
+    int selector = data [0] % (PROTOCOL_COUNT * DECODER_COUNT);
+    decode (&protocols [selector / DECODER_COUNT], selector % DECODER_COUNT,
+            data + 1, size - 1);
+
+    return 0;
+}
+
+/**
+ * Decodes every received FMS and robot packet of the capture file at the
+ * given \a path with the protocol with the given \a name, until at least
+ * one second has elapsed, and prints the number of packets decoded per
+ * second
+ */
+static int throughput (const char* name, const char* path)
+{
+    int i;
+    size_t count = 0;
+    size_t decoded = 0;
+    DS_CaptureFile file;
+    DS_CaptureRecord record;
+    DS_CaptureRecord* records;
+    const DS_Protocol* protocol = NULL;
+
+    /* Get the protocol */
+    init();
+    for (i = 0; i < PROTOCOL_COUNT; ++i) {
+        if (strcmp (name, protocol_names [i]) == 0)
+            protocol = &protocols [i];
+    }
+
+    if (!protocol) {
+        fprintf (stderr, "Unknown protocol: %s\n", name);
+        return EXIT_FAILURE;
+    }
+
+    /* Load the capture */
+    if (!DS_CaptureLoad (&file, path)) {
+        fprintf (stderr, "Cannot load capture: %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    /* Collect the received FMS and robot packets (views of the file data) */
+    records = (DS_CaptureRecord*) calloc (file.size, sizeof (DS_CaptureRecord));
+    while (records && DS_CaptureRead (&file, &record)) {
+        if (record.received && (record.channel == DS_CAPTURE_FMS ||
+                                record.channel == DS_CAPTURE_ROBOT))
+            records [count++] = record;
+    }
+
+    if (count == 0) {
+        fprintf (stderr, "No received FMS or robot packets in: %s\n", path);
+        DS_CaptureFree (&file);
+        free (records);
+        return EXIT_FAILURE;
+    }
+
+    /* Decode the packets in a loop (the robot state is reset on each pass) */
+    uint64_t start = DS_GetTimeUs();
+    uint64_t elapsed = 0;
+    while (elapsed < MIN_DURATION_US) {
+        protocol->reset_robot();
+
+        for (i = 0; i < (int) count; ++i)
+            decode (protocol, records [i].channel == DS_CAPTURE_ROBOT ?
+                              DECODER_ROBOT : DECODER_FMS,
+                    (const uint8_t*) records [i].data.buf,
+                    records [i].data.len);
+
+        decoded += count;
+        elapsed = DS_GetTimeUs() - start;
+    }
+
+    /* Print results */
+    printf ("FRC %s: %lu packets in %.2f s, %.0f packets/s (%.1f ns/packet)\n",
+            name, (unsigned long) decoded, elapsed / 1e6,
+            decoded / (elapsed / 1e6), elapsed * 1e3 / decoded);
+
+    DS_CaptureFree (&file);
+    free (records);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Reads the whole contents of the given \a stream into an exactly-sized
+ * buffer and decodes it
+ */
+static void decode_stream (FILE* stream)
+{
+    size_t size = 0;
+    size_t capacity = 4096;
+    uint8_t* buffer = (uint8_t*) malloc (capacity);
+
+    while (buffer) {
+        size += fread (buffer + size, 1, capacity - size, stream);
+        if (size < capacity)
+            break;
+
+        capacity *= 2;
+        uint8_t* grown = (uint8_t*) realloc (buffer, capacity);
+        if (!grown)
+            free (buffer);
+
+        buffer = grown;
+    }
+
+    if (buffer) {
+        uint8_t* input = (uint8_t*) malloc (size > 0 ? size : 1);
+        if (input) {
+            memcpy (input, buffer, size);
+            LLVMFuzzerTestOneInput (input, size);
+            free (input);
+        }
+
+        free (buffer);
+    }
+}
+
+#if !defined LIBDS_LIBFUZZER
+
+/**
+ * Main entry point of the application (not used with libFuzzer)
+ */
+int main (int argc, char** argv)
+{
+    int i;
+
+    /* Throughput mode */
+    if (argc == 4 && strcmp (argv [1], "--throughput") == 0)
+        return throughput (argv [2], argv [3]);
+
+    /* Decode the standard input */
+    if (argc < 2)
+        decode_stream (stdin);
+
+    /* Decode the given files */
+    for (i = 1; i < argc; ++i) {
+        FILE* file = fopen (argv [i], "rb");
+        if (!file) {
+            fprintf (stderr, "Cannot open file: %s\n", argv [i]);
+            return EXIT_FAILURE;
+        }
+
+        decode_stream (file);
+        fclose (file);
+    }
+
+    DS_Close();
+    return EXIT_SUCCESS;
+}
+
+#endif
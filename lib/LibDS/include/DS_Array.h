@@ -31,15 +31,36 @@ extern "C" {
 #include <stdint.h>
 #include <stdlib.h>
 
+/**
+ * A dynamic array of fixed-size items, which are stored by value in a single
+ * contiguous block. The storage grows geometrically (doubling its size), so
+ * inserting items has an amortized constant cost, and it is only released by
+ * \c DS_ArrayFree(), clearing the array keeps it for the next items.
+ *
+ * An array can start with storage provided by its owner (e.g. a member of
+ * the owner structure), which is used until more items are inserted than it
+ * can hold, so small arrays are never allocated:
+ *
+ *     DS_JoystickState storage [6];
+ *     DS_ArrayInitInline (&array, storage, 6, sizeof (DS_JoystickState));
+ */
 typedef struct _array {
-    size_t used;
-    size_t size;
-    void** data;
+    size_t used;        /**< Number of items in the array */
+    size_t size;        /**< Number of items that fit in the storage */
+    size_t item_size;   /**< Size of each item (in bytes) */
+    void* data;         /**< Storage of the items */
+    void* inline_data;  /**< Storage provided by the owner (can be NULL) */
+    size_t inline_size; /**< Number of items that fit in the owner storage */
 } DS_Array;
 
 extern void DS_ArrayFree (DS_Array* array);
-extern void DS_ArrayInsert (DS_Array* array, void* element);
-extern void DS_ArrayInit (DS_Array* array, size_t initial_size);
+extern void DS_ArrayClear (DS_Array* array);
+extern int DS_ArrayReserve (DS_Array* array, size_t count);
+extern void* DS_ArrayAt (const DS_Array* array, size_t index);
+extern void* DS_ArrayInsert (DS_Array* array, const void* item);
+extern void DS_ArrayInit (DS_Array* array, size_t initial_size, size_t item_size);
+extern void DS_ArrayInitInline (DS_Array* array, void* storage, size_t storage_size,
+                                size_t item_size);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,191 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_ATOMIC_H
+#define _LIB_DS_ATOMIC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Minimal set of atomic operations on size_t values, used by the lock-free
+ * queues of the library (and by the high-water marks of the internal
+ * statistics), and on 64-bit counters (which are written by a single thread
+ * and read by any thread)
+ */
+#if defined _MSC_VER
+#include <intrin.h>
+
+#if defined _WIN64
+    #define DS_INTERLOCKED_CAS(p,d,e) \
+        (size_t) _InterlockedCompareExchange64 ((volatile __int64*) (p), (__int64) (d), (__int64) (e))
+    #define DS_INTERLOCKED_ADD(p,v) \
+        (size_t) _InterlockedExchangeAdd64 ((volatile __int64*) (p), (__int64) (v))
+#else
+    #define DS_INTERLOCKED_CAS(p,d,e) \
+        (size_t) _InterlockedCompareExchange ((volatile long*) (p), (long) (d), (long) (e))
+    #define DS_INTERLOCKED_ADD(p,v) \
+        (size_t) _InterlockedExchangeAdd ((volatile long*) (p), (long) (v))
+#endif
+
+/* x86/x64 loads and stores already have acquire/release semantics */
+static __inline size_t DS_AtomicLoad (const volatile size_t* ptr)
+{
+    size_t value = *ptr;
+    _ReadWriteBarrier();
+    return value;
+}
+
+static __inline void DS_AtomicStore (volatile size_t* ptr, size_t value)
+{
+    _ReadWriteBarrier();
+    *ptr = value;
+}
+
+static __inline int DS_AtomicCAS (volatile size_t* ptr, size_t expected, size_t desired)
+{
+    return DS_INTERLOCKED_CAS (ptr, desired, expected) == expected;
+}
+
+static __inline size_t DS_AtomicFetchAdd (volatile size_t* ptr, size_t value)
+{
+    return DS_INTERLOCKED_ADD (ptr, value);
+}
+
+static __inline void DS_AtomicAcquireFence (void)
+{
+    _ReadWriteBarrier();
+}
+
+static __inline void DS_AtomicMax (volatile size_t* ptr, size_t value)
+{
+    size_t current = DS_AtomicLoad (ptr);
+    while (value > current && !DS_AtomicCAS (ptr, current, value))
+        current = DS_AtomicLoad (ptr);
+}
+
+static __inline uint64_t DS_AtomicLoad64 (const volatile uint64_t* ptr)
+{
+    return (uint64_t) _InterlockedCompareExchange64 ((volatile __int64*) ptr, 0, 0);
+}
+
+static __inline void DS_AtomicStore64 (volatile uint64_t* ptr, uint64_t value)
+{
+    uint64_t current = DS_AtomicLoad64 (ptr);
+    uint64_t previous;
+
+    while ((previous = (uint64_t) _InterlockedCompareExchange64 (
+                           (volatile __int64*) ptr, (__int64) value,
+                           (__int64) current)) != current)
+        current = previous;
+}
+
+static __inline void DS_AtomicAdd64 (volatile uint64_t* ptr, uint64_t value)
+{
+    uint64_t current = DS_AtomicLoad64 (ptr);
+    uint64_t previous;
+
+    while ((previous = (uint64_t) _InterlockedCompareExchange64 (
+                           (volatile __int64*) ptr, (__int64) (current + value),
+                           (__int64) current)) != current)
+        current = previous;
+}
+
+/* Hint to the CPU that the thread is spinning */
+static __inline void DS_CpuRelax (void)
+{
+#if defined _M_ARM || defined _M_ARM64
+    __yield();
+#else
+    _mm_pause();
+#endif
+}
+#else
+static inline size_t DS_AtomicLoad (const volatile size_t* ptr)
+{
+    return __atomic_load_n (ptr, __ATOMIC_ACQUIRE);
+}
+
+static inline void DS_AtomicStore (volatile size_t* ptr, size_t value)
+{
+    __atomic_store_n (ptr, value, __ATOMIC_RELEASE);
+}
+
+static inline int DS_AtomicCAS (volatile size_t* ptr, size_t expected, size_t desired)
+{
+    return __atomic_compare_exchange_n (ptr, &expected, desired, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static inline size_t DS_AtomicFetchAdd (volatile size_t* ptr, size_t value)
+{
+    return __atomic_fetch_add (ptr, value, __ATOMIC_ACQ_REL);
+}
+
+static inline void DS_AtomicAcquireFence (void)
+{
+    __atomic_thread_fence (__ATOMIC_ACQUIRE);
+}
+
+static inline void DS_AtomicMax (volatile size_t* ptr, size_t value)
+{
+    size_t current = DS_AtomicLoad (ptr);
+    while (value > current && !DS_AtomicCAS (ptr, current, value))
+        current = DS_AtomicLoad (ptr);
+}
+
+static inline uint64_t DS_AtomicLoad64 (const volatile uint64_t* ptr)
+{
+    return __atomic_load_n (ptr, __ATOMIC_RELAXED);
+}
+
+static inline void DS_AtomicStore64 (volatile uint64_t* ptr, uint64_t value)
+{
+    __atomic_store_n (ptr, value, __ATOMIC_RELAXED);
+}
+
+static inline void DS_AtomicAdd64 (volatile uint64_t* ptr, uint64_t value)
+{
+    __atomic_fetch_add (ptr, value, __ATOMIC_RELAXED);
+}
+
+/* Hint to the CPU that the thread is spinning */
+static inline void DS_CpuRelax (void)
+{
+#if defined __i386__ || defined __x86_64__
+    __builtin_ia32_pause();
+#elif defined __aarch64__ || defined __arm__
+    __asm__ __volatile__ ("yield");
+#endif
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_BANDWIDTH_H
+#define _LIB_DS_BANDWIDTH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "DS_Protocol.h"
+
+/*
+ * The bandwidth is sampled every DS_BANDWIDTH_INTERVAL msecs, the rates are
+ * computed over the last second and over the last 10 seconds of samples
+ */
+#define DS_BANDWIDTH_INTERVAL 250
+#define DS_BANDWIDTH_SHORT    1000
+#define DS_BANDWIDTH_LONG     10000
+
+/*
+ * Default budget (in Mbit/s) and the usage percentages at which the budget
+ * warning is raised and cleared
+ */
+#define DS_BANDWIDTH_DEFAULT_BUDGET 4.0
+#define DS_BANDWIDTH_WARN_PERCENT   80
+#define DS_BANDWIDTH_CLEAR_PERCENT  70
+
+/**
+ * Sockets of the loaded protocol whose bandwidth is measured
+ */
+typedef enum {
+    DS_BANDWIDTH_FMS,
+    DS_BANDWIDTH_RADIO,
+    DS_BANDWIDTH_ROBOT,
+    DS_BANDWIDTH_ROBOT_STREAM,
+    DS_BANDWIDTH_NETCONSOLE,
+    DS_BANDWIDTH_SOCKET_COUNT,
+} DS_BandwidthSocket;
+
+/**
+ * Byte rates (in bytes per second) over the last second and over the last
+ * 10 seconds, only the payload of the packets is counted
+ */
+typedef struct _bandwidth {
+    double sent_short;     /**< Sent bytes per second (last second) */
+    double received_short; /**< Received bytes per second (last second) */
+    double sent_long;      /**< Sent bytes per second (last 10 seconds) */
+    double received_long;  /**< Received bytes per second (last 10 seconds) */
+} DS_Bandwidth;
+
+extern void Bandwidth_Reset (void);
+extern int Bandwidth_Remaining (void);
+extern void Bandwidth_Update (DS_Protocol* protocol);
+
+extern DS_Bandwidth DS_GetSocketBandwidth (const DS_BandwidthSocket socket);
+extern DS_Bandwidth DS_GetTotalBandwidth (void);
+extern int DS_GetHostBandwidth (DS_Bandwidth* bandwidth);
+
+extern double DS_GetBandwidthBudget (void);
+extern void DS_SetBandwidthBudget (const double mbps);
+extern int DS_GetBandwidthUsage (void);
+extern int DS_BandwidthWarning (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
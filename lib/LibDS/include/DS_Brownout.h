@@ -0,0 +1,86 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_BROWNOUT_H
+#define _LIB_DS_BROWNOUT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/*
+ * Default brownout threshold of the roboRIO (in volts), the margin (in
+ * volts) above the threshold at which the warning is raised, and the time
+ * (in msecs) within which a predicted brownout raises the warning
+ */
+#define DS_BROWNOUT_THRESHOLD 6.8f
+#define DS_BROWNOUT_MARGIN    0.7f
+#define DS_BROWNOUT_HORIZON   500
+
+/*
+ * Number of voltage samples kept in the history (about 5 seconds of robot
+ * packets) and time constants (in msecs) of the voltage statistics
+ */
+#define DS_VOLTAGE_HISTORY    256
+#define DS_VOLTAGE_FAST_TAU   100
+#define DS_VOLTAGE_SLOW_TAU   5000
+#define DS_VOLTAGE_SLOPE_TAU  250
+
+/**
+ * A voltage reported by the robot
+ */
+typedef struct _voltage_sample {
+    uint64_t time; /**< Time (in msecs) at which the voltage was received */
+    float voltage; /**< The voltage of the robot */
+} DS_VoltageSample;
+
+/**
+ * Trend of the robot voltage, updated with every robot packet
+ */
+typedef struct _voltage_stats {
+    int samples;          /**< Number of samples since the robot connected */
+    float voltage;        /**< Filtered voltage (over about 100 msecs) */
+    float resting;        /**< Average voltage (over about 5 seconds) */
+    float sag;            /**< Drop of the filtered voltage below the average */
+    float slope;          /**< Trend of the voltage (in volts per second) */
+    float minimum;        /**< Lowest voltage in the history */
+    int time_to_brownout; /**< Predicted msecs until brownout, -1 if stable */
+    int warning;          /**< Set to \c 1 if a brownout is approaching */
+} DS_VoltageStats;
+
+extern void Brownout_Reset (void);
+extern void Brownout_AddSample (const float voltage);
+
+extern int DS_BrownoutWarning (void);
+extern float DS_GetBrownoutThreshold (void);
+extern void DS_SetBrownoutThreshold (const float volts);
+extern void DS_GetVoltageStats (DS_VoltageStats* stats);
+extern int DS_GetVoltageHistory (DS_VoltageSample* samples, const int max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
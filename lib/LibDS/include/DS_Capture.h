@@ -0,0 +1,119 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_CAPTURE_H
+#define _LIB_DS_CAPTURE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "DS_String.h"
+
+/*
+ * Capture file format (all integers are little-endian):
+ *
+ *   Header:  "DSCP", u8 version, 1 reserved byte, u16 team number,
+ *            u64 wall clock time of the start of the capture (usecs since
+ *            the UNIX epoch),
+ *            (u16 local port, u16 remote port) per channel
+ *
+ *   Record:  u8 type (channel in the lower 7 bits, the highest bit is set
+ *            for received datagrams), varint time (usecs since the previous
+ *            record), varint length, data, u32 CRC32 of the record
+ *
+ * Varints are unsigned LEB128 values. Records are appended while the capture
+ * runs, so a capture interrupted by a crash can still be read up to its last
+ * complete record. Version 1 captures have a 16 byte header, without the
+ * team number and the ports.
+ */
+#define DS_CAPTURE_MAGIC       "DSCP"
+#define DS_CAPTURE_VERSION     2
+#define DS_CAPTURE_HEADER_SIZE 32
+#define DS_CAPTURE_RECEIVED    0x80
+
+/**
+ * Network channels of a DS context
+ */
+typedef enum {
+    DS_CAPTURE_FMS,
+    DS_CAPTURE_RADIO,
+    DS_CAPTURE_ROBOT,
+    DS_CAPTURE_NETCONSOLE,
+    DS_CAPTURE_CHANNEL_COUNT,
+} DS_CaptureChannel;
+
+/**
+ * A datagram read from a capture file
+ */
+typedef struct {
+    DS_CaptureChannel channel; /**< Channel of the datagram */
+    int received;              /**< \c 1 if received, \c 0 if sent */
+    uint64_t time;             /**< Time (in usecs) since the capture start */
+    DS_String data;            /**< View of the datagram (in the file data) */
+} DS_CaptureRecord;
+
+/**
+ * A capture file loaded in memory, the records are read sequentially
+ */
+typedef struct {
+    uint8_t* data;       /**< Contents of the file */
+    size_t size;         /**< Size of the file */
+    size_t offset;       /**< Offset of the next record */
+    uint64_t time;       /**< Time (in usecs) of the last read record */
+    uint64_t start_time; /**< Wall clock time (in usecs) of the start */
+    int team;            /**< Team number at the start of the capture */
+    int local_ports [DS_CAPTURE_CHANNEL_COUNT];  /**< DS port of each channel */
+    int remote_ports [DS_CAPTURE_CHANNEL_COUNT]; /**< Device port of each channel */
+} DS_CaptureFile;
+
+extern void Capture_Close (void);
+extern void Capture_Record (const DS_CaptureChannel channel,
+                            const int received,
+                            const DS_String* data);
+extern int Replay_Running (void);
+extern int Replay_Remaining (void);
+extern int Replay_Next (DS_CaptureRecord* record);
+
+extern int DS_StartCapture (const char* path);
+extern void DS_StopCapture (void);
+extern int DS_CaptureActive (void);
+
+extern int DS_StartReplay (const char* path, const double speed);
+extern void DS_StopReplay (void);
+extern int DS_ReplayActive (void);
+
+extern int DS_CaptureLoad (DS_CaptureFile* file, const char* path);
+extern int DS_CaptureRead (DS_CaptureFile* file, DS_CaptureRecord* record);
+extern void DS_CaptureFree (DS_CaptureFile* file);
+
+extern int DS_CaptureExportPcapng (const char* capture, const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -33,6 +33,9 @@ extern "C" {
 /* Init/Close functions */
 extern void Client_Init (void);
 extern void Client_Close (void);
+extern void Client_ApplyCommands (void);
+extern void Client_KnownRobotAddressFailed (void);
+extern void Client_RobotAddressConfirmed (void);
 
 /* User-set addresses */
 extern char* DS_GetCustomFMSAddress (void);
@@ -49,8 +52,14 @@ extern char* DS_GetAppliedFMSAddress (void);
 extern char* DS_GetAppliedRadioAddress (void);
 extern char* DS_GetAppliedRobotAddress (void);
 
+/* Last known robot address (probed on startup) and address in use */
+extern char* DS_GetKnownRobotAddress (void);
+extern char* DS_GetRobotEndpoint (void);
+
 /* Status string */
+extern DS_Status DS_GetStatus (void);
 extern char* DS_GetStatusString (void);
+extern const char* DS_GetStatusName (const DS_Status status);
 
 /* Getters */
 extern int DS_GetTeamNumber (void);
@@ -66,11 +75,16 @@ extern DS_Position DS_GetPosition (void);
 extern int DS_GetEmergencyStopped (void);
 extern int DS_GetFMSCommunications (void);
 extern int DS_GetRadioCommunications (void);
+extern int DS_GetRadioOnlyCommunications (void);
 extern int DS_GetRobotCommunications (void);
 extern int DS_GetRobotCANUtilization (void);
 extern DS_ControlMode DS_GetControlMode (void);
 extern float DS_GetMaximumBatteryVoltage (void);
 
+/* Match state reported by the FMS */
+extern void DS_GetFMSMatch (DS_FMSMatch* match);
+extern int DS_GetMatchTimeRemaining (void);
+
 /* Setters */
 extern void DS_RebootRobot (void);
 extern void DS_RestartRobotCode (void);
@@ -83,8 +97,20 @@ extern void DS_SetControlMode (const DS_ControlMode mode);
 extern void DS_SetCustomFMSAddress (const char* address);
 extern void DS_SetCustomRadioAddress (const char* address);
 extern void DS_SetCustomRobotAddress (const char* address);
+extern void DS_SetKnownRobotAddress (const char* address);
 extern void DS_SendNetConsoleMessage (const char* message);
 
+/* Configuration transactions (addresses are re-applied once, on commit) */
+extern void DS_BeginConfiguration (void);
+extern void DS_CommitConfiguration (void);
+extern void DS_CancelConfiguration (void);
+extern int DS_ConfigurationPending (void);
+
+/* Match information (sent to the robot by the protocols that support it) */
+extern void DS_SetGameSpecificMessage (const char* message);
+extern void DS_SetMatchInfo (const char* event, const DS_MatchType type,
+                             const int number, const int replay);
+
 #ifdef __cplusplus
 }
 #endif
@@ -28,6 +28,7 @@
 
 #include "DS_Types.h"
 #include "DS_Socket.h"
+#include "DS_NetConsole.h"
 
 /*
  * WARNING:
@@ -46,14 +47,78 @@ extern "C" {
 #define RECONFIGURE_ROBOT 0x04
 #define RECONFIGURE_ALL   0x01 | 0x02 | 0x04
 
+/*
+ * Maximum length (including the terminator) of the event name and of the
+ * game-specific message
+ */
+#define CFG_MAX_EVENT_NAME_LEN 64
+#define CFG_MAX_GAME_DATA_LEN  64
+
+/**
+ * Holds a consistent copy of the state of the LibDS, obtained with
+ * \c CFG_GetState()
+ */
+typedef struct _cfg_state {
+    int team;                     /**< The team number */
+    int robot_code;               /**< Set to \c 1 if robot code is running */
+    int robot_enabled;            /**< Set to \c 1 if the robot is enabled */
+    int cpu_usage;                /**< The CPU usage of the robot */
+    int ram_usage;                /**< The RAM usage of the robot */
+    int disk_usage;               /**< The disk usage of the robot */
+    int can_utilization;          /**< The CAN utilization of the robot */
+    float robot_voltage;          /**< The voltage of the robot */
+    int emergency_stopped;        /**< Set to \c 1 if the robot is e-stopped */
+    int fms_communications;       /**< Set to \c 1 if the FMS is connected */
+    int radio_communications;     /**< Set to \c 1 if the radio is connected */
+    int robot_communications;     /**< Set to \c 1 if the robot is connected */
+    DS_Position position;         /**< The team position */
+    DS_Alliance alliance;         /**< The team alliance */
+    DS_ControlMode control_mode;  /**< The control mode of the robot */
+} CFG_State;
+
+/**
+ * Holds a copy of the information about the current match, obtained with
+ * \c CFG_GetMatchInfo()
+ */
+typedef struct _cfg_match_info {
+    size_t version;                             /**< Changes with the info */
+    char event_name [CFG_MAX_EVENT_NAME_LEN];   /**< Name of the event */
+    DS_MatchType match_type;                    /**< Type of the match */
+    int match_number;                           /**< Number of the match */
+    int replay_number;                          /**< Replay of the match */
+    char game_data [CFG_MAX_GAME_DATA_LEN];     /**< Game-specific message */
+} CFG_MatchInfo;
+
+/**
+ * Notifications without variable text, their messages and severities are
+ * constant (see \c CFG_AddStaticNotification())
+ */
+typedef enum {
+    CFG_NOTIFY_REBOOTING_ROBOT,
+    CFG_NOTIFY_RESTARTING_CODE,
+    CFG_NOTIFY_THREAD_SCHEDULING,
+    CFG_NOTIFY_CAPTURE_WRITE_FAILED,
+    CFG_NOTIFY_REPLAY_FINISHED,
+    CFG_NOTIFY_MACRO_FINISHED,
+    CFG_NOTIFY_BANDWIDTH_RECOVERED,
+    CFG_NOTIFICATION_COUNT,
+} CFG_Notification;
+
 /* Misc */
 extern void CFG_ReconfigureAddresses (const int flags);
 
 /* NetConsole ouput */
 extern void CFG_AddNotification (const DS_String* msg);
+extern void CFG_AddStaticNotification (const CFG_Notification notification);
 extern void CFG_AddNetConsoleMessage (const DS_String* msg);
+extern void CFG_AddNetConsoleEntry (const DS_NetConsoleSource source,
+                                    const DS_NetConsoleSeverity severity,
+                                    const DS_String* msg);
 
 /* Getters */
+extern void CFG_GetState (CFG_State* snapshot);
+extern void CFG_GetMatchInfo (CFG_MatchInfo* info);
+extern void CFG_GetFMSMatch (DS_FMSMatch* match);
 extern int CFG_GetTeamNumber (void);
 extern int CFG_GetRobotCode (void);
 extern int CFG_GetRobotEnabled (void);
@@ -86,6 +151,10 @@ extern void CFG_SetControlMode (const DS_ControlMode mode);
 extern void CFG_SetFMSCommunications (const int communications);
 extern void CFG_SetRadioCommunications (const int communications);
 extern void CFG_SetRobotCommunications (const int communications);
+extern void CFG_SetGameData (const char* data);
+extern void CFG_SetFMSMatch (const DS_FMSMatch* match);
+extern void CFG_SetMatchInfo (const char* event, const DS_MatchType type,
+                              const int number, const int replay);
 
 /* Watchdog functions */
 extern void CFG_FMSWatchdogExpired (void);
@@ -0,0 +1,88 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_CONTEXT_H
+#define _LIB_DS_CONTEXT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+/**
+ * A driver station instance. Each context owns the state of the modules
+ * (configuration, events, joysticks, NetConsole, protocol and sockets), so
+ * several driver stations can run in the same process. The timer and socket
+ * threads are shared by all contexts.
+ */
+typedef struct _ds_context DS_Context;
+
+/*
+ * Modules that store their state in a context
+ */
+typedef enum {
+    DS_CONTEXT_INIT,
+    DS_CONTEXT_CONFIG,
+    DS_CONTEXT_CLIENT,
+    DS_CONTEXT_EVENTS,
+    DS_CONTEXT_JOYSTICKS,
+    DS_CONTEXT_NETCONSOLE,
+    DS_CONTEXT_PROTOCOLS,
+    DS_CONTEXT_FRC_2014,
+    DS_CONTEXT_FRC_2015,
+    DS_CONTEXT_FRC_2016,
+    DS_CONTEXT_FRC_2020,
+    DS_CONTEXT_CAPTURE,
+    DS_CONTEXT_TELEMETRY,
+    DS_CONTEXT_METRICS,
+    DS_CONTEXT_BANDWIDTH,
+    DS_CONTEXT_BROWNOUT,
+    DS_CONTEXT_MACRO,
+    DS_CONTEXT_DASHBOARD,
+    DS_CONTEXT_HISTORY,
+    DS_CONTEXT_LIFECYCLE,
+    DS_CONTEXT_MATCH,
+    DS_CONTEXT_EVDEV,
+    DS_CONTEXT_MESSAGES,
+    DS_CONTEXT_MODULE_COUNT,
+} DS_ContextModule;
+
+/* Context management */
+extern DS_Context* DS_ContextNew (void);
+extern void DS_ContextFree (DS_Context* context);
+extern DS_Context* DS_ContextDefault (void);
+extern DS_Context* DS_ContextCurrent (void);
+extern void DS_ContextMakeCurrent (DS_Context* context);
+
+/* Used by the modules to obtain their state */
+extern void* DS_ContextData (const DS_ContextModule module,
+                             const size_t size,
+                             void (*init) (void*),
+                             void (*destroy) (void*));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
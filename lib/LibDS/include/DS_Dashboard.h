@@ -0,0 +1,113 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_DASHBOARD_H
+#define _LIB_DS_DASHBOARD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/*
+ * Dashboard protocol:
+ *
+ * The DS connects to the dashboard server of the robot (a TCP socket on
+ * DS_DASHBOARD_PORT by default) through the socket reactor. Each message
+ * (framed by the sockets module, see DS_Socket.h) holds one or more entries:
+ *
+ *   Entry:   u8 type, u8 key length, key (UTF-8), value
+ *
+ *   Values:  DS_DASHBOARD_DELETED: none
+ *            DS_DASHBOARD_BOOLEAN: u8 (0 or 1)
+ *            DS_DASHBOARD_NUMBER:  IEEE 754 double (big-endian)
+ *            DS_DASHBOARD_STRING:  u16 length (big-endian), UTF-8 text
+ *
+ * Both sides send the same entries. When the connection is established, the
+ * server sends all its entries and the DS sends the entries set by the
+ * application, afterwards each side only sends the entries that change.
+ */
+#define DS_DASHBOARD_PORT 5800
+
+/*
+ * Maximum number of entries, maximum size (including the terminator) of a
+ * key and of a string value, longer keys and strings are truncated. Embedded
+ * builds define smaller values (see LibDS.pri).
+ */
+#ifndef DS_DASHBOARD_MAX_ENTRIES
+    #define DS_DASHBOARD_MAX_ENTRIES 256
+#endif
+#ifndef DS_DASHBOARD_KEY_SIZE
+    #define DS_DASHBOARD_KEY_SIZE    64
+#endif
+#ifndef DS_DASHBOARD_TEXT_SIZE
+    #define DS_DASHBOARD_TEXT_SIZE   256
+#endif
+
+/**
+ * Type of a dashboard entry
+ */
+typedef enum {
+    DS_DASHBOARD_DELETED = 0x00,
+    DS_DASHBOARD_BOOLEAN = 0x01,
+    DS_DASHBOARD_NUMBER  = 0x02,
+    DS_DASHBOARD_STRING  = 0x03,
+} DS_DashboardType;
+
+/**
+ * A dashboard entry obtained with \c DS_DashboardRead()
+ */
+typedef struct {
+    uint64_t sequence;                 /**< Change number of the entry */
+    DS_DashboardType type;             /**< Type of the value */
+    double number;                     /**< Value of numbers and booleans */
+    char key [DS_DASHBOARD_KEY_SIZE];  /**< Null-terminated key */
+    char text [DS_DASHBOARD_TEXT_SIZE]; /**< Value of strings */
+} DS_DashboardEntry;
+
+/* Internal functions */
+extern void Dashboard_Close (void);
+extern void Dashboard_Update (void);
+extern void Dashboard_ChangeAddress (const char* address);
+
+/* Connection */
+extern int DS_StartDashboard (const int port);
+extern void DS_StopDashboard (void);
+extern int DS_DashboardRunning (void);
+extern int DS_DashboardConnected (void);
+
+/* Entries */
+extern int DS_DashboardRead (uint64_t* cursor,
+                             DS_DashboardEntry* entries,
+                             const int max_entries);
+extern int DS_DashboardSetBoolean (const char* key, const int value);
+extern int DS_DashboardSetNumber (const char* key, const double value);
+extern int DS_DashboardSetString (const char* key, const char* value);
+extern int DS_DashboardDelete (const char* key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
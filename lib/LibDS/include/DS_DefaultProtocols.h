@@ -33,6 +33,20 @@ extern "C" {
 extern DS_Protocol DS_GetProtocolFRC_2014 (void);
 extern DS_Protocol DS_GetProtocolFRC_2015 (void);
 extern DS_Protocol DS_GetProtocolFRC_2016 (void);
+extern DS_Protocol DS_GetProtocolFRC_2020 (void);
+
+/*
+ * Packet functions of the FRC 2015 protocol (also used by the 2016 and 2020
+ * protocols), which are called directly by the event loop when LibDS is built
+ * with DS_STATIC_FRC_2015
+ */
+#if defined DS_STATIC_FRC_2015
+extern int DS_FRC2015_Matches (const DS_Protocol* protocol);
+extern void DS_FRC2015_WriteFMSPacket (DS_Packet* packet);
+extern void DS_FRC2015_WriteRobotPacket (DS_Packet* packet);
+extern int DS_FRC2015_ReadFMSPacket (const DS_String* data);
+extern int DS_FRC2015_ReadRobotPacket (const DS_String* data);
+#endif
 
 #ifdef __cplusplus
 }
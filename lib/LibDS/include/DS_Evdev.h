@@ -0,0 +1,86 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_EVDEV_H
+#define _LIB_DS_EVDEV_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Linux input backend:
+ *
+ * The joysticks and gamepads of /dev/input/event* are read directly (without
+ * SDL) by the socket reactor, which wakes up as soon as the kernel has new
+ * input. Each input report (the events up to a SYN_REPORT) is written to the
+ * joysticks of the DS context with a single DS_SetJoystickState() call.
+ *
+ * While the backend is running, it owns the joysticks of its DS context:
+ * the joysticks are registered again (in the order in which the devices were
+ * found) when a device is attached or removed. New devices are found with
+ * inotify, so the application needs read access to the device nodes.
+ *
+ * The kernel stamps each event with CLOCK_MONOTONIC, the stamps are used to
+ * measure the time between the input and its delivery to the DS.
+ *
+ * On other operating systems the backend cannot be started.
+ */
+
+/*
+ * Maximum size (including the terminator) of a device name
+ */
+#define DS_EVDEV_NAME_SIZE 64
+
+/**
+ * Statistics of the evdev backend
+ */
+typedef struct {
+    int devices;           /**< Devices that are being read */
+    uint64_t reports;      /**< Input reports written to the joysticks */
+    uint64_t overflows;    /**< Reports lost because the kernel buffer was full */
+    uint64_t delay_max_us; /**< Longest time between an input and its delivery */
+    uint64_t delay_avg_us; /**< Average time between an input and its delivery */
+} DS_EvdevStats;
+
+/* Internal functions */
+extern void Evdev_Close (void);
+
+/* Backend control */
+extern int DS_EvdevStart (void);
+extern void DS_EvdevStop (void);
+extern int DS_EvdevRunning (void);
+
+/* Devices and statistics */
+extern int DS_EvdevGetName (const int joystick, char* name, const size_t size);
+extern void DS_EvdevGetStats (DS_EvdevStats* stats);
+extern void DS_EvdevResetStats (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
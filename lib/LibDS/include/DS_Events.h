@@ -30,6 +30,7 @@ extern "C" {
 
 #include <stdint.h>
 #include "DS_Types.h"
+#include "DS_Stats.h"
 
 /**
  * \brief The types of events that can be delivered.
@@ -54,21 +55,97 @@ typedef enum {
     DS_ROBOT_STATION_CHANGED    = 0x16,
     DS_ROBOT_ESTOP_CHANGED      = 0x17,
     DS_STATUS_STRING_CHANGED    = 0x18,
+    DS_NETCONSOLE_NEW_LINES     = 0x19,
+    DS_FMS_MATCH_CHANGED        = 0x1a,
+    DS_ROBOT_BROWNOUT_WARNING   = 0x1b,
+    DS_DASHBOARD_CHANGED        = 0x1c,
+    DS_MATCH_FINISHED           = 0x1d,
 } DS_EventType;
 
+/*
+ * Number of event types and maximum number of queued events (must be a
+ * power of two)
+ */
+#define DS_EVENT_TYPE_COUNT 0x1e
+#ifndef DS_EVENT_QUEUE_SIZE
+    #define DS_EVENT_QUEUE_SIZE 256
+#endif
+
+/*
+ * Event type masks (used to select the events that are queued or delivered
+ * to a subscriber), there must be less than 32 event types
+ */
+#define DS_EVENT_MASK(type) ((uint32_t) 1 << (type))
+#define DS_EVENT_MASK_ALL   ((uint32_t) 0xffffffff)
+
+/*
+ * Maximum number of event subscribers of a context
+ */
+#ifndef DS_EVENT_SUBSCRIBERS
+    #define DS_EVENT_SUBSCRIBERS 16
+#endif
+
+/**
+ * \brief Waitable handle used to notify the application about new events
+ */
+#if defined _WIN32
+    typedef void* DS_EventHandle;
+#else
+    typedef int DS_EventHandle;
+#endif
+
+/**
+ * \brief How the events are delivered to a subscriber
+ */
+typedef enum {
+    DS_DELIVER_QUEUED,
+    DS_DELIVER_IMMEDIATE,
+} DS_EventDelivery;
+
+/**
+ * \brief What to do when the event queue is full
+ */
+typedef enum {
+    DS_EVENTS_DROP_OLDEST,
+    DS_EVENTS_COALESCE,
+} DS_EventOverflowPolicy;
+
+/**
+ * \brief Fields shared by all the events
+ *
+ * The time is obtained from the monotonic clock (see \c DS_GetTimeUs())
+ * when the event is registered with \c DS_AddEvent(), so it tells when the
+ * LibDS created the event and not when the application received it.
+ */
+typedef struct {
+    DS_EventType type;
+    uint64_t time;
+} DS_EventHeader;
+
 /**
  * \brief FMS event fields
  */
 typedef struct {
     DS_EventType type;
+    uint64_t time;
     int connected;
 } DS_FMSEvent;
 
+/**
+ * \brief FMS match event fields
+ */
+typedef struct {
+    DS_EventType type;
+    uint64_t time;
+    DS_FMSMatch match;
+} DS_FMSMatchEvent;
+
 /**
  * \brief Radio event fields
  */
 typedef struct {
     DS_EventType type;
+    uint64_t time;
     int connected;
 } DS_RadioEvent;
 
@@ -77,6 +154,7 @@ typedef struct {
  */
 typedef struct {
     DS_EventType type;
+    uint64_t time;
     int code;
     int enabled;
     int can_util;
@@ -89,19 +167,37 @@ typedef struct {
     DS_ControlMode mode;
 } DS_RobotEvent;
 
+/**
+ * \brief Brownout warning event fields
+ */
+typedef struct {
+    DS_EventType type;
+    uint64_t time;
+    int warning;
+    float voltage;
+    float slope;
+    int time_to_brownout;
+} DS_BrownoutEvent;
+
 /**
  * \brief Joystick event fields
  */
 typedef struct {
     DS_EventType type;
+    uint64_t time;
     int count;
 } DS_JoystickEvent;
 
 /**
  * \brief NetConsole event fields
+ *
+ * The message is owned by the LibDS and is valid until the next call to
+ * \c DS_PollEvent(). \c DS_NETCONSOLE_NEW_LINES events have no message,
+ * the new lines must be obtained with \c DS_NetConsoleRead()
  */
 typedef struct {
     DS_EventType type;
+    uint64_t time;
     char* message;
 } DS_NetConsoleEvent;
 
@@ -110,17 +206,40 @@ typedef struct {
  */
 typedef union {
     DS_EventType type;
+    DS_EventHeader header;
     DS_FMSEvent fms;
+    DS_FMSMatchEvent fms_match;
     DS_RobotEvent robot;
     DS_RadioEvent radio;
+    DS_BrownoutEvent brownout;
     DS_JoystickEvent joystick;
     DS_NetConsoleEvent netconsole;
 } DS_Event;
 
+/**
+ * \brief Function called with the events of a subscription
+ *
+ * The \a event (and its NetConsole message) is only valid during the call
+ */
+typedef void (*DS_EventCallback) (const DS_Event* event, void* data);
+
 extern void Events_Init (void);
 extern void Events_Close (void);
+extern void Events_ResetStats (void);
+extern void Events_GetStats (DS_EventQueueStats* stats);
 extern void DS_AddEvent (DS_Event* event);
 extern int DS_PollEvent (DS_Event* event);
+extern int DS_DispatchEvents (void);
+extern DS_EventHandle DS_GetEventHandle (void);
+extern int DS_EventWanted (const DS_EventType type);
+extern void DS_SetEventMask (const uint32_t mask);
+extern void DS_Unsubscribe (const int subscription);
+extern int DS_Subscribe (const uint32_t mask,
+                         DS_EventCallback callback,
+                         void* data,
+                         const DS_EventDelivery delivery);
+extern void DS_SetEventCoalescing (const int enabled);
+extern void DS_SetEventOverflowPolicy (const DS_EventOverflowPolicy overflow_policy);
 
 #ifdef __cplusplus
 }
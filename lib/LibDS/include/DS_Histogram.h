@@ -0,0 +1,62 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_HISTOGRAM_H
+#define _LIB_DS_HISTOGRAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/*
+ * Every power-of-two range is split in this many linear buckets, which
+ * gives a relative error of ~6% for any recorded value
+ */
+#define DS_HISTOGRAM_SUB_BUCKETS 16
+#define DS_HISTOGRAM_SIZE        (DS_HISTOGRAM_SUB_BUCKETS * 29)
+
+/**
+ * A fixed-size, log-linear (HDR-style) histogram of 32-bit values.
+ * Recording a value is O(1) and never allocates memory.
+ */
+typedef struct _histogram {
+    uint32_t total;                       /**< Number of recorded values */
+    uint32_t max;                         /**< Largest recorded value */
+    uint64_t sum;                         /**< Sum of the recorded values */
+    uint32_t counts [DS_HISTOGRAM_SIZE];  /**< Number of values per bucket */
+} DS_Histogram;
+
+extern void DS_HistogramReset (DS_Histogram* histogram);
+extern void DS_HistogramRecord (DS_Histogram* histogram, const uint32_t value);
+extern uint32_t DS_HistogramPercentile (const DS_Histogram* histogram,
+                                        const double percentile);
+extern uint32_t DS_HistogramCountBelow (const DS_Histogram* histogram,
+                                        const uint32_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
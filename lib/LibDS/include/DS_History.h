@@ -0,0 +1,73 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_HISTORY_H
+#define _LIB_DS_HISTORY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/*
+ * Resolution (in msecs) of the metric history and size (in bytes) of the
+ * history of each metric. Each sample is quantized to a byte and has an
+ * implicit timestamp, so the history holds one hour of continuous samples.
+ */
+#define DS_HISTORY_TICK 100
+#define DS_HISTORY_SIZE 36000
+
+/**
+ * The robot metrics that are kept in the history
+ */
+typedef enum {
+    DS_HISTORY_CPU_USAGE,       /**< The CPU usage of the robot */
+    DS_HISTORY_RAM_USAGE,       /**< The RAM usage of the robot */
+    DS_HISTORY_DISK_USAGE,      /**< The disk usage of the robot */
+    DS_HISTORY_CAN_UTILIZATION, /**< The CAN utilization of the robot */
+    DS_HISTORY_METRIC_COUNT,
+} DS_HistoryMetric;
+
+/**
+ * A sample of the metric history
+ */
+typedef struct _history_sample {
+    uint64_t time; /**< Time (in msecs, see \c DS_GetTimeMs) of the sample */
+    uint8_t value; /**< The value of the metric (from 0 to 100) */
+} DS_HistorySample;
+
+extern void History_AddSample (const DS_HistoryMetric metric, const int percent);
+
+extern void DS_ClearHistory (void);
+extern int DS_GetHistoryRange (const DS_HistoryMetric metric,
+                               uint64_t* first, uint64_t* last);
+extern int DS_GetHistory (const DS_HistoryMetric metric,
+                          const uint64_t from, const uint64_t to,
+                          DS_HistorySample* samples, const int max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
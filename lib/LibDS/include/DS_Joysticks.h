@@ -28,10 +28,75 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
+#include "DS_Stats.h"
+
+/*
+ * Fixed limits of a joystick snapshot, values beyond these limits are ignored
+ */
+#define DS_MAX_JOYSTICKS        8
+#define DS_MAX_JOYSTICK_AXES    16
+#define DS_MAX_JOYSTICK_HATS    4
+#define DS_MAX_JOYSTICK_BUTTONS 32
+
+/**
+ * Holds the state of a single joystick in a flat, contiguous structure
+ */
+typedef struct _joystick_state {
+    uint8_t num_axes;                    /**< The number of axes */
+    uint8_t num_hats;                    /**< The number of hats */
+    uint8_t num_buttons;                 /**< The number of buttons */
+    uint32_t buttons;                    /**< Button states, bit n is button n */
+    int16_t hats [DS_MAX_JOYSTICK_HATS]; /**< The hat angles */
+    float axes [DS_MAX_JOYSTICK_AXES];   /**< The axis values */
+} DS_JoystickState;
+
+/**
+ * Holds the state of all the registered joysticks
+ */
+typedef struct _joystick_snapshot {
+    int count;                                    /**< Number of joysticks */
+    unsigned int layout_version;                  /**< Changes when a joystick is added, replaced or removed */
+    unsigned int version;                         /**< Changes when the reported state changes, never 0 */
+    DS_JoystickState joysticks [DS_MAX_JOYSTICKS]; /**< Joystick states */
+} DS_JoystickSnapshot;
+
+/**
+ * Response curves that can be applied to a joystick axis
+ */
+typedef enum {
+    DS_AXIS_CURVE_LINEAR = 0, /**< The output is equal to the input */
+    DS_AXIS_CURVE_EXPO   = 1, /**< The output is |x|^(1 + gain), with the sign of x */
+    DS_AXIS_CURVE_CUBIC  = 2, /**< The output is (1 - gain) * x + gain * x^3 */
+} DS_AxisCurve;
+
+/**
+ * Holds the processing applied to a joystick axis before it is sent to the
+ * robot. The stages are applied in order (deadband, curve, low-pass filter
+ * and rate limiter), a zeroed structure disables all the stages.
+ */
+typedef struct _axis_filter {
+    float deadband;     /**< Inputs with a smaller magnitude are reported as 0 */
+    DS_AxisCurve curve; /**< The response curve applied after the deadband */
+    float curve_gain;   /**< Strength of the curve (from 0 to 1) */
+    float smoothing;    /**< Time constant (in seconds) of the low-pass filter */
+    float rate_limit;   /**< Maximum change of the output per second */
+} DS_AxisFilter;
+
+/**
+ * Function that is called before each joystick snapshot is taken, it can be
+ * used to read the joystick state from the input devices (with the
+ * \c DS_SetJoystick* functions) right before it is sent to the robot
+ */
+typedef void (*DS_JoystickPollFunc) (void* data);
+
 extern void Joysticks_Init (void);
 extern void Joysticks_Close (void);
+extern void Joysticks_ResetStats (void);
+extern void Joysticks_GetStats (DS_JoystickStats* stats);
 
 extern int DS_GetJoystickCount (void);
+extern unsigned int DS_GetJoystickLayoutVersion (void);
 extern int DS_GetJoystickNumHats (int joystick);
 extern int DS_GetJoystickNumAxes (int joystick);
 extern int DS_GetJoystickNumButtons (int joystick);
@@ -40,11 +105,23 @@ extern int DS_GetJoystickHat (int joystick, int hat);
 extern float DS_GetJoystickAxis (int joystick, int axis);
 extern int DS_GetJoystickButton (int joystick, int button);
 
+extern void DS_GetJoystickSnapshot (DS_JoystickSnapshot* snapshot);
+extern void DS_SetJoystickPollFunc (DS_JoystickPollFunc func, void* data);
+
+extern void DS_SetJoystickFilter (int joystick, const DS_AxisFilter* filter);
+extern void DS_GetJoystickAxisFilter (int joystick, int axis, DS_AxisFilter* filter);
+extern void DS_SetJoystickAxisFilter (int joystick, int axis, const DS_AxisFilter* filter);
+
 extern void DS_JoysticksReset (void);
 extern void DS_JoysticksAdd (const int axes, const int hats, const int buttons);
+extern void DS_JoysticksReplace (const int joystick, const int axes, const int hats, const int buttons);
 extern void DS_SetJoystickHat (int joystick, int hat, int angle);
 extern void DS_SetJoystickAxis (int joystick, int axis, float value);
 extern void DS_SetJoystickButton (int joystick, int button, int pressed);
+extern void DS_SetJoystickState (int joystick,
+                                 const float* axes, int num_axes,
+                                 uint32_t buttons,
+                                 const int* hats, int num_hats);
 
 #ifdef __cplusplus
 }
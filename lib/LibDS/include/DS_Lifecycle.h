@@ -0,0 +1,95 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_LIFECYCLE_H
+#define _LIB_DS_LIFECYCLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "DS_Protocol.h"
+#include "DS_Histogram.h"
+
+/*
+ * Number of finished requests kept in the history, and time (in msecs)
+ * after which a request that did not bring the robot code back fails
+ */
+#define DS_LIFECYCLE_HISTORY 16
+#define DS_LIFECYCLE_TIMEOUT 180000
+
+/**
+ * Operations whose timing is tracked
+ */
+typedef enum {
+    DS_LIFECYCLE_REBOOT,  /**< Robot reboot (see \c DS_RebootRobot()) */
+    DS_LIFECYCLE_RESTART, /**< Code restart (see \c DS_RestartRobotCode()) */
+    DS_LIFECYCLE_DEPLOY,  /**< Code restart that the DS did not request */
+    DS_LIFECYCLE_KIND_COUNT,
+} DS_LifecycleKind;
+
+/**
+ * Timing of a single reboot or code restart. The times are given in msecs
+ * since the request (deploys start when the robot code stops), and are
+ * \c -1 if the step did not happen.
+ */
+typedef struct _lifecycle_record {
+    DS_LifecycleKind kind; /**< The tracked operation */
+    int completed;         /**< Set to \c 1 if the robot code came back */
+    uint64_t time;         /**< Time (in msecs) of the request */
+    int comms_lost;        /**< The robot communications were lost */
+    int comms_regained;    /**< The robot communications came back */
+    int code_lost;         /**< The robot code stopped */
+    int code_present;      /**< The robot code runs again */
+} DS_LifecycleRecord;
+
+/**
+ * Timing statistics of an operation, in msecs
+ */
+typedef struct _lifecycle_stats {
+    int requests;            /**< Number of tracked requests */
+    int completed;           /**< Requests that brought the robot code back */
+    int failed;              /**< Requests that timed out or were replaced */
+    DS_LatencyStats total;   /**< Time from the request until the code runs */
+    DS_LatencyStats outage;  /**< Time without robot code (or comms) */
+} DS_LifecycleStats;
+
+extern void Lifecycle_Request (const DS_LifecycleKind kind);
+extern void Lifecycle_CommsChanged (const int communications);
+extern void Lifecycle_CodeChanged (const int code, const int robot_lost);
+
+extern void DS_ResetLifecycleStats (void);
+extern void DS_GetLifecycleStats (const DS_LifecycleKind kind,
+                                  DS_LifecycleStats* stats);
+extern void DS_GetLifecycleHistograms (const DS_LifecycleKind kind,
+                                       DS_Histogram* total,
+                                       DS_Histogram* outage);
+extern int DS_GetLifecycleRecords (DS_LifecycleRecord* records, const int max);
+extern int DS_GetPendingLifecycle (DS_LifecycleRecord* record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
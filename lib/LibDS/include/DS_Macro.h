@@ -0,0 +1,86 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _LIB_DS_MACRO_H
+#define _LIB_DS_MACRO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "DS_Joysticks.h"
+
+/*
+ * Macro file format (all integers are little-endian):
+ *
+ *   Header:  "DSJM", u8 version, 3 reserved bytes, u64 wall clock time of
+ *            the start of the recording (usecs since the UNIX epoch),
+ *            u32 number of frames
+ *
+ *   Frame:   varint time (usecs since the previous frame), u8 flags, then
+ *            the joystick layout (if DS_MACRO_LAYOUT is set) and the changed
+ *            values (if DS_MACRO_VALUES is set)
+ *
+ *   Layout:  u8 joystick count, (u8 axes, u8 hats, u8 buttons) per joystick
+ *
+ *   Values:  u8 mask per joystick, followed by u32 buttons (if the mask has
+ *            DS_MACRO_BUTTONS), u8 changed hat bits and a zigzag varint for
+ *            each changed hat (DS_MACRO_HATS), u16 changed axis bits and the
+ *            IEEE 754 bits (u32) of each changed axis (DS_MACRO_AXES)
+ *
+ * Each frame is the joystick snapshot of one robot packet, encoded as the
+ * difference with the previous frame (the first frame is compared with an
+ * empty snapshot), so frames in which nothing changed only take a few bytes.
+ */
+#define DS_MACRO_MAGIC       "DSJM"
+#define DS_MACRO_VERSION     1
+#define DS_MACRO_HEADER_SIZE 20
+
+#define DS_MACRO_LAYOUT  0x01
+#define DS_MACRO_VALUES  0x02
+#define DS_MACRO_BUTTONS 0x01
+#define DS_MACRO_HATS    0x02
+#define DS_MACRO_AXES    0x04
+
+extern void Macro_Close (void);
+extern int Macro_Playing (void);
+extern int Macro_NextFrame (DS_JoystickSnapshot* snapshot);
+extern void Macro_RecordFrame (const DS_JoystickSnapshot* snapshot);
+
+extern void DS_StartMacroRecording (void);
+extern void DS_StopMacroRecording (void);
+extern int DS_MacroRecording (void);
+extern int DS_SaveMacro (const char* path);
+
+extern int DS_StartMacroPlayback (const char* path, const int loop);
+extern void DS_StopMacroPlayback (void);
+extern int DS_MacroPlaying (void);
+extern int DS_GetMacroFrameCount (void);
+extern int DS_GetMacroPosition (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,84 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_MATCH_H
+#define _LIB_DS_MATCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "DS_Types.h"
+#include "DS_Protocol.h"
+#include "DS_History.h"
+
+/*
+ * Number of finished matches whose summary is kept
+ */
+#define DS_MATCH_HISTORY 16
+
+/**
+ * Summary of a match played with the FMS. The aggregates are updated as
+ * the samples arrive, so obtaining a summary does not scan any history.
+ *
+ * A match starts when the robot is enabled while the FMS is connected, and
+ * ends when the robot is disabled after the teleoperated period, when the
+ * FMS disconnects or when the FMS reports a different match.
+ */
+typedef struct _match_summary {
+    DS_MatchType match_type;  /**< Match type reported by the FMS */
+    int match_number;         /**< Match number reported by the FMS */
+    int replay_number;        /**< Replay number reported by the FMS */
+    uint64_t start_time;      /**< Time (in msecs) when the match started */
+    int duration;             /**< Length of the match (in msecs) */
+    float min_voltage;        /**< Lowest robot voltage, \c 0 if unknown */
+    float avg_voltage;        /**< Average robot voltage, \c 0 if unknown */
+    int brownouts;            /**< Drops below the brownout threshold */
+    int comms_drops;          /**< Losses of the robot communications */
+    int comms_lost_time;      /**< Time (in msecs) without robot comms */
+    unsigned int sent;        /**< Robot packets sent during the match */
+    unsigned int lost;        /**< Robot packets that got no reply */
+    float packet_loss;        /**< Percentage of lost robot packets */
+    DS_LatencyStats latency;  /**< Robot round-trip time (in usecs) */
+    int max_cpu;              /**< Peak robot CPU usage, \c -1 if unknown */
+    int max_can;              /**< Peak CAN utilization, \c -1 if unknown */
+} DS_MatchSummary;
+
+extern void Match_Update (void);
+extern void Match_PacketSent (void);
+extern void Match_RoundTrip (const uint32_t usecs);
+extern void Match_AddVoltage (const float voltage);
+extern void Match_CommsChanged (const int communications);
+extern void Match_AddSample (const DS_HistoryMetric metric, const int percent);
+
+extern int DS_MatchActive (void);
+extern void DS_ClearMatchSummaries (void);
+extern int DS_GetCurrentMatch (DS_MatchSummary* summary);
+extern int DS_GetMatchSummaries (DS_MatchSummary* summaries, const int max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_MESSAGES_H
+#define _LIB_DS_MESSAGES_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "DS_Stats.h"
+#include "DS_NetConsole.h"
+
+/*
+ * Messages received through the robot stream (standard output, errors and
+ * warnings of the robot program):
+ *
+ * - At most DS_ROBOT_MESSAGES_RATE messages are processed per second, the
+ *   rest are dropped and their number is reported in the NetConsole
+ * - The first occurrence of an error or warning is stored in the NetConsole,
+ *   its repeats are only counted and summarized in a single line (at most
+ *   once every DS_ROBOT_MESSAGES_REPEAT_INTERVAL msecs)
+ * - DS_ROBOT_MESSAGES_MAX distinct errors and warnings are remembered (the
+ *   least recently seen one is forgotten first), the first
+ *   DS_ROBOT_MESSAGE_SIZE - 1 bytes of their text are kept
+ *
+ * Embedded builds define smaller values (see LibDS.pri).
+ */
+#ifndef DS_ROBOT_MESSAGES_RATE
+    #define DS_ROBOT_MESSAGES_RATE            500
+#endif
+#ifndef DS_ROBOT_MESSAGES_REPEAT_INTERVAL
+    #define DS_ROBOT_MESSAGES_REPEAT_INTERVAL 1000
+#endif
+#ifndef DS_ROBOT_MESSAGES_MAX
+    #define DS_ROBOT_MESSAGES_MAX             128
+#endif
+#ifndef DS_ROBOT_MESSAGE_SIZE
+    #define DS_ROBOT_MESSAGE_SIZE             256
+#endif
+
+/**
+ * A distinct error or warning reported by the robot program
+ */
+typedef struct {
+    int code;                          /**< Error code of the message */
+    DS_NetConsoleSeverity severity;    /**< Error or warning */
+    uint64_t count;                    /**< Number of occurrences */
+    uint64_t first_time;               /**< Wall-clock time (usecs) of the first occurrence */
+    uint64_t last_time;                /**< Wall-clock time (usecs) of the last occurrence */
+    char text [DS_ROBOT_MESSAGE_SIZE]; /**< Text (as received) of the message */
+} DS_RobotMessage;
+
+/* Internal functions */
+extern void Messages_Update (void);
+extern void Messages_ResetStats (void);
+extern void Messages_GetStats (DS_RobotMessageStats* stats);
+extern void Messages_AddOutput (const char* text, const size_t len);
+extern void Messages_AddError (const int error, const int code,
+                               const char* details, const size_t details_len,
+                               const char* location, const size_t location_len);
+
+/* Errors and warnings of the robot program */
+extern void DS_ClearRobotMessages (void);
+extern int DS_GetRobotMessages (DS_RobotMessage* messages, const int max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
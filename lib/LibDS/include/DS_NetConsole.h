@@ -0,0 +1,138 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_NETCONSOLE_H
+#define _LIB_DS_NETCONSOLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "DS_Socket.h"
+#include "DS_Stats.h"
+
+/*
+ * Size of the arena that stores the text of the NetConsole lines, maximum
+ * number of stored lines (must be a power of two) and maximum length of a
+ * single line (longer lines are truncated, must not exceed the arena size).
+ * Embedded builds define smaller values (see LibDS.pri).
+ */
+#ifndef DS_NETCONSOLE_ARENA_SIZE
+    #define DS_NETCONSOLE_ARENA_SIZE (512 * 1024)
+#endif
+#ifndef DS_NETCONSOLE_MAX_LINES
+    #define DS_NETCONSOLE_MAX_LINES  8192
+#endif
+#ifndef DS_NETCONSOLE_LINE_SIZE
+    #define DS_NETCONSOLE_LINE_SIZE  4096
+#endif
+
+/*
+ * Number and size (including the terminator) of the buffers that hold the
+ * messages of the DS_NETCONSOLE_NEW_MESSAGE events, longer messages are
+ * truncated (the stored lines are not)
+ */
+#ifndef DS_NETCONSOLE_MESSAGE_SLOTS
+    #define DS_NETCONSOLE_MESSAGE_SLOTS 32
+#endif
+#ifndef DS_NETCONSOLE_MESSAGE_SIZE
+    #define DS_NETCONSOLE_MESSAGE_SIZE  1024
+#endif
+
+/*
+ * Outgoing messages are queued (messages that do not fit in the queue are
+ * dropped) and sent by the protocol event loop. The messages queued within
+ * DS_NETCONSOLE_SEND_DELAY msecs are sent together, in datagrams of up to
+ * DS_NETCONSOLE_SEND_MTU bytes.
+ */
+#ifndef DS_NETCONSOLE_SEND_QUEUE_SIZE
+    #define DS_NETCONSOLE_SEND_QUEUE_SIZE 8192
+#endif
+#ifndef DS_NETCONSOLE_SEND_MTU
+    #define DS_NETCONSOLE_SEND_MTU        1400
+#endif
+#ifndef DS_NETCONSOLE_SEND_DELAY
+    #define DS_NETCONSOLE_SEND_DELAY      5
+#endif
+
+/**
+ * Origin of a NetConsole line
+ */
+typedef enum {
+    DS_NETCONSOLE_SOURCE_ROBOT,       /**< Printed by the robot program */
+    DS_NETCONSOLE_SOURCE_LIBDS,       /**< Notification of the LibDS */
+    DS_NETCONSOLE_SOURCE_APPLICATION, /**< Added by the application */
+} DS_NetConsoleSource;
+
+/**
+ * Severity of a NetConsole line
+ */
+typedef enum {
+    DS_NETCONSOLE_SEVERITY_INFO,
+    DS_NETCONSOLE_SEVERITY_WARNING,
+    DS_NETCONSOLE_SEVERITY_ERROR,
+} DS_NetConsoleSeverity;
+
+/**
+ * A NetConsole line obtained with \c DS_NetConsoleRead(). The text is plain
+ * text (valid UTF-8 without control characters, except tabs), applications
+ * decide how to display each source and severity.
+ */
+typedef struct {
+    uint64_t number;                /**< Sequence number of the line */
+    uint64_t time;                  /**< Wall-clock time (usecs) of the line */
+    DS_NetConsoleSource source;     /**< Origin of the line */
+    DS_NetConsoleSeverity severity; /**< Severity of the line */
+    const char* text;               /**< Null-terminated text (in the caller's buffer) */
+    size_t len;                     /**< Length of \a text */
+} DS_NetConsoleLine;
+
+extern void NetConsole_Init (void);
+extern void NetConsole_Close (void);
+extern void NetConsole_ResetStats (void);
+extern void NetConsole_GetStats (DS_NetConsoleStats* stats);
+extern int NetConsole_SendRemaining (void);
+extern void NetConsole_SendQueued (DS_Socket* socket);
+extern int NetConsole_QueueMessage (const char* message);
+
+extern void DS_NetConsoleClear (void);
+extern uint64_t DS_NetConsoleFirstLine (void);
+extern uint64_t DS_NetConsoleLineCount (void);
+extern void DS_NetConsoleAppend (const char* data, const size_t len);
+extern void DS_NetConsoleAppendEntry (const DS_NetConsoleSource source,
+                                      const DS_NetConsoleSeverity severity,
+                                      const char* data, const size_t len);
+extern void DS_SetNetConsoleMessageEvents (const int enabled);
+extern void DS_NetConsoleReleaseMessage (char* message);
+extern int DS_NetConsoleRead (uint64_t* cursor, DS_NetConsoleLine* lines,
+                              const int max_lines, char* buffer,
+                              const size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
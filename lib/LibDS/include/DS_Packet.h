@@ -0,0 +1,64 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_PACKET_H
+#define _LIB_DS_PACKET_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "DS_String.h"
+
+/*
+ * Size of the scratch buffers used to build outgoing packets
+ */
+#define DS_PACKET_MAX_SIZE 2048
+
+/**
+ * Writes bytes into a caller-provided buffer with a fixed capacity. The
+ * packet never allocates memory, writes that do not fit in the buffer are
+ * discarded and the \a overflow flag is set instead.
+ */
+typedef struct {
+    uint8_t* buf;    /**< Buffer provided by the caller */
+    size_t len;      /**< Number of bytes written so far */
+    size_t capacity; /**< Size of \a buf */
+    int overflow;    /**< Set to \c 1 if a write did not fit in \a buf */
+} DS_Packet;
+
+extern void DS_PacketClear (DS_Packet* packet);
+extern DS_String DS_PacketView (const DS_Packet* packet);
+extern int DS_PacketAppend (DS_Packet* packet, const uint8_t byte);
+extern int DS_PacketAppendU16 (DS_Packet* packet, const uint16_t value);
+extern int DS_PacketAppendBytes (DS_Packet* packet, const void* data, size_t len);
+extern void DS_PacketInit (DS_Packet* packet, uint8_t* buffer, size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
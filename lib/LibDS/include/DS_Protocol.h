@@ -28,23 +28,97 @@
 extern "C" {
 #endif
 
+#include "DS_Packet.h"
 #include "DS_Socket.h"
 #include "DS_String.h"
+#include "DS_Histogram.h"
+
+/**
+ * Summary of a latency histogram, all values are in microseconds
+ */
+typedef struct _latency_stats {
+    unsigned int samples; /**< Number of recorded values */
+    unsigned int p50;     /**< Median value */
+    unsigned int p99;     /**< 99th percentile */
+    unsigned int max;     /**< Largest recorded value */
+} DS_LatencyStats;
+
+/**
+ * Timing statistics of a network channel
+ */
+typedef struct _latency_info {
+    DS_LatencyStats round_trip; /**< Time between a sent packet and its reply */
+    DS_LatencyStats jitter;     /**< Deviation of the packet inter-arrival time */
+    DS_LatencyStats lateness;   /**< Delay between a send deadline and the send */
+    DS_LatencyStats period;     /**< Time between two consecutive sends */
+    unsigned int deadline_misses; /**< Sends more than 2 intervals apart */
+} DS_LatencyInfo;
+
+/**
+ * Packet loss of a network channel over a sliding time window
+ */
+typedef struct _loss_info {
+    int packets; /**< Number of sent packets in the window */
+    int lost;    /**< Number of those packets that got no reply */
+    int percent; /**< Packet loss percentage in the window */
+    int streak;  /**< Number of consecutive packets lost most recently */
+} DS_LossInfo;
+
+/**
+ * Network usage of a channel since the current protocol was loaded, the
+ * rates are exponentially weighted moving averages (over about a second)
+ */
+typedef struct _traffic_info {
+    uint64_t sent_bytes;         /**< Number of sent bytes */
+    uint64_t received_bytes;     /**< Number of received bytes */
+    uint64_t sent_packets;       /**< Number of sent packets */
+    uint64_t received_packets;   /**< Number of received packets */
+    double sent_byte_rate;       /**< Sent bytes per second */
+    double received_byte_rate;   /**< Received bytes per second */
+    double sent_packet_rate;     /**< Sent packets per second */
+    double received_packet_rate; /**< Received packets per second */
+} DS_TrafficInfo;
+
+/**
+ * Estimated offset between the DS and robot clocks, robot time equals the
+ * DS time (see \c DS_GetTimeUs()) plus the offset
+ */
+typedef struct _clock_info {
+    int valid;     /**< Set to \c 1 once the robot clock has been sampled */
+    int samples;   /**< Number of samples used by the estimate */
+    double offset; /**< Robot time minus DS time (in msecs), right now */
+    double drift;  /**< Change of the offset (in usecs per second, i.e. ppm) */
+    double error;  /**< Last correction of the estimate (in msecs) */
+} DS_ClockInfo;
 
 typedef struct _protocol {
     DS_String name;
     DS_String (*fms_address) (void);
     DS_String (*radio_address) (void);
     DS_String (*robot_address) (void);
+    int (*robot_fallback_addresses) (DS_String* addresses, const int max);
 
     DS_String (*create_fms_packet) (void);
     DS_String (*create_radio_packet) (void);
     DS_String (*create_robot_packet) (void);
 
+    void (*write_fms_packet) (DS_Packet*);
+    void (*write_radio_packet) (DS_Packet*);
+    void (*write_robot_packet) (DS_Packet*);
+
     int (*read_fms_packet) (const DS_String*);
     int (*read_radio_packet) (const DS_String*);
     int (*read_robot_packet) (const DS_String*);
 
+    /*
+     * Messages exchanged with the robot through its TCP stream (if the
+     * protocol enables the robot stream socket). The write function is called
+     * until it leaves the packet empty, each call writes a single message.
+     */
+    void (*write_robot_stream) (DS_Packet*);
+    int (*read_robot_stream) (const DS_String*);
+    void (*reset_robot_stream) (void);
+
     void (*reset_fms) (void);
     void (*reset_radio) (void);
     void (*reset_robot) (void);
@@ -62,14 +136,17 @@ typedef struct _protocol {
     int max_button_count;
     float max_battery_voltage;
 
+    /* The sockets must be the last members (see DS_ConfigureProtocol) */
     DS_Socket fms_socket;
     DS_Socket radio_socket;
     DS_Socket robot_socket;
+    DS_Socket robot_stream_socket;
     DS_Socket netconsole_socket;
 } DS_Protocol;
 
 extern void Protocols_Init();
 extern void Protocols_Close();
+extern int Protocols_QueuesCommands (void);
 extern void DS_ConfigureProtocol (const DS_Protocol* ptr);
 
 extern unsigned long DS_SentFMSBytes();
@@ -88,10 +165,57 @@ extern int DS_ReceivedFMSPackets();
 extern int DS_ReceivedRadioPackets();
 extern int DS_ReceivedRobotPackets();
 
+extern int DS_DuplicatedRobotPackets();
+extern int DS_ReorderedRobotPackets();
+extern void DS_CountDuplicatedRobotPacket();
+extern void DS_CountReorderedRobotPacket();
+extern void DS_AddRobotClockSample (const double robot_time);
+
+extern DS_ClockInfo DS_GetRobotClockInfo();
+extern double DS_RobotClockTime (const uint64_t usecs);
+
 extern void DS_ResetFMSPackets();
 extern void DS_ResetRadioPackets();
 extern void DS_ResetRobotPackets();
 
+extern DS_LatencyInfo DS_GetFMSLatencyInfo();
+extern DS_LatencyInfo DS_GetRadioLatencyInfo();
+extern DS_LatencyInfo DS_GetRobotLatencyInfo();
+extern void DS_GetRobotLatencyHistograms (DS_Histogram* round_trip,
+                                          DS_Histogram* jitter);
+
+extern DS_LossInfo DS_GetFMSLossInfo();
+extern DS_LossInfo DS_GetRadioLossInfo();
+extern DS_LossInfo DS_GetRobotLossInfo();
+extern void DS_SetPacketLossWindow (const int millisecs);
+
+extern DS_TrafficInfo DS_GetFMSTrafficInfo();
+extern DS_TrafficInfo DS_GetRadioTrafficInfo();
+extern DS_TrafficInfo DS_GetRobotTrafficInfo();
+
+extern void DS_RequestRobotPacket (void);
+extern void DS_SetEarlyRobotPacketGap (const int millisecs);
+extern void DS_SendStateChange (void);
+extern void DS_SetStateChangeBurst (const int packets);
+extern void DS_SetNetworkImpairment (const DS_SocketImpairment* impairment);
+
+extern void DS_SetFMSSendInterval (const int millisecs);
+extern void DS_SetRadioSendInterval (const int millisecs);
+extern void DS_SetRobotSendInterval (const int millisecs);
+extern void DS_SetAdaptiveSendRate (const int enabled);
+extern int DS_SendRateBackoff (void);
+extern void DS_SetPowerSaving (const int enabled);
+extern int DS_PowerSavingIdle (void);
+
+extern void DS_SetFMSWatchdogTimeout (const int millisecs);
+extern void DS_SetRadioWatchdogTimeout (const int millisecs);
+extern void DS_SetRobotWatchdogTimeout (const int millisecs);
+extern void DS_SetWatchdogRecovery (const int packets);
+
+extern void DS_SetProtocolThreadRealtime (const int enabled);
+extern void DS_SetProtocolThreadAffinity (const int cpu);
+extern void DS_SetProtocolBusyPolling (const int enabled);
+
 extern DS_Protocol* DS_CurrentProtocol();
 
 #ifdef __cplusplus
@@ -28,21 +28,26 @@
 extern "C" {
 #endif
 
-typedef struct _queue {
-    int count;
-    int capacity;
-    int item_size;
-
-    int rear;
-    int front;
+#include <stdint.h>
 
-    void** buffer;
+/**
+ * A FIFO queue of fixed-size items, stored by value in a single ring buffer
+ * of \c capacity items. The capacity is a power of two, so that the ring
+ * indexes are wrapped with a mask. The buffer doubles its size when an item
+ * is pushed to a full queue.
+ */
+typedef struct _queue {
+    int count;       /**< Number of items in the queue */
+    int capacity;    /**< Number of items that fit in the buffer */
+    int item_size;   /**< Size of each item (in bytes) */
+    int front;       /**< Index of the first item */
+    uint8_t* buffer; /**< Storage of the items */
 } DS_Queue;
 
 extern int DS_QueuePop (DS_Queue* queue);
 extern void DS_QueueFree (DS_Queue* queue);
 extern void* DS_QueueGetFirst (DS_Queue* queue);
-extern void DS_QueuePush (DS_Queue* queue, void* item);
+extern int DS_QueuePush (DS_Queue* queue, const void* item);
 extern void DS_QueueInit (DS_Queue* queue, int initial_count, int item_size);
 
 #ifdef __cplusplus
@@ -0,0 +1,192 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_READER_H
+#define _LIB_DS_READER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "DS_String.h"
+
+#if defined _MSC_VER && !defined __cplusplus
+    #define DS_READER_INLINE static __inline
+#else
+    #define DS_READER_INLINE static inline
+#endif
+
+/**
+ * Reads bytes from a borrowed buffer (e.g. a received packet) with a cursor.
+ * Reads past the end of the buffer return zero and set the \a error flag
+ * instead, so that a decoder can read all its fields and check the flag
+ * once. The reader never copies nor allocates memory.
+ */
+typedef struct {
+    const uint8_t* buf; /**< Data being read (not owned by the reader) */
+    size_t len;         /**< Size of \a buf */
+    size_t pos;         /**< Position of the next byte to read */
+    int error;          /**< Set to \c 1 if a read went past the end */
+} DS_Reader;
+
+/**
+ * Initializes the given \a reader to read the bytes of the given \a data.
+ *
+ * \param reader the reader to initialize
+ * \param data the string to read, may be \c NULL
+ * \param min_len the minimum size of a valid packet
+ *
+ * \returns \c 1 if \a data is valid and has at least \a min_len bytes,
+ *          \c 0 otherwise (the \a error flag of the reader is also set)
+ */
+DS_READER_INLINE int DS_ReaderInit (DS_Reader* reader, const DS_String* data,
+                                    const size_t min_len)
+{
+    reader->pos = 0;
+    reader->buf = data ? (const uint8_t*) data->buf : NULL;
+    reader->len = (data && data->buf) ? data->len : 0;
+    reader->error = !data || reader->len < min_len;
+
+    return !reader->error;
+}
+
+/**
+ * Returns the number of bytes that have not been read yet
+ */
+DS_READER_INLINE size_t DS_ReaderRemaining (const DS_Reader* reader)
+{
+    return reader->len - reader->pos;
+}
+
+/**
+ * Returns a pointer to the next \a size bytes and moves the cursor past
+ * them, or \c NULL (and sets the \a error flag) if they are not available
+ */
+DS_READER_INLINE const uint8_t* DS_ReaderBytes (DS_Reader* reader,
+                                                const size_t size)
+{
+    const uint8_t* bytes;
+
+    if (size > DS_ReaderRemaining (reader)) {
+        reader->error = 1;
+        reader->pos = reader->len;
+        return NULL;
+    }
+
+    bytes = reader->buf + reader->pos;
+    reader->pos += size;
+    return bytes;
+}
+
+/**
+ * Moves the cursor of the \a reader past the next \a size bytes
+ */
+DS_READER_INLINE void DS_ReaderSkip (DS_Reader* reader, const size_t size)
+{
+    DS_ReaderBytes (reader, size);
+}
+
+/**
+ * Reads an unsigned byte, returns \c 0 if there is no data left
+ */
+DS_READER_INLINE uint8_t DS_ReaderU8 (DS_Reader* reader)
+{
+    const uint8_t* bytes = DS_ReaderBytes (reader, 1);
+    return bytes ? bytes [0] : 0;
+}
+
+/**
+ * Reads a big-endian 16-bit unsigned integer, returns \c 0 if there is not
+ * enough data left
+ */
+DS_READER_INLINE uint16_t DS_ReaderU16 (DS_Reader* reader)
+{
+    const uint8_t* bytes = DS_ReaderBytes (reader, 2);
+    return bytes ? (uint16_t) ((bytes [0] << 8) | bytes [1]) : 0;
+}
+
+/**
+ * Reads a big-endian 32-bit unsigned integer, returns \c 0 if there is not
+ * enough data left
+ */
+DS_READER_INLINE uint32_t DS_ReaderU32 (DS_Reader* reader)
+{
+    const uint8_t* bytes = DS_ReaderBytes (reader, 4);
+    if (!bytes)
+        return 0;
+
+    return ((uint32_t) bytes [0] << 24) | ((uint32_t) bytes [1] << 16) |
+           ((uint32_t) bytes [2] << 8)  | ((uint32_t) bytes [3]);
+}
+
+/**
+ * Reads a big-endian IEEE-754 float, returns \c 0 if there is not enough
+ * data left
+ */
+DS_READER_INLINE float DS_ReaderFloat (DS_Reader* reader)
+{
+    float value;
+    uint32_t bits = DS_ReaderU32 (reader);
+    memcpy (&value, &bits, sizeof (value));
+    return value;
+}
+
+/**
+ * Reads a tag (TLV) with the following layout: the size of the tag (one
+ * byte, which counts the ID and the payload), the tag ID (one byte) and
+ * the payload. The \a payload reader is set to read only the payload.
+ *
+ * \returns \c 1 if a tag was read, \c 0 if there are no tags left or if the
+ *          next tag is empty or truncated (the cursor is not moved)
+ */
+DS_READER_INLINE int DS_ReaderTag (DS_Reader* reader, uint8_t* id,
+                                   DS_Reader* payload)
+{
+    size_t size;
+
+    if (DS_ReaderRemaining (reader) < 2)
+        return 0;
+
+    size = reader->buf [reader->pos];
+    if (size < 1 || size + 1 > DS_ReaderRemaining (reader))
+        return 0;
+
+    *id = reader->buf [reader->pos + 1];
+    payload->buf = reader->buf + reader->pos + 2;
+    payload->len = size - 1;
+    payload->pos = 0;
+    payload->error = 0;
+
+    reader->pos += size + 1;
+    return 1;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_REGISTRY_H
+#define _LIB_DS_REGISTRY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "DS_String.h"
+#include "DS_Protocol.h"
+
+/*
+ * Maximum number of registered protocols and length of their names
+ */
+#define DS_MAX_PROTOCOLS         32
+#define DS_MAX_PROTOCOL_NAME_LEN 64
+
+/*
+ * Version of the protocol module interface, it changes whenever the layout
+ * of \c DS_Protocol or \c DS_ProtocolModule changes
+ */
+#define DS_PROTOCOL_ABI_VERSION 2
+
+/*
+ * Name of the function that a protocol module must export, its type is
+ * \c DS_ProtocolModuleEntry
+ */
+#define DS_PROTOCOL_MODULE_ENTRY "DS_GetProtocolModule"
+
+/**
+ * Creates a new instance of a protocol (e.g. \c DS_GetProtocolFRC_2016), the
+ * instance declares its own packet functions, intervals and sockets
+ */
+typedef DS_Protocol (*DS_ProtocolFactory) (void);
+
+/**
+ * A protocol provided by a protocol module
+ */
+typedef struct {
+    const char* name;           /**< Unique name of the protocol */
+    DS_ProtocolFactory factory; /**< Function that creates the protocol */
+} DS_ProtocolInfo;
+
+/**
+ * Describes the protocols of a protocol module (a shared library), which
+ * returns it from its \c DS_GetProtocolModule() function
+ *
+ * \note Protocol modules call the LibDS functions of the host application,
+ *       which must export them (e.g. link LibDS as a shared library or link
+ *       the application with -rdynamic)
+ */
+typedef struct {
+    int abi_version;                  /**< Set to DS_PROTOCOL_ABI_VERSION */
+    size_t protocol_size;             /**< Set to sizeof (DS_Protocol) */
+    int count;                        /**< Number of protocols */
+    const DS_ProtocolInfo* protocols; /**< Protocols of the module */
+} DS_ProtocolModule;
+
+typedef const DS_ProtocolModule* (*DS_ProtocolModuleEntry) (void);
+
+extern int DS_RegisterProtocol (const char* name, DS_ProtocolFactory factory);
+extern int DS_UnregisterProtocol (const char* name);
+extern int DS_RegisteredProtocolCount (void);
+extern DS_String DS_RegisteredProtocolName (const int index);
+extern int DS_CreateRegisteredProtocol (const char* name, DS_Protocol* protocol);
+extern int DS_LoadRegisteredProtocol (const char* name);
+extern int DS_LoadProtocolModule (const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
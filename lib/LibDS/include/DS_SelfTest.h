@@ -0,0 +1,74 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_SELF_TEST_H
+#define _LIB_DS_SELF_TEST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "DS_Protocol.h"
+
+/*
+ * Limits (in microseconds) of the self-test checks, they leave a margin
+ * for the 20 ms interval of the robot packets
+ */
+#define DS_SELF_TEST_MAX_SLEEP_ERROR_P50 1000
+#define DS_SELF_TEST_MAX_SLEEP_ERROR_P99 4000
+#define DS_SELF_TEST_MAX_LOOPBACK_P99    1000
+#define DS_SELF_TEST_MAX_RESOLVE_TIME    1000000
+#define DS_SELF_TEST_MAX_LATENESS_P99    5000
+#define DS_SELF_TEST_MAX_LATENESS        10000
+
+/*
+ * Maximum size (including the terminator) of the tested robot address
+ */
+#define DS_SELF_TEST_ADDRESS_SIZE 128
+
+/**
+ * Results of a self-test (see \c DS_RunSelfTest()), all times are given in
+ * microseconds
+ */
+typedef struct _self_test_result {
+    int passed;                   /**< Set to \c 1 if every check passed */
+    int timer_passed;             /**< The sleeps are accurate enough */
+    int loopback_passed;          /**< Loopback datagrams are fast and not lost */
+    int resolve_passed;           /**< The robot address is resolved quickly */
+    int lateness_passed;          /**< 50 Hz sends meet their deadlines */
+    DS_LatencyStats sleep_error;  /**< Time slept beyond the requested time */
+    DS_LatencyStats loopback;     /**< Round-trip time of a loopback datagram */
+    DS_LatencyStats lateness;     /**< Delay between a send deadline and the send */
+    unsigned int loopback_lost;   /**< Loopback datagrams that did not return */
+    int resolved;                 /**< Set to \c 1 if the robot address was found */
+    unsigned int resolve_time;    /**< Time spent resolving the robot address */
+    char robot_address [DS_SELF_TEST_ADDRESS_SIZE]; /**< The resolved address */
+} DS_SelfTestResult;
+
+extern int DS_RunSelfTest (DS_SelfTestResult* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -28,42 +28,109 @@
 extern "C" {
 #endif
 
-#include <pthread.h>
+#include <stdint.h>
+#include "DS_Thread.h"
 
 #include "DS_Types.h"
 #include "DS_String.h"
 
+/*
+ * Number (a power of two) and size of the receive slots of each socket,
+ * embedded builds use less slots (see LibDS.pri)
+ */
+#ifndef DS_SOCKET_SLOTS
+    #define DS_SOCKET_SLOTS 8
+#endif
+#define DS_SOCKET_SLOT_SIZE 2048
+
+/*
+ * Size of the reassembly buffer of TCP sockets, it must be able to hold a
+ * complete message of DS_SOCKET_SLOT_SIZE bytes along with its prefix
+ */
+#define DS_SOCKET_STREAM_SIZE 4096
+
+/*
+ * DSCP code points used to prioritize the traffic of a socket
+ */
+#define DS_DSCP_DEFAULT 0  /* Best effort */
+#define DS_DSCP_AF41    34 /* Interactive video (e.g. camera streams) */
+#define DS_DSCP_EF      46 /* Expedited forwarding (control packets) */
+
+/*
+ * Maximum size of a cached remote address (a sockaddr structure), of a
+ * candidate host name and number of address candidates of a socket
+ */
+#define DS_SOCKET_ADDR_SIZE      128
+#define DS_SOCKET_HOST_SIZE      256
+#define DS_SOCKET_MAX_CANDIDATES 5
+
 /**
- * Holds all the private (erm, dirty) variables that the sockets module needs
- * to operate with the data provided by a \c DS_Socket structure
+ * Network conditions simulated by a socket (for testing), the datagrams
+ * received by the socket, and the datagrams sent to its connected address,
+ * are dropped, duplicated, delayed and reordered by the reactor thread.
+ * TCP sockets are not impaired.
  */
 typedef struct {
-    int sock_in;           /**< Input socket file descriptor */
-    int sock_out;          /**< Output socket file descriptor */
-    int client_init;       /**< 1 if client is working, 0 if not */
-    int server_init;       /**< 1 if server is working, 0 if not */
-    size_t buffer_size;    /**< Holds the number of received bytes */
-    char buffer [4096];    /**< Holds the received data buffer */
-    char in_service [12];  /**< Holds the input port number as a string */
-    char out_service [12]; /**< Holds the output port number as a string */
-} DS_SocketInfo;
+    int loss;      /**< Probability (in %) of dropping a datagram */
+    int duplicate; /**< Probability (in %) of duplicating a datagram */
+    int reorder;   /**< Probability (in %) of holding a datagram back */
+    int latency;   /**< Delay (in msecs) added to every datagram */
+    int jitter;    /**< Maximum random delay (in msecs) added to the latency */
+    int bandwidth; /**< Bandwidth cap (in kbit/s), 0 for unlimited */
+} DS_SocketImpairment;
+
+/**
+ * Runtime state of a socket (file descriptors, receive ring, TCP reassembly
+ * buffer and address cache), allocated and owned by the sockets module
+ */
+typedef struct _ds_socket_info DS_SocketInfo;
 
 /**
  * Holds all the 'public' variables of a socket, these variables can be used
  * both the the networking module and the rest of the application.
+ *
+ * TCP sockets exchange messages that are prefixed with their length (as a
+ * 16-bit big-endian number), each message is read and sent like a datagram.
+ * A TCP socket connects to its address and output port, and (if it has an
+ * input port) accepts connections on its input port.
+ *
+ * ICMP sockets send echo requests (written by the application) to their
+ * address and receive the replies through a single (IPv4) descriptor, the
+ * ports are not used. Replies may include the IP header (see
+ * \c create_client_icmp()).
+ *
+ * Addresses can resolve to IPv4 or IPv6 addresses (the first address given
+ * by the resolver is used), each socket has an input and an output socket
+ * for each address family.
+ *
+ * The structure itself only holds the configuration of the socket, so it is
+ * cheap to copy (copies do not share the runtime state). The runtime state
+ * is allocated once the socket is opened (or once its addresses or network
+ * conditions are set) and is de-allocated by \c DS_SocketClose().
  */
 typedef struct {
     int in_port;           /**< Input port number */
     int out_port;          /**< Output port number */
     int disabled;          /**< 1 if socket shall not send or receive data */
     int broadcast;         /**< 1 if socket shall send or receive broadcasts */
-    char address [512];    /**< Address of remote host */
-    DS_SocketType type;    /**< Type of socket (UDP/TCP) */
-    DS_SocketInfo info;    /**< Ugly data about the socket */
+    int discovery;         /**< 1 if all addresses are probed until one replies */
+    int recv_buffer;       /**< Kernel receive buffer size, 0 for default */
+    int send_buffer;       /**< Kernel send buffer size, 0 for default */
+    int dscp;              /**< DSCP code point of the sent packets */
+    int busy_poll;         /**< Busy-polling time in usecs, 0 to disable */
+    char address [DS_SOCKET_HOST_SIZE]; /**< Address of remote host */
+    DS_SocketType type;    /**< Type of socket (UDP/TCP/ICMP) */
+    DS_SocketInfo* info;   /**< Runtime state, owned by the sockets module */
 } DS_Socket;
 
+/**
+ * Function called by the reactor thread when a watched descriptor can be
+ * read (see \c DS_SocketWatch())
+ */
+typedef void (*DS_WatchFunc) (int fd, void* data);
+
 /* For socket initialization */
-extern DS_Socket* DS_SocketEmpty (void);
+extern DS_Socket DS_SocketEmpty (void);
 
 /* Module functions */
 extern void Sockets_Init (void);
@@ -72,11 +139,31 @@ extern void Sockets_Close (void);
 /* Socket initializer and destructor functions */
 extern void DS_SocketOpen (DS_Socket* ptr);
 extern void DS_SocketClose (DS_Socket* ptr);
+extern void DS_SocketReconfigure (DS_Socket* ptr, const DS_Socket* config);
 
 /* I/O functions */
 extern DS_String DS_SocketRead (DS_Socket* ptr);
-extern int DS_SocketSend (const DS_Socket* ptr, const DS_String* data);
+extern void DS_SocketRelease (DS_Socket* ptr);
+extern int DS_SocketPeek (DS_Socket* ptr, DS_String* view);
+extern uint64_t DS_SocketPeekTime (DS_Socket* ptr);
+extern int DS_SocketConnected (DS_Socket* ptr);
+extern void DS_SocketTraffic (DS_Socket* ptr, uint64_t* sent, uint64_t* received);
+extern DS_String DS_SocketRemoteHost (DS_Socket* ptr);
+extern void DS_SocketWakeUp (void);
+extern int DS_SocketWaitForData (const int millisecs, size_t* generation);
+extern int DS_SocketSend (DS_Socket* ptr, const DS_String* data);
 extern void DS_SocketChangeAddress (DS_Socket* ptr, const char* address);
+extern void DS_SocketSetFallbackAddresses (DS_Socket* ptr,
+                                           const DS_String* addresses,
+                                           const int count);
+extern void DS_SocketSetThreadOptions (const int realtime, const int cpu);
+extern void DS_SocketSetBusyPolling (const int enabled);
+extern void DS_SocketSetImpairment (DS_Socket* ptr,
+                                    const DS_SocketImpairment* impairment);
+
+/* Other descriptors handled by the reactor */
+extern int DS_SocketWatch (const int fd, DS_WatchFunc func, void* data);
+extern void DS_SocketUnwatch (const int fd);
 
 #ifdef __cplusplus
 }
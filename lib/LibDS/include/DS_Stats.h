@@ -0,0 +1,102 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _LIB_DS_STATS_H
+#define _LIB_DS_STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Internal statistics of the current DS context, used to size the queues
+ * and buffers of the LibDS with real-world data (e.g. NetConsole bursts).
+ * The counters are accumulated since the context was created or since the
+ * last call to DS_ResetInternalStats().
+ */
+
+/**
+ * Statistics of the event queue
+ */
+typedef struct {
+    size_t queue_size;       /**< Capacity of the queue (DS_EVENT_QUEUE_SIZE) */
+    size_t queue_depth;      /**< Events waiting in the queue */
+    size_t high_water;       /**< Largest number of events in the queue */
+    size_t queued;           /**< Events added to the queue */
+    size_t dropped;          /**< Events discarded because the queue was full */
+    size_t coalesced;        /**< Events merged with the latest event of their type */
+    size_t contentions;      /**< Times the coalescing mutex was held by another thread */
+    uint64_t lag_max_us;     /**< Longest time between adding and polling an event */
+    uint64_t lag_avg_us;     /**< Average time between adding and polling an event */
+} DS_EventQueueStats;
+
+/**
+ * Statistics of the joystick snapshots
+ */
+typedef struct {
+    size_t read_retries;     /**< Reads repeated because a writer modified the buffer */
+    size_t contentions;      /**< Times the write mutex was held by another thread */
+} DS_JoystickStats;
+
+/**
+ * Statistics of the NetConsole line store
+ */
+typedef struct {
+    size_t lines;            /**< Lines received */
+    size_t max_burst;        /**< Most lines received in a single message */
+    size_t max_backlog;      /**< Most unread lines found by DS_NetConsoleRead() */
+    size_t lines_lost;       /**< Lines overwritten before the application read them */
+    size_t messages_dropped; /**< Message events not registered (no free buffers) */
+    size_t contentions;      /**< Times the line store mutex was held by another thread */
+} DS_NetConsoleStats;
+
+/**
+ * Statistics of the messages received through the robot stream
+ */
+typedef struct {
+    size_t received;         /**< Messages received from the robot */
+    size_t duplicates;       /**< Repeated errors and warnings (only counted) */
+    size_t dropped;          /**< Messages discarded by the rate limit */
+    size_t forgotten;        /**< Distinct messages forgotten to make room */
+} DS_RobotMessageStats;
+
+/**
+ * Internal statistics of a DS context
+ */
+typedef struct {
+    DS_EventQueueStats events;
+    DS_JoystickStats joysticks;
+    DS_NetConsoleStats netconsole;
+    DS_RobotMessageStats messages;
+} DS_InternalStats;
+
+extern void DS_GetInternalStats (DS_InternalStats* stats);
+extern void DS_ResetInternalStats (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
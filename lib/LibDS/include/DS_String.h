@@ -33,15 +33,43 @@ extern "C" {
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdarg.h>
+
+/*
+ * Size of the stack buffer used by \c DS_StrFormat() (longer results are
+ * formatted again in the heap) and of the text of a string cache
+ */
+#define DS_STR_FORMAT_STACK_SIZE 128
+#define DS_STR_CACHE_SIZE        64
 
 /**
- * Represents a string and its length
+ * Represents a string and its length.
+ *
+ * The buffer may be larger than the string itself (\a cap), so that
+ * appending data does not need to re-allocate the buffer every time.
+ * Strings with a \a cap of \c 0 do not own their buffer (e.g. views of
+ * a received datagram) and must not be resized.
  */
 typedef struct {
     char* buf;  /**< String data buffer */
     size_t len; /**< Length of the string */
+    size_t cap; /**< Allocated size of the data buffer */
 } DS_String;
 
+/**
+ * A short string formatted from an integer key (e.g. an address that depends
+ * on the team number), which is only formatted again when the key changes.
+ * A zeroed structure is an empty cache. Readers and writers can use the
+ * cache from different threads (the sequence is odd while it is written).
+ */
+typedef struct {
+    volatile size_t sequence;    /**< Incremented before and after each write */
+    int valid;                   /**< Set if the text was formatted */
+    int key;                     /**< Key of the formatted text */
+    size_t len;                  /**< Length of the text */
+    char text [DS_STR_CACHE_SIZE]; /**< The formatted text */
+} DS_StrCache;
+
 /*
  * Information functions
  */
@@ -54,6 +82,7 @@ extern int DS_StrCompare (const DS_String* a, const DS_String* b);
  */
 extern int DS_StrRmBuf (DS_String* string);
 extern int DS_StrResize (DS_String* string, size_t size);
+extern int DS_StrReserve (DS_String* string, size_t capacity);
 extern int DS_StrAppend (DS_String* string, const uint8_t byte);
 extern int DS_StrJoin (DS_String* first, const DS_String* second);
 extern int DS_StrJoinCStr (DS_String* string, const char* cstring);
@@ -73,6 +102,15 @@ extern DS_String DS_StrNewLen (const size_t length);
 extern DS_String DS_StrDup (const DS_String* source);
 extern DS_String DS_StrFormat (const char* format, ...);
 
+/*
+ * Formatting into existing buffers
+ */
+extern size_t DS_StrFormatBuf (char* buffer, size_t size, const char* format, ...);
+extern size_t DS_StrFormatV (char* buffer, size_t size, const char* format, va_list args);
+extern int DS_StrFormatInto (DS_String* string, const char* format, ...);
+extern DS_String DS_StrCacheFormat (DS_StrCache* cache, const int key,
+                                    const char* format, ...);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,110 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_TELEMETRY_H
+#define _LIB_DS_TELEMETRY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "DS_Protocol.h"
+#include "DS_Joysticks.h"
+
+/*
+ * Shared memory layout:
+ *
+ * The exported segment holds a single DS_TelemetryBlock. The event loop
+ * updates it (at most every DS_TELEMETRY_INTERVAL msecs) with a sequence
+ * lock: the sequence is odd while the data is being written, and it grows
+ * with every update, so readers can also use it as a version counter.
+ *
+ * Readers copy the data without any system call, and retry if the sequence
+ * was odd or if it changed during the copy (see DS_TelemetryRead). The block
+ * uses the native types of the library, so readers must be built for the
+ * same architecture as the DS (e.g. both 64-bit).
+ */
+#define DS_TELEMETRY_MAGIC    0x4D544C44 /* "DLTM" */
+#define DS_TELEMETRY_VERSION  3
+#define DS_TELEMETRY_INTERVAL 20
+
+/**
+ * Holds the state published by the DS
+ */
+typedef struct _telemetry_data {
+    uint64_t time;                  /**< Time (in msecs) of the update */
+    int32_t team;                   /**< The team number */
+    int32_t robot_code;             /**< Set to \c 1 if robot code is running */
+    int32_t robot_enabled;          /**< Set to \c 1 if the robot is enabled */
+    int32_t emergency_stopped;      /**< Set to \c 1 if the robot is e-stopped */
+    int32_t fms_communications;     /**< Set to \c 1 if the FMS is connected */
+    int32_t radio_communications;   /**< Set to \c 1 if the radio is connected */
+    int32_t robot_communications;   /**< Set to \c 1 if the robot is connected */
+    int32_t cpu_usage;              /**< The CPU usage of the robot */
+    int32_t ram_usage;              /**< The RAM usage of the robot */
+    int32_t disk_usage;             /**< The disk usage of the robot */
+    int32_t can_utilization;        /**< The CAN utilization of the robot */
+    float robot_voltage;            /**< The voltage of the robot */
+    int32_t position;               /**< The team position (DS_Position) */
+    int32_t alliance;               /**< The team alliance (DS_Alliance) */
+    int32_t control_mode;           /**< The control mode (DS_ControlMode) */
+    DS_LatencyInfo robot_latency;   /**< Timing statistics of the robot */
+    DS_LossInfo robot_loss;         /**< Packet loss of the robot */
+    DS_JoystickSnapshot joysticks;  /**< State of the joysticks */
+} DS_TelemetryData;
+
+/**
+ * The contents of the shared memory segment
+ */
+typedef struct _telemetry_block {
+    uint32_t magic;           /**< Set to DS_TELEMETRY_MAGIC */
+    uint32_t version;         /**< Set to DS_TELEMETRY_VERSION */
+    uint32_t size;            /**< Size of the block (in bytes) */
+    volatile size_t sequence; /**< Odd while the data is being written */
+    DS_TelemetryData data;    /**< The published state */
+} DS_TelemetryBlock;
+
+/* Internal functions */
+extern void Telemetry_Close (void);
+extern void Telemetry_Update (void);
+extern int Telemetry_Remaining (void);
+
+/* Exporter functions */
+extern int DS_StartTelemetryExport (const char* name);
+extern void DS_StopTelemetryExport (void);
+extern int DS_TelemetryExportActive (void);
+
+/* Reader functions */
+extern const DS_TelemetryBlock* DS_TelemetryMap (const char* name);
+extern void DS_TelemetryUnmap (const DS_TelemetryBlock* block);
+extern size_t DS_TelemetryRead (const DS_TelemetryBlock* block,
+                                DS_TelemetryData* data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
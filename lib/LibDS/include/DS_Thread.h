@@ -0,0 +1,172 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_THREAD_H
+#define _LIB_DS_THREAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "DS_Atomic.h"
+
+/*
+ * Thin threading layer used by the LibDS, it maps to the native primitives
+ * of Windows (slim reader/writer locks, condition variables and one-time
+ * initialization) and to pthreads on every other platform, so that Windows
+ * builds do not need a pthreads emulation library.
+ *
+ * The Windows types are opaque (a thread handle, an SRWLOCK, a
+ * CONDITION_VARIABLE and an INIT_ONCE are a single pointer and a TLS index
+ * is a DWORD), so that this header does not include <windows.h> and does not
+ * change the Windows API level of the application.
+ */
+#if defined _WIN32
+    typedef void* DS_Thread;
+    typedef struct { void* ptr; } DS_Mutex;
+    typedef struct { void* ptr; } DS_Cond;
+    typedef struct { void* ptr; } DS_Once;
+    typedef unsigned long DS_ThreadKey;
+
+    #define DS_MUTEX_INITIALIZER { 0 }
+    #define DS_COND_INITIALIZER  { 0 }
+    #define DS_ONCE_INIT         { 0 }
+#else
+    #include <pthread.h>
+
+    typedef pthread_t DS_Thread;
+    typedef pthread_mutex_t DS_Mutex;
+    typedef pthread_cond_t DS_Cond;
+    typedef pthread_once_t DS_Once;
+    typedef pthread_key_t DS_ThreadKey;
+
+    #define DS_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+    #define DS_COND_INITIALIZER  PTHREAD_COND_INITIALIZER
+    #define DS_ONCE_INIT         PTHREAD_ONCE_INIT
+#endif
+
+/*
+ * Mutex and condition variable operations, these are used in every hot
+ * path of the library, so they are inlined (on Windows they are implemented
+ * in thread.c, since they need <windows.h>). DS_MutexLockCounted() also
+ * increments the given counter if the mutex is held by another thread (on
+ * Windows this needs Windows 7, older targets never count contentions).
+ */
+#if defined _WIN32
+extern void DS_MutexInit (DS_Mutex* mutex);
+extern void DS_MutexDestroy (DS_Mutex* mutex);
+extern void DS_MutexLock (DS_Mutex* mutex);
+extern void DS_MutexUnlock (DS_Mutex* mutex);
+extern void DS_MutexLockCounted (DS_Mutex* mutex, volatile size_t* contentions);
+extern void DS_CondInit (DS_Cond* cond);
+extern void DS_CondDestroy (DS_Cond* cond);
+extern void DS_CondSignal (DS_Cond* cond);
+extern void DS_CondBroadcast (DS_Cond* cond);
+extern void DS_CondWait (DS_Cond* cond, DS_Mutex* mutex);
+#else
+static inline void DS_MutexInit (DS_Mutex* mutex)
+{
+    pthread_mutex_init (mutex, NULL);
+}
+
+static inline void DS_MutexDestroy (DS_Mutex* mutex)
+{
+    pthread_mutex_destroy (mutex);
+}
+
+static inline void DS_MutexLock (DS_Mutex* mutex)
+{
+    pthread_mutex_lock (mutex);
+}
+
+static inline void DS_MutexUnlock (DS_Mutex* mutex)
+{
+    pthread_mutex_unlock (mutex);
+}
+
+static inline void DS_MutexLockCounted (DS_Mutex* mutex,
+                                        volatile size_t* contentions)
+{
+    if (pthread_mutex_trylock (mutex) != 0) {
+        DS_AtomicFetchAdd (contentions, 1);
+        pthread_mutex_lock (mutex);
+    }
+}
+
+static inline void DS_CondInit (DS_Cond* cond)
+{
+    pthread_cond_init (cond, NULL);
+}
+
+static inline void DS_CondDestroy (DS_Cond* cond)
+{
+    pthread_cond_destroy (cond);
+}
+
+static inline void DS_CondSignal (DS_Cond* cond)
+{
+    pthread_cond_signal (cond);
+}
+
+static inline void DS_CondBroadcast (DS_Cond* cond)
+{
+    pthread_cond_broadcast (cond);
+}
+
+static inline void DS_CondWait (DS_Cond* cond, DS_Mutex* mutex)
+{
+    pthread_cond_wait (cond, mutex);
+}
+#endif
+
+/*
+ * Name, OS thread ID and CPU time (user and system, in nanoseconds) of a
+ * running LibDS thread
+ */
+typedef struct {
+    char name [16];
+    uint64_t id;
+    uint64_t cpu_time;
+} DS_ThreadInfo;
+
+/* Threads */
+extern int DS_CreateThread (DS_Thread* thread,
+                            const char* name,
+                            void* (*func) (void*),
+                            void* arg);
+extern int DS_GetThreads (DS_ThreadInfo* list, const int max);
+extern void DS_JoinThread (DS_Thread thread);
+extern void DS_DetachThread (DS_Thread thread);
+
+/* One-time initialization and thread-local values */
+extern void DS_CallOnce (DS_Once* once, void (*func) (void));
+extern void DS_ThreadKeyCreate (DS_ThreadKey* key);
+extern void* DS_ThreadKeyGet (DS_ThreadKey key);
+extern void DS_ThreadKeySet (DS_ThreadKey key, void* value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -28,7 +28,8 @@
 extern "C" {
 #endif
 
-#include <pthread.h>
+#include <stdint.h>
+#include "DS_Thread.h"
 
 /**
  * Represents a tiemr and its properties
@@ -38,17 +39,41 @@ typedef struct _timer {
     int expired;      /**< Set to \c 1 if \a elapsed is greater than \a time */
     int enabled;      /**< Enabled state of the timer */
     int elapsed;      /**< Number of milliseconds elapsed since last reset */
-    int precision;    /**< The update interval (in milliseconds) */
+    int precision;    /**< Kept for compatibility, not used anymore */
     int initialized;  /**< Set to \c 1 if the timer has been initialized */
+    uint64_t start;   /**< Monotonic time (in msecs) of the last reset */
 } DS_Timer;
 
+/**
+ * Periodic work that is run on the timer thread, see \c DS_Schedule()
+ */
+typedef void (*DS_ScheduleCallback) (void* data);
+
 extern void Timers_Init (void);
 extern void Timers_Close (void);
+extern void Timers_CancelSchedules (void);
+extern void Timers_ClockJoin (void);
+extern void Timers_ClockLeave (void);
+extern size_t Timers_ClockStep (void);
+extern int Timers_ClockHandled (const size_t step, size_t* acked);
 extern void DS_Sleep (const int millisecs);
+extern uint64_t DS_GetTimeMs (void);
+extern uint64_t DS_GetTimeUs (void);
+extern uint64_t DS_GetWallTimeUs (void);
+extern int DS_VirtualClock (void);
+extern void DS_SetVirtualClock (const int enabled);
+extern void DS_AdvanceClock (const uint64_t usecs);
+extern void DS_TimedWait (DS_Cond* cond, DS_Mutex* mutex,
+                          const int millisecs);
 extern void DS_TimerStop (DS_Timer* timer);
 extern void DS_TimerStart (DS_Timer* timer);
 extern void DS_TimerReset (DS_Timer* timer);
+extern int DS_TimerRemaining (DS_Timer* timer);
 extern void DS_TimerInit (DS_Timer* timer, const int time, const int precision);
+extern void DS_TimerFree (DS_Timer* timer);
+extern int DS_Schedule (const int period, DS_ScheduleCallback callback,
+                        void* data);
+extern void DS_Unschedule (const int id);
 
 #ifdef __cplusplus
 }
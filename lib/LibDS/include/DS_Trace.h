@@ -0,0 +1,98 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_TRACE_H
+#define _LIB_DS_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/*
+ * Each thread records its events in its own ring buffer (which keeps the
+ * most recent DS_TRACE_BUFFER_EVENTS events), up to DS_TRACE_MAX_THREADS
+ * threads are traced
+ */
+#ifndef DS_TRACE_BUFFER_EVENTS
+    #define DS_TRACE_BUFFER_EVENTS 16384
+#endif
+#define DS_TRACE_MAX_THREADS 64
+
+extern void DS_StartTrace (void);
+extern void DS_StopTrace (void);
+extern int DS_TraceActive (void);
+extern int DS_SaveTrace (const char* path);
+extern void DS_TraceThreadName (const char* name);
+extern void DS_TraceEvent (const char* name, const char phase);
+
+/*
+ * Instrumentation macros, they are only compiled in builds that define
+ * DS_ENABLE_TRACE (the names must be string literals, which are recorded
+ * by address)
+ */
+#if defined DS_ENABLE_TRACE
+    #define DS_TRACE_BEGIN(name)   DS_TraceEvent (name, 'B')
+    #define DS_TRACE_END(name)     DS_TraceEvent (name, 'E')
+    #define DS_TRACE_INSTANT(name) DS_TraceEvent (name, 'i')
+    #define DS_TRACE_THREAD(name)  DS_TraceThreadName (name)
+#else
+    #define DS_TRACE_BEGIN(name)   ((void) 0)
+    #define DS_TRACE_END(name)     ((void) 0)
+    #define DS_TRACE_INSTANT(name) ((void) 0)
+    #define DS_TRACE_THREAD(name)  ((void) 0)
+#endif
+
+#ifdef __cplusplus
+}
+
+/**
+ * Records a begin event when constructed and an end event when destroyed,
+ * use it through \c DS_TRACE_SCOPE()
+ */
+class DS_TraceScope
+{
+public:
+    explicit DS_TraceScope (const char* name) : m_name (name)
+    {
+        DS_TraceEvent (m_name, 'B');
+    }
+
+    ~DS_TraceScope()
+    {
+        DS_TraceEvent (m_name, 'E');
+    }
+
+private:
+    const char* m_name;
+};
+
+#if defined DS_ENABLE_TRACE
+    #define DS_TRACE_SCOPE(name) DS_TraceScope _ds_trace_scope (name)
+#else
+    #define DS_TRACE_SCOPE(name) ((void) 0)
+#endif
+#endif
+
+#endif
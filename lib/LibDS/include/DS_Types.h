@@ -45,11 +45,46 @@ typedef enum {
     DS_POSITION_3,
 } DS_Position;
 
+typedef enum {
+    DS_MATCH_NONE,
+    DS_MATCH_PRACTICE,
+    DS_MATCH_QUALIFICATION,
+    DS_MATCH_ELIMINATION,
+} DS_MatchType;
+
+/**
+ * Match state reported by the FMS
+ */
+typedef struct {
+    DS_MatchType match_type; /**< Tournament level of the match */
+    int match_number;        /**< Number of the match */
+    int replay_number;       /**< Replay (play) number of the match */
+    int time_remaining;      /**< Seconds left in the period, -1 if unknown */
+} DS_FMSMatch;
+
 typedef enum {
     DS_SOCKET_UDP,
     DS_SOCKET_TCP,
+    DS_SOCKET_ICMP,
 } DS_SocketType;
 
+/**
+ * Robot/DS status reported by \c DS_GetStatus(), the name of each status
+ * is a constant string (see \c DS_GetStatusName())
+ */
+typedef enum {
+    DS_STATUS_NO_COMMUNICATIONS,
+    DS_STATUS_NO_CODE,
+    DS_STATUS_TELEOPERATED_ENABLED,
+    DS_STATUS_TELEOPERATED_DISABLED,
+    DS_STATUS_AUTONOMOUS_ENABLED,
+    DS_STATUS_AUTONOMOUS_DISABLED,
+    DS_STATUS_TEST_ENABLED,
+    DS_STATUS_TEST_DISABLED,
+    DS_STATUS_ERROR,
+    DS_STATUS_COUNT,
+} DS_Status;
+
 #ifdef __cplusplus
 }
 #endif
@@ -40,7 +40,53 @@ extern "C" {
 #define DS_FallBackAddress "0.0.0.0"
 #define DS_Max(a,b) ((a) > (b) ? a : b)
 #define DS_Min(a,b) ((a) < (b) ? a : b)
-#define DS_FREE(p) if (p) { free (p); p = NULL; }
+
+/*
+ * Subsystems that own the memory allocated by the LibDS
+ */
+typedef enum {
+    DS_MEMORY_GENERAL,
+    DS_MEMORY_STRINGS,
+    DS_MEMORY_QUEUES,
+    DS_MEMORY_ARRAYS,
+    DS_MEMORY_SUBSYSTEM_COUNT,
+} DS_MemorySubsystem;
+
+/*
+ * Allocation counters of a subsystem
+ */
+typedef struct {
+    size_t live_bytes;
+    size_t peak_bytes;
+    size_t live_allocations;
+    size_t total_allocations;
+} DS_MemoryStats;
+
+/*
+ * Builds with DS_STATIC_MEMORY take every block from a static pool instead
+ * of the heap (e.g. for embedded targets), the pool needs the block sizes
+ * that are recorded by the memory tracker
+ */
+#if defined DS_STATIC_MEMORY && !defined DS_TRACK_MEMORY
+    #define DS_TRACK_MEMORY
+#endif
+
+/*
+ * Memory allocation macros, builds with DS_TRACK_MEMORY keep track of the
+ * live bytes and allocations of each subsystem. Memory returned by the LibDS
+ * must always be released with DS_FREE.
+ */
+#if defined DS_TRACK_MEMORY
+    #define DS_MALLOC(s,size) DS_Allocate (s, size, 0)
+    #define DS_CALLOC(s,n,size) DS_Allocate (s, (n) * (size), 1)
+    #define DS_REALLOC(s,p,size) DS_Reallocate (s, p, size)
+    #define DS_FREE(p) if (p) { DS_Deallocate (p); p = NULL; }
+#else
+    #define DS_MALLOC(s,size) malloc (size)
+    #define DS_CALLOC(s,n,size) calloc (n, size)
+    #define DS_REALLOC(s,p,size) realloc (p, size)
+    #define DS_FREE(p) if (p) { free (p); p = NULL; }
+#endif
 
 /*
  * Icon types for message boxes
@@ -51,16 +97,43 @@ typedef enum {
     DS_ICON_ERROR,
 } DS_IconType;
 
+/*
+ * Memory tracking functions
+ */
+#if defined DS_TRACK_MEMORY
+extern void DS_Deallocate (void* ptr);
+extern void* DS_Allocate (const DS_MemorySubsystem subsystem,
+                          const size_t size,
+                          const int zero);
+extern void* DS_Reallocate (const DS_MemorySubsystem subsystem,
+                            void* ptr,
+                            const size_t size);
+#endif
+extern void DS_PrintMemoryStats (void);
+extern size_t DS_GetStaticPoolStats (DS_MemoryStats* info);
+extern void DS_GetMemoryStats (const DS_MemorySubsystem subsystem,
+                               DS_MemoryStats* info);
+
 /*
  * Misc functions
  */
 extern uint32_t DS_CRC32 (const void* buf, size_t size);
+extern uint32_t DS_CRC32Update (const uint32_t crc, const void* buf,
+                                size_t size);
 extern uint8_t DS_FloatToByte (const float val, const float max);
+extern void DS_FloatsToBytes (const float* values, uint8_t* bytes,
+                              const size_t count, const float max);
 extern DS_String DS_GetStaticIP (const int net, const int team, const int host);
 extern void DS_ShowMessageBox (const DS_String* caption,
                                const DS_String* message,
                                const DS_IconType icon);
 
+/*
+ * Thread scheduling functions (applied to the calling thread)
+ */
+extern int DS_SetThreadRealtime (const int enabled);
+extern int DS_SetThreadAffinity (const int cpu);
+
 #ifdef __cplusplus
 }
 #endif
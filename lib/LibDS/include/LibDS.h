@@ -30,12 +30,31 @@ extern "C" {
 
 #include "DS_Timer.h"
 #include "DS_Types.h"
+#include "DS_Thread.h"
 #include "DS_Utils.h"
 #include "DS_Events.h"
 #include "DS_Client.h"
+#include "DS_Capture.h"
+#include "DS_Context.h"
 #include "DS_Socket.h"
 #include "DS_Protocol.h"
+#include "DS_Registry.h"
 #include "DS_Joysticks.h"
+#include "DS_Macro.h"
+#include "DS_NetConsole.h"
+#include "DS_Messages.h"
+#include "DS_Metrics.h"
+#include "DS_Telemetry.h"
+#include "DS_Bandwidth.h"
+#include "DS_Brownout.h"
+#include "DS_History.h"
+#include "DS_Lifecycle.h"
+#include "DS_Match.h"
+#include "DS_Evdev.h"
+#include "DS_SelfTest.h"
+#include "DS_Dashboard.h"
+#include "DS_Trace.h"
+#include "DS_Stats.h"
 #include "DS_DefaultProtocols.h"
 
 extern void DS_Init (void);
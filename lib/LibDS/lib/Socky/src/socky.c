@@ -20,11 +20,21 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#if defined __linux__ && !defined _GNU_SOURCE
+    #define _GNU_SOURCE /* For sendmmsg and recvmmsg */
+#endif
+
 #include "socky.h"
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
-#include <pthread.h>
+
+#if defined _WIN32
+    #include <process.h>
+#else
+    #include <pthread.h>
+#endif
 
 #if defined _WIN32
     static WSADATA WSA_DATA;
@@ -43,6 +53,28 @@ static int valid_sfd (int sfd)
     return (sfd > 0);
 }
 
+/**
+ * Returns \c 1 if the given socket has a pending datagram, this is used to
+ * stop a batched receive operation without blocking
+ *
+ * \param sfd the socket file descriptor
+ */
+#if !defined SOCKY_HAS_MMSG
+static int datagram_pending (int sfd)
+{
+#if defined _WIN32
+    u_long bytes = 0;
+    if (ioctlsocket (sfd, FIONREAD, &bytes) != 0)
+        return 0;
+
+    return (bytes > 0);
+#else
+    char byte;
+    return (recv (sfd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) >= 0);
+#endif
+}
+#endif
+
 /**
  * Prints a detailed error message if \c VERBOSE is defined
  */
@@ -203,6 +235,13 @@ static int create_server (const char* port, const int family,
         if (!valid_sfd (sfd) || (set_socket_options (sfd) == -1))
             continue;
 
+        /* Only accept IPv6 traffic, so that an IPv4 server can use the port */
+        if (info->ai_family == AF_INET6) {
+            int v6only = 1;
+            setsockopt (sfd, IPPROTO_IPV6, IPV6_V6ONLY,
+                        (const char*) &v6only, sizeof (v6only));
+        }
+
         /* Bound without error, break loop */
         if (bind (sfd, info->ai_addr, info->ai_addrlen) == 0) {
             /* Configure the TCP listener */
@@ -233,16 +272,22 @@ static int create_server (const char* port, const int family,
 }
 
 /**
- * Casts the given \a data pointer into an int containing the
- * socket file descriptor and closes it
+ * Casts the given \a data pointer into the socket file descriptor that it
+ * holds and closes it
  */
+#if defined _WIN32
+static unsigned __stdcall close_socket (void* data)
+{
+    socket_close ((int) (intptr_t) data);
+    return 0;
+}
+#else
 static void* close_socket (void* data)
 {
-    assert (data);
-    int* sfd = (int*) data;
-    socket_close (*sfd);
+    socket_close ((int) (intptr_t) data);
     return NULL;
 }
+#endif
 
 /**
  * If compiling on Windows, this function closes the WinSock API.
@@ -302,6 +347,141 @@ int set_socket_block (const int sfd, const int block)
 #endif
 }
 
+/**
+ * Changes the size of the kernel receive and send buffers of the given
+ * socket, a size of \c 0 keeps the system default
+ *
+ * \param sfd the socket file descriptor
+ * \param recv_size the receive buffer size (in bytes)
+ * \param send_size the send buffer size (in bytes)
+ *
+ * \returns \c 0 on success, \c -1 if any option could not be set
+ */
+int set_socket_buffers (const int sfd, const int recv_size,
+                        const int send_size)
+{
+    int err = 0;
+
+    if (!valid_sfd (sfd))
+        return -1;
+
+    if (recv_size > 0)
+        err |= setsockopt (sfd, SOL_SOCKET, SO_RCVBUF,
+                           (const char*) &recv_size, sizeof (recv_size));
+
+    if (send_size > 0)
+        err |= setsockopt (sfd, SOL_SOCKET, SO_SNDBUF,
+                           (const char*) &send_size, sizeof (send_size));
+
+    if (err != 0) {
+        print_error (sfd, "cannot set socket buffer sizes", GET_ERR);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Sets the IPv4 type-of-service byte (or the IPv6 traffic class) of the
+ * packets sent by the given socket, the DSCP code point is stored in the
+ * upper six bits
+ *
+ * \note Windows ignores this option unless the QoS policy allows it
+ *
+ * \param sfd the socket file descriptor
+ * \param tos the type-of-service byte
+ *
+ * \returns \c 0 on success, \c -1 on failure
+ */
+int set_socket_tos (const int sfd, const int tos)
+{
+    if (!valid_sfd (sfd))
+        return -1;
+
+    /* IPv6 sockets use the traffic class instead */
+    int level = IPPROTO_IP;
+    int option = IP_TOS;
+#if defined IPV6_TCLASS
+    struct sockaddr_storage addr;
+    socklen_t len = sizeof (addr);
+    memset (&addr, 0, sizeof (addr));
+    if (getsockname (sfd, (struct sockaddr*) &addr, &len) == 0 &&
+        addr.ss_family == AF_INET6) {
+        level = IPPROTO_IPV6;
+        option = IPV6_TCLASS;
+    }
+#endif
+
+    if (setsockopt (sfd, level, option,
+                    (const char*) &tos, sizeof (tos)) != 0) {
+        print_error (sfd, "cannot set type-of-service", GET_ERR);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Enables busy-polling on the given socket, which makes the kernel poll the
+ * network device for up to \a usecs microseconds instead of waiting for an
+ * interrupt when the socket has no data
+ *
+ * \note This option is only available on Linux, and may require elevated
+ *       privileges on some systems
+ *
+ * \param sfd the socket file descriptor
+ * \param usecs the busy-polling time in microseconds
+ *
+ * \returns \c 0 on success, \c -1 on failure (or on unsupported systems)
+ */
+int set_socket_busy_poll (const int sfd, const int usecs)
+{
+    if (!valid_sfd (sfd))
+        return -1;
+
+#if defined __linux__ && defined SO_BUSY_POLL
+    if (setsockopt (sfd, SOL_SOCKET, SO_BUSY_POLL, &usecs, sizeof (usecs)) != 0) {
+        print_error (sfd, "cannot enable busy-polling", GET_ERR);
+        return -1;
+    }
+
+    return 0;
+#else
+    (void) usecs;
+    return -1;
+#endif
+}
+
+/**
+ * Makes the kernel stamp every datagram received by the given socket with
+ * its arrival time, which is reported by \c udp_recv_batch(). This is only
+ * supported where the datagrams are received with \c recvmmsg()
+ *
+ * \param sfd the socket file descriptor
+ * \param enabled set to \c 1 to enable the timestamps
+ *
+ * \returns \c 0 on success, \c -1 on failure (or if not supported)
+ */
+int set_socket_timestamps (const int sfd, const int enabled)
+{
+    if (!valid_sfd (sfd))
+        return -1;
+
+#if defined SOCKY_HAS_MMSG && defined SO_TIMESTAMPNS
+    int value = enabled ? 1 : 0;
+    if (setsockopt (sfd, SOL_SOCKET, SO_TIMESTAMPNS, &value,
+                    sizeof (value)) != 0) {
+        print_error (sfd, "cannot enable receive timestamps", GET_ERR);
+        return -1;
+    }
+
+    return 0;
+#else
+    (void) enabled;
+    return -1;
+#endif
+}
+
 /**
  * Obtains the address information for the given \a host, \a service and
  * address \a family
@@ -385,6 +565,31 @@ int create_client_udp (const int family, const int flags)
     return sfd;
 }
 
+/**
+ * Creates a new (IPv4) ICMP socket, which can send echo requests and receive
+ * their replies. An unprivileged ICMP datagram socket is used if the system
+ * allows it, otherwise a raw socket is created (which requires special
+ * privileges). The datagrams read from a raw socket include the IP header.
+ *
+ * \param flags the additional flags to use while creating the socket
+ */
+int create_client_icmp (const int flags)
+{
+    /* Try to create an ICMP datagram socket, then a raw socket */
+    int sfd = socket (AF_INET, SOCK_DGRAM | flags, IPPROTO_ICMP);
+    if (!valid_sfd (sfd))
+        sfd = socket (AF_INET, SOCK_RAW | flags, IPPROTO_ICMP);
+
+    /* We are not allowed to send ICMP messages */
+    if (!valid_sfd (sfd)) {
+        print_error (sfd, "cannot create ICMP socket", GET_ERR);
+        return -1;
+    }
+
+    /* Return the socket file descriptor */
+    return sfd;
+}
+
 /**
  * Creates a new TCP socket and connects it to the given \a host and \a port
  *
@@ -495,18 +700,32 @@ int socket_close (const int sfd)
 }
 
 /**
- * Closes the given \a sfd in a different thread
+ * Closes the given \a sfd in a different (detached) thread
  */
 void socket_close_threaded (int sfd)
 {
-    /* Try to close the socket on different thread */
+    /* Try to close the socket on different thread (pass the value, the
+     * thread may start after this function returns) */
+#if defined _WIN32
+    HANDLE thread = (HANDLE) _beginthreadex (NULL, 0, &close_socket,
+                                             (void*) (intptr_t) sfd, 0, NULL);
+
+    /* Close socket normally if there is an error */
+    if (!thread)
+        socket_close (sfd);
+    else
+        CloseHandle (thread);
+#else
     pthread_t thread;
     int error = pthread_create (&thread, NULL,
-                                &close_socket, (void*) &sfd);
+                                &close_socket, (void*) (intptr_t) sfd);
 
     /* Close socket normally if there is an error */
     if (error)
-        shutdown (sfd, SOCKY_READ | SOCKY_WRITE);
+        socket_close (sfd);
+    else
+        pthread_detach (thread);
+#endif
 }
 
 /**
@@ -567,6 +786,84 @@ int tcp_accept (const int sfd, char* host, const int host_len,
     return client_sfd;
 }
 
+/**
+ * Creates a non-blocking TCP socket and starts connecting it to the given
+ * (already resolved) address, without waiting for the connection.
+ *
+ * Wait until the socket is writable and call \c tcp_connect_status() to
+ * know if the connection was established.
+ *
+ * \param addr the remote address
+ * \param addr_len the size of the remote address
+ * \param flags any additional flags that you may need to use
+ *
+ * \returns a new socket file descriptor on success, -1 on failure
+ */
+int tcp_connect_async (const struct sockaddr* addr, const int addr_len,
+                       const int flags)
+{
+    /* Create new socket */
+    int sfd = socket (addr->sa_family, SOCK_STREAM | flags, 0);
+    if (!valid_sfd (sfd)) {
+        print_error (sfd, "cannot create TCP client socket", GET_ERR);
+        return -1;
+    }
+
+    /* Disable socket blocking */
+#if defined _WIN32
+    u_long nonblock = 1;
+    int error = ioctlsocket (sfd, FIONBIO, &nonblock);
+#else
+    int error = fcntl (sfd, F_SETFL, fcntl (sfd, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+    if (error != 0) {
+        socket_close (sfd);
+        return -1;
+    }
+
+    /* Start connecting (an immediate connection is fine too) */
+    if (connect (sfd, addr, addr_len) != 0 && !socket_would_block()) {
+        print_error (sfd, "cannot connect to address", GET_ERR);
+        socket_close (sfd);
+        return -1;
+    }
+
+    return sfd;
+}
+
+/**
+ * Returns the result of a connection started with \c tcp_connect_async()
+ *
+ * \param sfd the socket file descriptor, which must be writable
+ *
+ * \returns \c 0 if the socket is connected, \c -1 if the connection failed
+ */
+int tcp_connect_status (const int sfd)
+{
+    int error = 0;
+    socklen_t len = sizeof (error);
+
+    if (getsockopt (sfd, SOL_SOCKET, SO_ERROR, (char*) &error, &len) != 0)
+        return -1;
+
+    return (error == 0) ? 0 : -1;
+}
+
+/**
+ * Returns \c 1 if the last socket operation of the calling thread failed
+ * only because it would block (or because a connection is in progress)
+ */
+int socket_would_block (void)
+{
+#if defined _WIN32
+    int error = WSAGetLastError();
+    return (error == WSAEWOULDBLOCK || error == WSAEINPROGRESS);
+#else
+    return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINPROGRESS);
+#endif
+}
+
 /**
  * Re-implements the \c sendto function
  *
@@ -642,3 +939,172 @@ int udp_recvfrom (const int sfd, char* buf, const int buf_len,
     freeaddrinfo (info);
     return bytes;
 }
+
+/**
+ * Sends the given \a datagrams with as few system calls as possible (a
+ * single \c sendmmsg call on Linux). The \c result of each datagram is set
+ * to the number of bytes sent.
+ *
+ * If the \c addr of a datagram is \c NULL, the datagram is sent to the
+ * address of the connected socket.
+ *
+ * \param sfd the socket descriptor
+ * \param datagrams the datagrams to send
+ * \param count the number of datagrams
+ * \param flags any additional flags that you may need to use
+ *
+ * \returns the number of datagrams sent, or \c -1 on error
+ */
+int udp_send_batch (const int sfd, socky_datagram* datagrams,
+                    const int count, const int flags)
+{
+    /* Check if socket and datagrams are valid */
+    if (!valid_sfd (sfd) || datagrams == NULL || count <= 0)
+        return -1;
+
+    int i;
+
+#if defined SOCKY_HAS_MMSG
+    struct mmsghdr msgs [count];
+    struct iovec iovs [count];
+    memset (msgs, 0, sizeof (msgs));
+
+    /* Fill the message headers */
+    for (i = 0; i < count; ++i) {
+        iovs [i].iov_base = datagrams [i].buf;
+        iovs [i].iov_len = datagrams [i].len;
+        msgs [i].msg_hdr.msg_iov = &iovs [i];
+        msgs [i].msg_hdr.msg_iovlen = 1;
+        msgs [i].msg_hdr.msg_name = datagrams [i].addr;
+        msgs [i].msg_hdr.msg_namelen = datagrams [i].addr ?
+                                       datagrams [i].addr_len : 0;
+    }
+
+    /* Send the datagrams */
+    int sent = sendmmsg (sfd, msgs, count, flags);
+    for (i = 0; i < sent; ++i)
+        datagrams [i].result = (int) msgs [i].msg_len;
+
+    return sent;
+#else
+    /* Send each datagram */
+    for (i = 0; i < count; ++i) {
+        int bytes;
+        if (datagrams [i].addr) {
+            bytes = sendto (sfd, datagrams [i].buf, datagrams [i].len, flags,
+                            datagrams [i].addr, datagrams [i].addr_len);
+        }
+
+        else
+            bytes = send (sfd, datagrams [i].buf, datagrams [i].len, flags);
+
+        if (bytes < 0)
+            break;
+
+        datagrams [i].result = bytes;
+    }
+
+    return (i > 0) ? i : -1;
+#endif
+}
+
+/**
+ * Receives up to \a count pending datagrams with as few system calls as
+ * possible (a single \c recvmmsg call on Linux). This function only waits
+ * for the first datagram (if the socket is blocking), and returns as soon as
+ * there are no more pending datagrams.
+ *
+ * The \c result of each datagram is set to the number of received bytes,
+ * and if the \c addr of a datagram is not \c NULL, the sender address is
+ * written to it.
+ *
+ * \param sfd the socket descriptor
+ * \param datagrams the buffers in which to receive the datagrams
+ * \param count the maximum number of datagrams to receive
+ * \param flags any additional flags that you may need to use
+ *
+ * \returns the number of datagrams received, or \c -1 on error
+ */
+int udp_recv_batch (const int sfd, socky_datagram* datagrams,
+                    const int count, const int flags)
+{
+    /* Check if socket and datagrams are valid */
+    if (!valid_sfd (sfd) || datagrams == NULL || count <= 0)
+        return -1;
+
+    int i;
+
+#if defined SOCKY_HAS_MMSG
+    struct mmsghdr msgs [count];
+    struct iovec iovs [count];
+    char controls [count][CMSG_SPACE (sizeof (struct timespec))];
+    memset (msgs, 0, sizeof (msgs));
+
+    /* Fill the message headers */
+    for (i = 0; i < count; ++i) {
+        iovs [i].iov_base = datagrams [i].buf;
+        iovs [i].iov_len = datagrams [i].len;
+        msgs [i].msg_hdr.msg_iov = &iovs [i];
+        msgs [i].msg_hdr.msg_iovlen = 1;
+        msgs [i].msg_hdr.msg_name = datagrams [i].addr;
+        msgs [i].msg_hdr.msg_namelen = datagrams [i].addr ?
+                                       datagrams [i].addr_len : 0;
+        msgs [i].msg_hdr.msg_control = controls [i];
+        msgs [i].msg_hdr.msg_controllen = sizeof (controls [i]);
+    }
+
+    /* Receive the pending datagrams */
+    int received = recvmmsg (sfd, msgs, count, flags | MSG_WAITFORONE, NULL);
+    for (i = 0; i < received; ++i) {
+        datagrams [i].result = (int) msgs [i].msg_len;
+        datagrams [i].addr_len = (int) msgs [i].msg_hdr.msg_namelen;
+        datagrams [i].time = 0;
+
+#if defined SCM_TIMESTAMPNS
+        /* Get the receive timestamp (if enabled) */
+        struct cmsghdr* cmsg;
+        for (cmsg = CMSG_FIRSTHDR (&msgs [i].msg_hdr); cmsg;
+                cmsg = CMSG_NXTHDR (&msgs [i].msg_hdr, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET &&
+                    cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                struct timespec ts;
+                memcpy (&ts, CMSG_DATA (cmsg), sizeof (ts));
+                datagrams [i].time = (uint64_t) ts.tv_sec * 1000000 +
+                                     (uint64_t) ts.tv_nsec / 1000;
+            }
+        }
+#endif
+    }
+
+    return received;
+#else
+    /* Receive datagrams until there are no more pending datagrams */
+    for (i = 0; i < count; ++i) {
+        if (i > 0 && !datagram_pending (sfd))
+            break;
+
+        int bytes;
+        if (datagrams [i].addr) {
+#if defined _WIN32
+            int len = datagrams [i].addr_len;
+#else
+            socklen_t len = datagrams [i].addr_len;
+#endif
+            bytes = recvfrom (sfd, datagrams [i].buf, datagrams [i].len, flags,
+                              datagrams [i].addr, &len);
+            datagrams [i].addr_len = (int) len;
+        }
+
+        else
+            bytes = recv (sfd, datagrams [i].buf, datagrams [i].len, flags);
+
+        if (bytes < 0)
+            break;
+
+        datagrams [i].result = bytes;
+        datagrams [i].time = 0;
+    }
+
+    return (i > 0) ? i : -1;
+#endif
+}
@@ -28,6 +28,7 @@ extern "C" {
 #endif
 
 #include <stdio.h>
+#include <stdint.h>
 
 /* Includes */
 #if defined _WIN32
@@ -41,6 +42,7 @@ extern "C" {
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <netinet/in.h>
 #endif
 
 /* Socket types */
@@ -59,16 +61,38 @@ extern "C" {
 /* Set listen() backlog value */
 #define SOCKY_BACKLOG 128
 
+/* Batched datagram functions use sendmmsg/recvmmsg on Linux */
+#if defined __linux__ && !defined __ANDROID__
+#define SOCKY_HAS_MMSG 1
+#endif
+
+/* A datagram of a batched send/receive operation */
+typedef struct {
+    char* buf;             /* Data to send, or buffer in which to receive */
+    int len;               /* Length of the data, or size of the buffer */
+    int result;            /* Number of bytes sent or received */
+    struct sockaddr* addr; /* Destination or source address (can be NULL) */
+    int addr_len;          /* Size of the address (updated when receiving) */
+    uint64_t time;         /* Kernel receive time (usecs since the epoch),
+                              0 if the socket has no receive timestamps */
+} socky_datagram;
+
 /* Misc functions */
 extern int sockets_exit (void);
 extern int sockets_init (const int exit_on_fail);
 extern int set_socket_block (const int sfd, const int block);
+extern int set_socket_buffers (const int sfd, const int recv_size,
+                               const int send_size);
+extern int set_socket_tos (const int sfd, const int tos);
+extern int set_socket_busy_poll (const int sfd, const int usecs);
+extern int set_socket_timestamps (const int sfd, const int enabled);
 extern struct addrinfo* get_address_info (const char* host,
                                           const char* service,
                                           int socktype, int family);
 
 /* Socket initialization functions */
 extern int create_client_udp (const int family, const int flags);
+extern int create_client_icmp (const int flags);
 extern int create_client_tcp (const char* host, const char* port,
                               const int family, const int flags);
 extern int create_server_udp (const char* port, const int family,
@@ -84,6 +108,10 @@ extern int socket_shutdown (const int sfd, const int method);
 /* Special TCP functions */
 extern int tcp_accept  (const int sfd, char* host, const int host_len,
                         char* service, const int service_len, const int flags);
+extern int tcp_connect_async (const struct sockaddr* addr, const int addr_len,
+                              const int flags);
+extern int tcp_connect_status (const int sfd);
+extern int socket_would_block (void);
 
 /* Re-implementation of sendto */
 extern int udp_sendto (const int sfd, const char* buf, const int buf_len,
@@ -93,6 +121,12 @@ extern int udp_sendto (const int sfd, const char* buf, const int buf_len,
 extern int udp_recvfrom (const int sfd, char* buf, const int buf_len,
                          const char* host, const char* service, const int flags);
 
+/* Batched datagram I/O */
+extern int udp_send_batch (const int sfd, socky_datagram* datagrams,
+                           const int count, const int flags);
+extern int udp_recv_batch (const int sfd, socky_datagram* datagrams,
+                           const int count, const int flags);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,894 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Golden-capture regression and performance tool for the protocols.
+ *
+ * Each capture file (see DS_StartCapture()) is replayed with every protocol:
+ * the received FMS, radio and robot packets are given to the decoders and a
+ * packet is generated by the protocol wherever the capture contains a sent
+ * packet of the same channel. The generated packets (and the messages of the
+ * robot stream, written before and after the replay) are compared byte for
+ * byte with the golden file of the capture and protocol, which is stored
+ * next to the capture as "<capture>.<protocol>.golden".
+ *
+ * Each replay starts with a new DS context in a fixed state (the team number
+ * of the capture, robot enabled in teleoperated), so the output only depends
+ * on the capture and on the protocol code. The payloads of the date and
+ * timezone tags are masked, since they depend on the clock (the timezone is
+ * set to UTC, so that the size of the timezone tag is the same on every host).
+ *
+ * If a baseline file is given, the time needed to decode the received
+ * packets and to generate the sent packets of each capture is measured
+ * (best of several runs) and compared with the time stored in the baseline.
+ *
+ * Usage: libds-regress [--update] [--baseline <file>] [--threshold <percent>]
+ *                      <capture> [<capture> ...]
+ *
+ *   --update     writes the golden files (and the baseline) instead of
+ *                comparing them, use it when a wire format change is intended
+ *   --baseline   file with the encode/decode times (in ns per packet)
+ *   --threshold  maximum slowdown over the baseline (default: 20 percent)
+ *
+ * The exit code is non-zero if a generated packet differs from its golden
+ * file, if a golden file is missing or if a protocol became slower than
+ * allowed by the threshold.
+ *
+ * Before the captures are replayed, the string formatter used to generate
+ * the packets and addresses is checked with numbers that need long
+ * representations (these overflowed its buffer in the past).
+ */
+
+#include <LibDS.h>
+#include <DS_Config.h>
+
+#include <math.h>
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Number of protocols, number of timed runs (the best one is kept), minimum
+ * duration of a timed run and default slowdown threshold (in percent)
+ */
+#define PROTOCOL_COUNT     4
+#define TIMING_RUNS        5
+#define MIN_DURATION_US    200000ULL
+#define DEFAULT_THRESHOLD  20.0
+
+/*
+ * Channel used in the golden files for the messages of the robot stream
+ */
+#define CHANNEL_STREAM     DS_CAPTURE_CHANNEL_COUNT
+
+/*
+ * Tags of the FRC 2015 (and newer) robot packets whose payload is masked and
+ * size of the robot packet header (index, general tag, control, request and
+ * station bytes)
+ */
+#define TAG_DATE           0x0f
+#define TAG_TIMEZONE       0x10
+#define ROBOT_HEADER_SIZE  6
+
+/*
+ * A protocol tested by the tool
+ */
+typedef struct {
+    const char* id;              /**< Suffix of the golden files */
+    DS_Protocol (*get) (void);   /**< Returns the protocol */
+    int date_tags;               /**< Robot packets may contain a date tag */
+} Target;
+
+/*
+ * A growable byte buffer
+ */
+typedef struct {
+    uint8_t* data;
+    size_t len;
+    size_t cap;
+} Buffer;
+
+/*
+ * Encode/decode times of a capture and protocol (in ns per packet)
+ */
+typedef struct {
+    char key [256];
+    double encode_ns;
+    double decode_ns;
+} Timing;
+
+/*
+ * Tested protocols
+ */
+static const Target targets [PROTOCOL_COUNT] = {
+    { "frc2014", &DS_GetProtocolFRC_2014, 0 },
+    { "frc2015", &DS_GetProtocolFRC_2015, 1 },
+    { "frc2016", &DS_GetProtocolFRC_2016, 1 },
+    { "frc2020", &DS_GetProtocolFRC_2020, 1 },
+};
+
+/*
+ * Names of the channels in the golden files
+ */
+static const char* channel_names [DS_CAPTURE_CHANNEL_COUNT + 1] = {
+    "FMS packet", "radio packet", "robot packet", "NetConsole message",
+    "robot stream message"
+};
+
+/*
+ * Options
+ */
+static int update = 0;
+static double threshold = DEFAULT_THRESHOLD;
+static const char* baseline_path = NULL;
+
+/*
+ * Baseline timings
+ */
+static Timing* timings = NULL;
+static size_t timing_count = 0;
+
+/**
+ * Appends \a size bytes of \a data to the given \a buffer, the program is
+ * aborted if the memory cannot be allocated
+ */
+static void buffer_append (Buffer* buffer, const void* data, const size_t size)
+{
+    if (buffer->len + size > buffer->cap) {
+        size_t cap = buffer->cap ? buffer->cap : 4096;
+        while (cap < buffer->len + size)
+            cap *= 2;
+
+        buffer->data = (uint8_t*) realloc (buffer->data, cap);
+        buffer->cap = cap;
+
+        if (!buffer->data) {
+            fprintf (stderr, "Out of memory\n");
+            exit (EXIT_FAILURE);
+        }
+    }
+
+    if (size > 0)
+        memcpy (buffer->data + buffer->len, data, size);
+
+    buffer->len += size;
+}
+
+/**
+ * Zeroes the payload of the date and timezone tags of the given robot
+ * \a packet, which change with the clock and with the host
+ */
+static void mask_date_tags (uint8_t* packet, const size_t size)
+{
+    size_t offset = ROBOT_HEADER_SIZE;
+
+    /* Each tag is made of its size (including the ID), its ID and payload */
+    while (offset + 1 < size) {
+        size_t tag_size = packet [offset];
+        uint8_t id = packet [offset + 1];
+
+        if (tag_size == 0 || offset + 1 + tag_size > size)
+            break;
+
+        if (id == TAG_DATE || id == TAG_TIMEZONE)
+            memset (packet + offset + 2, 0, tag_size - 1);
+
+        offset += tag_size + 1;
+    }
+}
+
+/**
+ * Appends a generated packet to the given \a output, as a golden file record:
+ * the channel (u8), the length (u16, little-endian) and the data
+ */
+static void add_record (Buffer* output, const int channel,
+                        const uint8_t* data, const size_t size)
+{
+    uint8_t header [3];
+
+    header [0] = (uint8_t) channel;
+    header [1] = (uint8_t) (size & 0xff);
+    header [2] = (uint8_t) (size >> 8);
+
+    buffer_append (output, header, sizeof (header));
+    buffer_append (output, data, size);
+}
+
+/**
+ * Generates a packet for the given \a channel with the given \a protocol, in
+ * the same way as the protocols module: with its write function if the
+ * protocol provides it, or with its create function otherwise. If
+ * \a output is not \c NULL, the packet is appended to it.
+ */
+static void encode (const Target* target, const DS_Protocol* protocol,
+                    const int channel, Buffer* output)
+{
+    DS_Packet packet;
+    uint8_t buffer [DS_PACKET_MAX_SIZE];
+    void (*write) (DS_Packet*) = NULL;
+    DS_String (*create) (void) = NULL;
+
+    if (channel == DS_CAPTURE_FMS) {
+        write = protocol->write_fms_packet;
+        create = protocol->create_fms_packet;
+    } else if (channel == DS_CAPTURE_RADIO) {
+        write = protocol->write_radio_packet;
+        create = protocol->create_radio_packet;
+    } else if (channel == DS_CAPTURE_ROBOT) {
+        write = protocol->write_robot_packet;
+        create = protocol->create_robot_packet;
+    }
+
+    /* Write the packet in a local buffer */
+    if (write) {
+        DS_PacketInit (&packet, buffer, sizeof (buffer));
+        write (&packet);
+
+        /* The protocols module drops the packets that do not fit */
+        if (packet.overflow)
+            packet.len = 0;
+
+        if (output) {
+            if (target->date_tags && channel == DS_CAPTURE_ROBOT)
+                mask_date_tags (packet.buf, packet.len);
+
+            add_record (output, channel, packet.buf, packet.len);
+        }
+    }
+
+    /* Let the protocol allocate the packet */
+    else if (create) {
+        DS_String data = create();
+
+        if (output) {
+            if (target->date_tags && channel == DS_CAPTURE_ROBOT)
+                mask_date_tags ((uint8_t*) data.buf, data.len);
+
+            add_record (output, channel, (uint8_t*) data.buf, data.len);
+        }
+
+        DS_StrRmBuf (&data);
+    }
+}
+
+/**
+ * Gives a received packet to the decoder of its channel
+ */
+static void decode (const DS_Protocol* protocol, const DS_CaptureRecord* record)
+{
+    DS_Event event;
+
+    if (record->channel == DS_CAPTURE_FMS && protocol->read_fms_packet)
+        protocol->read_fms_packet (&record->data);
+    else if (record->channel == DS_CAPTURE_RADIO && protocol->read_radio_packet)
+        protocol->read_radio_packet (&record->data);
+    else if (record->channel == DS_CAPTURE_ROBOT && protocol->read_robot_packet)
+        protocol->read_robot_packet (&record->data);
+
+    /* Discard events generated by the decoders */
+    while (DS_PollEvent (&event));
+}
+
+/**
+ * Writes every pending message of the robot stream of the given
+ * \a protocol (if it has one) to the given \a output
+ */
+static void encode_stream (const DS_Protocol* protocol, Buffer* output)
+{
+    DS_Packet packet;
+    uint8_t buffer [DS_PACKET_MAX_SIZE];
+
+    if (!protocol->write_robot_stream)
+        return;
+
+    do {
+        DS_PacketInit (&packet, buffer, sizeof (buffer));
+        protocol->write_robot_stream (&packet);
+
+        if (packet.len > 0 && !packet.overflow)
+            add_record (output, CHANNEL_STREAM, packet.buf, packet.len);
+    } while (packet.len > 0 && !packet.overflow);
+}
+
+/**
+ * Creates (and selects) a new DS context in the state used for the replays
+ */
+static DS_Context* begin_replay (const DS_CaptureFile* file)
+{
+    DS_Context* context = DS_ContextNew();
+
+    if (!context) {
+        fprintf (stderr, "Cannot create a DS context\n");
+        exit (EXIT_FAILURE);
+    }
+
+    DS_ContextMakeCurrent (context);
+    DS_Init();
+
+    CFG_SetTeamNumber (file->team);
+    CFG_SetControlMode (DS_CONTROL_TELEOPERATED);
+    CFG_SetRobotEnabled (1);
+
+    return context;
+}
+
+/**
+ * Closes the given replay \a context and selects the default context
+ */
+static void end_replay (DS_Context* context)
+{
+    DS_ContextFree (context);
+    DS_ContextMakeCurrent (NULL);
+}
+
+/**
+ * Replays the given \a records with the given \a target protocol and writes
+ * the generated packets to the given \a output
+ */
+static void replay (const Target* target, const DS_CaptureFile* file,
+                    const DS_CaptureRecord* records, const size_t count,
+                    Buffer* output)
+{
+    size_t i;
+    DS_Context* context = begin_replay (file);
+    DS_Protocol protocol = target->get();
+
+    encode_stream (&protocol, output);
+
+    for (i = 0; i < count; ++i) {
+        if (records [i].received)
+            decode (&protocol, &records [i]);
+        else
+            encode (target, &protocol, records [i].channel, output);
+    }
+
+    encode_stream (&protocol, output);
+
+    DS_StrRmBuf (&protocol.name);
+    end_replay (context);
+}
+
+/**
+ * Returns the time (in ns per packet) of the fastest of \c TIMING_RUNS runs
+ * that decode the received \a records (\a encode set to \c 0) or that
+ * generate a packet for each of the sent \a records (\a encode set to \c 1),
+ * or \c 0 if there are no such records
+ */
+static double measure (const Target* target, const DS_CaptureFile* file,
+                       const DS_CaptureRecord* records, const size_t count,
+                       const int encode_packets)
+{
+    int run;
+    size_t i;
+    size_t packets = 0;
+    double best = 0;
+    DS_Context* context = begin_replay (file);
+    DS_Protocol protocol = target->get();
+
+    /* Count the packets of a pass */
+    for (i = 0; i < count; ++i) {
+        if (records [i].received != encode_packets)
+            ++packets;
+    }
+
+    for (run = 0; run < TIMING_RUNS && packets > 0; ++run) {
+        size_t done = 0;
+        uint64_t elapsed = 0;
+        uint64_t start = DS_GetTimeUs();
+
+        /* Repeat the pass until the minimum duration has elapsed */
+        while (elapsed < MIN_DURATION_US) {
+            for (i = 0; i < count; ++i) {
+                if (records [i].received == encode_packets)
+                    continue;
+
+                if (encode_packets)
+                    encode (target, &protocol, records [i].channel, NULL);
+                else
+                    decode (&protocol, &records [i]);
+            }
+
+            done += packets;
+            elapsed = DS_GetTimeUs() - start;
+        }
+
+        double time = elapsed * 1e3 / (double) done;
+        if (run == 0 || time < best)
+            best = time;
+    }
+
+    DS_StrRmBuf (&protocol.name);
+    end_replay (context);
+
+    return best;
+}
+
+/**
+ * Reads the whole file at the given \a path into the given \a buffer
+ *
+ * \returns \c 1 on success, \c 0 if the file cannot be read
+ */
+static int read_file (const char* path, Buffer* buffer)
+{
+    size_t size;
+    uint8_t chunk [4096];
+    FILE* file = fopen (path, "rb");
+
+    if (!file)
+        return 0;
+
+    while ((size = fread (chunk, 1, sizeof (chunk), file)) > 0)
+        buffer_append (buffer, chunk, size);
+
+    fclose (file);
+    return 1;
+}
+
+/**
+ * Writes the contents of the given \a buffer to the file at the given \a path
+ *
+ * \returns \c 1 on success, \c 0 on failure
+ */
+static int write_file (const char* path, const Buffer* buffer)
+{
+    int ok;
+    FILE* file = fopen (path, "wb");
+
+    if (!file)
+        return 0;
+
+    ok = fwrite (buffer->data, 1, buffer->len, file) == buffer->len;
+    ok = (fclose (file) == 0) && ok;
+
+    return ok;
+}
+
+/**
+ * Prints up to 16 bytes of the given packet \a data, starting at \a offset
+ */
+static void print_bytes (const char* label, const uint8_t* data,
+                         const size_t size, const size_t offset)
+{
+    size_t i;
+
+    fprintf (stderr, "    %s:", label);
+    for (i = offset; i < size && i < offset + 16; ++i)
+        fprintf (stderr, " %02x", data [i]);
+
+    fprintf (stderr, i < size ? " ...\n" : "\n");
+}
+
+/**
+ * Reads the golden file record at the given \a offset of the given \a buffer
+ *
+ * \returns the offset of the next record, or \c 0 if the buffer does not
+ *          contain a complete record at \a offset
+ */
+static size_t read_record (const Buffer* buffer, const size_t offset,
+                           int* channel, const uint8_t** data, size_t* size)
+{
+    if (offset + 3 > buffer->len)
+        return 0;
+
+    *channel = buffer->data [offset];
+    *size = (size_t) buffer->data [offset + 1] |
+            ((size_t) buffer->data [offset + 2] << 8);
+    *data = buffer->data + offset + 3;
+
+    if (offset + 3 + *size > buffer->len || *channel > CHANNEL_STREAM)
+        return 0;
+
+    return offset + 3 + *size;
+}
+
+/**
+ * Compares the generated packets in \a actual with the ones in the golden
+ * file (\a expected) and reports the first difference
+ *
+ * \returns \c 1 if both are identical, \c 0 otherwise
+ */
+static int compare (const char* name, const Buffer* expected,
+                    const Buffer* actual)
+{
+    size_t index = 0;
+    size_t expected_offset = 0;
+    size_t actual_offset = 0;
+
+    if (expected->len == actual->len &&
+            (actual->len == 0 ||
+             memcmp (expected->data, actual->data, actual->len) == 0))
+        return 1;
+
+    /* Find the first record that differs */
+    for (;; ++index) {
+        int expected_channel = 0;
+        int actual_channel = 0;
+        size_t expected_size = 0;
+        size_t actual_size = 0;
+        const uint8_t* expected_data = NULL;
+        const uint8_t* actual_data = NULL;
+
+        size_t expected_next = read_record (expected, expected_offset,
+                                            &expected_channel,
+                                            &expected_data, &expected_size);
+        size_t actual_next = read_record (actual, actual_offset,
+                                          &actual_channel,
+                                          &actual_data, &actual_size);
+
+        if (!expected_next || !actual_next) {
+            fprintf (stderr, "FAIL %s: %s after %lu packets\n", name,
+                     expected_next ? "fewer packets generated" :
+                     actual_next ? "more packets generated" :
+                     "golden file is corrupted",
+                     (unsigned long) index);
+            return 0;
+        }
+
+        if (expected_channel != actual_channel) {
+            fprintf (stderr, "FAIL %s: packet %lu is a %s, expected a %s\n",
+                     name, (unsigned long) index,
+                     channel_names [actual_channel],
+                     channel_names [expected_channel]);
+            return 0;
+        }
+
+        if (expected_size != actual_size ||
+                memcmp (expected_data, actual_data, actual_size) != 0) {
+            size_t diff = 0;
+            while (diff < expected_size && diff < actual_size &&
+                    expected_data [diff] == actual_data [diff])
+                ++diff;
+
+            fprintf (stderr, "FAIL %s: packet %lu (%s) differs at byte %lu "
+                     "(%lu bytes, expected %lu)\n", name,
+                     (unsigned long) index, channel_names [actual_channel],
+                     (unsigned long) diff, (unsigned long) actual_size,
+                     (unsigned long) expected_size);
+            print_bytes ("expected", expected_data, expected_size, diff);
+            print_bytes ("actual  ", actual_data, actual_size, diff);
+            return 0;
+        }
+
+        expected_offset = expected_next;
+        actual_offset = actual_next;
+    }
+}
+
+/**
+ * Returns the baseline timing with the given \a key, which is added if
+ * \a create is set and the baseline does not contain it
+ */
+static Timing* find_timing (const char* key, const int create)
+{
+    size_t i;
+
+    for (i = 0; i < timing_count; ++i) {
+        if (strcmp (timings [i].key, key) == 0)
+            return &timings [i];
+    }
+
+    if (!create)
+        return NULL;
+
+    timings = (Timing*) realloc (timings, (timing_count + 1) * sizeof (Timing));
+    if (!timings) {
+        fprintf (stderr, "Out of memory\n");
+        exit (EXIT_FAILURE);
+    }
+
+    memset (&timings [timing_count], 0, sizeof (Timing));
+    snprintf (timings [timing_count].key, sizeof (timings [0].key), "%s", key);
+    return &timings [timing_count++];
+}
+
+/**
+ * Loads the baseline file, which contains a "<key> <encode ns> <decode ns>"
+ * line for each capture and protocol. A missing file is an empty baseline.
+ */
+static void load_baseline (void)
+{
+    char key [256];
+    double encode_ns;
+    double decode_ns;
+    FILE* file = fopen (baseline_path, "r");
+
+    if (!file)
+        return;
+
+    while (fscanf (file, "%255s %lf %lf", key, &encode_ns, &decode_ns) == 3) {
+        Timing* timing = find_timing (key, 1);
+        timing->encode_ns = encode_ns;
+        timing->decode_ns = decode_ns;
+    }
+
+    fclose (file);
+}
+
+/**
+ * Writes the baseline file
+ *
+ * \returns \c 1 on success, \c 0 on failure
+ */
+static int save_baseline (void)
+{
+    size_t i;
+    int ok = 1;
+    FILE* file = fopen (baseline_path, "w");
+
+    if (!file)
+        return 0;
+
+    for (i = 0; i < timing_count; ++i) {
+        if (fprintf (file, "%s %.1f %.1f\n", timings [i].key,
+                     timings [i].encode_ns, timings [i].decode_ns) < 0)
+            ok = 0;
+    }
+
+    return (fclose (file) == 0) && ok;
+}
+
+/**
+ * Compares a measured \a time with its \a baseline time
+ *
+ * \returns \c 1 if the slowdown is within the threshold, \c 0 otherwise
+ */
+static int check_time (const char* name, const char* what,
+                       const double time, const double baseline)
+{
+    if (baseline <= 0 || time <= baseline * (1 + threshold / 100))
+        return 1;
+
+    fprintf (stderr, "FAIL %s: %s takes %.1f ns/packet, baseline is %.1f "
+             "ns/packet (%+.0f%%, threshold is %.0f%%)\n", name, what, time,
+             baseline, (time / baseline - 1) * 100, threshold);
+    return 0;
+}
+
+/**
+ * Returns the file name of the given \a path
+ */
+static const char* file_name (const char* path)
+{
+    const char* name = path;
+    const char* p;
+
+    for (p = path; *p; ++p) {
+        if (*p == '/' || *p == '\\')
+            name = p + 1;
+    }
+
+    return name;
+}
+
+/**
+ * Replays the capture at the given \a path with every protocol
+ *
+ * \returns the number of failures
+ */
+static int test_capture (const char* path)
+{
+    int i;
+    int failures = 0;
+    size_t count = 0;
+    DS_CaptureFile file;
+    DS_CaptureRecord record;
+    DS_CaptureRecord* records;
+
+    /* Load the capture */
+    if (!DS_CaptureLoad (&file, path)) {
+        fprintf (stderr, "FAIL %s: cannot load capture\n", path);
+        return 1;
+    }
+
+    /* Collect the FMS, radio and robot packets (views of the file data) */
+    records = (DS_CaptureRecord*) calloc (file.size, sizeof (DS_CaptureRecord));
+    while (records && DS_CaptureRead (&file, &record)) {
+        if (record.channel != DS_CAPTURE_NETCONSOLE)
+            records [count++] = record;
+    }
+
+    for (i = 0; i < PROTOCOL_COUNT; ++i) {
+        char name [256];
+        char golden_path [1024];
+        Buffer actual = { NULL, 0, 0 };
+        Buffer expected = { NULL, 0, 0 };
+
+        snprintf (name, sizeof (name), "%s:%s", file_name (path),
+                  targets [i].id);
+        snprintf (golden_path, sizeof (golden_path), "%s.%s.golden", path,
+                  targets [i].id);
+
+        /* Compare (or write) the generated packets */
+        replay (&targets [i], &file, records, count, &actual);
+        if (update) {
+            if (!write_file (golden_path, &actual)) {
+                fprintf (stderr, "FAIL %s: cannot write %s\n", name,
+                         golden_path);
+                ++failures;
+            }
+        }
+
+        else if (!read_file (golden_path, &expected)) {
+            fprintf (stderr, "FAIL %s: missing golden file %s (run with "
+                     "--update to create it)\n", name, golden_path);
+            ++failures;
+        }
+
+        else if (!compare (name, &expected, &actual))
+            ++failures;
+
+        /* Compare (or write) the timings */
+        if (baseline_path) {
+            double encode_ns = measure (&targets [i], &file, records, count, 1);
+            double decode_ns = measure (&targets [i], &file, records, count, 0);
+            Timing* timing = find_timing (name, update);
+
+            printf ("%s: encode %.1f ns/packet, decode %.1f ns/packet\n",
+                    name, encode_ns, decode_ns);
+
+            if (update) {
+                timing->encode_ns = encode_ns;
+                timing->decode_ns = decode_ns;
+            }
+
+            else if (timing) {
+                failures += !check_time (name, "encoding", encode_ns,
+                                         timing->encode_ns);
+                failures += !check_time (name, "decoding", decode_ns,
+                                         timing->decode_ns);
+            }
+        }
+
+        free (actual.data);
+        free (expected.data);
+    }
+
+    DS_CaptureFree (&file);
+    free (records);
+    return failures;
+}
+
+/**
+ * Formats the given \a value with \c DS_StrFormatBuf() in a buffer of the
+ * given \a size and compares the result with the output of \c snprintf()
+ *
+ * \returns \c 0 on success, \c 1 on failure
+ */
+static int check_float (const double value, const size_t size)
+{
+    char result [512];
+    char expected [512];
+    size_t len;
+    int expected_len;
+
+    len = DS_StrFormatBuf (result, size, "%f", value);
+    expected_len = snprintf (expected, size, "%.2f", value);
+
+    if (expected_len < 0 || len != (size_t) expected_len ||
+        strcmp (result, expected) != 0) {
+        fprintf (stderr, "FAIL formatter: %g in %lu bytes gives \"%s\" (%lu), "
+                 "expected \"%s\" (%d)\n", value, (unsigned long) size,
+                 result, (unsigned long) len, expected, expected_len);
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Checks the \c %f conversion of the string formatter with numbers whose
+ * representation is longer than its internal buffer
+ *
+ * \returns the number of failures
+ */
+static int check_formatter (void)
+{
+    int failures = 0;
+
+    failures += check_float (12.345, 512);
+    failures += check_float (1e62, 512);
+    failures += check_float (1e200, 512);
+    failures += check_float (-DBL_MAX, 512);
+    failures += check_float (1e200, 8);
+    failures += check_float (HUGE_VAL, 512);
+
+    return failures;
+}
+
+/**
+ * Prints the usage of the tool
+ */
+static void usage (void)
+{
+    fprintf (stderr, "Usage: libds-regress [--update] [--baseline <file>] "
+             "[--threshold <percent>] <capture> [<capture> ...]\n");
+}
+
+/**
+ * Main entry point of the application
+ */
+int main (int argc, char** argv)
+{
+    int i;
+    int captures = 0;
+    int failures = 0;
+
+    /* Parse the options */
+    for (i = 1; i < argc && strncmp (argv [i], "--", 2) == 0; ++i) {
+        if (strcmp (argv [i], "--update") == 0)
+            update = 1;
+        else if (strcmp (argv [i], "--baseline") == 0 && i + 1 < argc)
+            baseline_path = argv [++i];
+        else if (strcmp (argv [i], "--threshold") == 0 && i + 1 < argc)
+            threshold = atof (argv [++i]);
+        else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (i >= argc) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    if (baseline_path)
+        load_baseline();
+
+    /* Use the same timezone on every host (see mask_date_tags()) */
+#if defined _WIN32
+    _putenv ("TZ=UTC");
+    _tzset();
+#else
+    setenv ("TZ", "UTC", 1);
+    tzset();
+#endif
+
+    /* Check the string formatter */
+    failures += check_formatter();
+
+    /* Replay the captures */
+    for (; i < argc; ++i) {
+        failures += test_capture (argv [i]);
+        ++captures;
+    }
+
+    /* Save the new baseline */
+    if (update && baseline_path && !save_baseline()) {
+        fprintf (stderr, "FAIL: cannot write %s\n", baseline_path);
+        ++failures;
+    }
+
+    /* Print results */
+    if (failures > 0) {
+        fprintf (stderr, "%d failure(s) in %d capture(s)\n", failures,
+                 captures);
+        return EXIT_FAILURE;
+    }
+
+    printf ("%d capture(s) %s with %d protocols\n", captures,
+            update ? "recorded" : "passed", PROTOCOL_COUNT);
+    return EXIT_SUCCESS;
+}
@@ -25,10 +25,17 @@
 #include "DS_Utils.h"
 
 #include <assert.h>
+#include <string.h>
+
+/*
+ * Number of items allocated by the first insertion in an empty array
+ */
+#define MIN_SIZE 4
 
 /**
  * Deallocates the memory used to store the \a array data and resets the
- * properties of the given \a array
+ * properties of the given \a array, which can be used again afterwards
+ * (with the storage provided by its owner, if any)
  *
  * \param array the array object to free
  */
@@ -36,63 +43,176 @@ void DS_ArrayFree (DS_Array* array)
 {
     /* Check arguments */
     assert (array);
-    assert (array->data);
-
-    /* De-allocate array data */
-    if (array->size > 0) {
-        int i;
-        for (i = 0; i < (int) array->size; ++i)
-            DS_FREE (array->data [i]);
 
+    /* De-allocate array data (if it is not the storage of the owner) */
+    if (array->data != array->inline_data)
         DS_FREE (array->data);
-    }
 
     /* Update array properties */
     array->used = 0;
-    array->size = 0;
+    array->data = array->inline_data;
+    array->size = array->inline_size;
+}
+
+/**
+ * Removes all the items of the given \a array, without releasing its
+ * storage, so that inserting the same number of items again does not
+ * allocate any memory
+ *
+ * \param array the array to clear
+ */
+void DS_ArrayClear (DS_Array* array)
+{
+    assert (array);
+    array->used = 0;
 }
 
 /**
- * Inserts the given \a element in the \a array. If there is no memory left
- * in the array, then this function will float the size of the array and
- * insert the item.
+ * Makes sure that the given \a array can hold at least \a count items
+ * without allocating more memory. The storage size is at least doubled,
+ * so that inserting items one by one has an amortized constant cost.
+ *
+ * \param array the array to enlarge
+ * \param count the number of items that the array must be able to hold
  *
- * \param array the array object in which to insert the given element
- * \param element pointer to the item to register with the array
+ * \returns \c 1 on success, \c 0 if the memory cannot be allocated
  */
-void DS_ArrayInsert (DS_Array* array, void* element)
+int DS_ArrayReserve (DS_Array* array, size_t count)
 {
+    void* data;
+    size_t size;
+
     /* Check arguments */
     assert (array);
-    assert (array->data);
+    assert (array->item_size > 0);
 
-    /* Resize array if required */
-    if (array->used == array->size) {
-        array->size *= 2;
-        array->data = realloc (array->data, array->size);
+    /* Array is large enough */
+    if (count <= array->size)
+        return 1;
+
+    /* Get the new size (in items), and check that it fits in a size_t */
+    size = DS_Max (DS_Max (array->size * 2, count), (size_t) MIN_SIZE);
+    if (size > (size_t) -1 / array->item_size)
+        return 0;
+
+    /* Move the items out of the storage of the owner */
+    if (array->data == array->inline_data) {
+        data = DS_MALLOC (DS_MEMORY_ARRAYS, size * array->item_size);
+        if (data && array->used > 0)
+            memcpy (data, array->data, array->used * array->item_size);
     }
 
-    /* Insert element */
-    array->data [array->used++] = element;
+    /* Enlarge the allocated storage */
+    else
+        data = DS_REALLOC (DS_MEMORY_ARRAYS, array->data, size * array->item_size);
+
+    /* Allocation failed, the array is not modified */
+    if (!data)
+        return 0;
+
+    array->data = data;
+    array->size = size;
+    return 1;
+}
+
+/**
+ * Returns a pointer to the item at the given \a index of the \a array, or
+ * \c NULL if the index is out of bounds. The pointer is valid until the
+ * array is enlarged or freed.
+ *
+ * \param array the array to read
+ * \param index the index of the item
+ */
+void* DS_ArrayAt (const DS_Array* array, size_t index)
+{
+    assert (array);
+
+    if (index >= array->used)
+        return NULL;
+
+    return (uint8_t*) array->data + index * array->item_size;
+}
+
+/**
+ * Inserts a copy of the given \a item at the end of the \a array. If there
+ * is no memory left in the array, then this function will double the size
+ * of the array and insert the item.
+ *
+ * \param array the array object in which to insert the given item
+ * \param item pointer to the item to copy (if \c NULL, the inserted item is
+ *        set to zero)
+ *
+ * \returns a pointer to the inserted item, or \c NULL if the memory cannot
+ *          be allocated
+ */
+void* DS_ArrayInsert (DS_Array* array, const void* item)
+{
+    uint8_t* slot;
+
+    /* Check arguments */
+    assert (array);
+
+    /* Resize array if required */
+    if (array->used == array->size && !DS_ArrayReserve (array, array->used + 1))
+        return NULL;
+
+    /* Insert item */
+    slot = (uint8_t*) array->data + array->used * array->item_size;
+    if (item)
+        memcpy (slot, item, array->item_size);
+    else
+        memset (slot, 0, array->item_size);
+
+    ++array->used;
+    return slot;
 }
 
 /**
  * Initializes the data list and properties of the given \a array
  *
  * \param array the array to initialize
- * \param initial_size the initial size of the array, since the array is an
- *        array of pointers, the initial size can also be thought as the
- *        initial number of supported items
+ * \param initial_size the number of items that can be inserted before the
+ *        array is enlarged (if it is \c 0, the storage is allocated by the
+ *        first insertion)
+ * \param item_size the size of each item (in bytes)
  */
-void DS_ArrayInit (DS_Array* array, size_t initial_size)
+void DS_ArrayInit (DS_Array* array, size_t initial_size, size_t item_size)
 {
     /* Check arguments */
     assert (array);
+    assert (item_size > 0);
+
+    /* Update array data */
+    memset (array, 0, sizeof (DS_Array));
+    array->item_size = item_size;
 
     /* Allocate array data */
-    array->data = calloc (initial_size, sizeof (void*));
+    DS_ArrayReserve (array, initial_size);
+}
 
-    /* Update array data */
-    array->used = 0;
-    array->size = initial_size;
+/**
+ * Initializes the given \a array with a \a storage provided by its owner,
+ * which holds the first \a storage_size items. The storage must be valid
+ * until the array is freed, it is never deallocated by the array.
+ *
+ * \param array the array to initialize
+ * \param storage the initial storage of the array
+ * \param storage_size the number of items that fit in the \a storage
+ * \param item_size the size of each item (in bytes)
+ */
+void DS_ArrayInitInline (DS_Array* array, void* storage, size_t storage_size,
+                         size_t item_size)
+{
+    /* Check arguments */
+    assert (array);
+    assert (storage);
+    assert (item_size > 0);
+
+    /* Use the given storage until more items are inserted */
+    memset (array, 0, sizeof (DS_Array));
+    array->data = storage;
+    array->inline_data = storage;
+    array->size = storage_size;
+    array->inline_size = storage_size;
+    array->item_size = item_size;
 }
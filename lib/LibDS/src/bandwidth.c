@@ -0,0 +1,578 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Utils.h"
+#include "DS_Timer.h"
+#include "DS_Atomic.h"
+#include "DS_Config.h"
+#include "DS_Context.h"
+#include "DS_Bandwidth.h"
+#include "DS_Thread.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined __linux__ && !defined __ANDROID__
+    #define HOST_COUNTERS
+    #include <ifaddrs.h>
+    #include <arpa/inet.h>
+    #include <linux/if_link.h>
+    #define LINK_FAMILY AF_PACKET
+    #define LINK_STATS  struct rtnl_link_stats
+    #define LINK_SENT   tx_bytes
+    #define LINK_RECV   rx_bytes
+#elif defined __APPLE__ || defined __FreeBSD__
+    #define HOST_COUNTERS
+    #include <ifaddrs.h>
+    #include <net/if.h>
+    #include <arpa/inet.h>
+    #define LINK_FAMILY AF_LINK
+    #define LINK_STATS  struct if_data
+    #define LINK_SENT   ifi_obytes
+    #define LINK_RECV   ifi_ibytes
+#endif
+
+/*
+ * Number of samples needed to cover the long window, and the counter index
+ * of the host interface (after the sockets)
+ */
+#define SAMPLES ((DS_BANDWIDTH_LONG / DS_BANDWIDTH_INTERVAL) + 1)
+#define HOST    DS_BANDWIDTH_SOCKET_COUNT
+#define COUNTERS (DS_BANDWIDTH_SOCKET_COUNT + 1)
+
+/*
+ * Cumulative byte counts at a given time. The counts only grow: when a
+ * socket (or the host interface) is re-created, its new counters are
+ * added to the totals instead of replacing them
+ */
+typedef struct {
+    uint64_t time;
+    uint64_t sent [COUNTERS];
+    uint64_t recv [COUNTERS];
+    int host_valid;
+} Sample;
+
+/*
+ * Bandwidth state of a DS context, the samples are written by the event
+ * loop and read by the application (the mutex protects everything except
+ * the raw counters, which are only used by the event loop)
+ */
+typedef struct {
+    Sample samples [SAMPLES];
+    int count;
+    int newest;
+    uint64_t raw_sent [COUNTERS];
+    uint64_t raw_recv [COUNTERS];
+    char host_name [64];
+    double budget;
+    int warning;
+    int usage;
+    DS_Mutex mutex;
+} BandwidthContext;
+
+/**
+ * Initializes the bandwidth state of a new DS context
+ */
+static void init_context (void* data)
+{
+    BandwidthContext* ctx = (BandwidthContext*) data;
+    ctx->budget = DS_BANDWIDTH_DEFAULT_BUDGET;
+    DS_MutexInit (&ctx->mutex);
+}
+
+/**
+ * Releases the bandwidth state of a DS context
+ */
+static void destroy_context (void* data)
+{
+    BandwidthContext* ctx = (BandwidthContext*) data;
+    DS_MutexDestroy (&ctx->mutex);
+}
+
+/**
+ * Returns the bandwidth state of the current DS context
+ */
+static BandwidthContext* get_context (void)
+{
+    return (BandwidthContext*) DS_ContextData (DS_CONTEXT_BANDWIDTH,
+                                               sizeof (BandwidthContext),
+                                               init_context, destroy_context);
+}
+
+/**
+ * Returns the growth of a counter that went from \a last to \a current,
+ * a counter that went backwards was re-created and counts from zero
+ */
+static uint64_t counter_delta (const uint64_t last, const uint64_t current)
+{
+    return (current >= last) ? current - last : current;
+}
+
+#if defined HOST_COUNTERS
+/**
+ * Reads the byte counters of the network interface whose IPv4 subnet holds
+ * the given \a address (the robot), the interface counters include the DS
+ * traffic along with the traffic of every other application of the host
+ *
+ * \returns \c 1 on success, \c 0 if no interface reaches the address
+ */
+static int read_host_counters (const char* address, char* name,
+                               const size_t size,
+                               uint64_t* sent, uint64_t* recv)
+{
+    struct in_addr target;
+    struct ifaddrs* list = NULL;
+    struct ifaddrs* ifa = NULL;
+    int found = 0;
+
+    if (inet_pton (AF_INET, address, &target) != 1 || getifaddrs (&list) != 0)
+        return 0;
+
+    /* Find the interface that is on the same subnet as the address */
+    name [0] = '\0';
+    for (ifa = list; ifa && !name [0]; ifa = ifa->ifa_next) {
+        if (!ifa->ifa_addr || !ifa->ifa_netmask ||
+                ifa->ifa_addr->sa_family != AF_INET)
+            continue;
+
+        uint32_t addr = ((struct sockaddr_in*) ifa->ifa_addr)->sin_addr.s_addr;
+        uint32_t mask = ((struct sockaddr_in*) ifa->ifa_netmask)->sin_addr.s_addr;
+        if ((addr & mask) == (target.s_addr & mask))
+            snprintf (name, size, "%s", ifa->ifa_name);
+    }
+
+    /* Get the counters of the interface (they are 32-bit on some systems) */
+    for (ifa = list; ifa && name [0] && !found; ifa = ifa->ifa_next) {
+        if (ifa->ifa_addr && ifa->ifa_data &&
+                ifa->ifa_addr->sa_family == LINK_FAMILY &&
+                strcmp (ifa->ifa_name, name) == 0) {
+            LINK_STATS* stats = (LINK_STATS*) ifa->ifa_data;
+            *sent = stats->LINK_SENT;
+            *recv = stats->LINK_RECV;
+            found = 1;
+        }
+    }
+
+    freeifaddrs (list);
+    return found;
+}
+#endif
+
+/**
+ * Adds the growth of the host interface counters to the given \a sample,
+ * the interface is the one used to reach the robot of the \a protocol
+ *
+ * \returns \c 1 if the host counters are known, \c 0 if not
+ */
+static int sample_host (BandwidthContext* ctx, DS_Protocol* protocol,
+                        Sample* sample)
+{
+#if defined HOST_COUNTERS
+    int valid = 0;
+    char name [sizeof (ctx->host_name)];
+    uint64_t sent = 0;
+    uint64_t recv = 0;
+
+    DS_String address = DS_SocketRemoteHost (&protocol->robot_socket);
+    char* host = DS_StrToChar (&address);
+    if (host && read_host_counters (host, name, sizeof (name), &sent, &recv)) {
+        /* Counters of a different interface are a new baseline */
+        if (strcmp (name, ctx->host_name) == 0) {
+            sample->sent [HOST] += (uint32_t) (sent - ctx->raw_sent [HOST]);
+            sample->recv [HOST] += (uint32_t) (recv - ctx->raw_recv [HOST]);
+            valid = 1;
+        }
+
+        snprintf (ctx->host_name, sizeof (ctx->host_name), "%s", name);
+        ctx->raw_sent [HOST] = sent;
+        ctx->raw_recv [HOST] = recv;
+    }
+
+    else
+        ctx->host_name [0] = '\0';
+
+    DS_FREE (host);
+    DS_StrRmBuf (&address);
+    return valid;
+#else
+    (void) ctx;
+    (void) protocol;
+    (void) sample;
+    return 0;
+#endif
+}
+
+/**
+ * Computes the rates of the given \a counter over the last \a window msecs,
+ * or over the available samples if the window is not filled yet. The host
+ * counter is only measured over consecutive samples in which it was known.
+ *
+ * \note The context mutex must be locked
+ */
+static void window_rates (BandwidthContext* ctx, const int counter,
+                          const int window, double* sent, double* recv)
+{
+    int i;
+    int oldest = ctx->newest;
+    Sample* newest = &ctx->samples [ctx->newest];
+
+    *sent = 0;
+    *recv = 0;
+
+    /* Walk back until the window is covered */
+    for (i = 1; i < ctx->count; ++i) {
+        int index = (ctx->newest - i + SAMPLES) % SAMPLES;
+        if (counter == HOST && !ctx->samples [index].host_valid)
+            break;
+
+        oldest = index;
+        if (newest->time - ctx->samples [index].time >= (uint64_t) window)
+            break;
+    }
+
+    if (counter == HOST && !newest->host_valid)
+        return;
+
+    /* Not enough samples yet */
+    Sample* first = &ctx->samples [oldest];
+    if (newest->time <= first->time)
+        return;
+
+    double secs = (newest->time - first->time) / 1000.0;
+    *sent = (newest->sent [counter] - first->sent [counter]) / secs;
+    *recv = (newest->recv [counter] - first->recv [counter]) / secs;
+}
+
+/**
+ * Returns the short and long window rates of the given \a counter
+ *
+ * \note The context mutex must be locked
+ */
+static DS_Bandwidth get_bandwidth (BandwidthContext* ctx, const int counter)
+{
+    DS_Bandwidth bandwidth;
+
+    window_rates (ctx, counter, DS_BANDWIDTH_SHORT,
+                  &bandwidth.sent_short, &bandwidth.received_short);
+    window_rates (ctx, counter, DS_BANDWIDTH_LONG,
+                  &bandwidth.sent_long, &bandwidth.received_long);
+
+    return bandwidth;
+}
+
+/**
+ * Returns the sum of the socket rates
+ *
+ * \note The context mutex must be locked
+ */
+static DS_Bandwidth total_bandwidth (BandwidthContext* ctx)
+{
+    int i;
+    DS_Bandwidth total = {0, 0, 0, 0};
+
+    for (i = 0; i < DS_BANDWIDTH_SOCKET_COUNT; ++i) {
+        DS_Bandwidth socket = get_bandwidth (ctx, i);
+        total.sent_short += socket.sent_short;
+        total.received_short += socket.received_short;
+        total.sent_long += socket.sent_long;
+        total.received_long += socket.received_long;
+    }
+
+    return total;
+}
+
+/**
+ * Compares the traffic of the last second (of the DS, or of the whole host
+ * interface if it is known and larger) with the budget, and raises/clears
+ * the budget warning (with some hysteresis to avoid flickering)
+ *
+ * \note The context mutex must be locked
+ *
+ * \returns \c 1 if the warning was raised, \c -1 if it was cleared and
+ *          \c 0 if it did not change
+ */
+static int update_warning (BandwidthContext* ctx)
+{
+    DS_Bandwidth ds = total_bandwidth (ctx);
+    DS_Bandwidth host = get_bandwidth (ctx, HOST);
+
+    double bytes = DS_Max (ds.sent_short + ds.received_short,
+                           host.sent_short + host.received_short);
+
+    ctx->usage = 0;
+    if (ctx->budget > 0)
+        ctx->usage = (int) (bytes * 8 * 100 / (ctx->budget * 1000000));
+
+    if (!ctx->warning && ctx->budget > 0 &&
+            ctx->usage >= DS_BANDWIDTH_WARN_PERCENT) {
+        ctx->warning = 1;
+        return 1;
+    }
+
+    if (ctx->warning && (ctx->budget <= 0 ||
+                         ctx->usage < DS_BANDWIDTH_CLEAR_PERCENT)) {
+        ctx->warning = 0;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Notifies the user that the budget warning was raised or cleared
+ */
+static void notify_warning (const int change, const int usage,
+                            const double budget)
+{
+    char text [128];
+
+    if (change <= 0) {
+        CFG_AddStaticNotification (CFG_NOTIFY_BANDWIDTH_RECOVERED);
+        return;
+    }
+
+    /* The usage and budget are part of the message, it is rarely raised */
+    DS_String str;
+    str.buf = text;
+    str.len = (size_t) snprintf (text, sizeof (text), "Network usage is at %d%% "
+                                 "of the bandwidth budget (%.1f Mbit/s)",
+                                 usage, budget);
+    str.cap = 0;
+    CFG_AddNetConsoleEntry (DS_NETCONSOLE_SOURCE_LIBDS,
+                            DS_NETCONSOLE_SEVERITY_WARNING, &str);
+}
+
+/**
+ * Discards the samples (e.g. when the protocol is unloaded), the next
+ * protocol starts with empty windows
+ */
+void Bandwidth_Reset (void)
+{
+    BandwidthContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    ctx->count = 0;
+    ctx->newest = 0;
+    ctx->usage = 0;
+    ctx->warning = 0;
+    ctx->host_name [0] = '\0';
+    memset (ctx->raw_sent, 0, sizeof (ctx->raw_sent));
+    memset (ctx->raw_recv, 0, sizeof (ctx->raw_recv));
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Returns the time (in msecs) until the next bandwidth sample must be taken
+ */
+int Bandwidth_Remaining (void)
+{
+    BandwidthContext* ctx = get_context();
+
+    if (ctx->count == 0)
+        return 0;
+
+    uint64_t elapsed = DS_GetTimeMs() - ctx->samples [ctx->newest].time;
+    if (elapsed >= DS_BANDWIDTH_INTERVAL)
+        return 0;
+
+    return DS_BANDWIDTH_INTERVAL - (int) elapsed;
+}
+
+/**
+ * Samples the byte counters of the sockets of the given \a protocol (and of
+ * the host interface used to reach the robot) every
+ * \c DS_BANDWIDTH_INTERVAL msecs, this function is called by the event loop
+ */
+void Bandwidth_Update (DS_Protocol* protocol)
+{
+    int i;
+    BandwidthContext* ctx = get_context();
+
+    assert (protocol);
+
+    if (Bandwidth_Remaining() > 0)
+        return;
+
+    /* Start from the previous totals */
+    Sample sample;
+    if (ctx->count > 0)
+        sample = ctx->samples [ctx->newest];
+    else
+        memset (&sample, 0, sizeof (sample));
+
+    /* Add the growth of the socket counters */
+    DS_Socket* sockets [DS_BANDWIDTH_SOCKET_COUNT] = {
+        &protocol->fms_socket,
+        &protocol->radio_socket,
+        &protocol->robot_socket,
+        &protocol->robot_stream_socket,
+        &protocol->netconsole_socket,
+    };
+
+    for (i = 0; i < DS_BANDWIDTH_SOCKET_COUNT; ++i) {
+        uint64_t sent, recv;
+        DS_SocketTraffic (sockets [i], &sent, &recv);
+        sample.sent [i] += counter_delta (ctx->raw_sent [i], sent);
+        sample.recv [i] += counter_delta (ctx->raw_recv [i], recv);
+        ctx->raw_sent [i] = sent;
+        ctx->raw_recv [i] = recv;
+    }
+
+    /* Add the growth of the interface counters (without the mutex) */
+    sample.time = DS_GetTimeMs();
+    sample.host_valid = sample_host (ctx, protocol, &sample);
+
+    /* Store the sample and check the budget */
+    DS_MutexLock (&ctx->mutex);
+    ctx->newest = (ctx->count > 0) ? (ctx->newest + 1) % SAMPLES : 0;
+    ctx->samples [ctx->newest] = sample;
+    ctx->count = DS_Min (ctx->count + 1, SAMPLES);
+
+    double budget = ctx->budget;
+    int change = update_warning (ctx);
+    int usage = ctx->usage;
+    DS_MutexUnlock (&ctx->mutex);
+
+    if (change != 0)
+        notify_warning (change, usage, budget);
+}
+
+/**
+ * Returns the bandwidth used by the given \a socket of the current protocol
+ * over the last second and over the last 10 seconds
+ */
+DS_Bandwidth DS_GetSocketBandwidth (const DS_BandwidthSocket socket)
+{
+    BandwidthContext* ctx = get_context();
+
+    assert (socket >= 0 && socket < DS_BANDWIDTH_SOCKET_COUNT);
+
+    DS_MutexLock (&ctx->mutex);
+    DS_Bandwidth bandwidth = get_bandwidth (ctx, socket);
+    DS_MutexUnlock (&ctx->mutex);
+
+    return bandwidth;
+}
+
+/**
+ * Returns the bandwidth used by all the sockets of the current protocol
+ * over the last second and over the last 10 seconds
+ */
+DS_Bandwidth DS_GetTotalBandwidth (void)
+{
+    BandwidthContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    DS_Bandwidth bandwidth = total_bandwidth (ctx);
+    DS_MutexUnlock (&ctx->mutex);
+
+    return bandwidth;
+}
+
+/**
+ * Obtains the bandwidth used by the whole host (the DS and every other
+ * application, e.g. camera viewers) on the network interface that reaches
+ * the robot subnet.
+ *
+ * The interface counters are only available on Linux, macOS and FreeBSD,
+ * and only while the robot address is known.
+ *
+ * \returns \c 1 on success, \c 0 if the host bandwidth is unknown
+ */
+int DS_GetHostBandwidth (DS_Bandwidth* bandwidth)
+{
+    BandwidthContext* ctx = get_context();
+
+    assert (bandwidth);
+
+    DS_MutexLock (&ctx->mutex);
+    int valid = (ctx->count > 0 && ctx->samples [ctx->newest].host_valid);
+    *bandwidth = get_bandwidth (ctx, HOST);
+    DS_MutexUnlock (&ctx->mutex);
+
+    return valid;
+}
+
+/**
+ * Returns the bandwidth budget (in Mbit/s), or \c 0 if it is disabled
+ */
+double DS_GetBandwidthBudget (void)
+{
+    BandwidthContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    double budget = ctx->budget;
+    DS_MutexUnlock (&ctx->mutex);
+
+    return budget;
+}
+
+/**
+ * Changes the bandwidth budget (in Mbit/s) of the DS, e.g. the bandwidth
+ * cap that the field network applies to each team. The traffic sent and
+ * received by the DS (or by the whole host, if it is known and larger)
+ * is compared with the budget, and the user is notified when it exceeds
+ * \c DS_BANDWIDTH_WARN_PERCENT of the budget.
+ *
+ * \param mbps the new budget, set it to \c 0 to disable the warning
+ */
+void DS_SetBandwidthBudget (const double mbps)
+{
+    BandwidthContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    ctx->budget = DS_Max (mbps, 0);
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Returns the percentage of the bandwidth budget that was used during the
+ * last second, or \c 0 if the budget is disabled
+ */
+int DS_GetBandwidthUsage (void)
+{
+    BandwidthContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    int usage = ctx->usage;
+    DS_MutexUnlock (&ctx->mutex);
+
+    return usage;
+}
+
+/**
+ * Returns \c 1 if the network usage is approaching (or exceeding) the
+ * bandwidth budget, the warning is cleared once the usage drops below
+ * \c DS_BANDWIDTH_CLEAR_PERCENT of the budget
+ */
+int DS_BandwidthWarning (void)
+{
+    BandwidthContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    int warning = ctx->warning;
+    DS_MutexUnlock (&ctx->mutex);
+
+    return warning;
+}
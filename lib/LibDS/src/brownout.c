@@ -0,0 +1,337 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Timer.h"
+#include "DS_Utils.h"
+#include "DS_Events.h"
+#include "DS_Context.h"
+#include "DS_Brownout.h"
+#include "DS_Thread.h"
+
+#include <math.h>
+#include <string.h>
+#include <assert.h>
+
+/*
+ * Extra margin (in volts) that the voltage must recover above the warning
+ * level before the warning is cleared, so that it does not flicker
+ */
+#define CLEAR_MARGIN 0.3f
+
+/*
+ * Voltage trend of a DS context. The samples are added by the event loop
+ * (through the config module) and read by the application, the mutex
+ * protects the whole structure.
+ *
+ * Every statistic is an exponentially weighted average that is updated in
+ * constant time with each sample, the history is only used to obtain the
+ * minimum voltage and to be plotted by the application.
+ */
+typedef struct {
+    DS_VoltageSample history [DS_VOLTAGE_HISTORY];
+    int count;
+    int newest;
+    uint64_t last_time;
+    float threshold;
+    DS_VoltageStats stats;
+    DS_Mutex mutex;
+} BrownoutContext;
+
+/**
+ * Initializes the voltage trend of a new DS context
+ */
+static void init_context (void* data)
+{
+    BrownoutContext* ctx = (BrownoutContext*) data;
+    ctx->threshold = DS_BROWNOUT_THRESHOLD;
+    ctx->stats.time_to_brownout = -1;
+    DS_MutexInit (&ctx->mutex);
+}
+
+/**
+ * Releases the voltage trend of a DS context
+ */
+static void destroy_context (void* data)
+{
+    BrownoutContext* ctx = (BrownoutContext*) data;
+    DS_MutexDestroy (&ctx->mutex);
+}
+
+/**
+ * Returns the voltage trend of the current DS context
+ */
+static BrownoutContext* get_context (void)
+{
+    return (BrownoutContext*) DS_ContextData (DS_CONTEXT_BROWNOUT,
+                                              sizeof (BrownoutContext),
+                                              init_context, destroy_context);
+}
+
+/**
+ * Returns the weight of a new sample in an exponentially weighted average
+ * with the given time constant (\a tau, in msecs), when \a secs seconds
+ * have passed since the previous sample
+ */
+static float blend_factor (const double secs, const int tau)
+{
+    return (float) (1 - exp (-secs * 1000 / tau));
+}
+
+/**
+ * Predicts the time (in msecs) until the filtered voltage reaches the
+ * brownout threshold if it keeps its current slope
+ *
+ * \returns the predicted time, or \c -1 if the voltage is not falling
+ */
+static int predict_brownout (const DS_VoltageStats* stats,
+                             const float threshold)
+{
+    if (stats->voltage <= threshold)
+        return 0;
+
+    if (stats->slope >= 0)
+        return -1;
+
+    double msecs = (stats->voltage - threshold) / -stats->slope * 1000;
+    return (int) DS_Min (msecs, (double) INT32_MAX);
+}
+
+/**
+ * Raises the warning if the voltage is close to the threshold or if a
+ * brownout is predicted soon, and clears it once the voltage recovered
+ *
+ * \returns \c 1 if the warning changed, \c 0 if not
+ */
+static int update_warning (BrownoutContext* ctx)
+{
+    DS_VoltageStats* stats = &ctx->stats;
+    float level = ctx->threshold + DS_BROWNOUT_MARGIN;
+    int predicted = stats->time_to_brownout;
+
+    int warn = stats->voltage < level ||
+               (predicted >= 0 && predicted < DS_BROWNOUT_HORIZON);
+    int clear = stats->voltage > level + CLEAR_MARGIN &&
+                (predicted < 0 || predicted > DS_BROWNOUT_HORIZON * 2);
+
+    if (!stats->warning && warn) {
+        stats->warning = 1;
+        return 1;
+    }
+
+    if (stats->warning && clear) {
+        stats->warning = 0;
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Registers a \c DS_ROBOT_BROWNOUT_WARNING event with the given \a stats
+ */
+static void create_event (const DS_VoltageStats* stats)
+{
+    DS_Event event;
+    event.brownout.type = DS_ROBOT_BROWNOUT_WARNING;
+    event.brownout.warning = stats->warning;
+    event.brownout.voltage = stats->voltage;
+    event.brownout.slope = stats->slope;
+    event.brownout.time_to_brownout = stats->time_to_brownout;
+    DS_AddEvent (&event);
+}
+
+/**
+ * Clears the voltage history and statistics (e.g. when the robot
+ * disconnects), and clears the warning if it was raised
+ */
+void Brownout_Reset (void)
+{
+    BrownoutContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    int warning = ctx->stats.warning;
+    ctx->count = 0;
+    ctx->newest = 0;
+    ctx->last_time = 0;
+    memset (&ctx->stats, 0, sizeof (ctx->stats));
+    ctx->stats.time_to_brownout = -1;
+    DS_VoltageStats stats = ctx->stats;
+    DS_MutexUnlock (&ctx->mutex);
+
+    if (warning)
+        create_event (&stats);
+}
+
+/**
+ * Adds the given \a voltage (received from the robot) to the history and
+ * updates the voltage statistics in constant time, a
+ * \c DS_ROBOT_BROWNOUT_WARNING event is registered when the warning is
+ * raised or cleared. A voltage of \c 0 (or less) means that the robot is
+ * not connected, and resets the statistics.
+ */
+void Brownout_AddSample (const float voltage)
+{
+    BrownoutContext* ctx = get_context();
+
+    if (voltage <= 0) {
+        if (ctx->count > 0)
+            Brownout_Reset();
+
+        return;
+    }
+
+    uint64_t now = DS_GetTimeUs();
+
+    DS_MutexLock (&ctx->mutex);
+
+    /* Store the sample in the history */
+    ctx->newest = (ctx->count > 0) ? (ctx->newest + 1) % DS_VOLTAGE_HISTORY : 0;
+    ctx->history [ctx->newest].time = now / 1000;
+    ctx->history [ctx->newest].voltage = voltage;
+    ctx->count = DS_Min (ctx->count + 1, DS_VOLTAGE_HISTORY);
+
+    /* The first sample initializes the averages */
+    DS_VoltageStats* stats = &ctx->stats;
+    if (stats->samples == 0) {
+        stats->voltage = voltage;
+        stats->resting = voltage;
+        stats->slope = 0;
+    }
+
+    /* Blend the sample into the averages (using the time between samples) */
+    else {
+        double secs = DS_Max ((now - ctx->last_time) / 1000000.0, 0.001);
+        float previous = stats->voltage;
+
+        stats->voltage += blend_factor (secs, DS_VOLTAGE_FAST_TAU) *
+                          (voltage - stats->voltage);
+        stats->resting += blend_factor (secs, DS_VOLTAGE_SLOW_TAU) *
+                          (voltage - stats->resting);
+
+        float slope = (float) ((stats->voltage - previous) / secs);
+        stats->slope += blend_factor (secs, DS_VOLTAGE_SLOPE_TAU) *
+                        (slope - stats->slope);
+    }
+
+    ctx->last_time = now;
+    stats->samples += 1;
+    stats->sag = DS_Max (stats->resting - stats->voltage, 0);
+    stats->time_to_brownout = predict_brownout (stats, ctx->threshold);
+
+    int changed = update_warning (ctx);
+    DS_VoltageStats copy = *stats;
+    DS_MutexUnlock (&ctx->mutex);
+
+    if (changed)
+        create_event (&copy);
+}
+
+/**
+ * Returns \c 1 if the robot voltage is approaching the brownout threshold
+ */
+int DS_BrownoutWarning (void)
+{
+    BrownoutContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    int warning = ctx->stats.warning;
+    DS_MutexUnlock (&ctx->mutex);
+
+    return warning;
+}
+
+/**
+ * Returns the voltage (in volts) at which the robot browns out
+ */
+float DS_GetBrownoutThreshold (void)
+{
+    BrownoutContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    float threshold = ctx->threshold;
+    DS_MutexUnlock (&ctx->mutex);
+
+    return threshold;
+}
+
+/**
+ * Changes the voltage at which the robot browns out (e.g. if the brownout
+ * threshold of the roboRIO was configured), the warning is raised
+ * \c DS_BROWNOUT_MARGIN volts above the threshold, or when the voltage trend
+ * predicts that the threshold is reached within \c DS_BROWNOUT_HORIZON msecs
+ */
+void DS_SetBrownoutThreshold (const float volts)
+{
+    BrownoutContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    ctx->threshold = DS_Max (volts, 0);
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Copies the voltage statistics into the given \a stats structure, the
+ * minimum voltage is obtained from the voltage history
+ */
+void DS_GetVoltageStats (DS_VoltageStats* stats)
+{
+    int i;
+    BrownoutContext* ctx = get_context();
+
+    /* Check arguments */
+    assert (stats);
+
+    DS_MutexLock (&ctx->mutex);
+    *stats = ctx->stats;
+    for (i = 0; i < ctx->count; ++i) {
+        float voltage = ctx->history [i].voltage;
+        stats->minimum = (i == 0) ? voltage : DS_Min (stats->minimum, voltage);
+    }
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Copies (up to \a max) of the most recent voltage samples into the given
+ * array, oldest first
+ *
+ * \returns the number of copied samples
+ */
+int DS_GetVoltageHistory (DS_VoltageSample* samples, const int max)
+{
+    int i;
+    BrownoutContext* ctx = get_context();
+
+    /* Check arguments */
+    assert (samples || max <= 0);
+
+    DS_MutexLock (&ctx->mutex);
+    int count = DS_Max (DS_Min (ctx->count, max), 0);
+    for (i = 0; i < count; ++i) {
+        int index = ctx->newest - count + 1 + i;
+        samples [i] = ctx->history [(index + DS_VOLTAGE_HISTORY) %
+                                    DS_VOLTAGE_HISTORY];
+    }
+    DS_MutexUnlock (&ctx->mutex);
+
+    return count;
+}
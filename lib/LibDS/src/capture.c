@@ -0,0 +1,736 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Utils.h"
+#include "DS_Timer.h"
+#include "DS_Atomic.h"
+#include "DS_Config.h"
+#include "DS_Socket.h"
+#include "DS_Capture.h"
+#include "DS_Context.h"
+#include "DS_Protocol.h"
+#include "DS_Thread.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#define FLUSH_INTERVAL 250 /* Time (in msecs) between capture file writes */
+#define MAX_VARINT     10  /* Maximum size of an encoded 64-bit varint */
+#define V1_HEADER_SIZE 16  /* Header size of version 1 captures */
+
+/*
+ * Growable byte buffer in which the captured records are encoded
+ */
+typedef struct {
+    uint8_t* data;
+    size_t len;
+    size_t cap;
+} CaptureBuffer;
+
+/*
+ * Capture and replay state of a DS context:
+ *
+ * - The event loop encodes the records in one of the two buffers, while the
+ *   writer thread writes the other one to the file, so that the event loop
+ *   never waits for the disk. The mutex protects the buffers and the file.
+ * - The replayed file is only used by the event loop, the application
+ *   requests a new replay (or the end of the current one) by incrementing
+ *   \c replay_requests, the requested file is protected by the mutex
+ */
+typedef struct {
+    /* Capture data */
+    volatile size_t capturing;
+    FILE* file;
+    int failed;
+    int writer_running;
+    int filling;
+    uint64_t start;
+    uint64_t last_record;
+    CaptureBuffer buffers [2];
+    DS_Thread writer;
+    DS_Cond cond;
+    DS_Mutex mutex;
+
+    /* Replay requests of the application */
+    volatile size_t replaying;
+    volatile size_t replay_requests;
+    DS_CaptureFile requested_file;
+    double requested_speed;
+
+    /* Replay state (owned by the event loop) */
+    size_t applied_replay_requests;
+    DS_CaptureFile replay;
+    double speed;
+    uint64_t replay_start;
+    int has_next;
+    DS_CaptureRecord next;
+} CaptureContext;
+
+/**
+ * Initializes the capture state of a new DS context
+ */
+static void init_context (void* data)
+{
+    CaptureContext* ctx = (CaptureContext*) data;
+
+    DS_CondInit (&ctx->cond);
+    DS_MutexInit (&ctx->mutex);
+}
+
+/**
+ * Releases the capture state of a DS context
+ */
+static void destroy_context (void* data)
+{
+    CaptureContext* ctx = (CaptureContext*) data;
+
+    DS_CondDestroy (&ctx->cond);
+    DS_MutexDestroy (&ctx->mutex);
+}
+
+/**
+ * Returns the capture state of the current DS context
+ */
+static CaptureContext* get_context (void)
+{
+    return (CaptureContext*) DS_ContextData (DS_CONTEXT_CAPTURE,
+                                             sizeof (CaptureContext),
+                                             init_context, destroy_context);
+}
+
+/**
+ * Makes room for \a size more bytes in the given \a buffer
+ *
+ * \returns \c 0 if the buffer cannot be enlarged
+ */
+static int reserve (CaptureBuffer* buffer, const size_t size)
+{
+    if (buffer->len + size <= buffer->cap)
+        return 1;
+
+    size_t cap = DS_Max (buffer->cap * 2, buffer->len + size);
+    uint8_t* data = (uint8_t*) DS_REALLOC (DS_MEMORY_GENERAL,
+                                           buffer->data, cap);
+    if (!data)
+        return 0;
+
+    buffer->data = data;
+    buffer->cap = cap;
+    return 1;
+}
+
+/**
+ * Appends the given \a value to the \a buffer as an unsigned LEB128 varint,
+ * the buffer must have room for \c MAX_VARINT bytes
+ */
+static void put_varint (CaptureBuffer* buffer, uint64_t value)
+{
+    while (value >= 0x80) {
+        buffer->data [buffer->len++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+
+    buffer->data [buffer->len++] = (uint8_t) value;
+}
+
+/**
+ * Reads an unsigned LEB128 varint from the given \a data
+ *
+ * \returns \c 0 if the varint is truncated or too long
+ */
+static int get_varint (const uint8_t* data, const size_t size,
+                       size_t* offset, uint64_t* value)
+{
+    int i;
+    *value = 0;
+
+    for (i = 0; i < MAX_VARINT && *offset < size; ++i) {
+        uint8_t byte = data [(*offset)++];
+        *value |= (uint64_t) (byte & 0x7f) << (7 * i);
+
+        if (!(byte & 0x80))
+            return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Writes the given little-endian \a value to the \a bytes
+ */
+static void encode_u16 (uint8_t* bytes, const uint16_t value)
+{
+    bytes [0] = (value & 0xff);
+    bytes [1] = (value >> 8) & 0xff;
+}
+
+/**
+ * Writes the given little-endian \a value to the \a bytes
+ */
+static void encode_u32 (uint8_t* bytes, const uint32_t value)
+{
+    encode_u16 (bytes, (uint16_t) value);
+    encode_u16 (bytes + 2, (uint16_t) (value >> 16));
+}
+
+/**
+ * Writes the local and remote ports of the given \a socket to the \a bytes
+ */
+static void encode_ports (uint8_t* bytes, const DS_Socket* socket)
+{
+    encode_u16 (bytes, (uint16_t) socket->in_port);
+    encode_u16 (bytes + 2, (uint16_t) socket->out_port);
+}
+
+/**
+ * Reads a little-endian integer of the given number of \a bytes
+ */
+static uint64_t decode_le (const uint8_t* data, const int bytes)
+{
+    int i;
+    uint64_t value = 0;
+
+    for (i = bytes - 1; i >= 0; --i)
+        value = (value << 8) | data [i];
+
+    return value;
+}
+
+/**
+ * Writes the contents of the given \a buffer to the capture file and empties
+ * the buffer. This function is called without holding the mutex, but only
+ * for the buffer that the event loop is not filling.
+ */
+static void write_buffer (CaptureContext* ctx, CaptureBuffer* buffer)
+{
+    if (buffer->len > 0 && ctx->file) {
+        if (fwrite (buffer->data, 1, buffer->len, ctx->file) != buffer->len)
+            ctx->failed = 1;
+
+        fflush (ctx->file);
+    }
+
+    buffer->len = 0;
+}
+
+/**
+ * Periodically writes the records encoded by the event loop to the capture
+ * file, until the capture is stopped
+ */
+static void* run_writer (void* data)
+{
+    CaptureContext* ctx = (CaptureContext*) data;
+
+    DS_MutexLock (&ctx->mutex);
+    while (ctx->writer_running) {
+        DS_TimedWait (&ctx->cond, &ctx->mutex, FLUSH_INTERVAL);
+
+        /* Nothing to write */
+        CaptureBuffer* buffer = &ctx->buffers [ctx->filling];
+        if (buffer->len == 0)
+            continue;
+
+        /* Let the event loop fill the other buffer while we write this one */
+        ctx->filling = !ctx->filling;
+        DS_MutexUnlock (&ctx->mutex);
+        write_buffer (ctx, buffer);
+        DS_MutexLock (&ctx->mutex);
+    }
+    DS_MutexUnlock (&ctx->mutex);
+
+    return NULL;
+}
+
+/**
+ * Reads the next received datagram of the replayed file
+ */
+static void read_next (CaptureContext* ctx)
+{
+    ctx->has_next = 0;
+
+    while (DS_CaptureRead (&ctx->replay, &ctx->next)) {
+        if (ctx->next.received) {
+            ctx->has_next = 1;
+            return;
+        }
+    }
+}
+
+/**
+ * Returns the number of microseconds until the next replayed datagram must
+ * be read (\c 0 if it must be read now)
+ */
+static uint64_t replay_wait (CaptureContext* ctx)
+{
+    uint64_t due = ctx->replay_start;
+    if (ctx->speed > 0)
+        due += (uint64_t) (ctx->next.time / ctx->speed);
+
+    uint64_t now = DS_GetTimeUs();
+    return due > now ? due - now : 0;
+}
+
+/**
+ * Starts or stops the replay requested by the application, or ends the
+ * current replay once all of its datagrams have been read
+ */
+static void update_replay (CaptureContext* ctx)
+{
+    /* Switch to the requested file (or stop the replay) */
+    size_t requests = DS_AtomicLoad (&ctx->replay_requests);
+    if (requests != ctx->applied_replay_requests) {
+        ctx->applied_replay_requests = requests;
+
+        DS_MutexLock (&ctx->mutex);
+        DS_CaptureFree (&ctx->replay);
+        ctx->replay = ctx->requested_file;
+        ctx->speed = ctx->requested_speed;
+        memset (&ctx->requested_file, 0, sizeof (DS_CaptureFile));
+        DS_MutexUnlock (&ctx->mutex);
+
+        ctx->replay_start = DS_GetTimeUs();
+        read_next (ctx);
+    }
+
+    /* All the datagrams have been read, end the replay */
+    if (ctx->replay.data && !ctx->has_next) {
+        DS_CaptureFree (&ctx->replay);
+
+        DS_MutexLock (&ctx->mutex);
+        if (DS_AtomicLoad (&ctx->replay_requests) == requests)
+            DS_AtomicStore (&ctx->replaying, 0);
+        DS_MutexUnlock (&ctx->mutex);
+
+        CFG_AddStaticNotification (CFG_NOTIFY_REPLAY_FINISHED);
+    }
+}
+
+/**
+ * Stops the capture and discards the replayed files
+ */
+void Capture_Close (void)
+{
+    CaptureContext* ctx = get_context();
+
+    DS_StopCapture();
+
+    DS_MutexLock (&ctx->mutex);
+    DS_CaptureFree (&ctx->requested_file);
+    DS_AtomicStore (&ctx->replaying, 0);
+    ctx->applied_replay_requests = DS_AtomicLoad (&ctx->replay_requests);
+    DS_MutexUnlock (&ctx->mutex);
+
+    DS_CaptureFree (&ctx->replay);
+    ctx->has_next = 0;
+}
+
+/**
+ * Appends the given datagram to the capture file (if a capture is running),
+ * this function is called by the event loop for every sent and received
+ * datagram
+ *
+ * \param channel the channel of the datagram
+ * \param received set to \c 1 if the datagram was received
+ * \param data the contents of the datagram
+ */
+void Capture_Record (const DS_CaptureChannel channel,
+                     const int received,
+                     const DS_String* data)
+{
+    CaptureContext* ctx = get_context();
+
+    /* No capture is running, or channel is not captured */
+    if (!DS_AtomicLoad (&ctx->capturing) || !data ||
+            channel >= DS_CAPTURE_CHANNEL_COUNT)
+        return;
+
+    uint64_t time = DS_GetTimeUs() - ctx->start;
+    int failed = 0;
+
+    DS_MutexLock (&ctx->mutex);
+
+    /* Encode the record */
+    CaptureBuffer* buffer = &ctx->buffers [ctx->filling];
+    if (ctx->file && reserve (buffer, 1 + 2 * MAX_VARINT + data->len + 4)) {
+        size_t start = buffer->len;
+        buffer->data [buffer->len++] = (uint8_t) channel |
+                                       (received ? DS_CAPTURE_RECEIVED : 0);
+        put_varint (buffer, time - ctx->last_record);
+        put_varint (buffer, data->len);
+        memcpy (buffer->data + buffer->len, data->buf, data->len);
+        buffer->len += data->len;
+
+        encode_u32 (buffer->data + buffer->len,
+                    DS_CRC32 (buffer->data + start, buffer->len - start));
+        buffer->len += 4;
+        ctx->last_record = time;
+    }
+
+    /* Notify the user once if the file cannot be written */
+    if (ctx->failed == 1) {
+        ctx->failed = 2;
+        failed = 1;
+    }
+
+    DS_MutexUnlock (&ctx->mutex);
+
+    if (failed)
+        CFG_AddStaticNotification (CFG_NOTIFY_CAPTURE_WRITE_FAILED);
+}
+
+/**
+ * Returns \c 1 if the event loop is replaying a capture, in which case the
+ * protocol must not send packets nor read the datagrams of its sockets
+ */
+int Replay_Running (void)
+{
+    CaptureContext* ctx = get_context();
+    update_replay (ctx);
+
+    return ctx->replay.data != NULL;
+}
+
+/**
+ * Returns the number of milliseconds until the next replayed datagram must
+ * be read, \c 0 if it must be read now, or \c -1 if no capture is being
+ * replayed. This function is called by the event loop.
+ */
+int Replay_Remaining (void)
+{
+    CaptureContext* ctx = get_context();
+    update_replay (ctx);
+
+    if (!ctx->has_next)
+        return ctx->replay.data ? 0 : -1;
+
+    return (int) ((replay_wait (ctx) + 999) / 1000);
+}
+
+/**
+ * Obtains the next replayed datagram that must be read now, the event loop
+ * passes it to the protocol as if it had been received by its socket. The
+ * data of the \a record is valid until the next call to this function.
+ *
+ * \returns \c 1 if a datagram is due, \c 0 if not
+ */
+int Replay_Next (DS_CaptureRecord* record)
+{
+    CaptureContext* ctx = get_context();
+
+    assert (record);
+    update_replay (ctx);
+
+    if (!ctx->has_next || replay_wait (ctx) > 0)
+        return 0;
+
+    *record = ctx->next;
+    read_next (ctx);
+    return 1;
+}
+
+/**
+ * Starts recording every datagram sent and received by the current DS
+ * context (FMS, radio, robot and NetConsole) in a new capture file at the
+ * given \a path. A running capture is stopped first.
+ *
+ * The event loop only encodes the records in memory, the file is written
+ * by a separate thread every few hundred milliseconds.
+ *
+ * \returns \c 1 on success, \c 0 if the file cannot be created
+ */
+int DS_StartCapture (const char* path)
+{
+    CaptureContext* ctx = get_context();
+
+    assert (path);
+    DS_StopCapture();
+
+    /* Create the file and write the header */
+    FILE* file = fopen (path, "wb");
+    if (!file)
+        return 0;
+
+    uint8_t header [DS_CAPTURE_HEADER_SIZE] = {0};
+    uint64_t time = DS_GetWallTimeUs();
+    memcpy (header, DS_CAPTURE_MAGIC, 4);
+    header [4] = DS_CAPTURE_VERSION;
+    encode_u16 (header + 6, (uint16_t) CFG_GetTeamNumber());
+    encode_u32 (header + 8, (uint32_t) time);
+    encode_u32 (header + 12, (uint32_t) (time >> 32));
+
+    /* Save the ports of the protocol, so that the capture can be exported */
+    DS_Protocol* protocol = DS_CurrentProtocol();
+    if (protocol) {
+        encode_ports (header + 16, &protocol->fms_socket);
+        encode_ports (header + 20, &protocol->radio_socket);
+        encode_ports (header + 24, &protocol->robot_socket);
+        encode_ports (header + 28, &protocol->netconsole_socket);
+    }
+
+    if (fwrite (header, 1, sizeof (header), file) != sizeof (header)) {
+        fclose (file);
+        return 0;
+    }
+
+    /* Start the writer thread */
+    DS_MutexLock (&ctx->mutex);
+    ctx->file = file;
+    ctx->failed = 0;
+    ctx->filling = 0;
+    ctx->last_record = 0;
+    ctx->start = DS_GetTimeUs();
+    ctx->writer_running = 1;
+    DS_MutexUnlock (&ctx->mutex);
+
+    if (DS_CreateThread (&ctx->writer, "DS Capture", &run_writer, ctx) != 0) {
+        DS_MutexLock (&ctx->mutex);
+        ctx->file = NULL;
+        ctx->writer_running = 0;
+        DS_MutexUnlock (&ctx->mutex);
+
+        fclose (file);
+        return 0;
+    }
+
+    DS_AtomicStore (&ctx->capturing, 1);
+    return 1;
+}
+
+/**
+ * Stops the running capture (if any) and closes its file
+ */
+void DS_StopCapture (void)
+{
+    CaptureContext* ctx = get_context();
+
+    if (!DS_AtomicLoad (&ctx->capturing))
+        return;
+
+    /* Stop the writer thread */
+    DS_MutexLock (&ctx->mutex);
+    DS_AtomicStore (&ctx->capturing, 0);
+    ctx->writer_running = 0;
+    DS_CondSignal (&ctx->cond);
+    DS_MutexUnlock (&ctx->mutex);
+    DS_JoinThread (ctx->writer);
+
+    /* Write the remaining records and close the file */
+    DS_MutexLock (&ctx->mutex);
+    write_buffer (ctx, &ctx->buffers [ctx->filling]);
+    fclose (ctx->file);
+    ctx->file = NULL;
+
+    DS_FREE (ctx->buffers [0].data);
+    DS_FREE (ctx->buffers [1].data);
+    memset (ctx->buffers, 0, sizeof (ctx->buffers));
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Returns \c 1 if a capture is running
+ */
+int DS_CaptureActive (void)
+{
+    return DS_AtomicLoad (&get_context()->capturing) != 0;
+}
+
+/**
+ * Replays the capture file at the given \a path: the received datagrams of
+ * the capture are passed to the current protocol (instead of the datagrams
+ * received by the sockets) with their original timing, and no packets are
+ * sent while the replay runs. Sent datagrams of the capture are ignored.
+ *
+ * The replay is deterministic as long as the same protocol is loaded, so
+ * that a problem reported after a match can be reproduced. The replay ends
+ * (and the sockets are used again) after the last datagram.
+ *
+ * \param path the location of the capture file
+ * \param speed the replay speed (e.g. \c 1 for the original speed or \c 10
+ *              to replay ten times faster), if it is \c 0, the datagrams are
+ *              read as fast as possible (which also measures the decoding
+ *              throughput of the protocol)
+ *
+ * \returns \c 1 on success, \c 0 if the file cannot be read
+ */
+int DS_StartReplay (const char* path, const double speed)
+{
+    CaptureContext* ctx = get_context();
+    DS_CaptureFile file;
+
+    assert (path);
+    if (!DS_CaptureLoad (&file, path))
+        return 0;
+
+    /* Let the event loop switch to the new file */
+    DS_MutexLock (&ctx->mutex);
+    DS_CaptureFree (&ctx->requested_file);
+    ctx->requested_file = file;
+    ctx->requested_speed = DS_Max (speed, 0);
+    DS_AtomicStore (&ctx->replaying, 1);
+    DS_AtomicFetchAdd (&ctx->replay_requests, 1);
+    DS_MutexUnlock (&ctx->mutex);
+
+    DS_SocketWakeUp();
+    return 1;
+}
+
+/**
+ * Stops the current replay, the protocol uses the sockets again
+ */
+void DS_StopReplay (void)
+{
+    CaptureContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    DS_CaptureFree (&ctx->requested_file);
+    DS_AtomicStore (&ctx->replaying, 0);
+    DS_AtomicFetchAdd (&ctx->replay_requests, 1);
+    DS_MutexUnlock (&ctx->mutex);
+
+    DS_SocketWakeUp();
+}
+
+/**
+ * Returns \c 1 if a capture is being replayed
+ */
+int DS_ReplayActive (void)
+{
+    return DS_AtomicLoad (&get_context()->replaying) != 0;
+}
+
+/**
+ * Loads the capture file at the given \a path in memory, the records can
+ * then be read with \c DS_CaptureRead()
+ *
+ * \returns \c 1 on success, \c 0 if the file cannot be read or if it is
+ *          not a capture file
+ */
+int DS_CaptureLoad (DS_CaptureFile* file, const char* path)
+{
+    assert (file);
+    assert (path);
+    memset (file, 0, sizeof (DS_CaptureFile));
+
+    FILE* fp = fopen (path, "rb");
+    if (!fp)
+        return 0;
+
+    /* Read the whole file */
+    long size = -1;
+    if (fseek (fp, 0, SEEK_END) == 0)
+        size = ftell (fp);
+
+    if (size >= V1_HEADER_SIZE && fseek (fp, 0, SEEK_SET) == 0) {
+        file->data = (uint8_t*) DS_MALLOC (DS_MEMORY_GENERAL, (size_t) size);
+        file->size = (size_t) size;
+
+        if (file->data && fread (file->data, 1, file->size, fp) != file->size)
+            DS_FREE (file->data);
+    }
+
+    fclose (fp);
+
+    /* Check the header */
+    if (!file->data || memcmp (file->data, DS_CAPTURE_MAGIC, 4) != 0 ||
+            file->data [4] > DS_CAPTURE_VERSION ||
+            (file->data [4] >= 2 && file->size < DS_CAPTURE_HEADER_SIZE)) {
+        DS_CaptureFree (file);
+        return 0;
+    }
+
+    file->offset = V1_HEADER_SIZE;
+    file->start_time = decode_le (file->data + 8, 8);
+
+    /* Read the team number and the ports of each channel */
+    if (file->data [4] >= 2) {
+        int i;
+        file->offset = DS_CAPTURE_HEADER_SIZE;
+        file->team = (int) decode_le (file->data + 6, 2);
+
+        for (i = 0; i < DS_CAPTURE_CHANNEL_COUNT; ++i) {
+            const uint8_t* ports = file->data + V1_HEADER_SIZE + i * 4;
+            file->local_ports [i] = (int) decode_le (ports, 2);
+            file->remote_ports [i] = (int) decode_le (ports + 2, 2);
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * Reads the next record of the given capture \a file, the data of the
+ * \a record points to the contents of the file
+ *
+ * \returns \c 0 at the end of the file, or if the next record is incomplete
+ *          or corrupted (e.g. the last record of an interrupted capture)
+ */
+int DS_CaptureRead (DS_CaptureFile* file, DS_CaptureRecord* record)
+{
+    assert (file);
+    assert (record);
+
+    uint64_t time;
+    uint64_t len;
+    size_t offset = file->offset;
+
+    /* Read the record header */
+    if (!file->data || offset >= file->size)
+        return 0;
+
+    uint8_t type = file->data [offset++];
+    if (!get_varint (file->data, file->size, &offset, &time) ||
+            !get_varint (file->data, file->size, &offset, &len) ||
+            len > file->size || offset + len + 4 > file->size)
+        return 0;
+
+    /* Verify the channel and the checksum */
+    uint32_t crc = (uint32_t) decode_le (file->data + offset + len, 4);
+    if ((type & ~DS_CAPTURE_RECEIVED) >= DS_CAPTURE_CHANNEL_COUNT ||
+            DS_CRC32 (file->data + file->offset,
+                      offset + len - file->offset) != crc)
+        return 0;
+
+    file->time += time;
+    file->offset = offset + len + 4;
+
+    record->channel = (DS_CaptureChannel) (type & ~DS_CAPTURE_RECEIVED);
+    record->received = (type & DS_CAPTURE_RECEIVED) != 0;
+    record->time = file->time;
+    record->data.buf = (char*) file->data + offset;
+    record->data.len = (size_t) len;
+    record->data.cap = 0;
+
+    return 1;
+}
+
+/**
+ * Releases the memory used by the given capture \a file
+ */
+void DS_CaptureFree (DS_CaptureFile* file)
+{
+    assert (file);
+
+    DS_FREE (file->data);
+    memset (file, 0, sizeof (DS_CaptureFile));
+}
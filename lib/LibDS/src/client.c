@@ -22,32 +22,123 @@
  */
 
 #include "DS_Utils.h"
+#include "DS_Timer.h"
+#include "DS_Atomic.h"
+#include "DS_Socket.h"
 #include "DS_Client.h"
 #include "DS_Config.h"
 #include "DS_String.h"
+#include "DS_Context.h"
 #include "DS_Protocol.h"
+#include "DS_Lifecycle.h"
+#include "DS_NetConsole.h"
 
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
 
+/*
+ * Number of state changes that can wait for the event loop (must be a
+ * power of two)
+ */
+#define COMMAND_QUEUE_SIZE 64
+
+/*
+ * Number of consecutive robot watchdog expirations (about one per second)
+ * after which the last known robot address is no longer probed, long enough
+ * for the robot to boot or to recover from a brownout
+ */
+#define KNOWN_ADDRESS_RETRIES 120
+
+/*
+ * Robot state changes requested by the application
+ */
+typedef enum {
+    COMMAND_ENABLED,
+    COMMAND_ESTOP,
+    COMMAND_MODE,
+    COMMAND_ALLIANCE,
+    COMMAND_POSITION,
+} CommandType;
+
+/*
+ * A cell of the command queue. The queue uses the same scheme as the event
+ * queue (see events.c): the sequence number of each cell tells producers and
+ * the consumer if the cell is free or holds a command, so no locks are needed.
+ * Any thread may submit commands, only the event loop consumes them.
+ */
+typedef struct {
+    volatile size_t seq;
+    CommandType type;
+    int value;
+} CommandCell;
+
 /*
  * Set the strings
  */
-static DS_String status_string;
-static DS_String custom_fms_address;
-static DS_String custom_radio_address;
-static DS_String custom_robot_address;
+typedef struct {
+    DS_String status_string;
+    DS_String fallback_address;
+    DS_String custom_fms_address;
+    DS_String custom_radio_address;
+    DS_String custom_robot_address;
+
+    /*
+     * Last known robot address, ignored once it is found to be invalid (the
+     * robot replies through another address, or it did not reply through
+     * any address for KNOWN_ADDRESS_RETRIES watchdog cycles)
+     */
+    DS_String known_robot_address;
+    volatile int known_robot_valid;
+    int known_robot_failures;
+
+    /*
+     * Configuration transaction, the addresses are re-applied when it is
+     * committed (the saved values are restored if it is cancelled)
+     */
+    int transaction;
+    int saved_team;
+    DS_String saved_fms_address;
+    DS_String saved_radio_address;
+    DS_String saved_robot_address;
+    DS_String saved_known_address;
+
+    /* State changes waiting to be applied by the event loop */
+    CommandCell commands [COMMAND_QUEUE_SIZE];
+    volatile size_t command_enqueue;
+    size_t command_dequeue;
+} ClientContext;
+
+/**
+ * Returns the client state of the current DS context
+ */
+static ClientContext* get_context (void)
+{
+    return (ClientContext*) DS_ContextData (DS_CONTEXT_CLIENT,
+                                            sizeof (ClientContext),
+                                            NULL, NULL);
+}
 
 /**
  * Allocates memory for the members of the client module
  */
 void Client_Init (void)
 {
-    status_string = DS_StrNew ("Loading...");
-    custom_fms_address = DS_StrNew (DS_FallBackAddress);
-    custom_radio_address = DS_StrNew (DS_FallBackAddress);
-    custom_robot_address = DS_StrNew (DS_FallBackAddress);
+    size_t i;
+    ClientContext* ctx = get_context();
+
+    for (i = 0; i < COMMAND_QUEUE_SIZE; ++i)
+        DS_AtomicStore (&ctx->commands [i].seq, i);
+
+    ctx->command_enqueue = 0;
+    ctx->command_dequeue = 0;
+
+    ctx->status_string = DS_StrNew ("Loading...");
+    ctx->fallback_address = DS_StrNew (DS_FallBackAddress);
+    ctx->custom_fms_address = DS_StrNew (DS_FallBackAddress);
+    ctx->custom_radio_address = DS_StrNew (DS_FallBackAddress);
+    ctx->custom_robot_address = DS_StrNew (DS_FallBackAddress);
+    ctx->known_robot_address = DS_StrNewLen (0);
 }
 
 /**
@@ -55,88 +146,316 @@ void Client_Init (void)
  */
 void Client_Close (void)
 {
-    DS_StrRmBuf (&status_string);
-    DS_StrRmBuf (&custom_fms_address);
-    DS_StrRmBuf (&custom_radio_address);
-    DS_StrRmBuf (&custom_robot_address);
+    ClientContext* ctx = get_context();
+
+    DS_StrRmBuf (&ctx->status_string);
+    DS_StrRmBuf (&ctx->fallback_address);
+    DS_StrRmBuf (&ctx->custom_fms_address);
+    DS_StrRmBuf (&ctx->custom_radio_address);
+    DS_StrRmBuf (&ctx->custom_robot_address);
+    DS_StrRmBuf (&ctx->known_robot_address);
+
+    if (ctx->transaction) {
+        ctx->transaction = 0;
+        DS_StrRmBuf (&ctx->saved_fms_address);
+        DS_StrRmBuf (&ctx->saved_radio_address);
+        DS_StrRmBuf (&ctx->saved_robot_address);
+        DS_StrRmBuf (&ctx->saved_known_address);
+    }
+}
+
+/**
+ * Called when the robot watchdog expires (the robot did not reply through
+ * any of its addresses). The last known robot address is still probed,
+ * unless the robot did not reply for \c KNOWN_ADDRESS_RETRIES cycles.
+ */
+void Client_KnownRobotAddressFailed (void)
+{
+    ClientContext* ctx = get_context();
+
+    if (ctx->known_robot_valid
+            && ++ctx->known_robot_failures >= KNOWN_ADDRESS_RETRIES)
+        ctx->known_robot_valid = 0;
+}
+
+/**
+ * Called when the robot communications are established. The last known
+ * robot address is no longer probed if the robot replied through a different
+ * address (the sockets are not reconfigured, so the communications are not
+ * interrupted).
+ */
+void Client_RobotAddressConfirmed (void)
+{
+    ClientContext* ctx = get_context();
+
+    ctx->known_robot_failures = 0;
+    if (!ctx->known_robot_valid || !DS_CurrentProtocol())
+        return;
+
+    DS_String host = DS_SocketRemoteHost (&DS_CurrentProtocol()->robot_socket);
+    if (!DS_StrEmpty (&host)
+            && DS_StrCompare (&host, &ctx->known_robot_address) != 0)
+        ctx->known_robot_valid = 0;
+
+    DS_StrRmBuf (&host);
+}
+
+/**
+ * Changes the robot state as requested by the given command
+ */
+static void apply_command (const CommandType type, const int value)
+{
+    int previous;
+
+    switch (type) {
+    case COMMAND_ENABLED:
+        previous = CFG_GetRobotEnabled();
+        CFG_SetRobotEnabled (value);
+        if (CFG_GetRobotEnabled() != previous)
+            DS_SendStateChange();
+        break;
+    case COMMAND_ESTOP:
+        previous = CFG_GetEmergencyStopped();
+        CFG_SetEmergencyStopped (value);
+        if (CFG_GetEmergencyStopped() != previous)
+            DS_SendStateChange();
+        break;
+    case COMMAND_MODE:
+        CFG_SetControlMode ((DS_ControlMode) value);
+        break;
+    case COMMAND_ALLIANCE:
+        CFG_SetAlliance ((DS_Alliance) value);
+        break;
+    case COMMAND_POSITION:
+        CFG_SetPosition ((DS_Position) value);
+        break;
+    }
+}
+
+/**
+ * Adds a command to the queue
+ *
+ * \returns \c 1 on success, \c 0 if the queue is full
+ */
+static int enqueue_command (ClientContext* ctx, const CommandType type,
+                            const int value)
+{
+    CommandCell* cell;
+    size_t pos = DS_AtomicLoad (&ctx->command_enqueue);
+
+    /* Reserve a cell */
+    for (;;) {
+        cell = &ctx->commands [pos & (COMMAND_QUEUE_SIZE - 1)];
+        size_t seq = DS_AtomicLoad (&cell->seq);
+        intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+
+        if (diff == 0) {
+            if (DS_AtomicCAS (&ctx->command_enqueue, pos, pos + 1))
+                break;
+        }
+
+        else if (diff < 0)
+            return 0;
+
+        pos = DS_AtomicLoad (&ctx->command_enqueue);
+    }
+
+    /* Write the command and publish the cell */
+    cell->type = type;
+    cell->value = value;
+    DS_AtomicStore (&cell->seq, pos + 1);
+    return 1;
+}
+
+/**
+ * Requests a change of the robot state. While the event loop runs (in
+ * another thread), the change is queued and the event loop applies it
+ * before it builds the next packets, so that a packet never mixes values
+ * from before and after a change. Otherwise the change is applied right away.
+ */
+static void submit_command (const CommandType type, const int value)
+{
+    ClientContext* ctx = get_context();
+
+    /* Wait for the event loop to make room (it is woken up to do so) */
+    while (Protocols_QueuesCommands()) {
+        if (enqueue_command (ctx, type, value)) {
+            DS_SocketWakeUp();
+            return;
+        }
+
+        DS_SocketWakeUp();
+        DS_Sleep (0);
+    }
+
+    apply_command (type, value);
+}
+
+/**
+ * Applies the robot state changes queued by the application, this is
+ * called by the event loop before it sends the packets (and once the event
+ * loop stopped, with the commands that it did not apply)
+ */
+void Client_ApplyCommands (void)
+{
+    ClientContext* ctx = get_context();
+
+    for (;;) {
+        size_t pos = ctx->command_dequeue;
+        CommandCell* cell = &ctx->commands [pos & (COMMAND_QUEUE_SIZE - 1)];
+
+        /* The queue is empty */
+        if (DS_AtomicLoad (&cell->seq) != pos + 1)
+            return;
+
+        /* Read the command and give the cell back to the producers */
+        CommandType type = cell->type;
+        int value = cell->value;
+        ctx->command_dequeue = pos + 1;
+        DS_AtomicStore (&cell->seq, pos + COMMAND_QUEUE_SIZE);
+
+        apply_command (type, value);
+    }
+}
+
+/**
+ * Re-applies the addresses selected by the given \a flags, unless a
+ * configuration transaction is open (the changes are applied once it is
+ * committed)
+ */
+static void reconfigure (const int flags)
+{
+    ClientContext* ctx = get_context();
+
+    if (!ctx->transaction)
+        CFG_ReconfigureAddresses (flags);
+}
+
+/**
+ * Replaces the \a custom address with the given \a address and re-applies
+ * the addresses selected by \a flags if it changed
+ *
+ * \returns \c 1 if the address changed, \c 0 if not
+ */
+static int set_custom_address (DS_String* custom, const char* address,
+                               const int flags)
+{
+    DS_String str = DS_StrNew (address);
+
+    if (DS_StrCompare (custom, &str) != 0) {
+        DS_StrRmBuf (custom);
+        *custom = str;
+        reconfigure (flags);
+        return 1;
+    }
+
+    DS_StrRmBuf (&str);
+    return 0;
 }
 
 /**
  * Returns the user-set FMS address.
  * This value may be empty, if that's the case, then the Driver Station will
  * use the addresses specified by the currently loaded protocol.
+ *
+ * \note The returned string must be freed with \c DS_FREE()
  */
 char* DS_GetCustomFMSAddress (void)
 {
-    return DS_StrToChar (&custom_fms_address);
+    ClientContext* ctx = get_context();
+
+    return DS_StrToChar (&ctx->custom_fms_address);
 }
 
 /**
  * Returns the user-set radio address.
  * This value may be empty, if that's the case, then the Driver Station will
  * use the addresses specified by the currently loaded protocol.
+ *
+ * \note The returned string must be freed with \c DS_FREE()
  */
 char* DS_GetCustomRadioAddress (void)
 {
-    return DS_StrToChar (&custom_radio_address);
+    ClientContext* ctx = get_context();
+
+    return DS_StrToChar (&ctx->custom_radio_address);
 }
 
 /**
  * Returns the user-set robot address
  * This value may be empty, if that's the case, then the Driver Station will
  * use the addresses specified by the currently loaded protocol.
+ *
+ * \note The returned string must be freed with \c DS_FREE()
  */
 char* DS_GetCustomRobotAddress (void)
 {
-    return DS_StrToChar (&custom_robot_address);
+    ClientContext* ctx = get_context();
+
+    return DS_StrToChar (&ctx->custom_robot_address);
 }
 
 /**
  * Returns the protocol-set FMS address, this address may change when the team
  * number is changed, if your application relies on this value, consider
  * updating in reguraly or using the events system of the LibDS.
+ *
+ * \note The returned string must be freed with \c DS_FREE()
  */
 char* DS_GetDefaultFMSAddress (void)
 {
+    ClientContext* ctx = get_context();
+
     if (DS_CurrentProtocol()) {
         DS_String address = DS_CurrentProtocol()->fms_address();
-        return DS_StrToChar (&address);
+        char* cstr = DS_StrToChar (&address);
+        DS_StrRmBuf (&address);
+        return cstr;
     }
 
-    else
-        return DS_FallBackAddress;
+    return DS_StrToChar (&ctx->fallback_address);
 }
 
 /**
  * Returns the protocol-set radio address, this address may change when the
  * team number is changed, if your application relies on this value, consider
  * updating in reguraly or using the events system of the LibDS.
+ *
+ * \note The returned string must be freed with \c DS_FREE()
  */
 char* DS_GetDefaultRadioAddress (void)
 {
+    ClientContext* ctx = get_context();
+
     if (DS_CurrentProtocol()) {
         DS_String address = DS_CurrentProtocol()->radio_address();
-        return DS_StrToChar (&address);
+        char* cstr = DS_StrToChar (&address);
+        DS_StrRmBuf (&address);
+        return cstr;
     }
 
-    else
-        return DS_FallBackAddress;
+    return DS_StrToChar (&ctx->fallback_address);
 }
 
 /**
  * Returns the protocol-set robot address, this address may change when the
  * team number is changed, if your application relies on this value, consider
  * updating in reguraly or using the events system of the LibDS.
+ *
+ * \note The returned string must be freed with \c DS_FREE()
  */
 char* DS_GetDefaultRobotAddress (void)
 {
+    ClientContext* ctx = get_context();
+
     if (DS_CurrentProtocol()) {
         DS_String address = DS_CurrentProtocol()->robot_address();
-        return DS_StrToChar (&address);
+        char* cstr = DS_StrToChar (&address);
+        DS_StrRmBuf (&address);
+        return cstr;
     }
 
-    else
-        return DS_FallBackAddress;
+    return DS_StrToChar (&ctx->fallback_address);
 }
 
 /**
@@ -144,10 +463,14 @@ char* DS_GetDefaultRobotAddress (void)
  * If the user-set address is not empty, then this function will return the
  * user-set address. Otherwise, this function will return the address
  * specified  by the currently loaded protocol.
+ *
+ * \note The returned string must be freed with \c DS_FREE()
  */
 char* DS_GetAppliedFMSAddress (void)
 {
-    if (DS_StrEmpty (&custom_fms_address))
+    ClientContext* ctx = get_context();
+
+    if (DS_StrEmpty (&ctx->custom_fms_address))
         return DS_GetDefaultFMSAddress();
     else
         return DS_GetCustomFMSAddress();
@@ -158,10 +481,14 @@ char* DS_GetAppliedFMSAddress (void)
  * If the user-set address is not empty, then this function will return the
  * user-set address. Otherwise, this function will return the address
  * specified  by the currently loaded protocol.
+ *
+ * \note The returned string must be freed with \c DS_FREE()
  */
 char* DS_GetAppliedRadioAddress (void)
 {
-    if (DS_StrEmpty (&custom_radio_address))
+    ClientContext* ctx = get_context();
+
+    if (DS_StrEmpty (&ctx->custom_radio_address))
         return DS_GetDefaultRadioAddress();
     else
         return DS_GetCustomRadioAddress();
@@ -172,51 +499,130 @@ char* DS_GetAppliedRadioAddress (void)
  * If the user-set address is not empty, then this function will return the
  * user-set address. Otherwise, this function will return the address
  * specified  by the currently loaded protocol.
+ *
+ * \note The returned string must be freed with \c DS_FREE()
  */
 char* DS_GetAppliedRobotAddress (void)
 {
-    if (DS_StrEmpty (&custom_robot_address))
+    ClientContext* ctx = get_context();
+
+    if (DS_StrEmpty (&ctx->custom_robot_address))
         return DS_GetDefaultRobotAddress();
     else
         return DS_GetCustomRobotAddress();
 }
 
 /**
- * Returns the current status of the robot/DS.
- * This string is meant to be used directly by the clien application,
- * the DS has no real use for it.
+ * Returns the last known address of the robot (set by the application with
+ * \c DS_SetKnownRobotAddress()), or an empty string if it is not set or if
+ * the robot did not reply through it
  *
- * Possible return values are:
- *    - No Robot Communications
- *    - No Robot Code
- *    - Emergency Stopped
- *    - Teleoperated Enabled/Disabled
- *    - Autonomous Enabled/Disabled
- *    - Test Enabled/Disabled
+ * \note The returned string must be freed with \c DS_FREE()
  */
-char* DS_GetStatusString (void)
+char* DS_GetKnownRobotAddress (void)
+{
+    ClientContext* ctx = get_context();
+
+    if (ctx->known_robot_valid)
+        return DS_StrToChar (&ctx->known_robot_address);
+
+    DS_String empty = DS_StrNewLen (0);
+    char* cstr = DS_StrToChar (&empty);
+    DS_StrRmBuf (&empty);
+    return cstr;
+}
+
+/**
+ * Returns the numeric IP address through which the DS communicates with the
+ * robot, or an empty string if there are no robot communications. The
+ * application can store it and restore it with \c DS_SetKnownRobotAddress()
+ * on the next launch.
+ *
+ * \note The returned string must be freed with \c DS_FREE()
+ */
+char* DS_GetRobotEndpoint (void)
+{
+    DS_String host = DS_StrNewLen (0);
+
+    if (DS_CurrentProtocol() && CFG_GetRobotCommunications()) {
+        DS_StrRmBuf (&host);
+        host = DS_SocketRemoteHost (&DS_CurrentProtocol()->robot_socket);
+    }
+
+    char* cstr = DS_StrToChar (&host);
+    DS_StrRmBuf (&host);
+    return cstr;
+}
+
+/**
+ * Returns the current status of the robot/DS, applications can compare it
+ * with the last status (and map it to their own strings) instead of
+ * comparing status strings
+ */
+DS_Status DS_GetStatus (void)
 {
     if (!CFG_GetRobotCommunications())
-        return "No Robot Communications";
+        return DS_STATUS_NO_COMMUNICATIONS;
 
     else if (!CFG_GetRobotCode())
-        return "No Robot Code";
+        return DS_STATUS_NO_CODE;
 
     int enabled = CFG_GetRobotEnabled();
 
     switch (CFG_GetControlMode()) {
     case DS_CONTROL_TELEOPERATED:
-        return enabled ? "Teleoperated Enabled" : "Teleoperated Disabled";
+        return enabled ? DS_STATUS_TELEOPERATED_ENABLED : DS_STATUS_TELEOPERATED_DISABLED;
         break;
     case DS_CONTROL_AUTONOMOUS:
-        return enabled ? "Autonomous Enabled" : "Autonomous Disabled";
+        return enabled ? DS_STATUS_AUTONOMOUS_ENABLED : DS_STATUS_AUTONOMOUS_DISABLED;
         break;
     case DS_CONTROL_TEST:
-        return enabled ? "Test Enabled" : "Test Disabled";
+        return enabled ? DS_STATUS_TEST_ENABLED : DS_STATUS_TEST_DISABLED;
         break;
     }
 
-    return "Status Error";
+    return DS_STATUS_ERROR;
+}
+
+/**
+ * Returns the current status of the robot/DS.
+ * This string is meant to be used directly by the clien application,
+ * the DS has no real use for it.
+ *
+ * Possible return values are:
+ *    - No Robot Communications
+ *    - No Robot Code
+ *    - Teleoperated Enabled/Disabled
+ *    - Autonomous Enabled/Disabled
+ *    - Test Enabled/Disabled
+ */
+char* DS_GetStatusString (void)
+{
+    return (char*) DS_GetStatusName (DS_GetStatus());
+}
+
+/**
+ * Returns the name of the given \a status, the names are constant strings
+ * (which are never freed), so the same pointer is returned for a status
+ */
+const char* DS_GetStatusName (const DS_Status status)
+{
+    static const char* const names [DS_STATUS_COUNT] = {
+        "No Robot Communications",
+        "No Robot Code",
+        "Teleoperated Enabled",
+        "Teleoperated Disabled",
+        "Autonomous Enabled",
+        "Autonomous Disabled",
+        "Test Enabled",
+        "Test Disabled",
+        "Status Error",
+    };
+
+    if (status < 0 || status >= DS_STATUS_COUNT)
+        return names [DS_STATUS_ERROR];
+
+    return names [status];
 }
 
 /**
@@ -324,6 +730,28 @@ int DS_GetFMSCommunications (void)
     return CFG_GetFMSCommunications();
 }
 
+/**
+ * Copies the match state reported by the FMS (match type and number, replay
+ * number and remaining time) into the given \a match structure. The state
+ * is reset when the FMS is disconnected.
+ */
+void DS_GetFMSMatch (DS_FMSMatch* match)
+{
+    assert (match);
+    CFG_GetFMSMatch (match);
+}
+
+/**
+ * Returns the remaining time (in seconds) of the current match period, as
+ * reported by the FMS, or \c -1 if it is unknown
+ */
+int DS_GetMatchTimeRemaining (void)
+{
+    DS_FMSMatch match;
+    CFG_GetFMSMatch (&match);
+    return match.time_remaining;
+}
+
 /**
  * Returns \c 1 if the LibDS has communications with the radio
  */
@@ -332,6 +760,16 @@ int DS_GetRadioCommunications (void)
     return CFG_GetRadioCommunications();
 }
 
+/**
+ * Returns \c 1 if the radio is reachable while the robot is not, which
+ * means that the problem is between the radio and the robot controller
+ * (and not between the DS and the radio)
+ */
+int DS_GetRadioOnlyCommunications (void)
+{
+    return CFG_GetRadioCommunications() && !CFG_GetRobotCommunications();
+}
+
 /**
  * Returns \c 1 if the LibDS has communications with the robot
  */
@@ -374,9 +812,8 @@ void DS_RebootRobot (void)
 {
     if (DS_CurrentProtocol()) {
         DS_CurrentProtocol()->reboot_robot();
-        DS_String str = DS_StrNew ("Rebooting robot...");
-        CFG_AddNotification (&str);
-        DS_StrRmBuf (&str);
+        Lifecycle_Request (DS_LIFECYCLE_REBOOT);
+        CFG_AddStaticNotification (CFG_NOTIFY_REBOOTING_ROBOT);
     }
 }
 
@@ -387,10 +824,8 @@ void DS_RestartRobotCode (void)
 {
     if (DS_CurrentProtocol()) {
         DS_CurrentProtocol()->restart_robot_code();
-
-        DS_String str = DS_StrNew ("Restarting robot code...");
-        CFG_AddNotification (&str);
-        DS_StrRmBuf (&str);
+        Lifecycle_Request (DS_LIFECYCLE_RESTART);
+        CFG_AddStaticNotification (CFG_NOTIFY_RESTARTING_CODE);
     }
 }
 
@@ -400,23 +835,32 @@ void DS_RestartRobotCode (void)
  */
 void DS_SetTeamNumber (const int team)
 {
-    CFG_SetTeamNumber (team);
+    if (team != CFG_GetTeamNumber()) {
+        CFG_SetTeamNumber (team);
+        reconfigure (RECONFIGURE_ALL);
+    }
 }
 
 /**
- * Changes the \a enabled state of the robot
+ * Changes the \a enabled state of the robot, a change is sent to the robot
+ * right away (see \c DS_SendStateChange())
+ *
+ * The robot state changes are applied by the event loop between two
+ * packets (see \c submit_command()), the getters return the new state and
+ * the events are registered once it is applied.
  */
 void DS_SetRobotEnabled (const int enabled)
 {
-    CFG_SetRobotEnabled (enabled);
+    submit_command (COMMAND_ENABLED, enabled);
 }
 
 /**
- * Changes the emergency stop state of the robot
+ * Changes the emergency stop state of the robot, a change is sent to the
+ * robot right away (see \c DS_SendStateChange())
  */
 void DS_SetEmergencyStopped (const int stop)
 {
-    CFG_SetEmergencyStopped (stop);
+    submit_command (COMMAND_ESTOP, stop);
 }
 
 /**
@@ -424,7 +868,7 @@ void DS_SetEmergencyStopped (const int stop)
  */
 void DS_SetAlliance (const DS_Alliance alliance)
 {
-    CFG_SetAlliance (alliance);
+    submit_command (COMMAND_ALLIANCE, (int) alliance);
 }
 
 /**
@@ -432,7 +876,7 @@ void DS_SetAlliance (const DS_Alliance alliance)
  */
 void DS_SetPosition (const DS_Position position)
 {
-    CFG_SetPosition (position);
+    submit_command (COMMAND_POSITION, (int) position);
 }
 
 /**
@@ -440,7 +884,7 @@ void DS_SetPosition (const DS_Position position)
  */
 void DS_SetControlMode (const DS_ControlMode mode)
 {
-    CFG_SetControlMode (mode);
+    submit_command (COMMAND_MODE, (int) mode);
 }
 
 /**
@@ -448,19 +892,10 @@ void DS_SetControlMode (const DS_ControlMode mode)
  */
 void DS_SetCustomFMSAddress (const char* address)
 {
-    assert (address);
+    ClientContext* ctx = get_context();
 
-    if (strlen (address) > 0) {
-        DS_StrRmBuf (&custom_fms_address);
-        custom_fms_address = DS_StrNew (address);
-        CFG_ReconfigureAddresses (RECONFIGURE_FMS);
-    }
-
-    else {
-        DS_StrRmBuf (&custom_fms_address);
-        custom_fms_address = DS_StrNewLen (0);
-        CFG_ReconfigureAddresses (RECONFIGURE_FMS);
-    }
+    assert (address);
+    set_custom_address (&ctx->custom_fms_address, address, RECONFIGURE_FMS);
 }
 
 /**
@@ -468,19 +903,10 @@ void DS_SetCustomFMSAddress (const char* address)
  */
 void DS_SetCustomRadioAddress (const char* address)
 {
-    assert (address);
-
-    if (strlen (address) > 0) {
-        DS_StrRmBuf (&custom_radio_address);
-        custom_radio_address = DS_StrNew (address);
-        CFG_ReconfigureAddresses (RECONFIGURE_RADIO);
-    }
+    ClientContext* ctx = get_context();
 
-    else {
-        DS_StrRmBuf (&custom_radio_address);
-        custom_radio_address = DS_StrNewLen (0);
-        CFG_ReconfigureAddresses (RECONFIGURE_RADIO);
-    }
+    assert (address);
+    set_custom_address (&ctx->custom_radio_address, address, RECONFIGURE_RADIO);
 }
 
 /**
@@ -488,30 +914,168 @@ void DS_SetCustomRadioAddress (const char* address)
  */
 void DS_SetCustomRobotAddress (const char* address)
 {
+    ClientContext* ctx = get_context();
+
     assert (address);
+    set_custom_address (&ctx->custom_robot_address, address, RECONFIGURE_ROBOT);
+}
 
-    if (strlen (address) > 0) {
-        DS_StrRmBuf (&custom_robot_address);
-        custom_robot_address = DS_StrNew (address);
-        CFG_ReconfigureAddresses (RECONFIGURE_ROBOT);
-    }
+/**
+ * Changes the last known \a address of the robot (e.g. the address returned
+ * by \c DS_GetRobotEndpoint() on a previous launch), which is probed along
+ * with the addresses of the protocol, so that the robot replies before its
+ * name is resolved. The address is ignored once the robot replies through
+ * another address, or if it does not reply for about two minutes.
+ *
+ * Set \a address to an empty string to clear it.
+ */
+void DS_SetKnownRobotAddress (const char* address)
+{
+    ClientContext* ctx = get_context();
 
-    else {
-        DS_StrRmBuf (&custom_robot_address);
-        custom_robot_address = DS_StrNewLen (0);
-        CFG_ReconfigureAddresses (RECONFIGURE_ROBOT);
+    assert (address);
+
+    /* Probe the address again if it was found to be invalid */
+    int valid = (strlen (address) > 0);
+    int revalidated = (valid && !ctx->known_robot_valid);
+    ctx->known_robot_valid = valid;
+    ctx->known_robot_failures = 0;
+
+    if (!set_custom_address (&ctx->known_robot_address, address,
+                             RECONFIGURE_ROBOT) && revalidated)
+        reconfigure (RECONFIGURE_ROBOT);
+}
+
+/**
+ * Opens a configuration transaction. The team number and the custom
+ * addresses can then be changed several times (e.g. while the user types
+ * them) without re-applying the addresses of the sockets, which are only
+ * updated by \c DS_CommitConfiguration(), and only if they really changed.
+ *
+ * Transactions are not nested, this function does nothing if a transaction
+ * is already open.
+ */
+void DS_BeginConfiguration (void)
+{
+    ClientContext* ctx = get_context();
+
+    if (!ctx->transaction) {
+        ctx->transaction = 1;
+        ctx->saved_team = CFG_GetTeamNumber();
+        ctx->saved_fms_address = DS_StrDup (&ctx->custom_fms_address);
+        ctx->saved_radio_address = DS_StrDup (&ctx->custom_radio_address);
+        ctx->saved_robot_address = DS_StrDup (&ctx->custom_robot_address);
+        ctx->saved_known_address = DS_StrDup (&ctx->known_robot_address);
     }
 }
 
 /**
- * Sends the given \a message to the NetConsole of the robot
+ * Closes the configuration transaction and re-applies the addresses that
+ * changed since it was opened. A new team number re-applies all of them.
+ */
+void DS_CommitConfiguration (void)
+{
+    ClientContext* ctx = get_context();
+    int flags = 0;
+
+    if (!ctx->transaction)
+        return;
+
+    /* Find the addresses that changed */
+    if (ctx->saved_team != CFG_GetTeamNumber())
+        flags = RECONFIGURE_ALL;
+    if (DS_StrCompare (&ctx->saved_fms_address, &ctx->custom_fms_address))
+        flags |= RECONFIGURE_FMS;
+    if (DS_StrCompare (&ctx->saved_radio_address, &ctx->custom_radio_address))
+        flags |= RECONFIGURE_RADIO;
+    if (DS_StrCompare (&ctx->saved_robot_address, &ctx->custom_robot_address))
+        flags |= RECONFIGURE_ROBOT;
+    if (DS_StrCompare (&ctx->saved_known_address, &ctx->known_robot_address))
+        flags |= RECONFIGURE_ROBOT;
+
+    /* Close the transaction */
+    ctx->transaction = 0;
+    DS_StrRmBuf (&ctx->saved_fms_address);
+    DS_StrRmBuf (&ctx->saved_radio_address);
+    DS_StrRmBuf (&ctx->saved_robot_address);
+    DS_StrRmBuf (&ctx->saved_known_address);
+
+    /* Apply the changes */
+    if (flags)
+        CFG_ReconfigureAddresses (flags);
+}
+
+/**
+ * Closes the configuration transaction and restores the team number and
+ * the custom addresses that were set when it was opened (the addresses of
+ * the sockets are not modified)
+ */
+void DS_CancelConfiguration (void)
+{
+    ClientContext* ctx = get_context();
+
+    if (!ctx->transaction)
+        return;
+
+    /* Restore the saved values */
+    CFG_SetTeamNumber (ctx->saved_team);
+    DS_StrRmBuf (&ctx->custom_fms_address);
+    DS_StrRmBuf (&ctx->custom_radio_address);
+    DS_StrRmBuf (&ctx->custom_robot_address);
+    DS_StrRmBuf (&ctx->known_robot_address);
+    ctx->custom_fms_address = ctx->saved_fms_address;
+    ctx->custom_radio_address = ctx->saved_radio_address;
+    ctx->custom_robot_address = ctx->saved_robot_address;
+    ctx->known_robot_address = ctx->saved_known_address;
+    ctx->known_robot_valid = !DS_StrEmpty (&ctx->known_robot_address);
+
+    /* Close the transaction (the saved strings are now owned by the DS) */
+    ctx->transaction = 0;
+}
+
+/**
+ * Returns \c 1 if a configuration transaction is open, \c 0 if not
+ */
+int DS_ConfigurationPending (void)
+{
+    ClientContext* ctx = get_context();
+
+    return ctx->transaction;
+}
+
+/**
+ * Changes the game-specific \a message of the current match (e.g. the
+ * colors assigned to each alliance), which is sent to the robot by the
+ * protocols that support it
+ */
+void DS_SetGameSpecificMessage (const char* message)
+{
+    assert (message);
+    CFG_SetGameData (message);
+}
+
+/**
+ * Changes the \a event name, the match \a type and the match and \a replay
+ * numbers of the current match, which are sent to the robot by the protocols
+ * that support them
+ */
+void DS_SetMatchInfo (const char* event, const DS_MatchType type,
+                      const int number, const int replay)
+{
+    assert (event);
+    CFG_SetMatchInfo (event, type, number, replay);
+}
+
+/**
+ * Sends the given \a message to the NetConsole of the robot. The message is
+ * queued and sent by the protocol event loop (together with the other
+ * messages queued at the same time), so this function does not block.
+ * Messages are discarded if no protocol is loaded or if the queue is full.
  */
 void DS_SendNetConsoleMessage (const char* message)
 {
     assert (message);
 
-    if (DS_CurrentProtocol()) {
-        DS_String data = DS_StrNew (message);
-        DS_SocketSend (&DS_CurrentProtocol()->netconsole_socket, &data);
-    }
+    if (DS_CurrentProtocol() && NetConsole_QueueMessage (message))
+        DS_SocketWakeUp();
 }
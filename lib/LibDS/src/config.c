@@ -24,31 +24,180 @@
 #include "DS_Utils.h"
 #include "DS_Client.h"
 #include "DS_Events.h"
+#include "DS_NetConsole.h"
 #include "DS_Config.h"
 #include "DS_Protocol.h"
+#include "DS_Brownout.h"
+#include "DS_History.h"
+#include "DS_Lifecycle.h"
+#include "DS_Match.h"
+#include "DS_Dashboard.h"
+#include "DS_Thread.h"
+
+#include "DS_Atomic.h"
+#include "DS_Context.h"
 
 #include <math.h>
 #include <string.h>
 #include <assert.h>
 
 /*
- * These variables hold the state(s) of the LibDS and its modules
- */
-static int team = 0;
-static int cpu_usage = -1;
-static int ram_usage = -1;
-static int disk_usage = -1;
-static int robot_code = -1;
-static int robot_enabled = -1;
-static int can_utilization = -1;
-static float robot_voltage = -1;
-static int emergency_stopped = -1;
-static int fms_communications = -1;
-static int radio_communications = -1;
-static int robot_communications = -1;
-static DS_Position robot_position = DS_POSITION_1;
-static DS_Alliance robot_alliance = DS_ALLIANCE_RED;
-static DS_ControlMode control_mode = DS_CONTROL_TELEOPERATED;
+ * Holds the state(s) of the LibDS and its modules. A value of -1 means that
+ * the value is unknown (e.g. before the first robot packet).
+ */
+typedef struct _cfg_raw_state {
+    int team;
+    int cpu_usage;
+    int ram_usage;
+    int disk_usage;
+    int robot_code;
+    int robot_enabled;
+    int can_utilization;
+    float robot_voltage;
+    int emergency_stopped;
+    int fms_communications;
+    int radio_communications;
+    int robot_communications;
+    int robot_position;
+    int robot_alliance;
+    int control_mode;
+} CFG_RawState;
+
+static const CFG_RawState initial_state = {
+    0, -1, -1, -1, -1, -1, -1, -1.0f, -1, -1, -1, -1,
+    DS_POSITION_1, DS_ALLIANCE_RED, DS_CONTROL_TELEOPERATED
+};
+
+/*
+ * The state is protected by a sequence lock: writers are serialized by the
+ * mutex and make the version odd while they modify the state, readers copy
+ * the state without locking and retry if the version changed meanwhile.
+ */
+typedef struct {
+    CFG_RawState state;
+    volatile size_t version;
+    DS_Mutex write_mutex;
+
+    /* Match information (its strings are copied with the mutex locked) */
+    CFG_MatchInfo match;
+
+    /* Match state reported by the FMS (copied with the mutex locked) */
+    DS_FMSMatch fms_match;
+
+    /* Set while the robot state is reset (the values are not samples) */
+    int resetting;
+} ConfigContext;
+
+/*
+ * Match state used while there is no FMS
+ */
+static const DS_FMSMatch no_fms_match = { DS_MATCH_NONE, 0, 0, -1 };
+
+/**
+ * Initializes the config state of a new DS context
+ */
+static void init_context (void* data)
+{
+    ConfigContext* ctx = (ConfigContext*) data;
+
+    ctx->state = initial_state;
+    ctx->fms_match = no_fms_match;
+    DS_MutexInit (&ctx->write_mutex);
+}
+
+/**
+ * Releases the config state of a DS context
+ */
+static void destroy_context (void* data)
+{
+    ConfigContext* ctx = (ConfigContext*) data;
+    DS_MutexDestroy (&ctx->write_mutex);
+}
+
+/**
+ * Returns the config state of the current DS context
+ */
+static ConfigContext* get_context (void)
+{
+    return (ConfigContext*) DS_ContextData (DS_CONTEXT_CONFIG,
+                                            sizeof (ConfigContext),
+                                            init_context, destroy_context);
+}
+
+/**
+ * Locks the writer mutex and marks the state as being modified
+ */
+static void write_begin (void)
+{
+    ConfigContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->write_mutex);
+    DS_AtomicFetchAdd (&ctx->version, 1);
+}
+
+/**
+ * Publishes the modified state and unlocks the writer mutex
+ */
+static void write_end (void)
+{
+    ConfigContext* ctx = get_context();
+
+    DS_AtomicFetchAdd (&ctx->version, 1);
+    DS_MutexUnlock (&ctx->write_mutex);
+}
+
+/**
+ * Changes the given integer \a field to \a value.
+ * Returns \c 1 if the value was changed, \c 0 if it was already set
+ */
+static int update_int (int* field, const int value)
+{
+    int changed = 0;
+
+    write_begin();
+    if (*field != value) {
+        *field = value;
+        changed = 1;
+    }
+    write_end();
+
+    return changed;
+}
+
+/**
+ * Changes the given float \a field to \a value.
+ * Returns \c 1 if the value was changed, \c 0 if it was already set
+ */
+static int update_float (float* field, const float value)
+{
+    int changed = 0;
+
+    write_begin();
+    if (*field != value) {
+        *field = value;
+        changed = 1;
+    }
+    write_end();
+
+    return changed;
+}
+
+/**
+ * Copies the given \a value into the string \a field of the given \a size,
+ * the value is truncated if it does not fit.
+ * Returns \c 1 if the string was changed, \c 0 if it was already set
+ */
+static int update_string (char* field, const size_t size, const char* value)
+{
+    size_t len = DS_Min (strlen (value), size - 1);
+
+    if (strlen (field) == len && memcmp (field, value, len) == 0)
+        return 0;
+
+    memcpy (field, value, len);
+    field [len] = '\0';
+    return 1;
+}
 
 /**
  * Ensures that the given \a input number is either \c 0 or \c 1
@@ -78,61 +227,169 @@ static int respect_range (const int input, const int min, const int max)
 }
 
 /**
- * Creates and fills a robot event with the given \a type header
+ * Creates and fills a robot event with the given \a type header (only if
+ * the application polls or subscribed to events of that type)
  */
 static void create_robot_event (const DS_EventType type)
 {
     DS_Event event;
+    CFG_State current;
+
+    if (!DS_EventWanted (type))
+        return;
+
+    CFG_GetState (&current);
 
     event.robot.type = type;
-    event.robot.code = CFG_GetRobotCode();
-    event.robot.mode = CFG_GetControlMode();
-    event.robot.enabled = CFG_GetRobotEnabled();
-    event.robot.voltage = CFG_GetRobotVoltage();
-    event.robot.can_util = CFG_GetCANUtilization();
-    event.robot.cpu_usage = CFG_GetRobotCPUUsage();
-    event.robot.ram_usage = CFG_GetRobotRAMUsage();
-    event.robot.disk_usage = CFG_GetRobotDiskUsage();
-    event.robot.estopped = CFG_GetEmergencyStopped();
-    event.robot.connected = CFG_GetRobotCommunications();
+    event.robot.code = current.robot_code;
+    event.robot.mode = current.control_mode;
+    event.robot.enabled = current.robot_enabled;
+    event.robot.voltage = current.robot_voltage;
+    event.robot.can_util = current.can_utilization;
+    event.robot.cpu_usage = current.cpu_usage;
+    event.robot.ram_usage = current.ram_usage;
+    event.robot.disk_usage = current.disk_usage;
+    event.robot.estopped = current.emergency_stopped;
+    event.robot.connected = current.robot_communications;
 
     DS_AddEvent (&event);
 }
 
 /**
- * Notifies the user about something through the NetConsole
+ * Adds a \a percent value reported by the robot to the history of the given
+ * \a metric and to the match statistics (the values set when the robot state
+ * is reset are skipped)
+ */
+static void add_sample (const DS_HistoryMetric metric, const int percent)
+{
+    if (!get_context()->resetting) {
+        History_AddSample (metric, percent);
+        Match_AddSample (metric, percent);
+    }
+}
+
+/**
+ * Lets the match statistics start or end the match after a change of the
+ * FMS, enabled or control mode state (unless the robot state is reset)
+ */
+static void update_match (void)
+{
+    if (!get_context()->resetting)
+        Match_Update();
+}
+
+/**
+ * Notifies the user about something through the NetConsole. The message is
+ * stored as plain text with the LibDS source, so the application decides
+ * how to display it.
  */
 void CFG_AddNotification (const DS_String* msg)
 {
-    /* Check arguments */
-    assert (msg);
+    CFG_AddNetConsoleEntry (DS_NETCONSOLE_SOURCE_LIBDS,
+                            DS_NETCONSOLE_SEVERITY_INFO, msg);
+}
+
+/**
+ * Shows the given constant \a notification in the NetConsole, the messages
+ * are constant, so no string is formatted nor allocated
+ */
+void CFG_AddStaticNotification (const CFG_Notification notification)
+{
+#define STATIC_NOTIFICATION(severity, text) \
+    { DS_NETCONSOLE_SEVERITY_##severity, text, sizeof (text) - 1 }
+    static const struct {
+        DS_NetConsoleSeverity severity;
+        const char* text;
+        size_t len;
+    } messages [CFG_NOTIFICATION_COUNT] = {
+        STATIC_NOTIFICATION (INFO, "Rebooting robot..."),
+        STATIC_NOTIFICATION (INFO, "Restarting robot code..."),
+        STATIC_NOTIFICATION (WARNING, "Cannot change the scheduling of the protocol thread"),
+        STATIC_NOTIFICATION (ERROR, "Cannot write the capture file"),
+        STATIC_NOTIFICATION (INFO, "Capture replay finished"),
+        STATIC_NOTIFICATION (INFO, "Joystick macro playback finished"),
+        STATIC_NOTIFICATION (INFO, "Network usage is back within the bandwidth budget"),
+    };
+#undef STATIC_NOTIFICATION
 
-    /* Create and display notification string */
-    char* cstr = DS_StrToChar (msg);
-    DS_String str = DS_StrFormat ("<font color=#888>** LibDS: %s</font>", cstr);
-    CFG_AddNetConsoleMessage (&str);
+    /* Check arguments */
+    assert (notification >= 0 && notification < CFG_NOTIFICATION_COUNT);
 
-    /* Delete the string buffer */
-    DS_StrRmBuf (&str);
-    DS_FREE (cstr);
+    DS_String str = {(char*) messages [notification].text,
+                     messages [notification].len, 0};
+    CFG_AddNetConsoleEntry (DS_NETCONSOLE_SOURCE_LIBDS,
+                            messages [notification].severity, &str);
 }
 
 /**
- * Notifies the application of a new NetConsole message through the
- * DS events system
+ * Stores the lines of a new NetConsole message printed by the robot and
+ * notifies the application through the DS events system
  *
  * \a msg the message to display
  */
 void CFG_AddNetConsoleMessage (const DS_String* msg)
+{
+    CFG_AddNetConsoleEntry (DS_NETCONSOLE_SOURCE_ROBOT,
+                            DS_NETCONSOLE_SEVERITY_INFO, msg);
+}
+
+/**
+ * Stores the lines of the given \a msg with the given \a source and
+ * \a severity (see \c DS_NetConsoleAppendEntry())
+ */
+void CFG_AddNetConsoleEntry (const DS_NetConsoleSource source,
+                             const DS_NetConsoleSeverity severity,
+                             const DS_String* msg)
 {
     /* Check arguments */
     assert (msg);
 
-    /* Register new NetConsole event */
-    DS_Event event;
-    event.netconsole.type = DS_NETCONSOLE_NEW_MESSAGE;
-    event.netconsole.message = DS_StrToChar (msg);
-    DS_AddEvent (&event);
+    /* Store the message lines and notify the application */
+    if (msg->buf && msg->len > 0)
+        DS_NetConsoleAppendEntry (source, severity, msg->buf, msg->len);
+}
+
+/**
+ * Tells the robot socket to also look up (and probe) the fallback addresses
+ * of the protocol (e.g. the static IP and USB address of the robot). If the
+ * user has set a custom robot address, the protocol address is also used as
+ * a fallback. The last known address of the robot (if any) is probed along
+ * with them, so that the robot replies before its name is resolved.
+ */
+static void reconfigure_robot_fallbacks (void)
+{
+    int i;
+    int count = 0;
+    const int max = DS_SOCKET_MAX_CANDIDATES - 1;
+    DS_String addresses [DS_SOCKET_MAX_CANDIDATES - 1];
+    DS_Protocol* protocol = DS_CurrentProtocol();
+
+    /* The custom address is used first, then the protocol address */
+    char* custom = DS_GetCustomRobotAddress();
+    if (strlen (custom) > 0 && protocol->robot_address)
+        addresses [count++] = protocol->robot_address();
+
+    /* Then the address that the robot used the last time */
+    char* known = DS_GetKnownRobotAddress();
+    if (strlen (known) > 0 && count < max)
+        addresses [count++] = DS_StrNew (known);
+
+    /* Add the fallback addresses of the protocol */
+    if (protocol->robot_fallback_addresses)
+        count += protocol->robot_fallback_addresses (addresses + count,
+                                                     max - count);
+
+    /* Update the sockets */
+    DS_SocketSetFallbackAddresses (&protocol->robot_socket, addresses, count);
+    DS_SocketSetFallbackAddresses (&protocol->robot_stream_socket,
+                                   addresses, count);
+
+    /* Delete the strings */
+    for (i = 0; i < count; ++i)
+        DS_StrRmBuf (&addresses [i]);
+
+    DS_FREE (known);
+    DS_FREE (custom);
 }
 
 /**
@@ -160,17 +417,99 @@ void CFG_ReconfigureAddresses (const int flags)
     if (flags & RECONFIGURE_ROBOT) {
         char* address = DS_GetAppliedRobotAddress();
         DS_SocketChangeAddress (&DS_CurrentProtocol()->robot_socket, address);
+        DS_SocketChangeAddress (&DS_CurrentProtocol()->robot_stream_socket,
+                                address);
+        Dashboard_ChangeAddress (address);
         DS_FREE (address);
+        reconfigure_robot_fallbacks();
     }
 }
 
+/**
+ * Copies the current state of the LibDS into the given \a snapshot.
+ *
+ * All values are read from the same version of the state, so protocols
+ * should call this function once per packet instead of calling the
+ * individual getters.
+ */
+void CFG_GetState (CFG_State* snapshot)
+{
+    ConfigContext* ctx = get_context();
+    size_t seq;
+    CFG_RawState raw;
+
+    /* Check arguments */
+    assert (snapshot);
+
+    /* Copy the state until we get a version that was not being modified */
+    do {
+        while ((seq = DS_AtomicLoad (&ctx->version)) & 1)
+            ;
+
+        raw = ctx->state;
+        DS_AtomicAcquireFence();
+    } while (DS_AtomicLoad (&ctx->version) != seq);
+
+    /* Convert the raw values */
+    snapshot->team = DS_Max (raw.team, 0);
+    snapshot->robot_code = raw.robot_code == 1;
+    snapshot->robot_enabled = raw.robot_enabled == 1;
+    snapshot->cpu_usage = DS_Max (raw.cpu_usage, 0);
+    snapshot->ram_usage = DS_Max (raw.ram_usage, 0);
+    snapshot->disk_usage = DS_Max (raw.disk_usage, 0);
+    snapshot->can_utilization = DS_Max (raw.can_utilization, 0);
+    snapshot->robot_voltage = DS_Max (raw.robot_voltage, 0);
+    snapshot->emergency_stopped = raw.emergency_stopped == 1;
+    snapshot->fms_communications = raw.fms_communications == 1;
+    snapshot->radio_communications = raw.radio_communications == 1;
+    snapshot->robot_communications = raw.robot_communications == 1;
+    snapshot->position = (DS_Position) raw.robot_position;
+    snapshot->alliance = (DS_Alliance) raw.robot_alliance;
+    snapshot->control_mode = (DS_ControlMode) raw.control_mode;
+}
+
+/**
+ * Copies the information about the current match (set by the application)
+ * into the given \a info structure. The protocols can compare the version
+ * of the copy to find out if the information changed.
+ */
+void CFG_GetMatchInfo (CFG_MatchInfo* info)
+{
+    ConfigContext* ctx = get_context();
+
+    /* Check arguments */
+    assert (info);
+
+    DS_MutexLock (&ctx->write_mutex);
+    *info = ctx->match;
+    DS_MutexUnlock (&ctx->write_mutex);
+}
+
+/**
+ * Copies the match state reported by the FMS into the given \a match
+ * structure
+ */
+void CFG_GetFMSMatch (DS_FMSMatch* match)
+{
+    ConfigContext* ctx = get_context();
+
+    /* Check arguments */
+    assert (match);
+
+    DS_MutexLock (&ctx->write_mutex);
+    *match = ctx->fms_match;
+    DS_MutexUnlock (&ctx->write_mutex);
+}
+
 /**
  * Returns the current team number, which may be used by the protocols to
  * specifiy the default addresses and generate specialized packets
  */
 int CFG_GetTeamNumber (void)
 {
-    return DS_Max (team, 0);
+    ConfigContext* ctx = get_context();
+
+    return DS_Max (ctx->state.team, 0);
 }
 
 /**
@@ -178,7 +517,9 @@ int CFG_GetTeamNumber (void)
  */
 int CFG_GetRobotCode (void)
 {
-    return robot_code == 1;
+    ConfigContext* ctx = get_context();
+
+    return ctx->state.robot_code == 1;
 }
 
 /**
@@ -186,7 +527,9 @@ int CFG_GetRobotCode (void)
  */
 int CFG_GetRobotEnabled (void)
 {
-    return robot_enabled == 1;
+    ConfigContext* ctx = get_context();
+
+    return ctx->state.robot_enabled == 1;
 }
 
 /**
@@ -194,7 +537,9 @@ int CFG_GetRobotEnabled (void)
  */
 int CFG_GetRobotCPUUsage (void)
 {
-    return DS_Max (cpu_usage, 0);
+    ConfigContext* ctx = get_context();
+
+    return DS_Max (ctx->state.cpu_usage, 0);
 }
 
 /**
@@ -202,7 +547,9 @@ int CFG_GetRobotCPUUsage (void)
  */
 int CFG_GetRobotRAMUsage (void)
 {
-    return DS_Max (ram_usage, 0);
+    ConfigContext* ctx = get_context();
+
+    return DS_Max (ctx->state.ram_usage, 0);
 }
 
 /**
@@ -210,7 +557,9 @@ int CFG_GetRobotRAMUsage (void)
  */
 int CFG_GetCANUtilization (void)
 {
-    return DS_Max (can_utilization, 0);
+    ConfigContext* ctx = get_context();
+
+    return DS_Max (ctx->state.can_utilization, 0);
 }
 
 /**
@@ -218,7 +567,9 @@ int CFG_GetCANUtilization (void)
  */
 int CFG_GetRobotDiskUsage (void)
 {
-    return DS_Max (disk_usage, 0);
+    ConfigContext* ctx = get_context();
+
+    return DS_Max (ctx->state.disk_usage, 0);
 }
 
 /**
@@ -226,7 +577,9 @@ int CFG_GetRobotDiskUsage (void)
  */
 float CFG_GetRobotVoltage (void)
 {
-    return DS_Max (robot_voltage, 0);
+    ConfigContext* ctx = get_context();
+
+    return DS_Max (ctx->state.robot_voltage, 0);
 }
 
 /**
@@ -236,7 +589,9 @@ float CFG_GetRobotVoltage (void)
  */
 DS_Alliance CFG_GetAlliance (void)
 {
-    return robot_alliance;
+    ConfigContext* ctx = get_context();
+
+    return (DS_Alliance) ctx->state.robot_alliance;
 }
 
 /**
@@ -247,7 +602,9 @@ DS_Alliance CFG_GetAlliance (void)
  */
 DS_Position CFG_GetPosition (void)
 {
-    return robot_position;
+    ConfigContext* ctx = get_context();
+
+    return (DS_Position) ctx->state.robot_position;
 }
 
 /**
@@ -255,7 +612,9 @@ DS_Position CFG_GetPosition (void)
  */
 int CFG_GetEmergencyStopped (void)
 {
-    return emergency_stopped == 1;
+    ConfigContext* ctx = get_context();
+
+    return ctx->state.emergency_stopped == 1;
 }
 
 /**
@@ -264,7 +623,9 @@ int CFG_GetEmergencyStopped (void)
  */
 int CFG_GetFMSCommunications (void)
 {
-    return fms_communications == 1;
+    ConfigContext* ctx = get_context();
+
+    return ctx->state.fms_communications == 1;
 }
 
 /**
@@ -273,7 +634,9 @@ int CFG_GetFMSCommunications (void)
  */
 int CFG_GetRadioCommunications (void)
 {
-    return radio_communications == 1;
+    ConfigContext* ctx = get_context();
+
+    return ctx->state.radio_communications == 1;
 }
 
 /**
@@ -282,7 +645,9 @@ int CFG_GetRadioCommunications (void)
  */
 int CFG_GetRobotCommunications (void)
 {
-    return robot_communications == 1;
+    ConfigContext* ctx = get_context();
+
+    return ctx->state.robot_communications == 1;
 }
 
 /**
@@ -293,7 +658,9 @@ int CFG_GetRobotCommunications (void)
  */
 DS_ControlMode CFG_GetControlMode (void)
 {
-    return control_mode;
+    ConfigContext* ctx = get_context();
+
+    return (DS_ControlMode) ctx->state.control_mode;
 }
 
 /**
@@ -301,22 +668,27 @@ DS_ControlMode CFG_GetControlMode (void)
  */
 void CFG_SetRobotCode (const int code)
 {
-    if (robot_code != to_boolean (code)) {
-        robot_code = to_boolean (code);
+    ConfigContext* ctx = get_context();
+    int known = (ctx->state.robot_code != -1);
+
+    if (update_int (&ctx->state.robot_code, to_boolean (code))) {
         create_robot_event (DS_ROBOT_CODE_CHANGED);
         create_robot_event (DS_STATUS_STRING_CHANGED);
+
+        /* The first report of the robot code is not a restart */
+        Lifecycle_CodeChanged (ctx->state.robot_code,
+                               ctx->resetting || !known);
     }
 }
 
 /**
- * Updates the team \a number
+ * Updates the team \a number (the client module re-applies the addresses)
  */
 void CFG_SetTeamNumber (const int number)
 {
-    if (team != number) {
-        team = number;
-        CFG_ReconfigureAddresses (RECONFIGURE_ALL);
-    }
+    ConfigContext* ctx = get_context();
+
+    update_int (&ctx->state.team, number);
 }
 
 /**
@@ -324,10 +696,23 @@ void CFG_SetTeamNumber (const int number)
  */
 void CFG_SetRobotEnabled (const int enabled)
 {
-    if (robot_enabled != to_boolean (enabled)) {
-        robot_enabled = to_boolean (enabled) && !CFG_GetEmergencyStopped();
+    ConfigContext* ctx = get_context();
+    int changed = 0;
+
+    /* The robot cannot be enabled while it is e-stopped */
+    write_begin();
+    if (ctx->state.robot_enabled != to_boolean (enabled)) {
+        ctx->state.robot_enabled = to_boolean (enabled) &&
+                                   ctx->state.emergency_stopped != 1;
+        changed = 1;
+    }
+    write_end();
+
+    /* Notify the application (even if the robot stays disabled) */
+    if (changed) {
         create_robot_event (DS_ROBOT_ENABLED_CHANGED);
         create_robot_event (DS_STATUS_STRING_CHANGED);
+        update_match();
     }
 }
 
@@ -337,8 +722,10 @@ void CFG_SetRobotEnabled (const int enabled)
  */
 void CFG_SetRobotCPUUsage (const int percent)
 {
-    if (cpu_usage != percent) {
-        cpu_usage = respect_range (percent, 0, 100);
+    ConfigContext* ctx = get_context();
+
+    add_sample (DS_HISTORY_CPU_USAGE, percent);
+    if (update_int (&ctx->state.cpu_usage, respect_range (percent, 0, 100))) {
         create_robot_event (DS_ROBOT_CPU_INFO_CHANGED);
     }
 }
@@ -349,8 +736,10 @@ void CFG_SetRobotCPUUsage (const int percent)
  */
 void CFG_SetRobotRAMUsage (const int percent)
 {
-    if (ram_usage != percent) {
-        ram_usage = respect_range (percent, 0, 100);
+    ConfigContext* ctx = get_context();
+
+    add_sample (DS_HISTORY_RAM_USAGE, percent);
+    if (update_int (&ctx->state.ram_usage, respect_range (percent, 0, 100))) {
         create_robot_event (DS_ROBOT_RAM_INFO_CHANGED);
     }
 }
@@ -361,19 +750,28 @@ void CFG_SetRobotRAMUsage (const int percent)
  */
 void CFG_SetRobotDiskUsage (const int percent)
 {
-    if (disk_usage != percent) {
-        disk_usage = respect_range (percent, 0, 100);
+    ConfigContext* ctx = get_context();
+
+    add_sample (DS_HISTORY_DISK_USAGE, percent);
+    if (update_int (&ctx->state.disk_usage, respect_range (percent, 0, 100))) {
         create_robot_event (DS_ROBOT_DISK_INFO_CHANGED);
     }
 }
 
 /**
- * Updates the robot's \a voltage, there are no range limits
+ * Updates the robot's \a voltage, there are no range limits. Every voltage
+ * (even an unchanged one) is added to the voltage trend, which predicts
+ * brownouts
  */
 void CFG_SetRobotVoltage (const float voltage)
 {
-    if (robot_voltage != voltage) {
-        robot_voltage = roundf (voltage * 100) / 100;
+    ConfigContext* ctx = get_context();
+    float rounded = roundf (voltage * 100) / 100;
+
+    Brownout_AddSample (voltage);
+    Match_AddVoltage (voltage);
+
+    if (update_float (&ctx->state.robot_voltage, rounded)) {
         create_robot_event (DS_ROBOT_VOLTAGE_CHANGED);
     }
 }
@@ -383,8 +781,9 @@ void CFG_SetRobotVoltage (const float voltage)
  */
 void CFG_SetEmergencyStopped (const int stopped)
 {
-    if (emergency_stopped != to_boolean (stopped)) {
-        emergency_stopped = to_boolean (stopped);
+    ConfigContext* ctx = get_context();
+
+    if (update_int (&ctx->state.emergency_stopped, to_boolean (stopped))) {
         create_robot_event (DS_ROBOT_ESTOP_CHANGED);
         create_robot_event (DS_STATUS_STRING_CHANGED);
     }
@@ -395,8 +794,9 @@ void CFG_SetEmergencyStopped (const int stopped)
  */
 void CFG_SetAlliance (const DS_Alliance alliance)
 {
-    if (robot_alliance != alliance) {
-        robot_alliance = alliance;
+    ConfigContext* ctx = get_context();
+
+    if (update_int (&ctx->state.robot_alliance, (int) alliance)) {
         create_robot_event (DS_ROBOT_STATION_CHANGED);
     }
 }
@@ -406,8 +806,9 @@ void CFG_SetAlliance (const DS_Alliance alliance)
  */
 void CFG_SetPosition (const DS_Position position)
 {
-    if (robot_position != position) {
-        robot_position = position;
+    ConfigContext* ctx = get_context();
+
+    if (update_int (&ctx->state.robot_position, (int) position)) {
         create_robot_event (DS_ROBOT_STATION_CHANGED);
     }
 }
@@ -417,8 +818,10 @@ void CFG_SetPosition (const DS_Position position)
  */
 void CFG_SetCANUtilization (const int utilization)
 {
-    if (can_utilization != utilization) {
-        can_utilization = utilization;
+    ConfigContext* ctx = get_context();
+
+    add_sample (DS_HISTORY_CAN_UTILIZATION, utilization);
+    if (update_int (&ctx->state.can_utilization, utilization)) {
         create_robot_event (DS_ROBOT_CAN_UTIL_CHANGED);
     }
 }
@@ -428,10 +831,12 @@ void CFG_SetCANUtilization (const int utilization)
  */
 void CFG_SetControlMode (const DS_ControlMode mode)
 {
-    if (control_mode != mode) {
-        control_mode = mode;
+    ConfigContext* ctx = get_context();
+
+    if (update_int (&ctx->state.control_mode, (int) mode)) {
         create_robot_event (DS_ROBOT_MODE_CHANGED);
         create_robot_event (DS_STATUS_STRING_CHANGED);
+        update_match();
     }
 }
 
@@ -440,15 +845,17 @@ void CFG_SetControlMode (const DS_ControlMode mode)
  */
 void CFG_SetFMSCommunications (const int communications)
 {
-    if (fms_communications != to_boolean (communications)) {
-        fms_communications = to_boolean (communications);
+    ConfigContext* ctx = get_context();
+    int* field = &ctx->state.fms_communications;
 
+    if (update_int (field, to_boolean (communications))) {
         DS_Event event;
         event.fms.type = DS_FMS_COMMS_CHANGED;
-        event.fms.connected = fms_communications;
+        event.fms.connected = to_boolean (communications);
         DS_AddEvent (&event);
 
         DS_ResetFMSPackets();
+        update_match();
     }
 }
 
@@ -457,12 +864,13 @@ void CFG_SetFMSCommunications (const int communications)
  */
 void CFG_SetRadioCommunications (const int communications)
 {
-    if (radio_communications != to_boolean (communications)) {
-        radio_communications = to_boolean (communications);
+    ConfigContext* ctx = get_context();
+    int* field = &ctx->state.radio_communications;
 
+    if (update_int (field, to_boolean (communications))) {
         DS_Event event;
         event.radio.type = DS_RADIO_COMMS_CHANGED;
-        event.radio.connected = fms_communications;
+        event.radio.connected = to_boolean (communications);
         DS_AddEvent (&event);
 
         DS_ResetRadioPackets();
@@ -474,13 +882,94 @@ void CFG_SetRadioCommunications (const int communications)
  */
 void CFG_SetRobotCommunications (const int communications)
 {
-    if (robot_communications != to_boolean (communications)) {
-        robot_communications = to_boolean (communications);
+    ConfigContext* ctx = get_context();
+    int* field = &ctx->state.robot_communications;
+
+    if (update_int (field, to_boolean (communications))) {
         create_robot_event (DS_ROBOT_COMMS_CHANGED);
         create_robot_event (DS_STATUS_STRING_CHANGED);
 
         DS_ResetRobotPackets();
+        Lifecycle_CommsChanged (*field);
+        Match_CommsChanged (*field);
+
+        /* Check if the robot replied through its last known address */
+        if (*field)
+            Client_RobotAddressConfirmed();
+    }
+}
+
+/**
+ * Updates the game-specific message of the current match
+ */
+void CFG_SetGameData (const char* data)
+{
+    ConfigContext* ctx = get_context();
+
+    /* Check arguments */
+    assert (data);
+
+    DS_MutexLock (&ctx->write_mutex);
+    if (update_string (ctx->match.game_data, sizeof (ctx->match.game_data),
+                       data))
+        ++ctx->match.version;
+    DS_MutexUnlock (&ctx->write_mutex);
+}
+
+/**
+ * Updates the match state reported by the FMS, a \c DS_FMS_MATCH_CHANGED
+ * event (with a copy of the state) is registered if it changed
+ */
+void CFG_SetFMSMatch (const DS_FMSMatch* match)
+{
+    ConfigContext* ctx = get_context();
+
+    /* Check arguments */
+    assert (match);
+
+    DS_MutexLock (&ctx->write_mutex);
+    int changed = memcmp (&ctx->fms_match, match, sizeof (*match)) != 0;
+    if (changed)
+        ctx->fms_match = *match;
+    DS_MutexUnlock (&ctx->write_mutex);
+
+    if (changed) {
+        DS_Event event;
+        event.fms_match.type = DS_FMS_MATCH_CHANGED;
+        event.fms_match.match = *match;
+        DS_AddEvent (&event);
+        update_match();
+    }
+}
+
+/**
+ * Updates the \a event name, the match \a type and the match and replay
+ * numbers of the current match
+ */
+void CFG_SetMatchInfo (const char* event, const DS_MatchType type,
+                       const int number, const int replay)
+{
+    ConfigContext* ctx = get_context();
+    CFG_MatchInfo* match = &ctx->match;
+
+    /* Check arguments */
+    assert (event);
+
+    DS_MutexLock (&ctx->write_mutex);
+    int changed = update_string (match->event_name,
+                                 sizeof (match->event_name), event);
+
+    if (match->match_type != type || match->match_number != number ||
+            match->replay_number != replay) {
+        match->match_type = type;
+        match->match_number = number;
+        match->replay_number = replay;
+        changed = 1;
     }
+
+    if (changed)
+        ++match->version;
+    DS_MutexUnlock (&ctx->write_mutex);
 }
 
 /**
@@ -489,6 +978,7 @@ void CFG_SetRobotCommunications (const int communications)
 void CFG_FMSWatchdogExpired (void)
 {
     CFG_SetFMSCommunications (0);
+    CFG_SetFMSMatch (&no_fms_match);
     CFG_ReconfigureAddresses (RECONFIGURE_FMS);
 }
 
@@ -506,7 +996,10 @@ void CFG_RadioWatchdogExpired (void)
  */
 void CFG_RobotWatchdogExpired (void)
 {
+    ConfigContext* ctx = get_context();
+
     /* Reset everything to safe state */
+    ctx->resetting = 1;
     CFG_SetRobotCode (0);
     CFG_SetRobotVoltage (0);
     CFG_SetRobotEnabled (0);
@@ -515,6 +1008,10 @@ void CFG_RobotWatchdogExpired (void)
     CFG_SetRobotDiskUsage (0);
     CFG_SetEmergencyStopped (0);
     CFG_SetRobotCommunications (0);
+    ctx->resetting = 0;
+
+    /* Count the cycle in which the last known address did not work */
+    Client_KnownRobotAddressFailed();
 
     /* Force the sockets to perform another lookup */
     CFG_ReconfigureAddresses (RECONFIGURE_ROBOT);
@@ -0,0 +1,183 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "LibDS.h"
+#include "DS_Atomic.h"
+#include "DS_Context.h"
+#include "DS_Thread.h"
+
+#include <assert.h>
+#include <string.h>
+
+/*
+ * The module states are allocated when a module uses them for the first
+ * time, their pointers are published with release semantics, so that the
+ * modules can read them without locking the context
+ */
+struct _ds_context {
+    DS_Mutex mutex;
+    volatile size_t data [DS_CONTEXT_MODULE_COUNT];
+    void (*destroy [DS_CONTEXT_MODULE_COUNT]) (void*);
+};
+
+/*
+ * The context used by threads that did not select another one, this keeps
+ * the LibDS usable without ever creating a context
+ */
+static DS_Context default_context = { DS_MUTEX_INITIALIZER, {0}, {0} };
+
+/*
+ * Holds the current context of each thread
+ */
+static DS_ThreadKey current_key;
+static DS_Once current_once = DS_ONCE_INIT;
+
+/**
+ * Creates the thread-specific key that holds the current context
+ */
+static void create_key (void)
+{
+    DS_ThreadKeyCreate (&current_key);
+}
+
+/**
+ * Creates a new (and uninitialized) context, select it with
+ * \c DS_ContextMakeCurrent() and call \c DS_Init() to start it
+ */
+DS_Context* DS_ContextNew (void)
+{
+    DS_Context* context = (DS_Context*) DS_CALLOC (DS_MEMORY_GENERAL, 1,
+                                                   sizeof (DS_Context));
+
+    if (context)
+        DS_MutexInit (&context->mutex);
+
+    return context;
+}
+
+/**
+ * Closes the given \a context (if it is initialized) and de-allocates the
+ * state of its modules. The default context cannot be freed.
+ */
+void DS_ContextFree (DS_Context* context)
+{
+    int i;
+    void* data;
+    DS_Context* current;
+
+    if (!context || context == &default_context)
+        return;
+
+    /* Close the context from this thread */
+    current = DS_ContextCurrent();
+    DS_ContextMakeCurrent (context);
+    DS_Close();
+    DS_ContextMakeCurrent (current == context ? NULL : current);
+
+    /* Delete the module states */
+    for (i = 0; i < DS_CONTEXT_MODULE_COUNT; ++i) {
+        data = (void*) DS_AtomicLoad (&context->data [i]);
+
+        if (data && context->destroy [i])
+            context->destroy [i] (data);
+
+        DS_FREE (data);
+    }
+
+    DS_MutexDestroy (&context->mutex);
+    DS_FREE (context);
+}
+
+/**
+ * Returns the context that is used by threads that did not select a
+ * context with \c DS_ContextMakeCurrent()
+ */
+DS_Context* DS_ContextDefault (void)
+{
+    return &default_context;
+}
+
+/**
+ * Returns the context used by the calling thread
+ */
+DS_Context* DS_ContextCurrent (void)
+{
+    DS_Context* context;
+
+    DS_CallOnce (&current_once, &create_key);
+    context = (DS_Context*) DS_ThreadKeyGet (current_key);
+
+    return context ? context : &default_context;
+}
+
+/**
+ * Selects the \a context used by all the LibDS functions that are called
+ * from the calling thread, pass \c NULL to select the default context.
+ *
+ * The threads created by a context (e.g. the protocol event loop) use it
+ * automatically.
+ */
+void DS_ContextMakeCurrent (DS_Context* context)
+{
+    DS_CallOnce (&current_once, &create_key);
+    DS_ThreadKeySet (current_key, context);
+}
+
+/**
+ * Returns the state of the given \a module in the current context. The state
+ * is allocated (with \a size bytes, set to zero) and passed to \a init the
+ * first time that the module asks for it. If set, \a destroy is called
+ * before the state is de-allocated with its context.
+ */
+void* DS_ContextData (const DS_ContextModule module,
+                      const size_t size,
+                      void (*init) (void*),
+                      void (*destroy) (void*))
+{
+    void* data;
+    DS_Context* context = DS_ContextCurrent();
+
+    assert (module < DS_CONTEXT_MODULE_COUNT);
+
+    /* The state already exists */
+    data = (void*) DS_AtomicLoad (&context->data [module]);
+    if (data)
+        return data;
+
+    /* Allocate and initialize the state (only once) */
+    DS_MutexLock (&context->mutex);
+    data = (void*) DS_AtomicLoad (&context->data [module]);
+    if (!data) {
+        data = DS_CALLOC (DS_MEMORY_GENERAL, 1, size);
+        assert (data);
+
+        if (init)
+            init (data);
+
+        context->destroy [module] = destroy;
+        DS_AtomicStore (&context->data [module], (size_t) data);
+    }
+    DS_MutexUnlock (&context->mutex);
+
+    return data;
+}
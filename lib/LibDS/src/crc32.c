@@ -41,10 +41,47 @@
  */
 
 #include "DS_Utils.h"
+#include "DS_Thread.h"
 
 #include <assert.h>
+#include <string.h>
 
-static uint32_t crc32_tab[] = {
+/*
+ * Carry-less multiplication (PCLMULQDQ) is detected at runtime on x86, the
+ * CRC32 instructions of ARMv8 are used if the compiler targets them
+ */
+#if (defined __x86_64__ || defined __i386__ || defined _M_X64 || defined _M_IX86) && \
+    (defined _MSC_VER || defined __clang__ || \
+     (defined __GNUC__ && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+    #define DS_CRC32_PCLMUL
+    #include <emmintrin.h>
+    #include <wmmintrin.h>
+    #if defined _MSC_VER
+        #include <intrin.h>
+        #define PCLMUL_FUNCTION
+    #else
+        #include <cpuid.h>
+        #define PCLMUL_FUNCTION __attribute__ ((target ("pclmul,sse2")))
+    #endif
+#elif defined __ARM_FEATURE_CRC32
+    #define DS_CRC32_ARMV8
+    #include <arm_acle.h>
+#endif
+
+/*
+ * Slicing-by-8 reads the input as little-endian words
+ */
+#if defined _WIN32 || defined __LITTLE_ENDIAN__ || \
+    (defined __BYTE_ORDER__ && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    #define DS_CRC32_SLICING
+#endif
+
+/*
+ * Minimum number of bytes that are processed with carry-less multiplication
+ */
+#define PCLMUL_MIN_SIZE 64
+
+static const uint32_t crc32_tab[] = {
     0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
     0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
     0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2,
@@ -90,17 +127,270 @@ static uint32_t crc32_tab[] = {
     0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
 
-uint32_t DS_CRC32 (const void* buf, size_t size)
+/*
+ * Tables of the slicing-by-8 algorithm (the first one is crc32_tab), they
+ * are generated when the first checksum is calculated
+ */
+static uint32_t slices [8][256];
+
+/*
+ * Implementation selected for the CPU of the computer
+ */
+static DS_Once init_once = DS_ONCE_INIT;
+static uint32_t (*crc32_update) (uint32_t crc, const uint8_t* p, size_t size);
+
+/**
+ * Updates the \a crc with the given bytes, one byte at a time
+ */
+static uint32_t crc32_bytes (uint32_t crc, const uint8_t* p, size_t size)
 {
-    assert (buf);
+    while (size--)
+        crc = crc32_tab [ (crc ^ *p++) & 0xFF] ^ (crc >> 8);
+
+    return crc;
+}
+
+/**
+ * Updates the \a crc with the given bytes, eight bytes at a time
+ */
+static uint32_t crc32_slicing (uint32_t crc, const uint8_t* p, size_t size)
+{
+#if defined DS_CRC32_SLICING
+    uint32_t one;
+    uint32_t two;
+
+    while (size >= 8) {
+        memcpy (&one, p, 4);
+        memcpy (&two, p + 4, 4);
+        one ^= crc;
+
+        crc = slices [7][one & 0xFF] ^
+              slices [6][(one >> 8) & 0xFF] ^
+              slices [5][(one >> 16) & 0xFF] ^
+              slices [4][one >> 24] ^
+              slices [3][two & 0xFF] ^
+              slices [2][(two >> 8) & 0xFF] ^
+              slices [1][(two >> 16) & 0xFF] ^
+              slices [0][two >> 24];
+
+        p += 8;
+        size -= 8;
+    }
+#endif
+
+    return crc32_bytes (crc, p, size);
+}
+
+#if defined DS_CRC32_PCLMUL
+
+/**
+ * Returns \c 1 if the CPU supports carry-less multiplication (and SSE2)
+ */
+static int cpu_has_pclmul (void)
+{
+    unsigned int ecx;
+    unsigned int edx;
+
+#if defined _MSC_VER
+    int info [4];
+    __cpuid (info, 1);
+    ecx = (unsigned int) info [2];
+    edx = (unsigned int) info [3];
+#else
+    unsigned int eax;
+    unsigned int ebx;
+    if (!__get_cpuid (1, &eax, &ebx, &ecx, &edx))
+        return 0;
+#endif
+
+    return (ecx & (1 << 1)) && (edx & (1 << 26));
+}
+
+/**
+ * Updates the \a crc with the given bytes by folding them in 128-bit blocks
+ * with carry-less multiplications, as described in the "Fast CRC Computation
+ * for Generic Polynomials Using PCLMULQDQ Instruction" paper by Intel. The
+ * blocks that do not fill 16 bytes are processed with slicing-by-8.
+ */
+PCLMUL_FUNCTION
+static uint32_t crc32_pclmul (uint32_t crc, const uint8_t* p, size_t size)
+{
+    /* Use tables for small buffers */
+    if (size < PCLMUL_MIN_SIZE)
+        return crc32_slicing (crc, p, size);
+
+    /* Constants of the bit-reflected polynomial (see the paper) */
+    const __m128i k1k2 = _mm_set_epi32 (0x00000001, 0xC6E41596,
+                                        0x00000001, 0x54442BD4);
+    const __m128i k3k4 = _mm_set_epi32 (0x00000000, 0xCCAA009E,
+                                        0x00000001, 0x751997D0);
+    const __m128i k5k0 = _mm_set_epi32 (0x00000000, 0x00000000,
+                                        0x00000001, 0x63CD6124);
+    const __m128i poly = _mm_set_epi32 (0x00000001, 0xF7011641,
+                                        0x00000001, 0xDB710641);
+    const __m128i mask = _mm_setr_epi32 (~0, 0, ~0, 0);
+
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+    /* Load the first 64 bytes */
+    x1 = _mm_loadu_si128 ((const __m128i*) (p + 0x00));
+    x2 = _mm_loadu_si128 ((const __m128i*) (p + 0x10));
+    x3 = _mm_loadu_si128 ((const __m128i*) (p + 0x20));
+    x4 = _mm_loadu_si128 ((const __m128i*) (p + 0x30));
+    x1 = _mm_xor_si128 (x1, _mm_cvtsi32_si128 ((int) crc));
+
+    p += 64;
+    size -= 64;
+
+    /* Fold four blocks at a time */
+    while (size >= 64) {
+        x5 = _mm_clmulepi64_si128 (x1, k1k2, 0x00);
+        x6 = _mm_clmulepi64_si128 (x2, k1k2, 0x00);
+        x7 = _mm_clmulepi64_si128 (x3, k1k2, 0x00);
+        x8 = _mm_clmulepi64_si128 (x4, k1k2, 0x00);
 
-    const uint8_t* p;
-    uint32_t crc = 0xFFFFFFFFUL;
+        x1 = _mm_clmulepi64_si128 (x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128 (x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128 (x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128 (x4, k1k2, 0x11);
 
-    p = buf;
+        x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x5),
+                            _mm_loadu_si128 ((const __m128i*) (p + 0x00)));
+        x2 = _mm_xor_si128 (_mm_xor_si128 (x2, x6),
+                            _mm_loadu_si128 ((const __m128i*) (p + 0x10)));
+        x3 = _mm_xor_si128 (_mm_xor_si128 (x3, x7),
+                            _mm_loadu_si128 ((const __m128i*) (p + 0x20)));
+        x4 = _mm_xor_si128 (_mm_xor_si128 (x4, x8),
+                            _mm_loadu_si128 ((const __m128i*) (p + 0x30)));
+
+        p += 64;
+        size -= 64;
+    }
+
+    /* Fold the four blocks into one */
+    x5 = _mm_clmulepi64_si128 (x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128 (x1, k3k4, 0x11);
+    x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x2), x5);
+
+    x5 = _mm_clmulepi64_si128 (x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128 (x1, k3k4, 0x11);
+    x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x3), x5);
+
+    x5 = _mm_clmulepi64_si128 (x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128 (x1, k3k4, 0x11);
+    x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x4), x5);
+
+    /* Fold the remaining 16-byte blocks */
+    while (size >= 16) {
+        x5 = _mm_clmulepi64_si128 (x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128 (x1, k3k4, 0x11);
+        x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x5),
+                            _mm_loadu_si128 ((const __m128i*) p));
+
+        p += 16;
+        size -= 16;
+    }
+
+    /* Fold 128 bits into 64 bits */
+    x2 = _mm_clmulepi64_si128 (x1, k3k4, 0x10);
+    x1 = _mm_xor_si128 (_mm_srli_si128 (x1, 8), x2);
+
+    x2 = _mm_srli_si128 (x1, 4);
+    x1 = _mm_and_si128 (x1, mask);
+    x1 = _mm_clmulepi64_si128 (x1, k5k0, 0x00);
+    x1 = _mm_xor_si128 (x1, x2);
+
+    /* Barrett reduction to 32 bits */
+    x2 = _mm_and_si128 (x1, mask);
+    x2 = _mm_clmulepi64_si128 (x2, poly, 0x10);
+    x2 = _mm_and_si128 (x2, mask);
+    x2 = _mm_clmulepi64_si128 (x2, poly, 0x00);
+    x1 = _mm_xor_si128 (x1, x2);
+
+    /* Process the remaining bytes */
+    x0 = _mm_srli_si128 (x1, 4);
+    crc = (uint32_t) _mm_cvtsi128_si32 (x0);
+    return crc32_slicing (crc, p, size);
+}
+
+#endif
+
+#if defined DS_CRC32_ARMV8
+
+/**
+ * Updates the \a crc with the given bytes using the CRC32 instructions of
+ * ARMv8, eight bytes at a time
+ */
+static uint32_t crc32_armv8 (uint32_t crc, const uint8_t* p, size_t size)
+{
+    uint64_t word;
+
+    while (size >= 8) {
+        memcpy (&word, p, 8);
+        crc = __crc32d (crc, word);
+        p += 8;
+        size -= 8;
+    }
 
     while (size--)
-        crc = crc32_tab [ (crc ^ *p++) & 0xFF] ^ (crc >> 8);
+        crc = __crc32b (crc, *p++);
+
+    return crc;
+}
 
-    return crc ^ 0xFFFFFFFFUL;
+#endif
+
+/**
+ * Generates the slicing-by-8 tables and selects the fastest implementation
+ * that is supported by the CPU
+ */
+static void init_crc32 (void)
+{
+    int i;
+    int j;
+
+    /* Generate the tables */
+    for (i = 0; i < 256; ++i)
+        slices [0][i] = crc32_tab [i];
+
+    for (i = 0; i < 256; ++i) {
+        for (j = 1; j < 8; ++j) {
+            uint32_t prev = slices [j - 1][i];
+            slices [j][i] = (prev >> 8) ^ crc32_tab [prev & 0xFF];
+        }
+    }
+
+    /* Select the implementation */
+    crc32_update = &crc32_slicing;
+
+#if defined DS_CRC32_PCLMUL
+    if (cpu_has_pclmul())
+        crc32_update = &crc32_pclmul;
+#elif defined DS_CRC32_ARMV8
+    crc32_update = &crc32_armv8;
+#endif
+}
+
+/**
+ * Continues the calculation of the CRC32 checksum of a stream of data, where
+ * \a crc is the checksum of the data that precedes the given \a buf
+ * (or \c 0 for the first block of the stream).
+ *
+ * \returns the checksum of all the data, including \a buf
+ */
+uint32_t DS_CRC32Update (const uint32_t crc, const void* buf, size_t size)
+{
+    assert (buf);
+
+    DS_CallOnce (&init_once, &init_crc32);
+    return crc32_update (crc ^ 0xFFFFFFFFUL, (const uint8_t*) buf, size) ^
+           0xFFFFFFFFUL;
+}
+
+/**
+ * Returns the CRC32 checksum of the given \a buf
+ */
+uint32_t DS_CRC32 (const void* buf, size_t size)
+{
+    return DS_CRC32Update (0, buf, size);
 }
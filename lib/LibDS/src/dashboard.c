@@ -0,0 +1,668 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Utils.h"
+#include "DS_Atomic.h"
+#include "DS_Client.h"
+#include "DS_Events.h"
+#include "DS_Packet.h"
+#include "DS_Reader.h"
+#include "DS_Socket.h"
+#include "DS_Thread.h"
+#include "DS_Context.h"
+#include "DS_Dashboard.h"
+
+#include <string.h>
+#include <assert.h>
+
+/*
+ * A dashboard entry, entries set by the application (\c local) are sent to
+ * the server when they change (\c dirty) and when the connection starts
+ */
+typedef struct {
+    uint64_t sequence;
+    DS_DashboardType type;
+    double number;
+    int local;
+    int dirty;
+    size_t key_len;
+    size_t text_len;
+    char key [DS_DASHBOARD_KEY_SIZE];
+    char text [DS_DASHBOARD_TEXT_SIZE];
+} Entry;
+
+/*
+ * Connection state, allocated while the dashboard is running (the socket is
+ * registered with the reactor, so its address must not change)
+ */
+typedef struct {
+    DS_Socket socket;
+    int connected;
+    int count;
+    Entry entries [DS_DASHBOARD_MAX_ENTRIES];
+} DashboardState;
+
+/*
+ * Dashboard state of a DS context:
+ *
+ * - The event loop reads the messages of the server and sends the changes
+ *   of the application (see Dashboard_Update), the application reads the
+ *   entries and changes them, the mutex protects the connection state
+ * - Every change of an entry gets the next \c sequence number, so the
+ *   application can read the entries that changed since its last read
+ * - \c notified is set to 1 when a DS_DASHBOARD_CHANGED event is pending,
+ *   and cleared when the application reads the latest change
+ */
+typedef struct {
+    volatile size_t running;
+    uint64_t sequence;
+    int notified;
+    DashboardState* state;
+    DS_Mutex mutex;
+} DashboardContext;
+
+/**
+ * Initializes the dashboard state of a new DS context
+ */
+static void init_context (void* data)
+{
+    DashboardContext* ctx = (DashboardContext*) data;
+    DS_MutexInit (&ctx->mutex);
+}
+
+/**
+ * Releases the dashboard state of a DS context
+ */
+static void destroy_context (void* data)
+{
+    DashboardContext* ctx = (DashboardContext*) data;
+    DS_MutexDestroy (&ctx->mutex);
+}
+
+/**
+ * Returns the dashboard state of the current DS context
+ */
+static DashboardContext* get_context (void)
+{
+    return (DashboardContext*) DS_ContextData (DS_CONTEXT_DASHBOARD,
+                                               sizeof (DashboardContext),
+                                               init_context, destroy_context);
+}
+
+/**
+ * Returns the entry with the given \a key, or \c NULL if there is none
+ */
+static Entry* find_entry (DashboardState* state, const char* key,
+                          const size_t len)
+{
+    int i;
+
+    for (i = 0; i < state->count; ++i) {
+        Entry* entry = &state->entries [i];
+        if (entry->key_len == len && memcmp (entry->key, key, len) == 0)
+            return entry;
+    }
+
+    return NULL;
+}
+
+/**
+ * Returns the entry with the given \a key, a new entry is added if there is
+ * none. Deleted entries are only re-used when the table is full, so that
+ * the application can see the deletion first.
+ *
+ * \returns \c NULL if the table is full
+ */
+static Entry* get_entry (DashboardState* state, const char* key, size_t len)
+{
+    int i;
+
+    len = DS_Min (len, (size_t) DS_DASHBOARD_KEY_SIZE - 1);
+    Entry* entry = find_entry (state, key, len);
+    if (entry)
+        return entry;
+
+    if (state->count < DS_DASHBOARD_MAX_ENTRIES)
+        entry = &state->entries [state->count++];
+
+    for (i = 0; !entry && i < state->count; ++i) {
+        if (state->entries [i].type == DS_DASHBOARD_DELETED &&
+                !state->entries [i].local)
+            entry = &state->entries [i];
+    }
+
+    if (entry) {
+        memset (entry, 0, sizeof (Entry));
+        memcpy (entry->key, key, len);
+        entry->key_len = len;
+    }
+
+    return entry;
+}
+
+/**
+ * Changes the value of the given \a entry, the entry gets a new sequence
+ * number if its value changed
+ *
+ * \returns \c 1 if the value changed, \c 0 otherwise
+ */
+static int set_value (DashboardContext* ctx, Entry* entry,
+                      const DS_DashboardType type, const double number,
+                      const char* text, size_t len)
+{
+    len = DS_Min (len, (size_t) DS_DASHBOARD_TEXT_SIZE - 1);
+
+    if (entry->sequence > 0 && entry->type == type &&
+            entry->number == number && entry->text_len == len &&
+            memcmp (entry->text, text, len) == 0)
+        return 0;
+
+    entry->type = type;
+    entry->number = number;
+    entry->text_len = len;
+    memcpy (entry->text, text, len);
+    entry->text [len] = '\0';
+    entry->sequence = ++ctx->sequence;
+
+    return 1;
+}
+
+/**
+ * Registers a DS_DASHBOARD_CHANGED event, unless the previous one has not
+ * been processed yet (the mutex must be locked)
+ */
+static int take_notification (DashboardContext* ctx)
+{
+    if (ctx->notified)
+        return 0;
+
+    ctx->notified = 1;
+    return 1;
+}
+
+/**
+ * Registers a DS_DASHBOARD_CHANGED event
+ */
+static void notify (void)
+{
+    DS_Event event;
+    event.type = DS_DASHBOARD_CHANGED;
+    DS_AddEvent (&event);
+}
+
+/**
+ * Stores the entries of the given server \a message
+ *
+ * \returns \c 1 if any entry changed
+ */
+static int read_message (DashboardContext* ctx, const DS_String* message)
+{
+    int changed = 0;
+    DS_Reader reader;
+    DS_ReaderInit (&reader, message, 0);
+
+    while (DS_ReaderRemaining (&reader) >= 2) {
+        uint8_t type = DS_ReaderU8 (&reader);
+        uint8_t key_len = DS_ReaderU8 (&reader);
+        const char* key = (const char*) DS_ReaderBytes (&reader, key_len);
+
+        double number = 0;
+        const char* text = "";
+        size_t text_len = 0;
+
+        switch (type) {
+        case DS_DASHBOARD_DELETED:
+            break;
+        case DS_DASHBOARD_BOOLEAN:
+            number = DS_ReaderU8 (&reader) ? 1 : 0;
+            break;
+        case DS_DASHBOARD_NUMBER: {
+            uint64_t bits = ((uint64_t) DS_ReaderU32 (&reader)) << 32;
+            bits |= DS_ReaderU32 (&reader);
+            memcpy (&number, &bits, sizeof (number));
+            break;
+        }
+        case DS_DASHBOARD_STRING:
+            text_len = DS_ReaderU16 (&reader);
+            text = (const char*) DS_ReaderBytes (&reader, text_len);
+            break;
+        default:
+            return changed;
+        }
+
+        /* Entry is truncated */
+        if (reader.error || !key || !text)
+            break;
+
+        /* The server owns the entries that it sends */
+        Entry* entry = get_entry (ctx->state, key, key_len);
+        if (entry) {
+            entry->local = 0;
+            entry->dirty = 0;
+            changed |= set_value (ctx, entry, (DS_DashboardType) type,
+                                  number, text, text_len);
+        }
+    }
+
+    return changed;
+}
+
+/**
+ * Appends the given \a entry to the \a packet
+ *
+ * \returns \c 0 if the entry does not fit in the packet
+ */
+static int write_entry (DS_Packet* packet, const Entry* entry)
+{
+    size_t len = packet->len;
+
+    DS_PacketAppend (packet, (uint8_t) entry->type);
+    DS_PacketAppend (packet, (uint8_t) entry->key_len);
+    DS_PacketAppendBytes (packet, entry->key, entry->key_len);
+
+    if (entry->type == DS_DASHBOARD_BOOLEAN)
+        DS_PacketAppend (packet, entry->number != 0);
+
+    else if (entry->type == DS_DASHBOARD_NUMBER) {
+        int i;
+        uint64_t bits;
+        memcpy (&bits, &entry->number, sizeof (bits));
+        for (i = 7; i >= 0; --i)
+            DS_PacketAppend (packet, (uint8_t) (bits >> (i * 8)));
+    }
+
+    else if (entry->type == DS_DASHBOARD_STRING) {
+        DS_PacketAppendU16 (packet, (uint16_t) entry->text_len);
+        DS_PacketAppendBytes (packet, entry->text, entry->text_len);
+    }
+
+    if (packet->overflow) {
+        packet->len = len;
+        packet->overflow = 0;
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Sends the entries of the application that changed, in as few messages
+ * as possible
+ */
+static void send_entries (DashboardState* state)
+{
+    int i;
+    DS_Packet packet;
+    uint8_t buffer [DS_SOCKET_SLOT_SIZE];
+    DS_PacketInit (&packet, buffer, sizeof (buffer));
+
+    for (i = 0; i < state->count; ++i) {
+        Entry* entry = &state->entries [i];
+        if (!entry->dirty)
+            continue;
+
+        if (!write_entry (&packet, entry)) {
+            DS_String data = DS_PacketView (&packet);
+            DS_SocketSend (&state->socket, &data);
+            DS_PacketClear (&packet);
+            write_entry (&packet, entry);
+        }
+
+        entry->dirty = 0;
+        if (entry->type == DS_DASHBOARD_DELETED)
+            entry->local = 0;
+    }
+
+    if (packet.len > 0) {
+        DS_String data = DS_PacketView (&packet);
+        DS_SocketSend (&state->socket, &data);
+    }
+}
+
+/**
+ * Called when the connection with the server starts or ends: the entries
+ * of the server are deleted (the server sends them again when the
+ * connection starts) and the entries of the application are sent again
+ *
+ * \returns \c 1 if any entry changed
+ */
+static int reset_entries (DashboardContext* ctx)
+{
+    int i;
+    int changed = 0;
+    DashboardState* state = ctx->state;
+
+    for (i = 0; i < state->count; ++i) {
+        Entry* entry = &state->entries [i];
+
+        if (entry->local)
+            entry->dirty = 1;
+        else if (entry->type != DS_DASHBOARD_DELETED)
+            changed |= set_value (ctx, entry, DS_DASHBOARD_DELETED, 0, "", 0);
+    }
+
+    return changed;
+}
+
+/**
+ * Changes the value of the entry with the given \a key on behalf of the
+ * application, the change is sent to the server by the event loop
+ *
+ * \returns \c 0 if the dashboard is not running or if the table is full
+ */
+static int set_local (const char* key, const DS_DashboardType type,
+                      const double number, const char* text)
+{
+    assert (key);
+    assert (text);
+
+    int changed = 0;
+    int notify_app = 0;
+    DashboardContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+
+    int ok = (ctx->state != NULL);
+    if (ok) {
+        /* Entries that do not exist are not added to be deleted */
+        size_t len = DS_Min (strlen (key), (size_t) DS_DASHBOARD_KEY_SIZE - 1);
+        Entry* entry = (type == DS_DASHBOARD_DELETED) ?
+                       find_entry (ctx->state, key, len) :
+                       get_entry (ctx->state, key, len);
+
+        if (entry) {
+            changed = set_value (ctx, entry, type, number, text, strlen (text));
+            entry->local = 1;
+            entry->dirty |= changed;
+            notify_app = changed && take_notification (ctx);
+        }
+
+        ok = (entry != NULL || type == DS_DASHBOARD_DELETED);
+    }
+
+    DS_MutexUnlock (&ctx->mutex);
+
+    if (notify_app)
+        notify();
+    if (changed)
+        DS_SocketWakeUp();
+
+    return ok;
+}
+
+/**
+ * Stops the dashboard client when the DS is closed
+ */
+void Dashboard_Close (void)
+{
+    DS_StopDashboard();
+}
+
+/**
+ * Reads the messages of the dashboard server and sends the changes of the
+ * application, this function is called by the event loop
+ */
+void Dashboard_Update (void)
+{
+    DashboardContext* ctx = get_context();
+
+    if (!DS_AtomicLoad (&ctx->running))
+        return;
+
+    int changed = 0;
+    int notify_app = 0;
+    DS_String message;
+
+    DS_MutexLock (&ctx->mutex);
+
+    DashboardState* state = ctx->state;
+    if (state) {
+        /* Connection started or ended */
+        int connected = DS_SocketConnected (&state->socket);
+        if (connected != state->connected) {
+            state->connected = connected;
+            changed |= reset_entries (ctx);
+        }
+
+        /* Read the entries of the server */
+        while (DS_SocketPeek (&state->socket, &message)) {
+            changed |= read_message (ctx, &message);
+            DS_SocketRelease (&state->socket);
+        }
+
+        /* Send the entries of the application */
+        if (connected)
+            send_entries (state);
+
+        notify_app = changed && take_notification (ctx);
+    }
+
+    DS_MutexUnlock (&ctx->mutex);
+
+    if (notify_app)
+        notify();
+}
+
+/**
+ * Connects the dashboard client to the given \a address (called when the
+ * robot address changes)
+ */
+void Dashboard_ChangeAddress (const char* address)
+{
+    DashboardContext* ctx = get_context();
+
+    if (!DS_AtomicLoad (&ctx->running))
+        return;
+
+    DS_MutexLock (&ctx->mutex);
+    if (ctx->state)
+        DS_SocketChangeAddress (&ctx->state->socket, address);
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Connects to the dashboard server of the robot on the given \a port
+ * (\c DS_DASHBOARD_PORT if \c 0). The connection is handled by the socket
+ * reactor and the event loop of the DS, so dashboard values are available
+ * to the application without a separate dashboard process.
+ *
+ * The application is notified with a \c DS_DASHBOARD_CHANGED event when
+ * entries change, and reads them with \c DS_DashboardRead().
+ *
+ * \returns \c 1 on success, \c 0 if the dashboard is already running or if
+ *          its state could not be allocated
+ */
+int DS_StartDashboard (const int port)
+{
+    DashboardContext* ctx = get_context();
+
+    if (DS_AtomicLoad (&ctx->running))
+        return 0;
+
+    DashboardState* state = (DashboardState*) DS_CALLOC (DS_MEMORY_GENERAL, 1,
+                                                         sizeof (DashboardState));
+    if (!state)
+        return 0;
+
+    char* address = DS_GetAppliedRobotAddress();
+    state->socket = DS_SocketEmpty();
+    state->socket.type = DS_SOCKET_TCP;
+    state->socket.out_port = port > 0 ? port : DS_DASHBOARD_PORT;
+    DS_SocketChangeAddress (&state->socket, address);
+    DS_FREE (address);
+
+    DS_MutexLock (&ctx->mutex);
+    ctx->state = state;
+    ctx->notified = 0;
+    DS_AtomicStore (&ctx->running, 1);
+    DS_MutexUnlock (&ctx->mutex);
+
+    DS_SocketOpen (&state->socket);
+    return 1;
+}
+
+/**
+ * Disconnects from the dashboard server, the entries are discarded
+ */
+void DS_StopDashboard (void)
+{
+    DashboardContext* ctx = get_context();
+
+    if (!DS_AtomicLoad (&ctx->running))
+        return;
+
+    DS_MutexLock (&ctx->mutex);
+    DashboardState* state = ctx->state;
+    ctx->state = NULL;
+    DS_AtomicStore (&ctx->running, 0);
+    DS_MutexUnlock (&ctx->mutex);
+
+    if (state) {
+        DS_SocketClose (&state->socket);
+        DS_FREE (state);
+    }
+}
+
+/**
+ * Returns \c 1 if the dashboard client is running
+ */
+int DS_DashboardRunning (void)
+{
+    return DS_AtomicLoad (&get_context()->running) != 0;
+}
+
+/**
+ * Returns \c 1 if the dashboard client is connected to the server
+ */
+int DS_DashboardConnected (void)
+{
+    int connected = 0;
+    DashboardContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    if (ctx->state)
+        connected = ctx->state->connected;
+    DS_MutexUnlock (&ctx->mutex);
+
+    return connected;
+}
+
+/**
+ * Copies (up to \a max_entries) entries that changed after the given
+ * \a cursor to \a entries, in the order in which they changed. The
+ * \a cursor (initially \c 0) is advanced past the returned entries.
+ *
+ * Deleted entries are returned with the DS_DASHBOARD_DELETED type, so that
+ * the application can remove them.
+ *
+ * \returns the number of entries copied to \a entries
+ */
+int DS_DashboardRead (uint64_t* cursor, DS_DashboardEntry* entries,
+                      const int max_entries)
+{
+    assert (cursor);
+    assert (entries);
+
+    int i, j;
+    int count = 0;
+    Entry* changed [DS_DASHBOARD_MAX_ENTRIES];
+    DashboardContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+
+    DashboardState* state = ctx->state;
+    if (state) {
+        /* Sort the entries that changed by their sequence number */
+        for (i = 0; i < state->count; ++i) {
+            Entry* entry = &state->entries [i];
+            if (entry->sequence <= *cursor)
+                continue;
+
+            for (j = count; j > 0 && changed [j - 1]->sequence > entry->sequence; --j)
+                changed [j] = changed [j - 1];
+
+            changed [j] = entry;
+            ++count;
+        }
+
+        count = DS_Min (count, max_entries);
+        for (i = 0; i < count; ++i) {
+            entries [i].sequence = changed [i]->sequence;
+            entries [i].type = changed [i]->type;
+            entries [i].number = changed [i]->number;
+            memcpy (entries [i].key, changed [i]->key, changed [i]->key_len);
+            entries [i].key [changed [i]->key_len] = '\0';
+            memcpy (entries [i].text, changed [i]->text, changed [i]->text_len);
+            entries [i].text [changed [i]->text_len] = '\0';
+            *cursor = changed [i]->sequence;
+        }
+    }
+
+    /* The application has seen the latest change */
+    if (*cursor >= ctx->sequence)
+        ctx->notified = 0;
+
+    DS_MutexUnlock (&ctx->mutex);
+
+    return count;
+}
+
+/**
+ * Sets the boolean \a value of the entry with the given \a key
+ *
+ * \returns \c 0 if the dashboard is not running or if the table is full
+ */
+int DS_DashboardSetBoolean (const char* key, const int value)
+{
+    return set_local (key, DS_DASHBOARD_BOOLEAN, value ? 1 : 0, "");
+}
+
+/**
+ * Sets the numeric \a value of the entry with the given \a key
+ *
+ * \returns \c 0 if the dashboard is not running or if the table is full
+ */
+int DS_DashboardSetNumber (const char* key, const double value)
+{
+    return set_local (key, DS_DASHBOARD_NUMBER, value, "");
+}
+
+/**
+ * Sets the string \a value of the entry with the given \a key
+ *
+ * \returns \c 0 if the dashboard is not running or if the table is full
+ */
+int DS_DashboardSetString (const char* key, const char* value)
+{
+    return set_local (key, DS_DASHBOARD_STRING, 0, value ? value : "");
+}
+
+/**
+ * Deletes the entry with the given \a key (on the server too)
+ *
+ * \returns \c 0 if the dashboard is not running
+ */
+int DS_DashboardDelete (const char* key)
+{
+    return set_local (key, DS_DASHBOARD_DELETED, 0, "");
+}
@@ -0,0 +1,809 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Utils.h"
+#include "DS_Evdev.h"
+#include "DS_Socket.h"
+#include "DS_Thread.h"
+#include "DS_Context.h"
+#include "DS_Joysticks.h"
+
+#include <string.h>
+
+#if defined __linux__
+
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/inotify.h>
+#include <linux/input.h>
+
+/*
+ * Directory with the device nodes
+ */
+#define INPUT_DIR "/dev/input"
+
+/*
+ * Number of events read from a device at once
+ */
+#define READ_EVENTS 64
+
+/*
+ * Number of hats defined by the kernel (ABS_HAT0X to ABS_HAT3Y)
+ */
+#define INPUT_HATS 4
+
+/*
+ * Stamps older than this (in microseconds) are not used for the delay, the
+ * device did not accept the monotonic clock
+ */
+#define MAX_DELAY 1000000
+
+/*
+ * Older kernel headers do not have the accessors of the event time
+ */
+#ifndef input_event_sec
+    #define input_event_sec  time.tv_sec
+    #define input_event_usec time.tv_usec
+#endif
+
+/*
+ * Capability bit arrays returned by the kernel
+ */
+#define LONG_BITS (sizeof (unsigned long) * 8)
+#define BIT_LONGS(bits) (((bits) + LONG_BITS - 1) / LONG_BITS)
+#define TEST_BIT(array,bit) ((array [(bit) / LONG_BITS] >> ((bit) % LONG_BITS)) & 1)
+
+/*
+ * An opened input device:
+ *
+ * - The codes of the kernel are mapped to the axes, hats and buttons of the
+ *   joystick (-1 if the code is not used)
+ * - The events of an input report change the state, which is written to the
+ *   joystick when the report ends (\c changed is set if there is something
+ *   to write)
+ * - \c stamp is the kernel time of the first event of the current report
+ * - \c dropped is set when the kernel lost events, the state is read again
+ *   from the device when the report ends
+ */
+typedef struct {
+    int fd;
+    int changed;
+    int dropped;
+    int num_axes;
+    int num_hats;
+    int num_buttons;
+    uint64_t stamp;
+    char node [32];
+    char name [DS_EVDEV_NAME_SIZE];
+    int8_t axis_of [ABS_CNT];
+    int8_t hat_of [INPUT_HATS];
+    int8_t button_of [KEY_CNT];
+    int32_t minimum [DS_MAX_JOYSTICK_AXES];
+    int32_t maximum [DS_MAX_JOYSTICK_AXES];
+    float axes [DS_MAX_JOYSTICK_AXES];
+    int hat_x [DS_MAX_JOYSTICK_HATS];
+    int hat_y [DS_MAX_JOYSTICK_HATS];
+    uint32_t buttons;
+} Device;
+
+/*
+ * Evdev state of a DS context:
+ *
+ * - The devices (and \c inotify_fd) are watched by the socket reactor, the
+ *   callbacks make the DS context of the backend current and hold the mutex
+ *   while they change the devices
+ * - The callbacks do nothing once \c running is cleared, so the devices can
+ *   be unwatched without holding the mutex (the reactor waits for a running
+ *   callback to return before a descriptor is unwatched)
+ */
+typedef struct {
+    int running;
+    int inotify_fd;
+    int count;
+    DS_Context* context;
+    Device* devices [DS_MAX_JOYSTICKS];
+    DS_EvdevStats stats;
+    uint64_t delay_sum;
+    uint64_t delay_samples;
+    DS_Mutex mutex;
+} EvdevContext;
+
+/**
+ * Initializes the evdev state of a new context
+ */
+static void init_context (void* data)
+{
+    EvdevContext* ctx = (EvdevContext*) data;
+    ctx->inotify_fd = -1;
+    DS_MutexInit (&ctx->mutex);
+}
+
+/**
+ * Releases the evdev state of a context
+ */
+static void destroy_context (void* data)
+{
+    EvdevContext* ctx = (EvdevContext*) data;
+    DS_MutexDestroy (&ctx->mutex);
+}
+
+/**
+ * Returns the evdev state of the current context
+ */
+static EvdevContext* get_context (void)
+{
+    return (EvdevContext*) DS_ContextData (DS_CONTEXT_EVDEV,
+                                           sizeof (EvdevContext),
+                                           init_context, destroy_context);
+}
+
+/**
+ * Returns the current time of the clock used for the event stamps
+ */
+static uint64_t monotonic_time (void)
+{
+    struct timespec now;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000 + (uint64_t) now.tv_nsec / 1000;
+}
+
+/**
+ * Converts the given axis value to the [-1, 1] range of the joysticks
+ */
+static float normalize (const int32_t value, const int32_t min, const int32_t max)
+{
+    float range;
+
+    if (max <= min)
+        return 0;
+
+    range = (float) ((int64_t) max - min);
+    range = 2 * (float) ((int64_t) value - min) / range - 1;
+    return DS_Max (-1.0f, DS_Min (range, 1.0f));
+}
+
+/**
+ * Returns the angle of the given hat position (-1 is up/left, 1 is
+ * down/right), or \c -1 if the hat is centered
+ */
+static int hat_angle (const int x, const int y)
+{
+    static const int angles [3][3] = {
+        { 315, 0, 45 },
+        { 270, -1, 90 },
+        { 225, 180, 135 },
+    };
+
+    return angles [DS_Max (-1, DS_Min (y, 1)) + 1][DS_Max (-1, DS_Min (x, 1)) + 1];
+}
+
+/**
+ * Returns \c 1 if the given device looks like a joystick or a gamepad
+ */
+static int is_joystick (const unsigned long* ev,
+                        const unsigned long* abs,
+                        const unsigned long* key)
+{
+    if (!TEST_BIT (ev, EV_ABS) || !TEST_BIT (ev, EV_KEY))
+        return 0;
+
+    if (!TEST_BIT (abs, ABS_X) || !TEST_BIT (abs, ABS_Y))
+        return 0;
+
+    return TEST_BIT (key, BTN_TRIGGER) ||
+           TEST_BIT (key, BTN_A) ||
+           TEST_BIT (key, BTN_1);
+}
+
+/**
+ * Changes the state of the axis (or hat) with the given code
+ */
+static void set_abs (Device* device, const int code, const int32_t value)
+{
+    int axis;
+    int hat;
+
+    if (code < 0 || code >= ABS_CNT)
+        return;
+
+    axis = device->axis_of [code];
+    if (axis >= 0) {
+        device->axes [axis] = normalize (value,
+                                         device->minimum [axis],
+                                         device->maximum [axis]);
+        device->changed = 1;
+    }
+
+    else if (code >= ABS_HAT0X && code <= ABS_HAT3Y) {
+        hat = device->hat_of [(code - ABS_HAT0X) / 2];
+        if (hat >= 0) {
+            if ((code - ABS_HAT0X) % 2 == 0)
+                device->hat_x [hat] = value;
+            else
+                device->hat_y [hat] = value;
+
+            device->changed = 1;
+        }
+    }
+}
+
+/**
+ * Reads the current state of the device, used when it is opened and after
+ * the kernel lost events
+ */
+static void sync_device (Device* device)
+{
+    int code;
+    struct input_absinfo info;
+    unsigned long keys [BIT_LONGS (KEY_CNT)];
+
+    memset (keys, 0, sizeof (keys));
+    if (ioctl (device->fd, EVIOCGKEY (sizeof (keys)), keys) >= 0) {
+        device->buttons = 0;
+        for (code = 0; code < KEY_CNT; ++code) {
+            if (device->button_of [code] >= 0 && TEST_BIT (keys, code))
+                device->buttons |= (uint32_t) 1 << device->button_of [code];
+        }
+    }
+
+    for (code = 0; code < ABS_CNT; ++code) {
+        if (ioctl (device->fd, EVIOCGABS (code), &info) >= 0)
+            set_abs (device, code, info.value);
+    }
+
+    device->changed = 1;
+}
+
+/**
+ * Writes the state of the device to the joystick in the given slot
+ */
+static void write_state (Device* device, const int slot)
+{
+    int i;
+    int hats [DS_MAX_JOYSTICK_HATS];
+
+    for (i = 0; i < device->num_hats; ++i)
+        hats [i] = hat_angle (device->hat_x [i], device->hat_y [i]);
+
+    DS_SetJoystickState (slot,
+                         device->axes, device->num_axes,
+                         device->buttons,
+                         hats, device->num_hats);
+
+    device->changed = 0;
+}
+
+/**
+ * Registers the joysticks of the devices again, used when a device is
+ * attached or removed
+ */
+static void register_joysticks (EvdevContext* ctx)
+{
+    int i;
+
+    DS_JoysticksReset();
+    for (i = 0; i < ctx->count; ++i)
+        DS_JoysticksAdd (ctx->devices [i]->num_axes,
+                         ctx->devices [i]->num_hats,
+                         ctx->devices [i]->num_buttons);
+
+    for (i = 0; i < ctx->count; ++i)
+        write_state (ctx->devices [i], i);
+}
+
+/**
+ * Writes the finished input report to the joystick and measures the time
+ * since the first event of the report
+ */
+static void end_report (EvdevContext* ctx, Device* device, const int slot)
+{
+    uint64_t now;
+    uint64_t delay;
+
+    if (device->dropped) {
+        device->dropped = 0;
+        ++ctx->stats.overflows;
+        sync_device (device);
+    }
+
+    if (device->changed) {
+        write_state (device, slot);
+        ++ctx->stats.reports;
+
+        now = monotonic_time();
+        if (device->stamp > 0 && now >= device->stamp) {
+            delay = now - device->stamp;
+            if (delay < MAX_DELAY) {
+                ctx->delay_sum += delay;
+                ++ctx->delay_samples;
+                ctx->stats.delay_max_us = DS_Max (ctx->stats.delay_max_us, delay);
+            }
+        }
+    }
+
+    device->stamp = 0;
+}
+
+/**
+ * Applies the given event to the device state
+ */
+static void handle_event (EvdevContext* ctx,
+                          Device* device,
+                          const int slot,
+                          const struct input_event* event)
+{
+    int button;
+
+    if (event->type == EV_SYN) {
+        if (event->code == SYN_DROPPED)
+            device->dropped = 1;
+        else if (event->code == SYN_REPORT)
+            end_report (ctx, device, slot);
+
+        return;
+    }
+
+    /* The state is read again when the report ends */
+    if (device->dropped)
+        return;
+
+    if (event->type == EV_KEY && event->code < KEY_CNT) {
+        button = device->button_of [event->code];
+        if (button < 0)
+            return;
+
+        if (event->value)
+            device->buttons |= (uint32_t) 1 << button;
+        else
+            device->buttons &= ~((uint32_t) 1 << button);
+
+        device->changed = 1;
+    }
+
+    else if (event->type == EV_ABS)
+        set_abs (device, event->code, event->value);
+
+    if (device->changed && device->stamp == 0)
+        device->stamp = (uint64_t) event->input_event_sec * 1000000 +
+                        (uint64_t) event->input_event_usec;
+}
+
+/**
+ * Reads the pending events of the device in the given slot, returns \c 0
+ * if the device was removed
+ */
+static int read_device (EvdevContext* ctx, const int slot)
+{
+    int i;
+    int count;
+    ssize_t len;
+    Device* device = ctx->devices [slot];
+    struct input_event events [READ_EVENTS];
+
+    do {
+        len = read (device->fd, events, sizeof (events));
+        if (len < 0)
+            return errno == EAGAIN || errno == EINTR;
+
+        count = (int) (len / (ssize_t) sizeof (struct input_event));
+        for (i = 0; i < count; ++i)
+            handle_event (ctx, device, slot, &events [i]);
+    } while (count == READ_EVENTS);
+
+    return 1;
+}
+
+/**
+ * Stops reading the device in the given slot and closes it
+ */
+static void remove_device (EvdevContext* ctx, const int slot)
+{
+    Device* device = ctx->devices [slot];
+
+    DS_SocketUnwatch (device->fd);
+    close (device->fd);
+    DS_FREE (device);
+
+    memmove (&ctx->devices [slot], &ctx->devices [slot + 1],
+             (size_t) (ctx->count - slot - 1) * sizeof (Device*));
+    --ctx->count;
+}
+
+/**
+ * Called by the reactor when a device has new events
+ */
+static void on_device_input (int fd, void* data)
+{
+    int slot;
+    EvdevContext* ctx;
+    DS_Context* previous = DS_ContextCurrent();
+
+    DS_ContextMakeCurrent ((DS_Context*) data);
+    ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    for (slot = 0; ctx->running && slot < ctx->count; ++slot) {
+        if (ctx->devices [slot]->fd != fd)
+            continue;
+
+        if (!read_device (ctx, slot)) {
+            remove_device (ctx, slot);
+            register_joysticks (ctx);
+        }
+
+        break;
+    }
+    DS_MutexUnlock (&ctx->mutex);
+
+    DS_ContextMakeCurrent (previous);
+}
+
+/**
+ * Opens the given device node if it is a joystick, returns \c 1 if the
+ * device was added
+ */
+static int add_device (EvdevContext* ctx, const char* node)
+{
+    int i;
+    int fd;
+    int code;
+    char path [64];
+    Device* device;
+    struct input_absinfo info;
+    int clock = CLOCK_MONOTONIC;
+    unsigned long ev [BIT_LONGS (EV_CNT)];
+    unsigned long abs [BIT_LONGS (ABS_CNT)];
+    unsigned long key [BIT_LONGS (KEY_CNT)];
+
+    if (strncmp (node, "event", 5) != 0 || ctx->count >= DS_MAX_JOYSTICKS)
+        return 0;
+
+    for (i = 0; i < ctx->count; ++i) {
+        if (strcmp (ctx->devices [i]->node, node) == 0)
+            return 0;
+    }
+
+    snprintf (path, sizeof (path), INPUT_DIR "/%s", node);
+    fd = open (path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        return 0;
+
+    memset (ev, 0, sizeof (ev));
+    memset (abs, 0, sizeof (abs));
+    memset (key, 0, sizeof (key));
+    if (ioctl (fd, EVIOCGBIT (0, sizeof (ev)), ev) < 0 ||
+        ioctl (fd, EVIOCGBIT (EV_ABS, sizeof (abs)), abs) < 0 ||
+        ioctl (fd, EVIOCGBIT (EV_KEY, sizeof (key)), key) < 0 ||
+        !is_joystick (ev, abs, key)) {
+        close (fd);
+        return 0;
+    }
+
+    device = (Device*) DS_CALLOC (DS_MEMORY_GENERAL, 1, sizeof (Device));
+    if (!device) {
+        close (fd);
+        return 0;
+    }
+
+    device->fd = fd;
+    snprintf (device->node, sizeof (device->node), "%s", node);
+    if (ioctl (fd, EVIOCGNAME (sizeof (device->name) - 1), device->name) < 0)
+        snprintf (device->name, sizeof (device->name), "%s", node);
+
+    /* Stamp the events with the clock used to measure the delay */
+    ioctl (fd, EVIOCSCLOCKID, &clock);
+
+    memset (device->axis_of, -1, sizeof (device->axis_of));
+    memset (device->hat_of, -1, sizeof (device->hat_of));
+    memset (device->button_of, -1, sizeof (device->button_of));
+
+    /* Joystick and gamepad buttons come first (like in SDL) */
+    for (code = BTN_JOYSTICK; code < KEY_CNT; ++code) {
+        if (TEST_BIT (key, code) && device->num_buttons < DS_MAX_JOYSTICK_BUTTONS)
+            device->button_of [code] = device->num_buttons++;
+    }
+    for (code = BTN_MISC; code < BTN_JOYSTICK; ++code) {
+        if (TEST_BIT (key, code) && device->num_buttons < DS_MAX_JOYSTICK_BUTTONS)
+            device->button_of [code] = device->num_buttons++;
+    }
+
+    /* Every absolute axis that is not a hat */
+    for (code = 0; code < ABS_MISC; ++code) {
+        if (!TEST_BIT (abs, code) || (code >= ABS_HAT0X && code <= ABS_HAT3Y))
+            continue;
+
+        if (device->num_axes >= DS_MAX_JOYSTICK_AXES ||
+            ioctl (fd, EVIOCGABS (code), &info) < 0)
+            continue;
+
+        device->minimum [device->num_axes] = info.minimum;
+        device->maximum [device->num_axes] = info.maximum;
+        device->axis_of [code] = device->num_axes++;
+    }
+
+    for (i = 0; i < INPUT_HATS && device->num_hats < DS_MAX_JOYSTICK_HATS; ++i) {
+        if (TEST_BIT (abs, ABS_HAT0X + 2 * i) || TEST_BIT (abs, ABS_HAT0Y + 2 * i))
+            device->hat_of [i] = device->num_hats++;
+    }
+
+    sync_device (device);
+
+    if (!DS_SocketWatch (fd, &on_device_input, ctx->context)) {
+        close (fd);
+        DS_FREE (device);
+        return 0;
+    }
+
+    ctx->devices [ctx->count++] = device;
+    return 1;
+}
+
+/**
+ * Called by the reactor when a node is created (or its permissions change)
+ * in the input directory
+ */
+static void on_hotplug (int fd, void* data)
+{
+    int added = 0;
+    ssize_t len;
+    const char* ptr;
+    EvdevContext* ctx;
+    const struct inotify_event* event;
+    DS_Context* previous = DS_ContextCurrent();
+    union {
+        struct inotify_event event;
+        char bytes [4096];
+    } buffer;
+
+    DS_ContextMakeCurrent ((DS_Context*) data);
+    ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    while ((len = read (fd, &buffer, sizeof (buffer))) > 0) {
+        for (ptr = buffer.bytes; ptr < buffer.bytes + len;
+             ptr += sizeof (struct inotify_event) + event->len) {
+            event = (const struct inotify_event*) ptr;
+            if (ctx->running && event->len > 0)
+                added |= add_device (ctx, event->name);
+        }
+    }
+
+    if (added)
+        register_joysticks (ctx);
+    DS_MutexUnlock (&ctx->mutex);
+
+    DS_ContextMakeCurrent (previous);
+}
+
+/**
+ * Stops the backend of the current context, called by \c DS_Close()
+ */
+void Evdev_Close (void)
+{
+    DS_EvdevStop();
+}
+
+/**
+ * Opens the joysticks of /dev/input and registers them with the current
+ * DS context, the devices are read by the socket reactor until
+ * \c DS_EvdevStop() is called.
+ *
+ * Returns \c 1 if the backend is running, \c 0 on error
+ */
+int DS_EvdevStart (void)
+{
+    int node;
+    int last = -1;
+    char name [32];
+    DIR* dir;
+    struct dirent* entry;
+    EvdevContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    if (ctx->running) {
+        DS_MutexUnlock (&ctx->mutex);
+        return 1;
+    }
+
+    dir = opendir (INPUT_DIR);
+    if (!dir) {
+        DS_MutexUnlock (&ctx->mutex);
+        return 0;
+    }
+
+    ctx->running = 1;
+    ctx->context = DS_ContextCurrent();
+
+    /* Hot-plug is not available if inotify fails */
+    ctx->inotify_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+    if (ctx->inotify_fd >= 0 &&
+        (inotify_add_watch (ctx->inotify_fd, INPUT_DIR, IN_CREATE | IN_ATTRIB) < 0 ||
+         !DS_SocketWatch (ctx->inotify_fd, &on_hotplug, ctx->context))) {
+        close (ctx->inotify_fd);
+        ctx->inotify_fd = -1;
+    }
+
+    /* Open the nodes in numeric order, so the joysticks keep their slots */
+    while ((entry = readdir (dir)) != NULL) {
+        if (sscanf (entry->d_name, "event%d", &node) == 1)
+            last = DS_Max (last, node);
+    }
+    closedir (dir);
+
+    for (node = 0; node <= last; ++node) {
+        snprintf (name, sizeof (name), "event%d", node);
+        add_device (ctx, name);
+    }
+
+    register_joysticks (ctx);
+    DS_MutexUnlock (&ctx->mutex);
+
+    return 1;
+}
+
+/**
+ * Stops reading the devices and removes their joysticks
+ */
+void DS_EvdevStop (void)
+{
+    int i;
+    int running;
+    EvdevContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    running = ctx->running;
+    ctx->running = 0;
+    DS_MutexUnlock (&ctx->mutex);
+
+    if (!running)
+        return;
+
+    /* The callbacks do nothing now, wait for them without the mutex */
+    if (ctx->inotify_fd >= 0)
+        DS_SocketUnwatch (ctx->inotify_fd);
+    for (i = 0; i < ctx->count; ++i)
+        DS_SocketUnwatch (ctx->devices [i]->fd);
+
+    DS_MutexLock (&ctx->mutex);
+    if (ctx->inotify_fd >= 0) {
+        close (ctx->inotify_fd);
+        ctx->inotify_fd = -1;
+    }
+
+    while (ctx->count > 0)
+        remove_device (ctx, ctx->count - 1);
+
+    DS_JoysticksReset();
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Returns \c 1 if the backend of the current context is running
+ */
+int DS_EvdevRunning (void)
+{
+    int running;
+    EvdevContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    running = ctx->running;
+    DS_MutexUnlock (&ctx->mutex);
+
+    return running;
+}
+
+/**
+ * Copies the name of the device of the given joystick to \a name, returns
+ * \c 0 if the joystick does not belong to the backend
+ */
+int DS_EvdevGetName (const int joystick, char* name, const size_t size)
+{
+    int found = 0;
+    EvdevContext* ctx = get_context();
+
+    if (!name || size == 0)
+        return 0;
+
+    DS_MutexLock (&ctx->mutex);
+    if (joystick >= 0 && joystick < ctx->count) {
+        snprintf (name, size, "%s", ctx->devices [joystick]->name);
+        found = 1;
+    }
+    DS_MutexUnlock (&ctx->mutex);
+
+    return found;
+}
+
+/**
+ * Copies the statistics of the backend to \a stats
+ */
+void DS_EvdevGetStats (DS_EvdevStats* stats)
+{
+    EvdevContext* ctx = get_context();
+
+    if (!stats)
+        return;
+
+    DS_MutexLock (&ctx->mutex);
+    *stats = ctx->stats;
+    stats->devices = ctx->count;
+    if (ctx->delay_samples > 0)
+        stats->delay_avg_us = ctx->delay_sum / ctx->delay_samples;
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Clears the statistics of the backend
+ */
+void DS_EvdevResetStats (void)
+{
+    EvdevContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    memset (&ctx->stats, 0, sizeof (ctx->stats));
+    ctx->delay_sum = 0;
+    ctx->delay_samples = 0;
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+#else
+
+void Evdev_Close (void) {}
+
+/**
+ * The backend is only available on Linux
+ */
+int DS_EvdevStart (void)
+{
+    return 0;
+}
+
+void DS_EvdevStop (void) {}
+
+int DS_EvdevRunning (void)
+{
+    return 0;
+}
+
+int DS_EvdevGetName (const int joystick, char* name, const size_t size)
+{
+    (void) joystick;
+    (void) name;
+    (void) size;
+    return 0;
+}
+
+void DS_EvdevGetStats (DS_EvdevStats* stats)
+{
+    if (stats)
+        memset (stats, 0, sizeof (DS_EvdevStats));
+}
+
+void DS_EvdevResetStats (void) {}
+
+#endif
@@ -21,59 +21,814 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
-#include "DS_Queue.h"
+#include "DS_Utils.h"
+#include "DS_Timer.h"
+#include "DS_Atomic.h"
 #include "DS_Events.h"
+#include "DS_Context.h"
+#include "DS_Thread.h"
+#include "DS_NetConsole.h"
 
 #include <string.h>
 #include <assert.h>
 #include <stdlib.h>
 
-static DS_Queue events;
+#if defined _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+/*
+ * A bounded multi-producer queue (based on Dmitry Vyukov's bounded MPMC
+ * queue). Each cell has a sequence number that tells producers and the
+ * consumer if the cell is free or holds an event, so no locks are needed.
+ * The time of the event is used to measure the lag of the consumer.
+ */
+typedef struct {
+    volatile size_t seq;
+    DS_Event event;
+} EventCell;
+
+/*
+ * A callback registered with \c DS_Subscribe(), free slots have an ID of 0
+ */
+typedef struct {
+    int id;
+    uint32_t mask;
+    void* data;
+    DS_EventCallback callback;
+    DS_EventDelivery delivery;
+} EventSubscriber;
+
+/*
+ * Event queue data of a context
+ */
+typedef struct {
+    /* The queue cells and positions */
+    EventCell cells [DS_EVENT_QUEUE_SIZE];
+    volatile size_t enqueue_pos;
+    volatile size_t dequeue_pos;
+
+    /* Latest value of each event type that did not fit in the queue */
+    volatile size_t coalesced_count;
+    int coalesced_pending [DS_EVENT_TYPE_COUNT];
+    DS_Event coalesced_events [DS_EVENT_TYPE_COUNT];
+    DS_Mutex coalesce_mutex;
+
+    /* NetConsole message of the last polled event, owned by the queue */
+    char* polled_message;
+
+    /* What to do when the queue is full */
+    DS_EventOverflowPolicy policy;
+
+    /* If set to 1, telemetry events are always coalesced */
+    int coalescing;
+
+    /* Subscribers, the masks of the polled, queued and immediate event types
+     * are read by the producers without locking */
+    int last_subscriber;
+    DS_Mutex subscribers_mutex;
+    EventSubscriber subscribers [DS_EVENT_SUBSCRIBERS];
+    volatile size_t poll_mask;
+    volatile size_t queued_mask;
+    volatile size_t immediate_mask;
+
+    /* Internal statistics, the lag is only written by the consumer */
+    volatile size_t queued;
+    volatile size_t dropped;
+    volatile size_t coalesced;
+    volatile size_t high_water;
+    volatile size_t contentions;
+    volatile uint64_t lag_max;
+    volatile uint64_t lag_total;
+    volatile uint64_t lag_count;
+
+    /* Waitable handle that is signaled while there are pending events */
+    volatile size_t signaled;
+#if defined _WIN32
+    HANDLE notifier;
+#else
+    int notifier_pipe [2];
+#endif
+} EventsContext;
+
+/**
+ * Sets the default values of the given event queue \a data
+ */
+static void init_context (void* data)
+{
+    size_t i;
+    EventsContext* ctx = (EventsContext*) data;
+
+    for (i = 0; i < DS_EVENT_QUEUE_SIZE; ++i)
+        ctx->cells [i].seq = i;
+
+    ctx->policy = DS_EVENTS_DROP_OLDEST;
+    ctx->poll_mask = DS_EVENT_MASK_ALL;
+    DS_MutexInit (&ctx->coalesce_mutex);
+    DS_MutexInit (&ctx->subscribers_mutex);
+
+#if !defined _WIN32
+    ctx->notifier_pipe [0] = -1;
+    ctx->notifier_pipe [1] = -1;
+#endif
+}
+
+/**
+ * Releases the resources of the given event queue \a data
+ */
+static void destroy_context (void* data)
+{
+    EventsContext* ctx = (EventsContext*) data;
+    DS_MutexDestroy (&ctx->coalesce_mutex);
+    DS_MutexDestroy (&ctx->subscribers_mutex);
+}
+
+/**
+ * Returns the event queue of the current context
+ */
+static EventsContext* get_context (void)
+{
+    return (EventsContext*) DS_ContextData (DS_CONTEXT_EVENTS,
+                                            sizeof (EventsContext),
+                                            &init_context,
+                                            &destroy_context);
+}
+
+/**
+ * Releases the data owned by the given \a event
+ */
+static void free_event (DS_Event* event)
+{
+    if (event->type == DS_NETCONSOLE_NEW_MESSAGE) {
+        DS_NetConsoleReleaseMessage (event->netconsole.message);
+        event->netconsole.message = NULL;
+    }
+}
+
+/**
+ * Releases the message of the last polled event
+ */
+static void release_polled_message (EventsContext* ctx)
+{
+    DS_NetConsoleReleaseMessage (ctx->polled_message);
+    ctx->polled_message = NULL;
+}
+
+/**
+ * Copies the given \a event into the queue
+ *
+ * \returns \c 1 on success, \c 0 if the queue is full
+ */
+static int enqueue (EventsContext* ctx, const DS_Event* event)
+{
+    EventCell* cell;
+    size_t pos = DS_AtomicLoad (&ctx->enqueue_pos);
+
+    /* Reserve a cell */
+    for (;;) {
+        cell = &ctx->cells [pos & (DS_EVENT_QUEUE_SIZE - 1)];
+        size_t seq = DS_AtomicLoad (&cell->seq);
+        intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+
+        if (diff == 0) {
+            if (DS_AtomicCAS (&ctx->enqueue_pos, pos, pos + 1))
+                break;
+        }
+
+        else if (diff < 0)
+            return 0;
+
+        pos = DS_AtomicLoad (&ctx->enqueue_pos);
+    }
+
+    /* Write the event and publish the cell */
+    cell->event = *event;
+    DS_AtomicStore (&cell->seq, pos + 1);
+
+    /* Update the high-water mark (the consumer may already be past us) */
+    size_t dequeued = DS_AtomicLoad (&ctx->dequeue_pos);
+    if (pos + 1 > dequeued)
+        DS_AtomicMax (&ctx->high_water, pos + 1 - dequeued);
+
+    return 1;
+}
+
+/**
+ * Moves the oldest event of the queue into the given \a event
+ *
+ * \returns \c 1 on success, \c 0 if the queue is empty
+ */
+static int dequeue (EventsContext* ctx, DS_Event* event)
+{
+    EventCell* cell;
+    size_t pos = DS_AtomicLoad (&ctx->dequeue_pos);
+
+    /* Claim the oldest cell */
+    for (;;) {
+        cell = &ctx->cells [pos & (DS_EVENT_QUEUE_SIZE - 1)];
+        size_t seq = DS_AtomicLoad (&cell->seq);
+        intptr_t diff = (intptr_t) seq - (intptr_t) (pos + 1);
+
+        if (diff == 0) {
+            if (DS_AtomicCAS (&ctx->dequeue_pos, pos, pos + 1))
+                break;
+        }
+
+        else if (diff < 0)
+            return 0;
+
+        pos = DS_AtomicLoad (&ctx->dequeue_pos);
+    }
+
+    /* Read the event and give the cell back to the producers */
+    *event = cell->event;
+    DS_AtomicStore (&cell->seq, pos + DS_EVENT_QUEUE_SIZE);
+    return 1;
+}
+
+/**
+ * Returns \c 1 if the given event \a type reports a telemetry value that is
+ * updated with (almost) every robot packet, only the latest value of these
+ * events is relevant to the application
+ */
+static int is_telemetry (const DS_EventType type)
+{
+    switch (type) {
+    case DS_ROBOT_VOLTAGE_CHANGED:
+    case DS_ROBOT_CAN_UTIL_CHANGED:
+    case DS_ROBOT_CPU_INFO_CHANGED:
+    case DS_ROBOT_RAM_INFO_CHANGED:
+    case DS_ROBOT_DISK_INFO_CHANGED:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Stores the given \a event as the latest value of its type, replacing any
+ * previous event of the same type that could not be queued
+ */
+static void coalesce (EventsContext* ctx, const DS_Event* event)
+{
+    DS_AtomicFetchAdd (&ctx->coalesced, 1);
+    DS_MutexLockCounted (&ctx->coalesce_mutex, &ctx->contentions);
+
+    if (!ctx->coalesced_pending [event->type]) {
+        ctx->coalesced_pending [event->type] = 1;
+        DS_AtomicFetchAdd (&ctx->coalesced_count, 1);
+    }
+
+    ctx->coalesced_events [event->type] = *event;
+    DS_MutexUnlock (&ctx->coalesce_mutex);
+}
+
+/**
+ * Removes the coalesced event of the given \a type (if any), this is done
+ * when a newer event of the same type is queued
+ */
+static void clear_coalesced (EventsContext* ctx, const DS_EventType type)
+{
+    DS_MutexLockCounted (&ctx->coalesce_mutex, &ctx->contentions);
+
+    if (ctx->coalesced_pending [type]) {
+        ctx->coalesced_pending [type] = 0;
+        DS_AtomicFetchAdd (&ctx->coalesced_count, (size_t) -1);
+    }
+
+    DS_MutexUnlock (&ctx->coalesce_mutex);
+}
+
+/**
+ * Moves the first coalesced event into the given \a event
+ *
+ * \returns \c 1 on success, \c 0 if there are no coalesced events
+ */
+static int take_coalesced (EventsContext* ctx, DS_Event* event)
+{
+    int i;
+    int found = 0;
+
+    DS_MutexLockCounted (&ctx->coalesce_mutex, &ctx->contentions);
+
+    for (i = 0; i < DS_EVENT_TYPE_COUNT && !found; ++i) {
+        if (ctx->coalesced_pending [i]) {
+            *event = ctx->coalesced_events [i];
+            ctx->coalesced_pending [i] = 0;
+            DS_AtomicFetchAdd (&ctx->coalesced_count, (size_t) -1);
+            found = 1;
+        }
+    }
+
+    DS_MutexUnlock (&ctx->coalesce_mutex);
+    return found;
+}
+
+/**
+ * Registers the time that an event created at the given \a time waited in
+ * the queue, this is only called by the consumer
+ */
+static void update_lag (EventsContext* ctx, const uint64_t time)
+{
+    uint64_t now = DS_GetTimeUs();
+    uint64_t lag = now > time ? now - time : 0;
+
+    if (lag > DS_AtomicLoad64 (&ctx->lag_max))
+        DS_AtomicStore64 (&ctx->lag_max, lag);
+
+    DS_AtomicAdd64 (&ctx->lag_total, lag);
+    DS_AtomicAdd64 (&ctx->lag_count, 1);
+}
+
+/**
+ * Updates the masks of the event types wanted by the queued and immediate
+ * subscribers, this is called with the subscribers mutex locked
+ */
+static void update_masks (EventsContext* ctx)
+{
+    int i;
+    size_t queued = 0;
+    size_t immediate = 0;
+
+    for (i = 0; i < DS_EVENT_SUBSCRIBERS; ++i) {
+        const EventSubscriber* subscriber = &ctx->subscribers [i];
+
+        if (!subscriber->id)
+            continue;
+
+        if (subscriber->delivery == DS_DELIVER_IMMEDIATE)
+            immediate |= subscriber->mask;
+        else
+            queued |= subscriber->mask;
+    }
+
+    DS_AtomicStore (&ctx->queued_mask, queued);
+    DS_AtomicStore (&ctx->immediate_mask, immediate);
+}
+
+/**
+ * Calls the subscribers with the given \a delivery that want the given
+ * \a event. The subscribers are copied before calling them, so that the
+ * callbacks can subscribe or unsubscribe without deadlocking.
+ */
+static void deliver (EventsContext* ctx,
+                     const DS_Event* event,
+                     const DS_EventDelivery delivery)
+{
+    int i;
+    int count = 0;
+    const uint32_t mask = DS_EVENT_MASK (event->type);
+    EventSubscriber targets [DS_EVENT_SUBSCRIBERS];
+
+    DS_MutexLockCounted (&ctx->subscribers_mutex, &ctx->contentions);
+    for (i = 0; i < DS_EVENT_SUBSCRIBERS; ++i) {
+        const EventSubscriber* subscriber = &ctx->subscribers [i];
+        if (subscriber->id && subscriber->delivery == delivery &&
+                (subscriber->mask & mask))
+            targets [count++] = *subscriber;
+    }
+    DS_MutexUnlock (&ctx->subscribers_mutex);
+
+    for (i = 0; i < count; ++i)
+        targets [i].callback (event, targets [i].data);
+}
 
 /**
- * Initializes the event queue with an initial support for 50 events
+ * Signals the event handle (only if it is not already signaled)
+ */
+static void signal_handle (EventsContext* ctx)
+{
+    if (!DS_AtomicCAS (&ctx->signaled, 0, 1))
+        return;
+
+#if defined _WIN32
+    if (ctx->notifier)
+        SetEvent (ctx->notifier);
+#else
+    if (ctx->notifier_pipe [1] >= 0) {
+        char byte = 0;
+        ssize_t ret = write (ctx->notifier_pipe [1], &byte, 1);
+        (void) ret;
+    }
+#endif
+}
+
+/**
+ * Clears the event handle once the queue is empty. If an event is added
+ * while we clear the handle, it is signaled again.
+ */
+static void clear_handle (EventsContext* ctx)
+{
+    if (!DS_AtomicCAS (&ctx->signaled, 1, 0))
+        return;
+
+#if defined _WIN32
+    if (ctx->notifier)
+        ResetEvent (ctx->notifier);
+#else
+    char buf [16];
+    if (ctx->notifier_pipe [0] >= 0)
+        while (read (ctx->notifier_pipe [0], buf, sizeof (buf)) > 0);
+#endif
+
+    /* An event could have been added before the handle was cleared */
+    size_t pos = DS_AtomicLoad (&ctx->dequeue_pos);
+    EventCell* cell = &ctx->cells [pos & (DS_EVENT_QUEUE_SIZE - 1)];
+    if (DS_AtomicLoad (&cell->seq) == pos + 1 ||
+        DS_AtomicLoad (&ctx->coalesced_count) > 0)
+        signal_handle (ctx);
+}
+
+/**
+ * Creates the waitable event handle
+ */
+static void create_handle (EventsContext* ctx)
+{
+    ctx->signaled = 0;
+
+#if defined _WIN32
+    ctx->notifier = CreateEvent (NULL, TRUE, FALSE, NULL);
+#else
+    if (pipe (ctx->notifier_pipe) == 0) {
+        fcntl (ctx->notifier_pipe [0], F_SETFL, O_NONBLOCK);
+        fcntl (ctx->notifier_pipe [1], F_SETFL, O_NONBLOCK);
+    }
+#endif
+}
+
+/**
+ * Destroys the waitable event handle
+ */
+static void destroy_handle (EventsContext* ctx)
+{
+#if defined _WIN32
+    if (ctx->notifier)
+        CloseHandle (ctx->notifier);
+
+    ctx->notifier = NULL;
+#else
+    if (ctx->notifier_pipe [0] >= 0)
+        close (ctx->notifier_pipe [0]);
+    if (ctx->notifier_pipe [1] >= 0)
+        close (ctx->notifier_pipe [1]);
+
+    ctx->notifier_pipe [0] = -1;
+    ctx->notifier_pipe [1] = -1;
+#endif
+}
+
+/**
+ * Initializes the event queue, which can hold up to
+ * \c DS_EVENT_QUEUE_SIZE events
  */
 void Events_Init (void)
 {
-    DS_QueueInit (&events, 50, sizeof (DS_Event));
+    size_t i;
+    EventsContext* ctx = get_context();
+
+    for (i = 0; i < DS_EVENT_QUEUE_SIZE; ++i)
+        ctx->cells [i].seq = i;
+
+    ctx->enqueue_pos = 0;
+    ctx->dequeue_pos = 0;
+    ctx->coalesced_count = 0;
+    memset (ctx->coalesced_pending, 0, sizeof (ctx->coalesced_pending));
+
+    create_handle (ctx);
 }
 
 /**
- * De-allocates the event queue (that's all)
+ * Discards all pending events
  */
 void Events_Close (void)
 {
-    DS_QueueFree (&events);
+    DS_Event event;
+    EventsContext* ctx = get_context();
+
+    while (DS_PollEvent (&event));
+    release_polled_message (ctx);
+
+    destroy_handle (ctx);
+}
+
+/**
+ * Clears the statistics of the event queue of the current context
+ */
+void Events_ResetStats (void)
+{
+    EventsContext* ctx = get_context();
+
+    DS_AtomicStore (&ctx->queued, 0);
+    DS_AtomicStore (&ctx->dropped, 0);
+    DS_AtomicStore (&ctx->coalesced, 0);
+    DS_AtomicStore (&ctx->high_water, 0);
+    DS_AtomicStore (&ctx->contentions, 0);
+    DS_AtomicStore64 (&ctx->lag_max, 0);
+    DS_AtomicStore64 (&ctx->lag_total, 0);
+    DS_AtomicStore64 (&ctx->lag_count, 0);
+}
+
+/**
+ * Writes the statistics of the event queue of the current context to the
+ * given \a stats structure
+ */
+void Events_GetStats (DS_EventQueueStats* stats)
+{
+    EventsContext* ctx = get_context();
+
+    assert (stats);
+
+    size_t enqueued = DS_AtomicLoad (&ctx->enqueue_pos);
+    size_t dequeued = DS_AtomicLoad (&ctx->dequeue_pos);
+    uint64_t count = DS_AtomicLoad64 (&ctx->lag_count);
+
+    stats->queue_size = DS_EVENT_QUEUE_SIZE;
+    stats->queue_depth = enqueued > dequeued ? enqueued - dequeued : 0;
+    stats->high_water = DS_AtomicLoad (&ctx->high_water);
+    stats->queued = DS_AtomicLoad (&ctx->queued);
+    stats->dropped = DS_AtomicLoad (&ctx->dropped);
+    stats->coalesced = DS_AtomicLoad (&ctx->coalesced);
+    stats->contentions = DS_AtomicLoad (&ctx->contentions);
+    stats->lag_max_us = DS_AtomicLoad64 (&ctx->lag_max);
+    stats->lag_avg_us = count ? DS_AtomicLoad64 (&ctx->lag_total) / count : 0;
+}
+
+/**
+ * Returns a handle that is signaled while there are pending events, so
+ * that the application can wait for events instead of polling for them:
+ *    - On Windows, this is a manual-reset event object
+ *    - On other platforms, this is the read end of a pipe, which becomes
+ *      readable when there are pending events
+ *
+ * The handle is cleared by \c DS_PollEvent() once the queue is empty, do
+ * not read from (or reset) the handle directly.
+ */
+DS_EventHandle DS_GetEventHandle (void)
+{
+    EventsContext* ctx = get_context();
+
+#if defined _WIN32
+    return (DS_EventHandle) ctx->notifier;
+#else
+    return ctx->notifier_pipe [0];
+#endif
+}
+
+/**
+ * Changes the behavior of the event queue when it is full (e.g. when the
+ * application does not poll the events fast enough):
+ *    - \c DS_EVENTS_DROP_OLDEST: the oldest event is discarded
+ *    - \c DS_EVENTS_COALESCE: only the latest event of each type is kept
+ *      until the application catches up (NetConsole messages cannot be
+ *      coalesced, so the oldest event is discarded instead)
+ */
+void DS_SetEventOverflowPolicy (const DS_EventOverflowPolicy overflow_policy)
+{
+    get_context()->policy = overflow_policy;
+}
+
+/**
+ * Enables or disables coalescing of telemetry events (voltage, CAN, CPU,
+ * RAM and disk usage). When enabled, only the latest event of each of these
+ * types is kept between two calls to \c DS_PollEvent(), so that the amount
+ * of events that the application must process does not depend on the
+ * number of received packets.
+ */
+void DS_SetEventCoalescing (const int enabled)
+{
+    get_context()->coalescing = (enabled != 0);
 }
 
 /**
- * Adds the given \a event to the event queue
+ * Selects the event types that are queued for \c DS_PollEvent() with the
+ * given \a mask (see \c DS_EVENT_MASK()), all the types are queued by
+ * default. The events that are not selected by the mask nor wanted by any
+ * subscriber are discarded when they are created, without being copied.
+ */
+void DS_SetEventMask (const uint32_t mask)
+{
+    DS_AtomicStore (&get_context()->poll_mask, mask);
+}
+
+/**
+ * Returns \c 1 if the events of the given \a type are polled or wanted by a
+ * subscriber. The modules use this to avoid building events (e.g. copying
+ * NetConsole messages) that would be discarded anyway.
+ */
+int DS_EventWanted (const DS_EventType type)
+{
+    EventsContext* ctx = get_context();
+    const size_t mask = DS_EVENT_MASK (type);
+
+    return ((DS_AtomicLoad (&ctx->poll_mask) |
+             DS_AtomicLoad (&ctx->queued_mask) |
+             DS_AtomicLoad (&ctx->immediate_mask)) & mask) != 0;
+}
+
+/**
+ * Registers the given \a callback for the event types selected by the given
+ * \a mask (see \c DS_EVENT_MASK()), the \a data is given to the callback.
+ * The \a delivery of the events can be:
+ *    - \c DS_DELIVER_QUEUED: the events are queued and the callback is
+ *      called by \c DS_DispatchEvents(), in the thread of the application
+ *    - \c DS_DELIVER_IMMEDIATE: the callback is called by the thread that
+ *      creates the event (e.g. the socket thread, right after a packet is
+ *      read), for latency-critical consumers. The callback must return
+ *      quickly and must not call \c DS_PollEvent()
+ *
+ * Applications that only use subscriptions should call
+ * \c DS_SetEventMask() with a mask of \c 0, so that the events that no
+ * subscriber wants are not queued.
+ *
+ * \returns the ID of the subscription, or \c 0 if the subscription table
+ *          is full (see \c DS_EVENT_SUBSCRIBERS)
+ */
+int DS_Subscribe (const uint32_t mask,
+                  DS_EventCallback callback,
+                  void* data,
+                  const DS_EventDelivery delivery)
+{
+    int i;
+    int id = 0;
+    EventsContext* ctx = get_context();
+
+    assert (callback);
+
+    DS_MutexLock (&ctx->subscribers_mutex);
+    for (i = 0; i < DS_EVENT_SUBSCRIBERS; ++i) {
+        EventSubscriber* subscriber = &ctx->subscribers [i];
+        if (subscriber->id)
+            continue;
+
+        /* IDs are never re-used (unless they wrap around) */
+        if (++ctx->last_subscriber <= 0)
+            ctx->last_subscriber = 1;
+
+        id = ctx->last_subscriber;
+        subscriber->id = id;
+        subscriber->mask = mask;
+        subscriber->data = data;
+        subscriber->callback = callback;
+        subscriber->delivery = delivery;
+
+        update_masks (ctx);
+        break;
+    }
+    DS_MutexUnlock (&ctx->subscribers_mutex);
+
+    return id;
+}
+
+/**
+ * Removes the given \a subscription (obtained with \c DS_Subscribe()).
+ * Immediate callbacks may still be running in other threads when this
+ * function returns.
+ */
+void DS_Unsubscribe (const int subscription)
+{
+    int i;
+    EventsContext* ctx = get_context();
+
+    if (subscription <= 0)
+        return;
+
+    DS_MutexLock (&ctx->subscribers_mutex);
+    for (i = 0; i < DS_EVENT_SUBSCRIBERS; ++i) {
+        if (ctx->subscribers [i].id == subscription) {
+            ctx->subscribers [i].id = 0;
+            update_masks (ctx);
+            break;
+        }
+    }
+    DS_MutexUnlock (&ctx->subscribers_mutex);
+}
+
+/**
+ * Polls the pending events and calls the queued subscribers that want
+ * them (see \c DS_Subscribe()), the events that no queued subscriber
+ * wants are discarded. Use either this function or \c DS_PollEvent(),
+ * not both.
+ *
+ * \returns the number of events that were polled
+ */
+int DS_DispatchEvents (void)
+{
+    int count = 0;
+    DS_Event event;
+    EventsContext* ctx = get_context();
+
+    while (DS_PollEvent (&event)) {
+        if (DS_AtomicLoad (&ctx->queued_mask) & DS_EVENT_MASK (event.type))
+            deliver (ctx, &event, DS_DELIVER_QUEUED);
+
+        ++count;
+    }
+
+    return count;
+}
+
+/**
+ * Adds the given \a event to the event queue. This function can be called
+ * from any thread and does not allocate memory.
+ *
+ * The time of the \a event is set to the current time of the monotonic
+ * clock, so it tells when the event was created. Immediate subscribers
+ * (see \c DS_Subscribe()) are called before the event is queued, and the
+ * event is only queued if it is polled or wanted by a queued subscriber.
  *
  * \param event the event to register in the event queue
  */
 void DS_AddEvent (DS_Event* event)
 {
+    EventsContext* ctx = get_context();
+
     assert (event);
-    DS_QueuePush (&events, (void*) event);
+    assert (event->type < DS_EVENT_TYPE_COUNT);
+
+    const size_t mask = DS_EVENT_MASK (event->type);
+    event->header.time = DS_GetTimeUs();
+
+    /* Latency-critical subscribers get the event in this thread */
+    if (DS_AtomicLoad (&ctx->immediate_mask) & mask)
+        deliver (ctx, event, DS_DELIVER_IMMEDIATE);
+
+    /* Nobody polls or dispatches this event type, discard it */
+    if (!((DS_AtomicLoad (&ctx->poll_mask) |
+           DS_AtomicLoad (&ctx->queued_mask)) & mask)) {
+        free_event (event);
+        return;
+    }
+
+    /* Only keep the latest value of telemetry, new-lines and dashboard events */
+    if ((ctx->coalescing && is_telemetry (event->type)) ||
+            event->type == DS_NETCONSOLE_NEW_LINES ||
+            event->type == DS_DASHBOARD_CHANGED) {
+        coalesce (ctx, event);
+        signal_handle (ctx);
+        return;
+    }
+
+    /* This event is newer than any coalesced event of the same type */
+    if (DS_AtomicLoad (&ctx->coalesced_count) > 0)
+        clear_coalesced (ctx, event->type);
+
+    /* Queue is full, apply the overflow policy */
+    while (!enqueue (ctx, event)) {
+        if (ctx->policy == DS_EVENTS_COALESCE &&
+            event->type != DS_NETCONSOLE_NEW_MESSAGE) {
+            coalesce (ctx, event);
+            signal_handle (ctx);
+            return;
+        }
+
+        DS_Event oldest;
+        if (dequeue (ctx, &oldest)) {
+            free_event (&oldest);
+            DS_AtomicFetchAdd (&ctx->dropped, 1);
+        }
+    }
+
+    DS_AtomicFetchAdd (&ctx->queued, 1);
+    signal_handle (ctx);
 }
 
 /**
  * Polls for currently pending events and copies the first event in the queue
  * to the given \a event object.
  *
+ * The NetConsole message of the obtained event belongs to the event queue
+ * and is only valid until the next call to this function, copy it if you
+ * need to keep it.
+ *
  * \returns 1 if there are any pending events, or 0 if there are none available.
  *
  * \param event we write the obtained event data here
  */
 int DS_PollEvent (DS_Event* event)
 {
-    DS_Event* front = (DS_Event*) DS_QueueGetFirst (&events);
+    EventsContext* ctx = get_context();
+
+    assert (event);
+
+    /* Release the message of the previous event */
+    release_polled_message (ctx);
+
+    if (dequeue (ctx, event)) {
+        if (event->type == DS_NETCONSOLE_NEW_MESSAGE)
+            ctx->polled_message = event->netconsole.message;
+
+        update_lag (ctx, event->header.time);
 
-    if (front) {
-        DS_QueuePop (&events);
-        memcpy (event, front, sizeof (DS_Event));
         return 1;
     }
 
+    if (DS_AtomicLoad (&ctx->coalesced_count) > 0 &&
+            take_coalesced (ctx, event))
+        return 1;
+
+    clear_handle (ctx);
     return 0;
 }
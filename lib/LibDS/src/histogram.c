@@ -0,0 +1,161 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Histogram.h"
+
+#include <string.h>
+#include <assert.h>
+
+/**
+ * Returns the position of the most significant bit of the given \a value
+ */
+static int msb (uint32_t value)
+{
+    int bit = 0;
+
+    while (value >>= 1)
+        ++bit;
+
+    return bit;
+}
+
+/**
+ * Returns the bucket in which the given \a value is counted.
+ *
+ * Values below \c DS_HISTOGRAM_SUB_BUCKETS have their own bucket, larger
+ * values are grouped by their most significant bit and then split in
+ * \c DS_HISTOGRAM_SUB_BUCKETS linear sub-buckets.
+ */
+static int bucket_index (const uint32_t value)
+{
+    if (value < DS_HISTOGRAM_SUB_BUCKETS)
+        return (int) value;
+
+    int shift = msb (value) - 4;
+    int sub = (int) (value >> shift) - DS_HISTOGRAM_SUB_BUCKETS;
+    return DS_HISTOGRAM_SUB_BUCKETS * (shift + 1) + sub;
+}
+
+/**
+ * Returns the highest value that is counted in the given \a bucket
+ */
+static uint32_t bucket_value (const int bucket)
+{
+    if (bucket < DS_HISTOGRAM_SUB_BUCKETS)
+        return (uint32_t) bucket;
+
+    int shift = bucket / DS_HISTOGRAM_SUB_BUCKETS - 1;
+    int sub = bucket % DS_HISTOGRAM_SUB_BUCKETS;
+    uint64_t lower = (uint64_t) (DS_HISTOGRAM_SUB_BUCKETS + sub) << shift;
+    uint64_t upper = lower + ((uint64_t) 1 << shift) - 1;
+
+    return upper > UINT32_MAX ? UINT32_MAX : (uint32_t) upper;
+}
+
+/**
+ * Clears all the values recorded in the given \a histogram
+ */
+void DS_HistogramReset (DS_Histogram* histogram)
+{
+    assert (histogram);
+    memset (histogram, 0, sizeof (DS_Histogram));
+}
+
+/**
+ * Records the given \a value in the \a histogram
+ */
+void DS_HistogramRecord (DS_Histogram* histogram, const uint32_t value)
+{
+    assert (histogram);
+
+    ++histogram->counts [bucket_index (value)];
+    ++histogram->total;
+    histogram->sum += value;
+
+    if (value > histogram->max)
+        histogram->max = value;
+}
+
+/**
+ * Returns the value below which the given \a percentile (from \c 0 to
+ * \c 100) of the recorded values fall. The result is accurate to the
+ * resolution of the histogram buckets and never exceeds the largest
+ * recorded value.
+ *
+ * If the histogram is empty, this function returns \c 0
+ */
+uint32_t DS_HistogramPercentile (const DS_Histogram* histogram,
+                                 const double percentile)
+{
+    int i;
+    uint32_t count = 0;
+
+    /* Check arguments */
+    assert (histogram);
+
+    /* Histogram is empty */
+    if (histogram->total == 0)
+        return 0;
+
+    /* Get the number of values that must be below the percentile */
+    double target = (percentile / 100) * histogram->total;
+    if (target < 1)
+        target = 1;
+
+    /* Find the bucket that contains the target value */
+    for (i = 0; i < DS_HISTOGRAM_SIZE; ++i) {
+        count += histogram->counts [i];
+
+        if (count >= target) {
+            uint32_t value = bucket_value (i);
+            return value < histogram->max ? value : histogram->max;
+        }
+    }
+
+    return histogram->max;
+}
+
+/**
+ * Returns the number of recorded values that are lower than or equal to the
+ * given \a value. Values that share a bucket with \a value are counted, so
+ * the result is accurate to the resolution of the histogram buckets.
+ */
+uint32_t DS_HistogramCountBelow (const DS_Histogram* histogram,
+                                 const uint32_t value)
+{
+    int i;
+    uint32_t count = 0;
+    int last = bucket_index (value);
+
+    /* Check arguments */
+    assert (histogram);
+
+    /* All values are below */
+    if (value >= histogram->max)
+        return histogram->total;
+
+    for (i = 0; i <= last; ++i)
+        count += histogram->counts [i];
+
+    return count;
+}
@@ -0,0 +1,326 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Timer.h"
+#include "DS_Utils.h"
+#include "DS_Context.h"
+#include "DS_History.h"
+#include "DS_Thread.h"
+
+#include <string.h>
+#include <assert.h>
+
+/*
+ * Encoding of the history, each entry starts with a byte:
+ *   - 0 to 100 is a sample, which covers one tick
+ *   - 101 to 254 is a gap (e.g. while the robot is disconnected) of up to
+ *     154 ticks without samples
+ *   - 255 is a long gap, its length (in ticks) is stored in the next four
+ *     bytes (least significant byte first)
+ */
+#define MAX_SAMPLE    100
+#define LONG_GAP      255
+#define MAX_SHORT_GAP (LONG_GAP - 1 - MAX_SAMPLE)
+
+/*
+ * History of a metric, stored in a ring buffer of entries. The time of
+ * each entry is the sum of the ticks covered by the previous entries.
+ */
+typedef struct {
+    uint8_t data [DS_HISTORY_SIZE];
+    int first;           /**< Position of the oldest byte */
+    int count;           /**< Number of bytes used */
+    uint64_t first_tick; /**< Tick of the oldest entry */
+    uint64_t end_tick;   /**< Tick that follows the newest entry */
+} MetricHistory;
+
+/*
+ * Metric history of a DS context. The samples are added by the event loop
+ * (through the config module) and read by the application, the mutex
+ * protects the whole structure.
+ */
+typedef struct {
+    MetricHistory metrics [DS_HISTORY_METRIC_COUNT];
+    DS_Mutex mutex;
+} HistoryContext;
+
+/**
+ * Initializes the metric history of a new DS context
+ */
+static void init_context (void* data)
+{
+    HistoryContext* ctx = (HistoryContext*) data;
+    DS_MutexInit (&ctx->mutex);
+}
+
+/**
+ * Releases the metric history of a DS context
+ */
+static void destroy_context (void* data)
+{
+    HistoryContext* ctx = (HistoryContext*) data;
+    DS_MutexDestroy (&ctx->mutex);
+}
+
+/**
+ * Returns the metric history of the current DS context
+ */
+static HistoryContext* get_context (void)
+{
+    return (HistoryContext*) DS_ContextData (DS_CONTEXT_HISTORY,
+                                             sizeof (HistoryContext),
+                                             init_context, destroy_context);
+}
+
+/**
+ * Returns the byte at the given \a offset from the oldest byte of the history
+ */
+static uint8_t byte_at (const MetricHistory* history, const int offset)
+{
+    return history->data [(history->first + offset) % DS_HISTORY_SIZE];
+}
+
+/**
+ * Reads the entry at the given \a offset of the history
+ *
+ * \returns the number of bytes of the entry, the ticks covered by the entry
+ *          are written to \a ticks
+ */
+static int read_entry (const MetricHistory* history, const int offset,
+                       uint32_t* ticks)
+{
+    uint8_t code = byte_at (history, offset);
+
+    if (code <= MAX_SAMPLE) {
+        *ticks = 1;
+        return 1;
+    }
+
+    if (code != LONG_GAP) {
+        *ticks = code - MAX_SAMPLE;
+        return 1;
+    }
+
+    *ticks = (uint32_t) byte_at (history, offset + 1) |
+             (uint32_t) byte_at (history, offset + 2) << 8 |
+             (uint32_t) byte_at (history, offset + 3) << 16 |
+             (uint32_t) byte_at (history, offset + 4) << 24;
+    return 5;
+}
+
+/**
+ * Removes the oldest entry of the history, and the gaps that follow it
+ * (so that the history always starts with a sample)
+ */
+static void drop_oldest (MetricHistory* history)
+{
+    uint32_t ticks = 0;
+    int size = 0;
+
+    do {
+        size = read_entry (history, 0, &ticks);
+        history->first = (history->first + size) % DS_HISTORY_SIZE;
+        history->count -= size;
+        history->first_tick += ticks;
+    } while (history->count > 0 && byte_at (history, 0) > MAX_SAMPLE);
+}
+
+/**
+ * Appends the given \a bytes (an entry that covers the given number of
+ * \a ticks) to the history, the oldest entries are removed if needed
+ */
+static void push_entry (MetricHistory* history, const uint8_t* bytes,
+                        const int size, const uint32_t ticks)
+{
+    int i;
+
+    while (history->count + size > DS_HISTORY_SIZE)
+        drop_oldest (history);
+
+    for (i = 0; i < size; ++i) {
+        int pos = (history->first + history->count + i) % DS_HISTORY_SIZE;
+        history->data [pos] = bytes [i];
+    }
+
+    history->count += size;
+    history->end_tick += ticks;
+}
+
+/**
+ * Appends the entries of a gap with the given number of \a ticks
+ */
+static void push_gap (MetricHistory* history, uint64_t ticks)
+{
+    uint8_t bytes [5];
+
+    while (ticks > MAX_SHORT_GAP) {
+        uint32_t length = (uint32_t) DS_Min (ticks, (uint64_t) UINT32_MAX);
+
+        bytes [0] = LONG_GAP;
+        bytes [1] = (uint8_t) length;
+        bytes [2] = (uint8_t) (length >> 8);
+        bytes [3] = (uint8_t) (length >> 16);
+        bytes [4] = (uint8_t) (length >> 24);
+        push_entry (history, bytes, 5, length);
+
+        ticks -= length;
+    }
+
+    if (ticks > 0) {
+        bytes [0] = (uint8_t) (MAX_SAMPLE + ticks);
+        push_entry (history, bytes, 1, (uint32_t) ticks);
+    }
+}
+
+/**
+ * Adds a sample (from 0 to 100) of the given \a metric to the history.
+ *
+ * Only one sample is stored per tick: if several samples are added during
+ * the same tick, the highest one is kept (so that short peaks are visible).
+ */
+void History_AddSample (const DS_HistoryMetric metric, const int percent)
+{
+    HistoryContext* ctx = get_context();
+    MetricHistory* history;
+    uint64_t tick = DS_GetTimeMs() / DS_HISTORY_TICK;
+    uint8_t value = (uint8_t) DS_Max (DS_Min (percent, MAX_SAMPLE), 0);
+
+    /* Check arguments */
+    assert (metric >= 0 && metric < DS_HISTORY_METRIC_COUNT);
+
+    DS_MutexLock (&ctx->mutex);
+    history = &ctx->metrics [metric];
+
+    /* First sample */
+    if (history->count == 0) {
+        history->first_tick = tick;
+        history->end_tick = tick;
+    }
+
+    /* Keep the peak of the current tick */
+    else if (tick < history->end_tick) {
+        int last = history->count - 1;
+        uint8_t* byte = &history->data [(history->first + last) % DS_HISTORY_SIZE];
+
+        if (tick + 1 == history->end_tick && *byte <= MAX_SAMPLE)
+            *byte = DS_Max (*byte, value);
+
+        DS_MutexUnlock (&ctx->mutex);
+        return;
+    }
+
+    /* Record the time without samples, then the sample */
+    push_gap (history, tick - history->end_tick);
+    push_entry (history, &value, 1, 1);
+
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Removes all the samples of the metric history
+ */
+void DS_ClearHistory (void)
+{
+    int i;
+    HistoryContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    for (i = 0; i < DS_HISTORY_METRIC_COUNT; ++i)
+        ctx->metrics [i].count = 0;
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Obtains the time (in msecs) of the \a first and \a last samples of the
+ * history of the given \a metric
+ *
+ * \returns \c 1 if the history has samples, \c 0 if it is empty
+ */
+int DS_GetHistoryRange (const DS_HistoryMetric metric,
+                        uint64_t* first, uint64_t* last)
+{
+    int found = 0;
+    HistoryContext* ctx = get_context();
+
+    /* Check arguments */
+    assert (first);
+    assert (last);
+    assert (metric >= 0 && metric < DS_HISTORY_METRIC_COUNT);
+
+    DS_MutexLock (&ctx->mutex);
+    if (ctx->metrics [metric].count > 0) {
+        found = 1;
+        *first = ctx->metrics [metric].first_tick * DS_HISTORY_TICK;
+        *last = (ctx->metrics [metric].end_tick - 1) * DS_HISTORY_TICK;
+    }
+    DS_MutexUnlock (&ctx->mutex);
+
+    return found;
+}
+
+/**
+ * Copies the samples of the given \a metric that were taken between the
+ * given times (in msecs, both included) to the \a samples array, oldest
+ * sample first.
+ *
+ * \returns the number of samples copied (up to \a max)
+ */
+int DS_GetHistory (const DS_HistoryMetric metric,
+                   const uint64_t from, const uint64_t to,
+                   DS_HistorySample* samples, const int max)
+{
+    int offset = 0;
+    int copied = 0;
+    uint32_t ticks = 0;
+    uint64_t tick = 0;
+    MetricHistory* history;
+    HistoryContext* ctx = get_context();
+
+    /* Check arguments */
+    assert (samples || max <= 0);
+    assert (metric >= 0 && metric < DS_HISTORY_METRIC_COUNT);
+
+    DS_MutexLock (&ctx->mutex);
+    history = &ctx->metrics [metric];
+    tick = history->first_tick;
+
+    while (offset < history->count && copied < max) {
+        uint8_t code = byte_at (history, offset);
+        uint64_t time = tick * DS_HISTORY_TICK;
+
+        if (time > to)
+            break;
+
+        if (code <= MAX_SAMPLE && time >= from) {
+            samples [copied].time = time;
+            samples [copied].value = code;
+            ++copied;
+        }
+
+        offset += read_entry (history, offset, &ticks);
+        tick += ticks;
+    }
+    DS_MutexUnlock (&ctx->mutex);
+
+    return copied;
+}
@@ -23,23 +23,62 @@
 
 #include "LibDS.h"
 #include "DS_Config.h"
+#include "DS_Context.h"
+#include "DS_Thread.h"
 
-static int init = 0;
+/*
+ * Initialized state of a context
+ */
+typedef struct {
+    int init;
+} InitContext;
+
+/*
+ * The timer and socket threads are shared by all the contexts, they are
+ * started by the first initialized context and stopped by the last one
+ */
+static int shared_users = 0;
+static DS_Mutex shared_mutex = DS_MUTEX_INITIALIZER;
+
+/**
+ * Returns the initialized state of the current context
+ */
+static InitContext* get_context (void)
+{
+    return (InitContext*) DS_ContextData (DS_CONTEXT_INIT,
+                                          sizeof (InitContext),
+                                          NULL, NULL);
+}
 
 /**
  * Initializes all the modules of the LibDS library, you should call this
  * function before your application begins interacting with the different
  * modules of the LibDS.
+ *
+ * Only the current context (see \c DS_ContextMakeCurrent()) is initialized,
+ * every context must be initialized (and closed) separately.
  */
 void DS_Init (void)
 {
+    int first;
+
     if (!DS_Initialized()) {
-        init = 1;
+        get_context()->init = 1;
+
+        DS_MutexLock (&shared_mutex);
+        first = (shared_users++ == 0);
+        DS_MutexUnlock (&shared_mutex);
+
+        if (first)
+            Timers_Init();
 
-        Timers_Init();
         Client_Init();
         Events_Init();
-        Sockets_Init();
+        NetConsole_Init();
+
+        if (first)
+            Sockets_Init();
+
         Joysticks_Init();
         Protocols_Init();
     }
@@ -53,25 +92,50 @@ void DS_Init (void)
  */
 void DS_Close (void)
 {
+    int last;
+
     if (DS_Initialized()) {
-        init = 0;
+        get_context()->init = 0;
+
+        /* Stop the metrics server, the dashboard and the input devices
+         * before the sockets module is closed */
+        Metrics_Close();
+        Dashboard_Close();
+        Evdev_Close();
+        Timers_CancelSchedules();
+
+        DS_MutexLock (&shared_mutex);
+        last = (--shared_users == 0);
+        DS_MutexUnlock (&shared_mutex);
+
+        if (last) {
+            Timers_Close();
+            Sockets_Close();
+        }
 
-        Timers_Close();
-        Sockets_Close();
         Protocols_Close();
+        Capture_Close();
+        Macro_Close();
+        Telemetry_Close();
         Joysticks_Close();
 
         Events_Close();
+        NetConsole_Close();
         Client_Close();
+
+#if defined DS_TRACK_MEMORY
+        if (last)
+            DS_PrintMemoryStats();
+#endif
     }
 }
 
 /**
- * Returns \c 1 if the DS is initialized, \c 0 if not
+ * Returns \c 1 if the current context is initialized, \c 0 if not
  */
 int DS_Initialized (void)
 {
-    return init;
+    return get_context()->init;
 }
 
 /**
@@ -21,29 +21,162 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
-#include "DS_Array.h"
+#include "DS_Utils.h"
+#include "DS_Timer.h"
+#include "DS_Atomic.h"
 #include "DS_Config.h"
+#include "DS_Context.h"
 #include "DS_Events.h"
+#include "DS_Protocol.h"
 #include "DS_Joysticks.h"
+#include "DS_Macro.h"
+#include "DS_Thread.h"
 
+#include <math.h>
 #include <stdio.h>
+#include <assert.h>
+#include <string.h>
 
 /**
- * Represents a joystick and its information
+ * Holds the state of all joysticks in a single, fixed-size block of memory.
+ * Each member is stored as its own array (indexed by joystick), so that
+ * reading a value does not require chasing any pointers.
  */
-typedef struct _joystick {
-    int* hats;       /**< An array with the hat angles */
-    float* axes;    /**< An array with the axis values */
-    int* buttons;    /**< An array with the button states */
-    int num_axes;    /**< The number of axes of the joystick */
-    int num_hats;    /**< The number of hats of the joystick */
-    int num_buttons; /**< The number of buttons of the joystick */
-} DS_Joystick;
+typedef struct _joystick_buffer {
+    int count;                                                 /**< Number of joysticks */
+    unsigned int layout_version;                               /**< Version of the joystick layouts */
+    uint8_t num_axes [DS_MAX_JOYSTICKS];                       /**< Axis count of each joystick */
+    uint8_t num_hats [DS_MAX_JOYSTICKS];                       /**< Hat count of each joystick */
+    uint8_t num_buttons [DS_MAX_JOYSTICKS];                    /**< Button count of each joystick */
+    uint32_t buttons [DS_MAX_JOYSTICKS];                       /**< Button states as bit flags */
+    int16_t hats [DS_MAX_JOYSTICKS][DS_MAX_JOYSTICK_HATS];     /**< Hat angles */
+    float axes [DS_MAX_JOYSTICKS][DS_MAX_JOYSTICK_AXES];       /**< Axis values */
+} DS_JoystickBuffer;
+
+/*
+ * Number of axes processed by the axis filters (all the axes of all the
+ * joysticks, in the same order as the axes of a joystick buffer)
+ */
+#define FILTER_SIZE (DS_MAX_JOYSTICKS * DS_MAX_JOYSTICK_AXES)
+
+/*
+ * Longest time step (in seconds) used by the low-pass filters and rate
+ * limiters, larger steps (e.g. after the robot was disabled) are clamped
+ */
+#define FILTER_MAX_STEP 0.1f
 
 /**
- * Holds all the joysticks
+ * Holds the parameters and state of the axis filters. Each parameter is
+ * stored as a flat array (indexed by joystick * DS_MAX_JOYSTICK_AXES + axis),
+ * so that each stage of the pipeline is a single loop over all the axes,
+ * which the compiler can vectorize.
  */
-static DS_Array array;
+typedef struct _axis_filters {
+    int active;                         /**< Set if any filter is configured */
+    uint64_t time;                      /**< Time of the last evaluation (us) */
+    DS_AxisFilter config [FILTER_SIZE]; /**< Filter configuration of each axis */
+    float deadband [FILTER_SIZE];       /**< Deadband of each axis */
+    float deadband_scale [FILTER_SIZE]; /**< Rescales values outside the deadband */
+    float exponent [FILTER_SIZE];       /**< Exponent of the expo curve (1 if unused) */
+    float cubic [FILTER_SIZE];          /**< Gain of the cubic curve (0 if unused) */
+    float smoothing [FILTER_SIZE];      /**< Low-pass time constant (0 if unused) */
+    float rate_limit [FILTER_SIZE];     /**< Maximum change per second (0 if unused) */
+    float state [FILTER_SIZE];          /**< Last output of each axis */
+} DS_AxisFilters;
+
+/*
+ * Minimum change of an axis (compared to the value in the last snapshot)
+ * that requests an early robot packet
+ */
+#define EARLY_SEND_AXIS_DELTA 0.25f
+
+/*
+ * Joystick data is double-buffered: writers modify the back buffer and then
+ * publish it by swapping the front index, readers always read the front
+ * buffer. Each buffer has a sequence number (odd while it is being written),
+ * which allows readers to detect and retry torn reads without locking.
+ *
+ * The write mutex serializes writers (e.g. the UI thread and a joystick
+ * polling thread). The poll mutex is held while the poll function runs, so
+ * that it is not called after it is removed. The snapshot axes are the raw axis values read by the
+ * last snapshot, used to detect significant axis changes (an approximate
+ * copy is enough, so they are not locked).
+ *
+ * The macro flag is set if the last snapshot was read from a played macro,
+ * it is only used by the thread that takes the snapshots.
+ *
+ * The layout version is incremented (by the writers, with the write mutex
+ * held) whenever a joystick is added, replaced or removed, and copied to
+ * each published buffer. The protocols use it to cache the joystick
+ * descriptors instead of re-encoding them for every packet.
+ *
+ * The last snapshot is the state reported by the previous call to
+ * DS_GetJoystickSnapshot() (after the filters are applied and with the
+ * values cleared while the robot is disabled), the snapshot version is only
+ * incremented when a new snapshot differs from it. The protocols use it to
+ * re-use the encoded joystick data of the previous packet.
+ *
+ * The read retries and the write mutex contentions are counted for the
+ * internal statistics (see DS_Stats.h).
+ */
+typedef struct {
+    DS_JoystickBuffer buffers [2];
+    volatile size_t sequence [2];
+    volatile size_t front;
+    DS_Mutex write_mutex;
+    DS_AxisFilters filters;
+    DS_Mutex filter_mutex;
+    DS_JoystickPollFunc poll_func;
+    void* poll_data;
+    DS_Mutex poll_mutex;
+    float snapshot_axes [DS_MAX_JOYSTICKS][DS_MAX_JOYSTICK_AXES];
+    int macro;
+    unsigned int layout_version;
+    unsigned int snapshot_version;
+    DS_JoystickSnapshot last_snapshot;
+    DS_Mutex snapshot_mutex;
+    volatile size_t read_retries;
+    volatile size_t contentions;
+} JoysticksContext;
+
+/**
+ * Initializes the joystick state of a new DS context
+ */
+static void init_context (void* data)
+{
+    JoysticksContext* ctx = (JoysticksContext*) data;
+
+    DS_MutexInit (&ctx->write_mutex);
+    DS_MutexInit (&ctx->filter_mutex);
+    DS_MutexInit (&ctx->poll_mutex);
+    DS_MutexInit (&ctx->snapshot_mutex);
+
+    /* Version 0 is never reported, so it can mark empty caches */
+    ctx->snapshot_version = 1;
+}
+
+/**
+ * Releases the joystick state of a DS context
+ */
+static void destroy_context (void* data)
+{
+    JoysticksContext* ctx = (JoysticksContext*) data;
+
+    DS_MutexDestroy (&ctx->write_mutex);
+    DS_MutexDestroy (&ctx->filter_mutex);
+    DS_MutexDestroy (&ctx->poll_mutex);
+    DS_MutexDestroy (&ctx->snapshot_mutex);
+}
+
+/**
+ * Returns the joystick state of the current DS context
+ */
+static JoysticksContext* get_context (void)
+{
+    return (JoysticksContext*) DS_ContextData (DS_CONTEXT_JOYSTICKS,
+                                               sizeof (JoysticksContext),
+                                               init_context, destroy_context);
+}
 
 /**
  * Registers a joystick event to the LibDS event system
@@ -57,43 +190,349 @@ static void register_event()
 }
 
 /**
- * Returns the joystick structure at the given index
- * If the joystick does not exist, this function shall return \c NULL
+ * Begins a read operation, returns the index of the front buffer and
+ * stores its sequence number in \a seq
+ */
+static size_t read_begin (size_t* seq)
+{
+    JoysticksContext* ctx = get_context();
+    size_t index;
+    int waited = 0;
+
+    for (;;) {
+        index = DS_AtomicLoad (&ctx->front);
+        *seq = DS_AtomicLoad (&ctx->sequence [index]);
+        if (!(*seq & 1))
+            break;
+
+        waited = 1;
+    }
+
+    /* Waiting for a writer counts as a single retry */
+    if (waited)
+        DS_AtomicFetchAdd (&ctx->read_retries, 1);
+
+    return index;
+}
+
+/**
+ * Returns \c 1 if the buffer at the given \a index was modified after
+ * the read operation started with sequence number \a seq
+ */
+static int read_retry (size_t index, size_t seq)
+{
+    JoysticksContext* ctx = get_context();
+
+    DS_AtomicAcquireFence();
+    if (DS_AtomicLoad (&ctx->sequence [index]) == seq)
+        return 0;
+
+    DS_AtomicFetchAdd (&ctx->read_retries, 1);
+    return 1;
+}
+
+/**
+ * Marks the back buffer as being written and returns it, the caller must
+ * hold the writer mutex
+ */
+static DS_JoystickBuffer* write_begin (void)
+{
+    JoysticksContext* ctx = get_context();
+    size_t index = DS_AtomicLoad (&ctx->front) ^ 1;
+    DS_AtomicFetchAdd (&ctx->sequence [index], 1);
+    return &ctx->buffers [index];
+}
+
+/**
+ * Finishes writing the back buffer and publishes it as the front buffer
+ */
+static void write_end (void)
+{
+    JoysticksContext* ctx = get_context();
+    size_t index = DS_AtomicLoad (&ctx->front) ^ 1;
+    DS_AtomicFetchAdd (&ctx->sequence [index], 1);
+    DS_AtomicStore (&ctx->front, index);
+}
+
+/**
+ * Copies the front buffer into the given \a buffer without tearing
+ */
+static void read_buffer (DS_JoystickBuffer* buffer)
+{
+    JoysticksContext* ctx = get_context();
+    size_t seq;
+    size_t index;
+
+    do {
+        index = read_begin (&seq);
+        memcpy (buffer, &ctx->buffers [index], sizeof (DS_JoystickBuffer));
+    } while (read_retry (index, seq));
+}
+
+/**
+ * Returns \c 1 if the given \a joystick exists in the given \a buffer
+ */
+static int joystick_exists (const DS_JoystickBuffer* buffer, int joystick)
+{
+    return joystick >= 0 && joystick < buffer->count;
+}
+
+/**
+ * Sets the layout of the given \a joystick slot of the given \a buffer and
+ * sets its values to a neutral state
  */
-static DS_Joystick* get_joystick (int joystick)
+static void init_joystick (DS_JoystickBuffer* buffer, const int joystick,
+                           const int axes, const int hats, const int buttons)
 {
-    if ((int) array.used > joystick)
-        return (DS_Joystick*) array.data [joystick];
+    buffer->num_axes [joystick] = (uint8_t) DS_Min (DS_Max (axes, 0), DS_MAX_JOYSTICK_AXES);
+    buffer->num_hats [joystick] = (uint8_t) DS_Min (DS_Max (hats, 0), DS_MAX_JOYSTICK_HATS);
+    buffer->num_buttons [joystick] = (uint8_t) DS_Min (DS_Max (buttons, 0), DS_MAX_JOYSTICK_BUTTONS);
 
-    return NULL;
+    buffer->buttons [joystick] = 0;
+    memset (buffer->hats [joystick], 0, sizeof (buffer->hats [joystick]));
+    memset (buffer->axes [joystick], 0, sizeof (buffer->axes [joystick]));
 }
 
 /**
- * Returns \c true if the given \a joystick exists and is valid
+ * Returns \c 1 if the joystick layouts of the given \a buffer and \a frame
+ * are different, the caller must hold the write mutex
  */
-static int joystick_exists (int joystick)
+static int layout_differs (const DS_JoystickBuffer* buffer,
+                           const DS_JoystickSnapshot* frame)
 {
-    if (DS_GetJoystickCount() > joystick)
-        return get_joystick (joystick) != NULL;
+    int i;
+
+    if (buffer->count != frame->count)
+        return 1;
+
+    for (i = 0; i < frame->count; ++i) {
+        if (buffer->num_axes [i] != frame->joysticks [i].num_axes ||
+                buffer->num_hats [i] != frame->joysticks [i].num_hats ||
+                buffer->num_buttons [i] != frame->joysticks [i].num_buttons)
+            return 1;
+    }
 
     return 0;
 }
 
 /**
- * Initializes the joystick array, with an initial support for 6 joysticks
+ * Replaces the joysticks (layout and values) with the given macro \a frame
+ */
+static void write_frame (const DS_JoystickSnapshot* frame)
+{
+    JoysticksContext* ctx = get_context();
+    int i;
+    int pass;
+    int changed = 0;
+
+    DS_MutexLockCounted (&ctx->write_mutex, &ctx->contentions);
+
+    /* Frames recorded with other joysticks change the layout */
+    if (layout_differs (&ctx->buffers [DS_AtomicLoad (&ctx->front)], frame))
+        ++ctx->layout_version;
+
+    for (pass = 0; pass < 2; ++pass) {
+        DS_JoystickBuffer* buffer = write_begin();
+        changed |= buffer->count != frame->count;
+        memset (buffer, 0, sizeof (DS_JoystickBuffer));
+
+        buffer->count = frame->count;
+        buffer->layout_version = ctx->layout_version;
+        for (i = 0; i < frame->count; ++i) {
+            const DS_JoystickState* state = &frame->joysticks [i];
+
+            buffer->num_axes [i] = state->num_axes;
+            buffer->num_hats [i] = state->num_hats;
+            buffer->num_buttons [i] = state->num_buttons;
+            buffer->buttons [i] = state->buttons;
+            memcpy (buffer->hats [i], state->hats, sizeof (buffer->hats [i]));
+            memcpy (buffer->axes [i], state->axes, sizeof (buffer->axes [i]));
+        }
+
+        write_end();
+    }
+    DS_MutexUnlock (&ctx->write_mutex);
+
+    /* The macro was recorded with other joysticks */
+    if (changed)
+        register_event();
+}
+
+/**
+ * Sets the values of all the joysticks to a neutral state, without
+ * modifying their layout
+ */
+static void clear_values (void)
+{
+    JoysticksContext* ctx = get_context();
+    int pass;
+
+    DS_MutexLockCounted (&ctx->write_mutex, &ctx->contentions);
+    for (pass = 0; pass < 2; ++pass) {
+        DS_JoystickBuffer* buffer = write_begin();
+        memset (buffer->buttons, 0, sizeof (buffer->buttons));
+        memset (buffer->hats, 0, sizeof (buffer->hats));
+        memset (buffer->axes, 0, sizeof (buffer->axes));
+        write_end();
+    }
+    DS_MutexUnlock (&ctx->write_mutex);
+}
+
+/**
+ * Updates the pre-computed parameters of the axis at the given \a index
+ * from its filter configuration, the caller must hold the filter mutex
+ */
+static void update_filter (int index)
+{
+    DS_AxisFilters* filters = &get_context()->filters;
+    int i;
+    const DS_AxisFilter* config = &filters->config [index];
+    const float gain = DS_Min (DS_Max (config->curve_gain, 0.0f), 1.0f);
+
+    /* Deadband (values outside of it are rescaled to the full range) */
+    filters->deadband [index] = DS_Min (DS_Max (config->deadband, 0.0f), 0.99f);
+    filters->deadband_scale [index] = 1 / (1 - filters->deadband [index]);
+
+    /* Response curve */
+    filters->cubic [index] = config->curve == DS_AXIS_CURVE_CUBIC ? gain : 0;
+    filters->exponent [index] = config->curve == DS_AXIS_CURVE_EXPO ? 1 + gain : 1;
+
+    /* Smoothing and rate limit */
+    filters->smoothing [index] = DS_Max (config->smoothing, 0.0f);
+    filters->rate_limit [index] = DS_Max (config->rate_limit, 0.0f);
+
+    /* Check if any axis needs to be processed */
+    filters->active = 0;
+    for (i = 0; i < FILTER_SIZE && !filters->active; ++i) {
+        filters->active = filters->deadband [i] > 0 ||
+                          filters->cubic [i] > 0 ||
+                          filters->exponent [i] != 1 ||
+                          filters->smoothing [i] > 0 ||
+                          filters->rate_limit [i] > 0;
+    }
+}
+
+/**
+ * Resets the output of the low-pass filters and rate limiters to a
+ * neutral state, the caller must hold the filter mutex
+ */
+static void reset_filter_state (void)
+{
+    DS_AxisFilters* filters = &get_context()->filters;
+
+    filters->time = 0;
+    memset (filters->state, 0, sizeof (filters->state));
+}
+
+/**
+ * Applies the configured axis filters to the given \a axes (which has the
+ * same layout as the axes of a joystick buffer).
+ *
+ * Each stage is evaluated for all the axes before the next stage, axes
+ * without filters pass through every stage unchanged.
+ */
+static void apply_filters (float* axes)
+{
+    JoysticksContext* ctx = get_context();
+    DS_AxisFilters* filters = &ctx->filters;
+    int i;
+    float dt;
+    uint64_t now;
+
+    DS_MutexLock (&ctx->filter_mutex);
+
+    /* Nothing to do */
+    if (!filters->active) {
+        DS_MutexUnlock (&ctx->filter_mutex);
+        return;
+    }
+
+    /* Get the time elapsed since the last evaluation */
+    now = DS_GetTimeUs();
+    dt = filters->time ? (float) (now - filters->time) / 1000000 : 0;
+    dt = DS_Min (dt, FILTER_MAX_STEP);
+    filters->time = now;
+
+    /* Deadband */
+    for (i = 0; i < FILTER_SIZE; ++i) {
+        const float magnitude = fminf (fabsf (axes [i]), 1) - filters->deadband [i];
+        const float scaled = magnitude > 0 ? magnitude * filters->deadband_scale [i] : 0;
+        axes [i] = copysignf (scaled, axes [i]);
+    }
+
+    /* Cubic and expo curves */
+    for (i = 0; i < FILTER_SIZE; ++i) {
+        const float x = axes [i];
+        const float cubic = x + filters->cubic [i] * (x * x * x - x);
+        axes [i] = copysignf (powf (fabsf (cubic), filters->exponent [i]), cubic);
+    }
+
+    /* Low-pass filter and rate limiter */
+    for (i = 0; i < FILTER_SIZE; ++i) {
+        const float tau = filters->smoothing [i];
+        const float alpha = tau > 0 ? dt / (tau + dt) : 1;
+        const float max_step = filters->rate_limit [i] > 0 ? filters->rate_limit [i] * dt : 2;
+        const float step = alpha * (axes [i] - filters->state [i]);
+
+        filters->state [i] += fmaxf (-max_step, fminf (step, max_step));
+        axes [i] = filters->state [i];
+    }
+
+    DS_MutexUnlock (&ctx->filter_mutex);
+}
+
+/**
+ * Resets the joystick buffers
  */
 void Joysticks_Init (void)
 {
-    DS_ArrayInit (&array, 6);
+    JoysticksContext* ctx = get_context();
+    int i;
+
+    DS_MutexLockCounted (&ctx->write_mutex, &ctx->contentions);
+    memset (ctx->buffers, 0, sizeof (ctx->buffers));
+    ctx->buffers [0].layout_version = ++ctx->layout_version;
+    ctx->buffers [1].layout_version = ctx->layout_version;
+    DS_MutexUnlock (&ctx->write_mutex);
+
+    DS_MutexLock (&ctx->filter_mutex);
+    memset (&ctx->filters, 0, sizeof (ctx->filters));
+    for (i = 0; i < FILTER_SIZE; ++i)
+        update_filter (i);
+    DS_MutexUnlock (&ctx->filter_mutex);
 }
 
 /**
- * De-allocates the joystick array data
+ * Removes all registered joysticks
  */
 void Joysticks_Close (void)
 {
-    DS_ArrayFree (&array);
-    register_event();
+    DS_JoysticksReset();
+}
+
+/**
+ * Clears the statistics of the joystick snapshots of the current context
+ */
+void Joysticks_ResetStats (void)
+{
+    JoysticksContext* ctx = get_context();
+
+    DS_AtomicStore (&ctx->read_retries, 0);
+    DS_AtomicStore (&ctx->contentions, 0);
+}
+
+/**
+ * Writes the statistics of the joystick snapshots of the current context
+ * to the given \a stats structure
+ */
+void Joysticks_GetStats (DS_JoystickStats* stats)
+{
+    JoysticksContext* ctx = get_context();
+
+    assert (stats);
+
+    stats->read_retries = DS_AtomicLoad (&ctx->read_retries);
+    stats->contentions = DS_AtomicLoad (&ctx->contentions);
 }
 
 /**
@@ -101,7 +540,22 @@ void Joysticks_Close (void)
  */
 int DS_GetJoystickCount (void)
 {
-    return (int) array.used;
+    JoysticksContext* ctx = get_context();
+
+    return ctx->buffers [DS_AtomicLoad (&ctx->front)].count;
+}
+
+/**
+ * Returns the version of the joystick layouts, which changes whenever a
+ * joystick is added, replaced or removed. This can be used to cache
+ * information that only depends on the number of joysticks and on their
+ * axis, hat and button counts.
+ */
+unsigned int DS_GetJoystickLayoutVersion (void)
+{
+    JoysticksContext* ctx = get_context();
+
+    return ctx->buffers [DS_AtomicLoad (&ctx->front)].layout_version;
 }
 
 /**
@@ -110,10 +564,18 @@ int DS_GetJoystickCount (void)
  */
 int DS_GetJoystickNumHats (int joystick)
 {
-    if (joystick_exists (joystick))
-        return get_joystick (joystick)->num_hats;
+    JoysticksContext* ctx = get_context();
+    size_t seq;
+    size_t index;
+    int value;
 
-    return 0;
+    do {
+        index = read_begin (&seq);
+        const DS_JoystickBuffer* buffer = &ctx->buffers [index];
+        value = joystick_exists (buffer, joystick) ? buffer->num_hats [joystick] : 0;
+    } while (read_retry (index, seq));
+
+    return value;
 }
 
 /**
@@ -122,10 +584,18 @@ int DS_GetJoystickNumHats (int joystick)
  */
 int DS_GetJoystickNumAxes (int joystick)
 {
-    if (joystick_exists (joystick))
-        return get_joystick (joystick)->num_axes;
+    JoysticksContext* ctx = get_context();
+    size_t seq;
+    size_t index;
+    int value;
 
-    return 0;
+    do {
+        index = read_begin (&seq);
+        const DS_JoystickBuffer* buffer = &ctx->buffers [index];
+        value = joystick_exists (buffer, joystick) ? buffer->num_axes [joystick] : 0;
+    } while (read_retry (index, seq));
+
+    return value;
 }
 
 /**
@@ -134,10 +604,18 @@ int DS_GetJoystickNumAxes (int joystick)
  */
 int DS_GetJoystickNumButtons (int joystick)
 {
-    if (joystick_exists (joystick))
-        return get_joystick (joystick)->num_buttons;
+    JoysticksContext* ctx = get_context();
+    size_t seq;
+    size_t index;
+    int value;
 
-    return 0;
+    do {
+        index = read_begin (&seq);
+        const DS_JoystickBuffer* buffer = &ctx->buffers [index];
+        value = joystick_exists (buffer, joystick) ? buffer->num_buttons [joystick] : 0;
+    } while (read_retry (index, seq));
+
+    return value;
 }
 
 /**
@@ -150,14 +628,24 @@ int DS_GetJoystickNumButtons (int joystick)
  */
 int DS_GetJoystickHat (int joystick, int hat)
 {
-    if (CFG_GetRobotEnabled() && joystick_exists (joystick)) {
-        DS_Joystick* stick = get_joystick (joystick);
+    JoysticksContext* ctx = get_context();
+    size_t seq;
+    size_t index;
+    int value;
 
-        if (stick->num_hats > hat)
-            return stick->hats [hat];
-    }
+    if (!CFG_GetRobotEnabled() || hat < 0)
+        return 0;
 
-    return 0;
+    do {
+        index = read_begin (&seq);
+        const DS_JoystickBuffer* buffer = &ctx->buffers [index];
+
+        value = 0;
+        if (joystick_exists (buffer, joystick) && buffer->num_hats [joystick] > hat)
+            value = buffer->hats [joystick][hat];
+    } while (read_retry (index, seq));
+
+    return value;
 }
 
 /**
@@ -170,14 +658,24 @@ int DS_GetJoystickHat (int joystick, int hat)
  */
 float DS_GetJoystickAxis (int joystick, int axis)
 {
-    if (CFG_GetRobotEnabled() && joystick_exists (joystick)) {
-        DS_Joystick* stick = get_joystick (joystick);
+    JoysticksContext* ctx = get_context();
+    size_t seq;
+    size_t index;
+    float value;
 
-        if (stick->num_axes > axis)
-            return stick->axes [axis];
-    }
+    if (!CFG_GetRobotEnabled() || axis < 0)
+        return 0;
 
-    return 0;
+    do {
+        index = read_begin (&seq);
+        const DS_JoystickBuffer* buffer = &ctx->buffers [index];
+
+        value = 0;
+        if (joystick_exists (buffer, joystick) && buffer->num_axes [joystick] > axis)
+            value = buffer->axes [joystick][axis];
+    } while (read_retry (index, seq));
+
+    return value;
 }
 
 /**
@@ -190,14 +688,213 @@ float DS_GetJoystickAxis (int joystick, int axis)
  */
 int DS_GetJoystickButton (int joystick, int button)
 {
-    if (CFG_GetRobotEnabled() && joystick_exists (joystick)) {
-        DS_Joystick* stick = get_joystick (joystick);
+    JoysticksContext* ctx = get_context();
+    size_t seq;
+    size_t index;
+    int value;
+
+    if (!CFG_GetRobotEnabled() || button < 0)
+        return 0;
+
+    do {
+        index = read_begin (&seq);
+        const DS_JoystickBuffer* buffer = &ctx->buffers [index];
+
+        value = 0;
+        if (joystick_exists (buffer, joystick) && buffer->num_buttons [joystick] > button)
+            value = (buffer->buttons [joystick] >> button) & 1;
+    } while (read_retry (index, seq));
+
+    return value;
+}
+
+/**
+ * Copies the state of all the registered joysticks into the given
+ * \a snapshot, so that protocols can encode joystick data without calling
+ * the individual getters for each axis, hat and button.
+ *
+ * The snapshot is taken from a single published version of the joystick
+ * data, so values from different joysticks are always consistent.
+ *
+ * The axis filters (see \c DS_SetJoystickAxisFilter()) are evaluated by
+ * this function, so it should be called once for each robot packet. The
+ * poll function (see \c DS_SetJoystickPollFunc()) is called first, so the
+ * joystick state is read right before it is sent.
+ *
+ * While a macro is played (see \c DS_StartMacroPlayback()), the joysticks
+ * are replaced by the next frame of the macro instead, and each snapshot is
+ * appended to the macro recording (see \c DS_StartMacroRecording()).
+ *
+ * \note Like the individual getters, this function will report neutral
+ *       values if the robot is disabled
+ */
+void DS_GetJoystickSnapshot (DS_JoystickSnapshot* snapshot)
+{
+    JoysticksContext* ctx = get_context();
+    int i;
+    int macro;
+    DS_JoystickBuffer buffer;
+    DS_JoystickSnapshot frame;
 
-        if (stick->num_buttons > button)
-            return stick->buttons [button];
+    /* Snapshot pointer is invalid */
+    if (!snapshot)
+        return;
+
+    /* Use the next frame of the played macro */
+    macro = Macro_NextFrame (&frame);
+    if (macro)
+        write_frame (&frame);
+
+    /* Do not keep the values of the last frame after the macro ends */
+    else if (ctx->macro)
+        clear_values();
+
+    ctx->macro = macro;
+
+    /* Let the application read the input devices (only used if enabled) */
+    if (CFG_GetRobotEnabled() && !macro) {
+        DS_MutexLock (&ctx->poll_mutex);
+        if (ctx->poll_func)
+            ctx->poll_func (ctx->poll_data);
+        DS_MutexUnlock (&ctx->poll_mutex);
     }
 
-    return 0;
+    /* Get a consistent copy of the joystick data */
+    read_buffer (&buffer);
+    memcpy (ctx->snapshot_axes, buffer.axes, sizeof (ctx->snapshot_axes));
+
+    /* Clear the snapshot and set the joystick count */
+    memset (snapshot, 0, sizeof (DS_JoystickSnapshot));
+    snapshot->count = buffer.count;
+    snapshot->layout_version = buffer.layout_version;
+
+    /* Only report values when the robot is enabled */
+    const int enabled = CFG_GetRobotEnabled();
+
+    /* Process the axes, or reset the filters if the robot is disabled (the
+     * values of a macro were already filtered when they were recorded) */
+    if (enabled && !macro)
+        apply_filters (&buffer.axes [0][0]);
+    else {
+        DS_MutexLock (&ctx->filter_mutex);
+        reset_filter_state();
+        DS_MutexUnlock (&ctx->filter_mutex);
+    }
+
+    /* Copy the state of each joystick */
+    for (i = 0; i < buffer.count; ++i) {
+        DS_JoystickState* state = &snapshot->joysticks [i];
+
+        state->num_axes = buffer.num_axes [i];
+        state->num_hats = buffer.num_hats [i];
+        state->num_buttons = buffer.num_buttons [i];
+
+        if (enabled) {
+            state->buttons = buffer.buttons [i];
+            memcpy (state->hats, buffer.hats [i], sizeof (state->hats));
+            memcpy (state->axes, buffer.axes [i], sizeof (state->axes));
+        }
+    }
+
+    /* Only change the version if the reported state changed (the version
+     * field itself is still zero, like in the stored snapshot) */
+    DS_MutexLock (&ctx->snapshot_mutex);
+    if (memcmp (snapshot, &ctx->last_snapshot, sizeof (DS_JoystickSnapshot))) {
+        memcpy (&ctx->last_snapshot, snapshot, sizeof (DS_JoystickSnapshot));
+        ++ctx->snapshot_version;
+        if (ctx->snapshot_version == 0)
+            ++ctx->snapshot_version;
+    }
+    snapshot->version = ctx->snapshot_version;
+    DS_MutexUnlock (&ctx->snapshot_mutex);
+
+    Macro_RecordFrame (snapshot);
+}
+
+/**
+ * Sets the function that is called (with the given \a data) before each
+ * joystick snapshot is taken while the robot is enabled, which allows the
+ * application to read the state of its input devices once per robot packet
+ * instead of writing every input event. If \a func is \c NULL, the poll
+ * function is removed.
+ *
+ * \note The function is called from the thread that builds the packets,
+ *       after this function returns, the previous function is not called
+ */
+void DS_SetJoystickPollFunc (DS_JoystickPollFunc func, void* data)
+{
+    JoysticksContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->poll_mutex);
+    ctx->poll_func = func;
+    ctx->poll_data = data;
+    DS_MutexUnlock (&ctx->poll_mutex);
+}
+
+/**
+ * Applies the given \a filter to every axis of the given \a joystick.
+ *
+ * \note The filters are kept when the joysticks are reset or registered
+ *       again, since they are configured by joystick index
+ */
+void DS_SetJoystickFilter (int joystick, const DS_AxisFilter* filter)
+{
+    int axis;
+    for (axis = 0; axis < DS_MAX_JOYSTICK_AXES; ++axis)
+        DS_SetJoystickAxisFilter (joystick, axis, filter);
+}
+
+/**
+ * Copies the filter configuration of the given \a axis of the given
+ * \a joystick into \a filter. If the axis is invalid, the \a filter
+ * is cleared.
+ */
+void DS_GetJoystickAxisFilter (int joystick, int axis, DS_AxisFilter* filter)
+{
+    JoysticksContext* ctx = get_context();
+
+    if (!filter)
+        return;
+
+    memset (filter, 0, sizeof (DS_AxisFilter));
+
+    if (joystick >= 0 && joystick < DS_MAX_JOYSTICKS &&
+            axis >= 0 && axis < DS_MAX_JOYSTICK_AXES) {
+        DS_MutexLock (&ctx->filter_mutex);
+        *filter = ctx->filters.config [joystick * DS_MAX_JOYSTICK_AXES + axis];
+        DS_MutexUnlock (&ctx->filter_mutex);
+    }
+}
+
+/**
+ * Changes the processing applied to the given \a axis of the given
+ * \a joystick before it is sent to the robot. If \a filter is \c NULL,
+ * the axis is sent without any processing.
+ *
+ * Shaping the axes before they are quantized by the protocol (which
+ * usually sends each axis as a single byte) makes a better use of the
+ * available resolution than doing it in the robot code.
+ */
+void DS_SetJoystickAxisFilter (int joystick, int axis, const DS_AxisFilter* filter)
+{
+    JoysticksContext* ctx = get_context();
+    int index;
+
+    if (joystick < 0 || joystick >= DS_MAX_JOYSTICKS ||
+            axis < 0 || axis >= DS_MAX_JOYSTICK_AXES)
+        return;
+
+    index = joystick * DS_MAX_JOYSTICK_AXES + axis;
+
+    DS_MutexLock (&ctx->filter_mutex);
+    if (filter)
+        ctx->filters.config [index] = *filter;
+    else
+        memset (&ctx->filters.config [index], 0, sizeof (DS_AxisFilter));
+
+    update_filter (index);
+    ctx->filters.state [index] = 0;
+    DS_MutexUnlock (&ctx->filter_mutex);
 }
 
 /**
@@ -205,8 +902,19 @@ int DS_GetJoystickButton (int joystick, int button)
  */
 void DS_JoysticksReset (void)
 {
-    DS_ArrayFree (&array);
-    DS_ArrayInit (&array, 6);
+    JoysticksContext* ctx = get_context();
+    int pass;
+
+    /* Update both buffers, publishing each one after it is modified */
+    DS_MutexLockCounted (&ctx->write_mutex, &ctx->contentions);
+    ++ctx->layout_version;
+    for (pass = 0; pass < 2; ++pass) {
+        DS_JoystickBuffer* buffer = write_begin();
+        memset (buffer, 0, sizeof (DS_JoystickBuffer));
+        buffer->layout_version = ctx->layout_version;
+        write_end();
+    }
+    DS_MutexUnlock (&ctx->write_mutex);
 
     register_event();
 }
@@ -215,70 +923,260 @@ void DS_JoysticksReset (void)
  * Registers a new joystick with the given number of \a axes, \a hats and
  * \a buttons. All joystick values are set to a neutral state to ensure
  * safe operation of the robot.
+ *
+ * Up to \c DS_MAX_JOYSTICKS joysticks can be registered, and the number of
+ * axes, hats and buttons is limited to \c DS_MAX_JOYSTICK_AXES,
+ * \c DS_MAX_JOYSTICK_HATS and \c DS_MAX_JOYSTICK_BUTTONS, which are larger
+ * than the limits of any of the default protocols.
  */
 void DS_JoysticksAdd (const int axes, const int hats, const int buttons)
 {
+    JoysticksContext* ctx = get_context();
+    int pass;
+
     /* Joystick is empty */
     if (axes <= 0 && hats <= 0 && buttons <= 0) {
         fprintf (stderr, "DS_JoystickAdd: Cannot register empty joystick!\n");
         return;
     }
 
-    /* Allocate memory for a new joystick */
-    DS_Joystick* joystick = (DS_Joystick*) calloc (1, sizeof (DS_Joystick));
-
-    /* Set joystick properties */
-    joystick->num_axes = axes;
-    joystick->num_hats = hats;
-    joystick->num_buttons = buttons;
+    DS_MutexLockCounted (&ctx->write_mutex, &ctx->contentions);
 
-    /* Set joystick value arrays */
-    joystick->hats = calloc (hats, sizeof (int));
-    joystick->axes = calloc (axes, sizeof (float));
-    joystick->buttons = calloc (buttons, sizeof (int));
+    /* Joystick limit reached */
+    if (DS_GetJoystickCount() >= DS_MAX_JOYSTICKS) {
+        DS_MutexUnlock (&ctx->write_mutex);
+        fprintf (stderr, "DS_JoystickAdd: Cannot register more than %d joysticks!\n",
+                 DS_MAX_JOYSTICKS);
+        return;
+    }
 
-    /* Register the new joystick in the joystick list */
-    DS_ArrayInsert (&array, (void*) joystick);
+    /* Update both buffers, publishing each one after it is modified */
+    ++ctx->layout_version;
+    for (pass = 0; pass < 2; ++pass) {
+        DS_JoystickBuffer* buffer = write_begin();
+        init_joystick (buffer, buffer->count, axes, hats, buttons);
+        buffer->layout_version = ctx->layout_version;
+        ++buffer->count;
+        write_end();
+    }
+    DS_MutexUnlock (&ctx->write_mutex);
 
     /* Emit the joystick count changed event */
     register_event();
 }
 
+/**
+ * Changes the number of \a axes, \a hats and \a buttons of an already
+ * registered \a joystick and sets its values to a neutral state, without
+ * modifying the other joysticks.
+ *
+ * This is used when a joystick is detached or replaced by another device,
+ * so that the indexes of the other joysticks (which are used by the robot
+ * code) do not change.
+ */
+void DS_JoysticksReplace (const int joystick, const int axes, const int hats, const int buttons)
+{
+    JoysticksContext* ctx = get_context();
+    int axis;
+    int pass;
+
+    DS_MutexLockCounted (&ctx->write_mutex, &ctx->contentions);
+
+    /* Joystick does not exist */
+    if (joystick < 0 || joystick >= DS_GetJoystickCount()) {
+        DS_MutexUnlock (&ctx->write_mutex);
+        return;
+    }
+
+    /* Update both buffers, publishing each one after it is modified */
+    ++ctx->layout_version;
+    for (pass = 0; pass < 2; ++pass) {
+        DS_JoystickBuffer* buffer = write_begin();
+        init_joystick (buffer, joystick, axes, hats, buttons);
+        buffer->layout_version = ctx->layout_version;
+        write_end();
+    }
+
+    memset (ctx->snapshot_axes [joystick], 0, sizeof (ctx->snapshot_axes [joystick]));
+    DS_MutexUnlock (&ctx->write_mutex);
+
+    /* Do not carry the filter output of the previous device */
+    DS_MutexLock (&ctx->filter_mutex);
+    for (axis = 0; axis < DS_MAX_JOYSTICK_AXES; ++axis)
+        ctx->filters.state [joystick * DS_MAX_JOYSTICK_AXES + axis] = 0;
+    DS_MutexUnlock (&ctx->filter_mutex);
+
+    /* Send the neutral values as soon as possible */
+    DS_RequestRobotPacket();
+}
+
 /**
  * Updates the \a angle of the given \a hat in the given \a joystick
+ * (ignored while a macro is played)
  */
 void DS_SetJoystickHat (int joystick, int hat, int angle)
 {
-    if (joystick_exists (joystick)) {
-        DS_Joystick* stick = get_joystick (joystick);
+    JoysticksContext* ctx = get_context();
+    int pass;
+    int changed = 0;
+
+    /* The values are set by the played macro */
+    if (Macro_Playing())
+        return;
+
+    DS_MutexLockCounted (&ctx->write_mutex, &ctx->contentions);
+    for (pass = 0; pass < 2; ++pass) {
+        DS_JoystickBuffer* buffer = write_begin();
 
-        if (stick->num_hats > hat)
-            stick->hats [hat] = angle;
+        if (joystick_exists (buffer, joystick) && hat >= 0 && buffer->num_hats [joystick] > hat) {
+            changed |= buffer->hats [joystick][hat] != (int16_t) angle;
+            buffer->hats [joystick][hat] = (int16_t) angle;
+        }
+
+        write_end();
     }
+    DS_MutexUnlock (&ctx->write_mutex);
+
+    /* Send the new hat angle as soon as possible */
+    if (changed)
+        DS_RequestRobotPacket();
 }
 
 /**
  * Updates the \a value of the given \a axis in the given \a joystick
+ * (ignored while a macro is played)
  */
 void DS_SetJoystickAxis (int joystick, int axis, float value)
 {
-    if (joystick_exists (joystick)) {
-        DS_Joystick* stick = get_joystick (joystick);
+    JoysticksContext* ctx = get_context();
+    int pass;
+    int changed = 0;
+
+    /* The values are set by the played macro */
+    if (Macro_Playing())
+        return;
 
-        if (stick->num_axes > axis)
-            stick->axes [axis] = value;
+    DS_MutexLockCounted (&ctx->write_mutex, &ctx->contentions);
+    for (pass = 0; pass < 2; ++pass) {
+        DS_JoystickBuffer* buffer = write_begin();
+
+        if (joystick_exists (buffer, joystick) && axis >= 0 && buffer->num_axes [joystick] > axis) {
+            buffer->axes [joystick][axis] = value;
+            changed = fabsf (value - ctx->snapshot_axes [joystick][axis]) >= EARLY_SEND_AXIS_DELTA;
+        }
+
+        write_end();
     }
+    DS_MutexUnlock (&ctx->write_mutex);
+
+    /* Send large axis changes (e.g. trigger pulls) as soon as possible */
+    if (changed)
+        DS_RequestRobotPacket();
 }
 
 /**
  * Updates the \a pressed state of the given \a button in the given \a joystick
+ * (ignored while a macro is played)
  */
 void DS_SetJoystickButton (int joystick, int button, int pressed)
 {
-    if (joystick_exists (joystick)) {
-        DS_Joystick* stick = get_joystick (joystick);
+    JoysticksContext* ctx = get_context();
+    int pass;
+    int changed = 0;
+
+    /* The values are set by the played macro */
+    if (Macro_Playing())
+        return;
+
+    DS_MutexLockCounted (&ctx->write_mutex, &ctx->contentions);
+    for (pass = 0; pass < 2; ++pass) {
+        DS_JoystickBuffer* buffer = write_begin();
+
+        if (joystick_exists (buffer, joystick) && button >= 0 && buffer->num_buttons [joystick] > button) {
+            const uint32_t mask = (uint32_t) 1 << button;
+            const uint32_t state = (pressed > 0) ? (buffer->buttons [joystick] | mask) :
+                                   (buffer->buttons [joystick] & ~mask);
+
+            changed |= state != buffer->buttons [joystick];
+            buffer->buttons [joystick] = state;
+        }
+
+        write_end();
+    }
+    DS_MutexUnlock (&ctx->write_mutex);
+
+    /* Send button edges as soon as possible */
+    if (changed)
+        DS_RequestRobotPacket();
+}
+
+/**
+ * Updates all the values of the given \a joystick with a single publication,
+ * so the robot never receives a state in which only some of the values have
+ * been updated (ignored while a macro is played).
+ *
+ * Input backends that read the whole state of a device at once (e.g. while
+ * polling SDL) should use this function instead of setting each value.
+ *
+ * \param joystick the joystick to update
+ * \param axes the values of the first \a num_axes axes (may be \c NULL if
+ *             \a num_axes is 0)
+ * \param num_axes the number of values in \a axes, the axes beyond the
+ *                 joystick layout are ignored and the remaining axes of
+ *                 the joystick are not modified
+ * \param buttons the state of all the buttons (bit n is button n), the
+ *                bits beyond the button count of the joystick are ignored
+ * \param hats the angles of the first \a num_hats hats (may be \c NULL if
+ *             \a num_hats is 0)
+ * \param num_hats the number of values in \a hats
+ */
+void DS_SetJoystickState (int joystick,
+                          const float* axes, int num_axes,
+                          uint32_t buttons,
+                          const int* hats, int num_hats)
+{
+    JoysticksContext* ctx = get_context();
+    int i;
+    int pass;
+    int changed = 0;
 
-        if (stick->num_buttons > button)
-            stick->buttons [button] = (pressed > 0) ? 1 : 0;
+    /* Check arguments */
+    assert (axes || num_axes <= 0);
+    assert (hats || num_hats <= 0);
+
+    /* The values are set by the played macro */
+    if (Macro_Playing())
+        return;
+
+    DS_MutexLockCounted (&ctx->write_mutex, &ctx->contentions);
+    for (pass = 0; pass < 2; ++pass) {
+        DS_JoystickBuffer* buffer = write_begin();
+
+        if (joystick_exists (buffer, joystick)) {
+            const int count = buffer->num_buttons [joystick];
+            const uint32_t mask = (count >= 32) ? 0xFFFFFFFFu : (((uint32_t) 1 << count) - 1);
+            const int axis_count = DS_Min (num_axes, (int) buffer->num_axes [joystick]);
+            const int hat_count = DS_Min (num_hats, (int) buffer->num_hats [joystick]);
+
+            for (i = 0; i < axis_count; ++i) {
+                buffer->axes [joystick][i] = axes [i];
+                changed |= fabsf (axes [i] - ctx->snapshot_axes [joystick][i]) >= EARLY_SEND_AXIS_DELTA;
+            }
+
+            for (i = 0; i < hat_count; ++i) {
+                changed |= buffer->hats [joystick][i] != (int16_t) hats [i];
+                buffer->hats [joystick][i] = (int16_t) hats [i];
+            }
+
+            changed |= buffer->buttons [joystick] != (buttons & mask);
+            buffer->buttons [joystick] = buttons & mask;
+        }
+
+        write_end();
     }
+    DS_MutexUnlock (&ctx->write_mutex);
+
+    /* Send button edges, hat changes and large axis changes at once */
+    if (changed)
+        DS_RequestRobotPacket();
 }
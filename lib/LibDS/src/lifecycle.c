@@ -0,0 +1,370 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Timer.h"
+#include "DS_Utils.h"
+#include "DS_Context.h"
+#include "DS_Lifecycle.h"
+#include "DS_Thread.h"
+
+#include <string.h>
+#include <assert.h>
+
+/*
+ * Accumulated timing of an operation
+ */
+typedef struct {
+    int requests;
+    int completed;
+    int failed;
+    DS_Histogram total;
+    DS_Histogram outage;
+} LifecycleTiming;
+
+/*
+ * Reboots and code restarts of a DS context. The requests are added by the
+ * application, the robot state changes are reported by the event loop
+ * (through the config module), the mutex protects the whole structure.
+ *
+ * Only one request is tracked at a time, a new request replaces (and fails)
+ * the pending one.
+ */
+typedef struct {
+    int pending;
+    DS_LifecycleRecord current;
+    DS_LifecycleRecord history [DS_LIFECYCLE_HISTORY];
+    int count;
+    int newest;
+    LifecycleTiming timing [DS_LIFECYCLE_KIND_COUNT];
+    DS_Mutex mutex;
+} LifecycleContext;
+
+/**
+ * Initializes the lifecycle timing of a new DS context
+ */
+static void init_context (void* data)
+{
+    LifecycleContext* ctx = (LifecycleContext*) data;
+    DS_MutexInit (&ctx->mutex);
+}
+
+/**
+ * Releases the lifecycle timing of a DS context
+ */
+static void destroy_context (void* data)
+{
+    LifecycleContext* ctx = (LifecycleContext*) data;
+    DS_MutexDestroy (&ctx->mutex);
+}
+
+/**
+ * Returns the lifecycle timing of the current DS context
+ */
+static LifecycleContext* get_context (void)
+{
+    return (LifecycleContext*) DS_ContextData (DS_CONTEXT_LIFECYCLE,
+                                               sizeof (LifecycleContext),
+                                               init_context, destroy_context);
+}
+
+/**
+ * Returns the msecs elapsed since the pending request was made
+ */
+static int elapsed (const LifecycleContext* ctx, const uint64_t now)
+{
+    return (int) DS_Min (now - ctx->current.time, (uint64_t) INT32_MAX);
+}
+
+/**
+ * Returns the time (in msecs since the request) in which the robot went
+ * dark, i.e. the first loss of its communications or of its code
+ */
+static int outage_start (const DS_LifecycleRecord* record)
+{
+    if (record->comms_lost < 0)
+        return record->code_lost;
+    if (record->code_lost < 0)
+        return record->comms_lost;
+
+    return DS_Min (record->comms_lost, record->code_lost);
+}
+
+/**
+ * Starts tracking a request of the given \a kind
+ */
+static void start_request (LifecycleContext* ctx, const DS_LifecycleKind kind,
+                           const uint64_t now)
+{
+    ctx->pending = 1;
+    ctx->current.kind = kind;
+    ctx->current.completed = 0;
+    ctx->current.time = now;
+    ctx->current.comms_lost = -1;
+    ctx->current.comms_regained = -1;
+    ctx->current.code_lost = -1;
+    ctx->current.code_present = -1;
+
+    ++ctx->timing [kind].requests;
+}
+
+/**
+ * Stops tracking the pending request, adds it to the history and, if it
+ * was \a completed, adds its durations to the statistics of its kind
+ */
+static void finish_request (LifecycleContext* ctx, const int completed)
+{
+    DS_LifecycleRecord* record = &ctx->current;
+    LifecycleTiming* timing = &ctx->timing [record->kind];
+
+    record->completed = completed;
+    if (completed) {
+        ++timing->completed;
+        DS_HistogramRecord (&timing->total, (uint32_t) record->code_present);
+        DS_HistogramRecord (&timing->outage, (uint32_t) (record->code_present -
+                                                         outage_start (record)));
+    }
+
+    else
+        ++timing->failed;
+
+    ctx->newest = (ctx->newest + 1) % DS_LIFECYCLE_HISTORY;
+    ctx->history [ctx->newest] = *record;
+    ctx->count = DS_Min (ctx->count + 1, DS_LIFECYCLE_HISTORY);
+    ctx->pending = 0;
+}
+
+/**
+ * Fails the pending request if the robot code did not come back in time
+ */
+static void expire_request (LifecycleContext* ctx, const uint64_t now)
+{
+    if (ctx->pending && elapsed (ctx, now) > DS_LIFECYCLE_TIMEOUT)
+        finish_request (ctx, 0);
+}
+
+/**
+ * Converts the given \a histogram to a percentile summary
+ */
+static DS_LatencyStats get_stats (const DS_Histogram* histogram)
+{
+    DS_LatencyStats stats;
+    stats.samples = histogram->total;
+    stats.p50 = DS_HistogramPercentile (histogram, 50);
+    stats.p99 = DS_HistogramPercentile (histogram, 99);
+    stats.max = histogram->max;
+    return stats;
+}
+
+/**
+ * Starts tracking a reboot or code restart request of the given \a kind,
+ * a pending request is failed
+ */
+void Lifecycle_Request (const DS_LifecycleKind kind)
+{
+    LifecycleContext* ctx = get_context();
+    uint64_t now = DS_GetTimeMs();
+
+    assert (kind >= 0 && kind < DS_LIFECYCLE_KIND_COUNT);
+
+    DS_MutexLock (&ctx->mutex);
+    expire_request (ctx, now);
+    if (ctx->pending)
+        finish_request (ctx, 0);
+
+    start_request (ctx, kind, now);
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Records the loss or recovery of the robot \a communications
+ */
+void Lifecycle_CommsChanged (const int communications)
+{
+    LifecycleContext* ctx = get_context();
+    uint64_t now = DS_GetTimeMs();
+
+    DS_MutexLock (&ctx->mutex);
+    expire_request (ctx, now);
+
+    if (ctx->pending) {
+        DS_LifecycleRecord* record = &ctx->current;
+
+        if (!communications && record->comms_lost < 0)
+            record->comms_lost = elapsed (ctx, now);
+
+        else if (communications && record->comms_lost >= 0 &&
+                 record->comms_regained < 0)
+            record->comms_regained = elapsed (ctx, now);
+    }
+
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Records the stop or start of the robot \a code. If the code stops while
+ * the robot is reachable and no request is pending, the restart is tracked
+ * as a deploy (\a robot_lost is set if the code stopped because the robot
+ * communications were lost).
+ */
+void Lifecycle_CodeChanged (const int code, const int robot_lost)
+{
+    LifecycleContext* ctx = get_context();
+    uint64_t now = DS_GetTimeMs();
+
+    DS_MutexLock (&ctx->mutex);
+    expire_request (ctx, now);
+
+    if (!code && !ctx->pending && !robot_lost)
+        start_request (ctx, DS_LIFECYCLE_DEPLOY, now);
+
+    if (ctx->pending) {
+        DS_LifecycleRecord* record = &ctx->current;
+
+        if (!code && record->code_lost < 0)
+            record->code_lost = elapsed (ctx, now);
+
+        else if (code && outage_start (record) >= 0) {
+            record->code_present = elapsed (ctx, now);
+            finish_request (ctx, 1);
+        }
+    }
+
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Clears the statistics and the history of the reboots and code restarts
+ * (the pending request is still tracked)
+ */
+void DS_ResetLifecycleStats (void)
+{
+    int i;
+    LifecycleContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    ctx->count = 0;
+    ctx->newest = 0;
+    for (i = 0; i < DS_LIFECYCLE_KIND_COUNT; ++i) {
+        ctx->timing [i].requests = ctx->pending && (int) ctx->current.kind == i;
+        ctx->timing [i].completed = 0;
+        ctx->timing [i].failed = 0;
+        DS_HistogramReset (&ctx->timing [i].total);
+        DS_HistogramReset (&ctx->timing [i].outage);
+    }
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Obtains the number of requests of the given \a kind and the percentiles
+ * (in msecs) of the time that the completed requests took to bring the
+ * robot code back and of the time that the robot was dark
+ */
+void DS_GetLifecycleStats (const DS_LifecycleKind kind,
+                           DS_LifecycleStats* stats)
+{
+    LifecycleTiming* timing;
+    LifecycleContext* ctx = get_context();
+
+    assert (stats);
+    assert (kind >= 0 && kind < DS_LIFECYCLE_KIND_COUNT);
+
+    DS_MutexLock (&ctx->mutex);
+    expire_request (ctx, DS_GetTimeMs());
+
+    timing = &ctx->timing [kind];
+    stats->requests = timing->requests;
+    stats->completed = timing->completed;
+    stats->failed = timing->failed;
+    stats->total = get_stats (&timing->total);
+    stats->outage = get_stats (&timing->outage);
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Copies the histograms (in msecs) of the durations of the completed
+ * requests of the given \a kind, either pointer may be \c NULL
+ */
+void DS_GetLifecycleHistograms (const DS_LifecycleKind kind,
+                                DS_Histogram* total,
+                                DS_Histogram* outage)
+{
+    LifecycleContext* ctx = get_context();
+
+    assert (kind >= 0 && kind < DS_LIFECYCLE_KIND_COUNT);
+
+    DS_MutexLock (&ctx->mutex);
+    if (total)
+        *total = ctx->timing [kind].total;
+    if (outage)
+        *outage = ctx->timing [kind].outage;
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Copies up to \a max finished requests (newest first) to \a records
+ *
+ * \returns the number of copied records
+ */
+int DS_GetLifecycleRecords (DS_LifecycleRecord* records, const int max)
+{
+    int i;
+    int count;
+    LifecycleContext* ctx = get_context();
+
+    assert (records || max <= 0);
+
+    DS_MutexLock (&ctx->mutex);
+    expire_request (ctx, DS_GetTimeMs());
+
+    count = DS_Min (ctx->count, max);
+    for (i = 0; i < count; ++i) {
+        int index = (ctx->newest - i + DS_LIFECYCLE_HISTORY) % DS_LIFECYCLE_HISTORY;
+        records [i] = ctx->history [index];
+    }
+    DS_MutexUnlock (&ctx->mutex);
+
+    return DS_Max (count, 0);
+}
+
+/**
+ * Copies the request that is being tracked to \a record
+ *
+ * \returns \c 1 if a request is pending, \c 0 if not
+ */
+int DS_GetPendingLifecycle (DS_LifecycleRecord* record)
+{
+    int pending;
+    LifecycleContext* ctx = get_context();
+
+    assert (record);
+
+    DS_MutexLock (&ctx->mutex);
+    expire_request (ctx, DS_GetTimeMs());
+
+    pending = ctx->pending;
+    if (pending)
+        *record = ctx->current;
+    DS_MutexUnlock (&ctx->mutex);
+
+    return pending;
+}
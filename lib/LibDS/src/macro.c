@@ -0,0 +1,763 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include "DS_Utils.h"
+#include "DS_Timer.h"
+#include "DS_Atomic.h"
+#include "DS_Config.h"
+#include "DS_Macro.h"
+#include "DS_Context.h"
+#include "DS_Thread.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#define MAX_VARINT 10 /* Maximum size of an encoded 64-bit varint */
+
+/*
+ * Largest possible size of an encoded frame
+ */
+#define MAX_FRAME_SIZE (MAX_VARINT + 2 + DS_MAX_JOYSTICKS * \
+                        (3 + 1 + 4 + 1 + 3 * DS_MAX_JOYSTICK_HATS + \
+                         2 + 4 * DS_MAX_JOYSTICK_AXES))
+
+/*
+ * Growable byte buffer in which the recorded frames are encoded
+ */
+typedef struct {
+    uint8_t* data;
+    size_t len;
+    size_t cap;
+} MacroBuffer;
+
+/*
+ * Macro state of a DS context. Frames are recorded and played by the thread
+ * that builds the robot packets (through the joystick snapshot), while the
+ * application starts and stops the recording and the playback, the mutex
+ * protects everything except the flags, which are read on every packet.
+ *
+ * Both directions keep the last frame (as a snapshot), since each frame is
+ * encoded as the difference with the previous one.
+ */
+typedef struct {
+    /* Recording */
+    volatile size_t recording;
+    MacroBuffer recorded;
+    int recorded_frames;
+    uint64_t record_start;
+    uint64_t record_wall_time;
+    uint64_t last_frame;
+    DS_JoystickSnapshot record_state;
+
+    /* Playback */
+    volatile size_t playing;
+    int loop;
+    uint8_t* macro;
+    size_t macro_size;
+    size_t offset;
+    int frames;
+    volatile size_t position;
+    DS_JoystickSnapshot play_state;
+
+    DS_Mutex mutex;
+} MacroContext;
+
+/**
+ * Initializes the macro state of a new DS context
+ */
+static void init_context (void* data)
+{
+    MacroContext* ctx = (MacroContext*) data;
+    DS_MutexInit (&ctx->mutex);
+}
+
+/**
+ * Releases the macro state of a DS context
+ */
+static void destroy_context (void* data)
+{
+    MacroContext* ctx = (MacroContext*) data;
+
+    DS_FREE (ctx->recorded.data);
+    DS_FREE (ctx->macro);
+    DS_MutexDestroy (&ctx->mutex);
+}
+
+/**
+ * Returns the macro state of the current DS context
+ */
+static MacroContext* get_context (void)
+{
+    return (MacroContext*) DS_ContextData (DS_CONTEXT_MACRO,
+                                           sizeof (MacroContext),
+                                           init_context, destroy_context);
+}
+
+/**
+ * Makes room for \a size more bytes in the given \a buffer
+ *
+ * \returns \c 0 if the buffer cannot be enlarged
+ */
+static int reserve (MacroBuffer* buffer, const size_t size)
+{
+    if (buffer->len + size <= buffer->cap)
+        return 1;
+
+    size_t cap = DS_Max (buffer->cap * 2, buffer->len + size);
+    uint8_t* data = (uint8_t*) DS_REALLOC (DS_MEMORY_GENERAL,
+                                           buffer->data, cap);
+    if (!data)
+        return 0;
+
+    buffer->data = data;
+    buffer->cap = cap;
+    return 1;
+}
+
+/**
+ * Appends the given \a value to the \a buffer as an unsigned LEB128 varint
+ */
+static void put_varint (MacroBuffer* buffer, uint64_t value)
+{
+    while (value >= 0x80) {
+        buffer->data [buffer->len++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+
+    buffer->data [buffer->len++] = (uint8_t) value;
+}
+
+/**
+ * Reads an unsigned LEB128 varint from the given \a data
+ *
+ * \returns \c 0 if the varint is truncated or too long
+ */
+static int get_varint (const uint8_t* data, const size_t size,
+                       size_t* offset, uint64_t* value)
+{
+    int i;
+    *value = 0;
+
+    for (i = 0; i < MAX_VARINT && *offset < size; ++i) {
+        uint8_t byte = data [(*offset)++];
+        *value |= (uint64_t) (byte & 0x7f) << (7 * i);
+
+        if (!(byte & 0x80))
+            return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Appends the given little-endian \a value of \a bytes bytes to the \a buffer
+ */
+static void put_le (MacroBuffer* buffer, uint64_t value, const int bytes)
+{
+    int i;
+    for (i = 0; i < bytes; ++i) {
+        buffer->data [buffer->len++] = (uint8_t) (value & 0xff);
+        value >>= 8;
+    }
+}
+
+/**
+ * Reads a little-endian integer of the given number of \a bytes
+ *
+ * \returns \c 0 if the data is truncated
+ */
+static int get_le (const uint8_t* data, const size_t size, size_t* offset,
+                   uint64_t* value, const int bytes)
+{
+    int i;
+
+    if (*offset + (size_t) bytes > size)
+        return 0;
+
+    *value = 0;
+    for (i = bytes - 1; i >= 0; --i)
+        *value = (*value << 8) | data [*offset + (size_t) i];
+
+    *offset += (size_t) bytes;
+    return 1;
+}
+
+/**
+ * Returns the IEEE 754 representation of the given \a value, axes are
+ * compared and stored as bits so that the playback is exact
+ */
+static uint32_t float_bits (const float value)
+{
+    uint32_t bits;
+    memcpy (&bits, &value, sizeof (bits));
+    return bits;
+}
+
+/**
+ * Returns the float represented by the given IEEE 754 \a bits
+ */
+static float bits_float (const uint32_t bits)
+{
+    float value;
+    memcpy (&value, &bits, sizeof (value));
+    return value;
+}
+
+/**
+ * Returns \c 1 if the joystick layout of the given snapshots is different
+ */
+static int layout_changed (const DS_JoystickSnapshot* a,
+                           const DS_JoystickSnapshot* b)
+{
+    int i;
+
+    if (a->count != b->count)
+        return 1;
+
+    for (i = 0; i < a->count; ++i) {
+        if (a->joysticks [i].num_axes != b->joysticks [i].num_axes ||
+                a->joysticks [i].num_hats != b->joysticks [i].num_hats ||
+                a->joysticks [i].num_buttons != b->joysticks [i].num_buttons)
+            return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Appends the given \a frame to the recorded stream, as the difference with
+ * the previous frame. The caller must hold the mutex.
+ */
+static void encode_frame (MacroContext* ctx, const DS_JoystickSnapshot* frame,
+                          const uint64_t time)
+{
+    int i;
+    int j;
+    uint8_t masks [DS_MAX_JOYSTICKS] = {0};
+    uint16_t axes [DS_MAX_JOYSTICKS] = {0};
+    uint8_t hats [DS_MAX_JOYSTICKS] = {0};
+    uint8_t flags = 0;
+    MacroBuffer* buffer = &ctx->recorded;
+    DS_JoystickSnapshot* last = &ctx->record_state;
+
+    if (!reserve (buffer, MAX_FRAME_SIZE))
+        return;
+
+    /* Find the changed values */
+    for (i = 0; i < frame->count; ++i) {
+        const DS_JoystickState* cur = &frame->joysticks [i];
+        const DS_JoystickState* prev = &last->joysticks [i];
+
+        if (cur->buttons != prev->buttons)
+            masks [i] |= DS_MACRO_BUTTONS;
+
+        for (j = 0; j < DS_MAX_JOYSTICK_HATS; ++j) {
+            if (cur->hats [j] != prev->hats [j])
+                hats [i] |= (uint8_t) (1 << j);
+        }
+
+        for (j = 0; j < DS_MAX_JOYSTICK_AXES; ++j) {
+            if (float_bits (cur->axes [j]) != float_bits (prev->axes [j]))
+                axes [i] |= (uint16_t) (1 << j);
+        }
+
+        masks [i] |= (hats [i] ? DS_MACRO_HATS : 0) | (axes [i] ? DS_MACRO_AXES : 0);
+        flags |= masks [i] ? DS_MACRO_VALUES : 0;
+    }
+
+    if (layout_changed (frame, last))
+        flags |= DS_MACRO_LAYOUT;
+
+    /* Write the frame time and flags */
+    put_varint (buffer, time - ctx->last_frame);
+    put_le (buffer, flags, 1);
+
+    /* Write the layout */
+    if (flags & DS_MACRO_LAYOUT) {
+        put_le (buffer, (uint64_t) frame->count, 1);
+        for (i = 0; i < frame->count; ++i) {
+            put_le (buffer, frame->joysticks [i].num_axes, 1);
+            put_le (buffer, frame->joysticks [i].num_hats, 1);
+            put_le (buffer, frame->joysticks [i].num_buttons, 1);
+        }
+    }
+
+    /* Write the changed values */
+    if (flags & DS_MACRO_VALUES) {
+        for (i = 0; i < frame->count; ++i) {
+            const DS_JoystickState* cur = &frame->joysticks [i];
+            put_le (buffer, masks [i], 1);
+
+            if (masks [i] & DS_MACRO_BUTTONS)
+                put_le (buffer, cur->buttons, 4);
+
+            if (masks [i] & DS_MACRO_HATS) {
+                put_le (buffer, hats [i], 1);
+                for (j = 0; j < DS_MAX_JOYSTICK_HATS; ++j) {
+                    const int32_t hat = cur->hats [j];
+                    if (hats [i] & (1 << j))
+                        put_varint (buffer, ((uint32_t) hat << 1) ^ (uint32_t) (hat >> 31));
+                }
+            }
+
+            if (masks [i] & DS_MACRO_AXES) {
+                put_le (buffer, axes [i], 2);
+                for (j = 0; j < DS_MAX_JOYSTICK_AXES; ++j) {
+                    if (axes [i] & (1 << j))
+                        put_le (buffer, float_bits (cur->axes [j]), 4);
+                }
+            }
+        }
+    }
+
+    *last = *frame;
+    ctx->last_frame = time;
+    ++ctx->recorded_frames;
+}
+
+/**
+ * Reads the frame at the given \a offset of the macro \a data and applies
+ * it to the \a state (the previous frame), the \a offset and the \a state
+ * are only modified if the frame is complete and valid
+ *
+ * \returns \c 0 at the end of the data, or if the frame is truncated or
+ *          corrupted
+ */
+static int decode_frame (const uint8_t* data, const size_t size,
+                         size_t* offset, DS_JoystickSnapshot* state)
+{
+    int i;
+    int j;
+    uint64_t value;
+    uint64_t flags;
+    size_t pos = *offset;
+    DS_JoystickSnapshot frame = *state;
+
+    /* Read the frame time (only used by tools) and flags */
+    if (!get_varint (data, size, &pos, &value) ||
+            !get_le (data, size, &pos, &flags, 1))
+        return 0;
+
+    /* Read the layout, joysticks beyond the new count are cleared */
+    if (flags & DS_MACRO_LAYOUT) {
+        if (!get_le (data, size, &pos, &value, 1) || value > DS_MAX_JOYSTICKS)
+            return 0;
+
+        frame.count = (int) value;
+        for (i = 0; i < frame.count; ++i) {
+            uint64_t layout [3];
+            for (j = 0; j < 3; ++j) {
+                if (!get_le (data, size, &pos, &layout [j], 1))
+                    return 0;
+            }
+
+            if (layout [0] > DS_MAX_JOYSTICK_AXES ||
+                    layout [1] > DS_MAX_JOYSTICK_HATS ||
+                    layout [2] > DS_MAX_JOYSTICK_BUTTONS)
+                return 0;
+
+            frame.joysticks [i].num_axes = (uint8_t) layout [0];
+            frame.joysticks [i].num_hats = (uint8_t) layout [1];
+            frame.joysticks [i].num_buttons = (uint8_t) layout [2];
+        }
+
+        memset (frame.joysticks + frame.count, 0,
+                (size_t) (DS_MAX_JOYSTICKS - frame.count) * sizeof (DS_JoystickState));
+    }
+
+    /* Read the changed values */
+    if (flags & DS_MACRO_VALUES) {
+        for (i = 0; i < frame.count; ++i) {
+            uint64_t mask;
+            uint64_t bits;
+            DS_JoystickState* joystick = &frame.joysticks [i];
+
+            if (!get_le (data, size, &pos, &mask, 1))
+                return 0;
+
+            if (mask & DS_MACRO_BUTTONS) {
+                if (!get_le (data, size, &pos, &value, 4))
+                    return 0;
+
+                joystick->buttons = (uint32_t) value;
+            }
+
+            if (mask & DS_MACRO_HATS) {
+                if (!get_le (data, size, &pos, &bits, 1))
+                    return 0;
+
+                for (j = 0; j < DS_MAX_JOYSTICK_HATS; ++j) {
+                    if (!(bits & (1 << j)))
+                        continue;
+
+                    if (!get_varint (data, size, &pos, &value))
+                        return 0;
+
+                    joystick->hats [j] = (int16_t) ((value >> 1) ^ (~(value & 1) + 1));
+                }
+            }
+
+            if (mask & DS_MACRO_AXES) {
+                if (!get_le (data, size, &pos, &bits, 2))
+                    return 0;
+
+                for (j = 0; j < DS_MAX_JOYSTICK_AXES; ++j) {
+                    if (!(bits & (1 << j)))
+                        continue;
+
+                    if (!get_le (data, size, &pos, &value, 4))
+                        return 0;
+
+                    joystick->axes [j] = bits_float ((uint32_t) value);
+                }
+            }
+        }
+    }
+
+    *offset = pos;
+    *state = frame;
+    return 1;
+}
+
+/**
+ * Discards the played macro, the caller must hold the mutex
+ */
+static void free_macro (MacroContext* ctx)
+{
+    DS_FREE (ctx->macro);
+    ctx->macro_size = 0;
+    ctx->offset = 0;
+    ctx->frames = 0;
+    DS_AtomicStore (&ctx->position, 0);
+    DS_AtomicStore (&ctx->playing, 0);
+}
+
+/**
+ * Stops the recording and the playback, and discards the recorded frames
+ */
+void Macro_Close (void)
+{
+    MacroContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    DS_AtomicStore (&ctx->recording, 0);
+    DS_FREE (ctx->recorded.data);
+    memset (&ctx->recorded, 0, sizeof (ctx->recorded));
+    ctx->recorded_frames = 0;
+    free_macro (ctx);
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Returns \c 1 if a macro is being played, in which case the joystick
+ * snapshots are replaced by the frames of the macro
+ */
+int Macro_Playing (void)
+{
+    return DS_AtomicLoad (&get_context()->playing) != 0;
+}
+
+/**
+ * Obtains the next frame of the played macro, this function is called once
+ * for each robot packet, so the frames are played at the packet rate (and
+ * not at the rate in which the application updates the joysticks). When the
+ * last frame is reached, the macro is played again (if it loops) or the
+ * playback ends.
+ *
+ * \returns \c 1 if a frame was read, \c 0 if no macro is being played
+ */
+int Macro_NextFrame (DS_JoystickSnapshot* snapshot)
+{
+    MacroContext* ctx = get_context();
+    int ended = 0;
+    int read = 0;
+
+    assert (snapshot);
+    if (!Macro_Playing())
+        return 0;
+
+    DS_MutexLock (&ctx->mutex);
+    if (ctx->macro) {
+        /* Go back to the first frame */
+        if (ctx->position >= (size_t) ctx->frames && ctx->loop) {
+            ctx->offset = DS_MACRO_HEADER_SIZE;
+            memset (&ctx->play_state, 0, sizeof (ctx->play_state));
+            DS_AtomicStore (&ctx->position, 0);
+        }
+
+        /* Read the frame, or stop if the macro ended */
+        if (ctx->position < (size_t) ctx->frames &&
+                decode_frame (ctx->macro, ctx->macro_size, &ctx->offset,
+                              &ctx->play_state)) {
+            *snapshot = ctx->play_state;
+            DS_AtomicStore (&ctx->position, ctx->position + 1);
+            read = 1;
+        }
+
+        else {
+            free_macro (ctx);
+            ended = 1;
+        }
+    }
+    DS_MutexUnlock (&ctx->mutex);
+
+    if (ended)
+        CFG_AddStaticNotification (CFG_NOTIFY_MACRO_FINISHED);
+
+    return read;
+}
+
+/**
+ * Appends the given joystick \a snapshot to the recording (if a recording
+ * is running), this function is called for every robot packet
+ */
+void Macro_RecordFrame (const DS_JoystickSnapshot* snapshot)
+{
+    MacroContext* ctx = get_context();
+    DS_JoystickSnapshot frame;
+
+    if (!DS_AtomicLoad (&ctx->recording) || !snapshot)
+        return;
+
+    /* Normalize the snapshot, so that unused values are not recorded */
+    memset (&frame, 0, sizeof (frame));
+    frame.count = DS_Min (DS_Max (snapshot->count, 0), DS_MAX_JOYSTICKS);
+    memcpy (frame.joysticks, snapshot->joysticks,
+            (size_t) frame.count * sizeof (DS_JoystickState));
+
+    DS_MutexLock (&ctx->mutex);
+    if (DS_AtomicLoad (&ctx->recording))
+        encode_frame (ctx, &frame, DS_GetTimeUs() - ctx->record_start);
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Starts recording the joystick values sent in every robot packet, the
+ * frames of the previous recording are discarded. The recording is kept in
+ * memory until it is saved with \c DS_SaveMacro().
+ */
+void DS_StartMacroRecording (void)
+{
+    MacroContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    ctx->recorded.len = 0;
+    ctx->recorded_frames = 0;
+    ctx->last_frame = 0;
+    ctx->record_start = DS_GetTimeUs();
+    ctx->record_wall_time = DS_GetWallTimeUs();
+    memset (&ctx->record_state, 0, sizeof (ctx->record_state));
+    DS_AtomicStore (&ctx->recording, 1);
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Stops the recording, the recorded frames are kept until a new recording
+ * is started
+ */
+void DS_StopMacroRecording (void)
+{
+    MacroContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    DS_AtomicStore (&ctx->recording, 0);
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Returns \c 1 if the joystick values are being recorded
+ */
+int DS_MacroRecording (void)
+{
+    return DS_AtomicLoad (&get_context()->recording) != 0;
+}
+
+/**
+ * Writes the frames of the current (or last) recording to a macro file at
+ * the given \a path, a running recording is not interrupted
+ *
+ * \returns \c 1 on success, \c 0 if nothing was recorded or if the file
+ *          cannot be written
+ */
+int DS_SaveMacro (const char* path)
+{
+    MacroContext* ctx = get_context();
+    MacroBuffer header = {0};
+    uint8_t bytes [DS_MACRO_HEADER_SIZE] = {0};
+    int ok = 0;
+
+    assert (path);
+
+    DS_MutexLock (&ctx->mutex);
+    if (ctx->recorded_frames > 0) {
+        FILE* file = fopen (path, "wb");
+
+        /* Write the header and the recorded frames */
+        if (file) {
+            header.data = bytes;
+            header.cap = sizeof (bytes);
+            memcpy (bytes, DS_MACRO_MAGIC, 4);
+            header.len = 4;
+            put_le (&header, DS_MACRO_VERSION, 4); /* With the reserved bytes */
+            put_le (&header, ctx->record_wall_time, 8);
+            put_le (&header, (uint64_t) ctx->recorded_frames, 4);
+
+            ok = fwrite (bytes, 1, sizeof (bytes), file) == sizeof (bytes) &&
+                 fwrite (ctx->recorded.data, 1, ctx->recorded.len, file) == ctx->recorded.len;
+            ok &= fclose (file) == 0;
+        }
+    }
+    DS_MutexUnlock (&ctx->mutex);
+
+    return ok;
+}
+
+/**
+ * Plays the macro file at the given \a path: each robot packet sends the
+ * next frame of the macro instead of the joystick values set by the
+ * application (which are ignored while the macro plays), and the frame is
+ * also written to the joystick values, so that the application can display
+ * it. Axis filters are not applied, since the recorded values were already
+ * filtered.
+ *
+ * Frames are played one per packet, with the same sequence as they were
+ * recorded, regardless of the UI and of the timer jitter. The recorded times
+ * are kept in the file, so that the macro can be aligned with other logs.
+ *
+ * When the playback ends (or is stopped), the joystick values are set to a
+ * neutral state.
+ *
+ * \param path the location of the macro file
+ * \param loop if set to \c 1, the macro is played again after its last frame
+ *
+ * \returns \c 1 on success, \c 0 if the file cannot be read, if it is not a
+ *          macro file, or if it has no frames
+ */
+int DS_StartMacroPlayback (const char* path, const int loop)
+{
+    MacroContext* ctx = get_context();
+    uint8_t* data = NULL;
+    size_t size = 0;
+    size_t offset = 16;
+    uint64_t count = 0;
+    int frames = 0;
+    DS_JoystickSnapshot state;
+
+    assert (path);
+
+    /* Read the whole file */
+    FILE* fp = fopen (path, "rb");
+    if (!fp)
+        return 0;
+
+    long len = -1;
+    if (fseek (fp, 0, SEEK_END) == 0)
+        len = ftell (fp);
+
+    if (len >= DS_MACRO_HEADER_SIZE && fseek (fp, 0, SEEK_SET) == 0) {
+        size = (size_t) len;
+        data = (uint8_t*) DS_MALLOC (DS_MEMORY_GENERAL, size);
+
+        if (data && fread (data, 1, size, fp) != size)
+            DS_FREE (data);
+    }
+
+    fclose (fp);
+
+    /* Check the header */
+    if (!data || memcmp (data, DS_MACRO_MAGIC, 4) != 0 ||
+            data [4] > DS_MACRO_VERSION) {
+        DS_FREE (data);
+        return 0;
+    }
+
+    /* Count the valid frames (an incomplete last frame is ignored) */
+    get_le (data, size, &offset, &count, 4);
+    memset (&state, 0, sizeof (state));
+    while ((uint64_t) frames < count && decode_frame (data, size, &offset, &state))
+        ++frames;
+
+    if (frames == 0) {
+        DS_FREE (data);
+        return 0;
+    }
+
+    /* Replace the current macro */
+    DS_MutexLock (&ctx->mutex);
+    free_macro (ctx);
+    ctx->macro = data;
+    ctx->macro_size = size;
+    ctx->offset = DS_MACRO_HEADER_SIZE;
+    ctx->frames = frames;
+    ctx->loop = loop;
+    memset (&ctx->play_state, 0, sizeof (ctx->play_state));
+    DS_AtomicStore (&ctx->playing, 1);
+    DS_MutexUnlock (&ctx->mutex);
+
+    return 1;
+}
+
+/**
+ * Stops the macro playback, the joystick values are set to a neutral state
+ * before the next robot packet
+ */
+void DS_StopMacroPlayback (void)
+{
+    MacroContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    free_macro (ctx);
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Returns \c 1 if a macro is being played
+ */
+int DS_MacroPlaying (void)
+{
+    return Macro_Playing();
+}
+
+/**
+ * Returns the number of frames of the played macro, or of the recording if
+ * no macro is being played
+ */
+int DS_GetMacroFrameCount (void)
+{
+    MacroContext* ctx = get_context();
+    int frames;
+
+    DS_MutexLock (&ctx->mutex);
+    frames = ctx->macro ? ctx->frames : ctx->recorded_frames;
+    DS_MutexUnlock (&ctx->mutex);
+
+    return frames;
+}
+
+/**
+ * Returns the number of frames of the played macro that were already sent
+ */
+int DS_GetMacroPosition (void)
+{
+    return (int) DS_AtomicLoad (&get_context()->position);
+}
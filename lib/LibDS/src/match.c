@@ -0,0 +1,387 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Timer.h"
+#include "DS_Utils.h"
+#include "DS_Match.h"
+#include "DS_Config.h"
+#include "DS_Events.h"
+#include "DS_Context.h"
+#include "DS_Brownout.h"
+#include "DS_Histogram.h"
+#include "DS_Thread.h"
+
+#include <string.h>
+#include <assert.h>
+
+/*
+ * Running aggregates of the current match. Every sample updates them in
+ * constant time, the derived values (averages, loss and percentiles) are
+ * only computed when a summary is requested or the match ends.
+ *
+ * The samples are added by the event loop and the match state changes may
+ * come from the application, the mutex protects the whole structure.
+ */
+typedef struct {
+    int active;
+    int teleop_seen;
+    int in_brownout;
+    double voltage_sum;
+    unsigned int voltage_samples;
+    unsigned int replies;
+    uint64_t comms_lost_since;
+    DS_Histogram round_trip;
+    DS_MatchSummary current;
+    DS_MatchSummary history [DS_MATCH_HISTORY];
+    int count;
+    int newest;
+    DS_Mutex mutex;
+} MatchContext;
+
+/**
+ * Initializes the match statistics of a new DS context
+ */
+static void init_context (void* data)
+{
+    MatchContext* ctx = (MatchContext*) data;
+    DS_MutexInit (&ctx->mutex);
+}
+
+/**
+ * Releases the match statistics of a DS context
+ */
+static void destroy_context (void* data)
+{
+    MatchContext* ctx = (MatchContext*) data;
+    DS_MutexDestroy (&ctx->mutex);
+}
+
+/**
+ * Returns the match statistics of the current DS context
+ */
+static MatchContext* get_context (void)
+{
+    return (MatchContext*) DS_ContextData (DS_CONTEXT_MATCH,
+                                           sizeof (MatchContext),
+                                           init_context, destroy_context);
+}
+
+/**
+ * Resets the aggregates and starts a match with the given FMS \a match
+ * identity
+ */
+static void start_match (MatchContext* ctx, const DS_FMSMatch* match,
+                         const uint64_t now)
+{
+    ctx->active = 1;
+    ctx->teleop_seen = 0;
+    ctx->in_brownout = 0;
+    ctx->voltage_sum = 0;
+    ctx->voltage_samples = 0;
+    ctx->replies = 0;
+    ctx->comms_lost_since = CFG_GetRobotCommunications() ? 0 : now;
+    DS_HistogramReset (&ctx->round_trip);
+
+    memset (&ctx->current, 0, sizeof (ctx->current));
+    ctx->current.match_type = match->match_type;
+    ctx->current.match_number = match->match_number;
+    ctx->current.replay_number = match->replay_number;
+    ctx->current.start_time = now;
+    ctx->current.max_cpu = -1;
+    ctx->current.max_can = -1;
+}
+
+/**
+ * Copies the aggregates of the current match to \a summary and computes
+ * its derived values as if the match ended \a now
+ */
+static void fill_summary (const MatchContext* ctx, DS_MatchSummary* summary,
+                          const uint64_t now)
+{
+    const DS_MatchSummary* current = &ctx->current;
+
+    *summary = *current;
+    summary->duration = (int) DS_Min (now - current->start_time,
+                                      (uint64_t) INT32_MAX);
+
+    if (ctx->voltage_samples > 0)
+        summary->avg_voltage = (float) (ctx->voltage_sum /
+                                        ctx->voltage_samples);
+
+    if (ctx->comms_lost_since > 0)
+        summary->comms_lost_time += (int) (now - ctx->comms_lost_since);
+
+    summary->lost = current->sent - DS_Min (ctx->replies, current->sent);
+    if (current->sent > 0)
+        summary->packet_loss = summary->lost * 100.0f / current->sent;
+
+    summary->latency.samples = ctx->round_trip.total;
+    summary->latency.p50 = DS_HistogramPercentile (&ctx->round_trip, 50);
+    summary->latency.p99 = DS_HistogramPercentile (&ctx->round_trip, 99);
+    summary->latency.max = ctx->round_trip.max;
+}
+
+/**
+ * Finalizes the current match and adds its summary to the history
+ */
+static void finish_match (MatchContext* ctx, const uint64_t now)
+{
+    ctx->newest = (ctx->newest + 1) % DS_MATCH_HISTORY;
+    fill_summary (ctx, &ctx->history [ctx->newest], now);
+    ctx->count = DS_Min (ctx->count + 1, DS_MATCH_HISTORY);
+    ctx->active = 0;
+}
+
+/**
+ * Returns \c 1 if the FMS reports a different match than the one that is
+ * being tracked
+ */
+static int match_changed (const MatchContext* ctx, const DS_FMSMatch* match)
+{
+    return ctx->current.match_type != match->match_type ||
+           ctx->current.match_number != match->match_number ||
+           ctx->current.replay_number != match->replay_number;
+}
+
+/**
+ * Starts or ends the match based on the FMS, enabled and control mode
+ * state. A \c DS_MATCH_FINISHED event is registered when a match ends.
+ *
+ * This is called by the config module when one of those values changes,
+ * but not while the robot state is reset after losing its communications
+ * (the robot is then disabled because it is unreachable).
+ */
+void Match_Update (void)
+{
+    MatchContext* ctx = get_context();
+    uint64_t now = DS_GetTimeMs();
+    int finished = 0;
+
+    DS_FMSMatch match;
+    CFG_GetFMSMatch (&match);
+    int fms = CFG_GetFMSCommunications() == 1;
+    int enabled = CFG_GetRobotEnabled() == 1;
+    int teleop = CFG_GetControlMode() == DS_CONTROL_TELEOPERATED;
+    int robot = CFG_GetRobotCommunications() == 1;
+
+    DS_MutexLock (&ctx->mutex);
+    if (ctx->active) {
+        if (enabled && teleop)
+            ctx->teleop_seen = 1;
+
+        if (!fms || match_changed (ctx, &match) ||
+                (ctx->teleop_seen && !enabled && robot)) {
+            finish_match (ctx, now);
+            finished = 1;
+        }
+    }
+
+    if (!ctx->active && fms && enabled)
+        start_match (ctx, &match, now);
+    DS_MutexUnlock (&ctx->mutex);
+
+    if (finished) {
+        DS_Event event;
+        event.type = DS_MATCH_FINISHED;
+        DS_AddEvent (&event);
+    }
+}
+
+/**
+ * Counts a packet sent to the robot
+ */
+void Match_PacketSent (void)
+{
+    MatchContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    if (ctx->active)
+        ++ctx->current.sent;
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Counts a reply of the robot, which arrived \a usecs after the packet
+ */
+void Match_RoundTrip (const uint32_t usecs)
+{
+    MatchContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    if (ctx->active) {
+        ++ctx->replies;
+        DS_HistogramRecord (&ctx->round_trip, usecs);
+    }
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Adds a robot \a voltage to the minimum and average, and counts a
+ * brownout when it falls below the brownout threshold. The brownout ends
+ * once the voltage recovers above the warning level.
+ */
+void Match_AddVoltage (const float voltage)
+{
+    MatchContext* ctx = get_context();
+    float threshold = DS_GetBrownoutThreshold();
+
+    if (voltage <= 0)
+        return;
+
+    DS_MutexLock (&ctx->mutex);
+    if (ctx->active) {
+        DS_MatchSummary* current = &ctx->current;
+
+        if (ctx->voltage_samples == 0 || voltage < current->min_voltage)
+            current->min_voltage = voltage;
+
+        ctx->voltage_sum += voltage;
+        ++ctx->voltage_samples;
+
+        if (!ctx->in_brownout && voltage < threshold) {
+            ctx->in_brownout = 1;
+            ++current->brownouts;
+        }
+
+        else if (voltage > threshold + DS_BROWNOUT_MARGIN)
+            ctx->in_brownout = 0;
+    }
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Counts a loss of the robot \a communications and the time until they
+ * come back
+ */
+void Match_CommsChanged (const int communications)
+{
+    MatchContext* ctx = get_context();
+    uint64_t now = DS_GetTimeMs();
+
+    DS_MutexLock (&ctx->mutex);
+    if (ctx->active) {
+        if (!communications && ctx->comms_lost_since == 0) {
+            ++ctx->current.comms_drops;
+            ctx->comms_lost_since = now;
+        }
+
+        else if (communications && ctx->comms_lost_since > 0) {
+            ctx->current.comms_lost_time += (int) (now - ctx->comms_lost_since);
+            ctx->comms_lost_since = 0;
+        }
+    }
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Updates the peak CPU usage or CAN utilization with a \a percent value
+ * reported by the robot (the other metrics are ignored)
+ */
+void Match_AddSample (const DS_HistoryMetric metric, const int percent)
+{
+    MatchContext* ctx = get_context();
+    int value = DS_Max (DS_Min (percent, 100), 0);
+
+    DS_MutexLock (&ctx->mutex);
+    if (ctx->active) {
+        if (metric == DS_HISTORY_CPU_USAGE)
+            ctx->current.max_cpu = DS_Max (ctx->current.max_cpu, value);
+        else if (metric == DS_HISTORY_CAN_UTILIZATION)
+            ctx->current.max_can = DS_Max (ctx->current.max_can, value);
+    }
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Returns \c 1 if a match is being played, \c 0 if not
+ */
+int DS_MatchActive (void)
+{
+    MatchContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    int active = ctx->active;
+    DS_MutexUnlock (&ctx->mutex);
+
+    return active;
+}
+
+/**
+ * Clears the summaries of the finished matches (the current match is still
+ * tracked)
+ */
+void DS_ClearMatchSummaries (void)
+{
+    MatchContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    ctx->count = 0;
+    ctx->newest = 0;
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Copies the summary of the match that is being played (as if it ended
+ * now) to \a summary
+ *
+ * \returns \c 1 if a match is being played, \c 0 if not
+ */
+int DS_GetCurrentMatch (DS_MatchSummary* summary)
+{
+    MatchContext* ctx = get_context();
+
+    assert (summary);
+
+    DS_MutexLock (&ctx->mutex);
+    int active = ctx->active;
+    if (active)
+        fill_summary (ctx, summary, DS_GetTimeMs());
+    DS_MutexUnlock (&ctx->mutex);
+
+    return active;
+}
+
+/**
+ * Copies up to \a max summaries of finished matches (newest first) to
+ * \a summaries
+ *
+ * \returns the number of copied summaries
+ */
+int DS_GetMatchSummaries (DS_MatchSummary* summaries, const int max)
+{
+    int i;
+    int count;
+    MatchContext* ctx = get_context();
+
+    assert (summaries || max <= 0);
+
+    DS_MutexLock (&ctx->mutex);
+    count = DS_Min (ctx->count, max);
+    for (i = 0; i < count; ++i) {
+        int index = (ctx->newest - i + DS_MATCH_HISTORY) % DS_MATCH_HISTORY;
+        summaries [i] = ctx->history [index];
+    }
+    DS_MutexUnlock (&ctx->mutex);
+
+    return DS_Max (count, 0);
+}
@@ -0,0 +1,442 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Utils.h"
+#include "DS_Thread.h"
+
+#include <assert.h>
+#include <string.h>
+
+#if defined DS_TRACK_MEMORY
+
+/*
+ * Every tracked block is preceded by this header, the union keeps the
+ * user data aligned for any type
+ */
+typedef union {
+    struct {
+        size_t size;
+        DS_MemorySubsystem subsystem;
+    } info;
+
+    void* ptr;
+    double dbl;
+    long double ldbl;
+} BlockHeader;
+
+/*
+ * Allocation counters of every subsystem
+ */
+static DS_MemoryStats stats [DS_MEMORY_SUBSYSTEM_COUNT];
+static DS_Mutex stats_mutex = DS_MUTEX_INITIALIZER;
+
+#if defined DS_STATIC_MEMORY
+
+/*
+ * Size of the static pool used instead of the heap, the default is enough
+ * for one context with the buffer sizes of the embedded profile (see
+ * LibDS.pri), which uses ~145 KB of it
+ */
+#ifndef DS_STATIC_POOL_SIZE
+    #define DS_STATIC_POOL_SIZE (192 * 1024)
+#endif
+
+/*
+ * Every chunk of the pool starts with this header, chunks are contiguous,
+ * so the next chunk is found by adding the size of the current one
+ */
+typedef union {
+    struct {
+        size_t size;
+        size_t used;
+    } info;
+
+    void* ptr;
+    double dbl;
+    long double ldbl;
+} ChunkHeader;
+
+#define POOL_CHUNKS (DS_STATIC_POOL_SIZE / sizeof (ChunkHeader))
+#define POOL_END    (pool + POOL_CHUNKS)
+
+/*
+ * The pool and its usage counters
+ */
+static ChunkHeader pool [POOL_CHUNKS];
+static DS_MemoryStats pool_stats;
+static DS_Mutex pool_mutex = DS_MUTEX_INITIALIZER;
+
+/**
+ * Returns the chunk that follows the given \a chunk
+ */
+static ChunkHeader* next_chunk (ChunkHeader* chunk)
+{
+    return chunk + chunk->info.size / sizeof (ChunkHeader);
+}
+
+/**
+ * Appends the free chunks that follow the given \a chunk to it, this is
+ * how freed chunks are merged (lazily, when the pool is searched)
+ */
+static void merge_chunks (ChunkHeader* chunk)
+{
+    ChunkHeader* next = next_chunk (chunk);
+    while (next < POOL_END && !next->info.used) {
+        chunk->info.size += next->info.size;
+        next = next_chunk (chunk);
+    }
+}
+
+/**
+ * Shrinks the given \a chunk to \a size bytes (if the remainder is large
+ * enough to hold another chunk) and marks it as used
+ */
+static void take_chunk (ChunkHeader* chunk, const size_t size)
+{
+    if (chunk->info.size >= size + 2 * sizeof (ChunkHeader)) {
+        ChunkHeader* rest = chunk + size / sizeof (ChunkHeader);
+        rest->info.size = chunk->info.size - size;
+        rest->info.used = 0;
+        chunk->info.size = size;
+    }
+
+    if (!chunk->info.used) {
+        pool_stats.live_allocations += 1;
+        pool_stats.total_allocations += 1;
+    }
+
+    chunk->info.used = 1;
+}
+
+/**
+ * Returns the size of a chunk able to hold \a size bytes
+ */
+static size_t chunk_size (const size_t size)
+{
+    size_t chunks = (size + sizeof (ChunkHeader) - 1) / sizeof (ChunkHeader);
+    return (chunks + 1) * sizeof (ChunkHeader);
+}
+
+/**
+ * Updates the usage counters after a chunk changed from \a old_size to
+ * \a new_size bytes (a size of \c 0 means that there was no chunk)
+ */
+static void update_pool_stats (const size_t old_size, const size_t new_size)
+{
+    pool_stats.live_bytes = pool_stats.live_bytes - old_size + new_size;
+    pool_stats.peak_bytes = DS_Max (pool_stats.peak_bytes,
+                                    pool_stats.live_bytes);
+}
+
+/**
+ * Allocates a block of \a size bytes from the static pool (first fit),
+ * returns \c NULL if the pool is exhausted
+ */
+static void* pool_alloc (const size_t size)
+{
+    void* ptr = NULL;
+    size_t needed = chunk_size (size);
+
+    DS_MutexLock (&pool_mutex);
+
+    if (!pool [0].info.size)
+        pool [0].info.size = sizeof (pool);
+
+    ChunkHeader* chunk;
+    for (chunk = pool; chunk < POOL_END; chunk = next_chunk (chunk)) {
+        if (chunk->info.used)
+            continue;
+
+        merge_chunks (chunk);
+        if (chunk->info.size >= needed) {
+            take_chunk (chunk, needed);
+            update_pool_stats (0, chunk->info.size);
+            ptr = chunk + 1;
+            break;
+        }
+    }
+
+    DS_MutexUnlock (&pool_mutex);
+
+    if (!ptr)
+        fprintf (stderr, "LibDS: static pool exhausted (%lu bytes)\n",
+                 (unsigned long) size);
+
+    return ptr;
+}
+
+/**
+ * Returns the given block to the static pool
+ */
+static void pool_free (void* ptr)
+{
+    DS_MutexLock (&pool_mutex);
+
+    ChunkHeader* chunk = (ChunkHeader*) ptr - 1;
+    chunk->info.used = 0;
+    pool_stats.live_allocations -= 1;
+    update_pool_stats (chunk->info.size, 0);
+
+    DS_MutexUnlock (&pool_mutex);
+}
+
+/**
+ * Resizes the given block to \a size bytes, the block grows in place when
+ * it is followed by enough free space, otherwise it is moved
+ */
+static void* pool_realloc (void* ptr, const size_t size)
+{
+    size_t needed = chunk_size (size);
+    ChunkHeader* chunk = (ChunkHeader*) ptr - 1;
+
+    DS_MutexLock (&pool_mutex);
+
+    size_t old_size = chunk->info.size;
+    merge_chunks (chunk);
+
+    if (chunk->info.size >= needed)
+        take_chunk (chunk, needed);
+
+    update_pool_stats (old_size, chunk->info.size);
+    DS_MutexUnlock (&pool_mutex);
+
+    if (chunk->info.size >= needed)
+        return ptr;
+
+    void* block = pool_alloc (size);
+    if (block) {
+        memcpy (block, ptr, old_size - sizeof (ChunkHeader));
+        pool_free (ptr);
+    }
+
+    return block;
+}
+
+/*
+ * Blocks are taken from the static pool
+ */
+#define BLOCK_ALLOC(size)       pool_alloc (size)
+#define BLOCK_REALLOC(ptr,size) pool_realloc (ptr, size)
+#define BLOCK_FREE(ptr)         pool_free (ptr)
+
+#else
+
+/*
+ * Blocks are taken from the heap
+ */
+#define BLOCK_ALLOC(size)       malloc (size)
+#define BLOCK_REALLOC(ptr,size) realloc (ptr, size)
+#define BLOCK_FREE(ptr)         free (ptr)
+
+#endif
+
+/**
+ * Registers a new block of \a size bytes owned by the given \a subsystem
+ */
+static void register_block (const DS_MemorySubsystem subsystem,
+                            const size_t size)
+{
+    DS_MutexLock (&stats_mutex);
+    DS_MemoryStats* s = &stats [subsystem];
+    s->live_bytes += size;
+    s->live_allocations += 1;
+    s->total_allocations += 1;
+    s->peak_bytes = DS_Max (s->peak_bytes, s->live_bytes);
+    DS_MutexUnlock (&stats_mutex);
+}
+
+/**
+ * Removes the block of \a size bytes from the counters of its \a subsystem
+ */
+static void unregister_block (const DS_MemorySubsystem subsystem,
+                              const size_t size)
+{
+    DS_MutexLock (&stats_mutex);
+    stats [subsystem].live_bytes -= size;
+    stats [subsystem].live_allocations -= 1;
+    DS_MutexUnlock (&stats_mutex);
+}
+
+/**
+ * Updates the counters of the given \a subsystem after one of its blocks
+ * was resized from \a old_size to \a new_size bytes
+ */
+static void resize_block (const DS_MemorySubsystem subsystem,
+                          const size_t old_size,
+                          const size_t new_size)
+{
+    DS_MutexLock (&stats_mutex);
+    DS_MemoryStats* s = &stats [subsystem];
+    s->live_bytes = s->live_bytes - old_size + new_size;
+    s->peak_bytes = DS_Max (s->peak_bytes, s->live_bytes);
+    DS_MutexUnlock (&stats_mutex);
+}
+
+/**
+ * Allocates \a size bytes for the given \a subsystem, if \a zero is set,
+ * the memory is filled with zeroes
+ */
+void* DS_Allocate (const DS_MemorySubsystem subsystem,
+                   const size_t size,
+                   const int zero)
+{
+    assert (subsystem < DS_MEMORY_SUBSYSTEM_COUNT);
+
+    BlockHeader* header = (BlockHeader*) BLOCK_ALLOC (sizeof (BlockHeader) + size);
+    if (!header)
+        return NULL;
+
+    if (zero)
+        memset (header + 1, 0, size);
+
+    header->info.size = size;
+    header->info.subsystem = subsystem;
+    register_block (subsystem, size);
+
+    return header + 1;
+}
+
+/**
+ * Changes the size of the block pointed by \a ptr to \a size bytes, the block
+ * keeps its original subsystem. If \a ptr is \c NULL, a new block is
+ * allocated for the given \a subsystem
+ */
+void* DS_Reallocate (const DS_MemorySubsystem subsystem,
+                     void* ptr,
+                     const size_t size)
+{
+    if (!ptr)
+        return DS_Allocate (subsystem, size, 0);
+
+    BlockHeader* header = (BlockHeader*) ptr - 1;
+    size_t old_size = header->info.size;
+    DS_MemorySubsystem owner = header->info.subsystem;
+
+    BlockHeader* block = (BlockHeader*) BLOCK_REALLOC (header,
+                                                       sizeof (BlockHeader) + size);
+    if (!block)
+        return NULL;
+
+    block->info.size = size;
+    resize_block (owner, old_size, size);
+
+    return block + 1;
+}
+
+/**
+ * De-allocates a block obtained with \c DS_Allocate() or
+ * \c DS_Reallocate()
+ */
+void DS_Deallocate (void* ptr)
+{
+    if (ptr) {
+        BlockHeader* header = (BlockHeader*) ptr - 1;
+        unregister_block (header->info.subsystem, header->info.size);
+        BLOCK_FREE (header);
+    }
+}
+
+#endif
+
+/**
+ * Copies the allocation counters of the given \a subsystem into \a info.
+ *
+ * If the LibDS was built without \c DS_TRACK_MEMORY, all counters are 0.
+ */
+void DS_GetMemoryStats (const DS_MemorySubsystem subsystem,
+                        DS_MemoryStats* info)
+{
+    assert (info);
+    assert (subsystem < DS_MEMORY_SUBSYSTEM_COUNT);
+
+    memset (info, 0, sizeof (DS_MemoryStats));
+
+#if defined DS_TRACK_MEMORY
+    DS_MutexLock (&stats_mutex);
+    *info = stats [subsystem];
+    DS_MutexUnlock (&stats_mutex);
+#endif
+}
+
+/**
+ * Copies the usage counters of the static pool into \a info, the peak bytes
+ * (including the chunk headers) are the heap footprint of the LibDS.
+ *
+ * If the LibDS was built without \c DS_STATIC_MEMORY, all counters are 0.
+ *
+ * \returns the size of the static pool in bytes
+ */
+size_t DS_GetStaticPoolStats (DS_MemoryStats* info)
+{
+    assert (info);
+
+    memset (info, 0, sizeof (DS_MemoryStats));
+
+#if defined DS_STATIC_MEMORY
+    DS_MutexLock (&pool_mutex);
+    *info = pool_stats;
+    DS_MutexUnlock (&pool_mutex);
+    return sizeof (pool);
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Prints the live bytes and allocations of every subsystem to \c stderr.
+ * This is called by \c DS_Close() in builds with \c DS_TRACK_MEMORY, so
+ * any block that is still alive at that point is a leak.
+ */
+void DS_PrintMemoryStats (void)
+{
+#if defined DS_TRACK_MEMORY
+    const char* names [DS_MEMORY_SUBSYSTEM_COUNT] = {
+        "General", "Strings", "Queues", "Arrays"
+    };
+
+    int i;
+    for (i = 0; i < DS_MEMORY_SUBSYSTEM_COUNT; ++i) {
+        DS_MemoryStats s;
+        DS_GetMemoryStats ((DS_MemorySubsystem) i, &s);
+        fprintf (stderr,
+                 "LibDS: %-8s %8lu live bytes, %6lu live allocations "
+                 "(%lu total, %lu peak bytes)\n",
+                 names [i],
+                 (unsigned long) s.live_bytes,
+                 (unsigned long) s.live_allocations,
+                 (unsigned long) s.total_allocations,
+                 (unsigned long) s.peak_bytes);
+    }
+#endif
+
+#if defined DS_STATIC_MEMORY
+    DS_MemoryStats pool_info;
+    size_t pool_size = DS_GetStaticPoolStats (&pool_info);
+    fprintf (stderr,
+             "LibDS: Pool     %8lu live bytes, %8lu peak bytes "
+             "(%lu byte pool)\n",
+             (unsigned long) pool_info.live_bytes,
+             (unsigned long) pool_info.peak_bytes,
+             (unsigned long) pool_size);
+#endif
+}
@@ -0,0 +1,406 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Utils.h"
+#include "DS_Timer.h"
+#include "DS_Thread.h"
+#include "DS_Context.h"
+#include "DS_Messages.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Length (in msecs) of the window in which the messages are rate limited
+ */
+#define RATE_WINDOW 1000
+
+/*
+ * A remembered error or warning:
+ *
+ * - \c hash and \c len identify the complete text (the message only keeps
+ *   its first bytes)
+ * - \c pending counts the repeats that were not reported in the NetConsole
+ *   yet, \c reported is the time (in msecs) of the last report
+ */
+typedef struct {
+    uint32_t hash;
+    size_t len;
+    uint64_t pending;
+    uint64_t reported;
+    DS_RobotMessage message;
+} Entry;
+
+/*
+ * Robot message state of a DS context, the messages are added by the event
+ * loop and read by the application, the mutex protects the whole state
+ */
+typedef struct {
+    int count;
+    uint64_t window;
+    size_t window_count;
+    size_t window_dropped;
+    DS_RobotMessageStats stats;
+    Entry entries [DS_ROBOT_MESSAGES_MAX];
+    DS_Mutex mutex;
+} MessagesContext;
+
+/**
+ * Initializes the robot message state of a new context
+ */
+static void init_context (void* data)
+{
+    MessagesContext* ctx = (MessagesContext*) data;
+    DS_MutexInit (&ctx->mutex);
+}
+
+/**
+ * Releases the robot message state of a context
+ */
+static void destroy_context (void* data)
+{
+    MessagesContext* ctx = (MessagesContext*) data;
+    DS_MutexDestroy (&ctx->mutex);
+}
+
+/**
+ * Returns the robot message state of the current context
+ */
+static MessagesContext* get_context (void)
+{
+    return (MessagesContext*) DS_ContextData (DS_CONTEXT_MESSAGES,
+                                              sizeof (MessagesContext),
+                                              init_context, destroy_context);
+}
+
+/**
+ * Starts a new rate window if the current one is over, and reports the
+ * messages that were dropped in the previous window
+ */
+static void update_window (MessagesContext* ctx, const uint64_t now)
+{
+    int len;
+    char text [128];
+
+    if (now >= ctx->window && now - ctx->window < RATE_WINDOW)
+        return;
+
+    if (ctx->window_dropped > 0) {
+        len = snprintf (text, sizeof (text),
+                        "Dropped %lu robot messages (more than %d per second)",
+                        (unsigned long) ctx->window_dropped,
+                        DS_ROBOT_MESSAGES_RATE);
+        DS_NetConsoleAppendEntry (DS_NETCONSOLE_SOURCE_LIBDS,
+                                  DS_NETCONSOLE_SEVERITY_WARNING,
+                                  text, (size_t) len);
+    }
+
+    ctx->window = now;
+    ctx->window_count = 0;
+    ctx->window_dropped = 0;
+}
+
+/**
+ * Counts a received message, returns \c 0 if the message must be dropped
+ * because too many messages were processed in the current window
+ */
+static int admit (MessagesContext* ctx, const uint64_t now)
+{
+    update_window (ctx, now);
+    ++ctx->stats.received;
+
+    if (ctx->window_count >= DS_ROBOT_MESSAGES_RATE) {
+        ++ctx->window_dropped;
+        ++ctx->stats.dropped;
+        return 0;
+    }
+
+    ++ctx->window_count;
+    return 1;
+}
+
+/**
+ * Appends a space and the given \a field to the \a text (of the given
+ * \a size), returns the new length of the text
+ */
+static size_t append_field (char* text, size_t len, const size_t size,
+                            const char* field, size_t field_len)
+{
+    if (!field || field_len == 0 || len + 1 >= size)
+        return len;
+
+    field_len = DS_Min (field_len, size - len - 2);
+    text [len] = ' ';
+    memcpy (text + len + 1, field, field_len);
+    len += field_len + 1;
+    text [len] = '\0';
+
+    return len;
+}
+
+/**
+ * Stores a line that summarizes the unreported repeats of the given entry
+ */
+static void report_repeats (Entry* entry, const uint64_t now)
+{
+    int len;
+    char text [DS_ROBOT_MESSAGE_SIZE + 48];
+
+    len = snprintf (text, sizeof (text), "%s (repeated %lu times)",
+                    entry->message.text, (unsigned long) entry->pending);
+    len = DS_Min (len, (int) sizeof (text) - 1);
+    DS_NetConsoleAppendEntry (DS_NETCONSOLE_SOURCE_ROBOT,
+                              entry->message.severity,
+                              text, (size_t) len);
+
+    entry->pending = 0;
+    entry->reported = now;
+}
+
+/**
+ * Returns the remembered entry with the given text, or \c NULL if the
+ * message is new
+ */
+static Entry* find_entry (MessagesContext* ctx,
+                          const DS_NetConsoleSeverity severity,
+                          const int code,
+                          const char* text,
+                          const size_t len,
+                          const uint32_t hash)
+{
+    int i;
+    Entry* entry;
+
+    for (i = 0; i < ctx->count; ++i) {
+        entry = &ctx->entries [i];
+        if (entry->hash == hash && entry->len == len &&
+                entry->message.code == code &&
+                entry->message.severity == severity &&
+                strncmp (entry->message.text, text, DS_ROBOT_MESSAGE_SIZE - 1) == 0)
+            return entry;
+    }
+
+    return NULL;
+}
+
+/**
+ * Returns a free entry, the least recently seen entry is forgotten (after
+ * reporting its repeats) if every entry is used
+ */
+static Entry* new_entry (MessagesContext* ctx, const uint64_t now)
+{
+    int i;
+    Entry* oldest;
+
+    if (ctx->count < DS_ROBOT_MESSAGES_MAX)
+        return &ctx->entries [ctx->count++];
+
+    oldest = &ctx->entries [0];
+    for (i = 1; i < ctx->count; ++i) {
+        if (ctx->entries [i].message.last_time < oldest->message.last_time)
+            oldest = &ctx->entries [i];
+    }
+
+    if (oldest->pending > 0)
+        report_repeats (oldest, now);
+
+    ++ctx->stats.forgotten;
+    return oldest;
+}
+
+/**
+ * Stores the repeats of the errors and warnings that were not reported
+ * recently and the number of dropped messages, called by the event loop
+ */
+void Messages_Update (void)
+{
+    int i;
+    uint64_t now = DS_GetTimeMs();
+    MessagesContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    update_window (ctx, now);
+
+    for (i = 0; i < ctx->count; ++i) {
+        if (ctx->entries [i].pending > 0 &&
+                now - ctx->entries [i].reported >= DS_ROBOT_MESSAGES_REPEAT_INTERVAL)
+            report_repeats (&ctx->entries [i], now);
+    }
+
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Clears the counters of the robot messages
+ */
+void Messages_ResetStats (void)
+{
+    MessagesContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    memset (&ctx->stats, 0, sizeof (ctx->stats));
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Writes the counters of the robot messages to the given \a stats
+ */
+void Messages_GetStats (DS_RobotMessageStats* stats)
+{
+    MessagesContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    *stats = ctx->stats;
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Stores the given standard output of the robot program in the NetConsole
+ * (unless the rate limit is exceeded)
+ */
+void Messages_AddOutput (const char* text, const size_t len)
+{
+    MessagesContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    if (admit (ctx, DS_GetTimeMs()) && text && len > 0)
+        DS_NetConsoleAppendEntry (DS_NETCONSOLE_SOURCE_ROBOT,
+                                  DS_NETCONSOLE_SEVERITY_INFO, text, len);
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Registers an error (or a warning, if \a error is \c 0) reported by the
+ * robot program, with the given \a code, \a details and \a location.
+ *
+ * The first occurrence of the message is stored in the NetConsole, its
+ * repeats are counted and summarized later (see \c Messages_Update())
+ */
+void Messages_AddError (const int error, const int code,
+                        const char* details, const size_t details_len,
+                        const char* location, const size_t location_len)
+{
+    size_t len;
+    Entry* entry;
+    uint32_t hash;
+    char text [DS_NETCONSOLE_LINE_SIZE];
+    uint64_t now = DS_GetTimeMs();
+    MessagesContext* ctx = get_context();
+    DS_NetConsoleSeverity severity = error ? DS_NETCONSOLE_SEVERITY_ERROR :
+                                     DS_NETCONSOLE_SEVERITY_WARNING;
+
+    DS_MutexLock (&ctx->mutex);
+    if (!admit (ctx, now)) {
+        DS_MutexUnlock (&ctx->mutex);
+        return;
+    }
+
+    /* Build the line, the same way it is displayed */
+    len = (size_t) snprintf (text, sizeof (text), "%s %d:",
+                             error ? "ERROR" : "Warning", code);
+    len = append_field (text, len, sizeof (text), details, details_len);
+    len = append_field (text, len, sizeof (text), location, location_len);
+    hash = DS_CRC32 (text, len);
+
+    /* The message was already seen, only count it */
+    entry = find_entry (ctx, severity, code, text, len, hash);
+    if (entry) {
+        ++entry->pending;
+        ++entry->message.count;
+        ++ctx->stats.duplicates;
+        entry->message.last_time = DS_GetWallTimeUs();
+    }
+
+    /* Remember the new message and store it */
+    else {
+        entry = new_entry (ctx, now);
+        entry->hash = hash;
+        entry->len = len;
+        entry->pending = 0;
+        entry->reported = now;
+        entry->message.code = code;
+        entry->message.severity = severity;
+        entry->message.count = 1;
+        entry->message.first_time = DS_GetWallTimeUs();
+        entry->message.last_time = entry->message.first_time;
+        memcpy (entry->message.text, text, DS_Min (len, DS_ROBOT_MESSAGE_SIZE - 1));
+        entry->message.text [DS_Min (len, DS_ROBOT_MESSAGE_SIZE - 1)] = '\0';
+
+        DS_NetConsoleAppendEntry (DS_NETCONSOLE_SOURCE_ROBOT, severity,
+                                  text, len);
+    }
+
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Forgets the errors and warnings of the robot program, their unreported
+ * repeats are not stored in the NetConsole
+ */
+void DS_ClearRobotMessages (void)
+{
+    MessagesContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->mutex);
+    ctx->count = 0;
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Copies up to \a max distinct errors and warnings of the robot program to
+ * the given \a messages (the most recently seen first), along with their
+ * number of occurrences and the time of their first and last occurrence.
+ *
+ * \returns the number of copied messages
+ */
+int DS_GetRobotMessages (DS_RobotMessage* messages, const int max)
+{
+    int i;
+    int j;
+    int count;
+    MessagesContext* ctx = get_context();
+
+    if (!messages || max <= 0)
+        return 0;
+
+    DS_MutexLock (&ctx->mutex);
+
+    /* Insert each message in order, keeping the first max messages */
+    count = 0;
+    for (i = 0; i < ctx->count; ++i) {
+        const DS_RobotMessage* message = &ctx->entries [i].message;
+
+        if (count == max && messages [max - 1].last_time >= message->last_time)
+            continue;
+
+        j = DS_Min (count, max - 1);
+        for (; j > 0 && messages [j - 1].last_time < message->last_time; --j)
+            messages [j] = messages [j - 1];
+
+        messages [j] = *message;
+        count = DS_Min (count + 1, max);
+    }
+
+    DS_MutexUnlock (&ctx->mutex);
+    return count;
+}
@@ -0,0 +1,464 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Utils.h"
+#include "DS_Atomic.h"
+#include "DS_Config.h"
+#include "DS_Context.h"
+#include "DS_Metrics.h"
+#include "DS_Protocol.h"
+#include "DS_Histogram.h"
+#include "DS_Thread.h"
+
+#include <socky.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <assert.h>
+
+#if !defined _WIN32
+    #include <sys/select.h>
+#endif
+
+#define ACCEPT_WAIT     100  /* Time (in msecs) between stop flag checks */
+#define REQUEST_TIMEOUT 1000 /* Time (in msecs) to receive a request */
+#define REQUEST_SIZE    1024 /* Maximum size of a request */
+
+#if defined MSG_NOSIGNAL
+    #define SEND_FLAGS MSG_NOSIGNAL
+#else
+    #define SEND_FLAGS 0
+#endif
+
+/*
+ * Upper bounds (in seconds) of the exported latency histogram buckets
+ */
+static const double bucket_bounds[] = {
+    0.0005, 0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.25, 0.5, 1
+};
+
+/*
+ * Metrics server state of a DS context, the server thread renders the
+ * metrics in the buffer, so that a scrape never allocates memory
+ */
+typedef struct {
+    volatile size_t running;
+    int server;
+    DS_Thread thread;
+    char buffer [DS_METRICS_BUFFER_SIZE];
+} MetricsContext;
+
+/*
+ * Appends formatted text to a fixed-size buffer
+ */
+typedef struct {
+    char* buf;
+    size_t size;
+    size_t len;
+    int overflow;
+} MetricsWriter;
+
+/**
+ * Returns the metrics state of the current DS context
+ */
+static MetricsContext* get_context (void)
+{
+    return (MetricsContext*) DS_ContextData (DS_CONTEXT_METRICS,
+                                             sizeof (MetricsContext),
+                                             NULL, NULL);
+}
+
+/**
+ * Appends the given formatted text to the \a writer, the writer stops
+ * appending text once the buffer is full
+ */
+static void append (MetricsWriter* writer, const char* format, ...)
+{
+    int len;
+    va_list args;
+
+    if (writer->overflow)
+        return;
+
+    va_start (args, format);
+    len = vsnprintf (writer->buf + writer->len, writer->size - writer->len,
+                     format, args);
+    va_end (args);
+
+    if (len < 0 || (size_t) len >= writer->size - writer->len)
+        writer->overflow = 1;
+    else
+        writer->len += (size_t) len;
+}
+
+/**
+ * Appends the HELP and TYPE lines of a metric
+ */
+static void write_header (MetricsWriter* writer, const char* name,
+                          const char* type, const char* help)
+{
+    append (writer, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/**
+ * Appends a gauge with a single value
+ */
+static void write_gauge (MetricsWriter* writer, const char* name,
+                         const char* help, const double value)
+{
+    write_header (writer, name, "gauge", help);
+    append (writer, "%s %g\n", name, value);
+}
+
+/**
+ * Appends a metric with one value per network channel
+ */
+static void write_channels (MetricsWriter* writer, const char* name,
+                            const char* type, const char* help,
+                            const double fms, const double radio,
+                            const double robot)
+{
+    write_header (writer, name, type, help);
+    append (writer, "%s{channel=\"fms\"} %g\n", name, fms);
+    append (writer, "%s{channel=\"radio\"} %g\n", name, radio);
+    append (writer, "%s{channel=\"robot\"} %g\n", name, robot);
+}
+
+/**
+ * Appends the buckets, sum and count of the given \a histogram (which holds
+ * values in microseconds) as a histogram in seconds
+ */
+static void write_histogram (MetricsWriter* writer, const char* name,
+                             const char* help, const DS_Histogram* histogram)
+{
+    size_t i;
+
+    write_header (writer, name, "histogram", help);
+    for (i = 0; i < sizeof (bucket_bounds) / sizeof (bucket_bounds [0]); ++i) {
+        uint32_t value = (uint32_t) (bucket_bounds [i] * 1000000);
+        append (writer, "%s_bucket{le=\"%g\"} %u\n", name, bucket_bounds [i],
+                DS_HistogramCountBelow (histogram, value));
+    }
+
+    append (writer, "%s_bucket{le=\"+Inf\"} %u\n", name, histogram->total);
+    append (writer, "%s_sum %.6f\n", name, (double) histogram->sum / 1000000);
+    append (writer, "%s_count %u\n", name, histogram->total);
+}
+
+/**
+ * Waits up to \a millisecs for the given socket to become readable
+ *
+ * \returns \c 1 if the socket is readable, \c 0 if not
+ */
+static int wait_readable (const int sfd, const int millisecs)
+{
+    fd_set set;
+    struct timeval timeout;
+
+    FD_ZERO (&set);
+    FD_SET (sfd, &set);
+    timeout.tv_sec = millisecs / 1000;
+    timeout.tv_usec = (millisecs % 1000) * 1000;
+
+    return select (sfd + 1, &set, NULL, NULL, &timeout) > 0;
+}
+
+/**
+ * Sends all the given bytes to the client
+ *
+ * \returns \c 1 on success, \c 0 if the client disconnected
+ */
+static int send_all (const int sfd, const char* buf, size_t len)
+{
+    while (len > 0) {
+        int sent = send (sfd, buf, (int) len, SEND_FLAGS);
+        if (sent <= 0)
+            return 0;
+
+        buf += sent;
+        len -= (size_t) sent;
+    }
+
+    return 1;
+}
+
+/**
+ * Reads the HTTP request of the given client and replies with the metrics
+ * (for any path), or with an error if the request is not a GET request
+ */
+static void serve_client (MetricsContext* ctx, const int client)
+{
+    int len = 0;
+    char header [160];
+    char request [REQUEST_SIZE];
+
+#if defined SO_NOSIGPIPE
+    int value = 1;
+    setsockopt (client, SOL_SOCKET, SO_NOSIGPIPE, &value, sizeof (value));
+#endif
+
+    /* Read the request until its headers end */
+    request [0] = '\0';
+    while (len < REQUEST_SIZE - 1 && !strstr (request, "\r\n\r\n")) {
+        if (!wait_readable (client, REQUEST_TIMEOUT))
+            return;
+
+        int bytes = recv (client, request + len, REQUEST_SIZE - 1 - len, 0);
+        if (bytes <= 0)
+            return;
+
+        len += bytes;
+        request [len] = '\0';
+    }
+
+    /* Only GET requests are supported */
+    if (strncmp (request, "GET ", 4) != 0) {
+        const char* error = "HTTP/1.0 405 Method Not Allowed\r\n"
+                            "Content-Length: 0\r\n"
+                            "Connection: close\r\n\r\n";
+        send_all (client, error, strlen (error));
+        return;
+    }
+
+    /* Render the metrics and send them */
+    size_t body = DS_RenderMetrics (ctx->buffer, sizeof (ctx->buffer));
+    int header_len = snprintf (header, sizeof (header),
+                               "HTTP/1.0 200 OK\r\n"
+                               "Content-Type: text/plain; version=0.0.4\r\n"
+                               "Content-Length: %lu\r\n"
+                               "Connection: close\r\n\r\n",
+                               (unsigned long) body);
+
+    if (send_all (client, header, (size_t) header_len))
+        send_all (client, ctx->buffer, body);
+}
+
+/**
+ * Accepts the scrape requests until the server is stopped, the requests are
+ * served one at a time (scrapes are rare and short)
+ */
+static void* run_server (void* context)
+{
+    DS_ContextMakeCurrent ((DS_Context*) context);
+    MetricsContext* ctx = get_context();
+
+    char host [64];
+    char service [16];
+
+    while (DS_AtomicLoad (&ctx->running)) {
+        if (!wait_readable (ctx->server, ACCEPT_WAIT))
+            continue;
+
+        int client = tcp_accept (ctx->server, host, sizeof (host),
+                                 service, sizeof (service),
+                                 NI_NUMERICHOST | NI_NUMERICSERV);
+        if (client < 0)
+            continue;
+
+        serve_client (ctx, client);
+        socket_close (client);
+    }
+
+    return NULL;
+}
+
+/**
+ * Stops the metrics server of the current context
+ */
+void Metrics_Close (void)
+{
+    DS_StopMetricsServer();
+}
+
+/**
+ * Starts a HTTP server that exports the state and network statistics of
+ * the DS in the Prometheus text format, so that a monitoring system can
+ * watch several driver stations (e.g. the practice robots of a team).
+ *
+ * The server accepts connections on all the IPv4 interfaces, and serves the
+ * metrics on any path (e.g. http://host:port/metrics). Each DS context can
+ * run its own server.
+ *
+ * \param port the TCP port on which the server listens
+ *
+ * \returns \c 1 on success, \c 0 if the port cannot be used
+ */
+int DS_StartMetricsServer (const int port)
+{
+    MetricsContext* ctx = get_context();
+    char service [12];
+
+    DS_StopMetricsServer();
+
+    snprintf (service, sizeof (service), "%d", port);
+    ctx->server = create_server_tcp (service, SOCKY_IPv4, 0);
+    if (ctx->server < 0)
+        return 0;
+
+    DS_AtomicStore (&ctx->running, 1);
+    if (DS_CreateThread (&ctx->thread, "DS Metrics", &run_server,
+                         DS_ContextCurrent()) != 0) {
+        DS_AtomicStore (&ctx->running, 0);
+        socket_close (ctx->server);
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Stops the metrics server (if it is running), shutting down the listener
+ * wakes the server thread on most systems, otherwise this can take up to
+ * \c ACCEPT_WAIT milliseconds
+ */
+void DS_StopMetricsServer (void)
+{
+    MetricsContext* ctx = get_context();
+
+    if (!DS_AtomicLoad (&ctx->running))
+        return;
+
+    DS_AtomicStore (&ctx->running, 0);
+    socket_shutdown (ctx->server, SOCKY_READ | SOCKY_WRITE);
+    DS_JoinThread (ctx->thread);
+    socket_close (ctx->server);
+}
+
+/**
+ * Returns \c 1 if the metrics server of the current context is running
+ */
+int DS_MetricsServerActive (void)
+{
+    return DS_AtomicLoad (&get_context()->running) != 0;
+}
+
+/**
+ * Writes the metrics of the current context to the given buffer, in the
+ * Prometheus text format. The metrics are rendered directly from the state
+ * and statistics of the DS, without allocating memory.
+ *
+ * \param buf the buffer in which the metrics are written
+ * \param size the size of the buffer (see \c DS_METRICS_BUFFER_SIZE)
+ *
+ * \returns the length of the rendered text, or \c 0 if the buffer is too
+ *          small to hold it
+ */
+size_t DS_RenderMetrics (char* buf, const size_t size)
+{
+    CFG_State state;
+    DS_Histogram jitter;
+    DS_Histogram round_trip;
+    MetricsWriter writer = {buf, size, 0, 0};
+
+    /* Check arguments */
+    assert (buf);
+
+    /* Get the current state and statistics */
+    CFG_GetState (&state);
+    DS_LossInfo fms_loss = DS_GetFMSLossInfo();
+    DS_LossInfo radio_loss = DS_GetRadioLossInfo();
+    DS_LossInfo robot_loss = DS_GetRobotLossInfo();
+    DS_LatencyInfo fms_latency = DS_GetFMSLatencyInfo();
+    DS_LatencyInfo radio_latency = DS_GetRadioLatencyInfo();
+    DS_LatencyInfo robot_latency = DS_GetRobotLatencyInfo();
+    DS_GetRobotLatencyHistograms (&round_trip, &jitter);
+
+    /* DS and robot state */
+    write_gauge (&writer, "libds_team", "Team number",
+                 state.team);
+    write_gauge (&writer, "libds_robot_communications",
+                 "Set to 1 if the robot is connected",
+                 state.robot_communications);
+    write_gauge (&writer, "libds_radio_communications",
+                 "Set to 1 if the radio is connected",
+                 state.radio_communications);
+    write_gauge (&writer, "libds_fms_communications",
+                 "Set to 1 if the FMS is connected",
+                 state.fms_communications);
+    write_gauge (&writer, "libds_robot_code",
+                 "Set to 1 if the robot code is running",
+                 state.robot_code);
+    write_gauge (&writer, "libds_robot_enabled",
+                 "Set to 1 if the robot is enabled",
+                 state.robot_enabled);
+    write_gauge (&writer, "libds_robot_emergency_stopped",
+                 "Set to 1 if the robot is emergency stopped",
+                 state.emergency_stopped);
+    write_gauge (&writer, "libds_robot_control_mode",
+                 "Control mode (0 = test, 1 = autonomous, 2 = teleoperated)",
+                 state.control_mode);
+    write_gauge (&writer, "libds_robot_voltage_volts",
+                 "Battery voltage of the robot",
+                 state.robot_voltage);
+    write_gauge (&writer, "libds_robot_cpu_percent",
+                 "CPU usage of the robot",
+                 state.cpu_usage);
+    write_gauge (&writer, "libds_robot_ram_percent",
+                 "RAM usage of the robot",
+                 state.ram_usage);
+    write_gauge (&writer, "libds_robot_disk_percent",
+                 "Disk usage of the robot",
+                 state.disk_usage);
+    write_gauge (&writer, "libds_robot_can_utilization_percent",
+                 "CAN bus utilization of the robot",
+                 state.can_utilization);
+
+    /* Network statistics */
+    write_channels (&writer, "libds_packets_sent_total", "counter",
+                    "Packets sent since the protocol was loaded",
+                    DS_SentFMSPackets(), DS_SentRadioPackets(),
+                    DS_SentRobotPackets());
+    write_channels (&writer, "libds_packets_received_total", "counter",
+                    "Packets received since the protocol was loaded",
+                    DS_ReceivedFMSPackets(), DS_ReceivedRadioPackets(),
+                    DS_ReceivedRobotPackets());
+    write_channels (&writer, "libds_bytes_sent_total", "counter",
+                    "Bytes sent since the protocol was loaded",
+                    DS_SentFMSBytes(), DS_SentRadioBytes(),
+                    DS_SentRobotBytes());
+    write_channels (&writer, "libds_bytes_received_total", "counter",
+                    "Bytes received since the protocol was loaded",
+                    DS_ReceivedFMSBytes(), DS_ReceivedRadioBytes(),
+                    DS_ReceivedRobotBytes());
+    write_channels (&writer, "libds_packet_loss_percent", "gauge",
+                    "Packet loss over the packet loss window",
+                    fms_loss.percent, radio_loss.percent, robot_loss.percent);
+    write_channels (&writer, "libds_packet_loss_streak", "gauge",
+                    "Consecutive packets lost most recently",
+                    fms_loss.streak, radio_loss.streak, robot_loss.streak);
+    write_channels (&writer, "libds_deadline_misses_total", "counter",
+                    "Sends more than two send intervals apart",
+                    fms_latency.deadline_misses,
+                    radio_latency.deadline_misses,
+                    robot_latency.deadline_misses);
+
+    /* Robot latency */
+    write_histogram (&writer, "libds_robot_round_trip_seconds",
+                     "Time between a robot packet and its reply",
+                     &round_trip);
+    write_histogram (&writer, "libds_robot_jitter_seconds",
+                     "Deviation of the robot packet inter-arrival time",
+                     &jitter);
+
+    return writer.overflow ? 0 : writer.len;
+}
@@ -0,0 +1,850 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Utils.h"
+#include "DS_Timer.h"
+#include "DS_Atomic.h"
+#include "DS_Events.h"
+#include "DS_Socket.h"
+#include "DS_Context.h"
+#include "DS_NetConsole.h"
+#include "DS_Thread.h"
+
+#include <string.h>
+#include <assert.h>
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+    #define DS_USE_SSE2
+    #include <emmintrin.h>
+#elif defined __ARM_NEON || defined __ARM_NEON__
+    #define DS_USE_NEON
+    #include <arm_neon.h>
+#endif
+
+/*
+ * Encoding of U+FFFD, which replaces the invalid UTF-8 sequences
+ */
+#define REPLACEMENT_CHAR     "\xEF\xBF\xBD"
+#define REPLACEMENT_CHAR_LEN 3
+
+/*
+ * Position, length and attributes of a stored line. Positions grow
+ * monotonically, the offset of the line in the arena is its position
+ * modulo the arena size.
+ */
+typedef struct {
+    uint64_t pos;
+    size_t len;
+    uint64_t time;
+    DS_NetConsoleSource source;
+    DS_NetConsoleSeverity severity;
+} LineIndex;
+
+/*
+ * NetConsole state of a DS context:
+ *
+ * - The arena holds the text of the stored lines, lines are never split
+ *   between the end and the start of the arena
+ * - Line N is stored at index N % DS_NETCONSOLE_MAX_LINES of the line index
+ * - \c first_line and \c next_line are the sequence numbers of the oldest
+ *   stored line and of the next line, \c write_pos is the position in which
+ *   the next line will be written
+ * - \c notified is set to 1 when a new-lines event is pending, and cleared
+ *   when the application reads the last stored line
+ * - If \c message_events is set to 1, a DS_NETCONSOLE_NEW_MESSAGE event is
+ *   registered for each received message (in addition to the
+ *   DS_NETCONSOLE_NEW_LINES events)
+ * - The messages of these events are stored in a slab of fixed buffers, a
+ *   buffer is in use from the moment the event is registered until the
+ *   event queue releases it (when the next event is polled, or when the
+ *   event is discarded)
+ * - The messages sent to the robot are queued in \c send_queue (separated by
+ *   new lines) until the event loop sends them, \c send_time is the time in
+ *   which the oldest queued message was added
+ * - Lines that must be cleaned (see \c read_line()) are written to
+ *   \c line before they are stored
+ * - The mutex protects the arena, the line index, the line buffer and the
+ *   message slab, the send mutex protects the outgoing queue
+ * - The remaining fields are the internal statistics (see DS_Stats.h), the
+ *   maximums are updated while the mutex is locked
+ */
+typedef struct {
+    char arena [DS_NETCONSOLE_ARENA_SIZE];
+    LineIndex line_index [DS_NETCONSOLE_MAX_LINES];
+    char line [DS_NETCONSOLE_LINE_SIZE];
+    uint64_t first_line;
+    uint64_t next_line;
+    uint64_t write_pos;
+    int notified;
+    int message_events;
+    char messages [DS_NETCONSOLE_MESSAGE_SLOTS][DS_NETCONSOLE_MESSAGE_SIZE];
+    int message_used [DS_NETCONSOLE_MESSAGE_SLOTS];
+    int next_message;
+    DS_Mutex mutex;
+    char send_queue [DS_NETCONSOLE_SEND_QUEUE_SIZE];
+    size_t send_len;
+    uint64_t send_time;
+    DS_Mutex send_mutex;
+    volatile size_t lines;
+    volatile size_t max_burst;
+    volatile size_t max_backlog;
+    volatile size_t lines_lost;
+    volatile size_t messages_dropped;
+    volatile size_t contentions;
+} NetConsoleContext;
+
+/**
+ * Initializes the NetConsole state of a new DS context
+ */
+static void init_context (void* data)
+{
+    NetConsoleContext* ctx = (NetConsoleContext*) data;
+
+    ctx->message_events = 1;
+    DS_MutexInit (&ctx->mutex);
+    DS_MutexInit (&ctx->send_mutex);
+}
+
+/**
+ * Releases the NetConsole state of a DS context
+ */
+static void destroy_context (void* data)
+{
+    NetConsoleContext* ctx = (NetConsoleContext*) data;
+    DS_MutexDestroy (&ctx->mutex);
+    DS_MutexDestroy (&ctx->send_mutex);
+}
+
+/**
+ * Returns the NetConsole state of the current DS context
+ */
+static NetConsoleContext* get_context (void)
+{
+    return (NetConsoleContext*) DS_ContextData (DS_CONTEXT_NETCONSOLE,
+                                                sizeof (NetConsoleContext),
+                                                init_context, destroy_context);
+}
+
+/**
+ * Removes the oldest stored line
+ */
+static void drop_oldest (void)
+{
+    NetConsoleContext* ctx = get_context();
+
+    if (ctx->first_line < ctx->next_line)
+        ++ctx->first_line;
+}
+
+/**
+ * Copies the given line into the arena, removing the oldest lines that are
+ * overwritten by it. The \a entry holds the attributes of the line (its
+ * position and length are set by this function). The mutex must be locked
+ * by the calling thread.
+ */
+static void store_line (const char* text, size_t len, LineIndex entry)
+{
+    NetConsoleContext* ctx = get_context();
+
+    /* Truncate long lines */
+    if (len > DS_NETCONSOLE_LINE_SIZE)
+        len = DS_NETCONSOLE_LINE_SIZE;
+
+    /* Line does not fit at the end of the arena, go back to the start */
+    size_t offset = (size_t) (ctx->write_pos % DS_NETCONSOLE_ARENA_SIZE);
+    if (offset + len > DS_NETCONSOLE_ARENA_SIZE) {
+        ctx->write_pos += DS_NETCONSOLE_ARENA_SIZE - offset;
+        offset = 0;
+    }
+
+    /* Remove the lines that will be overwritten */
+    uint64_t end = ctx->write_pos + len;
+    while (ctx->first_line < ctx->next_line &&
+            ctx->line_index [ctx->first_line % DS_NETCONSOLE_MAX_LINES].pos + DS_NETCONSOLE_ARENA_SIZE < end)
+        drop_oldest();
+
+    /* The line index is full, remove the oldest line */
+    if (ctx->next_line - ctx->first_line >= DS_NETCONSOLE_MAX_LINES)
+        drop_oldest();
+
+    /* Copy the line */
+    memcpy (ctx->arena + offset, text, len);
+    entry.pos = ctx->write_pos;
+    entry.len = len;
+    ctx->line_index [ctx->next_line % DS_NETCONSOLE_MAX_LINES] = entry;
+
+    /* Update positions */
+    ++ctx->next_line;
+    ctx->write_pos = end;
+}
+
+/**
+ * Returns the index of the first byte of \a data that is not printable
+ * ASCII (a control character, DEL or a non-ASCII byte), or \a len if all
+ * the bytes are printable. Robot output is mostly printable ASCII, so this
+ * is where the NetConsole text spends its time: SSE2 or NEON instructions
+ * are used (when available) to check 16 bytes at once.
+ */
+static size_t find_special (const char* data, const size_t len)
+{
+    size_t i = 0;
+
+#if defined DS_USE_SSE2
+    const __m128i space = _mm_set1_epi8 (0x20);
+    const __m128i del = _mm_set1_epi8 (0x7F);
+
+    /* Non-ASCII bytes are negative, so they are also less than a space */
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128 ((const __m128i*) (data + i));
+        __m128i special = _mm_or_si128 (_mm_cmplt_epi8 (v, space),
+                                        _mm_cmpeq_epi8 (v, del));
+
+        int mask = _mm_movemask_epi8 (special);
+        if (mask) {
+            while (!(mask & 1)) {
+                mask >>= 1;
+                ++i;
+            }
+
+            return i;
+        }
+    }
+#elif defined DS_USE_NEON
+    const int8x16_t space = vdupq_n_s8 (0x20);
+    const int8x16_t del = vdupq_n_s8 (0x7F);
+
+    /* Find the block that contains the byte, then the byte itself */
+    for (; i + 16 <= len; i += 16) {
+        int8x16_t v = vld1q_s8 ((const int8_t*) (data + i));
+        uint64x2_t special = vreinterpretq_u64_u8 (
+                                 vorrq_u8 (vcltq_s8 (v, space),
+                                           vceqq_s8 (v, del)));
+
+        if (vgetq_lane_u64 (special, 0) | vgetq_lane_u64 (special, 1))
+            break;
+    }
+#endif
+
+    for (; i < len; ++i) {
+        unsigned char c = (unsigned char) data [i];
+        if (c < 0x20 || c >= 0x7F)
+            return i;
+    }
+
+    return len;
+}
+
+/**
+ * Returns the length of the valid UTF-8 sequence at the start of \a data,
+ * or \c 0 if the sequence is invalid (including overlong encodings,
+ * surrogates, values above U+10FFFF and sequences cut by the end of the
+ * data)
+ */
+static size_t utf8_sequence (const unsigned char* data, const size_t len)
+{
+    size_t i;
+    size_t n;
+    unsigned char min = 0x80;
+    unsigned char max = 0xBF;
+
+    if (data [0] >= 0xC2 && data [0] <= 0xDF)
+        n = 2;
+    else if (data [0] >= 0xE0 && data [0] <= 0xEF) {
+        n = 3;
+        if (data [0] == 0xE0)
+            min = 0xA0;
+        else if (data [0] == 0xED)
+            max = 0x9F;
+    } else if (data [0] >= 0xF0 && data [0] <= 0xF4) {
+        n = 4;
+        if (data [0] == 0xF0)
+            min = 0x90;
+        else if (data [0] == 0xF4)
+            max = 0x8F;
+    } else
+        return 0;
+
+    if (len < n || data [1] < min || data [1] > max)
+        return 0;
+
+    for (i = 2; i < n; ++i) {
+        if (data [i] < 0x80 || data [i] > 0xBF)
+            return 0;
+    }
+
+    return n;
+}
+
+/**
+ * Appends \a len bytes (a single character) to the line buffer of the
+ * context if they fit, so that long lines are truncated at a character
+ * boundary
+ */
+static void append_clean (NetConsoleContext* ctx, size_t* used,
+                          const char* data, const size_t len)
+{
+    if (*used + len <= DS_NETCONSOLE_LINE_SIZE) {
+        memcpy (ctx->line + *used, data, len);
+        *used += len;
+    }
+}
+
+/**
+ * Appends as many bytes of the given printable ASCII \a data as fit in the
+ * line buffer of the context
+ */
+static void append_ascii (NetConsoleContext* ctx, size_t* used,
+                          const char* data, const size_t len)
+{
+    append_clean (ctx, used, data, DS_Min (len, DS_NETCONSOLE_LINE_SIZE - *used));
+}
+
+/**
+ * Reads the line at the start of the given \a data (which ends with a new
+ * line or with the data) and returns the number of bytes that it spans,
+ * including the new line.
+ *
+ * The stored lines are valid UTF-8 without control characters (except
+ * tabs): invalid sequences are replaced with U+FFFD and the other control
+ * characters (e.g. carriage returns) are removed. Lines that are already
+ * clean (which is almost always the case) are only scanned, \a text then
+ * points into \a data. Otherwise, the clean line is written to the line
+ * buffer of the context. The mutex must be locked by the calling thread.
+ */
+static size_t read_line (NetConsoleContext* ctx,
+                         const char* data, const size_t len,
+                         const char** text, size_t* text_len)
+{
+    /* Find the end of the line, stop at the first byte to clean */
+    size_t i = 0;
+    for (;;) {
+        i += find_special (data + i, len - i);
+
+        /* The line is clean (with a LF or CRLF line ending) */
+        if (i == len || data [i] == '\n') {
+            *text = data;
+            *text_len = i;
+            return DS_Min (i + 1, len);
+        } else if (data [i] == '\r' && (i + 1 == len || data [i + 1] == '\n')) {
+            *text = data;
+            *text_len = i;
+            return DS_Min (i + 2, len);
+        }
+
+        /* Tabs and valid UTF-8 sequences are kept */
+        if (data [i] == '\t')
+            ++i;
+        else if ((unsigned char) data [i] >= 0x80) {
+            size_t n = utf8_sequence ((const unsigned char*) data + i, len - i);
+            if (n == 0)
+                break;
+
+            i += n;
+        } else
+            break;
+    }
+
+    /* Copy the clean part of the line, then clean the rest */
+    size_t used = 0;
+    append_ascii (ctx, &used, data, i);
+    while (i < len && data [i] != '\n') {
+        const unsigned char c = (unsigned char) data [i];
+
+        /* Keep tabs, remove the other control characters */
+        if (c < 0x80) {
+            if (c == '\t')
+                append_clean (ctx, &used, data + i, 1);
+
+            ++i;
+        }
+
+        /* Copy valid UTF-8 sequences, replace invalid bytes */
+        else {
+            size_t n = utf8_sequence ((const unsigned char*) data + i, len - i);
+            if (n > 0) {
+                append_clean (ctx, &used, data + i, n);
+                i += n;
+            } else {
+                append_clean (ctx, &used, REPLACEMENT_CHAR, REPLACEMENT_CHAR_LEN);
+                ++i;
+            }
+        }
+
+        /* Copy the next run of printable ASCII at once */
+        size_t run = find_special (data + i, len - i);
+        append_ascii (ctx, &used, data + i, run);
+        i += run;
+    }
+
+    *text = ctx->line;
+    *text_len = used;
+    return DS_Min (i + 1, len);
+}
+
+/**
+ * Returns a free buffer of the message slab, or \c NULL if all of them are
+ * in use. The mutex must be locked by the calling thread.
+ */
+static char* take_message (void)
+{
+    int i;
+    NetConsoleContext* ctx = get_context();
+
+    for (i = 0; i < DS_NETCONSOLE_MESSAGE_SLOTS; ++i) {
+        int slot = (ctx->next_message + i) % DS_NETCONSOLE_MESSAGE_SLOTS;
+        if (!ctx->message_used [slot]) {
+            ctx->message_used [slot] = 1;
+            ctx->next_message = slot + 1;
+            return ctx->messages [slot];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Registers a \c DS_NETCONSOLE_NEW_MESSAGE event with a copy of the given
+ * message. If all the message buffers are in use (the application is not
+ * polling the events), the event is not registered, the lines of the
+ * message are stored anyway.
+ */
+static void add_message_event (const char* data, size_t len)
+{
+    NetConsoleContext* ctx = get_context();
+
+    DS_MutexLockCounted (&ctx->mutex, &ctx->contentions);
+    char* message = take_message();
+    DS_MutexUnlock (&ctx->mutex);
+
+    if (!message) {
+        DS_AtomicFetchAdd (&ctx->messages_dropped, 1);
+        return;
+    }
+
+    /* Copy the message, truncating it if needed */
+    len = DS_Min (len, DS_NETCONSOLE_MESSAGE_SIZE - 1);
+    memcpy (message, data, len);
+    message [len] = 0;
+
+    DS_Event event;
+    event.netconsole.type = DS_NETCONSOLE_NEW_MESSAGE;
+    event.netconsole.message = message;
+    DS_AddEvent (&event);
+}
+
+/**
+ * Initializes the NetConsole line store
+ */
+void NetConsole_Init (void)
+{
+    DS_NetConsoleClear();
+}
+
+/**
+ * Removes the stored lines (the line numbers keep growing, so that the
+ * application can tell the old lines from the new ones if the LibDS is
+ * initialized again) and discards the messages that were not sent
+ */
+void NetConsole_Close (void)
+{
+    NetConsoleContext* ctx = get_context();
+
+    DS_NetConsoleClear();
+
+    DS_MutexLock (&ctx->send_mutex);
+    ctx->send_len = 0;
+    DS_MutexUnlock (&ctx->send_mutex);
+}
+
+/**
+ * Clears the statistics of the NetConsole line store of the current context
+ */
+void NetConsole_ResetStats (void)
+{
+    NetConsoleContext* ctx = get_context();
+
+    DS_AtomicStore (&ctx->lines, 0);
+    DS_AtomicStore (&ctx->max_burst, 0);
+    DS_AtomicStore (&ctx->max_backlog, 0);
+    DS_AtomicStore (&ctx->lines_lost, 0);
+    DS_AtomicStore (&ctx->messages_dropped, 0);
+    DS_AtomicStore (&ctx->contentions, 0);
+}
+
+/**
+ * Writes the statistics of the NetConsole line store of the current context
+ * to the given \a stats structure
+ */
+void NetConsole_GetStats (DS_NetConsoleStats* stats)
+{
+    NetConsoleContext* ctx = get_context();
+
+    assert (stats);
+
+    stats->lines = DS_AtomicLoad (&ctx->lines);
+    stats->max_burst = DS_AtomicLoad (&ctx->max_burst);
+    stats->max_backlog = DS_AtomicLoad (&ctx->max_backlog);
+    stats->lines_lost = DS_AtomicLoad (&ctx->lines_lost);
+    stats->messages_dropped = DS_AtomicLoad (&ctx->messages_dropped);
+    stats->contentions = DS_AtomicLoad (&ctx->contentions);
+}
+
+/**
+ * Returns the time (in msecs) until the queued messages must be sent, or
+ * \c -1 if there are no queued messages
+ */
+int NetConsole_SendRemaining (void)
+{
+    NetConsoleContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->send_mutex);
+    size_t len = ctx->send_len;
+    uint64_t elapsed = DS_GetTimeMs() - ctx->send_time;
+    DS_MutexUnlock (&ctx->send_mutex);
+
+    if (len == 0)
+        return -1;
+
+    /* A full datagram is sent at once */
+    if (len >= DS_NETCONSOLE_SEND_MTU || elapsed >= DS_NETCONSOLE_SEND_DELAY)
+        return 0;
+
+    return DS_NETCONSOLE_SEND_DELAY - (int) elapsed;
+}
+
+/**
+ * Sends the queued messages through the given \a socket once they are due
+ * (see \c NetConsole_SendRemaining()). Datagrams end at a message boundary,
+ * unless a single message is longer than \c DS_NETCONSOLE_SEND_MTU.
+ *
+ * This function is called by the protocol event loop.
+ */
+void NetConsole_SendQueued (DS_Socket* socket)
+{
+    NetConsoleContext* ctx = get_context();
+    char datagram [DS_NETCONSOLE_SEND_MTU];
+
+    assert (socket);
+
+    while (NetConsole_SendRemaining() == 0) {
+        DS_MutexLock (&ctx->send_mutex);
+
+        /* Take as many whole messages as possible */
+        size_t len = DS_Min (ctx->send_len, (size_t) DS_NETCONSOLE_SEND_MTU);
+        if (len < ctx->send_len) {
+            size_t end = len;
+            while (end > 0 && ctx->send_queue [end - 1] != '\n')
+                --end;
+
+            if (end > 0)
+                len = end;
+        }
+
+        /* Remove them from the queue */
+        memcpy (datagram, ctx->send_queue, len);
+        memmove (ctx->send_queue, ctx->send_queue + len, ctx->send_len - len);
+        ctx->send_len -= len;
+        DS_MutexUnlock (&ctx->send_mutex);
+
+        /* Send them (without copying the datagram again) */
+        DS_String data;
+        data.buf = datagram;
+        data.len = len;
+        data.cap = 0;
+        DS_SocketSend (socket, &data);
+    }
+}
+
+/**
+ * Queues the given \a message to be sent to the NetConsole of the robot,
+ * the message is separated from the previously queued message with a new
+ * line (if needed)
+ *
+ * \returns \c 1 if the message was queued, \c 0 if the queue is full
+ */
+int NetConsole_QueueMessage (const char* message)
+{
+    NetConsoleContext* ctx = get_context();
+    int queued = 0;
+
+    assert (message);
+
+    size_t len = strlen (message);
+    if (len == 0)
+        return 1;
+
+    DS_MutexLock (&ctx->send_mutex);
+
+    /* Separate the message from the previous one */
+    int separator = ctx->send_len > 0 &&
+                    ctx->send_queue [ctx->send_len - 1] != '\n';
+
+    /* Append the message, if it fits */
+    if (ctx->send_len + separator + len <= sizeof (ctx->send_queue)) {
+        if (ctx->send_len == 0)
+            ctx->send_time = DS_GetTimeMs();
+
+        if (separator)
+            ctx->send_queue [ctx->send_len++] = '\n';
+
+        memcpy (ctx->send_queue + ctx->send_len, message, len);
+        ctx->send_len += len;
+        queued = 1;
+    }
+
+    DS_MutexUnlock (&ctx->send_mutex);
+    return queued;
+}
+
+/**
+ * Removes all the stored lines
+ */
+void DS_NetConsoleClear (void)
+{
+    NetConsoleContext* ctx = get_context();
+
+    DS_MutexLockCounted (&ctx->mutex, &ctx->contentions);
+    ctx->first_line = ctx->next_line;
+    ctx->notified = 0;
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Returns the number of the oldest stored line
+ */
+uint64_t DS_NetConsoleFirstLine (void)
+{
+    NetConsoleContext* ctx = get_context();
+
+    DS_MutexLockCounted (&ctx->mutex, &ctx->contentions);
+    uint64_t line = ctx->first_line;
+    DS_MutexUnlock (&ctx->mutex);
+
+    return line;
+}
+
+/**
+ * Returns the total number of lines that have been stored (including the
+ * ones that have been removed), which is also the number of the next line
+ */
+uint64_t DS_NetConsoleLineCount (void)
+{
+    NetConsoleContext* ctx = get_context();
+
+    DS_MutexLockCounted (&ctx->mutex, &ctx->contentions);
+    uint64_t count = ctx->next_line;
+    DS_MutexUnlock (&ctx->mutex);
+
+    return count;
+}
+
+/**
+ * Stores the given \a data as informational lines printed by the robot
+ * (see \c DS_NetConsoleAppendEntry())
+ *
+ * \param data the received text
+ * \param len the length of \a data
+ */
+void DS_NetConsoleAppend (const char* data, const size_t len)
+{
+    DS_NetConsoleAppendEntry (DS_NETCONSOLE_SOURCE_ROBOT,
+                              DS_NETCONSOLE_SEVERITY_INFO, data, len);
+}
+
+/**
+ * Splits the given NetConsole \a data in lines and stores them, along with
+ * their \a source, \a severity and the current time. A single
+ * \c DS_NETCONSOLE_NEW_LINES event is registered until the application
+ * reads the stored lines with \c DS_NetConsoleRead(), so the number of
+ * events does not depend on the amount of text printed by the robot.
+ *
+ * \param source the origin of the text
+ * \param severity the severity of the text
+ * \param data the plain text to store
+ * \param len the length of \a data
+ */
+void DS_NetConsoleAppendEntry (const DS_NetConsoleSource source,
+                               const DS_NetConsoleSeverity severity,
+                               const char* data, const size_t len)
+{
+    NetConsoleContext* ctx = get_context();
+
+    /* Check arguments */
+    assert (data);
+
+    /* Nothing to store */
+    if (len == 0)
+        return;
+
+    /* Register the message event (for compatibility) */
+    if (ctx->message_events && DS_EventWanted (DS_NETCONSOLE_NEW_MESSAGE))
+        add_message_event (data, len);
+
+    /* All the lines of the message share the same attributes */
+    LineIndex entry;
+    entry.time = DS_GetWallTimeUs();
+    entry.source = source;
+    entry.severity = severity;
+
+    DS_MutexLockCounted (&ctx->mutex, &ctx->contentions);
+
+    /* Clean and store every line (a trailing newline does not start a new
+     * line) */
+    size_t pos = 0;
+    size_t burst = 0;
+    while (pos < len) {
+        const char* text;
+        size_t text_len;
+
+        pos += read_line (ctx, data + pos, len - pos, &text, &text_len);
+        store_line (text, text_len, entry);
+        ++burst;
+    }
+
+    DS_AtomicFetchAdd (&ctx->lines, burst);
+    DS_AtomicMax (&ctx->max_burst, burst);
+
+    /* Only register the event if the previous one was processed */
+    int notify = !ctx->notified;
+    ctx->notified = 1;
+
+    DS_MutexUnlock (&ctx->mutex);
+
+    if (notify) {
+        DS_Event event;
+        event.netconsole.type = DS_NETCONSOLE_NEW_LINES;
+        event.netconsole.message = NULL;
+        DS_AddEvent (&event);
+    }
+}
+
+/**
+ * Enables or disables the \c DS_NETCONSOLE_NEW_MESSAGE events. Applications
+ * that read the stored lines with \c DS_NetConsoleRead() should disable
+ * them to avoid copying each message twice.
+ */
+void DS_SetNetConsoleMessageEvents (const int enabled)
+{
+    NetConsoleContext* ctx = get_context();
+
+    ctx->message_events = (enabled != 0);
+}
+
+/**
+ * Releases the \a message of a \c DS_NETCONSOLE_NEW_MESSAGE event, this is
+ * done by the event queue once the event has been polled or discarded.
+ * Messages that were not taken from the message slab (e.g. the messages
+ * of events registered by the application) are de-allocated instead.
+ */
+void DS_NetConsoleReleaseMessage (char* message)
+{
+    NetConsoleContext* ctx = get_context();
+    const char* first = ctx->messages [0];
+    const char* end = first + sizeof (ctx->messages);
+
+    if (!message)
+        return;
+
+    /* Not a slab buffer */
+    if (message < first || message >= end) {
+        DS_FREE (message);
+        return;
+    }
+
+    /* Return the buffer to the slab */
+    int slot = (int) ((message - first) / DS_NETCONSOLE_MESSAGE_SIZE);
+    DS_MutexLockCounted (&ctx->mutex, &ctx->contentions);
+    ctx->message_used [slot] = 0;
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Copies the stored lines, beginning with the line number pointed by
+ * \a cursor, into the given \a buffer.
+ *
+ * If the first requested line has already been removed, the copy begins
+ * with the oldest stored line. The \a cursor is then advanced to the
+ * number of the next line to read.
+ *
+ * \param cursor number of the first line to read, updated by this function
+ * \param lines array in which the line information is written
+ * \param max_lines maximum number of lines to read
+ * \param buffer buffer in which the (null-terminated) text is copied
+ * \param size the size of \a buffer, which should be larger than
+ *             \c DS_NETCONSOLE_LINE_SIZE
+ *
+ * \returns the number of lines written to \a lines
+ */
+int DS_NetConsoleRead (uint64_t* cursor, DS_NetConsoleLine* lines,
+                       const int max_lines, char* buffer, const size_t size)
+{
+    NetConsoleContext* ctx = get_context();
+
+    /* Check arguments */
+    assert (cursor);
+    assert (buffer);
+    assert (lines);
+
+    int count = 0;
+    size_t used = 0;
+
+    DS_MutexLockCounted (&ctx->mutex, &ctx->contentions);
+
+    /* Skip the removed lines */
+    if (*cursor < ctx->first_line) {
+        DS_AtomicFetchAdd (&ctx->lines_lost, (size_t) (ctx->first_line - *cursor));
+        *cursor = ctx->first_line;
+    }
+
+    DS_AtomicMax (&ctx->max_backlog, (size_t) (ctx->next_line - *cursor));
+
+    /* Copy the lines until the buffer is full */
+    while (*cursor < ctx->next_line && count < max_lines) {
+        const LineIndex* index = &ctx->line_index [*cursor % DS_NETCONSOLE_MAX_LINES];
+        if (used + index->len + 1 > size)
+            break;
+
+        size_t offset = (size_t) (index->pos % DS_NETCONSOLE_ARENA_SIZE);
+        memcpy (buffer + used, ctx->arena + offset, index->len);
+        buffer [used + index->len] = 0;
+
+        lines [count].number = *cursor;
+        lines [count].time = index->time;
+        lines [count].source = index->source;
+        lines [count].severity = index->severity;
+        lines [count].text = buffer + used;
+        lines [count].len = index->len;
+
+        used += index->len + 1;
+        ++*cursor;
+        ++count;
+    }
+
+    /* The application is up to date, register an event for the next line */
+    if (*cursor >= ctx->next_line)
+        ctx->notified = 0;
+
+    DS_MutexUnlock (&ctx->mutex);
+
+    return count;
+}
@@ -0,0 +1,141 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Packet.h"
+
+#include <assert.h>
+#include <string.h>
+
+/**
+ * Removes all the data written to the given \a packet, the buffer is kept
+ *
+ * \param packet the packet to clear
+ */
+void DS_PacketClear (DS_Packet* packet)
+{
+    assert (packet);
+
+    packet->len = 0;
+    packet->overflow = 0;
+}
+
+/**
+ * Returns a string that points to the data of the given \a packet.
+ *
+ * \warning The returned string does not own its buffer, do not free it
+ *
+ * \param packet the packet to read
+ */
+DS_String DS_PacketView (const DS_Packet* packet)
+{
+    assert (packet);
+
+    DS_String view;
+    view.buf = (char*) packet->buf;
+    view.len = packet->len;
+    view.cap = 0;
+
+    return view;
+}
+
+/**
+ * Writes the given \a byte at the end of the \a packet
+ *
+ * \param packet the packet in which to write the data
+ * \param byte the byte to write
+ *
+ * \returns \c 1 on success, \c 0 if there is no space left in the packet
+ */
+int DS_PacketAppend (DS_Packet* packet, const uint8_t byte)
+{
+    assert (packet);
+
+    if (packet->len >= packet->capacity) {
+        packet->overflow = 1;
+        return 0;
+    }
+
+    packet->buf [packet->len++] = byte;
+    return 1;
+}
+
+/**
+ * Writes the given 16-bit \a value at the end of the \a packet, using the
+ * network byte order (big endian)
+ *
+ * \param packet the packet in which to write the data
+ * \param value the value to write
+ *
+ * \returns \c 1 on success, \c 0 if there is no space left in the packet
+ */
+int DS_PacketAppendU16 (DS_Packet* packet, const uint16_t value)
+{
+    uint8_t bytes [2];
+    bytes [0] = (uint8_t) (value >> 8);
+    bytes [1] = (uint8_t) (value);
+
+    return DS_PacketAppendBytes (packet, bytes, sizeof (bytes));
+}
+
+/**
+ * Writes \a len bytes of the given \a data at the end of the \a packet.
+ * Nothing is written if the data does not fit in the packet.
+ *
+ * \param packet the packet in which to write the data
+ * \param data the bytes to write
+ * \param len the number of bytes to write
+ *
+ * \returns \c 1 on success, \c 0 if there is no space left in the packet
+ */
+int DS_PacketAppendBytes (DS_Packet* packet, const void* data, size_t len)
+{
+    assert (packet);
+    assert (data || len == 0);
+
+    if (packet->len + len > packet->capacity) {
+        packet->overflow = 1;
+        return 0;
+    }
+
+    memcpy (packet->buf + packet->len, data, len);
+    packet->len += len;
+    return 1;
+}
+
+/**
+ * Initializes the given \a packet to write into the given \a buffer
+ *
+ * \param packet the packet to initialize
+ * \param buffer the memory in which the data will be written
+ * \param capacity the size of the \a buffer (in bytes)
+ */
+void DS_PacketInit (DS_Packet* packet, uint8_t* buffer, size_t capacity)
+{
+    assert (packet);
+    assert (buffer);
+
+    packet->buf = buffer;
+    packet->len = 0;
+    packet->capacity = capacity;
+    packet->overflow = 0;
+}
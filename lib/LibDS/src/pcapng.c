@@ -0,0 +1,334 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Utils.h"
+#include "DS_Capture.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+/*
+ * pcapng block types, options and the link type of the exported packets
+ * (raw IPv4, the UDP datagrams are wrapped in synthetic IPv4/UDP headers)
+ */
+#define SECTION_HEADER_BLOCK   0x0A0D0D0A
+#define INTERFACE_BLOCK        0x00000001
+#define ENHANCED_PACKET_BLOCK  0x00000006
+#define BYTE_ORDER_MAGIC       0x1A2B3C4D
+#define OPT_END_OF_OPT         0
+#define OPT_COMMENT            1
+#define OPT_SHB_USERAPPL       4
+#define OPT_IF_NAME            2
+#define OPT_EPB_FLAGS          2
+#define EPB_INBOUND            0x01
+#define EPB_OUTBOUND           0x02
+#define LINKTYPE_IPV4          228
+
+#define IP_HEADER_SIZE         20
+#define UDP_HEADER_SIZE        8
+#define MAX_PAYLOAD            (0xffff - IP_HEADER_SIZE - UDP_HEADER_SIZE)
+
+/*
+ * Names of the capture channels, used in the packet comments
+ */
+static const char* channel_names [DS_CAPTURE_CHANNEL_COUNT] = {
+    "FMS", "Radio", "Robot", "NetConsole"
+};
+
+/*
+ * Growable buffer in which a block is generated before it is written
+ */
+typedef struct {
+    uint8_t* data;
+    size_t len;
+    size_t cap;
+} Block;
+
+/**
+ * Appends \a size bytes of \a data to the \a block (or zeros if \a data is
+ * \c NULL), returns \c 0 if the block cannot be enlarged
+ */
+static int append (Block* block, const void* data, const size_t size)
+{
+    if (block->len + size > block->cap) {
+        size_t cap = DS_Max (block->cap * 2, block->len + size);
+        uint8_t* buf = (uint8_t*) DS_REALLOC (DS_MEMORY_GENERAL,
+                                              block->data, cap);
+        if (!buf)
+            return 0;
+
+        block->data = buf;
+        block->cap = cap;
+    }
+
+    if (data)
+        memcpy (block->data + block->len, data, size);
+    else
+        memset (block->data + block->len, 0, size);
+
+    block->len += size;
+    return 1;
+}
+
+/**
+ * Appends a little-endian 16-bit \a value to the \a block
+ */
+static int append_u16 (Block* block, const uint16_t value)
+{
+    uint8_t bytes [2] = { value & 0xff, value >> 8 };
+    return append (block, bytes, 2);
+}
+
+/**
+ * Appends a little-endian 32-bit \a value to the \a block
+ */
+static int append_u32 (Block* block, const uint32_t value)
+{
+    return append_u16 (block, (uint16_t) value) &&
+           append_u16 (block, (uint16_t) (value >> 16));
+}
+
+/**
+ * Appends zeros to the \a block until its length is a multiple of 4
+ */
+static int pad (Block* block)
+{
+    return append (block, NULL, (4 - block->len % 4) % 4);
+}
+
+/**
+ * Appends an option with the given \a code and value to the \a block
+ */
+static int append_option (Block* block, const uint16_t code,
+                          const void* value, const size_t size)
+{
+    return append_u16 (block, code) &&
+           append_u16 (block, (uint16_t) size) &&
+           append (block, value, size) &&
+           pad (block);
+}
+
+/**
+ * Starts a block of the given \a type, its length is set by \c end_block()
+ */
+static int begin_block (Block* block, const uint32_t type)
+{
+    block->len = 0;
+    return append_u32 (block, type) && append_u32 (block, 0);
+}
+
+/**
+ * Adds the end of the options and the length of the \a block, and writes
+ * the block to the given \a file
+ */
+static int end_block (Block* block, FILE* file)
+{
+    if (!append_u32 (block, OPT_END_OF_OPT) || !append_u32 (block, 0))
+        return 0;
+
+    uint32_t len = (uint32_t) block->len + 4;
+    if (!append_u32 (block, len))
+        return 0;
+
+    memcpy (block->data + 4, block->data + block->len - 4, 4);
+    return fwrite (block->data, 1, block->len, file) == block->len;
+}
+
+/**
+ * Writes a big-endian 16-bit \a value to the \a bytes
+ */
+static void encode_be16 (uint8_t* bytes, const uint16_t value)
+{
+    bytes [0] = value >> 8;
+    bytes [1] = value & 0xff;
+}
+
+/**
+ * Returns the IPv4 address of the device of the given \a channel, using the
+ * static addresses of the FRC network (10.TE.AM.x), or the address of the
+ * DS itself if \a channel is \c -1
+ */
+static uint32_t device_address (const int team, const int channel)
+{
+    uint32_t net = (10u << 24) | ((team / 100 & 0xff) << 16) |
+                   ((team % 100) << 8);
+
+    switch (channel) {
+    case DS_CAPTURE_FMS:
+        return (10u << 24) | (100 << 8) | 5;
+    case DS_CAPTURE_RADIO:
+        return net | 1;
+    case DS_CAPTURE_ROBOT:
+    case DS_CAPTURE_NETCONSOLE:
+        return net | 2;
+    default:
+        return net | 5;
+    }
+}
+
+/**
+ * Generates the IPv4 and UDP headers of the given \a record, the addresses
+ * and ports are the ones of the DS and of the device of the record channel
+ */
+static void encode_headers (uint8_t* headers, const DS_CaptureFile* file,
+                            const DS_CaptureRecord* record,
+                            const size_t payload, const uint16_t id)
+{
+    int i;
+    uint32_t sum = 0;
+    uint32_t ds = device_address (file->team, -1);
+    uint32_t device = device_address (file->team, record->channel);
+    uint32_t src = record->received ? device : ds;
+    uint32_t dst = record->received ? ds : device;
+    int local = file->local_ports [record->channel];
+    int remote = file->remote_ports [record->channel];
+
+    /* IPv4 header (no options) */
+    memset (headers, 0, IP_HEADER_SIZE + UDP_HEADER_SIZE);
+    headers [0] = 0x45;
+    encode_be16 (headers + 2, (uint16_t) (IP_HEADER_SIZE + UDP_HEADER_SIZE +
+                                          payload));
+    encode_be16 (headers + 4, id);
+    headers [8] = 64;
+    headers [9] = 17;
+    encode_be16 (headers + 12, (uint16_t) (src >> 16));
+    encode_be16 (headers + 14, (uint16_t) src);
+    encode_be16 (headers + 16, (uint16_t) (dst >> 16));
+    encode_be16 (headers + 18, (uint16_t) dst);
+
+    /* IPv4 header checksum */
+    for (i = 0; i < IP_HEADER_SIZE; i += 2)
+        sum += (headers [i] << 8) | headers [i + 1];
+    while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+    encode_be16 (headers + 10, (uint16_t) ~sum);
+
+    /* UDP header (the checksum is optional over IPv4) */
+    uint8_t* udp = headers + IP_HEADER_SIZE;
+    encode_be16 (udp, (uint16_t) (record->received ? remote : local));
+    encode_be16 (udp + 2, (uint16_t) (record->received ? local : remote));
+    encode_be16 (udp + 4, (uint16_t) (UDP_HEADER_SIZE + payload));
+}
+
+/**
+ * Writes the section header and interface description blocks
+ */
+static int write_header (Block* block, FILE* file)
+{
+    const char* app = "LibDS";
+
+    return begin_block (block, SECTION_HEADER_BLOCK) &&
+           append_u32 (block, BYTE_ORDER_MAGIC) &&
+           append_u16 (block, 1) &&
+           append_u16 (block, 0) &&
+           append_u32 (block, 0xffffffff) &&
+           append_u32 (block, 0xffffffff) &&
+           append_option (block, OPT_SHB_USERAPPL, app, strlen (app)) &&
+           end_block (block, file) &&
+           begin_block (block, INTERFACE_BLOCK) &&
+           append_u16 (block, LINKTYPE_IPV4) &&
+           append_u16 (block, 0) &&
+           append_u32 (block, 0) &&
+           append_option (block, OPT_IF_NAME, app, strlen (app)) &&
+           end_block (block, file);
+}
+
+/**
+ * Writes an enhanced packet block with the given \a record, the channel and
+ * direction of the record are stored in the packet comment and flags
+ */
+static int write_record (Block* block, FILE* file,
+                         const DS_CaptureFile* capture,
+                         const DS_CaptureRecord* record,
+                         const uint16_t id)
+{
+    char comment [64];
+    uint8_t headers [IP_HEADER_SIZE + UDP_HEADER_SIZE];
+    uint64_t time = capture->start_time + record->time;
+    size_t payload = DS_Min (record->data.len, (size_t) MAX_PAYLOAD);
+    uint32_t captured = (uint32_t) (sizeof (headers) + payload);
+    uint8_t flags [4] = { record->received ? EPB_INBOUND : EPB_OUTBOUND };
+
+    snprintf (comment, sizeof (comment), "LibDS %s channel, %s",
+              channel_names [record->channel],
+              record->received ? "received" : "sent");
+    encode_headers (headers, capture, record, payload, id);
+
+    return begin_block (block, ENHANCED_PACKET_BLOCK) &&
+           append_u32 (block, 0) &&
+           append_u32 (block, (uint32_t) (time >> 32)) &&
+           append_u32 (block, (uint32_t) time) &&
+           append_u32 (block, captured) &&
+           append_u32 (block, captured) &&
+           append (block, headers, sizeof (headers)) &&
+           append (block, record->data.buf, payload) &&
+           pad (block) &&
+           append_option (block, OPT_COMMENT, comment, strlen (comment)) &&
+           append_option (block, OPT_EPB_FLAGS, flags, sizeof (flags)) &&
+           end_block (block, file);
+}
+
+/**
+ * Converts the given \a capture file (see \c DS_StartCapture()) to a pcapng
+ * file at the given \a path, which can be opened by Wireshark and other
+ * network analyzers. The export runs offline, so it costs nothing while
+ * the DS is running.
+ *
+ * Each datagram is wrapped in IPv4 and UDP headers with the ports of its
+ * channel and the static FRC addresses of the team. The channel and
+ * direction are written in the comment of each packet (e.g. "LibDS Robot
+ * channel, sent") and the direction is also set in the packet flags.
+ *
+ * \returns \c 1 on success, \c 0 if the capture cannot be read or the
+ *          pcapng file cannot be written
+ */
+int DS_CaptureExportPcapng (const char* capture, const char* path)
+{
+    assert (capture);
+    assert (path);
+
+    DS_CaptureFile input;
+    if (!DS_CaptureLoad (&input, capture))
+        return 0;
+
+    FILE* file = fopen (path, "wb");
+    if (!file) {
+        DS_CaptureFree (&input);
+        return 0;
+    }
+
+    /* Write the header and a packet block for each record */
+    Block block = {0};
+    uint16_t id = 0;
+    DS_CaptureRecord record;
+    int ok = write_header (&block, file);
+    while (ok && DS_CaptureRead (&input, &record))
+        ok = write_record (&block, file, &input, &record, id++);
+
+    ok = (fclose (file) == 0) && ok;
+
+    DS_FREE (block.data);
+    DS_CaptureFree (&input);
+    return ok;
+}
@@ -21,587 +21,2045 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#if defined _WIN32
+    /* GetThreadId() needs Windows Vista */
+    #if !defined _WIN32_WINNT || _WIN32_WINNT < 0x0600
+        #undef  _WIN32_WINNT
+        #define _WIN32_WINNT 0x0600
+    #endif
+#endif
+
 #include "DS_Utils.h"
 #include "DS_Timer.h"
+#include "DS_Atomic.h"
 #include "DS_Client.h"
 #include "DS_Config.h"
 #include "DS_Events.h"
+#include "DS_Context.h"
 #include "DS_Socket.h"
+#include "DS_Capture.h"
 #include "DS_Protocol.h"
-
+#include "DS_DefaultProtocols.h"
+#include "DS_Histogram.h"
+#include "DS_Telemetry.h"
+#include "DS_Dashboard.h"
+#include "DS_Bandwidth.h"
+#include "DS_Match.h"
+#include "DS_NetConsole.h"
+#include "DS_Messages.h"
+#include "DS_Trace.h"
+#include "DS_Thread.h"
+
+#include <math.h>
 #include <stdio.h>
+#include <stddef.h>
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
-#include <pthread.h>
 
-#define SEND_PRECISION 1  /* Update the sender timers every millisecond */
-#define RECV_PRECISION 50 /* Update the watchdogs every 50 milliseconds */
+#if defined _WIN32
+    #include <windows.h>
+#endif
+
+#define SEND_PRECISION 1  /* Tolerated sender timer delay (in msecs) */
+#define RECOVERY       3  /* Valid packets needed to restore comms */
+#define IDLE_WAIT      50 /* Wait time when no protocol is loaded */
+#define LOSS_SLOTS     512 /* Number of sent packets kept in the loss window */
+#define RATE_CHECK     250 /* Time (in msecs) between adaptive rate updates */
+#define RATE_SAMPLES   10  /* Minimum number of packets to adapt the rate */
+#define MAX_BACKOFF    3   /* Maximum backoff level of the adaptive rate */
+#define BACKOFF_LOSS   10  /* Robot packet loss (in %) that increases it */
+#define RESTORE_LOSS   2   /* Robot packet loss (in %) that decreases it */
+#define TRAFFIC_UPDATE 250 /* Time (in msecs) between traffic rate updates */
+#define TRAFFIC_TAU    1000 /* Time constant (in msecs) of the traffic rates */
+#define STREAM_BURST   16  /* Maximum robot stream messages sent at once */
+#define IDLE_INTERVAL  500 /* Send interval (in msecs) of the idle mode */
+#define STATE_BURST    3   /* Robot packets sent when the robot state changes */
+#define STATE_SPACING  5   /* Time (in msecs) between the copies of a burst */
+#define CLOCK_WINDOW   2000 /* Time (in msecs) of each robot clock filter window */
+#define CLOCK_STEP     1000 /* Clock error (in msecs) that restarts the estimate */
+#define CLOCK_MAX_DRIFT 500 /* Maximum drift (in ppm) between the two clocks */
 
 /*
- * Used to re-assing to 'empty' structure
+ * Interprets a packet with the given function of the current protocol. If
+ * LibDS is built with DS_STATIC_FRC_2015 and the FRC 2015/2016 protocol is
+ * loaded, the FRC 2015 function is called directly instead, so that the
+ * compiler can inline it in the event loop (with link-time optimization)
  */
-static const DS_Protocol EmptyProtocol;
+#if defined DS_STATIC_FRC_2015
+    #define READ_PACKET(ctx, function, frc_2015, data) \
+        ((ctx)->static_frc_2015 ? frc_2015 (data) : \
+                                  (ctx)->protocol.function (data))
+#else
+    #define READ_PACKET(ctx, function, frc_2015, data) \
+        ((ctx)->protocol.function (data))
+#endif
 
 /*
- * Protocol data
+ * Used to re-assing to 'empty' structure
  */
-static DS_Protocol protocol;
-static int enable_operations = 0;
+static const DS_Protocol EmptyProtocol;
 
-/*
- * Define the sender watchdogs (when one expires, we send a packet)
+/**
+ * Holds the timing statistics of a network channel (FMS, radio or robot)
  */
-static DS_Timer fms_send_timer;
-static DS_Timer radio_send_timer;
-static DS_Timer robot_send_timer;
+typedef struct _channel_stats {
+    int awaiting_reply;      /**< Set to \c 1 after a packet is sent */
+    uint64_t last_send;      /**< Time (in usecs) of the last sent packet */
+    uint64_t last_recv;      /**< Time (in usecs) of the last read packet */
+    DS_Histogram round_trip; /**< Time between a sent packet and its reply */
+    DS_Histogram jitter;     /**< Deviation of the packet inter-arrival time */
+    DS_Histogram lateness;   /**< Delay between a send deadline and the send */
+    DS_Histogram period;     /**< Time between two consecutive sends */
+    unsigned int deadline_misses;       /**< Sends more than 2 intervals apart */
+    size_t sent;                        /**< Number of sent packets recorded */
+    uint64_t send_time [LOSS_SLOTS];    /**< Time (in msecs) of each sent packet */
+    uint8_t replied [LOSS_SLOTS];       /**< Set to \c 1 if a packet got a reply */
+} DS_ChannelStats;
 
-/*
- * Define the receiver watchdogs (when one expires, comms are lost)
+/**
+ * Holds the receiver watchdog of a network channel, which expires when no
+ * valid packet has been read during the last \a timeout milliseconds
  */
-static DS_Timer fms_recv_timer;
-static DS_Timer radio_recv_timer;
-static DS_Timer robot_recv_timer;
+typedef struct _channel_watchdog {
+    int timeout;         /**< Watchdog time (in msecs), 0 if disabled */
+    int recovered;       /**< Valid packets read since the comms were lost */
+    uint64_t last_valid; /**< Time (in usecs) of the last valid packet */
+} DS_ChannelWatchdog;
 
-/*
- * If set to anything else than 0, then the event loop will be allowed to run
+/**
+ * Holds the network usage of a channel. The counters are only written by
+ * the event loop, and are read atomically by the other threads
  */
-static int running = 0;
+typedef struct _channel_traffic {
+    volatile uint64_t sent_bytes;   /**< Number of sent bytes */
+    volatile uint64_t recv_bytes;   /**< Number of received bytes */
+    volatile uint64_t sent_packets; /**< Number of sent packets */
+    volatile uint64_t recv_packets; /**< Number of received packets */
+    uint64_t last_counts [4];       /**< Counters at the last rate update */
+    double rates [4];               /**< Rates (per second) of the counters */
+} DS_ChannelTraffic;
 
-/*
- * Protocol read success booleans (used to feed the watchdogs)
+/**
+ * Holds the estimate of the offset between the DS and robot clocks. The
+ * samples are filtered over windows of \c CLOCK_WINDOW msecs (the sample
+ * with the smallest transit delay, i.e. the largest offset, is kept), and
+ * the result of each window corrects the offset and the drift
  */
-static int fms_read = 0;
-static int radio_read = 0;
-static int robot_read = 0;
+typedef struct _clock_estimator {
+    int samples;           /**< Number of samples since the last reset */
+    int windows;           /**< Number of closed filter windows */
+    int window_open;       /**< 1 once the current window has a sample */
+    double offset;         /**< Robot minus DS time (in usecs) at \a ref */
+    double drift;          /**< Change of the offset per DS usec */
+    double error;          /**< Last deviation from the estimate (in usecs) */
+    uint64_t ref;          /**< DS time (in usecs) of the offset */
+    double best;           /**< Largest offset of the current window */
+    uint64_t best_time;    /**< DS time (in usecs) of that sample */
+    uint64_t window_start; /**< DS time (in usecs) in which the window began */
+} DS_ClockEstimator;
 
 /*
- * Holds the received data
+ * Protocol state of a DS context, each context runs its own event loop
  */
-static DS_String fms_data;
-static DS_String radio_data;
-static DS_String robot_data;
-static DS_String netcs_data;
+typedef struct {
+    /* Protocol data */
+    DS_Protocol protocol;
+    int enable_operations;
+
+#if defined DS_STATIC_FRC_2015
+    /* Set to 1 if the loaded protocol uses the FRC 2015 packet functions */
+    int static_frc_2015;
+#endif
+
+    /* Sender watchdogs (when one expires, we send a packet) */
+    DS_Timer fms_send_timer;
+    DS_Timer radio_send_timer;
+    DS_Timer robot_send_timer;
+
+    /* Receiver watchdogs (when one expires, comms are lost) */
+    DS_ChannelWatchdog fms_watchdog;
+    DS_ChannelWatchdog radio_watchdog;
+    DS_ChannelWatchdog robot_watchdog;
+
+    /* Watchdog times set by the application (0 to use the send intervals) */
+    int fms_watchdog_timeout;
+    int radio_watchdog_timeout;
+    int robot_watchdog_timeout;
+
+    /* Consecutive valid packets needed to restore lost comms */
+    int recovery_packets;
+
+    /* If set to anything else than 0, the event loop is allowed to run */
+    int running;
+
+    /* Sent/received packets */
+    int sent_fms_packets;
+    int sent_radio_packets;
+    int sent_robot_packets;
+    int received_fms_packets;
+    int received_radio_packets;
+    int received_robot_packets;
+    int duplicated_robot_packets;
+    int reordered_robot_packets;
+
+    /* Set to 1 while the robot stream is connected */
+    int robot_stream_connected;
+
+    /* Network usage of each channel (since the protocol was loaded) */
+    DS_ChannelTraffic fms_traffic;
+    DS_ChannelTraffic radio_traffic;
+    DS_ChannelTraffic robot_traffic;
+    uint64_t last_traffic_update;
+
+    /* Timing statistics of each channel */
+    DS_ChannelStats fms_stats;
+    DS_ChannelStats radio_stats;
+    DS_ChannelStats robot_stats;
+    DS_Mutex stats_mutex;
+
+    /* Receive time (in usecs) of the datagram being read, 0 if unknown */
+    uint64_t recv_time;
+
+    /* Offset and drift of the robot clock (guarded by the stats mutex) */
+    DS_ClockEstimator robot_clock;
+
+    /* Packet loss is calculated over the packets sent in the last N msecs */
+    int loss_window;
+
+    /*
+     * Minimum time (in msecs) between an early robot packet and the
+     * previous robot packet (early packets are disabled if it is 0)
+     */
+    int early_send_gap;
+    volatile size_t early_send_requested;
+
+    /*
+     * Robot packets that must still be sent (one right away and the rest
+     * every STATE_SPACING msecs) after the enabled or e-stop state changed
+     */
+    int state_burst;
+    volatile size_t state_packets;
+
+    /* Send intervals set by the application (0 to use the protocol's) */
+    int fms_send_interval;
+    int radio_send_interval;
+    int robot_send_interval;
+
+    /*
+     * Adaptive send rate, each backoff level doubles the FMS interval and
+     * defers other non-essential data while the robot is losing packets
+     */
+    int adaptive_rate;
+    int backoff_level;
+    uint64_t last_rate_check;
+
+    /*
+     * Power saving, the DS enters the idle mode (slow discovery packets)
+     * when the robot watchdog expires and leaves it with the first valid
+     * robot or FMS packet
+     */
+    int power_saving;
+    int idle;
+
+    /* Network conditions simulated on the sockets of the protocol */
+    DS_SocketImpairment impairment;
+
+    /* The protocol event loop thread and its socket data generation */
+    DS_Thread event_thread;
+    size_t data_generation;
+
+    /* Scheduling options of the event loop (applied by the thread itself) */
+    int thread_cpu;
+    int thread_realtime;
+    int busy_polling;
+    volatile size_t thread_options;
+    size_t applied_thread_options;
+
+    /* Scratch buffer in which the outgoing packets are generated */
+    DS_Packet send_packet;
+    uint8_t send_buffer [DS_PACKET_MAX_SIZE];
+} ProtocolsContext;
 
-/*
- * Holds the sent/received packets
+/**
+ * Initializes the protocol state of a new DS context
  */
-static int sent_fms_packets = 0;
-static int sent_radio_packets = 0;
-static int sent_robot_packets = 0;
-static int received_fms_packets = 0;
-static int received_radio_packets = 0;
-static int received_robot_packets = 0;
+static void init_context (void* data)
+{
+    ProtocolsContext* ctx = (ProtocolsContext*) data;
+
+    ctx->loss_window = 5000;
+    ctx->recovery_packets = RECOVERY;
+    ctx->thread_cpu = -1;
+    ctx->power_saving = 1;
+    ctx->state_burst = STATE_BURST;
+    DS_MutexInit (&ctx->stats_mutex);
+}
 
-/*
- * Sent/received bytes
+/**
+ * Releases the protocol state of a DS context
  */
-static unsigned long sent_fms_bytes = 0;
-static unsigned long recv_fms_bytes = 0;
-static unsigned long sent_radio_bytes = 0;
-static unsigned long recv_radio_bytes = 0;
-static unsigned long sent_robot_bytes = 0;
-static unsigned long recv_robot_bytes = 0;
+static void destroy_context (void* data)
+{
+    ProtocolsContext* ctx = (ProtocolsContext*) data;
+    DS_MutexDestroy (&ctx->stats_mutex);
+}
 
-/*
- * The thread ID for the protocol event loop
+/**
+ * Returns the protocol state of the current DS context
  */
-static pthread_t event_thread;
+static ProtocolsContext* get_context (void)
+{
+    return (ProtocolsContext*) DS_ContextData (DS_CONTEXT_PROTOCOLS,
+                                               sizeof (ProtocolsContext),
+                                               init_context, destroy_context);
+}
 
 /**
- * Sends a new packet to the FMS, the generated data is immediatly deleted
- * once the packet has been sent
+ * Clears the timing statistics of the given \a channel
  */
-static void send_fms_data()
+static void reset_stats (DS_ChannelStats* channel)
 {
-    if (enable_operations) {
-        ++sent_fms_packets;
-        DS_String data = protocol.create_fms_packet();
-        sent_fms_bytes += DS_Max (DS_SocketSend (&protocol.fms_socket, &data), 0);
-        DS_StrRmBuf (&data);
-    }
+    ProtocolsContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->stats_mutex);
+    channel->last_send = 0;
+    channel->last_recv = 0;
+    channel->awaiting_reply = 0;
+    channel->sent = 0;
+    channel->deadline_misses = 0;
+    DS_HistogramReset (&channel->jitter);
+    DS_HistogramReset (&channel->period);
+    DS_HistogramReset (&channel->lateness);
+    DS_HistogramReset (&channel->round_trip);
+    DS_MutexUnlock (&ctx->stats_mutex);
 }
 
 /**
- * Sends a new packet to the radio, the generated data is immediatly deleted
- * once the packet has been sent
+ * Clears the network usage counters and rates of the given \a traffic
  */
-static void send_radio_data()
+static void reset_traffic (DS_ChannelTraffic* traffic)
 {
-    if (enable_operations) {
-        ++sent_radio_packets;
-        DS_String data = protocol.create_radio_packet();
-        sent_radio_bytes += DS_Max (DS_SocketSend (&protocol.radio_socket, &data), 0);
-        DS_StrRmBuf (&data);
-    }
+    ProtocolsContext* ctx = get_context();
+
+    DS_MutexLock (&ctx->stats_mutex);
+    DS_AtomicStore64 (&traffic->sent_bytes, 0);
+    DS_AtomicStore64 (&traffic->recv_bytes, 0);
+    DS_AtomicStore64 (&traffic->sent_packets, 0);
+    DS_AtomicStore64 (&traffic->recv_packets, 0);
+    memset (traffic->last_counts, 0, sizeof (traffic->last_counts));
+    memset (traffic->rates, 0, sizeof (traffic->rates));
+    DS_MutexUnlock (&ctx->stats_mutex);
 }
 
 /**
- * Sends a new packet to the robot, the generated data is immediatly deleted
- * once the packet has been sent
+ * Counts a packet of the given size (in \a bytes) that was sent through
+ * the channel of the given \a traffic
  */
-static void send_robot_data()
+static void count_sent (DS_ChannelTraffic* traffic, const int bytes)
 {
-    if (enable_operations) {
-        ++sent_robot_packets;
-        DS_String data = protocol.create_robot_packet();
-        sent_robot_bytes += DS_Max (DS_SocketSend (&protocol.robot_socket, &data), 0);
-        DS_StrRmBuf (&data);
-    }
+    DS_AtomicAdd64 (&traffic->sent_packets, 1);
+    DS_AtomicAdd64 (&traffic->sent_bytes, (uint64_t) bytes);
 }
 
 /**
- * Sends data over the network using the functions of the current protocol.
- * If there is no protocol running, then this function will do nothing.
+ * Counts a packet of the given size (in \a bytes) that was received through
+ * the channel of the given \a traffic
  */
-static void send_data()
+static void count_recv (DS_ChannelTraffic* traffic, const int bytes)
 {
-    /* Protocol is NULL, abort */
-    if (!enable_operations)
-        return;
-
-    /* Send FMS packet */
-    if (fms_send_timer.expired) {
-        send_fms_data();
-        DS_TimerReset (&fms_send_timer);
-    }
-
-    /* Send radio packet */
-    if (radio_send_timer.expired) {
-        send_radio_data();
-        DS_TimerReset (&radio_send_timer);
-    }
+    DS_AtomicAdd64 (&traffic->recv_packets, 1);
+    DS_AtomicAdd64 (&traffic->recv_bytes, (uint64_t) bytes);
+}
 
-    /* Send robot packet */
-    if (robot_send_timer.expired) {
-        send_robot_data();
-        DS_TimerReset (&robot_send_timer);
+/**
+ * Updates the rates of the given \a traffic with the counters accumulated
+ * during the last \a secs seconds, the new rates are blended into the
+ * averages with the given \a alpha factor
+ */
+static void update_rates (DS_ChannelTraffic* traffic,
+                          const double secs, const double alpha)
+{
+    int i;
+    uint64_t counts [4];
+
+    counts [0] = DS_AtomicLoad64 (&traffic->sent_bytes);
+    counts [1] = DS_AtomicLoad64 (&traffic->recv_bytes);
+    counts [2] = DS_AtomicLoad64 (&traffic->sent_packets);
+    counts [3] = DS_AtomicLoad64 (&traffic->recv_packets);
+
+    for (i = 0; i < 4; ++i) {
+        double rate = (double) (counts [i] - traffic->last_counts [i]) / secs;
+        traffic->rates [i] += alpha * (rate - traffic->rates [i]);
+        traffic->last_counts [i] = counts [i];
     }
 }
 
 /**
- * Clears the strings that hold the incoming data packets
+ * Returns the network usage counters and rates of the given \a traffic
  */
-static void clear_recv_data()
+static DS_TrafficInfo get_traffic_info (DS_ChannelTraffic* traffic)
 {
-    DS_StrRmBuf (&fms_data);
-    DS_StrRmBuf (&radio_data);
-    DS_StrRmBuf (&robot_data);
-    DS_StrRmBuf (&netcs_data);
+    ProtocolsContext* ctx = get_context();
+    DS_TrafficInfo info;
+
+    info.sent_bytes = DS_AtomicLoad64 (&traffic->sent_bytes);
+    info.received_bytes = DS_AtomicLoad64 (&traffic->recv_bytes);
+    info.sent_packets = DS_AtomicLoad64 (&traffic->sent_packets);
+    info.received_packets = DS_AtomicLoad64 (&traffic->recv_packets);
+
+    DS_MutexLock (&ctx->stats_mutex);
+    info.sent_byte_rate = traffic->rates [0];
+    info.received_byte_rate = traffic->rates [1];
+    info.sent_packet_rate = traffic->rates [2];
+    info.received_packet_rate = traffic->rates [3];
+    DS_MutexUnlock (&ctx->stats_mutex);
+
+    return info;
 }
 
 /**
- * Reads the received data using the functions provided by the current protocol.
- * If there is no protocol running, then this function will do nothing.
+ * Records the time at which a packet is about to be sent through the given
+ * \a channel, and how late it is compared to the deadline of its \a timer
+ * (if the packet was sent by a \a timer). The sender timers follow an ideal
+ * schedule (see \c DS_TimerReset()), so the lateness does not accumulate.
+ *
+ * A deadline miss is counted when the time since the previous packet is
+ * greater than twice the send interval of the \a timer.
  */
-static void recv_data()
+static void record_send (DS_ChannelStats* channel, const DS_Timer* timer)
 {
-    /* Protocol is NULL, abort */
-    if (!enable_operations)
-        return;
-
-    /* Clear buffers (just to be sure) */
-    clear_recv_data();
+    ProtocolsContext* ctx = get_context();
+    uint64_t now = DS_GetTimeUs();
 
-    /* Read data from sockets */
-    fms_data = DS_SocketRead (&protocol.fms_socket);
-    radio_data = DS_SocketRead (&protocol.radio_socket);
-    robot_data = DS_SocketRead (&protocol.robot_socket);
-    netcs_data = DS_SocketRead (&protocol.netconsole_socket);
+    DS_MutexLock (&ctx->stats_mutex);
 
-    /* Update received data indicators */
-    recv_fms_bytes += DS_StrLen (&fms_data);
-    recv_radio_bytes += DS_StrLen (&radio_data);
-    recv_robot_bytes += DS_StrLen (&robot_data);
-
-    /* Read FMS packet */
-    if (DS_StrLen (&fms_data) > 0) {
-        ++received_fms_packets;
-        fms_read = protocol.read_fms_packet (&fms_data);
-        CFG_SetFMSCommunications (fms_read);
+    /* Early packets (without a timer) have no deadline */
+    if (timer) {
+        uint64_t deadline = (timer->start + (uint64_t) timer->time) * 1000;
+        DS_HistogramRecord (&channel->lateness,
+                            (uint32_t) (now > deadline ? now - deadline : 0));
     }
 
-    /* Read radio packet */
-    if (DS_StrLen (&radio_data) > 0) {
-        ++received_radio_packets;
-        radio_read = protocol.read_radio_packet (&radio_data);
-        CFG_SetRadioCommunications (radio_read);
-    }
+    /* Record the send period and count the missed deadlines */
+    if (channel->last_send > 0) {
+        uint64_t period = now - channel->last_send;
+        DS_HistogramRecord (&channel->period, (uint32_t) period);
 
-    /* Read robot packet */
-    if (DS_StrLen (&robot_data) > 0) {
-        ++received_robot_packets;
-        robot_read = protocol.read_robot_packet (&robot_data);
-        CFG_SetRobotCommunications (robot_read);
+        if (timer && timer->time > 0 &&
+                period > (uint64_t) timer->time * 2000)
+            ++channel->deadline_misses;
     }
 
-    /* Add NetConsole message to event system */
-    if (netcs_data.len > 0)
-        CFG_AddNetConsoleMessage (&netcs_data);
+    channel->last_send = now;
+    channel->awaiting_reply = 1;
 
-    /* Reset the data pointers */
-    clear_recv_data();
+    /* Add the packet to the loss window */
+    channel->send_time [channel->sent % LOSS_SLOTS] = now / 1000;
+    channel->replied [channel->sent % LOSS_SLOTS] = 0;
+    ++channel->sent;
+    DS_MutexUnlock (&ctx->stats_mutex);
 }
 
 /**
- * Feeds the watchdogs, updates them and checks if any of them has expired
+ * Returns the time in which the datagram that is being read arrived (which
+ * excludes the time that it waited for the event loop), or the current
+ * time for replayed datagrams
  */
-static void update_watchdogs()
+static uint64_t receive_time (const ProtocolsContext* ctx)
 {
-    /* Feed the watchdogs if packets are read */
-    if (fms_read)   DS_TimerReset (&fms_recv_timer);
-    if (radio_read) DS_TimerReset (&radio_recv_timer);
-    if (robot_read) DS_TimerReset (&robot_recv_timer);
-
-    /* Clear the read success values */
-    fms_read = 0;
-    radio_read = 0;
-    robot_read = 0;
-
-    /* Reset the FMS if the watchdog expires */
-    if (fms_recv_timer.expired) {
-        CFG_FMSWatchdogExpired();
-        DS_TimerReset (&fms_recv_timer);
-    }
-
-    /* Reset the radio if the watchdog expires */
-    if (radio_recv_timer.expired) {
-        CFG_RadioWatchdogExpired();
-        DS_TimerReset (&radio_recv_timer);
-    }
-
-    /* Reset the robot if the watchdog expires */
-    if (robot_recv_timer.expired) {
-        CFG_RobotWatchdogExpired();
-        DS_TimerReset (&robot_recv_timer);
-    }
+    return ctx->recv_time > 0 ? ctx->recv_time : DS_GetTimeUs();
 }
 
 /**
- * This function is executed periodically, the function does the following:
- *    - Send data to the FMS, robot and radio
- *    - Read received data from the FMS, robot and radio
- *    - Feed/reset the watchdogs
- *    - Check if any of the watchdogs has expired
+ * Records the round-trip time and the inter-arrival jitter when a packet is
+ * successfully read from the given \a channel, which is expected to receive
+ * a packet every \a interval milliseconds
+ *
+ * \returns the round-trip time (in usecs) if the packet replies to the last
+ *          sent packet, \c -1 if not
  */
-static void* run_event_loop()
+static int64_t record_recv (DS_ChannelStats* channel, const int interval)
 {
-    while (running) {
-        send_data();
-        recv_data();
-        update_watchdogs();
-        DS_Sleep (5);
+    ProtocolsContext* ctx = get_context();
+    uint64_t now = receive_time (ctx);
+    int64_t round_trip = -1;
+
+    DS_MutexLock (&ctx->stats_mutex);
+
+    /* This is the reply to the last sent packet (a packet that arrived
+     * before it was sent replies to an older packet) */
+    if (channel->awaiting_reply && now >= channel->last_send) {
+        round_trip = (int64_t) (now - channel->last_send);
+        DS_HistogramRecord (&channel->round_trip, (uint32_t) round_trip);
+        channel->awaiting_reply = 0;
     }
 
-    return NULL;
+    /* Replies are not matched by index, count it for the newest packet */
+    if (channel->sent > 0)
+        channel->replied [(channel->sent - 1) % LOSS_SLOTS] = 1;
+
+    /* Compare the inter-arrival time with the expected interval */
+    if (channel->last_recv > 0) {
+        int64_t delta = (int64_t) (now - channel->last_recv);
+        int64_t deviation = delta - (int64_t) interval * 1000;
+        DS_HistogramRecord (&channel->jitter,
+                            (uint32_t) (deviation < 0 ? -deviation : deviation));
+    }
+
+    channel->last_recv = now;
+    DS_MutexUnlock (&ctx->stats_mutex);
+
+    return round_trip;
 }
 
 /**
- * Returns a pointer to the current protocol
+ * Returns the offset (in usecs) between the robot and DS clocks that the
+ * given \a clock predicts at the given DS \a time
  */
-DS_Protocol* DS_CurrentProtocol()
+static double clock_offset (const DS_ClockEstimator* clock, const uint64_t time)
 {
-    if (enable_operations)
-        return &protocol;
-
-    return NULL;
+    return clock->offset + clock->drift * ((double) time - (double) clock->ref);
 }
 
 /**
- * Initializes the protocol sender/receiver thread and the timers
+ * Updates the estimate of the given \a clock with a sample of the robot
+ * clock (\a offset is the robot time minus the DS \a time, in usecs)
  */
-void Protocols_Init()
+static void update_clock (DS_ClockEstimator* clock, const double offset,
+                          const uint64_t time)
 {
-    /* Initialize sender timers */
-    DS_TimerInit (&fms_send_timer,   0, SEND_PRECISION);
-    DS_TimerInit (&radio_send_timer, 0, SEND_PRECISION);
-    DS_TimerInit (&robot_send_timer, 0, SEND_PRECISION);
+    /* The robot clock jumped (e.g. the robot rebooted), start over */
+    if (clock->samples > 0 &&
+            fabs (offset - clock_offset (clock, time)) > CLOCK_STEP * 1000.0)
+        memset (clock, 0, sizeof (DS_ClockEstimator));
+
+    /* Keep the least delayed sample of the window */
+    if (!clock->window_open) {
+        clock->window_open = 1;
+        clock->best = offset;
+        clock->best_time = time;
+        clock->window_start = time;
+    }
 
-    /* Initialize watchdog timers */
-    DS_TimerInit (&fms_recv_timer,   0, RECV_PRECISION);
-    DS_TimerInit (&radio_recv_timer, 0, RECV_PRECISION);
-    DS_TimerInit (&robot_recv_timer, 0, RECV_PRECISION);
+    else if (offset > clock->best) {
+        clock->best = offset;
+        clock->best_time = time;
+    }
 
-    /* Allow the event loop to run */
-    running = 1;
-    enable_operations = 0;
+    ++clock->samples;
 
-    /* Configure the event thread */
-    int error = pthread_create (&event_thread, NULL,
-                                &run_event_loop, NULL);
+    /* Use the first window as-is until it closes */
+    if (clock->windows == 0) {
+        clock->offset = clock->best;
+        clock->ref = clock->best_time;
+    }
 
-    /* Display error message if we cannot star the event loop */
-    if (error) {
-        DS_String caption = DS_StrNew ("LibDS");
-        DS_String message = DS_StrNew ("Cannot start protocol event loop!");
-        DS_ShowMessageBox (&caption, &message, DS_ICON_ERROR);
-        DS_StrRmBuf (&caption);
-        DS_StrRmBuf (&message);
+    /* Window is still open */
+    if (time - clock->window_start < CLOCK_WINDOW * 1000)
+        return;
+
+    /* Correct the offset and the drift with the result of the window */
+    if (clock->windows > 0) {
+        double limit = CLOCK_MAX_DRIFT / 1e6;
+        double elapsed = (double) clock->best_time - (double) clock->ref;
+        double rate = (clock->best - clock->offset) / DS_Max (elapsed, 1.0);
+        double predicted = clock_offset (clock, clock->best_time);
+
+        clock->drift = (clock->windows == 1) ? rate :
+                       clock->drift + (rate - clock->drift) * 0.25;
+        clock->drift = DS_Max (DS_Min (clock->drift, limit), -limit);
+        clock->error = clock->best - predicted;
+        clock->offset = predicted + clock->error * 0.5;
+        clock->ref = clock->best_time;
     }
 
-    /* Quit if the thread fails to start */
-    assert (!error);
+    ++clock->windows;
+    clock->window_open = 0;
 }
 
 /**
- * De-allocates the current protocol and closes its sockets
+ * Returns the percentiles of the given \a histogram
  */
-static void close_protocol()
+static DS_LatencyStats get_latency_stats (const DS_Histogram* histogram)
 {
-    /* Protocol is empty, abort */
-    if (!enable_operations)
-        return;
-
-    /* Disable protocol operations */
-    enable_operations = 0;
-
-    /* Stop sender timers */
-    DS_TimerStop (&fms_send_timer);
-    DS_TimerStop (&radio_send_timer);
-    DS_TimerStop (&robot_send_timer);
-
-    /* Stop receiver timers */
-    DS_TimerStop (&fms_recv_timer);
-    DS_TimerStop (&radio_recv_timer);
-    DS_TimerStop (&robot_recv_timer);
-
-    /* Close the sockets */
-    DS_SocketClose (&protocol.fms_socket);
-    DS_SocketClose (&protocol.radio_socket);
-    DS_SocketClose (&protocol.robot_socket);
-    DS_SocketClose (&protocol.netconsole_socket);
-
-    /* Reset sent/recv bytes */
-    sent_fms_bytes = 0;
-    recv_fms_bytes = 0;
-    sent_radio_bytes = 0;
-    recv_radio_bytes = 0;
-    sent_robot_bytes = 0;
-    recv_robot_bytes = 0;
-
-    /* Reset sent/recv packets */
-    DS_ResetFMSPackets();
-    DS_ResetRadioPackets();
-    DS_ResetRadioPackets();
-
-    /* Create notification string */
-    char* name = DS_StrToChar (&protocol.name);
-    DS_String str = DS_StrFormat ("Closed %s protocol", name);
-    CFG_AddNotification (&str);
-    DS_StrRmBuf (&str);
-    DS_FREE (name);
+    DS_LatencyStats stats;
+    stats.samples = histogram->total;
+    stats.p50 = DS_HistogramPercentile (histogram, 50);
+    stats.p99 = DS_HistogramPercentile (histogram, 99);
+    stats.max = histogram->max;
+    return stats;
 }
 
 /**
- * Stops the sender/receiver thread and deletes the allocated protocol
+ * Returns the timing statistics of the given \a channel
  */
-void Protocols_Close()
+static DS_LatencyInfo get_latency_info (const DS_ChannelStats* channel)
 {
-    running = 0;
-    close_protocol();
-    clear_recv_data();
+    ProtocolsContext* ctx = get_context();
+    DS_LatencyInfo info;
+
+    DS_MutexLock (&ctx->stats_mutex);
+    info.jitter = get_latency_stats (&channel->jitter);
+    info.lateness = get_latency_stats (&channel->lateness);
+    info.period = get_latency_stats (&channel->period);
+    info.deadline_misses = channel->deadline_misses;
+    info.round_trip = get_latency_stats (&channel->round_trip);
+    DS_MutexUnlock (&ctx->stats_mutex);
+
+    return info;
 }
 
 /**
- * De-allocates the current protocol and loads the given protocol
- *
- * Note the given \a ptr is not used directly, you should free it
- * after using it...
- *
- * \param ptr pointer to the new protocol implementation to load
+ * Calculates the packet loss of the given \a channel over the packets that
+ * were sent during the last \c loss_window milliseconds. The newest packet
+ * is ignored if it has not been replied yet, since it may still be in flight.
  */
-void DS_ConfigureProtocol (const DS_Protocol* ptr)
+static DS_LossInfo get_loss_info (const DS_ChannelStats* channel)
 {
-    /* Pointer is NULL, abort */
-    assert (ptr != NULL);
+    ProtocolsContext* ctx = get_context();
+    DS_LossInfo info;
+    memset (&info, 0, sizeof (info));
 
-    /* Close previous protocol */
-    close_protocol();
+    DS_MutexLock (&ctx->stats_mutex);
 
-    /* Re-assign the protocol */
-    protocol = *ptr;
+    size_t i;
+    int streak = 1;
+    size_t count = DS_Min (channel->sent, (size_t) LOSS_SLOTS);
+    uint64_t now = DS_GetTimeMs();
 
-    /* Update sockets */
-    DS_SocketOpen (&protocol.fms_socket);
-    DS_SocketOpen (&protocol.radio_socket);
-    DS_SocketOpen (&protocol.robot_socket);
-    DS_SocketOpen (&protocol.netconsole_socket);
+    for (i = 0; i < count; ++i) {
+        size_t slot = (channel->sent - 1 - i) % LOSS_SLOTS;
 
-    /* Update sender timers */
-    fms_send_timer.time = protocol.fms_interval;
-    radio_send_timer.time = protocol.radio_interval;
-    robot_send_timer.time = protocol.robot_interval;
+        /* Packet is older than the window */
+        if (now - channel->send_time [slot] > (uint64_t) ctx->loss_window)
+            break;
 
-    /* Update watchdogs */
-    fms_recv_timer.time = DS_Min (protocol.fms_interval * 50, 1000);
-    radio_recv_timer.time = DS_Min (protocol.radio_interval * 50, 1000);
-    robot_recv_timer.time = DS_Min (protocol.robot_interval * 50, 1000);
+        /* Newest packet may still be in flight */
+        if (i == 0 && !channel->replied [slot])
+            continue;
 
-    /* Start the timers */
-    DS_TimerStart (&fms_send_timer);
-    DS_TimerStart (&fms_recv_timer);
-    DS_TimerStart (&radio_send_timer);
-    DS_TimerStart (&radio_recv_timer);
-    DS_TimerStart (&robot_send_timer);
-    DS_TimerStart (&robot_recv_timer);
+        ++info.packets;
 
-    /* Create notification string */
-    char* name = DS_StrToChar (&protocol.name);
-    DS_String str = DS_StrFormat ("Loaded %s protocol", name);
-    CFG_AddNotification (&str);
-    DS_StrRmBuf (&str);
-    DS_FREE (name);
+        /* Count lost packets and the newest run of lost packets */
+        if (!channel->replied [slot]) {
+            ++info.lost;
+            if (streak)
+                ++info.streak;
+        }
 
-    /* Restore protocol operations */
-    enable_operations = 1;
+        else
+            streak = 0;
+    }
+
+    DS_MutexUnlock (&ctx->stats_mutex);
+
+    if (info.packets > 0)
+        info.percent = (info.lost * 100) / info.packets;
+
+    return info;
 }
 
 /**
- * Returns the number of sent FMS bytes since the current
- * protocol was loaded.
- *
- * This value is only reset to 0 when the current protocol
- * is closed (e.g while loading another protocol).
+ * Returns the receiver watchdog time of a channel that sends a packet every
+ * \a interval milliseconds
  */
-unsigned long DS_SentFMSBytes()
+static int watchdog_time (const int interval)
 {
-    return sent_fms_bytes;
+    return DS_Max (DS_Min (interval * 50, 1000), interval * 2);
 }
 
 /**
- * Returns the number of sent radio bytes since the current
- * protocol was loaded.
- *
- * This value is only reset to 0 when the current protocol
- * is closed (e.g while loading another protocol).
+ * Restarts the given \a watchdog, as if a valid packet was read now
  */
-unsigned long DS_SentRadioBytes()
+static void reset_watchdog (DS_ChannelWatchdog* watchdog)
 {
-    return sent_radio_bytes;
+    watchdog->recovered = 0;
+    watchdog->last_valid = DS_GetTimeUs();
 }
 
 /**
- * Returns the number of sent robot bytes since the current
- * protocol was loaded.
- *
- * This value is only reset to 0 when the current protocol
- * is closed (e.g while loading another protocol).
+ * Feeds the given \a watchdog with a valid packet. If the channel has no
+ * comms, they are restored once the configured number of consecutive
+ * valid packets has been read (without the watchdog expiring in between)
  */
-unsigned long DS_SentRobotBytes()
+static void feed_watchdog (DS_ChannelWatchdog* watchdog,
+                           int (*get_comms) (void),
+                           void (*set_comms) (const int))
 {
-    return sent_robot_bytes;
+    ProtocolsContext* ctx = get_context();
+
+    watchdog->last_valid = DS_GetTimeUs();
+
+    if (!get_comms()) {
+        ++watchdog->recovered;
+        if (watchdog->recovered >= ctx->recovery_packets) {
+            watchdog->recovered = 0;
+            set_comms (1);
+        }
+    }
 }
 
 /**
- * Returns the number of received FMS bytes since the
- * current protocol was loaded.
- *
- * This value is only reset to 0 when the current protocol
- * is closed (e.g while loading another protocol).
+ * Returns the number of milliseconds until the given \a watchdog expires
+ * (\c 0 if it has expired), or \c -1 if the watchdog is disabled
  */
-unsigned long DS_ReceivedFMSBytes()
+static int watchdog_remaining (const DS_ChannelWatchdog* watchdog,
+                               const uint64_t now)
 {
-    return recv_fms_bytes;
+    if (watchdog->timeout <= 0)
+        return -1;
+
+    uint64_t timeout = (uint64_t) watchdog->timeout * 1000;
+    uint64_t deadline = watchdog->last_valid + timeout;
+    if (now >= deadline)
+        return 0;
+
+    return (int) ((deadline - now + 999) / 1000);
 }
 
 /**
- * Returns the number of received radio bytes since the
- * current protocol was loaded.
- *
- * This value is only reset to 0 when the current protocol
- * is closed (e.g while loading another protocol).
+ * Returns \c 1 (and restarts the \a watchdog) if no valid packet has been
+ * read during the watchdog time
  */
-unsigned long DS_ReceivedRadioBytes()
+static int watchdog_expired (DS_ChannelWatchdog* watchdog, const uint64_t now)
 {
-    return recv_radio_bytes;
+    if (watchdog_remaining (watchdog, now) != 0)
+        return 0;
+
+    reset_watchdog (watchdog);
+    return 1;
 }
 
 /**
- * Returns the number of received robot bytes since the
- * current protocol was loaded.
- *
- * This value is only reset to 0 when the current protocol
- * is closed (e.g while loading another protocol).
+ * Updates the sender timers and the watchdogs with the send intervals set
+ * by the application (or by the protocol), the current backoff level and
+ * the idle mode
  */
-unsigned long DS_ReceivedRobotBytes()
+static void apply_intervals()
 {
-    return recv_robot_bytes;
+    ProtocolsContext* ctx = get_context();
+
+    /* Use the intervals of the application, if set */
+    int fms = ctx->fms_send_interval > 0 ? ctx->fms_send_interval :
+              ctx->protocol.fms_interval;
+    int radio = ctx->radio_send_interval > 0 ? ctx->radio_send_interval :
+                ctx->protocol.radio_interval;
+    int robot = ctx->robot_send_interval > 0 ? ctx->robot_send_interval :
+                ctx->protocol.robot_interval;
+
+    /* Slow down the FMS packets while the robot channel is congested */
+    fms <<= ctx->backoff_level;
+
+    /* Update sender timers (only discovery packets are sent while idle) */
+    ctx->fms_send_timer.time = ctx->idle ? DS_Max (fms, IDLE_INTERVAL) : fms;
+    ctx->radio_send_timer.time = ctx->idle ? DS_Max (radio, IDLE_INTERVAL) :
+                                 radio;
+    ctx->robot_send_timer.time = ctx->idle ? DS_Max (robot, IDLE_INTERVAL) :
+                                 robot;
+
+    /* Update watchdogs (with the full send rate, they do not change) */
+    ctx->fms_watchdog.timeout = ctx->fms_watchdog_timeout > 0 ?
+                                ctx->fms_watchdog_timeout :
+                                watchdog_time (fms);
+    ctx->radio_watchdog.timeout = ctx->radio_watchdog_timeout > 0 ?
+                                  ctx->radio_watchdog_timeout :
+                                  watchdog_time (radio);
+    ctx->robot_watchdog.timeout = ctx->robot_watchdog_timeout > 0 ?
+                                  ctx->robot_watchdog_timeout :
+                                  watchdog_time (robot);
+
+    /* Disabled sockets never receive packets, do not reset their devices */
+    if (ctx->protocol.fms_socket.disabled)
+        ctx->fms_watchdog.timeout = 0;
+    if (ctx->protocol.radio_socket.disabled)
+        ctx->radio_watchdog.timeout = 0;
+    if (ctx->protocol.robot_socket.disabled)
+        ctx->robot_watchdog.timeout = 0;
 }
 
 /**
- * Returns the number of sent FMS packets.
- *
- * This value is reset when the communications with
- * the FMS are changed, or when the protocol is changed.
+ * Enters or leaves the idle mode. The sender timers are updated at once, so
+ * the event loop sleeps until the next (slow) discovery packet, or sends
+ * the next packet right away when the full rate is restored.
  */
-int DS_SentFMSPackets()
+static void set_idle (const int idle)
 {
-    return DS_Max (1, sent_fms_packets);
+    ProtocolsContext* ctx = get_context();
+
+    if (ctx->idle != idle) {
+        ctx->idle = idle;
+        apply_intervals();
+    }
 }
 
 /**
- * Returns the number of sent radio packets.
- *
- * This value is reset when the communications with
- * the radio are changed, or when the protocol is changed.
+ * Increases the backoff level of the adaptive send rate while the robot
+ * packet loss is high, and decreases it once the loss is low again. The
+ * loss is checked every \c RATE_CHECK milliseconds.
  */
-int DS_SentRadioPackets()
+static void update_send_rate()
 {
-    return DS_Max (1, sent_radio_packets);
+    ProtocolsContext* ctx = get_context();
+
+    /* Adaptive rate is disabled */
+    if (!ctx->adaptive_rate || !ctx->enable_operations)
+        return;
+
+    /* Loss was checked recently */
+    uint64_t now = DS_GetTimeMs();
+    if (now - ctx->last_rate_check < RATE_CHECK)
+        return;
+
+    ctx->last_rate_check = now;
+
+    /* Restore the traffic if there is no robot (there is no congestion) */
+    int level = ctx->backoff_level;
+    if (!CFG_GetRobotCommunications())
+        level = 0;
+
+    /* Update the backoff level with the robot packet loss */
+    else {
+        DS_LossInfo loss = get_loss_info (&ctx->robot_stats);
+        if (loss.packets >= RATE_SAMPLES) {
+            if (loss.percent >= BACKOFF_LOSS)
+                level = DS_Min (level + 1, MAX_BACKOFF);
+            else if (loss.percent <= RESTORE_LOSS)
+                level = DS_Max (level - 1, 0);
+        }
+    }
+
+    /* Apply the new FMS interval */
+    if (level != ctx->backoff_level) {
+        ctx->backoff_level = level;
+        apply_intervals();
+    }
 }
 
 /**
- * Returns the number of sent robot packets.
- *
- * This value is reset when the communications with
- * the robot are changed, or when the protocol is changed.
+ * Returns the capture channel of the given \a socket of the current protocol,
+ * or \c DS_CAPTURE_CHANNEL_COUNT if the socket is not captured (the robot
+ * stream, which does not fit in the channels of the capture format)
  */
-int DS_SentRobotPackets()
+static DS_CaptureChannel capture_channel (const DS_Socket* socket)
 {
-    return DS_Max (1, sent_robot_packets);
+    ProtocolsContext* ctx = get_context();
+
+    if (socket == &ctx->protocol.fms_socket)
+        return DS_CAPTURE_FMS;
+    else if (socket == &ctx->protocol.radio_socket)
+        return DS_CAPTURE_RADIO;
+    else if (socket == &ctx->protocol.robot_socket)
+        return DS_CAPTURE_ROBOT;
+    else if (socket == &ctx->protocol.robot_stream_socket)
+        return DS_CAPTURE_CHANNEL_COUNT;
+
+    return DS_CAPTURE_NETCONSOLE;
 }
 
 /**
- * Returns the number of received FMS packets.
+ * Generates a packet with the given \a write function (if the protocol
+ * provides it) or with the given \a create function and sends it through
+ * the given \a socket. The packet is also recorded if a capture is running.
  *
- * This value is reset when the communications with
- * the FMS are changed, or when the protocol is changed.
+ * \returns the number of bytes sent
  */
-int DS_ReceivedFMSPackets()
+static int send_packet_data (DS_Socket* socket,
+                             void (*write) (DS_Packet*),
+                             DS_String (*create) (void))
 {
-    return received_fms_packets;
+    ProtocolsContext* ctx = get_context();
+    int bytes = 0;
+
+    /* Write the packet in the scratch buffer, without allocating memory */
+    if (write) {
+        DS_PacketClear (&ctx->send_packet);
+        write (&ctx->send_packet);
+
+        if (!ctx->send_packet.overflow) {
+            DS_String data = DS_PacketView (&ctx->send_packet);
+            bytes = DS_SocketSend (socket, &data);
+
+            if (bytes > 0)
+                Capture_Record (capture_channel (socket), 0, &data);
+        }
+    }
+
+    /* Let the protocol allocate the packet */
+    else if (create) {
+        DS_String data = create();
+        bytes = DS_SocketSend (socket, &data);
+
+        if (bytes > 0)
+            Capture_Record (capture_channel (socket), 0, &data);
+
+        DS_StrRmBuf (&data);
+    }
+
+    return DS_Max (bytes, 0);
 }
 
 /**
- * Returns the number of received radio packets.
- *
- * This value is reset when the communications with
- * the radio are changed, or when the protocol is changed.
+ * Sends a new packet to the FMS, the generated data is immediatly deleted
+ * once the packet has been sent
  */
-int DS_ReceivedRadioPackets()
+static void send_fms_data()
 {
-    return received_radio_packets;
+    ProtocolsContext* ctx = get_context();
+    DS_Protocol* protocol = &ctx->protocol;
+
+    if (ctx->enable_operations) {
+        ++ctx->sent_fms_packets;
+
+#if defined DS_STATIC_FRC_2015
+        /* Call the FRC 2015 generator directly */
+        if (ctx->static_frc_2015) {
+            count_sent (&ctx->fms_traffic,
+                        send_packet_data (&protocol->fms_socket,
+                                          &DS_FRC2015_WriteFMSPacket,
+                                          NULL));
+            return;
+        }
+#endif
+
+        count_sent (&ctx->fms_traffic,
+                    send_packet_data (&protocol->fms_socket,
+                                      protocol->write_fms_packet,
+                                      protocol->create_fms_packet));
+    }
 }
 
 /**
- * Returns the number of received robot packets.
- *
- * This value is reset when the communications with
- * the robot are changed, or when the protocol is changed.
+ * Sends a new packet to the radio, the generated data is immediatly deleted
+ * once the packet has been sent
  */
-int DS_ReceivedRobotPackets()
+static void send_radio_data()
 {
-    return received_robot_packets;
+    ProtocolsContext* ctx = get_context();
+    DS_Protocol* protocol = &ctx->protocol;
+
+    if (ctx->enable_operations) {
+        ++ctx->sent_radio_packets;
+        count_sent (&ctx->radio_traffic,
+                    send_packet_data (&protocol->radio_socket,
+                                      protocol->write_radio_packet,
+                                      protocol->create_radio_packet));
+    }
 }
 
 /**
- * Resets the number of sent/received FMS packets.
- * This function is called when the connection state with the FMS is changed
- */
+ * Sends a new packet to the robot, the generated data is immediatly deleted
+ * once the packet has been sent
+ */
+static void send_robot_data()
+{
+    ProtocolsContext* ctx = get_context();
+    DS_Protocol* protocol = &ctx->protocol;
+
+    DS_TRACE_BEGIN ("send_robot_data");
+
+    if (ctx->enable_operations) {
+        ++ctx->sent_robot_packets;
+        Match_PacketSent();
+
+#if defined DS_STATIC_FRC_2015
+        /* Call the FRC 2015 generator directly */
+        if (ctx->static_frc_2015) {
+            count_sent (&ctx->robot_traffic,
+                        send_packet_data (&protocol->robot_socket,
+                                          &DS_FRC2015_WriteRobotPacket,
+                                          NULL));
+            DS_TRACE_END ("send_robot_data");
+            return;
+        }
+#endif
+
+        count_sent (&ctx->robot_traffic,
+                    send_packet_data (&protocol->robot_socket,
+                                      protocol->write_robot_packet,
+                                      protocol->create_robot_packet));
+    }
+
+    DS_TRACE_END ("send_robot_data");
+}
+
+/**
+ * Sends the pending messages of the robot stream (e.g. joystick descriptors
+ * or match information), which the protocol writes one at a time in the
+ * scratch buffer. When the stream is (re)connected, the protocol is told to
+ * send all of its messages again.
+ */
+static void send_stream_data()
+{
+    ProtocolsContext* ctx = get_context();
+    DS_Protocol* protocol = &ctx->protocol;
+    int i;
+
+    /* Protocol does not use a robot stream */
+    if (!protocol->write_robot_stream || protocol->robot_stream_socket.disabled)
+        return;
+
+    /* Stream is not connected, the messages would be discarded */
+    if (!DS_SocketConnected (&protocol->robot_stream_socket)) {
+        ctx->robot_stream_connected = 0;
+        return;
+    }
+
+    /* Stream was just established, let the protocol start over */
+    if (!ctx->robot_stream_connected) {
+        ctx->robot_stream_connected = 1;
+        if (protocol->reset_robot_stream)
+            protocol->reset_robot_stream();
+    }
+
+    /* Send the pending messages, until the protocol writes an empty one */
+    for (i = 0; i < STREAM_BURST; ++i) {
+        DS_PacketClear (&ctx->send_packet);
+        protocol->write_robot_stream (&ctx->send_packet);
+
+        if (ctx->send_packet.len == 0)
+            break;
+
+        if (!ctx->send_packet.overflow) {
+            DS_String data = DS_PacketView (&ctx->send_packet);
+            DS_SocketSend (&protocol->robot_stream_socket, &data);
+        }
+    }
+}
+
+/**
+ * Returns the number of milliseconds until the requested early robot packet
+ * can be sent (\c 0 if it can be sent now), or \c -1 if no early packet
+ * has been requested
+ */
+static int early_send_remaining()
+{
+    ProtocolsContext* ctx = get_context();
+    const int gap = ctx->early_send_gap;
+
+    if (gap <= 0 || !DS_AtomicLoad (&ctx->early_send_requested))
+        return -1;
+
+    uint64_t elapsed = (DS_GetTimeUs() - ctx->robot_stats.last_send) / 1000;
+    return elapsed >= (uint64_t) gap ? 0 : gap - (int) elapsed;
+}
+
+/**
+ * Returns the number of milliseconds until the next packet of a state
+ * change burst must be sent (\c 0 if it must be sent now), or \c -1 if no
+ * burst is in progress. The first packet of a burst is sent right away.
+ */
+static int state_send_remaining()
+{
+    ProtocolsContext* ctx = get_context();
+    size_t pending = DS_AtomicLoad (&ctx->state_packets);
+
+    if (pending == 0)
+        return -1;
+
+    if (pending >= (size_t) ctx->state_burst)
+        return 0;
+
+    uint64_t elapsed = (DS_GetTimeUs() - ctx->robot_stats.last_send) / 1000;
+    return elapsed >= STATE_SPACING ? 0 : STATE_SPACING - (int) elapsed;
+}
+
+/**
+ * Sends data over the network using the functions of the current protocol.
+ * If there is no protocol running (or a capture is being replayed), then
+ * this function will do nothing.
+ */
+static void send_data()
+{
+    ProtocolsContext* ctx = get_context();
+
+    /* Protocol is NULL, abort */
+    if (!ctx->enable_operations)
+        return;
+
+    /* Do not send packets to the real devices while replaying a capture */
+    if (Replay_Running())
+        return;
+
+    /* Send FMS packet */
+    if (ctx->fms_send_timer.expired) {
+        record_send (&ctx->fms_stats, &ctx->fms_send_timer);
+        send_fms_data();
+        DS_TimerReset (&ctx->fms_send_timer);
+    }
+
+    /* Send radio packet */
+    if (ctx->radio_send_timer.expired) {
+        record_send (&ctx->radio_stats, &ctx->radio_send_timer);
+        send_radio_data();
+        DS_TimerReset (&ctx->radio_send_timer);
+    }
+
+    /* Send the changed robot state right away (and its redundant copies) */
+    if (state_send_remaining() == 0) {
+        size_t pending = DS_AtomicLoad (&ctx->state_packets);
+        DS_AtomicCAS (&ctx->state_packets, pending, pending - 1);
+        DS_AtomicStore (&ctx->early_send_requested, 0);
+        record_send (&ctx->robot_stats, NULL);
+        send_robot_data();
+        DS_TimerReset (&ctx->robot_send_timer);
+    }
+
+    /* Send robot packet (it also carries any requested input change) */
+    else if (ctx->robot_send_timer.expired) {
+        DS_AtomicStore (&ctx->early_send_requested, 0);
+        record_send (&ctx->robot_stats, &ctx->robot_send_timer);
+        send_robot_data();
+        send_stream_data();
+        DS_TimerReset (&ctx->robot_send_timer);
+    }
+
+    /* Send an early robot packet and restart the send interval */
+    else if (early_send_remaining() == 0) {
+        DS_AtomicStore (&ctx->early_send_requested, 0);
+        record_send (&ctx->robot_stats, NULL);
+        send_robot_data();
+        send_stream_data();
+        DS_TimerReset (&ctx->robot_send_timer);
+    }
+
+    /* Send the queued NetConsole messages */
+    NetConsole_SendQueued (&ctx->protocol.netconsole_socket);
+}
+
+/**
+ * Interprets a received FMS datagram and feeds the FMS watchdog if it is
+ * valid
+ */
+static void read_fms_data (const DS_String* data)
+{
+    ProtocolsContext* ctx = get_context();
+
+    ++ctx->received_fms_packets;
+    count_recv (&ctx->fms_traffic, DS_StrLen (data));
+    int ok = READ_PACKET (ctx, read_fms_packet,
+                          DS_FRC2015_ReadFMSPacket, data);
+
+    if (ok) {
+        set_idle (0);
+        feed_watchdog (&ctx->fms_watchdog,
+                       CFG_GetFMSCommunications,
+                       CFG_SetFMSCommunications);
+        record_recv (&ctx->fms_stats, ctx->fms_send_timer.time);
+    }
+}
+
+/**
+ * Interprets a received radio datagram and feeds the radio watchdog if it
+ * is valid
+ */
+static void read_radio_data (const DS_String* data)
+{
+    ProtocolsContext* ctx = get_context();
+
+    ++ctx->received_radio_packets;
+    count_recv (&ctx->radio_traffic, DS_StrLen (data));
+    int ok = ctx->protocol.read_radio_packet (data);
+
+    if (ok) {
+        feed_watchdog (&ctx->radio_watchdog,
+                       CFG_GetRadioCommunications,
+                       CFG_SetRadioCommunications);
+        record_recv (&ctx->radio_stats, ctx->radio_send_timer.time);
+    }
+}
+
+/**
+ * Interprets a received robot datagram and feeds the robot watchdog if it
+ * is valid
+ */
+static void read_robot_data (const DS_String* data)
+{
+    ProtocolsContext* ctx = get_context();
+
+    ++ctx->received_robot_packets;
+    count_recv (&ctx->robot_traffic, DS_StrLen (data));
+    int ok = READ_PACKET (ctx, read_robot_packet,
+                          DS_FRC2015_ReadRobotPacket, data);
+
+    if (ok) {
+        set_idle (0);
+        feed_watchdog (&ctx->robot_watchdog,
+                       CFG_GetRobotCommunications,
+                       CFG_SetRobotCommunications);
+
+        int64_t round_trip = record_recv (&ctx->robot_stats,
+                                          ctx->robot_send_timer.time);
+        if (round_trip >= 0)
+            Match_RoundTrip ((uint32_t) round_trip);
+    }
+}
+
+/**
+ * Interprets a message received through the robot stream (the robot
+ * watchdog is only fed by the robot datagrams)
+ */
+static void read_robot_stream_data (const DS_String* data)
+{
+    ProtocolsContext* ctx = get_context();
+
+    if (ctx->protocol.read_robot_stream)
+        ctx->protocol.read_robot_stream (data);
+}
+
+/**
+ * Reads the datagrams queued in the given \a socket with the given \a read
+ * function, the datagrams are discarded while a capture is being replayed
+ */
+static void read_socket (DS_Socket* socket,
+                         void (*read) (const DS_String*),
+                         const int replaying)
+{
+    DS_String data;
+    ProtocolsContext* ctx = get_context();
+
+    while (DS_SocketPeek (socket, &data)) {
+        if (!replaying) {
+            ctx->recv_time = DS_SocketPeekTime (socket);
+            Capture_Record (capture_channel (socket), 1, &data);
+            read (&data);
+            ctx->recv_time = 0;
+        }
+
+        DS_SocketRelease (socket);
+    }
+}
+
+/**
+ * Reads the received data using the functions provided by the current protocol.
+ * If there is no protocol running, then this function will do nothing.
+ *
+ * Every queued datagram is processed directly from the socket's receive
+ * ring, without copying it. While a capture is being replayed, its received
+ * datagrams are read instead of the datagrams of the sockets.
+ */
+static void recv_data()
+{
+    ProtocolsContext* ctx = get_context();
+
+    /* Protocol is NULL, abort */
+    if (!ctx->enable_operations)
+        return;
+
+    /* Read FMS, radio and robot packets and NetConsole messages */
+    DS_TRACE_BEGIN ("recv_data");
+    int replaying = Replay_Running();
+    read_socket (&ctx->protocol.fms_socket, read_fms_data, replaying);
+    read_socket (&ctx->protocol.radio_socket, read_radio_data, replaying);
+    read_socket (&ctx->protocol.robot_socket, read_robot_data, replaying);
+    read_socket (&ctx->protocol.robot_stream_socket,
+                 read_robot_stream_data, replaying);
+    read_socket (&ctx->protocol.netconsole_socket,
+                 CFG_AddNetConsoleMessage, replaying);
+
+    /* Read the replayed datagrams that are due */
+    DS_CaptureRecord record;
+    while (replaying && Replay_Next (&record)) {
+        switch (record.channel) {
+        case DS_CAPTURE_FMS:
+            read_fms_data (&record.data);
+            break;
+        case DS_CAPTURE_RADIO:
+            read_radio_data (&record.data);
+            break;
+        case DS_CAPTURE_ROBOT:
+            read_robot_data (&record.data);
+            break;
+        default:
+            CFG_AddNetConsoleMessage (&record.data);
+            break;
+        }
+    }
+
+    DS_TRACE_END ("recv_data");
+}
+
+/**
+ * Checks if any of the watchdogs has expired (the watchdogs are fed when
+ * valid packets are read)
+ */
+static void update_watchdogs()
+{
+    ProtocolsContext* ctx = get_context();
+
+    /* Protocol is NULL, abort */
+    if (!ctx->enable_operations)
+        return;
+
+    uint64_t now = DS_GetTimeUs();
+
+    /* Reset the FMS if the watchdog expires */
+    if (watchdog_expired (&ctx->fms_watchdog, now))
+        CFG_FMSWatchdogExpired();
+
+    /* Reset the radio if the watchdog expires */
+    if (watchdog_expired (&ctx->radio_watchdog, now))
+        CFG_RadioWatchdogExpired();
+
+    /* Reset the robot if the watchdog expires (and go idle without FMS) */
+    if (watchdog_expired (&ctx->robot_watchdog, now)) {
+        CFG_RobotWatchdogExpired();
+
+        if (ctx->power_saving && !CFG_GetFMSCommunications())
+            set_idle (1);
+    }
+}
+
+/**
+ * Samples the bandwidth used by the sockets of the current protocol
+ */
+static void update_bandwidth()
+{
+    ProtocolsContext* ctx = get_context();
+
+    if (ctx->enable_operations)
+        Bandwidth_Update (&ctx->protocol);
+}
+
+/**
+ * Updates the byte and packet rates of each channel every \c TRAFFIC_UPDATE
+ * milliseconds. The rates are exponentially weighted moving averages with a
+ * time constant of \c TRAFFIC_TAU milliseconds.
+ */
+static void update_traffic()
+{
+    ProtocolsContext* ctx = get_context();
+
+    if (!ctx->enable_operations)
+        return;
+
+    /* First update after loading a protocol */
+    uint64_t now = DS_GetTimeUs();
+    if (ctx->last_traffic_update == 0) {
+        ctx->last_traffic_update = now;
+        return;
+    }
+
+    /* Rates were updated recently */
+    uint64_t elapsed = now - ctx->last_traffic_update;
+    if (elapsed < TRAFFIC_UPDATE * 1000)
+        return;
+
+    double secs = elapsed / 1000000.0;
+    double alpha = 1 - exp (-secs * 1000 / TRAFFIC_TAU);
+
+    DS_MutexLock (&ctx->stats_mutex);
+    update_rates (&ctx->fms_traffic, secs, alpha);
+    update_rates (&ctx->radio_traffic, secs, alpha);
+    update_rates (&ctx->robot_traffic, secs, alpha);
+    DS_MutexUnlock (&ctx->stats_mutex);
+
+    ctx->last_traffic_update = now;
+}
+
+/**
+ * Updates the expired state of the sender timers and watchdogs and returns
+ * the number of milliseconds until the next one expires (or \c -1 if none
+ * of them is running)
+ */
+static int next_deadline()
+{
+    ProtocolsContext* ctx = get_context();
+    int i;
+    int next = -1;
+    DS_Timer* timers[] = {
+        &ctx->fms_send_timer, &ctx->radio_send_timer, &ctx->robot_send_timer
+    };
+
+    for (i = 0; i < (int) (sizeof (timers) / sizeof (timers [0])); ++i) {
+        int remaining = DS_TimerRemaining (timers [i]);
+        if (remaining >= 0 && (next < 0 || remaining < next))
+            next = remaining;
+    }
+
+    /* Wake up when a watchdog expires */
+    if (ctx->enable_operations) {
+        uint64_t now = DS_GetTimeUs();
+        DS_ChannelWatchdog* watchdogs[] = {
+            &ctx->fms_watchdog, &ctx->radio_watchdog, &ctx->robot_watchdog
+        };
+
+        for (i = 0; i < 3; ++i) {
+            int remaining = watchdog_remaining (watchdogs [i], now);
+            if (remaining >= 0 && (next < 0 || remaining < next))
+                next = remaining;
+        }
+    }
+
+    /* Wake up when the next replayed datagram must be read */
+    int replay = ctx->enable_operations ? Replay_Remaining() : -1;
+    if (replay >= 0 && (next < 0 || replay < next))
+        next = replay;
+
+    /* Wake up when the exported telemetry must be updated */
+    int telemetry = Telemetry_Remaining();
+    if (telemetry >= 0 && (next < 0 || telemetry < next))
+        next = telemetry;
+
+    /* Wake up when the requested early robot packet can be sent */
+    int early = ctx->enable_operations ? early_send_remaining() : -1;
+    if (early >= 0 && (next < 0 || early < next))
+        next = early;
+
+    /* Wake up when the next packet of a state change burst must be sent */
+    int state = ctx->enable_operations && !Replay_Running() ?
+                state_send_remaining() : -1;
+    if (state >= 0 && (next < 0 || state < next))
+        next = state;
+
+    /* Wake up when the next bandwidth sample must be taken */
+    int bandwidth = ctx->enable_operations ? Bandwidth_Remaining() : -1;
+    if (bandwidth >= 0 && (next < 0 || bandwidth < next))
+        next = bandwidth;
+
+    /* Wake up when the queued NetConsole messages must be sent */
+    int netconsole = ctx->enable_operations ? NetConsole_SendRemaining() : -1;
+    if (netconsole >= 0 && (next < 0 || netconsole < next))
+        next = netconsole;
+
+    return next;
+}
+
+/**
+ * Applies the scheduling options requested by the application to the
+ * event loop thread (this function is called by the thread itself)
+ */
+static void apply_thread_options()
+{
+    ProtocolsContext* ctx = get_context();
+
+    /* Options did not change */
+    size_t options = DS_AtomicLoad (&ctx->thread_options);
+    if (options == ctx->applied_thread_options)
+        return;
+
+    ctx->applied_thread_options = options;
+
+    /* Change the priority and the affinity, notify the user on failure */
+    int ok = DS_SetThreadRealtime (ctx->thread_realtime);
+    if (ok && ctx->thread_cpu >= 0)
+        ok = DS_SetThreadAffinity (ctx->thread_cpu);
+    else if (ok)
+        DS_SetThreadAffinity (-1);
+
+    if (!ok) {
+        CFG_AddStaticNotification (CFG_NOTIFY_THREAD_SCHEDULING);
+    }
+}
+
+/**
+ * Spins until a socket receives data or until a sender timer, watchdog or
+ * other deadline expires, instead of sleeping (see
+ * \c DS_SetProtocolBusyPolling())
+ */
+static void busy_wait()
+{
+    ProtocolsContext* ctx = get_context();
+
+    while (ctx->running && ctx->busy_polling) {
+        if (DS_SocketWaitForData (0, &ctx->data_generation))
+            break;
+        if (next_deadline() == 0)
+            break;
+
+        DS_CpuRelax();
+    }
+}
+
+/**
+ * This function is executed in a loop (in the thread of the given DS
+ * \a context), the function does the following:
+ *    - Apply the robot state changes requested by the application
+ *    - Send data to the FMS, robot and radio
+ *    - Read received data from the FMS, robot and radio
+ *    - Feed/reset the watchdogs
+ *    - Check if any of the watchdogs has expired
+ *    - Adapt the send rate to the robot packet loss (if enabled)
+ *    - Update the network usage rates
+ *    - Sample the bandwidth and check it against the budget
+ *    - Update the exported telemetry (if enabled)
+ *    - Exchange the dashboard entries (if enabled)
+ *
+ * Instead of polling at a fixed rate, the loop blocks until the next
+ * send/watchdog deadline or until a socket receives data, whichever
+ * comes first (or spins until then, in busy-polling mode).
+ *
+ * With the virtual clock, the loop reports each step of the clock that it
+ * handled before it waits (see \c DS_AdvanceClock()).
+ */
+static void* run_event_loop (void* context)
+{
+    DS_ContextMakeCurrent ((DS_Context*) context);
+    ProtocolsContext* ctx = get_context();
+    size_t clock_acked = 0;
+
+    DS_TRACE_THREAD ("LibDS event loop");
+    Timers_ClockJoin();
+
+    while (ctx->running) {
+        size_t step = Timers_ClockStep();
+
+        DS_TRACE_BEGIN ("run_event_loop");
+        apply_thread_options();
+        Client_ApplyCommands();
+        send_data();
+        recv_data();
+        update_watchdogs();
+        update_send_rate();
+        update_traffic();
+        update_bandwidth();
+        Telemetry_Update();
+        Dashboard_Update();
+        Messages_Update();
+        DS_TRACE_END ("run_event_loop");
+
+        /* Wait for the next deadline or for incoming data */
+        int wait = next_deadline();
+        if (wait != 0 && !Timers_ClockHandled (step, &clock_acked))
+            wait = 0;
+
+        if (wait > 0 && ctx->busy_polling && !ctx->idle)
+            busy_wait();
+
+        else if (wait != 0) {
+            DS_SocketWaitForData (wait > 0 ? wait : IDLE_WAIT,
+                                  &ctx->data_generation);
+            next_deadline();
+        }
+    }
+
+    Timers_ClockLeave();
+    return NULL;
+}
+
+/**
+ * Returns \c 1 if the calling thread is the event loop thread
+ */
+static int on_event_loop (const ProtocolsContext* ctx)
+{
+#if defined _WIN32
+    return GetThreadId (ctx->event_thread) == GetCurrentThreadId();
+#else
+    return pthread_equal (ctx->event_thread, pthread_self());
+#endif
+}
+
+/**
+ * Returns \c 1 if the event loop runs in another thread than the calling
+ * thread, in which case the robot state changes are queued for it (see
+ * \c Client_ApplyCommands())
+ */
+int Protocols_QueuesCommands (void)
+{
+    ProtocolsContext* ctx = get_context();
+
+    return ctx->running && !on_event_loop (ctx);
+}
+
+/**
+ * Returns a pointer to the current protocol
+ */
+DS_Protocol* DS_CurrentProtocol()
+{
+    ProtocolsContext* ctx = get_context();
+
+    if (ctx->enable_operations)
+        return &ctx->protocol;
+
+    return NULL;
+}
+
+/**
+ * Initializes the protocol sender/receiver thread and the timers
+ */
+void Protocols_Init()
+{
+    ProtocolsContext* ctx = get_context();
+
+    /* Initialize the packet scratch buffer */
+    DS_PacketInit (&ctx->send_packet, ctx->send_buffer,
+                   sizeof (ctx->send_buffer));
+
+    /* Initialize sender timers */
+    DS_TimerInit (&ctx->fms_send_timer,   0, SEND_PRECISION);
+    DS_TimerInit (&ctx->radio_send_timer, 0, SEND_PRECISION);
+    DS_TimerInit (&ctx->robot_send_timer, 0, SEND_PRECISION);
+
+    /* Allow the event loop to run */
+    ctx->running = 1;
+    ctx->enable_operations = 0;
+
+    /* Configure the event thread */
+    int error = DS_CreateThread (&ctx->event_thread, "DS Event Loop",
+                                 &run_event_loop, DS_ContextCurrent());
+
+    /* Display error message if we cannot star the event loop */
+    if (error) {
+        DS_String caption = DS_StrNew ("LibDS");
+        DS_String message = DS_StrNew ("Cannot start protocol event loop!");
+        DS_ShowMessageBox (&caption, &message, DS_ICON_ERROR);
+        DS_StrRmBuf (&caption);
+        DS_StrRmBuf (&message);
+    }
+
+    /* Quit if the thread fails to start */
+    assert (!error);
+}
+
+/**
+ * De-allocates the current protocol and closes its sockets
+ */
+static void close_protocol (const int close_sockets)
+{
+    ProtocolsContext* ctx = get_context();
+
+    /* Protocol is empty, abort */
+    if (!ctx->enable_operations)
+        return;
+
+    /* Disable protocol operations */
+    ctx->enable_operations = 0;
+
+    /* Stop sender timers */
+    DS_TimerStop (&ctx->fms_send_timer);
+    DS_TimerStop (&ctx->radio_send_timer);
+    DS_TimerStop (&ctx->robot_send_timer);
+
+    /* Close the sockets (unless the next protocol re-uses them) */
+    if (close_sockets) {
+        DS_SocketClose (&ctx->protocol.fms_socket);
+        DS_SocketClose (&ctx->protocol.radio_socket);
+        DS_SocketClose (&ctx->protocol.robot_socket);
+        DS_SocketClose (&ctx->protocol.robot_stream_socket);
+        DS_SocketClose (&ctx->protocol.netconsole_socket);
+    }
+
+    /* The next protocol starts its robot stream from scratch */
+    ctx->robot_stream_connected = 0;
+
+    /* Reset the network usage */
+    reset_traffic (&ctx->fms_traffic);
+    reset_traffic (&ctx->radio_traffic);
+    reset_traffic (&ctx->robot_traffic);
+    ctx->last_traffic_update = 0;
+    Bandwidth_Reset();
+
+    /* Reset sent/recv packets */
+    DS_ResetFMSPackets();
+    DS_ResetRadioPackets();
+    DS_ResetRobotPackets();
+
+    /* Create notification string */
+    char* name = DS_StrToChar (&ctx->protocol.name);
+    DS_String str = DS_StrFormat ("Closed %s protocol", name);
+    CFG_AddNotification (&str);
+    DS_StrRmBuf (&str);
+    DS_FREE (name);
+
+    /* Delete the protocol name (owned by this module) */
+    DS_StrRmBuf (&ctx->protocol.name);
+}
+
+/**
+ * Stops the sender/receiver thread and deletes the allocated protocol
+ */
+void Protocols_Close()
+{
+    ProtocolsContext* ctx = get_context();
+
+    /* Stop the event loop and wait for it to finish */
+    ctx->running = 0;
+    DS_SocketWakeUp();
+    DS_JoinThread (ctx->event_thread);
+
+    /* Apply the state changes that the event loop did not get to */
+    Client_ApplyCommands();
+
+    /* Close the protocol */
+    close_protocol (1);
+
+    /* Un-register the timers, the context may be deleted after this */
+    DS_TimerFree (&ctx->fms_send_timer);
+    DS_TimerFree (&ctx->radio_send_timer);
+    DS_TimerFree (&ctx->robot_send_timer);
+}
+
+/**
+ * Simulates the network conditions set by the application on the sockets
+ * of the current protocol
+ */
+static void apply_impairment (void)
+{
+    ProtocolsContext* ctx = get_context();
+
+    DS_SocketSetImpairment (&ctx->protocol.fms_socket, &ctx->impairment);
+    DS_SocketSetImpairment (&ctx->protocol.radio_socket, &ctx->impairment);
+    DS_SocketSetImpairment (&ctx->protocol.robot_socket, &ctx->impairment);
+    DS_SocketSetImpairment (&ctx->protocol.netconsole_socket, &ctx->impairment);
+}
+
+/**
+ * De-allocates the current protocol and loads the given protocol
+ *
+ * Note the given \a ptr is not used directly, but the name of the protocol
+ * now belongs to the LibDS and is deleted when the protocol is closed. The
+ * sockets of \a ptr are only read as a configuration, they are never opened.
+ *
+ * \param ptr pointer to the new protocol implementation to load
+ */
+void DS_ConfigureProtocol (const DS_Protocol* ptr)
+{
+    ProtocolsContext* ctx = get_context();
+
+    /* Pointer is NULL, abort */
+    assert (ptr != NULL);
+
+    /* Close previous protocol, but keep its sockets open */
+    close_protocol (0);
+
+    /* Copy the descriptor, the sockets keep their own runtime state */
+    memcpy (&ctx->protocol, ptr, offsetof (DS_Protocol, fms_socket));
+
+    /* Open the sockets (when switching protocols, only re-bind the ports
+     * that changed) */
+    DS_SocketReconfigure (&ctx->protocol.fms_socket, &ptr->fms_socket);
+    DS_SocketReconfigure (&ctx->protocol.radio_socket, &ptr->radio_socket);
+    DS_SocketReconfigure (&ctx->protocol.robot_socket, &ptr->robot_socket);
+    DS_SocketReconfigure (&ctx->protocol.robot_stream_socket,
+                          &ptr->robot_stream_socket);
+    DS_SocketReconfigure (&ctx->protocol.netconsole_socket,
+                          &ptr->netconsole_socket);
+
+    /* Keep simulating the network conditions on the new sockets */
+    apply_impairment();
+
+#if defined DS_STATIC_FRC_2015
+    /* Use the FRC 2015 packet functions directly, if possible */
+    ctx->static_frc_2015 = DS_FRC2015_Matches (&ctx->protocol);
+#endif
+
+    /* The new protocol may read another robot clock */
+    DS_MutexLock (&ctx->stats_mutex);
+    memset (&ctx->robot_clock, 0, sizeof (DS_ClockEstimator));
+    DS_MutexUnlock (&ctx->stats_mutex);
+
+    /* Update sender timers and watchdogs (at the full send rate) */
+    ctx->idle = 0;
+    ctx->backoff_level = 0;
+    apply_intervals();
+
+    /* Start the timers and watchdogs */
+    DS_TimerStart (&ctx->fms_send_timer);
+    DS_TimerStart (&ctx->radio_send_timer);
+    DS_TimerStart (&ctx->robot_send_timer);
+    reset_watchdog (&ctx->fms_watchdog);
+    reset_watchdog (&ctx->radio_watchdog);
+    reset_watchdog (&ctx->robot_watchdog);
+
+    /* Create notification string */
+    char* name = DS_StrToChar (&ctx->protocol.name);
+    DS_String str = DS_StrFormat ("Loaded %s protocol", name);
+    CFG_AddNotification (&str);
+    DS_StrRmBuf (&str);
+    DS_FREE (name);
+
+    /* Restore protocol operations */
+    ctx->enable_operations = 1;
+
+    /* Apply the addresses of the new protocol now, not when watchdogs expire */
+    CFG_ReconfigureAddresses (RECONFIGURE_ALL);
+}
+
+/**
+ * Returns the number of sent FMS bytes since the current
+ * protocol was loaded.
+ *
+ * This value is only reset to 0 when the current protocol
+ * is closed (e.g while loading another protocol).
+ */
+unsigned long DS_SentFMSBytes()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return (unsigned long) DS_AtomicLoad64 (&ctx->fms_traffic.sent_bytes);
+}
+
+/**
+ * Returns the number of sent radio bytes since the current
+ * protocol was loaded.
+ *
+ * This value is only reset to 0 when the current protocol
+ * is closed (e.g while loading another protocol).
+ */
+unsigned long DS_SentRadioBytes()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return (unsigned long) DS_AtomicLoad64 (&ctx->radio_traffic.sent_bytes);
+}
+
+/**
+ * Returns the number of sent robot bytes since the current
+ * protocol was loaded.
+ *
+ * This value is only reset to 0 when the current protocol
+ * is closed (e.g while loading another protocol).
+ */
+unsigned long DS_SentRobotBytes()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return (unsigned long) DS_AtomicLoad64 (&ctx->robot_traffic.sent_bytes);
+}
+
+/**
+ * Returns the number of received FMS bytes since the
+ * current protocol was loaded.
+ *
+ * This value is only reset to 0 when the current protocol
+ * is closed (e.g while loading another protocol).
+ */
+unsigned long DS_ReceivedFMSBytes()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return (unsigned long) DS_AtomicLoad64 (&ctx->fms_traffic.recv_bytes);
+}
+
+/**
+ * Returns the number of received radio bytes since the
+ * current protocol was loaded.
+ *
+ * This value is only reset to 0 when the current protocol
+ * is closed (e.g while loading another protocol).
+ */
+unsigned long DS_ReceivedRadioBytes()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return (unsigned long) DS_AtomicLoad64 (&ctx->radio_traffic.recv_bytes);
+}
+
+/**
+ * Returns the number of received robot bytes since the
+ * current protocol was loaded.
+ *
+ * This value is only reset to 0 when the current protocol
+ * is closed (e.g while loading another protocol).
+ */
+unsigned long DS_ReceivedRobotBytes()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return (unsigned long) DS_AtomicLoad64 (&ctx->robot_traffic.recv_bytes);
+}
+
+/**
+ * Returns the number of sent FMS packets.
+ *
+ * This value is reset when the communications with
+ * the FMS are changed, or when the protocol is changed.
+ */
+int DS_SentFMSPackets()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return DS_Max (1, ctx->sent_fms_packets);
+}
+
+/**
+ * Returns the number of sent radio packets.
+ *
+ * This value is reset when the communications with
+ * the radio are changed, or when the protocol is changed.
+ */
+int DS_SentRadioPackets()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return DS_Max (1, ctx->sent_radio_packets);
+}
+
+/**
+ * Returns the number of sent robot packets.
+ *
+ * This value is reset when the communications with
+ * the robot are changed, or when the protocol is changed.
+ */
+int DS_SentRobotPackets()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return DS_Max (1, ctx->sent_robot_packets);
+}
+
+/**
+ * Returns the number of received FMS packets.
+ *
+ * This value is reset when the communications with
+ * the FMS are changed, or when the protocol is changed.
+ */
+int DS_ReceivedFMSPackets()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return ctx->received_fms_packets;
+}
+
+/**
+ * Returns the number of received radio packets.
+ *
+ * This value is reset when the communications with
+ * the radio are changed, or when the protocol is changed.
+ */
+int DS_ReceivedRadioPackets()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return ctx->received_radio_packets;
+}
+
+/**
+ * Returns the number of received robot packets.
+ *
+ * This value is reset when the communications with
+ * the robot are changed, or when the protocol is changed.
+ */
+int DS_ReceivedRobotPackets()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return ctx->received_robot_packets;
+}
+
+/**
+ * Returns the number of duplicated robot packets that were discarded by the
+ * protocol.
+ *
+ * This value is reset when the communications with
+ * the robot are changed, or when the protocol is changed.
+ */
+int DS_DuplicatedRobotPackets()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return ctx->duplicated_robot_packets;
+}
+
+/**
+ * Returns the number of out-of-order (stale) robot packets that were
+ * discarded by the protocol.
+ *
+ * This value is reset when the communications with
+ * the robot are changed, or when the protocol is changed.
+ */
+int DS_ReorderedRobotPackets()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return ctx->reordered_robot_packets;
+}
+
+/**
+ * Called by the protocol when it discards a duplicated robot packet
+ */
+void DS_CountDuplicatedRobotPacket()
+{
+    ProtocolsContext* ctx = get_context();
+
+    ++ctx->duplicated_robot_packets;
+}
+
+/**
+ * Called by the protocol when it discards an out-of-order robot packet
+ */
+void DS_CountReorderedRobotPacket()
+{
+    ProtocolsContext* ctx = get_context();
+
+    ++ctx->reordered_robot_packets;
+}
+
+/**
+ * Called by the protocol when it reads a message stamped with the robot
+ * clock (\a robot_time is in seconds). The sample is assumed to have taken
+ * half of the robot round-trip time to arrive, and updates the estimated
+ * offset and drift between the DS and robot clocks.
+ */
+void DS_AddRobotClockSample (const double robot_time)
+{
+    ProtocolsContext* ctx = get_context();
+    uint64_t now = receive_time (ctx);
+
+    DS_MutexLock (&ctx->stats_mutex);
+    double transit = DS_HistogramPercentile (&ctx->robot_stats.round_trip, 50) / 2.0;
+    update_clock (&ctx->robot_clock, robot_time * 1e6 - (double) now + transit,
+                  now);
+    DS_MutexUnlock (&ctx->stats_mutex);
+}
+
+/**
+ * Returns the estimated offset and drift between the DS and robot clocks,
+ * which is only valid if the protocol reads robot messages that are stamped
+ * with the robot clock (e.g. the console messages of the FRC 2020 protocol).
+ *
+ * The estimate restarts when the protocol is changed, or when the robot
+ * clock jumps (e.g. when the robot reboots).
+ */
+DS_ClockInfo DS_GetRobotClockInfo()
+{
+    ProtocolsContext* ctx = get_context();
+    DS_ClockInfo info;
+
+    DS_MutexLock (&ctx->stats_mutex);
+    uint64_t now = DS_GetTimeUs();
+    DS_ClockEstimator* clock = &ctx->robot_clock;
+    info.valid = clock->samples > 0;
+    info.samples = clock->samples;
+    info.offset = clock_offset (clock, now) / 1000.0;
+    info.drift = clock->drift * 1e6;
+    info.error = clock->error / 1000.0;
+    DS_MutexUnlock (&ctx->stats_mutex);
+
+    return info;
+}
+
+/**
+ * Converts the given DS time (in usecs, see \c DS_GetTimeUs()) to the time
+ * of the robot clock (in seconds), so that the DS logs can be merged with
+ * the logs of the robot program.
+ *
+ * \returns the robot time, or \c -1 if the robot clock was never sampled
+ */
+double DS_RobotClockTime (const uint64_t usecs)
+{
+    ProtocolsContext* ctx = get_context();
+    double time = -1;
+
+    DS_MutexLock (&ctx->stats_mutex);
+    if (ctx->robot_clock.samples > 0)
+        time = ((double) usecs + clock_offset (&ctx->robot_clock, usecs)) / 1e6;
+    DS_MutexUnlock (&ctx->stats_mutex);
+
+    return time;
+}
+
+/**
+ * Resets the number of sent/received FMS packets.
+ * This function is called when the connection state with the FMS is changed
+ */
 void DS_ResetFMSPackets()
 {
-    sent_fms_packets = 0;
-    received_fms_packets = 0;
+    ProtocolsContext* ctx = get_context();
+
+    ctx->sent_fms_packets = 0;
+    ctx->received_fms_packets = 0;
+    reset_stats (&ctx->fms_stats);
 }
 
 /**
@@ -610,8 +2068,11 @@ void DS_ResetFMSPackets()
  */
 void DS_ResetRadioPackets()
 {
-    sent_radio_packets = 0;
-    received_radio_packets = 0;
+    ProtocolsContext* ctx = get_context();
+
+    ctx->sent_radio_packets = 0;
+    ctx->received_radio_packets = 0;
+    reset_stats (&ctx->radio_stats);
 }
 
 /**
@@ -620,6 +2081,467 @@ void DS_ResetRadioPackets()
  */
 void DS_ResetRobotPackets()
 {
-    sent_robot_packets = 0;
-    received_robot_packets = 0;
+    ProtocolsContext* ctx = get_context();
+
+    ctx->sent_robot_packets = 0;
+    ctx->received_robot_packets = 0;
+    ctx->duplicated_robot_packets = 0;
+    ctx->reordered_robot_packets = 0;
+    reset_stats (&ctx->robot_stats);
+}
+
+/**
+ * Returns the round-trip latency, the inter-arrival jitter, the send deadline
+ * lateness and the send period of the FMS packets (in microseconds), along
+ * with the number of missed send deadlines.
+ *
+ * These values are reset when the communications with
+ * the FMS are changed, or when the protocol is changed.
+ */
+DS_LatencyInfo DS_GetFMSLatencyInfo()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return get_latency_info (&ctx->fms_stats);
+}
+
+/**
+ * Returns the round-trip latency, the inter-arrival jitter, the send deadline
+ * lateness and the send period of the radio packets (in microseconds), along
+ * with the number of missed send deadlines.
+ *
+ * These values are reset when the communications with
+ * the radio are changed, or when the protocol is changed.
+ */
+DS_LatencyInfo DS_GetRadioLatencyInfo()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return get_latency_info (&ctx->radio_stats);
+}
+
+/**
+ * Returns the round-trip latency, the inter-arrival jitter, the send deadline
+ * lateness and the send period of the robot packets (in microseconds), along
+ * with the number of missed send deadlines.
+ *
+ * These values are reset when the communications with
+ * the robot are changed, or when the protocol is changed.
+ */
+DS_LatencyInfo DS_GetRobotLatencyInfo()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return get_latency_info (&ctx->robot_stats);
+}
+
+/**
+ * Copies the round-trip latency and the inter-arrival jitter histograms of
+ * the robot packets (in microseconds) into the given histograms, e.g. to
+ * export their buckets to a monitoring system
+ */
+void DS_GetRobotLatencyHistograms (DS_Histogram* round_trip,
+                                   DS_Histogram* jitter)
+{
+    ProtocolsContext* ctx = get_context();
+
+    assert (round_trip);
+    assert (jitter);
+
+    DS_MutexLock (&ctx->stats_mutex);
+    *round_trip = ctx->robot_stats.round_trip;
+    *jitter = ctx->robot_stats.jitter;
+    DS_MutexUnlock (&ctx->stats_mutex);
+}
+
+/**
+ * Returns the packet loss of the FMS channel over the configured window,
+ * along with the number of consecutive packets lost most recently
+ */
+DS_LossInfo DS_GetFMSLossInfo()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return get_loss_info (&ctx->fms_stats);
+}
+
+/**
+ * Returns the packet loss of the radio channel over the configured window,
+ * along with the number of consecutive packets lost most recently
+ */
+DS_LossInfo DS_GetRadioLossInfo()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return get_loss_info (&ctx->radio_stats);
+}
+
+/**
+ * Returns the packet loss of the robot channel over the configured window,
+ * along with the number of consecutive packets lost most recently
+ */
+DS_LossInfo DS_GetRobotLossInfo()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return get_loss_info (&ctx->robot_stats);
+}
+
+/**
+ * Changes the time window (in \a millisecs) over which the packet loss is
+ * calculated. The window is also limited to the last 512 sent packets.
+ */
+void DS_SetPacketLossWindow (const int millisecs)
+{
+    ProtocolsContext* ctx = get_context();
+
+    ctx->loss_window = DS_Max (millisecs, 1);
+}
+
+/**
+ * Returns the number of bytes and packets sent to and received from the FMS
+ * since the current protocol was loaded, along with their rates per second
+ */
+DS_TrafficInfo DS_GetFMSTrafficInfo()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return get_traffic_info (&ctx->fms_traffic);
+}
+
+/**
+ * Returns the number of bytes and packets sent to and received from the
+ * radio since the current protocol was loaded, along with their rates per
+ * second
+ */
+DS_TrafficInfo DS_GetRadioTrafficInfo()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return get_traffic_info (&ctx->radio_traffic);
+}
+
+/**
+ * Returns the number of bytes and packets sent to and received from the
+ * robot since the current protocol was loaded, along with their rates per
+ * second
+ */
+DS_TrafficInfo DS_GetRobotTrafficInfo()
+{
+    ProtocolsContext* ctx = get_context();
+
+    return get_traffic_info (&ctx->robot_traffic);
+}
+
+/**
+ * Asks the protocol event loop to send a robot packet as soon as possible
+ * (instead of waiting for the next send interval), e.g. because the user
+ * pressed a button or pulled a trigger.
+ *
+ * This function does nothing unless early robot packets are enabled with
+ * \c DS_SetEarlyRobotPacketGap()
+ */
+void DS_RequestRobotPacket (void)
+{
+    ProtocolsContext* ctx = get_context();
+
+    if (ctx->early_send_gap > 0 && !DS_AtomicLoad (&ctx->early_send_requested)) {
+        DS_AtomicStore (&ctx->early_send_requested, 1);
+        DS_SocketWakeUp();
+    }
+}
+
+/**
+ * Asks the protocol event loop to send a robot packet right away, followed
+ * by redundant copies (see \c DS_SetStateChangeBurst()), so that the robot
+ * learns about the new state even if a packet is lost. This is done when
+ * the application enables, disables or e-stops the robot.
+ */
+void DS_SendStateChange (void)
+{
+    ProtocolsContext* ctx = get_context();
+
+    if (ctx->state_burst > 0) {
+        DS_AtomicStore (&ctx->state_packets, (size_t) ctx->state_burst);
+        DS_SocketWakeUp();
+    }
+}
+
+/**
+ * Simulates the given network conditions (packet loss, latency, jitter,
+ * duplication, reordering and bandwidth caps) on the FMS, radio, robot and
+ * NetConsole sockets, e.g. to rehearse the conditions of a competition
+ * field, or to test the watchdogs and the adaptive send rate. The conditions
+ * are applied to the sockets of the protocols that are loaded later too.
+ *
+ * Set \a impairment to \c NULL to stop simulating them (default)
+ */
+void DS_SetNetworkImpairment (const DS_SocketImpairment* impairment)
+{
+    ProtocolsContext* ctx = get_context();
+
+    if (impairment)
+        ctx->impairment = *impairment;
+    else
+        memset (&ctx->impairment, 0, sizeof (DS_SocketImpairment));
+
+    apply_impairment();
+}
+
+/**
+ * Changes the number of robot \a packets sent when the robot state changes,
+ * the packets are sent \c STATE_SPACING msecs apart (the first one is sent
+ * right away). The default is \c STATE_BURST packets.
+ *
+ * Set \a packets to \c 0 to wait for the next send interval instead
+ */
+void DS_SetStateChangeBurst (const int packets)
+{
+    ProtocolsContext* ctx = get_context();
+
+    ctx->state_burst = DS_Max (packets, 0);
+    DS_AtomicStore (&ctx->state_packets, 0);
+}
+
+/**
+ * Enables early robot packets, which are sent when the joystick input
+ * changes significantly. An early packet is never sent less than
+ * \a millisecs after the previous robot packet, and the regular send
+ * interval restarts after each early packet.
+ *
+ * Set \a millisecs to \c 0 to disable early robot packets (default)
+ */
+void DS_SetEarlyRobotPacketGap (const int millisecs)
+{
+    ProtocolsContext* ctx = get_context();
+
+    ctx->early_send_gap = DS_Max (millisecs, 0);
+    DS_AtomicStore (&ctx->early_send_requested, 0);
+}
+
+/**
+ * Changes the interval (in \a millisecs) between the packets sent to the
+ * FMS, the receiver watchdog is adjusted accordingly.
+ *
+ * Set \a millisecs to \c 0 to use the interval of the protocol (default)
+ */
+void DS_SetFMSSendInterval (const int millisecs)
+{
+    ProtocolsContext* ctx = get_context();
+
+    ctx->fms_send_interval = DS_Max (millisecs, 0);
+    apply_intervals();
+    DS_SocketWakeUp();
+}
+
+/**
+ * Changes the interval (in \a millisecs) between the packets sent to the
+ * radio, the receiver watchdog is adjusted accordingly.
+ *
+ * Set \a millisecs to \c 0 to use the interval of the protocol (default)
+ */
+void DS_SetRadioSendInterval (const int millisecs)
+{
+    ProtocolsContext* ctx = get_context();
+
+    ctx->radio_send_interval = DS_Max (millisecs, 0);
+    apply_intervals();
+    DS_SocketWakeUp();
+}
+
+/**
+ * Changes the interval (in \a millisecs) between the packets sent to the
+ * robot, the receiver watchdog is adjusted accordingly.
+ *
+ * Set \a millisecs to \c 0 to use the interval of the protocol (default)
+ */
+void DS_SetRobotSendInterval (const int millisecs)
+{
+    ProtocolsContext* ctx = get_context();
+
+    ctx->robot_send_interval = DS_Max (millisecs, 0);
+    apply_intervals();
+    DS_SocketWakeUp();
+}
+
+/**
+ * Enables or disables the adaptive send rate. When enabled, non-essential
+ * traffic (the FMS packets and the date/timezone data of the robot packets)
+ * is reduced while the robot packet loss rises, so that the control data
+ * keeps flowing on congested networks. The traffic is restored gradually
+ * once the loss is low again.
+ *
+ * The adaptive send rate is disabled by default
+ */
+void DS_SetAdaptiveSendRate (const int enabled)
+{
+    ProtocolsContext* ctx = get_context();
+
+    ctx->adaptive_rate = (enabled != 0);
+
+    /* Restore the full send rate */
+    if (!ctx->adaptive_rate && ctx->backoff_level > 0) {
+        ctx->backoff_level = 0;
+        apply_intervals();
+    }
+}
+
+/**
+ * Returns the current backoff level of the adaptive send rate, \c 0 if the
+ * non-essential traffic is sent normally. Protocols should defer optional
+ * data while this value is greater than \c 0.
+ */
+int DS_SendRateBackoff (void)
+{
+    ProtocolsContext* ctx = get_context();
+
+    return ctx->backoff_level;
+}
+
+/**
+ * Enables or disables the power saving mode. When enabled, the DS becomes
+ * idle after the robot watchdog expires (and there are no FMS comms): the
+ * packets are sent every \c IDLE_INTERVAL milliseconds to discover the
+ * robot and the event loop sleeps in between. The full send rate is
+ * restored with the first valid robot (or FMS) packet.
+ *
+ * Power saving is enabled by default
+ */
+void DS_SetPowerSaving (const int enabled)
+{
+    ProtocolsContext* ctx = get_context();
+
+    ctx->power_saving = (enabled != 0);
+
+    /* Restore the full send rate */
+    if (!ctx->power_saving) {
+        set_idle (0);
+        DS_SocketWakeUp();
+    }
+}
+
+/**
+ * Returns \c 1 if the DS is idle (no robot has been found and the packets
+ * are sent at a reduced rate), \c 0 if not
+ */
+int DS_PowerSavingIdle (void)
+{
+    ProtocolsContext* ctx = get_context();
+
+    return ctx->idle;
+}
+
+/**
+ * Changes the time (in \a millisecs) after which the FMS comms are lost if
+ * no valid packet is received.
+ *
+ * Set \a millisecs to \c 0 to derive it from the send interval (default)
+ */
+void DS_SetFMSWatchdogTimeout (const int millisecs)
+{
+    ProtocolsContext* ctx = get_context();
+
+    ctx->fms_watchdog_timeout = DS_Max (millisecs, 0);
+    apply_intervals();
+    DS_SocketWakeUp();
+}
+
+/**
+ * Changes the time (in \a millisecs) after which the radio comms are lost if
+ * no valid packet is received.
+ *
+ * Set \a millisecs to \c 0 to derive it from the send interval (default)
+ */
+void DS_SetRadioWatchdogTimeout (const int millisecs)
+{
+    ProtocolsContext* ctx = get_context();
+
+    ctx->radio_watchdog_timeout = DS_Max (millisecs, 0);
+    apply_intervals();
+    DS_SocketWakeUp();
+}
+
+/**
+ * Changes the time (in \a millisecs) after which the robot comms are lost if
+ * no valid packet is received.
+ *
+ * Set \a millisecs to \c 0 to derive it from the send interval (default)
+ */
+void DS_SetRobotWatchdogTimeout (const int millisecs)
+{
+    ProtocolsContext* ctx = get_context();
+
+    ctx->robot_watchdog_timeout = DS_Max (millisecs, 0);
+    apply_intervals();
+    DS_SocketWakeUp();
+}
+
+/**
+ * Changes the number of consecutive valid packets that must be received to
+ * restore the lost comms of a channel (3 by default), so that a single stray
+ * packet does not make the comms flicker. Invalid packets never cause the
+ * comms to be lost, only the watchdogs do.
+ */
+void DS_SetWatchdogRecovery (const int packets)
+{
+    ProtocolsContext* ctx = get_context();
+
+    ctx->recovery_packets = DS_Max (packets, 1);
+}
+
+/**
+ * Raises the priority of the protocol event loop and of the socket reactor
+ * thread to a real-time priority (if \a enabled is set to \c 1), so that
+ * the packets are sent on time even if the computer is busy. This may
+ * require elevated privileges, a notification is shown if it fails.
+ *
+ * The real-time priority is disabled by default
+ */
+void DS_SetProtocolThreadRealtime (const int enabled)
+{
+    ProtocolsContext* ctx = get_context();
+
+    ctx->thread_realtime = (enabled != 0);
+    DS_AtomicFetchAdd (&ctx->thread_options, 1);
+    DS_SocketSetThreadOptions (ctx->thread_realtime, ctx->thread_cpu);
+    DS_SocketWakeUp();
+}
+
+/**
+ * Pins the protocol event loop and the socket reactor thread to the given
+ * \a cpu (starting from \c 0), or lets them run on any CPU if \a cpu is
+ * negative (default). This is not supported on macOS.
+ */
+void DS_SetProtocolThreadAffinity (const int cpu)
+{
+    ProtocolsContext* ctx = get_context();
+
+    ctx->thread_cpu = DS_Max (cpu, -1);
+    DS_AtomicFetchAdd (&ctx->thread_options, 1);
+    DS_SocketSetThreadOptions (ctx->thread_realtime, ctx->thread_cpu);
+    DS_SocketWakeUp();
+}
+
+/**
+ * Enables or disables the busy-polling mode (meant for matches, when the
+ * power usage does not matter). Instead of sleeping until the next
+ * deadline, the protocol event loop and the socket reactor thread spin
+ * (with CPU pause hints), so that the packets are sent and read within
+ * tens of microseconds, regardless of the sleep granularity of the OS.
+ * Where supported, the kernel also busy-polls the sockets (\c SO_BUSY_POLL).
+ *
+ * This keeps two CPU cores busy, it is best combined with a real-time
+ * priority and a dedicated CPU (see \c DS_SetProtocolThreadRealtime() and
+ * \c DS_SetProtocolThreadAffinity()). While the DS is idle (see
+ * \c DS_SetPowerSaving()), the event loop sleeps anyway.
+ *
+ * Busy-polling is disabled by default
+ */
+void DS_SetProtocolBusyPolling (const int enabled)
+{
+    ProtocolsContext* ctx = get_context();
+
+    ctx->busy_polling = (enabled != 0);
+    DS_SocketSetBusyPolling (ctx->busy_polling);
+    DS_SocketWakeUp();
 }
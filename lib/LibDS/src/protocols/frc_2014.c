@@ -22,12 +22,16 @@
  */
 
 #include <math.h>
+#include <string.h>
 
 #include "DS_Utils.h"
 #include "DS_Config.h"
+#include "DS_Reader.h"
+#include "DS_Context.h"
 #include "DS_Protocol.h"
 #include "DS_Joysticks.h"
 #include "DS_DefaultProtocols.h"
+#include "DS_Thread.h"
 
 /*
  * Protocol bytes
@@ -49,11 +53,6 @@ static const uint8_t cAllianceBlue     = 0x42;
 static const uint8_t cFMSAutonomous    = 0x53;
 static const uint8_t cFMSTeleoperated  = 0x43;
 
-/*
- * Sent robot packet counters, they are used as packet IDs
- */
-static unsigned int sent_robot_packets = 0;
-
 /*
  * Joystick properties
  */
@@ -63,11 +62,125 @@ static int max_buttons = 10;
 static int max_joysticks = 4;
 
 /*
- * Control code flags
+ * Layout of the robot packet, only the header (packet index, control code,
+ * team station and joystick data) changes between two packets
+ */
+#define PACKET_SIZE     1024
+#define PACKET_HEADER   40
+#define PACKET_VERSION  72
+#define PACKET_CHECKSUM 1020
+
+/*
+ * FRC Driver Station version (same as FRC DS 17.01)
+ */
+static const uint8_t cVersion [8] = {
+    0x31, 0x34, 0x30, 0x32, 0x31, 0x37, 0x30, 0x30
+};
+
+/*
+ * The CRC32 of the packet is calculated with the checksum field set to zero.
+ * Since the bytes that follow the header never change, the CRC register after
+ * the whole packet is a fixed linear function of the register after the
+ * header, xor'ed with the CRC register of the constant tail. The function is
+ * evaluated with one table per byte of the register.
+ */
+static uint32_t tail_crc;
+static uint32_t tail_shift [4][256];
+static DS_Once tail_once = DS_ONCE_INIT;
+
+/*
+ * Protocol state of a DS context, the sent robot packet counter is used to
+ * generate the packet IDs. The robot packet is kept between two sends, so
+ * that its constant regions are only written once.
+ */
+typedef struct {
+    unsigned int sent_robot_packets;
+    int resync;
+    int reboot;
+    int restart_code;
+    uint8_t packet [PACKET_SIZE];
+
+    /* Addresses of the current team number */
+    DS_StrCache radio_address;
+    DS_StrCache robot_address;
+} FRC2014Context;
+
+/**
+ * Initializes the control code flags and the robot packet template of a new
+ * DS context
+ */
+static void init_context (void* data)
+{
+    FRC2014Context* ctx = (FRC2014Context*) data;
+
+    ctx->resync = 1;
+    memset (ctx->packet, 0, sizeof (ctx->packet));
+    memcpy (ctx->packet + PACKET_VERSION, cVersion, sizeof (cVersion));
+}
+
+/**
+ * Returns the CRC register (without the initial and final inversion) after
+ * feeding the given \a size bytes of \a buf to a register with the given
+ * \a crc value
+ */
+static uint32_t crc_register (const uint32_t crc, const uint8_t* buf,
+                              const size_t size)
+{
+    return ~DS_CRC32Update (~crc, buf, size);
+}
+
+/**
+ * Calculates the CRC register of the constant tail of the robot packet and
+ * the tables that shift the register of the header through the tail
+ */
+static void init_tail_crc (void)
+{
+    int i;
+    int j;
+    uint8_t tail [PACKET_SIZE - PACKET_HEADER];
+
+    memset (tail, 0, sizeof (tail));
+    memcpy (tail + PACKET_VERSION - PACKET_HEADER, cVersion, sizeof (cVersion));
+
+    /* The register of the tail is its contribution with a zero register */
+    tail_crc = crc_register (0, tail, sizeof (tail));
+
+    /* Shifting a register through the tail is linear (for a zero tail) */
+    memset (tail, 0, sizeof (tail));
+    for (i = 0; i < 4; ++i) {
+        for (j = 0; j < 256; ++j)
+            tail_shift [i][j] = crc_register ((uint32_t) j << (i * 8),
+                                              tail, sizeof (tail));
+    }
+}
+
+/**
+ * Returns the CRC32 checksum of the robot packet, only the header of the
+ * \a packet is read
+ */
+static uint32_t get_packet_checksum (const uint8_t* packet)
+{
+    DS_CallOnce (&tail_once, &init_tail_crc);
+
+    uint32_t crc = crc_register (0xFFFFFFFF, packet, PACKET_HEADER);
+    crc = tail_shift [0][crc & 0xFF] ^
+          tail_shift [1][(crc >> 8) & 0xFF] ^
+          tail_shift [2][(crc >> 16) & 0xFF] ^
+          tail_shift [3][crc >> 24] ^
+          tail_crc;
+
+    return ~crc;
+}
+
+/**
+ * Returns the protocol state of the current DS context
  */
-static int resync = 1;
-static int reboot = 0;
-static int restart_code = 0;
+static FRC2014Context* get_context (void)
+{
+    return (FRC2014Context*) DS_ContextData (DS_CONTEXT_FRC_2014,
+                                             sizeof (FRC2014Context),
+                                             init_context, NULL);
+}
 
 /**
  * Gets the alliance type from the received \a byte
@@ -112,6 +225,7 @@ static DS_Position get_position (const uint8_t byte)
  */
 static uint8_t get_control_code (void)
 {
+    FRC2014Context* ctx = get_context();
     uint8_t code = cEmergencyStopOff;
     uint8_t enabled = CFG_GetRobotEnabled() ? cEnabled : 0x00;
 
@@ -132,7 +246,7 @@ static uint8_t get_control_code (void)
     }
 
     /* Resync robot communications */
-    if (resync)
+    if (ctx->resync)
         code |= cResyncComms;
 
     /* Let robot know if we are connected to FMS */
@@ -144,7 +258,7 @@ static uint8_t get_control_code (void)
         code = cEmergencyStopOn;
 
     /* Send the reboot code if required */
-    if (reboot)
+    if (ctx->reboot)
         code = cRebootRobot;
 
     return code;
@@ -194,8 +308,8 @@ static uint8_t get_digital_inputs (void)
 }
 
 /**
- * Adds joystick information to a DS-to-robot packet, beginning at the given
- * \a offset in the data packet.
+ * Writes the joystick information of a DS-to-robot packet to the given
+ * \a data, which must have room for 8 bytes per joystick.
  *
  * The 2014 communication protocol records the data for all four joysticks,
  * if a joystick or joystick member is not present, we will send a neutral
@@ -207,30 +321,33 @@ static uint8_t get_digital_inputs (void)
  * Button states are stored in a similar way as enumerated flags in a C/C++
  * program.
  */
-static DS_String get_joystick_data (void)
+static void write_joystick_data (uint8_t* data)
 {
     /* Initialize variables */
     int i = 0;
     int j = 0;
-    DS_String buf = DS_StrNewLen (0);
+
+    /* Get the (filtered) state of all joysticks */
+    DS_JoystickSnapshot snapshot;
+    DS_GetJoystickSnapshot (&snapshot);
 
     /* Add data for every joystick */
     for (i = 0; i < max_joysticks; ++i) {
+        const DS_JoystickState* state = &snapshot.joysticks [i];
+
         /* Add axis data */
-        for (j = 0; j < max_axes; ++j)
-            DS_StrAppend (&buf, DS_FloatToByte (DS_GetJoystickAxis (i, j), 1));
+        DS_FloatsToBytes (state->axes, data, max_axes, 1);
+        data += max_axes;
 
         /* Generate button data */
         uint16_t button_flags = 0;
         for (j = 0; j < max_buttons; ++j)
-            button_flags += (uint16_t) DS_GetJoystickButton (i, j) ? j * j : 0;
+            button_flags += (uint16_t) ((state->buttons >> j) & 1) ? j * j : 0;
 
         /* Add button data */
-        DS_StrAppend (&buf, (button_flags & 0xff00) >> 8);
-        DS_StrAppend (&buf, (button_flags & 0xff));
+        *data++ = (button_flags & 0xff00) >> 8;
+        *data++ = (button_flags & 0xff);
     }
-
-    return buf;
 }
 
 /**
@@ -247,7 +364,9 @@ static DS_String fms_address (void)
  */
 static DS_String radio_address (void)
 {
-    return DS_GetStaticIP (10, CFG_GetTeamNumber(), 1);
+    const int team = CFG_GetTeamNumber();
+    return DS_StrCacheFormat (&get_context()->radio_address, team,
+                              "10.%d.%d.1", team / 100, team % 100);
 }
 
 /**
@@ -255,7 +374,9 @@ static DS_String radio_address (void)
  */
 static DS_String robot_address (void)
 {
-    return DS_GetStaticIP (10, CFG_GetTeamNumber(), 2);
+    const int team = CFG_GetTeamNumber();
+    return DS_StrCacheFormat (&get_context()->robot_address, team,
+                              "10.%d.%d.2", team / 100, team % 100);
 }
 
 /**
@@ -285,57 +406,46 @@ static DS_String create_radio_packet (void)
  *     - (Number?) of digital inputs
  *     - The version of the FRC Driver Station
  *     - The CRC32 checksum of the packet
+ *
+ * Only the header of the packet template is updated, the version and the
+ * zero padding are written once (see \c init_context()).
  */
-static DS_String create_robot_packet (void)
+static void write_robot_packet (DS_Packet* packet)
 {
-    /* Create initial packet */
-    DS_String data = DS_StrNewLen (8);
+    FRC2014Context* ctx = get_context();
+    uint8_t* data = ctx->packet;
 
     /* Add packet index */
-    DS_StrSetChar (&data, 0, (sent_robot_packets & 0xff00) >> 8);
-    DS_StrSetChar (&data, 1, (sent_robot_packets & 0xff));
+    data [0] = (ctx->sent_robot_packets & 0xff00) >> 8;
+    data [1] = (ctx->sent_robot_packets & 0xff);
 
     /* Add control code and digital inputs */
-    DS_StrSetChar (&data, 2, get_control_code());
-    DS_StrSetChar (&data, 3,  get_digital_inputs());
+    data [2] = get_control_code();
+    data [3] = get_digital_inputs();
 
     /* Add team number */
-    DS_StrSetChar (&data, 4, (CFG_GetTeamNumber() & 0xff00) >> 8);
-    DS_StrSetChar (&data, 5, (CFG_GetTeamNumber() & 0xff));
+    data [4] = (CFG_GetTeamNumber() & 0xff00) >> 8;
+    data [5] = (CFG_GetTeamNumber() & 0xff);
 
     /* Add alliance and position */
-    DS_StrSetChar (&data, 6, get_alliance_code());
-    DS_StrSetChar (&data, 7, get_position_code());
+    data [6] = get_alliance_code();
+    data [7] = get_position_code();
 
     /* Add joystick data */
-    DS_String jsData = get_joystick_data();
-    DS_StrJoin (&data, &jsData);
-
-    /* Now resize the datagram to 1024 bytes */
-    DS_StrResize (&data, 1024);
-
-    /* Add FRC Driver Station version (same as FRC DS 17.01) */
-    DS_StrSetChar (&data, 72, (uint8_t) 0x31);
-    DS_StrSetChar (&data, 73, (uint8_t) 0x34);
-    DS_StrSetChar (&data, 74, (uint8_t) 0x30);
-    DS_StrSetChar (&data, 75, (uint8_t) 0x32);
-    DS_StrSetChar (&data, 76, (uint8_t) 0x31);
-    DS_StrSetChar (&data, 77, (uint8_t) 0x37);
-    DS_StrSetChar (&data, 78, (uint8_t) 0x30);
-    DS_StrSetChar (&data, 79, (uint8_t) 0x30);
+    write_joystick_data (data + 8);
 
     /* Add CRC32 checksum */
-    uint32_t checksum = DS_CRC32 (data.buf, DS_StrLen (&data));
-    DS_StrSetChar (&data, 1020, (checksum & 0xff000000) >> 24);
-    DS_StrSetChar (&data, 1021, (checksum & 0xff0000) >> 16);
-    DS_StrSetChar (&data, 1022, (checksum & 0xff00) >> 8);
-    DS_StrSetChar (&data, 1023, (checksum & 0xff));
+    uint32_t checksum = get_packet_checksum (data);
+    data [PACKET_CHECKSUM + 0] = (checksum & 0xff000000) >> 24;
+    data [PACKET_CHECKSUM + 1] = (checksum & 0xff0000) >> 16;
+    data [PACKET_CHECKSUM + 2] = (checksum & 0xff00) >> 8;
+    data [PACKET_CHECKSUM + 3] = (checksum & 0xff);
 
-    /* Increase sent robot packets */
-    ++sent_robot_packets;
+    /* Copy the packet to the send buffer */
+    DS_PacketAppendBytes (packet, data, PACKET_SIZE);
 
-    /* Return address of data */
-    return data;
+    /* Increase sent robot packets */
+    ++ctx->sent_robot_packets;
 }
 
 /**
@@ -343,18 +453,16 @@ static DS_String create_robot_packet (void)
  */
 static int read_fms_packet (const DS_String* data)
 {
-    /* Data pointer is invalid */
-    if (!data)
-        return 0;
-
-    /* Packet is too small */
-    if (DS_StrLen (data) < 5)
+    /* Data pointer is invalid or packet is too small */
+    DS_Reader reader;
+    if (!DS_ReaderInit (&reader, data, 5))
         return 0;
 
     /* Read FMS packet */
-    uint8_t robotmod = (uint8_t) DS_StrCharAt (data, 2);
-    uint8_t alliance = (uint8_t) DS_StrCharAt (data, 3);
-    uint8_t position = (uint8_t) DS_StrCharAt (data, 4);
+    DS_ReaderSkip (&reader, 2);
+    uint8_t robotmod = DS_ReaderU8 (&reader);
+    uint8_t alliance = DS_ReaderU8 (&reader);
+    uint8_t position = DS_ReaderU8 (&reader);
 
     /* Switch to autonomous */
     if (robotmod & cFMSAutonomous)
@@ -390,24 +498,22 @@ static int read_radio_packet (const DS_String* data)
  */
 int read_robot_packet (const DS_String* data)
 {
-    /* Data pointer is invalid */
-    if (!data)
-        return 0;
-
-    /* Packet is too small */
-    if (DS_StrLen (data) < 1024)
+    /* Data pointer is invalid or packet is too small */
+    DS_Reader reader;
+    if (!DS_ReaderInit (&reader, data, PACKET_SIZE))
         return 0;
 
     /* Calculate voltage using the rule of three */
-    uint8_t upper = ((uint8_t) DS_StrCharAt (data, 1) * 12) / 0x12;
-    uint8_t lower = ((uint8_t) DS_StrCharAt (data, 2) * 12) / 0x12;
+    uint8_t estop = DS_ReaderU8 (&reader);
+    uint8_t upper = (DS_ReaderU8 (&reader) * 12) / 0x12;
+    uint8_t lower = (DS_ReaderU8 (&reader) * 12) / 0x12;
 
     /* Construct the voltage float */
     float voltage = ((float) upper) + ((float) lower / 0xff);
     CFG_SetRobotVoltage (voltage);
 
     /* Check if robot is e-stopped */
-    CFG_SetEmergencyStopped ((uint8_t) DS_StrCharAt (data, 0) == cEmergencyStopOn);
+    CFG_SetEmergencyStopped (estop == cEmergencyStopOn);
 
     /* Assume that robot code is present (issue #31 in QDriverStation) */
     CFG_SetRobotCode (1);
@@ -438,9 +544,11 @@ static void reset_radio (void)
  */
 static void reset_robot (void)
 {
-    resync = 1;
-    reboot = 0;
-    restart_code = 0;
+    FRC2014Context* ctx = get_context();
+
+    ctx->resync = 1;
+    ctx->reboot = 0;
+    ctx->restart_code = 0;
 }
 
 /**
@@ -449,7 +557,9 @@ static void reset_robot (void)
  */
 static void reboot_robot (void)
 {
-    reboot = 1;
+    FRC2014Context* ctx = get_context();
+
+    ctx->reboot = 1;
 }
 
 /**
@@ -458,7 +568,9 @@ static void reboot_robot (void)
  */
 void restart_robot_code (void)
 {
-    restart_code = 1;
+    FRC2014Context* ctx = get_context();
+
+    ctx->restart_code = 1;
 }
 
 /**
@@ -476,17 +588,26 @@ DS_Protocol DS_GetProtocolFRC_2014 (void)
     protocol.fms_address = &fms_address;
     protocol.radio_address = &radio_address;
     protocol.robot_address = &robot_address;
+    protocol.robot_fallback_addresses = NULL;
 
     /* Set packet generator functions */
     protocol.create_fms_packet = &create_fms_packet;
     protocol.create_radio_packet = &create_radio_packet;
-    protocol.create_robot_packet = &create_robot_packet;
+    protocol.create_robot_packet = NULL;
+    protocol.write_fms_packet = NULL;
+    protocol.write_radio_packet = NULL;
+    protocol.write_robot_packet = &write_robot_packet;
 
     /* Set packet interpretation functions */
     protocol.read_fms_packet = &read_fms_packet;
     protocol.read_radio_packet = &read_radio_packet;
     protocol.read_robot_packet = &read_robot_packet;
 
+    /* The robot stream is not used */
+    protocol.write_robot_stream = NULL;
+    protocol.read_robot_stream = NULL;
+    protocol.reset_robot_stream = NULL;
+
     /* Set reset functions */
     protocol.reset_fms = &reset_fms;
     protocol.reset_radio = &reset_radio;
@@ -509,25 +630,31 @@ DS_Protocol DS_GetProtocolFRC_2014 (void)
     protocol.max_button_count = max_buttons;
 
     /* Define FMS socket properties */
-    protocol.fms_socket = *DS_SocketEmpty();
+    protocol.fms_socket = DS_SocketEmpty();
     protocol.fms_socket.disabled = 0;
     protocol.fms_socket.in_port = 1120;
     protocol.fms_socket.out_port = 1160;
     protocol.fms_socket.type = DS_SOCKET_UDP;
+    protocol.fms_socket.dscp = DS_DSCP_EF;
 
     /* Define radio socket properties */
-    protocol.radio_socket = *DS_SocketEmpty();
+    protocol.radio_socket = DS_SocketEmpty();
     protocol.radio_socket.disabled = 1;
 
     /* Define robot socket properties */
-    protocol.robot_socket = *DS_SocketEmpty();
+    protocol.robot_socket = DS_SocketEmpty();
     protocol.robot_socket.disabled = 0;
     protocol.robot_socket.in_port = 1150;
     protocol.robot_socket.out_port = 1110;
     protocol.robot_socket.type = DS_SOCKET_UDP;
+    protocol.robot_socket.dscp = DS_DSCP_EF;
+
+    /* Define robot stream socket properties */
+    protocol.robot_stream_socket = DS_SocketEmpty();
+    protocol.robot_stream_socket.disabled = 1;
 
     /* Define netconsole socket properties */
-    protocol.netconsole_socket = *DS_SocketEmpty();
+    protocol.netconsole_socket = DS_SocketEmpty();
     protocol.netconsole_socket.disabled = 1;
 
     /* Return the pointer */
@@ -23,12 +23,15 @@
 
 #include "DS_Utils.h"
 #include "DS_Config.h"
+#include "DS_Reader.h"
+#include "DS_Capture.h"
+#include "DS_Context.h"
 #include "DS_Protocol.h"
 #include "DS_Joysticks.h"
 #include "DS_DefaultProtocols.h"
 
-#include <time.h>
 #include <math.h>
+#include <time.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -69,19 +72,116 @@ static const uint8_t cRTagRAMInfo        = 0x06;
 static const uint8_t cRTagDiskInfo       = 0x04;
 static const uint8_t cRequestTime        = 0x01;
 static const uint8_t cRobotHasCode       = 0x20;
+static const uint8_t cLevelPractice      = 0x01;
+static const uint8_t cLevelQualification = 0x02;
+static const uint8_t cLevelPlayoff       = 0x03;
+static const uint8_t cICMP_EchoRequest   = 0x08;
+static const uint8_t cICMP_EchoReply     = 0x00;
+static const uint16_t cICMP_Identifier   = 0x4453;
+
+/*
+ * Nominal roboRIO memory and storage sizes, the robot only reports the free
+ * space, so these are used to calculate the usage percentages
+ */
+static const double cRoboRIORAMSize      = 256.0 * 1024 * 1024;
+static const double cRoboRIODiskSize     = 512.0 * 1024 * 1024;
+
+/*
+ * Address of the roboRIO when it is connected through USB
+ */
+static const char* cRoboRIOUSBAddress    = "172.22.11.2";
 
 /*
- * Sent robot and FMS packet counters
+ * Packets that are up to REORDER_WINDOW indexes older than the last applied
+ * robot packet are considered to be stale
  */
-static unsigned int send_time_data = 0;
-static unsigned int sent_fms_packets = 0;
-static unsigned int sent_robot_packets = 0;
+#define REORDER_WINDOW 64
 
 /*
- * Control code flags
+ * Protocol state of a DS context (also used by the 2016 and 2020 protocols)
+ */
+typedef struct {
+    /* Sent robot and FMS packet counters */
+    unsigned int send_time_data;
+    unsigned int sent_fms_packets;
+    unsigned int sent_radio_packets;
+    unsigned int sent_robot_packets;
+
+    /* Cached date and timezone tags (without the milliseconds field) */
+    uint8_t timezone_block [80];
+    size_t timezone_block_len;
+    time_t timezone_block_time;
+
+    /* Joystick tag headers (size, tag and axis count) of the cached layout */
+    unsigned int joystick_version;
+    uint8_t joystick_headers [DS_MAX_JOYSTICKS][3];
+
+    /* Encoded joystick tags of the cached snapshot version (at most 31 bytes
+     * per joystick) */
+    unsigned int joystick_data_version;
+    size_t joystick_data_len;
+    uint8_t joystick_data [DS_MAX_JOYSTICKS * 32];
+
+    /* Control code flags */
+    int reboot;
+    int restart_code;
+
+    /* Sequence number of the last ICMP echo request sent to the radio */
+    int has_radio_request;
+    uint16_t radio_sequence;
+
+    /* Index of the last robot packet that was applied */
+    int has_robot_index;
+    uint16_t last_robot_index;
+
+    /* Match bytes of the last FMS packet (level, numbers and time) */
+    int has_fms_match;
+    uint8_t fms_match_bytes [6];
+
+    /* Addresses of the current team number */
+    DS_StrCache radio_address;
+    DS_StrCache robot_address;
+} FRC2015Context;
+
+/**
+ * Returns the protocol state of the current DS context
+ */
+static FRC2015Context* get_context (void)
+{
+    return (FRC2015Context*) DS_ContextData (DS_CONTEXT_FRC_2015,
+                                             sizeof (FRC2015Context),
+                                             NULL, NULL);
+}
+
+/**
+ * Returns \c 1 if the robot packet with the given \a index is newer than
+ * the last applied robot packet. If the packet is a duplicate or arrived
+ * out of order, it is counted and this function returns \c 0.
+ *
+ * Packets that are much older than the last one are accepted, since that
+ * happens when the packet counter is reset.
  */
-static int reboot = 0;
-static int restart_code = 0;
+static int accept_robot_index (const uint16_t index)
+{
+    FRC2015Context* ctx = get_context();
+    int16_t delta = (int16_t) (index - ctx->last_robot_index);
+
+    if (ctx->has_robot_index) {
+        if (delta == 0) {
+            DS_CountDuplicatedRobotPacket();
+            return 0;
+        }
+
+        if (delta < 0 && delta >= -REORDER_WINDOW) {
+            DS_CountReorderedRobotPacket();
+            return 0;
+        }
+    }
+
+    ctx->has_robot_index = 1;
+    ctx->last_robot_index = index;
+    return 1;
+}
 
 /**
  * Obtains the voltage float from the given \a upper and \a lower bytes
@@ -114,12 +214,12 @@ static void encode_voltage (float voltage, uint8_t* upper, uint8_t* lower)
  *    - Robot radio connected?
  *    - The operation state (e-stop, normal)
  */
-static uint8_t fms_control_code (void)
+static uint8_t fms_control_code (const CFG_State* state)
 {
     uint8_t code = 0;
 
     /* Let the FMS know the operational status of the robot */
-    switch (CFG_GetControlMode()) {
+    switch (state->control_mode) {
     case DS_CONTROL_TEST:
         code |= cTest;
         break;
@@ -132,19 +232,19 @@ static uint8_t fms_control_code (void)
     }
 
     /* Let the FMS know if robot is e-stopped */
-    if (CFG_GetEmergencyStopped())
+    if (state->emergency_stopped)
         code |= cEmergencyStop;
 
     /* Let the FMS know if the robot is enabled */
-    if (CFG_GetRobotEnabled())
+    if (state->robot_enabled)
         code |= cEnabled;
 
     /* Let the FMS know if we are connected to radio */
-    if (CFG_GetRadioCommunications())
+    if (state->radio_communications)
         code |= cFMS_RadioPing;
 
     /* Let the FMS know if we are connected to robot */
-    if (CFG_GetRobotCommunications()) {
+    if (state->robot_communications) {
         code |= cFMS_RobotComms;
         code |= cFMS_RobotPing;
     }
@@ -159,12 +259,12 @@ static uint8_t fms_control_code (void)
  *    - The FMS attached keyword
  *    - The operation state (e-stop, normal)
  */
-static uint8_t get_control_code (void)
+static uint8_t get_control_code (const CFG_State* state)
 {
     uint8_t code = 0;
 
     /* Get current control mode (Test, Auto or Teleop) */
-    switch (CFG_GetControlMode()) {
+    switch (state->control_mode) {
     case DS_CONTROL_TEST:
         code |= cTest;
         break;
@@ -179,15 +279,15 @@ static uint8_t get_control_code (void)
     }
 
     /* Let the robot know if we are connected to the FMS */
-    if (CFG_GetFMSCommunications())
+    if (state->fms_communications)
         code |= cFMS_Attached;
 
     /* Let the robot know if it should e-stop right now */
-    if (CFG_GetEmergencyStopped())
+    if (state->emergency_stopped)
         code |= cEmergencyStop;
 
     /* Append the robot enabled state */
-    if (CFG_GetRobotEnabled())
+    if (state->robot_enabled)
         code |= cEnabled;
 
     return code;
@@ -199,15 +299,16 @@ static uint8_t get_control_code (void)
  *    - Reboot the roboRIO
  *    - Restart the robot code process
  */
-static uint8_t get_request_code (void)
+static uint8_t get_request_code (const CFG_State* state)
 {
+    FRC2015Context* ctx = get_context();
     uint8_t code = cRequestNormal;
 
     /* Robot has comms, check if we need to send additional flags */
-    if (CFG_GetRobotCommunications()) {
-        if (reboot)
+    if (state->robot_communications) {
+        if (ctx->reboot)
             code = cRequestReboot;
-        else if (restart_code)
+        else if (ctx->restart_code)
             code = cRequestRestartCode;
     }
 
@@ -223,27 +324,27 @@ static uint8_t get_request_code (void)
  * This value may be used by the robot program to use specialized autonomous
  * modes or adjust sensor input.
  */
-static uint8_t get_station_code (void)
+static uint8_t get_station_code (const CFG_State* state)
 {
     /* Current config is set to position 1 */
-    if (CFG_GetPosition() == DS_POSITION_1) {
-        if (CFG_GetAlliance() == DS_ALLIANCE_RED)
+    if (state->position == DS_POSITION_1) {
+        if (state->alliance == DS_ALLIANCE_RED)
             return cRed1;
         else
             return cBlue1;
     }
 
     /* Current config is set to position 2 */
-    if (CFG_GetPosition() == DS_POSITION_2) {
-        if (CFG_GetAlliance() == DS_ALLIANCE_RED)
+    if (state->position == DS_POSITION_2) {
+        if (state->alliance == DS_ALLIANCE_RED)
             return cRed2;
         else
             return cBlue2;
     }
 
     /* Current config is set to position 3 */
-    if (CFG_GetPosition() == DS_POSITION_3) {
-        if (CFG_GetAlliance() == DS_ALLIANCE_RED)
+    if (state->position == DS_POSITION_3) {
+        if (state->alliance == DS_ALLIANCE_RED)
             return cRed3;
         else
             return cBlue3;
@@ -257,156 +358,277 @@ static uint8_t get_station_code (void)
  * joystick data (which is sent to the robot) and to resize the client->robot
  * datagram automatically.
  */
-static uint8_t get_joystick_size (const int joystick)
+static uint8_t get_joystick_size (const DS_JoystickState* joystick)
 {
     int header_size = 2;
     int button_data = 3;
-    int axis_data = DS_GetJoystickNumAxes (joystick) + 1;
-    int hat_data = (DS_GetJoystickNumHats (joystick) * 2) + 1;
+    int axis_data = joystick->num_axes + 1;
+    int hat_data = (joystick->num_hats * 2) + 1;
 
     return header_size + button_data + axis_data + hat_data;
 }
 
 /**
- * Returns information regarding the current date and time and the timezone
- * of the client computer.
- *
- * The robot may ask for this information in some cases (e.g. when initializing
- * the robot code).
+ * Encodes the date (without the milliseconds) and timezone tags for the
+ * given time in \c timezone_block. This involves calling the date/timezone
+ * functions of the OS, so it is only done when the second changes.
  */
-static DS_String get_timezone_data (void)
+static void update_timezone_block (const time_t now)
 {
-    DS_String data = DS_StrNewLen (14);
+    FRC2015Context* ctx = get_context();
 
-    /* Get current time */
-    time_t rt = 0;
-    uint32_t ms = 0;
     struct tm timeinfo;
 
 #if defined _WIN32
-    localtime_s (&timeinfo, &rt);
-#else
-    localtime_r (&rt, &timeinfo);
-#endif
+    localtime_s (&timeinfo, &now);
 
-#if defined _WIN32
     /* Get timezone information */
     TIME_ZONE_INFORMATION info;
     GetTimeZoneInformation (&info);
 
     /* Convert the wchar to a standard string */
-    size_t len = wcslen (info.StandardName) + 1;
-    char* str = calloc (len, sizeof (char));
-    wcstombs_s (NULL, str, len, info.StandardName, wcslen (info.StandardName));
-
-    /* Convert the obtained cstring to a bstring */
-    DS_String tz = DS_StrNew (str);
-    free (str);
-
-    /* Get milliseconds */
-    GetSystemTime (&info.StandardDate);
-    ms = (uint32_t) info.StandardDate.wMilliseconds;
+    char tz [64] = {0};
+    wcstombs_s (NULL, tz, sizeof (tz), info.StandardName, _TRUNCATE);
 #else
+    localtime_r (&now, &timeinfo);
+
     /* Timezone is stored directly in time_t structure */
-    DS_String tz = DS_StrNew (timeinfo.tm_zone);
+    const char* tz = timeinfo.tm_zone ? timeinfo.tm_zone : "";
 #endif
 
-    /* Encode date/time in datagram */
-    DS_StrSetChar (&data, 0,  (uint8_t) 0x0b);
-    DS_StrSetChar (&data, 1,  (uint8_t) cTagDate);
-    DS_StrSetChar (&data, 2,  (uint8_t) (ms >> 24));
-    DS_StrSetChar (&data, 3,  (uint8_t) (ms >> 16));
-    DS_StrSetChar (&data, 4,  (uint8_t) (ms >> 8));
-    DS_StrSetChar (&data, 5,  (uint8_t) (ms));
-    DS_StrSetChar (&data, 6,  (uint8_t) timeinfo.tm_sec);
-    DS_StrSetChar (&data, 7,  (uint8_t) timeinfo.tm_min);
-    DS_StrSetChar (&data, 8,  (uint8_t) timeinfo.tm_hour);
-    DS_StrSetChar (&data, 9,  (uint8_t) timeinfo.tm_yday);
-    DS_StrSetChar (&data, 10, (uint8_t) timeinfo.tm_mon);
-    DS_StrSetChar (&data, 11, (uint8_t) timeinfo.tm_year);
-
-    /* Add timezone length and tag */
-    DS_StrSetChar (&data, 12, DS_StrLen (&tz));
-    DS_StrSetChar (&data, 13, cTagTimezone);
+    /* Limit the timezone string to the space left in the block */
+    size_t tz_len = DS_Min (strlen (tz), sizeof (ctx->timezone_block) - 10);
+
+    /* Encode date/time tag (the milliseconds are added for each packet) */
+    DS_Packet block;
+    DS_PacketInit (&block, ctx->timezone_block, sizeof (ctx->timezone_block));
+    DS_PacketAppend (&block, (uint8_t) 0x0b);
+    DS_PacketAppend (&block, (uint8_t) cTagDate);
+    DS_PacketAppend (&block, (uint8_t) timeinfo.tm_sec);
+    DS_PacketAppend (&block, (uint8_t) timeinfo.tm_min);
+    DS_PacketAppend (&block, (uint8_t) timeinfo.tm_hour);
+    DS_PacketAppend (&block, (uint8_t) timeinfo.tm_yday);
+    DS_PacketAppend (&block, (uint8_t) timeinfo.tm_mon);
+    DS_PacketAppend (&block, (uint8_t) timeinfo.tm_year);
+
+    /* Add timezone length (tag ID + string) and tag */
+    DS_PacketAppend (&block, (uint8_t) (tz_len + 1));
+    DS_PacketAppend (&block, cTagTimezone);
 
     /* Add timezone string */
-    DS_StrJoin (&data, &tz);
+    DS_PacketAppendBytes (&block, tz, tz_len);
 
-    /* Return the obtained data */
-    return data;
+    /* Update block length and time */
+    ctx->timezone_block_len = block.len;
+    ctx->timezone_block_time = now;
 }
 
 /**
- * Constructs a joystick information structure for every attached joystick.
+ * Writes information regarding the current date and time and the timezone
+ * of the client computer into the given \a packet.
+ *
+ * The robot may ask for this information in some cases (e.g. when initializing
+ * the robot code).
+ */
+static void write_timezone_data (DS_Packet* packet)
+{
+    FRC2015Context* ctx = get_context();
+
+    /* Get current time, split in seconds and milliseconds */
+    time_t now = 0;
+    uint32_t ms = 0;
+
+#if defined _WIN32
+    FILETIME ft;
+    ULARGE_INTEGER ticks;
+    GetSystemTimeAsFileTime (&ft);
+    ticks.LowPart = ft.dwLowDateTime;
+    ticks.HighPart = ft.dwHighDateTime;
+
+    /* FILETIME is in 100 ns units since 1601 */
+    now = (time_t) ((ticks.QuadPart - 116444736000000000ULL) / 10000000);
+    ms = (uint32_t) ((ticks.QuadPart / 10000) % 1000);
+#else
+    struct timespec ts;
+    clock_gettime (CLOCK_REALTIME, &ts);
+    now = ts.tv_sec;
+    ms = (uint32_t) (ts.tv_nsec / 1000000);
+#endif
+
+    /* Re-encode the date and timezone tags once per second */
+    if (ctx->timezone_block_len == 0 || now != ctx->timezone_block_time)
+        update_timezone_block (now);
+
+    /* Copy the date tag header, the milliseconds and the rest of the block */
+    DS_PacketAppendBytes (packet, ctx->timezone_block, 2);
+    DS_PacketAppend (packet, (uint8_t) (ms >> 24));
+    DS_PacketAppend (packet, (uint8_t) (ms >> 16));
+    DS_PacketAppend (packet, (uint8_t) (ms >> 8));
+    DS_PacketAppend (packet, (uint8_t) (ms));
+    DS_PacketAppendBytes (packet, ctx->timezone_block + 2,
+                          ctx->timezone_block_len - 2);
+}
+
+/**
+ * Writes a joystick information structure for every attached joystick.
  * Unlike the 2014 protocol, the 2015 protocol only generates joystick data
  * for the attached joysticks.
+ *
+ * The robot expects the counts of each joystick in every packet, but the
+ * tag headers (size, tag and axis count) are only encoded again when the
+ * layout version of the joysticks changes. If the snapshot did not change
+ * since the last packet (e.g. the driver holds still or the robot is
+ * disabled), the encoded tags of the last packet are copied instead.
  */
-static DS_String get_joystick_data (void)
+static void write_joystick_data (DS_Packet* packet)
 {
     /* Initialize the variables */
     int i = 0;
     int j = 0;
-    DS_String data = DS_StrNewLen (0);
+    DS_Packet section;
+    uint8_t axes [DS_MAX_JOYSTICK_AXES];
+    FRC2015Context* ctx = get_context();
+
+    /* Take a snapshot of all joysticks once per packet */
+    DS_JoystickSnapshot snapshot;
+    DS_GetJoystickSnapshot (&snapshot);
+
+    /* Re-use the joystick tags of the last packet */
+    if (snapshot.version == ctx->joystick_data_version) {
+        DS_PacketAppendBytes (packet, ctx->joystick_data,
+                              ctx->joystick_data_len);
+        return;
+    }
 
-    /* Generate data for each joystick */
-    for (i = 0; i < DS_GetJoystickCount(); ++i) {
-        DS_StrAppend (&data, get_joystick_size (i));
-        DS_StrAppend (&data, cTagJoystick);
+    /* Update the tag headers if a joystick was added, replaced or removed */
+    if (snapshot.layout_version != ctx->joystick_version) {
+        for (i = 0; i < snapshot.count; ++i) {
+            const DS_JoystickState* joystick = &snapshot.joysticks [i];
 
-        /* Add axis data */
-        DS_StrAppend (&data, DS_GetJoystickNumAxes (i));
-        for (j = 0; j < DS_GetJoystickNumAxes (i); ++j)
-            DS_StrAppend (&data, DS_FloatToByte (DS_GetJoystickAxis (i, j), 1));
+            ctx->joystick_headers [i][0] = get_joystick_size (joystick);
+            ctx->joystick_headers [i][1] = cTagJoystick;
+            ctx->joystick_headers [i][2] = joystick->num_axes;
+        }
+
+        ctx->joystick_version = snapshot.layout_version;
+    }
+
+    /* Generate data for each joystick in the cache */
+    DS_PacketInit (&section, ctx->joystick_data, sizeof (ctx->joystick_data));
+    for (i = 0; i < snapshot.count; ++i) {
+        const DS_JoystickState* joystick = &snapshot.joysticks [i];
+
+        /* Add joystick header and axis count */
+        DS_PacketAppendBytes (&section, ctx->joystick_headers [i], 3);
 
-        /* Generate button data */
-        uint16_t button_flags = 0;
-        for (j = 0; j < DS_GetJoystickNumButtons (i); ++j)
-            button_flags += DS_GetJoystickButton (i, j) ? (int) pow (2, j) : 0;
+        /* Convert all axes in one pass */
+        DS_FloatsToBytes (joystick->axes, axes, joystick->num_axes, 1);
 
-        /* Add button data */
-        DS_StrAppend (&data, DS_GetJoystickNumButtons (i));
-        DS_StrAppend (&data, (uint8_t) (button_flags >> 8));
-        DS_StrAppend (&data, (uint8_t) (button_flags));
+        /* Add axis data */
+        DS_PacketAppendBytes (&section, axes, joystick->num_axes);
+
+        /* Add button data (already packed as bit flags) */
+        DS_PacketAppend (&section, joystick->num_buttons);
+        DS_PacketAppendU16 (&section, (uint16_t) joystick->buttons);
 
         /* Add hat data */
-        DS_StrAppend (&data, DS_GetJoystickNumHats (i));
-        for (j = 0; j < DS_GetJoystickNumHats (i); ++j) {
-            DS_StrAppend (&data, (uint8_t) (DS_GetJoystickHat (i, j) >> 8));
-            DS_StrAppend (&data, (uint8_t) (DS_GetJoystickHat (i, j)));
-        }
+        DS_PacketAppend (&section, joystick->num_hats);
+        for (j = 0; j < joystick->num_hats; ++j)
+            DS_PacketAppendU16 (&section, (uint16_t) joystick->hats [j]);
     }
 
-    /* Return obtained data */
-    return data;
+    /* Copy the tags to the packet */
+    ctx->joystick_data_len = section.len;
+    ctx->joystick_data_version = section.overflow ? 0 : snapshot.version;
+    DS_PacketAppendBytes (packet, ctx->joystick_data, section.len);
 }
 
 /**
- * Obtains the CPU, RAM, Disk and CAN information from the robot packet
+ * Converts the given \a free_space to a usage percentage of \a total
  */
-static void read_extended (const DS_String* data, const int offset)
+static int usage_percent (const uint32_t free_space, const double total)
 {
-    /* Check if data pointer is valid */
-    if (!data)
-        return;
+    return (int) (100 - (free_space / total) * 100);
+}
+
+/**
+ * Converts the given \a value (received from the network) to an integer
+ * between \a min and \a max. Casting NaN, infinity or values out of the
+ * range of an int is undefined, so these are never cast (NaN and infinity
+ * are converted to \a min).
+ */
+static int float_to_int (const float value, const int min, const int max)
+{
+    if (!isfinite (value) || value <= (float) min)
+        return min;
 
-    /* Get header tag */
-    uint8_t tag = (uint8_t) DS_StrCharAt (data, offset + 1);
+    if (value >= (float) max)
+        return max;
+
+    return (int) value;
+}
+
+/**
+ * Interprets a single extended tag with the given \a payload.
+ *
+ * The payload layouts are:
+ *    - CAN:  utilization (float), bus off, TX full (u32), RX/TX errors (u8)
+ *    - CPU:  CPU count (float), then four load percentages per CPU (floats)
+ *    - RAM:  block size (u32), free space (u32)
+ *    - Disk: block size (u32), free space (u32)
+ */
+static void read_tag (const uint8_t tag, DS_Reader* payload)
+{
+    int i;
+    int len = (int) DS_ReaderRemaining (payload);
 
     /* Get CAN information */
-    if (tag == cRTagCANInfo)
-        CFG_SetCANUtilization ((uint8_t) DS_StrCharAt (data, 10));
+    if (tag == cRTagCANInfo && len >= 4)
+        CFG_SetCANUtilization (float_to_int (DS_ReaderFloat (payload) + 0.5f,
+                                             0, 100));
+
+    /* Get CPU usage (average of the total load of each CPU) */
+    else if (tag == cRTagCPUInfo && len >= 4) {
+        float usage = 0;
+        int cpus = float_to_int (DS_ReaderFloat (payload), 0, (len - 4) / 16);
+
+        for (i = 0; i < cpus * 4; ++i)
+            usage += DS_ReaderFloat (payload);
 
-    /* Get CPU usage */
-    else if (tag == cRTagCPUInfo)
-        CFG_SetRobotCPUUsage ((uint8_t) DS_StrCharAt (data, 3));
+        if (cpus > 0)
+            CFG_SetRobotCPUUsage (float_to_int (usage / cpus + 0.5f, 0, 100));
+    }
 
-    /* Get RAM usage */
-    else if (tag == cRTagRAMInfo)
-        CFG_SetRobotRAMUsage ((uint8_t) DS_StrCharAt (data, 4));
+    /* Get RAM usage (skip the block size) */
+    else if (tag == cRTagRAMInfo && len >= 8) {
+        DS_ReaderSkip (payload, 4);
+        CFG_SetRobotRAMUsage (usage_percent (DS_ReaderU32 (payload),
+                                             cRoboRIORAMSize));
+    }
 
-    /* Get disk usage */
-    else if (tag == cRTagDiskInfo)
-        CFG_SetRobotDiskUsage ((uint8_t)  DS_StrCharAt (data, 4));
+    /* Get disk usage (skip the block size) */
+    else if (tag == cRTagDiskInfo && len >= 8) {
+        DS_ReaderSkip (payload, 4);
+        CFG_SetRobotDiskUsage (usage_percent (DS_ReaderU32 (payload),
+                                              cRoboRIODiskSize));
+    }
+}
+
+/**
+ * Obtains the CPU, RAM, Disk and CAN information from the robot packet.
+ *
+ * The extended data (the rest of the given \a reader) is a sequence of
+ * tags, each tag begins with its size (which includes the tag ID, but not
+ * the size byte itself), followed by its ID and its payload. Every tag is
+ * read in a single pass, the reading stops at the first truncated tag.
+ */
+static void read_extended (DS_Reader* reader)
+{
+    uint8_t tag;
+    DS_Reader payload;
+
+    while (DS_ReaderTag (reader, &tag, &payload))
+        read_tag (tag, &payload);
 }
 
 /**
@@ -455,7 +677,9 @@ static DS_String fms_address (void)
  */
 static DS_String radio_address (void)
 {
-    return DS_GetStaticIP (10, CFG_GetTeamNumber(), 1);
+    const int team = CFG_GetTeamNumber();
+    return DS_StrCacheFormat (&get_context()->radio_address, team,
+                              "10.%d.%d.1", team / 100, team % 100);
 }
 
 /**
@@ -463,7 +687,29 @@ static DS_String radio_address (void)
  */
 static DS_String robot_address (void)
 {
-    return DS_StrFormat ("roboRIO-%d.local", CFG_GetTeamNumber());
+    const int team = CFG_GetTeamNumber();
+    return DS_StrCacheFormat (&get_context()->robot_address, team,
+                              "roboRIO-%d.local", team);
+}
+
+/**
+ * The roboRIO can also be found at the static 10.te.am.2 IP and at
+ * 172.22.11.2 (when connected through USB). These addresses are resolved
+ * along with the mDNS address, so that the robot can be reached even if
+ * mDNS is slow or unavailable.
+ *
+ * \returns the number of addresses written to \a addresses
+ */
+static int robot_fallback_addresses (DS_String* addresses, const int max)
+{
+    int count = 0;
+
+    if (count < max)
+        addresses [count++] = DS_GetStaticIP (10, CFG_GetTeamNumber(), 2);
+    if (count < max)
+        addresses [count++] = DS_StrNew (cRoboRIOUSBAddress);
+
+    return count;
 }
 
 /**
@@ -475,46 +721,113 @@ static DS_String robot_address (void)
  *    - Radio and robot ping flags
  *    - The team number
  */
-static DS_String create_fms_packet (void)
+static void write_fms_packet (DS_Packet* packet)
 {
-    /* Create an 8-byte long packet */
-    DS_String data = DS_StrNewLen (8);
+    FRC2015Context* ctx = get_context();
+
+    /* Take a snapshot of the DS state */
+    CFG_State state;
+    CFG_GetState (&state);
 
     /* Get voltage bytes */
     uint8_t integer = 0;
     uint8_t decimal = 0;
-    encode_voltage (CFG_GetRobotVoltage(), &integer, &decimal);
+    encode_voltage (state.robot_voltage, &integer, &decimal);
 
     /* Add FMS packet count */
-    DS_StrSetChar (&data, 0, (sent_fms_packets >> 8));
-    DS_StrSetChar (&data, 1, (sent_fms_packets));
+    DS_PacketAppendU16 (packet, (uint16_t) ctx->sent_fms_packets);
 
     /* Add DS version and FMS control code */
-    DS_StrSetChar (&data, 2, cFMS_DS_Version);
-    DS_StrSetChar (&data, 3, fms_control_code());
+    DS_PacketAppend (packet, cFMS_DS_Version);
+    DS_PacketAppend (packet, fms_control_code (&state));
 
     /* Add team number */
-    DS_StrSetChar (&data, 4, (CFG_GetTeamNumber() >> 8));
-    DS_StrSetChar (&data, 5, (CFG_GetTeamNumber()));
+    DS_PacketAppendU16 (packet, (uint16_t) state.team);
 
     /* Add robot voltage */
-    DS_StrSetChar (&data, 6, integer);
-    DS_StrSetChar (&data, 7, decimal);
+    DS_PacketAppend (packet, integer);
+    DS_PacketAppend (packet, decimal);
 
     /* Increase FMS packet counter */
-    ++sent_fms_packets;
+    ++ctx->sent_fms_packets;
+}
+
+/**
+ * Returns \c 1 if the radio socket has a resolved address that can be probed.
+ * The fall-back address is never probed, since the system answers the echo
+ * requests sent to it (and the radio would be reported as connected).
+ */
+static int radio_target_valid (void)
+{
+    DS_Protocol* protocol = DS_CurrentProtocol();
+    if (!protocol)
+        return 0;
+
+    /* Address is not set */
+    DS_Socket* socket = &protocol->radio_socket;
+    if (!strlen (socket->address) ||
+        strcmp (socket->address, DS_FallBackAddress) == 0)
+        return 0;
+
+    /* Address is not resolved, or resolves to the unspecified address */
+    DS_String address = DS_SocketRemoteHost (socket);
+    char* host = DS_StrToChar (&address);
+    int valid = host && strlen (host) &&
+                strcmp (host, DS_FallBackAddress) != 0 &&
+                strcmp (host, "::") != 0;
 
-    return data;
+    DS_FREE (host);
+    DS_StrRmBuf (&address);
+    return valid;
 }
 
 /**
  * The 2015 communication protocol does not involve sending specialized packets
- * to the DS Radio / Bridge. For that reason, the 2015 communication protocol
- * generates empty radio packets.
+ * to the DS Radio / Bridge, so the radio packets are ICMP echo requests. The
+ * replies tell if the radio is reachable (and its round-trip time), even
+ * while the robot is not.
+ *
+ * Nothing is sent (and the replies are ignored) while the radio address is
+ * not set or not resolved.
+ *
+ * The identifier is replaced by the system when an ICMP datagram socket is
+ * used, the checksum is calculated anyway (raw sockets need it).
  */
-static DS_String create_radio_packet (void)
+static void write_radio_packet (DS_Packet* packet)
 {
-    return  DS_StrNewLen (0);
+    FRC2015Context* ctx = get_context();
+
+    /* There is no radio to probe */
+    if (!radio_target_valid()) {
+        ctx->has_radio_request = 0;
+        return;
+    }
+
+    /* Remember the request, only its reply is accepted */
+    ctx->has_radio_request = 1;
+    ctx->radio_sequence = (uint16_t) ctx->sent_radio_packets;
+
+    /* Add type, code, checksum, identifier and sequence number */
+    DS_PacketAppend (packet, cICMP_EchoRequest);
+    DS_PacketAppend (packet, 0);
+    DS_PacketAppendU16 (packet, 0);
+    DS_PacketAppendU16 (packet, cICMP_Identifier);
+    DS_PacketAppendU16 (packet, ctx->radio_sequence);
+
+    /* Calculate the checksum */
+    size_t i;
+    uint32_t sum = 0;
+    for (i = 0; i + 1 < packet->len; i += 2)
+        sum += (uint32_t) (packet->buf [i] << 8 | packet->buf [i + 1]);
+    while (sum >> 16)
+        sum = (sum & 0xFFFF) + (sum >> 16);
+
+    if (!packet->overflow) {
+        packet->buf [2] = (uint8_t) (~sum >> 8);
+        packet->buf [3] = (uint8_t) ~sum;
+    }
+
+    ++ctx->sent_radio_packets;
 }
 
 /**
@@ -527,38 +840,95 @@ static DS_String create_radio_packet (void)
  *    - Date and time data (if robot requests it)
  *    - Joystick information (if the robot does not want date/time)
  */
-static DS_String create_robot_packet (void)
+static void write_robot_packet (DS_Packet* packet)
 {
-    DS_String data = DS_StrNewLen (6);
+    FRC2015Context* ctx = get_context();
+
+    /* Take a snapshot of the DS state */
+    CFG_State state;
+    CFG_GetState (&state);
 
     /* Add packet index */
-    DS_StrSetChar (&data, 0, (sent_robot_packets >> 8));
-    DS_StrSetChar (&data, 1, (sent_robot_packets));
+    DS_PacketAppendU16 (packet, (uint16_t) ctx->sent_robot_packets);
 
     /* Add packet header */
-    DS_StrSetChar (&data, 2, cTagGeneral);
+    DS_PacketAppend (packet, cTagGeneral);
 
     /* Add control code, request flags and team station */
-    DS_StrSetChar (&data, 3, get_control_code());
-    DS_StrSetChar (&data, 4, get_request_code());
-    DS_StrSetChar (&data, 5, get_station_code());
-
-    /* Add timezone data (if robot wants it) */
-    if (send_time_data) {
-        DS_String tz = get_timezone_data();
-        DS_StrJoin (&data, &tz);
-    }
+    DS_PacketAppend (packet, get_control_code (&state));
+    DS_PacketAppend (packet, get_request_code (&state));
+    DS_PacketAppend (packet, get_station_code (&state));
+
+    /* Add timezone data (if robot wants it and the network is not congested) */
+    if (ctx->send_time_data && !DS_SendRateBackoff())
+        write_timezone_data (packet);
 
     /* Add joystick data */
-    else if (sent_robot_packets > 5) {
-        DS_String js = get_joystick_data();
-        DS_StrJoin (&data, &js);
-    }
+    else if (ctx->sent_robot_packets > 5)
+        write_joystick_data (packet);
 
     /* Increase robot packet counter */
-    ++sent_robot_packets;
+    ++ctx->sent_robot_packets;
+}
 
-    return data;
+/**
+ * Returns the match type that corresponds to the given tournament \a level
+ */
+static DS_MatchType get_match_type (const uint8_t level)
+{
+    if (level == cLevelPractice)
+        return DS_MATCH_PRACTICE;
+    else if (level == cLevelQualification)
+        return DS_MATCH_QUALIFICATION;
+    else if (level == cLevelPlayoff)
+        return DS_MATCH_ELIMINATION;
+
+    return DS_MATCH_NONE;
+}
+
+/**
+ * Decodes the match information of the FMS packet read by the given
+ * \a reader (positioned after the station byte). Once the FMS is connected,
+ * the match state is only updated when its bytes differ from the ones of
+ * the previous packet (the date bytes are ignored, they change with every
+ * packet).
+ */
+static void read_fms_match (DS_Reader* reader)
+{
+    FRC2015Context* ctx = get_context();
+
+    /* Tournament level, match number and play number */
+    const uint8_t* numbers = DS_ReaderBytes (reader, 4);
+
+    /* Date (microseconds, seconds, minutes, hours, day, month and year) */
+    DS_ReaderSkip (reader, 10);
+
+    /* Remaining time of the current period */
+    const uint8_t* remaining = DS_ReaderBytes (reader, 2);
+
+    if (!numbers || !remaining)
+        return;
+
+    /* Same match state as the previous packet */
+    uint8_t bytes [sizeof (ctx->fms_match_bytes)];
+    memcpy (bytes, numbers, 4);
+    memcpy (bytes + 4, remaining, 2);
+    if (!CFG_GetFMSCommunications())
+        ctx->has_fms_match = 0;
+    else if (ctx->has_fms_match && !memcmp (bytes, ctx->fms_match_bytes,
+                                            sizeof (bytes)))
+        return;
+
+    ctx->has_fms_match = 1;
+    memcpy (ctx->fms_match_bytes, bytes, sizeof (bytes));
+
+    /* Decode and publish the match state */
+    DS_FMSMatch match;
+    match.match_type = get_match_type (bytes [0]);
+    match.match_number = (bytes [1] << 8) | bytes [2];
+    match.replay_number = bytes [3];
+    match.time_remaining = (bytes [4] << 8) | bytes [5];
+    CFG_SetFMSMatch (&match);
 }
 
 /**
@@ -568,51 +938,90 @@ static DS_String create_robot_packet (void)
  *   - Change robot enabled status
  *   - Change team alliance
  *   - Change team position
+ *
+ * The match information (tournament level, match and play numbers and the
+ * remaining time) is published as the FMS match state. The event name is
+ * not part of the UDP packet.
  */
 static int read_fms_packet (const DS_String* data)
 {
-    /* Data pointer is invalid */
-    if (!data)
-        return 0;
-
-    /* Packet is too small */
-    if (DS_StrLen (data) < 22)
+    /* Data pointer is invalid or packet is too small */
+    DS_Reader reader;
+    if (!DS_ReaderInit (&reader, data, 22))
         return 0;
 
     /* Read FMS packet */
-    uint8_t control = (uint8_t) DS_StrCharAt (data, 3);
-    uint8_t station = (uint8_t) DS_StrCharAt (data, 5);
+    DS_ReaderSkip (&reader, 3);
+    uint8_t control = DS_ReaderU8 (&reader);
+    DS_ReaderSkip (&reader, 1);
+    uint8_t station = DS_ReaderU8 (&reader);
+    read_fms_match (&reader);
 
     /* Change robot enabled state based on what FMS tells us to do*/
     CFG_SetRobotEnabled (control & cEnabled);
 
-    /* Get FMS robot mode */
-    if (control & cTeleoperated)
-        CFG_SetControlMode (DS_CONTROL_TELEOPERATED);
-    else if (control & cAutonomous)
+    /* Get FMS robot mode (the teleoperated mode has no flag) */
+    if (control & cAutonomous)
         CFG_SetControlMode (DS_CONTROL_AUTONOMOUS);
     else if (control & cTest)
         CFG_SetControlMode (DS_CONTROL_TEST);
+    else
+        CFG_SetControlMode (DS_CONTROL_TELEOPERATED);
 
     /* Update to correct alliance and position */
     CFG_SetAlliance (get_alliance (station));
     CFG_SetPosition (get_position (station));
 
-    /* After this, we have more information about the current match,
-     * but we do not really use it, so... */
-
     /* Packet read successfully */
     return 1;
 }
 
 /**
- * Since the DS does not interact directly with the radio/bridge, any incoming
- * packets shall be ignored.
+ * Checks if the given datagram is the reply to the last ICMP echo request
+ * (see \c write_radio_packet()), the IP header is skipped if it is present.
+ * Other ICMP messages (and the replies to older requests) are ignored.
+ *
+ * Raw sockets receive every ICMP message of the host, so the identifier of
+ * the reply must match. ICMP datagram sockets only receive the replies to
+ * their own requests (the system replaces the identifier). The requests are
+ * not sent while a capture is replayed, so any replayed reply is valid.
  */
 static int read_radio_packet (const DS_String* data)
 {
-    (void) data;
-    return 0;
+    FRC2015Context* ctx = get_context();
+    int replaying = Replay_Running();
+
+    /* No request was sent to the radio */
+    if (!replaying && !ctx->has_radio_request)
+        return 0;
+
+    DS_Reader reader;
+    if (!DS_ReaderInit (&reader, data, 8))
+        return 0;
+
+    /* Skip the IP header (raw sockets), its first byte has the version 4 */
+    int raw = 0;
+    uint8_t type = DS_ReaderU8 (&reader);
+    if ((type >> 4) == 4) {
+        raw = 1;
+        DS_ReaderSkip (&reader, (size_t) (type & 0x0F) * 4 - 1);
+        type = DS_ReaderU8 (&reader);
+    }
+
+    /* Skip the code and checksum, read identifier and sequence number */
+    DS_ReaderSkip (&reader, 3);
+    uint16_t identifier = DS_ReaderU16 (&reader);
+    uint16_t sequence = DS_ReaderU16 (&reader);
+
+    /* Only the reply to the last echo request is valid */
+    if (reader.error || type != cICMP_EchoReply)
+        return 0;
+    if (replaying)
+        return 1;
+    if (raw && identifier != cICMP_Identifier)
+        return 0;
+
+    return sequence == ctx->radio_sequence;
 }
 
 /**
@@ -625,34 +1034,38 @@ static int read_radio_packet (const DS_String* data)
  */
 static int read_robot_packet (const DS_String* data)
 {
-    /* Data pointer is invalid */
-    if (!data)
-        return 0;
+    FRC2015Context* ctx = get_context();
 
-    /* Packet is too small */
-    if (DS_StrLen (data) < 7)
+    /* Data pointer is invalid or packet is too small */
+    DS_Reader reader;
+    if (!DS_ReaderInit (&reader, data, 7))
         return 0;
 
-    /* Read robot packet */
-    uint8_t control = (uint8_t) DS_StrCharAt (data, 3);
-    uint8_t rstatus = (uint8_t) DS_StrCharAt (data, 4);
-    uint8_t request = (uint8_t) DS_StrCharAt (data, 7);
+    /* Packet is stale or duplicated, the link is alive but ignore it */
+    uint16_t index = DS_ReaderU16 (&reader);
+    if (!accept_robot_index (index))
+        return 1;
+
+    /* Read robot packet (the request byte is optional) */
+    DS_ReaderSkip (&reader, 1);
+    uint8_t control = DS_ReaderU8 (&reader);
+    uint8_t rstatus = DS_ReaderU8 (&reader);
+    uint8_t upper = DS_ReaderU8 (&reader);
+    uint8_t lower = DS_ReaderU8 (&reader);
+    uint8_t request = DS_ReaderU8 (&reader);
 
     /* Update client information */
     CFG_SetRobotCode (rstatus & cRobotHasCode);
     CFG_SetEmergencyStopped (control & cEmergencyStop);
 
     /* Update date/time request flag */
-    send_time_data = (request == cRequestTime);
+    ctx->send_time_data = (request == cRequestTime);
 
     /* Calculate the voltage */
-    uint8_t upper = (uint8_t) DS_StrCharAt (data, 5);
-    uint8_t lower = (uint8_t) DS_StrCharAt (data, 6);
     CFG_SetRobotVoltage (decode_voltage (upper, lower));
 
     /* This is an extended packet, read its extra data */
-    if (DS_StrLen (data) > 9)
-        read_extended (data, 8);
+    read_extended (&reader);
 
     /* Packet read, feed the watchdog some meat */
     return 1;
@@ -679,9 +1092,12 @@ static void reset_radio (void)
  */
 static void reset_robot (void)
 {
-    reboot = 0;
-    restart_code = 0;
-    send_time_data = 0;
+    FRC2015Context* ctx = get_context();
+
+    ctx->reboot = 0;
+    ctx->restart_code = 0;
+    ctx->send_time_data = 0;
+    ctx->has_robot_index = 0;
 }
 
 /**
@@ -689,7 +1105,9 @@ static void reset_robot (void)
  */
 static void reboot_robot (void)
 {
-    reboot = 1;
+    FRC2015Context* ctx = get_context();
+
+    ctx->reboot = 1;
 }
 
 /**
@@ -698,7 +1116,9 @@ static void reboot_robot (void)
  */
 static void restart_robot_code (void)
 {
-    restart_code = 1;
+    FRC2015Context* ctx = get_context();
+
+    ctx->restart_code = 1;
 }
 
 /**
@@ -716,17 +1136,26 @@ DS_Protocol DS_GetProtocolFRC_2015 (void)
     protocol.fms_address = &fms_address;
     protocol.radio_address = &radio_address;
     protocol.robot_address = &robot_address;
+    protocol.robot_fallback_addresses = &robot_fallback_addresses;
 
     /* Set packet generator functions */
-    protocol.create_fms_packet = &create_fms_packet;
-    protocol.create_radio_packet = &create_radio_packet;
-    protocol.create_robot_packet = &create_robot_packet;
+    protocol.create_fms_packet = NULL;
+    protocol.create_radio_packet = NULL;
+    protocol.create_robot_packet = NULL;
+    protocol.write_fms_packet = &write_fms_packet;
+    protocol.write_radio_packet = &write_radio_packet;
+    protocol.write_robot_packet = &write_robot_packet;
 
     /* Set packet interpretation functions */
     protocol.read_fms_packet = &read_fms_packet;
     protocol.read_radio_packet = &read_radio_packet;
     protocol.read_robot_packet = &read_robot_packet;
 
+    /* The robot stream is not used */
+    protocol.write_robot_stream = NULL;
+    protocol.read_robot_stream = NULL;
+    protocol.reset_robot_stream = NULL;
+
     /* Set reset functions */
     protocol.reset_fms = &reset_fms;
     protocol.reset_radio = &reset_radio;
@@ -739,7 +1168,7 @@ DS_Protocol DS_GetProtocolFRC_2015 (void)
 
     /* Set packet intervals */
     protocol.fms_interval = 500;
-    protocol.radio_interval = 0;
+    protocol.radio_interval = 1000;
     protocol.robot_interval = 20;
 
     /* Set joystick properties */
@@ -749,31 +1178,90 @@ DS_Protocol DS_GetProtocolFRC_2015 (void)
     protocol.max_button_count = 10;
 
     /* Define FMS socket properties */
-    protocol.fms_socket = *DS_SocketEmpty();
+    protocol.fms_socket = DS_SocketEmpty();
     protocol.fms_socket.disabled = 0;
     protocol.fms_socket.in_port = 1120;
     protocol.fms_socket.out_port = 1160;
     protocol.fms_socket.type = DS_SOCKET_UDP;
+    protocol.fms_socket.dscp = DS_DSCP_EF;
 
-    /* Define radio socket properties */
-    protocol.radio_socket = *DS_SocketEmpty();
-    protocol.radio_socket.disabled = 1;
+    /* Define radio socket properties (health probes) */
+    protocol.radio_socket = DS_SocketEmpty();
+    protocol.radio_socket.disabled = 0;
+    protocol.radio_socket.type = DS_SOCKET_ICMP;
 
     /* Define robot socket properties */
-    protocol.robot_socket = *DS_SocketEmpty();
+    protocol.robot_socket = DS_SocketEmpty();
     protocol.robot_socket.disabled = 0;
     protocol.robot_socket.in_port = 1150;
     protocol.robot_socket.out_port = 1110;
     protocol.robot_socket.type = DS_SOCKET_UDP;
+    protocol.robot_socket.discovery = 1;
+    protocol.robot_socket.dscp = DS_DSCP_EF;
+
+    /* Define robot stream socket properties */
+    protocol.robot_stream_socket = DS_SocketEmpty();
+    protocol.robot_stream_socket.disabled = 1;
 
     /* Define netconsole socket properties */
-    protocol.netconsole_socket = *DS_SocketEmpty();
+    protocol.netconsole_socket = DS_SocketEmpty();
     protocol.netconsole_socket.disabled = 0;
     protocol.netconsole_socket.broadcast = 1;
     protocol.netconsole_socket.in_port = 6666;
     protocol.netconsole_socket.out_port = 6668;
     protocol.netconsole_socket.type = DS_SOCKET_UDP;
+    protocol.netconsole_socket.recv_buffer = 256 * 1024;
 
     /* Return the protocol */
     return protocol;
 }
+
+#if defined DS_STATIC_FRC_2015
+
+/**
+ * Returns \c 1 if the given \a protocol uses the packet functions of the
+ * FRC 2015 protocol (e.g. if it is the FRC 2015, 2016 or 2020 protocol)
+ */
+int DS_FRC2015_Matches (const DS_Protocol* protocol)
+{
+    return protocol->write_fms_packet == &write_fms_packet &&
+           protocol->write_robot_packet == &write_robot_packet &&
+           protocol->read_fms_packet == &read_fms_packet &&
+           protocol->read_robot_packet == &read_robot_packet &&
+           protocol->create_fms_packet == NULL &&
+           protocol->create_robot_packet == NULL;
+}
+
+/**
+ * Generates a FMS packet in the given \a packet buffer
+ */
+void DS_FRC2015_WriteFMSPacket (DS_Packet* packet)
+{
+    write_fms_packet (packet);
+}
+
+/**
+ * Generates a robot packet in the given \a packet buffer
+ */
+void DS_FRC2015_WriteRobotPacket (DS_Packet* packet)
+{
+    write_robot_packet (packet);
+}
+
+/**
+ * Interprets the given FMS packet \a data
+ */
+int DS_FRC2015_ReadFMSPacket (const DS_String* data)
+{
+    return read_fms_packet (data);
+}
+
+/**
+ * Interprets the given robot packet \a data
+ */
+int DS_FRC2015_ReadRobotPacket (const DS_String* data)
+{
+    return read_robot_packet (data);
+}
+
+#endif
@@ -23,12 +23,31 @@
 
 #include "DS_Utils.h"
 #include "DS_Config.h"
+#include "DS_Context.h"
 #include "DS_Protocol.h"
 #include "DS_DefaultProtocols.h"
 
 #include <stdio.h>
 #include <string.h>
 
+/*
+ * Protocol state of a DS context (the rest of the state is kept by the FRC
+ * 2015 protocol)
+ */
+typedef struct {
+    DS_StrCache robot_address;
+} FRC2016Context;
+
+/**
+ * Returns the protocol state of the current DS context
+ */
+static FRC2016Context* get_context (void)
+{
+    return (FRC2016Context*) DS_ContextData (DS_CONTEXT_FRC_2016,
+                                             sizeof (FRC2016Context),
+                                             NULL, NULL);
+}
+
 /**
  * The 2016 FRC control system is very similar to the FRC 2015 control system,
  * the only (DS/Comms) difference is that the robot address is found at
@@ -36,7 +55,9 @@
  */
 static DS_String robot_address (void)
 {
-    return DS_StrFormat ("roboRIO-%d-FRC.local", CFG_GetTeamNumber());
+    const int team = CFG_GetTeamNumber();
+    return DS_StrCacheFormat (&get_context()->robot_address, team,
+                              "roboRIO-%d-FRC.local", team);
 }
 
 /**
@@ -0,0 +1,413 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Utils.h"
+#include "DS_Config.h"
+#include "DS_Reader.h"
+#include "DS_Context.h"
+#include "DS_Messages.h"
+#include "DS_Protocol.h"
+#include "DS_Joysticks.h"
+#include "DS_DefaultProtocols.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Tags of the messages sent to the robot through the TCP stream
+ */
+static const uint8_t cTagJoystickDescriptor = 0x02;
+static const uint8_t cTagMatchInfo          = 0x07;
+static const uint8_t cTagGameData           = 0x0e;
+
+/*
+ * Tags of the messages sent by the robot through the TCP stream
+ */
+static const uint8_t cRTagErrorMessage      = 0x0b;
+static const uint8_t cRTagStandardOutput    = 0x0c;
+
+/*
+ * Joystick descriptor values (HID device types and axis types)
+ */
+static const uint8_t cHIDUnknown            = 0xff;
+static const uint8_t cHIDJoystick           = 20;
+static const uint8_t cAxisThrottle          = 4;
+
+/*
+ * Match type codes
+ */
+static const uint8_t cMatchNone             = 0x00;
+static const uint8_t cMatchPractice         = 0x01;
+static const uint8_t cMatchQualification    = 0x02;
+static const uint8_t cMatchElimination      = 0x03;
+
+/*
+ * Flag of the robot error messages that are errors (not warnings)
+ */
+static const uint8_t cErrorFlag             = 0x01;
+
+/*
+ * Number of joysticks described to the robot (every slot is described, so
+ * that the robot knows which joysticks are detached)
+ */
+#define JOYSTICK_SLOTS 6
+
+/*
+ * Robot stream state of a DS context, the UDP packets are generated and read
+ * by the FRC 2015 protocol (with its own state)
+ */
+typedef struct {
+    /* Joystick layouts (axes, hats, buttons) that were described */
+    uint8_t layouts [JOYSTICK_SLOTS][3];
+    unsigned int layout_version;
+
+    /* Bit n is set if the descriptor of joystick n must be sent */
+    unsigned int pending_joysticks;
+
+    /* Version of the match information that was sent */
+    size_t match_version;
+    int pending_match_info;
+    int pending_game_data;
+
+    /* Robot address of the current team number */
+    DS_StrCache robot_address;
+} FRC2020Context;
+
+/**
+ * Returns the protocol state of the current DS context
+ */
+static FRC2020Context* get_context (void)
+{
+    return (FRC2020Context*) DS_ContextData (DS_CONTEXT_FRC_2020,
+                                             sizeof (FRC2020Context),
+                                             NULL, NULL);
+}
+
+/**
+ * Compares the layout of each joystick slot with the layout that was last
+ * described to the robot, and marks the descriptors of the joysticks that
+ * were attached, detached or changed as pending. Nothing is compared while
+ * the layout version of the joysticks does not change.
+ */
+static void update_joystick_layouts (void)
+{
+    int i;
+    int count;
+    unsigned int version = DS_GetJoystickLayoutVersion();
+    FRC2020Context* ctx = get_context();
+
+    if (version == ctx->layout_version)
+        return;
+
+    ctx->layout_version = version;
+    count = DS_GetJoystickCount();
+
+    for (i = 0; i < JOYSTICK_SLOTS; ++i) {
+        uint8_t layout [3] = {0, 0, 0};
+
+        if (i < count) {
+            layout [0] = (uint8_t) DS_GetJoystickNumAxes (i);
+            layout [1] = (uint8_t) DS_GetJoystickNumHats (i);
+            layout [2] = (uint8_t) DS_GetJoystickNumButtons (i);
+        }
+
+        if (memcmp (ctx->layouts [i], layout, sizeof (layout)) != 0) {
+            memcpy (ctx->layouts [i], layout, sizeof (layout));
+            ctx->pending_joysticks |= 1u << i;
+        }
+    }
+}
+
+/**
+ * Returns the match type code of the given \a type
+ */
+static uint8_t get_match_type (const DS_MatchType type)
+{
+    switch (type) {
+    case DS_MATCH_PRACTICE:
+        return cMatchPractice;
+    case DS_MATCH_QUALIFICATION:
+        return cMatchQualification;
+    case DS_MATCH_ELIMINATION:
+        return cMatchElimination;
+    default:
+        return cMatchNone;
+    }
+}
+
+/**
+ * Writes the descriptor of the joystick in the given \a slot, which tells
+ * the robot program the name, type and layout of the joystick. Detached
+ * joysticks are described with an empty layout.
+ */
+static void write_joystick_descriptor (DS_Packet* packet, const int slot)
+{
+    int i;
+    char name [32];
+    FRC2020Context* ctx = get_context();
+
+    const uint8_t axes = ctx->layouts [slot][0];
+    const uint8_t hats = ctx->layouts [slot][1];
+    const uint8_t buttons = ctx->layouts [slot][2];
+    const int attached = (axes + hats + buttons) > 0;
+
+    /* Detached joysticks have no name */
+    name [0] = '\0';
+    if (attached)
+        snprintf (name, sizeof (name), "Joystick %d", slot);
+
+    /* Add tag, joystick index, XInput flag and device type */
+    DS_PacketAppend (packet, cTagJoystickDescriptor);
+    DS_PacketAppend (packet, (uint8_t) slot);
+    DS_PacketAppend (packet, 0);
+    DS_PacketAppend (packet, attached ? cHIDJoystick : cHIDUnknown);
+
+    /* Add joystick name */
+    DS_PacketAppend (packet, (uint8_t) strlen (name));
+    DS_PacketAppendBytes (packet, name, strlen (name));
+
+    /* Add axis types (X, Y, Z, twist, then throttles) */
+    DS_PacketAppend (packet, axes);
+    for (i = 0; i < axes; ++i)
+        DS_PacketAppend (packet, (uint8_t) DS_Min (i, cAxisThrottle));
+
+    /* Add button and POV counts */
+    DS_PacketAppend (packet, buttons);
+    DS_PacketAppend (packet, hats);
+}
+
+/**
+ * Writes the event name, match type, match number and replay number of the
+ * given match \a info
+ */
+static void write_match_info (DS_Packet* packet, const CFG_MatchInfo* info)
+{
+    size_t len = strlen (info->event_name);
+
+    DS_PacketAppend (packet, cTagMatchInfo);
+    DS_PacketAppend (packet, (uint8_t) len);
+    DS_PacketAppendBytes (packet, info->event_name, len);
+    DS_PacketAppend (packet, get_match_type (info->match_type));
+    DS_PacketAppendU16 (packet, (uint16_t) info->match_number);
+    DS_PacketAppend (packet, (uint8_t) info->replay_number);
+}
+
+/**
+ * Writes the game-specific message of the given match \a info
+ */
+static void write_game_data (DS_Packet* packet, const CFG_MatchInfo* info)
+{
+    DS_PacketAppend (packet, cTagGameData);
+    DS_PacketAppendBytes (packet, info->game_data, strlen (info->game_data));
+}
+
+/**
+ * Reads a string field of a robot error message (its length as a 16-bit
+ * number, followed by its bytes), the field is not copied. The length is
+ * set to \c 0 if the field is truncated.
+ */
+static const char* read_field (DS_Reader* reader, size_t* len)
+{
+    *len = DS_ReaderU16 (reader);
+    const char* bytes = (const char*) DS_ReaderBytes (reader, *len);
+
+    if (!bytes)
+        *len = 0;
+
+    return bytes;
+}
+
+/**
+ * Displays a message printed by the robot program, which contains:
+ *    - The timestamp of the message (float) and its sequence number (u16)
+ *    - The printed text (the rest of the message)
+ */
+static int read_standard_output (DS_Reader* reader)
+{
+    float timestamp = DS_ReaderFloat (reader);
+    DS_ReaderSkip (reader, 2);
+    if (reader->error)
+        return 0;
+
+    DS_AddRobotClockSample (timestamp);
+
+    size_t len = DS_ReaderRemaining (reader);
+    const char* text = (const char*) DS_ReaderBytes (reader, len);
+
+    Messages_AddOutput (text, len);
+    return 1;
+}
+
+/**
+ * Displays an error or warning reported by the robot program, which contains:
+ *    - The timestamp (float), sequence number (u16) and occurrences (u16)
+ *    - The error code (i32) and flags (u8)
+ *    - The details, location and call stack (strings with a u16 length)
+ */
+static int read_error_message (DS_Reader* reader)
+{
+    float timestamp = DS_ReaderFloat (reader);
+    DS_ReaderSkip (reader, 4);
+    int code = (int) DS_ReaderU32 (reader);
+    uint8_t flags = DS_ReaderU8 (reader);
+    if (reader->error)
+        return 0;
+
+    DS_AddRobotClockSample (timestamp);
+
+    /* Repeated messages are only counted (the call stack is not displayed) */
+    size_t details_len;
+    size_t location_len;
+    const char* details = read_field (reader, &details_len);
+    const char* location = read_field (reader, &location_len);
+
+    Messages_AddError ((flags & cErrorFlag) != 0, code,
+                       details, details_len, location, location_len);
+    return 1;
+}
+
+/**
+ * The robot address is found at roboRIO-TEAM-FRC.local
+ */
+static DS_String robot_address (void)
+{
+    const int team = CFG_GetTeamNumber();
+    return DS_StrCacheFormat (&get_context()->robot_address, team,
+                              "roboRIO-%d-FRC.local", team);
+}
+
+/**
+ * Writes the next pending message of the robot stream in the given
+ * \a packet, the packet is left empty if there is nothing to send.
+ * The messages are (in order of priority):
+ *    - The descriptors of the joysticks that changed
+ *    - The match information
+ *    - The game-specific message
+ */
+static void write_robot_stream (DS_Packet* packet)
+{
+    int slot;
+    CFG_MatchInfo info;
+    FRC2020Context* ctx = get_context();
+
+    /* Check if the joysticks or the match information changed */
+    update_joystick_layouts();
+    CFG_GetMatchInfo (&info);
+    if (info.version != ctx->match_version) {
+        ctx->match_version = info.version;
+        ctx->pending_match_info = 1;
+        ctx->pending_game_data = 1;
+    }
+
+    /* Describe the first joystick that changed */
+    if (ctx->pending_joysticks) {
+        for (slot = 0; !(ctx->pending_joysticks & (1u << slot)); ++slot)
+            ;
+
+        ctx->pending_joysticks &= ~(1u << slot);
+        write_joystick_descriptor (packet, slot);
+    }
+
+    /* Send the match information */
+    else if (ctx->pending_match_info) {
+        ctx->pending_match_info = 0;
+        write_match_info (packet, &info);
+    }
+
+    /* Send the game-specific message */
+    else if (ctx->pending_game_data) {
+        ctx->pending_game_data = 0;
+        write_game_data (packet, &info);
+    }
+}
+
+/**
+ * Interprets a message received through the robot stream, the standard
+ * output and the errors of the robot program are displayed in the
+ * NetConsole, other messages (e.g. usage reports) are ignored
+ */
+static int read_robot_stream (const DS_String* data)
+{
+    DS_Reader reader;
+    if (!DS_ReaderInit (&reader, data, 1))
+        return 0;
+
+    uint8_t tag = DS_ReaderU8 (&reader);
+
+    if (tag == cRTagStandardOutput)
+        return read_standard_output (&reader);
+
+    else if (tag == cRTagErrorMessage)
+        return read_error_message (&reader);
+
+    return 0;
+}
+
+/**
+ * Called when the robot stream is (re)connected, the robot knows nothing
+ * about the joysticks and the match, so everything is sent again
+ */
+static void reset_robot_stream (void)
+{
+    FRC2020Context* ctx = get_context();
+
+    ctx->pending_joysticks = (1u << JOYSTICK_SLOTS) - 1;
+    ctx->pending_match_info = 1;
+    ctx->pending_game_data = 1;
+}
+
+/**
+ * Initializes the FRC 2020 Communication Protocol. The UDP packets are the
+ * same as in the FRC 2015 protocol, but the robot program also expects the
+ * joystick descriptors and the match information through a TCP stream
+ * (port 1740), through which it sends its standard output and errors.
+ */
+DS_Protocol DS_GetProtocolFRC_2020 (void)
+{
+    DS_Protocol protocol = DS_GetProtocolFRC_2015();
+
+    /* Set protocol name */
+    DS_StrRmBuf (&protocol.name);
+    protocol.name = DS_StrNew ("FRC 2020");
+
+    /* Set robot address function */
+    protocol.robot_address = &robot_address;
+
+    /* Set robot stream functions */
+    protocol.write_robot_stream = &write_robot_stream;
+    protocol.read_robot_stream = &read_robot_stream;
+    protocol.reset_robot_stream = &reset_robot_stream;
+
+    /* Set joystick properties */
+    protocol.max_hat_count = 4;
+    protocol.max_axis_count = 12;
+    protocol.max_button_count = 16;
+
+    /* Define robot stream socket properties */
+    protocol.robot_stream_socket = DS_SocketEmpty();
+    protocol.robot_stream_socket.disabled = 0;
+    protocol.robot_stream_socket.out_port = 1740;
+    protocol.robot_stream_socket.type = DS_SOCKET_TCP;
+
+    return protocol;
+}
@@ -24,18 +24,62 @@
 #include "DS_Utils.h"
 #include "DS_Queue.h"
 
-#include <stdio.h>
 #include <assert.h>
-#include <stdlib.h>
 #include <string.h>
 
+/*
+ * Capacity of a queue initialized with a smaller count
+ */
+#define MIN_CAPACITY 4
+
+/**
+ * Returns the address of the item at the given ring \a index
+ */
+static void* item_at (DS_Queue* queue, int index)
+{
+    return queue->buffer + (index & (queue->capacity - 1)) * queue->item_size;
+}
+
+/**
+ * Replaces the buffer of the given \a queue with one of the given
+ * \a capacity (a power of two), the items are copied in order to the
+ * beginning of the new buffer, since the ring can wrap around
+ *
+ * \returns \c 1 on success, \c 0 if the memory cannot be allocated
+ */
+static int resize (DS_Queue* queue, int capacity)
+{
+    int head;
+    uint8_t* buffer = (uint8_t*) DS_MALLOC (DS_MEMORY_QUEUES,
+                                            (size_t) capacity * queue->item_size);
+
+    if (!buffer)
+        return 0;
+
+    /* Copy the items from the front to the end of the buffer, and then the
+     * items that wrapped around to its beginning */
+    if (queue->count > 0) {
+        head = DS_Min (queue->count, queue->capacity - queue->front);
+        memcpy (buffer, item_at (queue, queue->front),
+                (size_t) head * queue->item_size);
+        memcpy (buffer + head * queue->item_size, queue->buffer,
+                (size_t) (queue->count - head) * queue->item_size);
+    }
+
+    DS_FREE (queue->buffer);
+    queue->buffer = buffer;
+    queue->capacity = capacity;
+    queue->front = 0;
+    return 1;
+}
+
 /**
  * Removes the first item in the given \a queue
  *
  * \param queue the queue in which to operate
  * \returns \c 1 on success, \c 0 on failure
  */
-extern int DS_QueuePop (DS_Queue* queue)
+int DS_QueuePop (DS_Queue* queue)
 {
     /* Check arguments */
     assert (queue);
@@ -44,13 +88,9 @@ extern int DS_QueuePop (DS_Queue* queue)
     if (queue->count <= 0)
         return 0;
 
-    /* Update queue properties */
+    /* Update queue properties, the front index wraps around the ring */
     --queue->count;
-    ++queue->front;
-
-    /* This is a circular queue, go back to the beginning */
-    if (queue->front >= queue->capacity)
-        queue->front = 0;
+    queue->front = (queue->front + 1) & (queue->capacity - 1);
 
     return 1;
 }
@@ -61,21 +101,15 @@ extern int DS_QueuePop (DS_Queue* queue)
  *
  * \param queue the queue to destroy
  */
-extern void DS_QueueFree (DS_Queue* queue)
+void DS_QueueFree (DS_Queue* queue)
 {
     /* Check arguments */
     assert (queue);
 
-    /* Free all the items in the queue */
-    int element;
-    for (element = 0; element < queue->capacity; ++element)
-        DS_FREE (queue->buffer [element]);
-
     /* Delete the buffer */
     DS_FREE (queue->buffer);
 
     /* Reset queue properties */
-    queue->rear = -1;
     queue->count = 0;
     queue->front = 0;
     queue->capacity = 0;
@@ -100,68 +134,60 @@ void* DS_QueueGetFirst (DS_Queue* queue)
 
     /* Get the first item in the list */
     assert (queue->buffer);
-    return (void*) queue->buffer [queue->front];
+    return item_at (queue, queue->front);
 }
 
 /**
- * Adds the given \a item to the \a queue in a circular fashion
+ * Copies the given \a item to the end of the \a queue, if the queue is full,
+ * its capacity is doubled first
  *
  * \param queue the queue in which to operate
- * \param item the item to add, to avoid potential errors, the pointer data
- *        is duplicated by this function
+ * \param item the item to add, its data is copied by this function
+ *
+ * \returns \c 1 on success, \c 0 if the queue cannot be enlarged
  */
-void DS_QueuePush (DS_Queue* queue, void* item)
+int DS_QueuePush (DS_Queue* queue, const void* item)
 {
     /* Check arguments */
     assert (queue);
+    assert (item);
 
     /* Queue is full, expand it */
-    if (queue->count >= queue->capacity) {
-        queue->capacity *= 2;
-        queue->buffer = (void**) realloc (queue->buffer,
-                                          queue->capacity * queue->item_size);
-
-        int i;
-        for (i = queue->count; i < queue->capacity; ++i)
-            queue->buffer [i] = (void**) malloc (queue->item_size);
-    }
+    if (queue->count >= queue->capacity &&
+            !resize (queue, DS_Max (queue->capacity * 2, MIN_CAPACITY)))
+        return 0;
 
-    /* Update queue properties */
-    ++queue->rear;
+    /* Copy the data after the last item */
+    memcpy (item_at (queue, queue->front + queue->count), item,
+            (size_t) queue->item_size);
     ++queue->count;
 
-    /* Front item should be somewhere in the middle by now */
-    if (queue->rear >= queue->capacity)
-        queue->rear = 0;
-
-    /* Since we don't want to depend on potential idiots, copy the data */
-    assert (queue->buffer);
-    memcpy (queue->buffer [queue->rear], item, queue->item_size);
+    return 1;
 }
 
 /**
  * Initializes the given queue and allocates memory for its elements
  *
  * \param queue the queue to initialize
- * \param initial_count the initial number of elements of the queue
+ * \param initial_count the initial number of elements of the queue, which
+ *        is rounded up to a power of two
  * \param item_size the size to use for each inidividual element of the queue
  */
 void DS_QueueInit (DS_Queue* queue, int initial_count, int item_size)
 {
-    /* Set initial navitation values */
-    queue->rear = -1;
-    queue->count = 0;
-    queue->front = 0;
+    int capacity = MIN_CAPACITY;
+
+    /* Check arguments */
+    assert (queue);
+    assert (item_size > 0);
 
     /* Set queue properties */
+    memset (queue, 0, sizeof (DS_Queue));
     queue->item_size = item_size;
-    queue->capacity = initial_count;
 
-    /* Initialize the pointer list */
-    queue->buffer = (void**) calloc (initial_count, initial_count * item_size);
+    /* Allocate the ring buffer */
+    while (capacity < initial_count)
+        capacity *= 2;
 
-    /* Initialize each item in the list */
-    int item;
-    for (item = 0; item < initial_count; ++item)
-        queue->buffer [item] = malloc (item_size);
+    resize (queue, capacity);
 }
@@ -0,0 +1,333 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Utils.h"
+#include "DS_Registry.h"
+#include "DS_DefaultProtocols.h"
+#include "DS_Thread.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined _WIN32
+    #include <windows.h>
+#else
+    #include <dlfcn.h>
+#endif
+
+/*
+ * The FRC 2016 and FRC 2020 protocols are built on top of the FRC 2015
+ * protocol
+ */
+#if defined DS_NO_FRC_2015 && !defined DS_NO_FRC_2016
+    #error "The FRC 2016 protocol requires the FRC 2015 protocol"
+#endif
+#if defined DS_NO_FRC_2015 && !defined DS_NO_FRC_2020
+    #error "The FRC 2020 protocol requires the FRC 2015 protocol"
+#endif
+
+/**
+ * A registered protocol
+ */
+typedef struct {
+    char name [DS_MAX_PROTOCOL_NAME_LEN];
+    DS_ProtocolFactory factory;
+} Entry;
+
+/*
+ * The registry is shared by all the DS contexts, the built-in protocols are
+ * registered when the registry is first used
+ */
+static int count = 0;
+static Entry entries [DS_MAX_PROTOCOLS];
+static DS_Mutex mutex = DS_MUTEX_INITIALIZER;
+static DS_Once init_once = DS_ONCE_INIT;
+
+/**
+ * Returns the index of the protocol with the given \a name, or \c -1 if
+ * the protocol is not registered (the mutex must be locked)
+ */
+static int find_entry (const char* name)
+{
+    int i;
+
+    for (i = 0; i < count; ++i) {
+        if (strcmp (entries [i].name, name) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+/**
+ * Registers (or replaces) the protocol with the given \a name, returns \c 1
+ * on success or \c 0 if the registry is full (the mutex must be locked)
+ */
+static int add_entry (const char* name, DS_ProtocolFactory factory)
+{
+    int index = find_entry (name);
+    if (index < 0 && count < DS_MAX_PROTOCOLS)
+        index = count++;
+
+    if (index < 0)
+        return 0;
+
+    strcpy (entries [index].name, name);
+    entries [index].factory = factory;
+    return 1;
+}
+
+/**
+ * Registers the protocols that are built into the library, unless they have
+ * been excluded with \c DS_NO_FRC_2014, \c DS_NO_FRC_2015, \c DS_NO_FRC_2016
+ * or \c DS_NO_FRC_2020 (e.g. for constrained targets)
+ */
+static void register_defaults (void)
+{
+    DS_MutexLock (&mutex);
+#if !defined DS_NO_FRC_2020
+    add_entry ("FRC 2020", &DS_GetProtocolFRC_2020);
+#endif
+#if !defined DS_NO_FRC_2016
+    add_entry ("FRC 2016", &DS_GetProtocolFRC_2016);
+#endif
+#if !defined DS_NO_FRC_2015
+    add_entry ("FRC 2015", &DS_GetProtocolFRC_2015);
+#endif
+#if !defined DS_NO_FRC_2014
+    add_entry ("FRC 2014", &DS_GetProtocolFRC_2014);
+#endif
+    DS_MutexUnlock (&mutex);
+}
+
+/**
+ * Registers the built-in protocols (only once)
+ */
+static void init_registry (void)
+{
+    DS_CallOnce (&init_once, &register_defaults);
+}
+
+/**
+ * Registers the given protocol \a factory with the given \a name, so that
+ * the protocol can be listed and loaded by name. If a protocol with the
+ * same name is already registered, it is replaced.
+ *
+ * The built-in protocols are registered as "FRC 2020", "FRC 2016",
+ * "FRC 2015" and "FRC 2014" (in that order).
+ *
+ * \returns \c 1 on success, \c 0 if the name is invalid or the registry is
+ *          full
+ */
+int DS_RegisterProtocol (const char* name, DS_ProtocolFactory factory)
+{
+    int registered;
+
+    if (!name || !factory || !*name)
+        return 0;
+
+    if (strlen (name) >= DS_MAX_PROTOCOL_NAME_LEN)
+        return 0;
+
+    init_registry();
+    DS_MutexLock (&mutex);
+    registered = add_entry (name, factory);
+    DS_MutexUnlock (&mutex);
+
+    return registered;
+}
+
+/**
+ * Removes the protocol with the given \a name from the registry, the
+ * protocols that are already loaded are not affected
+ *
+ * \returns \c 1 if the protocol was registered, \c 0 otherwise
+ */
+int DS_UnregisterProtocol (const char* name)
+{
+    int index;
+
+    if (!name)
+        return 0;
+
+    init_registry();
+    DS_MutexLock (&mutex);
+
+    index = find_entry (name);
+    if (index >= 0) {
+        memmove (&entries [index], &entries [index + 1],
+                 (count - index - 1) * sizeof (Entry));
+        --count;
+    }
+
+    DS_MutexUnlock (&mutex);
+    return index >= 0;
+}
+
+/**
+ * Returns the number of registered protocols
+ */
+int DS_RegisteredProtocolCount (void)
+{
+    int value;
+
+    init_registry();
+    DS_MutexLock (&mutex);
+    value = count;
+    DS_MutexUnlock (&mutex);
+
+    return value;
+}
+
+/**
+ * Returns the name of the registered protocol with the given \a index (in
+ * registration order), or an empty string if the \a index is invalid
+ *
+ * \note The returned string must be freed by the caller
+ */
+DS_String DS_RegisteredProtocolName (const int index)
+{
+    DS_String name;
+
+    init_registry();
+    DS_MutexLock (&mutex);
+
+    if (index >= 0 && index < count)
+        name = DS_StrNew (entries [index].name);
+    else
+        name = DS_StrNewLen (0);
+
+    DS_MutexUnlock (&mutex);
+    return name;
+}
+
+/**
+ * Creates a new instance of the registered protocol with the given \a name
+ * and writes it to the given \a protocol
+ *
+ * \returns \c 1 on success, \c 0 if the protocol is not registered
+ */
+int DS_CreateRegisteredProtocol (const char* name, DS_Protocol* protocol)
+{
+    int index;
+    DS_ProtocolFactory factory = NULL;
+
+    if (!name || !protocol)
+        return 0;
+
+    init_registry();
+    DS_MutexLock (&mutex);
+
+    index = find_entry (name);
+    if (index >= 0)
+        factory = entries [index].factory;
+
+    DS_MutexUnlock (&mutex);
+
+    if (factory)
+        *protocol = factory();
+
+    return factory != NULL;
+}
+
+/**
+ * Loads the registered protocol with the given \a name in the current DS
+ * context (see \c DS_ConfigureProtocol())
+ *
+ * \returns \c 1 on success, \c 0 if the protocol is not registered
+ */
+int DS_LoadRegisteredProtocol (const char* name)
+{
+    DS_Protocol protocol;
+
+    if (!DS_CreateRegisteredProtocol (name, &protocol))
+        return 0;
+
+    DS_ConfigureProtocol (&protocol);
+    return 1;
+}
+
+/**
+ * Loads the protocol module (shared library) at the given \a path and
+ * registers its protocols. The module must export a \c DS_GetProtocolModule()
+ * function (see \c DS_ProtocolModule) that was built for the same version of
+ * the protocol interface.
+ *
+ * Modules are never unloaded, since the loaded protocols keep pointers to
+ * their functions.
+ *
+ * \returns the number of registered protocols, or \c -1 if the module cannot
+ *          be loaded or is not compatible
+ */
+int DS_LoadProtocolModule (const char* path)
+{
+    int i;
+    int registered = 0;
+    DS_ProtocolModuleEntry entry;
+    const DS_ProtocolModule* module;
+
+    if (!path)
+        return -1;
+
+    /* Load the library and find its entry point */
+#if defined _WIN32
+    HMODULE library = LoadLibraryA (path);
+    if (!library) {
+        fprintf (stderr, "DS_LoadProtocolModule: Cannot load %s!\n", path);
+        return -1;
+    }
+
+    entry = (DS_ProtocolModuleEntry) GetProcAddress (library,
+                                                     DS_PROTOCOL_MODULE_ENTRY);
+#else
+    void* library = dlopen (path, RTLD_NOW | RTLD_LOCAL);
+    if (!library) {
+        fprintf (stderr, "DS_LoadProtocolModule: %s\n", dlerror());
+        return -1;
+    }
+
+    *(void**) (&entry) = dlsym (library, DS_PROTOCOL_MODULE_ENTRY);
+#endif
+
+    /* Check that the module is compatible */
+    module = entry ? entry() : NULL;
+    if (!module || module->abi_version != DS_PROTOCOL_ABI_VERSION ||
+            module->protocol_size != sizeof (DS_Protocol) ||
+            module->count < 0 || (module->count > 0 && !module->protocols)) {
+        fprintf (stderr, "DS_LoadProtocolModule: %s is not compatible!\n", path);
+
+#if defined _WIN32
+        FreeLibrary (library);
+#else
+        dlclose (library);
+#endif
+        return -1;
+    }
+
+    /* Register the protocols of the module */
+    for (i = 0; i < module->count; ++i)
+        registered += DS_RegisterProtocol (module->protocols [i].name,
+                                           module->protocols [i].factory);
+
+    return registered;
+}
@@ -0,0 +1,336 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Utils.h"
+#include "DS_Timer.h"
+#include "DS_Client.h"
+#include "DS_Thread.h"
+#include "DS_Histogram.h"
+#include "DS_SelfTest.h"
+
+#include <socky.h>
+#include <string.h>
+
+#if !defined _WIN32
+    #include <sys/select.h>
+    #include <arpa/inet.h>
+#endif
+
+/*
+ * Timer check: duration (in msecs) and the requested sleeps, which are the
+ * same as the waits of the event loops
+ */
+#define TIMER_DURATION 1000
+static const int SLEEPS [] = { 1, 2, 5, 10, 20 };
+#define SLEEP_COUNT ((int) (sizeof (SLEEPS) / sizeof (SLEEPS [0])))
+
+/*
+ * Loopback check: number of round trips, time (in msecs) between them and
+ * time (in msecs) after which a datagram is considered lost
+ */
+#define LOOPBACK_SAMPLES  100
+#define LOOPBACK_INTERVAL 5
+#define LOOPBACK_TIMEOUT  100
+
+/*
+ * Lateness check: number of sends, at the interval (in msecs) of the robot
+ * packets
+ */
+#define LATENESS_SAMPLES 75
+#define LATENESS_PERIOD  20
+
+/*
+ * Two UDP sockets bound to the loopback interface
+ */
+typedef struct {
+    int a;
+    int b;
+    struct sockaddr_in addr_a;
+    struct sockaddr_in addr_b;
+} Loopback;
+
+/**
+ * Converts the given \a histogram to a percentile summary
+ */
+static DS_LatencyStats get_stats (const DS_Histogram* histogram)
+{
+    DS_LatencyStats stats;
+    stats.samples = histogram->total;
+    stats.p50 = DS_HistogramPercentile (histogram, 50);
+    stats.p99 = DS_HistogramPercentile (histogram, 99);
+    stats.max = histogram->max;
+    return stats;
+}
+
+/**
+ * Records the time elapsed since \a start beyond the \a expected time (both
+ * in usecs)
+ */
+static void record_delay (DS_Histogram* histogram,
+                          const uint64_t start,
+                          const uint64_t expected)
+{
+    uint64_t elapsed = DS_GetTimeUs() - start;
+    DS_HistogramRecord (histogram, (uint32_t) (elapsed > expected ?
+                                               elapsed - expected : 0));
+}
+
+/**
+ * Waits on a condition that is never signaled, like the event loops wait
+ * for their next deadline
+ */
+static void timed_wait (const int millisecs)
+{
+    static DS_Cond cond = DS_COND_INITIALIZER;
+    static DS_Mutex mutex = DS_MUTEX_INITIALIZER;
+
+    DS_MutexLock (&mutex);
+    DS_TimedWait (&cond, &mutex, millisecs);
+    DS_MutexUnlock (&mutex);
+}
+
+/**
+ * Opens a UDP socket bound to a free port of the loopback interface, and
+ * writes its address to \a addr
+ */
+static int open_socket (struct sockaddr_in* addr)
+{
+    socklen_t len = sizeof (*addr);
+    int sfd = (int) socket (AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+    if (sfd < 0)
+        return -1;
+
+    memset (addr, 0, sizeof (*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+
+    if (bind (sfd, (struct sockaddr*) addr, sizeof (*addr)) != 0 ||
+            getsockname (sfd, (struct sockaddr*) addr, &len) != 0) {
+        socket_close (sfd);
+        return -1;
+    }
+
+    return sfd;
+}
+
+/**
+ * Sends a datagram from the \a from socket to the \a to socket, and returns
+ * \c 1 if it was received before the loopback timeout
+ */
+static int transfer (const int from, const int to, const struct sockaddr_in* addr)
+{
+    fd_set set;
+    struct timeval tv;
+    char buffer [32] = "LibDS self-test";
+
+    if (sendto (from, buffer, sizeof (buffer), 0,
+                (const struct sockaddr*) addr, sizeof (*addr)) < 0)
+        return 0;
+
+    FD_ZERO (&set);
+    FD_SET (to, &set);
+    tv.tv_sec = 0;
+    tv.tv_usec = LOOPBACK_TIMEOUT * 1000;
+
+    if (select (to + 1, &set, NULL, NULL, &tv) <= 0)
+        return 0;
+
+    return recv (to, buffer, sizeof (buffer), 0) > 0;
+}
+
+/**
+ * Measures how much longer than requested the sleeps and timed waits take,
+ * this detects a coarse system timer (e.g. the 15.6 ms default of Windows)
+ * and the wake-up delay of the power-saving states of the CPU
+ */
+static void test_timer (DS_SelfTestResult* result)
+{
+    int i = 0;
+    int sleep;
+    uint64_t start;
+    DS_Histogram errors;
+    uint64_t end = DS_GetTimeUs() + TIMER_DURATION * 1000;
+
+    DS_HistogramReset (&errors);
+    while (DS_GetTimeUs() < end) {
+        sleep = SLEEPS [(i / 2) % SLEEP_COUNT];
+        start = DS_GetTimeUs();
+
+        if (i % 2 == 0)
+            DS_Sleep (sleep);
+        else
+            timed_wait (sleep);
+
+        record_delay (&errors, start, (uint64_t) sleep * 1000);
+        ++i;
+    }
+
+    result->sleep_error = get_stats (&errors);
+    result->timer_passed = result->sleep_error.p50 <= DS_SELF_TEST_MAX_SLEEP_ERROR_P50 &&
+                           result->sleep_error.p99 <= DS_SELF_TEST_MAX_SLEEP_ERROR_P99;
+}
+
+/**
+ * Measures the round-trip time of datagrams between two loopback sockets
+ */
+static void test_loopback (Loopback* loopback, DS_SelfTestResult* result)
+{
+    int i;
+    uint64_t start;
+    DS_Histogram times;
+
+    DS_HistogramReset (&times);
+    for (i = 0; i < LOOPBACK_SAMPLES; ++i) {
+        start = DS_GetTimeUs();
+        if (transfer (loopback->a, loopback->b, &loopback->addr_b) &&
+                transfer (loopback->b, loopback->a, &loopback->addr_a))
+            record_delay (&times, start, 0);
+        else
+            ++result->loopback_lost;
+
+        DS_Sleep (LOOPBACK_INTERVAL);
+    }
+
+    result->loopback = get_stats (&times);
+    result->loopback_passed = result->loopback_lost == 0 &&
+                              result->loopback.p99 <= DS_SELF_TEST_MAX_LOOPBACK_P99;
+}
+
+/**
+ * Measures the time needed to resolve the robot address of the current
+ * context (e.g. through mDNS), the check fails if it is too slow, even if
+ * the address is not found (the robot may be off)
+ */
+static void test_resolve (DS_SelfTestResult* result)
+{
+    uint64_t start;
+    struct addrinfo* info = NULL;
+    char* address = DS_GetAppliedRobotAddress();
+
+    if (address) {
+        strncpy (result->robot_address, address, DS_SELF_TEST_ADDRESS_SIZE - 1);
+        result->robot_address [DS_SELF_TEST_ADDRESS_SIZE - 1] = '\0';
+    }
+
+    DS_FREE (address);
+
+    start = DS_GetTimeUs();
+    if (strlen (result->robot_address) > 0)
+        info = get_address_info (result->robot_address, NULL,
+                                 SOCKY_UDP, SOCKY_IPv4);
+
+    result->resolve_time = (unsigned int) (DS_GetTimeUs() - start);
+    result->resolved = (info != NULL);
+    result->resolve_passed = result->resolve_time <= DS_SELF_TEST_MAX_RESOLVE_TIME;
+
+    if (info)
+        freeaddrinfo (info);
+}
+
+/**
+ * Sends a datagram every 20 ms (like the robot packets) and measures how
+ * late each send is, under the current load of the system
+ */
+static void test_lateness (Loopback* loopback, DS_SelfTestResult* result)
+{
+    int i;
+    uint64_t now;
+    uint64_t deadline;
+    DS_Histogram lateness;
+    char buffer [32] = "LibDS self-test";
+    const uint64_t period = LATENESS_PERIOD * 1000;
+
+    DS_HistogramReset (&lateness);
+    deadline = DS_GetTimeUs() + period;
+    for (i = 0; i < LATENESS_SAMPLES; ++i) {
+        while ((now = DS_GetTimeUs()) < deadline)
+            timed_wait ((int) ((deadline - now + 999) / 1000));
+
+        sendto (loopback->a, buffer, sizeof (buffer), 0,
+                (const struct sockaddr*) &loopback->addr_b,
+                sizeof (loopback->addr_b));
+        record_delay (&lateness, deadline, 0);
+
+        /* Follow an ideal schedule, so the lateness does not accumulate */
+        deadline += period;
+        if (DS_GetTimeUs() > deadline)
+            deadline = DS_GetTimeUs() + period;
+    }
+
+    result->lateness = get_stats (&lateness);
+    result->lateness_passed = result->lateness.p99 <= DS_SELF_TEST_MAX_LATENESS_P99 &&
+                              result->lateness.max <= DS_SELF_TEST_MAX_LATENESS;
+}
+
+/**
+ * Checks whether this computer can keep up with the 50 Hz robot packets,
+ * by measuring (for about three seconds):
+ *
+ * - The accuracy of the sleeps and timed waits
+ * - The round-trip time of datagrams through the loopback interface
+ * - The time needed to resolve the robot address of the current context
+ * - The lateness of 50 Hz sends under the current load
+ *
+ * The calling thread is blocked while the test runs, so it should not be the
+ * thread of the user interface. The LibDS must be initialized.
+ *
+ * \returns \c 1 if the test ran (see \c result->passed for its outcome), or
+ *          \c 0 if the loopback sockets cannot be opened or the virtual clock
+ *          is used
+ */
+int DS_RunSelfTest (DS_SelfTestResult* result)
+{
+    Loopback loopback;
+
+    if (!result || DS_VirtualClock())
+        return 0;
+
+    memset (result, 0, sizeof (DS_SelfTestResult));
+
+    loopback.a = open_socket (&loopback.addr_a);
+    loopback.b = open_socket (&loopback.addr_b);
+    if (loopback.a < 0 || loopback.b < 0) {
+        if (loopback.a >= 0)
+            socket_close (loopback.a);
+        if (loopback.b >= 0)
+            socket_close (loopback.b);
+
+        return 0;
+    }
+
+    test_timer (result);
+    test_loopback (&loopback, result);
+    test_resolve (result);
+    test_lateness (&loopback, result);
+
+    socket_close (loopback.a);
+    socket_close (loopback.b);
+
+    result->passed = result->timer_passed &&
+                     result->loopback_passed &&
+                     result->resolve_passed &&
+                     result->lateness_passed;
+
+    return 1;
+}
@@ -21,12 +21,58 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+/*
+ * WSAPoll() is only available on Windows Vista and later
+ */
+#if defined _WIN32
+    #if !defined _WIN32_WINNT || _WIN32_WINNT < 0x0600
+        #undef  _WIN32_WINNT
+        #define _WIN32_WINNT 0x0600
+    #endif
+#endif
+
 #include "DS_Utils.h"
+#include "DS_Timer.h"
+#include "DS_Atomic.h"
 #include "DS_Socket.h"
+#include "DS_Trace.h"
 
 #include <socky.h>
 #include <assert.h>
 
+#if defined _WIN32
+    #define POLL WSAPoll
+    typedef WSAPOLLFD PollFd;
+#else
+    #include <poll.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <arpa/inet.h>
+    #define POLL poll
+    typedef struct pollfd PollFd;
+#endif
+
+#if defined __linux__
+    #include <sys/eventfd.h>
+#endif
+
+/*
+ * Do not raise SIGPIPE when a TCP peer closes the connection during a send
+ */
+#if defined MSG_NOSIGNAL
+    #define SEND_FLAGS MSG_NOSIGNAL
+#else
+    #define SEND_FLAGS 0
+#endif
+
+#if defined _WIN32
+    #define SHUTDOWN_BOTH SD_BOTH
+#else
+    #define SHUTDOWN_BOTH SHUT_RDWR
+#endif
+
 #define SPRINTF_S snprintf
 #ifdef _WIN32
     #ifndef __MINGW32__
@@ -35,275 +81,2729 @@
     #endif
 #endif
 
+/*
+ * Maximum number of sockets that can be registered with the reactor (each
+ * DS context registers up to six sockets)
+ */
+#define MAX_SOCKETS 64
+
+/*
+ * Maximum number of other descriptors (e.g. input devices) that can be
+ * watched by the reactor (see DS_SocketWatch)
+ */
+#define MAX_WATCHES 32
+
+/*
+ * Maximum number of descriptors polled by the reactor (TCP sockets poll
+ * their IPv4 and IPv6 listeners and their stream, and the wakeup socket and
+ * the watched descriptors are polled too)
+ */
+#define MAX_POLL_FDS (MAX_SOCKETS * 3 + MAX_WATCHES + 1)
+
+/*
+ * Time (in milliseconds) after which a resolved address is looked up again,
+ * and after which a failed lookup is retried
+ */
+#define ADDRESS_TTL  30000
+#define LOOKUP_RETRY 1000
+
+/*
+ * Number of resolver threads, so that a slow lookup (e.g. a missing mDNS
+ * responder) does not delay the lookup of the other addresses. Embedded
+ * builds can lower it with DS_RESOLVER_THREADS.
+ */
+#if defined DS_RESOLVER_THREADS
+    #define RESOLVER_THREADS DS_RESOLVER_THREADS
+#else
+    #define RESOLVER_THREADS 4
+#endif
+
+/*
+ * Time (in milliseconds) after which a failed or lost TCP connection is
+ * attempted again, after which a connection attempt is aborted, and that
+ * a sender waits for a full TCP send buffer to drain
+ */
+#define TCP_RETRY           500
+#define TCP_CONNECT_TIMEOUT 2000
+#define TCP_SEND_TIMEOUT    100
+
+/*
+ * Time (in milliseconds) that Sockets_Close() waits for the resolver
+ * threads, a thread that is still waiting for a lookup (e.g. an mDNS lookup)
+ * exits on its own once the lookup finishes
+ */
+#define RESOLVER_EXIT_TIMEOUT 100
+
+/*
+ * Maximum number of datagrams held back by the impaired sockets, extra time
+ * (in milliseconds) that a reordered datagram is held back (longer than the
+ * send interval of the protocols, so that the next datagram overtakes it)
+ * and maximum time (in milliseconds) that a datagram can wait for a capped
+ * link before it is dropped
+ */
+#define IMPAIR_QUEUE         64
+#define IMPAIR_REORDER_DELAY 25
+#define IMPAIR_MAX_BACKLOG   200
+
+/*
+ * Maximum age (in milliseconds) of a kernel receive timestamp, older stamps
+ * (e.g. after the wall clock was changed) are replaced by the read time
+ */
+#define MAX_STAMP_AGE 1000
+
+/*
+ * Time (in usecs) that the kernel busy-polls the device queue of a socket
+ * (SO_BUSY_POLL) while the reactor is in busy-polling mode, unless the
+ * socket asks for a longer time
+ */
+#define BUSY_POLL_USECS 50
+
+/*
+ * Operations that the reactor thread must perform on a registered socket
+ */
+typedef enum {
+    ACTION_NONE,
+    ACTION_OPEN,
+    ACTION_CLOSE,
+    ACTION_CONNECT,
+    ACTION_REBIND,
+} SocketAction;
+
+/**
+ * Holds a received datagram
+ */
+typedef struct {
+    size_t len;                       /**< Number of bytes in \a data */
+    uint64_t time;                    /**< Receive time (in usecs) */
+    char data [DS_SOCKET_SLOT_SIZE];  /**< The received bytes */
+} DS_Datagram;
+
+/**
+ * Holds an address that a socket can use and its resolved value
+ */
+typedef struct {
+    int len;                         /**< Size of \a addr, 0 if unresolved */
+    int pending;                     /**< 1 if the host must be looked up */
+    int running;                     /**< 1 while the host is looked up */
+    uint64_t time;                   /**< Time (in ms) of the last lookup */
+    char host [DS_SOCKET_HOST_SIZE]; /**< Host name or IP address */
+    char addr [DS_SOCKET_ADDR_SIZE]; /**< Resolved address (a sockaddr) */
+} DS_SocketCandidate;
+
+/**
+ * Holds all the private (erm, dirty) variables that the sockets module needs
+ * to operate with the data provided by a \c DS_Socket structure, allocated
+ * by \c socket_info() and de-allocated by \c DS_SocketClose()
+ */
+struct _ds_socket_info {
+    int sock_in;           /**< Input socket file descriptor */
+    int sock_out;          /**< Output socket file descriptor */
+    int sock_in6;          /**< IPv6 input socket file descriptor */
+    int sock_out6;         /**< IPv6 output socket file descriptor */
+    int client_init;       /**< 1 if client is working, 0 if not */
+    int server_init;       /**< 1 if server is working, 0 if not */
+    size_t head;           /**< Next slot to be written by the reactor */
+    size_t tail;           /**< Next slot to be read by the application */
+    char in_service [12];  /**< Holds the input port number as a string */
+    char out_service [12]; /**< Holds the output port number as a string */
+    int connected;         /**< 1 if the output socket is connected */
+    int connecting;        /**< 1 while the TCP stream is being connected */
+    uint64_t deadline;     /**< Time (in ms) of the next TCP connect/timeout */
+    size_t stream_len;     /**< Number of bytes in the reassembly buffer */
+    size_t stream_skip;    /**< Bytes left of an oversized TCP message */
+    volatile uint64_t sent_bytes; /**< Bytes sent since the socket was set up */
+    volatile uint64_t recv_bytes; /**< Bytes received since it was set up */
+    int active;            /**< Candidate in use, -1 if none */
+    int locked;            /**< 1 if a probed candidate has replied */
+    int remote_len;        /**< Size of the address in use */
+    int candidate_count;   /**< Address and fallback addresses count */
+    char remote [DS_SOCKET_ADDR_SIZE]; /**< Address in use */
+    DS_SocketCandidate candidates [DS_SOCKET_MAX_CANDIDATES]; /**< Addresses */
+    DS_SocketImpairment impairment; /**< Simulated network conditions */
+    uint32_t impair_seed;  /**< State of the impairment's random generator */
+    uint64_t impair_idle [2]; /**< Time (in usecs) in which the simulated
+                                   link is idle again (inbound, outbound) */
+    DS_Datagram ring [DS_SOCKET_SLOTS]; /**< Received datagram ring */
+    char stream [DS_SOCKET_STREAM_SIZE]; /**< TCP reassembly buffer */
+};
+
+/*
+ * Registered sockets and their pending operations
+ */
+static int socket_count = 0;
+static DS_Socket* sockets [MAX_SOCKETS];
+static SocketAction actions [MAX_SOCKETS];
+
+/*
+ * Reactor thread data
+ */
+static int running = 0;
+static int wakeup_fd = -1;
+static int wakeup_write_fd = -1;
+static DS_Thread reactor_thread;
+static DS_Cond done_cond = DS_COND_INITIALIZER;
+static DS_Mutex mutex = DS_MUTEX_INITIALIZER;
+
+/*
+ * Scheduling options of the reactor thread, applied by the thread itself
+ */
+static int thread_cpu = -1;
+static int thread_realtime = 0;
+static int thread_options_changed = 0;
+
+/*
+ * Set to 1 if the reactor polls the sockets without sleeping
+ */
+static int busy_polling = 0;
+
+/*
+ * Set to 1 if the system supports IPv6, otherwise, host names are only
+ * resolved to IPv4 addresses
+ */
+static int ipv6_enabled = 0;
+
+/*
+ * Resolver thread data, host names (e.g. mDNS names) are looked up in this
+ * thread so that neither the reactor nor the senders wait for the network
+ */
+static int resolver_count = 0;
+static DS_Cond lookup_cond = DS_COND_INITIALIZER;
+static DS_Cond resolver_cond = DS_COND_INITIALIZER;
+
+/*
+ * Datagrams held back by the impaired sockets (see DS_SocketSetImpairment),
+ * the queue is only allocated once a socket is impaired
+ */
+typedef struct {
+    DS_Socket* socket;                /* Socket that sent/received it */
+    int outbound;                     /* 1 if it must be sent */
+    uint64_t release;                 /* Release time (in usecs) */
+    size_t len;                       /* Number of bytes in data */
+    char data [DS_SOCKET_SLOT_SIZE];  /* The datagram */
+} DelayedDatagram;
+
+static int delayed_count = 0;
+static DelayedDatagram* delayed = NULL;
+
+/*
+ * Descriptors watched by the reactor (see DS_SocketWatch), their callbacks
+ * are called with the mutex unlocked, \c dispatch_fd holds the descriptor
+ * whose callback is running (or -1)
+ */
+typedef struct {
+    int fd;             /* Watched descriptor */
+    DS_WatchFunc func;  /* Called when the descriptor can be read */
+    void* data;         /* Given to the callback */
+} Watch;
+
+static int watch_count = 0;
+static int dispatch_fd = -1;
+static Watch watches [MAX_WATCHES];
+static DS_Cond watch_cond = DS_COND_INITIALIZER;
+
+/*
+ * Used to notify the protocol event loops that a socket received data, the
+ * generation is increased on each notification, so that every event loop
+ * (one per DS context) can tell if it missed a notification
+ */
+static size_t data_generation = 0;
+static DS_Cond data_cond = DS_COND_INITIALIZER;
+static DS_Mutex data_mutex = DS_MUTEX_INITIALIZER;
+
+/**
+ * Wakes up every thread waiting in \c DS_SocketWaitForData()
+ */
+static void notify_data (void)
+{
+    DS_MutexLock (&data_mutex);
+    ++data_generation;
+    DS_CondBroadcast (&data_cond);
+    DS_MutexUnlock (&data_mutex);
+}
+
+/**
+ * Interrupts the \c poll() call of the reactor thread, so that it can
+ * process new open/close requests
+ */
+static void wake_reactor (void)
+{
+    if (wakeup_write_fd < 0)
+        return;
+
+#if defined _WIN32
+    send (wakeup_write_fd, "", 1, 0);
+#elif defined __linux__
+    uint64_t value = 1;
+    ssize_t rc = write (wakeup_write_fd, &value, sizeof (value));
+    (void) rc;
+#else
+    ssize_t rc = write (wakeup_write_fd, "", 1);
+    (void) rc;
+#endif
+}
+
+/**
+ * Clears the pending wakeup requests of the reactor thread
+ */
+static void clear_wakeup (void)
+{
+#if defined _WIN32
+    char drain [16];
+    recv (wakeup_fd, drain, sizeof (drain), 0);
+#elif defined __linux__
+    uint64_t value;
+    ssize_t rc = read (wakeup_fd, &value, sizeof (value));
+    (void) rc;
+#else
+    char drain [64];
+    while (read (wakeup_fd, drain, sizeof (drain)) > 0)
+        continue;
+#endif
+}
+
+/**
+ * Creates the descriptors that are used to wake up the reactor thread: an
+ * eventfd on Linux, a pipe on other POSIX systems, and a loopback UDP socket
+ * connected to itself on Windows (where \c WSAPoll() only accepts sockets)
+ *
+ * \returns \c 1 on success, \c 0 on failure
+ */
+static int create_wakeup (void)
+{
+#if defined _WIN32
+    struct sockaddr_in addr;
+    socklen_t len = sizeof (addr);
+    int sfd = socket (AF_INET, SOCK_DGRAM, 0);
+    if (sfd <= 0)
+        return 0;
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = 0;
+    addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+
+    /* Bind to a random port and send datagrams to that port */
+    if (bind (sfd, (struct sockaddr*) &addr, len) != 0 ||
+        getsockname (sfd, (struct sockaddr*) &addr, &len) != 0 ||
+        connect (sfd, (struct sockaddr*) &addr, len) != 0) {
+        socket_close (sfd);
+        return 0;
+    }
+
+    wakeup_fd = sfd;
+    wakeup_write_fd = sfd;
+#elif defined __linux__
+    wakeup_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+    wakeup_write_fd = wakeup_fd;
+#else
+    int fds [2];
+    if (pipe (fds) != 0)
+        return 0;
+
+    fcntl (fds [0], F_SETFL, fcntl (fds [0], F_GETFL, 0) | O_NONBLOCK);
+    fcntl (fds [1], F_SETFL, fcntl (fds [1], F_GETFL, 0) | O_NONBLOCK);
+    wakeup_fd = fds [0];
+    wakeup_write_fd = fds [1];
+#endif
+
+    return (wakeup_fd >= 0);
+}
+
+/**
+ * Closes the descriptors that are used to wake up the reactor thread
+ */
+static void close_wakeup (void)
+{
+#if defined _WIN32
+    socket_close (wakeup_fd);
+#else
+    if (wakeup_write_fd != wakeup_fd)
+        close (wakeup_write_fd);
+
+    close (wakeup_fd);
+#endif
+
+    wakeup_fd = -1;
+    wakeup_write_fd = -1;
+}
+
+/**
+ * Returns the registry index of the given socket, or \c -1 if the socket
+ * is not registered with the reactor. The mutex must be locked by the
+ * calling thread.
+ */
+static int find_socket (const DS_Socket* ptr)
+{
+    int i;
+    for (i = 0; i < socket_count; ++i) {
+        if (sockets [i] == ptr)
+            return i;
+    }
+
+    return -1;
+}
+
+/**
+ * Returns the runtime state of the given socket, which is allocated (with
+ * no address in use and no fallback addresses) if the socket has none yet.
+ * The mutex must be locked by the calling thread.
+ *
+ * \returns the runtime state, or \c NULL if it cannot be allocated
+ */
+static DS_SocketInfo* socket_info (DS_Socket* ptr)
+{
+    if (!ptr->info) {
+        ptr->info = (DS_SocketInfo*) DS_CALLOC (DS_MEMORY_GENERAL, 1,
+                                                sizeof (DS_SocketInfo));
+        if (ptr->info) {
+            ptr->info->active = -1;
+            ptr->info->candidate_count = 1;
+        }
+    }
+
+    return ptr->info;
+}
+
+/**
+ * Removes the socket at the given registry \a index. The mutex must be
+ * locked by the calling thread.
+ */
+static void unregister_socket (const int index)
+{
+    assert (index >= 0 && index < socket_count);
+
+    --socket_count;
+    sockets [index] = sockets [socket_count];
+    actions [index] = actions [socket_count];
+}
+
+/**
+ * Resolves the given \a host and \a service into the \a addr buffer. If
+ * \a numeric is set, only numeric hosts are accepted, so that the function
+ * returns immediately and never performs a network lookup.
+ *
+ * The address can be an IPv4 or an IPv6 address (if the system supports
+ * IPv6), e.g. the link-local IPv6 address of an mDNS host.
+ *
+ * \returns the size of the obtained address, or \c 0 on failure
+ */
+static int resolve_address (const char* host, const char* service,
+                            const int numeric, char* addr, const int addr_size)
+{
+    /* Host is empty */
+    if (!host || !host [0])
+        return 0;
+
+    /* Set hints */
+    struct addrinfo hints, *info = NULL;
+    memset (&hints, 0, sizeof (hints));
+    hints.ai_family = ipv6_enabled ? AF_UNSPEC : AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = numeric ? AI_NUMERICHOST : 0;
+
+    /* Get address info */
+    if (getaddrinfo (host, service, &hints, &info) != 0 || !info)
+        return 0;
+
+    /* Copy the first address (in the order preferred by the resolver) */
+    int len = 0;
+    struct addrinfo* item;
+    for (item = info; item != NULL && len == 0; item = item->ai_next) {
+        if (item->ai_family != AF_INET && item->ai_family != AF_INET6)
+            continue;
+
+        if ((int) item->ai_addrlen <= addr_size) {
+            len = (int) item->ai_addrlen;
+            memcpy (addr, item->ai_addr, len);
+        }
+    }
+
+    freeaddrinfo (info);
+    return len;
+}
+
+/**
+ * Returns the address family of the given cached address (a sockaddr)
+ */
+static int address_family (const char* addr)
+{
+    struct sockaddr sa;
+    memcpy (&sa, addr, sizeof (sa));
+    return sa.sa_family;
+}
+
+/**
+ * Returns the UDP output socket of the given socket that can send datagrams
+ * to addresses of the given \a family
+ */
+static int output_socket (const DS_Socket* ptr, const int family)
+{
+    if (family == AF_INET6)
+        return ptr->info->sock_out6;
+
+    return ptr->info->sock_out;
+}
+
+/**
+ * Returns \c 1 if the given socket is probing its address candidates (it
+ * sends each datagram to every candidate until one of them replies)
+ */
+static int probing (const DS_Socket* ptr)
+{
+    return ptr->type == DS_SOCKET_UDP && ptr->discovery && !ptr->info->locked;
+}
+
+/**
+ * Asks the reactor to apply the address of the given socket (unless the
+ * reactor will re-open the socket). The mutex must be locked by the calling
+ * thread.
+ */
+static void request_connect (DS_Socket* ptr)
+{
+    int index = find_socket (ptr);
+    if (index >= 0 && actions [index] == ACTION_NONE) {
+        actions [index] = ACTION_CONNECT;
+        wake_reactor();
+    }
+}
+
+/**
+ * Asks the resolver threads to look up the address candidate at the given
+ * \a index of the given socket. The mutex must be locked by the calling
+ * thread.
+ */
+static void request_lookup (DS_Socket* ptr, const int index)
+{
+    DS_SocketCandidate* candidate = &ptr->info->candidates [index];
+
+    if (candidate->host [0] && !candidate->running) {
+        candidate->pending = 1;
+        DS_CondSignal (&lookup_cond);
+    }
+}
+
+/**
+ * Uses the resolved address candidate at the given \a index for the socket
+ * if no candidate is in use yet, or if the candidate has a higher priority
+ * (lower index) than the candidate in use. The mutex must be locked by the
+ * calling thread.
+ */
+static void commit_candidate (DS_Socket* ptr, const int index)
+{
+    DS_SocketCandidate* candidate = &ptr->info->candidates [index];
+
+    /* Candidate is not resolved */
+    if (candidate->len <= 0)
+        return;
+
+    /* A candidate with a higher priority (or that replied) is in use */
+    int active = ptr->info->active;
+    if (active >= 0 && active < index)
+        return;
+    if (ptr->info->locked && active != index)
+        return;
+
+    /* Address did not change */
+    if (active == index &&
+        (ptr->info->connected || ptr->info->connecting || probing (ptr)) &&
+        candidate->len == ptr->info->remote_len &&
+        memcmp (ptr->info->remote, candidate->addr, candidate->len) == 0)
+        return;
+
+    /* Use the candidate address */
+    memcpy (ptr->info->remote, candidate->addr, candidate->len);
+    ptr->info->remote_len = candidate->len;
+    ptr->info->active = index;
+    request_connect (ptr);
+}
+
+/**
+ * Stops using the current address of the socket and switches to the
+ * resolved candidate with the highest priority (if any). The mutex must be
+ * locked by the calling thread.
+ */
+static void drop_active_candidate (DS_Socket* ptr)
+{
+    ptr->info->active = -1;
+    ptr->info->locked = 0;
+    ptr->info->connected = 0;
+    ptr->info->remote_len = 0;
+
+    /* Close the TCP stream, even if no other candidate is resolved */
+    if (ptr->type == DS_SOCKET_TCP)
+        request_connect (ptr);
+
+    int i;
+    for (i = 0; i < ptr->info->candidate_count; ++i)
+        commit_candidate (ptr, i);
+}
+
+/**
+ * Resolves the candidate at the given \a index directly if it is a numeric
+ * address, otherwise, the candidate is looked up by the resolver threads.
+ * The mutex must be locked by the calling thread.
+ */
+static void lookup_candidate (DS_Socket* ptr, const int index)
+{
+    DS_SocketCandidate* candidate = &ptr->info->candidates [index];
+    int len = resolve_address (candidate->host, ptr->info->out_service, 1,
+                               candidate->addr, sizeof (candidate->addr));
+
+    if (len > 0) {
+        candidate->len = len;
+        candidate->time = DS_GetTimeMs();
+        commit_candidate (ptr, index);
+    }
+
+    else
+        request_lookup (ptr, index);
+}
+
+/**
+ * Changes the host of the candidate at the given \a index, if the host
+ * changed, the resolved address of the candidate is discarded.
+ * The mutex must be locked by the calling thread.
+ *
+ * \returns \c 1 if the host changed, \c 0 if not
+ */
+static int set_candidate (DS_Socket* ptr, const int index,
+                          const char* host, size_t len)
+{
+    DS_SocketCandidate* candidate = &ptr->info->candidates [index];
+    len = DS_Min (len, sizeof (candidate->host) - 1);
+
+    /* Host did not change */
+    if (strlen (candidate->host) == len &&
+        memcmp (candidate->host, host, len) == 0)
+        return 0;
+
+    /* Reset the candidate (a running lookup result will be discarded) */
+    memset (candidate, 0, sizeof (DS_SocketCandidate));
+    memcpy (candidate->host, host, len);
+    return 1;
+}
+
+/**
+ * Makes the given socket probe all of its address candidates again, this
+ * is done when the remote host stops replying, as it may now be reachable
+ * through another address. The mutex must be locked by the calling thread.
+ */
+static void restart_discovery (DS_Socket* ptr)
+{
+    if (ptr->discovery && ptr->info->locked) {
+        ptr->info->locked = 0;
+        ptr->info->connected = 0;
+        request_connect (ptr);
+    }
+}
+
+/**
+ * Requests a new lookup of each address candidate when its cached address
+ * expires (or after a failed lookup). The mutex must be locked by the
+ * calling thread.
+ */
+static void refresh_address (DS_Socket* ptr)
+{
+    int i;
+    uint64_t now = DS_GetTimeMs();
+
+    for (i = 0; i < ptr->info->candidate_count; ++i) {
+        DS_SocketCandidate* candidate = &ptr->info->candidates [i];
+
+        if (candidate->pending || candidate->running)
+            continue;
+
+        uint64_t ttl = candidate->len > 0 ? ADDRESS_TTL : LOOKUP_RETRY;
+        if (now - candidate->time >= ttl)
+            request_lookup (ptr, i);
+    }
+}
+
+/**
+ * Returns the busy-polling time (in usecs) of the given socket, which is
+ * raised while the reactor is in busy-polling mode
+ */
+static int busy_poll_time (const DS_Socket* ptr)
+{
+    if (busy_polling && ptr->type != DS_SOCKET_TCP)
+        return DS_Max (ptr->busy_poll, BUSY_POLL_USECS);
+
+    return ptr->busy_poll;
+}
+
+/**
+ * Applies the receive buffer size and busy-polling options of the given
+ * socket structure to the given input descriptor
+ */
+static void apply_input_options (const DS_Socket* ptr, const int sfd)
+{
+    if (sfd <= 0)
+        return;
+
+    /* Set kernel buffer size */
+    if (ptr->recv_buffer > 0)
+        set_socket_buffers (sfd, ptr->recv_buffer, 0);
+
+    /* Busy-poll the input socket */
+    if (busy_poll_time (ptr) > 0)
+        set_socket_busy_poll (sfd, busy_poll_time (ptr));
+
+    /* Let the kernel stamp the arrival time of the datagrams */
+    if (ptr->type != DS_SOCKET_TCP)
+        set_socket_timestamps (sfd, 1);
+}
+
+/**
+ * Applies the send buffer size and DSCP marking of the given socket
+ * structure to the given output descriptor
+ */
+static void apply_output_options (const DS_Socket* ptr, const int sfd)
+{
+    if (sfd <= 0)
+        return;
+
+    /* Set kernel buffer size */
+    if (ptr->send_buffer > 0)
+        set_socket_buffers (sfd, 0, ptr->send_buffer);
+
+    /* Mark the outgoing packets */
+    if (ptr->dscp > 0)
+        set_socket_tos (sfd, (ptr->dscp & 0x3F) << 2);
+}
+
+/**
+ * Applies the buffer sizes, DSCP marking and busy-polling options of the
+ * given socket structure to its file descriptors
+ *
+ * \param ptr pointer to a \c DS_Socket structure
+ */
+static void apply_socket_options (DS_Socket* ptr)
+{
+    /* Check arguments */
+    assert (ptr);
+
+    /* TCP sockets receive data through their stream */
+    if (ptr->type == DS_SOCKET_TCP) {
+        apply_input_options (ptr, ptr->info->sock_out);
+        apply_output_options (ptr, ptr->info->sock_out);
+        return;
+    }
+
+    /* Configure the IPv4 and IPv6 sockets */
+    apply_input_options (ptr, ptr->info->sock_in);
+    apply_input_options (ptr, ptr->info->sock_in6);
+    apply_output_options (ptr, ptr->info->sock_out);
+    apply_output_options (ptr, ptr->info->sock_out6);
+}
+
+/**
+ * Closes the given socket file descriptor. Descriptors are only closed by
+ * the reactor thread (or while it is stopped), so no other thread can be
+ * blocked on the descriptor and the call returns immediately.
+ */
+static void close_descriptor (const int sfd)
+{
+    socket_close (sfd);
+}
+
+/**
+ * Closes the TCP stream of the given socket and discards the incomplete
+ * message in its reassembly buffer. If \a retry is set, the socket connects
+ * to its address again after \c TCP_RETRY milliseconds.
+ */
+static void close_stream (DS_Socket* ptr, const int retry)
+{
+    close_descriptor (ptr->info->sock_out);
+
+    ptr->info->sock_out = -1;
+    ptr->info->connected = 0;
+    ptr->info->connecting = 0;
+    ptr->info->stream_len = 0;
+    ptr->info->stream_skip = 0;
+    ptr->info->deadline = retry ? DS_GetTimeMs() + TCP_RETRY : 0;
+}
+
+/**
+ * Configures a TCP stream that was just established (or accepted): the
+ * messages are sent without delay, and the socket options are applied
+ */
+static void setup_stream (DS_Socket* ptr)
+{
+    int val = 1;
+    setsockopt (ptr->info->sock_out, IPPROTO_TCP, TCP_NODELAY,
+                (const char*) &val, sizeof (val));
+
+#if defined SO_NOSIGPIPE
+    setsockopt (ptr->info->sock_out, SOL_SOCKET, SO_NOSIGPIPE,
+                &val, sizeof (val));
+#endif
+
+    apply_socket_options (ptr);
+}
+
+/**
+ * Starts connecting the TCP stream of the given socket to its cached remote
+ * address (the previous stream is closed). The reactor waits for the
+ * connection to complete, so this function never blocks.
+ */
+static void connect_stream (DS_Socket* ptr)
+{
+    /* Close the previous stream */
+    close_stream (ptr, 0);
+
+    /* Address is not resolved yet, or socket does not connect */
+    if (ptr->info->remote_len <= 0 || ptr->out_port <= 0)
+        return;
+
+    /* Copy address to an aligned structure */
+    struct sockaddr_storage addr;
+    memset (&addr, 0, sizeof (addr));
+    memcpy (&addr, ptr->info->remote, ptr->info->remote_len);
+
+    /* Start connecting */
+    int sfd = tcp_connect_async ((struct sockaddr*) &addr,
+                                 ptr->info->remote_len, 0);
+    if (sfd <= 0) {
+        ptr->info->deadline = DS_GetTimeMs() + TCP_RETRY;
+        return;
+    }
+
+    ptr->info->sock_out = sfd;
+    ptr->info->connecting = 1;
+    ptr->info->deadline = DS_GetTimeMs() + TCP_CONNECT_TIMEOUT;
+}
+
+/**
+ * Called by the reactor when the TCP stream that is being connected becomes
+ * writable, which means that the connection was established or that it
+ * failed (in which case the socket tries again later)
+ */
+static void finish_connect (DS_Socket* ptr)
+{
+    if (tcp_connect_status (ptr->info->sock_out) != 0) {
+        close_stream (ptr, 1);
+        return;
+    }
+
+    ptr->info->connecting = 0;
+    ptr->info->connected = 1;
+    ptr->info->deadline = 0;
+    setup_stream (ptr);
+}
+
+/**
+ * Accepts a connection on the given TCP listener (\a sfd) of the given
+ * socket, the new connection replaces the current stream (e.g. when the
+ * remote host reconnects before the old connection times out)
+ */
+static void accept_stream (DS_Socket* ptr, const int listener)
+{
+    char host [DS_SOCKET_HOST_SIZE];
+    char service [12];
+
+    int sfd = tcp_accept (listener, host, sizeof (host),
+                          service, sizeof (service),
+                          NI_NUMERICHOST | NI_NUMERICSERV);
+    if (sfd <= 0)
+        return;
+
+    close_stream (ptr, 0);
+
+#ifndef _WIN32
+    set_socket_block (sfd, 0);
+#endif
+
+    ptr->info->sock_out = sfd;
+    ptr->info->connected = 1;
+    setup_stream (ptr);
+}
+
+/**
+ * Dissolves the association of the given UDP socket (of the given address
+ * \a family) with its remote address
+ */
+static void disconnect_descriptor (const int sfd, const int family)
+{
+    if (sfd <= 0)
+        return;
+
+    struct sockaddr_storage addr;
+    memset (&addr, 0, sizeof (addr));
+
+    /* Windows disconnects when the address is 0, other systems need AF_UNSPEC */
+#if defined _WIN32
+    addr.ss_family = family;
+#else
+    addr.ss_family = AF_UNSPEC;
+#endif
+
+    int len = sizeof (struct sockaddr_in);
+    if (family == AF_INET6)
+        len = sizeof (struct sockaddr_in6);
+
+    connect (sfd, (struct sockaddr*) &addr, len);
+}
+
+/**
+ * Dissolves the association of the UDP output sockets with their remote
+ * address, so that datagrams can be sent to any address
+ */
+static void disconnect_socket (DS_Socket* ptr)
+{
+    disconnect_descriptor (ptr->info->sock_out, AF_INET);
+    disconnect_descriptor (ptr->info->sock_out6, AF_INET6);
+    ptr->info->connected = 0;
+}
+
+/**
+ * Connects the UDP output socket to the cached remote address, so that
+ * datagrams can be sent without specifying (or resolving) the address.
+ *
+ * While the socket probes its address candidates, the output socket is
+ * disconnected instead. TCP sockets open a new connection to the address.
+ */
+static void connect_socket (DS_Socket* ptr)
+{
+    /* Check arguments */
+    assert (ptr);
+
+    /* Socket is not open */
+    if (!ptr->info->client_init)
+        return;
+
+    /* Establish a new TCP connection */
+    if (ptr->type == DS_SOCKET_TCP) {
+        connect_stream (ptr);
+        return;
+    }
+
+    /* Send datagrams to every candidate until one of them replies */
+    if (probing (ptr)) {
+        disconnect_socket (ptr);
+        return;
+    }
+
+    /* Address is not resolved yet */
+    ptr->info->connected = 0;
+    if (ptr->info->remote_len <= 0)
+        return;
+
+    /* Copy address to an aligned structure */
+    struct sockaddr_storage addr;
+    memset (&addr, 0, sizeof (addr));
+    memcpy (&addr, ptr->info->remote, ptr->info->remote_len);
+
+    /* Connect the output socket of the address family */
+    int sfd = output_socket (ptr, addr.ss_family);
+    if (sfd > 0 && connect (sfd, (struct sockaddr*) &addr,
+                            ptr->info->remote_len) == 0)
+        ptr->info->connected = 1;
+}
+
+/**
+ * Returns \c 1 if the given cached address (a sockaddr) has the same IP
+ * address as the \a sender address
+ */
+static int same_host (const char* addr, const struct sockaddr_storage* sender)
+{
+    if (address_family (addr) != sender->ss_family)
+        return 0;
+
+    /* Compare IPv4 addresses */
+    if (sender->ss_family == AF_INET) {
+        struct sockaddr_in a;
+        memcpy (&a, addr, sizeof (a));
+        return a.sin_addr.s_addr ==
+               ((const struct sockaddr_in*) sender)->sin_addr.s_addr;
+    }
+
+    /* Compare IPv6 addresses */
+    if (sender->ss_family == AF_INET6) {
+        struct sockaddr_in6 a;
+        memcpy (&a, addr, sizeof (a));
+        return memcmp (&a.sin6_addr,
+                       &((const struct sockaddr_in6*) sender)->sin6_addr,
+                       sizeof (a.sin6_addr)) == 0;
+    }
+
+    return 0;
+}
+
+/**
+ * Makes the given socket use the address candidate that matches the sender
+ * of the \a from address (which replied to the probes of the socket).
+ * The mutex must be locked by the calling thread.
+ */
+static void lock_candidate (DS_Socket* ptr, const struct sockaddr_storage* from)
+{
+    int i;
+    for (i = 0; i < ptr->info->candidate_count; ++i) {
+        DS_SocketCandidate* candidate = &ptr->info->candidates [i];
+        if (candidate->len <= 0 || !same_host (candidate->addr, from))
+            continue;
+
+        /* Lock onto the candidate */
+        memcpy (ptr->info->remote, candidate->addr, candidate->len);
+        ptr->info->remote_len = candidate->len;
+        ptr->info->active = i;
+        ptr->info->locked = 1;
+        connect_socket (ptr);
+        return;
+    }
+}
+
+/**
+ * Returns \c 1 if the receive ring of the given socket has no free slots
+ */
+static int ring_full (const DS_Socket* ptr)
+{
+    size_t tail = DS_AtomicLoad (&ptr->info->tail);
+    return (ptr->info->head - tail) >= DS_SOCKET_SLOTS;
+}
+
+/**
+ * Returns \c 1 if another registered UDP socket (e.g. of another DS context
+ * talking to another robot) listens on the input port of the given socket.
+ * The mutex must be locked by the calling thread.
+ */
+static int shared_port (const DS_Socket* ptr)
+{
+    int i;
+    for (i = 0; i < socket_count; ++i) {
+        if (sockets [i] != ptr && sockets [i]->type == DS_SOCKET_UDP &&
+                sockets [i]->info->server_init &&
+                sockets [i]->in_port == ptr->in_port)
+            return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Returns the UDP socket that listens on the input port of the given socket
+ * and whose remote host sent a datagram from the \a sender address, or
+ * \c NULL if it is the given socket (or if no socket matches). The mutex
+ * must be locked by the calling thread.
+ */
+static DS_Socket* port_owner (const DS_Socket* ptr,
+                              const struct sockaddr_storage* sender)
+{
+    int i;
+
+    if (ptr->info->remote_len > 0 && same_host (ptr->info->remote, sender))
+        return NULL;
+
+    for (i = 0; i < socket_count; ++i) {
+        DS_Socket* sock = sockets [i];
+        if (sock != ptr && sock->type == DS_SOCKET_UDP &&
+                sock->info->server_init && sock->in_port == ptr->in_port &&
+                sock->info->remote_len > 0 &&
+                same_host (sock->info->remote, sender))
+            return sock;
+    }
+
+    return NULL;
+}
+
+/**
+ * Copies a datagram that was received (at the given \a time) by the
+ * descriptor of another socket to the receive ring of the given socket (it
+ * is dropped if the ring is full). The mutex must be locked by the calling
+ * thread.
+ */
+static void forward_datagram (DS_Socket* ptr, const char* data, const int len,
+                              const uint64_t time)
+{
+    if (ring_full (ptr))
+        return;
+
+    size_t head = ptr->info->head;
+    DS_Datagram* slot = &ptr->info->ring [head % DS_SOCKET_SLOTS];
+    memcpy (slot->data, data, (size_t) len);
+    slot->len = len;
+    slot->time = time;
+
+    DS_AtomicAdd64 (&ptr->info->recv_bytes, (uint64_t) len);
+    DS_AtomicStore (&ptr->info->head, head + 1);
+}
+
+/**
+ * Returns \c 1 if the given network conditions alter any datagram
+ */
+static int impairment_active (const DS_SocketImpairment* imp)
+{
+    return imp->loss > 0 || imp->duplicate > 0 || imp->reorder > 0 ||
+           imp->latency > 0 || imp->jitter > 0 || imp->bandwidth > 0;
+}
+
+/**
+ * Returns \c 1 if the datagrams of the given socket go through the
+ * simulated network conditions. The mutex must be locked by the calling
+ * thread.
+ */
+static int impaired (const DS_Socket* ptr)
+{
+    if (!delayed || ptr->type == DS_SOCKET_TCP)
+        return 0;
+
+    return impairment_active (&ptr->info->impairment);
+}
+
+/**
+ * Returns a pseudo-random number (xorshift) for the impairment decisions
+ * of the given socket
+ */
+static uint32_t impair_random (DS_Socket* ptr)
+{
+    uint32_t x = ptr->info->impair_seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    ptr->info->impair_seed = x;
+    return x;
+}
+
+/**
+ * Returns \c 1 with the given probability (in %)
+ */
+static int impair_chance (DS_Socket* ptr, const int percent)
+{
+    if (percent <= 0)
+        return 0;
+
+    return (int) (impair_random (ptr) % 100) < percent;
+}
+
+/**
+ * Holds back a copy of the given datagram until the time in which the
+ * simulated network would deliver it
+ */
+static void delay_datagram (DS_Socket* ptr, const int outbound,
+                            const char* data, const int len,
+                            const uint64_t now)
+{
+    const DS_SocketImpairment* imp = &ptr->info->impairment;
+
+    /* Wait for the capped link to send the previous datagrams */
+    uint64_t release = now;
+    if (imp->bandwidth > 0) {
+        uint64_t* idle = &ptr->info->impair_idle [outbound ? 1 : 0];
+        uint64_t start = DS_Max (*idle, now);
+        if (start - now > (uint64_t) IMPAIR_MAX_BACKLOG * 1000)
+            return;
+
+        *idle = start + (uint64_t) len * 8 * 1000 / imp->bandwidth;
+        release = *idle;
+    }
+
+    /* Add the latency, the jitter and the reordering delay */
+    release += (uint64_t) DS_Max (imp->latency, 0) * 1000;
+    if (imp->jitter > 0)
+        release += impair_random (ptr) % ((uint32_t) imp->jitter * 1000 + 1);
+    if (impair_chance (ptr, imp->reorder))
+        release += IMPAIR_REORDER_DELAY * 1000;
+
+    /* Queue is full, drop the datagram */
+    if (delayed_count >= IMPAIR_QUEUE)
+        return;
+
+    DelayedDatagram* entry = &delayed [delayed_count++];
+    memcpy (entry->data, data, (size_t) len);
+    entry->len = (size_t) len;
+    entry->socket = ptr;
+    entry->release = release;
+    entry->outbound = outbound;
+}
+
+/**
+ * Applies the simulated network conditions of the given socket to a
+ * datagram that it received (or that it sends), the datagram is dropped,
+ * or held back (along with its duplicate) until the reactor releases it.
+ * The mutex must be locked by the calling thread.
+ */
+static void impair_datagram (DS_Socket* ptr, const int outbound,
+                             const char* data, const int len)
+{
+    uint64_t now = DS_GetTimeUs();
+
+    if (impair_chance (ptr, ptr->info->impairment.loss))
+        return;
+
+    delay_datagram (ptr, outbound, data, len, now);
+    if (impair_chance (ptr, ptr->info->impairment.duplicate))
+        delay_datagram (ptr, outbound, data, len, now);
+}
+
+/**
+ * Discards the datagrams held back for the given socket. The mutex must be
+ * locked by the calling thread.
+ */
+static void drop_delayed (const DS_Socket* ptr)
+{
+    int i = 0;
+    while (i < delayed_count) {
+        if (delayed [i].socket == ptr)
+            delayed [i] = delayed [--delayed_count];
+        else
+            ++i;
+    }
+}
+
+/**
+ * Publishes the received datagrams and sends the outgoing datagrams whose
+ * release time has come (in release order). The mutex must be locked by the
+ * calling thread.
+ *
+ * \returns the time (in milliseconds) until the next release, or \c -1 if
+ *          no datagram is held back
+ */
+static int release_delayed (void)
+{
+    int i;
+    int published = 0;
+    uint64_t now = DS_GetTimeUs();
+
+    while (delayed_count > 0) {
+        /* Find the next datagram to release */
+        int next = 0;
+        for (i = 1; i < delayed_count; ++i) {
+            if (delayed [i].release < delayed [next].release)
+                next = i;
+        }
+
+        /* Wait until it is released */
+        if (delayed [next].release > now) {
+            if (published)
+                notify_data();
+
+            return (int) ((delayed [next].release - now + 999) / 1000);
+        }
+
+        /* Send it (if the socket is still connected) or publish it */
+        DelayedDatagram* entry = &delayed [next];
+        DS_Socket* ptr = entry->socket;
+        if (entry->outbound) {
+            int sfd = output_socket (ptr, address_family (ptr->info->remote));
+            if (ptr->info->connected && sfd > 0)
+                send (sfd, entry->data, entry->len, 0);
+        }
+
+        else {
+            forward_datagram (ptr, entry->data, (int) entry->len,
+                              entry->release);
+            published = 1;
+        }
+
+        *entry = delayed [--delayed_count];
+    }
+
+    if (published)
+        notify_data();
+
+    return -1;
+}
+
+/**
+ * Moves the complete messages of the TCP reassembly buffer of the given
+ * socket into its receive ring (up to the number of free slots). Messages
+ * that do not fit in a slot and empty messages are discarded. The remaining
+ * bytes are kept until the rest of the message arrives, or until the
+ * application releases a slot.
+ */
+static void flush_stream (DS_Socket* ptr)
+{
+    int count = 0;
+    size_t pos = 0;
+    size_t len = ptr->info->stream_len;
+    size_t head = ptr->info->head;
+    size_t tail = DS_AtomicLoad (&ptr->info->tail);
+    uint64_t now = DS_GetTimeUs();
+    const uint8_t* data = (const uint8_t*) ptr->info->stream;
+
+    while (pos < len) {
+        /* Discard the rest of an oversized message */
+        if (ptr->info->stream_skip > 0) {
+            size_t skip = DS_Min (ptr->info->stream_skip, len - pos);
+            ptr->info->stream_skip -= skip;
+            pos += skip;
+            continue;
+        }
+
+        /* Length prefix is incomplete */
+        if (len - pos < 2)
+            break;
+
+        /* Message is too large for a slot */
+        size_t size = ((size_t) data [pos] << 8) | data [pos + 1];
+        if (size > DS_SOCKET_SLOT_SIZE) {
+            ptr->info->stream_skip = size;
+            pos += 2;
+            continue;
+        }
+
+        /* Message is incomplete, or ring is full */
+        if (len - pos - 2 < size)
+            break;
+        if (size > 0 && (head + count - tail) >= DS_SOCKET_SLOTS)
+            break;
+
+        /* Copy the message to the next slot */
+        if (size > 0) {
+            DS_Datagram* slot = &ptr->info->ring [(head + count) % DS_SOCKET_SLOTS];
+            memcpy (slot->data, data + pos + 2, size);
+            slot->len = size;
+            slot->time = now;
+            ++count;
+        }
+
+        pos += size + 2;
+    }
+
+    /* Keep the incomplete message at the start of the buffer */
+    if (pos > 0) {
+        memmove (ptr->info->stream, ptr->info->stream + pos, len - pos);
+        ptr->info->stream_len = len - pos;
+    }
+
+    if (count > 0) {
+        DS_AtomicStore (&ptr->info->head, head + count);
+        notify_data();
+    }
+}
+
+/**
+ * Receives the available bytes of the TCP stream of the given socket into
+ * its reassembly buffer and publishes the complete messages. If the remote
+ * host closed the connection (or the connection failed), the stream is
+ * closed and the socket connects again later.
+ */
+static void read_stream (DS_Socket* ptr)
+{
+    /* Buffer is full, it can only hold complete messages */
+    size_t free_bytes = sizeof (ptr->info->stream) - ptr->info->stream_len;
+    if (free_bytes == 0) {
+        flush_stream (ptr);
+        return;
+    }
+
+    /* Read the stream */
+    int read = recv (ptr->info->sock_out,
+                     ptr->info->stream + ptr->info->stream_len,
+                     (int) free_bytes, 0);
+
+    /* Connection closed or failed */
+    if (read == 0 || (read < 0 && !socket_would_block())) {
+        close_stream (ptr, ptr->info->remote_len > 0);
+        return;
+    }
+
+    /* Publish the complete messages */
+    if (read > 0) {
+        DS_AtomicAdd64 (&ptr->info->recv_bytes, (uint64_t) read);
+        ptr->info->stream_len += read;
+        flush_stream (ptr);
+    }
+}
+
+/**
+ * Converts the given kernel receive \a stamp (wall clock, in usecs) to the
+ * monotonic clock of \c DS_GetTimeUs(), given the current time of both
+ * clocks. Returns \a now if the datagram has no (usable) stamp.
+ */
+static uint64_t receive_time (const uint64_t stamp, const uint64_t now,
+                              const uint64_t wall)
+{
+    if (stamp == 0 || stamp > wall)
+        return now;
+
+    uint64_t age = wall - stamp;
+    if (age > (uint64_t) MAX_STAMP_AGE * 1000 || age > now)
+        return now;
+
+    return now - age;
+}
+
+/**
+ * Receives all pending datagrams (up to the number of free slots) directly
+ * into the socket's receive ring, using a single batched call when the
+ * platform supports it. The reactor stops polling a socket while its ring
+ * is full, so the pending datagrams stay in the OS buffer instead of being
+ * dropped. TCP sockets read their stream instead.
+ *
+ * \param ptr pointer to a \c DS_Socket structure
+ * \param sfd the (IPv4 or IPv6) UDP input socket (or the ICMP socket) that
+ *            has pending data
+ */
+static void read_socket (DS_Socket* ptr, const int sfd)
+{
+    /* Check arguments */
+    assert (ptr);
+
+    /* Ring is full, wait for the application to release a slot */
+    if (ring_full (ptr))
+        return;
+
+    /* Read TCP socket */
+    if (ptr->type == DS_SOCKET_TCP) {
+        read_stream (ptr);
+        return;
+    }
+
+    /* Get the free slots */
+    int i;
+    int read = -1;
+    size_t head = ptr->info->head;
+    size_t tail = DS_AtomicLoad (&ptr->info->tail);
+    int free_slots = (int) (DS_SOCKET_SLOTS - (head - tail));
+    DS_Datagram* slot = NULL;
+
+    /* Point each datagram to its slot (senders are only needed to probe,
+     * or to give the datagrams of a shared port to the right socket) */
+    int shared = shared_port (ptr);
+    int want_sender = probing (ptr) || shared;
+    socky_datagram datagrams [DS_SOCKET_SLOTS];
+    struct sockaddr_storage senders [DS_SOCKET_SLOTS];
+    for (i = 0; i < free_slots; ++i) {
+        slot = &ptr->info->ring [(head + i) % DS_SOCKET_SLOTS];
+        datagrams [i].buf = slot->data;
+        datagrams [i].len = sizeof (slot->data);
+        datagrams [i].result = 0;
+        datagrams [i].addr = want_sender ? (struct sockaddr*) &senders [i] : NULL;
+        datagrams [i].addr_len = sizeof (senders [i]);
+    }
+
+    /* Receive the pending datagrams */
+    read = udp_recv_batch (sfd, datagrams, free_slots, 0);
+    uint64_t now = DS_GetTimeUs();
+    uint64_t wall = DS_GetWallTimeUs();
+
+    /* Publish the non-empty datagrams */
+    int count = 0;
+    int forwarded = 0;
+    uint64_t bytes = 0;
+    for (i = 0; i < read; ++i) {
+        if (datagrams [i].result <= 0)
+            continue;
+
+        /* Use the arrival time, not the time in which we got to read it */
+        uint64_t time = receive_time (datagrams [i].time, now, wall);
+
+        /* The kernel may deliver the datagrams of a shared port to any of
+         * its descriptors, give them to the socket of their sender */
+        if (shared) {
+            DS_Socket* owner = port_owner (ptr, &senders [i]);
+            if (owner) {
+                if (impaired (owner))
+                    impair_datagram (owner, 0, datagrams [i].buf,
+                                     datagrams [i].result);
+                else
+                    forward_datagram (owner, datagrams [i].buf,
+                                      datagrams [i].result, time);
+
+                forwarded = 1;
+                continue;
+            }
+        }
+
+        /* Lock onto the first probed address that replies */
+        if (want_sender && probing (ptr))
+            lock_candidate (ptr, &senders [i]);
+
+        /* Hold the datagram back until the simulated network delivers it */
+        if (impaired (ptr)) {
+            impair_datagram (ptr, 0, datagrams [i].buf, datagrams [i].result);
+            continue;
+        }
+
+        /* Move the datagram if an empty datagram was skipped */
+        DS_Datagram* dest = &ptr->info->ring [(head + count) % DS_SOCKET_SLOTS];
+        if (dest->data != datagrams [i].buf)
+            memcpy (dest->data, datagrams [i].buf, datagrams [i].result);
+
+        dest->len = datagrams [i].result;
+        dest->time = time;
+        bytes += datagrams [i].result;
+        ++count;
+    }
+
+    if (count > 0) {
+        DS_AtomicAdd64 (&ptr->info->recv_bytes, bytes);
+        DS_AtomicStore (&ptr->info->head, head + count);
+    }
+
+    if (count > 0 || forwarded)
+        notify_data();
+}
+
+/**
+ * Creates the file descriptors of the given socket structure
+ *
+ * \param ptr pointer to a \c DS_Socket structure
+ */
+static void open_socket (DS_Socket* ptr)
+{
+    /* Check arguments */
+    assert (ptr);
+
+    /* Ensure that ring and service strings are set to 0 */
+    ptr->info->head = 0;
+    ptr->info->tail = 0;
+    memset (ptr->info->in_service, 0, sizeof (ptr->info->in_service));
+    memset (ptr->info->out_service, 0, sizeof (ptr->info->out_service));
+
+    /* Set service strings */
+    int len = sizeof (ptr->info->in_service);
+    SPRINTF_S (ptr->info->in_service, len, "%d", ptr->in_port);
+    SPRINTF_S (ptr->info->out_service, len, "%d", ptr->out_port);
+
+    /* Open TCP listeners (the stream is connected by the reactor) */
+    ptr->info->sock_in = -1;
+    ptr->info->sock_out = -1;
+    ptr->info->sock_in6 = -1;
+    ptr->info->sock_out6 = -1;
+    if (ptr->type == DS_SOCKET_TCP && ptr->in_port > 0) {
+        ptr->info->sock_in = create_server_tcp (ptr->info->in_service,
+                                               SOCKY_IPv4, 0);
+        if (ipv6_enabled)
+            ptr->info->sock_in6 = create_server_tcp (ptr->info->in_service,
+                                                    SOCKY_IPv6, 0);
+    }
+
+    /* Open UDP sockets */
+    else if (ptr->type == DS_SOCKET_UDP) {
+        ptr->info->sock_out = create_client_udp (SOCKY_IPv4, 0);
+        ptr->info->sock_in = create_server_udp (ptr->info->in_service, SOCKY_IPv4, 0);
+        if (ipv6_enabled) {
+            ptr->info->sock_out6 = create_client_udp (SOCKY_IPv6, 0);
+            ptr->info->sock_in6 = create_server_udp (ptr->info->in_service,
+                                                    SOCKY_IPv6, 0);
+        }
+
+        /* Apply buffer sizes and QoS options */
+        apply_socket_options (ptr);
+    }
+
+    /* Open the ICMP socket (it sends and receives through one descriptor) */
+    else if (ptr->type == DS_SOCKET_ICMP) {
+        ptr->info->sock_out = create_client_icmp (0);
+        apply_socket_options (ptr);
+    }
+
+    /* Disable socket blocking */
+#ifndef _WIN32
+    if (ptr->info->sock_in > 0)
+        set_socket_block (ptr->info->sock_in, 0);
+    if (ptr->info->sock_in6 > 0)
+        set_socket_block (ptr->info->sock_in6, 0);
+    if (ptr->type == DS_SOCKET_ICMP && ptr->info->sock_out > 0)
+        set_socket_block (ptr->info->sock_out, 0);
+#endif
+
+    /* Update initialized states (TCP sockets always have a receive ring) */
+    if (ptr->type == DS_SOCKET_TCP) {
+        ptr->info->server_init = 1;
+        ptr->info->client_init = 1;
+    }
+
+    else if (ptr->type == DS_SOCKET_ICMP) {
+        ptr->info->server_init = (ptr->info->sock_out > 0);
+        ptr->info->client_init = (ptr->info->sock_out > 0);
+    }
+
+    else {
+        ptr->info->server_init = (ptr->info->sock_in > 0 || ptr->info->sock_in6 > 0);
+        ptr->info->client_init = (ptr->info->sock_out > 0 || ptr->info->sock_out6 > 0);
+    }
+
+    /* Connect directly to numeric addresses, look up host names later */
+    int i;
+    set_candidate (ptr, 0, ptr->address, strlen (ptr->address));
+    for (i = 0; i < ptr->info->candidate_count; ++i)
+        lookup_candidate (ptr, i);
+
+    if (ptr->info->active >= 0)
+        connect_socket (ptr);
+}
+
+/**
+ * Closes the socket file descriptors of the given socket structure
+ * and resets the structure's information.
+ *
+ * \param ptr pointer to the \c DS_Socket to close
+ */
+static void close_socket (DS_Socket* ptr)
+{
+    /* Check arguments */
+    assert (ptr);
+
+    /* Reset socket properties */
+    ptr->info->connected = 0;
+    ptr->info->connecting = 0;
+    ptr->info->deadline = 0;
+    ptr->info->stream_len = 0;
+    ptr->info->stream_skip = 0;
+    ptr->info->server_init = 0;
+    ptr->info->client_init = 0;
+
+    /* Discard the datagrams held back by the simulated network */
+    drop_delayed (ptr);
+    ptr->info->impair_idle [0] = 0;
+    ptr->info->impair_idle [1] = 0;
+
+    /* Reset the address cache (but keep the candidate hosts) */
+    int i;
+    ptr->info->active = -1;
+    ptr->info->locked = 0;
+    ptr->info->remote_len = 0;
+    for (i = 0; i < DS_SOCKET_MAX_CANDIDATES; ++i) {
+        ptr->info->candidates [i].len = 0;
+        ptr->info->candidates [i].time = 0;
+        ptr->info->candidates [i].pending = 0;
+        ptr->info->candidates [i].running = 0;
+    }
+
+    /* Close sockets */
+    close_descriptor (ptr->info->sock_in);
+    close_descriptor (ptr->info->sock_out);
+    close_descriptor (ptr->info->sock_in6);
+    close_descriptor (ptr->info->sock_out6);
+
+    /* Reset socket information structure */
+    ptr->info->sock_in = -1;
+    ptr->info->sock_out = -1;
+    ptr->info->sock_in6 = -1;
+    ptr->info->sock_out6 = -1;
+    ptr->info->head = 0;
+    ptr->info->tail = 0;
+
+    /* Reset strings */
+    memset (ptr->info->in_service, 0, sizeof (ptr->info->in_service));
+    memset (ptr->info->out_service, 0, sizeof (ptr->info->out_service));
+}
+
+/**
+ * Applies the (new) ports and options of an open socket structure. Only
+ * the file descriptors whose port changed are re-created, the options are
+ * applied to the existing descriptors and the addresses are looked up
+ * again only if the output port changed.
+ *
+ * \param ptr pointer to a \c DS_Socket structure
+ */
+static void rebind_socket (DS_Socket* ptr)
+{
+    int i;
+    char service [12];
+
+    /* Check arguments */
+    assert (ptr);
+
+    /* Re-create the TCP listener and stream (or the ICMP socket) */
+    if (ptr->type == DS_SOCKET_TCP || ptr->type == DS_SOCKET_ICMP) {
+        close_socket (ptr);
+        open_socket (ptr);
+        return;
+    }
+
+    /* Input port changed, bind a new server socket */
+    SPRINTF_S (service, sizeof (service), "%d", ptr->in_port);
+    if (strcmp (service, ptr->info->in_service) != 0) {
+        close_descriptor (ptr->info->sock_in);
+        close_descriptor (ptr->info->sock_in6);
+        memcpy (ptr->info->in_service, service, sizeof (service));
+        ptr->info->sock_in = create_server_udp (ptr->info->in_service,
+                                               SOCKY_IPv4, 0);
+        ptr->info->sock_in6 = -1;
+        if (ipv6_enabled)
+            ptr->info->sock_in6 = create_server_udp (ptr->info->in_service,
+                                                    SOCKY_IPv6, 0);
+
+#ifndef _WIN32
+        if (ptr->info->sock_in > 0)
+            set_socket_block (ptr->info->sock_in, 0);
+        if (ptr->info->sock_in6 > 0)
+            set_socket_block (ptr->info->sock_in6, 0);
+#endif
+
+        ptr->info->head = 0;
+        ptr->info->tail = 0;
+        ptr->info->server_init = (ptr->info->sock_in > 0 || ptr->info->sock_in6 > 0);
+    }
+
+    /* Apply buffer sizes and QoS options */
+    apply_socket_options (ptr);
+
+    /* Output port changed, resolve the address candidates again */
+    SPRINTF_S (service, sizeof (service), "%d", ptr->out_port);
+    if (strcmp (service, ptr->info->out_service) != 0) {
+        memcpy (ptr->info->out_service, service, sizeof (service));
+
+        ptr->info->active = -1;
+        ptr->info->locked = 0;
+        ptr->info->remote_len = 0;
+        for (i = 0; i < ptr->info->candidate_count; ++i) {
+            ptr->info->candidates [i].len = 0;
+            ptr->info->candidates [i].time = 0;
+            ptr->info->candidates [i].pending = 0;
+            ptr->info->candidates [i].running = 0;
+            lookup_candidate (ptr, i);
+        }
+
+        disconnect_socket (ptr);
+    }
+
+    /* Apply the address (the discovery flag may have changed) */
+    if (ptr->info->active >= 0)
+        connect_socket (ptr);
+}
+
+/**
+ * Performs the pending open/close operations of the registered sockets.
+ * The mutex must be locked by the calling thread.
+ */
+static void process_actions (void)
+{
+    int i = 0;
+    while (i < socket_count) {
+        DS_Socket* ptr = sockets [i];
+
+        /* Close the socket and remove it from the registry */
+        if (actions [i] == ACTION_CLOSE) {
+            close_socket (ptr);
+            unregister_socket (i);
+            continue;
+        }
+
+        /* Open (or re-open) the socket */
+        if (actions [i] == ACTION_OPEN) {
+            if (ptr->info->server_init || ptr->info->client_init)
+                close_socket (ptr);
+
+            open_socket (ptr);
+            actions [i] = ACTION_NONE;
+        }
+
+        /* Apply the new ports and options of the socket */
+        else if (actions [i] == ACTION_REBIND) {
+            actions [i] = ACTION_NONE;
+            rebind_socket (ptr);
+        }
+
+        /* Connect the socket to its (new) cached address */
+        else if (actions [i] == ACTION_CONNECT) {
+            connect_socket (ptr);
+            actions [i] = ACTION_NONE;
+        }
+
+        ++i;
+    }
+
+    DS_CondBroadcast (&done_cond);
+}
+
+/**
+ * Publishes the buffered messages of the TCP sockets (once the application
+ * releases their slots), connects the TCP sockets whose retry time expired
+ * and aborts the connection attempts that timed out. The mutex must be
+ * locked by the calling thread.
+ *
+ * \returns the time (in milliseconds) until the next TCP deadline, or \c -1
+ *          if no TCP socket is waiting to connect
+ */
+static int service_streams (void)
+{
+    int i;
+    int timeout = -1;
+    uint64_t now = DS_GetTimeMs();
+
+    for (i = 0; i < socket_count; ++i) {
+        DS_Socket* ptr = sockets [i];
+        if (ptr->type != DS_SOCKET_TCP || !ptr->info->client_init)
+            continue;
+
+        /* Publish the messages that did not fit in the ring */
+        if (ptr->info->stream_len > 0 && !ring_full (ptr))
+            flush_stream (ptr);
+
+        /* Abort a connection attempt, or connect again */
+        if (ptr->info->deadline > 0 && now >= ptr->info->deadline) {
+            if (ptr->info->connecting)
+                close_stream (ptr, 1);
+            else
+                connect_stream (ptr);
+        }
+
+        /* Wait until the next deadline */
+        if (ptr->info->deadline > now) {
+            int wait = (int) (ptr->info->deadline - now);
+            timeout = (timeout < 0) ? wait : DS_Min (timeout, wait);
+        }
+    }
+
+    return timeout;
+}
+
+/**
+ * Handles the \a events reported by \c poll() for the given descriptor of a
+ * TCP socket: accepts connections on the listener, completes connection
+ * attempts and reads the stream
+ */
+static void handle_stream_events (DS_Socket* ptr, const int sfd,
+                                  const int events)
+{
+    /* Accept a connection */
+    if (sfd == ptr->info->sock_in || sfd == ptr->info->sock_in6) {
+        if (events & POLLIN)
+            accept_stream (ptr, sfd);
+
+        return;
+    }
+
+    /* Descriptor was closed while handling the listener */
+    if (sfd != ptr->info->sock_out)
+        return;
+
+    /* Connection attempt finished */
+    if (ptr->info->connecting) {
+        if (events & (POLLOUT | POLLERR | POLLHUP))
+            finish_connect (ptr);
+    }
+
+    /* Data received (or connection closed) */
+    else if (events & (POLLIN | POLLERR | POLLHUP))
+        read_socket (ptr, sfd);
+}
+
+/**
+ * Returns \c 1 if the calling thread is the reactor thread
+ */
+static int on_reactor (void)
+{
+#if defined _WIN32
+    return GetThreadId (reactor_thread) == GetCurrentThreadId();
+#else
+    return pthread_equal (reactor_thread, pthread_self());
+#endif
+}
+
+/**
+ * Calls the callback of the given watched descriptor (if it is still
+ * watched), the mutex is unlocked while the callback runs. The mutex must be
+ * locked by the calling thread.
+ */
+static void dispatch_watch (const int fd)
+{
+    int i;
+    Watch watch;
+
+    for (i = 0; i < watch_count; ++i) {
+        if (watches [i].fd != fd)
+            continue;
+
+        watch = watches [i];
+        dispatch_fd = fd;
+        DS_MutexUnlock (&mutex);
+        watch.func (fd, watch.data);
+        DS_MutexLock (&mutex);
+        dispatch_fd = -1;
+        DS_CondBroadcast (&watch_cond);
+        return;
+    }
+}
+
+/**
+ * Runs the reactor loop, which waits for any of the registered sockets
+ * to become readable (using a single \c poll() call) and copies the
+ * received data as soon as the operating system reports it.
+ *
+ * All socket descriptors are created and destroyed in this thread, so
+ * they are never closed while the reactor is waiting on them.
+ */
+static void* run_reactor (void* ptr)
+{
+    (void) ptr;
+
+    int i;
+    int count;
+    int timeout;
+    int first_watch;
+    PollFd fds [MAX_POLL_FDS];
+    DS_Socket* owners [MAX_POLL_FDS];
+
+    DS_TRACE_THREAD ("LibDS reactor");
+    DS_MutexLock (&mutex);
+
+    while (running) {
+        /* Open/close sockets */
+        process_actions();
+        timeout = service_streams();
+
+        /* Release the datagrams held back by the simulated network */
+        int release = release_delayed();
+        if (release >= 0)
+            timeout = (timeout < 0) ? release : DS_Min (timeout, release);
+
+        /* Apply the scheduling options requested by the application */
+        if (thread_options_changed) {
+            thread_options_changed = 0;
+            DS_SetThreadRealtime (thread_realtime);
+            DS_SetThreadAffinity (thread_cpu);
+
+            for (i = 0; i < socket_count; ++i) {
+                if (sockets [i]->type != DS_SOCKET_TCP) {
+                    set_socket_busy_poll (sockets [i]->info->sock_in,
+                                          busy_poll_time (sockets [i]));
+                    set_socket_busy_poll (sockets [i]->info->sock_in6,
+                                          busy_poll_time (sockets [i]));
+                }
+            }
+        }
+
+        /* Do not sleep in busy-polling mode */
+        if (busy_polling)
+            timeout = 0;
+
+        /* Register the wakeup socket */
+        count = 0;
+        fds [count].fd = wakeup_fd;
+        fds [count].events = POLLIN;
+        fds [count].revents = 0;
+        owners [count++] = NULL;
+
+        /* Register the server sockets (if they can store more data) */
+        for (i = 0; i < socket_count; ++i) {
+            DS_Socket* sock = sockets [i];
+
+            /* Register the TCP listeners and stream */
+            if (sock->type == DS_SOCKET_TCP) {
+                if (sock->info->sock_in > 0) {
+                    fds [count].fd = sock->info->sock_in;
+                    fds [count].events = POLLIN;
+                    fds [count].revents = 0;
+                    owners [count++] = sock;
+                }
+
+                if (sock->info->sock_in6 > 0) {
+                    fds [count].fd = sock->info->sock_in6;
+                    fds [count].events = POLLIN;
+                    fds [count].revents = 0;
+                    owners [count++] = sock;
+                }
+
+                if (sock->info->sock_out > 0 &&
+                    (sock->info->connecting || !ring_full (sock))) {
+                    fds [count].fd = sock->info->sock_out;
+                    fds [count].events = sock->info->connecting ? POLLOUT : POLLIN;
+                    fds [count].revents = 0;
+                    owners [count++] = sock;
+                }
+            }
+
+            /* Register the ICMP socket */
+            else if (sock->type == DS_SOCKET_ICMP) {
+                if (sock->info->server_init && !ring_full (sock)) {
+                    fds [count].fd = sock->info->sock_out;
+                    fds [count].events = POLLIN;
+                    fds [count].revents = 0;
+                    owners [count++] = sock;
+                }
+            }
+
+            else if (sock->info->server_init && !ring_full (sock)) {
+                if (sock->info->sock_in > 0) {
+                    fds [count].fd = sock->info->sock_in;
+                    fds [count].events = POLLIN;
+                    fds [count].revents = 0;
+                    owners [count++] = sock;
+                }
+
+                if (sock->info->sock_in6 > 0) {
+                    fds [count].fd = sock->info->sock_in6;
+                    fds [count].events = POLLIN;
+                    fds [count].revents = 0;
+                    owners [count++] = sock;
+                }
+            }
+        }
+
+        /* Register the watched descriptors */
+        first_watch = count;
+        for (i = 0; i < watch_count; ++i) {
+            fds [count].fd = watches [i].fd;
+            fds [count].events = POLLIN;
+            fds [count].revents = 0;
+            owners [count++] = NULL;
+        }
+
+        /* Wait for incoming data, a wakeup request or a deadline */
+        DS_MutexUnlock (&mutex);
+        int rc = POLL (fds, count, timeout);
+        DS_MutexLock (&mutex);
+
+        if (rc <= 0) {
+            if (busy_polling)
+                DS_CpuRelax();
+
+            continue;
+        }
+
+        /* Clear wakeup request */
+        if (fds [0].revents & POLLIN)
+            clear_wakeup();
+
+        /* Read received data (sockets can only be closed by this thread) */
+        DS_TRACE_BEGIN ("reactor read");
+        for (i = 1; i < first_watch; ++i) {
+            if (owners [i]->type == DS_SOCKET_TCP)
+                handle_stream_events (owners [i], fds [i].fd, fds [i].revents);
+            else if (fds [i].revents & POLLIN)
+                read_socket (owners [i], fds [i].fd);
+        }
+        DS_TRACE_END ("reactor read");
+
+        /* Call the callbacks of the watched descriptors */
+        for (i = first_watch; i < count; ++i) {
+            if (fds [i].revents)
+                dispatch_watch (fds [i].fd);
+        }
+    }
+
+    /* Close all registered sockets */
+    for (i = 0; i < socket_count; ++i)
+        close_socket (sockets [i]);
+
+    socket_count = 0;
+    DS_CondBroadcast (&done_cond);
+    DS_MutexUnlock (&mutex);
+
+    return NULL;
+}
+
+/**
+ * Returns the first registered socket that has an address candidate that
+ * needs a lookup (and writes the candidate index to \a index), or \c NULL
+ * if there is none. The mutex must be locked by the calling thread.
+ */
+static DS_Socket* next_lookup (int* index)
+{
+    int i, j;
+    for (i = 0; i < socket_count; ++i) {
+        for (j = 0; j < sockets [i]->info->candidate_count; ++j) {
+            DS_SocketCandidate* candidate = &sockets [i]->info->candidates [j];
+            if (candidate->pending && !candidate->running) {
+                *index = j;
+                return sockets [i];
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Runs a resolver loop, which looks up the address candidates requested by
+ * the sockets. Several resolvers run at the same time, so all candidates of
+ * a socket are looked up in parallel and the socket uses the first address
+ * that is resolved (until a candidate with a higher priority is resolved).
+ */
+static void* run_resolver (void* ptr)
+{
+    (void) ptr;
+
+    int index;
+    char service [12];
+    char host [DS_SOCKET_HOST_SIZE];
+    char addr [DS_SOCKET_ADDR_SIZE];
+
+    DS_MutexLock (&mutex);
+
+    while (running) {
+        /* Wait for a lookup request */
+        DS_Socket* sock = next_lookup (&index);
+        if (!sock) {
+            DS_CondWait (&lookup_cond, &mutex);
+            continue;
+        }
+
+        /* Copy the host, it may change during the lookup */
+        DS_SocketInfo* info = sock->info;
+        DS_SocketCandidate* candidate = &info->candidates [index];
+        memcpy (host, candidate->host, sizeof (host));
+        memcpy (service, sock->info->out_service, sizeof (service));
+        candidate->pending = 0;
+        candidate->running = 1;
+
+        /* Look up the address without blocking the other threads */
+        DS_MutexUnlock (&mutex);
+        int len = resolve_address (host, service, 0, addr, sizeof (addr));
+        DS_MutexLock (&mutex);
+
+        /* Socket was closed or re-configured during the lookup */
+        if (find_socket (sock) < 0 || sock->info != info ||
+            !candidate->running ||
+            strcmp (host, candidate->host) != 0 ||
+            strcmp (service, sock->info->out_service) != 0)
+            continue;
+
+        /* Cache the address (if the lookup fails, keep the last address) */
+        candidate->running = 0;
+        candidate->time = DS_GetTimeMs();
+        if (len > 0) {
+            memcpy (candidate->addr, addr, len);
+            candidate->len = len;
+            commit_candidate (sock, index);
+        }
+    }
+
+    /* Tell Sockets_Close() that this thread exited */
+    --resolver_count;
+    DS_CondBroadcast (&resolver_cond);
+    DS_MutexUnlock (&mutex);
+    return NULL;
+}
+
+/**
+ * Writes the given bytes to a TCP stream, waiting up to \c TCP_SEND_TIMEOUT
+ * milliseconds whenever the send buffer of the stream is full
+ *
+ * \returns \c 0 on success, \c -1 on failure
+ */
+static int send_all (const int sfd, const char* buf, int len)
+{
+    while (len > 0) {
+        int sent = send (sfd, buf, len, SEND_FLAGS);
+        if (sent > 0) {
+            buf += sent;
+            len -= sent;
+            continue;
+        }
+
+        /* Wait for the stream to become writable */
+        if (sent < 0 && socket_would_block()) {
+            PollFd pfd;
+            pfd.fd = sfd;
+            pfd.events = POLLOUT;
+            pfd.revents = 0;
+
+            if (POLL (&pfd, 1, TCP_SEND_TIMEOUT) > 0)
+                continue;
+        }
+
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Sends the given \a data as a length-prefixed message through the TCP
+ * stream of the given socket. If the message cannot be sent completely, the
+ * stream is shut down (the remote host would lose track of the message
+ * boundaries) and the reactor connects again.
+ *
+ * \returns number of bytes written on success, -1 on failure
+ */
+static int send_message (DS_Socket* ptr, const char* data, const int len)
+{
+    /* Get the stream (the reactor may be connecting it) */
+    DS_MutexLock (&mutex);
+    refresh_address (ptr);
+    int sfd = ptr->info->connected ? ptr->info->sock_out : -1;
+    DS_MutexUnlock (&mutex);
+
+    /* Stream is not connected, or message cannot be prefixed */
+    if (sfd <= 0 || len > 0xFFFF)
+        return -1;
+
+    /* Prefix the message, small messages are sent with a single call */
+    int error = 0;
+    char frame [DS_SOCKET_SLOT_SIZE + 2];
+    frame [0] = (char) ((len >> 8) & 0xFF);
+    frame [1] = (char) (len & 0xFF);
+    if (len <= DS_SOCKET_SLOT_SIZE) {
+        memcpy (frame + 2, data, len);
+        error = send_all (sfd, frame, len + 2);
+    }
+
+    else {
+        error = send_all (sfd, frame, 2);
+        if (!error)
+            error = send_all (sfd, data, len);
+    }
+
+    /* Drop the connection */
+    if (error) {
+        shutdown (sfd, SHUTDOWN_BOTH);
+        return -1;
+    }
+
+    return len;
+}
+
+/**
+ * Returns an empty socket for safe initialization, the socket is returned
+ * by value and has no runtime state until it is used, so it does not need
+ * to be de-allocated
+ */
+DS_Socket DS_SocketEmpty (void)
+{
+    /* Initialize a new socket */
+    DS_Socket socket;
+    memset (&socket, 0, sizeof (DS_Socket));
+
+    /* Fill basic data */
+    socket.in_port = 0;
+    socket.out_port = 0;
+    socket.disabled = 0;
+    socket.broadcast = 0;
+    socket.type = DS_SOCKET_UDP;
+
+    /* Use the system defaults for buffers and QoS */
+    socket.recv_buffer = 0;
+    socket.send_buffer = 0;
+    socket.busy_poll = 0;
+    socket.dscp = DS_DSCP_DEFAULT;
+
+    /* Only the address is used until fallback addresses are set */
+    socket.discovery = 0;
+
+    /* The runtime state is allocated by the sockets module */
+    socket.info = NULL;
+    memset (socket.address, 0, sizeof (socket.address));
+
+    /* Return the socket data */
+    return socket;
+}
+
+/**
+ * Initializes the sockets module and starts the reactor thread
+ */
+void Sockets_Init (void)
+{
+    sockets_init (1);
+
+    /* Check if the system supports IPv6 */
+    int sfd = create_client_udp (SOCKY_IPv6, 0);
+    ipv6_enabled = (sfd > 0);
+    socket_close (sfd);
+
+    /* Create the wakeup descriptors */
+    socket_count = 0;
+    int created = create_wakeup();
+    assert (created);
+    (void) created;
+
+    /* Start the reactor thread */
+    running = 1;
+    int error = DS_CreateThread (&reactor_thread, "DS Sockets",
+                                 &run_reactor, NULL);
+
+    /* Warn the user when the reactor cannot start */
+    if (error) {
+        DS_String caption = DS_StrNew ("LibDS");
+        DS_String message = DS_StrNew ("Cannot start socket thread!");
+        DS_ShowMessageBox (&caption, &message, DS_ICON_ERROR);
+        DS_StrRmBuf (&caption);
+        DS_StrRmBuf (&message);
+    }
+
+    /* Quit if reactor cannot start */
+    assert (!error);
+
+    /* Start the resolver threads (detached, see Sockets_Close()) */
+    int i;
+    for (i = 0; i < RESOLVER_THREADS && !error; ++i) {
+        DS_Thread thread;
+        error = DS_CreateThread (&thread, "DS Resolver",
+                                 &run_resolver, NULL);
+
+        if (!error) {
+            DS_DetachThread (thread);
+
+            DS_MutexLock (&mutex);
+            ++resolver_count;
+            DS_MutexUnlock (&mutex);
+        }
+    }
+
+    /* Warn the user when the resolvers cannot start */
+    if (error) {
+        DS_String caption = DS_StrNew ("LibDS");
+        DS_String message = DS_StrNew ("Cannot start address resolver thread!");
+        DS_ShowMessageBox (&caption, &message, DS_ICON_ERROR);
+        DS_StrRmBuf (&caption);
+        DS_StrRmBuf (&message);
+    }
+
+    /* Quit if resolvers cannot start */
+    assert (!error);
+}
+
+/**
+ * Stops the reactor thread and closes all socket structures
+ *
+ * The resolver threads are given \c RESOLVER_EXIT_TIMEOUT milliseconds to
+ * exit, a resolver that is waiting for a slow lookup is not joined, it exits
+ * (without touching any socket) as soon as its lookup returns.
+ */
+void Sockets_Close (void)
+{
+    /* Stop the reactor thread */
+    DS_MutexLock (&mutex);
+    running = 0;
+    wake_reactor();
+    DS_CondBroadcast (&lookup_cond);
+    DS_MutexUnlock (&mutex);
+    DS_JoinThread (reactor_thread);
+
+    /* Wait for the idle resolver threads to exit */
+    DS_MutexLock (&mutex);
+    uint64_t deadline = DS_GetTimeMs() + RESOLVER_EXIT_TIMEOUT;
+    while (resolver_count > 0) {
+        uint64_t now = DS_GetTimeMs();
+        if (now >= deadline)
+            break;
+
+        DS_TimedWait (&resolver_cond, &mutex, (int) (deadline - now));
+    }
+    DS_MutexUnlock (&mutex);
+
+    /* Close the wakeup descriptors */
+    close_wakeup();
+
+    /* Free the datagrams held back by the simulated network */
+    delayed_count = 0;
+    DS_FREE (delayed);
+
+    sockets_exit();
+}
+
 /**
- * Copies the received data from the socket in its data buffer
+ * Registers the given socket with the reactor thread, which will open it
+ * (or re-open it if it was already open).
+ *
+ * \note The socket is initialized by the reactor thread to avoid blocking
+ *       the main thread of the application
  */
-static void read_socket (DS_Socket* ptr)
+void DS_SocketOpen (DS_Socket* ptr)
 {
     /* Check arguments */
     assert (ptr);
 
-    /* Initialize temporary buffer */
-    int read = -1;
-    char data [4096] = {0};
+    /* Socket is disabled */
+    if (ptr->disabled)
+        return;
 
-    /* Read TCP socket */
-    if (ptr->type == DS_SOCKET_TCP)
-        read = recv (ptr->info.sock_in, data, sizeof (data), 0);
+    DS_MutexLock (&mutex);
+
+    /* Reactor is not running, or the socket state cannot be allocated */
+    if (!running || !socket_info (ptr)) {
+        DS_MutexUnlock (&mutex);
+        return;
+    }
 
-    /* Read UDP socket */
-    if (ptr->type == DS_SOCKET_UDP) {
-        read = udp_recvfrom (ptr->info.sock_in, data, sizeof (data),
-                             ptr->address, ptr->info.in_service, 0);
+    /* Register the socket */
+    int index = find_socket (ptr);
+    if (index < 0) {
+        assert (socket_count < MAX_SOCKETS);
+        index = socket_count++;
+        sockets [index] = ptr;
     }
 
-    /* We received some data, copy it to socket's buffer */
-    if (read > 0) {
-        ptr->info.buffer_size = read;
-        memset (ptr->info.buffer, 0, ptr->info.buffer_size);
+    /* Ask the reactor to open it */
+    actions [index] = ACTION_OPEN;
+    wake_reactor();
 
-        int i;
-        for (i = 0; i < read; ++i)
-            ptr->info.buffer [i] = data [i];
-    }
+    DS_MutexUnlock (&mutex);
 }
 
 /**
- * Runs the server socket loop, which uses the \c select() function
- * to copy received data into the socket's buffer only when the
- * operating system detects that the socket received some data.
+ * Closes the socket file descriptors of the given socket structure
+ * and de-allocates its runtime state (including the fallback addresses and
+ * the simulated network conditions).
  *
- * \param ptr a pointer to a \c DS_Socket structure
+ * This function blocks until the reactor thread has closed the socket.
+ *
+ * \param ptr pointer to the \c DS_Socket to close
  */
-static void server_loop (DS_Socket* ptr)
+void DS_SocketClose (DS_Socket* ptr)
 {
     /* Check arguments */
     assert (ptr);
 
-    /* Initialize variables for select */
-    int rc, fd;
-    fd_set set;
-    struct timeval tv;
+    DS_MutexLock (&mutex);
 
-    /* Disable socket blocking */
-#ifndef _WIN32
-    set_socket_block (ptr->info.sock_in, 0);
-#endif
+    /* Ask the reactor to close the socket and wait for it */
+    int index = find_socket (ptr);
+    if (index >= 0 && running) {
+        actions [index] = ACTION_CLOSE;
+        wake_reactor();
 
-    /* Run the server while the socket is valid */
-    while (ptr->info.server_init && ptr->info.sock_in > 0) {
-        tv.tv_sec = 0;
-        tv.tv_usec = 5000 * 100;
+        while (running && find_socket (ptr) >= 0)
+            DS_CondWait (&done_cond, &mutex);
+    }
 
-        FD_ZERO (&set);
-        FD_SET (ptr->info.sock_in, &set);
+    /* Socket is not managed by the reactor (anymore), close it directly */
+    index = find_socket (ptr);
+    if (index >= 0)
+        unregister_socket (index);
+    if (ptr->info)
+        close_socket (ptr);
 
-#if defined _WIN32
-        fd = 0;
-#else
-        fd = ptr->info.sock_in + 1;
-#endif
+    /* Release the runtime state */
+    DS_FREE (ptr->info);
 
-        rc = select (fd, &set, NULL, NULL, &tv);
-        if (rc > 0 && FD_ISSET (ptr->info.sock_in, &set))
-            read_socket (ptr);
-    }
+    DS_MutexUnlock (&mutex);
 }
 
 /**
- * Initializes the given socket structure
+ * Applies the ports and options of the \a config socket to the given socket
+ * without closing it. Only the file descriptors whose port changed are
+ * re-created, and the address (along with the fallback addresses and the
+ * cached lookups) of the socket is kept, unless \a config has an address.
+ *
+ * If the socket is not open, or its type changes, the socket is re-opened
+ * with the given configuration instead.
  *
- * \param data raw pointer to a \c DS_Socket structure
+ * This function blocks until the reactor thread has applied the changes.
+ *
+ * \param ptr pointer to the \c DS_Socket to reconfigure
+ * \param config the socket structure with the new configuration
  */
-static void* create_socket (void* data)
+void DS_SocketReconfigure (DS_Socket* ptr, const DS_Socket* config)
 {
     /* Check arguments */
-    assert (data);
-    DS_Socket* ptr = (DS_Socket*) data;
+    assert (ptr);
+    assert (config);
 
-    /* Ensure that buffer and service strings are set to 0 */
-    memset (ptr->info.buffer, 0, sizeof (ptr->info.buffer));
-    memset (ptr->info.in_service, 0, sizeof (ptr->info.in_service));
-    memset (ptr->info.out_service, 0, sizeof (ptr->info.out_service));
+    DS_MutexLock (&mutex);
 
-    /* Set service strings */
-    int len = sizeof (ptr->info.in_service);
-    SPRINTF_S (ptr->info.in_service, len, "%d", ptr->in_port);
-    SPRINTF_S (ptr->info.out_service, len, "%d", ptr->out_port);
+    /* Socket cannot be changed in place, close it and open it again */
+    int index = find_socket (ptr);
+    if (index < 0 || !running || config->disabled ||
+            config->type != ptr->type) {
+        DS_MutexUnlock (&mutex);
 
-    /* Open TCP socket */
-    if (ptr->type == DS_SOCKET_TCP) {
-        ptr->info.sock_in = create_server_tcp (ptr->info.in_service, SOCKY_IPv4, 0);
-        ptr->info.sock_out = create_client_tcp (ptr->address, ptr->info.out_service, SOCKY_IPv4, 0);
-    }
+        /* Copies of a socket do not share its runtime state */
+        DS_SocketClose (ptr);
+        *ptr = *config;
+        ptr->info = NULL;
+        DS_SocketOpen (ptr);
 
-    /* Open UDP socket */
-    else if (ptr->type == DS_SOCKET_UDP) {
-        ptr->info.sock_out = create_client_udp (SOCKY_IPv4, 0);
-        ptr->info.sock_in = create_server_udp (ptr->info.in_service, SOCKY_IPv4, 0);
+        return;
     }
 
-    /* Update initialized states */
-    ptr->info.server_init = (ptr->info.sock_in > 0);
-    ptr->info.client_init = (ptr->info.sock_out > 0);
+    /* Copy the public settings (the reactor may be using the socket) */
+    ptr->in_port = config->in_port;
+    ptr->out_port = config->out_port;
+    ptr->disabled = config->disabled;
+    ptr->broadcast = config->broadcast;
+    ptr->discovery = config->discovery;
+    ptr->recv_buffer = config->recv_buffer;
+    ptr->send_buffer = config->send_buffer;
+    ptr->dscp = config->dscp;
+    ptr->busy_poll = config->busy_poll;
 
-    /* Start server loop */
-    server_loop (ptr);
+    /* Ask the reactor to apply them (pending opens use them anyway) */
+    if (actions [index] != ACTION_OPEN)
+        actions [index] = ACTION_REBIND;
 
-    /* Exit */
-    return NULL;
+    wake_reactor();
+
+    while (running && (index = find_socket (ptr)) >= 0 &&
+            actions [index] == ACTION_REBIND)
+        DS_CondWait (&done_cond, &mutex);
+
+    DS_MutexUnlock (&mutex);
+
+    /* Apply the new address */
+    if (strlen (config->address) > 0)
+        DS_SocketChangeAddress (ptr, config->address);
 }
 
 /**
- * Returns an empty socket for safe initialization
+ * Obtains a view of the oldest datagram received by the given socket,
+ * without copying it. The \a view remains valid until the datagram is
+ * released with \c DS_SocketRelease(), and must not be freed.
+ *
+ * \note Only one thread may read from a given socket
+ *
+ * \param ptr pointer to a \c DS_Socket structure
+ * \param view the string in which to store the datagram location and size
+ *
+ * \returns \c 1 if there is a datagram available, \c 0 otherwise
  */
-DS_Socket* DS_SocketEmpty (void)
+int DS_SocketPeek (DS_Socket* ptr, DS_String* view)
 {
-    /* Initialize a new socket */
-    DS_Socket* socket = (DS_Socket*) calloc (1, sizeof (DS_Socket));
+    /* Check arguments */
+    assert (ptr);
+    assert (view);
 
-    /* Fill basic data */
-    socket->in_port = 0;
-    socket->out_port = 0;
-    socket->disabled = 0;
-    socket->broadcast = 0;
-    socket->type = DS_SOCKET_UDP;
-
-    /* Fill socket info structure */
-    socket->info.sock_in = 0;
-    socket->info.sock_out = 0;
-    socket->info.buffer_size = 0;
-    socket->info.server_init = 0;
-    socket->info.client_init = 0;
-
-    /* Fill strings with 0 */
-    memset (socket->address, 0, sizeof (socket->address));
-    memset (socket->info.buffer, 0, sizeof (socket->info.buffer));
-    memset (socket->info.in_service, 0, sizeof (socket->info.in_service));
-    memset (socket->info.out_service, 0, sizeof (socket->info.out_service));
+    /* Reset the view */
+    view->buf = NULL;
+    view->len = 0;
+    view->cap = 0;
 
-    /* Return the socket data */
-    return socket;
+    /* Socket is disabled or uninitialized */
+    if (!ptr->info || (ptr->info->server_init == 0) || (ptr->disabled == 1))
+        return 0;
+
+    /* No datagrams available */
+    size_t tail = ptr->info->tail;
+    if (DS_AtomicLoad (&ptr->info->head) == tail)
+        return 0;
+
+    /* Point to the datagram */
+    DS_Datagram* slot = &ptr->info->ring [tail % DS_SOCKET_SLOTS];
+    view->buf = slot->data;
+    view->len = slot->len;
+    return 1;
 }
 
 /**
- * Initializes the sockets module and its event system
+ * Returns the time (in usecs, see \c DS_GetTimeUs()) in which the datagram
+ * obtained with \c DS_SocketPeek() was received. Where supported, this is
+ * the arrival time stamped by the kernel, so it does not include the time
+ * that the datagram waited to be read.
+ *
+ * \returns the receive time, or \c 0 if there is no datagram available
  */
-void Sockets_Init (void)
+uint64_t DS_SocketPeekTime (DS_Socket* ptr)
 {
-    sockets_init (1);
+    /* Check arguments */
+    assert (ptr);
+
+    if (!ptr->info)
+        return 0;
+
+    size_t tail = ptr->info->tail;
+    if (DS_AtomicLoad (&ptr->info->head) == tail)
+        return 0;
+
+    return ptr->info->ring [tail % DS_SOCKET_SLOTS].time;
 }
 
 /**
- * Stops the event loops and closes all socket structures
+ * Releases the datagram obtained with \c DS_SocketPeek(), so that its slot
+ * can be used to store new data
+ *
+ * \param ptr pointer to a \c DS_Socket structure
  */
-void Sockets_Close (void)
+void DS_SocketRelease (DS_Socket* ptr)
 {
-    sockets_exit();
+    /* Check arguments */
+    assert (ptr);
+
+    /* Nothing to release */
+    if (!ptr->info)
+        return;
+
+    size_t tail = ptr->info->tail;
+    if (DS_AtomicLoad (&ptr->info->head) == tail)
+        return;
+
+    /* Free the slot and let the reactor resume reading if ring was full */
+    int was_full = ring_full (ptr);
+    DS_AtomicStore (&ptr->info->tail, tail + 1);
+
+    if (was_full)
+        wake_reactor();
 }
 
 /**
- * Initializes and configures the given socket
+ * Returns a copy of the oldest datagram received by the given socket
  *
- * \note The socket will be initialzed in another thread to avoid blocking
- *       the main thread of the application
+ * If no datagram is available, the returned string is empty and has no
+ * buffer, so that polling an idle socket does not allocate any memory.
+ * Use \c DS_SocketPeek() and \c DS_SocketRelease() to read the datagrams
+ * without copying them.
+ *
+ * \param ptr pointer to a \c DS_Socket structure
  */
-void DS_SocketOpen (DS_Socket* ptr)
+DS_String DS_SocketRead (DS_Socket* ptr)
 {
     /* Check arguments */
     assert (ptr);
 
-    /* Socket is disabled */
-    if (ptr->disabled)
-        return;
-
-    /* Initialize the socket in another thread */
-    pthread_t thread;
-    int error = pthread_create (&thread, NULL,
-                                &create_socket, (void*) ptr);
+    /* Get the datagram (the view is empty if there is none) */
+    DS_String view;
+    if (!DS_SocketPeek (ptr, &view))
+        return view;
 
-    /* Warn the user when the socket cannot start */
-    if (error) {
-        DS_String caption = DS_StrNew ("LibDS");
-        DS_String message = DS_StrNew ("Cannot start socket thread!");
-        DS_ShowMessageBox (&caption, &message, DS_ICON_ERROR);
-        DS_StrRmBuf (&caption);
-        DS_StrRmBuf (&message);
-    }
+    /* Copy the datagram into a new string */
+    DS_String buffer = DS_StrNewLen (view.len);
+    memcpy (buffer.buf, view.buf, view.len);
 
-    /* Quit if socket cannot start */
-    assert (!error);
+    /* Free the slot */
+    DS_SocketRelease (ptr);
+    return buffer;
 }
 
 /**
- * Closes the socket file descriptors of the given socket structure
- * and resets the structure's information.
+ * Returns \c 1 if the output socket of the given socket is connected to its
+ * remote host (for TCP sockets, if the stream is established)
  *
- * \param ptr pointer to the \c DS_Socket to close
+ * \param ptr pointer to a \c DS_Socket structure
  */
-void DS_SocketClose (DS_Socket* ptr)
+int DS_SocketConnected (DS_Socket* ptr)
 {
     /* Check arguments */
     assert (ptr);
 
-    /* Reset socket properties */
-    ptr->info.server_init = 0;
-    ptr->info.client_init = 0;
+    DS_MutexLock (&mutex);
+    int connected = ptr->info ? ptr->info->connected : 0;
+    DS_MutexUnlock (&mutex);
 
-    /* Close sockets */
-#if defined (__ANDROID__)
-    socket_close_threaded (ptr->info.sock_in);
-    socket_close_threaded (ptr->info.sock_out);
-#else
-    socket_close (ptr->info.sock_in);
-    socket_close (ptr->info.sock_out);
-#endif
+    return connected && !ptr->disabled;
+}
 
-    /* Reset socket information structure */
-    ptr->info.sock_in = -1;
-    ptr->info.sock_out = -1;
-    ptr->info.buffer_size = 0;
+/**
+ * Obtains the number of bytes that the given socket has \a sent and
+ * \a received since it was opened (both are \c 0 if it is closed)
+ *
+ * \param ptr pointer to a \c DS_Socket structure
+ * \param sent the variable in which to store the number of sent bytes
+ * \param received the variable in which to store the received bytes
+ */
+void DS_SocketTraffic (DS_Socket* ptr, uint64_t* sent, uint64_t* received)
+{
+    /* Check arguments */
+    assert (ptr);
+    assert (sent);
+    assert (received);
 
-    /* Reset strings */
-    memset (ptr->info.buffer, 0, sizeof (ptr->info.buffer));
-    memset (ptr->info.in_service, 0, sizeof (ptr->info.in_service));
-    memset (ptr->info.out_service, 0, sizeof (ptr->info.out_service));
+    DS_MutexLock (&mutex);
+    *sent = ptr->info ? DS_AtomicLoad64 (&ptr->info->sent_bytes) : 0;
+    *received = ptr->info ? DS_AtomicLoad64 (&ptr->info->recv_bytes) : 0;
+    DS_MutexUnlock (&mutex);
 }
 
 /**
- * Returns any data received by the given socket
+ * Returns the numeric IP address of the remote host that the given socket
+ * is using (e.g. the address of the probed candidate that replied), or an
+ * empty string if no address is in use
  *
  * \param ptr pointer to a \c DS_Socket structure
  */
-DS_String DS_SocketRead (DS_Socket* ptr)
+DS_String DS_SocketRemoteHost (DS_Socket* ptr)
 {
+    char host [DS_SOCKET_HOST_SIZE] = {0};
+
     /* Check arguments */
     assert (ptr);
 
-    /* Socket is disabled or uninitialized */
-    if ((ptr->info.server_init == 0) || (ptr->disabled == 1))
-        return DS_StrNewLen (0);
+    DS_MutexLock (&mutex);
+    if (ptr->info && ptr->info->active >= 0 && ptr->info->remote_len > 0) {
+        if (getnameinfo ((struct sockaddr*) ptr->info->remote,
+                         (socklen_t) ptr->info->remote_len,
+                         host, sizeof (host), NULL, 0, NI_NUMERICHOST) != 0)
+            host [0] = '\0';
+    }
+    DS_MutexUnlock (&mutex);
 
-    /* Copy the current buffer and clear it */
-    if (ptr->info.buffer_size > 0) {
-        DS_String buffer = DS_StrNewLen (ptr->info.buffer_size);
+    return DS_StrNew (host);
+}
 
-        /* Copy buffer to string */
-        int i;
-        for (i = 0; i < (int) ptr->info.buffer_size; ++i)
-            DS_StrSetChar (&buffer, i, ptr->info.buffer [i]);
+/**
+ * Asks the reactor thread to call \a func (with the given \a data) when the
+ * given descriptor \a fd can be read, or when it is closed or fails. If the
+ * descriptor is already watched, its callback is replaced.
+ *
+ * The callback runs in the reactor thread, so it must not block (the
+ * descriptor should be non-blocking). On Windows, only sockets can be
+ * watched.
+ *
+ * \returns \c 1 on success, \c 0 if too many descriptors are watched
+ */
+int DS_SocketWatch (const int fd, DS_WatchFunc func, void* data)
+{
+    int i;
+    int watched = 0;
+
+    assert (fd >= 0);
+    assert (func);
+
+    DS_MutexLock (&mutex);
+    for (i = 0; i < watch_count && !watched; ++i) {
+        if (watches [i].fd == fd) {
+            watches [i].func = func;
+            watches [i].data = data;
+            watched = 1;
+        }
+    }
+
+    if (!watched && watch_count < MAX_WATCHES) {
+        watches [watch_count].fd = fd;
+        watches [watch_count].func = func;
+        watches [watch_count].data = data;
+        ++watch_count;
+        watched = 1;
+    }
+
+    if (watched)
+        wake_reactor();
+    DS_MutexUnlock (&mutex);
 
-        /* Clear buffer info */
-        memset (ptr->info.buffer, 0, ptr->info.buffer_size);
-        ptr->info.buffer_size = 0;
+    return watched;
+}
+
+/**
+ * Stops watching the given descriptor \a fd. Its callback is not called
+ * after this function returns (if the callback is running in another thread,
+ * this function waits for it), so the descriptor can be closed right away.
+ */
+void DS_SocketUnwatch (const int fd)
+{
+    int i;
 
-        /* Return copied buffer */
-        return buffer;
+    DS_MutexLock (&mutex);
+    for (i = 0; i < watch_count; ++i) {
+        if (watches [i].fd == fd) {
+            watches [i] = watches [--watch_count];
+            break;
+        }
     }
 
-    return DS_StrNewLen (0);
+    while (dispatch_fd == fd && !on_reactor())
+        DS_CondWait (&watch_cond, &mutex);
+
+    wake_reactor();
+    DS_MutexUnlock (&mutex);
+}
+
+/**
+ * Wakes up the threads that are waiting in \c DS_SocketWaitForData(), e.g.
+ * when a protocol event loop has to send a packet before its next deadline
+ */
+void DS_SocketWakeUp (void)
+{
+    notify_data();
 }
 
+/**
+ * Blocks the calling thread until any socket receives data or until the
+ * given number of \a millisecs have passed.
+ *
+ * The \a generation holds the last notification seen by the caller (it
+ * should be set to \c 0 before the first call), the function returns
+ * immediately if another notification was posted since then.
+ *
+ * \returns \c 1 if any socket received data, \c 0 on timeout
+ */
+int DS_SocketWaitForData (const int millisecs, size_t* generation)
+{
+    assert (generation);
+
+    DS_MutexLock (&data_mutex);
+
+    if (*generation == data_generation && millisecs > 0)
+        DS_TimedWait (&data_cond, &data_mutex, millisecs);
+
+    int pending = (*generation != data_generation);
+    *generation = data_generation;
+
+    DS_MutexUnlock (&data_mutex);
+    return pending;
+}
 
 /**
  * Sends the given \a data using the given socket
@@ -311,46 +2811,145 @@ DS_String DS_SocketRead (DS_Socket* ptr)
  * \param data the data buffer to send
  * \param ptr pointer to the socket to use to send the given \a data
  *
+ * UDP datagrams are sent through the connected output socket, so that the
+ * address is never resolved in the calling thread. If the address is not
+ * resolved yet, the datagram is discarded. While the socket probes its
+ * address candidates, the datagram is sent to each resolved candidate.
+ *
+ * TCP sockets send the data as a single message, which is discarded while
+ * the stream is not connected.
+ *
  * \returns number of bytes written on success, -1 on failure
  */
-int DS_SocketSend (const DS_Socket* ptr, const DS_String* data)
+int DS_SocketSend (DS_Socket* ptr, const DS_String* data)
 {
     /* Check arguments */
     assert (ptr);
     assert (data);
 
     /* Socket is disabled or uninitialized */
-    if ((ptr->info.client_init == 0) || ptr->disabled)
+    if (!ptr->info || (ptr->info->client_init == 0) || ptr->disabled)
         return -1;
 
     /* Data is empty */
     if (DS_StrEmpty (data))
         return 0;
 
-    /* Initialize variables*/
+    /* Initialize variables (send directly from the string buffer) */
     int bytes_written = 0;
+    int wire_bytes = 0;
+    DS_TRACE_BEGIN ("DS_SocketSend");
     int len = DS_StrLen (data);
-    char* bytes = DS_StrToChar (data);
+    const char* bytes = data->buf;
 
-    /* Send data using TCP */
+    /* Send a message using TCP */
     if (ptr->type == DS_SOCKET_TCP)
-        bytes_written = send (ptr->info.sock_out, bytes, len, 0);
+        wire_bytes = bytes_written = send_message (ptr, bytes, len);
 
-    /* Send data using UDP */
-    else if (ptr->type == DS_SOCKET_UDP) {
-        bytes_written = udp_sendto (ptr->info.sock_out, bytes, len,
-                                    ptr->address, ptr->info.out_service, 0);
+    /* Send data using UDP (or send an ICMP message) */
+    else {
+        int i;
+        int count = 0;
+        int lens [DS_SOCKET_MAX_CANDIDATES];
+        struct sockaddr_storage targets [DS_SOCKET_MAX_CANDIDATES];
+
+        int count4 = 0;
+        int families [2] = { AF_INET, AF_INET6 };
+
+        DS_MutexLock (&mutex);
+        refresh_address (ptr);
+        int connected = ptr->info->connected;
+        int sfd = output_socket (ptr, address_family (ptr->info->remote));
+
+        /* Let the reactor send the datagram through the simulated network */
+        int held = connected && impaired (ptr);
+        if (held) {
+            impair_datagram (ptr, 1, bytes, len);
+            wake_reactor();
+        }
+
+        /* Get the addresses to probe (IPv4 addresses first) */
+        if (!connected && probing (ptr)) {
+            int f;
+            for (f = 0; f < 2; ++f) {
+                for (i = 0; i < ptr->info->candidate_count; ++i) {
+                    DS_SocketCandidate* candidate = &ptr->info->candidates [i];
+                    if (candidate->len > 0 &&
+                        address_family (candidate->addr) == families [f]) {
+                        memset (&targets [count], 0, sizeof (targets [count]));
+                        memcpy (&targets [count], candidate->addr, candidate->len);
+                        lens [count++] = candidate->len;
+                    }
+                }
+
+                if (f == 0)
+                    count4 = count;
+            }
+        }
+
+        DS_MutexUnlock (&mutex);
+
+        /* Datagram is (or was dropped) by the simulated network */
+        if (held)
+            wire_bytes = bytes_written = len;
+
+        /* Send to the connected address */
+        else if (connected)
+            wire_bytes = bytes_written = send (sfd, bytes, len, 0);
+
+        /* Send to every candidate (with a single call per family if possible) */
+        else if (count > 0) {
+            socky_datagram datagrams [DS_SOCKET_MAX_CANDIDATES];
+            for (i = 0; i < count; ++i) {
+                datagrams [i].buf = (char*) bytes;
+                datagrams [i].len = len;
+                datagrams [i].result = -1;
+                datagrams [i].addr = (struct sockaddr*) &targets [i];
+                datagrams [i].addr_len = lens [i];
+            }
+
+            bytes_written = -1;
+            int sent = 0;
+            if (count4 > 0)
+                sent = udp_send_batch (ptr->info->sock_out, datagrams, count4, 0);
+            for (i = 0; i < sent; ++i) {
+                bytes_written = DS_Max (bytes_written, datagrams [i].result);
+                wire_bytes += DS_Max (datagrams [i].result, 0);
+            }
+
+            sent = 0;
+            if (count > count4 && ptr->info->sock_out6 > 0)
+                sent = udp_send_batch (ptr->info->sock_out6, datagrams + count4,
+                                       count - count4, 0);
+            for (i = 0; i < sent; ++i) {
+                bytes_written = DS_Max (bytes_written,
+                                        datagrams [count4 + i].result);
+                wire_bytes += DS_Max (datagrams [count4 + i].result, 0);
+            }
+        }
+
+        else
+            bytes_written = -1;
     }
 
-    /* Delete temp. buffer */
-    DS_FREE (bytes);
+    /* Count the bytes sent to every address */
+    if (wire_bytes > 0)
+        DS_AtomicAdd64 (&ptr->info->sent_bytes, (uint64_t) wire_bytes);
+
+    DS_TRACE_END ("DS_SocketSend");
 
     /* Return error code */
     return bytes_written;
 }
 
 /**
- * Changes the \a address of the given socket structre
+ * Changes the \a address of the given socket structre.
+ *
+ * Sockets are not re-opened, if the address changed, the socket is
+ * connected to the new address once it is resolved (numeric addresses are
+ * applied immediately). If the address did not change, it is looked up
+ * again (along with the fallback addresses) in the background and the
+ * socket keeps using the cached address in the meantime.
  *
  * \param ptr pointer to a \c DS_Socket structure
  * \param address the new address to apply to the socket
@@ -364,11 +2963,222 @@ void DS_SocketChangeAddress (DS_Socket* ptr, const char* address)
     if (!address)
         return;
 
-    /* Re-assign the address */
-    memset (ptr->address, 0, sizeof (ptr->address));
-    memcpy (ptr->address, address, strlen (address));
+    DS_MutexLock (&mutex);
+
+    /* Re-assign the address (the reactor may be reading from the socket) */
+    size_t len = DS_Min (strlen (address), sizeof (ptr->address) - 1);
+    int changed = (strlen (ptr->address) != len) ||
+                  (memcmp (ptr->address, address, len) != 0);
+
+    if (changed) {
+        memset (ptr->address, 0, sizeof (ptr->address));
+        memcpy (ptr->address, address, len);
+    }
+
+    /* Socket state cannot be allocated, the address is applied on open */
+    if (!socket_info (ptr)) {
+        DS_MutexUnlock (&mutex);
+        return;
+    }
+
+    /* Update the first address candidate */
+    changed = set_candidate (ptr, 0, ptr->address, len);
+
+    /* Socket is not open yet, the address is resolved when it opens */
+    if (find_socket (ptr) < 0 || !ptr->info->client_init) {
+        DS_MutexUnlock (&mutex);
+        return;
+    }
+
+    /* Address changed, stop sending to the old address */
+    if (changed) {
+        if (ptr->info->active == 0)
+            drop_active_candidate (ptr);
+
+        restart_discovery (ptr);
+        lookup_candidate (ptr, 0);
+    }
+
+    /* Look up (and probe) all candidates again, e.g. after a watchdog expired */
+    else {
+        int i;
+        restart_discovery (ptr);
+        for (i = 0; i < ptr->info->candidate_count; ++i)
+            request_lookup (ptr, i);
+    }
+
+    DS_MutexUnlock (&mutex);
+}
+
+/**
+ * Sets the addresses that are looked up along with the address of the given
+ * socket, e.g. the static IP and USB address of a robot, so that the
+ * socket can be used even if the main address is slow (or impossible) to
+ * resolve. All addresses are resolved in parallel, the socket uses the
+ * first resolved address, until an address with a higher priority (the main
+ * address, or an address that comes before it in the list) is resolved.
+ *
+ * If the \c discovery flag of the socket is set, the socket sends its
+ * datagrams to all of the resolved addresses, and uses the first address
+ * that replies instead.
+ *
+ * \param ptr pointer to a \c DS_Socket structure
+ * \param addresses the list of fallback addresses, by priority
+ * \param count the number of fallback addresses (0 to disable fallbacks)
+ */
+void DS_SocketSetFallbackAddresses (DS_Socket* ptr,
+                                    const DS_String* addresses,
+                                    const int count)
+{
+    /* Check arguments */
+    assert (ptr);
+    assert (addresses || count == 0);
+
+    DS_MutexLock (&mutex);
+
+    /* Socket state cannot be allocated */
+    if (!socket_info (ptr)) {
+        DS_MutexUnlock (&mutex);
+        return;
+    }
+
+    /* Update the candidates */
+    int i;
+    int changed [DS_SOCKET_MAX_CANDIDATES] = {0};
+    int new_count = DS_Min (count, DS_SOCKET_MAX_CANDIDATES - 1) + 1;
+    for (i = 1; i < DS_SOCKET_MAX_CANDIDATES; ++i) {
+        if (i < new_count)
+            changed [i] = set_candidate (ptr, i, addresses [i - 1].buf,
+                                         addresses [i - 1].len);
+        else {
+            changed [i] = (i < ptr->info->candidate_count);
+            set_candidate (ptr, i, "", 0);
+        }
+    }
+
+    ptr->info->candidate_count = new_count;
+
+    /* Socket is not open yet, the addresses are resolved when it opens */
+    if (find_socket (ptr) < 0 || !ptr->info->client_init) {
+        DS_MutexUnlock (&mutex);
+        return;
+    }
+
+    /* The address in use was changed or removed */
+    if (ptr->info->active > 0 && changed [ptr->info->active])
+        drop_active_candidate (ptr);
+
+    /* Resolve the new addresses */
+    for (i = 1; i < new_count; ++i) {
+        if (changed [i])
+            lookup_candidate (ptr, i);
+    }
+
+    DS_MutexUnlock (&mutex);
+}
+
+/**
+ * Changes the scheduling options of the reactor thread, which receives the
+ * data of all sockets. If \a realtime is set to \c 1, the thread runs with
+ * a real-time priority, and if \a cpu is not negative, the thread is pinned
+ * to the given CPU.
+ *
+ * \note The options are applied asynchronously by the reactor thread
+ */
+void DS_SocketSetThreadOptions (const int realtime, const int cpu)
+{
+    DS_MutexLock (&mutex);
+
+    thread_cpu = cpu;
+    thread_realtime = realtime;
+    thread_options_changed = 1;
+
+    if (running)
+        wake_reactor();
+
+    DS_MutexUnlock (&mutex);
+}
+
+/**
+ * Enables or disables the busy-polling mode of the reactor thread. While
+ * enabled, the reactor polls the sockets without sleeping (and asks the
+ * kernel to busy-poll the device queues of the UDP sockets, where
+ * \c SO_BUSY_POLL is supported), so that the received data is not delayed
+ * by the sleep granularity of the OS. This keeps a CPU core busy.
+ *
+ * \note The option is applied asynchronously by the reactor thread
+ */
+void DS_SocketSetBusyPolling (const int enabled)
+{
+    DS_MutexLock (&mutex);
+
+    busy_polling = (enabled != 0);
+    thread_options_changed = 1;
+
+    if (running)
+        wake_reactor();
+
+    DS_MutexUnlock (&mutex);
+}
+
+/**
+ * Simulates the given network conditions on the given UDP (or ICMP) socket,
+ * so that the application can be tested without special network gear. The
+ * reactor thread drops, duplicates, delays and reorders the received
+ * datagrams and the datagrams sent to the connected address, and limits the
+ * bandwidth of each direction (datagrams that would wait more than
+ * \c IMPAIR_MAX_BACKLOG msecs for the capped link are dropped).
+ *
+ * The conditions are kept when the socket is reconfigured (but not once it
+ * is closed), pass \c NULL (or a zeroed structure) to remove them.
+ *
+ * \param ptr pointer to a \c DS_Socket structure
+ * \param impairment the network conditions to simulate
+ */
+void DS_SocketSetImpairment (DS_Socket* ptr,
+                             const DS_SocketImpairment* impairment)
+{
+    /* Check arguments */
+    assert (ptr);
+
+    DS_MutexLock (&mutex);
+
+    /* Nothing to remove, or socket state cannot be allocated */
+    if ((!impairment && !ptr->info) || !socket_info (ptr)) {
+        DS_MutexUnlock (&mutex);
+        return;
+    }
+
+    /* Apply the conditions */
+    if (impairment)
+        ptr->info->impairment = *impairment;
+    else
+        memset (&ptr->info->impairment, 0, sizeof (DS_SocketImpairment));
+
+    /* Seed the random generator (it must never be 0) */
+    if (ptr->info->impair_seed == 0)
+        ptr->info->impair_seed = (uint32_t) DS_GetTimeUs() | 1;
+
+    /* Allocate the queue of held back datagrams */
+    if (!delayed && impairment_active (&ptr->info->impairment)) {
+        delayed = (DelayedDatagram*) DS_CALLOC (DS_MEMORY_GENERAL,
+                                                IMPAIR_QUEUE,
+                                                sizeof (DelayedDatagram));
+    }
+
+    /* Release the held back datagrams right away */
+    ptr->info->impair_idle [0] = 0;
+    ptr->info->impair_idle [1] = 0;
+    if (!impaired (ptr)) {
+        int i;
+        for (i = 0; i < delayed_count; ++i) {
+            if (delayed [i].socket == ptr)
+                delayed [i].release = 0;
+        }
+    }
+
+    if (running)
+        wake_reactor();
 
-    /* Re-open the socket */
-    DS_SocketClose (ptr);
-    DS_SocketOpen (ptr);
+    DS_MutexUnlock (&mutex);
 }
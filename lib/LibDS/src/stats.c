@@ -0,0 +1,57 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include "DS_Stats.h"
+#include "DS_Events.h"
+#include "DS_Messages.h"
+#include "DS_Joysticks.h"
+#include "DS_NetConsole.h"
+
+#include <assert.h>
+#include <string.h>
+
+/**
+ * Writes the internal statistics of the current context to the given
+ * \a stats structure
+ */
+void DS_GetInternalStats (DS_InternalStats* stats)
+{
+    assert (stats);
+    memset (stats, 0, sizeof (DS_InternalStats));
+
+    Events_GetStats (&stats->events);
+    Joysticks_GetStats (&stats->joysticks);
+    NetConsole_GetStats (&stats->netconsole);
+    Messages_GetStats (&stats->messages);
+}
+
+/**
+ * Clears the counters, high-water marks and maximums of the internal
+ * statistics of the current context
+ */
+void DS_ResetInternalStats (void)
+{
+    Events_ResetStats();
+    Joysticks_ResetStats();
+    NetConsole_ResetStats();
+    Messages_ResetStats();
+}
@@ -21,6 +21,8 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include "DS_Utils.h"
+#include "DS_Atomic.h"
 #include "DS_String.h"
 
 #include <stdio.h>
@@ -29,6 +31,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#define DS_STR_MAX(a,b) ((a) > (b) ? (a) : (b))
+
 #define SPRINTF_S snprintf
 #ifdef _WIN32
     #ifndef __MINGW32__
@@ -106,8 +110,8 @@ int DS_StrRmBuf (DS_String* string)
     /* Delete the buffer */
     if (string->buf != NULL) {
         string->len = 0;
-        free (string->buf);
-        string->buf = NULL;
+        string->cap = 0;
+        DS_FREE (string->buf);
         return DS_STR_SUCCESS;
     }
 
@@ -116,46 +120,72 @@ int DS_StrRmBuf (DS_String* string)
 }
 
 /**
- * Resizes the given \a string to the given \a size
+ * Ensures that the buffer of the given \a string can hold at least
+ * \a capacity bytes without being re-allocated. The length of the string
+ * is not modified.
  *
  * \param string the original string structure
- * \param size the new size to apply to the string
+ * \param capacity the minimum buffer size
  *
  * \warning The program will quit if \a string is \c NULL
- * \warning The program will quit if buffer of the \a string is \c NULL
  */
-int DS_StrResize (DS_String* string, size_t size)
+int DS_StrReserve (DS_String* string, size_t capacity)
 {
     /* Check arguments */
     assert (string);
-    assert (string->buf);
 
-    /* Initialize variables */
-    int i;
-    int oldSize = (int) string->len;
+    /* Buffer is already big enough */
+    if (capacity <= string->cap && string->buf)
+        return DS_STR_SUCCESS;
 
-    /* Copy old buffer */
-    char* copy = calloc (oldSize, sizeof (char));
-    for (i = 0; i < oldSize; ++i)
-        copy [i] = string->buf [i];
+    /* Re-allocate the buffer (the old data is kept by realloc) */
+    char* buf = (char*) DS_REALLOC (DS_MEMORY_STRINGS, string->buf,
+                                    DS_STR_MAX (capacity, 1));
+    if (!buf)
+        return DS_STR_FAILURE;
 
-    /* Re-initialize the buffer */
-    free (string->buf);
-    string->buf = calloc (size, sizeof (char));
+    /* Fill the new space with zeroes */
+    memset (buf + string->len, 0, DS_STR_MAX (capacity, 1) - string->len);
 
-    /* Copy old buffer into start of new buffer */
-    if (string->buf) {
-        string->len = size;
-        for (i = 0; i < oldSize; ++i)
-            string->buf [i] = copy [i];
+    /* Update string properties */
+    string->buf = buf;
+    string->cap = DS_STR_MAX (capacity, 1);
+    return DS_STR_SUCCESS;
+}
 
-        free (copy);
-        return DS_STR_SUCCESS;
+/**
+ * Resizes the given \a string to the given \a size, if the string grows,
+ * the new bytes are set to \c 0.
+ *
+ * The buffer capacity grows geometrically, so that repeatedly growing a
+ * string (e.g. appending bytes to a packet) takes amortized constant time.
+ *
+ * \param string the original string structure
+ * \param size the new size to apply to the string
+ *
+ * \warning The program will quit if \a string is \c NULL
+ * \warning The program will quit if buffer of the \a string is \c NULL
+ */
+int DS_StrResize (DS_String* string, size_t size)
+{
+    /* Check arguments */
+    assert (string);
+    assert (string->buf);
+
+    /* Grow the buffer if required */
+    if (size > string->cap) {
+        if (!DS_StrReserve (string, DS_STR_MAX (size, string->cap * 2)))
+            return DS_STR_FAILURE;
     }
 
-    /* Could not initialize the buffer, restore data */
-    string->buf = copy;
-    return DS_STR_FAILURE;
+    /* Clear the bytes that are added to (or removed from) the string */
+    if (size > string->len)
+        memset (string->buf + string->len, 0, size - string->len);
+    else
+        memset (string->buf + size, 0, string->len - size);
+
+    string->len = size;
+    return DS_STR_SUCCESS;
 }
 
 /**
@@ -205,10 +235,7 @@ int DS_StrJoin (DS_String* first, const DS_String* second)
 
     /* Resize the string and append the other string */
     if (DS_StrResize (first, original_len + append_len)) {
-        int i;
-        for (i = 0; i < append_len; ++i)
-            first->buf [original_len + i] = second->buf [i];
-
+        memcpy (first->buf + original_len, second->buf, append_len);
         return DS_STR_SUCCESS;
     }
 
@@ -227,14 +254,14 @@ int DS_StrJoinCStr (DS_String* string, const char* cstring)
     assert (string);
     assert (cstring);
 
-    /* Append each character to the string */
-    int i;
-    int len = (int) strlen (cstring);
-    for (i = 0; i < len; ++i)
-        if (!DS_StrAppend (string, cstring [i]))
-            return DS_STR_FAILURE;
+    /* Append the characters to the string */
+    size_t len = strlen (cstring);
+    size_t original_len = string->len;
+    if (!DS_StrResize (string, original_len + len))
+        return DS_STR_FAILURE;
 
     /* Tell everyone how smart this function is */
+    memcpy (string->buf + original_len, cstring, len);
     return DS_STR_SUCCESS;
 }
 
@@ -277,12 +304,13 @@ char* DS_StrToChar (const DS_String* string)
 
     /* Initialize the c-string with one extra byte (for null terminator) */
     size_t len = string->len + 1;
-    char* cstr = (char*) calloc (len, sizeof (char));
+    char* cstr = (char*) DS_MALLOC (DS_MEMORY_STRINGS, len);
+    if (!cstr)
+        return NULL;
 
     /* Copy buffer data into c-string */
-    int i;
-    for (i = 0; i < (int) string->len; ++i)
-        cstr [i] = string->buf [i];
+    if (string->len > 0)
+        memcpy (cstr, string->buf, string->len);
 
     /* Add NULL-terminator */
     cstr [string->len] = 0;
@@ -334,9 +362,8 @@ DS_String DS_StrNew (const char* string)
     DS_String str = DS_StrNewLen (strlen (string));
 
     /* Copy C string data into buffer */
-    int i;
-    for (i = 0; i < (int) str.len; ++i)
-        str.buf [i] = string [i];
+    if (str.buf)
+        memcpy (str.buf, string, str.len);
 
     /* Return obtained string */
     return str;
@@ -349,7 +376,8 @@ DS_String DS_StrNewLen (const size_t length)
 {
     DS_String string;
     string.len = length;
-    string.buf = (char*) calloc (string.len, sizeof (char));
+    string.cap = DS_STR_MAX (length, 1);
+    string.buf = (char*) DS_CALLOC (DS_MEMORY_STRINGS, string.cap, sizeof (char));
     return string;
 }
 
@@ -367,15 +395,123 @@ DS_String DS_StrDup (const DS_String* source)
     /* Create new empty string */
     DS_String string = DS_StrNewLen (source->len);
 
-    /* Copy each character to the new string */
-    int i;
-    for (i = 0; i < (int) string.len; ++i)
-        string.buf [i] = source->buf [i];
+    /* Copy the data to the new string */
+    if (string.buf)
+        memcpy (string.buf, source->buf, string.len);
 
     /* Return the copy */
     return string;
 }
 
+/*
+ * Output of the formatter, the bytes that do not fit in the buffer are
+ * only counted
+ */
+typedef struct {
+    char* buf;
+    size_t size;
+    size_t len;
+} FormatOutput;
+
+/**
+ * Writes the given \a data to the formatter \a output
+ */
+static void put_data (FormatOutput* output, const char* data, size_t len)
+{
+    if (output->len < output->size) {
+        size_t room = output->size - output->len;
+        memcpy (output->buf + output->len, data, len < room ? len : room);
+    }
+
+    output->len += len;
+}
+
+/**
+ * Writes the decimal representation of the given \a value to the formatter
+ * \a output, with a minus sign if \a negative is set
+ */
+static void put_number (FormatOutput* output, unsigned int value, int negative)
+{
+    char digits [12];
+    size_t pos = sizeof (digits);
+
+    do {
+        digits [--pos] = (char) ('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    if (negative)
+        digits [--pos] = '-';
+
+    put_data (output, digits + pos, sizeof (digits) - pos);
+}
+
+/**
+ * Formats the given \a format and arguments in a single pass, writing at
+ * most \a size bytes to the \a buffer (without a null terminator)
+ *
+ * \returns the length of the complete result
+ */
+static size_t format_args (char* buffer, size_t size, const char* format, va_list args)
+{
+    const char* f = format;
+    FormatOutput output = {buffer, buffer ? size : 0, 0};
+
+    while (*f) {
+        /* This is not a specifier, write the text up to the next one */
+        if (*f != '%') {
+            size_t run = strcspn (f, "%");
+            put_data (&output, f, run);
+            f += run;
+            continue;
+        }
+
+        /* The format ends with a single '%' */
+        char next = * (f + 1);
+        if (next == '\0')
+            break;
+
+        /* Handle integers */
+        if (next == 'd') {
+            int value = va_arg (args, int);
+            put_number (&output, value < 0 ? 0u - (unsigned int) value :
+                        (unsigned int) value, value < 0);
+        }
+
+        else if (next == 'u')
+            put_number (&output, va_arg (args, unsigned int), 0);
+
+        /* Handle floating point numbers, the buffer fits any double (the
+         * largest one has 309 digits), the length is clamped anyway since
+         * snprintf() returns the length that the number needs */
+        else if (next == 'f') {
+            char str [320];
+            int len = SPRINTF_S (str, sizeof (str), "%.2f", va_arg (args, double));
+            put_data (&output, str, len > 0 ? DS_Min ((size_t) len, sizeof (str) - 1) : 0);
+        }
+
+        /* Handle characters */
+        else if (next == 'c') {
+            char c = (char) va_arg (args, int);
+            put_data (&output, &c, 1);
+        }
+
+        /* Handle strings */
+        else if (next == 's') {
+            const char* str = va_arg (args, const char*);
+            put_data (&output, str, strlen (str));
+        }
+
+        /* Handle everything else */
+        else
+            put_data (&output, &next, 1);
+
+        f += 2;
+    }
+
+    return output.len;
+}
+
 /**
  * Constructs a string with the given \a format and arguments
  *
@@ -387,86 +523,184 @@ DS_String DS_StrDup (const DS_String* source)
  *     - %f floating point number
  *     - Any other format specifier will be ignored
  *
+ * The string is formatted in a stack buffer and copied to a buffer of the
+ * exact size, results longer than \c DS_STR_FORMAT_STACK_SIZE are
+ * formatted again in the new buffer.
+ *
  * \warning The program will quit if \a format is \c NULL
  */
 DS_String DS_StrFormat (const char* format, ...)
 {
+    va_list args;
+    va_list copy;
+    size_t len;
+    char stack [DS_STR_FORMAT_STACK_SIZE];
+
     /* Check arguments */
     assert (format);
 
-    /* Initialize variables */
-    int init_len = 0;
-    const char* f = format;
+    /* Format the string in the stack buffer */
+    va_start (args, format);
+    va_copy (copy, args);
+    len = format_args (stack, sizeof (stack), format, args);
+    va_end (args);
 
-    /* Initialize string */
-    DS_String string = DS_StrNewLen (init_len);
+    /* Copy the result, or format it again if it was too long */
+    DS_String string = DS_StrNewLen (len);
+    if (string.buf) {
+        if (len <= sizeof (stack))
+            memcpy (string.buf, stack, len);
+        else
+            format_args (string.buf, len, format, copy);
+    }
+
+    va_end (copy);
+    return string;
+}
 
-    /* Initialize argument list */
+/**
+ * Formats the given \a format and arguments (see \c DS_StrFormat()) in the
+ * given \a buffer, which holds \a size bytes. Like \c snprintf(), the
+ * result is truncated (and always null-terminated) if it does not fit.
+ *
+ * \returns the length of the complete result, without the null terminator
+ */
+size_t DS_StrFormatBuf (char* buffer, size_t size, const char* format, ...)
+{
     va_list args;
+    size_t len;
+
     va_start (args, format);
+    len = DS_StrFormatV (buffer, size, format, args);
+    va_end (args);
 
-    /* Get next byte specifier */
-    f = format;
+    return len;
+}
 
-    while (*f) {
-        char next;
-
-        /* This is a format specifier, let's do some magic */
-        if (*f == '%') {
-            next = * (f + 1);
-            f++;
-
-            /* Handle number values */
-            if (next == 'u' || next == 'd' || next == 'f') {
-                char str [sizeof (double) * 2];
-                memset (str, 0, sizeof (str));
-
-                /* Get the representation of the number */
-                if (next == 'u')
-                    SPRINTF_S (str, sizeof (str), "%u", (unsigned int) va_arg (args, unsigned int));
-                else if (next == 'd')
-                    SPRINTF_S (str, sizeof (str), "%d", (int) va_arg (args, int));
-                else if (next == 'f')
-                    SPRINTF_S (str, sizeof (str), "%.2f", (double) va_arg (args, double));
-
-                /* Append every character to the string */
-                int i = 0;
-                int len = (int) strlen (str);
-                for (i = 0; i < len; ++i)
-                    DS_StrAppend (&string, str [i]);
-            }
-
-            /* Handle characters */
-            else if (next == 'c')
-                DS_StrAppend (&string, (char) va_arg (args, int));
-
-            /* Handle strings */
-            else if (next == 's') {
-                char* str = (char*) va_arg (args, char*);
-                int len = (int) strlen (str);
-
-                /* Append every character to the string */
-                int i = 0;
-                for (i = 0; i < len; ++i)
-                    DS_StrAppend (&string, str [i]);
-            }
-
-            /* Handle everything else */
-            else
-                DS_StrAppend (&string, next);
+/**
+ * Same as \c DS_StrFormatBuf(), with a list of arguments
+ */
+size_t DS_StrFormatV (char* buffer, size_t size, const char* format, va_list args)
+{
+    size_t len;
+
+    /* Check arguments */
+    assert (format);
+
+    /* Format the string and add the null terminator */
+    len = format_args (buffer, size > 0 ? size - 1 : 0, format, args);
+    if (buffer && size > 0)
+        buffer [len < size ? len : size - 1] = '\0';
+
+    return len;
+}
+
+/**
+ * Replaces the contents of the given \a string with the given \a format and
+ * arguments (see \c DS_StrFormat()), the buffer of the string is reused, so
+ * formatting the same kind of text repeatedly does not allocate memory.
+ * The string must own its buffer (or be zeroed).
+ *
+ * \returns \c DS_STR_SUCCESS on success, \c DS_STR_FAILURE if the buffer
+ *          cannot be enlarged
+ */
+int DS_StrFormatInto (DS_String* string, const char* format, ...)
+{
+    va_list args;
+    va_list copy;
+    size_t len;
+
+    /* Check arguments */
+    assert (string);
+    assert (format);
+    assert (string->cap > 0 || !string->buf);
+
+    /* Format in the current buffer (which is used as the size hint) */
+    va_start (args, format);
+    va_copy (copy, args);
+    len = format_args (string->buf, string->buf ? string->cap : 0, format, args);
+    va_end (args);
+
+    /* Enlarge the buffer and format again */
+    if (len > string->cap || !string->buf) {
+        string->len = 0;
+        if (!DS_StrReserve (string, len)) {
+            va_end (copy);
+            return DS_STR_FAILURE;
         }
 
-        /* This is not a specifier, just append the data to the string */
-        else
-            DS_StrAppend (&string, *f);
+        format_args (string->buf, len, format, copy);
+    }
 
-        /* Go to next byte */
-        f++;
+    va_end (copy);
+    string->len = len;
+    return DS_STR_SUCCESS;
+}
+
+/**
+ * Returns a new string with the text of the given \a cache, the text is
+ * only formatted (with the given \a format and arguments) if the cache is
+ * empty or if it was formatted for another \a key.
+ *
+ * Results longer than \c DS_STR_CACHE_SIZE are never cached.
+ */
+DS_String DS_StrCacheFormat (DS_StrCache* cache, const int key,
+                             const char* format, ...)
+{
+    va_list args;
+    size_t len;
+    size_t seq;
+    char text [DS_STR_CACHE_SIZE];
+
+    /* Check arguments */
+    assert (cache);
+    assert (format);
+
+    /* Copy the cached text (if it is not being written and matches the key) */
+    seq = DS_AtomicLoad (&cache->sequence);
+    if (!(seq & 1) && cache->valid && cache->key == key) {
+        len = cache->len;
+        memcpy (text, cache->text, len);
+
+        DS_AtomicAcquireFence();
+        if (DS_AtomicLoad (&cache->sequence) == seq) {
+            DS_String string = DS_StrNewLen (len);
+            if (string.buf)
+                memcpy (string.buf, text, len);
+
+            return string;
+        }
     }
 
-    /* End argument list */
+    /* Format the text */
+    va_start (args, format);
+    len = format_args (text, sizeof (text), format, args);
     va_end (args);
 
-    /* Return string structure */
+    /* Result is too long for the cache, format it again in a new string */
+    if (len > sizeof (text)) {
+        DS_String string = DS_StrNewLen (len);
+        va_start (args, format);
+        if (string.buf)
+            format_args (string.buf, len, format, args);
+        va_end (args);
+        return string;
+    }
+
+    /* Update the cache, unless another thread is writing it */
+    seq = DS_AtomicLoad (&cache->sequence);
+    if (!(seq & 1) && DS_AtomicCAS (&cache->sequence, seq, seq + 1)) {
+        memcpy (cache->text, text, len);
+        cache->len = len;
+        cache->key = key;
+        cache->valid = 1;
+        DS_AtomicStore (&cache->sequence, seq + 2);
+    }
+
+    /* Return a copy of the text */
+    DS_String string = DS_StrNewLen (len);
+    if (string.buf)
+        memcpy (string.buf, text, len);
+
     return string;
 }
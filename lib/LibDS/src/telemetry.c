@@ -0,0 +1,402 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Utils.h"
+#include "DS_Timer.h"
+#include "DS_Atomic.h"
+#include "DS_Config.h"
+#include "DS_Context.h"
+#include "DS_Telemetry.h"
+#include "DS_Thread.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined _WIN32
+    #include <windows.h>
+#elif !defined __ANDROID__
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+#define NAME_SIZE 256 /* Maximum size of a segment name */
+
+/*
+ * Telemetry export state of a DS context, the mutex protects the segment,
+ * which is created and removed by the application and updated by the event
+ * loop
+ */
+typedef struct {
+    volatile size_t exporting;
+    DS_TelemetryBlock* block;
+    char name [NAME_SIZE];
+    uint64_t last_update;
+    DS_Mutex mutex;
+
+#if defined _WIN32
+    HANDLE mapping;
+#endif
+} TelemetryContext;
+
+/**
+ * Initializes the telemetry state of a new DS context
+ */
+static void init_context (void* data)
+{
+    TelemetryContext* ctx = (TelemetryContext*) data;
+    DS_MutexInit (&ctx->mutex);
+}
+
+/**
+ * Releases the telemetry state of a DS context
+ */
+static void destroy_context (void* data)
+{
+    TelemetryContext* ctx = (TelemetryContext*) data;
+    DS_MutexDestroy (&ctx->mutex);
+}
+
+/**
+ * Returns the telemetry state of the current DS context
+ */
+static TelemetryContext* get_context (void)
+{
+    return (TelemetryContext*) DS_ContextData (DS_CONTEXT_TELEMETRY,
+                                               sizeof (TelemetryContext),
+                                               init_context, destroy_context);
+}
+
+/**
+ * Writes the segment name of the given \a name to \a buf, POSIX segment
+ * names must begin with a slash (which is added if it is missing)
+ *
+ * \returns \c 0 if the name is too long
+ */
+static int segment_name (const char* name, char* buf, const size_t size)
+{
+#if defined _WIN32
+    const char* prefix = "";
+#else
+    const char* prefix = (name [0] == '/') ? "" : "/";
+#endif
+
+    return snprintf (buf, size, "%s%s", prefix, name) < (int) size;
+}
+
+/**
+ * Copies the current state of the DS into the given \a data
+ */
+static void collect_data (DS_TelemetryData* data)
+{
+    CFG_State state;
+    CFG_GetState (&state);
+
+    data->time = DS_GetTimeMs();
+    data->team = state.team;
+    data->robot_code = state.robot_code;
+    data->robot_enabled = state.robot_enabled;
+    data->emergency_stopped = state.emergency_stopped;
+    data->fms_communications = state.fms_communications;
+    data->radio_communications = state.radio_communications;
+    data->robot_communications = state.robot_communications;
+    data->cpu_usage = state.cpu_usage;
+    data->ram_usage = state.ram_usage;
+    data->disk_usage = state.disk_usage;
+    data->can_utilization = state.can_utilization;
+    data->robot_voltage = state.robot_voltage;
+    data->position = state.position;
+    data->alliance = state.alliance;
+    data->control_mode = state.control_mode;
+    data->robot_latency = DS_GetRobotLatencyInfo();
+    data->robot_loss = DS_GetRobotLossInfo();
+    DS_GetJoystickSnapshot (&data->joysticks);
+}
+
+/**
+ * Stops the telemetry export of the current context
+ */
+void Telemetry_Close (void)
+{
+    DS_StopTelemetryExport();
+}
+
+/**
+ * Publishes the current state of the DS in the exported segment (if the
+ * export is running and the update interval has elapsed), this function
+ * is called by the event loop
+ */
+void Telemetry_Update (void)
+{
+    TelemetryContext* ctx = get_context();
+
+    if (!DS_AtomicLoad (&ctx->exporting) || Telemetry_Remaining() > 0)
+        return;
+
+    /* Collect the data before locking, readers only see the final copy */
+    DS_TelemetryData data;
+    collect_data (&data);
+
+    DS_MutexLock (&ctx->mutex);
+    if (ctx->block) {
+        DS_AtomicFetchAdd (&ctx->block->sequence, 1);
+        ctx->block->data = data;
+        DS_AtomicFetchAdd (&ctx->block->sequence, 1);
+    }
+    DS_MutexUnlock (&ctx->mutex);
+
+    ctx->last_update = data.time;
+}
+
+/**
+ * Returns the time (in msecs) until the exported state must be updated,
+ * or \c -1 if the telemetry export is not running
+ */
+int Telemetry_Remaining (void)
+{
+    TelemetryContext* ctx = get_context();
+
+    if (!DS_AtomicLoad (&ctx->exporting))
+        return -1;
+
+    uint64_t elapsed = DS_GetTimeMs() - ctx->last_update;
+    if (elapsed >= DS_TELEMETRY_INTERVAL)
+        return 0;
+
+    return DS_TELEMETRY_INTERVAL - (int) elapsed;
+}
+
+/**
+ * Creates a shared memory segment with the given \a name and publishes the
+ * state of the DS (including the joysticks and the robot latency) in it,
+ * local dashboards can then read the state with \c DS_TelemetryMap() and
+ * \c DS_TelemetryRead() (or by following the layout of DS_TelemetryBlock).
+ *
+ * Each DS context exports its own segment. The segment is removed when the
+ * export is stopped or when the DS is closed.
+ *
+ * \param name the name of the segment (e.g. "libds"), on POSIX systems a
+ *        leading slash is added if the name has none
+ *
+ * \returns \c 1 on success, \c 0 if the segment cannot be created
+ */
+int DS_StartTelemetryExport (const char* name)
+{
+    TelemetryContext* ctx = get_context();
+    DS_TelemetryBlock* block = NULL;
+    char path [NAME_SIZE];
+
+    assert (name);
+    DS_StopTelemetryExport();
+
+    if (!segment_name (name, path, sizeof (path)))
+        return 0;
+
+#if defined _WIN32
+    HANDLE mapping = CreateFileMappingA (INVALID_HANDLE_VALUE, NULL,
+                                         PAGE_READWRITE, 0,
+                                         sizeof (DS_TelemetryBlock), path);
+    if (!mapping)
+        return 0;
+
+    block = (DS_TelemetryBlock*) MapViewOfFile (mapping, FILE_MAP_WRITE, 0, 0,
+                                                sizeof (DS_TelemetryBlock));
+    if (!block) {
+        CloseHandle (mapping);
+        return 0;
+    }
+#elif defined __ANDROID__
+    return 0;
+#else
+    int fd = shm_open (path, O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+        return 0;
+
+    if (ftruncate (fd, sizeof (DS_TelemetryBlock)) == 0)
+        block = (DS_TelemetryBlock*) mmap (NULL, sizeof (DS_TelemetryBlock),
+                                           PROT_READ | PROT_WRITE,
+                                           MAP_SHARED, fd, 0);
+
+    close (fd);
+
+    if (!block || block == MAP_FAILED) {
+        shm_unlink (path);
+        return 0;
+    }
+#endif
+
+    /* The sequence stays at 0 until the first update */
+    memset (block, 0, sizeof (DS_TelemetryBlock));
+    block->magic = DS_TELEMETRY_MAGIC;
+    block->version = DS_TELEMETRY_VERSION;
+    block->size = sizeof (DS_TelemetryBlock);
+
+    DS_MutexLock (&ctx->mutex);
+    ctx->block = block;
+    ctx->last_update = 0;
+    memcpy (ctx->name, path, sizeof (path));
+#if defined _WIN32
+    ctx->mapping = mapping;
+#endif
+    DS_MutexUnlock (&ctx->mutex);
+
+    DS_AtomicStore (&ctx->exporting, 1);
+    return 1;
+}
+
+/**
+ * Stops the telemetry export (if it is running) and removes its segment,
+ * readers that still map the segment keep their (now frozen) copy
+ */
+void DS_StopTelemetryExport (void)
+{
+    TelemetryContext* ctx = get_context();
+
+    if (!DS_AtomicLoad (&ctx->exporting))
+        return;
+
+    DS_AtomicStore (&ctx->exporting, 0);
+
+    DS_MutexLock (&ctx->mutex);
+#if defined _WIN32
+    UnmapViewOfFile (ctx->block);
+    CloseHandle (ctx->mapping);
+#elif !defined __ANDROID__
+    munmap (ctx->block, sizeof (DS_TelemetryBlock));
+    shm_unlink (ctx->name);
+#endif
+    ctx->block = NULL;
+    DS_MutexUnlock (&ctx->mutex);
+}
+
+/**
+ * Returns \c 1 if the state of the current context is being exported
+ */
+int DS_TelemetryExportActive (void)
+{
+    return DS_AtomicLoad (&get_context()->exporting) != 0;
+}
+
+/**
+ * Maps the telemetry segment with the given \a name (exported by this or
+ * by another process) in read-only mode
+ *
+ * \returns the mapped block, or \c NULL if the segment does not exist or
+ *          if it was exported by an incompatible version of the LibDS
+ */
+const DS_TelemetryBlock* DS_TelemetryMap (const char* name)
+{
+    DS_TelemetryBlock* block = NULL;
+    char path [NAME_SIZE];
+
+    assert (name);
+    if (!segment_name (name, path, sizeof (path)))
+        return NULL;
+
+#if defined _WIN32
+    HANDLE mapping = OpenFileMappingA (FILE_MAP_READ, FALSE, path);
+    if (!mapping)
+        return NULL;
+
+    /* The view keeps the mapping alive */
+    block = (DS_TelemetryBlock*) MapViewOfFile (mapping, FILE_MAP_READ, 0, 0,
+                                                sizeof (DS_TelemetryBlock));
+    CloseHandle (mapping);
+#elif defined __ANDROID__
+    return NULL;
+#else
+    struct stat info;
+    int fd = shm_open (path, O_RDONLY, 0);
+    if (fd < 0)
+        return NULL;
+
+    if (fstat (fd, &info) == 0 && info.st_size >= (off_t) sizeof (*block)) {
+        block = (DS_TelemetryBlock*) mmap (NULL, sizeof (DS_TelemetryBlock),
+                                           PROT_READ, MAP_SHARED, fd, 0);
+        if (block == MAP_FAILED)
+            block = NULL;
+    }
+
+    close (fd);
+#endif
+
+    /* Reject blocks with another layout */
+    if (block && (block->magic != DS_TELEMETRY_MAGIC ||
+                  block->version != DS_TELEMETRY_VERSION ||
+                  block->size != sizeof (DS_TelemetryBlock))) {
+        DS_TelemetryUnmap (block);
+        return NULL;
+    }
+
+    return block;
+}
+
+/**
+ * Unmaps a block obtained with \c DS_TelemetryMap()
+ */
+void DS_TelemetryUnmap (const DS_TelemetryBlock* block)
+{
+    if (!block)
+        return;
+
+#if defined _WIN32
+    UnmapViewOfFile ((LPCVOID) block);
+#elif !defined __ANDROID__
+    munmap ((void*) block, sizeof (DS_TelemetryBlock));
+#endif
+}
+
+/**
+ * Copies a consistent version of the state published in the given \a block
+ * into \a data, without any system call
+ *
+ * \returns the sequence of the copied version (which grows with each update,
+ *          so that readers can skip unchanged data), or \c 0 if the block
+ *          has not been updated yet
+ */
+size_t DS_TelemetryRead (const DS_TelemetryBlock* block,
+                         DS_TelemetryData* data)
+{
+    size_t seq;
+
+    /* Check arguments */
+    assert (block);
+    assert (data);
+
+    /* Copy the data until we get a version that was not being modified */
+    for (;;) {
+        seq = DS_AtomicLoad (&block->sequence);
+        if (seq == 0)
+            return 0;
+        if (seq & 1)
+            continue;
+
+        *data = block->data;
+        DS_AtomicAcquireFence();
+
+        if (DS_AtomicLoad (&block->sequence) == seq)
+            return seq;
+    }
+}
@@ -0,0 +1,592 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#if defined __linux__ && !defined _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#if defined _WIN32
+    /* Slim reader/writer locks and condition variables need Windows Vista */
+    #if !defined _WIN32_WINNT || _WIN32_WINNT < 0x0600
+        #undef  _WIN32_WINNT
+        #define _WIN32_WINNT 0x0600
+    #endif
+#endif
+
+#include "DS_Utils.h"
+#include "DS_Thread.h"
+
+#include <time.h>
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+
+#if defined _WIN32
+    #include <windows.h>
+    #include <process.h>
+#elif defined __APPLE__
+    #include <mach/mach.h>
+    #include <pthread/qos.h>
+#elif defined __linux__
+    #include <sched.h>
+    #include <unistd.h>
+    #include <sys/syscall.h>
+#else
+    #include <unistd.h>
+#endif
+
+/*
+ * Real-time priority used on Linux, high enough to preempt the rest of the
+ * application, but below the kernel threads (IRQs run at priority 50)
+ */
+#define RT_PRIORITY 20
+
+/*
+ * A thread started by DS_CreateThread(), the running threads are kept in a
+ * list so that their names and CPU time can be queried with DS_GetThreads()
+ */
+typedef struct _thread_entry {
+    void* (*func) (void*);
+    void* arg;
+    DS_ThreadInfo info;
+#if defined _WIN32
+    HANDLE handle;
+#else
+    pthread_t self;
+#endif
+    struct _thread_entry* next;
+} ThreadEntry;
+
+static ThreadEntry* threads = NULL;
+static DS_Mutex threads_mutex = DS_MUTEX_INITIALIZER;
+
+#if defined _WIN32
+/*
+ * SetThreadDescription() needs Windows 10 (1607), so it is looked up at
+ * run-time
+ */
+typedef HRESULT (WINAPI* SetThreadDescriptionFunc) (HANDLE, PCWSTR);
+
+/**
+ * Converts a \c FILETIME duration (in 100 nsecs units) to nsecs
+ */
+static uint64_t file_time_ns (const FILETIME* time)
+{
+    ULARGE_INTEGER value;
+    value.LowPart = time->dwLowDateTime;
+    value.HighPart = time->dwHighDateTime;
+    return value.QuadPart * 100;
+}
+
+/*
+ * The opaque types of DS_Thread.h must match the native types
+ */
+typedef char DS_MutexSize [sizeof (DS_Mutex) == sizeof (SRWLOCK) ? 1 : -1];
+typedef char DS_CondSize [sizeof (DS_Cond) == sizeof (CONDITION_VARIABLE) ? 1 : -1];
+typedef char DS_OnceSize [sizeof (DS_Once) == sizeof (INIT_ONCE) ? 1 : -1];
+typedef char DS_KeySize [sizeof (DS_ThreadKey) == sizeof (DWORD) ? 1 : -1];
+typedef char DS_ThreadSize [sizeof (DS_Thread) == sizeof (HANDLE) ? 1 : -1];
+
+/**
+ * Initializes the given \a mutex
+ */
+void DS_MutexInit (DS_Mutex* mutex)
+{
+    InitializeSRWLock ((PSRWLOCK) mutex);
+}
+
+/**
+ * Slim reader/writer locks do not need to be destroyed
+ */
+void DS_MutexDestroy (DS_Mutex* mutex)
+{
+    (void) mutex;
+}
+
+/**
+ * Locks the given \a mutex
+ */
+void DS_MutexLock (DS_Mutex* mutex)
+{
+    AcquireSRWLockExclusive ((PSRWLOCK) mutex);
+}
+
+/**
+ * Unlocks the given \a mutex
+ */
+void DS_MutexUnlock (DS_Mutex* mutex)
+{
+    ReleaseSRWLockExclusive ((PSRWLOCK) mutex);
+}
+
+/**
+ * Locks the given \a mutex, and increments \a contentions if the mutex is
+ * held by another thread
+ */
+void DS_MutexLockCounted (DS_Mutex* mutex, volatile size_t* contentions)
+{
+#if _WIN32_WINNT >= 0x0601
+    if (!TryAcquireSRWLockExclusive ((PSRWLOCK) mutex)) {
+        DS_AtomicFetchAdd (contentions, 1);
+        AcquireSRWLockExclusive ((PSRWLOCK) mutex);
+    }
+#else
+    (void) contentions;
+    AcquireSRWLockExclusive ((PSRWLOCK) mutex);
+#endif
+}
+
+/**
+ * Initializes the given \a cond
+ */
+void DS_CondInit (DS_Cond* cond)
+{
+    InitializeConditionVariable ((PCONDITION_VARIABLE) cond);
+}
+
+/**
+ * Condition variables do not need to be destroyed
+ */
+void DS_CondDestroy (DS_Cond* cond)
+{
+    (void) cond;
+}
+
+/**
+ * Wakes up one thread waiting on the given \a cond
+ */
+void DS_CondSignal (DS_Cond* cond)
+{
+    WakeConditionVariable ((PCONDITION_VARIABLE) cond);
+}
+
+/**
+ * Wakes up all the threads waiting on the given \a cond
+ */
+void DS_CondBroadcast (DS_Cond* cond)
+{
+    WakeAllConditionVariable ((PCONDITION_VARIABLE) cond);
+}
+
+/**
+ * Waits (unlocking the given \a mutex) until \a cond is signaled
+ */
+void DS_CondWait (DS_Cond* cond, DS_Mutex* mutex)
+{
+    SleepConditionVariableSRW ((PCONDITION_VARIABLE) cond, (PSRWLOCK) mutex,
+                               INFINITE, 0);
+}
+#endif
+
+/**
+ * Gives the given \a name to the calling thread, so that it can be told
+ * apart in debuggers and profilers
+ */
+static void set_thread_name (const char* name)
+{
+#if defined _WIN32
+    wchar_t wide [sizeof (((DS_ThreadInfo*) 0)->name)];
+    SetThreadDescriptionFunc func = (SetThreadDescriptionFunc) (void*)
+                                    GetProcAddress (GetModuleHandleW (L"kernel32.dll"),
+                                                    "SetThreadDescription");
+
+    if (func && MultiByteToWideChar (CP_UTF8, 0, name, -1, wide,
+                                     (int) (sizeof (wide) / sizeof (wide [0]))))
+        func (GetCurrentThread(), wide);
+#elif defined __APPLE__
+    pthread_setname_np (name);
+#elif defined __linux__
+    pthread_setname_np (pthread_self(), name);
+#else
+    (void) name;
+#endif
+}
+
+/**
+ * Returns the ID given by the OS to the calling thread (the same ID that is
+ * shown by the system tools)
+ */
+static uint64_t current_thread_id (void)
+{
+#if defined _WIN32
+    return (uint64_t) GetCurrentThreadId();
+#elif defined __APPLE__
+    uint64_t id = 0;
+    pthread_threadid_np (NULL, &id);
+    return id;
+#elif defined __linux__
+    return (uint64_t) syscall (SYS_gettid);
+#else
+    return (uint64_t) (uintptr_t) pthread_self();
+#endif
+}
+
+/**
+ * Returns the CPU time (user and system) used by the thread of the given
+ * \a entry, in nanoseconds. The thread must still be in the list.
+ */
+static uint64_t thread_cpu_time (const ThreadEntry* entry)
+{
+#if defined _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (GetThreadTimes (entry->handle, &creation, &exit, &kernel, &user))
+        return file_time_ns (&kernel) + file_time_ns (&user);
+#elif defined __APPLE__
+    thread_basic_info_data_t info;
+    mach_msg_type_number_t count = THREAD_BASIC_INFO_COUNT;
+    if (thread_info (pthread_mach_thread_np (entry->self), THREAD_BASIC_INFO,
+                     (thread_info_t) &info, &count) == KERN_SUCCESS)
+        return (uint64_t) (info.user_time.seconds +
+                           info.system_time.seconds) * 1000000000ULL
+               + (uint64_t) (info.user_time.microseconds +
+                             info.system_time.microseconds) * 1000ULL;
+#elif defined _POSIX_THREAD_CPUTIME
+    clockid_t clock;
+    struct timespec time;
+    if (pthread_getcpuclockid (entry->self, &clock) == 0
+            && clock_gettime (clock, &time) == 0)
+        return (uint64_t) time.tv_sec * 1000000000ULL + (uint64_t) time.tv_nsec;
+#else
+    (void) entry;
+#endif
+
+    return 0;
+}
+
+/**
+ * Names the calling thread, adds it to the thread list and runs the thread
+ * function of the given \a entry. The thread is removed from the list when
+ * the function returns.
+ */
+static void* run_entry (ThreadEntry* entry)
+{
+    set_thread_name (entry->info.name);
+
+    DS_MutexLock (&threads_mutex);
+    entry->info.id = current_thread_id();
+#if defined _WIN32
+    if (!DuplicateHandle (GetCurrentProcess(), GetCurrentThread(),
+                          GetCurrentProcess(), &entry->handle,
+                          THREAD_QUERY_LIMITED_INFORMATION, FALSE, 0))
+        entry->handle = NULL;
+#else
+    entry->self = pthread_self();
+#endif
+    entry->next = threads;
+    threads = entry;
+    DS_MutexUnlock (&threads_mutex);
+
+    void* result = entry->func (entry->arg);
+
+    DS_MutexLock (&threads_mutex);
+    ThreadEntry** link = &threads;
+    while (*link && *link != entry)
+        link = & (*link)->next;
+    if (*link)
+        *link = entry->next;
+    DS_MutexUnlock (&threads_mutex);
+
+#if defined _WIN32
+    if (entry->handle)
+        CloseHandle (entry->handle);
+#endif
+
+    DS_FREE (entry);
+    return result;
+}
+
+#if defined _WIN32
+/**
+ * Runs the thread described by the given \a ptr, Windows threads have a
+ * different signature than the thread functions of the LibDS
+ */
+static unsigned __stdcall run_thread (void* ptr)
+{
+    run_entry ((ThreadEntry*) ptr);
+    return 0;
+}
+
+/**
+ * Calls the function pointed by \a param (a one-time initializer)
+ */
+static BOOL CALLBACK run_once (PINIT_ONCE once, PVOID param, PVOID* context)
+{
+    (void) once;
+    (void) context;
+
+    void (**func) (void) = (void (**) (void)) param;
+    (*func)();
+    return TRUE;
+}
+#else
+/**
+ * Runs the thread described by the given \a ptr
+ */
+static void* run_thread (void* ptr)
+{
+    return run_entry ((ThreadEntry*) ptr);
+}
+#endif
+
+/**
+ * Starts a new thread that runs \a func with the given \a arg. Every thread
+ * of the LibDS is started with this function, so that:
+ *    - The thread is given the \a name (at most 15 characters are kept, the
+ *      limit of Linux), which is shown by debuggers and profilers
+ *    - The thread is listed by \c DS_GetThreads() while it runs
+ *    - The stack size can be set with \c DS_THREAD_STACK_SIZE (the default
+ *      stack of the platform is used if this is not defined, embedded builds
+ *      use a small stack, since the threads do not use much of it)
+ *
+ * \returns \c 0 on success, or an error code if the thread cannot start
+ */
+int DS_CreateThread (DS_Thread* thread, const char* name,
+                     void* (*func) (void*), void* arg)
+{
+#if defined DS_THREAD_STACK_SIZE
+    size_t stack = DS_THREAD_STACK_SIZE;
+#else
+    size_t stack = 0;
+#endif
+
+    ThreadEntry* entry = (ThreadEntry*) DS_CALLOC (DS_MEMORY_GENERAL, 1,
+                                                   sizeof (ThreadEntry));
+    if (!entry)
+        return ENOMEM;
+
+    entry->func = func;
+    entry->arg = arg;
+    strncpy (entry->info.name, name ? name : "LibDS",
+             sizeof (entry->info.name) - 1);
+
+#if defined _WIN32
+    *thread = (HANDLE) _beginthreadex (NULL, (unsigned) stack, &run_thread,
+                                       entry, 0, NULL);
+    if (!*thread) {
+        DS_FREE (entry);
+        return (int) GetLastError();
+    }
+
+    return 0;
+#else
+    int error;
+
+    if (!stack)
+        error = pthread_create (thread, NULL, &run_thread, entry);
+
+    else {
+#if defined PTHREAD_STACK_MIN
+        stack = DS_Max (stack, (size_t) PTHREAD_STACK_MIN);
+#endif
+
+        pthread_attr_t attr;
+        pthread_attr_init (&attr);
+        pthread_attr_setstacksize (&attr, stack);
+
+        error = pthread_create (thread, &attr, &run_thread, entry);
+        pthread_attr_destroy (&attr);
+    }
+
+    if (error)
+        DS_FREE (entry);
+
+    return error;
+#endif
+}
+
+/**
+ * Writes the name, ID and CPU time of the running LibDS threads to the
+ * given \a list (at most \a max threads are written), so that the CPU time
+ * of the LibDS can be attributed to its threads
+ *
+ * \returns the number of running LibDS threads (which may be greater than
+ *          \a max)
+ */
+int DS_GetThreads (DS_ThreadInfo* list, const int max)
+{
+    int count = 0;
+    ThreadEntry* entry;
+
+    DS_MutexLock (&threads_mutex);
+    for (entry = threads; entry; entry = entry->next) {
+        if (list && count < max) {
+            list [count] = entry->info;
+            list [count].cpu_time = thread_cpu_time (entry);
+        }
+
+        ++count;
+    }
+    DS_MutexUnlock (&threads_mutex);
+
+    return count;
+}
+
+/**
+ * Waits for the given \a thread to finish and releases it
+ */
+void DS_JoinThread (DS_Thread thread)
+{
+#if defined _WIN32
+    WaitForSingleObject (thread, INFINITE);
+    CloseHandle (thread);
+#else
+    pthread_join (thread, NULL);
+#endif
+}
+
+/**
+ * Releases the given \a thread without waiting for it, its resources are
+ * freed when it finishes
+ */
+void DS_DetachThread (DS_Thread thread)
+{
+#if defined _WIN32
+    CloseHandle (thread);
+#else
+    pthread_detach (thread);
+#endif
+}
+
+/**
+ * Calls \a func exactly once for the given \a once flag, even if several
+ * threads call this function at the same time
+ */
+void DS_CallOnce (DS_Once* once, void (*func) (void))
+{
+#if defined _WIN32
+    InitOnceExecuteOnce ((PINIT_ONCE) once, &run_once, &func, NULL);
+#else
+    pthread_once (once, func);
+#endif
+}
+
+/**
+ * Creates a key that holds a different value for each thread
+ */
+void DS_ThreadKeyCreate (DS_ThreadKey* key)
+{
+#if defined _WIN32
+    *key = TlsAlloc();
+#else
+    pthread_key_create (key, NULL);
+#endif
+}
+
+/**
+ * Returns the value of the given \a key for the calling thread
+ */
+void* DS_ThreadKeyGet (DS_ThreadKey key)
+{
+#if defined _WIN32
+    return TlsGetValue (key);
+#else
+    return pthread_getspecific (key);
+#endif
+}
+
+/**
+ * Changes the value of the given \a key for the calling thread
+ */
+void DS_ThreadKeySet (DS_ThreadKey key, void* value)
+{
+#if defined _WIN32
+    TlsSetValue (key, value);
+#else
+    pthread_setspecific (key, value);
+#endif
+}
+
+/**
+ * Raises the scheduling priority of the calling thread to a real-time
+ * priority (if \a enabled is set to \c 1), or restores the default priority:
+ *    - On Linux, the thread is scheduled with \c SCHED_FIFO (this requires
+ *      root privileges or the \c CAP_SYS_NICE capability)
+ *    - On Windows, the thread priority is set to time critical
+ *    - On macOS, the thread is assigned the user-interactive QoS class
+ *
+ * \returns \c 1 on success, \c 0 if the priority cannot be changed
+ */
+int DS_SetThreadRealtime (const int enabled)
+{
+#if defined _WIN32
+    int priority = enabled ? THREAD_PRIORITY_TIME_CRITICAL :
+                   THREAD_PRIORITY_NORMAL;
+    return SetThreadPriority (GetCurrentThread(), priority) != 0;
+#elif defined __APPLE__
+    qos_class_t qos = enabled ? QOS_CLASS_USER_INTERACTIVE : QOS_CLASS_DEFAULT;
+    return pthread_set_qos_class_self_np (qos, 0) == 0;
+#else
+    struct sched_param param;
+    int policy = enabled ? SCHED_FIFO : SCHED_OTHER;
+    param.sched_priority = enabled ? RT_PRIORITY : 0;
+    return pthread_setschedparam (pthread_self(), policy, &param) == 0;
+#endif
+}
+
+/**
+ * Pins the calling thread to the given \a cpu (starting from \c 0), or
+ * allows it to run on any CPU if \a cpu is negative.
+ *
+ * \note macOS does not support thread affinity, this function does nothing
+ *       on that platform
+ *
+ * \returns \c 1 on success, \c 0 if the affinity cannot be changed
+ */
+int DS_SetThreadAffinity (const int cpu)
+{
+#if defined _WIN32
+    DWORD_PTR mask;
+    DWORD_PTR system;
+
+    if (!GetProcessAffinityMask (GetCurrentProcess(), &mask, &system))
+        return 0;
+
+    if (cpu >= 0) {
+        if (cpu >= (int) (sizeof (DWORD_PTR) * 8))
+            return 0;
+
+        mask = (DWORD_PTR) 1 << cpu;
+    }
+
+    return SetThreadAffinityMask (GetCurrentThread(), mask) != 0;
+#elif defined __linux__
+    int i;
+    cpu_set_t set;
+    CPU_ZERO (&set);
+
+    if (cpu >= CPU_SETSIZE)
+        return 0;
+
+    if (cpu >= 0)
+        CPU_SET (cpu, &set);
+    else {
+        for (i = 0; i < CPU_SETSIZE; ++i)
+            CPU_SET (i, &set);
+    }
+
+    return sched_setaffinity (0, sizeof (set), &set) == 0;
+#else
+    (void) cpu;
+    return 0;
+#endif
+}
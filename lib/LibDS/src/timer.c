@@ -21,83 +21,773 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#if defined _WIN32
+    /* Condition variables and high-resolution timers need Windows Vista */
+    #if !defined _WIN32_WINNT || _WIN32_WINNT < 0x0600
+        #undef  _WIN32_WINNT
+        #define _WIN32_WINNT 0x0600
+    #endif
+#endif
+
 #include "DS_Utils.h"
-#include "DS_Array.h"
 #include "DS_Timer.h"
+#include "DS_Trace.h"
+#include "DS_Atomic.h"
+#include "DS_Socket.h"
+#include "DS_Context.h"
 
 #include <stdio.h>
 #include <assert.h>
 
 #if defined _WIN32
     #include <windows.h>
+    #include <mmsystem.h>
+#elif defined __APPLE__
+    #include <unistd.h>
+    #include <sys/time.h>
+    #include <mach/mach_time.h>
 #else
+    #include <time.h>
     #include <unistd.h>
+    #include <sys/time.h>
+#endif
+
+/*
+ * Maximum number of timers that can be registered with the timer thread,
+ * the library itself uses three of them for each DS context
+ */
+#define MAX_TIMERS 128
+
+/*
+ * Maximum number of periodic callbacks registered with \c DS_Schedule()
+ */
+#define MAX_SCHEDULES 64
+
+/*
+ * Time (in milliseconds) that the timer thread waits when there are no
+ * running timers, the thread is woken up earlier when a timer is started
+ */
+#define IDLE_WAIT 1000
+
+/*
+ * Maximum time (in real milliseconds) that \c DS_AdvanceClock() waits for
+ * the timer thread and the event loops to handle a step of the virtual clock
+ */
+#define QUIESCE_TIMEOUT 1000
+
+/*
+ * High resolution waitable timers are only declared by newer Windows SDKs,
+ * they are supported since Windows 10 (version 1803)
+ */
+#if defined _WIN32 && !defined CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+    #define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+/*
+ * Windows 11 ignores the timer period requested by a process while its
+ * windows are minimized or hidden (e.g. a DS in the background), unless the
+ * process opts out of this power throttling. These definitions are only
+ * available in newer Windows SDKs, so they are declared here.
+ */
+#if defined _WIN32
+    #define POWER_THROTTLING_CLASS    4   /* ProcessPowerThrottling */
+    #define POWER_THROTTLING_VERSION  1
+    #define POWER_THROTTLING_TIMER    0x4 /* Ignore timer resolution */
+
+    typedef struct {
+        ULONG version;
+        ULONG control_mask;
+        ULONG state_mask;
+    } PowerThrottlingState;
+
+    typedef BOOL (WINAPI* SetProcessInformationFunc) (HANDLE, int,
+                                                      LPVOID, DWORD);
 #endif
 
-static DS_Array timers;
+/*
+ * A periodic callback, it is run in the context that registered it
+ */
+typedef struct {
+    int id;
+    int period;
+    void* data;
+    uint64_t deadline;
+    DS_Context* context;
+    DS_ScheduleCallback callback;
+} Schedule;
+
 static int running = 0;
+static int timer_count = 0;
+static DS_Timer* timers [MAX_TIMERS];
+
+static int schedule_count = 0;
+static int next_schedule_id = 1;
+static Schedule schedules [MAX_SCHEDULES];
+
+/* The callback that is being run by the timer thread (if any) */
+static int current_id = 0;
+static DS_Context* current_context = NULL;
+
+static DS_Thread thread;
+static DS_Cond cond = DS_COND_INITIALIZER;
+static DS_Cond done_cond = DS_COND_INITIALIZER;
+static DS_Mutex mutex = DS_MUTEX_INITIALIZER;
+
+/*
+ * Virtual clock (see \c DS_SetVirtualClock()). The times are read without
+ * locking, the other fields are protected by the mutex:
+ *    - \c clock_offset is added to the real clock, so that the time keeps
+ *      increasing after the virtual clock is turned off
+ *    - \c wall_offset converts the virtual time to a wall time
+ *    - \c clock_step counts the steps, \c clock_threads is the number of
+ *      threads that follow the clock (the timer thread and the event loops)
+ *      and \c clock_idle the number of them that handled the current step
+ */
+static volatile size_t virtual_clock = 0;
+static volatile uint64_t virtual_time = 0;
+static volatile uint64_t clock_offset = 0;
+static volatile uint64_t wall_offset = 0;
+static size_t clock_step = 0;
+static size_t timer_step = 0;
+static int clock_threads = 0;
+static int clock_idle = 0;
+static DS_Cond clock_cond = DS_COND_INITIALIZER;
 
 /**
- * Updates the properties of the given \a timer
- * This function is called in a separate thread for each timer that we use.
- * This is **not** the best way to implement a timer, but its effective,
- * easy to understand and efficient. Also, this implementation does not need
- * to play with the kernel/OS to compare elapsed times periodically.
+ * Updates the elapsed time and expired state of every registered timer and
+ * returns the number of milliseconds until the next timer expires, or
+ * \c -1 if no timer is currently running. The mutex must be locked by the
+ * calling thread.
  */
-static void* update_timer (void* ptr)
+static int update_timers (void)
 {
-    assert (ptr);
-    DS_Timer* timer = (DS_Timer*) ptr;
+    int i;
+    int next = -1;
+    uint64_t now = DS_GetTimeMs();
 
-    while (running == 1) {
-        if (timer->enabled && timer->time > 0 && !timer->expired) {
-            timer->elapsed += timer->precision;
+    for (i = 0; i < timer_count; ++i) {
+        DS_Timer* timer = timers [i];
+
+        if (!timer->enabled || timer->time <= 0 || timer->expired)
+            continue;
+
+        timer->elapsed = (int) (now - timer->start);
+
+        if (timer->elapsed >= timer->time)
+            timer->expired = 1;
+
+        else {
+            int remaining = timer->time - timer->elapsed;
+            if (next < 0 || remaining < next)
+                next = remaining;
+        }
+    }
+
+    return next;
+}
+
+/**
+ * Returns \c 1 if the calling thread is the timer thread
+ */
+static int on_timer_thread (void)
+{
+#if defined _WIN32
+    return running && GetThreadId (thread) == GetCurrentThreadId();
+#else
+    return running && pthread_equal (thread, pthread_self());
+#endif
+}
+
+/**
+ * Removes the schedule at the given \a index. The mutex must be locked by
+ * the calling thread.
+ */
+static void remove_schedule (const int index)
+{
+    schedules [index] = schedules [--schedule_count];
+}
+
+/**
+ * Blocks until the timer thread is done with the callback for which
+ * \a busy returns \c 1, unless the callback is the caller itself. The
+ * mutex must be locked by the calling thread.
+ */
+static void wait_for_callback (int (*busy) (const void*), const void* arg)
+{
+    if (on_timer_thread())
+        return;
 
-            if (timer->elapsed >= timer->time)
-                timer->expired = 1;
+    while (busy (arg))
+        DS_CondWait (&done_cond, &mutex);
+}
+
+/**
+ * Runs the callbacks whose deadline has passed and returns the number of
+ * milliseconds until the next deadline, or \c -1 if there are no schedules.
+ * The mutex must be locked by the calling thread, it is released while a
+ * callback is running (so that it can use the timers or (un)schedule work).
+ */
+static int run_schedules (void)
+{
+    int i;
+    int next;
+    Schedule due;
+    uint64_t now;
+
+    for (;;) {
+        now = DS_GetTimeMs();
+
+        /* Find a callback that is due */
+        for (i = 0; i < schedule_count; ++i) {
+            if (schedules [i].deadline <= now)
+                break;
         }
 
-        DS_Sleep (timer->precision);
+        if (i >= schedule_count)
+            break;
+
+        /* Keep the cadence, unless we fell behind by a whole period */
+        schedules [i].deadline += schedules [i].period;
+        if (schedules [i].deadline <= now)
+            schedules [i].deadline = now + schedules [i].period;
+
+        due = schedules [i];
+        current_id = due.id;
+        current_context = due.context;
+        DS_MutexUnlock (&mutex);
+
+        DS_TRACE_BEGIN ("schedule");
+        DS_ContextMakeCurrent (due.context);
+        due.callback (due.data);
+        DS_TRACE_END ("schedule");
+
+        DS_MutexLock (&mutex);
+        current_id = 0;
+        current_context = NULL;
+        DS_CondBroadcast (&done_cond);
     }
 
+    next = -1;
+    for (i = 0; i < schedule_count; ++i) {
+        int remaining = (int) (schedules [i].deadline - now);
+        if (next < 0 || remaining < next)
+            next = remaining;
+    }
+
+    return next;
+}
+
+#if defined _WIN32
+/**
+ * Raises the timer period of the system to 1 ms (if \a enabled is set to
+ * \c 1) or restores it. The default period of Windows is 15.6 ms, which is
+ * also the granularity of every timed wait and socket poll, this would turn
+ * the 20 ms robot interval into ~31 ms.
+ */
+static void set_timer_resolution (const int enabled)
+{
+    if (!enabled) {
+        timeEndPeriod (1);
+        return;
+    }
+
+    timeBeginPeriod (1);
+
+    /* Keep the timer period when the windows of the DS are hidden */
+    HMODULE kernel = GetModuleHandleW (L"kernel32.dll");
+    SetProcessInformationFunc set_info = (SetProcessInformationFunc)
+                                         GetProcAddress (kernel,
+                                                         "SetProcessInformation");
+
+    if (set_info) {
+        PowerThrottlingState state;
+        state.version = POWER_THROTTLING_VERSION;
+        state.control_mask = POWER_THROTTLING_TIMER;
+        state.state_mask = 0;
+        set_info (GetCurrentProcess(), POWER_THROTTLING_CLASS,
+                  &state, sizeof (state));
+    }
+}
+#endif
+
+/**
+ * Counts the calling thread as idle if it handled the given \a step, which is
+ * the current step of the virtual clock. The \a acked step of the thread
+ * avoids counting it twice. The mutex must be locked by the calling thread.
+ *
+ * \returns \c 1 if the thread may wait, \c 0 if a newer step arrived
+ */
+static int clock_handled (const size_t step, size_t* acked)
+{
+    if (step != clock_step)
+        return 0;
+
+    if (*acked != step) {
+        *acked = step;
+        ++clock_idle;
+        DS_CondBroadcast (&clock_cond);
+    }
+
+    return 1;
+}
+
+/**
+ * Returns the time (in usecs) of the monotonic clock of the system
+ */
+static uint64_t real_time_us (void)
+{
+#if defined _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+
+    if (freq.QuadPart == 0)
+        QueryPerformanceFrequency (&freq);
+
+    /* Split the conversion to avoid overflows */
+    QueryPerformanceCounter (&count);
+    return (uint64_t) ((count.QuadPart / freq.QuadPart) * 1000000 +
+                       (count.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart);
+#elif defined __APPLE__
+    static mach_timebase_info_data_t info;
+
+    if (info.denom == 0)
+        mach_timebase_info (&info);
+
+    return mach_absolute_time() * info.numer / info.denom / 1000;
+#else
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+/**
+ * Returns the time (in usecs since the UNIX epoch) of the wall clock of the
+ * system
+ */
+static uint64_t real_wall_time_us (void)
+{
+#if defined _WIN32
+    FILETIME ft;
+    ULARGE_INTEGER now;
+    GetSystemTimeAsFileTime (&ft);
+    now.LowPart = ft.dwLowDateTime;
+    now.HighPart = ft.dwHighDateTime;
+
+    /* Convert from 100 ns units since 1601 to the UNIX epoch */
+    return (now.QuadPart - 116444736000000000ULL) / 10;
+#else
+    struct timeval tv;
+    gettimeofday (&tv, NULL);
+    return (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+/**
+ * Updates all the registered timers. Instead of waking up periodically, the
+ * thread sleeps until the closest deadline (or until a timer is started or
+ * reset, which may move that deadline).
+ */
+static void* run_timers (void* ptr)
+{
+    (void) ptr;
+
+    DS_TRACE_THREAD ("LibDS timers");
+    DS_MutexLock (&mutex);
+    ++clock_threads;
+
+    while (running == 1) {
+        size_t step = clock_step;
+        int next = run_schedules();
+        int timer = update_timers();
+
+        if (next < 0 || (timer >= 0 && timer < next))
+            next = timer;
+
+        /* A step of the virtual clock arrived while running the schedules */
+        if (!clock_handled (step, &timer_step))
+            continue;
+
+        DS_TimedWait (&cond, &mutex, next < 0 ? IDLE_WAIT : DS_Max (next, 1));
+    }
+
+    --clock_threads;
+    DS_CondBroadcast (&clock_cond);
+
+    DS_MutexUnlock (&mutex);
+
     return NULL;
 }
 
 /**
- * Initializes the timer array, which is used to keep track of all the timers
- * used by the library. We need to do this so that we can terminate each timer
- * thread once the module is closed.
+ * Starts the timer thread, which is used to update every timer registered
+ * with \c DS_TimerInit()
  */
 void Timers_Init (void)
 {
+    timer_count = 0;
     running = 1;
-    DS_ArrayInit (&timers, 10);
+
+    /* Use a 1 ms timer period while the LibDS is running */
+#if defined _WIN32
+    set_timer_resolution (1);
+#endif
+
+    /* Configure the thread */
+    int error = DS_CreateThread (&thread, "DS Timers", &run_timers, NULL);
+
+    /* Check if thread was started */
+    assert (!error);
 }
 
 /**
- * Breaks all the timer loops and stops every thread used by this module
+ * Stops the timer thread and un-registers all timers and schedules
  */
 void Timers_Close (void)
 {
+    /* The threads are stopped with the real clock */
+    DS_SetVirtualClock (0);
+
+    /* Wake the timer thread and wait for it to finish */
+    DS_MutexLock (&mutex);
     running = 0;
-    DS_ArrayFree (&timers);
+    DS_CondSignal (&cond);
+    DS_MutexUnlock (&mutex);
+    DS_JoinThread (thread);
+
+#if defined _WIN32
+    set_timer_resolution (0);
+#endif
+
+    /* Allow timers to be registered again */
+    int i;
+    for (i = 0; i < timer_count; ++i)
+        timers [i]->initialized = 0;
+
+    timer_count = 0;
+    schedule_count = 0;
+}
+
+/**
+ * Returns \c 1 while the timer thread runs a callback of the given
+ * \a context
+ */
+static int context_busy (const void* context)
+{
+    return current_context == context;
+}
+
+/**
+ * Un-registers the schedules of the current context, this is done when the
+ * context is closed. Returns once none of its callbacks is running.
+ */
+void Timers_CancelSchedules (void)
+{
+    int i;
+    DS_Context* context = DS_ContextCurrent();
+
+    DS_MutexLock (&mutex);
+
+    for (i = schedule_count - 1; i >= 0; --i) {
+        if (schedules [i].context == context)
+            remove_schedule (i);
+    }
+
+    wait_for_callback (&context_busy, context);
+    DS_MutexUnlock (&mutex);
 }
 
 /**
  * Pauses the execution state of the program/thread for the given
  * number of \a millisecs.
  *
- * We use this function to update each timer based on its precision
+ * On Windows, a high resolution waitable timer is used (if available), so
+ * that the sleep is not rounded up to the timer period of the system
+ *
+ * With the virtual clock, the thread is blocked until the clock has been
+ * advanced by the given time (see \c DS_AdvanceClock())
  */
 void DS_Sleep (const int millisecs)
 {
+    if (DS_AtomicLoad (&virtual_clock) && millisecs > 0) {
+        uint64_t until = DS_GetTimeUs() + (uint64_t) millisecs * 1000;
+
+        DS_MutexLock (&mutex);
+        while (DS_AtomicLoad (&virtual_clock) &&
+                DS_AtomicLoad64 (&virtual_time) < until)
+            DS_TimedWait (&clock_cond, &mutex, IDLE_WAIT);
+        DS_MutexUnlock (&mutex);
+
+        return;
+    }
+
 #if defined _WIN32
-    Sleep (millisecs);
+    if (millisecs <= 0) {
+        Sleep (0);
+        return;
+    }
+
+    HANDLE timer = CreateWaitableTimerExW (NULL, NULL,
+                                           CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                           TIMER_ALL_ACCESS);
+
+    if (timer) {
+        LARGE_INTEGER due;
+        due.QuadPart = -10000LL * millisecs;
+
+        if (SetWaitableTimer (timer, &due, 0, NULL, NULL, FALSE))
+            WaitForSingleObject (timer, INFINITE);
+
+        CloseHandle (timer);
+    }
+
+    else
+        Sleep (millisecs);
 #else
     usleep (millisecs * 1000);
 #endif
 }
 
+/**
+ * Returns the number of microseconds elapsed since an arbitrary point
+ * in time. The value is obtained from a monotonic clock, so it is not
+ * affected by changes to the system time and can be used to measure
+ * time intervals.
+ *
+ * While the virtual clock is used, the time only changes when the clock is
+ * advanced (see \c DS_SetVirtualClock())
+ */
+uint64_t DS_GetTimeUs (void)
+{
+    if (DS_AtomicLoad (&virtual_clock))
+        return DS_AtomicLoad64 (&virtual_time);
+
+    return real_time_us() + DS_AtomicLoad64 (&clock_offset);
+}
+
+/**
+ * Returns the number of milliseconds elapsed since an arbitrary point
+ * in time, obtained from the same monotonic clock as \c DS_GetTimeUs()
+ */
+uint64_t DS_GetTimeMs (void)
+{
+    return DS_GetTimeUs() / 1000;
+}
+
+/**
+ * Returns the number of microseconds elapsed since the UNIX epoch, obtained
+ * from the wall clock. Use \c DS_GetTimeUs() to measure time intervals.
+ *
+ * While the virtual clock is used, the wall time advances with it
+ */
+uint64_t DS_GetWallTimeUs (void)
+{
+    if (DS_AtomicLoad (&virtual_clock))
+        return DS_AtomicLoad64 (&virtual_time) + DS_AtomicLoad64 (&wall_offset);
+
+    return real_wall_time_us();
+}
+
+/**
+ * Makes the LibDS use a virtual clock (if \a enabled is set to \c 1) or
+ * the clock of the system (default). This is a process-wide setting.
+ *
+ * The virtual clock starts at the current time and only moves when it is
+ * advanced with \c DS_AdvanceClock(). The timers, schedules, watchdogs,
+ * send intervals and \c DS_Sleep() follow it, so that tests and simulators
+ * can run the DS faster (or slower) than in real time, with reproducible
+ * timing. Packets received from the network are still handled when they
+ * arrive.
+ *
+ * The clock goes on from the virtual time when it is turned off, and it is
+ * turned off when the last context is closed.
+ */
+void DS_SetVirtualClock (const int enabled)
+{
+    DS_MutexLock (&mutex);
+
+    if (enabled && !DS_AtomicLoad (&virtual_clock)) {
+        uint64_t now = DS_GetTimeUs();
+        DS_AtomicStore64 (&virtual_time, now);
+        DS_AtomicStore64 (&wall_offset, real_wall_time_us() - now);
+        DS_AtomicStore (&virtual_clock, 1);
+    }
+
+    else if (!enabled && DS_AtomicLoad (&virtual_clock)) {
+        DS_AtomicStore64 (&clock_offset, DS_AtomicLoad64 (&virtual_time) -
+                                         real_time_us());
+        DS_AtomicStore (&virtual_clock, 0);
+    }
+
+    DS_CondBroadcast (&cond);
+    DS_CondBroadcast (&clock_cond);
+    DS_MutexUnlock (&mutex);
+
+    DS_SocketWakeUp();
+}
+
+/**
+ * Returns \c 1 if the LibDS uses the virtual clock, \c 0 if not
+ */
+int DS_VirtualClock (void)
+{
+    return DS_AtomicLoad (&virtual_clock) != 0;
+}
+
+/**
+ * Advances the virtual clock by the given number of \a usecs, and returns
+ * once the timer thread and the event loops handled the new time (the
+ * expired timers and schedules, the packets that were due, the watchdogs...)
+ * and are waiting again. Tests can then check the state of the DS and take
+ * the next step.
+ *
+ * Large steps are taken at once, so use steps shorter than the send
+ * intervals to see every packet. Do not call this from a schedule or an
+ * event callback, which would wait for itself.
+ */
+void DS_AdvanceClock (const uint64_t usecs)
+{
+    if (!DS_AtomicLoad (&virtual_clock))
+        return;
+
+    DS_MutexLock (&mutex);
+    DS_AtomicStore64 (&virtual_time, DS_AtomicLoad64 (&virtual_time) + usecs);
+    ++clock_step;
+    clock_idle = 0;
+    DS_CondBroadcast (&cond);
+    DS_CondBroadcast (&clock_cond);
+    DS_MutexUnlock (&mutex);
+
+    /* Wake up the event loops */
+    DS_SocketWakeUp();
+
+    if (on_timer_thread())
+        return;
+
+    /* Wait until every thread that follows the clock handled the step */
+    DS_MutexLock (&mutex);
+    uint64_t deadline = real_time_us() + QUIESCE_TIMEOUT * 1000;
+    while (clock_idle < clock_threads && real_time_us() < deadline)
+        DS_TimedWait (&clock_cond, &mutex, 1);
+    DS_MutexUnlock (&mutex);
+}
+
+/**
+ * Registers the calling thread (an event loop) as a thread that follows
+ * the virtual clock, see \c Timers_ClockHandled()
+ */
+void Timers_ClockJoin (void)
+{
+    DS_MutexLock (&mutex);
+    ++clock_threads;
+    DS_MutexUnlock (&mutex);
+}
+
+/**
+ * Un-registers the calling thread, see \c Timers_ClockJoin()
+ */
+void Timers_ClockLeave (void)
+{
+    DS_MutexLock (&mutex);
+    --clock_threads;
+    DS_CondBroadcast (&clock_cond);
+    DS_MutexUnlock (&mutex);
+}
+
+/**
+ * Returns the current step of the virtual clock, a thread that follows the
+ * clock obtains it before it handles the current time
+ */
+size_t Timers_ClockStep (void)
+{
+    if (!DS_AtomicLoad (&virtual_clock))
+        return 0;
+
+    DS_MutexLock (&mutex);
+    size_t step = clock_step;
+    DS_MutexUnlock (&mutex);
+
+    return step;
+}
+
+/**
+ * Tells \c DS_AdvanceClock() that the calling thread handled the given
+ * \a step (see \c Timers_ClockStep()) and is about to wait, the \a acked
+ * step of the thread avoids counting it twice
+ *
+ * \returns \c 1 if the thread may wait, \c 0 if the clock was advanced
+ *          again meanwhile (the thread must handle the new time first)
+ */
+int Timers_ClockHandled (const size_t step, size_t* acked)
+{
+    assert (acked);
+
+    if (!DS_AtomicLoad (&virtual_clock))
+        return 1;
+
+    DS_MutexLock (&mutex);
+    int handled = clock_handled (step, acked);
+    DS_MutexUnlock (&mutex);
+
+    return handled;
+}
+
+/**
+ * Blocks the calling thread until the given \a cond is signaled or the
+ * given number of \a millisecs have passed. The \a mutex must be locked by
+ * the calling thread.
+ *
+ * On POSIX systems, the absolute timeout is expressed using the wall clock
+ * (as required by \c pthread_cond_timedwait), but this is only used to
+ * limit the waiting time, time intervals should always be measured with
+ * \c DS_GetTimeMs()
+ */
+void DS_TimedWait (DS_Cond* cond, DS_Mutex* mutex, const int millisecs)
+{
+    assert (cond);
+    assert (mutex);
+
+#if defined _WIN32
+    SleepConditionVariableSRW ((PCONDITION_VARIABLE) cond, (PSRWLOCK) mutex,
+                               (DWORD) DS_Max (millisecs, 0), 0);
+#else
+    struct timespec abstime;
+    uint64_t usecs = real_wall_time_us();
+
+    usecs += (uint64_t) DS_Max (millisecs, 0) * 1000;
+    abstime.tv_sec = usecs / 1000000;
+    abstime.tv_nsec = (usecs % 1000000) * 1000;
+
+    pthread_cond_timedwait (cond, mutex, &abstime);
+#endif
+}
+
+/**
+ * Updates the expired state of the given \a timer and returns the number of
+ * milliseconds left until it expires.
+ *
+ * \returns \c 0 if the timer has expired, \c -1 if the timer is not running
+ */
+int DS_TimerRemaining (DS_Timer* timer)
+{
+    assert (timer);
+
+    int remaining = -1;
+    DS_MutexLock (&mutex);
+
+    if (timer->enabled && timer->time > 0) {
+        if (!timer->expired) {
+            timer->elapsed = (int) (DS_GetTimeMs() - timer->start);
+            timer->expired = (timer->elapsed >= timer->time);
+        }
+
+        remaining = timer->expired ? 0 : timer->time - timer->elapsed;
+    }
+
+    DS_MutexUnlock (&mutex);
+    return remaining;
+}
+
 /**
  * Resets and disables the given \a timer
  */
@@ -105,9 +795,11 @@ void DS_TimerStop (DS_Timer* timer)
 {
     assert (timer);
 
+    DS_MutexLock (&mutex);
     timer->enabled = 0;
     timer->expired = 0;
     timer->elapsed = 0;
+    DS_MutexUnlock (&mutex);
 }
 
 /**
@@ -117,32 +809,53 @@ void DS_TimerStart (DS_Timer* timer)
 {
     assert (timer);
 
+    DS_MutexLock (&mutex);
     timer->enabled = 1;
     timer->expired = 0;
     timer->elapsed = 0;
+    timer->start = DS_GetTimeMs();
+    DS_CondSignal (&cond);
+    DS_MutexUnlock (&mutex);
 }
 
 /**
- * Resets the elapsed time and expired state of the given \a timer
+ * Resets the elapsed time and expired state of the given \a timer.
+ *
+ * If the timer has already expired, the new period is counted from the
+ * previous deadline (and not from the current time), so that periodic
+ * timers (e.g. the packet senders) keep a steady cadence even if the
+ * reset is done a couple of milliseconds late. If we fell behind by more
+ * than a whole period, we do not try to catch up and start over instead.
  */
 void DS_TimerReset (DS_Timer* timer)
 {
     assert (timer);
 
+    DS_MutexLock (&mutex);
+
+    uint64_t now = DS_GetTimeMs();
+    uint64_t deadline = timer->start + timer->time;
+
+    if (timer->expired && timer->time > 0 && now < deadline + timer->time)
+        timer->start = deadline;
+    else
+        timer->start = now;
+
     timer->expired = 0;
-    timer->elapsed = 0;
+    timer->elapsed = (int) (now - timer->start);
+
+    DS_CondSignal (&cond);
+    DS_MutexUnlock (&mutex);
 }
 
 /**
- * Initializes the given \a timer with the given \a time and \a precision.
- * The timers are updated using a threaded while loop (that sleeps the number
- * of milliseconds specified with \a precision). As stated before, this is
- * probably not the best timer implementation out there, but its simple and
- * it works perfectly for this library.
+ * Initializes the given \a timer with the given \a time and \a precision and
+ * registers it with the timer thread.
  *
- * A word of advice, using a higher \a precision (lower value in msecs) will
- * result in increased CPU usage, this thing does not have morals and will eat
- * the whole cake if you allow it.
+ * All timers are updated by a single thread, which computes the elapsed time
+ * of each timer with a monotonic clock and sleeps until the next deadline.
+ * The \a precision is kept only for compatibility, it no longer affects how
+ * often the timer is updated.
  */
 void DS_TimerInit (DS_Timer* timer, const int time, const int precision)
 {
@@ -153,7 +866,10 @@ void DS_TimerInit (DS_Timer* timer, const int time, const int precision)
     if (timer->initialized)
         return;
 
+    DS_MutexLock (&mutex);
+
     /* Configure the timer */
+    timer->start = 0;
     timer->enabled = 0;
     timer->expired = 0;
     timer->elapsed = 0;
@@ -161,11 +877,117 @@ void DS_TimerInit (DS_Timer* timer, const int time, const int precision)
     timer->initialized = 1;
     timer->precision = precision;
 
-    /* Configure the thread */
-    pthread_t thread;
-    int error = pthread_create (&thread, NULL,
-                                &update_timer, (void*) timer);
+    /* Register the timer with the timer thread */
+    assert (timer_count < MAX_TIMERS);
+    timers [timer_count++] = timer;
 
-    /* Check if thread was started */
-    assert (!error);
+    DS_MutexUnlock (&mutex);
+}
+
+/**
+ * Un-registers the given \a timer from the timer thread, this must be done
+ * before the memory of the timer is de-allocated (unless the timer thread
+ * is already closed)
+ */
+void DS_TimerFree (DS_Timer* timer)
+{
+    int i;
+
+    assert (timer);
+
+    DS_MutexLock (&mutex);
+
+    for (i = 0; i < timer_count; ++i) {
+        if (timers [i] == timer) {
+            timers [i] = timers [--timer_count];
+            break;
+        }
+    }
+
+    timer->enabled = 0;
+    timer->initialized = 0;
+
+    DS_MutexUnlock (&mutex);
+}
+
+/**
+ * Runs the given \a callback (with the given \a data) every \a period
+ * milliseconds on the timer thread, the first call is done after one period.
+ *
+ * This allows custom protocols and applications to run periodic work on the
+ * shared timer thread instead of creating more sleeping threads. The
+ * callback is run with the current context of the caller selected, it
+ * should return quickly, as the timers and the other callbacks are not
+ * updated while it runs. If the thread falls behind by more than a period,
+ * the missed calls are skipped.
+ *
+ * The schedules of a context are removed when it is closed.
+ *
+ * \returns an identifier for \c DS_Unschedule(), or \c 0 if there are
+ *          too many schedules
+ */
+int DS_Schedule (const int period, DS_ScheduleCallback callback, void* data)
+{
+    int id = 0;
+
+    /* Check arguments */
+    assert (period > 0);
+    assert (callback);
+
+    DS_MutexLock (&mutex);
+
+    if (schedule_count < MAX_SCHEDULES) {
+        Schedule* schedule = &schedules [schedule_count++];
+
+        id = next_schedule_id++;
+        if (next_schedule_id <= 0)
+            next_schedule_id = 1;
+
+        schedule->id = id;
+        schedule->data = data;
+        schedule->period = period;
+        schedule->callback = callback;
+        schedule->context = DS_ContextCurrent();
+        schedule->deadline = DS_GetTimeMs() + period;
+
+        /* The new deadline may be closer than the one of the timer thread */
+        DS_CondSignal (&cond);
+    }
+
+    DS_MutexUnlock (&mutex);
+    return id;
+}
+
+/**
+ * Returns \c 1 while the timer thread runs the callback with the given \a id
+ */
+static int schedule_busy (const void* id)
+{
+    return current_id == *((const int*) id);
+}
+
+/**
+ * Stops the periodic callback with the given \a id (as returned by
+ * \c DS_Schedule()). When this function returns, the callback is not running
+ * and will not be called again, so its data can be released. Unknown (or
+ * already removed) identifiers are ignored.
+ */
+void DS_Unschedule (const int id)
+{
+    int i;
+
+    if (id <= 0)
+        return;
+
+    DS_MutexLock (&mutex);
+
+    for (i = 0; i < schedule_count; ++i) {
+        if (schedules [i].id == id) {
+            remove_schedule (i);
+            break;
+        }
+    }
+
+    wait_for_callback (&schedule_busy, &id);
+    DS_MutexUnlock (&mutex);
 }
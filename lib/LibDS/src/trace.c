@@ -0,0 +1,322 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Utils.h"
+#include "DS_Timer.h"
+#include "DS_Trace.h"
+#include "DS_Atomic.h"
+#include "DS_Thread.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define NAME_SIZE 32 /* Maximum size of a thread name */
+
+/*
+ * A recorded event, the name is a string literal of the instrumented code
+ */
+typedef struct {
+    uint64_t time;
+    const char* name;
+    char phase;
+} TraceEvent;
+
+/*
+ * Events of a thread. Only the owner thread writes the buffer: it stores
+ * the event and then publishes the new count, so the buffer can be read
+ * without locking (events that were overwritten while they were being
+ * copied are discarded). The buffer is reset by its owner when it sees
+ * that a new trace was started.
+ */
+typedef struct {
+    volatile size_t count;
+    volatile size_t generation;
+    int tid;
+    char name [NAME_SIZE];
+    TraceEvent events [DS_TRACE_BUFFER_EVENTS];
+} TraceBuffer;
+
+/*
+ * Buffers are shared by all the DS contexts and are kept until the process
+ * exits (a thread may record events at any time). The mutex protects the
+ * registration of new buffers and the thread names.
+ */
+static volatile size_t tracing = 0;
+static volatile size_t generation = 0;
+static volatile size_t buffer_count = 0;
+static TraceBuffer* buffers [DS_TRACE_MAX_THREADS];
+static DS_Mutex mutex = DS_MUTEX_INITIALIZER;
+
+/*
+ * Thread-specific buffer and name (which may be set before the buffer is
+ * created)
+ */
+static DS_ThreadKey buffer_key;
+static DS_ThreadKey name_key;
+static DS_Once key_once = DS_ONCE_INIT;
+
+/**
+ * Creates the thread-specific keys
+ */
+static void create_keys (void)
+{
+    DS_ThreadKeyCreate (&buffer_key);
+    DS_ThreadKeyCreate (&name_key);
+}
+
+/**
+ * Copies the given thread \a name into the \a buffer
+ *
+ * \note The mutex must be locked
+ */
+static void set_buffer_name (TraceBuffer* buffer, const char* name)
+{
+    if (name)
+        snprintf (buffer->name, sizeof (buffer->name), "%s", name);
+    else
+        snprintf (buffer->name, sizeof (buffer->name), "Thread %d",
+                  buffer->tid);
+}
+
+/**
+ * Returns the buffer of the calling thread, the buffer is created the
+ * first time that the thread records an event
+ *
+ * \returns the buffer, or \c NULL if too many threads are traced
+ */
+static TraceBuffer* thread_buffer (void)
+{
+    DS_CallOnce (&key_once, create_keys);
+
+    TraceBuffer* buffer = (TraceBuffer*) DS_ThreadKeyGet (buffer_key);
+    if (buffer || DS_AtomicLoad (&buffer_count) >= DS_TRACE_MAX_THREADS)
+        return buffer;
+
+    DS_MutexLock (&mutex);
+    if (buffer_count < DS_TRACE_MAX_THREADS) {
+        buffer = (TraceBuffer*) DS_CALLOC (DS_MEMORY_GENERAL, 1,
+                                           sizeof (TraceBuffer));
+        if (buffer) {
+            buffer->tid = (int) buffer_count + 1;
+            buffer->generation = DS_AtomicLoad (&generation);
+            set_buffer_name (buffer, (const char*) DS_ThreadKeyGet (name_key));
+
+            buffers [buffer_count] = buffer;
+            DS_AtomicStore (&buffer_count, buffer_count + 1);
+        }
+    }
+    DS_MutexUnlock (&mutex);
+
+    DS_ThreadKeySet (buffer_key, buffer);
+    return buffer;
+}
+
+/**
+ * Writes the given string to the \a file as a JSON string
+ */
+static void write_string (FILE* file, const char* str)
+{
+    fputc ('"', file);
+    for (; *str; ++str) {
+        if (*str == '"' || *str == '\\')
+            fprintf (file, "\\%c", *str);
+        else if ((unsigned char) *str < 0x20)
+            fprintf (file, "\\u%04x", (unsigned char) *str);
+        else
+            fputc (*str, file);
+    }
+    fputc ('"', file);
+}
+
+/**
+ * Writes the events of the given \a buffer to the \a file as Chrome trace
+ * events (after the name of the thread). The events are copied to the
+ * \a copy array first, so that the buffer can be written while it is
+ * being saved.
+ *
+ * \returns \c 1 if the buffer was written, \c 0 if it has no events
+ */
+static int write_buffer (FILE* file, TraceBuffer* buffer,
+                         TraceEvent* copy, const int first)
+{
+    size_t i;
+
+    /* Buffer was not used during this trace */
+    if (DS_AtomicLoad (&buffer->generation) != DS_AtomicLoad (&generation))
+        return 0;
+
+    /* Copy the events that are still in the ring */
+    size_t end = DS_AtomicLoad (&buffer->count);
+    size_t begin = (end > DS_TRACE_BUFFER_EVENTS) ?
+                   end - DS_TRACE_BUFFER_EVENTS : 0;
+    for (i = begin; i < end; ++i)
+        copy [i - begin] = buffer->events [i % DS_TRACE_BUFFER_EVENTS];
+
+    /* Skip the events that were overwritten during the copy */
+    size_t skip = 0;
+    size_t now = DS_AtomicLoad (&buffer->count);
+    if (now > begin + DS_TRACE_BUFFER_EVENTS)
+        skip = DS_Min (now - begin - DS_TRACE_BUFFER_EVENTS, end - begin);
+
+    /* Write the thread name */
+    DS_MutexLock (&mutex);
+    fprintf (file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+             "\"tid\":%d,\"args\":{\"name\":", first ? "" : ",", buffer->tid);
+    write_string (file, buffer->name);
+    fprintf (file, "}}");
+    DS_MutexUnlock (&mutex);
+
+    /* Write the events */
+    for (i = skip; i < end - begin; ++i) {
+        fprintf (file, ",\n{\"name\":");
+        write_string (file, copy [i].name);
+        fprintf (file, ",\"ph\":\"%c\",\"ts\":%llu,\"pid\":1,\"tid\":%d%s}",
+                 copy [i].phase, (unsigned long long) copy [i].time,
+                 buffer->tid, (copy [i].phase == 'i') ? ",\"s\":\"t\"" : "");
+    }
+
+    return 1;
+}
+
+/**
+ * Discards the recorded events and starts recording the events of the
+ * instrumented code (see \c DS_TRACE_BEGIN()), which is only compiled in
+ * builds that define \c DS_ENABLE_TRACE. Tracing is global, it records the
+ * threads of every DS context (and of the application, if it is also
+ * instrumented).
+ */
+void DS_StartTrace (void)
+{
+    DS_AtomicFetchAdd (&generation, 1);
+    DS_AtomicStore (&tracing, 1);
+}
+
+/**
+ * Stops recording events, the recorded events are kept until the next
+ * trace is started
+ */
+void DS_StopTrace (void)
+{
+    DS_AtomicStore (&tracing, 0);
+}
+
+/**
+ * Returns \c 1 if the events are being recorded
+ */
+int DS_TraceActive (void)
+{
+    return (int) DS_AtomicLoad (&tracing);
+}
+
+/**
+ * Saves the recorded events to the given \a path in the Chrome trace event
+ * format (JSON), which can be opened with chrome://tracing or with the
+ * Perfetto UI. The trace may be saved while it is being recorded.
+ *
+ * \returns \c 1 on success, \c 0 on failure
+ */
+int DS_SaveTrace (const char* path)
+{
+    size_t i;
+    int first = 1;
+
+    if (!path)
+        return 0;
+
+    FILE* file = fopen (path, "w");
+    if (!file)
+        return 0;
+
+    TraceEvent* copy = (TraceEvent*) DS_MALLOC (DS_MEMORY_GENERAL,
+                       sizeof (TraceEvent) * DS_TRACE_BUFFER_EVENTS);
+    if (!copy) {
+        fclose (file);
+        return 0;
+    }
+
+    fprintf (file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    size_t count = DS_AtomicLoad (&buffer_count);
+    for (i = 0; i < count; ++i) {
+        if (write_buffer (file, buffers [i], copy, first))
+            first = 0;
+    }
+
+    fprintf (file, "\n]}\n");
+    DS_FREE (copy);
+
+    return fclose (file) == 0;
+}
+
+/**
+ * Changes the name of the calling thread in the saved traces
+ *
+ * \param name the name of the thread, it must remain valid while the
+ *             thread runs (e.g. a string literal)
+ */
+void DS_TraceThreadName (const char* name)
+{
+    DS_CallOnce (&key_once, create_keys);
+    DS_ThreadKeySet (name_key, (void*) name);
+
+    TraceBuffer* buffer = (TraceBuffer*) DS_ThreadKeyGet (buffer_key);
+    if (buffer) {
+        DS_MutexLock (&mutex);
+        set_buffer_name (buffer, name);
+        DS_MutexUnlock (&mutex);
+    }
+}
+
+/**
+ * Records an event of the calling thread (if tracing is active), use the
+ * \c DS_TRACE_BEGIN(), \c DS_TRACE_END() and \c DS_TRACE_INSTANT() macros
+ * instead of calling this function directly
+ *
+ * \param name the name of the event (a string literal)
+ * \param phase the phase of the event, \c 'B' (begin), \c 'E' (end) or
+ *              \c 'i' (instant)
+ */
+void DS_TraceEvent (const char* name, const char phase)
+{
+    if (!DS_AtomicLoad (&tracing))
+        return;
+
+    TraceBuffer* buffer = thread_buffer();
+    if (!buffer)
+        return;
+
+    /* A new trace was started, discard the old events */
+    size_t current = DS_AtomicLoad (&generation);
+    if (buffer->generation != current) {
+        DS_AtomicStore (&buffer->count, 0);
+        DS_AtomicStore (&buffer->generation, current);
+    }
+
+    /* Write the event and publish it */
+    size_t count = buffer->count;
+    TraceEvent* event = &buffer->events [count % DS_TRACE_BUFFER_EVENTS];
+    event->time = DS_GetTimeUs();
+    event->name = name;
+    event->phase = phase;
+    DS_AtomicStore (&buffer->count, count + 1);
+}
@@ -28,6 +28,14 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+    #define DS_USE_SSE2
+    #include <emmintrin.h>
+#elif defined __ARM_NEON || defined __ARM_NEON__
+    #define DS_USE_NEON
+    #include <arm_neon.h>
+#endif
+
 #ifdef _WIN32
     #include <windows.h>
     #ifndef __MINGW32__
@@ -35,20 +43,123 @@
     #endif
 #endif
 
+/**
+ * Quantizes a single \a value that has already been multiplied by the
+ * scale factor. The value is saturated to [-127, 127] and rounded to the
+ * nearest integer (halfway cases are rounded away from zero).
+ */
+static uint8_t quantize (float value)
+{
+    if (value != value)
+        return 0;
+
+    if (value > 127)
+        value = 127;
+    else if (value < -127)
+        value = -127;
+
+    value += (value < 0) ? -0.5f : 0.5f;
+    return (uint8_t) ((int) value & 0xFF);
+}
+
 /**
  * Returns a single byte value that represents the ratio between the
  * given \a value and the maximum number specified.
+ *
+ * The ratio is encoded as a signed byte, so that \c -max becomes \c -127
+ * (\c 0x81), \c 0 becomes \c 0 and \c max becomes \c 127 (\c 0x7F).
+ * Values outside of the [-max, max] range are saturated.
  */
 uint8_t DS_FloatToByte (const float value, const float max)
 {
-    if (value != 0 && max != 0 && value <= max) {
-        int percent = (int) (value / max) * (0xFF / 2);
-        return (uint8_t) (percent & 0xFF);
-    }
+    if (max != 0)
+        return quantize (value * (127 / max));
 
     return 0;
 }
 
+/**
+ * Converts \a count floating point \a values to bytes in the same way as
+ * \c DS_FloatToByte(), writing the results to the \a bytes array.
+ *
+ * SSE2 or NEON instructions are used (when available) to convert four
+ * values at a time, the results are identical to the scalar implementation.
+ */
+void DS_FloatsToBytes (const float* values, uint8_t* bytes,
+                       const size_t count, const float max)
+{
+    size_t i = 0;
+
+    /* Check arguments */
+    assert (values);
+    assert (bytes);
+
+    /* Avoid dividing by zero */
+    if (max == 0) {
+        memset (bytes, 0, count);
+        return;
+    }
+
+    /* Get scale factor */
+    const float scale = 127 / max;
+
+#if defined DS_USE_SSE2
+    const __m128 vscale = _mm_set1_ps (scale);
+    const __m128 vupper = _mm_set1_ps (127);
+    const __m128 vlower = _mm_set1_ps (-127);
+    const __m128 vhalf = _mm_set1_ps (0.5f);
+    const __m128 vsign = _mm_set1_ps (-0.0f);
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 v = _mm_mul_ps (_mm_loadu_ps (values + i), vscale);
+
+        /* Replace NaNs with 0 and saturate */
+        v = _mm_and_ps (v, _mm_cmpord_ps (v, v));
+        v = _mm_min_ps (_mm_max_ps (v, vlower), vupper);
+
+        /* Round away from zero and truncate */
+        v = _mm_add_ps (v, _mm_or_ps (vhalf, _mm_and_ps (v, vsign)));
+        __m128i n = _mm_cvttps_epi32 (v);
+
+        /* Narrow to signed bytes */
+        n = _mm_packs_epi32 (n, n);
+        n = _mm_packs_epi16 (n, n);
+
+        int32_t packed = _mm_cvtsi128_si32 (n);
+        memcpy (bytes + i, &packed, 4);
+    }
+#elif defined DS_USE_NEON
+    const float32x4_t vscale = vdupq_n_f32 (scale);
+    const float32x4_t vupper = vdupq_n_f32 (127);
+    const float32x4_t vlower = vdupq_n_f32 (-127);
+    const uint32x4_t vhalf = vreinterpretq_u32_f32 (vdupq_n_f32 (0.5f));
+    const uint32x4_t vsign = vdupq_n_u32 (0x80000000);
+
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t v = vmulq_f32 (vld1q_f32 (values + i), vscale);
+
+        /* Replace NaNs with 0 and saturate */
+        uint32x4_t bits = vandq_u32 (vreinterpretq_u32_f32 (v), vceqq_f32 (v, v));
+        v = vminq_f32 (vmaxq_f32 (vreinterpretq_f32_u32 (bits), vlower), vupper);
+
+        /* Round away from zero and truncate */
+        uint32x4_t half = vorrq_u32 (vhalf, vandq_u32 (vreinterpretq_u32_f32 (v), vsign));
+        int32x4_t n = vcvtq_s32_f32 (vaddq_f32 (v, vreinterpretq_f32_u32 (half)));
+
+        /* Narrow to signed bytes */
+        int16x4_t n16 = vqmovn_s32 (n);
+        int8x8_t n8 = vqmovn_s16 (vcombine_s16 (n16, n16));
+
+        int32_t packed = vget_lane_s32 (vreinterpret_s32_s8 (n8), 0);
+        memcpy (bytes + i, &packed, 4);
+    }
+#endif
+
+    /* Convert the remaining values */
+    for (; i < count; ++i)
+        bytes [i] = quantize (values [i] * scale);
+}
+
 /**
  * Returns a string in the format of NET.TE.AM.HOST, examples include
  *    - \c DS_GetStaticIP (10, 3794, 2) will return \c 10.37.94.2
@@ -91,8 +202,10 @@ void DS_ShowMessageBox (const DS_String* caption,
 
 #ifdef _WIN32
     /* Convert strings to wstrings */
-    wchar_t* wcap = calloc (caption->len + 1, sizeof (wchar_t));
-    wchar_t* wmsg = calloc (message->len + 1, sizeof (wchar_t));
+    wchar_t* wcap = DS_CALLOC (DS_MEMORY_GENERAL,
+                               caption->len + 1, sizeof (wchar_t));
+    wchar_t* wmsg = DS_CALLOC (DS_MEMORY_GENERAL,
+                               message->len + 1, sizeof (wchar_t));
     mbstowcs_s (NULL, wcap, caption->len + 1, ccap, caption->len);
     mbstowcs_s (NULL, wmsg, message->len + 1, cmsg, message->len);
 
@@ -139,9 +252,6 @@ void DS_ShowMessageBox (const DS_String* caption,
 
     /* Log message to stderr */
     fprintf (stderr, "%s: %s\n", cico, cmsg);
-
-    /* Free icon text memory */
-    DS_FREE (cico);
 #endif
 
     /* Free resources */
@@ -21,18 +21,381 @@
  */
 
 #include "DriverStation.h"
+#include "EventThread.h"
+#include "Hotkeys.h"
+#include "Robot.h"
 
 #include <math.h>
 #include <LibDS.h>
 
-#include <QTime>
+#include <QDir>
 #include <QTimer>
+#include <QLibrary>
+#include <QSettings>
+#include <QVector>
+#include <QDateTime>
 #include <QDebug>
+#include <QPointF>
 #include <QHostAddress>
 #include <QApplication>
+#include <QtConcurrent>
+
+#if defined Q_OS_WIN
+    #include <QWinEventNotifier>
+#else
+    #include <QSocketNotifier>
+#endif
 
 #define LOG qDebug() << "DS Client:"
 
+/*
+ * Maximum number of NetConsole lines that are read in a single batch and
+ * in a single call to DriverStation::readNetConsole()
+ */
+#define NETCONSOLE_BATCH 256
+#define NETCONSOLE_LIMIT 4096
+#define DASHBOARD_BATCH  32
+
+/*
+ * Minimum time between two telemetry frames (one frame at 60 Hz)
+ */
+#define FRAME_INTERVAL 16
+
+/*
+ * Minimum time between two telemetry frames (and two emissions of the
+ * robot telemetry signals) while the UI is in the background (2 Hz)
+ */
+#define BACKGROUND_INTERVAL 500
+
+/*
+ * Time between two updates of the network usage properties
+ */
+#define NETWORK_USAGE_INTERVAL 1000
+
+/*
+ * Time without changes to the team number or the custom addresses after
+ * which they are applied (so that they are not applied on every keystroke)
+ */
+#define CONFIG_DEBOUNCE 500
+
+/**
+ * Converts the given \a string (allocated by the LibDS) to a \c QString
+ * and de-allocates it
+ */
+static QString takeString (char* string)
+{
+    QString copy = QString::fromUtf8 (string);
+    DS_FREE (string);
+    return copy;
+}
+
+/**
+ * Returns the name of the given LibDS \a status, the names are converted
+ * to \c QString once and shared by every status change
+ */
+static const QString& statusName (const DS_Status status)
+{
+    static const QVector<QString> names = []() {
+        QVector<QString> list;
+        for (int i = 0; i < DS_STATUS_COUNT; ++i)
+            list.append (QString::fromUtf8 (DS_GetStatusName ((DS_Status) i)));
+        return list;
+    }();
+
+    return names.at (qBound (0, (int) status, DS_STATUS_COUNT - 1));
+}
+
+/**
+ * Returns the settings key in which the last known robot address of the
+ * given \a protocol and the current team number is stored
+ */
+static QString knownAddressKey (const DS_Protocol& protocol)
+{
+    QString name = QString::fromUtf8 (protocol.name.buf,
+                                      (int) protocol.name.len);
+    return QString ("LibDS/KnownRobotAddresses/%1/%2")
+           .arg (name.replace ('/', '_'))
+           .arg (DS_GetTeamNumber());
+}
+
+/**
+ * Converts the given latency \a info (in microseconds) to a map with the
+ * round-trip, jitter, lateness and send period percentiles (in milliseconds)
+ * and the number of missed send deadlines
+ */
+static QVariantMap latencyMap (const DS_LatencyInfo& info)
+{
+    QVariantMap map;
+
+    map.insert ("roundTripP50", info.round_trip.p50 / 1000.0);
+    map.insert ("roundTripP99", info.round_trip.p99 / 1000.0);
+    map.insert ("roundTripMax", info.round_trip.max / 1000.0);
+    map.insert ("jitterP50",    info.jitter.p50 / 1000.0);
+    map.insert ("jitterP99",    info.jitter.p99 / 1000.0);
+    map.insert ("jitterMax",    info.jitter.max / 1000.0);
+    map.insert ("latenessP50",  info.lateness.p50 / 1000.0);
+    map.insert ("latenessP99",  info.lateness.p99 / 1000.0);
+    map.insert ("latenessMax",  info.lateness.max / 1000.0);
+    map.insert ("periodP50",    info.period.p50 / 1000.0);
+    map.insert ("periodP99",    info.period.p99 / 1000.0);
+    map.insert ("periodMax",    info.period.max / 1000.0);
+    map.insert ("deadlineMisses", info.deadline_misses);
+    map.insert ("samples",      info.round_trip.samples);
+
+    return map;
+}
+
+/**
+ * Converts the reboot/restart statistics of the given \a kind to a map with
+ * the request counts and the percentiles (in milliseconds) of the time until
+ * the robot code came back and of the time that the robot was dark
+ */
+static QVariantMap lifecycleMap (const DS_LifecycleKind kind)
+{
+    QVariantMap map;
+    DS_LifecycleStats stats;
+    DS_GetLifecycleStats (kind, &stats);
+
+    map.insert ("requests",  stats.requests);
+    map.insert ("completed", stats.completed);
+    map.insert ("failed",    stats.failed);
+    map.insert ("totalP50",  stats.total.p50);
+    map.insert ("totalP99",  stats.total.p99);
+    map.insert ("totalMax",  stats.total.max);
+    map.insert ("outageP50", stats.outage.p50);
+    map.insert ("outageP99", stats.outage.p99);
+    map.insert ("outageMax", stats.outage.max);
+
+    return map;
+}
+
+/**
+ * Converts the given match \a summary to a map, the times are given in
+ * milliseconds and the voltages in volts
+ */
+static QVariantMap matchMap (const DS_MatchSummary& summary)
+{
+    QVariantMap map;
+
+    map.insert ("matchType",     (int) summary.match_type);
+    map.insert ("matchNumber",   summary.match_number);
+    map.insert ("replayNumber",  summary.replay_number);
+    map.insert ("duration",      summary.duration);
+    map.insert ("minVoltage",    summary.min_voltage);
+    map.insert ("avgVoltage",    summary.avg_voltage);
+    map.insert ("brownouts",     summary.brownouts);
+    map.insert ("commsDrops",    summary.comms_drops);
+    map.insert ("commsLostTime", summary.comms_lost_time);
+    map.insert ("sentPackets",   summary.sent);
+    map.insert ("lostPackets",   summary.lost);
+    map.insert ("packetLoss",    summary.packet_loss);
+    map.insert ("latencyP50",    summary.latency.p50 / 1000.0);
+    map.insert ("latencyP99",    summary.latency.p99 / 1000.0);
+    map.insert ("latencyMax",    summary.latency.max / 1000.0);
+    map.insert ("maxCpuUsage",   summary.max_cpu);
+    map.insert ("maxCanUsage",   summary.max_can);
+
+    return map;
+}
+
+/**
+ * Converts the given network usage \a info to a map with the sent/received
+ * bytes and packets and their rates (per second)
+ */
+static QVariantMap trafficMap (const DS_TrafficInfo& info)
+{
+    QVariantMap map;
+
+    map.insert ("sentBytes",          (quint64) info.sent_bytes);
+    map.insert ("receivedBytes",      (quint64) info.received_bytes);
+    map.insert ("sentPackets",        (quint64) info.sent_packets);
+    map.insert ("receivedPackets",    (quint64) info.received_packets);
+    map.insert ("sentByteRate",       info.sent_byte_rate);
+    map.insert ("receivedByteRate",   info.received_byte_rate);
+    map.insert ("sentPacketRate",     info.sent_packet_rate);
+    map.insert ("receivedPacketRate", info.received_packet_rate);
+
+    return map;
+}
+
+/**
+ * Formats the given number of \a bytes with an appropiate unit
+ */
+static QString formatBytes (const double bytes)
+{
+    if (bytes < 1024)
+        return QString ("%1 bytes").arg (qRound64 (bytes));
+
+    else if (bytes < 1024 * 1024)
+        return QString ("%1 KB").arg (qRound64 (bytes / 1024));
+
+    return QString ("%1 MB").arg (bytes / (1024 * 1024), 0, 'f', 2);
+}
+
+/**
+ * Formats the sent/received bytes and byte rates of the given network
+ * usage \a info (in two lines of rich text)
+ */
+static QString networkUsageText (const DS_TrafficInfo& info)
+{
+    return QString ("%1: %2 (%3/s)<br/>%4: %5 (%6/s)")
+           .arg (DriverStation::tr ("Sent"))
+           .arg (formatBytes (info.sent_bytes))
+           .arg (formatBytes (info.sent_byte_rate))
+           .arg (DriverStation::tr ("Received"))
+           .arg (formatBytes (info.received_bytes))
+           .arg (formatBytes (info.received_byte_rate));
+}
+
+/**
+ * Converts the given \a bandwidth to a map with the sent/received byte rates
+ * over the last second and over the last 10 seconds
+ */
+static QVariantMap bandwidthMap (const DS_Bandwidth& bandwidth)
+{
+    QVariantMap map;
+
+    map.insert ("sentShort",     bandwidth.sent_short);
+    map.insert ("receivedShort", bandwidth.received_short);
+    map.insert ("sentLong",      bandwidth.sent_long);
+    map.insert ("receivedLong",  bandwidth.received_long);
+
+    return map;
+}
+
+/**
+ * Returns the bandwidth map of the given \a socket of the current protocol
+ */
+static QVariantMap socketBandwidth (const DS_BandwidthSocket socket)
+{
+    return bandwidthMap (DS_GetSocketBandwidth (socket));
+}
+
+/**
+ * Converts the given self-test \a result to a map with the outcome of each
+ * check and the measured percentiles (in milliseconds), \c completed is
+ * \c false if the test could not run
+ */
+static QVariantMap selfTestMap (const DS_SelfTestResult& result,
+                                const bool completed)
+{
+    QVariantMap map;
+
+    map.insert ("completed",      completed);
+    map.insert ("passed",         completed && result.passed);
+    map.insert ("timerPassed",    result.timer_passed != 0);
+    map.insert ("loopbackPassed", result.loopback_passed != 0);
+    map.insert ("resolvePassed",  result.resolve_passed != 0);
+    map.insert ("latenessPassed", result.lateness_passed != 0);
+    map.insert ("sleepErrorP50",  result.sleep_error.p50 / 1000.0);
+    map.insert ("sleepErrorP99",  result.sleep_error.p99 / 1000.0);
+    map.insert ("sleepErrorMax",  result.sleep_error.max / 1000.0);
+    map.insert ("loopbackP50",    result.loopback.p50 / 1000.0);
+    map.insert ("loopbackP99",    result.loopback.p99 / 1000.0);
+    map.insert ("loopbackMax",    result.loopback.max / 1000.0);
+    map.insert ("loopbackLost",   result.loopback_lost);
+    map.insert ("latenessP50",    result.lateness.p50 / 1000.0);
+    map.insert ("latenessP99",    result.lateness.p99 / 1000.0);
+    map.insert ("latenessMax",    result.lateness.max / 1000.0);
+    map.insert ("resolved",       result.resolved != 0);
+    map.insert ("resolveTime",    result.resolve_time / 1000.0);
+    map.insert ("robotAddress",   QString::fromUtf8 (result.robot_address));
+
+    return map;
+}
+
+/**
+ * Formats the given byte rate (in bytes per second) in Mbit/s
+ */
+static QString formatBitRate (const double bytes)
+{
+    return QString ("%1 Mbit/s").arg (bytes * 8 / 1000000, 0, 'f', 2);
+}
+
+/**
+ * Formats the bandwidth used by the DS (and by the host, if it is known)
+ * against the bandwidth budget (in up to three lines of rich text), the
+ * budget line is highlighted while the budget warning is active
+ */
+static QString bandwidthText()
+{
+    DS_Bandwidth host;
+    DS_Bandwidth ds = DS_GetTotalBandwidth();
+    bool hostKnown = DS_GetHostBandwidth (&host);
+
+    QString text = QString ("%1: %2 (%3 %4)")
+                   .arg (DriverStation::tr ("DS"))
+                   .arg (formatBitRate (ds.sent_short + ds.received_short))
+                   .arg (formatBitRate (ds.sent_long + ds.received_long))
+                   .arg (DriverStation::tr ("over 10 s"));
+
+    if (hostKnown) {
+        double current = host.sent_short + host.received_short;
+        double average = host.sent_long + host.received_long;
+        text.append (QString ("<br/>%1: %2 (%3 %4)")
+                     .arg (DriverStation::tr ("Host"))
+                     .arg (formatBitRate (current))
+                     .arg (formatBitRate (average))
+                     .arg (DriverStation::tr ("over 10 s")));
+    }
+
+    if (DS_GetBandwidthBudget() > 0) {
+        QString budget = DriverStation::tr ("%1 % of the %2 Mbit/s budget")
+                         .arg (DS_GetBandwidthUsage())
+                         .arg (DS_GetBandwidthBudget(), 0, 'f', 1);
+
+        if (DS_BandwidthWarning())
+            budget = QString ("<font color=#e4574c>%1</font>").arg (budget);
+
+        text.append ("<br/>" + budget);
+    }
+
+    return text;
+}
+
+/**
+ * Formats the given match time (in milliseconds) as "mm:ss.d", or as
+ * "mm:ss.ddd" if \a milliseconds is set to \c true
+ */
+static QString formatMatchTime (const qint64 msec, const bool milliseconds)
+{
+    const qint64 secs = msec / 1000;
+
+    return QString ("%1:%2.%3")
+           .arg (secs / 60, 2, 10, QLatin1Char ('0'))
+           .arg (secs % 60, 2, 10, QLatin1Char ('0'))
+           .arg (milliseconds ? msec % 1000 : (msec % 1000) / 100,
+                 milliseconds ? 3 : 1, 10, QLatin1Char ('0'));
+}
+
+/**
+ * Returns the index of the given deferred \a signal flag, which is used to
+ * store the time of the value held back by the signal
+ */
+static int deferredIndex (const int signal)
+{
+    int index = 0;
+    while (index < 31 && !(signal & (1 << index)))
+        ++index;
+
+    return index;
+}
+
+/**
+ * Stores the given \a value in the \a cache
+ *
+ * \returns \c true if the value is different from the cached value
+ */
+template <typename T>
+static bool changed (T& cache, const T& value)
+{
+    if (cache == value)
+        return false;
+
+    cache = value;
+    return true;
+}
+
 /**
  * Thar shall be only one tavern that manages
  * th' Driver Station interface
@@ -78,1035 +441,2321 @@ int DriverStation::diskUsage() const
 }
 
 /**
- * Returns the packet loss percentage between the FMS and the client
+ * Returns the packet loss percentage between the FMS and the client over the
+ * last few seconds (instead of the whole session)
  */
 int DriverStation::fmsPacketLoss() const
 {
-    qreal sent = (qreal) DS_SentFMSPackets();
-    qreal recv = (qreal) DS_ReceivedFMSPackets();
+    DS_LossInfo info = DS_GetFMSLossInfo();
 
-    if (sent > 0)
-        return (1 - (recv / sent)) * 100;
+    if (info.packets > 0)
+        return info.percent;
 
     return 100;
 }
 
 /**
- * Returns the packet loss percentage between the radio and the client
+ * Returns the number of consecutive packets sent to the FMS that have not
+ * been replied
  */
-int DriverStation::radioPacketLoss() const
+int DriverStation::fmsLossStreak() const
 {
-    qreal sent = (qreal) DS_SentRadioPackets();
-    qreal recv = (qreal) DS_ReceivedRadioPackets();
-
-    if (sent > 0)
-        return (1 - (recv / sent)) * 100;
-
-    return 100;
+    return DS_GetFMSLossInfo().streak;
 }
 
 /**
- * Returns the packet loss percentage between the robot and the client
+ * Returns the packet loss percentage between the radio and the client over the
+ * last few seconds (instead of the whole session)
  */
-int DriverStation::robotPacketLoss() const
+int DriverStation::radioPacketLoss() const
 {
-    qreal sent = (qreal) DS_SentRobotPackets();
-    qreal recv = (qreal) DS_ReceivedRobotPackets();
+    DS_LossInfo info = DS_GetRadioLossInfo();
 
-    if (sent > 0)
-        return (1 - (recv / sent)) * 100;
+    if (info.packets > 0)
+        return info.percent;
 
     return 100;
 }
 
 /**
- * Returns the date when the LibDS binary was build
+ * Returns the number of consecutive packets sent to the radio that have not
+ * been replied
  */
-QString DriverStation::buildDate()
+int DriverStation::radioLossStreak() const
 {
-    return QString (DS_GetBuildDate());
+    return DS_GetRadioLossInfo().streak;
 }
 
 /**
- * Returns the time when the LibDS binary was build
+ * Returns the packet loss percentage between the robot and the client over the
+ * last few seconds (instead of the whole session)
  */
-QString DriverStation::buildTime()
+int DriverStation::robotPacketLoss() const
 {
-    return QString (DS_GetBuildTime());
+    DS_LossInfo info = DS_GetRobotLossInfo();
+
+    if (info.packets > 0)
+        return info.percent;
+
+    return 100;
 }
 
 /**
- * Returns the version of LibDS as a string
+ * Returns the number of consecutive packets sent to the robot that have not
+ * been replied
  */
-QString DriverStation::libDSVersion()
+int DriverStation::robotLossStreak() const
 {
-    return QString (DS_GetVersion());
+    return DS_GetRobotLossInfo().streak;
 }
 
 /**
- * Returns the team number used by the LibDS,
- * use the \c setTeamNumber() function to change it
+ * Returns the round-trip latency, jitter, send lateness and send period (in
+ * milliseconds) and the missed send deadlines of the packets exchanged with
+ * the FMS
  */
-int DriverStation::teamNumber() const
+QVariantMap DriverStation::fmsLatency() const
 {
-    return DS_GetTeamNumber();
+    return latencyMap (DS_GetFMSLatencyInfo());
 }
 
 /**
- * Returns the number of joysticks registered with the Driver Station
+ * Returns the round-trip latency, jitter, send lateness and send period (in
+ * milliseconds) and the missed send deadlines of the packets exchanged with
+ * the radio
  */
-int DriverStation::joystickCount() const
+QVariantMap DriverStation::radioLatency() const
 {
-    return DS_GetJoystickCount();
+    return latencyMap (DS_GetRadioLatencyInfo());
 }
 
 /**
- * Returns the current enabled state of the robot,
- * you can change it with the \c setEnabled() function
+ * Returns the round-trip latency, jitter, send lateness and send period (in
+ * milliseconds) and the missed send deadlines of the packets exchanged with
+ * the robot
  */
-bool DriverStation::isEnabled() const
+QVariantMap DriverStation::robotLatency() const
 {
-    return DS_GetRobotEnabled();
+    return latencyMap (DS_GetRobotLatencyInfo());
 }
 
 /**
- * Returns \c true if the robot is currently in test mode.
- * You can change the control mode with the \c setControlMode() function
- * or with the \c switchToAutonomous(), \c switchToTestMode() or
- * \c switchToTeleoperated() functions
+ * Returns the number of robot reboots and the time (in milliseconds) that
+ * they took to bring the robot code back
  */
-bool DriverStation::isTestMode() const
+QVariantMap DriverStation::rebootTiming() const
 {
-    return (controlMode() == ControlTest);
+    return lifecycleMap (DS_LIFECYCLE_REBOOT);
 }
 
 /**
- * Returns \c true if it is possible to enable the robot.
- * This function checks if:
- *   - We have communications with the robot
- *   - The robot code is loaded
- *   - The robot is not emergency stopped
+ * Returns the number of robot code restarts and the time (in milliseconds)
+ * that they took to bring the robot code back
  */
-bool DriverStation::canBeEnabled() const
+QVariantMap DriverStation::restartTiming() const
 {
-    return DS_GetCanBeEnabled();
+    return lifecycleMap (DS_LIFECYCLE_RESTART);
 }
 
 /**
- * Returns \c true if the robot code is present
+ * Returns the number of detected code deploys (the robot code restarting
+ * while the robot is reachable) and their duration in milliseconds
  */
-bool DriverStation::hasRobotCode() const
+QVariantMap DriverStation::deployTiming() const
 {
-    return DS_GetRobotCode();
+    return lifecycleMap (DS_LIFECYCLE_DEPLOY);
 }
 
 /**
- * Returns \c true if the robot is currently in autonomous mode.
- * You can change the control mode with the \c setControlMode() function
- * or with the \c switchToAutonomous(), \c switchToTestMode() or
- * \c switchToTeleoperated() functions
+ * Returns the summaries of the last matches played with the FMS (newest
+ * first), see \c matchMap() for their fields
  */
-bool DriverStation::isAutonomous() const
+QVariantList DriverStation::matchSummaries() const
 {
-    return (controlMode() == ControlAutonomous);
+    QVariantList list;
+    DS_MatchSummary summaries [DS_MATCH_HISTORY];
+
+    int count = DS_GetMatchSummaries (summaries, DS_MATCH_HISTORY);
+    for (int i = 0; i < count; ++i)
+        list.append (matchMap (summaries [i]));
+
+    return list;
 }
 
 /**
- * Returns \c true if the robot is currently in teleop mode.
- * You can change the control mode with the \c setControlMode() function
- * or with the \c switchToAutonomous(), \c switchToTestMode() or
- * \c switchToTeleoperated() functions
+ * Returns the sent/received bytes and packets (since the protocol was loaded)
+ * and their rates per second for the FMS channel
  */
-bool DriverStation::isTeleoperated() const
+QVariantMap DriverStation::fmsTraffic() const
 {
-    return (controlMode() == ControlTeleoperated);
+    return trafficMap (DS_GetFMSTrafficInfo());
 }
 
 /**
- * Returns \c true if the Driver Station has communications with the FMS
+ * Returns the sent/received bytes and packets (since the protocol was loaded)
+ * and their rates per second for the radio channel
  */
-bool DriverStation::connectedToFMS() const
+QVariantMap DriverStation::radioTraffic() const
 {
-    return DS_GetFMSCommunications();
+    return trafficMap (DS_GetRadioTrafficInfo());
 }
 
 /**
- * Returns \c true if the Driver Station has communications with the robot radio
+ * Returns the sent/received bytes and packets (since the protocol was loaded)
+ * and their rates per second for the robot channel
  */
-bool DriverStation::connectedToRadio() const
+QVariantMap DriverStation::robotTraffic() const
 {
-    return DS_GetRadioCommunications();
+    return trafficMap (DS_GetRobotTrafficInfo());
 }
 
 /**
- * Returns \c true if the Driver Station has communications with the robot
+ * Returns the formatted network usage of the FMS channel, this value is
+ * updated every \c NETWORK_USAGE_INTERVAL milliseconds
  */
-bool DriverStation::connectedToRobot() const
+QString DriverStation::fmsNetworkUsage() const
 {
-    return DS_GetRobotCommunications();
+    return m_fmsNetworkUsage;
 }
 
 /**
- * Returns \c true if the Driver Station detects that the robot is emergency
- * stopped.
- *
- * You can trigger an emergency stop with the \c setEmergencyStopped() function
+ * Returns the formatted network usage of the radio channel, this value is
+ * updated every \c NETWORK_USAGE_INTERVAL milliseconds
  */
-bool DriverStation::emergencyStopped() const
+QString DriverStation::radioNetworkUsage() const
 {
-    return DS_GetEmergencyStopped();
+    return m_radioNetworkUsage;
 }
 
 /**
- * Returns the current voltage reported by the robot and the loaded protocol
+ * Returns the formatted network usage of the robot channel, this value is
+ * updated every \c NETWORK_USAGE_INTERVAL milliseconds
  */
-qreal DriverStation::voltage() const
+QString DriverStation::robotNetworkUsage() const
 {
-    return (qreal) DS_GetRobotVoltage();
+    return m_robotNetworkUsage;
 }
 
 /**
- * Returns the current voltage as a string, this function ensures that
- * the voltage will always display two decimals, even if the number is
- * an integer (e.g. this function will return "12.00 V")
+ * Returns the byte rates (over the last second and over the last 10 seconds)
+ * of each socket, of all the sockets (\c total) and of the host interface
+ * that reaches the robot (\c host, if known), along with the percentage of
+ * the bandwidth budget that is in use
  */
-QString DriverStation::voltageString() const
+QVariantMap DriverStation::bandwidth() const
 {
-    /* Round voltage to two decimal places */
-    qreal volt = roundf (voltage() * 100) / 100;
+    QVariantMap map;
+    DS_Bandwidth host;
 
-    /* Avoid this: http://i.imgur.com/iAAi1bX.png */
-    if (volt > maximumBatteryVoltage())
-        volt = maximumBatteryVoltage();
+    map.insert ("fms",         socketBandwidth (DS_BANDWIDTH_FMS));
+    map.insert ("radio",       socketBandwidth (DS_BANDWIDTH_RADIO));
+    map.insert ("robot",       socketBandwidth (DS_BANDWIDTH_ROBOT));
+    map.insert ("robotStream", socketBandwidth (DS_BANDWIDTH_ROBOT_STREAM));
+    map.insert ("netconsole",  socketBandwidth (DS_BANDWIDTH_NETCONSOLE));
+    map.insert ("total",       bandwidthMap (DS_GetTotalBandwidth()));
 
-    /* Separate voltage into natural and decimal numbers */
-    int integer = static_cast<int> (volt);
-    int decimal = static_cast<qreal> (volt - integer) * 100;
+    if (DS_GetHostBandwidth (&host))
+        map.insert ("host", bandwidthMap (host));
 
-    /* Convert the obtained numbers into strings */
-    QString integer_str = QString::number (integer);
-    QString decimal_str = QString::number (decimal);
+    map.insert ("usage",   DS_GetBandwidthUsage());
+    map.insert ("budget",  DS_GetBandwidthBudget());
+    map.insert ("warning", DS_BandwidthWarning() != 0);
 
-    /* Prepend a 0 to the decimal numbers if required */
-    if (decimal < 10)
-        decimal_str.prepend ("0");
+    return map;
+}
 
-    /* Construct final string */
-    return integer_str + "." + decimal_str + " V";
+/**
+ * Returns the formatted bandwidth usage of the DS and of the host, this
+ * value is updated every \c NETWORK_USAGE_INTERVAL milliseconds
+ */
+QString DriverStation::bandwidthUsage() const
+{
+    return m_bandwidthUsage;
 }
 
 /**
- * Returns the maximum battery voltage specified by the current protocol.
- * This value can be used to genereate graphs or enchance the user interface
+ * Returns \c true if the network usage is approaching the bandwidth budget
  */
-qreal DriverStation::maximumBatteryVoltage() const
+bool DriverStation::bandwidthWarning() const
 {
-    return (qreal) DS_GetMaximumBatteryVoltage();
+    return DS_BandwidthWarning() != 0;
 }
 
 /**
- * Returns the current control mode set by the Driver Station.
- * Possible return values are:
- *    - \c kControlTest
- *    - \c kControlAutonomous
- *    - \c kControlTeleoperated
+ * Returns the bandwidth budget (in Mbit/s), \c 0 if it is disabled
  */
-DriverStation::Control DriverStation::controlMode() const
+qreal DriverStation::bandwidthBudget() const
 {
-    switch (DS_GetControlMode()) {
-    case DS_CONTROL_TEST:
-        return ControlTest;
-        break;
-    case DS_CONTROL_AUTONOMOUS:
-        return ControlAutonomous;
-        break;
-    case DS_CONTROL_TELEOPERATED:
-        return ControlTeleoperated;
-        break;
-    default:
-        return ControlTeleoperated;
-        break;
-    }
+    return DS_GetBandwidthBudget();
 }
 
 /**
- * Returns the current team station of the DS/robot.
- *
- * Possible return values are:
- *   - \c kStationRed1
- *   - \c kStationRed2
- *   - \c kStationRed3
- *   - \c kStationBlue1
- *   - \c kStationBlue2
- *   - \c kStationBlue3
- *
- * You can also use the \c teamAlliance() and \c teamPosition() functions to
- * obtain the individual alliance and position of the DS/robot.
+ * Returns the dashboard entries received from (or sent to) the robot,
+ * the map is empty if the dashboard is not running or not connected
  */
-DriverStation::Station DriverStation::teamStation() const
+QVariantMap DriverStation::dashboard() const
 {
-    if (teamAlliance() == AllianceRed) {
-        switch (teamPosition()) {
-        case Position1:
-            return StationRed1;
-            break;
-        case Position2:
-            return StationRed2;
-            break;
-        case Position3:
-            return StationRed3;
-            break;
-        default:
-            return StationRed1;
-            break;
-        }
-    }
-
-    else {
-        switch (teamPosition()) {
-        case Position1:
-            return StationBlue1;
-            break;
-        case Position2:
-            return StationBlue2;
-            break;
-        case Position3:
-            return StationBlue3;
-            break;
-        default:
-            return StationBlue1;
-            break;
-        }
-    }
+    return m_dashboard;
 }
 
 /**
- * Returns the current team alliance of the DS/robot.
- *
- * Possible return values are:
- *   - \c kAllianceRed
- *   - \c kAllianceBlue
- *
- * Related functions: \c teamPosition() and \c teamStation()
+ * Returns the results of the last self-test (see \c selfTestMap()), the
+ * map is empty if the self-test was never run
  */
-DriverStation::Alliance DriverStation::teamAlliance() const
+QVariantMap DriverStation::selfTest() const
 {
-    switch (DS_GetAlliance()) {
-    case DS_ALLIANCE_RED:
-        return AllianceRed;
-        break;
-    case DS_ALLIANCE_BLUE:
-        return AllianceBlue;
-        break;
-    default:
-        return AllianceRed;
-        break;
-    }
+    return m_selfTest;
 }
 
 /**
- * Returns the current position of the DS/robot.
- *
- * Possible return values are:
- *   - \c kPosition1
- *   - \c kPosition2
- *   - \c kPosition3
- *
- * Related functions: \c teamAlliance() and \c teamStation()
+ * Returns \c true while the self-test is running
  */
-DriverStation::Position DriverStation::teamPosition() const
+bool DriverStation::selfTestRunning() const
 {
-    switch (DS_GetPosition()) {
-    case DS_POSITION_1:
-        return Position1;
-        break;
-    case DS_POSITION_2:
-        return Position2;
-        break;
-    case DS_POSITION_3:
-        return Position3;
-        break;
-    default:
-        return Position1;
-        break;
-    }
+    return m_selfTestWatcher.isRunning();
 }
 
 /**
- * Returns the internet address that the Driver Station is using to communicate
- * with the Field Management System.
+ * Returns the additional robots controlled by the DS (as \c DSRobot objects)
  */
-QString DriverStation::appliedFMSAddress() const
+QVariantList DriverStation::robots() const
 {
-    return QString::fromUtf8 (DS_GetAppliedFMSAddress());
+    QVariantList list;
+    foreach (DSRobot* robot, m_robots)
+        list.append (QVariant::fromValue<QObject*> (robot));
+
+    return list;
 }
 
 /**
- * Returns the internet address that the Driver Station is using to communicate
- * with the robot radio.
+ * Returns the additional robots controlled by the DS
  */
-QString DriverStation::appliedRadioAddress() const
+QList<DSRobot*> DriverStation::robotList() const
 {
-    return QString::fromUtf8 (DS_GetAppliedRadioAddress());
+    return m_robots;
 }
 
 /**
- * Returns the internet address that the Driver Station is using to communicate
- * with the robot controller.
+ * Returns the date when the LibDS binary was build
  */
-QString DriverStation::appliedRobotAddress() const
+QString DriverStation::buildDate()
 {
-    return QString::fromUtf8 (DS_GetAppliedRobotAddress());
+    return QString (DS_GetBuildDate());
 }
 
 /**
- * Returns the FMS address recommended by the loaded protocol
+ * Returns the time when the LibDS binary was build
  */
-QString DriverStation::defaultFMSAddress() const
+QString DriverStation::buildTime()
 {
-    return QString::fromUtf8 (DS_GetDefaultFMSAddress());
+    return QString (DS_GetBuildTime());
 }
 
 /**
- * Returns the radio address recommended by the loaded protocol
+ * Returns the version of LibDS as a string
  */
-QString DriverStation::defaultRadioAddress() const
+QString DriverStation::libDSVersion()
 {
-    return QString::fromUtf8 (DS_GetDefaultRadioAddress());
+    return QString (DS_GetVersion());
 }
 
 /**
- * Returns the robot address recommended by the loaded protocol
+ * Returns the team number used by the LibDS,
+ * use the \c setTeamNumber() function to change it
  */
-QString DriverStation::defaultRobotAddress() const
+int DriverStation::teamNumber() const
 {
-    return QString::fromUtf8 (DS_GetDefaultRobotAddress());
+    return DS_GetTeamNumber();
 }
 
 /**
- * Returns the elapsed time since the robot has been enabled
+ * Returns the number of joysticks registered with the Driver Station
  */
-QString DriverStation::elapsedTime()
+int DriverStation::joystickCount() const
 {
-    if (m_elapsedTime.isEmpty())
-        m_elapsedTime = "00:00.0";
-
-    return m_elapsedTime;
+    return DS_GetJoystickCount();
 }
 
 /**
- * Returns the current status of the robot/DS.
- * This string is meant to be used directly by the clien application,
- * the DS has no real use for it.
- *
- * Possible return values are:
- *    - No Robot Communications
- *    - No Robot Code
- *    - Emergency Stopped
- *    - Teleoperated Enabled/Disabled
- *    - Autonomous Enabled/Disabled
- *    - Test Enabled/Disabled
+ * Returns the current enabled state of the robot,
+ * you can change it with the \c setEnabled() function
  */
-QString DriverStation::generalStatus() const
+bool DriverStation::isEnabled() const
 {
-    return QString::fromUtf8 (DS_GetStatusString());
+    return DS_GetRobotEnabled();
 }
 
 /**
- * Returns the user-set FMS address, use the \c setCustomFMSAddress() function
- * to change this value.
+ * Returns \c true if the robot is currently in test mode.
+ * You can change the control mode with the \c setControlMode() function
+ * or with the \c switchToAutonomous(), \c switchToTestMode() or
+ * \c switchToTeleoperated() functions
  */
-QString DriverStation::customFMSAddress() const
+bool DriverStation::isTestMode() const
 {
-    return QString::fromUtf8 (DS_GetCustomFMSAddress());
+    return (controlMode() == ControlTest);
 }
 
 /**
- * Returns the user-set radio address, use the \c setCustomRadioAddress()
- * function to change this value.
+ * Returns \c true if it is possible to enable the robot.
+ * This function checks if:
+ *   - We have communications with the robot
+ *   - The robot code is loaded
+ *   - The robot is not emergency stopped
  */
-QString DriverStation::customRadioAddress() const
+bool DriverStation::canBeEnabled() const
 {
-    return QString::fromUtf8 (DS_GetCustomRadioAddress());
+    return DS_GetCanBeEnabled();
 }
 
 /**
- * Returns the user-set robot address, use the \c setCustomRobotAddress()
- * function to change this value.
+ * Returns \c true if the robot code is present
  */
-QString DriverStation::customRobotAddress() const
+bool DriverStation::hasRobotCode() const
 {
-    return QString::fromUtf8 (DS_GetCustomRobotAddress());
+    return DS_GetRobotCode();
 }
 
 /**
- * Returns an ordered list with the available team stations.
- * You can use the value indexes of this list directly with the
- * \c setTeamStation() function
+ * Returns \c true if the robot is currently in autonomous mode.
+ * You can change the control mode with the \c setControlMode() function
+ * or with the \c switchToAutonomous(), \c switchToTestMode() or
+ * \c switchToTeleoperated() functions
  */
-QStringList DriverStation::stations() const
+bool DriverStation::isAutonomous() const
 {
-    QStringList list;
-
-    list.append (tr ("Red 1"));
-    list.append (tr ("Red 2"));
-    list.append (tr ("Red 3"));
-    list.append (tr ("Blue 1"));
-    list.append (tr ("Blue 2"));
-    list.append (tr ("Blue 3"));
-
-    return list;
+    return (controlMode() == ControlAutonomous);
 }
 
 /**
- * Returns an ordered list with the available communication protocols.
- * You can use the value indexes of this list directly with the \c setProtocol()
- * function.
+ * Returns \c true if the robot is currently in teleop mode.
+ * You can change the control mode with the \c setControlMode() function
+ * or with the \c switchToAutonomous(), \c switchToTestMode() or
+ * \c switchToTeleoperated() functions
  */
-QStringList DriverStation::protocols() const
+bool DriverStation::isTeleoperated() const
 {
-    QStringList list;
-
-    list.append (tr ("FRC 2016"));
-    list.append (tr ("FRC 2015"));
-    list.append (tr ("FRC 2014"));
-
-    return list;
+    return (controlMode() == ControlTeleoperated);
 }
 
 /**
- * Returns the number of sent FMS bytes since the current
- * protocol was loaded
+ * Returns the number of the current match, as reported by the FMS
  */
-unsigned long DriverStation::sentFMSBytes() const
+int DriverStation::fmsMatchNumber() const
 {
-    return DS_SentFMSBytes();
+    DS_FMSMatch match;
+    DS_GetFMSMatch (&match);
+    return match.match_number;
 }
 
 /**
- * Returns the number of sent radio bytes since the current
- * protocol was loaded
+ * Returns the replay number of the current match, as reported by the FMS
  */
-unsigned long DriverStation::sentRadioBytes() const
+int DriverStation::fmsReplayNumber() const
 {
-    return DS_SentRadioBytes();
+    DS_FMSMatch match;
+    DS_GetFMSMatch (&match);
+    return match.replay_number;
 }
 
 /**
- * Returns the number of sent robot bytes since the current
- * protocol was loaded
+ * Returns the remaining time (in seconds) of the current match period, as
+ * reported by the FMS, or \c -1 if there is no FMS
  */
-unsigned long DriverStation::sentRobotBytes() const
+int DriverStation::matchTimeRemaining() const
 {
-    return DS_SentRobotBytes();
+    return DS_GetMatchTimeRemaining();
 }
 
 /**
- * Returns the number of received FMS bytes since the current
- * protocol was loaded
+ * Returns \c true if the Driver Station has communications with the FMS
  */
-unsigned long DriverStation::receivedFMSBytes() const
+bool DriverStation::connectedToFMS() const
 {
-    return DS_ReceivedFMSBytes();
+    return DS_GetFMSCommunications();
 }
 
 /**
- * Returns the number of received radio bytes since the current
- * protocol was loaded
+ * Returns \c true if the Driver Station has communications with the robot radio
  */
-unsigned long DriverStation::receivedRadioBytes() const
+bool DriverStation::connectedToRadio() const
 {
-    return DS_ReceivedRadioBytes();
+    return DS_GetRadioCommunications();
 }
 
 /**
- * Returns the number of received robot bytes since the current
- * protocol was loaded
+ * Returns \c true if the Driver Station has communications with the robot
  */
-unsigned long DriverStation::receivedRobotBytes() const
+bool DriverStation::connectedToRobot() const
 {
-    return DS_ReceivedRobotBytes();
+    return DS_GetRobotCommunications();
 }
 
 /**
- * Returns the number of axes that the given \a joystick has.
- * If the joystick does not exist, this function will return \c 0
+ * Returns \c true if the Driver Station detects that the robot is emergency
+ * stopped.
+ *
+ * You can trigger an emergency stop with the \c setEmergencyStopped() function
  */
-int DriverStation::getNumAxes (const int joystick) const
+bool DriverStation::emergencyStopped() const
 {
-    return DS_GetJoystickNumAxes (joystick);
+    return DS_GetEmergencyStopped();
 }
 
 /**
- * Returns the number of hats that the given \a joystick has.
- * If the joystick does not exist, this function will return \c 0
+ * Returns the current voltage reported by the robot and the loaded protocol
  */
-int DriverStation::getNumHats (const int joystick) const
+qreal DriverStation::voltage() const
 {
-    return DS_GetJoystickNumHats (joystick);
+    return (qreal) DS_GetRobotVoltage();
 }
 
 /**
- * Returns the number of buttons that the given \a joystick has.
- * If the joystick does not exist, this function will return \c 0
+ * Returns \c true if the robot voltage is approaching the brownout threshold
+ * (or is predicted to reach it soon)
  */
-int DriverStation::getNumButtons (const int joystick) const
+bool DriverStation::brownoutWarning() const
 {
-    return DS_GetJoystickNumButtons (joystick);
+    return m_brownoutWarning;
 }
 
 /**
- * Initializes the LibDS system and instructs the class to close the LibDS
- * before the Qt application is closed.
+ * Returns the current voltage as a string, this function ensures that
+ * the voltage will always display two decimals, even if the number is
+ * an integer (e.g. this function will return "12.00 V")
  */
-void DriverStation::start()
+QString DriverStation::voltageString() const
+{
+    /* Round voltage to two decimal places */
+    qreal volt = roundf (voltage() * 100) / 100;
+
+    /* Avoid this: http://i.imgur.com/iAAi1bX.png */
+    if (volt > maximumBatteryVoltage())
+        volt = maximumBatteryVoltage();
+
+    /* Separate voltage into natural and decimal numbers */
+    int integer = static_cast<int> (volt);
+    int decimal = static_cast<qreal> (volt - integer) * 100;
+
+    /* Convert the obtained numbers into strings */
+    QString integer_str = QString::number (integer);
+    QString decimal_str = QString::number (decimal);
+
+    /* Prepend a 0 to the decimal numbers if required */
+    if (decimal < 10)
+        decimal_str.prepend ("0");
+
+    /* Construct final string */
+    return integer_str + "." + decimal_str + " V";
+}
+
+/**
+ * Returns the maximum battery voltage specified by the current protocol.
+ * This value can be used to genereate graphs or enchance the user interface
+ */
+qreal DriverStation::maximumBatteryVoltage() const
+{
+    return (qreal) DS_GetMaximumBatteryVoltage();
+}
+
+/**
+ * Returns the current control mode set by the Driver Station.
+ * Possible return values are:
+ *    - \c kControlTest
+ *    - \c kControlAutonomous
+ *    - \c kControlTeleoperated
+ */
+DriverStation::Control DriverStation::controlMode() const
+{
+    switch (DS_GetControlMode()) {
+    case DS_CONTROL_TEST:
+        return ControlTest;
+        break;
+    case DS_CONTROL_AUTONOMOUS:
+        return ControlAutonomous;
+        break;
+    case DS_CONTROL_TELEOPERATED:
+        return ControlTeleoperated;
+        break;
+    default:
+        return ControlTeleoperated;
+        break;
+    }
+}
+
+/**
+ * Returns the current team station of the DS/robot.
+ *
+ * Possible return values are:
+ *   - \c kStationRed1
+ *   - \c kStationRed2
+ *   - \c kStationRed3
+ *   - \c kStationBlue1
+ *   - \c kStationBlue2
+ *   - \c kStationBlue3
+ *
+ * You can also use the \c teamAlliance() and \c teamPosition() functions to
+ * obtain the individual alliance and position of the DS/robot.
+ */
+DriverStation::Station DriverStation::teamStation() const
+{
+    if (teamAlliance() == AllianceRed) {
+        switch (teamPosition()) {
+        case Position1:
+            return StationRed1;
+            break;
+        case Position2:
+            return StationRed2;
+            break;
+        case Position3:
+            return StationRed3;
+            break;
+        default:
+            return StationRed1;
+            break;
+        }
+    }
+
+    else {
+        switch (teamPosition()) {
+        case Position1:
+            return StationBlue1;
+            break;
+        case Position2:
+            return StationBlue2;
+            break;
+        case Position3:
+            return StationBlue3;
+            break;
+        default:
+            return StationBlue1;
+            break;
+        }
+    }
+}
+
+/**
+ * Returns the current team alliance of the DS/robot.
+ *
+ * Possible return values are:
+ *   - \c kAllianceRed
+ *   - \c kAllianceBlue
+ *
+ * Related functions: \c teamPosition() and \c teamStation()
+ */
+DriverStation::Alliance DriverStation::teamAlliance() const
+{
+    switch (DS_GetAlliance()) {
+    case DS_ALLIANCE_RED:
+        return AllianceRed;
+        break;
+    case DS_ALLIANCE_BLUE:
+        return AllianceBlue;
+        break;
+    default:
+        return AllianceRed;
+        break;
+    }
+}
+
+/**
+ * Returns the current position of the DS/robot.
+ *
+ * Possible return values are:
+ *   - \c kPosition1
+ *   - \c kPosition2
+ *   - \c kPosition3
+ *
+ * Related functions: \c teamAlliance() and \c teamStation()
+ */
+DriverStation::Position DriverStation::teamPosition() const
+{
+    switch (DS_GetPosition()) {
+    case DS_POSITION_1:
+        return Position1;
+        break;
+    case DS_POSITION_2:
+        return Position2;
+        break;
+    case DS_POSITION_3:
+        return Position3;
+        break;
+    default:
+        return Position1;
+        break;
+    }
+}
+
+/**
+ * Returns the internet address that the Driver Station is using to communicate
+ * with the Field Management System.
+ */
+QString DriverStation::appliedFMSAddress() const
+{
+    return m_appliedFMSAddress;
+}
+
+/**
+ * Returns the internet address that the Driver Station is using to communicate
+ * with the robot radio.
+ */
+QString DriverStation::appliedRadioAddress() const
+{
+    return m_appliedRadioAddress;
+}
+
+/**
+ * Returns the internet address that the Driver Station is using to communicate
+ * with the robot controller.
+ */
+QString DriverStation::appliedRobotAddress() const
+{
+    return m_appliedRobotAddress;
+}
+
+/**
+ * Returns the FMS address recommended by the loaded protocol
+ */
+QString DriverStation::defaultFMSAddress() const
+{
+    return takeString (DS_GetDefaultFMSAddress());
+}
+
+/**
+ * Returns the radio address recommended by the loaded protocol
+ */
+QString DriverStation::defaultRadioAddress() const
+{
+    return takeString (DS_GetDefaultRadioAddress());
+}
+
+/**
+ * Returns the robot address recommended by the loaded protocol
+ */
+QString DriverStation::defaultRobotAddress() const
+{
+    return takeString (DS_GetDefaultRobotAddress());
+}
+
+/**
+ * Returns the elapsed time since the robot has been enabled, formatted as
+ * "mm:ss.d". The string is generated when this function is called, use
+ * \c matchStartTime() to render the timer continuously.
+ */
+QString DriverStation::elapsedTime() const
+{
+    return formatMatchTime (matchElapsedTime(), false);
+}
+
+/**
+ * Returns \c true if the match timer is running (the robot is enabled)
+ */
+bool DriverStation::matchTimerRunning() const
+{
+    return m_matchTimerRunning;
+}
+
+/**
+ * Returns the time (in milliseconds since the epoch) at which the running
+ * match timer would have been started if the robot was never disabled.
+ *
+ * While \c matchTimerRunning() is \c true, the UI can obtain the elapsed time
+ * as \c Date.now() \c - \c matchStartTime in its own frame callbacks, so
+ * that no work is done while the timer is not visible.
+ */
+qint64 DriverStation::matchStartTime() const
+{
+    return m_matchStartTime;
+}
+
+/**
+ * Returns the elapsed time (in milliseconds) of the match timer, measured
+ * with a monotonic clock
+ */
+qint64 DriverStation::matchElapsedTime() const
+{
+    if (m_matchTimerRunning)
+        return m_matchElapsedTime + m_matchTimer.elapsed();
+
+    return m_matchElapsedTime;
+}
+
+/**
+ * Returns the current status of the robot/DS.
+ * This string is meant to be used directly by the clien application,
+ * the DS has no real use for it.
+ *
+ * Possible return values are:
+ *    - No Robot Communications
+ *    - No Robot Code
+ *    - Emergency Stopped
+ *    - Teleoperated Enabled/Disabled
+ *    - Autonomous Enabled/Disabled
+ *    - Test Enabled/Disabled
+ */
+QString DriverStation::generalStatus() const
+{
+    return m_status;
+}
+
+/**
+ * Returns the user-set FMS address, use the \c setCustomFMSAddress() function
+ * to change this value.
+ */
+QString DriverStation::customFMSAddress() const
+{
+    return takeString (DS_GetCustomFMSAddress());
+}
+
+/**
+ * Returns the user-set radio address, use the \c setCustomRadioAddress()
+ * function to change this value.
+ */
+QString DriverStation::customRadioAddress() const
+{
+    return takeString (DS_GetCustomRadioAddress());
+}
+
+/**
+ * Returns the user-set robot address, use the \c setCustomRobotAddress()
+ * function to change this value.
+ */
+QString DriverStation::customRobotAddress() const
+{
+    return takeString (DS_GetCustomRobotAddress());
+}
+
+/**
+ * Returns an ordered list with the available team stations.
+ * You can use the value indexes of this list directly with the
+ * \c setTeamStation() function
+ */
+QStringList DriverStation::stations() const
+{
+    QStringList list;
+
+    list.append (tr ("Red 1"));
+    list.append (tr ("Red 2"));
+    list.append (tr ("Red 3"));
+    list.append (tr ("Blue 1"));
+    list.append (tr ("Blue 2"));
+    list.append (tr ("Blue 3"));
+
+    return list;
+}
+
+/**
+ * Returns an ordered list with the registered communication protocols (the
+ * built-in protocols first, then the protocols of the loaded modules).
+ * You can use the value indexes of this list directly with the \c setProtocol()
+ * function.
+ */
+QStringList DriverStation::protocols() const
+{
+    QStringList list;
+
+    for (int i = 0; i < DS_RegisteredProtocolCount(); ++i) {
+        DS_String name = DS_RegisteredProtocolName (i);
+        list.append (QString::fromUtf8 (name.buf, (int) DS_StrLen (&name)));
+        DS_StrRmBuf (&name);
+    }
+
+    return list;
+}
+
+/**
+ * Returns the last telemetry frame emitted by the \c telemetryFrame() signal
+ */
+DriverStationFrame DriverStation::frame() const
+{
+    return m_frame;
+}
+
+/**
+ * Returns \c true if the LibDS events are drained by the event thread
+ */
+bool DriverStation::eventThreadEnabled() const
+{
+    return m_eventThreadEnabled;
+}
+
+/**
+ * Returns \c true if the spacebar and Enter keys e-stop and disable the
+ * robots, see \c setHotkeysEnabled() for details
+ */
+bool DriverStation::hotkeysEnabled() const
+{
+    return m_hotkeysEnabled;
+}
+
+/**
+ * Returns \c true if the \c telemetryFrame() signal is emitted
+ */
+bool DriverStation::telemetryFramesEnabled() const
+{
+    return m_telemetryFrames;
+}
+
+/**
+ * Returns \c true if the UI is visible and focused (the default), see
+ * \c setForeground() for details
+ */
+bool DriverStation::foreground() const
+{
+    return m_foreground;
+}
+
+/**
+ * Returns the time (in microseconds, from the monotonic clock of the LibDS,
+ * see \c DS_GetTimeUs()) in which the LibDS created the event that caused
+ * the signal that is being emitted. Outside of these signals, the current
+ * time of the same clock is returned.
+ */
+quint64 DriverStation::eventTime() const
+{
+    return m_eventTime ? m_eventTime : DS_GetTimeUs();
+}
+
+/**
+ * Returns the number of sent FMS bytes since the current
+ * protocol was loaded
+ */
+unsigned long DriverStation::sentFMSBytes() const
+{
+    return DS_SentFMSBytes();
+}
+
+/**
+ * Returns the number of sent radio bytes since the current
+ * protocol was loaded
+ */
+unsigned long DriverStation::sentRadioBytes() const
+{
+    return DS_SentRadioBytes();
+}
+
+/**
+ * Returns the number of sent robot bytes since the current
+ * protocol was loaded
+ */
+unsigned long DriverStation::sentRobotBytes() const
+{
+    return DS_SentRobotBytes();
+}
+
+/**
+ * Returns the number of received FMS bytes since the current
+ * protocol was loaded
+ */
+unsigned long DriverStation::receivedFMSBytes() const
+{
+    return DS_ReceivedFMSBytes();
+}
+
+/**
+ * Returns the number of received radio bytes since the current
+ * protocol was loaded
+ */
+unsigned long DriverStation::receivedRadioBytes() const
+{
+    return DS_ReceivedRadioBytes();
+}
+
+/**
+ * Returns the number of received robot bytes since the current
+ * protocol was loaded
+ */
+unsigned long DriverStation::receivedRobotBytes() const
+{
+    return DS_ReceivedRobotBytes();
+}
+
+/**
+ * Returns the number of axes that the given \a joystick has.
+ * If the joystick does not exist, this function will return \c 0
+ */
+int DriverStation::getNumAxes (const int joystick) const
+{
+    return DS_GetJoystickNumAxes (joystick);
+}
+
+/**
+ * Returns the number of hats that the given \a joystick has.
+ * If the joystick does not exist, this function will return \c 0
+ */
+int DriverStation::getNumHats (const int joystick) const
+{
+    return DS_GetJoystickNumHats (joystick);
+}
+
+/**
+ * Returns the number of buttons that the given \a joystick has.
+ * If the joystick does not exist, this function will return \c 0
+ */
+int DriverStation::getNumButtons (const int joystick) const
+{
+    return DS_GetJoystickNumButtons (joystick);
+}
+
+/**
+ * Returns the samples of the given robot \a metric that were received during
+ * the last \a msecs milliseconds, read from the LibDS metric history. Each
+ * sample is a point with the age of the sample (in msecs, as a negative
+ * number) and its value (in percent).
+ */
+QVariantList DriverStation::metricHistory (const Metric metric,
+                                           const int msecs) const
+{
+    QVariantList points;
+    uint64_t now = DS_GetTimeMs();
+    uint64_t from = now - qMin<uint64_t> (qMax (msecs, 0), now);
+
+    QVector<DS_HistorySample> samples (qMin (qMax (msecs, 0) / DS_HISTORY_TICK + 1,
+                                             DS_HISTORY_SIZE));
+    int count = DS_GetHistory ((DS_HistoryMetric) metric, from, now,
+                               samples.data(), samples.count());
+
+    for (int i = 0; i < count; ++i)
+        points.append (QPointF (-(qreal) (now - samples [i].time),
+                                samples [i].value));
+
+    return points;
+}
+
+/**
+ * Initializes the LibDS system and instructs the class to close the LibDS
+ * before the Qt application is closed.
+ */
+void DriverStation::start()
 {
     if (!DS_Initialized()) {
         DS_Init();
+        DS_SetEventCoalescing (1);
+        DS_SetNetConsoleMessageEvents (0);
+        m_netConsoleCursor = DS_NetConsoleLineCount();
+
+        /* Initialize the published values */
+        m_cpuUsage = cpuUsage();
+        m_canUsage = canUsage();
+        m_ramUsage = ramUsage();
+        m_diskUsage = diskUsage();
+        m_voltage = qRound (voltage() * 100);
+        m_enabled = isEnabled();
+        m_robotCode = hasRobotCode();
+        m_emergencyStop = emergencyStopped();
+        m_fmsCommunications = connectedToFMS();
+        m_radioCommunications = connectedToRadio();
+        m_robotCommunications = connectedToRobot();
+        m_controlMode = controlMode();
+        m_alliance = teamAlliance();
+        m_position = teamPosition();
+        updateAddresses (AllAddressSignals);
+
+        /* Apply the network configuration once the user stops typing */
+        m_configTimer.setSingleShot (true);
+        m_configTimer.setInterval (CONFIG_DEBOUNCE);
+        connect (&m_configTimer, SIGNAL (timeout()),
+                 this, SLOT (applyConfiguration()));
+
+        watchEvents();
+        processEvents();
+        updateHotkeys();
+        updateMatchTimer (m_enabled);
+        updateStatus();
+        updateNetworkUsage();
+        connect (qApp, SIGNAL (aboutToQuit()), this, SLOT (quitDS()));
+
+        /* Register the protocols of the modules shipped with the app */
+        loadProtocolModules (qApp->applicationDirPath() + "/protocols");
+    }
+}
+
+/**
+ * Reboots the robot controller
+ */
+void DriverStation::rebootRobot()
+{
+    LOG << "Requesting robot reboot...";
+    DS_RebootRobot();
+}
+
+/**
+ * Removes all the registered joysticks from the Driver Station
+ */
+void DriverStation::resetJoysticks()
+{
+    LOG << "Resetting joysticks...";
+    DS_JoysticksReset();
+    emit joystickCountChanged();
+}
+
+/**
+ * Restarts the robot code process in the robot controller
+ */
+void DriverStation::restartRobotCode()
+{
+    LOG << "Requesting robot code restart...";
+    DS_RestartRobotCode();
+}
+
+/**
+ * Returns an operation that succeeds once the robot communications are up
+ * (right away if they already are), or fails if they are not up within the
+ * given \a timeout (in milliseconds)
+ */
+DriverStationOperation* DriverStation::waitForRobotComms (const int timeout)
+{
+    return startOperation (timeout,
+                           QList<DriverStationOperation::Condition>()
+                           << DriverStationOperation::RobotCommunications);
+}
+
+/**
+ * Returns an operation that succeeds once the robot code is running (right
+ * away if it already is), or fails if it is not running within the given
+ * \a timeout (in milliseconds)
+ */
+DriverStationOperation* DriverStation::waitForRobotCode (const int timeout)
+{
+    return startOperation (timeout,
+                           QList<DriverStationOperation::Condition>()
+                           << DriverStationOperation::RobotCode);
+}
+
+/**
+ * Reboots the robot controller and returns an operation that succeeds once
+ * the robot communications are lost and then restored, or fails if this
+ * does not happen within the given \a timeout (in milliseconds)
+ */
+DriverStationOperation* DriverStation::rebootRobotAndWait (const int timeout)
+{
+    DriverStationOperation* operation;
+    operation = startOperation (timeout,
+                                QList<DriverStationOperation::Condition>()
+                                << DriverStationOperation::NoRobotCommunications
+                                << DriverStationOperation::RobotCommunications);
+
+    rebootRobot();
+    return operation;
+}
+
+/**
+ * Restarts the robot code and returns an operation that succeeds once the
+ * robot code stops and runs again, or fails if this does not happen within
+ * the given \a timeout (in milliseconds)
+ */
+DriverStationOperation* DriverStation::restartRobotCodeAndWait (const int timeout)
+{
+    DriverStationOperation* operation;
+    operation = startOperation (timeout,
+                                QList<DriverStationOperation::Condition>()
+                                << DriverStationOperation::NoRobotCode
+                                << DriverStationOperation::RobotCode);
+
+    restartRobotCode();
+    return operation;
+}
+
+/**
+ * Disables or enables the robot
+ */
+void DriverStation::setEnabled (const bool enabled)
+{
+    LOG << "Setting enabled state to" << enabled;
+
+    if (enabled)
+        resetElapsedTime();
+
+    DS_SetRobotEnabled (enabled);
+}
+
+/**
+ * Changes the team \a number
+ * \note Changing the team number will trigger a refresh in the internet
+ *       addresses used to communicate with the FMS, radio and robot, once
+ *       it has not been changed for \c CONFIG_DEBOUNCE milliseconds.
+ */
+void DriverStation::setTeamNumber (const int number)
+{
+    stageConfiguration();
+    DS_SetTeamNumber (number);
+
+    updateAddresses (AllAddressSignals);
+    emit teamNumberChanged (number);
+}
+
+/**
+ * De-allocates the current protocol and loads the given \a protocol
+ *
+ * \param protocol the new communication protocol to use
+ */
+void DriverStation::loadProtocol (const DS_Protocol& protocol)
+{
+    restoreKnownRobotAddress (protocol);
+    DS_ConfigureProtocol (&protocol);
+
+    setCustomFMSAddress (customFMSAddress());
+    setCustomRadioAddress (customRadioAddress());
+    setCustomRobotAddress (customRobotAddress());
+    applyConfiguration();
+
+    emit protocolChanged();
+    updateStatus();
+}
+
+/**
+ * Changes the control \a mode of the robot
+ */
+void DriverStation::setControlMode (const Control mode)
+{
+    LOG << "Setting control mode to" << mode;
+
+    if (isEnabled() && mode != controlMode())
+        setEnabled (false);
+    if (mode != controlMode())
+        resetElapsedTime();
+
+    switch (mode) {
+    case ControlTest:
+        DS_SetControlMode (DS_CONTROL_TEST);
+        break;
+    case ControlAutonomous:
+        DS_SetControlMode (DS_CONTROL_AUTONOMOUS);
+        break;
+    case ControlTeleoperated:
+        DS_SetControlMode (DS_CONTROL_TELEOPERATED);
+        break;
+    default:
+        DS_SetControlMode (DS_CONTROL_TELEOPERATED);
+        break;
+    }
+}
+
+/**
+ * Loads the given \a protocol type.
+ *
+ * \note You can use this function directly with the index values given by the
+ *       \c protocols() function
+ */
+void DriverStation::setProtocol (const Protocol protocol)
+{
+    DS_Protocol instance;
+    QStringList list = protocols();
+    if (protocol < 0 || protocol >= list.count())
+        return;
+
+    QByteArray name = list.at (protocol).toUtf8();
+    if (DS_CreateRegisteredProtocol (name.constData(), &instance)) {
+        loadProtocol (instance);
+        LOG << "Switched to" << list.at (protocol) << "Protocol";
+    }
+}
+
+/**
+ * Loads the protocol module (shared library) at the given \a path and
+ * registers its protocols, which are appended to the \c protocols() list
+ *
+ * \returns the number of registered protocols, or \c -1 on failure
+ */
+int DriverStation::loadProtocolModule (const QString& path)
+{
+    int count = DS_LoadProtocolModule (QFile::encodeName (path).constData());
+
+    if (count > 0) {
+        LOG << "Loaded" << count << "protocols from" << path;
+        emit protocolsChanged();
+    }
+
+    return count;
+}
+
+/**
+ * Loads every protocol module (shared library) in the given \a directory
+ *
+ * \returns the number of registered protocols
+ */
+int DriverStation::loadProtocolModules (const QString& directory)
+{
+    int count = 0;
+    QDir dir (directory);
+
+    foreach (const QFileInfo& info, dir.entryInfoList (QDir::Files)) {
+        if (QLibrary::isLibrary (info.fileName()))
+            count += qMax (loadProtocolModule (info.absoluteFilePath()), 0);
+    }
+
+    return count;
+}
+
+/**
+ * Changes the team alliance and position based on the given \a station
+ *
+ * Possible input values are:
+ *   - \c kStationRed1 (0)
+ *   - \c kStationRed2 (1)
+ *   - \c kStationRed3 (2)
+ *   - \c kStationBlue1 (3)
+ *   - \c kStationBlue2 (4)
+ *   - \c kStationBlue3 (5)
+ *
+ * \note You can use this function directly with the output given by the \c
+ *       \c stations() function
+ */
+void DriverStation::setTeamStation (const Station station)
+{
+    switch (station) {
+    case StationRed1:
+        setTeamPosition (Position1);
+        setTeamAlliance (AllianceRed);
+        break;
+    case StationRed2:
+        setTeamPosition (Position2);
+        setTeamAlliance (AllianceRed);
+        break;
+    case StationRed3:
+        setTeamPosition (Position3);
+        setTeamAlliance (AllianceRed);
+        break;
+    case StationBlue1:
+        setTeamPosition (Position1);
+        setTeamAlliance (AllianceBlue);
+        break;
+    case StationBlue2:
+        setTeamPosition (Position2);
+        setTeamAlliance (AllianceBlue);
+        break;
+    case StationBlue3:
+        setTeamPosition (Position3);
+        setTeamAlliance (AllianceBlue);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Updates the team alliance, possible input values are:
+ *    - \c kAllianceRed (0)
+ *    - \c kAllianceBlue (1)
+ */
+void DriverStation::setTeamAlliance (const Alliance alliance)
+{
+    LOG << "Setting alliance to" << alliance;
+
+    switch ((Alliance) alliance) {
+    case AllianceRed:
+        DS_SetAlliance (DS_ALLIANCE_RED);
+        break;
+    case AllianceBlue:
+        DS_SetAlliance (DS_ALLIANCE_BLUE);
+        break;
+    }
+}
+
+/**
+ * Updates the team position, possible input values are:
+ *    - \c kPosition1 (0)
+ *    - \c kPosition2 (1)
+ *    - \c kPosition3 (2)
+ */
+void DriverStation::setTeamPosition (const Position position)
+{
+    LOG << "Setting position to" << position;
+
+    switch ((Position) position) {
+    case Position1:
+        DS_SetPosition (DS_POSITION_1);
+        break;
+    case Position2:
+        DS_SetPosition (DS_POSITION_2);
+        break;
+    case Position3:
+        DS_SetPosition (DS_POSITION_3);
+        break;
+    }
+}
+
+/**
+ * Changes the emergency stopped state of the robot
+ */
+void DriverStation::setEmergencyStopped (const bool stopped)
+{
+    LOG << "Setting ESTOP to" << stopped;
+    DS_SetEmergencyStopped (stopped);
+}
+
+/**
+ * Forces the LibDS to use the given \a address to communicate with the FMS
+ */
+void DriverStation::setCustomFMSAddress (const QString& address)
+{
+    stageConfiguration();
+    DS_SetCustomFMSAddress (getAddress (address).toStdString().c_str());
+    updateAddresses (FMSAddressSignal);
+}
+
+/**
+ * Forces the LibDS to use the given \a address to communicate with the radio
+ */
+void DriverStation::setCustomRadioAddress (const QString& address)
+{
+    stageConfiguration();
+    DS_SetCustomRadioAddress (getAddress (address).toStdString().c_str());
+    updateAddresses (RadioAddressSignal);
+}
+
+/**
+ * Forces the LibDS to use the given \a address to communicate with the robot
+ */
+void DriverStation::setCustomRobotAddress (const QString& address)
+{
+    stageConfiguration();
+    DS_SetCustomRobotAddress (getAddress (address).toStdString().c_str());
+    updateAddresses (RobotAddressSignal);
+}
+
+/**
+ * Changes the bandwidth budget (in Mbit/s), e.g. the per-team bandwidth cap
+ * of the field network. Set it to \c 0 to disable the budget warning.
+ */
+void DriverStation::setBandwidthBudget (const qreal mbps)
+{
+    if (!qFuzzyCompare (bandwidthBudget() + 1, mbps + 1)) {
+        DS_SetBandwidthBudget (mbps);
+        emit networkUsageChanged();
+    }
+}
+
+/**
+ * Broadcasts/sends the given \a message to the NetConsole network
+ */
+void DriverStation::sendNetConsoleMessage (const QString& message)
+{
+    if (!message.isEmpty())
+        DS_SendNetConsoleMessage (message.toStdString().c_str());
+}
+
+/**
+ * Controls an additional robot of the given \a team from this DS. The
+ * robot has its own LibDS context (protocol, sockets, joysticks and
+ * events), which shares the timer and socket threads with the main robot.
+ *
+ * \returns the new \c DSRobot
+ */
+QObject* DriverStation::addRobot (const int team)
+{
+    DSRobot* robot = new DSRobot (team, this);
+    connect (robot, &DSRobot::joysticksChanged,
+             this,  &DriverStation::joystickMappingChanged);
+
+    m_robots.append (robot);
+    updateHotkeys();
+    emit robotsChanged();
+    emit joystickMappingChanged();
+
+    return robot;
+}
+
+/**
+ * Stops controlling the additional robot with the given \a index (in the
+ * \c robots() list) and closes its LibDS context
+ */
+void DriverStation::removeRobot (const int index)
+{
+    if (index < 0 || index >= m_robots.count())
+        return;
+
+    /* Stop routing joystick input to the robot before it is deleted */
+    DSRobot* robot = m_robots.takeAt (index);
+    updateHotkeys();
+    emit joystickMappingChanged();
+    emit robotsChanged();
+
+    delete robot;
+}
+
+/**
+ * Disconnects from the dashboard server of the robot and clears the
+ * dashboard entries
+ */
+void DriverStation::stopDashboard()
+{
+    DS_StopDashboard();
+
+    if (!m_dashboard.isEmpty()) {
+        QStringList keys = m_dashboard.keys();
+        m_dashboard.clear();
+
+        foreach (const QString& key, keys)
+            emit dashboardValueChanged (key, QVariant());
+
+        emit dashboardChanged();
+    }
+}
+
+/**
+ * Connects to the dashboard server of the robot on the given \a port, or
+ * on the default port if \a port is \c 0
+ */
+void DriverStation::startDashboard (const int port)
+{
+    if (!DS_StartDashboard (port))
+        qWarning() << "Cannot start the dashboard on port" << port;
+}
+
+/**
+ * Changes the dashboard entry with the given \a key. Booleans, numbers and
+ * strings are sent with their own types, an invalid \a value deletes the
+ * entry.
+ */
+void DriverStation::setDashboardValue (const QString& key,
+                                       const QVariant& value)
+{
+    QByteArray name = key.toUtf8();
+
+    if (!value.isValid())
+        DS_DashboardDelete (name.constData());
+
+    else if (value.type() == QVariant::Bool)
+        DS_DashboardSetBoolean (name.constData(), value.toBool());
+
+    else if (value.canConvert<double>() && value.type() != QVariant::String)
+        DS_DashboardSetNumber (name.constData(), value.toDouble());
+
+    else
+        DS_DashboardSetString (name.constData(),
+                               value.toString().toUtf8().constData());
+}
+
+/**
+ * Checks (for about three seconds) whether this computer can keep up with
+ * the robot packets, see \c DS_RunSelfTest(). The test runs in the global
+ * thread pool, its results are published through the \c selfTest property.
+ */
+void DriverStation::runSelfTest()
+{
+    if (!DS_Initialized() || m_selfTestWatcher.isRunning())
+        return;
+
+    LOG << "Running self-test...";
+    connect (&m_selfTestWatcher, SIGNAL (finished()),
+             this,               SLOT (finishSelfTest()),
+             Qt::UniqueConnection);
+
+    /* The robot address is read from the context of the DS */
+    DS_Context* context = DS_ContextCurrent();
+    m_selfTestWatcher.setFuture (QtConcurrent::run ([context]() {
+        DS_SelfTestResult result = {};
+        DS_Context* previous = DS_ContextCurrent();
+
+        DS_ContextMakeCurrent (context);
+        const bool completed = DS_RunSelfTest (&result) != 0;
+        DS_ContextMakeCurrent (previous);
+
+        return selfTestMap (result, completed);
+    }));
+
+    emit selfTestChanged();
+}
+
+/**
+ * Enables or disables the event thread. When enabled, the LibDS events are
+ * drained (and coalesced) by a worker thread, which notifies the GUI thread
+ * through queued signals, so that a busy GUI thread does not delay the
+ * LibDS. The robot packets and the SDL joystick input never depend on the
+ * GUI thread.
+ *
+ * The event thread is disabled by default
+ */
+void DriverStation::setEventThreadEnabled (const bool enabled)
+{
+    if (changed (m_eventThreadEnabled, enabled) && DS_Initialized()) {
+        unwatchEvents();
+        watchEvents();
         processEvents();
-        updateElapsedTime();
-        emit statusChanged (generalStatus());
-        connect (qApp, SIGNAL (aboutToQuit()), this, SLOT (quitDS()));
     }
 }
 
 /**
- * Reboots the robot controller
+ * Enables or disables the hotkeys of the official DS: the spacebar
+ * emergency stops every robot and Enter disables every robot. The keys are
+ * read by a separate thread (see \c DSHotkeys), so they work even if the
+ * window is not focused or the GUI thread is busy.
+ *
+ * The hotkeys are disabled by default
  */
-void DriverStation::rebootRobot()
+void DriverStation::setHotkeysEnabled (const bool enabled)
 {
-    LOG << "Requesting robot reboot...";
-    DS_RebootRobot();
+    if (changed (m_hotkeysEnabled, enabled))
+        updateHotkeys();
 }
 
 /**
- * Removes all the registered joysticks from the Driver Station
+ * Enables or disables the \c telemetryFrame() signal. When enabled, the
+ * robot and communications state is published in a single frame at most
+ * once every \c FRAME_INTERVAL milliseconds (in addition to the individual
+ * property signals).
  */
-void DriverStation::resetJoysticks()
+void DriverStation::setTelemetryFramesEnabled (const bool enabled)
 {
-    LOG << "Resetting joysticks...";
-    DS_JoysticksReset();
+    if (changed (m_telemetryFrames, enabled)) {
+        emit telemetryFramesEnabledChanged (enabled);
+
+        if (enabled)
+            scheduleFrame();
+    }
+}
+
+/**
+ * Tells the wrapper if the UI is visible and focused. While the UI is in
+ * the background (e.g. minimized or behind the dashboard), the telemetry
+ * frames and the voltage and usage signals are emitted at most every
+ * \c BACKGROUND_INTERVAL milliseconds, so that the UI does not re-evaluate
+ * its bindings for values that nobody sees. The LibDS and the joystick
+ * input keep running at full rate.
+ *
+ * The held back signals are emitted as soon as the UI is in the foreground
+ * again.
+ */
+void DriverStation::setForeground (const bool foreground)
+{
+    if (changed (m_foreground, foreground)) {
+        LOG << "UI in" << (foreground ? "foreground" : "background");
+
+        if (foreground) {
+            emitDeferredSignals();
+            scheduleFrame();
+        }
+
+        emit foregroundChanged (foreground);
+    }
+}
+
+/**
+ * Registers a new joystick with the Driver Station
+ *
+ * \param axes the number of axes of the new joystick
+ * \param hats the number of hats/povs of the new joystick
+ * \param buttons the number of buttons of the new joystick
+ */
+void DriverStation::addJoystick (int axes, int hats, int buttons)
+{
+    DS_JoysticksAdd (axes, hats, buttons);
+
+    LOG << "Registered new joystick with"
+        << axes << "axes,"
+        << hats << "hats and"
+        << buttons << "buttons";
+
     emit joystickCountChanged();
 }
 
 /**
- * Restarts the robot code process in the robot controller
+ * Changes the layout of an already registered joystick and resets its values,
+ * the other joysticks keep their IDs and values
+ *
+ * \param joystick the ID of the joystick to replace
+ * \param axes the number of axes of the new joystick
+ * \param hats the number of hats/povs of the new joystick
+ * \param buttons the number of buttons of the new joystick
  */
-void DriverStation::restartRobotCode()
+void DriverStation::replaceJoystick (int joystick, int axes, int hats, int buttons)
 {
-    LOG << "Requesting robot code restart...";
-    DS_RestartRobotCode();
+    DS_JoysticksReplace (joystick, axes, hats, buttons);
+
+    LOG << "Replaced joystick" << joystick << "with"
+        << axes << "axes,"
+        << hats << "hats and"
+        << buttons << "buttons";
 }
 
 /**
- * Disables or enables the robot
+ * Updates the \a angle of the given \a hat of the given \a joystick
+ *
+ * \param joystick the ID of the joystick to update (e.g. 0 for Joystick 0)
+ * \param hat the ID of the hat to update (e.g. 0 for primary hat)
+ * \param angle the new angle to apply to the hat
  */
-void DriverStation::setEnabled (const bool enabled)
+void DriverStation::setJoystickHat (int joystick, int hat, int angle)
 {
-    LOG << "Setting enabled state to" << enabled;
+    DS_SetJoystickHat (joystick, hat, angle);
+}
 
-    if (enabled)
-        resetElapsedTime();
+/**
+ * Updates the \a value of the given \a axis of the given \a joystick
+ *
+ * \param joystick the ID of the joystick to update (e.g. 0 for Joystick 0)
+ * \param axis the ID of the axis to update (e.g. 0 for primary X axis)
+ * \param value the new value to apply to the given axis (e.g. 0.5)
+ *
+ * \note the \a value must have a range from \c -1 to \c 1
+ */
+void DriverStation::setJoystickAxis (int joystick, int axis, float value)
+{
+    DS_SetJoystickAxis (joystick, axis, value);
+}
 
-    DS_SetRobotEnabled (enabled);
+/**
+ * Updates the \a pressed state of the given \a button of the given \a joystick
+ *
+ * \param joystick the ID of the joystick to update (e.g. 0 for Joystick 0)
+ * \param button the ID of the button to update (e.g. 0 for A in an Xbox stick)
+ * \param pressed the new pressed state of the button
+ */
+void DriverStation::setJoystickButton (int joystick, int button, bool pressed)
+{
+    DS_SetJoystickButton (joystick, button, pressed);
 }
 
 /**
- * Changes the team \a number
- * \note Changing the team number will trigger a refresh in the internet
- *       addresses used to communicate with the FMS, radio and robot.
+ * Updates all the values of the given \a joystick at once, so the robot
+ * never receives a partially updated joystick
+ *
+ * \param joystick the ID of the joystick to update (e.g. 0 for Joystick 0)
+ * \param axes the values of the axes (from \c -1 to \c 1)
+ * \param buttons the pressed state of the buttons (bit n is button n)
+ * \param hats the angles of the hats
  */
-void DriverStation::setTeamNumber (const int number)
+void DriverStation::setJoystickState (int joystick, const QVector<float>& axes,
+                                      quint32 buttons, const QVector<int>& hats)
 {
-    LOG << "Changing team number to" << number;
-    DS_SetTeamNumber (number);
+    DS_SetJoystickState (joystick, axes.constData(), axes.count(),
+                         buttons, hats.constData(), hats.count());
+}
 
-    emit fmsAddressChanged();
-    emit radioAddressChanged();
-    emit robotAddressChanged();
-    emit teamNumberChanged (number);
+/**
+ * Breaks the internal loops of the LibDS, de-allocates its assets and
+ * closes all the network sockets used by the library
+ */
+void DriverStation::quitDS()
+{
+    if (DS_Initialized()) {
+        LOG << "Stopping DS Engine...";
+        m_configTimer.stop();
+        m_selfTestWatcher.waitForFinished();
+        unwatchEvents();
+
+        delete m_hotkeys;
+        m_hotkeys = nullptr;
+
+        while (!m_robots.isEmpty())
+            removeRobot (m_robots.count() - 1);
+
+        DS_Close();
+        LOG << "DS Engine Stopped";
+    }
 }
 
 /**
- * De-allocates the current protocol and loads the given \a protocol
+ * Calls \c processEvents() whenever the LibDS event handle is signaled,
+ * if the handle is not available, the events are polled every 5 ms.
  *
- * \param protocol the new communication protocol to use
+ * If the event thread is enabled, the events are drained by the thread and
+ * \c processEvents() is called (through a queued connection) when it has
+ * received new events.
+ */
+void DriverStation::watchEvents()
+{
+    if (m_eventThreadEnabled) {
+        m_eventThread = new DSEventThread();
+        connect (m_eventThread, SIGNAL (eventsAvailable()),
+                 this,            SLOT (processEvents()),
+                 Qt::QueuedConnection);
+        m_eventThread->start();
+        return;
+    }
+
+    DS_EventHandle handle = DS_GetEventHandle();
+
+#if defined Q_OS_WIN
+    if (handle) {
+        QWinEventNotifier* notifier = new QWinEventNotifier (handle, this);
+        connect (notifier, SIGNAL (activated (HANDLE)),
+                 this,       SLOT (processEvents()));
+        m_eventNotifier = notifier;
+    }
+#else
+    if (handle >= 0) {
+        QSocketNotifier* notifier = new QSocketNotifier (handle,
+                                                         QSocketNotifier::Read,
+                                                         this);
+        connect (notifier, SIGNAL (activated (int)),
+                 this,       SLOT (processEvents()));
+        m_eventNotifier = notifier;
+    }
+#endif
+
+    if (!m_eventNotifier)
+        LOG << "Cannot watch event handle, polling events instead";
+}
+
+/**
+ * Starts or stops the hotkeys, and gives them the LibDS contexts of the
+ * main robot and of the additional robots
  */
-void DriverStation::loadProtocol (const DS_Protocol& protocol)
+void DriverStation::updateHotkeys()
 {
-    DS_ConfigureProtocol (&protocol);
+    if (!m_hotkeysEnabled || !DS_Initialized()) {
+        delete m_hotkeys;
+        m_hotkeys = nullptr;
+        return;
+    }
+
+    if (!m_hotkeys) {
+        m_hotkeys = new DSHotkeys();
+        m_hotkeys->start();
+
+        if (!m_hotkeys->global())
+            LOG << "Cannot read the keyboard globally, hotkeys only work"
+                << "while the window is focused";
+    }
+
+    QList<DS_Context*> contexts;
+    contexts.append (DS_ContextCurrent());
+    foreach (DSRobot* robot, m_robots)
+        contexts.append (robot->context());
+
+    m_hotkeys->setContexts (contexts);
+}
+
+/**
+ * Stops watching the LibDS event handle (or stops the event thread)
+ */
+void DriverStation::unwatchEvents()
+{
+    delete m_eventThread;
+    m_eventThread = nullptr;
+
+    delete m_eventNotifier;
+    m_eventNotifier = nullptr;
+}
+
+/**
+ * Polls for new LibDS events and emits Qt signals as appropiate.
+ * This function is called when the LibDS event handle is signaled (or
+ * every 5 milliseconds if the event handle is not available), or when the
+ * event thread has received new events.
+ *
+ * Signals are only emitted when the published value of a property changes,
+ * so that QML does not re-evaluate its bindings for nothing.
+ */
+void DriverStation::processEvents()
+{
+    DS_TRACE_SCOPE ("DriverStation::processEvents");
+
+    if (m_eventThread) {
+        foreach (const DSEventThread::Event& item, m_eventThread->takeEvents())
+            handleEvent (item.event, item.message);
+    }
 
-    setCustomFMSAddress (customFMSAddress());
-    setCustomRadioAddress (customRadioAddress());
-    setCustomRobotAddress (customRobotAddress());
+    else {
+        DS_Event event;
+        while (DS_PollEvent (&event)) {
+            QString message;
+            if (event.type == DS_NETCONSOLE_NEW_MESSAGE)
+                message = QString::fromUtf8 (event.netconsole.message);
 
-    emit protocolChanged();
-    emit statusChanged (QString::fromUtf8 (DS_GetStatusString()));
+            handleEvent (event, message);
+        }
+    }
+
+    scheduleFrame();
+
+    if (!m_eventNotifier && !m_eventThread)
+        QTimer::singleShot (5, Qt::CoarseTimer, this, SLOT (processEvents()));
 }
 
 /**
- * Changes the control \a mode of the robot
+ * Updates the published values with the given LibDS \a event and emits the
+ * signals of the values that changed. The \a message of NetConsole message
+ * events is given separately (the event thread copies it).
  */
-void DriverStation::setControlMode (const Control mode)
+void DriverStation::handleEvent (const DS_Event& event, const QString& message)
 {
-    LOG << "Setting control mode to" << mode;
-
-    if (isEnabled() && mode != controlMode())
-        setEnabled (false);
-    if (mode != controlMode())
-        resetElapsedTime();
+    m_eventTime = event.header.time;
 
-    switch (mode) {
-    case ControlTest:
-        DS_SetControlMode (DS_CONTROL_TEST);
+    switch (event.type) {
+    case DS_FMS_COMMS_CHANGED:
+        updateAddresses (0);
+        if (changed (m_fmsCommunications, (bool) event.fms.connected))
+            emit fmsCommunicationsChanged (m_fmsCommunications);
         break;
-    case ControlAutonomous:
-        DS_SetControlMode (DS_CONTROL_AUTONOMOUS);
+    case DS_RADIO_COMMS_CHANGED:
+        updateAddresses (0);
+        if (changed (m_radioCommunications, (bool) event.radio.connected))
+            emit radioCommunicationsChanged (m_radioCommunications);
         break;
-    case ControlTeleoperated:
-        DS_SetControlMode (DS_CONTROL_TELEOPERATED);
+    case DS_NETCONSOLE_NEW_MESSAGE:
+        emit newMessage (message);
         break;
-    default:
-        DS_SetControlMode (DS_CONTROL_TELEOPERATED);
+    case DS_NETCONSOLE_NEW_LINES:
+        readNetConsole();
         break;
-    }
-}
-
-/**
- * Loads the given \a protocol type.
- *
- * \note You can use this function directly with the index values given by the
- *       \c protocols() function
- */
-void DriverStation::setProtocol (const Protocol protocol)
-{
-    switch ((Protocol) protocol) {
-    case Protocol2014:
-        loadProtocol (DS_GetProtocolFRC_2014());
-        LOG << "Switched to FRC 2014 Protocol";
+    case DS_DASHBOARD_CHANGED:
+        readDashboard();
         break;
-    case Protocol2015:
-        loadProtocol (DS_GetProtocolFRC_2015());
-        LOG << "Switched to FRC 2015 Protocol";
+    case DS_FMS_MATCH_CHANGED:
+        emit fmsMatchChanged();
         break;
-    case Protocol2016:
-        loadProtocol (DS_GetProtocolFRC_2016());
-        LOG << "Switched to FRC 2016 Protocol";
+    case DS_MATCH_FINISHED:
+        emit matchFinished();
         break;
-    default:
+    case DS_ROBOT_ENABLED_CHANGED:
+        if (changed (m_enabled, (bool) event.robot.enabled)) {
+            updateMatchTimer (m_enabled);
+            emit enabledChanged (m_enabled);
+        }
         break;
-    }
-}
+    case DS_ROBOT_MODE_CHANGED:
+        if (changed (m_controlMode, controlMode()))
+            emit controlModeChanged (m_controlMode);
+        break;
+    case DS_ROBOT_COMMS_CHANGED:
+        updateAddresses (0);
+        if (changed (m_robotCommunications, (bool) event.robot.connected)) {
+            if (m_robotCommunications)
+                saveKnownRobotAddress();
 
-/**
- * Changes the team alliance and position based on the given \a station
- *
- * Possible input values are:
- *   - \c kStationRed1 (0)
- *   - \c kStationRed2 (1)
- *   - \c kStationRed3 (2)
- *   - \c kStationBlue1 (3)
- *   - \c kStationBlue2 (4)
- *   - \c kStationBlue3 (5)
- *
- * \note You can use this function directly with the output given by the \c
- *       \c stations() function
- */
-void DriverStation::setTeamStation (const Station station)
-{
-    switch (station) {
-    case StationRed1:
-        setTeamPosition (Position1);
-        setTeamAlliance (AllianceRed);
+            emit robotCommunicationsChanged (m_robotCommunications);
+        }
         break;
-    case StationRed2:
-        setTeamPosition (Position2);
-        setTeamAlliance (AllianceRed);
+    case DS_ROBOT_CODE_CHANGED:
+        if (changed (m_robotCode, (bool) event.robot.code))
+            emit robotCodeChanged (m_robotCode);
         break;
-    case StationRed3:
-        setTeamPosition (Position3);
-        setTeamAlliance (AllianceRed);
+    case DS_ROBOT_VOLTAGE_CHANGED:
+        /* Only notify changes that are visible in the voltage string */
+        if (changed (m_voltage, qRound (event.robot.voltage * 100)))
+            deferSignal (VoltageSignal);
         break;
-    case StationBlue1:
-        setTeamPosition (Position1);
-        setTeamAlliance (AllianceBlue);
+    case DS_ROBOT_BROWNOUT_WARNING:
+        if (changed (m_brownoutWarning, (bool) event.brownout.warning))
+            emit brownoutWarningChanged (m_brownoutWarning);
         break;
-    case StationBlue2:
-        setTeamPosition (Position2);
-        setTeamAlliance (AllianceBlue);
+    case DS_ROBOT_CAN_UTIL_CHANGED:
+        if (changed (m_canUsage, event.robot.can_util))
+            deferSignal (CANUsageSignal);
         break;
-    case StationBlue3:
-        setTeamPosition (Position3);
-        setTeamAlliance (AllianceBlue);
+    case DS_ROBOT_CPU_INFO_CHANGED:
+        if (changed (m_cpuUsage, event.robot.cpu_usage))
+            deferSignal (CPUUsageSignal);
+        break;
+    case DS_ROBOT_RAM_INFO_CHANGED:
+        if (changed (m_ramUsage, event.robot.ram_usage))
+            deferSignal (RAMUsageSignal);
+        break;
+    case DS_ROBOT_DISK_INFO_CHANGED:
+        if (changed (m_diskUsage, event.robot.disk_usage))
+            deferSignal (DiskUsageSignal);
+        break;
+    case DS_ROBOT_STATION_CHANGED: {
+        bool alliance = changed (m_alliance, teamAlliance());
+        bool position = changed (m_position, teamPosition());
+
+        if (alliance || position)
+            emit stationChanged();
+        if (alliance)
+            emit allianceChanged (m_alliance);
+        if (position)
+            emit positionChanged (m_position);
+        break;
+    }
+    case DS_ROBOT_ESTOP_CHANGED:
+        if (changed (m_emergencyStop, (bool) event.robot.estopped))
+            emit emergencyStoppedChanged (m_emergencyStop);
+        break;
+    case DS_STATUS_STRING_CHANGED:
+        updateStatus();
         break;
     default:
         break;
     }
+
+    m_eventTime = 0;
 }
 
 /**
- * Updates the team alliance, possible input values are:
- *    - \c kAllianceRed (0)
- *    - \c kAllianceBlue (1)
+ * Emits the \c telemetryFrame() signal if the robot or communications state
+ * changed since the last frame
  */
-void DriverStation::setTeamAlliance (const Alliance alliance)
+void DriverStation::publishFrame()
 {
-    LOG << "Setting alliance to" << alliance;
+    m_framePending = false;
 
-    switch ((Alliance) alliance) {
-    case AllianceRed:
-        DS_SetAlliance (DS_ALLIANCE_RED);
-        break;
-    case AllianceBlue:
-        DS_SetAlliance (DS_ALLIANCE_BLUE);
-        break;
-    }
+    if (m_telemetryFrames && changed (m_frame, currentFrame()))
+        emit telemetryFrame (m_frame);
 }
 
 /**
- * Updates the team position, possible input values are:
- *    - \c kPosition1 (0)
- *    - \c kPosition2 (1)
- *    - \c kPosition3 (2)
+ * Publishes the results of the self-test once it finishes
  */
-void DriverStation::setTeamPosition (const Position position)
+void DriverStation::finishSelfTest()
 {
-    LOG << "Setting position to" << position;
+    m_selfTest = m_selfTestWatcher.result();
+    LOG << "Self-test" << (m_selfTest.value ("passed").toBool() ? "passed" :
+                           "failed");
 
-    switch ((Position) position) {
-    case Position1:
-        DS_SetPosition (DS_POSITION_1);
-        break;
-    case Position2:
-        DS_SetPosition (DS_POSITION_2);
-        break;
-    case Position3:
-        DS_SetPosition (DS_POSITION_3);
-        break;
+    emit selfTestChanged();
+}
+
+/**
+ * Emits the telemetry signals held back by \c deferSignal() with the last
+ * published values
+ */
+void DriverStation::emitDeferredSignals()
+{
+    const int pending = m_deferredSignals;
+    const quint64 eventTime = m_eventTime;
+    m_deferredSignals = 0;
+    m_deferredPending = false;
+
+    /* Each signal is emitted with the time of the event of its value */
+    if (pending & VoltageSignal) {
+        m_eventTime = m_deferredTimes [deferredIndex (VoltageSignal)];
+        emit voltageChanged (m_voltage / 100.0f);
+    }
+    if (pending & CANUsageSignal) {
+        m_eventTime = m_deferredTimes [deferredIndex (CANUsageSignal)];
+        emit canUsageChanged (m_canUsage);
     }
+    if (pending & CPUUsageSignal) {
+        m_eventTime = m_deferredTimes [deferredIndex (CPUUsageSignal)];
+        emit cpuUsageChanged (m_cpuUsage);
+    }
+    if (pending & RAMUsageSignal) {
+        m_eventTime = m_deferredTimes [deferredIndex (RAMUsageSignal)];
+        emit ramUsageChanged (m_ramUsage);
+    }
+    if (pending & DiskUsageSignal) {
+        m_eventTime = m_deferredTimes [deferredIndex (DiskUsageSignal)];
+        emit diskUsageChanged (m_diskUsage);
+    }
+
+    m_eventTime = eventTime;
 }
 
 /**
- * Changes the emergency stopped state of the robot
+ * Reads the new NetConsole lines stored by the LibDS in batches and emits
+ * them with a single \c newEntries() signal (and a single \c newMessages()
+ * signal with their plain text). If the robot printed more
+ * than \c NETCONSOLE_LIMIT lines, the rest are read in the next iteration
+ * of the Qt event loop, so that the UI is never blocked by the NetConsole.
  */
-void DriverStation::setEmergencyStopped (const bool stopped)
+void DriverStation::readNetConsole()
 {
-    LOG << "Setting ESTOP to" << stopped;
-    DS_SetEmergencyStopped (stopped);
+    static char buffer [NETCONSOLE_BATCH * 64 + DS_NETCONSOLE_LINE_SIZE];
+    DS_NetConsoleLine lines [NETCONSOLE_BATCH];
+
+    QVector<NetConsoleEntry> entries;
+    int count = 0;
+    do {
+        count = DS_NetConsoleRead (&m_netConsoleCursor, lines, NETCONSOLE_BATCH,
+                                   buffer, sizeof (buffer));
+
+        for (int i = 0; i < count; ++i) {
+            NetConsoleEntry entry;
+            entry.text = QString::fromUtf8 (lines [i].text, (int) lines [i].len);
+            entry.source = lines [i].source;
+            entry.severity = lines [i].severity;
+            entry.time = (qint64) (lines [i].time / 1000);
+            entries.append (entry);
+        }
+    } while (count > 0 && entries.count() < NETCONSOLE_LIMIT);
+
+    if (entries.isEmpty())
+        return;
+
+    QStringList messages;
+    messages.reserve (entries.count());
+    for (int i = 0; i < entries.count(); ++i)
+        messages.append (entries.at (i).toPlainText());
+
+    for (int i = 0; i < messages.count(); ++i)
+        emit newMessage (messages.at (i));
+
+    emit newEntries (entries);
+    emit newMessages (messages);
+
+    if (count > 0)
+        QTimer::singleShot (0, this, SLOT (readNetConsole()));
 }
 
 /**
- * Forces the LibDS to use the given \a address to communicate with the FMS
+ * Reads the dashboard entries that changed since the last call, updates
+ * the dashboard map and emits a \c dashboardValueChanged() signal for each
+ * changed entry (with an invalid value for deleted entries)
  */
-void DriverStation::setCustomFMSAddress (const QString& address)
+void DriverStation::readDashboard()
 {
-    LOG << "Using new FMS address" << getAddress (address);
-    DS_SetCustomFMSAddress (getAddress (address).toStdString().c_str());
+    DS_DashboardEntry entries [DASHBOARD_BATCH];
+
+    int count = 0;
+    bool updated = false;
+    do {
+        count = DS_DashboardRead (&m_dashboardCursor, entries, DASHBOARD_BATCH);
 
-    emit fmsAddressChanged();
+        for (int i = 0; i < count; ++i) {
+            QVariant value;
+            QString key = QString::fromUtf8 (entries [i].key);
+
+            switch (entries [i].type) {
+            case DS_DASHBOARD_BOOLEAN:
+                value = entries [i].number != 0;
+                break;
+            case DS_DASHBOARD_NUMBER:
+                value = entries [i].number;
+                break;
+            case DS_DASHBOARD_STRING:
+                value = QString::fromUtf8 (entries [i].text);
+                break;
+            default:
+                break;
+            }
+
+            if (value.isValid())
+                m_dashboard.insert (key, value);
+            else
+                m_dashboard.remove (key);
+
+            updated = true;
+            emit dashboardValueChanged (key, value);
+        }
+    } while (count == DASHBOARD_BATCH);
+
+    if (updated)
+        emit dashboardChanged();
 }
 
 /**
- * Forces the LibDS to use the given \a address to communicate with the radio
+ * Reads the network usage of each channel (and the bandwidth) and emits
+ * \c networkUsageChanged() if the formatted values changed. This function
+ * is called again after \c NETWORK_USAGE_INTERVAL milliseconds.
  */
-void DriverStation::setCustomRadioAddress (const QString& address)
+void DriverStation::updateNetworkUsage()
 {
-    LOG << "Using new radio address" << getAddress (address);
-    DS_SetCustomRadioAddress (getAddress (address).toStdString().c_str());
+    bool fms = changed (m_fmsNetworkUsage,
+                        networkUsageText (DS_GetFMSTrafficInfo()));
+    bool radio = changed (m_radioNetworkUsage,
+                          networkUsageText (DS_GetRadioTrafficInfo()));
+    bool robot = changed (m_robotNetworkUsage,
+                          networkUsageText (DS_GetRobotTrafficInfo()));
+    bool bandwidth = changed (m_bandwidthUsage, bandwidthText());
 
-    emit radioAddressChanged();
+    if (fms || radio || robot || bandwidth)
+        emit networkUsageChanged();
+
+    QTimer::singleShot (NETWORK_USAGE_INTERVAL, Qt::CoarseTimer,
+                        this, SLOT (updateNetworkUsage()));
 }
 
 /**
- * Forces the LibDS to use the given \a address to communicate with the robot
+ * Restarts the elapsed time counter
  */
-void DriverStation::setCustomRobotAddress (const QString& address)
+void DriverStation::resetElapsedTime()
 {
-    LOG << "Using new robot address" << getAddress (address);
-    DS_SetCustomRobotAddress (getAddress (address).toStdString().c_str());
-    emit robotAddressChanged();
+    m_matchElapsedTime = 0;
+    m_matchTimer.restart();
+    m_matchStartTime = QDateTime::currentMSecsSinceEpoch();
+
+    emit matchTimerChanged();
 }
 
 /**
- * Broadcasts/sends the given \a message to the NetConsole network
+ * Creates and starts an operation (owned by this object) that waits for
+ * the given \a conditions, one after the other, for up to \a timeout msecs
  */
-void DriverStation::sendNetConsoleMessage (const QString& message)
+DriverStationOperation* DriverStation::startOperation (
+    const int timeout,
+    const QList<DriverStationOperation::Condition>& conditions)
 {
-    if (!message.isEmpty())
-        DS_SendNetConsoleMessage (message.toStdString().c_str());
+    DriverStationOperation* operation = new DriverStationOperation (timeout,
+                                                                    this);
+    foreach (const DriverStationOperation::Condition condition, conditions)
+        operation->addCondition (condition);
+
+    operation->start();
+    return operation;
 }
 
 /**
- * Registers a new joystick with the Driver Station
- *
- * \param axes the number of axes of the new joystick
- * \param hats the number of hats/povs of the new joystick
- * \param buttons the number of buttons of the new joystick
+ * Starts or stops the match timer. The timer is only updated when the
+ * enabled state of the robot changes, the elapsed time is computed on
+ * demand by \c matchElapsedTime()
  */
-void DriverStation::addJoystick (int axes, int hats, int buttons)
+void DriverStation::updateMatchTimer (const bool running)
 {
-    DS_JoysticksAdd (axes, hats, buttons);
+    if (running == m_matchTimerRunning)
+        return;
 
-    LOG << "Registered new joystick with"
-        << axes << "axes,"
-        << hats << "hats and"
-        << buttons << "buttons";
+    if (running) {
+        m_matchTimer.restart();
+        m_matchStartTime = QDateTime::currentMSecsSinceEpoch()
+                           - m_matchElapsedTime;
+    }
 
-    emit joystickCountChanged();
+    else {
+        m_matchElapsedTime += m_matchTimer.elapsed();
+        LOG << "Match timer stopped at"
+            << formatMatchTime (m_matchElapsedTime, true);
+    }
+
+    m_matchTimerRunning = running;
+    emit matchTimerChanged();
 }
 
 /**
- * Updates the \a angle of the given \a hat of the given \a joystick
- *
- * \param joystick the ID of the joystick to update (e.g. 0 for Joystick 0)
- * \param hat the ID of the hat to update (e.g. 0 for primary hat)
- * \param angle the new angle to apply to the hat
+ * Publishes the status string of the LibDS (if it changed)
  */
-void DriverStation::setJoystickHat (int joystick, int hat, int angle)
+void DriverStation::updateStatus()
 {
-    DS_SetJoystickHat (joystick, hat, angle);
+    const DS_Status status = DS_GetStatus();
+
+    if (m_statusId != status) {
+        m_statusId = status;
+        m_status = statusName (status);
+        emit statusChanged (m_status);
+        scheduleFrame();
+    }
 }
 
 /**
- * Updates the \a value of the given \a axis of the given \a joystick
- *
- * \param joystick the ID of the joystick to update (e.g. 0 for Joystick 0)
- * \param axis the ID of the axis to update (e.g. 0 for primary X axis)
- * \param value the new value to apply to the given axis (e.g. 0.5)
- *
- * \note the \a value must have a range from \c -1 to \c 1
+ * Schedules the emission of a telemetry frame, so that all the events
+ * received until the next frame are published together
  */
-void DriverStation::setJoystickAxis (int joystick, int axis, float value)
+void DriverStation::scheduleFrame()
 {
-    DS_SetJoystickAxis (joystick, axis, value);
+    if (m_telemetryFrames && !m_framePending) {
+        m_framePending = true;
+        QTimer::singleShot (m_foreground ? FRAME_INTERVAL : BACKGROUND_INTERVAL,
+                            Qt::PreciseTimer, this, SLOT (publishFrame()));
+    }
 }
 
 /**
- * Updates the \a pressed state of the given \a button of the given \a joystick
- *
- * \param joystick the ID of the joystick to update (e.g. 0 for Joystick 0)
- * \param button the ID of the button to update (e.g. 0 for A in an Xbox stick)
- * \param pressed the new pressed state of the button
+ * Emits the given telemetry \a signal, or holds it back until the next
+ * \c emitDeferredSignals() call if the UI is in the background
  */
-void DriverStation::setJoystickButton (int joystick, int button, bool pressed)
+void DriverStation::deferSignal (const DeferredSignal signal)
 {
-    DS_SetJoystickButton (joystick, button, pressed);
+    m_deferredSignals |= signal;
+    m_deferredTimes [deferredIndex (signal)] = m_eventTime;
+
+    if (m_foreground)
+        emitDeferredSignals();
+
+    else if (!m_deferredPending) {
+        m_deferredPending = true;
+        QTimer::singleShot (BACKGROUND_INTERVAL, Qt::CoarseTimer,
+                            this, SLOT (emitDeferredSignals()));
+    }
 }
 
 /**
- * Breaks the internal loops of the LibDS, de-allocates its assets and
- * closes all the network sockets used by the library
+ * Returns a telemetry frame with the last published values of the
+ * robot and communications state
  */
-void DriverStation::quitDS()
+DriverStationFrame DriverStation::currentFrame() const
 {
-    if (DS_Initialized()) {
-        LOG << "Stopping DS Engine...";
-        DS_Close();
-        LOG << "DS Engine Stopped";
-    }
+    DriverStationFrame frame;
+
+    frame.enabled = m_enabled;
+    frame.robotCode = m_robotCode;
+    frame.emergencyStopped = m_emergencyStop;
+    frame.connectedToFMS = m_fmsCommunications;
+    frame.connectedToRadio = m_radioCommunications;
+    frame.connectedToRobot = m_robotCommunications;
+    frame.voltage = m_voltage / 100.0;
+    frame.cpuUsage = m_cpuUsage;
+    frame.canUsage = m_canUsage;
+    frame.ramUsage = m_ramUsage;
+    frame.diskUsage = m_diskUsage;
+    frame.controlMode = m_controlMode;
+    frame.alliance = m_alliance;
+    frame.position = m_position;
+    frame.status = m_status;
+
+    return frame;
 }
 
 /**
- * Polls for new LibDS events and emits Qt signals as appropiate.
- * This function is called every 5 milliseconds.
+ * Reads the addresses applied by the LibDS and emits the address signals
+ * of the addresses that changed. The signals given in \a forcedSignals are
+ * always emitted (e.g. because the default or custom address changed).
  */
-void DriverStation::processEvents()
+void DriverStation::updateAddresses (const int forcedSignals)
 {
-    DS_Event event;
-    while (DS_PollEvent (&event)) {
-        switch (event.type) {
-        case DS_FMS_COMMS_CHANGED:
-            emit fmsAddressChanged();
-            emit fmsCommunicationsChanged (event.fms.connected);
-            break;
-        case DS_RADIO_COMMS_CHANGED:
-            emit radioAddressChanged();
-            emit radioCommunicationsChanged (event.radio.connected);
-            break;
-        case DS_NETCONSOLE_NEW_MESSAGE:
-            emit newMessage (QString::fromUtf8 (event.netconsole.message));
-            break;
-        case DS_ROBOT_ENABLED_CHANGED:
-            emit enabledChanged (event.robot.enabled);
-            break;
-        case DS_ROBOT_MODE_CHANGED:
-            emit controlModeChanged (controlMode());
-            break;
-        case DS_ROBOT_COMMS_CHANGED:
-            emit robotAddressChanged();
-            emit robotCommunicationsChanged (event.robot.connected);
-            break;
-        case DS_ROBOT_CODE_CHANGED:
-            emit robotCodeChanged (event.robot.code);
-            break;
-        case DS_ROBOT_VOLTAGE_CHANGED:
-            emit voltageChanged (event.robot.voltage);
-            break;
-        case DS_ROBOT_CAN_UTIL_CHANGED:
-            emit canUsageChanged (event.robot.can_util);
-            break;
-        case DS_ROBOT_CPU_INFO_CHANGED:
-            emit cpuUsageChanged (event.robot.cpu_usage);
-            break;
-        case DS_ROBOT_RAM_INFO_CHANGED:
-            emit ramUsageChanged (event.robot.ram_usage);
-            break;
-        case DS_ROBOT_DISK_INFO_CHANGED:
-            emit diskUsageChanged (event.robot.disk_usage);
-            break;
-        case DS_ROBOT_STATION_CHANGED:
-            emit stationChanged();
-            emit allianceChanged (teamAlliance());
-            emit positionChanged (teamPosition());
-            break;
-        case DS_ROBOT_ESTOP_CHANGED:
-            emit emergencyStoppedChanged (event.robot.estopped);
-            break;
-        case DS_STATUS_STRING_CHANGED:
-            emit statusChanged (QString::fromUtf8 (DS_GetStatusString()));
-            break;
-        default:
-            break;
-        }
-    }
+    if (changed (m_appliedFMSAddress, takeString (DS_GetAppliedFMSAddress()))
+        || (forcedSignals & FMSAddressSignal))
+        emit fmsAddressChanged();
+
+    if (changed (m_appliedRadioAddress, takeString (DS_GetAppliedRadioAddress()))
+        || (forcedSignals & RadioAddressSignal))
+        emit radioAddressChanged();
 
-    QTimer::singleShot (5, Qt::CoarseTimer, this, SLOT (processEvents()));
+    if (changed (m_appliedRobotAddress, takeString (DS_GetAppliedRobotAddress()))
+        || (forcedSignals & RobotAddressSignal))
+        emit robotAddressChanged();
 }
 
 /**
- * Restarts the elapsed time counter
+ * Opens a LibDS configuration transaction (if needed) and restarts the
+ * debounce timer, the changes are applied by \c applyConfiguration()
  */
-void DriverStation::resetElapsedTime()
+void DriverStation::stageConfiguration()
 {
-    m_time.restart();
-    m_elapsedTime.clear();
-    emit elapsedTimeChanged (elapsedTime());
+    if (!DS_ConfigurationPending())
+        DS_BeginConfiguration();
+
+    m_configTimer.start();
 }
 
 /**
- * Updates the elapsed time and formats it as a string only if the robot
- * is currently enabled
+ * Applies the staged team number and custom addresses, the sockets are
+ * only updated if the addresses really changed
  */
-void DriverStation::updateElapsedTime()
+void DriverStation::applyConfiguration()
 {
-    if (isEnabled()) {
-        int milliseconds = m_time.elapsed();
-        int seconds = (milliseconds / 1000);
-        int minutes = (seconds / 60) % 60;
+    m_configTimer.stop();
 
-        seconds = seconds % 60;
-        milliseconds = milliseconds % 1000;
+    if (DS_ConfigurationPending()) {
+        LOG << "Applying team" << teamNumber()
+            << "and robot address" << m_appliedRobotAddress;
 
-        m_elapsedTime = QString ("%1:%2.%3")
-                        .arg (minutes, 2, 10, QLatin1Char ('0'))
-                        .arg (seconds, 2, 10, QLatin1Char ('0'))
-                        .arg (QString::number (milliseconds).at (0));
+        if (DS_CurrentProtocol())
+            restoreKnownRobotAddress (*DS_CurrentProtocol());
 
-        emit elapsedTimeChanged (elapsedTime());
+        DS_CommitConfiguration();
     }
+}
+
+/**
+ * Gives the LibDS the address through which the robot of the current team
+ * was reached the last time the given \a protocol was used, so that it is
+ * probed right away instead of waiting for the robot name to be resolved
+ */
+void DriverStation::restoreKnownRobotAddress (const DS_Protocol& protocol)
+{
+    QSettings settings (qApp->organizationName(), qApp->applicationName());
+    QString address = settings.value (knownAddressKey (protocol)).toString();
+    DS_SetKnownRobotAddress (address.toUtf8().constData());
+}
+
+/**
+ * Stores the address through which the robot is reached, a stale address
+ * is replaced once the robot is found through another address
+ */
+void DriverStation::saveKnownRobotAddress()
+{
+    QString address = takeString (DS_GetRobotEndpoint());
+    if (address.isEmpty() || !DS_CurrentProtocol())
+        return;
 
-    QTimer::singleShot (100, Qt::PreciseTimer,
-                        this, SLOT (updateElapsedTime()));
+    QSettings settings (qApp->organizationName(), qApp->applicationName());
+    QString key = knownAddressKey (*DS_CurrentProtocol());
+    if (settings.value (key).toString() != address) {
+        LOG << "Robot reached through" << address;
+        settings.setValue (key, address);
+    }
 }
 
 /**
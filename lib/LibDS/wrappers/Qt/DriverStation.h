@@ -27,11 +27,26 @@
     #include <QtQml>
 #endif
 
-#include <QTime>
 #include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QVariantMap>
+#include <QVector>
 #include <QStringList>
+#include <QFutureWatcher>
+#include <DS_Events.h>
+#include <DS_History.h>
 #include <DS_Protocol.h>
 
+#include "NetConsoleEntry.h"
+#include "TelemetryReader.h"
+#include "DriverStationFrame.h"
+#include "DriverStationOperation.h"
+
+class DSRobot;
+class DSHotkeys;
+class DSEventThread;
+
 class DriverStation : public QObject
 {
     Q_OBJECT
@@ -67,6 +82,9 @@ class DriverStation : public QObject
     Q_PROPERTY (qreal maximumBatteryVoltage
                 READ maximumBatteryVoltage
                 NOTIFY protocolChanged)
+    Q_PROPERTY (bool brownoutWarning
+                READ brownoutWarning
+                NOTIFY brownoutWarningChanged)
     Q_PROPERTY (bool robotCode
                 READ hasRobotCode
                 NOTIFY robotCodeChanged)
@@ -107,7 +125,7 @@ class DriverStation : public QObject
                 NOTIFY fmsAddressChanged)
     Q_PROPERTY (QString appliedRadioAddress
                 READ appliedRadioAddress
-                NOTIFY robotAddressChanged)
+                NOTIFY radioAddressChanged)
     Q_PROPERTY (QString appliedRobotAddress
                 READ appliedRobotAddress
                 NOTIFY robotAddressChanged)
@@ -116,7 +134,7 @@ class DriverStation : public QObject
                 NOTIFY fmsAddressChanged)
     Q_PROPERTY (QString defaultRadioAddress
                 READ defaultRadioAddress
-                NOTIFY robotAddressChanged)
+                NOTIFY radioAddressChanged)
     Q_PROPERTY (QString defaultRobotAddress
                 READ defaultRobotAddress
                 NOTIFY robotAddressChanged)
@@ -127,20 +145,38 @@ class DriverStation : public QObject
     Q_PROPERTY (QString customRadioAddress
                 READ customRadioAddress
                 WRITE setCustomRadioAddress
-                NOTIFY robotAddressChanged)
+                NOTIFY radioAddressChanged)
     Q_PROPERTY (QString customRobotAddress
                 READ customRobotAddress
                 WRITE setCustomRobotAddress
                 NOTIFY robotAddressChanged)
     Q_PROPERTY (QString elapsedTime
                 READ elapsedTime
-                NOTIFY elapsedTimeChanged)
+                NOTIFY matchTimerChanged)
+    Q_PROPERTY (bool matchTimerRunning
+                READ matchTimerRunning
+                NOTIFY matchTimerChanged)
+    Q_PROPERTY (qint64 matchStartTime
+                READ matchStartTime
+                NOTIFY matchTimerChanged)
+    Q_PROPERTY (qint64 matchElapsedTime
+                READ matchElapsedTime
+                NOTIFY matchTimerChanged)
+    Q_PROPERTY (int fmsMatchNumber
+                READ fmsMatchNumber
+                NOTIFY fmsMatchChanged)
+    Q_PROPERTY (int fmsReplayNumber
+                READ fmsReplayNumber
+                NOTIFY fmsMatchChanged)
+    Q_PROPERTY (int matchTimeRemaining
+                READ matchTimeRemaining
+                NOTIFY fmsMatchChanged)
     Q_PROPERTY (QStringList stations
                 READ stations
                 CONSTANT)
     Q_PROPERTY (QStringList protocols
                 READ protocols
-                CONSTANT)
+                NOTIFY protocolsChanged)
     Q_PROPERTY (QString libDSVersion
                 READ libDSVersion
                 CONSTANT)
@@ -156,6 +192,73 @@ class DriverStation : public QObject
                 READ radioPacketLoss)
     Q_PROPERTY (int robotPacketLoss
                 READ robotPacketLoss)
+    Q_PROPERTY (int fmsLossStreak
+                READ fmsLossStreak)
+    Q_PROPERTY (int radioLossStreak
+                READ radioLossStreak)
+    Q_PROPERTY (int robotLossStreak
+                READ robotLossStreak)
+    Q_PROPERTY (QVariantMap fmsLatency
+                READ fmsLatency)
+    Q_PROPERTY (QVariantMap radioLatency
+                READ radioLatency)
+    Q_PROPERTY (QVariantMap robotLatency
+                READ robotLatency)
+    Q_PROPERTY (QVariantMap rebootTiming
+                READ rebootTiming
+                NOTIFY robotCodeChanged)
+    Q_PROPERTY (QVariantMap restartTiming
+                READ restartTiming
+                NOTIFY robotCodeChanged)
+    Q_PROPERTY (QVariantMap deployTiming
+                READ deployTiming
+                NOTIFY robotCodeChanged)
+    Q_PROPERTY (QVariantList matchSummaries
+                READ matchSummaries
+                NOTIFY matchFinished)
+    Q_PROPERTY (QVariantMap fmsTraffic
+                READ fmsTraffic
+                NOTIFY networkUsageChanged)
+    Q_PROPERTY (QVariantMap radioTraffic
+                READ radioTraffic
+                NOTIFY networkUsageChanged)
+    Q_PROPERTY (QVariantMap robotTraffic
+                READ robotTraffic
+                NOTIFY networkUsageChanged)
+    Q_PROPERTY (QString fmsNetworkUsage
+                READ fmsNetworkUsage
+                NOTIFY networkUsageChanged)
+    Q_PROPERTY (QString radioNetworkUsage
+                READ radioNetworkUsage
+                NOTIFY networkUsageChanged)
+    Q_PROPERTY (QString robotNetworkUsage
+                READ robotNetworkUsage
+                NOTIFY networkUsageChanged)
+    Q_PROPERTY (QVariantMap bandwidth
+                READ bandwidth
+                NOTIFY networkUsageChanged)
+    Q_PROPERTY (QString bandwidthUsage
+                READ bandwidthUsage
+                NOTIFY networkUsageChanged)
+    Q_PROPERTY (bool bandwidthWarning
+                READ bandwidthWarning
+                NOTIFY networkUsageChanged)
+    Q_PROPERTY (qreal bandwidthBudget
+                READ bandwidthBudget
+                WRITE setBandwidthBudget
+                NOTIFY networkUsageChanged)
+    Q_PROPERTY (QVariantMap dashboard
+                READ dashboard
+                NOTIFY dashboardChanged)
+    Q_PROPERTY (QVariantMap selfTest
+                READ selfTest
+                NOTIFY selfTestChanged)
+    Q_PROPERTY (bool selfTestRunning
+                READ selfTestRunning
+                NOTIFY selfTestChanged)
+    Q_PROPERTY (QVariantList robots
+                READ robots
+                NOTIFY robotsChanged)
     Q_PROPERTY (bool isTestMode
                 READ isTestMode
                 NOTIFY controlModeChanged)
@@ -167,6 +270,17 @@ class DriverStation : public QObject
                 NOTIFY controlModeChanged)
     Q_PROPERTY (bool canBeEnabled
                 READ canBeEnabled)
+    Q_PROPERTY (DriverStationFrame frame
+                READ frame
+                NOTIFY telemetryFrame)
+    Q_PROPERTY (bool telemetryFramesEnabled
+                READ telemetryFramesEnabled
+                WRITE setTelemetryFramesEnabled
+                NOTIFY telemetryFramesEnabledChanged)
+    Q_PROPERTY (bool foreground
+                READ foreground
+                WRITE setForeground
+                NOTIFY foregroundChanged)
 
 public:
     static DriverStation* getInstance();
@@ -179,9 +293,10 @@ public:
     Q_ENUMS (Control)
 
     enum Protocol {
-        Protocol2016 = 0x00,
-        Protocol2015 = 0x01,
-        Protocol2014 = 0x02,
+        Protocol2020 = 0x00,
+        Protocol2016 = 0x01,
+        Protocol2015 = 0x02,
+        Protocol2014 = 0x03,
     };
     Q_ENUMS (Protocol)
 
@@ -208,10 +323,35 @@ public:
     };
     Q_ENUMS (Station)
 
+    enum Metric {
+        MetricCPUUsage = DS_HISTORY_CPU_USAGE,
+        MetricRAMUsage = DS_HISTORY_RAM_USAGE,
+        MetricDiskUsage = DS_HISTORY_DISK_USAGE,
+        MetricCANUsage = DS_HISTORY_CAN_UTILIZATION,
+    };
+    Q_ENUMS (Metric)
+
+    enum NetConsoleSource {
+        NetConsoleRobot = DS_NETCONSOLE_SOURCE_ROBOT,
+        NetConsoleLibDS = DS_NETCONSOLE_SOURCE_LIBDS,
+        NetConsoleApplication = DS_NETCONSOLE_SOURCE_APPLICATION,
+    };
+    Q_ENUMS (NetConsoleSource)
+
+    enum NetConsoleSeverity {
+        SeverityInfo = DS_NETCONSOLE_SEVERITY_INFO,
+        SeverityWarning = DS_NETCONSOLE_SEVERITY_WARNING,
+        SeverityError = DS_NETCONSOLE_SEVERITY_ERROR,
+    };
+    Q_ENUMS (NetConsoleSeverity)
+
     static void declareQML()
     {
+        qRegisterMetaType<DriverStationFrame>();
+
 #ifdef QT_QML_LIB
         qmlRegisterType<DriverStation> ("DriverStation", 1, 0, "LibDS");
+        qmlRegisterType<TelemetryReader> ("DriverStation", 1, 0, "TelemetryReader");
 #endif
     }
 
@@ -231,6 +371,40 @@ public:
     int radioPacketLoss() const;
     int robotPacketLoss() const;
 
+    int fmsLossStreak() const;
+    int radioLossStreak() const;
+    int robotLossStreak() const;
+
+    QVariantMap fmsLatency() const;
+    QVariantMap radioLatency() const;
+    QVariantMap robotLatency() const;
+
+    QVariantMap rebootTiming() const;
+    QVariantMap restartTiming() const;
+    QVariantMap deployTiming() const;
+    QVariantList matchSummaries() const;
+
+    QVariantMap fmsTraffic() const;
+    QVariantMap radioTraffic() const;
+    QVariantMap robotTraffic() const;
+
+    QString fmsNetworkUsage() const;
+    QString radioNetworkUsage() const;
+    QString robotNetworkUsage() const;
+
+    QVariantMap bandwidth() const;
+    QString bandwidthUsage() const;
+    bool bandwidthWarning() const;
+    qreal bandwidthBudget() const;
+
+    QVariantMap dashboard() const;
+
+    QVariantMap selfTest() const;
+    bool selfTestRunning() const;
+
+    QVariantList robots() const;
+    QList<DSRobot*> robotList() const;
+
     bool isEnabled() const;
     bool isTestMode() const;
     bool canBeEnabled() const;
@@ -243,6 +417,7 @@ public:
     bool emergencyStopped() const;
 
     qreal voltage() const;
+    bool brownoutWarning() const;
     QString voltageString() const;
     qreal maximumBatteryVoltage() const;
 
@@ -259,7 +434,13 @@ public:
     QString defaultRadioAddress() const;
     QString defaultRobotAddress() const;
 
-    QString elapsedTime();
+    QString elapsedTime() const;
+    bool matchTimerRunning() const;
+    qint64 matchStartTime() const;
+    qint64 matchElapsedTime() const;
+    int fmsMatchNumber() const;
+    int fmsReplayNumber() const;
+    int matchTimeRemaining() const;
     QString generalStatus() const;
     QString customFMSAddress() const;
     QString customRadioAddress() const;
@@ -268,6 +449,13 @@ public:
     QStringList stations() const;
     QStringList protocols() const;
 
+    DriverStationFrame frame() const;
+    bool eventThreadEnabled() const;
+    bool hotkeysEnabled() const;
+    bool telemetryFramesEnabled() const;
+    bool foreground() const;
+    quint64 eventTime() const;
+
     Q_INVOKABLE unsigned long sentFMSBytes() const;
     Q_INVOKABLE unsigned long sentRadioBytes() const;
     Q_INVOKABLE unsigned long sentRobotBytes() const;
@@ -279,6 +467,17 @@ public:
     Q_INVOKABLE int getNumHats (const int joystick) const;
     Q_INVOKABLE int getNumButtons (const int joystick) const;
 
+    Q_INVOKABLE QVariantList metricHistory (const Metric metric,
+                                            const int msecs) const;
+
+    Q_INVOKABLE int loadProtocolModule (const QString& path);
+    Q_INVOKABLE int loadProtocolModules (const QString& directory);
+
+    Q_INVOKABLE DriverStationOperation* waitForRobotComms (const int timeout = 10000);
+    Q_INVOKABLE DriverStationOperation* waitForRobotCode (const int timeout = 10000);
+    Q_INVOKABLE DriverStationOperation* rebootRobotAndWait (const int timeout = 60000);
+    Q_INVOKABLE DriverStationOperation* restartRobotCodeAndWait (const int timeout = 30000);
+
 public slots:
     void start();
     void rebootRobot();
@@ -296,51 +495,188 @@ public slots:
     void setCustomFMSAddress (const QString& address);
     void setCustomRadioAddress (const QString& address);
     void setCustomRobotAddress (const QString& address);
+    void setBandwidthBudget (const qreal mbps);
     void sendNetConsoleMessage (const QString& message);
+    void setEventThreadEnabled (const bool enabled);
+    void setHotkeysEnabled (const bool enabled);
+    void setTelemetryFramesEnabled (const bool enabled);
+    void setForeground (const bool foreground);
+
+    QObject* addRobot (const int team);
+    void removeRobot (const int index);
+
+    void stopDashboard();
+    void startDashboard (const int port = 0);
+    void setDashboardValue (const QString& key, const QVariant& value);
+
+    void runSelfTest();
 
     void addJoystick (int axes, int hats, int buttons);
+    void replaceJoystick (int joystick, int axes, int hats, int buttons);
     void setJoystickHat (int joystick, int hat, int angle);
     void setJoystickAxis (int joystick, int axis, float value);
     void setJoystickButton (int joystick, int button, bool pressed);
+    void setJoystickState (int joystick, const QVector<float>& axes,
+                           quint32 buttons, const QVector<int>& hats);
 
 private slots:
     void quitDS();
+    void watchEvents();
     void processEvents();
+    void readNetConsole();
+    void readDashboard();
     void resetElapsedTime();
-    void updateElapsedTime();
+    void updateNetworkUsage();
+    void publishFrame();
+    void applyConfiguration();
+    void emitDeferredSignals();
+    void finishSelfTest();
 
 private:
+    enum AddressSignal {
+        FMSAddressSignal = 0x01,
+        RadioAddressSignal = 0x02,
+        RobotAddressSignal = 0x04,
+        AllAddressSignals = 0x07,
+    };
+
+    enum DeferredSignal {
+        VoltageSignal = 0x01,
+        CANUsageSignal = 0x02,
+        CPUUsageSignal = 0x04,
+        RAMUsageSignal = 0x08,
+        DiskUsageSignal = 0x10,
+    };
+
+    void updateStatus();
+    void updateHotkeys();
+    void unwatchEvents();
+    void deferSignal (const DeferredSignal signal);
+    void scheduleFrame();
+    void stageConfiguration();
+    void saveKnownRobotAddress();
+    void restoreKnownRobotAddress (const DS_Protocol& protocol);
+    void updateMatchTimer (const bool running);
+    DriverStationOperation* startOperation (
+        const int timeout,
+        const QList<DriverStationOperation::Condition>& conditions);
+    void handleEvent (const DS_Event& event, const QString& message);
+    DriverStationFrame currentFrame() const;
+    void updateAddresses (const int forcedSignals);
     QString getAddress (const QString& address);
 
 signals:
     void stationChanged();
     void protocolChanged();
+    void protocolsChanged();
     void fmsAddressChanged();
     void radioAddressChanged();
     void robotAddressChanged();
     void joystickCountChanged();
+    void robotsChanged();
+    void joystickMappingChanged();
     void canUsageChanged (const int usage);
     void cpuUsageChanged (const int usage);
     void ramUsageChanged (const int usage);
     void diskUsageChanged (const int usage);
     void enabledChanged (const bool enabled);
     void newMessage (const QString& message);
+    void newMessages (const QStringList& messages);
+    void newEntries (const QVector<NetConsoleEntry>& entries);
+    void dashboardChanged();
+    void dashboardValueChanged (const QString& key, const QVariant& value);
+    void selfTestChanged();
     void teamNumberChanged (const int number);
     void statusChanged (const QString& status);
     void voltageChanged (const float voltage);
+    void brownoutWarningChanged (const bool warning);
     void robotCodeChanged (const bool robotCode);
     void controlModeChanged (const Control mode);
     void allianceChanged (const Alliance alliance);
     void positionChanged (const Position position);
-    void elapsedTimeChanged (const QString& string);
+    void matchTimerChanged();
+    void fmsMatchChanged();
+    void matchFinished();
+    void networkUsageChanged();
     void fmsCommunicationsChanged (const bool connected);
     void radioCommunicationsChanged (const bool connected);
     void robotCommunicationsChanged (const bool connected);
     void emergencyStoppedChanged (const bool emergencyStopped);
+    void telemetryFramesEnabledChanged (const bool enabled);
+    void foregroundChanged (const bool foreground);
+    void telemetryFrame (const DriverStationFrame& frame);
 
 private:
-    QTime m_time;
-    QString m_elapsedTime;
+    /* Match timer (stopped while the robot is disabled) */
+    QElapsedTimer m_matchTimer;
+    qint64 m_matchStartTime = 0;
+    qint64 m_matchElapsedTime = 0;
+    bool m_matchTimerRunning = false;
+
+    /* Last published values, signals are only emitted when they change */
+    int m_cpuUsage = 0;
+    int m_canUsage = 0;
+    int m_ramUsage = 0;
+    int m_diskUsage = 0;
+    int m_voltage = 0;
+    bool m_brownoutWarning = false;
+    bool m_enabled = false;
+    bool m_robotCode = false;
+    bool m_emergencyStop = false;
+    bool m_fmsCommunications = false;
+    bool m_radioCommunications = false;
+    bool m_robotCommunications = false;
+    Control m_controlMode = ControlTeleoperated;
+    Alliance m_alliance = AllianceRed;
+    Position m_position = Position1;
+    int m_statusId = -1;
+    QString m_status;
+    QString m_appliedFMSAddress;
+    QString m_appliedRadioAddress;
+    QString m_appliedRobotAddress;
+
+    /* Formatted network usage of each channel */
+    QString m_fmsNetworkUsage;
+    QString m_radioNetworkUsage;
+    QString m_robotNetworkUsage;
+    QString m_bandwidthUsage;
+
+    /* Batched telemetry frames */
+    DriverStationFrame m_frame;
+    bool m_framePending = false;
+    bool m_telemetryFrames = false;
+
+    /* Telemetry signals held back while the UI is in the background */
+    bool m_foreground = true;
+    int m_deferredSignals = 0;
+    bool m_deferredPending = false;
+
+    /* Creation time of the event being notified and of the deferred values */
+    quint64 m_eventTime = 0;
+    quint64 m_deferredTimes [5] = {};
+
+    /* Debounces the changes of the team number and custom addresses */
+    QTimer m_configTimer;
+
+    QObject* m_eventNotifier = nullptr;
+    DSEventThread* m_eventThread = nullptr;
+    bool m_eventThreadEnabled = false;
+
+    /* Global e-stop (spacebar) and disable (Enter) keys */
+    DSHotkeys* m_hotkeys = nullptr;
+    bool m_hotkeysEnabled = false;
+    uint64_t m_netConsoleCursor = 0;
+
+    /* Additional robots (each with its own LibDS context) */
+    QList<DSRobot*> m_robots;
+
+    /* Dashboard entries read from the LibDS */
+    QVariantMap m_dashboard;
+    uint64_t m_dashboardCursor = 0;
+
+    /* Self-test running in the thread pool, and its last results */
+    QFutureWatcher<QVariantMap> m_selfTestWatcher;
+    QVariantMap m_selfTest;
 };
 
 #endif
@@ -0,0 +1,105 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _DRIVER_STATION_FRAME_H
+#define _DRIVER_STATION_FRAME_H
+
+#include <QObject>
+#include <QString>
+#include <QMetaType>
+
+/**
+ * Snapshot of the robot and communications state published by the
+ * \c DriverStation::telemetryFrame() signal. QML code can bind to the
+ * properties of a single frame instead of connecting to every signal of
+ * the \c DriverStation, so a burst of LibDS events results in a single
+ * binding update.
+ *
+ * The control mode, alliance and position are the integer values of the
+ * corresponding \c DriverStation enums.
+ */
+class DriverStationFrame
+{
+    Q_GADGET
+    Q_PROPERTY (bool enabled MEMBER enabled)
+    Q_PROPERTY (bool robotCode MEMBER robotCode)
+    Q_PROPERTY (bool emergencyStopped MEMBER emergencyStopped)
+    Q_PROPERTY (bool connectedToFMS MEMBER connectedToFMS)
+    Q_PROPERTY (bool connectedToRadio MEMBER connectedToRadio)
+    Q_PROPERTY (bool connectedToRobot MEMBER connectedToRobot)
+    Q_PROPERTY (qreal voltage MEMBER voltage)
+    Q_PROPERTY (int cpuUsage MEMBER cpuUsage)
+    Q_PROPERTY (int canUsage MEMBER canUsage)
+    Q_PROPERTY (int ramUsage MEMBER ramUsage)
+    Q_PROPERTY (int diskUsage MEMBER diskUsage)
+    Q_PROPERTY (int controlMode MEMBER controlMode)
+    Q_PROPERTY (int alliance MEMBER alliance)
+    Q_PROPERTY (int position MEMBER position)
+    Q_PROPERTY (QString status MEMBER status)
+
+public:
+    bool enabled = false;
+    bool robotCode = false;
+    bool emergencyStopped = false;
+    bool connectedToFMS = false;
+    bool connectedToRadio = false;
+    bool connectedToRobot = false;
+    qreal voltage = 0;
+    int cpuUsage = 0;
+    int canUsage = 0;
+    int ramUsage = 0;
+    int diskUsage = 0;
+    int controlMode = 0;
+    int alliance = 0;
+    int position = 0;
+    QString status;
+
+    bool operator== (const DriverStationFrame& other) const
+    {
+        return enabled == other.enabled &&
+               robotCode == other.robotCode &&
+               emergencyStopped == other.emergencyStopped &&
+               connectedToFMS == other.connectedToFMS &&
+               connectedToRadio == other.connectedToRadio &&
+               connectedToRobot == other.connectedToRobot &&
+               voltage == other.voltage &&
+               cpuUsage == other.cpuUsage &&
+               canUsage == other.canUsage &&
+               ramUsage == other.ramUsage &&
+               diskUsage == other.diskUsage &&
+               controlMode == other.controlMode &&
+               alliance == other.alliance &&
+               position == other.position &&
+               status == other.status;
+    }
+
+    bool operator!= (const DriverStationFrame& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+Q_DECLARE_METATYPE (DriverStationFrame)
+
+#endif
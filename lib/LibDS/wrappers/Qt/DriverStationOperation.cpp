@@ -0,0 +1,151 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DriverStationOperation.h"
+#include "DriverStation.h"
+
+/**
+ * Creates an operation that fails if its conditions are not met within the
+ * given \a timeout (in milliseconds, \c 0 or less to wait forever)
+ */
+DriverStationOperation::DriverStationOperation (const int timeout,
+                                                QObject* parent) :
+    QObject (parent),
+    m_timeout (timeout),
+    m_finished (false),
+    m_succeeded (false)
+{
+    m_timer.setSingleShot (true);
+    connect (&m_timer, SIGNAL (timeout()), this, SLOT (expire()));
+}
+
+/**
+ * Returns \c true once the operation has succeeded or failed
+ */
+bool DriverStationOperation::isFinished() const
+{
+    return m_finished;
+}
+
+/**
+ * Returns \c true if all the conditions of the operation were met in time
+ */
+bool DriverStationOperation::succeeded() const
+{
+    return m_succeeded;
+}
+
+/**
+ * Appends the given \a condition to the conditions that the operation
+ * waits for, the conditions are met one after the other
+ */
+void DriverStationOperation::addCondition (const Condition condition)
+{
+    m_conditions.append (condition);
+}
+
+/**
+ * Starts waiting for the conditions of the operation, the conditions are
+ * checked whenever the robot communications or the robot code change
+ */
+void DriverStationOperation::start()
+{
+    DriverStation* ds = DriverStation::getInstance();
+    connect (ds, SIGNAL (robotCommunicationsChanged (bool)),
+             this, SLOT (check()));
+    connect (ds, SIGNAL (robotCodeChanged (bool)),
+             this, SLOT (check()));
+
+    if (m_timeout > 0)
+        m_timer.start (m_timeout);
+
+    /* Report the result from the event loop, even if it is already known */
+    QTimer::singleShot (0, this, SLOT (check()));
+}
+
+/**
+ * Stops waiting for the conditions and reports the operation as failed
+ */
+void DriverStationOperation::cancel()
+{
+    finish (false);
+}
+
+/**
+ * Skips the conditions that are met, and finishes the operation once all of
+ * them have been met
+ */
+void DriverStationOperation::check()
+{
+    while (!m_conditions.isEmpty() && met (m_conditions.first()))
+        m_conditions.removeFirst();
+
+    if (m_conditions.isEmpty())
+        finish (true);
+}
+
+/**
+ * Called when the timeout expires before the conditions are met
+ */
+void DriverStationOperation::expire()
+{
+    finish (false);
+}
+
+/**
+ * Returns \c true if the given \a condition is met right now
+ */
+bool DriverStationOperation::met (const Condition condition) const
+{
+    DriverStation* ds = DriverStation::getInstance();
+
+    switch (condition) {
+    case RobotCommunications:
+        return ds->connectedToRobot();
+    case NoRobotCommunications:
+        return !ds->connectedToRobot();
+    case RobotCode:
+        return ds->hasRobotCode();
+    case NoRobotCode:
+        return !ds->hasRobotCode();
+    }
+
+    return false;
+}
+
+/**
+ * Reports the result of the operation (only once) and schedules its deletion
+ */
+void DriverStationOperation::finish (const bool succeeded)
+{
+    if (m_finished)
+        return;
+
+    m_finished = true;
+    m_succeeded = succeeded;
+    m_timer.stop();
+    disconnect (DriverStation::getInstance(), nullptr, this, nullptr);
+
+    emit finished (succeeded);
+    deleteLater();
+}
@@ -0,0 +1,90 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _DRIVER_STATION_OPERATION_H
+#define _DRIVER_STATION_OPERATION_H
+
+#include <QList>
+#include <QTimer>
+#include <QObject>
+
+/**
+ * An asynchronous operation of the \c DriverStation (e.g. waiting until the
+ * robot communications are up, or rebooting the robot and waiting for it to
+ * come back), which is driven by the signals of the \c DriverStation instead
+ * of polling its properties.
+ *
+ * The operation waits until each of its conditions is met, in order, and
+ * emits \c finished() with \c true once the last one is met, or with
+ * \c false if the timeout expires (or the operation is cancelled) first.
+ * The result is never emitted before the event loop runs, so the caller can
+ * connect to the signal (or \c co_await the operation, see
+ * \c DriverStationTask.h) right after starting it. The operation deletes
+ * itself after emitting \c finished().
+ */
+class DriverStationOperation : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY (bool finished READ isFinished NOTIFY finished)
+    Q_PROPERTY (bool succeeded READ succeeded NOTIFY finished)
+
+public:
+    enum Condition {
+        RobotCommunications,
+        NoRobotCommunications,
+        RobotCode,
+        NoRobotCode,
+    };
+
+    explicit DriverStationOperation (const int timeout,
+                                     QObject* parent = nullptr);
+
+    bool isFinished() const;
+    bool succeeded() const;
+
+    void addCondition (const Condition condition);
+    void start();
+
+public slots:
+    void cancel();
+
+signals:
+    void finished (const bool succeeded);
+
+private slots:
+    void check();
+    void expire();
+
+private:
+    bool met (const Condition condition) const;
+    void finish (const bool succeeded);
+
+private:
+    int m_timeout;
+    bool m_finished;
+    bool m_succeeded;
+    QTimer m_timer;
+    QList<Condition> m_conditions;
+};
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _DRIVER_STATION_TASK_H
+#define _DRIVER_STATION_TASK_H
+
+#include "DriverStationOperation.h"
+
+/*
+ * The awaitable operations need C++20 coroutines, the rest of the wrapper
+ * builds as C++11 (add "CONFIG += c++2a" to the project to use them)
+ */
+#if defined __cpp_impl_coroutine && __cpp_impl_coroutine >= 201902L
+
+#include <utility>
+#include <exception>
+#include <coroutine>
+
+/**
+ * Suspends a coroutine until the given \c DriverStationOperation finishes,
+ * the result of the \c co_await expression is \c true if the operation
+ * succeeded. The operation must be awaited right after it is started (i.e.
+ * before the event loop runs again).
+ */
+class DriverStationAwaiter
+{
+public:
+    explicit DriverStationAwaiter (DriverStationOperation* operation) :
+        m_operation (operation), m_succeeded (false) {}
+
+    bool await_ready() const
+    {
+        return false;
+    }
+
+    void await_suspend (std::coroutine_handle<> handle)
+    {
+        QObject::connect (m_operation, &DriverStationOperation::finished,
+                          [this, handle] (const bool succeeded) {
+            m_succeeded = succeeded;
+            handle.resume();
+        });
+    }
+
+    bool await_resume() const
+    {
+        return m_succeeded;
+    }
+
+private:
+    DriverStationOperation* m_operation;
+    bool m_succeeded;
+};
+
+/**
+ * Return type of the coroutines that await the operations of the
+ * \c DriverStation, e.g.
+ *
+ * \code
+ * DriverStationTask cycleRobot (DriverStation* ds)
+ * {
+ *     if (!co_await ds->waitForRobotComms (5000))
+ *         co_return;
+ *
+ *     if (co_await ds->rebootRobotAndWait())
+ *         ds->setEnabled (true);
+ * }
+ * \endcode
+ *
+ * The coroutine starts right away and runs (in the GUI thread) until it
+ * awaits an operation, the rest of it runs from the event loop once the
+ * operation finishes. Nothing is returned, the coroutine frame is freed
+ * when the coroutine ends.
+ */
+class DriverStationTask
+{
+public:
+    struct promise_type {
+        DriverStationTask get_return_object()
+        {
+            return DriverStationTask();
+        }
+
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void() {}
+
+        void unhandled_exception()
+        {
+            std::terminate();
+        }
+
+        DriverStationAwaiter await_transform (DriverStationOperation* operation)
+        {
+            return DriverStationAwaiter (operation);
+        }
+
+        template <typename T>
+        T&& await_transform (T&& awaitable)
+        {
+            return std::forward<T> (awaitable);
+        }
+    };
+};
+
+#endif
+
+#endif
@@ -30,6 +30,8 @@
 #include <QDebug>
 #include <QTimer>
 #include <QSysInfo>
+#include <QFileInfo>
+#include <QSaveFile>
 #include <QDateTime>
 #include <QJsonArray>
 #include <QJsonObject>
@@ -41,9 +43,630 @@
 
 /* Used for the custom message handler */
 #define PRINT_FMT "%-14s %-13s %-12s\n"
-#define PRINT(string) QString(string).toLocal8Bit().constData()
 #define GET_DATE_TIME(format) QDateTime::currentDateTime().toString(format)
 
+/**
+ * Returns \c true if the given \a array of the segment index contains the
+ * given number \a value
+ */
+static bool contains (const QJsonArray& array, const double value)
+{
+    foreach (const QJsonValue& item, array) {
+        if (item.toDouble() == value)
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * Loads the segment index of the given \a root logs directory
+ */
+DSLogArchiver::DSLogArchiver (const QString& root) : m_root (root)
+{
+    QFile file (m_root.filePath (LOG_INDEX_FILE));
+    if (file.open (QFile::ReadOnly))
+        m_index = QJsonDocument::fromJson (file.readAll()).array();
+}
+
+/**
+ * Returns the hash of the given log \a message (32-bit FNV-1a of its UTF-8
+ * bytes), which does not change between sessions
+ */
+quint32 DSLogArchiver::hash (const QString& message)
+{
+    quint32 value = 2166136261u;
+    QByteArray data = message.toUtf8();
+
+    for (int i = 0; i < data.size(); ++i) {
+        value ^= (quint8) data.at (i);
+        value *= 16777619u;
+    }
+
+    return value;
+}
+
+/**
+ * Returns the contents of the given log segment, which may be compressed
+ */
+QByteArray DSLogArchiver::read (const QString& path)
+{
+    QFile file (path);
+    if (!file.open (QFile::ReadOnly))
+        return QByteArray();
+
+    if (path.endsWith (LOG_ARCHIVE_SUFFIX))
+        return qUncompress (file.readAll());
+
+    return file.readAll();
+}
+
+/**
+ * Returns the paths of the closed segments of the given \a root logs
+ * directory that satisfy the given \a query. Only the segment index is
+ * read, so this can be called from any thread.
+ */
+QStringList DSLogArchiver::search (const QString& root,
+                                   const DSLogQuery& query)
+{
+    QDir dir (root);
+    QStringList segments;
+
+    QFile file (dir.filePath (LOG_INDEX_FILE));
+    if (!file.open (QFile::ReadOnly))
+        return segments;
+
+    quint32 error = query.error.isEmpty() ? 0 : hash (query.error);
+    QJsonArray index = QJsonDocument::fromJson (file.readAll()).array();
+
+    foreach (const QJsonValue& value, index) {
+        QJsonObject segment = value.toObject();
+        if (segment.value ("open").toBool())
+            continue;
+
+        /* Time range */
+        double start = segment.value ("start").toDouble();
+        double end = segment.value ("end").toDouble();
+        if ((query.from > 0 && end < query.from) ||
+            (query.to > 0 && start > query.to))
+            continue;
+
+        /* Matches */
+        if (query.matchesOnly && !segment.value ("match").toBool())
+            continue;
+        if (query.matchNumber > 0 &&
+            !contains (segment.value ("matches").toArray(), query.matchNumber))
+            continue;
+
+        /* Voltage and communications */
+        if (query.maxVoltage > 0 &&
+            !(segment.value ("minVoltage").toDouble (query.maxVoltage) <
+              query.maxVoltage))
+            continue;
+        if (query.minCommsDrops > 0 &&
+            segment.value ("commsDrops").toInt() < query.minCommsDrops)
+            continue;
+
+        /* Errors */
+        if (error && !contains (segment.value ("errors").toArray(), error))
+            continue;
+
+        segments.append (dir.filePath (segment.value ("file").toString()));
+    }
+
+    return segments;
+}
+
+/**
+ * Forgets the segments that no longer exist and compresses the segments
+ * that were left open by a previous session (e.g. after a crash)
+ */
+void DSLogArchiver::recover()
+{
+    for (int i = m_index.count() - 1; i >= 0; --i) {
+        QJsonObject segment = m_index.at (i).toObject();
+        QFileInfo info (m_root.filePath (segment.value ("file").toString()));
+
+        if (!info.exists())
+            m_index.removeAt (i);
+
+        else if (segment.value ("open").toBool()) {
+            segment.insert ("end", info.lastModified().toMSecsSinceEpoch());
+            m_index.replace (i, segment);
+            compress (i);
+        }
+    }
+
+    saveIndex();
+}
+
+/**
+ * Adds the segment opened at the given \a path to the index
+ */
+void DSLogArchiver::segmentOpened (const QString& path,
+                                   const qint64 start,
+                                   const bool match)
+{
+    QJsonObject segment;
+    segment.insert ("file", m_root.relativeFilePath (path));
+    segment.insert ("start", start);
+    segment.insert ("match", match);
+    segment.insert ("open", true);
+
+    m_index.append (segment);
+    saveIndex();
+}
+
+/**
+ * Adds the \a summary of the segment closed at the given \a path to the
+ * index, then compresses the segment
+ */
+void DSLogArchiver::segmentClosed (const QString& path,
+                                   const qint64 end,
+                                   const QJsonObject& summary)
+{
+    int entry = find (m_root.relativeFilePath (path));
+    if (entry < 0)
+        return;
+
+    QJsonObject segment = m_index.at (entry).toObject();
+    for (QJsonObject::const_iterator i = summary.begin();
+         i != summary.end(); ++i)
+        segment.insert (i.key(), i.value());
+
+    segment.insert ("end", end);
+    m_index.replace (entry, segment);
+
+    compress (entry);
+    saveIndex();
+}
+
+/**
+ * Writes the segment index to the logs directory, the previous index is
+ * only replaced once the new one has been written completely
+ */
+void DSLogArchiver::saveIndex()
+{
+    QSaveFile file (m_root.filePath (LOG_INDEX_FILE));
+    if (file.open (QFile::WriteOnly)) {
+        file.write (QJsonDocument (m_index).toJson (QJsonDocument::Compact));
+        file.commit();
+    }
+}
+
+/**
+ * Compresses the segment at the given \a entry of the index, the plain
+ * text segment is only removed once the compressed segment is on the disk
+ */
+void DSLogArchiver::compress (const int entry)
+{
+    QJsonObject segment = m_index.at (entry).toObject();
+    QString name = segment.value ("file").toString();
+
+    QFile plain (m_root.filePath (name));
+    if (!plain.open (QFile::ReadOnly))
+        return;
+
+    QByteArray data = plain.readAll();
+    QByteArray compressed = qCompress (data);
+    plain.close();
+
+    QSaveFile archive (m_root.filePath (name + LOG_ARCHIVE_SUFFIX));
+    if (!archive.open (QFile::WriteOnly))
+        return;
+
+    archive.write (compressed);
+    if (!archive.commit())
+        return;
+
+    plain.remove();
+    segment.insert ("file", name + LOG_ARCHIVE_SUFFIX);
+    segment.insert ("size", data.size());
+    segment.insert ("stored", compressed.size());
+    segment.remove ("open");
+    m_index.replace (entry, segment);
+}
+
+/**
+ * Returns the index entry of the given segment \a file, or -1 if the
+ * segment is not in the index
+ */
+int DSLogArchiver::find (const QString& file) const
+{
+    for (int i = m_index.count() - 1; i >= 0; --i) {
+        if (m_index.at (i).toObject().value ("file").toString() == file)
+            return i;
+    }
+
+    return -1;
+}
+
+/**
+ * Initializes the queue cells, the writer thread is started by the logger
+ * once the first log segment is open
+ */
+DSLogWriter::DSLogWriter() :
+    m_file (stderr),
+    m_segmentSize (0),
+    m_archiver (NULL),
+    m_segmentRequest (0),
+    m_commsDrops (0),
+    m_minVoltage (0),
+    m_running (false),
+    m_enqueuePos (0),
+    m_dequeuePos (0)
+{
+    for (size_t i = 0; i < LOG_QUEUE_SIZE; ++i)
+        m_cells [i].seq = i;
+}
+
+/**
+ * Stops the writer thread and writes the messages that are still queued,
+ * the messages logged afterwards must be written directly by the caller
+ */
+void DSLogWriter::stop()
+{
+    if (!m_running.exchange (false))
+        return;
+
+    m_wakeUp.release();
+    wait();
+
+    /* The writer thread is gone, messages queued in the meantime are ours */
+    drain();
+}
+
+/**
+ * Returns the file of the current log segment (or \c stderr if no segment
+ * could be opened), this must not be called while the thread is running
+ */
+FILE* DSLogWriter::file() const
+{
+    return m_file;
+}
+
+/**
+ * Returns the path of the current log segment
+ */
+QString DSLogWriter::currentPath() const
+{
+    QMutexLocker locker (&m_pathLock);
+    return m_path;
+}
+
+/**
+ * Closes the current log segment and hands it to the archiver, the
+ * connection \a type allows the caller to wait for the segment to be
+ * compressed (e.g. when the application quits)
+ */
+void DSLogWriter::close (const Qt::ConnectionType type)
+{
+    if (!m_file || m_file == stderr)
+        return;
+
+    fclose (m_file);
+    m_file = stderr;
+
+    QJsonObject summary = takeSummary();
+    if (m_archiver)
+        QMetaObject::invokeMethod (m_archiver, "segmentClosed", type,
+                                   Q_ARG (QString, currentPath()),
+                                   Q_ARG (qint64,
+                                          QDateTime::currentMSecsSinceEpoch()),
+                                   Q_ARG (QJsonObject, summary));
+}
+
+/**
+ * Asks the writer thread to open a new log segment before writing the next
+ * messages, \a match is \c true if the segment begins with a match
+ */
+void DSLogWriter::startSegment (const bool match)
+{
+    m_segmentRequest = match ? 2 : 1;
+    m_wakeUp.release();
+}
+
+/**
+ * Notes in the segment summary that the robot communications were lost
+ */
+void DSLogWriter::noteCommsDrop()
+{
+    QMutexLocker locker (&m_summaryLock);
+    ++m_commsDrops;
+}
+
+/**
+ * Notes in the segment summary that the FMS reported the given \a match
+ */
+void DSLogWriter::noteMatch (const int match)
+{
+    QMutexLocker locker (&m_summaryLock);
+    if (match > 0 && !m_matches.contains (match))
+        m_matches.append (match);
+}
+
+/**
+ * Notes the robot \a voltage in the segment summary, which keeps the
+ * lowest voltage reported while the robot was connected
+ */
+void DSLogWriter::noteVoltage (const float voltage)
+{
+    QMutexLocker locker (&m_summaryLock);
+    if (voltage > 0 && (m_minVoltage <= 0 || voltage < m_minVoltage))
+        m_minVoltage = voltage;
+}
+
+/**
+ * Opens the first log segment in the given \a root directory, the \a header
+ * is written at the beginning of every segment. The messages are written to
+ * the console (and to the segments) once the thread is started.
+ *
+ * \returns \c false if the segment could not be opened, in which case the
+ *          messages are only written to the console
+ */
+bool DSLogWriter::open (const QString& root,
+                        const QByteArray& header,
+                        DSLogArchiver* archiver)
+{
+    m_root = root;
+    m_header = header;
+    m_archiver = archiver;
+    m_running = true;
+
+    return openSegment (false);
+}
+
+/**
+ * Queues the given message, if the queue is full, the caller waits until
+ * the writer thread makes room for it.
+ *
+ * \returns \c false if the writer thread is not running
+ */
+bool DSLogWriter::enqueue (const QtMsgType type,
+                           const qint64 time,
+                           const QString& data)
+{
+    if (!m_running)
+        return false;
+
+    Cell* cell;
+    size_t pos = m_enqueuePos.load (std::memory_order_relaxed);
+
+    forever {
+        cell = &m_cells [pos % LOG_QUEUE_SIZE];
+        size_t seq = cell->seq.load (std::memory_order_acquire);
+
+        /* Cell is free, try to claim it */
+        if (seq == pos) {
+            if (m_enqueuePos.compare_exchange_weak (pos, pos + 1,
+                                                    std::memory_order_relaxed))
+                break;
+        }
+
+        /* Queue is full, let the writer empty it */
+        else if (seq < pos) {
+            m_wakeUp.release();
+            QThread::yieldCurrentThread();
+            pos = m_enqueuePos.load (std::memory_order_relaxed);
+        }
+
+        /* Another producer claimed the cell */
+        else
+            pos = m_enqueuePos.load (std::memory_order_relaxed);
+    }
+
+    cell->type = type;
+    cell->time = time;
+    cell->data = data;
+    cell->seq.store (pos + 1, std::memory_order_release);
+
+    /* Write warnings and errors (or a half-full queue) without delay */
+    if (type == QtWarningMsg || type == QtCriticalMsg ||
+        pos - m_dequeuePos.load (std::memory_order_relaxed) >= LOG_QUEUE_SIZE / 2)
+        m_wakeUp.release();
+
+    return true;
+}
+
+/**
+ * Writes the given \a data to the given \a file and flushes it
+ */
+void DSLogWriter::write (FILE* file, const QByteArray& data)
+{
+    if (file && !data.isEmpty()) {
+        fwrite (data.constData(), 1, (size_t) data.size(), file);
+        fflush (file);
+    }
+}
+
+/**
+ * Formats a log message as a line of the log table, with the elapsed
+ * \a time (in msecs), the warning level of the given \a type and the
+ * message \a data
+ */
+QByteArray DSLogWriter::format (const QtMsgType type,
+                                const qint64 time,
+                                const QString& data)
+{
+    /* Get warning level */
+    const char* level;
+    switch (type) {
+    case QtDebugMsg:
+        level = "DEBUG";
+        break;
+    case QtWarningMsg:
+        level = "WARNING";
+        break;
+    case QtCriticalMsg:
+        level = "CRITICAL";
+        break;
+    case QtFatalMsg:
+        level = "FATAL";
+        break;
+    default:
+        level = "SYSTEM";
+        break;
+    }
+
+    /* Get the elapsed minutes, seconds and tenths of a second */
+    char elapsed [32];
+    qsnprintf (elapsed, sizeof (elapsed), "%02d:%02d.%d",
+               (int) ((time / 60000) % 60),
+               (int) ((time / 1000) % 60),
+               (int) ((time % 1000) / 100));
+
+    QByteArray line;
+    line.append (QByteArray (elapsed).leftJustified (14));
+    line.append (' ');
+    line.append (QByteArray (level).leftJustified (13));
+    line.append (' ');
+    line.append (data.toLocal8Bit().leftJustified (12));
+    line.append ('\n');
+
+    return line;
+}
+
+/**
+ * Writes the queued messages every \c LOG_FLUSH_INTERVAL milliseconds, or
+ * when a producer wakes up the thread
+ */
+void DSLogWriter::run()
+{
+    while (m_running) {
+        m_wakeUp.tryAcquire (1, LOG_FLUSH_INTERVAL);
+        m_wakeUp.tryAcquire (m_wakeUp.available());
+        drain();
+    }
+}
+
+/**
+ * Formats the queued messages and writes them with a single write (and
+ * flush) to the dump file and to the console
+ */
+void DSLogWriter::drain()
+{
+    /* Start a new segment if requested, or if the current one is full */
+    int request = m_segmentRequest.exchange (0);
+    if (request || m_segmentSize >= LOG_SEGMENT_SIZE ||
+        (m_file != stderr && m_segmentTimer.hasExpired (LOG_SEGMENT_AGE))) {
+        close();
+        openSegment (request == 2);
+    }
+
+    QByteArray batch;
+    size_t pos = m_dequeuePos.load (std::memory_order_relaxed);
+
+    forever {
+        Cell* cell = &m_cells [pos % LOG_QUEUE_SIZE];
+        if (cell->seq.load (std::memory_order_acquire) != pos + 1)
+            break;
+
+        batch.append (format (cell->type, cell->time, cell->data));
+        if (cell->type == QtWarningMsg || cell->type == QtCriticalMsg) {
+            quint32 hash = DSLogArchiver::hash (cell->data);
+
+            m_summaryLock.lock();
+            if (m_errors.count() < LOG_SUMMARY_ERRORS &&
+                !m_errors.contains (hash))
+                m_errors.append (hash);
+            m_summaryLock.unlock();
+        }
+
+        cell->data.clear();
+        cell->seq.store (pos + LOG_QUEUE_SIZE, std::memory_order_release);
+        m_dequeuePos.store (++pos, std::memory_order_relaxed);
+    }
+
+    write (m_file, batch);
+    if (m_file != stderr) {
+        write (stderr, batch);
+        m_segmentSize += batch.size();
+    }
+}
+
+/**
+ * Returns the summary of the current segment and starts a new one
+ */
+QJsonObject DSLogWriter::takeSummary()
+{
+    QJsonObject summary;
+    QJsonArray matches;
+    QJsonArray errors;
+
+    QMutexLocker locker (&m_summaryLock);
+
+    foreach (int match, m_matches)
+        matches.append (match);
+    foreach (quint32 error, m_errors)
+        errors.append ((double) error);
+
+    summary.insert ("commsDrops", m_commsDrops);
+    summary.insert ("matches", matches);
+    summary.insert ("errors", errors);
+    if (m_minVoltage > 0)
+        summary.insert ("minVoltage", m_minVoltage);
+
+    m_commsDrops = 0;
+    m_minVoltage = 0;
+    m_matches.clear();
+    m_errors.clear();
+
+    return summary;
+}
+
+/**
+ * Opens a new log segment in the directory of the current day and writes
+ * the log header to it, \a match is \c true if the segment begins with a
+ * match (which is also noted in its file name)
+ */
+bool DSLogWriter::openSegment (const bool match)
+{
+    QDateTime now = QDateTime::currentDateTime();
+
+    /* Create the directory of the current day (if necessary) */
+    QDir dir (QString ("%1/%2/%3/%4/")
+              .arg (m_root)
+              .arg (now.toString ("yyyy"))
+              .arg (now.toString ("MMMM"))
+              .arg (now.toString ("ddd dd")));
+    if (!dir.exists())
+        dir.mkpath (".");
+
+    /* Get a file name that is not used by another segment */
+    QString name = now.toString ("HH_mm_ss AP");
+    if (match)
+        name.append (" Match");
+
+    QString path = dir.filePath (name + ".log");
+    for (int i = 2; QFile::exists (path) ||
+         QFile::exists (path + LOG_ARCHIVE_SUFFIX); ++i)
+        path = dir.filePath (QString ("%1 (%2).log").arg (name).arg (i));
+
+    /* Open the segment */
+    FILE* file = fopen (path.toLocal8Bit().constData(), "w");
+    if (!file)
+        return false;
+
+    m_file = file;
+    m_segmentSize = 0;
+    m_segmentTimer.restart();
+
+    m_pathLock.lock();
+    m_path = path;
+    m_pathLock.unlock();
+
+    write (m_file, m_header);
+
+    if (m_archiver)
+        QMetaObject::invokeMethod (m_archiver, "segmentOpened",
+                                   Qt::QueuedConnection,
+                                   Q_ARG (QString, path),
+                                   Q_ARG (qint64, now.toMSecsSinceEpoch()),
+                                   Q_ARG (bool, match));
+
+    return true;
+}
+
 /**
  * Repeats the \a input string \a n times and returns the obtained string
  */
@@ -63,8 +686,17 @@ static QString REPEAT (QString input, int n)
 DSEventLogger::DSEventLogger()
 {
     m_init = 0;
-    m_dump = NULL;
-    m_currentLog = "";
+
+    /* Maps the monotonic time of the LibDS events to the wall clock */
+    m_clockOffset = QDateTime::currentMSecsSinceEpoch()
+                    - (qint64) (DriverStation::getInstance()->eventTime() / 1000);
+
+    m_archiver = new DSLogArchiver (logsPath());
+    m_archiver->moveToThread (&m_archiverThread);
+    connect (&m_archiverThread, SIGNAL (finished()),
+             m_archiver,        SLOT (deleteLater()));
+    m_archiverThread.start (QThread::LowPriority);
+    QMetaObject::invokeMethod (m_archiver, "recover", Qt::QueuedConnection);
 
     init();
 
@@ -73,11 +705,17 @@ DSEventLogger::DSEventLogger()
 }
 
 /**
- * Closes the log file
+ * Closes the log file and waits for the last segment to be compressed
  */
 DSEventLogger::~DSEventLogger()
 {
+    m_writer.stop();
+    m_writer.close (Qt::BlockingQueuedConnection);
+    m_archiverThread.quit();
+    m_archiverThread.wait();
+
     saveData();
+    m_telemetry.close();
 }
 
 /**
@@ -100,6 +738,15 @@ QString DSEventLogger::logsPath() const
                  qApp->applicationVersion().toLower());
 }
 
+/**
+ * Returns the paths of the closed log segments that satisfy the given
+ * \a query, see \c DSLogArchiver::search()
+ */
+QStringList DSEventLogger::findSegments (const DSLogQuery& query) const
+{
+    return DSLogArchiver::search (logsPath(), query);
+}
+
 /**
  * Calls the appropiate functions to display the \a data on the console
  * and write it on the log file
@@ -115,8 +762,9 @@ void DSEventLogger::messageHandler (QtMsgType type,
 }
 
 /**
- * Writes the message output to the console and to the dump file (which is
- * dumped on the DS log file when the application exits).
+ * Queues the message output, which is written to the console and to the
+ * dump file by the writer thread. Fatal messages are written immediately
+ * (after the queued messages), since the application aborts afterwards.
  */
 void DSEventLogger::handleMessage (const QtMsgType type, const QString& data)
 {
@@ -128,51 +776,25 @@ void DSEventLogger::handleMessage (const QtMsgType type, const QString& data)
     if (!m_init)
         init();
 
-    /* Get warning level */
-    QString level;
-    switch (type) {
-    case QtDebugMsg:
-        level = "DEBUG";
-        break;
-    case QtWarningMsg:
-        level = "WARNING";
-        break;
-    case QtCriticalMsg:
-        level = "CRITICAL";
-        break;
-    case QtFatalMsg:
-        level = "FATAL";
-        break;
-    default:
-        level = "SYSTEM";
-        break;
-    }
-
     /* Get elapsed time */
-    qint64 msec = m_timer.elapsed();
-    qint64 secs = (msec / 1000);
-    qint64 mins = (secs / 60) % 60;
+    qint64 time = m_timer.elapsed();
 
-    /* Get the remaining seconds and milliseconds */
-    secs = secs % 60;
-    msec = msec % 1000;
+    /* Write the queued messages and the fatal message now */
+    if (type == QtFatalMsg)
+        m_writer.stop();
 
-    /* Get current time */
-    QString time = (QString ("%1:%2.%3")
-                    .arg (mins, 2, 10, QLatin1Char ('0'))
-                    .arg (secs, 2, 10, QLatin1Char ('0'))
-                    .arg (QString::number (msec).at (0)));
+    /* Write the message directly if the writer thread is not running */
+    if (!m_writer.enqueue (type, time, data)) {
+        QByteArray line = DSLogWriter::format (type, time, data);
 
-    /* Write logs to dump file and console */
-    fprintf (m_dump, PRINT_FMT, PRINT (time), PRINT (level), PRINT (data));
-    fprintf (stderr, PRINT_FMT, PRINT (time), PRINT (level), PRINT (data));
-
-    /* Flush to write "instantly" */
-    fflush (m_dump);
+        DSLogWriter::write (m_writer.file(), line);
+        if (m_writer.file() != stderr)
+            DSLogWriter::write (stderr, line);
+    }
 }
 
 /**
- * Prepares the log file for writting
+ * Writes the log header and opens the first log segment
  */
 void DSEventLogger::init()
 {
@@ -187,27 +809,6 @@ void DSEventLogger::init()
         QString ldsV = DriverStation::libDSVersion();
         QString time = GET_DATE_TIME ("MMM dd yyyy - HH:mm:ss AP");
 
-        /* Get dump directoru */
-        QString path = QString ("%1/%2/%3/%4/")
-                       .arg (logsPath())
-                       .arg (GET_DATE_TIME ("yyyy"))
-                       .arg (GET_DATE_TIME ("MMMM"))
-                       .arg (GET_DATE_TIME ("ddd dd"));
-
-        /* Create logs directory (if necessesary) */
-        QDir dir (path);
-        if (!dir.exists())
-            dir.mkpath (".");
-
-        /* Get dump file path */
-        m_currentLog = QString ("%1/%2.log")
-                       .arg (path)
-                       .arg (GET_DATE_TIME ("HH_mm_ss AP"));
-
-        /* Open dump file */
-        m_dump = fopen (m_currentLog.toStdString().c_str(), "w");
-        m_dump = !m_dump ? stderr : m_dump;
-
         /* Get OS information */
         QString sysV;
 #if QT_VERSION >= QT_VERSION_CHECK (5, 4, 0)
@@ -232,16 +833,33 @@ void DSEventLogger::init()
         appV.prepend ("Application version: ");
 
         /* Append app info */
-        fprintf (m_dump, "%s\n",   PRINT (time));
-        fprintf (m_dump, "%s\n",   PRINT (ldsV));
-        fprintf (m_dump, "%s\n",   PRINT (sysV));
-        fprintf (m_dump, "%s\n",   PRINT (appN));
-        fprintf (m_dump, "%s\n\n", PRINT (appV));
+        QByteArray header;
+        header.append (QString ("%1\n").arg (time).toLocal8Bit());
+        header.append (QString ("%1\n").arg (ldsV).toLocal8Bit());
+        header.append (QString ("%1\n").arg (sysV).toLocal8Bit());
+        header.append (QString ("%1\n").arg (appN).toLocal8Bit());
+        header.append (QString ("%1\n\n").arg (appV).toLocal8Bit());
 
         /* Start the table header */
-        fprintf (m_dump, "%s\n", PRINT (REPEAT ("-", 72)));
-        fprintf (m_dump, PRINT_FMT, "ELAPSED TIME", "ERROR LEVEL", "MESSAGE");
-        fprintf (m_dump, "%s\n", PRINT (REPEAT ("-", 72)));
+        char columns [64];
+        qsnprintf (columns, sizeof (columns), PRINT_FMT,
+                   "ELAPSED TIME", "ERROR LEVEL", "MESSAGE");
+        header.append (QString ("%1\n").arg (REPEAT ("-", 72)).toLocal8Bit());
+        header.append (columns);
+        header.append (QString ("%1\n").arg (REPEAT ("-", 72)).toLocal8Bit());
+
+        /* Open the first log segment */
+        m_writer.open (logsPath(), header, m_archiver);
+
+        /* Open the telemetry log (next to the first segment) */
+        QString telemetry = m_writer.currentPath();
+        if (!telemetry.isEmpty()) {
+            telemetry.replace (telemetry.length() - 4, 4, ".dstl");
+            m_telemetry.open (telemetry, currentTime());
+        }
+
+        /* Write the log messages from now on */
+        m_writer.start (QThread::LowPriority);
     }
 }
 
@@ -257,12 +875,13 @@ void DSEventLogger::openLogsPath()
 }
 
 /**
- * Opens the current log file using a system process
+ * Opens the current log segment using a system process
  */
 void DSEventLogger::openCurrentLog()
 {
-    if (!m_currentLog.isEmpty())
-        QDesktopServices::openUrl (QUrl::fromLocalFile (m_currentLog));
+    QString path = m_writer.currentPath();
+    if (!path.isEmpty())
+        QDesktopServices::openUrl (QUrl::fromLocalFile (path));
 }
 
 /**
@@ -280,7 +899,7 @@ void DSEventLogger::saveDataLoop()
 void DSEventLogger::onCANUsageChanged (int usage)
 {
     Q_UNUSED (usage);
-    m_canUsageLog.append (qMakePair<qint64, int> (currentTime(), usage));
+    m_telemetry.append (TelemetryLog::CANUsage, currentTime(), usage);
 }
 
 /**
@@ -289,7 +908,7 @@ void DSEventLogger::onCANUsageChanged (int usage)
 void DSEventLogger::onCPUUsageChanged (int usage)
 {
     Q_UNUSED (usage);
-    m_cpuUsageLog.append (qMakePair<qint64, int> (currentTime(), usage));
+    m_telemetry.append (TelemetryLog::CPUUsage, currentTime(), usage);
 }
 
 /**
@@ -298,7 +917,7 @@ void DSEventLogger::onCPUUsageChanged (int usage)
 void DSEventLogger::onRAMUsageChanged (int usage)
 {
     Q_UNUSED (usage);
-    m_ramUsageLog.append (qMakePair<qint64, int> (currentTime(), usage));
+    m_telemetry.append (TelemetryLog::RAMUsage, currentTime(), usage);
 }
 
 /**
@@ -307,7 +926,7 @@ void DSEventLogger::onRAMUsageChanged (int usage)
 void DSEventLogger::onNewMessage (QString message)
 {
     Q_UNUSED (message);
-    m_messagesLog.append (qMakePair<qint64, QString> (currentTime(), message));
+    m_telemetry.appendText (currentTime(), message);
 }
 
 /**
@@ -316,16 +935,21 @@ void DSEventLogger::onNewMessage (QString message)
 void DSEventLogger::onDiskUsageChanged (int usage)
 {
     Q_UNUSED (usage);
-    m_diskUsageLog.append (qMakePair<qint64, int> (currentTime(), usage));
+    m_telemetry.append (TelemetryLog::DiskUsage, currentTime(), usage);
 }
 
 /**
- * Called when the DS reports a change of the enabled status
+ * Called when the DS reports a change of the enabled status, the log
+ * segment of a match begins when the FMS enables the robot in autonomous
  */
 void DSEventLogger::onEnabledChanged (bool enabled)
 {
+    DriverStation* ds = DriverStation::getInstance();
+    if (enabled && ds->connectedToFMS() && ds->isAutonomous())
+        m_writer.startSegment (true);
+
     LOG << "Robot enabled state set to" << enabled;
-    m_enabledLog.append (qMakePair<qint64, bool> (currentTime(), enabled));
+    m_telemetry.append (TelemetryLog::Enabled, currentTime(), enabled);
 }
 
 /**
@@ -341,8 +965,10 @@ void DSEventLogger::onTeamNumberChanged (int number)
  */
 void DSEventLogger::onVoltageChanged (float voltage)
 {
-    Q_UNUSED (voltage);
-    m_voltageLog.append (qMakePair<qint64, float> (currentTime(), voltage));
+    if (DriverStation::getInstance()->connectedToRobot())
+        m_writer.noteVoltage (voltage);
+
+    m_telemetry.append (TelemetryLog::Voltage, currentTime(), voltage);
 }
 
 /**
@@ -351,7 +977,7 @@ void DSEventLogger::onVoltageChanged (float voltage)
 void DSEventLogger::onRobotCodeChanged (bool robotCode)
 {
     LOG << "Robot code status set to" << robotCode;
-    m_robotCodeLog.append (qMakePair<qint64, bool> (currentTime(), robotCode));
+    m_telemetry.append (TelemetryLog::RobotCode, currentTime(), robotCode);
 }
 
 /**
@@ -360,7 +986,8 @@ void DSEventLogger::onRobotCodeChanged (bool robotCode)
 void DSEventLogger::onFMSCommunicationsChanged (bool connected)
 {
     LOG << "FMS communications set to" << connected;
-    m_fmsCommsLog.append (qMakePair<qint64, bool> (currentTime(), connected));
+    m_telemetry.append (TelemetryLog::FMSCommunications, currentTime(),
+                        connected);
 }
 
 /**
@@ -369,7 +996,8 @@ void DSEventLogger::onFMSCommunicationsChanged (bool connected)
 void DSEventLogger::onRadioCommunicationsChanged (bool connected)
 {
     LOG << "Radio communications set to" << connected;
-    m_radioCommsLog.append (qMakePair<qint64, bool> (currentTime(), connected));
+    m_telemetry.append (TelemetryLog::RadioCommunications, currentTime(),
+                        connected);
 }
 
 /**
@@ -378,7 +1006,22 @@ void DSEventLogger::onRadioCommunicationsChanged (bool connected)
 void DSEventLogger::onRobotCommunicationsChanged (bool connected)
 {
     LOG << "Robot communications set to" << connected;
-    m_robotCommsLog.append (qMakePair<qint64, bool> (currentTime(), connected));
+    if (!connected)
+        m_writer.noteCommsDrop();
+
+    m_telemetry.append (TelemetryLog::RobotCommunications, currentTime(),
+                        connected);
+}
+
+/**
+ * Called when the FMS reports a new match
+ */
+void DSEventLogger::onFMSMatchChanged()
+{
+    int match = DriverStation::getInstance()->fmsMatchNumber();
+
+    LOG << "FMS match number set to" << match;
+    m_writer.noteMatch (match);
 }
 
 /**
@@ -387,8 +1030,8 @@ void DSEventLogger::onRobotCommunicationsChanged (bool connected)
 void DSEventLogger::onEmergencyStoppedChanged (bool emergencyStopped)
 {
     LOG << "ESTOP set to" << emergencyStopped;
-    m_emergencyStopLog.append (qMakePair<qint64, bool> (currentTime(),
-                               emergencyStopped));
+    m_telemetry.append (TelemetryLog::EmergencyStop, currentTime(),
+                        emergencyStopped);
 }
 
 /**
@@ -397,8 +1040,7 @@ void DSEventLogger::onEmergencyStoppedChanged (bool emergencyStopped)
 void DSEventLogger::onControlModeChanged (DriverStation::Control mode)
 {
     LOG << "Robot control mode set to" << mode;
-    m_controlModeLog.append (qMakePair<qint64, int> (currentTime(),
-                                                     (int) mode));
+    m_telemetry.append (TelemetryLog::ControlMode, currentTime(), (int) mode);
 }
 
 /**
@@ -418,10 +1060,12 @@ void DSEventLogger::onPositionChanged (DriverStation::Position position)
 }
 
 /**
- * Saves the current log information to a local file using the JSON format
+ * Sends the telemetry samples recorded since the last chunk to the writer
+ * thread, the samples are kept in memory for up to two seconds
  */
 void DSEventLogger::saveData()
 {
+    m_telemetry.flush (false);
 }
 
 /**
@@ -456,6 +1100,8 @@ void DSEventLogger::connectSlots()
              this, &DSEventLogger::onRadioCommunicationsChanged);
     connect (ds,   &DriverStation::robotCommunicationsChanged,
              this, &DSEventLogger::onRobotCommunicationsChanged);
+    connect (ds,   &DriverStation::fmsMatchChanged,
+             this, &DSEventLogger::onFMSMatchChanged);
     connect (ds,   &DriverStation::emergencyStoppedChanged,
              this, &DSEventLogger::onEmergencyStoppedChanged);
     connect (ds,   &DriverStation::controlModeChanged,
@@ -467,10 +1113,13 @@ void DSEventLogger::connectSlots()
 }
 
 /**
- * Returns the current time signature
+ * Returns the time signature (in msecs since the epoch) of the value that
+ * is being logged, which is the time in which the LibDS created the event
+ * that reported the value. The monotonic time of the event is mapped to the
+ * wall clock once, so changes to the system time do not affect the logs.
  */
 qint64 DSEventLogger::currentTime()
 {
-    QDateTime time = QDateTime::currentDateTime();
-    return time.toMSecsSinceEpoch();
+    quint64 time = DriverStation::getInstance()->eventTime();
+    return m_clockOffset + (qint64) (time / 1000);
 }
@@ -20,11 +20,189 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <stdio.h>
+#include <atomic>
+
+#include <QDir>
 #include <QList>
+#include <QMutex>
+#include <QVector>
 #include <QObject>
+#include <QThread>
+#include <QSemaphore>
+#include <QJsonArray>
+#include <QJsonObject>
 #include <QElapsedTimer>
 
 #include "DriverStation.h"
+#include "TelemetryLog.h"
+
+/*
+ * Number of log messages that can be queued before the producers must wait
+ * for the writer thread, and maximum time (in msecs) between two writes
+ */
+#define LOG_QUEUE_SIZE     1024
+#define LOG_FLUSH_INTERVAL 250
+
+/*
+ * A log segment is closed when it holds more than LOG_SEGMENT_SIZE bytes or
+ * when it is older than LOG_SEGMENT_AGE msecs. Closed segments are compressed
+ * (and renamed with the LOG_ARCHIVE_SUFFIX) and listed in the LOG_INDEX_FILE
+ * of the logs directory.
+ */
+#define LOG_SEGMENT_SIZE   (4 * 1024 * 1024)
+#define LOG_SEGMENT_AGE    (60 * 60 * 1000)
+#define LOG_INDEX_FILE     "index.json"
+#define LOG_ARCHIVE_SUFFIX ".z"
+
+/*
+ * Maximum number of distinct error messages noted in a segment summary
+ */
+#define LOG_SUMMARY_ERRORS 64
+
+/**
+ * Selects the log segments returned by \c DSLogArchiver::search(), a
+ * segment must satisfy every criteria that is set. Criteria that rely on
+ * the segment summary never match the segments that have no summary
+ * (e.g. the segments of a crashed session).
+ */
+struct DSLogQuery {
+    DSLogQuery() :
+        from (0),
+        to (0),
+        matchesOnly (false),
+        matchNumber (0),
+        maxVoltage (0),
+        minCommsDrops (0) {}
+
+    qint64 from;          /**< Segments that end after (msecs since epoch) */
+    qint64 to;            /**< Segments that start before (msecs since epoch) */
+    bool matchesOnly;     /**< Only the segments that begin with a match */
+    int matchNumber;      /**< Segments in which the FMS reported this match */
+    double maxVoltage;    /**< Segments where the voltage dropped below */
+    int minCommsDrops;    /**< Segments with at least these comms drops */
+    QString error;        /**< Segments that logged this error message */
+};
+
+/**
+ * Compresses the closed log segments in its own thread and keeps the index
+ * of the segments (file, start and end times, sizes and whether the segment
+ * belongs to a match) up to date.
+ *
+ * Segments that were left open by a crashed session are compressed when the
+ * index is recovered, and the segments deleted by the user are forgotten.
+ */
+class DSLogArchiver : public QObject
+{
+    Q_OBJECT
+
+public:
+    DSLogArchiver (const QString& root);
+
+    static quint32 hash (const QString& message);
+    static QByteArray read (const QString& path);
+    static QStringList search (const QString& root, const DSLogQuery& query);
+
+public slots:
+    void recover();
+    void segmentOpened (const QString& path,
+                        const qint64 start,
+                        const bool match);
+    void segmentClosed (const QString& path,
+                        const qint64 end,
+                        const QJsonObject& summary);
+
+private:
+    void saveIndex();
+    void compress (const int entry);
+    int find (const QString& file) const;
+
+private:
+    QDir m_root;
+    QJsonArray m_index;
+};
+
+/**
+ * Formats the log messages queued by the \c DSEventLogger and writes them
+ * in batches to the dump file and to the console, from its own thread.
+ *
+ * The queue is a bounded multi-producer queue (the same design as the event
+ * queue of the LibDS), so logging a message never takes a lock or touches
+ * the disk. The batch is written every \c LOG_FLUSH_INTERVAL milliseconds,
+ * or as soon as a warning or an error is queued.
+ *
+ * The messages are written to the current segment of the log, a new segment
+ * is opened when the current one grows too large or too old, or when the
+ * logger reports the start of a match.
+ *
+ * The writer also builds the summary of the current segment (lowest robot
+ * voltage, communication drops, match numbers and the hashes of the errors
+ * and warnings), which the archiver stores in the segment index so that the
+ * segments can be searched without reading them.
+ */
+class DSLogWriter : public QThread
+{
+public:
+    DSLogWriter();
+
+    FILE* file() const;
+    QString currentPath() const;
+
+    void stop();
+    void close (const Qt::ConnectionType type = Qt::QueuedConnection);
+    void startSegment (const bool match);
+
+    void noteCommsDrop();
+    void noteMatch (const int match);
+    void noteVoltage (const float voltage);
+    bool open (const QString& root,
+               const QByteArray& header,
+               DSLogArchiver* archiver);
+    bool enqueue (const QtMsgType type, const qint64 time, const QString& data);
+
+    static void write (FILE* file, const QByteArray& data);
+    static QByteArray format (const QtMsgType type,
+                              const qint64 time,
+                              const QString& data);
+
+protected:
+    void run();
+
+private:
+    void drain();
+    bool openSegment (const bool match);
+    QJsonObject takeSummary();
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        QtMsgType type;
+        qint64 time;
+        QString data;
+    };
+
+    FILE* m_file;
+    QString m_root;
+    QString m_path;
+    QByteArray m_header;
+    qint64 m_segmentSize;
+    mutable QMutex m_pathLock;
+    QElapsedTimer m_segmentTimer;
+    DSLogArchiver* m_archiver;
+    std::atomic<int> m_segmentRequest;
+
+    int m_commsDrops;
+    float m_minVoltage;
+    QVector<int> m_matches;
+    QVector<quint32> m_errors;
+    QMutex m_summaryLock;
+
+    QSemaphore m_wakeUp;
+    std::atomic<bool> m_running;
+    std::atomic<size_t> m_enqueuePos;
+    std::atomic<size_t> m_dequeuePos;
+    Cell m_cells [LOG_QUEUE_SIZE];
+};
 
 class DSEventLogger : public QObject
 {
@@ -34,6 +212,7 @@ public:
     static DSEventLogger* getInstance();
 
     QString logsPath() const;
+    QStringList findSegments (const DSLogQuery& query) const;
     static void messageHandler (QtMsgType type,
                                 const QMessageLogContext& context,
                                 const QString& data);
@@ -63,6 +242,7 @@ private slots:
     void onFMSCommunicationsChanged (bool connected);
     void onRadioCommunicationsChanged (bool connected);
     void onRobotCommunicationsChanged (bool connected);
+    void onFMSMatchChanged();
     void onEmergencyStoppedChanged (bool emergencyStopped);
     void onControlModeChanged (DriverStation::Control mode);
     void onAllianceChanged (DriverStation::Alliance alliance);
@@ -75,21 +255,11 @@ private:
 
 private:
     bool m_init;
-    FILE* m_dump;
-    QString m_currentLog;
+    qint64 m_clockOffset;
     QElapsedTimer m_timer;
+    DSLogWriter m_writer;
+    QThread m_archiverThread;
+    DSLogArchiver* m_archiver;
 
-    QList<QPair<qint64, int>> m_canUsageLog;
-    QList<QPair<qint64, int>> m_cpuUsageLog;
-    QList<QPair<qint64, int>> m_ramUsageLog;
-    QList<QPair<qint64, bool>> m_enabledLog;
-    QList<QPair<qint64, int>> m_diskUsageLog;
-    QList<QPair<qint64, float>> m_voltageLog;
-    QList<QPair<qint64, bool>> m_fmsCommsLog;
-    QList<QPair<qint64, bool>> m_robotCodeLog;
-    QList<QPair<qint64, bool>> m_radioCommsLog;
-    QList<QPair<qint64, bool>> m_robotCommsLog;
-    QList<QPair<qint64, int>> m_controlModeLog;
-    QList<QPair<qint64, QString>> m_messagesLog;
-    QList<QPair<qint64, bool>> m_emergencyStopLog;
+    TelemetryLog m_telemetry;
 };
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "EventThread.h"
+
+#include <LibDS.h>
+#include <QMutexLocker>
+
+#if defined Q_OS_WIN
+    #include <windows.h>
+#else
+    #include <poll.h>
+#endif
+
+/*
+ * Maximum time (in msecs) that the thread waits for the event handle before
+ * checking if it must stop, and polling interval used if the event handle
+ * is not available
+ */
+#define EVENT_WAIT          50
+#define EVENT_POLL_INTERVAL 5
+
+/**
+ * The thread drains the events of the LibDS context that is current in the
+ * thread that creates it
+ */
+DSEventThread::DSEventThread() :
+    m_context (DS_ContextCurrent()),
+    m_running (false)
+{
+}
+
+/**
+ * Stops the thread before it is destroyed
+ */
+DSEventThread::~DSEventThread()
+{
+    stop();
+}
+
+/**
+ * Stops the thread, the events that were not taken by the GUI thread are
+ * discarded
+ */
+void DSEventThread::stop()
+{
+    if (!m_running.exchange (false))
+        return;
+
+    wait();
+}
+
+/**
+ * Returns (and removes) the events received since the last call, this is
+ * called by the GUI thread when \c eventsAvailable() is emitted
+ */
+QList<DSEventThread::Event> DSEventThread::takeEvents()
+{
+    QMutexLocker locker (&m_mutex);
+
+    QList<Event> events;
+    events.swap (m_events);
+    return events;
+}
+
+/**
+ * Waits for the LibDS events and drains them until the thread is stopped
+ */
+void DSEventThread::run()
+{
+    DS_ContextMakeCurrent (m_context);
+
+    while (m_running.load()) {
+        waitForEvents (EVENT_WAIT);
+        drain();
+    }
+}
+
+/**
+ * Starts the thread (if it is not running yet)
+ */
+void DSEventThread::start()
+{
+    if (!m_running.exchange (true))
+        QThread::start (QThread::HighPriority);
+}
+
+/**
+ * Reads the pending LibDS events and stores them (coalesced by type, in
+ * chronological order) until the GUI thread takes them. The
+ * \c eventsAvailable() signal is only emitted when the first events of a
+ * batch are stored.
+ */
+void DSEventThread::drain()
+{
+    DS_Event event;
+    bool notify = false;
+
+    while (DS_PollEvent (&event)) {
+        Event item;
+        item.event = event;
+
+        /* The message is only valid until the next event is polled */
+        if (event.type == DS_NETCONSOLE_NEW_MESSAGE) {
+            item.message = QString::fromUtf8 (event.netconsole.message);
+            item.event.netconsole.message = Q_NULLPTR;
+        }
+
+        QMutexLocker locker (&m_mutex);
+        notify |= m_events.isEmpty();
+
+        /* Remove the pending event of the same type, the new event is
+         * appended so that the events are delivered in the order they
+         * happened */
+        if (event.type != DS_NETCONSOLE_NEW_MESSAGE) {
+            for (int i = 0; i < m_events.count(); ++i) {
+                if (m_events.at (i).event.type == event.type) {
+                    m_events.removeAt (i);
+                    break;
+                }
+            }
+        }
+
+        m_events.append (item);
+    }
+
+    if (notify)
+        emit eventsAvailable();
+}
+
+/**
+ * Waits (at most \a msecs milliseconds) until the LibDS event handle is
+ * signaled, if the handle is not available, the thread sleeps for
+ * \c EVENT_POLL_INTERVAL milliseconds instead
+ */
+void DSEventThread::waitForEvents (const int msecs)
+{
+    DS_EventHandle handle = DS_GetEventHandle();
+
+#if defined Q_OS_WIN
+    if (handle) {
+        WaitForSingleObject ((HANDLE) handle, (DWORD) msecs);
+        return;
+    }
+#else
+    if (handle >= 0) {
+        struct pollfd pfd;
+        pfd.fd = handle;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        poll (&pfd, 1, msecs);
+        return;
+    }
+#endif
+
+    msleep (EVENT_POLL_INTERVAL);
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _DS_EVENT_THREAD_H
+#define _DS_EVENT_THREAD_H
+
+#include <atomic>
+
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QThread>
+
+#include <DS_Events.h>
+#include <DS_Context.h>
+
+/**
+ * Drains the LibDS event queue from its own thread, so that a busy GUI
+ * thread (e.g. a long QML layout or a modal dialog) never lets the queue of
+ * the LibDS fill up.
+ *
+ * The events are coalesced while the GUI thread is busy: only the latest
+ * event of each type is kept (NetConsole messages are all kept), and the
+ * \c eventsAvailable() signal is emitted once per batch, so the GUI thread
+ * processes at most one event of each type after a stall.
+ */
+class DSEventThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    struct Event {
+        DS_Event event;  /**< The LibDS event (without its message) */
+        QString message; /**< Message of a NetConsole message event */
+    };
+
+    DSEventThread();
+    ~DSEventThread();
+
+    void start();
+    void stop();
+    QList<Event> takeEvents();
+
+signals:
+    void eventsAvailable();
+
+protected:
+    void run();
+
+private:
+    void drain();
+    void waitForEvents (const int msecs);
+
+private:
+    QMutex m_mutex;
+    QList<Event> m_events;
+    DS_Context* m_context;
+    std::atomic<bool> m_running;
+};
+
+#endif
@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "Hotkeys.h"
+#include "Robot.h"
+
+#include <LibDS.h>
+#include <QKeyEvent>
+#include <QMutexLocker>
+#include <QCoreApplication>
+
+#if defined Q_OS_WIN
+    #include <windows.h>
+#elif defined Q_OS_LINUX && !defined Q_OS_ANDROID
+    #include <QDir>
+    #include <QVector>
+
+    #include <poll.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/ioctl.h>
+    #include <linux/input.h>
+#endif
+
+/*
+ * Maximum time (in msecs) that the thread waits for key presses before
+ * checking if it must stop
+ */
+#define HOTKEY_WAIT 50
+
+#if defined Q_OS_WIN
+/*
+ * State of the keyboard hook, which is installed by the thread itself
+ */
+enum HookState {
+    HookPending,
+    HookInstalled,
+    HookFailed,
+};
+
+/*
+ * The hotkeys that own the keyboard hook (there is only one instance)
+ */
+static std::atomic<DSHotkeys*> HOOK_OWNER (nullptr);
+
+/**
+ * Called by Windows (in the thread that installed the hook) whenever a key
+ * is pressed in any application. The key is always passed on.
+ */
+static LRESULT CALLBACK keyboardHook (int code, WPARAM wParam, LPARAM lParam)
+{
+    DSHotkeys* hotkeys = HOOK_OWNER.load();
+
+    if (code == HC_ACTION && hotkeys &&
+            (wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN)) {
+        const KBDLLHOOKSTRUCT* key = (const KBDLLHOOKSTRUCT*) lParam;
+
+        if (key->vkCode == VK_SPACE)
+            hotkeys->trigger (DSHotkeys::EmergencyStop);
+        else if (key->vkCode == VK_RETURN)
+            hotkeys->trigger (DSHotkeys::Disable);
+    }
+
+    return CallNextHookEx (NULL, code, wParam, lParam);
+}
+#elif defined Q_OS_LINUX && !defined Q_OS_ANDROID
+/**
+ * Returns \c true if the given \a bit is set in the given evdev \a bits
+ */
+static bool testBit (const unsigned long* bits, const int bit)
+{
+    const int size = 8 * sizeof (unsigned long);
+    return (bits [bit / size] >> (bit % size)) & 1;
+}
+#endif
+
+/**
+ * The hotkeys act on the LibDS context that is current in the thread that
+ * creates them, until \c setContexts() is called
+ */
+DSHotkeys::DSHotkeys() :
+    m_running (false),
+    m_global (false),
+    m_filter (false)
+{
+    m_contexts.append (DS_ContextCurrent());
+
+#if defined Q_OS_WIN
+    m_hookState = HookPending;
+#endif
+}
+
+/**
+ * Stops reading the keyboard before the hotkeys are destroyed
+ */
+DSHotkeys::~DSHotkeys()
+{
+    stop();
+}
+
+/**
+ * Returns \c true if the keys are read even when the window is not focused
+ */
+bool DSHotkeys::global() const
+{
+    return m_global;
+}
+
+/**
+ * Starts reading the keyboard, globally if possible, or with an event
+ * filter of the application if not
+ */
+void DSHotkeys::start()
+{
+    if (m_running.exchange (true))
+        return;
+
+    m_global = startGlobal();
+    if (!m_global) {
+        QCoreApplication::instance()->installEventFilter (this);
+        m_filter = true;
+    }
+}
+
+/**
+ * Stops reading the keyboard
+ */
+void DSHotkeys::stop()
+{
+    if (!m_running.exchange (false))
+        return;
+
+    if (m_filter) {
+        QCoreApplication::instance()->removeEventFilter (this);
+        m_filter = false;
+    }
+
+    wait();
+
+#if defined Q_OS_WIN
+    DSHotkeys* owner = this;
+    HOOK_OWNER.compare_exchange_strong (owner, nullptr);
+#elif defined Q_OS_LINUX && !defined Q_OS_ANDROID
+    foreach (int device, m_devices)
+        close (device);
+
+    m_devices.clear();
+#endif
+
+    m_global = false;
+}
+
+/**
+ * Changes the LibDS \a contexts (the main robot and the additional robots)
+ * that are e-stopped or disabled by the hotkeys. This waits until a running
+ * action finishes, so a context can be closed right after it is removed.
+ */
+void DSHotkeys::setContexts (const QList<DS_Context*>& contexts)
+{
+    QMutexLocker locker (&m_mutex);
+    m_contexts = contexts;
+}
+
+/**
+ * Emergency stops or disables every robot, this is called by the thread
+ * that reads the keyboard (or by the GUI thread with the event filter)
+ */
+void DSHotkeys::trigger (const Action action)
+{
+    QMutexLocker locker (&m_mutex);
+
+    foreach (DS_Context* context, m_contexts) {
+        DSContextScope scope (context);
+
+        if (action == EmergencyStop)
+            DS_SetEmergencyStopped (1);
+        else
+            DS_SetRobotEnabled (0);
+    }
+}
+
+/**
+ * Reads the keyboard until the hotkeys are stopped
+ */
+void DSHotkeys::run()
+{
+#if defined Q_OS_WIN
+    HHOOK hook = SetWindowsHookEx (WH_KEYBOARD_LL, &keyboardHook,
+                                   GetModuleHandle (NULL), 0);
+    m_hookState = hook ? HookInstalled : HookFailed;
+    if (!hook)
+        return;
+
+    /* The hook is called while the thread retrieves its messages */
+    while (m_running.load()) {
+        MSG msg;
+        MsgWaitForMultipleObjects (0, NULL, FALSE, HOTKEY_WAIT, QS_ALLINPUT);
+        while (PeekMessage (&msg, NULL, 0, 0, PM_REMOVE)) {
+            TranslateMessage (&msg);
+            DispatchMessage (&msg);
+        }
+    }
+
+    UnhookWindowsHookEx (hook);
+#elif defined Q_OS_LINUX && !defined Q_OS_ANDROID
+    QVector<struct pollfd> fds;
+    foreach (int device, m_devices) {
+        struct pollfd pfd;
+        pfd.fd = device;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        fds.append (pfd);
+    }
+
+    while (m_running.load()) {
+        if (poll (fds.data(), (nfds_t) fds.count(), HOTKEY_WAIT) <= 0)
+            continue;
+
+        for (int i = 0; i < fds.count(); ++i) {
+            /* Keyboard was unplugged, stop polling it */
+            if (fds [i].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                fds [i].fd = -1;
+                continue;
+            }
+
+            if (!(fds [i].revents & POLLIN))
+                continue;
+
+            /* Only key presses are used (not releases or repeats) */
+            ssize_t bytes;
+            struct input_event events [16];
+            while ((bytes = read (fds [i].fd, events, sizeof (events))) > 0) {
+                int count = (int) (bytes / sizeof (struct input_event));
+                for (int j = 0; j < count; ++j) {
+                    if (events [j].type != EV_KEY || events [j].value != 1)
+                        continue;
+
+                    if (events [j].code == KEY_SPACE)
+                        trigger (EmergencyStop);
+                    else if (events [j].code == KEY_ENTER ||
+                             events [j].code == KEY_KPENTER)
+                        trigger (Disable);
+                }
+            }
+        }
+    }
+#endif
+}
+
+/**
+ * Catches the spacebar and Enter key presses of the application before
+ * they are delivered to QML (only used if the keyboard cannot be read
+ * globally). The key presses are not consumed.
+ */
+bool DSHotkeys::eventFilter (QObject* object, QEvent* event)
+{
+    if (event->type() == QEvent::KeyPress) {
+        QKeyEvent* key = static_cast<QKeyEvent*> (event);
+
+        if (!key->isAutoRepeat()) {
+            if (key->key() == Qt::Key_Space)
+                trigger (EmergencyStop);
+            else if (key->key() == Qt::Key_Return || key->key() == Qt::Key_Enter)
+                trigger (Disable);
+        }
+    }
+
+    return QThread::eventFilter (object, event);
+}
+
+/**
+ * Starts the thread that reads the keyboard globally
+ *
+ * \returns \c true on success, \c false if the keyboard cannot be read
+ *          globally on this platform (or by this user)
+ */
+bool DSHotkeys::startGlobal()
+{
+#if defined Q_OS_WIN
+    /* Only one instance can own the keyboard hook */
+    DSHotkeys* owner = nullptr;
+    if (!HOOK_OWNER.compare_exchange_strong (owner, this))
+        return false;
+
+    /* Wait until the thread has installed the hook */
+    m_hookState = HookPending;
+    QThread::start (QThread::TimeCriticalPriority);
+    while (m_hookState.load() == HookPending)
+        QThread::msleep (1);
+
+    if (m_hookState.load() == HookInstalled)
+        return true;
+
+    wait();
+    HOOK_OWNER.store (nullptr);
+    return false;
+#elif defined Q_OS_LINUX && !defined Q_OS_ANDROID
+    /* Open the devices that have a spacebar and an Enter key */
+    QDir input ("/dev/input");
+    foreach (const QString& name, input.entryList (QStringList ("event*"),
+                                                   QDir::System)) {
+        QByteArray path = input.filePath (name).toLocal8Bit();
+        int device = open (path.constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (device < 0)
+            continue;
+
+        unsigned long keys [KEY_MAX / (8 * sizeof (unsigned long)) + 1] = {0};
+        if (ioctl (device, EVIOCGBIT (EV_KEY, sizeof (keys)), keys) >= 0 &&
+                testBit (keys, KEY_SPACE) && testBit (keys, KEY_ENTER))
+            m_devices.append (device);
+        else
+            close (device);
+    }
+
+    if (m_devices.isEmpty())
+        return false;
+
+    QThread::start (QThread::TimeCriticalPriority);
+    return true;
+#else
+    return false;
+#endif
+}
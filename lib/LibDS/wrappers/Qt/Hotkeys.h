@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _DS_HOTKEYS_H
+#define _DS_HOTKEYS_H
+
+#include <atomic>
+
+#include <QList>
+#include <QMutex>
+#include <QThread>
+
+#include <DS_Context.h>
+
+/**
+ * Emergency stops the robots when the user presses the spacebar and
+ * disables them when the user presses Enter, like the official DS.
+ *
+ * The keys are read by a thread that calls the LibDS directly (a low-level
+ * keyboard hook on Windows, the evdev keyboards on Linux), so they work
+ * when the window is not focused or the GUI thread is busy, and together
+ * with the state change packets of the LibDS the robot learns about the
+ * key press within a couple of milliseconds.
+ *
+ * If the keyboard cannot be read globally (e.g. on macOS, or on Linux if
+ * the user cannot read \c /dev/input), the keys are caught by an event
+ * filter of the application instead, which only works while the window is
+ * focused, but still skips the QML event path.
+ */
+class DSHotkeys : public QThread
+{
+    Q_OBJECT
+
+public:
+    enum Action {
+        EmergencyStop,
+        Disable,
+    };
+
+    DSHotkeys();
+    ~DSHotkeys();
+
+    bool global() const;
+
+    void start();
+    void stop();
+    void setContexts (const QList<DS_Context*>& contexts);
+    void trigger (const Action action);
+
+protected:
+    void run();
+    bool eventFilter (QObject* object, QEvent* event);
+
+private:
+    bool startGlobal();
+
+private:
+    QMutex m_mutex;
+    QList<DS_Context*> m_contexts;
+    std::atomic<bool> m_running;
+    bool m_global;
+    bool m_filter;
+
+#if defined Q_OS_WIN
+    std::atomic<int> m_hookState;
+#elif defined Q_OS_LINUX && !defined Q_OS_ANDROID
+    QList<int> m_devices;
+#endif
+};
+
+#endif
@@ -1,9 +1,7 @@
 QT += gui
 QT += widgets
-
-android {
-  QT += network
-}
+QT += network
+QT += concurrent
 
 CONFIG += c++11
 
@@ -11,10 +9,52 @@ INCLUDEPATH += $$PWD
 
 include ($$PWD/../../LibDS.pri)
 
+# Read the memory usage of the process (see ProcessMonitor.cpp)
+win32* {
+    LIBS += -lpsapi
+}
+
+# Install the low-level keyboard hook of the hotkeys (see Hotkeys.cpp)
+win32* {
+    LIBS += -luser32
+}
+
+# Export the LibDS functions to the protocol modules loaded at runtime
+unix:!macx:!android {
+    QMAKE_LFLAGS += -rdynamic
+}
+
 HEADERS += \
     $$PWD/DriverStation.h \
-    $$PWD/EventLogger.h
+    $$PWD/DriverStationFrame.h \
+    $$PWD/DriverStationOperation.h \
+    $$PWD/DriverStationTask.h \
+    $$PWD/EventLogger.h \
+    $$PWD/EventThread.h \
+    $$PWD/Hotkeys.h \
+    $$PWD/NetConsoleEntry.h \
+    $$PWD/NetConsoleModel.h \
+    $$PWD/NetConsoleFilter.h \
+    $$PWD/ProcessMonitor.h \
+    $$PWD/RemoteServer.h \
+    $$PWD/Robot.h \
+    $$PWD/TelemetryExport.h \
+    $$PWD/TelemetryLog.h \
+    $$PWD/TelemetryReader.h \
+    $$PWD/TelemetryHistory.h
 
 SOURCES += \
     $$PWD/DriverStation.cpp \
-    $$PWD/EventLogger.cpp
+    $$PWD/DriverStationOperation.cpp \
+    $$PWD/EventLogger.cpp \
+    $$PWD/EventThread.cpp \
+    $$PWD/Hotkeys.cpp \
+    $$PWD/NetConsoleModel.cpp \
+    $$PWD/NetConsoleFilter.cpp \
+    $$PWD/ProcessMonitor.cpp \
+    $$PWD/RemoteServer.cpp \
+    $$PWD/Robot.cpp \
+    $$PWD/TelemetryExport.cpp \
+    $$PWD/TelemetryLog.cpp \
+    $$PWD/TelemetryReader.cpp \
+    $$PWD/TelemetryHistory.cpp
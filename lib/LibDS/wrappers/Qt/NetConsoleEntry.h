@@ -0,0 +1,65 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _NETCONSOLE_ENTRY_H
+#define _NETCONSOLE_ENTRY_H
+
+#include <QString>
+#include <QMetaType>
+#include <DS_NetConsole.h>
+
+/**
+ * A NetConsole line, stored as plain text along with its origin, severity
+ * and the time (in msecs since the epoch) in which it was received. Views
+ * decide how to display each source and severity, so the lines never need
+ * to be parsed as rich text.
+ *
+ * The source and severity are the values of the \c DS_NetConsoleSource and
+ * \c DS_NetConsoleSeverity enums (also exposed by the \c DriverStation).
+ */
+struct NetConsoleEntry {
+    QString text;
+    int source = DS_NETCONSOLE_SOURCE_ROBOT;
+    int severity = DS_NETCONSOLE_SEVERITY_INFO;
+    qint64 time = 0;
+
+    /**
+     * Returns the line as it is copied or exported, the lines that were
+     * not printed by the robot are prefixed with "**"
+     */
+    QString toPlainText() const
+    {
+        switch (source) {
+        case DS_NETCONSOLE_SOURCE_LIBDS:
+            return "** LibDS: " + text;
+        case DS_NETCONSOLE_SOURCE_APPLICATION:
+            return "** " + text;
+        default:
+            return text;
+        }
+    }
+};
+
+Q_DECLARE_METATYPE (NetConsoleEntry)
+
+#endif
@@ -0,0 +1,430 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "NetConsoleFilter.h"
+#include "NetConsoleModel.h"
+
+#include <QRegularExpression>
+
+/*
+ * Number of lines in each indexed block, and number of bits (as a power of
+ * two) of the trigram set of each block
+ */
+#define BLOCK_SIZE     64
+#define SIGNATURE_BITS 13
+
+/**
+ * Returns the position of the trigram that begins with the given
+ * character in the trigram set of a block
+ */
+static int trigramBit (const QChar* c)
+{
+    quint32 hash = ((quint32) c [0].unicode() << 16) ^
+                   ((quint32) c [1].unicode() << 8) ^
+                   ((quint32) c [2].unicode());
+
+    return (int) ((hash * 2654435761u) >> (32 - SIGNATURE_BITS));
+}
+
+/**
+ * Returns the trigram bits of the given (lower-case) \a text
+ */
+static QVector<int> trigramBits (const QString& text)
+{
+    QVector<int> bits;
+    for (int i = 0; i + 2 < text.length(); ++i)
+        bits.append (trigramBit (text.constData() + i));
+
+    return bits;
+}
+
+/**
+ * Returns \c true if the trigram set of a block contains all the given
+ * trigram \a bits
+ */
+static bool containsAll (const QBitArray& set, const QVector<int>& bits)
+{
+    for (int i = 0; i < bits.count(); ++i) {
+        if (!set.testBit (bits.at (i)))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Registers the types used to send search results between threads
+ */
+NetConsoleSearch::NetConsoleSearch()
+{
+    qRegisterMetaType<QVector<quint64>> ("QVector<quint64>");
+}
+
+/**
+ * Searches the lines that match the given \a pattern, beginning with the
+ * line number \a from. The found line numbers are reported with the
+ * \c finished() signal.
+ *
+ * \param request identifier of the search, sent back with the results
+ * \param lines snapshot of the NetConsole lines
+ * \param firstLine number of the first line of \a lines
+ * \param from number of the first line to search
+ * \param pattern the substring or regular expression to find
+ * \param regex set to \c true if \a pattern is a regular expression
+ * \param caseSensitive set to \c true to match the case of \a pattern
+ */
+void NetConsoleSearch::search (const quint64 request,
+                               const QStringList& lines,
+                               const quint64 firstLine,
+                               const quint64 from,
+                               const QString& pattern,
+                               const bool regex,
+                               const bool caseSensitive)
+{
+    QVector<quint64> matches;
+    quint64 end = firstLine + lines.count();
+
+    /* Index the new lines */
+    updateIndex (lines, firstLine);
+
+    /* Prepare the regular expression */
+    QRegularExpression expression;
+    if (regex) {
+        expression.setPattern (pattern);
+        if (!caseSensitive)
+            expression.setPatternOptions (QRegularExpression::CaseInsensitiveOption);
+
+        if (!expression.isValid()) {
+            emit finished (request, matches, end);
+            return;
+        }
+    }
+
+    /* Get the trigrams that a block must contain to match the substring */
+    QVector<int> bits;
+    if (!regex)
+        bits = trigramBits (pattern.toLower());
+
+    Qt::CaseSensitivity cs = caseSensitive ? Qt::CaseSensitive :
+                             Qt::CaseInsensitive;
+
+    /* Search the lines */
+    quint64 line;
+    for (line = qMax (from, firstLine); line < end; ++line) {
+        /* Skip the indexed blocks that cannot contain the substring */
+        if (!bits.isEmpty() && (line == from || line % BLOCK_SIZE == 0)) {
+            QMap<quint64, QBitArray>::const_iterator it;
+            it = m_index.constFind (line / BLOCK_SIZE);
+            if (it != m_index.constEnd() && !containsAll (it.value(), bits)) {
+                line = (line / BLOCK_SIZE + 1) * BLOCK_SIZE - 1;
+                continue;
+            }
+        }
+
+        /* Compare the line */
+        const QString& text = lines.at ((int) (line - firstLine));
+        if (regex ? expression.match (text).hasMatch() :
+                text.contains (pattern, cs))
+            matches.append (line);
+    }
+
+    emit finished (request, matches, end);
+}
+
+/**
+ * Removes the blocks of the removed lines from the index and records the
+ * trigrams of the new complete blocks
+ */
+void NetConsoleSearch::updateIndex (const QStringList& lines,
+                                    const quint64 firstLine)
+{
+    /* Remove the blocks that only contain removed lines */
+    while (!m_index.isEmpty() &&
+            (m_index.firstKey() + 1) * BLOCK_SIZE <= firstLine)
+        m_index.erase (m_index.begin());
+
+    /* Index the complete blocks */
+    quint64 end = firstLine + lines.count();
+    quint64 block = (firstLine + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    for (; (block + 1) * BLOCK_SIZE <= end; ++block) {
+        if (m_index.contains (block))
+            continue;
+
+        QBitArray set (1 << SIGNATURE_BITS);
+        for (int i = 0; i < BLOCK_SIZE; ++i) {
+            int row = (int) (block * BLOCK_SIZE + i - firstLine);
+            QString text = lines.at (row).toLower();
+            for (int j = 0; j + 2 < text.length(); ++j)
+                set.setBit (trigramBit (text.constData() + j));
+        }
+
+        m_index.insert (block, set);
+    }
+}
+
+/**
+ * Starts the search thread and follows the changes of the NetConsole model
+ */
+NetConsoleFilter::NetConsoleFilter()
+{
+    m_busy = false;
+    m_regex = false;
+    m_caseSensitive = false;
+
+    m_request = 0;
+    m_searched = 0;
+    m_model = NetConsoleModel::getInstance();
+
+    /* Move the search engine to its own thread */
+    NetConsoleSearch* search = new NetConsoleSearch;
+    search->moveToThread (&m_thread);
+    connect (&m_thread, SIGNAL (finished()), search, SLOT (deleteLater()));
+    connect (this,   &NetConsoleFilter::searchRequested,
+             search, &NetConsoleSearch::search);
+    connect (search, &NetConsoleSearch::finished,
+             this,   &NetConsoleFilter::onSearchFinished);
+    m_thread.start (QThread::LowPriority);
+
+    /* Search the new lines as they arrive */
+    connect (m_model, SIGNAL (rowsInserted (QModelIndex, int, int)),
+             this,      SLOT (requestSearch()));
+    connect (m_model, SIGNAL (rowsRemoved (QModelIndex, int, int)),
+             this,      SLOT (onLinesRemoved()));
+    connect (m_model, SIGNAL (modelReset()),
+             this,      SLOT (restart()));
+}
+
+/**
+ * Stops the search thread
+ */
+NetConsoleFilter::~NetConsoleFilter()
+{
+    m_thread.quit();
+    m_thread.wait();
+}
+
+/**
+ * Returns the only instance of the class
+ */
+NetConsoleFilter* NetConsoleFilter::getInstance()
+{
+    static NetConsoleFilter instance;
+    return &instance;
+}
+
+/**
+ * Returns \c true while the lines are being searched
+ */
+bool NetConsoleFilter::busy() const
+{
+    return m_busy;
+}
+
+/**
+ * Returns \c true if the filter is a regular expression
+ */
+bool NetConsoleFilter::regex() const
+{
+    return m_regex;
+}
+
+/**
+ * Returns the current filter, an empty filter matches no lines
+ */
+QString NetConsoleFilter::filter() const
+{
+    return m_filter;
+}
+
+/**
+ * Returns \c true if the filter is case-sensitive
+ */
+bool NetConsoleFilter::caseSensitive() const
+{
+    return m_caseSensitive;
+}
+
+/**
+ * Returns the role names of the NetConsole model
+ */
+QHash<int, QByteArray> NetConsoleFilter::roleNames() const
+{
+    return m_model->roleNames();
+}
+
+/**
+ * Returns the data of the matching line at the given \a index
+ */
+QVariant NetConsoleFilter::data (const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_matches.count())
+        return QVariant();
+
+    quint64 line = m_matches.at (index.row());
+    int row = (int) (line - m_model->firstLine());
+    return m_model->data (m_model->index (row), role);
+}
+
+/**
+ * Returns the number of matching lines
+ */
+int NetConsoleFilter::rowCount (const QModelIndex& parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return m_matches.count();
+}
+
+/**
+ * Changes the filter type and searches all the lines again
+ */
+void NetConsoleFilter::setRegex (const bool regex)
+{
+    if (m_regex != regex) {
+        m_regex = regex;
+        emit filterChanged();
+        restart();
+    }
+}
+
+/**
+ * Changes the filter and searches all the lines again
+ */
+void NetConsoleFilter::setFilter (const QString& filter)
+{
+    if (m_filter != filter) {
+        m_filter = filter;
+        emit filterChanged();
+        restart();
+    }
+}
+
+/**
+ * Changes the case sensitivity of the filter and searches all the lines
+ * again
+ */
+void NetConsoleFilter::setCaseSensitive (const bool caseSensitive)
+{
+    if (m_caseSensitive != caseSensitive) {
+        m_caseSensitive = caseSensitive;
+        emit filterChanged();
+        restart();
+    }
+}
+
+/**
+ * Removes the current matches and searches all the lines (results of the
+ * previous searches are discarded when they arrive)
+ */
+void NetConsoleFilter::restart()
+{
+    ++m_request;
+
+    beginResetModel();
+    m_matches.clear();
+    m_searched = m_model->firstLine();
+    endResetModel();
+
+    if (m_busy) {
+        m_busy = false;
+        emit busyChanged();
+    }
+
+    emit countChanged();
+    requestSearch();
+}
+
+/**
+ * Searches the lines that have not been searched yet, if a search is
+ * running, the new lines are searched when it finishes
+ */
+void NetConsoleFilter::requestSearch()
+{
+    if (m_filter.isEmpty() || m_busy)
+        return;
+
+    quint64 end = m_model->firstLine() + m_model->rowCount();
+    if (m_searched >= end)
+        return;
+
+    m_busy = true;
+    emit busyChanged();
+    emit searchRequested (m_request, m_model->lines(), m_model->firstLine(),
+                          m_searched, m_filter, m_regex, m_caseSensitive);
+}
+
+/**
+ * Removes the matches of the lines removed from the NetConsole model
+ */
+void NetConsoleFilter::onLinesRemoved()
+{
+    quint64 first = m_model->firstLine();
+    m_searched = qMax (m_searched, first);
+
+    int count = 0;
+    while (count < m_matches.count() && m_matches.at (count) < first)
+        ++count;
+
+    if (count > 0) {
+        beginRemoveRows (QModelIndex(), 0, count - 1);
+        m_matches.remove (0, count);
+        endRemoveRows();
+        emit countChanged();
+    }
+}
+
+/**
+ * Adds the lines found by the search thread (if they are still displayed)
+ * and searches the lines received during the search
+ */
+void NetConsoleFilter::onSearchFinished (const quint64 request,
+                                        const QVector<quint64>& matches,
+                                        const quint64 searched)
+{
+    if (request != m_request)
+        return;
+
+    /* Only add the lines that have not been removed */
+    QVector<quint64> lines;
+    quint64 first = m_model->firstLine();
+    for (int i = 0; i < matches.count(); ++i) {
+        if (matches.at (i) >= first)
+            lines.append (matches.at (i));
+    }
+
+    /* Add the matches with a single notification */
+    if (!lines.isEmpty()) {
+        int row = m_matches.count();
+        beginInsertRows (QModelIndex(), row, row + lines.count() - 1);
+        m_matches += lines;
+        endInsertRows();
+        emit countChanged();
+    }
+
+    m_busy = false;
+    m_searched = qMax (m_searched, searched);
+    emit busyChanged();
+
+    requestSearch();
+}
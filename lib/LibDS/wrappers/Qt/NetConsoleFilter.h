@@ -0,0 +1,157 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _NETCONSOLE_FILTER_H
+#define _NETCONSOLE_FILTER_H
+
+#include <QMap>
+#include <QThread>
+#include <QVector>
+#include <QBitArray>
+#include <QStringList>
+#include <QAbstractListModel>
+
+class NetConsoleModel;
+
+/**
+ * Searches the NetConsole lines in a background thread.
+ *
+ * The lines are split in blocks of consecutive lines, and the trigrams of
+ * each complete block are recorded in a bit set. A substring query only
+ * scans the blocks that contain all of its trigrams, so most of the lines
+ * are never compared. Regular expressions are matched against every line.
+ *
+ * The index is only accessed by the search thread, and the lines are
+ * received as implicitly shared snapshots, so no locks are needed.
+ */
+class NetConsoleSearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    NetConsoleSearch();
+
+public slots:
+    void search (const quint64 request,
+                 const QStringList& lines,
+                 const quint64 firstLine,
+                 const quint64 from,
+                 const QString& pattern,
+                 const bool regex,
+                 const bool caseSensitive);
+
+signals:
+    void finished (const quint64 request,
+                   const QVector<quint64>& matches,
+                   const quint64 searched);
+
+private:
+    void updateIndex (const QStringList& lines, const quint64 firstLine);
+
+private:
+    QMap<quint64, QBitArray> m_index;
+};
+
+/**
+ * Exposes the lines of the \c NetConsoleModel that match a substring or a
+ * regular expression. The matches are updated incrementally as new lines
+ * are received.
+ */
+class NetConsoleFilter : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY (int count
+                READ rowCount
+                NOTIFY countChanged)
+    Q_PROPERTY (bool busy
+                READ busy
+                NOTIFY busyChanged)
+    Q_PROPERTY (QString filter
+                READ filter
+                WRITE setFilter
+                NOTIFY filterChanged)
+    Q_PROPERTY (bool regex
+                READ regex
+                WRITE setRegex
+                NOTIFY filterChanged)
+    Q_PROPERTY (bool caseSensitive
+                READ caseSensitive
+                WRITE setCaseSensitive
+                NOTIFY filterChanged)
+
+public:
+    static NetConsoleFilter* getInstance();
+
+    bool busy() const;
+    bool regex() const;
+    QString filter() const;
+    bool caseSensitive() const;
+
+    QHash<int, QByteArray> roleNames() const;
+    QVariant data (const QModelIndex& index, int role) const;
+    int rowCount (const QModelIndex& parent = QModelIndex()) const;
+
+public slots:
+    void setRegex (const bool regex);
+    void setFilter (const QString& filter);
+    void setCaseSensitive (const bool caseSensitive);
+
+signals:
+    void busyChanged();
+    void countChanged();
+    void filterChanged();
+    void searchRequested (const quint64 request,
+                          const QStringList& lines,
+                          const quint64 firstLine,
+                          const quint64 from,
+                          const QString& pattern,
+                          const bool regex,
+                          const bool caseSensitive);
+
+private slots:
+    void restart();
+    void requestSearch();
+    void onLinesRemoved();
+    void onSearchFinished (const quint64 request,
+                           const QVector<quint64>& matches,
+                           const quint64 searched);
+
+private:
+    NetConsoleFilter();
+    ~NetConsoleFilter();
+
+private:
+    bool m_busy;
+    bool m_regex;
+    bool m_caseSensitive;
+
+    quint64 m_request;
+    quint64 m_searched;
+
+    QString m_filter;
+    QThread m_thread;
+    NetConsoleModel* m_model;
+    QVector<quint64> m_matches;
+};
+
+#endif
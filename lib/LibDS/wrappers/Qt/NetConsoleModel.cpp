@@ -0,0 +1,313 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "NetConsoleModel.h"
+#include "DriverStation.h"
+
+#include <QDateTime>
+#include <QClipboard>
+#include <QGuiApplication>
+
+/*
+ * Default maximum number of lines, and time (in milliseconds) between two
+ * insertions of new lines (about one frame at 60 Hz)
+ */
+#define DEFAULT_MAX_LINES 100000
+#define FLUSH_INTERVAL    16
+
+/**
+ * Receives the NetConsole output of the \c DriverStation in batches
+ */
+NetConsoleModel::NetConsoleModel()
+{
+    m_firstLine = 0;
+    m_maximumLines = DEFAULT_MAX_LINES;
+
+    m_flushTimer.setSingleShot (true);
+    m_flushTimer.setInterval (FLUSH_INTERVAL);
+    m_flushTimer.setTimerType (Qt::PreciseTimer);
+
+    connect (&m_flushTimer, SIGNAL (timeout()),
+             this,            SLOT (flush()));
+    connect (DriverStation::getInstance(),
+             SIGNAL (newEntries (QVector<NetConsoleEntry>)),
+             this, SLOT (appendEntries (QVector<NetConsoleEntry>)));
+}
+
+/**
+ * Returns the only instance of the class
+ */
+NetConsoleModel* NetConsoleModel::getInstance()
+{
+    static NetConsoleModel instance;
+    return &instance;
+}
+
+/**
+ * Returns the maximum number of lines held by the model
+ */
+int NetConsoleModel::maximumLines() const
+{
+    return m_maximumLines;
+}
+
+/**
+ * Returns the number of the line displayed in the first row, line numbers
+ * keep growing when the oldest lines are removed
+ */
+quint64 NetConsoleModel::firstLine() const
+{
+    return m_firstLine;
+}
+
+/**
+ * Returns the lines held by the model (the list is implicitly shared, so
+ * obtaining it does not copy the lines)
+ */
+QStringList NetConsoleModel::lines() const
+{
+    return m_lines;
+}
+
+/**
+ * Returns the role names used by QML delegates
+ */
+QHash<int, QByteArray> NetConsoleModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles [Qt::DisplayRole] = "display";
+    roles [TextRole] = "text";
+    roles [SourceRole] = "source";
+    roles [SeverityRole] = "severity";
+    roles [TimeRole] = "time";
+    return roles;
+}
+
+/**
+ * Returns the text or the attributes of the line at the given \a index, the
+ * display role is the text as it is copied (see \c plainText())
+ */
+QVariant NetConsoleModel::data (const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_lines.count())
+        return QVariant();
+
+    const LineInfo& info = m_info.at (index.row());
+
+    switch (role) {
+    case Qt::DisplayRole:
+        return entry (index.row()).toPlainText();
+    case TextRole:
+        return m_lines.at (index.row());
+    case SourceRole:
+        return (int) info.source;
+    case SeverityRole:
+        return (int) info.severity;
+    case TimeRole:
+        return QDateTime::fromMSecsSinceEpoch (info.time);
+    default:
+        return QVariant();
+    }
+}
+
+/**
+ * Returns the number of lines held by the model
+ */
+int NetConsoleModel::rowCount (const QModelIndex& parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return m_lines.count();
+}
+
+/**
+ * Returns all the lines as plain text, the lines that were not printed by
+ * the robot are prefixed with "**"
+ */
+QString NetConsoleModel::plainText() const
+{
+    QStringList lines;
+    lines.reserve (m_lines.count());
+    for (int i = 0; i < m_lines.count(); ++i)
+        lines.append (entry (i).toPlainText());
+
+    return lines.join ("\n");
+}
+
+/**
+ * Copies the NetConsole output to the clipboard
+ */
+void NetConsoleModel::copy()
+{
+    QClipboard* clipboard = QGuiApplication::clipboard();
+    if (clipboard)
+        clipboard->setText (plainText());
+}
+
+/**
+ * Removes all the lines (including the ones waiting to be inserted)
+ */
+void NetConsoleModel::clear()
+{
+    m_pending.clear();
+    m_flushTimer.stop();
+
+    if (!m_lines.isEmpty()) {
+        beginResetModel();
+        m_firstLine += m_lines.count();
+        m_lines.clear();
+        m_info.clear();
+        endResetModel();
+        emit countChanged();
+    }
+}
+
+/**
+ * Adds a local \a message (e.g. a notification of the UI), which is
+ * displayed as a line of the application
+ */
+void NetConsoleModel::append (const QString& message)
+{
+    appendLines (QStringList (message));
+}
+
+/**
+ * Changes the maximum number of \a lines held by the model, the oldest
+ * lines are removed if needed
+ */
+void NetConsoleModel::setMaximumLines (const int lines)
+{
+    if (lines > 0 && lines != m_maximumLines) {
+        m_maximumLines = lines;
+
+        if (m_lines.count() > m_maximumLines) {
+            removeOldestLines (m_lines.count() - m_maximumLines);
+            emit countChanged();
+        }
+
+        emit maximumLinesChanged();
+    }
+}
+
+/**
+ * Queues the given local \a lines (see \c append()), they are inserted
+ * into the model with the next batch
+ */
+void NetConsoleModel::appendLines (const QStringList& lines)
+{
+    QVector<NetConsoleEntry> entries;
+    entries.reserve (lines.count());
+
+    NetConsoleEntry entry;
+    entry.source = DS_NETCONSOLE_SOURCE_APPLICATION;
+    entry.time = QDateTime::currentMSecsSinceEpoch();
+    foreach (const QString& line, lines) {
+        entry.text = line;
+        entries.append (entry);
+    }
+
+    appendEntries (entries);
+}
+
+/**
+ * Queues the given \a entries, they are inserted into the model with the
+ * next batch
+ */
+void NetConsoleModel::appendEntries (const QVector<NetConsoleEntry>& entries)
+{
+    if (entries.isEmpty())
+        return;
+
+    m_pending += entries;
+
+    /* Do not keep pending lines that would be removed anyway */
+    if (m_pending.count() > m_maximumLines)
+        m_pending.erase (m_pending.begin(),
+                         m_pending.begin() + m_pending.count() - m_maximumLines);
+
+    if (!m_flushTimer.isActive())
+        m_flushTimer.start();
+}
+
+/**
+ * Inserts the pending lines with a single \c rowsInserted() notification
+ */
+void NetConsoleModel::flush()
+{
+    if (m_pending.isEmpty())
+        return;
+
+    /* Make room for the new lines */
+    int overflow = m_lines.count() + m_pending.count() - m_maximumLines;
+    if (overflow > 0)
+        removeOldestLines (overflow);
+
+    /* Insert the new lines */
+    int first = m_lines.count();
+    beginInsertRows (QModelIndex(), first, first + m_pending.count() - 1);
+    m_lines.reserve (first + m_pending.count());
+    m_info.reserve (first + m_pending.count());
+    foreach (const NetConsoleEntry& entry, m_pending) {
+        LineInfo info;
+        info.source = (qint8) entry.source;
+        info.severity = (qint8) entry.severity;
+        info.time = entry.time;
+
+        m_lines.append (entry.text);
+        m_info.append (info);
+    }
+    m_pending.clear();
+    endInsertRows();
+
+    emit countChanged();
+}
+
+/**
+ * Removes the given \a count of lines from the start of the model
+ */
+void NetConsoleModel::removeOldestLines (const int count)
+{
+    int lines = qMin (count, m_lines.count());
+    if (lines <= 0)
+        return;
+
+    beginRemoveRows (QModelIndex(), 0, lines - 1);
+    m_lines.erase (m_lines.begin(), m_lines.begin() + lines);
+    m_info.erase (m_info.begin(), m_info.begin() + lines);
+    m_firstLine += lines;
+    endRemoveRows();
+}
+
+/**
+ * Returns the line at the given \a row along with its attributes
+ */
+NetConsoleEntry NetConsoleModel::entry (const int row) const
+{
+    NetConsoleEntry entry;
+    entry.text = m_lines.at (row);
+    entry.source = m_info.at (row).source;
+    entry.severity = m_info.at (row).severity;
+    entry.time = m_info.at (row).time;
+    return entry;
+}
@@ -0,0 +1,113 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _NETCONSOLE_MODEL_H
+#define _NETCONSOLE_MODEL_H
+
+#include <QTimer>
+#include <QVector>
+#include <QStringList>
+#include <QAbstractListModel>
+
+#include "NetConsoleEntry.h"
+
+/**
+ * Exposes the NetConsole output to QML as a list model (one row per line),
+ * so that views only need to create delegates for the visible lines. The
+ * lines are plain text, their source, severity and time are exposed as
+ * separate roles so that delegates can style them.
+ *
+ * New lines are inserted in batches (at most once per frame) and the
+ * oldest lines are removed when the model holds more than
+ * \c maximumLines lines.
+ */
+class NetConsoleModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY (int count
+                READ rowCount
+                NOTIFY countChanged)
+    Q_PROPERTY (int maximumLines
+                READ maximumLines
+                WRITE setMaximumLines
+                NOTIFY maximumLinesChanged)
+
+public:
+    enum Roles {
+        TextRole = Qt::UserRole + 1,
+        SourceRole,
+        SeverityRole,
+        TimeRole,
+    };
+
+    static NetConsoleModel* getInstance();
+
+    int maximumLines() const;
+    quint64 firstLine() const;
+    QStringList lines() const;
+    QHash<int, QByteArray> roleNames() const;
+    QVariant data (const QModelIndex& index, int role) const;
+    int rowCount (const QModelIndex& parent = QModelIndex()) const;
+
+    Q_INVOKABLE QString plainText() const;
+
+public slots:
+    void copy();
+    void clear();
+    void append (const QString& message);
+    void setMaximumLines (const int lines);
+    void appendLines (const QStringList& lines);
+    void appendEntries (const QVector<NetConsoleEntry>& entries);
+
+signals:
+    void countChanged();
+    void maximumLinesChanged();
+
+private slots:
+    void flush();
+
+private:
+    NetConsoleModel();
+    NetConsoleEntry entry (const int row) const;
+    void removeOldestLines (const int count);
+
+private:
+    /*
+     * Attributes of a line, kept apart from the text so that the search
+     * thread receives the lines as a plain string list
+     */
+    struct LineInfo {
+        qint8 source;
+        qint8 severity;
+        qint64 time;
+    };
+
+    int m_maximumLines;
+    quint64 m_firstLine;
+    QTimer m_flushTimer;
+    QStringList m_lines;
+    QVector<LineInfo> m_info;
+    QVector<NetConsoleEntry> m_pending;
+};
+
+#endif
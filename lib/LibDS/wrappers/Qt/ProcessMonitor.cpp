@@ -0,0 +1,568 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include "ProcessMonitor.h"
+
+#include <LibDS.h>
+
+#include <QtAlgorithms>
+
+#if defined Q_OS_WIN
+    /* Querying the times of the other threads needs Windows Vista */
+    #if !defined _WIN32_WINNT || _WIN32_WINNT < 0x0600
+        #undef  _WIN32_WINNT
+        #define _WIN32_WINNT 0x0600
+    #endif
+
+    #include <windows.h>
+    #include <psapi.h>
+    #include <tlhelp32.h>
+#else
+    #include <stdio.h>
+    #include <string.h>
+    #include <unistd.h>
+    #include <sys/resource.h>
+#endif
+
+#if defined Q_OS_LINUX
+    #include <dirent.h>
+#elif defined Q_OS_MAC
+    #include <mach/mach.h>
+#endif
+
+/*
+ * Interval (in msecs) of the timer used to measure the event loop lag
+ */
+#define LAG_TIMER_INTERVAL 100
+
+/**
+ * CPU time (in nsecs) used by a thread of the process
+ */
+typedef struct {
+    quint64 id;
+    QString name;
+    quint64 cpu;
+} ThreadUsage;
+
+/**
+ * Resources used by the process, values that cannot be obtained on the
+ * current OS are left at \c -1
+ */
+typedef struct {
+    qint64 cpu;
+    qint64 rss;
+    qint64 switches;
+    QList<ThreadUsage> threads;
+} ProcessUsage;
+
+#if !defined Q_OS_WIN
+/**
+ * Reads the CPU time and the context switches of the whole process
+ */
+static void readRusage (ProcessUsage* usage)
+{
+    struct rusage ru;
+    if (getrusage (RUSAGE_SELF, &ru) != 0)
+        return;
+
+    usage->cpu = (qint64) (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000
+                 + (qint64) (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000;
+    usage->switches = (qint64) (ru.ru_nvcsw + ru.ru_nivcsw);
+}
+#endif
+
+#if defined Q_OS_LINUX
+/**
+ * Reads the name and CPU time of each thread (task) of the process, and the
+ * resident memory of the process from the proc filesystem
+ */
+static void readProcess (ProcessUsage* usage)
+{
+    readRusage (usage);
+
+    const long ticks = sysconf (_SC_CLK_TCK);
+    const long page = sysconf (_SC_PAGESIZE);
+
+    /* Resident pages are the second field of statm */
+    FILE* file = fopen ("/proc/self/statm", "r");
+    if (file) {
+        unsigned long long size = 0, resident = 0;
+        if (fscanf (file, "%llu %llu", &size, &resident) == 2)
+            usage->rss = (qint64) resident * page;
+
+        fclose (file);
+    }
+
+    DIR* dir = opendir ("/proc/self/task");
+    if (!dir || ticks <= 0) {
+        if (dir)
+            closedir (dir);
+
+        return;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir (dir)) != NULL) {
+        if (entry->d_name [0] == '.')
+            continue;
+
+        char path [sizeof ("/proc/self/task//stat") + sizeof (entry->d_name)];
+        char stat [512];
+        snprintf (path, sizeof (path), "/proc/self/task/%s/stat", entry->d_name);
+
+        file = fopen (path, "r");
+        if (!file)
+            continue;
+
+        size_t len = fread (stat, 1, sizeof (stat) - 1, file);
+        stat [len] = '\0';
+        fclose (file);
+
+        /* The name is between parentheses (and may contain them) */
+        char* open = strchr (stat, '(');
+        char* close = strrchr (stat, ')');
+        if (!open || !close || close < open || close [1] == '\0')
+            continue;
+
+        /* User and system times are the 14th and 15th fields */
+        unsigned long long utime = 0, stime = 0;
+        if (sscanf (close + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u "
+                    "%llu %llu", &utime, &stime) != 2)
+            continue;
+
+        ThreadUsage thread;
+        thread.id = QByteArray (entry->d_name).toULongLong();
+        thread.name = QString::fromLocal8Bit (open + 1, (int) (close - open - 1));
+        thread.cpu = (utime + stime) * 1000000000ULL / (quint64) ticks;
+        usage->threads.append (thread);
+    }
+
+    closedir (dir);
+}
+#elif defined Q_OS_MAC
+/**
+ * Reads the name and CPU time of each Mach thread of the task, and the
+ * resident memory of the task
+ */
+static void readProcess (ProcessUsage* usage)
+{
+    readRusage (usage);
+
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info (mach_task_self(), MACH_TASK_BASIC_INFO,
+                   (task_info_t) &info, &count) == KERN_SUCCESS)
+        usage->rss = (qint64) info.resident_size;
+
+    thread_act_array_t list;
+    mach_msg_type_number_t threads = 0;
+    if (task_threads (mach_task_self(), &list, &threads) != KERN_SUCCESS)
+        return;
+
+    for (mach_msg_type_number_t i = 0; i < threads; ++i) {
+        thread_basic_info_data_t basic;
+        thread_extended_info_data_t extended;
+        thread_identifier_info_data_t identifier;
+
+        count = THREAD_BASIC_INFO_COUNT;
+        if (thread_info (list [i], THREAD_BASIC_INFO,
+                         (thread_info_t) &basic, &count) == KERN_SUCCESS) {
+            ThreadUsage thread;
+            thread.id = list [i];
+            thread.cpu = (quint64) (basic.user_time.seconds +
+                                    basic.system_time.seconds) * 1000000000ULL
+                         + (quint64) (basic.user_time.microseconds +
+                                      basic.system_time.microseconds) * 1000ULL;
+
+            count = THREAD_IDENTIFIER_INFO_COUNT;
+            if (thread_info (list [i], THREAD_IDENTIFIER_INFO,
+                             (thread_info_t) &identifier, &count) == KERN_SUCCESS)
+                thread.id = identifier.thread_id;
+
+            count = THREAD_EXTENDED_INFO_COUNT;
+            if (thread_info (list [i], THREAD_EXTENDED_INFO,
+                             (thread_info_t) &extended, &count) == KERN_SUCCESS)
+                thread.name = QString::fromUtf8 (extended.pth_name);
+
+            usage->threads.append (thread);
+        }
+
+        mach_port_deallocate (mach_task_self(), list [i]);
+    }
+
+    vm_deallocate (mach_task_self(), (vm_address_t) list,
+                   threads * sizeof (thread_act_t));
+}
+#elif defined Q_OS_WIN
+/**
+ * Converts a \c FILETIME duration (in 100 nsecs units) to nsecs
+ */
+static quint64 fileTimeNs (const FILETIME& time)
+{
+    ULARGE_INTEGER value;
+    value.LowPart = time.dwLowDateTime;
+    value.HighPart = time.dwHighDateTime;
+    return value.QuadPart * 100;
+}
+
+/**
+ * Reads the CPU time of the process and of each of its threads, and the
+ * working set of the process. The context switches are not available.
+ */
+static void readProcess (ProcessUsage* usage)
+{
+    FILETIME creation, exit, kernel, user;
+    if (GetProcessTimes (GetCurrentProcess(), &creation, &exit, &kernel, &user))
+        usage->cpu = (qint64) (fileTimeNs (kernel) + fileTimeNs (user));
+
+    PROCESS_MEMORY_COUNTERS memory;
+    if (GetProcessMemoryInfo (GetCurrentProcess(), &memory, sizeof (memory)))
+        usage->rss = (qint64) memory.WorkingSetSize;
+
+    HANDLE snapshot = CreateToolhelp32Snapshot (TH32CS_SNAPTHREAD, 0);
+    if (snapshot == INVALID_HANDLE_VALUE)
+        return;
+
+    THREADENTRY32 entry;
+    entry.dwSize = sizeof (entry);
+    const DWORD pid = GetCurrentProcessId();
+    for (BOOL ok = Thread32First (snapshot, &entry); ok;
+            ok = Thread32Next (snapshot, &entry)) {
+        if (entry.th32OwnerProcessID != pid)
+            continue;
+
+        HANDLE handle = OpenThread (THREAD_QUERY_LIMITED_INFORMATION, FALSE,
+                                    entry.th32ThreadID);
+        if (!handle)
+            continue;
+
+        if (GetThreadTimes (handle, &creation, &exit, &kernel, &user)) {
+            ThreadUsage thread;
+            thread.id = entry.th32ThreadID;
+            thread.name = QString ("Thread %1").arg (entry.th32ThreadID);
+            thread.cpu = fileTimeNs (kernel) + fileTimeNs (user);
+            usage->threads.append (thread);
+        }
+
+        CloseHandle (handle);
+    }
+
+    CloseHandle (snapshot);
+}
+#else
+/**
+ * Only the CPU time and context switches of the process are available
+ */
+static void readProcess (ProcessUsage* usage)
+{
+    readRusage (usage);
+}
+#endif
+
+/*
+ * Maximum number of LibDS threads whose names are read in each sample
+ */
+#define MAX_LIBDS_THREADS 32
+
+/**
+ * Gives the threads started by the LibDS the name registered with
+ * \c DS_CreateThread(), so that they can be told apart on systems that do
+ * not report the thread names (e.g. Windows)
+ */
+static void nameLibDSThreads (ProcessUsage* usage)
+{
+    DS_ThreadInfo list [MAX_LIBDS_THREADS];
+    const int count = qMin (DS_GetThreads (list, MAX_LIBDS_THREADS),
+                            MAX_LIBDS_THREADS);
+
+    for (int i = 0; i < usage->threads.count(); ++i) {
+        for (int j = 0; j < count; ++j) {
+            if (usage->threads [i].id == list [j].id) {
+                usage->threads [i].name = QString::fromUtf8 (list [j].name);
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Returns \c true if the \a first thread used more CPU than the \a second
+ */
+static bool busier (const QVariant& first, const QVariant& second)
+{
+    return first.toMap().value ("cpu").toDouble() >
+           second.toMap().value ("cpu").toDouble();
+}
+
+/**
+ * Initializes the sampler, the timer is created by \c start() on the
+ * thread of the sampler
+ */
+DSProcessSampler::DSProcessSampler() :
+    m_timer (nullptr),
+    m_lastTime (0),
+    m_lastCpu (0),
+    m_lastSwitches (0)
+{
+}
+
+/**
+ * Takes the first sample and samples the process every
+ * \c PROCESS_SAMPLE_INTERVAL msecs
+ */
+void DSProcessSampler::start()
+{
+    m_clock.start();
+    sample();
+
+    m_timer = new QTimer (this);
+    m_timer->setTimerType (Qt::CoarseTimer);
+    connect (m_timer, SIGNAL (timeout()), this, SLOT (sample()));
+    m_timer->start (PROCESS_SAMPLE_INTERVAL);
+}
+
+/**
+ * Reads the resources used by the process and emits their usage since the
+ * previous sample (the first sample only sets the reference values)
+ */
+void DSProcessSampler::sample()
+{
+    ProcessUsage usage;
+    usage.cpu = -1;
+    usage.rss = -1;
+    usage.switches = -1;
+    readProcess (&usage);
+    nameLibDSThreads (&usage);
+
+    const qint64 now = m_clock.nsecsElapsed();
+    const qint64 elapsed = now - m_lastTime;
+    const bool first = (m_lastTime == 0);
+
+    QVariantMap sample;
+    QVariantList threads;
+    QHash<quint64, quint64> lastThreads;
+
+    /* CPU usage of each thread that existed in the previous sample */
+    foreach (const ThreadUsage& thread, usage.threads) {
+        lastThreads.insert (thread.id, thread.cpu);
+        if (first || !m_lastThreads.contains (thread.id))
+            continue;
+
+        const quint64 cpu = thread.cpu - qMin (thread.cpu, m_lastThreads.value (thread.id));
+        QVariantMap map;
+        map.insert ("id", thread.id);
+        map.insert ("name", thread.name);
+        map.insert ("cpu", cpu * 100.0 / elapsed);
+        threads.append (map);
+    }
+
+    qSort (threads.begin(), threads.end(), busier);
+    while (threads.count() > PROCESS_MAX_THREADS)
+        threads.removeLast();
+
+    sample.insert ("threads", threads);
+    sample.insert ("rss", usage.rss >= 0 ? usage.rss / (1024.0 * 1024.0) : -1.0);
+    sample.insert ("cpu", -1.0);
+    sample.insert ("switches", -1);
+
+    if (!first && elapsed > 0) {
+        if (usage.cpu >= 0)
+            sample.insert ("cpu", ((quint64) usage.cpu - m_lastCpu) * 100.0 / elapsed);
+        if (usage.switches >= 0)
+            sample.insert ("switches", qRound (((quint64) usage.switches - m_lastSwitches)
+                                               * 1e9 / elapsed));
+    }
+
+    m_lastTime = now;
+    m_lastCpu = (quint64) qMax<qint64> (0, usage.cpu);
+    m_lastSwitches = (quint64) qMax<qint64> (0, usage.switches);
+    m_lastThreads = lastThreads;
+
+    if (!first)
+        emit sampled (sample);
+}
+
+/**
+ * Starts the sampler thread and the event loop lag timer
+ */
+DSProcessMonitor::DSProcessMonitor() :
+    m_sampler (new DSProcessSampler),
+    m_frameStart (-1),
+    m_frameSum (0),
+    m_frameMax (0),
+    m_frameCount (0),
+    m_lagMax (0),
+    m_frameTime (0),
+    m_maxFrameTime (0),
+    m_eventLoopLag (0)
+{
+    m_sampler->moveToThread (&m_thread);
+    connect (&m_thread, SIGNAL (started()), m_sampler, SLOT (start()));
+    connect (&m_thread, SIGNAL (finished()), m_sampler, SLOT (deleteLater()));
+    connect (m_sampler, SIGNAL (sampled (QVariantMap)),
+             this,        SLOT (onSampled (QVariantMap)));
+    m_thread.start (QThread::LowPriority);
+
+    m_frameClock.start();
+    m_lagClock.start();
+    m_lagTimer.setTimerType (Qt::PreciseTimer);
+    connect (&m_lagTimer, SIGNAL (timeout()), this, SLOT (checkEventLoop()));
+    m_lagTimer.start (LAG_TIMER_INTERVAL);
+}
+
+/**
+ * Stops the sampler thread
+ */
+DSProcessMonitor::~DSProcessMonitor()
+{
+    m_thread.quit();
+    m_thread.wait();
+}
+
+/**
+ * Returns the only instance of the class
+ */
+DSProcessMonitor* DSProcessMonitor::getInstance()
+{
+    static DSProcessMonitor instance;
+    return &instance;
+}
+
+/**
+ * Returns the CPU usage of the process during the last second (100% is a
+ * whole core), or \c -1 if it is unknown
+ */
+qreal DSProcessMonitor::cpuUsage() const
+{
+    return m_sample.value ("cpu", -1).toReal();
+}
+
+/**
+ * Returns the resident memory of the process (in MB), or \c -1 if it is
+ * unknown
+ */
+qreal DSProcessMonitor::residentMemory() const
+{
+    return m_sample.value ("rss", -1).toReal();
+}
+
+/**
+ * Returns the context switches per second of the process, or \c -1 if
+ * they are unknown
+ */
+int DSProcessMonitor::contextSwitches() const
+{
+    return m_sample.value ("switches", -1).toInt();
+}
+
+/**
+ * Returns the average frame time (in msecs) during the last second
+ */
+qreal DSProcessMonitor::frameTime() const
+{
+    return m_frameTime;
+}
+
+/**
+ * Returns the longest frame time (in msecs) during the last second
+ */
+qreal DSProcessMonitor::maxFrameTime() const
+{
+    return m_maxFrameTime;
+}
+
+/**
+ * Returns the largest delay (in msecs) of the GUI thread during the last
+ * second
+ */
+qreal DSProcessMonitor::eventLoopLag() const
+{
+    return m_eventLoopLag;
+}
+
+/**
+ * Returns the busiest threads of the process during the last second, each
+ * one as a map with its \c id, \c name and \c cpu usage
+ */
+QVariantList DSProcessMonitor::threads() const
+{
+    return m_sample.value ("threads").toList();
+}
+
+/**
+ * Marks the beginning of a frame
+ *
+ * \note This function is called from the render thread
+ */
+void DSProcessMonitor::onFrameStarted()
+{
+    QMutexLocker locker (&m_frameMutex);
+    m_frameStart = m_frameClock.nsecsElapsed();
+}
+
+/**
+ * Adds the time elapsed since the beginning of the frame to the frame times
+ *
+ * \note This function is called from the render thread
+ */
+void DSProcessMonitor::onFrameRendered()
+{
+    QMutexLocker locker (&m_frameMutex);
+
+    if (m_frameStart >= 0) {
+        const qint64 time = m_frameClock.nsecsElapsed() - m_frameStart;
+        m_frameSum += time;
+        m_frameMax = qMax (m_frameMax, time);
+        m_frameStart = -1;
+        ++m_frameCount;
+    }
+}
+
+/**
+ * Measures how late the lag timer was triggered
+ */
+void DSProcessMonitor::checkEventLoop()
+{
+    const qint64 lag = m_lagClock.restart() - LAG_TIMER_INTERVAL;
+    m_lagMax = qMax (m_lagMax, lag);
+}
+
+/**
+ * Publishes the new process \a sample along with the frame times and the
+ * event loop lag of the last second
+ */
+void DSProcessMonitor::onSampled (const QVariantMap& sample)
+{
+    m_sample = sample;
+
+    m_frameMutex.lock();
+    m_frameTime = m_frameCount > 0 ? m_frameSum / 1e6 / m_frameCount : 0;
+    m_maxFrameTime = m_frameMax / 1e6;
+    m_frameSum = 0;
+    m_frameMax = 0;
+    m_frameCount = 0;
+    m_frameMutex.unlock();
+
+    m_eventLoopLag = m_lagMax;
+    m_lagMax = 0;
+
+    emit sampled();
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _DS_PROCESS_MONITOR_H
+#define _DS_PROCESS_MONITOR_H
+
+#include <QHash>
+#include <QMutex>
+#include <QTimer>
+#include <QThread>
+#include <QObject>
+#include <QVariantList>
+#include <QElapsedTimer>
+
+/*
+ * Interval (in msecs) between two samples of the process resources, and
+ * number of threads reported (the busiest ones)
+ */
+#define PROCESS_SAMPLE_INTERVAL 1000
+#define PROCESS_MAX_THREADS     5
+
+/**
+ * Reads the resource usage of the DS process from the OS, it lives on the
+ * thread of the \c DSProcessMonitor so that the OS calls (which read many
+ * files on Linux) never block the GUI thread
+ */
+class DSProcessSampler : public QObject
+{
+    Q_OBJECT
+
+public:
+    DSProcessSampler();
+
+public slots:
+    void start();
+    void sample();
+
+signals:
+    void sampled (const QVariantMap& sample);
+
+private:
+    QTimer* m_timer;
+    QElapsedTimer m_clock;
+    qint64 m_lastTime;
+    quint64 m_lastCpu;
+    quint64 m_lastSwitches;
+    QHash<quint64, quint64> m_lastThreads;
+};
+
+/**
+ * Samples the CPU usage (of the process and of each thread), the resident
+ * memory and the context switches of the DS process about once per second,
+ * along with the frame times of the GUI. This tells whether the DS itself
+ * (e.g. a busy GUI thread) or the network is the cause of a stutter.
+ *
+ * The frame time is the time spent by the render thread to synchronize and
+ * render a frame (without waiting for the vertical sync), it is measured by
+ * connecting the \c beforeSynchronizing() and \c afterRendering() signals
+ * of the window to \c onFrameStarted() and \c onFrameRendered() with direct
+ * connections. The event loop lag is the largest delay of a GUI thread
+ * timer, a busy GUI thread delays the DS signals and the joystick widgets.
+ */
+class DSProcessMonitor : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY (qreal cpuUsage
+                READ cpuUsage
+                NOTIFY sampled)
+    Q_PROPERTY (qreal residentMemory
+                READ residentMemory
+                NOTIFY sampled)
+    Q_PROPERTY (int contextSwitches
+                READ contextSwitches
+                NOTIFY sampled)
+    Q_PROPERTY (qreal frameTime
+                READ frameTime
+                NOTIFY sampled)
+    Q_PROPERTY (qreal maxFrameTime
+                READ maxFrameTime
+                NOTIFY sampled)
+    Q_PROPERTY (qreal eventLoopLag
+                READ eventLoopLag
+                NOTIFY sampled)
+    Q_PROPERTY (QVariantList threads
+                READ threads
+                NOTIFY sampled)
+
+public:
+    static DSProcessMonitor* getInstance();
+
+    qreal cpuUsage() const;
+    qreal residentMemory() const;
+    int contextSwitches() const;
+    qreal frameTime() const;
+    qreal maxFrameTime() const;
+    qreal eventLoopLag() const;
+    QVariantList threads() const;
+
+public slots:
+    void onFrameStarted();
+    void onFrameRendered();
+
+signals:
+    void sampled();
+
+private slots:
+    void checkEventLoop();
+    void onSampled (const QVariantMap& sample);
+
+private:
+    DSProcessMonitor();
+    ~DSProcessMonitor();
+
+private:
+    QThread m_thread;
+    DSProcessSampler* m_sampler;
+    QVariantMap m_sample;
+
+    /* Frame times since the last sample (written by the render thread) */
+    QMutex m_frameMutex;
+    QElapsedTimer m_frameClock;
+    qint64 m_frameStart;
+    qint64 m_frameSum;
+    qint64 m_frameMax;
+    int m_frameCount;
+
+    /* Delay of the GUI thread timer since the last sample */
+    QTimer m_lagTimer;
+    QElapsedTimer m_lagClock;
+    qint64 m_lagMax;
+
+    qreal m_frameTime;
+    qreal m_maxFrameTime;
+    qreal m_eventLoopLag;
+};
+
+#endif
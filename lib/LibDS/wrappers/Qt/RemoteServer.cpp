@@ -0,0 +1,599 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "RemoteServer.h"
+#include "DriverStation.h"
+
+#include <QUrl>
+#include <QTimer>
+#include <QDebug>
+#include <QUrlQuery>
+#include <QJsonArray>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QJsonDocument>
+#include <QCryptographicHash>
+
+#define LOG qDebug() << "DS Remote:"
+
+/*
+ * Appended to the key of the client to obtain the accept key (RFC 6455)
+ */
+#define WEBSOCKET_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+/**
+ * The server and its timer are created by \c listen(), in the server thread
+ */
+DSRemoteWorker::DSRemoteWorker() :
+    m_seq (0),
+    m_keySeq (-1),
+    m_timer (NULL),
+    m_server (NULL)
+{
+}
+
+/**
+ * Disconnects the clients and stops the server
+ */
+DSRemoteWorker::~DSRemoteWorker()
+{
+    close();
+}
+
+/**
+ * Starts listening for WebSocket clients on the given \a port
+ */
+void DSRemoteWorker::listen (const quint16 port)
+{
+    close();
+
+    m_server = new QTcpServer (this);
+    connect (m_server, SIGNAL (newConnection()),
+             this,     SLOT (acceptClients()));
+
+    if (!m_server->listen (QHostAddress::Any, port)) {
+        qWarning() << "DS Remote: cannot listen on port" << port
+                   << m_server->errorString();
+        delete m_server;
+        m_server = NULL;
+        return;
+    }
+
+    if (!m_timer) {
+        m_timer = new QTimer (this);
+        m_timer->setInterval (REMOTE_MIN_INTERVAL);
+        connect (m_timer, SIGNAL (timeout()),
+                 this,    SLOT (sendPendingFrames()));
+    }
+
+    LOG << "Listening on port" << port;
+}
+
+/**
+ * Disconnects the clients and stops listening
+ */
+void DSRemoteWorker::close()
+{
+    if (m_timer)
+        m_timer->stop();
+
+    foreach (Client* client, m_clients) {
+        client->socket->disconnect (this);
+        client->socket->abort();
+        client->socket->deleteLater();
+        delete client;
+    }
+
+    if (!m_clients.isEmpty()) {
+        m_clients.clear();
+        emit clientCountChanged (0);
+    }
+
+    m_console.clear();
+
+    if (m_server) {
+        m_server->close();
+        m_server->deleteLater();
+        m_server = NULL;
+    }
+}
+
+/**
+ * Serializes the differences between the given \a frame and the previous
+ * one and sends them to the clients that are up to date and whose update
+ * interval has elapsed, the other clients are updated later
+ */
+void DSRemoteWorker::publishFrame (const DriverStationFrame& frame)
+{
+    QJsonObject state = toJson (frame);
+    QJsonObject delta;
+
+    for (QJsonObject::const_iterator i = state.begin(); i != state.end(); ++i) {
+        if (m_state.value (i.key()) != i.value())
+            delta.insert (i.key(), i.value());
+    }
+
+    if (delta.isEmpty())
+        return;
+
+    m_state = state;
+    ++m_seq;
+
+    /* Serialize the delta once, the key frame is serialized on demand */
+    QJsonObject message;
+    message.insert ("seq", m_seq);
+    message.insert ("key", false);
+    message.insert ("state", delta);
+    m_delta = encode (QJsonDocument (message).toJson (QJsonDocument::Compact));
+
+    foreach (Client* client, m_clients) {
+        if (!client->upgraded)
+            continue;
+
+        if (canSend (client))
+            sendFrame (client);
+        else
+            client->pending = true;
+    }
+}
+
+/**
+ * Queues the given NetConsole \a message, which is sent to the clients
+ * with the next batch
+ */
+void DSRemoteWorker::publishMessage (const QString& message)
+{
+    if (!m_clients.isEmpty())
+        m_console.append (message);
+}
+
+/**
+ * Accepts the new connections (up to \c REMOTE_MAX_CLIENTS clients), the
+ * clients must complete the WebSocket handshake before receiving updates
+ */
+void DSRemoteWorker::acceptClients()
+{
+    while (m_server && m_server->hasPendingConnections()) {
+        QTcpSocket* socket = m_server->nextPendingConnection();
+
+        if (m_clients.count() >= REMOTE_MAX_CLIENTS) {
+            socket->abort();
+            socket->deleteLater();
+            continue;
+        }
+
+        Client* client = new Client;
+        client->socket = socket;
+        client->upgraded = false;
+        client->pending = false;
+        client->lastSeq = -1;
+        client->interval = REMOTE_DEFAULT_INTERVAL;
+
+        socket->setSocketOption (QAbstractSocket::LowDelayOption, 1);
+        connect (socket, SIGNAL (readyRead()),    this, SLOT (readClient()));
+        connect (socket, SIGNAL (disconnected()), this, SLOT (removeClient()));
+
+        m_clients.append (client);
+        m_timer->start();
+        emit clientCountChanged (m_clients.count());
+    }
+}
+
+/**
+ * Reads the handshake request or the frames sent by a client
+ */
+void DSRemoteWorker::readClient()
+{
+    Client* client = find (qobject_cast<QTcpSocket*> (sender()));
+    if (!client)
+        return;
+
+    client->request.append (client->socket->readAll());
+    if (client->request.size() > REMOTE_MAX_REQUEST) {
+        client->socket->abort();
+        return;
+    }
+
+    if (!client->upgraded) {
+        if (client->request.contains ("\r\n\r\n"))
+            handshake (client);
+    }
+
+    else
+        readFrames (client);
+}
+
+/**
+ * Forgets a client that has disconnected
+ */
+void DSRemoteWorker::removeClient()
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*> (sender());
+    Client* client = find (socket);
+    if (!client)
+        return;
+
+    m_clients.removeOne (client);
+    socket->deleteLater();
+    delete client;
+
+    if (m_clients.isEmpty()) {
+        m_timer->stop();
+        m_console.clear();
+    }
+
+    emit clientCountChanged (m_clients.count());
+}
+
+/**
+ * Sends the batched NetConsole messages and the state frames that were
+ * delayed by the update interval of the clients
+ */
+void DSRemoteWorker::sendPendingFrames()
+{
+    QByteArray console;
+    if (!m_console.isEmpty()) {
+        QJsonObject message;
+        message.insert ("console", QJsonArray::fromStringList (m_console));
+        console = encode (QJsonDocument (message).toJson (QJsonDocument::Compact));
+        m_console.clear();
+    }
+
+    foreach (Client* client, m_clients) {
+        if (!client->upgraded)
+            continue;
+
+        if (!console.isEmpty() &&
+            client->socket->bytesToWrite() < REMOTE_MAX_BACKLOG)
+            send (client, console);
+
+        if (client->pending && canSend (client))
+            sendFrame (client);
+    }
+}
+
+/**
+ * Returns the client that owns the given \a socket
+ */
+DSRemoteWorker::Client* DSRemoteWorker::find (QTcpSocket* socket)
+{
+    foreach (Client* client, m_clients) {
+        if (client->socket == socket)
+            return client;
+    }
+
+    return NULL;
+}
+
+/**
+ * Answers the WebSocket handshake request of the given \a client and sends
+ * it the current state. The update interval of the client is read from the
+ * "interval" parameter of the request.
+ */
+void DSRemoteWorker::handshake (Client* client)
+{
+    QByteArray key;
+    QByteArray path;
+
+    QList<QByteArray> lines = client->request.split ('\n');
+    foreach (const QByteArray& line, lines) {
+        QByteArray header = line.trimmed();
+
+        if (header.startsWith ("GET "))
+            path = header.split (' ').value (1);
+        else if (header.toLower().startsWith ("sec-websocket-key:"))
+            key = header.mid (18).trimmed();
+    }
+
+    if (key.isEmpty()) {
+        client->socket->write ("HTTP/1.1 400 Bad Request\r\n"
+                               "Connection: close\r\n\r\n");
+        client->socket->disconnectFromHost();
+        return;
+    }
+
+    QUrlQuery query (QUrl (QString::fromUtf8 (path)));
+    int interval = query.queryItemValue ("interval").toInt();
+    if (interval > 0)
+        client->interval = qMax (interval, REMOTE_MIN_INTERVAL);
+
+    QByteArray accept = QCryptographicHash::hash (key + WEBSOCKET_GUID,
+                                                  QCryptographicHash::Sha1);
+
+    client->socket->write ("HTTP/1.1 101 Switching Protocols\r\n"
+                           "Upgrade: websocket\r\n"
+                           "Connection: Upgrade\r\n"
+                           "Sec-WebSocket-Accept: " + accept.toBase64() +
+                           "\r\n\r\n");
+
+    client->upgraded = true;
+    client->request.clear();
+
+    if (m_seq > 0)
+        sendFrame (client);
+}
+
+/**
+ * Reads the (masked) frames sent by the given \a client, only the close
+ * and ping control frames are answered, other messages are ignored
+ */
+void DSRemoteWorker::readFrames (Client* client)
+{
+    QByteArray& data = client->request;
+
+    while (data.size() >= 2) {
+        quint8 opcode = (quint8) data.at (0) & 0x0F;
+        bool masked = (quint8) data.at (1) & 0x80;
+        int length = (quint8) data.at (1) & 0x7F;
+        int offset = 2;
+
+        if (length == 126) {
+            if (data.size() < 4)
+                return;
+
+            length = ((quint8) data.at (2) << 8) | (quint8) data.at (3);
+            offset = 4;
+        }
+
+        else if (length == 127) {
+            client->socket->abort();
+            return;
+        }
+
+        int size = offset + (masked ? 4 : 0) + length;
+        if (data.size() < size)
+            return;
+
+        QByteArray payload = data.mid (size - length, length);
+        if (masked) {
+            for (int i = 0; i < length; ++i)
+                payload [i] = payload.at (i) ^ data.at (offset + (i % 4));
+        }
+
+        data.remove (0, size);
+
+        if (opcode == 0x08) {
+            send (client, encode (QByteArray(), 0x08));
+            client->socket->disconnectFromHost();
+            return;
+        }
+
+        else if (opcode == 0x09)
+            send (client, encode (payload, 0x0A));
+    }
+}
+
+/**
+ * Returns \c true if the update interval of the given \a client has elapsed
+ * and if its connection is not falling behind
+ */
+bool DSRemoteWorker::canSend (const Client* client) const
+{
+    if (client->socket->bytesToWrite() >= REMOTE_MAX_BACKLOG)
+        return false;
+
+    return !client->lastSend.isValid() ||
+           client->lastSend.hasExpired (client->interval);
+}
+
+/**
+ * Sends the given WebSocket \a message to the given \a client
+ */
+void DSRemoteWorker::send (Client* client, const QByteArray& message)
+{
+    client->socket->write (message);
+}
+
+/**
+ * Sends the latest state frame to the given \a client: the delta if the
+ * client has received the previous frame, the key frame otherwise
+ */
+void DSRemoteWorker::sendFrame (Client* client)
+{
+    if (client->lastSeq == m_seq - 1)
+        send (client, m_delta);
+    else
+        send (client, keyFrame());
+
+    client->pending = false;
+    client->lastSeq = m_seq;
+    client->lastSend.start();
+}
+
+/**
+ * Returns the key frame (with the complete state) of the latest frame, the
+ * key frame is serialized once per frame, when a client needs it
+ */
+QByteArray DSRemoteWorker::keyFrame()
+{
+    if (m_keySeq != m_seq) {
+        QJsonObject message;
+        message.insert ("seq", m_seq);
+        message.insert ("key", true);
+        message.insert ("state", m_state);
+
+        m_key = encode (QJsonDocument (message).toJson (QJsonDocument::Compact));
+        m_keySeq = m_seq;
+    }
+
+    return m_key;
+}
+
+/**
+ * Returns the properties of the given \a frame as a JSON object
+ */
+QJsonObject DSRemoteWorker::toJson (const DriverStationFrame& frame)
+{
+    QJsonObject json;
+    json.insert ("enabled", frame.enabled);
+    json.insert ("robotCode", frame.robotCode);
+    json.insert ("emergencyStopped", frame.emergencyStopped);
+    json.insert ("connectedToFMS", frame.connectedToFMS);
+    json.insert ("connectedToRadio", frame.connectedToRadio);
+    json.insert ("connectedToRobot", frame.connectedToRobot);
+    json.insert ("voltage", frame.voltage);
+    json.insert ("cpuUsage", frame.cpuUsage);
+    json.insert ("canUsage", frame.canUsage);
+    json.insert ("ramUsage", frame.ramUsage);
+    json.insert ("diskUsage", frame.diskUsage);
+    json.insert ("controlMode", frame.controlMode);
+    json.insert ("alliance", frame.alliance);
+    json.insert ("position", frame.position);
+    json.insert ("status", frame.status);
+    return json;
+}
+
+/**
+ * Returns the given \a payload as an unmasked WebSocket frame with the
+ * given \a opcode (text by default)
+ */
+QByteArray DSRemoteWorker::encode (const QByteArray& payload,
+                                   const quint8 opcode)
+{
+    QByteArray frame;
+    quint64 length = (quint64) payload.size();
+
+    frame.append ((char) (0x80 | opcode));
+    if (length < 126)
+        frame.append ((char) length);
+
+    else if (length < 65536) {
+        frame.append ((char) 126);
+        frame.append ((char) (length >> 8));
+        frame.append ((char) (length & 0xFF));
+    }
+
+    else {
+        frame.append ((char) 127);
+        for (int i = 7; i >= 0; --i)
+            frame.append ((char) ((length >> (i * 8)) & 0xFF));
+    }
+
+    frame.append (payload);
+    return frame;
+}
+
+/**
+ * Starts the server thread, the server does not listen until \c start()
+ * is called
+ */
+DSRemoteServer::DSRemoteServer()
+{
+    m_listening = false;
+    m_clientCount = 0;
+
+    m_worker = new DSRemoteWorker;
+    m_worker->moveToThread (&m_thread);
+
+    connect (&m_thread, SIGNAL (finished()), m_worker, SLOT (deleteLater()));
+    connect (m_worker, &DSRemoteWorker::clientCountChanged,
+             this,     &DSRemoteServer::onClientCountChanged);
+
+    m_thread.start (QThread::LowPriority);
+}
+
+/**
+ * Stops the server and its thread
+ */
+DSRemoteServer::~DSRemoteServer()
+{
+    stop();
+    m_thread.quit();
+    m_thread.wait();
+}
+
+/**
+ * Returns the only instance of this class
+ */
+DSRemoteServer* DSRemoteServer::getInstance()
+{
+    static DSRemoteServer instance;
+    return &instance;
+}
+
+/**
+ * Returns the number of connected clients
+ */
+int DSRemoteServer::clientCount() const
+{
+    return m_clientCount;
+}
+
+/**
+ * Returns \c true if the server has been started
+ */
+bool DSRemoteServer::isListening() const
+{
+    return m_listening;
+}
+
+/**
+ * Disconnects the clients and stops forwarding the state to the server
+ * thread
+ */
+void DSRemoteServer::stop()
+{
+    if (!m_listening)
+        return;
+
+    DriverStation* ds = DriverStation::getInstance();
+    disconnect (ds, &DriverStation::telemetryFrame,
+                m_worker, &DSRemoteWorker::publishFrame);
+    disconnect (ds, &DriverStation::newMessage,
+                m_worker, &DSRemoteWorker::publishMessage);
+
+    QMetaObject::invokeMethod (m_worker, "close", Qt::QueuedConnection);
+    m_listening = false;
+}
+
+/**
+ * Starts streaming the state and the NetConsole to the WebSocket clients
+ * that connect to the given \a port. This enables the telemetry frames of
+ * the \c DriverStation.
+ */
+void DSRemoteServer::start (const quint16 port)
+{
+    stop();
+
+    DriverStation* ds = DriverStation::getInstance();
+    connect (ds, &DriverStation::telemetryFrame,
+             m_worker, &DSRemoteWorker::publishFrame);
+    connect (ds, &DriverStation::newMessage,
+             m_worker, &DSRemoteWorker::publishMessage);
+
+    ds->setTelemetryFramesEnabled (true);
+    QMetaObject::invokeMethod (m_worker, "listen", Qt::QueuedConnection,
+                               Q_ARG (quint16, port));
+    QMetaObject::invokeMethod (m_worker, "publishFrame", Qt::QueuedConnection,
+                               Q_ARG (DriverStationFrame, ds->frame()));
+
+    m_listening = true;
+}
+
+/**
+ * Called when a client connects to (or disconnects from) the server
+ */
+void DSRemoteServer::onClientCountChanged (const int count)
+{
+    m_clientCount = count;
+    emit clientCountChanged (count);
+}
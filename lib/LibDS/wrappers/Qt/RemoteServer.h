@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _DS_REMOTE_SERVER_H
+#define _DS_REMOTE_SERVER_H
+
+#include <QList>
+#include <QThread>
+#include <QObject>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QStringList>
+#include <QElapsedTimer>
+
+#include "DriverStationFrame.h"
+
+class QTimer;
+class QTcpServer;
+class QTcpSocket;
+
+/*
+ * Default and minimum interval (in msecs) between two state updates sent
+ * to a client (a client can ask for a slower rate with the "interval"
+ * parameter of its request, e.g. ws://laptop:5810/?interval=500)
+ */
+#define REMOTE_DEFAULT_INTERVAL 100
+#define REMOTE_MIN_INTERVAL     20
+
+/*
+ * Limits that keep the server cheap: maximum number of clients, maximum
+ * size of a handshake request and of the data queued for a slow client
+ */
+#define REMOTE_MAX_CLIENTS      16
+#define REMOTE_MAX_REQUEST      4096
+#define REMOTE_MAX_BACKLOG      (256 * 1024)
+
+/**
+ * Serves the WebSocket clients of the \c DSRemoteServer from its own thread.
+ *
+ * Every state frame is serialized once, as a delta against the previous
+ * frame, and the same WebSocket message is sent to all the clients that
+ * are up to date. A client that skipped frames (because of its update
+ * interval or because its connection is slow) receives a key frame with
+ * the complete state instead, which is also serialized once per frame and
+ * only when a client needs it.
+ *
+ * Messages are JSON objects:
+ *
+ *   State:      {"seq": n, "key": bool, "state": {changed properties}}
+ *   NetConsole: {"console": [messages]}
+ *
+ * The NetConsole messages are batched and sent with the pending state
+ * frames every \c REMOTE_MIN_INTERVAL msecs.
+ */
+class DSRemoteWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    DSRemoteWorker();
+    ~DSRemoteWorker();
+
+public slots:
+    void listen (const quint16 port);
+    void close();
+    void publishFrame (const DriverStationFrame& frame);
+    void publishMessage (const QString& message);
+
+signals:
+    void clientCountChanged (const int count);
+
+private slots:
+    void acceptClients();
+    void readClient();
+    void removeClient();
+    void sendPendingFrames();
+
+private:
+    struct Client {
+        QTcpSocket* socket;
+        bool upgraded;
+        bool pending;
+        qint64 lastSeq;
+        qint64 interval;
+        QByteArray request;
+        QElapsedTimer lastSend;
+    };
+
+    Client* find (QTcpSocket* socket);
+    void handshake (Client* client);
+    void readFrames (Client* client);
+    bool canSend (const Client* client) const;
+    void send (Client* client, const QByteArray& message);
+    void sendFrame (Client* client);
+    QByteArray keyFrame();
+
+    static QJsonObject toJson (const DriverStationFrame& frame);
+    static QByteArray encode (const QByteArray& payload,
+                              const quint8 opcode = 0x01);
+
+private:
+    qint64 m_seq;
+    qint64 m_keySeq;
+    QByteArray m_key;
+    QByteArray m_delta;
+    QJsonObject m_state;
+    QStringList m_console;
+
+    QTimer* m_timer;
+    QTcpServer* m_server;
+    QList<Client*> m_clients;
+};
+
+/**
+ * Optional WebSocket server that streams the robot and communications state
+ * (the \c DriverStation telemetry frames) and the NetConsole messages, so
+ * that the driver laptop can be watched from a browser in the stands.
+ *
+ * The GUI thread only forwards the frames (which are published at most
+ * once per frame swap) and the NetConsole messages to the server thread,
+ * all the serialization and networking happens in the server thread. The
+ * LibDS threads are never involved.
+ */
+class DSRemoteServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static DSRemoteServer* getInstance();
+
+    int clientCount() const;
+    bool isListening() const;
+
+public slots:
+    void stop();
+    void start (const quint16 port);
+
+signals:
+    void clientCountChanged (const int count);
+
+private slots:
+    void onClientCountChanged (const int count);
+
+private:
+    DSRemoteServer();
+    ~DSRemoteServer();
+
+private:
+    bool m_listening;
+    int m_clientCount;
+    QThread m_thread;
+    DSRemoteWorker* m_worker;
+};
+
+#endif
@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include "Robot.h"
+
+#include <LibDS.h>
+#include <QTimer>
+#include <QDebug>
+
+#if defined Q_OS_WIN
+    #include <QWinEventNotifier>
+#else
+    #include <QSocketNotifier>
+#endif
+
+#define LOG qDebug() << "DS Robot:"
+
+/*
+ * Interval (in msecs) at which the events are polled if the event handle
+ * of the context is not available
+ */
+#define EVENT_POLL_INTERVAL 5
+
+/**
+ * Creates and initializes a new LibDS context for the robot of the given
+ * \a team, which uses the first registered protocol
+ */
+DSRobot::DSRobot (const int team, QObject* parent) : QObject (parent),
+    m_context (DS_ContextNew()),
+    m_eventNotifier (nullptr),
+    m_pollTimer (nullptr),
+    m_protocol (-1)
+{
+    Q_ASSERT (m_context);
+
+    DSContextScope scope (m_context);
+    DS_Init();
+    DS_SetEventCoalescing (1);
+    DS_SetNetConsoleMessageEvents (0);
+    DS_SetTeamNumber (team);
+    setProtocol (0);
+
+    /* Process the events of the context when its handle is signaled */
+    DS_EventHandle handle = DS_GetEventHandle();
+
+#if defined Q_OS_WIN
+    if (handle) {
+        QWinEventNotifier* notifier = new QWinEventNotifier (handle, this);
+        connect (notifier, SIGNAL (activated (HANDLE)),
+                 this,       SLOT (processEvents()));
+        m_eventNotifier = notifier;
+    }
+#else
+    if (handle >= 0) {
+        QSocketNotifier* notifier = new QSocketNotifier (handle,
+                                                         QSocketNotifier::Read,
+                                                         this);
+        connect (notifier, SIGNAL (activated (int)),
+                 this,       SLOT (processEvents()));
+        m_eventNotifier = notifier;
+    }
+#endif
+
+    if (!m_eventNotifier) {
+        m_pollTimer = new QTimer (this);
+        m_pollTimer->setTimerType (Qt::CoarseTimer);
+        connect (m_pollTimer, SIGNAL (timeout()), this, SLOT (processEvents()));
+        m_pollTimer->start (EVENT_POLL_INTERVAL);
+    }
+
+    LOG << "Added robot of team" << team;
+}
+
+/**
+ * Closes the sockets of the robot and de-allocates its context
+ */
+DSRobot::~DSRobot()
+{
+    delete m_eventNotifier;
+    delete m_pollTimer;
+
+    LOG << "Removing robot of team" << teamNumber();
+    DS_ContextFree (m_context);
+}
+
+/**
+ * Returns the LibDS context of the robot
+ */
+DS_Context* DSRobot::context() const
+{
+    return m_context;
+}
+
+/**
+ * Returns the team number of the robot
+ */
+int DSRobot::teamNumber() const
+{
+    DSContextScope scope (m_context);
+    return DS_GetTeamNumber();
+}
+
+/**
+ * Returns the index of the protocol used by the robot, in the list given
+ * by \c DriverStation::protocols()
+ */
+int DSRobot::protocol() const
+{
+    return m_protocol;
+}
+
+/**
+ * Returns \c true if the robot is enabled
+ */
+bool DSRobot::isEnabled() const
+{
+    DSContextScope scope (m_context);
+    return DS_GetRobotEnabled() != 0;
+}
+
+/**
+ * Returns \c true if the robot is emergency stopped
+ */
+bool DSRobot::emergencyStopped() const
+{
+    DSContextScope scope (m_context);
+    return DS_GetEmergencyStopped() != 0;
+}
+
+/**
+ * Returns the control mode of the robot (a \c DriverStation::Control value)
+ */
+int DSRobot::controlMode() const
+{
+    DSContextScope scope (m_context);
+    return (int) DS_GetControlMode();
+}
+
+/**
+ * Returns \c true if the DS communicates with the robot
+ */
+bool DSRobot::connectedToRobot() const
+{
+    DSContextScope scope (m_context);
+    return DS_GetRobotCommunications() != 0;
+}
+
+/**
+ * Returns \c true if the robot is running its code
+ */
+bool DSRobot::hasRobotCode() const
+{
+    DSContextScope scope (m_context);
+    return DS_GetRobotCode() != 0;
+}
+
+/**
+ * Returns the battery voltage of the robot
+ */
+qreal DSRobot::voltage() const
+{
+    DSContextScope scope (m_context);
+    return DS_GetRobotVoltage();
+}
+
+/**
+ * Returns the status string of the robot (e.g. "Teleoperated Disabled")
+ */
+QString DSRobot::status() const
+{
+    DSContextScope scope (m_context);
+    return QString::fromUtf8 (DS_GetStatusName (DS_GetStatus()));
+}
+
+/**
+ * Returns the \c QJoysticks indexes of the joysticks sent to this robot
+ */
+QVariantList DSRobot::joysticks() const
+{
+    QVariantList list;
+    foreach (int device, m_joysticks)
+        list.append (device);
+
+    return list;
+}
+
+/**
+ * Returns \c true if the joystick with the given \c QJoysticks index is
+ * sent to this robot
+ */
+bool DSRobot::hasJoystick (const int device) const
+{
+    return m_joysticks.contains (device);
+}
+
+/**
+ * Changes the team \a number of the robot (and its addresses)
+ */
+void DSRobot::setTeamNumber (const int number)
+{
+    DSContextScope scope (m_context);
+
+    if (DS_GetTeamNumber() != number) {
+        DS_SetTeamNumber (number);
+        emit teamNumberChanged (number);
+    }
+}
+
+/**
+ * Loads the registered protocol with the given index (see
+ * \c DriverStation::protocols())
+ */
+void DSRobot::setProtocol (const int protocol)
+{
+    if (protocol == m_protocol || protocol < 0 ||
+            protocol >= DS_RegisteredProtocolCount())
+        return;
+
+    DSContextScope scope (m_context);
+    DS_String name = DS_RegisteredProtocolName (protocol);
+    char* cname = DS_StrToChar (&name);
+
+    if (cname && DS_LoadRegisteredProtocol (cname)) {
+        m_protocol = protocol;
+        emit protocolChanged();
+    }
+
+    DS_FREE (cname);
+    DS_StrRmBuf (&name);
+}
+
+/**
+ * Enables or disables the robot
+ */
+void DSRobot::setEnabled (const bool enabled)
+{
+    DSContextScope scope (m_context);
+    DS_SetRobotEnabled (enabled);
+}
+
+/**
+ * Changes the emergency stop state of the robot
+ */
+void DSRobot::setEmergencyStopped (const bool stopped)
+{
+    DSContextScope scope (m_context);
+    DS_SetEmergencyStopped (stopped);
+}
+
+/**
+ * Changes the control \a mode of the robot (a \c DriverStation::Control
+ * value), the robot is disabled if the mode changes while it is enabled
+ */
+void DSRobot::setControlMode (const int mode)
+{
+    DSContextScope scope (m_context);
+
+    if (mode != (int) DS_GetControlMode()) {
+        DS_SetRobotEnabled (0);
+        DS_SetControlMode ((DS_ControlMode) mode);
+    }
+}
+
+/**
+ * Sends the joysticks with the given \c QJoysticks indexes to this robot
+ * (instead of the main robot)
+ */
+void DSRobot::setJoysticks (const QVariantList& devices)
+{
+    QList<int> list;
+    foreach (const QVariant& device, devices)
+        if (!list.contains (device.toInt()))
+            list.append (device.toInt());
+
+    if (m_joysticks != list) {
+        m_joysticks = list;
+        emit joysticksChanged();
+    }
+}
+
+/**
+ * Removes all the joysticks registered with the robot
+ */
+void DSRobot::resetJoysticks()
+{
+    DSContextScope scope (m_context);
+    DS_JoysticksReset();
+}
+
+/**
+ * Registers a new joystick with the robot
+ */
+void DSRobot::addJoystick (int axes, int hats, int buttons)
+{
+    DSContextScope scope (m_context);
+    DS_JoysticksAdd (axes, hats, buttons);
+}
+
+/**
+ * Polls the events of the robot context and emits the signals of the
+ * values that changed
+ */
+void DSRobot::processEvents()
+{
+    DS_Event event;
+    DSContextScope scope (m_context);
+
+    while (DS_PollEvent (&event)) {
+        switch (event.type) {
+        case DS_ROBOT_ENABLED_CHANGED:
+            emit enabledChanged (event.robot.enabled != 0);
+            break;
+        case DS_ROBOT_ESTOP_CHANGED:
+            emit emergencyStoppedChanged (event.robot.estopped != 0);
+            break;
+        case DS_ROBOT_MODE_CHANGED:
+            emit controlModeChanged ((int) event.robot.mode);
+            break;
+        case DS_ROBOT_COMMS_CHANGED:
+            emit robotCommunicationsChanged (event.robot.connected != 0);
+            break;
+        case DS_ROBOT_CODE_CHANGED:
+            emit robotCodeChanged (event.robot.code != 0);
+            break;
+        case DS_ROBOT_VOLTAGE_CHANGED:
+            emit voltageChanged (event.robot.voltage);
+            break;
+        case DS_STATUS_STRING_CHANGED:
+            emit statusChanged (QString::fromUtf8 (DS_GetStatusName (DS_GetStatus())));
+            break;
+        default:
+            break;
+        }
+    }
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _DS_ROBOT_H
+#define _DS_ROBOT_H
+
+#include <QObject>
+#include <QVariantList>
+
+#include <DS_Context.h>
+
+class QTimer;
+
+/**
+ * Makes the given LibDS context current in the calling thread until the
+ * scope ends, the previous context is restored afterwards
+ */
+class DSContextScope
+{
+public:
+    explicit DSContextScope (DS_Context* context) :
+        m_previous (DS_ContextCurrent())
+    {
+        DS_ContextMakeCurrent (context);
+    }
+
+    ~DSContextScope()
+    {
+        DS_ContextMakeCurrent (m_previous);
+    }
+
+private:
+    DS_Context* m_previous;
+};
+
+/**
+ * An additional robot controlled by the same DS process. Each robot owns a
+ * LibDS context (with its own team number, protocol, sockets, joysticks and
+ * event queue), while the timer and socket threads are shared with the
+ * main robot of the \c DriverStation class.
+ *
+ * Robots are created and destroyed with \c DriverStation::addRobot() and
+ * \c DriverStation::removeRobot(). The joysticks given to \c setJoysticks()
+ * (by their \c QJoysticks index) are sent to this robot instead of the main
+ * robot.
+ */
+class DSRobot : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY (int teamNumber
+                READ teamNumber
+                WRITE setTeamNumber
+                NOTIFY teamNumberChanged)
+    Q_PROPERTY (int protocol
+                READ protocol
+                WRITE setProtocol
+                NOTIFY protocolChanged)
+    Q_PROPERTY (bool enabled
+                READ isEnabled
+                WRITE setEnabled
+                NOTIFY enabledChanged)
+    Q_PROPERTY (bool emergencyStopped
+                READ emergencyStopped
+                WRITE setEmergencyStopped
+                NOTIFY emergencyStoppedChanged)
+    Q_PROPERTY (int controlMode
+                READ controlMode
+                WRITE setControlMode
+                NOTIFY controlModeChanged)
+    Q_PROPERTY (bool connectedToRobot
+                READ connectedToRobot
+                NOTIFY robotCommunicationsChanged)
+    Q_PROPERTY (bool robotCode
+                READ hasRobotCode
+                NOTIFY robotCodeChanged)
+    Q_PROPERTY (qreal voltage
+                READ voltage
+                NOTIFY voltageChanged)
+    Q_PROPERTY (QString status
+                READ status
+                NOTIFY statusChanged)
+    Q_PROPERTY (QVariantList joysticks
+                READ joysticks
+                WRITE setJoysticks
+                NOTIFY joysticksChanged)
+
+public:
+    explicit DSRobot (const int team, QObject* parent = nullptr);
+    ~DSRobot();
+
+    DS_Context* context() const;
+
+    int teamNumber() const;
+    int protocol() const;
+    bool isEnabled() const;
+    bool emergencyStopped() const;
+    int controlMode() const;
+    bool connectedToRobot() const;
+    bool hasRobotCode() const;
+    qreal voltage() const;
+    QString status() const;
+    QVariantList joysticks() const;
+    bool hasJoystick (const int device) const;
+
+public slots:
+    void setTeamNumber (const int number);
+    void setProtocol (const int protocol);
+    void setEnabled (const bool enabled);
+    void setEmergencyStopped (const bool stopped);
+    void setControlMode (const int mode);
+    void setJoysticks (const QVariantList& devices);
+
+    void resetJoysticks();
+    void addJoystick (int axes, int hats, int buttons);
+
+signals:
+    void protocolChanged();
+    void joysticksChanged();
+    void teamNumberChanged (const int number);
+    void enabledChanged (const bool enabled);
+    void emergencyStoppedChanged (const bool stopped);
+    void controlModeChanged (const int mode);
+    void robotCommunicationsChanged (const bool connected);
+    void robotCodeChanged (const bool robotCode);
+    void voltageChanged (const qreal voltage);
+    void statusChanged (const QString& status);
+
+private slots:
+    void processEvents();
+
+private:
+    DS_Context* m_context;
+    QObject* m_eventNotifier;
+    QTimer* m_pollTimer;
+    int m_protocol;
+    QList<int> m_joysticks;
+};
+
+#endif
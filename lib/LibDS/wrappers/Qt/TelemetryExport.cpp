@@ -0,0 +1,815 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "TelemetryExport.h"
+#include "TelemetryReader.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QVector>
+#include <QtEndian>
+#include <QFileInfo>
+#include <QtConcurrent>
+
+/*
+ * Parquet file magic, physical types, converted types, encodings and page
+ * types (see parquet.thrift), the files are written without compression
+ */
+#define PARQUET_MAGIC              "PAR1"
+#define PARQUET_INT32              1
+#define PARQUET_INT64              2
+#define PARQUET_DOUBLE             5
+#define PARQUET_BYTE_ARRAY         6
+#define PARQUET_UTF8               0
+#define PARQUET_TIMESTAMP_MILLIS   9
+#define PARQUET_REQUIRED           0
+#define PARQUET_OPTIONAL           1
+#define PARQUET_PLAIN              0
+#define PARQUET_RLE                3
+#define PARQUET_DELTA_BINARY       5
+#define PARQUET_RLE_DICTIONARY     8
+#define PARQUET_DATA_PAGE          0
+#define PARQUET_DICTIONARY_PAGE    2
+
+/*
+ * Field types of the Thrift compact protocol
+ */
+#define THRIFT_I32    5
+#define THRIFT_I64    6
+#define THRIFT_BINARY 8
+#define THRIFT_LIST   9
+#define THRIFT_STRUCT 12
+
+/*
+ * Number of values in each block of the delta encoding, and number of
+ * miniblocks (with their own bit width) in each block
+ */
+#define DELTA_BLOCK_SIZE 128
+#define DELTA_MINIBLOCKS 4
+
+/**
+ * Names of the columns of the channels
+ */
+static const char* COLUMN_NAMES [TelemetryLog::ChannelCount] = {
+    "voltage",
+    "can_usage",
+    "cpu_usage",
+    "ram_usage",
+    "disk_usage",
+    "enabled",
+    "robot_code",
+    "fms_communications",
+    "radio_communications",
+    "robot_communications",
+    "emergency_stop",
+    "control_mode",
+    "message",
+};
+
+/**
+ * The rows of a row group, each channel has a definition level (1 if the
+ * channel has a sample in the row) for every row, and the values of the
+ * rows in which it has a sample
+ */
+struct RowGroup {
+    QVector<qint64> times;
+    QVector<quint64> defined [TelemetryLog::ChannelCount];
+    QVector<double> values [TelemetryLog::ChannelCount];
+    QVector<QByteArray> messages;
+};
+
+/**
+ * Location and size of an encoded column chunk in the file
+ */
+struct ColumnInfo {
+    int encoding;
+    qint64 offset;
+    qint64 size;
+    qint64 dataOffset;
+    qint64 dictionaryOffset;
+};
+
+/**
+ * Location of a row group and of its column chunks in the file
+ */
+struct RowGroupInfo {
+    qint64 rows;
+    qint64 size;
+    QVector<ColumnInfo> columns;
+};
+
+/**
+ * A sample of any channel, used to merge the channels in time order
+ */
+struct Event {
+    qint64 time;
+    int channel;
+    int index;
+};
+
+/**
+ * Exports a single log, used to map the list of logs to the thread pool
+ */
+struct ExportJob {
+    typedef bool result_type;
+
+    ExportJob (const QString& directory) : directory (directory) {}
+    bool operator() (const QString& log) const
+    {
+        return TelemetryExport::exportLog (log, TelemetryExport::outputPath (
+                                               log, directory));
+    }
+
+    QString directory;
+};
+
+/**
+ * Appends the given unsigned \a value to the \a data as a varint
+ */
+static void putVarint (QByteArray& data, quint64 value)
+{
+    while (value >= 0x80) {
+        data.append ((char) ((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+
+    data.append ((char) value);
+}
+
+/**
+ * Appends the given signed \a value to the \a data as a zigzag varint
+ */
+static void putSigned (QByteArray& data, const qint64 value)
+{
+    putVarint (data, ((quint64) value << 1) ^ (quint64) (value >> 63));
+}
+
+/**
+ * Appends the given integer \a value to the \a data (little-endian)
+ */
+template <typename T>
+static void putInteger (QByteArray& data, const T value)
+{
+    char bytes [sizeof (T)];
+    qToLittleEndian<T> (value, (uchar*) bytes);
+    data.append (bytes, sizeof (T));
+}
+
+/**
+ * Appends the given \a values to the \a data, packed with \a width bits
+ * per value (starting with the least significant bit)
+ */
+static void putPacked (QByteArray& data, const quint64* values,
+                       const int count, const int width)
+{
+    int bit = 0;
+    uchar byte = 0;
+    for (int i = 0; i < count; ++i) {
+        for (int b = 0; b < width; ++b) {
+            if ((values [i] >> b) & 1)
+                byte |= (uchar) (1 << bit);
+
+            if (++bit == 8) {
+                data.append ((char) byte);
+                byte = 0;
+                bit = 0;
+            }
+        }
+    }
+
+    if (bit > 0)
+        data.append ((char) byte);
+}
+
+/**
+ * Returns the number of bits needed to store the given \a value
+ */
+static int bitWidth (quint64 value)
+{
+    int width = 0;
+    while (value > 0) {
+        value >>= 1;
+        ++width;
+    }
+
+    return width;
+}
+
+/**
+ * Appends the given \a values to the \a data with the RLE/bit-packing
+ * hybrid encoding, as a single bit-packed run (padded with zeros)
+ */
+static void putHybrid (QByteArray& data, QVector<quint64> values,
+                       const int width)
+{
+    int groups = (values.count() + 7) / 8;
+    values.resize (groups * 8);
+
+    putVarint (data, ((quint64) groups << 1) | 1);
+    putPacked (data, values.constData(), values.count(), width);
+}
+
+/**
+ * Appends the given \a values to the \a data with the delta encoding: the
+ * differences between consecutive values are stored in blocks, with the
+ * bit width needed by the differences of each miniblock
+ */
+static void putDeltas (QByteArray& data, const QVector<qint64>& values)
+{
+    const int miniblock = DELTA_BLOCK_SIZE / DELTA_MINIBLOCKS;
+
+    putVarint (data, DELTA_BLOCK_SIZE);
+    putVarint (data, DELTA_MINIBLOCKS);
+    putVarint (data, (quint64) values.count());
+    putSigned (data, values.isEmpty() ? 0 : values.first());
+
+    for (int start = 1; start < values.count(); start += DELTA_BLOCK_SIZE) {
+        int count = qMin (DELTA_BLOCK_SIZE, values.count() - start);
+
+        /* Get the smallest difference of the block */
+        qint64 minDelta = values [start] - values [start - 1];
+        for (int i = 1; i < count; ++i)
+            minDelta = qMin (minDelta, values [start + i] - values [start + i - 1]);
+
+        /* Store the differences relative to the smallest one */
+        quint64 deltas [DELTA_BLOCK_SIZE];
+        memset (deltas, 0, sizeof (deltas));
+        for (int i = 0; i < count; ++i)
+            deltas [i] = (quint64) (values [start + i] - values [start + i - 1]
+                                    - minDelta);
+
+        /* Get the bit width of each miniblock (0 for unused miniblocks) */
+        uchar widths [DELTA_MINIBLOCKS];
+        for (int m = 0; m < DELTA_MINIBLOCKS; ++m) {
+            quint64 max = 0;
+            for (int i = m * miniblock; i < qMin (count, (m + 1) * miniblock); ++i)
+                max = qMax (max, deltas [i]);
+
+            widths [m] = (uchar) bitWidth (max);
+        }
+
+        putSigned (data, minDelta);
+        data.append ((const char*) widths, DELTA_MINIBLOCKS);
+        for (int m = 0; m * miniblock < count; ++m)
+            putPacked (data, deltas + m * miniblock, miniblock, widths [m]);
+    }
+}
+
+/**
+ * Writes the structures of the Parquet metadata with the Thrift compact
+ * protocol, the fields of each structure must be written in order
+ */
+class ThriftWriter
+{
+public:
+    ThriftWriter() : m_last (0) {}
+
+    QByteArray data;
+
+    void i32 (const int id, const qint32 value)
+    {
+        field (id, THRIFT_I32);
+        putSigned (data, value);
+    }
+
+    void i64 (const int id, const qint64 value)
+    {
+        field (id, THRIFT_I64);
+        putSigned (data, value);
+    }
+
+    void binary (const int id, const QByteArray& value)
+    {
+        field (id, THRIFT_BINARY);
+        element (value);
+    }
+
+    void list (const int id, const int type, const int size)
+    {
+        field (id, THRIFT_LIST);
+        if (size < 15)
+            data.append ((char) ((size << 4) | type));
+        else {
+            data.append ((char) (0xF0 | type));
+            putVarint (data, (quint64) size);
+        }
+    }
+
+    void element (const qint32 value)
+    {
+        putSigned (data, value);
+    }
+
+    void element (const QByteArray& value)
+    {
+        putVarint (data, (quint64) value.size());
+        data.append (value);
+    }
+
+    void beginStruct (const int id)
+    {
+        field (id, THRIFT_STRUCT);
+        begin();
+    }
+
+    void begin()
+    {
+        m_stack.append (m_last);
+        m_last = 0;
+    }
+
+    void end()
+    {
+        data.append ((char) 0);
+        if (!m_stack.isEmpty())
+            m_last = m_stack.takeLast();
+    }
+
+private:
+    void field (const int id, const int type)
+    {
+        if (id > m_last && id - m_last <= 15)
+            data.append ((char) (((id - m_last) << 4) | type));
+        else {
+            data.append ((char) type);
+            putSigned (data, id);
+        }
+
+        m_last = id;
+    }
+
+private:
+    int m_last;
+    QVector<int> m_stack;
+};
+
+/**
+ * Returns the physical type of the given \a column (the time column is
+ * the first one, followed by the channels)
+ */
+static int columnType (const int column)
+{
+    if (column == 0)
+        return PARQUET_INT64;
+
+    TelemetryLog::Channel channel = (TelemetryLog::Channel) (column - 1);
+    if (TelemetryLog::encoding (channel) == TelemetryLog::TextEncoding)
+        return PARQUET_BYTE_ARRAY;
+
+    return TelemetryLog::decimals (channel) > 0 ? PARQUET_DOUBLE : PARQUET_INT32;
+}
+
+/**
+ * Returns the header of a data page or of a dictionary page
+ */
+static QByteArray pageHeader (const int type, const int size,
+                              const int values, const int encoding)
+{
+    ThriftWriter header;
+    header.begin();
+    header.i32 (1, type);
+    header.i32 (2, size);
+    header.i32 (3, size);
+
+    if (type == PARQUET_DICTIONARY_PAGE) {
+        header.beginStruct (7);
+        header.i32 (1, values);
+        header.i32 (2, encoding);
+        header.end();
+    }
+
+    else {
+        header.beginStruct (5);
+        header.i32 (1, values);
+        header.i32 (2, encoding);
+        header.i32 (3, PARQUET_RLE);
+        header.i32 (4, PARQUET_RLE);
+        header.end();
+    }
+
+    header.end();
+    return header.data;
+}
+
+/**
+ * Appends the definition levels of a column to the given \a page (prefixed
+ * with their size)
+ */
+static void putLevels (QByteArray& page, const QVector<quint64>& levels)
+{
+    QByteArray encoded;
+    putHybrid (encoded, levels, 1);
+    putInteger<quint32> (page, (quint32) encoded.size());
+    page.append (encoded);
+}
+
+/**
+ * Encodes the pages of the given \a column of the \a rows
+ *
+ * \param dictionary set to the size of the dictionary page (0 if none)
+ * \param encoding set to the encoding of the data page
+ */
+static QByteArray encodeColumn (const RowGroup& rows, const int column,
+                                int* dictionary, int* encoding)
+{
+    QByteArray page;
+    QByteArray pages;
+    int count = rows.times.count();
+
+    *dictionary = 0;
+    *encoding = PARQUET_PLAIN;
+
+    /* Times are stored as deltas */
+    if (column == 0) {
+        *encoding = PARQUET_DELTA_BINARY;
+        putDeltas (page, rows.times);
+    }
+
+    /* Messages are stored in a dictionary, rows refer to its entries */
+    else if (column - 1 == TelemetryLog::Messages) {
+        putLevels (page, rows.defined [TelemetryLog::Messages]);
+
+        if (!rows.messages.isEmpty()) {
+            QByteArray entries;
+            QVector<quint64> indexes;
+            QHash<QByteArray, int> indexOf;
+            foreach (const QByteArray& message, rows.messages) {
+                int index = indexOf.value (message, -1);
+                if (index < 0) {
+                    index = indexOf.count();
+                    indexOf.insert (message, index);
+                    putInteger<quint32> (entries, (quint32) message.size());
+                    entries.append (message);
+                }
+
+                indexes.append ((quint64) index);
+            }
+
+            int width = qMax (1, bitWidth ((quint64) indexOf.count() - 1));
+            page.append ((char) width);
+            putHybrid (page, indexes, width);
+
+            pages = pageHeader (PARQUET_DICTIONARY_PAGE, entries.size(),
+                                indexOf.count(), PARQUET_PLAIN);
+            pages.append (entries);
+            *dictionary = pages.size();
+            *encoding = PARQUET_RLE_DICTIONARY;
+        }
+    }
+
+    /* Values are stored as they are */
+    else {
+        int channel = column - 1;
+        bool real = columnType (column) == PARQUET_DOUBLE;
+        putLevels (page, rows.defined [channel]);
+
+        foreach (const double value, rows.values [channel]) {
+            if (real) {
+                quint64 bits;
+                memcpy (&bits, &value, sizeof (bits));
+                putInteger<quint64> (page, bits);
+            }
+
+            else
+                putInteger<qint32> (page, (qint32) qRound (value));
+        }
+    }
+
+    pages.append (pageHeader (PARQUET_DATA_PAGE, page.size(), count, *encoding));
+    pages.append (page);
+    return pages;
+}
+
+/**
+ * Reads the samples of every channel between the \a from and \a to times
+ * and merges them in rows, samples of different channels that have the
+ * same time share a row
+ */
+static RowGroup readRows (const TelemetryReader& reader,
+                          const qint64 from, const qint64 to)
+{
+    int i;
+    RowGroup rows;
+    QVector<Event> events;
+    QVector<TelemetryReader::Sample> samples [TelemetryLog::ChannelCount];
+    QVector<QPair<qint64, QString>> messages = reader.messages (from, to);
+
+    /* Get the samples of each channel */
+    for (i = 0; i < TelemetryLog::Messages; ++i) {
+        samples [i] = reader.samples ((TelemetryLog::Channel) i, from, to);
+        for (int j = 0; j < samples [i].count(); ++j) {
+            Event event = { samples [i].at (j).time, i, j };
+            events.append (event);
+        }
+    }
+
+    for (i = 0; i < messages.count(); ++i) {
+        Event event = { messages.at (i).first, TelemetryLog::Messages, i };
+        events.append (event);
+    }
+
+    /* Sort the samples by time (keeping the order of each channel) */
+    std::stable_sort (events.begin(), events.end(),
+    [] (const Event & a, const Event & b) {
+        return a.time < b.time;
+    });
+
+    /* Start a new row when the time changes, or when the channel of the
+     * sample already has a value in the current row */
+    foreach (const Event& event, events) {
+        if (rows.times.isEmpty() || rows.times.last() != event.time ||
+                rows.defined [event.channel].last() != 0) {
+            rows.times.append (event.time);
+            for (i = 0; i < TelemetryLog::ChannelCount; ++i)
+                rows.defined [i].append (0);
+        }
+
+        rows.defined [event.channel].last() = 1;
+        if (event.channel == TelemetryLog::Messages)
+            rows.messages.append (messages.at (event.index).second.toUtf8());
+        else
+            rows.values [event.channel].append (
+                samples [event.channel].at (event.index).value);
+    }
+
+    return rows;
+}
+
+/**
+ * Encodes the given \a rows and appends them to the \a file as a row group
+ *
+ * \returns \c false if the file cannot be written
+ */
+static bool writeRowGroup (QFile& file, const RowGroup& rows,
+                           QVector<RowGroupInfo>& groups)
+{
+    RowGroupInfo group;
+    group.size = 0;
+    group.rows = rows.times.count();
+
+    for (int column = 0; column <= TelemetryLog::ChannelCount; ++column) {
+        int dictionary;
+        ColumnInfo info;
+        QByteArray pages = encodeColumn (rows, column, &dictionary,
+                                         &info.encoding);
+
+        info.offset = file.pos();
+        info.size = pages.size();
+        info.dataOffset = info.offset + dictionary;
+        info.dictionaryOffset = (dictionary > 0) ? info.offset : -1;
+
+        if (file.write (pages) != pages.size())
+            return false;
+
+        group.size += info.size;
+        group.columns.append (info);
+    }
+
+    groups.append (group);
+    return true;
+}
+
+/**
+ * Returns the file metadata (the schema and the location of the row
+ * groups) of an exported file
+ */
+static QByteArray fileMetadata (const QVector<RowGroupInfo>& groups,
+                                const qint64 creationTime)
+{
+    int column;
+    qint64 rows = 0;
+    const int columns = TelemetryLog::ChannelCount + 1;
+    foreach (const RowGroupInfo& group, groups)
+        rows += group.rows;
+
+    ThriftWriter meta;
+    meta.begin();
+    meta.i32 (1, 1);
+
+    /* Write the schema (a root with the columns) */
+    meta.list (2, THRIFT_STRUCT, columns + 1);
+    meta.begin();
+    meta.binary (4, "schema");
+    meta.i32 (5, columns);
+    meta.end();
+
+    for (column = 0; column < columns; ++column) {
+        meta.begin();
+        meta.i32 (1, columnType (column));
+        meta.i32 (3, column == 0 ? PARQUET_REQUIRED : PARQUET_OPTIONAL);
+        meta.binary (4, column == 0 ? "time" : COLUMN_NAMES [column - 1]);
+        if (column == 0)
+            meta.i32 (6, PARQUET_TIMESTAMP_MILLIS);
+        else if (columnType (column) == PARQUET_BYTE_ARRAY)
+            meta.i32 (6, PARQUET_UTF8);
+        meta.end();
+    }
+
+    meta.i64 (3, rows);
+
+    /* Write the location of each column chunk */
+    meta.list (4, THRIFT_STRUCT, groups.count());
+    foreach (const RowGroupInfo& group, groups) {
+        meta.begin();
+        meta.list (1, THRIFT_STRUCT, columns);
+        for (column = 0; column < columns; ++column) {
+            const ColumnInfo& info = group.columns.at (column);
+            QByteArray name = column == 0 ? "time" : COLUMN_NAMES [column - 1];
+
+            meta.begin();
+            meta.i64 (2, info.offset);
+            meta.beginStruct (3);
+            meta.i32 (1, columnType (column));
+            QVector<int> encodings;
+            encodings.append (PARQUET_PLAIN);
+            if (column > 0)
+                encodings.append (PARQUET_RLE);
+            if (info.encoding != PARQUET_PLAIN)
+                encodings.append (info.encoding);
+
+            meta.list (2, THRIFT_I32, encodings.count());
+            foreach (const int encoding, encodings)
+                meta.element (encoding);
+
+            meta.list (3, THRIFT_BINARY, 1);
+            meta.element (name);
+            meta.i32 (4, 0);
+            meta.i64 (5, group.rows);
+            meta.i64 (6, info.size);
+            meta.i64 (7, info.size);
+            meta.i64 (9, info.dataOffset);
+            if (info.dictionaryOffset >= 0)
+                meta.i64 (11, info.dictionaryOffset);
+            meta.end();
+            meta.end();
+        }
+
+        meta.i64 (2, group.size);
+        meta.i64 (3, group.rows);
+        meta.end();
+    }
+
+    /* Keep the creation time of the log */
+    meta.list (5, THRIFT_STRUCT, 1);
+    meta.begin();
+    meta.binary (1, "creation_time");
+    meta.binary (2, QByteArray::number (creationTime));
+    meta.end();
+
+    meta.binary (6, "LibDS telemetry export");
+    meta.end();
+    return meta.data;
+}
+
+/**
+ * Creates an exporter, which uses the global thread pool
+ */
+TelemetryExport::TelemetryExport (QObject* parent) : QObject (parent)
+{
+    connect (&m_watcher, SIGNAL (finished()), this, SLOT (onFinished()));
+    connect (&m_watcher, SIGNAL (progressValueChanged (int)),
+             this,       SLOT (onProgress (int)));
+}
+
+/**
+ * Stops the export (the logs that are being exported are finished first)
+ */
+TelemetryExport::~TelemetryExport()
+{
+    m_watcher.disconnect (this);
+    m_watcher.cancel();
+    m_watcher.waitForFinished();
+}
+
+/**
+ * Returns \c true while the logs are being exported
+ */
+bool TelemetryExport::isRunning() const
+{
+    return m_watcher.isRunning();
+}
+
+/**
+ * Returns the location of the Parquet file of the given \a log, which is
+ * stored in the given \a directory (or next to the log if it is empty)
+ */
+QString TelemetryExport::outputPath (const QString& log,
+                                     const QString& directory)
+{
+    QFileInfo info (log);
+    QDir dir (directory.isEmpty() ? info.absolutePath() : directory);
+    return dir.filePath (info.completeBaseName() + ".parquet");
+}
+
+/**
+ * Exports the given telemetry \a log to a Parquet file at the given \a path,
+ * in the calling thread. The samples are decoded and written one row group
+ * (of \c EXPORT_ROW_GROUP_SPAN milliseconds) at a time, so the memory used
+ * does not grow with the size of the log.
+ *
+ * \returns \c true on success
+ */
+bool TelemetryExport::exportLog (const QString& log, const QString& path)
+{
+    TelemetryReader reader;
+    if (!reader.open (log))
+        return false;
+
+    QFile file (path);
+    if (!file.open (QFile::WriteOnly | QFile::Truncate))
+        return false;
+
+    /* Write the row groups */
+    bool ok = file.write (PARQUET_MAGIC, 4) == 4;
+    QVector<RowGroupInfo> groups;
+    for (qint64 from = reader.firstTime();
+            ok && from <= reader.lastTime(); from += EXPORT_ROW_GROUP_SPAN) {
+        RowGroup rows = readRows (reader, from, from + EXPORT_ROW_GROUP_SPAN - 1);
+        if (!rows.times.isEmpty())
+            ok = writeRowGroup (file, rows, groups);
+    }
+
+    /* Write the metadata, its size and the magic */
+    QByteArray footer = fileMetadata (groups, reader.creationTime());
+    putInteger<quint32> (footer, (quint32) footer.size());
+    footer.append (PARQUET_MAGIC, 4);
+    ok = ok && file.write (footer) == footer.size();
+
+    /* Do not leave incomplete files */
+    file.close();
+    if (!ok)
+        file.remove();
+
+    return ok;
+}
+
+/**
+ * Stops exporting logs, the logs that are being exported are finished
+ */
+void TelemetryExport::cancel()
+{
+    m_watcher.cancel();
+}
+
+/**
+ * Exports the given \a logs in the background (see \c exportLog()), each
+ * log is exported by a worker of the global thread pool. The Parquet files
+ * are stored in the given \a directory (or next to their logs).
+ *
+ * \returns \c false if an export is already running
+ */
+bool TelemetryExport::start (const QStringList& logs, const QString& directory)
+{
+    if (isRunning() || logs.isEmpty())
+        return false;
+
+    m_watcher.setFuture (QtConcurrent::mapped (logs, ExportJob (directory)));
+    return true;
+}
+
+/**
+ * Reports the number of exported (and failed) logs
+ */
+void TelemetryExport::onFinished()
+{
+    int exported = 0;
+    QFuture<bool> future = m_watcher.future();
+    for (int i = 0; i < future.resultCount(); ++i) {
+        if (future.resultAt (i))
+            ++exported;
+    }
+
+    emit finished (exported, m_watcher.progressMaximum() - exported);
+}
+
+/**
+ * Reports the number of logs that were processed
+ */
+void TelemetryExport::onProgress (const int done)
+{
+    emit progress (done, m_watcher.progressMaximum());
+}
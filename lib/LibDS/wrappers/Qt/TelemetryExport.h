@@ -0,0 +1,78 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _TELEMETRY_EXPORT_H
+#define _TELEMETRY_EXPORT_H
+
+#include <QObject>
+#include <QStringList>
+#include <QFutureWatcher>
+
+/*
+ * Time span (in milliseconds) of the rows of each row group of an exported
+ * file, the samples of a row group are decoded and encoded at once
+ */
+#define EXPORT_ROW_GROUP_SPAN (10 * 60 * 1000)
+
+/**
+ * Converts the telemetry logs written by \c TelemetryLog to Parquet files,
+ * which can be loaded directly by pandas, R or any notebook.
+ *
+ * Each row of an exported file holds a time (the \c time column, stored
+ * with delta encoding) and the samples recorded at that time: one column
+ * per channel (null when the channel has no sample in the row), and the
+ * NetConsole messages in a dictionary-encoded \c message column.
+ *
+ * Several logs (e.g. the logs of a whole event) are exported in parallel,
+ * one log per worker of the global thread pool.
+ */
+class TelemetryExport : public QObject
+{
+    Q_OBJECT
+
+public:
+    TelemetryExport (QObject* parent = nullptr);
+    ~TelemetryExport();
+
+    bool isRunning() const;
+
+    static QString outputPath (const QString& log, const QString& directory);
+    static bool exportLog (const QString& log, const QString& path);
+
+public slots:
+    void cancel();
+    bool start (const QStringList& logs, const QString& directory = "");
+
+signals:
+    void progress (const int done, const int total);
+    void finished (const int exported, const int failed);
+
+private slots:
+    void onFinished();
+    void onProgress (const int done);
+
+private:
+    QFutureWatcher<bool> m_watcher;
+};
+
+#endif
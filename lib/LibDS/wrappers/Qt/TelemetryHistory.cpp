@@ -0,0 +1,341 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "TelemetryHistory.h"
+#include "DriverStation.h"
+
+#include <QDateTime>
+#include <QVariantMap>
+
+/**
+ * Starts a bucket of the given \a span (in msecs) with the given sample
+ */
+static TelemetryHistory::Bucket newBucket (const qint64 time,
+                                           const qint64 span,
+                                           const double value)
+{
+    TelemetryHistory::Bucket bucket;
+    bucket.time = time;
+    bucket.span = span;
+    bucket.min = value;
+    bucket.max = value;
+    bucket.sum = value;
+    bucket.count = 1;
+    return bucket;
+}
+
+/**
+ * Adds the values of the \a source bucket to the \a target bucket
+ */
+static void mergeBucket (TelemetryHistory::Bucket& target,
+                         const TelemetryHistory::Bucket& source)
+{
+    target.min = qMin (target.min, source.min);
+    target.max = qMax (target.max, source.max);
+    target.sum += source.sum;
+    target.count += source.count;
+}
+
+/**
+ * Returns the time of the oldest value of the given \a tier of the channel
+ * \a data (-1 is the full resolution tier), or of the next finer tier if
+ * the \a tier is empty. If there are no samples, \a to + 1 is returned.
+ */
+static qint64 tierStart (const TelemetryHistory::ChannelData& data,
+                         const int tier, const qint64 to)
+{
+    if (tier < 0)
+        return data.raw.isEmpty() ? to + 1 : data.raw.first().time;
+
+    if (!data.tiers [tier].closed.isEmpty())
+        return data.tiers [tier].closed.first().time;
+    if (data.tiers [tier].open.count > 0)
+        return data.tiers [tier].open.time;
+
+    return tierStart (data, tier - 1, to);
+}
+
+/**
+ * Allocates the ring buffers of every channel and starts recording the
+ * values reported by the \c DriverStation
+ */
+TelemetryHistory::TelemetryHistory()
+{
+    for (int i = 0; i < TelemetryLog::Messages; ++i) {
+        m_channels [i].raw = TelemetryRing<Sample> (HISTORY_RAW_SIZE);
+        m_channels [i].tiers [0].closed = TelemetryRing<Bucket> (HISTORY_SHORT_SIZE);
+        m_channels [i].tiers [1].closed = TelemetryRing<Bucket> (HISTORY_LONG_SIZE);
+        m_channels [i].tiers [0].open.count = 0;
+        m_channels [i].tiers [1].open.count = 0;
+    }
+
+    connectSlots();
+}
+
+/**
+ * Returns the only instance of the class
+ */
+TelemetryHistory* TelemetryHistory::getInstance()
+{
+    static TelemetryHistory instance;
+    return &instance;
+}
+
+/**
+ * Returns the values of the given \a channel between the \a from and \a to
+ * times, merged into (at most) the given number of \a buckets.
+ *
+ * The values are read from the finest tier that still covers the \a from
+ * time, the more recent values are read from the finer tiers.
+ */
+QVector<TelemetryHistory::Bucket> TelemetryHistory::downsample (
+    const TelemetryLog::Channel channel,
+    const qint64 from, const qint64 to,
+    const int buckets) const
+{
+    QVector<Bucket> list;
+    if (channel < 0 || channel >= TelemetryLog::Messages)
+        return list;
+    if (buckets <= 0 || to < from)
+        return list;
+
+    /* Find the finest tier that covers the start time (-1 is full res.) */
+    const ChannelData& data = m_channels [channel];
+    int tier = -1;
+    if (tierStart (data, -1, to) > from) {
+        tier = 0;
+        if (data.tiers [0].closed.isEmpty() ||
+            data.tiers [0].closed.first().time > from)
+            tier = 1;
+    }
+
+    /* Get the buckets of each tier, up to the start of the next tier */
+    QVector<Bucket> values;
+    qint64 cursor = from;
+    for (; tier >= 0; --tier) {
+        const Tier& t = data.tiers [tier];
+        qint64 end = tierStart (data, tier - 1, to);
+
+        for (int i = 0; i <= t.closed.count(); ++i) {
+            const Bucket& bucket = (i < t.closed.count()) ? t.closed.at (i)
+                                                           : t.open;
+            if (bucket.count == 0 || bucket.time < cursor)
+                continue;
+            if (bucket.time + bucket.span > end || bucket.time > to)
+                break;
+
+            values.append (bucket);
+            cursor = bucket.time + bucket.span;
+        }
+    }
+
+    /* Get the samples of the full resolution tier */
+    for (int i = 0; i < data.raw.count(); ++i) {
+        const Sample& sample = data.raw.at (i);
+        if (sample.time >= cursor && sample.time <= to)
+            values.append (newBucket (sample.time, 0, sample.value));
+    }
+
+    /* Merge the values into the requested buckets */
+    double width = qMax (1.0, (double) (to - from + 1) / buckets);
+    int current = -1;
+    for (int i = 0; i < values.count(); ++i) {
+        const Bucket& value = values.at (i);
+        int index = qMin (buckets - 1, (int) ((value.time - from) / width));
+
+        if (index != current || list.isEmpty()) {
+            Bucket bucket = value;
+            bucket.time = from + (qint64) (index * width);
+            bucket.span = (qint64) width;
+            list.append (bucket);
+            current = index;
+        }
+
+        else
+            mergeBucket (list.last(), value);
+    }
+
+    return list;
+}
+
+/**
+ * Returns the time of the oldest value of the given \a channel that is
+ * still in the history (or \c -1 if the channel has no values)
+ */
+qint64 TelemetryHistory::firstTime (const int channel) const
+{
+    if (channel < 0 || channel >= TelemetryLog::Messages)
+        return -1;
+
+    const ChannelData& data = m_channels [channel];
+    for (int tier = 1; tier >= 0; --tier) {
+        if (!data.tiers [tier].closed.isEmpty())
+            return data.tiers [tier].closed.first().time;
+    }
+
+    if (!data.raw.isEmpty())
+        return data.raw.first().time;
+
+    return -1;
+}
+
+/**
+ * Returns the downsampled values of the given \a channel as a list of maps
+ * with the \c time, \c min, \c max and \c mean keys (for plotting with QML)
+ */
+QVariantList TelemetryHistory::series (const int channel,
+                                       const qint64 from,
+                                       const qint64 to,
+                                       const int buckets) const
+{
+    QVariantList list;
+    if (channel < 0 || channel >= TelemetryLog::Messages)
+        return list;
+
+    QVector<Bucket> values = downsample ((TelemetryLog::Channel) channel,
+                                         from, to, buckets);
+    for (int i = 0; i < values.count(); ++i) {
+        QVariantMap map;
+        map.insert ("time", values.at (i).time);
+        map.insert ("min", values.at (i).min);
+        map.insert ("max", values.at (i).max);
+        map.insert ("mean", values.at (i).sum / values.at (i).count);
+        list.append (map);
+    }
+
+    return list;
+}
+
+/**
+ * Removes all the values of the history
+ */
+void TelemetryHistory::clear()
+{
+    for (int i = 0; i < TelemetryLog::Messages; ++i) {
+        m_channels [i].raw.clear();
+        for (int j = 0; j < 2; ++j) {
+            m_channels [i].tiers [j].closed.clear();
+            m_channels [i].tiers [j].open.count = 0;
+        }
+    }
+}
+
+/**
+ * Adds the given sample of a \a channel to every tier of the history.
+ * Samples that are older than the full resolution window are removed,
+ * and the buckets of the other tiers are closed once their span ends.
+ */
+void TelemetryHistory::append (const TelemetryLog::Channel channel,
+                               const qint64 time,
+                               const double value)
+{
+    if (channel < 0 || channel >= TelemetryLog::Messages)
+        return;
+
+    ChannelData& data = m_channels [channel];
+
+    /* Add the sample at full resolution */
+    Sample sample;
+    sample.time = time;
+    sample.value = value;
+    data.raw.append (sample);
+    while (data.raw.first().time < time - HISTORY_RAW_WINDOW)
+        data.raw.removeFirst();
+
+    /* Add the sample to the 1 s and 10 s buckets */
+    const qint64 spans[] = { HISTORY_SHORT_SPAN, HISTORY_LONG_SPAN };
+    for (int i = 0; i < 2; ++i) {
+        Tier& tier = data.tiers [i];
+        qint64 start = time - (time % spans [i]);
+
+        if (tier.open.count > 0 && start > tier.open.time) {
+            tier.closed.append (tier.open);
+            tier.open.count = 0;
+        }
+
+        if (tier.open.count == 0)
+            tier.open = newBucket (start, spans [i], value);
+        else
+            mergeBucket (tier.open, newBucket (start, spans [i], value));
+    }
+}
+
+/**
+ * Records the given \a value of a \a channel with the current time
+ */
+void TelemetryHistory::record (const TelemetryLog::Channel channel,
+                               const double value)
+{
+    append (channel, QDateTime::currentMSecsSinceEpoch(), value);
+}
+
+/**
+ * Records the values reported by the \c DriverStation
+ */
+void TelemetryHistory::connectSlots()
+{
+    DriverStation* ds = DriverStation::getInstance();
+
+    connect (ds, &DriverStation::voltageChanged, this, [this] (float value) {
+        record (TelemetryLog::Voltage, value);
+    });
+    connect (ds, &DriverStation::canUsageChanged, this, [this] (int value) {
+        record (TelemetryLog::CANUsage, value);
+    });
+    connect (ds, &DriverStation::cpuUsageChanged, this, [this] (int value) {
+        record (TelemetryLog::CPUUsage, value);
+    });
+    connect (ds, &DriverStation::ramUsageChanged, this, [this] (int value) {
+        record (TelemetryLog::RAMUsage, value);
+    });
+    connect (ds, &DriverStation::diskUsageChanged, this, [this] (int value) {
+        record (TelemetryLog::DiskUsage, value);
+    });
+    connect (ds, &DriverStation::enabledChanged, this, [this] (bool value) {
+        record (TelemetryLog::Enabled, value);
+    });
+    connect (ds, &DriverStation::robotCodeChanged, this, [this] (bool value) {
+        record (TelemetryLog::RobotCode, value);
+    });
+    connect (ds, &DriverStation::fmsCommunicationsChanged,
+             this, [this] (bool value) {
+        record (TelemetryLog::FMSCommunications, value);
+    });
+    connect (ds, &DriverStation::radioCommunicationsChanged,
+             this, [this] (bool value) {
+        record (TelemetryLog::RadioCommunications, value);
+    });
+    connect (ds, &DriverStation::robotCommunicationsChanged,
+             this, [this] (bool value) {
+        record (TelemetryLog::RobotCommunications, value);
+    });
+    connect (ds, &DriverStation::emergencyStoppedChanged,
+             this, [this] (bool value) {
+        record (TelemetryLog::EmergencyStop, value);
+    });
+    connect (ds, &DriverStation::controlModeChanged,
+             this, [this] (DriverStation::Control mode) {
+        record (TelemetryLog::ControlMode, (int) mode);
+    });
+}
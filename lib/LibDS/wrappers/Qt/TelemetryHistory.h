@@ -0,0 +1,172 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _TELEMETRY_HISTORY_H
+#define _TELEMETRY_HISTORY_H
+
+#include <QObject>
+#include <QVector>
+#include <QVariantList>
+
+#include "TelemetryLog.h"
+
+/*
+ * Size of each tier of the history: the samples of the last few minutes are
+ * kept at full resolution, older values are only kept as 1 s buckets (for
+ * an hour) and as 10 s buckets (for a day)
+ */
+#define HISTORY_RAW_WINDOW  (5 * 60 * 1000)
+#define HISTORY_RAW_SIZE    4096
+#define HISTORY_SHORT_SPAN  1000
+#define HISTORY_SHORT_SIZE  3600
+#define HISTORY_LONG_SPAN   10000
+#define HISTORY_LONG_SIZE   8640
+
+/**
+ * A fixed-size ring buffer, the oldest item is overwritten when the buffer
+ * is full
+ */
+template <typename T>
+class TelemetryRing
+{
+public:
+    TelemetryRing (const int capacity = 0) :
+        m_first (0),
+        m_count (0),
+        m_items (capacity) {}
+
+    int count() const { return m_count; }
+    bool isEmpty() const { return m_count == 0; }
+    const T& first() const { return at (0); }
+    const T& last() const { return at (m_count - 1); }
+    const T& at (const int i) const
+    {
+        return m_items.at ((m_first + i) % m_items.count());
+    }
+
+    void clear()
+    {
+        m_first = 0;
+        m_count = 0;
+    }
+
+    void removeFirst()
+    {
+        m_first = (m_first + 1) % m_items.count();
+        --m_count;
+    }
+
+    void append (const T& item)
+    {
+        if (m_count == m_items.count())
+            removeFirst();
+
+        m_items [(m_first + m_count) % m_items.count()] = item;
+        ++m_count;
+    }
+
+private:
+    int m_first;
+    int m_count;
+    QVector<T> m_items;
+};
+
+/**
+ * Keeps the recent values of the numeric telemetry channels of the
+ * \c DriverStation in memory, so that charts can be drawn without reading
+ * the telemetry log. The history uses a constant amount of memory:
+ *
+ *   - Samples of the last \c HISTORY_RAW_WINDOW msecs, at full resolution
+ *   - Minimum/maximum/mean of each second, for the last hour
+ *   - Minimum/maximum/mean of every ten seconds, for the last day
+ */
+class TelemetryHistory : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * A sample of a channel
+     */
+    struct Sample {
+        qint64 time;
+        double value;
+    };
+
+    /**
+     * The minimum, maximum and mean values of a channel during a time
+     * bucket (or over several samples)
+     */
+    struct Bucket {
+        qint64 time;
+        qint64 span;
+        double min;
+        double max;
+        double sum;
+        quint32 count;
+    };
+
+    /**
+     * The values of a channel at full resolution, and in 1 s and 10 s
+     * buckets (the last bucket of each tier is still open)
+     */
+    struct Tier {
+        Bucket open;
+        TelemetryRing<Bucket> closed;
+    };
+
+    struct ChannelData {
+        TelemetryRing<Sample> raw;
+        Tier tiers [2];
+    };
+
+    static TelemetryHistory* getInstance();
+
+    QVector<Bucket> downsample (const TelemetryLog::Channel channel,
+                                const qint64 from, const qint64 to,
+                                const int buckets) const;
+
+    Q_INVOKABLE qint64 firstTime (const int channel) const;
+    Q_INVOKABLE QVariantList series (const int channel,
+                                     const qint64 from,
+                                     const qint64 to,
+                                     const int buckets) const;
+
+public slots:
+    void clear();
+    void append (const TelemetryLog::Channel channel,
+                 const qint64 time,
+                 const double value);
+
+private:
+    TelemetryHistory();
+
+    void connectSlots();
+    void record (const TelemetryLog::Channel channel, const double value);
+
+private:
+    ChannelData m_channels [TelemetryLog::Messages];
+};
+
+#endif
@@ -0,0 +1,355 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "TelemetryLog.h"
+
+#include <math.h>
+#include <LibDS.h>
+#include <QtEndian>
+
+/*
+ * Chunks are sealed when they span more than CHUNK_INTERVAL milliseconds
+ * or when their columns hold more than CHUNK_SIZE bytes
+ */
+#define CHUNK_INTERVAL 2000
+#define CHUNK_SIZE     (64 * 1024)
+
+/**
+ * Appends the given unsigned \a value to the \a data as a varint
+ */
+static void putVarint (QByteArray& data, quint64 value)
+{
+    while (value >= 0x80) {
+        data.append ((char) ((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+
+    data.append ((char) value);
+}
+
+/**
+ * Appends the given signed \a value to the \a data as a zigzag varint
+ */
+static void putSigned (QByteArray& data, const qint64 value)
+{
+    putVarint (data, ((quint64) value << 1) ^ (quint64) (value >> 63));
+}
+
+/**
+ * Appends the given integer \a value to the \a data (little-endian)
+ */
+template <typename T>
+static void putInteger (QByteArray& data, const T value)
+{
+    char bytes [sizeof (T)];
+    qToLittleEndian<T> (value, (uchar*) bytes);
+    data.append (bytes, sizeof (T));
+}
+
+/**
+ * Opens the log file and writes its \a header
+ */
+void TelemetryWriter::open (const QString& path, const QByteArray& header)
+{
+    close();
+
+    m_file.setFileName (path);
+    if (m_file.open (QFile::WriteOnly | QFile::Truncate)) {
+        m_file.write (header);
+        m_file.flush();
+    }
+}
+
+/**
+ * Appends the given \a chunk to the log file. The chunk is flushed to the
+ * operating system immediately, so it is kept if the application crashes.
+ */
+void TelemetryWriter::write (const QByteArray& chunk,
+                             const qint64 first,
+                             const qint64 last)
+{
+    if (!m_file.isOpen())
+        return;
+
+    IndexEntry entry;
+    entry.first = first;
+    entry.last = last;
+    entry.offset = (quint64) m_file.pos();
+
+    if (m_file.write (chunk) == chunk.size()) {
+        m_index.append (entry);
+        m_file.flush();
+    }
+}
+
+/**
+ * Writes the chunk index at the end of the log file and closes it
+ */
+void TelemetryWriter::close()
+{
+    if (!m_file.isOpen())
+        return;
+
+    QByteArray footer;
+    quint64 offset = (quint64) m_file.pos();
+    footer.append (TELEMETRY_INDEX_MAGIC, 4);
+    putInteger<quint32> (footer, (quint32) m_index.count());
+    for (int i = 0; i < m_index.count(); ++i) {
+        putInteger<qint64> (footer, m_index.at (i).first);
+        putInteger<qint64> (footer, m_index.at (i).last);
+        putInteger<quint64> (footer, m_index.at (i).offset);
+    }
+
+    putInteger<quint64> (footer, offset);
+    footer.append (TELEMETRY_END_MAGIC, 4);
+
+    m_file.write (footer);
+    m_file.close();
+    m_index.clear();
+}
+
+/**
+ * Starts the writer thread
+ */
+TelemetryLog::TelemetryLog()
+{
+    m_open = false;
+    m_lastTime = 0;
+    m_firstTime = 0;
+
+    for (int i = 0; i < ChannelCount; ++i) {
+        m_columns [i].count = 0;
+        m_columns [i].lastTime = 0;
+        m_columns [i].lastValue = 0;
+    }
+
+    m_writer = new TelemetryWriter;
+    m_writer->moveToThread (&m_thread);
+
+    connect (&m_thread, SIGNAL (finished()), m_writer, SLOT (deleteLater()));
+    connect (this,     &TelemetryLog::openRequested,
+             m_writer, &TelemetryWriter::open);
+    connect (this,     &TelemetryLog::chunkReady,
+             m_writer, &TelemetryWriter::write);
+
+    m_thread.start (QThread::LowPriority);
+}
+
+/**
+ * Writes the pending samples and the chunk index, then stops the writer
+ * thread
+ */
+TelemetryLog::~TelemetryLog()
+{
+    close();
+    m_thread.quit();
+    m_thread.wait();
+}
+
+/**
+ * Returns the number of decimals stored for the values of the given
+ * \a channel
+ */
+int TelemetryLog::decimals (const Channel channel)
+{
+    return (channel == Voltage) ? 2 : 0;
+}
+
+/**
+ * Returns the encoding of the values of the given \a channel
+ */
+TelemetryLog::Encoding TelemetryLog::encoding (const Channel channel)
+{
+    return (channel == Messages) ? TextEncoding : IntegerEncoding;
+}
+
+/**
+ * Returns \c true if the log file is open
+ */
+bool TelemetryLog::isOpen() const
+{
+    return m_open;
+}
+
+/**
+ * Writes the pending samples and the chunk index to the log file and
+ * closes it (the writer thread processes all the pending chunks first)
+ */
+void TelemetryLog::close()
+{
+    if (!m_open)
+        return;
+
+    flush (true);
+    m_open = false;
+
+    if (m_thread.isRunning())
+        QMetaObject::invokeMethod (m_writer, "close",
+                                   Qt::BlockingQueuedConnection);
+}
+
+/**
+ * Seals the current chunk and sends it to the writer thread. If \a force is
+ * \c false, the chunk is only sealed once it spans \c CHUNK_INTERVAL
+ * milliseconds.
+ */
+void TelemetryLog::flush (const bool force)
+{
+    if (!m_open)
+        return;
+
+    /* Get the columns that have samples */
+    int i;
+    int size = 0;
+    int columns = 0;
+    for (i = 0; i < ChannelCount; ++i) {
+        if (m_columns [i].count > 0) {
+            size += m_columns [i].data.size();
+            ++columns;
+        }
+    }
+
+    /* Nothing to write, or chunk is too recent */
+    if (columns == 0)
+        return;
+    if (!force && m_lastTime - m_firstTime < CHUNK_INTERVAL && size < CHUNK_SIZE)
+        return;
+
+    /* Encode the columns */
+    QByteArray body;
+    body.reserve (size + columns * 11);
+    for (i = 0; i < ChannelCount; ++i) {
+        Column* column = &m_columns [i];
+        if (column->count == 0)
+            continue;
+
+        Channel channel = (Channel) i;
+        body.append ((char) i);
+        body.append ((char) encoding (channel));
+        body.append ((char) decimals (channel));
+        putInteger<quint32> (body, column->count);
+        putInteger<quint32> (body, (quint32) column->data.size());
+        body.append (column->data);
+
+        column->count = 0;
+        column->lastValue = 0;
+        column->data.clear();
+    }
+
+    /* Build the chunk */
+    QByteArray chunk;
+    chunk.reserve (body.size() + 33);
+    chunk.append (TELEMETRY_CHUNK_MAGIC, 4);
+    putInteger<quint32> (chunk, (quint32) (body.size() + 21));
+    putInteger<qint64> (chunk, m_firstTime);
+    putInteger<qint64> (chunk, m_lastTime);
+    chunk.append ((char) columns);
+    chunk.append (body);
+    putInteger<quint32> (chunk, DS_CRC32 (body.constData(), body.size()));
+
+    emit chunkReady (chunk, m_firstTime, m_lastTime);
+    m_firstTime = 0;
+    m_lastTime = 0;
+}
+
+/**
+ * Creates the log file at the given \a path
+ *
+ * \param path the location of the log file
+ * \param time the creation time (in milliseconds since the epoch)
+ */
+bool TelemetryLog::open (const QString& path, const qint64 time)
+{
+    close();
+
+    QByteArray header;
+    header.append (TELEMETRY_MAGIC, 4);
+    header.append ((char) TELEMETRY_VERSION);
+    header.append (3, (char) 0);
+    putInteger<qint64> (header, time);
+
+    emit openRequested (path, header);
+    m_open = true;
+    return true;
+}
+
+/**
+ * Records the \a value of the given \a channel at the given \a time
+ */
+void TelemetryLog::append (const Channel channel,
+                           const qint64 time,
+                           const double value)
+{
+    if (!m_open || encoding (channel) != IntegerEncoding)
+        return;
+
+    addTime (channel, time);
+
+    Column* column = &m_columns [channel];
+    qint64 quantized = qRound64 (value * pow (10, decimals (channel)));
+    putSigned (column->data, quantized - column->lastValue);
+    column->lastValue = quantized;
+
+    if (column->data.size() >= CHUNK_SIZE)
+        flush (true);
+}
+
+/**
+ * Records the given NetConsole \a text at the given \a time
+ */
+void TelemetryLog::appendText (const qint64 time, const QString& text)
+{
+    if (!m_open)
+        return;
+
+    addTime (Messages, time);
+
+    Column* column = &m_columns [Messages];
+    QByteArray utf8 = text.toUtf8();
+    putVarint (column->data, (quint64) utf8.size());
+    column->data.append (utf8);
+
+    if (column->data.size() >= CHUNK_SIZE)
+        flush (true);
+}
+
+/**
+ * Registers a new sample of the given \a channel and writes its time delta
+ */
+void TelemetryLog::addTime (const Channel channel, const qint64 time)
+{
+    /* The first sample of the chunk defines its base time */
+    if (m_firstTime == 0) {
+        m_firstTime = time;
+        m_lastTime = time;
+    }
+
+    Column* column = &m_columns [channel];
+    qint64 previous = (column->count > 0) ? column->lastTime : m_firstTime;
+    putSigned (column->data, time - previous);
+
+    column->lastTime = time;
+    column->count += 1;
+
+    m_lastTime = qMax (m_lastTime, time);
+}
@@ -0,0 +1,163 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _TELEMETRY_LOG_H
+#define _TELEMETRY_LOG_H
+
+#include <QFile>
+#include <QThread>
+#include <QVector>
+#include <QObject>
+#include <QByteArray>
+
+/*
+ * Telemetry log format (all integers are little-endian):
+ *
+ *   Header:  "DSTL", u8 version, 3 reserved bytes, i64 creation time (ms)
+ *
+ *   Chunk:   "CHNK", u32 size of the rest of the chunk,
+ *            i64 base time (of the first sample), i64 last sample time,
+ *            u8 column count, columns, u32 CRC32 of the columns (u16
+ *            qChecksum() of the columns in version 1 logs)
+ *
+ *   Column:  u8 channel, u8 encoding, u8 decimals, u32 sample count,
+ *            u32 data size, data
+ *
+ *   Footer:  "INDX", u32 chunk count,
+ *            (i64 first time, i64 last time, u64 chunk offset) per chunk,
+ *            u64 footer offset, "DSTE"
+ *
+ * Each sample of a column is stored as the zigzag varint delta of its time
+ * (from the previous sample, or from the base time of the chunk) followed
+ * by the zigzag varint delta of its value (integer encoding), or by the
+ * varint length and UTF-8 bytes of its text (text encoding). Real values
+ * are stored as integers with the given number of decimals.
+ *
+ * The footer is only written when the log is closed, if it is missing (e.g.
+ * after a crash) the chunks can still be read sequentially.
+ */
+#define TELEMETRY_MAGIC        "DSTL"
+#define TELEMETRY_CHUNK_MAGIC  "CHNK"
+#define TELEMETRY_INDEX_MAGIC  "INDX"
+#define TELEMETRY_END_MAGIC    "DSTE"
+#define TELEMETRY_VERSION      2
+#define TELEMETRY_HEADER_SIZE  16
+#define TELEMETRY_TRAILER_SIZE 12
+
+/**
+ * Receives the encoded chunks and appends them to the log file in a
+ * background thread, the chunk index is written when the log is closed
+ */
+class TelemetryWriter : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void open (const QString& path, const QByteArray& header);
+    void write (const QByteArray& chunk, const qint64 first, const qint64 last);
+    void close();
+
+private:
+    struct IndexEntry {
+        qint64 first;
+        qint64 last;
+        quint64 offset;
+    };
+
+    QFile m_file;
+    QVector<IndexEntry> m_index;
+};
+
+/**
+ * Encodes telemetry samples into compact, column-oriented chunks and sends
+ * the chunks to a \c TelemetryWriter running in its own thread, so that the
+ * memory used by the log does not grow with the duration of the session
+ */
+class TelemetryLog : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Channel {
+        Voltage,
+        CANUsage,
+        CPUUsage,
+        RAMUsage,
+        DiskUsage,
+        Enabled,
+        RobotCode,
+        FMSCommunications,
+        RadioCommunications,
+        RobotCommunications,
+        EmergencyStop,
+        ControlMode,
+        Messages,
+        ChannelCount,
+    };
+
+    enum Encoding {
+        IntegerEncoding,
+        TextEncoding,
+    };
+
+    TelemetryLog();
+    ~TelemetryLog();
+
+    static int decimals (const Channel channel);
+    static Encoding encoding (const Channel channel);
+
+    bool isOpen() const;
+
+public slots:
+    void close();
+    void flush (const bool force = true);
+    bool open (const QString& path, const qint64 time);
+    void append (const Channel channel, const qint64 time, const double value);
+    void appendText (const qint64 time, const QString& text);
+
+signals:
+    void openRequested (const QString& path, const QByteArray& header);
+    void chunkReady (const QByteArray& chunk,
+                     const qint64 first,
+                     const qint64 last);
+
+private:
+    void addTime (const Channel channel, const qint64 time);
+
+private:
+    struct Column {
+        quint32 count;
+        QByteArray data;
+        qint64 lastTime;
+        qint64 lastValue;
+    };
+
+    bool m_open;
+    qint64 m_firstTime;
+    qint64 m_lastTime;
+    QThread m_thread;
+    TelemetryWriter* m_writer;
+    Column m_columns [ChannelCount];
+};
+
+#endif
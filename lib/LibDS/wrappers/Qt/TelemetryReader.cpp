@@ -0,0 +1,498 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "TelemetryReader.h"
+
+#include <math.h>
+#include <string.h>
+#include <LibDS.h>
+#include <QtEndian>
+
+/*
+ * Size of the fixed part of a chunk (magic, size, base time, last time
+ * and column count), of a column header and of an index entry
+ */
+#define CHUNK_HEADER_SIZE  25
+#define COLUMN_HEADER_SIZE 11
+#define INDEX_ENTRY_SIZE   24
+
+/**
+ * Reads an unsigned varint from \a data (without reading past \a end)
+ *
+ * \returns \c false if the varint is truncated
+ */
+static bool getVarint (const uchar** data, const uchar* end, quint64* value)
+{
+    int shift = 0;
+    *value = 0;
+
+    while (*data < end && shift < 64) {
+        uchar byte = *(*data)++;
+        *value |= (quint64) (byte & 0x7F) << shift;
+
+        if (!(byte & 0x80))
+            return true;
+
+        shift += 7;
+    }
+
+    return false;
+}
+
+/**
+ * Reads a zigzag varint from \a data (without reading past \a end)
+ */
+static bool getSigned (const uchar** data, const uchar* end, qint64* value)
+{
+    quint64 raw;
+    if (!getVarint (data, end, &raw))
+        return false;
+
+    *value = (qint64) (raw >> 1) ^ - (qint64) (raw & 1);
+    return true;
+}
+
+/**
+ * Reads a little-endian integer at the given \a offset of the mapped file
+ */
+template <typename T>
+static T getInteger (const uchar* data, const qint64 offset)
+{
+    return qFromLittleEndian<T> (data + offset);
+}
+
+/**
+ * Creates a reader without any open file
+ */
+TelemetryReader::TelemetryReader (QObject* parent) : QObject (parent)
+{
+    m_size = 0;
+    m_data = nullptr;
+    m_creationTime = 0;
+    m_version = 0;
+}
+
+/**
+ * Unmaps the open file
+ */
+TelemetryReader::~TelemetryReader()
+{
+    close();
+}
+
+/**
+ * Returns \c true if a telemetry log is open
+ */
+bool TelemetryReader::isOpen() const
+{
+    return m_data != nullptr;
+}
+
+/**
+ * Returns the time of the last sample of the log
+ */
+qint64 TelemetryReader::lastTime() const
+{
+    if (m_chunks.isEmpty())
+        return m_creationTime;
+
+    return m_chunks.last().last;
+}
+
+/**
+ * Returns the time of the first sample of the log
+ */
+qint64 TelemetryReader::firstTime() const
+{
+    if (m_chunks.isEmpty())
+        return m_creationTime;
+
+    return m_chunks.first().first;
+}
+
+/**
+ * Returns the time in which the log was created
+ */
+qint64 TelemetryReader::creationTime() const
+{
+    return m_creationTime;
+}
+
+/**
+ * Returns the samples of the given \a channel between the \a from and \a to
+ * times (in milliseconds since the epoch)
+ */
+QVector<TelemetryReader::Sample> TelemetryReader::samples (
+    const TelemetryLog::Channel channel,
+    const qint64 from, const qint64 to) const
+{
+    QVector<Sample> list;
+    if (!isOpen() || TelemetryLog::encoding (channel) != TelemetryLog::IntegerEncoding)
+        return list;
+
+    for (int i = firstChunk (from); i < m_chunks.count(); ++i) {
+        const Chunk& chunk = m_chunks.at (i);
+        if (chunk.first > to)
+            break;
+
+        /* Get the column of the channel */
+        int decimals;
+        quint32 count, size;
+        const uchar* data;
+        if (!findColumn (chunk, channel, &data, &count, &size, &decimals))
+            continue;
+
+        /* Decode the samples */
+        qint64 time = chunk.first;
+        qint64 value = 0;
+        double scale = pow (10, -decimals);
+        const uchar* end = data + size;
+        for (quint32 j = 0; j < count; ++j) {
+            qint64 dt, dv;
+            if (!getSigned (&data, end, &dt) || !getSigned (&data, end, &dv))
+                break;
+
+            time += dt;
+            value += dv;
+
+            if (time >= from && time <= to) {
+                Sample sample;
+                sample.time = time;
+                sample.value = value * scale;
+                list.append (sample);
+            }
+        }
+    }
+
+    return list;
+}
+
+/**
+ * Splits the given time range in the given number of \a buckets and
+ * returns the minimum and maximum values of the \a channel in each bucket,
+ * which preserves the peaks when plotting long periods of time. Buckets
+ * without samples are omitted.
+ */
+QVector<TelemetryReader::Bucket> TelemetryReader::downsample (
+    const TelemetryLog::Channel channel,
+    const qint64 from, const qint64 to,
+    const int buckets) const
+{
+    QVector<Bucket> list;
+    if (buckets <= 0 || to < from)
+        return list;
+
+    QVector<Sample> values = samples (channel, from, to);
+    double width = qMax (1.0, (double) (to - from + 1) / buckets);
+
+    int current = -1;
+    for (int i = 0; i < values.count(); ++i) {
+        const Sample& sample = values.at (i);
+        int index = qMin (buckets - 1, (int) ((sample.time - from) / width));
+
+        if (index != current || list.isEmpty()) {
+            Bucket bucket;
+            bucket.time = from + (qint64) (index * width);
+            bucket.min = sample.value;
+            bucket.max = sample.value;
+            list.append (bucket);
+            current = index;
+        }
+
+        else {
+            list.last().min = qMin (list.last().min, sample.value);
+            list.last().max = qMax (list.last().max, sample.value);
+        }
+    }
+
+    return list;
+}
+
+/**
+ * Returns the NetConsole messages received between the \a from and \a to
+ * times
+ */
+QVector<QPair<qint64, QString>> TelemetryReader::messages (
+    const qint64 from, const qint64 to) const
+{
+    QVector<QPair<qint64, QString>> list;
+    if (!isOpen())
+        return list;
+
+    for (int i = firstChunk (from); i < m_chunks.count(); ++i) {
+        const Chunk& chunk = m_chunks.at (i);
+        if (chunk.first > to)
+            break;
+
+        int decimals;
+        quint32 count, size;
+        const uchar* data;
+        if (!findColumn (chunk, TelemetryLog::Messages,
+                         &data, &count, &size, &decimals))
+            continue;
+
+        qint64 time = chunk.first;
+        const uchar* end = data + size;
+        for (quint32 j = 0; j < count; ++j) {
+            qint64 dt;
+            quint64 len;
+            if (!getSigned (&data, end, &dt) || !getVarint (&data, end, &len))
+                break;
+            if (len > (quint64) (end - data))
+                break;
+
+            time += dt;
+            if (time >= from && time <= to)
+                list.append (qMakePair (time,
+                                        QString::fromUtf8 ((const char*) data,
+                                                           (int) len)));
+
+            data += len;
+        }
+    }
+
+    return list;
+}
+
+/**
+ * Returns the downsampled values of the given \a channel as a list of maps
+ * with the \c time, \c min and \c max keys (for plotting with QML)
+ */
+QVariantList TelemetryReader::series (const int channel,
+                                      const qint64 from,
+                                      const qint64 to,
+                                      const int buckets) const
+{
+    QVariantList list;
+    if (channel < 0 || channel >= TelemetryLog::ChannelCount)
+        return list;
+
+    QVector<Bucket> values = downsample ((TelemetryLog::Channel) channel,
+                                         from, to, buckets);
+    for (int i = 0; i < values.count(); ++i) {
+        QVariantMap map;
+        map.insert ("time", values.at (i).time);
+        map.insert ("min", values.at (i).min);
+        map.insert ("max", values.at (i).max);
+        list.append (map);
+    }
+
+    return list;
+}
+
+/**
+ * Unmaps and closes the current log file
+ */
+void TelemetryReader::close()
+{
+    if (m_data)
+        m_file.unmap (m_data);
+
+    m_size = 0;
+    m_data = nullptr;
+    m_creationTime = 0;
+    m_version = 0;
+    m_chunks.clear();
+
+    if (m_file.isOpen()) {
+        m_file.close();
+        emit fileChanged();
+    }
+}
+
+/**
+ * Maps the log file at the given \a path and loads its chunk index
+ *
+ * \returns \c true on success
+ */
+bool TelemetryReader::open (const QString& path)
+{
+    close();
+
+    /* Map the file */
+    m_file.setFileName (path);
+    if (!m_file.open (QFile::ReadOnly))
+        return false;
+
+    m_size = m_file.size();
+    if (m_size >= TELEMETRY_HEADER_SIZE)
+        m_data = m_file.map (0, m_size);
+
+    /* Check the header */
+    if (!m_data || memcmp (m_data, TELEMETRY_MAGIC, 4) != 0 ||
+            m_data [4] > TELEMETRY_VERSION) {
+        close();
+        return false;
+    }
+
+    /* Use the index of the file, or find the chunks if it is missing */
+    m_version = m_data [4];
+    m_creationTime = getInteger<qint64> (m_data, 8);
+    if (!readIndex())
+        scanChunks();
+
+    emit fileChanged();
+    return true;
+}
+
+/**
+ * Loads the chunk index from the footer of the file
+ *
+ * \returns \c false if the file has no (valid) footer
+ */
+bool TelemetryReader::readIndex()
+{
+    if (m_size < TELEMETRY_HEADER_SIZE + TELEMETRY_TRAILER_SIZE + 8)
+        return false;
+
+    /* Check the trailer */
+    if (memcmp (m_data + m_size - 4, TELEMETRY_END_MAGIC, 4) != 0)
+        return false;
+
+    /* Check the footer */
+    qint64 offset = (qint64) getInteger<quint64> (m_data, m_size - 12);
+    if (offset < TELEMETRY_HEADER_SIZE || offset + 8 > m_size ||
+            memcmp (m_data + offset, TELEMETRY_INDEX_MAGIC, 4) != 0)
+        return false;
+
+    quint32 count = getInteger<quint32> (m_data, offset + 4);
+    if (offset + 8 + (qint64) count * INDEX_ENTRY_SIZE + TELEMETRY_TRAILER_SIZE != m_size)
+        return false;
+
+    /* Read the entries */
+    m_chunks.resize ((int) count);
+    for (quint32 i = 0; i < count; ++i) {
+        qint64 entry = offset + 8 + (qint64) i * INDEX_ENTRY_SIZE;
+        m_chunks [i].first = getInteger<qint64> (m_data, entry);
+        m_chunks [i].last = getInteger<qint64> (m_data, entry + 8);
+        m_chunks [i].offset = getInteger<quint64> (m_data, entry + 16);
+    }
+
+    return true;
+}
+
+/**
+ * Builds the chunk index by reading the chunk headers, the scan stops at
+ * the first incomplete or corrupted chunk (e.g. the one that was being
+ * written when the application crashed)
+ */
+void TelemetryReader::scanChunks()
+{
+    qint64 offset = TELEMETRY_HEADER_SIZE;
+    while (offset + CHUNK_HEADER_SIZE <= m_size) {
+        if (memcmp (m_data + offset, TELEMETRY_CHUNK_MAGIC, 4) != 0)
+            break;
+
+        qint64 size = getInteger<quint32> (m_data, offset + 4);
+        if (size < CHUNK_HEADER_SIZE - 8 + checksumSize() ||
+                offset + 8 + size > m_size)
+            break;
+
+        /* Verify the checksum of the columns */
+        const char* body = (const char*) m_data + offset + CHUNK_HEADER_SIZE;
+        uint bodySize = (uint) (size - (CHUNK_HEADER_SIZE - 8)
+                                - checksumSize());
+        qint64 checksumOffset = offset + 8 + size - checksumSize();
+        if (m_version >= 2) {
+            if (DS_CRC32 (body, bodySize) !=
+                    getInteger<quint32> (m_data, checksumOffset))
+                break;
+        }
+
+        else if (qChecksum (body, bodySize) !=
+                 getInteger<quint16> (m_data, checksumOffset))
+            break;
+
+        Chunk chunk;
+        chunk.first = getInteger<qint64> (m_data, offset + 8);
+        chunk.last = getInteger<qint64> (m_data, offset + 16);
+        chunk.offset = (quint64) offset;
+        m_chunks.append (chunk);
+
+        offset += 8 + size;
+    }
+}
+
+/**
+ * Returns the first chunk that may contain samples after the \a from time
+ */
+int TelemetryReader::firstChunk (const qint64 from) const
+{
+    int low = 0;
+    int high = m_chunks.count();
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (m_chunks.at (mid).last < from)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+/**
+ * Finds the column of the given \a channel in the given \a chunk
+ *
+ * \returns \c false if the chunk has no samples of the channel
+ */
+bool TelemetryReader::findColumn (const Chunk& chunk, const int channel,
+                                  const uchar** data, quint32* count,
+                                  quint32* size, int* decimals) const
+{
+    qint64 offset = (qint64) chunk.offset;
+    if (offset + CHUNK_HEADER_SIZE > m_size)
+        return false;
+
+    qint64 end = offset + 8 + getInteger<quint32> (m_data, offset + 4)
+                 - checksumSize();
+    int columns = m_data [offset + 24];
+    offset += CHUNK_HEADER_SIZE;
+
+    for (int i = 0; i < columns && offset + COLUMN_HEADER_SIZE <= end; ++i) {
+        quint32 bytes = getInteger<quint32> (m_data, offset + 7);
+        if (offset + COLUMN_HEADER_SIZE + bytes > end)
+            return false;
+
+        if (m_data [offset] == channel) {
+            *decimals = m_data [offset + 2];
+            *count = getInteger<quint32> (m_data, offset + 3);
+            *size = bytes;
+            *data = m_data + offset + COLUMN_HEADER_SIZE;
+            return true;
+        }
+
+        offset += COLUMN_HEADER_SIZE + bytes;
+    }
+
+    return false;
+}
+
+/**
+ * Returns the size of the checksum at the end of each chunk, which depends
+ * on the version of the log
+ */
+int TelemetryReader::checksumSize() const
+{
+    return m_version >= 2 ? 4 : 2;
+}
@@ -0,0 +1,129 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _TELEMETRY_READER_H
+#define _TELEMETRY_READER_H
+
+#include <QFile>
+#include <QPair>
+#include <QVector>
+#include <QObject>
+#include <QVariantList>
+
+#include "TelemetryLog.h"
+
+/**
+ * Reads the telemetry logs written by \c TelemetryLog.
+ *
+ * The log file is memory-mapped and only the chunks that overlap the
+ * requested time range are decoded (they are found with the chunk index
+ * of the file, or with a quick scan of the chunk headers if the log was not
+ * closed properly), so large logs can be explored without loading them.
+ */
+class TelemetryReader : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY (bool isOpen
+                READ isOpen
+                NOTIFY fileChanged)
+    Q_PROPERTY (qint64 firstTime
+                READ firstTime
+                NOTIFY fileChanged)
+    Q_PROPERTY (qint64 lastTime
+                READ lastTime
+                NOTIFY fileChanged)
+    Q_PROPERTY (qint64 creationTime
+                READ creationTime
+                NOTIFY fileChanged)
+
+public:
+    /**
+     * A sample of a channel
+     */
+    struct Sample {
+        qint64 time;
+        double value;
+    };
+
+    /**
+     * The minimum and maximum values of a channel during a time bucket
+     */
+    struct Bucket {
+        qint64 time;
+        double min;
+        double max;
+    };
+
+    TelemetryReader (QObject* parent = nullptr);
+    ~TelemetryReader();
+
+    bool isOpen() const;
+    qint64 lastTime() const;
+    qint64 firstTime() const;
+    qint64 creationTime() const;
+
+    QVector<Sample> samples (const TelemetryLog::Channel channel,
+                             const qint64 from, const qint64 to) const;
+    QVector<Bucket> downsample (const TelemetryLog::Channel channel,
+                                const qint64 from, const qint64 to,
+                                const int buckets) const;
+    QVector<QPair<qint64, QString>> messages (const qint64 from,
+                                              const qint64 to) const;
+
+    Q_INVOKABLE QVariantList series (const int channel,
+                                     const qint64 from,
+                                     const qint64 to,
+                                     const int buckets) const;
+
+public slots:
+    void close();
+    bool open (const QString& path);
+
+signals:
+    void fileChanged();
+
+private:
+    struct Chunk {
+        qint64 first;
+        qint64 last;
+        quint64 offset;
+    };
+
+    bool readIndex();
+    void scanChunks();
+    int firstChunk (const qint64 from) const;
+    bool findColumn (const Chunk& chunk, const int channel,
+                     const uchar** data, quint32* count,
+                     quint32* size, int* decimals) const;
+    int checksumSize() const;
+
+private:
+    QFile m_file;
+    uchar* m_data;
+    qint64 m_size;
+    qint64 m_creationTime;
+    int m_version;
+    QVector<Chunk> m_chunks;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#-------------------------------------------------------------------------------
+# Qt configuration
+#-------------------------------------------------------------------------------
+
+QT += qml
+
+CONFIG += console
+CONFIG -= app_bundle
+
+#-------------------------------------------------------------------------------
+# Deploy options
+#-------------------------------------------------------------------------------
+
+TARGET = libds-qt-bench
+
+#-------------------------------------------------------------------------------
+# Include libraries
+#-------------------------------------------------------------------------------
+
+include ($$PWD/../LibDS-Qt.pri)
+
+unix:!macx* {
+    LIBS += -pthread
+}
+
+win32* {
+    LIBS += -lws2_32
+}
+
+#-------------------------------------------------------------------------------
+# Import source code
+#-------------------------------------------------------------------------------
+
+SOURCES += \
+    $$PWD/src/main.cpp
@@ -0,0 +1,398 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Floods the LibDS with synthetic events (robot voltage at 50 Hz, NetConsole
+ * messages at 5 kHz and flapping robot communications) and measures how the
+ * Qt wrapper keeps up with them:
+ *
+ *   - The cost of DriverStation::processEvents() per LibDS event
+ *   - The latency between the creation of an event and the QML handler of
+ *     the signal that it causes
+ *   - The occupancy of the GUI thread while the flood lasts
+ *
+ * The flood is run with the per-property signals, with the event thread and
+ * with the telemetry frames, so that changes to the event delivery can be
+ * compared by running this program before and after them.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include <QAtomicInteger>
+#include <QAbstractEventDispatcher>
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QQmlComponent>
+#include <QQmlContext>
+#include <QQmlEngine>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+
+#include <LibDS.h>
+#include <DS_Config.h>
+
+#include "DriverStation.h"
+
+#define COST_EVENTS      10000
+#define FLOOD_DURATION   5000
+#define VOLTAGE_RATE     50
+#define NETCONSOLE_RATE  5000
+#define FLAP_INTERVAL    250
+#define VOLTAGE_STEPS    100
+
+/*
+ * QML consumers of the different scenarios, every handler reports the
+ * signal to the latency probe
+ */
+static const char* SIGNALS_QML =
+    "import QtQml 2.2\n"
+    "Connections {\n"
+    "    target: DS\n"
+    "    onVoltageChanged: Probe.record()\n"
+    "    onNewMessage: Probe.record()\n"
+    "    onNewMessages: Probe.record()\n"
+    "    onRobotCommunicationsChanged: Probe.record()\n"
+    "}\n";
+static const char* FRAMES_QML =
+    "import QtQml 2.2\n"
+    "Connections {\n"
+    "    target: DS\n"
+    "    onTelemetryFrame: Probe.recordFrame (frame.voltage)\n"
+    "    onNewMessages: Probe.record()\n"
+    "}\n";
+
+/*
+ * Time (in usecs) in which each of the voltage steps was last submitted,
+ * used to measure the latency of the telemetry frames (the frames are not
+ * emitted while an event is handled, so their event time is meaningless)
+ */
+static QAtomicInteger<quint64> voltage_times [VOLTAGE_STEPS];
+
+/**
+ * Returns the voltage of the given \a step
+ */
+static float step_voltage (const int step)
+{
+    return 11.0f + (float) (step % VOLTAGE_STEPS) / 100.0f;
+}
+
+/**
+ * Submits the given NetConsole \a message to the LibDS
+ */
+static void add_message (const char* message)
+{
+    DS_String str = {(char*) message, strlen (message), 0};
+    CFG_AddNetConsoleMessage (&str);
+}
+
+/**
+ * Handles the pending LibDS events in the GUI thread (the slot that does
+ * it is private, so it is called through the meta-object system)
+ */
+static void process_events()
+{
+    QMetaObject::invokeMethod (DriverStation::getInstance(), "processEvents",
+                               Qt::DirectConnection);
+}
+
+/**
+ * Records the time elapsed between the creation of the LibDS events and the
+ * QML handlers of the signals that they caused
+ */
+class LatencyProbe : public QObject
+{
+    Q_OBJECT
+
+public:
+    QVector<quint64> samples;
+
+    Q_INVOKABLE void record()
+    {
+        const quint64 now = DS_GetTimeUs();
+        const quint64 time = DriverStation::getInstance()->eventTime();
+        samples.append (now > time ? now - time : 0);
+    }
+
+    Q_INVOKABLE void recordFrame (const qreal voltage)
+    {
+        const int step = qRound ((voltage - 11) * 100);
+        if (step < 0 || step >= VOLTAGE_STEPS)
+            return;
+
+        const quint64 now = DS_GetTimeUs();
+        const quint64 time = voltage_times [step].load();
+        if (time > 0)
+            samples.append (now > time ? now - time : 0);
+    }
+
+    quint64 percentile (const double fraction)
+    {
+        if (samples.isEmpty())
+            return 0;
+
+        std::sort (samples.begin(), samples.end());
+        return samples.at (qMin (samples.count() - 1,
+                                 (int) (samples.count() * fraction)));
+    }
+};
+
+/**
+ * Measures the fraction of the time that the GUI thread spends outside of
+ * the wait for new events of its event dispatcher
+ */
+class OccupancyMeter : public QObject
+{
+    Q_OBJECT
+
+public:
+    OccupancyMeter()
+    {
+        QAbstractEventDispatcher* dispatcher;
+        dispatcher = QAbstractEventDispatcher::instance();
+        connect (dispatcher, SIGNAL (awake()), this, SLOT (awake()));
+        connect (dispatcher, SIGNAL (aboutToBlock()), this, SLOT (aboutToBlock()));
+        m_wall.start();
+        m_busy.start();
+    }
+
+    double occupancy() const
+    {
+        const qint64 wall = m_wall.nsecsElapsed();
+        return wall > 0 ? (double) m_busyTime / wall : 0;
+    }
+
+private slots:
+    void awake()
+    {
+        if (!m_awake) {
+            m_awake = true;
+            m_busy.restart();
+        }
+    }
+
+    void aboutToBlock()
+    {
+        if (m_awake) {
+            m_awake = false;
+            m_busyTime += m_busy.nsecsElapsed();
+        }
+    }
+
+private:
+    bool m_awake = true;
+    qint64 m_busyTime = 0;
+    QElapsedTimer m_wall;
+    QElapsedTimer m_busy;
+};
+
+/**
+ * Submits the synthetic events from a separate thread, as the protocol
+ * threads of the LibDS would do
+ */
+class FloodThread : public QThread
+{
+public:
+    QAtomicInteger<int> events;
+
+protected:
+    void run() override
+    {
+        int voltages = 0;
+        int messages = 0;
+        int flaps = 0;
+
+        QElapsedTimer timer;
+        timer.start();
+
+        while (timer.elapsed() < FLOOD_DURATION) {
+            const qint64 usecs = timer.nsecsElapsed() / 1000;
+
+            while (voltages < usecs * VOLTAGE_RATE / 1000000) {
+                const int step = voltages++ % VOLTAGE_STEPS;
+                voltage_times [step].store (DS_GetTimeUs());
+                CFG_SetRobotVoltage (step_voltage (step));
+                events.ref();
+            }
+
+            while (messages < usecs * NETCONSOLE_RATE / 1000000) {
+                add_message ("Benchmark: synthetic NetConsole message");
+                events.ref();
+                ++messages;
+            }
+
+            while (flaps < usecs / (FLAP_INTERVAL * 1000)) {
+                CFG_SetRobotCommunications (++flaps % 2);
+                events.ref();
+            }
+
+            QThread::usleep (200);
+        }
+    }
+};
+
+/**
+ * Submits \a count events with the given \a body from the GUI thread and
+ * prints the average cost of the \c processEvents() call that handles them
+ */
+static void run_cost (const char* name, void (*body) (int), const int count)
+{
+    int i;
+
+    /* Drain the events of the previous run */
+    process_events();
+
+    for (i = 0; i < count; ++i)
+        body (i);
+
+    QElapsedTimer timer;
+    timer.start();
+    process_events();
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    printf ("%-36s %10.1f ns/event\n", name, (double) elapsed / count);
+}
+
+static void voltage_event (int i)
+{
+    CFG_SetRobotVoltage (step_voltage (i));
+}
+
+static void netconsole_event (int i)
+{
+    Q_UNUSED (i);
+    add_message ("Benchmark: synthetic NetConsole message");
+}
+
+static void comms_event (int i)
+{
+    CFG_SetRobotCommunications (i % 2);
+}
+
+static void mixed_event (int i)
+{
+    switch (i % 3) {
+    case 0:
+        voltage_event (i);
+        break;
+    case 1:
+        netconsole_event (i);
+        break;
+    default:
+        comms_event (i);
+        break;
+    }
+}
+
+/**
+ * Floods the LibDS for \c FLOOD_DURATION milliseconds while the given
+ * \a qml consumer is loaded and prints the signal latencies and the
+ * occupancy of the GUI thread
+ */
+static void run_flood (QQmlEngine* engine, const char* name, const char* qml)
+{
+    int i;
+    LatencyProbe probe;
+    engine->rootContext()->setContextProperty ("Probe", &probe);
+
+    for (i = 0; i < VOLTAGE_STEPS; ++i)
+        voltage_times [i].store (0);
+
+    QQmlComponent component (engine);
+    component.setData (qml, QUrl());
+    QObject* consumer = component.create();
+    if (!consumer) {
+        fprintf (stderr, "%s\n", qPrintable (component.errorString()));
+        return;
+    }
+
+    process_events();
+
+    FloodThread flood;
+    QEventLoop loop;
+    QObject::connect (&flood, SIGNAL (finished()), &loop, SLOT (quit()));
+
+    OccupancyMeter meter;
+    flood.start();
+    loop.exec();
+
+    /* Deliver the last events before measuring */
+    QTimer::singleShot (100, &loop, SLOT (quit()));
+    loop.exec();
+
+    const double occupancy = meter.occupancy();
+    delete consumer;
+
+    printf ("%-36s %8d events %8d signals\n", name,
+            flood.events.load(), probe.samples.count());
+    printf ("%-36s %8.3f ms p50 %8.3f ms p99 %8.3f ms max\n", "  latency",
+            probe.percentile (0.50) / 1e3, probe.percentile (0.99) / 1e3,
+            probe.percentile (1.00) / 1e3);
+    printf ("%-36s %8.1f %%\n", "  GUI thread occupancy", occupancy * 100);
+}
+
+/**
+ * Main entry point of the benchmarks
+ */
+int main (int argc, char** argv)
+{
+    QApplication app (argc, argv);
+
+    DriverStation* ds = DriverStation::getInstance();
+    ds->start();
+
+    printf ("LibDS %s Qt wrapper benchmarks\n\n", DS_GetVersion());
+
+    /* Cost of processEvents() */
+    DS_SetEventCoalescing (0);
+    run_cost ("processEvents (voltage)", &voltage_event, COST_EVENTS);
+    run_cost ("processEvents (NetConsole)", &netconsole_event, COST_EVENTS);
+    run_cost ("processEvents (comms flapping)", &comms_event, COST_EVENTS);
+    run_cost ("processEvents (mixed)", &mixed_event, COST_EVENTS);
+    DS_SetEventCoalescing (1);
+    run_cost ("processEvents (mixed, coalesced)", &mixed_event, COST_EVENTS);
+    printf ("\n");
+
+    /* Signal latency and GUI thread occupancy */
+    QQmlEngine engine;
+    engine.rootContext()->setContextProperty ("DS", ds);
+
+    run_flood (&engine, "Flood (signals)", SIGNALS_QML);
+
+    ds->setEventThreadEnabled (true);
+    run_flood (&engine, "Flood (signals, event thread)", SIGNALS_QML);
+    ds->setEventThreadEnabled (false);
+
+    ds->setTelemetryFramesEnabled (true);
+    run_flood (&engine, "Flood (telemetry frames)", FRAMES_QML);
+    ds->setTelemetryFramesEnabled (false);
+
+    DS_Close();
+    return EXIT_SUCCESS;
+}
+
+#include "main.moc"
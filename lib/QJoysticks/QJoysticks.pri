@@ -25,20 +25,36 @@ QT += gui
 QT += core
 QT += widgets
 
+android {
+    QT += androidextras
+}
+
+win32:!winrt {
+    LIBS += -lhid
+}
+
 INCLUDEPATH += $$PWD/src
 
 HEADERS += \
     $$PWD/src/QJoysticks.h \
+    $$PWD/src/QJoysticks/DeferredSettings.h \
+    $$PWD/src/QJoysticks/JoystickModel.h \
+    $$PWD/src/QJoysticks/JoystickProfiles.h \
     $$PWD/src/QJoysticks/JoysticksCommon.h \
     $$PWD/src/QJoysticks/SDL_Joysticks.h \
     $$PWD/src/QJoysticks/VirtualJoystick.h \
-    $$PWD/src/QJoysticks/Android_Joystick.h
+    $$PWD/src/QJoysticks/Android_Joystick.h \
+    $$PWD/src/QJoysticks/Windows_Joysticks.h
 
 SOURCES += \
     $$PWD/src/QJoysticks.cpp \
+    $$PWD/src/QJoysticks/DeferredSettings.cpp \
+    $$PWD/src/QJoysticks/JoystickModel.cpp \
+    $$PWD/src/QJoysticks/JoystickProfiles.cpp \
     $$PWD/src/QJoysticks/SDL_Joysticks.cpp \
     $$PWD/src/QJoysticks/VirtualJoystick.cpp \
-    $$PWD/src/QJoysticks/Android_Joystick.cpp
+    $$PWD/src/QJoysticks/Android_Joystick.cpp \
+    $$PWD/src/QJoysticks/Windows_Joysticks.cpp
 
 RESOURCES += \
     $$PWD/etc/resources/qjoysticks-res.qrc
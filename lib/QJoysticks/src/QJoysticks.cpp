@@ -21,16 +21,26 @@
  */
 
 #include <QDebug>
-#include <QSettings>
+#include <QTimer>
 #include <QJoysticks.h>
+#include <QJoysticks/DeferredSettings.h>
 #include <QJoysticks/SDL_Joysticks.h>
 #include <QJoysticks/VirtualJoystick.h>
+#include <QJoysticks/Android_Joystick.h>
+#include <QJoysticks/Windows_Joysticks.h>
+
+/**
+ * Settings group that holds the blacklist state of each joystick name
+ */
+#define BLACKLIST_GROUP QString ("Blacklisted Joysticks/")
 
 QJoysticks::QJoysticks()
 {
     /* Initialize input methods */
     m_sdlJoysticks = new SDL_Joysticks (this);
     m_virtualJoystick = new VirtualJoystick (this);
+    m_androidJoysticks = new Android_Joystick (this);
+    m_windowsJoysticks = new Windows_Joysticks (this);
 
     /* Configure SDL joysticks */
     connect (sdlJoysticks(),    &SDL_Joysticks::POVEvent,
@@ -40,7 +50,30 @@ QJoysticks::QJoysticks()
     connect (sdlJoysticks(),    &SDL_Joysticks::buttonEvent,
              this,              &QJoysticks::buttonEvent);
     connect (sdlJoysticks(),    &SDL_Joysticks::countChanged,
-             this,              &QJoysticks::updateInterfaces);
+             this,              &QJoysticks::onHardwareChanged);
+
+    /* Configure Android gamepads */
+    connect (androidJoysticks(), &Android_Joystick::POVEvent,
+             this,               &QJoysticks::POVEvent);
+    connect (androidJoysticks(), &Android_Joystick::axisEvent,
+             this,               &QJoysticks::axisEvent);
+    connect (androidJoysticks(), &Android_Joystick::buttonEvent,
+             this,               &QJoysticks::buttonEvent);
+    connect (androidJoysticks(), &Android_Joystick::countChanged,
+             this,               &QJoysticks::onHardwareChanged);
+
+    /* Configure the native Windows controllers (they replace the SDL
+     * joysticks while the native backend is enabled) */
+    connect (windowsJoysticks(), &Windows_Joysticks::POVEvent,
+             this,               &QJoysticks::POVEvent);
+    connect (windowsJoysticks(), &Windows_Joysticks::axisEvent,
+             this,               &QJoysticks::axisEvent);
+    connect (windowsJoysticks(), &Windows_Joysticks::buttonEvent,
+             this,               &QJoysticks::buttonEvent);
+    connect (windowsJoysticks(), &Windows_Joysticks::countChanged,
+             this,               &QJoysticks::onHardwareChanged);
+    connect (windowsJoysticks(), &Windows_Joysticks::enabledChanged,
+             this,               &QJoysticks::updateInterfaces);
 
     /* Configure virtual joysticks */
     connect (virtualJoystick(), &VirtualJoystick::povEvent,
@@ -60,17 +93,27 @@ QJoysticks::QJoysticks()
     connect (this, &QJoysticks::buttonEvent,
              this, &QJoysticks::onButtonEvent);
 
+    /* Publish the input statistics once per second */
+    m_statisticsTimestamp = QJoystickTimestamp();
+    m_statisticsTimer = new QTimer (this);
+    m_statisticsTimer->setInterval (1000);
+    connect (m_statisticsTimer, &QTimer::timeout,
+             this,              &QJoysticks::publishStatistics);
+    m_statisticsTimer->start();
+
     /* Configure the settings */
     m_sortJoyticks = 0;
-    m_settings = new QSettings (qApp->organizationName(), qApp->applicationName());
-    m_settings->beginGroup ("Blacklisted Joysticks");
+    m_frameRequested = false;
+    m_inputHandler = Q_NULLPTR;
 }
 
 QJoysticks::~QJoysticks()
 {
-    delete m_settings;
+    clearPlaceholders();
     delete m_sdlJoysticks;
     delete m_virtualJoystick;
+    delete m_androidJoysticks;
+    delete m_windowsJoysticks;
 }
 
 /**
@@ -124,6 +167,27 @@ QStringList QJoysticks::deviceNames() const
     return names;
 }
 
+/**
+ * Returns the input statistics of the registered joysticks (in the same
+ * order as \c deviceNames()), which are updated once per second. Each item
+ * is a map with the following values:
+ *     - \c name: the joystick name
+ *     - \c eventRate: the number of input events per second
+ *     - \c latency: the average time (in milliseconds) between reading an
+ *       input and dispatching it to the application
+ *     - \c maxLatency: the highest dispatch latency (in milliseconds)
+ *     - \c maxInterval: the longest time (in milliseconds) between two
+ *       consecutive input events
+ *     - \c droppedEvents: the number of events that were discarded because
+ *       they referred to an invalid POV, axis or button
+ *     - \c coalescedEvents: the number of SDL events that were merged by the
+ *       state polling mode (see \c SDL_Joysticks::pollState())
+ */
+QVariantList QJoysticks::statistics() const
+{
+    return m_statistics;
+}
+
 /**
  * Returns the POV value for the given joystick \a index and \a pov ID
  */
@@ -210,6 +274,22 @@ bool QJoysticks::joystickExists (const int index)
     return (index >= 0) && (count() > index);
 }
 
+/**
+ * Returns \c true if the joystick at the given \a index is the virtual
+ * joystick or one of the other virtual devices (i.e. it is not a SDL joystick)
+ */
+bool QJoysticks::isVirtualDevice (const int index)
+{
+    if (!joystickExists (index))
+        return false;
+
+    QJoystickDevice* device = m_devices.at (index);
+    if (virtualJoystick()->joystickEnabled() && device == virtualJoystick()->joystick())
+        return true;
+
+    return m_virtualDevices.contains (device);
+}
+
 /**
  * Returns the name of the given joystick
  */
@@ -221,6 +301,58 @@ QString QJoysticks::getName (const int index)
     return "Invalid Joystick";
 }
 
+/**
+ * Returns the calibration (\c center, \c deadband and \c curve) of the given
+ * \a axis of the joystick at the given \a index.
+ *
+ * \note Only the SDL joysticks can be calibrated, their calibration profiles
+ *       are stored with the GUID of each joystick
+ */
+QVariantMap QJoysticks::getAxisCalibration (const int index, const int axis)
+{
+    QJoystickAxisCalibration calibration = {0, 0, 0};
+    if (joystickExists (index))
+        calibration = sdlJoysticks()->axisCalibration (m_devices.at (index), axis);
+
+    QVariantMap map;
+    map.insert ("center", calibration.center);
+    map.insert ("deadband", calibration.deadband);
+    map.insert ("curve", calibration.curve);
+    return map;
+}
+
+/**
+ * Changes the calibration of the given \a axis of the joystick at the given
+ * \a index (see \c QJoystickAxisCalibration), the calibration is applied to
+ * every joystick with the same GUID and saved to the joystick profiles.
+ *
+ * Returns \c false if the joystick cannot be calibrated.
+ */
+bool QJoysticks::setAxisCalibration (const int index, const int axis,
+                                     const qreal center, const qreal deadband,
+                                     const qreal curve)
+{
+    if (!joystickExists (index))
+        return false;
+
+    QJoystickAxisCalibration calibration;
+    calibration.center = center;
+    calibration.deadband = deadband;
+    calibration.curve = curve;
+
+    return sdlJoysticks()->setAxisCalibration (m_devices.at (index), axis, calibration);
+}
+
+/**
+ * Returns the window (a \c QQuickWindow) that the joystick models use to
+ * publish the joystick input once per frame, or \c NULL if the models
+ * publish every joystick event as soon as it is received
+ */
+QObject* QJoysticks::frameWindow() const
+{
+    return m_frameWindow;
+}
+
 /**
  * Returns a pointer to the SDL joysticks system.
  * This can be used if you need to get more information regarding the joysticks
@@ -231,6 +363,25 @@ SDL_Joysticks* QJoysticks::sdlJoysticks() const
     return m_sdlJoysticks;
 }
 
+/**
+ * Returns a pointer to the Android gamepads system.
+ * On other operating systems, this system does not report any joystick.
+ */
+Android_Joystick* QJoysticks::androidJoysticks() const
+{
+    return m_androidJoysticks;
+}
+
+/**
+ * Returns a pointer to the native Windows controllers system (XInput and
+ * Raw Input). This system is disabled by default, while it is enabled its
+ * controllers are registered instead of the SDL joysticks.
+ */
+Windows_Joysticks* QJoysticks::windowsJoysticks() const
+{
+    return m_windowsJoysticks;
+}
+
 /**
  * Returns a pointer to the virtual joystick system.
  * This can be used if you need to get more information regarding the virtual
@@ -260,11 +411,62 @@ QJoystickDevice* QJoysticks::getInputDevice (const int index)
  * This can be used for advanced hacks or just to get all properties of each
  * joystick.
  */
-QList<QJoystickDevice*> QJoysticks::inputDevices() const
+const QList<QJoystickDevice*>& QJoysticks::inputDevices() const
 {
     return m_devices;
 }
 
+/**
+ * Sets the \a handler that receives the input of the virtual devices as soon
+ * as their state is updated, before the QML-friendly signals are emitted.
+ *
+ * \note The input of the SDL, Android and native Windows joysticks is given
+ *       to the handlers registered with their own \c setInputHandler()
+ *       functions instead
+ */
+void QJoysticks::setInputHandler (QJoystickInputHandler* handler)
+{
+    m_inputHandler = handler;
+}
+
+/**
+ * Asks the frame window to render a new frame, the \c publishInput() signal
+ * is emitted before the frame is synchronized with the scene graph.
+ *
+ * \note Several requests made before the next frame are merged into one
+ */
+void QJoysticks::requestFrame()
+{
+    if (m_frameWindow && !m_frameRequested) {
+        m_frameRequested = true;
+        QMetaObject::invokeMethod (m_frameWindow, "update");
+    }
+}
+
+/**
+ * Changes the \a window (a \c QQuickWindow) used to publish the joystick input
+ * to the joystick models. When a window is set, the models aggregate the
+ * joystick events and notify their views at most once per rendered frame.
+ *
+ * \note The joystick input is still sent to the rest of the application (and
+ *       to the robot) as soon as it is received
+ */
+void QJoysticks::setFrameWindow (QObject* window)
+{
+    if (m_frameWindow)
+        disconnect (m_frameWindow, SIGNAL (afterAnimating()),
+                    this,          SLOT (onFrame()));
+
+    m_frameWindow = window;
+    m_frameRequested = false;
+
+    if (m_frameWindow)
+        connect (m_frameWindow, SIGNAL (afterAnimating()),
+                 this,          SLOT (onFrame()));
+
+    emit publishInput();
+}
+
 /**
  * If \a sort is set to true, then the device list will put all blacklisted
  * joysticks at the end of the list
@@ -304,7 +506,9 @@ void QJoysticks::setBlacklisted (const int index, bool blacklisted)
 
     /* Save settings */
     m_devices.at (index)->blacklisted = blacklisted;
-    m_settings->setValue (getName (index), blacklisted);
+    m_blacklist.insert (getName (index), blacklisted);
+    DeferredSettings::getInstance()->setValue (BLACKLIST_GROUP + getName (index),
+                                               blacklisted);
 
     /* Re-scan joysticks if blacklist value has changed */
     if (changed)
@@ -313,16 +517,24 @@ void QJoysticks::setBlacklisted (const int index, bool blacklisted)
 
 /**
  * 'Rescans' for new/removed joysticks and registers them again.
+ *
+ * \note The attached and removed joysticks are handled by
+ *       \c onHardwareChanged(), which does not change the slots of the
+ *       other joysticks. A rescan is only done when the user changes which
+ *       joysticks are registered (or their order).
  */
 void QJoysticks::updateInterfaces()
 {
     m_devices.clear();
+    clearPlaceholders();
+
+    QList<QJoystickDevice*> hardware = hardwareJoysticks();
 
     /* Put blacklisted joysticks at the bottom of the list */
     if (m_sortJoyticks) {
-        /* Register non-blacklisted SDL joysticks */
-        foreach (QJoystickDevice* joystick, sdlJoysticks()->joysticks()) {
-            joystick->blacklisted = m_settings->value (joystick->name, false).toBool();
+        /* Register non-blacklisted SDL and Android joysticks */
+        foreach (QJoystickDevice* joystick, hardware) {
+            joystick->blacklisted = savedBlacklistState (joystick->name);
             if (!joystick->blacklisted)
                 addInputDevice (joystick);
         }
@@ -330,7 +542,7 @@ void QJoysticks::updateInterfaces()
         /* Register the virtual joystick (if its not blacklisted) */
         if (virtualJoystick()->joystickEnabled()) {
             QJoystickDevice* joystick = virtualJoystick()->joystick();
-            joystick->blacklisted = m_settings->value (joystick->name, false).toBool();
+            joystick->blacklisted = savedBlacklistState (joystick->name);
 
             if (!joystick->blacklisted) {
                 addInputDevice (joystick);
@@ -338,9 +550,12 @@ void QJoysticks::updateInterfaces()
             }
         }
 
-        /* Register blacklisted SDL joysticks */
-        foreach (QJoystickDevice* joystick, sdlJoysticks()->joysticks()) {
-            joystick->blacklisted = m_settings->value (joystick->name, false).toBool();
+        /* Register the non-blacklisted virtual devices */
+        registerVirtualDevices (false);
+
+        /* Register blacklisted SDL and Android joysticks */
+        foreach (QJoystickDevice* joystick, hardware) {
+            joystick->blacklisted = savedBlacklistState (joystick->name);
             if (joystick->blacklisted)
                 addInputDevice (joystick);
         }
@@ -348,33 +563,46 @@ void QJoysticks::updateInterfaces()
         /* Register the virtual joystick (if its blacklisted) */
         if (virtualJoystick()->joystickEnabled()) {
             QJoystickDevice* joystick = virtualJoystick()->joystick();
-            joystick->blacklisted = m_settings->value (joystick->name, false).toBool();
+            joystick->blacklisted = savedBlacklistState (joystick->name);
 
             if (joystick->blacklisted) {
                 addInputDevice (joystick);
                 virtualJoystick()->setJoystickID (inputDevices().count() - 1);
             }
         }
+
+        /* Register the blacklisted virtual devices */
+        registerVirtualDevices (true);
     }
 
     /* Sort normally */
     else {
-        /* Register SDL joysticks */
-        foreach (QJoystickDevice* joystick, sdlJoysticks()->joysticks()) {
+        /* Register SDL and Android joysticks */
+        foreach (QJoystickDevice* joystick, hardware) {
             addInputDevice (joystick);
-            joystick->blacklisted = m_settings->value (joystick->name, false).toBool();
+            joystick->blacklisted = savedBlacklistState (joystick->name);
         }
 
         /* Register virtual joystick */
         if (virtualJoystick()->joystickEnabled()) {
             QJoystickDevice* joystick = virtualJoystick()->joystick();
-            joystick->blacklisted = m_settings->value (joystick->name, false).toBool();
+            joystick->blacklisted = savedBlacklistState (joystick->name);
 
             addInputDevice (joystick);
             virtualJoystick()->setJoystickID (inputDevices().count() - 1);
         }
+
+        /* Register the other virtual devices */
+        foreach (QJoystickDevice* device, m_virtualDevices) {
+            device->blacklisted = savedBlacklistState (device->name);
+            addInputDevice (device);
+        }
     }
 
+    /* Prepare the slots that are kept when a joystick is removed */
+    foreach (QJoystickDevice* joystick, hardware)
+        m_placeholders.insert (joystick, createPlaceholder (joystick));
+
     emit countChanged();
 }
 
@@ -397,6 +625,151 @@ void QJoysticks::setVirtualJoystickEnabled (bool enabled)
     virtualJoystick()->setJoystickEnabled (enabled);
 }
 
+/**
+ * Registers a virtual \a device (e.g. an on-screen joystick), the input of
+ * the device is obtained from the \c povEvent(), \c axisEvent() and
+ * \c buttonEvent() signals of the given \a source object.
+ *
+ * Virtual devices are registered after the SDL joysticks and the virtual
+ * joystick, in the order in which they were added.
+ */
+void QJoysticks::addVirtualDevice (QJoystickDevice* device, QObject* source)
+{
+    Q_ASSERT (device);
+    Q_ASSERT (source);
+
+    if (m_virtualDevices.contains (device))
+        return;
+
+    connect (source, SIGNAL (povEvent (QJoystickPOVEvent)),
+             this,   SIGNAL (POVEvent (QJoystickPOVEvent)));
+    connect (source, SIGNAL (axisEvent (QJoystickAxisEvent)),
+             this,   SIGNAL (axisEvent (QJoystickAxisEvent)));
+    connect (source, SIGNAL (buttonEvent (QJoystickButtonEvent)),
+             this,   SIGNAL (buttonEvent (QJoystickButtonEvent)));
+
+    m_virtualDevices.append (device);
+    updateInterfaces();
+}
+
+/**
+ * Unregisters the given virtual \a device and stops reading the input
+ * signals of its \a source object
+ */
+void QJoysticks::removeVirtualDevice (QJoystickDevice* device, QObject* source)
+{
+    if (m_virtualDevices.removeAll (device) > 0) {
+        disconnect (source, Q_NULLPTR, this, Q_NULLPTR);
+        updateInterfaces();
+    }
+}
+
+/**
+ * Registers the attached joysticks and unregisters the removed joysticks
+ * without changing the slots of the other joysticks:
+ *     - A removed joystick leaves a placeholder with the same name and
+ *       layout (and neutral values) in its slot
+ *     - An attached joystick takes the slot that it left (if any), or is
+ *       registered after the other joysticks
+ *
+ * Since the virtual devices must be registered after the real joysticks,
+ * the joysticks are registered again if a new joystick is attached while
+ * a virtual device is registered.
+ */
+void QJoysticks::onHardwareChanged()
+{
+    const int count = m_devices.count();
+    QList<QJoystickDevice*> hardware = hardwareJoysticks();
+
+    /* Keep the slots of the removed joysticks */
+    foreach (QJoystickDevice* joystick, m_placeholders.keys()) {
+        if (hardware.contains (joystick))
+            continue;
+
+        QJoystickDevice* placeholder = m_placeholders.take (joystick);
+        const int index = m_devices.indexOf (joystick);
+
+        if (index >= 0) {
+            setInputDevice (index, placeholder);
+            m_detached.append (placeholder);
+            emit deviceChanged (index);
+        }
+
+        else
+            delete placeholder;
+    }
+
+    /* Register the new joysticks */
+    foreach (QJoystickDevice* joystick, hardware) {
+        if (m_placeholders.contains (joystick))
+            continue;
+
+        joystick->blacklisted = savedBlacklistState (joystick->name);
+        const int index = detachedSlot (joystick);
+
+        if (index >= 0) {
+            QJoystickDevice* placeholder = m_devices.at (index);
+            m_detached.removeAll (placeholder);
+            delete placeholder;
+
+            setInputDevice (index, joystick);
+            emit deviceChanged (index);
+        }
+
+        else if (virtualDevicesRegistered()) {
+            updateInterfaces();
+            return;
+        }
+
+        else
+            addInputDevice (joystick);
+
+        m_placeholders.insert (joystick, createPlaceholder (joystick));
+    }
+
+    if (m_devices.count() != count)
+        emit countChanged();
+}
+
+/**
+ * Builds the statistics of the registered joysticks from the events that
+ * were dispatched since the last call and starts a new measurement window
+ */
+void QJoysticks::publishStatistics()
+{
+    qint64 now = QJoystickTimestamp();
+    qreal seconds = qMax (now - m_statisticsTimestamp, Q_INT64_C (1)) / 1e6;
+    m_statisticsTimestamp = now;
+
+    QVariantList statistics;
+    QHash<const QJoystickDevice*, QJoystickStats> stats;
+
+    foreach (QJoystickDevice* joystick, m_devices) {
+        QJoystickStats current = m_stats.value (joystick);
+
+        QVariantMap map;
+        map.insert ("name", joystick->name);
+        map.insert ("eventRate", current.events / seconds);
+        map.insert ("latency", current.events > 0 ?
+                    current.latency / 1000.0 / current.events : 0.0);
+        map.insert ("maxLatency", current.maxLatency / 1000.0);
+        map.insert ("maxInterval", current.maxInterval / 1000.0);
+        map.insert ("droppedEvents", current.dropped);
+        map.insert ("coalescedEvents", sdlJoysticks()->coalescedEvents (joystick));
+        statistics.append (map);
+
+        /* Keep the totals and the time of the last event */
+        QJoystickStats next;
+        next.dropped = current.dropped;
+        next.lastTimestamp = current.lastTimestamp;
+        stats.insert (joystick, next);
+    }
+
+    m_stats = stats;
+    m_statistics = statistics;
+    emit statisticsChanged();
+}
+
 /**
  * Removes all the registered joysticks and emits appropriate signals.
  */
@@ -407,22 +780,196 @@ void QJoysticks::resetJoysticks()
 }
 
 /**
- * Registers the given \a device to the \c QJoysticks system
+ * Returns the blacklist state saved for the joystick with the given \a name.
+ * The settings are only read the first time that a joystick name is found,
+ * the result is cached in memory for later rescans.
+ */
+bool QJoysticks::savedBlacklistState (const QString& name)
+{
+    if (!m_blacklist.contains (name))
+        m_blacklist.insert (name, DeferredSettings::getInstance()->value (
+                                BLACKLIST_GROUP + name, false).toBool());
+
+    return m_blacklist.value (name);
+}
+
+/**
+ * Returns \c true if the given \a joystick is registered in the slot given by
+ * its ID and it is not blacklisted. Since the ID of each device is its slot,
+ * the device of an event is found without searching the device list.
+ */
+bool QJoysticks::isActive (const QJoystickDevice* joystick)
+{
+    if (joystick && joystickExists (joystick->id))
+        return m_devices.at (joystick->id) == joystick && !joystick->blacklisted;
+
+    return false;
+}
+
+/**
+ * Updates the input statistics of the given \a joystick with an event that
+ * was read at the given \a timestamp. If the event was not \a applied, it is
+ * counted as a dropped event.
+ */
+void QJoysticks::recordEvent (const QJoystickDevice* joystick,
+                              const qint64 timestamp, const bool applied)
+{
+    QJoystickStats& stats = m_stats [joystick];
+
+    if (!applied) {
+        ++stats.dropped;
+        return;
+    }
+
+    qint64 latency = qMax (QJoystickTimestamp() - timestamp, Q_INT64_C (0));
+    ++stats.events;
+    stats.latency += latency;
+    stats.maxLatency = qMax (stats.maxLatency, latency);
+
+    if (stats.lastTimestamp >= 0)
+        stats.maxInterval = qMax (stats.maxInterval,
+                                  timestamp - stats.lastTimestamp);
+
+    stats.lastTimestamp = timestamp;
+}
+
+/**
+ * Registers the virtual devices whose blacklist state matches the given
+ * \a blacklisted value
+ */
+void QJoysticks::registerVirtualDevices (const bool blacklisted)
+{
+    foreach (QJoystickDevice* device, m_virtualDevices) {
+        device->blacklisted = savedBlacklistState (device->name);
+        if (device->blacklisted == blacklisted)
+            addInputDevice (device);
+    }
+}
+
+/**
+ * Returns the joysticks that are attached to the computer or device (the
+ * SDL joysticks, or the native Windows controllers if they are enabled, and
+ * the Android gamepads)
+ */
+QList<QJoystickDevice*> QJoysticks::hardwareJoysticks()
+{
+    QList<QJoystickDevice*> native = windowsJoysticks()->joysticks();
+    if (windowsJoysticks()->isEnabled())
+        return native + androidJoysticks()->joysticks();
+
+    return sdlJoysticks()->joysticks() + androidJoysticks()->joysticks();
+}
+
+/**
+ * Returns \c true if the virtual joystick or any other virtual device is
+ * registered
+ */
+bool QJoysticks::virtualDevicesRegistered()
+{
+    for (int i = 0; i < count(); ++i)
+        if (isVirtualDevice (i))
+            return true;
+
+    return false;
+}
+
+/**
+ * Returns the slot left by a removed joystick with the same name and layout
+ * as the given \a device, or \c -1 if there is no such slot
+ */
+int QJoysticks::detachedSlot (const QJoystickDevice* device)
+{
+    foreach (QJoystickDevice* placeholder, m_detached) {
+        if (placeholder->name == device->name &&
+                placeholder->povs.count() == device->povs.count() &&
+                placeholder->axes.count() == device->axes.count() &&
+                placeholder->buttons.count() == device->buttons.count())
+            return m_devices.indexOf (placeholder);
+    }
+
+    return -1;
+}
+
+/**
+ * Deletes the placeholders of the removed joysticks (and the placeholders
+ * prepared for the attached joysticks)
+ */
+void QJoysticks::clearPlaceholders()
+{
+    qDeleteAll (m_detached);
+    qDeleteAll (m_placeholders);
+    m_detached.clear();
+    m_placeholders.clear();
+}
+
+/**
+ * Registers the given \a device in the slot with the given \a index
+ */
+void QJoysticks::setInputDevice (const int index, QJoystickDevice* device)
+{
+    Q_ASSERT (device);
+    device->id = index;
+    m_devices [index] = device;
+}
+
+/**
+ * Returns a new device with the name and layout of the given \a device and
+ * neutral values, which takes the slot of the \a device when it is removed
+ */
+QJoystickDevice* QJoysticks::createPlaceholder (const QJoystickDevice* device)
+{
+    QJoystickDevice* placeholder = new QJoystickDevice;
+    placeholder->id = -1;
+    placeholder->name = device->name;
+    placeholder->guid = device->guid;
+    placeholder->blacklisted = device->blacklisted;
+    placeholder->povs.fill (0, device->povs.count());
+    placeholder->axes.fill (0, device->axes.count());
+    placeholder->buttons.fill (false, device->buttons.count());
+    return placeholder;
+}
+
+/**
+ * Registers the given \a device to the \c QJoysticks system, the ID of the
+ * device is set to the slot that it occupies in the device list
  */
 void QJoysticks::addInputDevice (QJoystickDevice* device)
 {
     Q_ASSERT (device);
+    device->id = m_devices.count();
     m_devices.append (device);
 }
 
+/**
+ * Publishes the aggregated joystick input to the joystick models (if a new
+ * frame was requested by them)
+ */
+void QJoysticks::onFrame()
+{
+    if (m_frameRequested) {
+        m_frameRequested = false;
+        emit publishInput();
+    }
+}
+
 /**
  * Configures the QML-friendly signal based on the information given by the
  * \a event data and updates the joystick values
  */
 void QJoysticks::onPOVEvent (const QJoystickPOVEvent& e)
 {
-    if (!isBlacklisted (e.joystick->id)) {
-        getInputDevice (e.joystick->id)->povs [e.pov] = e.angle;
+    if (!isActive (e.joystick))
+        return;
+
+    bool valid = e.pov >= 0 && e.pov < e.joystick->povs.count();
+    recordEvent (e.joystick, e.timestamp, valid);
+
+    if (valid) {
+        e.joystick->povs [e.pov] = e.angle;
+
+        if (m_inputHandler && isVirtualDevice (e.joystick->id))
+            m_inputHandler->povEvent (e);
+
         emit povChanged (e.joystick->id, e.pov, e.angle);
     }
 }
@@ -433,8 +980,18 @@ void QJoysticks::onPOVEvent (const QJoystickPOVEvent& e)
  */
 void QJoysticks::onAxisEvent (const QJoystickAxisEvent& e)
 {
-    if (!isBlacklisted (e.joystick->id)) {
-        getInputDevice (e.joystick->id)->axes [e.axis] = e.value;
+    if (!isActive (e.joystick))
+        return;
+
+    bool valid = e.axis >= 0 && e.axis < e.joystick->axes.count();
+    recordEvent (e.joystick, e.timestamp, valid);
+
+    if (valid) {
+        e.joystick->axes [e.axis] = e.value;
+
+        if (m_inputHandler && isVirtualDevice (e.joystick->id))
+            m_inputHandler->axisEvent (e);
+
         emit axisChanged (e.joystick->id, e.axis, e.value);
     }
 }
@@ -445,8 +1002,18 @@ void QJoysticks::onAxisEvent (const QJoystickAxisEvent& e)
  */
 void QJoysticks::onButtonEvent (const QJoystickButtonEvent& e)
 {
-    if (!isBlacklisted (e.joystick->id)) {
-        getInputDevice (e.joystick->id)->buttons [e.button] = e.pressed;
+    if (!isActive (e.joystick))
+        return;
+
+    bool valid = e.button >= 0 && e.button < e.joystick->buttons.count();
+    recordEvent (e.joystick, e.timestamp, valid);
+
+    if (valid) {
+        e.joystick->buttons [e.button] = e.pressed;
+
+        if (m_inputHandler && isVirtualDevice (e.joystick->id))
+            m_inputHandler->buttonEvent (e);
+
         emit buttonChanged (e.joystick->id, e.button, e.pressed);
     }
 }
@@ -23,12 +23,22 @@
 #ifndef _QJOYSTICKS_MAIN_H
 #define _QJOYSTICKS_MAIN_H
 
+#ifdef QT_QML_LIB
+    #include <QtQml>
+#endif
+
+#include <QHash>
 #include <QObject>
+#include <QPointer>
+#include <QVariant>
 #include <QStringList>
+#include <QJoysticks/JoystickModel.h>
 #include <QJoysticks/JoysticksCommon.h>
 
-class QSettings;
+class QTimer;
 class SDL_Joysticks;
+class Android_Joystick;
+class Windows_Joysticks;
 class VirtualJoystick;
 
 /**
@@ -40,13 +50,30 @@ class VirtualJoystick;
  * with the rest of the application through standarized types.
  *
  * The joysticks are assigned a numerical ID, which the \c QJoysticks can use to
- * identify them. The ID's start with \c 0 (as with a QList). The ID's are
- * refreshed when a joystick is attached or removed. The first joystick that
- * has been connected to the computer will have \c 0 as an ID, the second
- * joystick will have \c 1 as an ID, and so on...
+ * identify them. The ID's start with \c 0 (as with a QList). The first
+ * joystick that has been connected to the computer will have \c 0 as an ID,
+ * the second joystick will have \c 1 as an ID, and so on...
+ *
+ * The ID's do not change when a joystick is attached or removed: a removed
+ * joystick leaves a placeholder (with neutral values) in its slot, which
+ * it takes again when it is attached, and the \c deviceChanged() signal is
+ * emitted for the slot. The ID's are only refreshed when the user changes
+ * the registered joysticks (e.g. by blacklisting a joystick).
+ *
+ * Other virtual devices (e.g. on-screen touch joysticks) can be registered
+ * with \c addVirtualDevice(), they are registered after the virtual joystick.
+ *
+ * The axes of the SDL joysticks can be calibrated (center offset, deadband and
+ * response curve), the calibration profiles are stored by the GUID of each
+ * joystick and applied when the joystick is attached.
+ *
+ * The input statistics of each registered device (event rate, latency between
+ * reading and dispatching the input, and dropped or coalesced events) are
+ * published once per second with the \c statistics property.
  *
- * \note the virtual joystick will ALWAYS be the last joystick to be registered,
- *       even if it has been enabled before any SDL joystick has been attached.
+ * \note the virtual joystick will ALWAYS be the last joystick to be registered
+ *       (before the other virtual devices), even if it has been enabled before
+ *       any SDL joystick has been attached.
  */
 class QJoysticks : public QObject
 {
@@ -60,11 +87,17 @@ class QJoysticks : public QObject
     Q_PROPERTY (QStringList deviceNames
                 READ deviceNames
                 NOTIFY countChanged)
+    Q_PROPERTY (QVariantList statistics
+                READ statistics
+                NOTIFY statisticsChanged)
 
     friend class Test_QJoysticks;
 
 signals:
     void countChanged();
+    void deviceChanged (const int index);
+    void publishInput();
+    void statisticsChanged();
     void enabledChanged (const bool enabled);
     void POVEvent (const QJoystickPOVEvent& event);
     void axisEvent (const QJoystickAxisEvent& event);
@@ -76,9 +109,17 @@ signals:
 public:
     static QJoysticks* getInstance();
 
+    static void declareQML()
+    {
+#ifdef QT_QML_LIB
+        qmlRegisterType<JoystickModel> ("QJoysticks", 1, 0, "JoystickModel");
+#endif
+    }
+
     int count() const;
     int nonBlacklistedCount();
     QStringList deviceNames() const;
+    QVariantList statistics() const;
 
     Q_INVOKABLE int getPOV (const int index, const int pov);
     Q_INVOKABLE double getAxis (const int index, const int axis);
@@ -89,17 +130,30 @@ public:
     Q_INVOKABLE int getNumButtons (const int index);
     Q_INVOKABLE bool isBlacklisted (const int index);
     Q_INVOKABLE bool joystickExists (const int index);
+    Q_INVOKABLE bool isVirtualDevice (const int index);
     Q_INVOKABLE QString getName (const int index);
+    Q_INVOKABLE QVariantMap getAxisCalibration (const int index, const int axis);
+    Q_INVOKABLE bool setAxisCalibration (const int index, const int axis,
+                                         const qreal center, const qreal deadband,
+                                         const qreal curve);
 
+    QObject* frameWindow() const;
     SDL_Joysticks* sdlJoysticks() const;
+    Android_Joystick* androidJoysticks() const;
+    Windows_Joysticks* windowsJoysticks() const;
     VirtualJoystick* virtualJoystick() const;
     QJoystickDevice* getInputDevice (const int index);
-    QList<QJoystickDevice*> inputDevices() const;
+    const QList<QJoystickDevice*>& inputDevices() const;
+    void setInputHandler (QJoystickInputHandler* handler);
 
 public slots:
+    void requestFrame();
     void updateInterfaces();
+    void setFrameWindow (QObject* window);
     void setVirtualJoystickRange (qreal range);
     void setVirtualJoystickEnabled (bool enabled);
+    void addVirtualDevice (QJoystickDevice* device, QObject* source);
+    void removeVirtualDevice (QJoystickDevice* device, QObject* source);
     void setSortJoysticksByBlacklistState (bool sort);
     void setBlacklisted (int index, bool blacklisted);
 
@@ -108,20 +162,63 @@ protected:
     ~QJoysticks();
 
 private slots:
+    void onFrame();
     void resetJoysticks();
+    void onHardwareChanged();
+    void publishStatistics();
     void addInputDevice (QJoystickDevice* device);
     void onPOVEvent (const QJoystickPOVEvent& e);
     void onAxisEvent (const QJoystickAxisEvent& e);
     void onButtonEvent (const QJoystickButtonEvent& e);
 
 private:
+    bool isActive (const QJoystickDevice* joystick);
+    void registerVirtualDevices (const bool blacklisted);
+    QList<QJoystickDevice*> hardwareJoysticks();
+    bool virtualDevicesRegistered();
+    int detachedSlot (const QJoystickDevice* device);
+    void clearPlaceholders();
+    void setInputDevice (const int index, QJoystickDevice* device);
+    QJoystickDevice* createPlaceholder (const QJoystickDevice* device);
+    bool savedBlacklistState (const QString& name);
+    void recordEvent (const QJoystickDevice* joystick, const qint64 timestamp,
+                      const bool applied);
+
+private:
+    /**
+     * Input statistics of a device during the current measurement window
+     */
+    struct QJoystickStats {
+        QJoystickStats() : events (0), latency (0), maxLatency (0),
+            maxInterval (0), lastTimestamp (-1), dropped (0) {}
+
+        int events;           /**< Number of events dispatched */
+        qint64 latency;       /**< Sum of the dispatch latencies (in us) */
+        qint64 maxLatency;    /**< Highest dispatch latency (in us) */
+        qint64 maxInterval;   /**< Longest time between two events (in us) */
+        qint64 lastTimestamp; /**< Timestamp of the last event */
+        int dropped;          /**< Total number of discarded events */
+    };
+
     bool m_sortJoyticks;
+    bool m_frameRequested;
+    QPointer<QObject> m_frameWindow;
+    QTimer* m_statisticsTimer;
+    qint64 m_statisticsTimestamp;
+    QVariantList m_statistics;
+    QHash<const QJoystickDevice*, QJoystickStats> m_stats;
+    QJoystickInputHandler* m_inputHandler;
 
-    QSettings* m_settings;
     SDL_Joysticks* m_sdlJoysticks;
     VirtualJoystick* m_virtualJoystick;
+    Android_Joystick* m_androidJoysticks;
+    Windows_Joysticks* m_windowsJoysticks;
 
     QList<QJoystickDevice*> m_devices;
+    QList<QJoystickDevice*> m_virtualDevices;
+    QList<QJoystickDevice*> m_detached;
+    QHash<QJoystickDevice*, QJoystickDevice*> m_placeholders;
+    QHash<QString, bool> m_blacklist;
 };
 
 #endif
@@ -0,0 +1,323 @@
+/*
+ * Copyright (c) 2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <QDebug>
+#include <QJoysticks/Android_Joystick.h>
+
+#ifdef Q_OS_ANDROID
+    #include <QtAndroidExtras/QtAndroid>
+    #include <QtAndroidExtras/QAndroidJniObject>
+    #include <QtAndroidExtras/QAndroidJniEnvironment>
+#endif
+
+/**
+ * Instance that receives the events of the native methods
+ */
+static QAtomicPointer<Android_Joystick> INSTANCE;
+
+/**
+ * Registers the native methods with the activity and asks the activity to
+ * start forwarding the gamepad events
+ */
+Android_Joystick::Android_Joystick (QObject* parent) : QObject (parent)
+{
+    m_inputHandler = Q_NULLPTR;
+    INSTANCE.store (this);
+
+#ifdef Q_OS_ANDROID
+    JNINativeMethod methods[] = {
+        {
+            (char*) "nativeDeviceAdded", (char*) "(ILjava/lang/String;II)V",
+            (void*) &Android_Joystick::onDeviceAdded
+        },
+        {
+            (char*) "nativeDeviceRemoved", (char*) "(I)V",
+            (void*) &Android_Joystick::onDeviceRemoved
+        },
+        {
+            (char*) "nativeMotionEvent", (char*) "(I[FI)V",
+            (void*) &Android_Joystick::onMotionEvent
+        },
+        {
+            (char*) "nativeButtonEvent", (char*) "(IIZ)V",
+            (void*) &Android_Joystick::onButtonEvent
+        },
+    };
+
+    QAndroidJniEnvironment env;
+    QAndroidJniObject activity = QtAndroid::androidActivity();
+    jclass activityClass = env->GetObjectClass (activity.object());
+
+    /* The activity is not a QJoysticksActivity */
+    int count = sizeof (methods) / sizeof (methods [0]);
+    if (env->RegisterNatives (activityClass, methods, count) < 0) {
+        env->ExceptionClear();
+        env->DeleteLocalRef (activityClass);
+        qWarning() << Q_FUNC_INFO << "Gamepad input is not forwarded by the activity";
+        return;
+    }
+
+    env->DeleteLocalRef (activityClass);
+    activity.callMethod<void> ("startGamepadInput");
+#endif
+}
+
+/**
+ * Stops the gamepad input and deletes the registered devices
+ */
+Android_Joystick::~Android_Joystick()
+{
+#ifdef Q_OS_ANDROID
+    QAndroidJniObject activity = QtAndroid::androidActivity();
+    if (activity.isValid()) {
+        QAndroidJniEnvironment env;
+        activity.callMethod<void> ("stopGamepadInput");
+        env->ExceptionClear();
+    }
+#endif
+
+    INSTANCE.testAndSetOrdered (this, Q_NULLPTR);
+
+    QMutexLocker locker (&m_mutex);
+    qDeleteAll (m_removed);
+    qDeleteAll (m_joysticks);
+}
+
+/**
+ * Returns a list with the attached gamepads
+ */
+QList<QJoystickDevice*> Android_Joystick::joysticks()
+{
+    QMutexLocker locker (&m_mutex);
+
+    qDeleteAll (m_removed);
+    m_removed.clear();
+
+    return m_joysticks;
+}
+
+/**
+ * Sets the \a handler that is called from the thread that receives the
+ * gamepad events
+ */
+void Android_Joystick::setInputHandler (QJoystickInputHandler* handler)
+{
+    m_inputHandler.store (handler);
+}
+
+/**
+ * Registers the gamepad with the given Android device \a id
+ */
+void Android_Joystick::addDevice (const int id, const QString& name,
+                                  const int axes, const int buttons)
+{
+    m_mutex.lock();
+    if (m_devices.contains (id)) {
+        m_mutex.unlock();
+        return;
+    }
+
+    QJoystickDevice* joystick = new QJoystickDevice;
+    joystick->id = -1;
+    joystick->name = name;
+    joystick->blacklisted = false;
+    joystick->povs.fill (0, 1);
+    joystick->axes.fill (0, axes);
+    joystick->buttons.fill (false, buttons);
+
+    m_devices.insert (id, joystick);
+    m_axes.insert (id, QVector<float> (axes, 0));
+    m_povs.insert (id, -1);
+    m_joysticks.append (joystick);
+    m_mutex.unlock();
+
+    emit countChanged();
+}
+
+/**
+ * Unregisters the gamepad with the given Android device \a id, the device
+ * is deleted when the joystick list is read again
+ */
+void Android_Joystick::removeDevice (const int id)
+{
+    m_mutex.lock();
+    if (!m_devices.contains (id)) {
+        m_mutex.unlock();
+        return;
+    }
+
+    QJoystickDevice* joystick = m_devices.take (id);
+    m_axes.remove (id);
+    m_povs.remove (id);
+    m_joysticks.removeAll (joystick);
+    m_removed.append (joystick);
+    m_mutex.unlock();
+
+    emit countChanged();
+}
+
+/**
+ * Reports the \a axes and POV \a angle of a motion event that changed since
+ * the previous event of the same device
+ */
+void Android_Joystick::processMotion (const int id, const float* axes,
+                                      const int count, const int angle)
+{
+    QJoystickInputHandler* handler = m_inputHandler.load();
+    QMutexLocker locker (&m_mutex);
+
+    QJoystickDevice* joystick = m_devices.value (id, Q_NULLPTR);
+    if (!joystick)
+        return;
+
+    QVector<float>& last = m_axes [id];
+    for (int i = 0; i < qMin (count, last.count()); ++i) {
+        if (axes [i] == last [i])
+            continue;
+
+        last [i] = axes [i];
+
+        QJoystickAxisEvent event;
+        event.axis = i;
+        event.value = axes [i];
+        event.timestamp = QJoystickTimestamp();
+        event.joystick = joystick;
+
+        if (handler)
+            handler->axisEvent (event);
+
+        emit axisEvent (event);
+    }
+
+    if (angle != m_povs.value (id)) {
+        m_povs.insert (id, angle);
+
+        QJoystickPOVEvent event;
+        event.pov = 0;
+        event.angle = angle;
+        event.timestamp = QJoystickTimestamp();
+        event.joystick = joystick;
+
+        if (handler)
+            handler->povEvent (event);
+
+        emit POVEvent (event);
+    }
+}
+
+/**
+ * Reports the new \a pressed state of the given \a button
+ */
+void Android_Joystick::processButton (const int id, const int button,
+                                      const bool pressed)
+{
+    QJoystickInputHandler* handler = m_inputHandler.load();
+    QMutexLocker locker (&m_mutex);
+
+    QJoystickDevice* joystick = m_devices.value (id, Q_NULLPTR);
+    if (!joystick)
+        return;
+
+    QJoystickButtonEvent event;
+    event.button = button;
+    event.pressed = pressed;
+    event.timestamp = QJoystickTimestamp();
+    event.joystick = joystick;
+
+    if (handler)
+        handler->buttonEvent (event);
+
+    emit buttonEvent (event);
+}
+
+#ifdef Q_OS_ANDROID
+
+/**
+ * Called by the input device listener of the activity when a gamepad with
+ * the given number of \a axes and \a buttons is attached
+ */
+void Android_Joystick::onDeviceAdded (JNIEnv* env, jobject object, jint id,
+                                      jstring name, jint axes, jint buttons)
+{
+    Q_UNUSED (object);
+
+    Android_Joystick* instance = INSTANCE.load();
+    if (!instance)
+        return;
+
+    const char* chars = env->GetStringUTFChars (name, Q_NULLPTR);
+    QString deviceName = QString::fromUtf8 (chars);
+    env->ReleaseStringUTFChars (name, chars);
+
+    instance->addDevice (id, deviceName, axes, buttons);
+}
+
+/**
+ * Called by the input device listener of the activity when a gamepad is
+ * removed
+ */
+void Android_Joystick::onDeviceRemoved (JNIEnv* env, jobject object, jint id)
+{
+    Q_UNUSED (env);
+    Q_UNUSED (object);
+
+    Android_Joystick* instance = INSTANCE.load();
+    if (instance)
+        instance->removeDevice (id);
+}
+
+/**
+ * Called from the Android UI thread with the values of every axis of a
+ * gamepad motion event
+ */
+void Android_Joystick::onMotionEvent (JNIEnv* env, jobject object, jint id,
+                                      jfloatArray axes, jint angle)
+{
+    Q_UNUSED (object);
+
+    Android_Joystick* instance = INSTANCE.load();
+    if (!instance)
+        return;
+
+    jsize count = env->GetArrayLength (axes);
+    jfloat* values = env->GetFloatArrayElements (axes, Q_NULLPTR);
+    instance->processMotion (id, values, count, angle);
+    env->ReleaseFloatArrayElements (axes, values, JNI_ABORT);
+}
+
+/**
+ * Called from the Android UI thread when a gamepad button is pressed or
+ * released
+ */
+void Android_Joystick::onButtonEvent (JNIEnv* env, jobject object, jint id,
+                                      jint button, jboolean pressed)
+{
+    Q_UNUSED (env);
+    Q_UNUSED (object);
+
+    Android_Joystick* instance = INSTANCE.load();
+    if (instance)
+        instance->processButton (id, button, pressed == JNI_TRUE);
+}
+
+#endif
@@ -20,17 +20,80 @@
  * THE SOFTWARE.
  */
 
+
 #ifndef _QJOYSTICKS_ANDROID_JOYSTICK_H
 #define _QJOYSTICKS_ANDROID_JOYSTICK_H
 
-#include <QtGlobal>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QVector>
+#include <QAtomicPointer>
+#include <QJoysticks/JoysticksCommon.h>
 
 #ifdef Q_OS_ANDROID
     #include <jni.h>
-    #include <QtCore/private/qjni_p.h>
-    #include <QtCore/private/qjnihelpers_p.h>
-    #include <QtAndroidExtras/QtAndroidExtras>
-    #include <QtAndroidExtras/QAndroidJniObject>
 #endif
 
+/**
+ * \brief Translates Android gamepad events into \c QJoysticks events
+ *
+ * The Qt activity owns the input queue of the application, so the gamepad
+ * events are forwarded by \c QJoysticksActivity (a subclass of \c QtActivity)
+ * through native methods, without going through the Qt event loop:
+ *     - The input events are received in the Android UI thread
+ *     - The devices are announced by an input device listener that runs in
+ *       a dedicated looper thread
+ *
+ * Each motion event carries the values of every axis, only the axes that
+ * changed are reported. As with the SDL joysticks, an input handler (if set)
+ * is called directly from the thread that receives the events, before the
+ * events are queued to the rest of the \c QJoysticks system.
+ *
+ * \note On other operating systems this class does not report any joystick
+ */
+class Android_Joystick : public QObject
+{
+    Q_OBJECT
+
+signals:
+    void countChanged();
+    void POVEvent (const QJoystickPOVEvent& event);
+    void axisEvent (const QJoystickAxisEvent& event);
+    void buttonEvent (const QJoystickButtonEvent& event);
+
+public:
+    Android_Joystick (QObject* parent = Q_NULLPTR);
+    ~Android_Joystick();
+
+    QList<QJoystickDevice*> joysticks();
+    void setInputHandler (QJoystickInputHandler* handler);
+
+private:
+    void addDevice (const int id, const QString& name,
+                    const int axes, const int buttons);
+    void removeDevice (const int id);
+    void processMotion (const int id, const float* axes, const int count,
+                        const int angle);
+    void processButton (const int id, const int button, const bool pressed);
+
+#ifdef Q_OS_ANDROID
+    static void onDeviceAdded (JNIEnv* env, jobject object, jint id,
+                               jstring name, jint axes, jint buttons);
+    static void onDeviceRemoved (JNIEnv* env, jobject object, jint id);
+    static void onMotionEvent (JNIEnv* env, jobject object, jint id,
+                               jfloatArray axes, jint angle);
+    static void onButtonEvent (JNIEnv* env, jobject object, jint id,
+                               jint button, jboolean pressed);
+#endif
+
+    QMutex m_mutex;
+    QList<QJoystickDevice*> m_removed;
+    QList<QJoystickDevice*> m_joysticks;
+    QHash<int, QJoystickDevice*> m_devices;
+    QHash<int, QVector<float> > m_axes;
+    QHash<int, int> m_povs;
+    QAtomicPointer<QJoystickInputHandler> m_inputHandler;
+};
+
 #endif
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <QTimer>
+#include <QSettings>
+#include <QCoreApplication>
+#include <QJoysticks/DeferredSettings.h>
+
+/**
+ * Time (in milliseconds) without changes after which the pending changes
+ * are written
+ */
+#define QUIET_PERIOD 1000
+
+DeferredSettingsWriter::DeferredSettingsWriter (const QString& organization,
+                                                const QString& application)
+{
+    m_organization = organization;
+    m_application = application;
+}
+
+/**
+ * Writes the given \a changes (in key order, so that a removed group is
+ * removed before its new values are written) and emits \c written()
+ */
+void DeferredSettingsWriter::write (const QVariantMap& changes, const int batch)
+{
+    QSettings settings (m_organization, m_application);
+
+    QMapIterator<QString, QVariant> it (changes);
+    while (it.hasNext()) {
+        it.next();
+
+        if (it.value().isValid())
+            settings.setValue (it.key(), it.value());
+        else
+            settings.remove (it.key());
+    }
+
+    settings.sync();
+    emit written (batch);
+}
+
+/**
+ * Does nothing, a blocking call to this function returns once the writes
+ * that were requested before it have been done
+ */
+void DeferredSettingsWriter::wait() {}
+
+DeferredSettings::DeferredSettings()
+{
+    m_batch = 0;
+    m_settings = new QSettings (QCoreApplication::organizationName(),
+                                QCoreApplication::applicationName());
+
+    /* Write the changes once the settings stop changing */
+    m_timer = new QTimer (this);
+    m_timer->setSingleShot (true);
+    m_timer->setInterval (QUIET_PERIOD);
+    connect (m_timer, SIGNAL (timeout()), this, SLOT (flush()));
+
+    /* Configure the writer thread */
+    m_writer = new DeferredSettingsWriter (QCoreApplication::organizationName(),
+                                           QCoreApplication::applicationName());
+    m_writer->moveToThread (&m_thread);
+
+    connect (&m_thread, SIGNAL (finished()), m_writer, SLOT (deleteLater()));
+    connect (this,      &DeferredSettings::writeRequested,
+             m_writer,  &DeferredSettingsWriter::write);
+    connect (m_writer,  &DeferredSettingsWriter::written,
+             this,      &DeferredSettings::onWritten);
+
+    m_thread.start (QThread::LowPriority);
+
+    /* Write the pending changes before the application exits */
+    if (QCoreApplication::instance())
+        connect (QCoreApplication::instance(), SIGNAL (aboutToQuit()),
+                 this,                         SLOT (sync()));
+}
+
+DeferredSettings::~DeferredSettings()
+{
+    sync();
+    m_thread.quit();
+    m_thread.wait();
+
+    delete m_settings;
+}
+
+/**
+ * Returns the one and only instance of this class
+ */
+DeferredSettings* DeferredSettings::getInstance()
+{
+    static DeferredSettings settings;
+    return &settings;
+}
+
+/**
+ * Returns the value of the given \a key (or the \a defaultValue if the key
+ * does not exist), the changes that were not written yet are taken into
+ * account
+ */
+QVariant DeferredSettings::value (const QString& key,
+                                  const QVariant& defaultValue)
+{
+    QVariant value;
+    QMutexLocker locker (&m_mutex);
+
+    if (find (m_pending, key, &value) || find (m_inFlight, key, &value))
+        return value.isValid() ? value : defaultValue;
+
+    return m_settings->value (key, defaultValue);
+}
+
+/**
+ * Sends the pending changes to the writer thread
+ */
+void DeferredSettings::flush()
+{
+    QVariantMap changes;
+
+    m_mutex.lock();
+    changes.swap (m_pending);
+
+    QMapIterator<QString, QVariant> it (changes);
+    while (it.hasNext()) {
+        it.next();
+        merge (m_inFlight, it.key(), it.value());
+    }
+
+    const int batch = changes.isEmpty() ? m_batch : ++m_batch;
+    m_mutex.unlock();
+
+    if (!changes.isEmpty())
+        emit writeRequested (changes, batch);
+}
+
+/**
+ * Writes the pending changes and waits until they have been written
+ */
+void DeferredSettings::sync()
+{
+    flush();
+
+    if (m_thread.isRunning())
+        QMetaObject::invokeMethod (m_writer, "wait",
+                                   Qt::BlockingQueuedConnection);
+}
+
+/**
+ * Removes the given \a key and its child keys
+ */
+void DeferredSettings::remove (const QString& key)
+{
+    setValue (key, QVariant());
+}
+
+/**
+ * Changes the \a value of the given \a key, the change is written after the
+ * settings stop changing for a short period of time
+ */
+void DeferredSettings::setValue (const QString& key, const QVariant& value)
+{
+    m_mutex.lock();
+    merge (m_pending, key, value);
+    m_mutex.unlock();
+
+    if (QThread::currentThread() == thread())
+        restartTimer();
+    else
+        QMetaObject::invokeMethod (this, "restartTimer", Qt::QueuedConnection);
+}
+
+/**
+ * Delays the next write by the quiet period
+ */
+void DeferredSettings::restartTimer()
+{
+    m_timer->start();
+}
+
+/**
+ * Forgets the written changes once the last requested \a batch is written
+ * (the settings return the written values from then on)
+ */
+void DeferredSettings::onWritten (const int batch)
+{
+    QMutexLocker locker (&m_mutex);
+    if (batch == m_batch)
+        m_inFlight.clear();
+}
+
+/**
+ * Adds the change of the given \a key to the given \a changes, the changes
+ * of the child keys are dropped if the \a key is removed
+ */
+void DeferredSettings::merge (QVariantMap& changes, const QString& key,
+                              const QVariant& value)
+{
+    if (!value.isValid()) {
+        const QString prefix = key + "/";
+        QVariantMap::iterator it = changes.lowerBound (prefix);
+        while (it != changes.end() && it.key().startsWith (prefix))
+            it = changes.erase (it);
+    }
+
+    changes.insert (key, value);
+}
+
+/**
+ * Finds the change of the given \a key (or the removal of one of its parent
+ * keys) in the given \a changes, removed keys are reported as invalid values
+ */
+bool DeferredSettings::find (const QVariantMap& changes, const QString& key,
+                             QVariant* value)
+{
+    if (changes.contains (key)) {
+        *value = changes.value (key);
+        return true;
+    }
+
+    for (int i = key.lastIndexOf ('/'); i > 0; i = key.lastIndexOf ('/', i - 1)) {
+        QVariantMap::const_iterator it = changes.constFind (key.left (i));
+        if (it != changes.constEnd() && !it.value().isValid()) {
+            *value = QVariant();
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _QJOYSTICKS_DEFERRED_SETTINGS_H
+#define _QJOYSTICKS_DEFERRED_SETTINGS_H
+
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QVariant>
+
+class QTimer;
+class QSettings;
+
+/**
+ * Writes batches of settings changes (and removals, which are stored as
+ * invalid values) in a background thread
+ */
+class DeferredSettingsWriter : public QObject
+{
+    Q_OBJECT
+
+signals:
+    void written (const int batch);
+
+public:
+    DeferredSettingsWriter (const QString& organization,
+                            const QString& application);
+
+public slots:
+    void write (const QVariantMap& changes, const int batch);
+    void wait();
+
+private:
+    QString m_organization;
+    QString m_application;
+};
+
+/**
+ * \brief Batches the settings writes of the application
+ *
+ * Writing a \c QSettings value can be slow (on Windows, each write can hit
+ * the registry synchronously), so the values given to \c setValue() and the
+ * keys given to \c remove() are kept in memory and written by a background
+ * thread once no setting has been changed for a short period of time. The
+ * pending changes are also written when the application quits.
+ *
+ * \c value() returns the pending values, so the settings can be read back
+ * before they are written.
+ *
+ * \note The functions of this class can be called from any thread
+ */
+class DeferredSettings : public QObject
+{
+    Q_OBJECT
+
+signals:
+    void writeRequested (const QVariantMap& changes, const int batch);
+
+public:
+    static DeferredSettings* getInstance();
+
+    QVariant value (const QString& key,
+                    const QVariant& defaultValue = QVariant());
+
+public slots:
+    void flush();
+    void sync();
+    void remove (const QString& key);
+    void setValue (const QString& key, const QVariant& value);
+
+protected:
+    DeferredSettings();
+    ~DeferredSettings();
+
+private slots:
+    void restartTimer();
+    void onWritten (const int batch);
+
+private:
+    static void merge (QVariantMap& changes, const QString& key,
+                       const QVariant& value);
+    static bool find (const QVariantMap& changes, const QString& key,
+                      QVariant* value);
+
+private:
+    int m_batch;
+    QMutex m_mutex;
+    QTimer* m_timer;
+    QThread m_thread;
+    QSettings* m_settings;
+    QVariantMap m_pending;
+    QVariantMap m_inFlight;
+    DeferredSettingsWriter* m_writer;
+};
+
+#endif
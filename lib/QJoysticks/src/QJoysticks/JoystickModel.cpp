@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <QJoysticks.h>
+#include <QJoysticks/JoystickModel.h>
+
+JoystickModel::JoystickModel (QObject* parent) : QAbstractListModel (parent)
+{
+    m_count = 0;
+    m_type = Axes;
+    m_joystick = 0;
+    m_pending = false;
+
+    QJoysticks* joysticks = QJoysticks::getInstance();
+    connect (joysticks, &QJoysticks::countChanged,
+             this,      &JoystickModel::reset);
+    connect (joysticks, &QJoysticks::publishInput,
+             this,      &JoystickModel::publish);
+    connect (joysticks, &QJoysticks::povChanged,
+             this,      &JoystickModel::onPOVChanged);
+    connect (joysticks, &QJoysticks::axisChanged,
+             this,      &JoystickModel::onAxisChanged);
+    connect (joysticks, &QJoysticks::buttonChanged,
+             this,      &JoystickModel::onButtonChanged);
+
+    reset();
+}
+
+/**
+ * Returns the type of the joystick elements represented by the model
+ */
+JoystickModel::Type JoystickModel::type() const
+{
+    return m_type;
+}
+
+/**
+ * Returns the index of the joystick represented by the model
+ */
+int JoystickModel::joystick() const
+{
+    return m_joystick;
+}
+
+/**
+ * Returns the role names used by QML delegates
+ */
+QHash<int, QByteArray> JoystickModel::roleNames() const
+{
+    QHash<int, QByteArray> names;
+    names.insert (ValueRole, "value");
+    return names;
+}
+
+/**
+ * Returns the current value of the axis, button or POV at the given \a index
+ */
+QVariant JoystickModel::data (const QModelIndex& index, int role) const
+{
+    if (role != ValueRole || index.row() < 0 || index.row() >= m_count)
+        return QVariant();
+
+    QJoysticks* joysticks = QJoysticks::getInstance();
+
+    switch (m_type) {
+    case Axes:
+        return joysticks->getAxis (m_joystick, index.row());
+    case Buttons:
+        return joysticks->getButton (m_joystick, index.row());
+    case POVs:
+        return joysticks->getPOV (m_joystick, index.row());
+    }
+
+    return QVariant();
+}
+
+/**
+ * Returns the number of axes, buttons or POVs of the joystick
+ */
+int JoystickModel::rowCount (const QModelIndex& parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return m_count;
+}
+
+/**
+ * Changes the \a type of the joystick elements represented by the model
+ */
+void JoystickModel::setType (const Type type)
+{
+    if (m_type != type) {
+        m_type = type;
+        reset();
+        emit typeChanged();
+    }
+}
+
+/**
+ * Changes the index of the \a joystick represented by the model
+ */
+void JoystickModel::setJoystick (const int joystick)
+{
+    if (m_joystick != joystick) {
+        m_joystick = joystick;
+        reset();
+        emit joystickChanged();
+    }
+}
+
+/**
+ * Re-reads the number of elements of the joystick and resets the model
+ */
+void JoystickModel::reset()
+{
+    int count = 0;
+    QJoysticks* joysticks = QJoysticks::getInstance();
+
+    switch (m_type) {
+    case Axes:
+        count = joysticks->getNumAxes (m_joystick);
+        break;
+    case Buttons:
+        count = joysticks->getNumButtons (m_joystick);
+        break;
+    case POVs:
+        count = joysticks->getNumPOVs (m_joystick);
+        break;
+    }
+
+    /* The joystick does not exist */
+    if (count < 0)
+        count = 0;
+
+    beginResetModel();
+    bool changed = (m_count != count);
+    m_count = count;
+    m_pending = false;
+    m_changed.fill (false, count);
+    endResetModel();
+
+    if (changed)
+        emit countChanged();
+}
+
+/**
+ * Notifies the views about the rows that have changed since the last frame
+ */
+void JoystickModel::publish()
+{
+    if (!m_pending)
+        return;
+
+    m_pending = false;
+    for (int row = 0; row < m_changed.count(); ++row) {
+        if (m_changed.at (row)) {
+            m_changed [row] = false;
+            QModelIndex changed = index (row);
+            emit dataChanged (changed, changed, QVector<int>() << ValueRole);
+        }
+    }
+}
+
+/**
+ * Notifies the row of the given \a pov (if the model represents POVs)
+ */
+void JoystickModel::onPOVChanged (const int js, const int pov)
+{
+    if (m_type == POVs)
+        updateRow (js, pov);
+}
+
+/**
+ * Notifies the row of the given \a axis (if the model represents axes)
+ */
+void JoystickModel::onAxisChanged (const int js, const int axis)
+{
+    if (m_type == Axes)
+        updateRow (js, axis);
+}
+
+/**
+ * Notifies the row of the given \a button (if the model represents buttons)
+ */
+void JoystickModel::onButtonChanged (const int js, const int button)
+{
+    if (m_type == Buttons)
+        updateRow (js, button);
+}
+
+/**
+ * Marks the given \a row as changed (if the event was caused by the joystick
+ * represented by the model) and asks for a new frame to publish it.
+ *
+ * If there is no frame window, the views are notified immediately.
+ */
+void JoystickModel::updateRow (const int js, const int row)
+{
+    if (js != m_joystick || row < 0 || row >= m_count)
+        return;
+
+    m_changed [row] = true;
+
+    if (!m_pending) {
+        m_pending = true;
+
+        QJoysticks* joysticks = QJoysticks::getInstance();
+        if (joysticks->frameWindow())
+            joysticks->requestFrame();
+        else
+            publish();
+    }
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _QJOYSTICKS_JOYSTICK_MODEL_H
+#define _QJOYSTICKS_JOYSTICK_MODEL_H
+
+#include <QVector>
+#include <QAbstractListModel>
+
+/**
+ * \brief Exposes the axes, buttons or POVs of a joystick as a list model
+ *
+ * Each row of the model represents an axis, a button or a POV (depending on
+ * the \c type of the model) of the joystick with the given \c joystick index.
+ *
+ * When a joystick event is received, the model only notifies the row that
+ * belongs to the changed element, so that views (e.g. a QML \c Repeater)
+ * only update the delegate that displays the element, instead of having
+ * every delegate filter every joystick event.
+ *
+ * If \c QJoysticks has a frame window, the changed rows are aggregated and
+ * notified at most once per rendered frame.
+ */
+class JoystickModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY (int joystick
+                READ joystick
+                WRITE setJoystick
+                NOTIFY joystickChanged)
+    Q_PROPERTY (Type type
+                READ type
+                WRITE setType
+                NOTIFY typeChanged)
+    Q_PROPERTY (int count
+                READ rowCount
+                NOTIFY countChanged)
+
+signals:
+    void typeChanged();
+    void countChanged();
+    void joystickChanged();
+
+public:
+    enum Type {
+        Axes,
+        Buttons,
+        POVs,
+    };
+    Q_ENUMS (Type)
+
+    enum Roles {
+        ValueRole = Qt::UserRole + 1,
+    };
+
+    JoystickModel (QObject* parent = Q_NULLPTR);
+
+    Type type() const;
+    int joystick() const;
+    QHash<int, QByteArray> roleNames() const;
+    QVariant data (const QModelIndex& index, int role) const;
+    int rowCount (const QModelIndex& parent = QModelIndex()) const;
+
+public slots:
+    void setType (const Type type);
+    void setJoystick (const int joystick);
+
+private slots:
+    void reset();
+    void publish();
+    void onPOVChanged (const int js, const int pov);
+    void onAxisChanged (const int js, const int axis);
+    void onButtonChanged (const int js, const int button);
+
+private:
+    void updateRow (const int js, const int row);
+
+private:
+    Type m_type;
+    int m_count;
+    int m_joystick;
+    bool m_pending;
+    QVector<bool> m_changed;
+};
+
+#endif
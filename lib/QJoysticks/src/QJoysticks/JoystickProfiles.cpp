@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <cstring>
+
+#include <QDir>
+#include <QMap>
+#include <QDebug>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QJoysticks/JoystickProfiles.h>
+
+/**
+ * Identifies the profile files and their format
+ */
+#define PROFILE_MAGIC   "QJCP"
+#define PROFILE_VERSION 1
+
+/**
+ * Length of the SDL GUID that identifies each profile
+ */
+#define GUID_SIZE 16
+
+/**
+ * Size of each record of the profile file (the GUID and the profile)
+ */
+#define RECORD_SIZE (GUID_SIZE + sizeof (QJoystickProfile))
+
+/**
+ * Header of the profile file, the records follow the header
+ */
+struct ProfileHeader {
+    char magic [4];     /**< Always set to \c PROFILE_MAGIC */
+    quint32 version;    /**< Format version of the file */
+    quint32 count;      /**< Number of records in the file */
+    quint32 recordSize; /**< Size of each record (in bytes) */
+};
+
+JoystickProfiles::JoystickProfiles()
+{
+    m_count = 0;
+    m_records = Q_NULLPTR;
+}
+
+JoystickProfiles::~JoystickProfiles()
+{
+    unmap();
+}
+
+/**
+ * Maps the profile file at the given \a path, the profiles of the previous
+ * file (including the profiles that were not saved) are discarded.
+ *
+ * Returns \c false if the file exists but is not a valid profile file.
+ */
+bool JoystickProfiles::open (const QString& path)
+{
+    QWriteLocker locker (&m_lock);
+
+    unmap();
+    m_changes.clear();
+    m_file.setFileName (path);
+    return map();
+}
+
+/**
+ * Writes the profiles to the profile file (the changed profiles replace the
+ * records with the same GUID) and maps the new file.
+ *
+ * \note The records are rewritten only if a profile was changed since the
+ *       file was opened or saved
+ */
+bool JoystickProfiles::save()
+{
+    QWriteLocker locker (&m_lock);
+
+    if (m_changes.isEmpty())
+        return true;
+
+    /* Merge the mapped records with the changes, sorted by GUID */
+    QMap<QByteArray, QJoystickProfile> profiles;
+    for (quint32 i = 0; i < m_count; ++i) {
+        const uchar* record = m_records + i * RECORD_SIZE;
+
+        QJoystickProfile profile;
+        memcpy (&profile, record + GUID_SIZE, sizeof (profile));
+        profiles.insert (QByteArray ((const char*) record, GUID_SIZE), profile);
+    }
+
+    QHashIterator<QByteArray, QJoystickProfile> it (m_changes);
+    while (it.hasNext()) {
+        it.next();
+        profiles.insert (it.key(), it.value());
+    }
+
+    /* Build the new file */
+    ProfileHeader header;
+    memcpy (header.magic, PROFILE_MAGIC, sizeof (header.magic));
+    header.version = PROFILE_VERSION;
+    header.count = profiles.count();
+    header.recordSize = RECORD_SIZE;
+
+    QByteArray data ((const char*) &header, sizeof (header));
+    QMapIterator<QByteArray, QJoystickProfile> record (profiles);
+    while (record.hasNext()) {
+        record.next();
+        data.append (record.key());
+        data.append ((const char*) &record.value(), sizeof (QJoystickProfile));
+    }
+
+    /* The mapped file cannot be replaced on some systems */
+    unmap();
+    QDir().mkpath (QFileInfo (m_file.fileName()).absolutePath());
+
+    QSaveFile file (m_file.fileName());
+    bool saved = file.open (QFile::WriteOnly) &&
+                 file.write (data) == data.size() &&
+                 file.commit();
+
+    if (!saved)
+        qWarning() << "Cannot save the joystick profiles:" << file.errorString();
+
+    /* Keep the changes in memory if they could not be written */
+    if (map() && saved)
+        m_changes.clear();
+
+    return saved;
+}
+
+/**
+ * Copies the profile of the joystick with the given \a guid to the given
+ * \a profile, returns \c false if the joystick has no profile.
+ */
+bool JoystickProfiles::find (const QByteArray& guid, QJoystickProfile* profile)
+{
+    Q_ASSERT (profile);
+    QReadLocker locker (&m_lock);
+
+    if (m_changes.contains (guid)) {
+        *profile = m_changes.value (guid);
+        return true;
+    }
+
+    const uchar* record = findRecord (guid);
+    if (record) {
+        memcpy (profile, record + GUID_SIZE, sizeof (QJoystickProfile));
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Changes the \a calibration of the given \a axis in the profile of the
+ * joystick with the given \a guid and returns the updated profile.
+ *
+ * \note The change is kept in memory until \c save() is called
+ */
+QJoystickProfile JoystickProfiles::setAxis (const QByteArray& guid,
+                                            const int axis,
+                                            const QJoystickAxisCalibration& calibration)
+{
+    QJoystickProfile profile;
+    memset (&profile, 0, sizeof (profile));
+
+    QWriteLocker locker (&m_lock);
+
+    if (m_changes.contains (guid))
+        profile = m_changes.value (guid);
+
+    else if (const uchar* record = findRecord (guid))
+        memcpy (&profile, record + GUID_SIZE, sizeof (profile));
+
+    if (guid.size() == GUID_SIZE && axis >= 0 && axis < QJOYSTICK_PROFILE_AXES) {
+        profile.axes [axis] = calibration;
+        profile.axisCount = qMax (profile.axisCount, (quint32) axis + 1);
+        m_changes.insert (guid, profile);
+    }
+
+    return profile;
+}
+
+/**
+ * Returns the axis \a value (from -1 to 1) after applying the given
+ * \a calibration to it
+ */
+qreal JoystickProfiles::calibrate (const QJoystickAxisCalibration& calibration,
+                                   const qreal value)
+{
+    /* Center offset */
+    const qreal center = qBound (-0.99, (qreal) calibration.center, 0.99);
+    qreal centered = qBound (-1.0, value, 1.0) - center;
+    centered /= centered > 0 ? 1 - center : 1 + center;
+
+    /* Deadband */
+    const qreal deadband = qBound (0.0, (qreal) calibration.deadband, 0.99);
+    qreal magnitude = qMin (qAbs (centered), 1.0) - deadband;
+    if (magnitude <= 0)
+        return 0;
+
+    magnitude /= 1 - deadband;
+
+    /* Response curve */
+    const qreal curve = qBound (0.0, (qreal) calibration.curve, 1.0);
+    magnitude = (1 - curve) * magnitude + curve * magnitude * magnitude * magnitude;
+
+    return centered < 0 ? -magnitude : magnitude;
+}
+
+/**
+ * Maps the profile file and validates its header, a missing file is handled
+ * as an empty file
+ *
+ * \note The caller must hold the write lock
+ */
+bool JoystickProfiles::map()
+{
+    if (!m_file.exists())
+        return true;
+
+    if (!m_file.open (QFile::ReadOnly))
+        return false;
+
+    const qint64 size = m_file.size();
+    const uchar* data = size >= (qint64) sizeof (ProfileHeader) ?
+                        m_file.map (0, size) : Q_NULLPTR;
+
+    if (data) {
+        ProfileHeader header;
+        memcpy (&header, data, sizeof (header));
+
+        if (memcmp (header.magic, PROFILE_MAGIC, sizeof (header.magic)) == 0 &&
+                header.version == PROFILE_VERSION &&
+                header.recordSize == RECORD_SIZE &&
+                (size - (qint64) sizeof (header)) / RECORD_SIZE >= header.count) {
+            m_count = header.count;
+            m_records = data + sizeof (header);
+            return true;
+        }
+    }
+
+    qWarning() << "Invalid joystick profile file:" << m_file.fileName();
+    unmap();
+    return false;
+}
+
+/**
+ * Unmaps and closes the profile file
+ *
+ * \note The caller must hold the write lock
+ */
+void JoystickProfiles::unmap()
+{
+    if (m_records)
+        m_file.unmap (const_cast<uchar*> (m_records - sizeof (ProfileHeader)));
+
+    m_count = 0;
+    m_records = Q_NULLPTR;
+    m_file.close();
+}
+
+/**
+ * Returns the record of the profile with the given \a guid (or \c NULL if
+ * there is no such record) with a binary search of the mapped records
+ *
+ * \note The caller must hold the lock
+ */
+const uchar* JoystickProfiles::findRecord (const QByteArray& guid) const
+{
+    if (guid.size() != GUID_SIZE)
+        return Q_NULLPTR;
+
+    quint32 low = 0;
+    quint32 high = m_count;
+    while (low < high) {
+        const quint32 middle = low + (high - low) / 2;
+        const uchar* record = m_records + middle * RECORD_SIZE;
+        const int cmp = memcmp (record, guid.constData(), GUID_SIZE);
+
+        if (cmp == 0)
+            return record;
+        else if (cmp < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return Q_NULLPTR;
+}
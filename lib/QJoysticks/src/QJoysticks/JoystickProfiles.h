@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _QJOYSTICKS_JOYSTICK_PROFILES_H
+#define _QJOYSTICKS_JOYSTICK_PROFILES_H
+
+#include <QHash>
+#include <QFile>
+#include <QByteArray>
+#include <QReadWriteLock>
+
+/**
+ * Maximum number of calibrated axes of a joystick (SDL game controllers have
+ * six axes, two are reserved for future layouts)
+ */
+#define QJOYSTICK_PROFILE_AXES 8
+
+/**
+ * @brief Calibration of a joystick axis
+ *
+ * The calibration is applied to the raw axis value in the following order:
+ *     - The \c center offset is subtracted, the value is rescaled so that
+ *       the full range can still be reached on both sides
+ *     - Values with a smaller magnitude than the \c deadband are reported
+ *       as \c 0, values outside of it are rescaled to the full range
+ *     - The \c curve blends the linear response (\c 0) with a cubic
+ *       response (\c 1)
+ *
+ * A zeroed structure leaves the axis value unchanged.
+ */
+struct QJoystickAxisCalibration {
+    float center;   /**< Value reported by the axis at rest (-1 to 1) */
+    float deadband; /**< Size of the dead zone (from 0 to 1) */
+    float curve;    /**< Strength of the cubic response (from 0 to 1) */
+};
+
+/**
+ * @brief Calibration profile of a joystick
+ *
+ * The layout of this structure is the layout of each record of the profile
+ * file, so a profile can be read directly from the mapped file.
+ */
+struct QJoystickProfile {
+    quint32 axisCount; /**< Number of calibrated axes */
+    QJoystickAxisCalibration axes [QJOYSTICK_PROFILE_AXES];
+};
+
+/**
+ * @brief Stores the calibration profiles of the joysticks
+ *
+ * The profiles are kept in a compact binary file, which is memory-mapped when
+ * it is opened. The file contains a small header followed by fixed-size
+ * records sorted by their 16-byte SDL GUID, so that the profile of a joystick
+ * is found with a binary search in the mapped memory (without reading the
+ * file or parsing any settings when a joystick is attached).
+ *
+ * The profiles that are changed by the application are kept in memory until
+ * \c save() writes them (along with the unchanged profiles) to a new file,
+ * which is mapped again.
+ *
+ * \note The functions of this class can be called from any thread
+ */
+class JoystickProfiles
+{
+public:
+    JoystickProfiles();
+    ~JoystickProfiles();
+
+    bool open (const QString& path);
+    bool save();
+
+    bool find (const QByteArray& guid, QJoystickProfile* profile);
+    QJoystickProfile setAxis (const QByteArray& guid, const int axis,
+                              const QJoystickAxisCalibration& calibration);
+
+    static qreal calibrate (const QJoystickAxisCalibration& calibration,
+                            const qreal value);
+
+private:
+    bool map();
+    void unmap();
+    const uchar* findRecord (const QByteArray& guid) const;
+
+    QFile m_file;
+    QReadWriteLock m_lock;
+    const uchar* m_records;
+    quint32 m_count;
+    QHash<QByteArray, QJoystickProfile> m_changes;
+};
+
+#endif
@@ -24,6 +24,10 @@
 #define _QJOYSTICKS_COMMON_H
 
 #include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QMetaType>
+#include <QElapsedTimer>
 
 /**
  * @brief Represents a joystick and its properties
@@ -35,14 +39,16 @@
  *     - The number of buttons operated by the joystick
  *     - The number of POVs operated by the joystick
  *     - A boolean value blacklisting or whitelisting the joystick
+ *     - The SDL GUID of the joystick (empty for other devices)
  */
 struct QJoystickDevice {
     int     id;          /**< Holds the ID of the joystick */
     QString name;        /**< Holds the name/title of the joystick */
-    QList<int> povs;     /**< Holds the values for each POV */
-    QList<double> axes;  /**< Holds the values for each axis */
-    QList<bool> buttons; /**< Holds the values for each button */
+    QVector<int> povs;     /**< Holds the values for each POV */
+    QVector<double> axes;  /**< Holds the values for each axis */
+    QVector<bool> buttons; /**< Holds the values for each button */
     bool    blacklisted; /**< Holds \c true if the joystick is disabled */
+    QByteArray guid;     /**< Holds the 16-byte SDL GUID of the joystick */
 };
 
 /**
@@ -59,6 +65,27 @@ struct QJoystickRumble {
     QJoystickDevice* joystick; /**< The pointer to the target joystick */
 };
 
+/**
+ * @brief Represents a joystick haptic effect with an envelope
+ *
+ * This structure contains:
+ *    - A pointer to the joystick that should play the effect
+ *    - The length (in milliseconds) and strength (from 0 to 1) of the effect
+ *    - The length (in milliseconds) and starting strength of the attack
+ *    - The length (in milliseconds) and final strength of the fade
+ *
+ * \note Effects without an attack or fade are played as simple rumbles
+ */
+struct QJoystickHapticEffect {
+    uint length;               /**< The duration of the effect */
+    qreal strength;            /**< Strength of the effect (0 to 1) */
+    uint attackLength;         /**< The duration of the attack */
+    qreal attackLevel;         /**< Strength at the start of the attack */
+    uint fadeLength;           /**< The duration of the fade */
+    qreal fadeLevel;           /**< Strength at the end of the fade */
+    QJoystickDevice* joystick; /**< The pointer to the target joystick */
+};
+
 /**
  * @brief Represents an POV event that can be triggered by a joystick
  *
@@ -66,10 +93,12 @@ struct QJoystickRumble {
  *    - A pointer to the joystick that triggered the event
  *    - The POV number/ID
  *    - The current POV angle
+ *    - The time (see \c QJoystickTimestamp()) at which the input was read
  */
 struct QJoystickPOVEvent {
     int pov;                   /**< The numerical ID of the POV */
     int angle;                 /**< The current angle of the POV */
+    qint64 timestamp;          /**< Time (in microseconds) of the input */
     QJoystickDevice* joystick; /**< Pointer to the device that caused the event */
 };
 
@@ -80,10 +109,12 @@ struct QJoystickPOVEvent {
  *    - A pointer to the joystick that caused the event
  *    - The axis number/ID
  *    - The current axis value
+ *    - The time (see \c QJoystickTimestamp()) at which the input was read
  */
 struct QJoystickAxisEvent {
     int axis;                  /**< The numerical ID of the axis */
     qreal value;               /**< The value (from -1 to 1) of the axis */
+    qint64 timestamp;          /**< Time (in microseconds) of the input */
     QJoystickDevice* joystick; /**< Pointer to the device that caused the event */
 };
 
@@ -94,11 +125,77 @@ struct QJoystickAxisEvent {
  *   - A pointer to the joystick that caused the event
  *   - The button number/ID
  *   - The current button state (pressed or not pressed)
+ *   - The time (see \c QJoystickTimestamp()) at which the input was read
  */
 struct QJoystickButtonEvent {
     int button;                /**< The numerical ID of the button */
     bool pressed;              /**< Set to \c true if the button is pressed */
+    qint64 timestamp;          /**< Time (in microseconds) of the input */
     QJoystickDevice* joystick; /**< Pointer to the device that caused the event */
 };
 
+/**
+ * @brief Represents the complete state of a joystick, read in one pass
+ *
+ * This structure contains:
+ *   - A pointer to the joystick that was read
+ *   - A pointer to the values of all its POVs, axes and buttons
+ *   - The time (see \c QJoystickTimestamp()) at which the input was read
+ */
+struct QJoystickStateEvent {
+    const QJoystickDevice* state; /**< Values of the POVs, axes and buttons */
+    qint64 timestamp;             /**< Time (in microseconds) of the input */
+    QJoystickDevice* joystick;    /**< Pointer to the device that was read */
+};
+
+/**
+ * Returns the number of microseconds elapsed since the first call of this
+ * function, the backends use it to stamp the joystick events so that the
+ * delay between reading an input and dispatching it can be measured
+ */
+inline qint64 QJoystickTimestamp()
+{
+    struct Clock {
+        QElapsedTimer timer;
+        Clock() { timer.start(); }
+    };
+
+    static Clock clock;
+    return clock.timer.nsecsElapsed() / 1000;
+}
+
+Q_DECLARE_METATYPE (QJoystickPOVEvent)
+Q_DECLARE_METATYPE (QJoystickAxisEvent)
+Q_DECLARE_METATYPE (QJoystickButtonEvent)
+Q_DECLARE_METATYPE (QJoystickHapticEffect)
+
+/**
+ * @brief Receives joystick events as soon as they are read
+ *
+ * An input handler is called from the thread that reads the joystick events
+ * (which is not necessarily the GUI thread), before the events are queued
+ * to the rest of the \c QJoysticks system. This allows the application to
+ * forward the joystick input without waiting for the GUI event loop.
+ *
+ * Backends that read the whole state of a joystick at once (e.g. the SDL
+ * state polling) first offer it to \c stateEvent(). If the handler accepts
+ * it (by returning \c true), the POV, axis and button events of that state
+ * are not sent to the handler, so it can apply all the values at once.
+ *
+ * \note Implementations must be thread-safe and should return quickly
+ */
+class QJoystickInputHandler
+{
+public:
+    virtual ~QJoystickInputHandler() {}
+    virtual void povEvent (const QJoystickPOVEvent& event) = 0;
+    virtual void axisEvent (const QJoystickAxisEvent& event) = 0;
+    virtual void buttonEvent (const QJoystickButtonEvent& event) = 0;
+    virtual bool stateEvent (const QJoystickStateEvent& event)
+    {
+        Q_UNUSED (event);
+        return false;
+    }
+};
+
 #endif
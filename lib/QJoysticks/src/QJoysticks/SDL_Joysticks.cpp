@@ -20,12 +20,104 @@
  * THE SOFTWARE.
  */
 
+#include <algorithm>
+
 #include <QFile>
 #include <QDebug>
 #include <QTimer>
+#include <QVector>
+#include <QThread>
 #include <QApplication>
+#include <QStandardPaths>
 #include <QJoysticks/SDL_Joysticks.h>
 
+/*
+ * Applications that link the LibDS can trace the joystick input along with
+ * the rest of the DS pipeline (see DS_Trace.h)
+ */
+#if defined DS_ENABLE_TRACE
+    #include <DS_Trace.h>
+#else
+    #define DS_TRACE_THREAD(name) ((void) 0)
+    #define DS_TRACE_SCOPE(name) ((void) 0)
+#endif
+
+/**
+ * Default rate (in Hz) at which the input thread reads the joystick events
+ */
+#define DEFAULT_POLLING_RATE 1000
+
+/**
+ * Time (in milliseconds) after the last calibration change at which the
+ * calibration profiles are written to the disk
+ */
+#define PROFILE_SAVE_DELAY 2000
+
+/**
+ * Reads the SDL events outside of the GUI thread, so that the joystick input
+ * is not delayed by the layout and rendering of the user interface
+ */
+class SDL_InputThread : public QThread
+{
+public:
+    SDL_InputThread (SDL_Joysticks* joysticks) : m_joysticks (joysticks) {}
+
+protected:
+    void run()
+    {
+#ifdef SDL_SUPPORTED
+        SDL_Event event;
+        DS_TRACE_THREAD ("SDL input");
+
+        while (!isInterruptionRequested()) {
+            int interval = qMax (1, 1000 / m_joysticks->pollingRate());
+
+            /* Wait for the next event and process all pending events */
+            if (SDL_WaitEventTimeout (&event, interval)) {
+                DS_TRACE_SCOPE ("SDL_Joysticks::update");
+                do
+                    m_joysticks->processEvent (&event);
+                while (SDL_PollEvent (&event));
+            }
+
+            /* Play the haptic effects requested by the application */
+            m_joysticks->playPendingEffects();
+            m_joysticks->applyPendingProfiles();
+        }
+#endif
+    }
+
+private:
+    SDL_Joysticks* m_joysticks;
+};
+
+/**
+ * Initializes the SDL joystick and haptic subsystems and loads the controller
+ * mappings outside of the GUI thread (the audio subsystem is not used)
+ */
+class SDL_InitThread : public QThread
+{
+public:
+    SDL_InitThread() : m_success (false) {}
+
+    bool success() const
+    {
+        return m_success;
+    }
+
+    QString error() const
+    {
+        return m_error;
+    }
+
+protected:
+    void run();
+
+private:
+    bool m_success;
+    QString m_error;
+};
+
 /**
  * Holds a generic mapping to be applied to joysticks that have not been mapped
  * by the SDL project or by the database.
@@ -34,6 +126,71 @@
  */
 static QString GENERIC_MAPPINGS;
 
+#ifdef SDL_SUPPORTED
+/**
+ * Returns the POV angle that corresponds to the given SDL hat \a value, or
+ * \c -1 if the hat is centered
+ */
+static int getHatAngle (const Uint8 value)
+{
+    switch (value) {
+    case SDL_HAT_RIGHTUP:
+        return 45;
+    case SDL_HAT_RIGHTDOWN:
+        return 135;
+    case SDL_HAT_LEFTDOWN:
+        return 225;
+    case SDL_HAT_LEFTUP:
+        return 315;
+    case SDL_HAT_UP:
+        return 0;
+    case SDL_HAT_RIGHT:
+        return 90;
+    case SDL_HAT_DOWN:
+        return 180;
+    case SDL_HAT_LEFT:
+        return 270;
+    default:
+        return -1;
+    }
+}
+
+/**
+ * Converts the SDL timestamp of the given \a event to the clock used by
+ * \c QJoystickTimestamp(), so that the time elapsed since SDL received the
+ * input can be measured
+ */
+static qint64 getEventTimestamp (const SDL_Event* event)
+{
+    Uint32 age = SDL_GetTicks() - event->common.timestamp;
+    return QJoystickTimestamp() - static_cast<qint64> (age) * 1000;
+}
+
+/**
+ * Location of a controller mapping of the database, the mappings are only
+ * added to SDL when a joystick with the same GUID is attached
+ */
+struct SDL_MappingEntry {
+    bool added;
+    int offset;
+    SDL_JoystickGUID guid;
+};
+
+/**
+ * Holds the mapping database (each mapping is a null-terminated string) and
+ * the index of the mappings for the current platform, sorted by GUID
+ */
+static QByteArray MAPPING_DATA;
+static QVector<SDL_MappingEntry> MAPPING_INDEX;
+
+/**
+ * Orders two mapping entries by their GUID
+ */
+static bool compareMappings (const SDL_MappingEntry& a, const SDL_MappingEntry& b)
+{
+    return memcmp (&a.guid, &b.guid, sizeof (SDL_JoystickGUID)) < 0;
+}
+
 /**
  * Load a different generic/backup mapping for each operating system.
  */
@@ -47,24 +204,86 @@ static QString GENERIC_MAPPINGS;
     #endif
 #endif
 
-SDL_Joysticks::SDL_Joysticks (QObject* parent) : QObject (parent)
+/**
+ * Builds the index of the controller mappings of the current platform, the
+ * line breaks of the database are replaced with null characters so that
+ * each mapping can be passed to SDL without copying it
+ */
+static void indexMappings()
 {
-    m_tracker = -1;
+    const QByteArray platform = QByteArray ("platform:") + SDL_GetPlatform();
+
+    char* data = MAPPING_DATA.data();
+    const int size = MAPPING_DATA.size();
+
+    int start = 0;
+    while (start < size) {
+        int end = start;
+        while (end < size && data [end] != '\n' && data [end] != '\r')
+            ++end;
+
+        if (end < size)
+            data [end] = '\0';
+
+        /* Skip comments, empty lines and mappings of other platforms */
+        const char* line = data + start;
+        const int length = end - start;
+        const QByteArray view = QByteArray::fromRawData (line, length);
+        if (length > 32 && line [0] != '#' && line [32] == ',' &&
+                (!view.contains ("platform:") || view.contains (platform))) {
+            char guid [33];
+            memcpy (guid, line, 32);
+            guid [32] = '\0';
+
+            SDL_MappingEntry entry;
+            entry.added = false;
+            entry.offset = start;
+            entry.guid = SDL_JoystickGetGUIDFromString (guid);
+            MAPPING_INDEX.append (entry);
+        }
+
+        start = end + 1;
+    }
 
+    std::sort (MAPPING_INDEX.begin(), MAPPING_INDEX.end(), compareMappings);
+}
+
+/**
+ * Adds the database mappings of the joystick with the given \a guid to SDL
+ * (if they have not been added yet)
+ */
+static void loadMapping (const SDL_JoystickGUID& guid)
+{
+    SDL_MappingEntry key;
+    key.guid = guid;
+
+    QVector<SDL_MappingEntry>::iterator it;
+    it = std::lower_bound (MAPPING_INDEX.begin(), MAPPING_INDEX.end(), key,
+                           compareMappings);
+
+    for (; it != MAPPING_INDEX.end() && !compareMappings (key, *it); ++it) {
+        if (!it->added) {
+            SDL_GameControllerAddMapping (MAPPING_DATA.constData() + it->offset);
+            it->added = true;
+        }
+    }
+}
+#endif
+
+void SDL_InitThread::run()
+{
 #ifdef SDL_SUPPORTED
-    if (SDL_Init (SDL_INIT_HAPTIC | SDL_INIT_AUDIO | SDL_INIT_GAMECONTROLLER)) {
-        qDebug() << "Cannot initialize SDL:" << SDL_GetError();
-        qApp->quit();
+    if (SDL_Init (SDL_INIT_HAPTIC | SDL_INIT_GAMECONTROLLER)) {
+        m_error = QString::fromUtf8 (SDL_GetError());
+        return;
     }
 
+    /* Index the mappings, they are added when their joysticks are attached */
     QFile database (":/QJoysticks/SDL/Database.txt");
     if (database.open (QFile::ReadOnly)) {
-        while (!database.atEnd()) {
-            QString line = QString::fromUtf8 (database.readLine());
-            SDL_GameControllerAddMapping (line.toStdString().c_str());
-        }
-
+        MAPPING_DATA = database.readAll();
         database.close();
+        indexMappings();
     }
 
     QFile genericMappings (GENERIC_MAPPINGS_PATH);
@@ -73,84 +292,655 @@ SDL_Joysticks::SDL_Joysticks (QObject* parent) : QObject (parent)
         genericMappings.close();
     }
 
-    QTimer::singleShot (100, Qt::PreciseTimer, this, SLOT (update()));
+    m_success = true;
+#endif
+}
+
+SDL_Joysticks::SDL_Joysticks (QObject* parent) : QObject (parent)
+{
+    m_timer = new QTimer (this);
+    m_initialized = false;
+    m_useInputThread = false;
+    m_initThread = Q_NULLPTR;
+    m_inputThread = Q_NULLPTR;
+    m_inputHandler = Q_NULLPTR;
+    m_pollingRate = DEFAULT_POLLING_RATE;
+    m_statePolling = 0;
+
+    /* Map the calibration profiles, they are looked up on hot-plug */
+    m_profiles.open (QStandardPaths::writableLocation (QStandardPaths::AppDataLocation)
+                     + "/JoystickProfiles.bin");
+
+    m_saveTimer = new QTimer (this);
+    m_saveTimer->setSingleShot (true);
+    m_saveTimer->setInterval (PROFILE_SAVE_DELAY);
+    connect (m_saveTimer, SIGNAL (timeout()), this, SLOT (saveProfiles()));
+
+    /* Allow the events to be queued from the input thread */
+    qRegisterMetaType<QJoystickPOVEvent>();
+    qRegisterMetaType<QJoystickAxisEvent>();
+    qRegisterMetaType<QJoystickButtonEvent>();
+    qRegisterMetaType<QJoystickHapticEffect>();
+
+#ifdef SDL_SUPPORTED
+    m_timer->setInterval (10);
+    m_timer->setTimerType (Qt::PreciseTimer);
+    connect (m_timer, SIGNAL (timeout()), this, SLOT (update()));
+
+    /* Initialize SDL without blocking the GUI thread */
+    m_initThread = new SDL_InitThread;
+    connect (m_initThread, SIGNAL (finished()), this, SLOT (onInitialized()));
+    m_initThread->start();
 #endif
 }
 
 SDL_Joysticks::~SDL_Joysticks()
 {
+    setInputThreadEnabled (false);
+    saveProfiles();
+
+    if (m_initThread) {
+        m_initThread->wait();
+        delete m_initThread;
+    }
+
 #ifdef SDL_SUPPORTED
+    foreach (SDL_Haptic* haptic, m_haptics)
+        SDL_HapticClose (haptic);
+
+    foreach (SDL_GameController* controller, m_controllers)
+        SDL_GameControllerClose (controller);
+
     SDL_Quit();
 #endif
+
+    qDeleteAll (m_removed);
+    qDeleteAll (m_joysticks);
 }
 
 /**
- * Returns a list with all the registered joystick devices
+ * Returns a list with all the registered joystick devices (in the order in
+ * which they were attached).
+ *
+ * \note The devices of the joysticks that were removed since the last call
+ *       are deleted by this function, this is safe because the joystick
+ *       signals emitted before the removal are delivered before the
+ *       \c countChanged() signal that triggers the rescan
  */
 QList<QJoystickDevice*> SDL_Joysticks::joysticks()
 {
-    QList<QJoystickDevice*> list;
+    QMutexLocker locker (&m_mutex);
+
+    qDeleteAll (m_removed);
+    m_removed.clear();
+
+    return m_joysticks;
+}
+
+/**
+ * Returns the rate (in Hz) at which the input thread reads the joystick events
+ */
+int SDL_Joysticks::pollingRate() const
+{
+    return m_pollingRate.load();
+}
+
+/**
+ * Returns \c true if the joystick events are read by the input thread instead
+ * of the GUI thread
+ */
+bool SDL_Joysticks::inputThreadEnabled() const
+{
+    return m_useInputThread;
+}
 
+/**
+ * Returns \c true if the joystick input is read by \c pollState() instead of
+ * being reported for every SDL event
+ */
+bool SDL_Joysticks::statePollingEnabled() const
+{
+    return m_statePolling.load() != 0;
+}
+
+/**
+ * Returns the number of input events of the given \a joystick that were
+ * discarded while state polling was enabled (the changes that they reported
+ * are coalesced into the next \c pollState() call)
+ */
+int SDL_Joysticks::coalescedEvents (const QJoystickDevice* joystick)
+{
+    QMutexLocker locker (&m_mutex);
+    return m_coalesced.value (m_devices.key (const_cast<QJoystickDevice*> (joystick), -1));
+}
+
+/**
+ * Sets the \a handler that is called (from the thread that reads the events)
+ * for every joystick event, before the event is emitted as a signal.
+ *
+ * \note Set the \a handler to \c NULL to stop calling it
+ */
+void SDL_Joysticks::setInputHandler (QJoystickInputHandler* handler)
+{
+    m_inputHandler.store (handler);
+}
+
+/**
+ * Changes the \a rate (in Hz) at which the input thread reads the joystick
+ * events. The rate is limited to the 1 Hz to 1000 Hz range.
+ */
+void SDL_Joysticks::setPollingRate (const int rate)
+{
+    m_pollingRate.store (qBound (1, rate, 1000));
+}
+
+/**
+ * Starts or stops the high-priority input thread. While the input thread is
+ * running, the GUI thread stops reading the SDL events and the joystick
+ * signals are emitted from the input thread (and queued to their receivers).
+ *
+ * \note If SDL is still being initialized, the input thread is started once
+ *       the initialization has finished
+ */
+void SDL_Joysticks::setInputThreadEnabled (const bool enabled)
+{
+    if (enabled != m_useInputThread) {
+        m_useInputThread = enabled;
+        applyPollingMode();
+    }
+}
+
+/**
+ * Reads the state of every open controller in one pass and reports the POVs,
+ * axes and buttons that changed since the last call (to the input handler and
+ * with the joystick signals). This function does nothing if state polling is
+ * disabled.
+ *
+ * \note This function can be called from any thread (e.g. the thread that
+ *       builds the robot packets)
+ */
+void SDL_Joysticks::pollState()
+{
 #ifdef SDL_SUPPORTED
-    for (int i = 0; i < SDL_NumJoysticks(); ++i)
-        list.append (getJoystick (i));
+    if (!m_statePolling.load())
+        return;
+
+    QJoystickInputHandler* handler = m_inputHandler.load();
+    QMutexLocker locker (&m_mutex);
+
+    QHashIterator<int, SDL_GameController*> it (m_controllers);
+    while (it.hasNext()) {
+        it.next();
+
+        QJoystickDevice* joystick = m_devices.value (it.key(), Q_NULLPTR);
+        if (!joystick)
+            continue;
+
+        /* Get the last reported state (neutral for new controllers) */
+        SDL_GameController* controller = it.value();
+        SDL_Joystick* sdl_joystick = SDL_GameControllerGetJoystick (controller);
+        if (!m_polledStates.contains (it.key())) {
+            QJoystickDevice neutral;
+            neutral.id = joystick->id;
+            neutral.blacklisted = false;
+            neutral.povs.fill (-1, joystick->povs.count());
+            neutral.axes.fill (0, joystick->axes.count());
+            neutral.buttons.fill (false, joystick->buttons.count());
+            m_polledStates.insert (it.key(), neutral);
+        }
+
+        QJoystickDevice& state = m_polledStates [it.key()];
+        qint64 timestamp = QJoystickTimestamp();
+
+        /* Read the POVs that changed */
+        QVector<QJoystickPOVEvent> povEvents;
+        for (int i = 0; i < state.povs.count(); ++i) {
+            int angle = getHatAngle (SDL_JoystickGetHat (sdl_joystick, i));
+            if (angle == state.povs [i])
+                continue;
+
+            state.povs [i] = angle;
+
+            QJoystickPOVEvent event;
+            event.pov = i;
+            event.angle = angle;
+            event.timestamp = timestamp;
+            event.joystick = joystick;
+            povEvents.append (event);
+        }
+
+        /* Read the axes that changed */
+        QVector<QJoystickAxisEvent> axisEvents;
+        int axes = qMin (state.axes.count(), (int) SDL_CONTROLLER_AXIS_MAX);
+        for (int i = 0; i < axes; ++i) {
+            qreal value = static_cast<qreal> (SDL_GameControllerGetAxis (
+                                                  controller, (SDL_GameControllerAxis) i)) / 32767;
+            value = calibrate (it.key(), i, value);
+            if (value == state.axes [i])
+                continue;
+
+            state.axes [i] = value;
+
+            QJoystickAxisEvent event;
+            event.axis = i;
+            event.value = value;
+            event.timestamp = timestamp;
+            event.joystick = joystick;
+            axisEvents.append (event);
+        }
+
+        /* Read the buttons that changed */
+        QVector<QJoystickButtonEvent> buttonEvents;
+        for (int i = 0; i < state.buttons.count(); ++i) {
+            bool pressed = SDL_JoystickGetButton (sdl_joystick, i) == 1;
+            if (pressed == state.buttons [i])
+                continue;
+
+            state.buttons [i] = pressed;
+
+            QJoystickButtonEvent event;
+            event.button = i;
+            event.pressed = pressed;
+            event.timestamp = timestamp;
+            event.joystick = joystick;
+            buttonEvents.append (event);
+        }
+
+        if (povEvents.isEmpty() && axisEvents.isEmpty() && buttonEvents.isEmpty())
+            continue;
+
+        /* Give the whole state to the handler, or each value if it does
+         * not handle complete states */
+        if (handler) {
+            QJoystickStateEvent event;
+            event.state = &state;
+            event.timestamp = timestamp;
+            event.joystick = joystick;
+
+            if (!handler->stateEvent (event)) {
+                foreach (const QJoystickPOVEvent& e, povEvents)
+                    handler->povEvent (e);
+                foreach (const QJoystickAxisEvent& e, axisEvents)
+                    handler->axisEvent (e);
+                foreach (const QJoystickButtonEvent& e, buttonEvents)
+                    handler->buttonEvent (e);
+            }
+        }
+
+        /* Report the values that changed */
+        foreach (const QJoystickPOVEvent& e, povEvents)
+            emit POVEvent (e);
+        foreach (const QJoystickAxisEvent& e, axisEvents)
+            emit axisEvent (e);
+        foreach (const QJoystickButtonEvent& e, buttonEvents)
+            emit buttonEvent (e);
+    }
 #endif
+}
+
+/**
+ * Enables or disables state polling. While state polling is enabled, the
+ * SDL input events are discarded (the joystick hot-plug events are still
+ * handled) and the input is only reported by \c pollState().
+ */
+void SDL_Joysticks::setStatePollingEnabled (const bool enabled)
+{
+    QMutexLocker locker (&m_mutex);
+    m_statePolling.store (enabled ? 1 : 0);
+    m_polledStates.clear();
+}
+
+/**
+ * Returns the calibration of the given \a axis of the given \a joystick, or a
+ * zeroed calibration if the axis is not calibrated
+ */
+QJoystickAxisCalibration SDL_Joysticks::axisCalibration (const QJoystickDevice* joystick,
+                                                         const int axis)
+{
+    QJoystickProfile profile;
+    QJoystickAxisCalibration calibration;
+    memset (&calibration, 0, sizeof (calibration));
+
+    if (joystick && m_profiles.find (joystick->guid, &profile))
+        if (axis >= 0 && axis < (int) qMin (profile.axisCount, (quint32) QJOYSTICK_PROFILE_AXES))
+            calibration = profile.axes [axis];
 
-    return list;
+    return calibration;
+}
+
+/**
+ * Changes the \a calibration of the given \a axis in the profile of the given
+ * \a joystick. The profile is applied by the thread that reads the joystick
+ * events and saved to the disk a few seconds after the last change.
+ *
+ * Returns \c false if the \a joystick is not an SDL joystick or the \a axis
+ * cannot be calibrated.
+ */
+bool SDL_Joysticks::setAxisCalibration (const QJoystickDevice* joystick,
+                                        const int axis,
+                                        const QJoystickAxisCalibration& calibration)
+{
+    if (!joystick || joystick->guid.isEmpty())
+        return false;
+
+    if (axis < 0 || axis >= QJOYSTICK_PROFILE_AXES)
+        return false;
+
+    QJoystickProfile profile = m_profiles.setAxis (joystick->guid, axis, calibration);
+
+    m_profileMutex.lock();
+    m_pendingProfiles.insert (joystick->guid, profile);
+    m_profileMutex.unlock();
+
+    m_saveTimer->start();
+    return true;
 }
 
 /**
  * Based on the data contained in the \a request, this function will instruct
- * the appropriate joystick to rumble for
+ * the appropriate joystick to rumble for the given length and strength.
+ *
+ * \note The request is queued, see \c playEffect()
  */
 void SDL_Joysticks::rumble (const QJoystickRumble& request)
+{
+    QJoystickHapticEffect effect;
+    effect.fadeLength = 0;
+    effect.fadeLevel = 0;
+    effect.attackLength = 0;
+    effect.attackLevel = 0;
+    effect.length = request.length;
+    effect.strength = request.strength;
+    effect.joystick = request.joystick;
+
+    playEffect (effect);
+}
+
+/**
+ * Queues the given haptic \a effect, which is played by the thread that reads
+ * the joystick events (using the cached haptic device of the joystick).
+ *
+ * If an effect for the same joystick is already queued, it is replaced by
+ * the new \a effect. This function is thread-safe and does not block.
+ */
+void SDL_Joysticks::playEffect (const QJoystickHapticEffect& effect)
+{
+    if (!effect.joystick)
+        return;
+
+    QMutexLocker locker (&m_effectMutex);
+    for (int i = 0; i < m_pendingEffects.count(); ++i) {
+        if (m_pendingEffects.at (i).joystick == effect.joystick) {
+            m_pendingEffects [i] = effect;
+            return;
+        }
+    }
+
+    m_pendingEffects.append (effect);
+}
+
+/**
+ * Plays the queued haptic effects. Effects with an envelope are played as
+ * sine effects (if the haptic device supports them), other effects (and
+ * devices) use the simple rumble API of SDL.
+ */
+void SDL_Joysticks::playPendingEffects()
+{
+#ifdef SDL_SUPPORTED
+    QList<QJoystickHapticEffect> effects;
+
+    m_effectMutex.lock();
+    effects.swap (m_pendingEffects);
+    m_effectMutex.unlock();
+
+    foreach (const QJoystickHapticEffect& effect, effects) {
+        int instance = m_devices.key (effect.joystick, -1);
+        SDL_Haptic* haptic = m_haptics.value (instance, Q_NULLPTR);
+        if (!haptic)
+            continue;
+
+        qreal strength = qBound<qreal> (0, effect.strength, 1);
+        bool envelope = effect.attackLength > 0 || effect.fadeLength > 0;
+
+        /* Play a simple rumble */
+        if (!envelope || !(SDL_HapticQuery (haptic) & SDL_HAPTIC_SINE)) {
+            SDL_HapticRumblePlay (haptic, strength, effect.length);
+            continue;
+        }
+
+        /* Construct the effect */
+        SDL_HapticEffect sdl_effect;
+        SDL_memset (&sdl_effect, 0, sizeof (sdl_effect));
+        sdl_effect.type = SDL_HAPTIC_SINE;
+        sdl_effect.periodic.direction.type = SDL_HAPTIC_CARTESIAN;
+        sdl_effect.periodic.direction.dir [0] = 1;
+        sdl_effect.periodic.period = 20; /* Short period, feels like a rumble */
+        sdl_effect.periodic.length = effect.length;
+        sdl_effect.periodic.magnitude = strength * 0x7FFF;
+        sdl_effect.periodic.attack_length = qMin (effect.attackLength, 0xFFFFu);
+        sdl_effect.periodic.attack_level = qBound<qreal> (0, effect.attackLevel, 1) * 0x7FFF;
+        sdl_effect.periodic.fade_length = qMin (effect.fadeLength, 0xFFFFu);
+        sdl_effect.periodic.fade_level = qBound<qreal> (0, effect.fadeLevel, 1) * 0x7FFF;
+
+        /* Upload the effect once and update it afterwards */
+        int id = m_hapticEffects.value (instance, -1);
+        if (id >= 0 && SDL_HapticUpdateEffect (haptic, id, &sdl_effect) < 0) {
+            SDL_HapticDestroyEffect (haptic, id);
+            id = -1;
+        }
+
+        if (id < 0) {
+            id = SDL_HapticNewEffect (haptic, &sdl_effect);
+            if (id < 0) {
+                SDL_HapticRumblePlay (haptic, strength, effect.length);
+                continue;
+            }
+
+            m_hapticEffects.insert (instance, id);
+        }
+
+        SDL_HapticRunEffect (haptic, id, 1);
+    }
+#endif
+}
+
+/**
+ * Applies the queued calibration profiles to the attached joysticks with
+ * the same GUID
+ */
+void SDL_Joysticks::applyPendingProfiles()
+{
+    QHash<QByteArray, QJoystickProfile> profiles;
+
+    m_profileMutex.lock();
+    profiles.swap (m_pendingProfiles);
+    m_profileMutex.unlock();
+
+    if (profiles.isEmpty())
+        return;
+
+    /* The calibrations are read by pollState() while the mutex is held */
+    QMutexLocker locker (&m_mutex);
+    QHashIterator<int, QJoystickDevice*> it (m_devices);
+    while (it.hasNext()) {
+        it.next();
+        if (profiles.contains (it.value()->guid))
+            m_calibrations.insert (it.key(), profiles.value (it.value()->guid));
+    }
+}
+
+/**
+ * Returns the given axis \a value after applying the calibration profile of
+ * the joystick with the given SDL \a instance ID (if any)
+ *
+ * \note The calibrations are only changed by the thread that reads the
+ *       joystick events, so it can read them without holding the mutex
+ */
+qreal SDL_Joysticks::calibrate (const int instance, const int axis,
+                                const qreal value)
+{
+    QHash<int, QJoystickProfile>::const_iterator it = m_calibrations.constFind (instance);
+    if (it == m_calibrations.constEnd() || axis < 0 || axis >= (int) it->axisCount)
+        return value;
+
+    return JoystickProfiles::calibrate (it->axes [axis], value);
+}
+
+/**
+ * Writes the changed calibration profiles to the disk
+ */
+void SDL_Joysticks::saveProfiles()
+{
+    m_saveTimer->stop();
+    m_profiles.save();
+}
+
+/**
+ * Starts reading the joystick events with the input thread or the GUI timer
+ * (depending on the input thread setting), once SDL has been initialized
+ */
+void SDL_Joysticks::applyPollingMode()
 {
 #ifdef SDL_SUPPORTED
-    SDL_Haptic* haptic = SDL_HapticOpen (request.joystick->id);
+    if (!m_initialized)
+        return;
 
-    if (haptic) {
-        SDL_HapticRumbleInit (haptic);
-        SDL_HapticRumblePlay (haptic, request.strength, request.length);
+    if (m_useInputThread && !m_inputThread) {
+        m_timer->stop();
+        m_inputThread = new SDL_InputThread (this);
+        m_inputThread->start (QThread::TimeCriticalPriority);
     }
-#else
-    Q_UNUSED (request);
+
+    else if (!m_useInputThread && m_inputThread) {
+        m_inputThread->requestInterruption();
+        m_inputThread->wait();
+
+        delete m_inputThread;
+        m_inputThread = Q_NULLPTR;
+    }
+
+    if (!m_useInputThread && !m_timer->isActive())
+        m_timer->start();
 #endif
 }
 
+/**
+ * Called when the background thread has initialized SDL, the joysticks that
+ * are already attached are reported (as added devices) by the first events
+ * that are read after this function
+ */
+void SDL_Joysticks::onInitialized()
+{
+    if (!m_initThread->success()) {
+        qDebug() << "Cannot initialize SDL:" << m_initThread->error();
+        qApp->quit();
+        return;
+    }
+
+    m_initialized = true;
+    applyPollingMode();
+}
+
 /**
  * Polls for new SDL events and reacts to each event accordingly.
+ *
+ * \note This function does nothing while the input thread is running
  */
 void SDL_Joysticks::update()
 {
 #ifdef SDL_SUPPORTED
+    if (m_inputThread)
+        return;
+
+    DS_TRACE_SCOPE ("SDL_Joysticks::update");
+
     SDL_Event event;
+    while (SDL_PollEvent (&event))
+        processEvent (&event);
 
-    while (SDL_PollEvent (&event)) {
-        switch (event.type) {
-        case SDL_JOYDEVICEADDED:
-            configureJoystick (&event);
-            break;
-        case SDL_JOYDEVICEREMOVED:
-            SDL_JoystickClose (SDL_JoystickOpen (event.jdevice.which));
-            SDL_GameControllerClose (SDL_GameControllerOpen (event.cdevice.which));
-            emit countChanged();
-            break;
+    playPendingEffects();
+    applyPendingProfiles();
+#endif
+}
+
+/**
+ * Reacts to the given SDL \a event, the input handler (if any) is called
+ * before emitting the joystick signals
+ */
+void SDL_Joysticks::processEvent (const SDL_Event* event)
+{
+#ifdef SDL_SUPPORTED
+    QJoystickInputHandler* handler = m_inputHandler.load();
+
+    /* The input is read by pollState(), count the events that it coalesces */
+    if (m_statePolling.load()) {
+        int instance = -1;
+        switch (event->type) {
         case SDL_CONTROLLERAXISMOTION:
-            emit axisEvent (getAxisEvent (&event));
+            instance = event->caxis.which;
             break;
         case SDL_JOYBUTTONUP:
-            emit buttonEvent (getButtonEvent (&event));
-            break;
         case SDL_JOYBUTTONDOWN:
-            emit buttonEvent (getButtonEvent (&event));
+            instance = event->jbutton.which;
             break;
         case SDL_JOYHATMOTION:
-            emit POVEvent (getPOVEvent (&event));
+            instance = event->jhat.which;
             break;
         }
+
+        if (instance != -1) {
+            QMutexLocker locker (&m_mutex);
+            if (m_devices.contains (instance))
+                ++m_coalesced [instance];
+
+            return;
+        }
+    }
+
+    switch (event->type) {
+    case SDL_JOYDEVICEADDED:
+        configureJoystick (event);
+        break;
+    case SDL_JOYDEVICEREMOVED:
+        removeJoystick (event);
+        break;
+    case SDL_CONTROLLERAXISMOTION: {
+        QJoystickAxisEvent axis = getAxisEvent (event);
+        if (!axis.joystick)
+            break;
+
+        if (handler)
+            handler->axisEvent (axis);
+
+        emit axisEvent (axis);
+        break;
     }
+    case SDL_JOYBUTTONUP:
+    case SDL_JOYBUTTONDOWN: {
+        QJoystickButtonEvent button = getButtonEvent (event);
+        if (!button.joystick)
+            break;
+
+        if (handler)
+            handler->buttonEvent (button);
+
+        emit buttonEvent (button);
+        break;
+    }
+    case SDL_JOYHATMOTION: {
+        QJoystickPOVEvent pov = getPOVEvent (event);
+        if (!pov.joystick)
+            break;
 
-    QTimer::singleShot (10, Qt::PreciseTimer, this, SLOT (update()));
+        if (handler)
+            handler->povEvent (pov);
+
+        emit POVEvent (pov);
+        break;
+    }
+    }
+#else
+    Q_UNUSED (event);
 #endif
 }
 
@@ -158,10 +948,15 @@ void SDL_Joysticks::update()
  * Checks if the joystick referenced by the \a event can be initialized.
  * If not, the function will apply a generic mapping to the joystick and
  * attempt to initialize the joystick again.
+ *
+ * The joystick is opened and registered only once, its handle is kept open
+ * until the joystick is removed.
  */
 void SDL_Joysticks::configureJoystick (const SDL_Event* event)
 {
 #ifdef SDL_SUPPORTED
+    loadMapping (SDL_JoystickGetDeviceGUID (event->jdevice.which));
+
     if (!SDL_IsGameController (event->cdevice.which)) {
         SDL_Joystick* js = SDL_JoystickOpen (event->jdevice.which);
 
@@ -179,9 +974,65 @@ void SDL_Joysticks::configureJoystick (const SDL_Event* event)
         }
     }
 
-    SDL_GameControllerOpen (event->cdevice.which);
+    SDL_GameController* controller = SDL_GameControllerOpen (event->cdevice.which);
+    if (!controller) {
+        qWarning() << Q_FUNC_INFO << "Cannot open joystick:" << SDL_GetError();
+        return;
+    }
+
+    /* SDL may report the same joystick twice, keep the existing handle */
+    SDL_Joystick* sdl_joystick = SDL_GameControllerGetJoystick (controller);
+    int instance = SDL_JoystickInstanceID (sdl_joystick);
+    if (m_controllers.contains (instance)) {
+        SDL_GameControllerClose (controller);
+        return;
+    }
+
+    /* Open the haptic device once, rumble requests reuse the handle */
+    if (SDL_JoystickIsHaptic (sdl_joystick) == 1) {
+        SDL_Haptic* haptic = SDL_HapticOpenFromJoystick (sdl_joystick);
+        if (haptic) {
+            if (SDL_HapticRumbleSupported (haptic) == SDL_TRUE)
+                SDL_HapticRumbleInit (haptic);
+
+            m_haptics.insert (instance, haptic);
+        }
+    }
+
+    /* Get joystick properties */
+    QJoystickDevice* joystick = new QJoystickDevice;
+    joystick->id = -1;
+    joystick->blacklisted = false;
+    joystick->name = SDL_JoystickName (sdl_joystick);
+
+    /* Find the calibration profile in the mapped profile file */
+    SDL_JoystickGUID guid = SDL_JoystickGetGUID (sdl_joystick);
+    joystick->guid = QByteArray ((const char*) guid.data, sizeof (guid.data));
+
+    QJoystickProfile profile;
+    bool calibrated = m_profiles.find (joystick->guid, &profile);
+
+    /* Initialize POVs */
+    for (int i = 0; i < SDL_JoystickNumHats (sdl_joystick); ++i)
+        joystick->povs.append (0);
+
+    /* Initialize axes */
+    for (int i = 0; i < SDL_JoystickNumAxes (sdl_joystick); ++i)
+        joystick->axes.append (0);
+
+    /* Initialize buttons */
+    for (int i = 0; i < SDL_JoystickNumButtons (sdl_joystick); ++i)
+        joystick->buttons.append (false);
+
+    /* Register the joystick */
+    m_mutex.lock();
+    m_devices.insert (instance, joystick);
+    m_controllers.insert (instance, controller);
+    m_joysticks.append (joystick);
+    if (calibrated)
+        m_calibrations.insert (instance, profile);
+    m_mutex.unlock();
 
-    ++m_tracker;
     emit countChanged();
 #else
     Q_UNUSED (event);
@@ -189,69 +1040,48 @@ void SDL_Joysticks::configureJoystick (const SDL_Event* event)
 }
 
 /**
- * Returns a joystick ID compatible with the \c QJoysticks system.
- * SDL assigns an ID to each joystick based on the order that they are attached,
- * but it does not decrease the ID counter when a joystick is removed.
- *
- * As noted earlier, the \c QJoysticks maintains an ID system similar to the
- * one used by a \c QList, since it eases the operation with most Qt classes
- * and widgets.
+ * Closes the joystick referenced by the \a event and removes it from the
+ * registered joysticks
  */
-int SDL_Joysticks::getDynamicID (int id)
+void SDL_Joysticks::removeJoystick (const SDL_Event* event)
 {
 #ifdef SDL_SUPPORTED
-    id = abs (m_tracker - (id + 1));
+    int instance = event->jdevice.which;
+    if (!m_controllers.contains (instance))
+        return;
 
-    if (id >= SDL_NumJoysticks())
-        id -= 1;
+    if (m_haptics.contains (instance))
+        SDL_HapticClose (m_haptics.take (instance));
 
-#endif
+    m_hapticEffects.remove (instance);
+
+    /* The controllers are read by pollState() while the mutex is held */
+    m_mutex.lock();
+    SDL_GameControllerClose (m_controllers.take (instance));
+    m_polledStates.remove (instance);
+    m_calibrations.remove (instance);
+    m_coalesced.remove (instance);
+    QJoystickDevice* joystick = m_devices.take (instance);
+    m_joysticks.removeAll (joystick);
+    m_removed.append (joystick);
+    m_mutex.unlock();
 
-    return id;
+    emit countChanged();
+#else
+    Q_UNUSED (event);
+#endif
 }
 
 /**
- * Returns the josytick device registered with the given \a id.
- * If no joystick with the given \a id is found, then the function will warn
- * the user through the console.
+ * Returns the registered joystick device with the given SDL instance \a id,
+ * or \c NULL if the joystick is not registered.
+ *
+ * SDL reports the instance ID (and not the device index) of the joystick in
+ * every input event, so this is a single hash lookup per event.
  */
 QJoystickDevice* SDL_Joysticks::getJoystick (int id)
 {
-#ifdef SDL_SUPPORTED
-    QJoystickDevice* joystick = new QJoystickDevice;
-    SDL_Joystick* sdl_joystick = SDL_JoystickOpen (id);
-    joystick->id = getDynamicID (id);
-
-    if (sdl_joystick) {
-        joystick->blacklisted = false;
-        joystick->name = SDL_JoystickName (sdl_joystick);
-
-        /* Get joystick properties */
-        int povs = SDL_JoystickNumHats (sdl_joystick);
-        int axes = SDL_JoystickNumAxes (sdl_joystick);
-        int buttons = SDL_JoystickNumButtons (sdl_joystick);
-
-        /* Initialize POVs */
-        for (int i = 0; i < povs; ++i)
-            joystick->povs.append (0);
-
-        /* Initialize axes */
-        for (int i = 0; i < axes; ++i)
-            joystick->axes.append (0);
-
-        /* Initialize buttons */
-        for (int i = 0; i < buttons; ++i)
-            joystick->buttons.append (false);
-    }
-
-    else
-        qWarning() << Q_FUNC_INFO << "Cannot find joystick with id:" << id;
-
-    return joystick;
-#else
-    Q_UNUSED (id);
-    return NULL;
-#endif
+    return m_devices.value (id, Q_NULLPTR);
 }
 
 /**
@@ -264,37 +1094,10 @@ QJoystickPOVEvent SDL_Joysticks::getPOVEvent (const SDL_Event* sdl_event)
 
 #ifdef SDL_SUPPORTED
     event.pov = sdl_event->jhat.hat;
-    event.joystick = getJoystick (sdl_event->jdevice.which);
+    event.joystick = getJoystick (sdl_event->jhat.which);
 
-    switch (sdl_event->jhat.value) {
-    case SDL_HAT_RIGHTUP:
-        event.angle = 45;
-        break;
-    case SDL_HAT_RIGHTDOWN:
-        event.angle = 135;
-        break;
-    case SDL_HAT_LEFTDOWN:
-        event.angle = 225;
-        break;
-    case SDL_HAT_LEFTUP:
-        event.angle = 315;
-        break;
-    case SDL_HAT_UP:
-        event.angle = 0;
-        break;
-    case SDL_HAT_RIGHT:
-        event.angle = 90;
-        break;
-    case SDL_HAT_DOWN:
-        event.angle = 180;
-        break;
-    case SDL_HAT_LEFT:
-        event.angle = 270;
-        break;
-    default:
-        event.angle = -1;
-        break;
-    }
+    event.angle = getHatAngle (sdl_event->jhat.value);
+    event.timestamp = getEventTimestamp (sdl_event);
 #else
     Q_UNUSED (sdl_event);
 #endif
@@ -312,8 +1115,10 @@ QJoystickAxisEvent SDL_Joysticks::getAxisEvent (const SDL_Event* sdl_event)
 
 #ifdef SDL_SUPPORTED
     event.axis = sdl_event->caxis.axis;
-    event.value = static_cast<qreal> (sdl_event->caxis.value) / 32767;
-    event.joystick = getJoystick (sdl_event->cdevice.which);
+    event.value = calibrate (sdl_event->caxis.which, event.axis,
+                             static_cast<qreal> (sdl_event->caxis.value) / 32767);
+    event.timestamp = getEventTimestamp (sdl_event);
+    event.joystick = getJoystick (sdl_event->caxis.which);
 #else
     Q_UNUSED (sdl_event);
 #endif
@@ -333,7 +1138,8 @@ QJoystickButtonEvent SDL_Joysticks::getButtonEvent (const SDL_Event*
 #ifdef SDL_SUPPORTED
     event.button = sdl_event->jbutton.button;
     event.pressed = sdl_event->jbutton.state == SDL_PRESSED;
-    event.joystick = getJoystick (sdl_event->jdevice.which);
+    event.timestamp = getEventTimestamp (sdl_event);
+    event.joystick = getJoystick (sdl_event->jbutton.which);
 #else
     Q_UNUSED (sdl_event);
 #endif
@@ -24,9 +24,18 @@
 #define _QJOYSTICKS_SDL_JOYSTICK_H
 
 #include <SDL.h>
+#include <QHash>
+#include <QMutex>
 #include <QObject>
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QJoysticks/JoystickProfiles.h>
 #include <QJoysticks/JoysticksCommon.h>
 
+class QTimer;
+class SDL_InitThread;
+class SDL_InputThread;
+
 /**
  * \brief Translates SDL events into \c QJoysticks events
  *
@@ -36,8 +45,34 @@
  * The only thing that differs from each operating system is the backup mapping
  * applied in the case that we do not know what mapping to apply to a joystick.
  *
- * \note The joystick values are refreshed every 20 milliseconds through a
- *       simple event loop.
+ * Each attached joystick is opened only once (when SDL reports it) and is
+ * registered with its SDL instance ID, the same \c QJoystickDevice is used
+ * until the joystick is removed. The \c id of each device is the slot that
+ * the \c QJoysticks system assigns to it (or \c -1 until it is registered).
+ *
+ * The haptic device of each joystick is also opened once. Rumble requests
+ * and haptic effects are queued and played by the thread that reads the
+ * joystick events.
+ *
+ * SDL is initialized (and the controller mappings are loaded) by a background
+ * thread, so that the user interface is not delayed by it. The joysticks are
+ * announced (with \c countChanged()) once SDL is ready.
+ *
+ * When state polling is enabled, the input events are not reported. Instead,
+ * \c pollState() reads the state of every controller in one pass (e.g. right
+ * before a robot packet is built) and reports the values that changed.
+ *
+ * The calibration profile of each joystick (see \c JoystickProfiles) is
+ * looked up by its GUID in the memory-mapped profile file when the joystick
+ * is attached, and is applied to the axis values by the thread that reads
+ * them. Calibration changes are queued to that thread (like the haptic
+ * effects) and written to the profile file shortly after the last change.
+ *
+ * \note By default, the joystick values are refreshed every 10 milliseconds
+ *       by a timer in the GUI thread. When the input thread is enabled, the
+ *       events are read by a high-priority thread at the polling rate and
+ *       queued to the GUI thread (an input handler, if set, is called
+ *       directly from the input thread).
  */
 class SDL_Joysticks : public QObject
 {
@@ -55,23 +90,71 @@ public:
 
     QList<QJoystickDevice*> joysticks();
 
+    int pollingRate() const;
+    bool inputThreadEnabled() const;
+    bool statePollingEnabled() const;
+    int coalescedEvents (const QJoystickDevice* joystick);
+    void setInputHandler (QJoystickInputHandler* handler);
+    void pollState();
+
+    QJoystickAxisCalibration axisCalibration (const QJoystickDevice* joystick,
+                                              const int axis);
+    bool setAxisCalibration (const QJoystickDevice* joystick, const int axis,
+                             const QJoystickAxisCalibration& calibration);
+
 public slots:
+    void setPollingRate (const int rate);
+    void setInputThreadEnabled (const bool enabled);
+    void setStatePollingEnabled (const bool enabled);
     void rumble (const QJoystickRumble& request);
+    void playEffect (const QJoystickHapticEffect& effect);
 
 private slots:
     void update();
+    void saveProfiles();
+    void onInitialized();
     void configureJoystick (const SDL_Event* event);
 
 private:
-    int getDynamicID (int id);
+    friend class SDL_InputThread;
+    friend class Bench_QJoysticks;
+
+    void playPendingEffects();
+    void applyPendingProfiles();
+    void applyPollingMode();
+    qreal calibrate (const int instance, const int axis, const qreal value);
+    void processEvent (const SDL_Event* event);
+    void removeJoystick (const SDL_Event* event);
 
     QJoystickDevice* getJoystick (int id);
     QJoystickPOVEvent getPOVEvent (const SDL_Event* sdl_event);
     QJoystickAxisEvent getAxisEvent (const SDL_Event* sdl_event);
     QJoystickButtonEvent getButtonEvent (const SDL_Event* sdl_event);
 
-    int m_tracker;
-    QList<QJoystickDevice> m_joysticks;
+    QMutex m_mutex;
+    QMutex m_effectMutex;
+    QMutex m_profileMutex;
+    QTimer* m_timer;
+    QTimer* m_saveTimer;
+    bool m_initialized;
+    bool m_useInputThread;
+    QAtomicInt m_pollingRate;
+    QAtomicInt m_statePolling;
+    SDL_InitThread* m_initThread;
+    SDL_InputThread* m_inputThread;
+    QList<QJoystickDevice*> m_removed;
+    QList<QJoystickDevice*> m_joysticks;
+    QHash<int, QJoystickDevice*> m_devices;
+    QHash<int, int> m_hapticEffects;
+    QHash<int, SDL_Haptic*> m_haptics;
+    QHash<int, SDL_GameController*> m_controllers;
+    QHash<int, int> m_coalesced;
+    QHash<int, QJoystickDevice> m_polledStates;
+    QList<QJoystickHapticEffect> m_pendingEffects;
+    JoystickProfiles m_profiles;
+    QHash<int, QJoystickProfile> m_calibrations;
+    QHash<QByteArray, QJoystickProfile> m_pendingProfiles;
+    QAtomicPointer<QJoystickInputHandler> m_inputHandler;
 };
 
 #endif
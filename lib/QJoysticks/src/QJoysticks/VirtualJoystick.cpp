@@ -21,11 +21,175 @@
  */
 
 #include <math.h>
+#include <QThread>
+#include <QSettings>
+#include <QStringList>
+#include <QElapsedTimer>
 #include <QJoysticks/VirtualJoystick.h>
+#include <QJoysticks/DeferredSettings.h>
+
+/*
+ * Interval (in msecs) at which ramping axes are moved to their target value
+ */
+#define RAMP_INTERVAL 10
+
+/*
+ * Settings keys of the bindings and the axis ramp times
+ */
+#define BINDINGS_GROUP "Virtual Joystick Bindings"
+#define RAMP_TIMES_KEY "Virtual Joystick Ramp Times"
+
+/**
+ * Moves the ramping axes of the virtual joystick towards their targets at a
+ * fixed rate, each step uses the monotonic time elapsed since the previous
+ * step. The thread sleeps while no axis has to move.
+ */
+class VirtualJoystickRamp : public QThread
+{
+public:
+    VirtualJoystickRamp (VirtualJoystick* joystick) : m_joystick (joystick) {}
+
+    void stop()
+    {
+        requestInterruption();
+
+        m_joystick->m_mutex.lock();
+        m_joystick->m_rampCondition.wakeAll();
+        m_joystick->m_mutex.unlock();
+
+        wait();
+    }
+
+protected:
+    void run()
+    {
+        QElapsedTimer clock;
+
+        while (!isInterruptionRequested()) {
+            /* Wait until an axis has to move */
+            m_joystick->m_mutex.lock();
+            while (!m_joystick->m_ramping && !isInterruptionRequested())
+                m_joystick->m_rampCondition.wait (&m_joystick->m_mutex);
+            m_joystick->m_mutex.unlock();
+
+            /* Integrate the axes until all of them reach their targets */
+            qint64 last = 0;
+            bool moving = true;
+            clock.start();
+            while (moving && !isInterruptionRequested()) {
+                const qint64 deadline = last + RAMP_INTERVAL * 1000000LL;
+                const qint64 now = clock.nsecsElapsed();
+                if (deadline > now)
+                    usleep ((deadline - now) / 1000);
+
+                const qint64 time = clock.nsecsElapsed();
+                moving = m_joystick->integrateAxes ((time - last) / 1000000.0);
+                last = time;
+            }
+        }
+    }
+
+private:
+    VirtualJoystick* m_joystick;
+};
+
+/**
+ * Key bindings that are used when the user has not configured the bindings
+ */
+static const struct {
+    int key;
+    VirtualJoystickBinding binding;
+} DEFAULT_BINDINGS[] = {
+    /* Thumb 1 */
+    { Qt::Key_D,     { VirtualJoystickBinding::Axis,   0,  1 } },
+    { Qt::Key_A,     { VirtualJoystickBinding::Axis,   0, -1 } },
+    { Qt::Key_S,     { VirtualJoystickBinding::Axis,   1,  1 } },
+    { Qt::Key_W,     { VirtualJoystickBinding::Axis,   1, -1 } },
+
+    /* Triggers */
+    { Qt::Key_E,     { VirtualJoystickBinding::Axis,   2,  1 } },
+    { Qt::Key_Q,     { VirtualJoystickBinding::Axis,   2, -1 } },
+    { Qt::Key_O,     { VirtualJoystickBinding::Axis,   3,  1 } },
+    { Qt::Key_U,     { VirtualJoystickBinding::Axis,   3, -1 } },
+
+    /* Thumb 2 */
+    { Qt::Key_L,     { VirtualJoystickBinding::Axis,   4,  1 } },
+    { Qt::Key_J,     { VirtualJoystickBinding::Axis,   4, -1 } },
+    { Qt::Key_I,     { VirtualJoystickBinding::Axis,   5,  1 } },
+    { Qt::Key_K,     { VirtualJoystickBinding::Axis,   5, -1 } },
+
+    /* POV */
+    { Qt::Key_Up,    { VirtualJoystickBinding::POV,    0, 360 } },
+    { Qt::Key_Right, { VirtualJoystickBinding::POV,    0,  90 } },
+    { Qt::Key_Down,  { VirtualJoystickBinding::POV,    0, 180 } },
+    { Qt::Key_Left,  { VirtualJoystickBinding::POV,    0, 270 } },
+
+    /* Buttons */
+    { Qt::Key_0,     { VirtualJoystickBinding::Button, 0,  0 } },
+    { Qt::Key_1,     { VirtualJoystickBinding::Button, 1,  0 } },
+    { Qt::Key_2,     { VirtualJoystickBinding::Button, 2,  0 } },
+    { Qt::Key_3,     { VirtualJoystickBinding::Button, 3,  0 } },
+    { Qt::Key_4,     { VirtualJoystickBinding::Button, 4,  0 } },
+    { Qt::Key_5,     { VirtualJoystickBinding::Button, 5,  0 } },
+    { Qt::Key_6,     { VirtualJoystickBinding::Button, 6,  0 } },
+    { Qt::Key_7,     { VirtualJoystickBinding::Button, 7,  0 } },
+    { Qt::Key_8,     { VirtualJoystickBinding::Button, 8,  0 } },
+    { Qt::Key_9,     { VirtualJoystickBinding::Button, 9,  0 } },
+};
+
+/**
+ * Returns the settings representation of the given \a binding
+ */
+static QString bindingToString (const VirtualJoystickBinding& binding)
+{
+    switch (binding.type) {
+    case VirtualJoystickBinding::Axis:
+        return QString ("axis:%1:%2").arg (binding.index)
+               .arg (binding.direction < 0 ? "-" : "+");
+    case VirtualJoystickBinding::Button:
+        return QString ("button:%1").arg (binding.index);
+    case VirtualJoystickBinding::POV:
+        return QString ("pov:%1").arg (binding.direction);
+    }
+
+    return QString();
+}
+
+/**
+ * Reads the \a binding from its settings representation
+ *
+ * \returns \c false if the \a string is not a valid binding
+ */
+static bool bindingFromString (const QString& string, VirtualJoystickBinding* binding)
+{
+    bool ok = false;
+    const QStringList fields = string.split (':');
+
+    if (fields.count() == 3 && fields.at (0) == "axis") {
+        binding->type = VirtualJoystickBinding::Axis;
+        binding->index = fields.at (1).toInt (&ok);
+        binding->direction = fields.at (2) == "-" ? -1 : 1;
+    }
+
+    else if (fields.count() == 2 && fields.at (0) == "button") {
+        binding->type = VirtualJoystickBinding::Button;
+        binding->index = fields.at (1).toInt (&ok);
+        binding->direction = 0;
+    }
+
+    else if (fields.count() == 2 && fields.at (0) == "pov") {
+        binding->type = VirtualJoystickBinding::POV;
+        binding->index = 0;
+        binding->direction = fields.at (1).toInt (&ok);
+    }
+
+    return ok && binding->index >= 0;
+}
 
 VirtualJoystick::VirtualJoystick (QObject* parent) : QObject (parent)
 {
     m_axisRange = 1;
+    m_ramping = false;
     m_joystickEnabled = false;
     m_joystick.blacklisted = false;
     m_joystick.name = tr ("Virtual Joystick");
@@ -34,14 +198,29 @@ VirtualJoystick::VirtualJoystick (QObject* parent) : QObject (parent)
     m_joystick.povs.append (0);
 
     /* Initialize axes */
-    for (int i = 0; i < 6; ++i)
+    for (int i = 0; i < 6; ++i) {
         m_joystick.axes.append (0);
+        m_axisValues.append (0);
+        m_axisTargets.append (0);
+        m_axisRampTimes.append (0);
+    }
 
     /* Initialize buttons */
     for (int i = 0; i < 10; ++i)
         m_joystick.buttons.append (false);
 
+    loadBindings();
     qApp->installEventFilter (this);
+
+    /* Start the thread that moves the ramping axes */
+    m_rampThread = new VirtualJoystickRamp (this);
+    m_rampThread->start (QThread::HighPriority);
+}
+
+VirtualJoystick::~VirtualJoystick()
+{
+    m_rampThread->stop();
+    delete m_rampThread;
 }
 
 /**
@@ -58,6 +237,15 @@ qreal VirtualJoystick::axisRange() const
     return m_axisRange;
 }
 
+/**
+ * Returns the time (in msecs) that the given \a axis takes to move from the
+ * center to one of its ends, \c 0 if the axis jumps to its value immediately
+ */
+int VirtualJoystick::axisRampTime (int axis) const
+{
+    return m_axisRampTimes.value (axis, 0);
+}
+
 /**
  * Returns \c true if the virtual joystick is enabled.
  */
@@ -75,6 +263,29 @@ QJoystickDevice* VirtualJoystick::joystick()
     return &m_joystick;
 }
 
+/**
+ * Returns the key bindings of the virtual joystick (indexed by Qt key code)
+ */
+QHash<int, VirtualJoystickBinding> VirtualJoystick::bindings() const
+{
+    return m_bindings;
+}
+
+/**
+ * Replaces the user bindings with the default key bindings
+ */
+void VirtualJoystick::resetBindings()
+{
+    releaseAll();
+    m_bindings.clear();
+
+    const int count = sizeof (DEFAULT_BINDINGS) / sizeof (DEFAULT_BINDINGS [0]);
+    for (int i = 0; i < count; ++i)
+        m_bindings.insert (DEFAULT_BINDINGS [i].key, DEFAULT_BINDINGS [i].binding);
+
+    DeferredSettings::getInstance()->remove (BINDINGS_GROUP);
+}
+
 /**
  * Sets the ID of the virtual joystick device. The \c QJoysticks will
  * automatically change the \a ID of the virtual joystick when it scans for
@@ -101,166 +312,130 @@ void VirtualJoystick::setAxisRange (qreal range)
     if (range > 1)
         range = 1;
 
+    QMutexLocker locker (&m_mutex);
     m_axisRange = range;
 }
 
 /**
- * Enables or disables the virtual joystick device.
+ * Changes the ramp time (in msecs) of all the axes, see \c setAxisRampTime()
  */
-void VirtualJoystick::setJoystickEnabled (bool enabled)
+void VirtualJoystick::setAxisRampTime (int msecs)
 {
-    m_joystickEnabled = enabled;
-    emit enabledChanged();
+    m_mutex.lock();
+    for (int axis = 0; axis < m_axisRampTimes.count(); ++axis)
+        m_axisRampTimes [axis] = qMax (0, msecs);
+    m_mutex.unlock();
+
+    saveRampTimes();
 }
 
 /**
- * Polls the keyboard events and if required, reports a change in the axis
- * values of the virtual joystick device.
+ * Changes the time (in msecs) that the given \a axis takes to move from the
+ * center to one of its ends. Set it to \c 0 to move the axis to its value
+ * immediately.
+ *
+ * The ramp times are saved to the settings of the application.
  */
-void VirtualJoystick::readAxes (int key, bool pressed)
+void VirtualJoystick::setAxisRampTime (int axis, int msecs)
 {
-    int axis = -1;
-    qreal value = axisRange() * (pressed ? 1 : 0);
-
-    /* Horizontal axis on thumb 1 */
-    if (key == Qt::Key_D)
-        axis = 0;
-    else if (key == Qt::Key_A) {
-        axis = 0;
-        value *= -1;
-    }
+    if (axis < 0 || axis >= m_axisRampTimes.count())
+        return;
 
-    /* Vertical axis on thumb 1 */
-    if (key == Qt::Key_S)
-        axis = 1;
-    else if (key == Qt::Key_W) {
-        axis = 1;
-        value *= -1;
-    }
-
-    /* Trigger 1 */
-    if (key == Qt::Key_E)
-        axis = 2;
-    else if (key == Qt::Key_Q) {
-        axis = 2;
-        value *= -1;
-    }
-
-    /* Trigger 2 */
-    if (key == Qt::Key_O)
-        axis = 3;
-    else if (key == Qt::Key_U) {
-        axis = 3;
-        value *= -1;
-    }
+    m_mutex.lock();
+    m_axisRampTimes [axis] = qMax (0, msecs);
+    m_mutex.unlock();
 
-    /* Horizontal axis on thumb 2 */
-    if (key == Qt::Key_L)
-        axis = 4;
-    else if (key == Qt::Key_J) {
-        axis = 4;
-        value *= -1;
-    }
-
-    /* Vertical axis on thumb 2 */
-    if (key == Qt::Key_I)
-        axis = 5;
-    else if (key == Qt::Key_K) {
-        axis = 5;
-        value *= -1;
-    }
+    saveRampTimes();
+}
 
-    if (axis != -1 && joystickEnabled()) {
-        QJoystickAxisEvent event;
-        event.axis     = axis;
-        event.value    = value;
-        event.joystick = joystick();
+/**
+ * Enables or disables the virtual joystick device.
+ */
+void VirtualJoystick::setJoystickEnabled (bool enabled)
+{
+    if (!enabled)
+        releaseAll();
 
-        emit axisEvent (event);
-    }
+    m_joystickEnabled = enabled;
+    emit enabledChanged();
 }
 
 /**
- * Polls the keyboard events and if required, reports a change in the POV/hat
- * values of the virtual joystick device.
+ * Binds the given Qt \a key to the given joystick input, the bindings are
+ * saved to the settings of the application
  */
-void VirtualJoystick::readPOVs (int key, bool pressed)
+void VirtualJoystick::setBinding (int key, const VirtualJoystickBinding& binding)
 {
-    int angle = 0;
-
-    if (key == Qt::Key_Up)
-        angle = 360;
-    else if (key == Qt::Key_Right)
-        angle = 90;
-    else if (key == Qt::Key_Left)
-        angle = 270;
-    else if (key == Qt::Key_Down)
-        angle = 180;
-
-    if (!pressed)
-        angle = 0;
-
-    if (joystickEnabled()) {
-        QJoystickPOVEvent event;
-        event.pov      = 0;
-        event.angle    = angle;
-        event.joystick = joystick();
-
-        emit povEvent (event);
-    }
+    releaseAll();
+    m_bindings.insert (key, binding);
+    saveBindings();
 }
 
 /**
- * Polls the keyboard events and if required, reports a change in the button
- * values of the virtual joystick device.
+ * Removes the binding of the given Qt \a key
  */
-void VirtualJoystick::readButtons (int key, bool pressed)
+void VirtualJoystick::removeBinding (int key)
 {
-    int button = -1;
-
-    if (key == Qt::Key_0)
-        button = 0;
-    else if (key == Qt::Key_1)
-        button = 1;
-    else if (key == Qt::Key_2)
-        button = 2;
-    else if (key == Qt::Key_3)
-        button = 3;
-    else if (key == Qt::Key_4)
-        button = 4;
-    else if (key == Qt::Key_5)
-        button = 5;
-    else if (key == Qt::Key_6)
-        button = 6;
-    else if (key == Qt::Key_7)
-        button = 7;
-    else if (key == Qt::Key_8)
-        button = 8;
-    else if (key == Qt::Key_9)
-        button = 9;
-
-    if (button != -1 && joystickEnabled()) {
-        QJoystickButtonEvent event;
-        event.button   = button;
-        event.pressed  = pressed;
-        event.joystick = joystick();
-
-        emit buttonEvent (event);
-    }
+    releaseAll();
+    m_bindings.remove (key);
+    saveBindings();
 }
 
 /**
  * Called when the event filter detects a keyboard event.
  *
- * This function prompts the joystick to update its axis, button and POV values
- * based on the keys that have been pressed or released.
+ * The key is looked up in the bindings table and the bound axis, button or
+ * POV is updated. Auto-repeated key presses are ignored.
  */
 void VirtualJoystick::processKeyEvent (QKeyEvent* event, bool pressed)
 {
-    if (joystickEnabled()) {
-        readPOVs (event->key(), pressed);
-        readAxes (event->key(), pressed);
-        readButtons (event->key(), pressed);
+    if (!joystickEnabled() || event->isAutoRepeat())
+        return;
+
+    const int key = event->key();
+    QHash<int, VirtualJoystickBinding>::const_iterator it = m_bindings.constFind (key);
+    if (it == m_bindings.constEnd())
+        return;
+
+    /* Update the list of pressed keys (and ignore duplicated events) */
+    if (pressed) {
+        if (m_pressedKeys.contains (key))
+            return;
+
+        m_pressedKeys.append (key);
+    }
+
+    else if (m_pressedKeys.removeAll (key) == 0)
+        return;
+
+    /* Update the input bound to the key */
+    const VirtualJoystickBinding& binding = it.value();
+    switch (binding.type) {
+    case VirtualJoystickBinding::Axis:
+        setAxisTarget (binding.index);
+        break;
+    case VirtualJoystickBinding::Button:
+        if (binding.index < m_joystick.buttons.count()) {
+            QJoystickButtonEvent button;
+            button.button    = binding.index;
+            button.pressed   = pressed;
+            button.timestamp = QJoystickTimestamp();
+            button.joystick  = joystick();
+
+            emit buttonEvent (button);
+        }
+        break;
+    case VirtualJoystickBinding::POV: {
+        int angle = 0;
+        foreach (int pressedKey, m_pressedKeys) {
+            const VirtualJoystickBinding b = m_bindings.value (pressedKey);
+            if (b.type == VirtualJoystickBinding::POV)
+                angle = b.direction;
+        }
+
+        emitPOV (angle);
+        break;
+    }
     }
 }
 
@@ -289,3 +464,166 @@ bool VirtualJoystick::eventFilter (QObject* object, QEvent* event)
 
     return false;
 }
+
+/**
+ * Loads the key bindings and the axis ramp times from the settings of the
+ * application (the default bindings are used if none are saved)
+ */
+void VirtualJoystick::loadBindings()
+{
+    QSettings settings (qApp->organizationName(), qApp->applicationName());
+    const QVariantList rampTimes = settings.value (RAMP_TIMES_KEY).toList();
+    for (int i = 0; i < rampTimes.count() && i < m_axisRampTimes.count(); ++i)
+        m_axisRampTimes [i] = qMax (0, rampTimes.at (i).toInt());
+
+    settings.beginGroup (BINDINGS_GROUP);
+    const QStringList keys = settings.childKeys();
+    foreach (const QString& key, keys) {
+        bool ok = false;
+        VirtualJoystickBinding binding;
+        const int code = key.toInt (&ok);
+
+        if (ok && bindingFromString (settings.value (key).toString(), &binding))
+            m_bindings.insert (code, binding);
+    }
+    settings.endGroup();
+
+    if (m_bindings.isEmpty())
+        resetBindings();
+}
+
+/**
+ * Writes the key bindings to the settings of the application
+ */
+void VirtualJoystick::saveBindings()
+{
+    DeferredSettings* settings = DeferredSettings::getInstance();
+    settings->remove (BINDINGS_GROUP);
+
+    QHash<int, VirtualJoystickBinding>::const_iterator it;
+    for (it = m_bindings.constBegin(); it != m_bindings.constEnd(); ++it)
+        settings->setValue (QString ("%1/%2").arg (BINDINGS_GROUP).arg (it.key()),
+                            bindingToString (it.value()));
+}
+
+/**
+ * Writes the axis ramp times to the settings of the application
+ */
+void VirtualJoystick::saveRampTimes()
+{
+    QVariantList rampTimes;
+    foreach (int msecs, m_axisRampTimes)
+        rampTimes.append (msecs);
+
+    DeferredSettings::getInstance()->setValue (RAMP_TIMES_KEY, rampTimes);
+}
+
+/**
+ * Moves the ramping axes towards their targets by the distance covered in
+ * the given time (in \a msecs), this is called by the ramp thread
+ *
+ * \returns \c true if an axis has not reached its target yet
+ */
+bool VirtualJoystick::integrateAxes (qreal msecs)
+{
+    QMutexLocker locker (&m_mutex);
+
+    bool moving = false;
+    for (int axis = 0; axis < m_axisValues.count(); ++axis) {
+        const qreal value = m_axisValues.at (axis);
+        const qreal target = m_axisTargets.at (axis);
+        const int rampTime = m_axisRampTimes.at (axis);
+        if (value == target)
+            continue;
+
+        qreal next = target;
+        if (rampTime > 0) {
+            const qreal step = m_axisRange * msecs / rampTime;
+            if (value < target)
+                next = qMin (value + step, target);
+            else
+                next = qMax (value - step, target);
+        }
+
+        emitAxis (axis, next);
+        moving |= (next != target);
+    }
+
+    m_ramping = moving;
+    return moving;
+}
+
+/**
+ * Releases all the pressed keys and centers the axes (immediately)
+ */
+void VirtualJoystick::releaseAll()
+{
+    QMutexLocker locker (&m_mutex);
+    m_pressedKeys.clear();
+
+    for (int axis = 0; axis < m_axisValues.count(); ++axis) {
+        m_axisTargets [axis] = 0;
+        if (m_axisValues.at (axis) != 0)
+            emitAxis (axis, 0);
+    }
+}
+
+/**
+ * Calculates the target value of the given \a axis from its pressed keys
+ * (opposite keys cancel each other) and moves the axis to it
+ */
+void VirtualJoystick::setAxisTarget (int axis)
+{
+    if (axis >= m_axisValues.count())
+        return;
+
+    int direction = 0;
+    foreach (int key, m_pressedKeys) {
+        const VirtualJoystickBinding b = m_bindings.value (key);
+        if (b.type == VirtualJoystickBinding::Axis && b.index == axis)
+            direction += b.direction;
+    }
+
+    QMutexLocker locker (&m_mutex);
+    m_axisTargets [axis] = m_axisRange * qBound (-1, direction, 1);
+
+    if (m_axisRampTimes.at (axis) > 0) {
+        m_ramping = true;
+        m_rampCondition.wakeAll();
+    }
+
+    else
+        emitAxis (axis, m_axisTargets.at (axis));
+}
+
+/**
+ * Stores the reported value of the given \a axis and emits an axis event
+ *
+ * \note The caller must hold \c m_mutex
+ */
+void VirtualJoystick::emitAxis (int axis, qreal value)
+{
+    m_axisValues [axis] = value;
+
+    QJoystickAxisEvent event;
+    event.axis      = axis;
+    event.value     = value;
+    event.timestamp = QJoystickTimestamp();
+    event.joystick  = joystick();
+
+    emit axisEvent (event);
+}
+
+/**
+ * Emits a POV event with the given \a angle
+ */
+void VirtualJoystick::emitPOV (int angle)
+{
+    QJoystickPOVEvent event;
+    event.pov       = 0;
+    event.angle     = angle;
+    event.timestamp = QJoystickTimestamp();
+    event.joystick  = joystick();
+
+    emit povEvent (event);
+}
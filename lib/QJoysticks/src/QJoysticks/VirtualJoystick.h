@@ -23,16 +23,51 @@
 #ifndef _QJOYSTICKS_JOYSTICK_H
 #define _QJOYSTICKS_JOYSTICK_H
 
+#include <QHash>
+#include <QMutex>
 #include <QWidget>
+#include <QWaitCondition>
 #include <QKeyEvent>
 #include <QApplication>
 #include <QJoysticks/JoysticksCommon.h>
 
+class VirtualJoystickRamp;
+
+/**
+ * @brief Represents the joystick input produced by a keyboard key
+ *
+ * A key moves an axis towards its positive or negative end (\c direction is
+ * \c 1 or \c -1), presses a button or moves a POV to the given angle
+ * (\c direction holds the angle).
+ */
+struct VirtualJoystickBinding {
+    enum Type {
+        Axis,
+        Button,
+        POV,
+    };
+
+    Type type;     /**< The kind of input generated by the key */
+    int index;     /**< The axis, button or POV number */
+    int direction; /**< Axis direction or POV angle */
+};
+
 /**
  * \brief Translates keyboard input to joystick input
  *
  * This class implements a virtual joystick device that uses the computer's
  * keyboard as means to get the axis, button and POV values of the joystick.
+ *
+ * Keys are translated with a lookup table, which is loaded from the
+ * "Virtual Joystick Bindings" settings group (the keys are Qt key codes and
+ * the values are \c axis:N:+, \c axis:N:-, \c button:N or \c pov:ANGLE). The
+ * default bindings are used when no bindings are saved.
+ *
+ * If a ramp time is set for an axis, the axis moves gradually to its target
+ * value instead of jumping to it, which makes keyboard driving smoother. The
+ * ramping axes are integrated by a dedicated thread at a fixed rate, using
+ * the monotonic time elapsed between two steps (their axis events are
+ * emitted from that thread).
  */
 class VirtualJoystick : public QObject
 {
@@ -46,29 +81,61 @@ signals:
 
 public:
     VirtualJoystick (QObject* parent = Q_NULLPTR);
+    ~VirtualJoystick();
 
     qreal axisRange() const;
+    int axisRampTime (int axis) const;
     bool joystickEnabled() const;
     QJoystickDevice* joystick();
+    QHash<int, VirtualJoystickBinding> bindings() const;
 
 public slots:
+    void resetBindings();
     void setJoystickID (int id);
     void setAxisRange (qreal range);
+    void setAxisRampTime (int msecs);
+    void setAxisRampTime (int axis, int msecs);
     void setJoystickEnabled (bool enabled);
+    void setBinding (int key, const VirtualJoystickBinding& binding);
+    void removeBinding (int key);
 
 private slots:
-    void readAxes (int key, bool pressed);
-    void readPOVs (int key, bool pressed);
-    void readButtons (int key, bool pressed);
     void processKeyEvent (QKeyEvent* event, bool pressed);
 
 protected:
     bool eventFilter (QObject* object, QEvent* event);
 
+private:
+    friend class VirtualJoystickRamp;
+
+    bool integrateAxes (qreal msecs);
+    void loadBindings();
+    void saveBindings();
+    void releaseAll();
+    void saveRampTimes();
+    void setAxisTarget (int axis);
+    void emitAxis (int axis, qreal value);
+    void emitPOV (int angle);
+
 private:
     qreal m_axisRange;
     bool m_joystickEnabled;
     QJoystickDevice m_joystick;
+    QHash<int, VirtualJoystickBinding> m_bindings;
+
+    /* Pressed keys (in press order) */
+    QList<int> m_pressedKeys;
+
+    /* Reported values, targets and ramp times of the axes (see m_mutex) */
+    QList<qreal> m_axisValues;
+    QList<qreal> m_axisTargets;
+    QList<int> m_axisRampTimes;
+
+    /* Wakes the ramp thread when an axis has to move */
+    QMutex m_mutex;
+    bool m_ramping;
+    QWaitCondition m_rampCondition;
+    VirtualJoystickRamp* m_rampThread;
 };
 
 #endif
@@ -0,0 +1,987 @@
+/*
+ * Copyright (c) 2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+
+#include <QDebug>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QJoysticks/Windows_Joysticks.h>
+
+#if defined Q_OS_WIN && !defined Q_OS_WINRT
+    #define NATIVE_SUPPORTED
+#endif
+
+#ifdef NATIVE_SUPPORTED
+    #include <windows.h>
+    #include <xinput.h>
+
+    /* Older MinGW versions ship the HID headers with the DDK headers */
+    extern "C" {
+    #if defined __has_include
+        #if __has_include (<hidsdi.h>)
+            #include <hidsdi.h>
+        #else
+            #include <ddk/hidsdi.h>
+        #endif
+    #else
+        #include <hidsdi.h>
+    #endif
+    }
+
+    /* Raw Input hot-plug notifications (Windows Vista and newer) */
+    #ifndef WM_INPUT_DEVICE_CHANGE
+        #define WM_INPUT_DEVICE_CHANGE 0x00FE
+    #endif
+    #ifndef RIDEV_DEVNOTIFY
+        #define RIDEV_DEVNOTIFY 0x00002000
+    #endif
+    #ifndef GIDC_ARRIVAL
+        #define GIDC_ARRIVAL 1
+    #endif
+#endif
+
+/*
+ * Applications that link the LibDS can trace the joystick input along with
+ * the rest of the DS pipeline (see DS_Trace.h)
+ */
+#if defined DS_ENABLE_TRACE
+    #include <DS_Trace.h>
+#else
+    #define DS_TRACE_THREAD(name) ((void) 0)
+    #define DS_TRACE_SCOPE(name) ((void) 0)
+#endif
+
+/**
+ * Number of controllers supported by XInput
+ */
+#define XINPUT_SLOTS 4
+
+/**
+ * Time (in milliseconds) between two reads of the XInput controllers by the
+ * input thread, when state polling is disabled
+ */
+#define XINPUT_INTERVAL 1
+
+/**
+ * Time (in milliseconds) that the input thread waits for Raw Input messages
+ * when the XInput controllers are read by \c pollState()
+ */
+#define IDLE_INTERVAL 100
+
+/**
+ * Time (in milliseconds) between two searches for new XInput controllers,
+ * querying an empty XInput slot is slow, so it is not done on every read
+ */
+#define XINPUT_SCAN_INTERVAL 1000
+
+/*
+ * Layout of the XInput controllers (the same as the SDL game controllers)
+ */
+#define XINPUT_POVS    1
+#define XINPUT_AXES    6
+#define XINPUT_BUTTONS 10
+
+#ifdef NATIVE_SUPPORTED
+
+/**
+ * XInput mask of each button, in the order of the SDL joystick buttons
+ */
+static const WORD XINPUT_BUTTON_MASKS [XINPUT_BUTTONS] = {
+    XINPUT_GAMEPAD_A,
+    XINPUT_GAMEPAD_B,
+    XINPUT_GAMEPAD_X,
+    XINPUT_GAMEPAD_Y,
+    XINPUT_GAMEPAD_LEFT_SHOULDER,
+    XINPUT_GAMEPAD_RIGHT_SHOULDER,
+    XINPUT_GAMEPAD_BACK,
+    XINPUT_GAMEPAD_START,
+    XINPUT_GAMEPAD_LEFT_THUMB,
+    XINPUT_GAMEPAD_RIGHT_THUMB,
+};
+
+typedef DWORD (WINAPI* XInputGetStateFunc) (DWORD index, XINPUT_STATE* state);
+
+/**
+ * The \c XInputGetState() function of the loaded XInput library
+ */
+static XInputGetStateFunc XINPUT_GET_STATE = Q_NULLPTR;
+
+/**
+ * Loads the newest XInput library that is installed, returns \c false if
+ * XInput is not available
+ */
+static bool loadXInput()
+{
+    static const wchar_t* libraries[] = {
+        L"xinput1_4.dll",
+        L"xinput1_3.dll",
+        L"xinput9_1_0.dll",
+    };
+
+    if (XINPUT_GET_STATE)
+        return true;
+
+    for (uint i = 0; i < sizeof (libraries) / sizeof (libraries [0]); ++i) {
+        HMODULE library = LoadLibraryW (libraries [i]);
+        if (!library)
+            continue;
+
+        /* Cast through a generic function pointer (avoids -Wcast-function-type) */
+        FARPROC symbol = GetProcAddress (library, "XInputGetState");
+        XINPUT_GET_STATE = (XInputGetStateFunc) (void (*)()) symbol;
+        if (XINPUT_GET_STATE)
+            return true;
+
+        FreeLibrary (library);
+    }
+
+    return false;
+}
+
+/**
+ * Returns the value (from -1 to 1) of the given XInput thumbstick axis
+ */
+static qreal getThumbValue (const SHORT value)
+{
+    return qMax (static_cast<qreal> (value) / 32767, static_cast<qreal> (-1));
+}
+
+/**
+ * Returns the POV angle of the given directional pad buttons, or \c -1 if
+ * the directional pad is centered
+ */
+static int getHatAngle (const bool up, const bool right,
+                        const bool down, const bool left)
+{
+    if (up && right)
+        return 45;
+    if (right && down)
+        return 135;
+    if (down && left)
+        return 225;
+    if (left && up)
+        return 315;
+    if (up)
+        return 0;
+    if (right)
+        return 90;
+    if (down)
+        return 180;
+    if (left)
+        return 270;
+
+    return -1;
+}
+
+/**
+ * Copies the values of the given XInput \a gamepad to the given \a state,
+ * using the layout of the SDL game controllers
+ */
+static void readGamepad (const XINPUT_GAMEPAD& gamepad, QJoystickDevice* state)
+{
+    const WORD buttons = gamepad.wButtons;
+
+    state->axes [0] = getThumbValue (gamepad.sThumbLX);
+    state->axes [1] = -getThumbValue (gamepad.sThumbLY);
+    state->axes [2] = getThumbValue (gamepad.sThumbRX);
+    state->axes [3] = -getThumbValue (gamepad.sThumbRY);
+    state->axes [4] = static_cast<qreal> (gamepad.bLeftTrigger) / 255;
+    state->axes [5] = static_cast<qreal> (gamepad.bRightTrigger) / 255;
+
+    for (int i = 0; i < XINPUT_BUTTONS; ++i)
+        state->buttons [i] = (buttons & XINPUT_BUTTON_MASKS [i]) != 0;
+
+    state->povs [0] = getHatAngle ((buttons & XINPUT_GAMEPAD_DPAD_UP) != 0,
+                                   (buttons & XINPUT_GAMEPAD_DPAD_RIGHT) != 0,
+                                   (buttons & XINPUT_GAMEPAD_DPAD_DOWN) != 0,
+                                   (buttons & XINPUT_GAMEPAD_DPAD_LEFT) != 0);
+}
+
+#endif
+
+/**
+ * Receives the Raw Input messages of the joysticks and reads the XInput
+ * controllers, outside of the GUI thread
+ */
+class Windows_InputThread : public QThread
+{
+public:
+    Windows_InputThread (Windows_Joysticks* joysticks) :
+        m_threadId (0), m_joysticks (joysticks) {}
+
+    /**
+     * Stops the thread without waiting for the next read of the XInput
+     * controllers or for the next Raw Input message
+     */
+    void stop()
+    {
+        requestInterruption();
+
+#ifdef NATIVE_SUPPORTED
+        if (m_threadId.load())
+            PostThreadMessageW ((DWORD) m_threadId.load(), WM_NULL, 0, 0);
+#endif
+
+        wait();
+    }
+
+protected:
+    void run()
+    {
+#ifdef NATIVE_SUPPORTED
+        DS_TRACE_THREAD ("Native input");
+
+        /* The Raw Input messages are sent to a message-only window */
+        HWND window = CreateWindowExW (0, L"Message", Q_NULLPTR, 0, 0, 0, 0, 0,
+                                       HWND_MESSAGE, Q_NULLPTR, Q_NULLPTR,
+                                       Q_NULLPTR);
+        if (!window) {
+            qWarning() << Q_FUNC_INFO << "Cannot create the Raw Input window";
+            return;
+        }
+
+        /* Receive the input of every joystick and gamepad */
+        RAWINPUTDEVICE devices [2];
+        for (int i = 0; i < 2; ++i) {
+            devices [i].usUsagePage = HID_USAGE_PAGE_GENERIC;
+            devices [i].dwFlags = RIDEV_INPUTSINK | RIDEV_DEVNOTIFY;
+            devices [i].hwndTarget = window;
+        }
+
+        devices [0].usUsage = HID_USAGE_GENERIC_JOYSTICK;
+        devices [1].usUsage = HID_USAGE_GENERIC_GAMEPAD;
+        if (!RegisterRawInputDevices (devices, 2, sizeof (RAWINPUTDEVICE)))
+            qWarning() << Q_FUNC_INFO << "Cannot register the Raw Input devices";
+
+        /* Allow stop() to wake up the thread */
+        MSG message;
+        PeekMessageW (&message, Q_NULLPTR, 0, 0, PM_NOREMOVE);
+        m_threadId.store ((int) GetCurrentThreadId());
+
+        m_joysticks->enumerateRawDevices();
+        m_joysticks->scanXInput();
+
+        QElapsedTimer scanTimer;
+        scanTimer.start();
+
+        while (!isInterruptionRequested()) {
+            const bool polling = m_joysticks->statePollingEnabled();
+            MsgWaitForMultipleObjects (0, Q_NULLPTR, FALSE,
+                                       polling ? IDLE_INTERVAL : XINPUT_INTERVAL,
+                                       QS_ALLINPUT);
+
+            /* Process the pending Raw Input messages */
+            while (PeekMessageW (&message, Q_NULLPTR, 0, 0, PM_REMOVE)) {
+                DS_TRACE_SCOPE ("Windows_Joysticks::update");
+
+                if (message.message == WM_INPUT)
+                    m_joysticks->processRawInput ((void*) message.lParam);
+
+                else if (message.message == WM_INPUT_DEVICE_CHANGE) {
+                    if (message.wParam == GIDC_ARRIVAL)
+                        m_joysticks->addRawDevice ((void*) message.lParam);
+                    else
+                        m_joysticks->removeRawDevice ((void*) message.lParam);
+                }
+
+                DispatchMessageW (&message);
+            }
+
+            /* Read the XInput controllers (if pollState() does not) */
+            if (!polling)
+                m_joysticks->readXInput();
+
+            /* Look for new XInput controllers */
+            if (scanTimer.elapsed() >= XINPUT_SCAN_INTERVAL) {
+                scanTimer.restart();
+                m_joysticks->scanXInput();
+            }
+        }
+
+        for (int i = 0; i < 2; ++i) {
+            devices [i].dwFlags = RIDEV_REMOVE;
+            devices [i].hwndTarget = Q_NULLPTR;
+        }
+
+        RegisterRawInputDevices (devices, 2, sizeof (RAWINPUTDEVICE));
+        DestroyWindow (window);
+#endif
+    }
+
+private:
+    QAtomicInt m_threadId;
+    Windows_Joysticks* m_joysticks;
+};
+
+Windows_Joysticks::Windows_Joysticks (QObject* parent) : QObject (parent)
+{
+    m_enabled = false;
+    m_statePolling = 0;
+    m_thread = Q_NULLPTR;
+    m_inputHandler = Q_NULLPTR;
+
+    /* Allow the events to be queued from the input thread */
+    qRegisterMetaType<QJoystickPOVEvent>();
+    qRegisterMetaType<QJoystickAxisEvent>();
+    qRegisterMetaType<QJoystickButtonEvent>();
+}
+
+/**
+ * Stops the input thread and deletes the registered devices
+ */
+Windows_Joysticks::~Windows_Joysticks()
+{
+    if (m_thread) {
+        m_thread->stop();
+        delete m_thread;
+    }
+
+    QMutexLocker locker (&m_mutex);
+    foreach (Device* device, m_xinput)
+        delete device;
+    foreach (Device* device, m_raw)
+        delete device;
+
+    qDeleteAll (m_removed);
+    qDeleteAll (m_joysticks);
+}
+
+/**
+ * Returns \c true if the native backend can be used on this operating system
+ */
+bool Windows_Joysticks::isSupported()
+{
+#ifdef NATIVE_SUPPORTED
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Returns \c true if the native backend is reading the controllers
+ */
+bool Windows_Joysticks::isEnabled() const
+{
+    return m_enabled;
+}
+
+/**
+ * Returns \c true if the XInput controllers are only read by \c pollState()
+ */
+bool Windows_Joysticks::statePollingEnabled() const
+{
+    return m_statePolling.load() == 1;
+}
+
+/**
+ * Returns a list with the attached controllers (in the order in which they
+ * were found)
+ *
+ * \note The devices of the controllers that were removed since the last call
+ *       are deleted by this function (see \c SDL_Joysticks::joysticks())
+ */
+QList<QJoystickDevice*> Windows_Joysticks::joysticks()
+{
+    QMutexLocker locker (&m_mutex);
+
+    qDeleteAll (m_removed);
+    m_removed.clear();
+
+    return m_joysticks;
+}
+
+/**
+ * Sets the \a handler that is called from the thread that reads the
+ * controllers, the handler is not called after this function returns
+ */
+void Windows_Joysticks::setInputHandler (QJoystickInputHandler* handler)
+{
+    QMutexLocker locker (&m_mutex);
+    m_inputHandler = handler;
+}
+
+/**
+ * Reads the state of the XInput controllers and reports the values that
+ * changed since the last read. This function does nothing if state polling
+ * is disabled (the Raw Input devices are always read by the input thread).
+ *
+ * \note This function can be called from any thread (e.g. the thread that
+ *       builds the robot packets)
+ */
+void Windows_Joysticks::pollState()
+{
+    if (m_statePolling.load())
+        readXInput();
+}
+
+/**
+ * Starts or stops reading the controllers, the devices of the controllers
+ * are removed when the backend is disabled.
+ *
+ * \note This function does nothing on operating systems other than Windows
+ */
+void Windows_Joysticks::setEnabled (const bool enabled)
+{
+    if (enabled == m_enabled || (enabled && !isSupported()))
+        return;
+
+    if (enabled) {
+#ifdef NATIVE_SUPPORTED
+        if (!loadXInput())
+            qWarning() << Q_FUNC_INFO << "XInput is not available";
+#endif
+
+        m_enabled = true;
+        m_thread = new Windows_InputThread (this);
+        m_thread->start (QThread::TimeCriticalPriority);
+    }
+
+    else {
+        m_enabled = false;
+        m_thread->stop();
+        delete m_thread;
+        m_thread = Q_NULLPTR;
+
+        clearDevices();
+    }
+
+    emit enabledChanged();
+}
+
+/**
+ * Enables or disables state polling. While state polling is enabled, the
+ * XInput controllers are only read when \c pollState() is called.
+ */
+void Windows_Joysticks::setStatePollingEnabled (const bool enabled)
+{
+    m_statePolling.store (enabled ? 1 : 0);
+}
+
+/**
+ * Reads the attached XInput controllers and reports the values that changed,
+ * the controllers that cannot be read are removed
+ */
+void Windows_Joysticks::readXInput()
+{
+#ifdef NATIVE_SUPPORTED
+    if (!XINPUT_GET_STATE)
+        return;
+
+    QList<int> removed;
+    QMutexLocker locker (&m_mutex);
+
+    QHashIterator<int, Device*> it (m_xinput);
+    while (it.hasNext()) {
+        it.next();
+
+        XINPUT_STATE state;
+        if (XINPUT_GET_STATE (it.key(), &state) != ERROR_SUCCESS) {
+            removed.append (it.key());
+            continue;
+        }
+
+        /* XInput changes the packet number when the state changes */
+        Device* device = it.value();
+        if (state.dwPacketNumber == device->packet)
+            continue;
+
+        device->packet = state.dwPacketNumber;
+
+        QJoystickDevice current = device->state;
+        readGamepad (state.Gamepad, &current);
+        reportState (device, current, QJoystickTimestamp());
+    }
+
+    foreach (int slot, removed)
+        unregisterDevice (m_xinput.take (slot));
+
+    locker.unlock();
+
+    if (!removed.isEmpty())
+        emit countChanged();
+#endif
+}
+
+/**
+ * Registers the XInput controllers that were attached since the last scan,
+ * the empty slots are queried without locking the devices
+ */
+void Windows_Joysticks::scanXInput()
+{
+#ifdef NATIVE_SUPPORTED
+    if (!XINPUT_GET_STATE)
+        return;
+
+    bool added = false;
+    for (int slot = 0; slot < XINPUT_SLOTS; ++slot) {
+        m_mutex.lock();
+        const bool attached = m_xinput.contains (slot);
+        m_mutex.unlock();
+
+        XINPUT_STATE state;
+        if (attached || XINPUT_GET_STATE (slot, &state) != ERROR_SUCCESS)
+            continue;
+
+        /* The first read reports the current values */
+        Device* device = new Device;
+        device->packet = ~state.dwPacketNumber;
+
+        m_mutex.lock();
+        registerDevice (device, QString ("XInput Controller #%1").arg (slot + 1),
+                        XINPUT_POVS, XINPUT_AXES, XINPUT_BUTTONS);
+        m_xinput.insert (slot, device);
+        m_mutex.unlock();
+
+        added = true;
+    }
+
+    if (added)
+        emit countChanged();
+#endif
+}
+
+/**
+ * Registers the joysticks and gamepads that are already attached, they are
+ * not always announced by a \c WM_INPUT_DEVICE_CHANGE message
+ */
+void Windows_Joysticks::enumerateRawDevices()
+{
+#ifdef NATIVE_SUPPORTED
+    UINT count = 0;
+    if (GetRawInputDeviceList (Q_NULLPTR, &count, sizeof (RAWINPUTDEVICELIST)) != 0)
+        return;
+
+    QVector<RAWINPUTDEVICELIST> list (count);
+    count = GetRawInputDeviceList (list.data(), &count, sizeof (RAWINPUTDEVICELIST));
+    if (count == (UINT) -1)
+        return;
+
+    for (UINT i = 0; i < count; ++i) {
+        if (list [i].dwType == RIM_TYPEHID)
+            addRawDevice (list [i].hDevice);
+    }
+#endif
+}
+
+/**
+ * Registers the Raw Input device with the given \a handle if it is a
+ * joystick or a gamepad (and it is not an XInput controller, which is read
+ * with XInput). The position and range of each axis, hat and button in the
+ * HID reports of the device are obtained from its report descriptor.
+ */
+void Windows_Joysticks::addRawDevice (void* handle)
+{
+#ifdef NATIVE_SUPPORTED
+    m_mutex.lock();
+    const bool attached = m_raw.contains (handle);
+    m_mutex.unlock();
+
+    if (attached)
+        return;
+
+    /* Only read joysticks and gamepads */
+    RID_DEVICE_INFO info;
+    UINT size = sizeof (info);
+    info.cbSize = sizeof (info);
+    if (GetRawInputDeviceInfoW ((HANDLE) handle, RIDI_DEVICEINFO, &info, &size) == (UINT) -1)
+        return;
+
+    if (info.dwType != RIM_TYPEHID || info.hid.usUsagePage != HID_USAGE_PAGE_GENERIC)
+        return;
+
+    if (info.hid.usUsage != HID_USAGE_GENERIC_JOYSTICK &&
+            info.hid.usUsage != HID_USAGE_GENERIC_GAMEPAD)
+        return;
+
+    /* The HID interfaces of the XInput controllers contain "IG_" */
+    size = 0;
+    GetRawInputDeviceInfoW ((HANDLE) handle, RIDI_DEVICENAME, Q_NULLPTR, &size);
+    QVector<wchar_t> path (size + 1, 0);
+    if (GetRawInputDeviceInfoW ((HANDLE) handle, RIDI_DEVICENAME, path.data(), &size) == (UINT) -1)
+        return;
+
+    if (QString::fromWCharArray (path.constData()).contains ("IG_", Qt::CaseInsensitive))
+        return;
+
+    /* Get the report descriptor */
+    size = 0;
+    GetRawInputDeviceInfoW ((HANDLE) handle, RIDI_PREPARSEDDATA, Q_NULLPTR, &size);
+    if (size == 0)
+        return;
+
+    Device* device = new Device;
+    device->packet = 0;
+    device->preparsed.resize (size);
+    PHIDP_PREPARSED_DATA data = (PHIDP_PREPARSED_DATA) device->preparsed.data();
+
+    HIDP_CAPS caps;
+    if (GetRawInputDeviceInfoW ((HANDLE) handle, RIDI_PREPARSEDDATA, data, &size) == (UINT) -1 ||
+            HidP_GetCaps (data, &caps) != HIDP_STATUS_SUCCESS) {
+        delete device;
+        return;
+    }
+
+    /* Number the buttons in the order of their usages */
+    USHORT length = caps.NumberInputButtonCaps;
+    QVector<HIDP_BUTTON_CAPS> buttonCaps (length);
+    QList<quint16> usages;
+    if (length > 0 && HidP_GetButtonCaps (HidP_Input, buttonCaps.data(), &length,
+                                          data) == HIDP_STATUS_SUCCESS) {
+        for (USHORT i = 0; i < length; ++i) {
+            const HIDP_BUTTON_CAPS& cap = buttonCaps [i];
+            if (cap.UsagePage != HID_USAGE_PAGE_BUTTON)
+                continue;
+
+            const int first = cap.IsRange ? cap.Range.UsageMin : cap.NotRange.Usage;
+            const int last = cap.IsRange ? cap.Range.UsageMax : cap.NotRange.Usage;
+            for (int usage = first; usage <= last; ++usage) {
+                if (!usages.contains (usage))
+                    usages.append (usage);
+            }
+        }
+    }
+
+    std::sort (usages.begin(), usages.end());
+    for (int i = 0; i < usages.count(); ++i)
+        device->buttons.insert (usages.at (i), i);
+
+    device->usages.resize ((int) HidP_MaxUsageListLength (HidP_Input,
+                                                          HID_USAGE_PAGE_BUTTON,
+                                                          data));
+
+    /* Find the axes and hats */
+    int povs = 0;
+    int axes = 0;
+    length = caps.NumberInputValueCaps;
+    QVector<HIDP_VALUE_CAPS> valueCaps (length);
+    if (length > 0 && HidP_GetValueCaps (HidP_Input, valueCaps.data(), &length,
+                                         data) == HIDP_STATUS_SUCCESS) {
+        for (USHORT i = 0; i < length; ++i) {
+            const HIDP_VALUE_CAPS& cap = valueCaps [i];
+            if (cap.UsagePage != HID_USAGE_PAGE_GENERIC)
+                continue;
+
+            const int first = cap.IsRange ? cap.Range.UsageMin : cap.NotRange.Usage;
+            const int last = cap.IsRange ? cap.Range.UsageMax : cap.NotRange.Usage;
+            for (int usage = first; usage <= last; ++usage) {
+                const bool hat = (usage == HID_USAGE_GENERIC_HATSWITCH);
+                if (!hat && (usage < HID_USAGE_GENERIC_X || usage > HID_USAGE_GENERIC_WHEEL))
+                    continue;
+
+                HidValue value;
+                value.page = cap.UsagePage;
+                value.usage = usage;
+                value.collection = cap.LinkCollection;
+                value.bits = cap.BitSize;
+                value.minimum = cap.LogicalMin;
+                value.maximum = cap.LogicalMax;
+                value.hat = hat;
+                value.index = hat ? povs++ : axes++;
+
+                /* Some devices report the maximum of unsigned values as -1 */
+                if (value.maximum <= value.minimum && value.bits > 0 && value.bits < 32) {
+                    value.minimum = 0;
+                    value.maximum = (qint32) ((1U << value.bits) - 1);
+                }
+
+                device->values.append (value);
+            }
+        }
+    }
+
+    /* Get the product name of the device */
+    QString name = "HID Joystick";
+    HANDLE file = CreateFileW (path.constData(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                               Q_NULLPTR, OPEN_EXISTING, 0, Q_NULLPTR);
+    if (file != INVALID_HANDLE_VALUE) {
+        wchar_t product [128] = { 0 };
+        if (HidD_GetProductString (file, product, sizeof (product) - sizeof (wchar_t)))
+            name = QString::fromWCharArray (product);
+
+        CloseHandle (file);
+    }
+
+    m_mutex.lock();
+    registerDevice (device, name, povs, axes, usages.count());
+    m_raw.insert (handle, device);
+    m_mutex.unlock();
+
+    emit countChanged();
+#else
+    Q_UNUSED (handle);
+#endif
+}
+
+/**
+ * Unregisters the Raw Input device with the given \a handle, the device is
+ * deleted when the joystick list is read again
+ */
+void Windows_Joysticks::removeRawDevice (void* handle)
+{
+    m_mutex.lock();
+    Device* device = m_raw.take (handle);
+    if (device)
+        unregisterDevice (device);
+    m_mutex.unlock();
+
+    if (device)
+        emit countChanged();
+}
+
+/**
+ * Reads the values of the HID report of the given Raw \a input message and
+ * reports the values that changed. When a message carries several reports,
+ * only the newest one is read.
+ */
+void Windows_Joysticks::processRawInput (void* input)
+{
+#ifdef NATIVE_SUPPORTED
+    UINT size = 0;
+    HRAWINPUT handle = (HRAWINPUT) input;
+    if (GetRawInputData (handle, RID_INPUT, Q_NULLPTR, &size, sizeof (RAWINPUTHEADER)) != 0)
+        return;
+
+    if (m_inputBuffer.size() < (int) size)
+        m_inputBuffer.resize (size);
+
+    if (GetRawInputData (handle, RID_INPUT, m_inputBuffer.data(), &size,
+                         sizeof (RAWINPUTHEADER)) == (UINT) -1)
+        return;
+
+    RAWINPUT* raw = (RAWINPUT*) m_inputBuffer.data();
+    if (raw->header.dwType != RIM_TYPEHID || raw->data.hid.dwCount == 0)
+        return;
+
+    QMutexLocker locker (&m_mutex);
+    Device* device = m_raw.value (raw->header.hDevice, Q_NULLPTR);
+    if (!device)
+        return;
+
+    const qint64 timestamp = QJoystickTimestamp();
+    const ULONG length = raw->data.hid.dwSizeHid;
+    PCHAR report = (PCHAR) raw->data.hid.bRawData + (raw->data.hid.dwCount - 1) * length;
+    PHIDP_PREPARSED_DATA data = (PHIDP_PREPARSED_DATA) device->preparsed.data();
+
+    /* Read the pressed buttons */
+    QJoystickDevice current = device->state;
+    current.buttons.fill (false);
+
+    ULONG count = device->usages.count();
+    if (count > 0 && HidP_GetUsages (HidP_Input, HID_USAGE_PAGE_BUTTON, 0,
+                                     (PUSAGE) device->usages.data(), &count,
+                                     data, report, length) == HIDP_STATUS_SUCCESS) {
+        for (ULONG i = 0; i < count; ++i) {
+            const int button = device->buttons.value (device->usages.at (i), -1);
+            if (button >= 0)
+                current.buttons [button] = true;
+        }
+    }
+
+    /* Read the axes and hats */
+    foreach (const HidValue& value, device->values) {
+        ULONG encoded = 0;
+        if (HidP_GetUsageValue (HidP_Input, value.page, value.collection,
+                                value.usage, &encoded, data, report,
+                                length) != HIDP_STATUS_SUCCESS)
+            continue;
+
+        /* Extend the sign of negative values */
+        qint64 reading = encoded;
+        if (value.minimum < 0 && value.bits > 0 && value.bits < 32 &&
+                (encoded & (1UL << (value.bits - 1))))
+            reading -= (qint64) 1 << value.bits;
+
+        /* Hats report a value outside of their range when centered */
+        if (value.hat) {
+            const qint64 positions = (qint64) value.maximum - value.minimum + 1;
+            if (reading < value.minimum || reading > value.maximum)
+                current.povs [value.index] = -1;
+            else
+                current.povs [value.index] = (reading - value.minimum) * 360 / positions;
+        }
+
+        else {
+            const qreal range = (qint64) value.maximum - value.minimum;
+            const qreal axis = 2 * (reading - value.minimum) / range - 1;
+            current.axes [value.index] = qBound (static_cast<qreal> (-1), axis,
+                                                 static_cast<qreal> (1));
+        }
+    }
+
+    reportState (device, current, timestamp);
+#else
+    Q_UNUSED (input);
+#endif
+}
+
+/**
+ * Creates the \c QJoystickDevice of the given \a device, the new joystick is
+ * reported by the next call of \c joysticks(). The device mutex must be
+ * locked by the calling thread.
+ */
+void Windows_Joysticks::registerDevice (Device* device, const QString& name,
+                                        const int povs, const int axes,
+                                        const int buttons)
+{
+    QJoystickDevice* joystick = new QJoystickDevice;
+    joystick->id = -1;
+    joystick->name = name;
+    joystick->blacklisted = false;
+    joystick->povs.fill (0, povs);
+    joystick->axes.fill (0, axes);
+    joystick->buttons.fill (false, buttons);
+
+    device->joystick = joystick;
+    device->state.id = -1;
+    device->state.name = name;
+    device->state.blacklisted = false;
+    device->state.povs.fill (-1, povs);
+    device->state.axes.fill (0, axes);
+    device->state.buttons.fill (false, buttons);
+
+    m_joysticks.append (joystick);
+}
+
+/**
+ * Deletes the given \a device, its \c QJoystickDevice is deleted when the
+ * joystick list is read again. The device mutex must be locked by the
+ * calling thread.
+ */
+void Windows_Joysticks::unregisterDevice (Device* device)
+{
+    m_joysticks.removeAll (device->joystick);
+    m_removed.append (device->joystick);
+    delete device;
+}
+
+/**
+ * Unregisters every device (when the backend is disabled)
+ */
+void Windows_Joysticks::clearDevices()
+{
+    m_mutex.lock();
+    const bool changed = !m_xinput.isEmpty() || !m_raw.isEmpty();
+    foreach (Device* device, m_xinput)
+        unregisterDevice (device);
+    foreach (Device* device, m_raw)
+        unregisterDevice (device);
+
+    m_xinput.clear();
+    m_raw.clear();
+    m_mutex.unlock();
+
+    if (changed)
+        emit countChanged();
+}
+
+/**
+ * Reports the values of the \a current state of the given \a device that
+ * changed since the previous read, the whole state is offered to the input
+ * handler first. The device mutex must be locked by the calling thread.
+ */
+void Windows_Joysticks::reportState (Device* device,
+                                     const QJoystickDevice& current,
+                                     const qint64 timestamp)
+{
+    QJoystickDevice& state = device->state;
+    QJoystickDevice* joystick = device->joystick;
+
+    /* Find the POVs that changed */
+    QVector<QJoystickPOVEvent> povEvents;
+    for (int i = 0; i < state.povs.count(); ++i) {
+        if (current.povs.at (i) == state.povs.at (i))
+            continue;
+
+        state.povs [i] = current.povs.at (i);
+
+        QJoystickPOVEvent event;
+        event.pov = i;
+        event.angle = current.povs.at (i);
+        event.timestamp = timestamp;
+        event.joystick = joystick;
+        povEvents.append (event);
+    }
+
+    /* Find the axes that changed */
+    QVector<QJoystickAxisEvent> axisEvents;
+    for (int i = 0; i < state.axes.count(); ++i) {
+        if (current.axes.at (i) == state.axes.at (i))
+            continue;
+
+        state.axes [i] = current.axes.at (i);
+
+        QJoystickAxisEvent event;
+        event.axis = i;
+        event.value = current.axes.at (i);
+        event.timestamp = timestamp;
+        event.joystick = joystick;
+        axisEvents.append (event);
+    }
+
+    /* Find the buttons that changed */
+    QVector<QJoystickButtonEvent> buttonEvents;
+    for (int i = 0; i < state.buttons.count(); ++i) {
+        if (current.buttons.at (i) == state.buttons.at (i))
+            continue;
+
+        state.buttons [i] = current.buttons.at (i);
+
+        QJoystickButtonEvent event;
+        event.button = i;
+        event.pressed = current.buttons.at (i);
+        event.timestamp = timestamp;
+        event.joystick = joystick;
+        buttonEvents.append (event);
+    }
+
+    if (povEvents.isEmpty() && axisEvents.isEmpty() && buttonEvents.isEmpty())
+        return;
+
+    /* Give the whole state to the handler, or each value if it does not
+     * handle complete states */
+    if (m_inputHandler) {
+        QJoystickStateEvent event;
+        event.state = &state;
+        event.timestamp = timestamp;
+        event.joystick = joystick;
+
+        if (!m_inputHandler->stateEvent (event)) {
+            foreach (const QJoystickPOVEvent& e, povEvents)
+                m_inputHandler->povEvent (e);
+            foreach (const QJoystickAxisEvent& e, axisEvents)
+                m_inputHandler->axisEvent (e);
+            foreach (const QJoystickButtonEvent& e, buttonEvents)
+                m_inputHandler->buttonEvent (e);
+        }
+    }
+
+    /* Report the values that changed */
+    foreach (const QJoystickPOVEvent& e, povEvents)
+        emit POVEvent (e);
+    foreach (const QJoystickAxisEvent& e, axisEvents)
+        emit axisEvent (e);
+    foreach (const QJoystickButtonEvent& e, buttonEvents)
+        emit buttonEvent (e);
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef _QJOYSTICKS_WINDOWS_JOYSTICKS_H
+#define _QJOYSTICKS_WINDOWS_JOYSTICKS_H
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QVector>
+#include <QAtomicInt>
+#include <QJoysticks/JoysticksCommon.h>
+
+class Windows_InputThread;
+
+/**
+ * \brief Reads the Windows controllers without going through SDL
+ *
+ * This is an optional backend (disabled by default) that replaces the SDL
+ * joysticks on Windows, so that the input does not wait for the SDL event
+ * queue or for the timer of the GUI thread:
+ *     - Xbox controllers are read with XInput, either by the input thread or
+ *       (when state polling is enabled) by \c pollState(), which is meant to
+ *       be called right before each robot packet is built
+ *     - Other joysticks and gamepads are read with Raw Input, the input
+ *       thread is woken up by the \c WM_INPUT message of each HID report
+ *
+ * The whole state of a controller is read at once, so it is offered to the
+ * \c stateEvent() function of the input handler (which can write it to the
+ * robot packet directly) before the values that changed are reported. The
+ * input handler is called with the device mutex locked, so that it is never
+ * called after \c setInputHandler() returns.
+ *
+ * XInput controllers use the axis and button layout of the SDL game
+ * controllers (the Y axes point down and the triggers go from 0 to 1), so
+ * the robot receives the same values as with the SDL backend.
+ *
+ * \note On other operating systems this class does not report any joystick
+ *       and cannot be enabled. Calibration profiles and haptic effects are
+ *       only supported by the SDL backend.
+ */
+class Windows_Joysticks : public QObject
+{
+    Q_OBJECT
+
+signals:
+    void countChanged();
+    void enabledChanged();
+    void POVEvent (const QJoystickPOVEvent& event);
+    void axisEvent (const QJoystickAxisEvent& event);
+    void buttonEvent (const QJoystickButtonEvent& event);
+
+public:
+    Windows_Joysticks (QObject* parent = Q_NULLPTR);
+    ~Windows_Joysticks();
+
+    static bool isSupported();
+
+    bool isEnabled() const;
+    bool statePollingEnabled() const;
+    QList<QJoystickDevice*> joysticks();
+    void setInputHandler (QJoystickInputHandler* handler);
+    void pollState();
+
+public slots:
+    void setEnabled (const bool enabled);
+    void setStatePollingEnabled (const bool enabled);
+
+private:
+    friend class Windows_InputThread;
+
+    /**
+     * Location and range of an axis or hat in the HID reports of a device
+     */
+    struct HidValue {
+        quint16 page;       /**< HID usage page of the value */
+        quint16 usage;      /**< HID usage of the value */
+        quint16 collection; /**< Link collection that contains the value */
+        quint16 bits;       /**< Size (in bits) of the value */
+        qint32 minimum;     /**< Logical minimum of the value */
+        qint32 maximum;     /**< Logical maximum of the value */
+        bool hat;           /**< Set to \c true if the value is a hat switch */
+        int index;          /**< Index of the axis or POV */
+    };
+
+    /**
+     * An attached controller and the last values that were reported
+     */
+    struct Device {
+        QJoystickDevice* joystick;   /**< Device registered with QJoysticks */
+        QJoystickDevice state;       /**< Values reported by the last read */
+        quint32 packet;              /**< XInput packet number of the state */
+        QByteArray preparsed;        /**< Raw Input report descriptor */
+        QVector<HidValue> values;    /**< Raw Input axes and hats */
+        QHash<quint16, int> buttons; /**< Raw Input button of each usage */
+        QVector<quint16> usages;     /**< Buffer for the pressed buttons */
+    };
+
+    void readXInput();
+    void scanXInput();
+    void enumerateRawDevices();
+    void addRawDevice (void* handle);
+    void removeRawDevice (void* handle);
+    void processRawInput (void* input);
+    void registerDevice (Device* device, const QString& name, const int povs,
+                         const int axes, const int buttons);
+    void unregisterDevice (Device* device);
+    void clearDevices();
+    void reportState (Device* device, const QJoystickDevice& current,
+                      const qint64 timestamp);
+
+    QMutex m_mutex;
+    bool m_enabled;
+    QAtomicInt m_statePolling;
+    QByteArray m_inputBuffer;
+    Windows_InputThread* m_thread;
+    QHash<int, Device*> m_xinput;
+    QHash<void*, Device*> m_raw;
+    QList<QJoystickDevice*> m_removed;
+    QList<QJoystickDevice*> m_joysticks;
+    QJoystickInputHandler* m_inputHandler;
+};
+
+#endif
@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2016 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * This file is part of the LibDS, which is released under the MIT license.
+ * For more information, please read the LICENSE file in the root directory
+ * of this project.
+ */
+
+#ifndef QJOYSTICKS_BENCH_H
+#define QJOYSTICKS_BENCH_H
+
+#include <QtTest>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QJoysticks.h>
+#include <QJoysticks/SDL_Joysticks.h>
+
+#ifdef QJOYSTICKS_BENCH_LIBDS
+    #include <LibDS.h>
+#endif
+
+/*
+ * The fake devices are registered with SDL instance IDs that real joysticks
+ * will never use, and each run injects fewer events than the range of an
+ * axis value (the value of each event is its sequence number)
+ */
+#define FAKE_INSTANCE_ID 0x4000
+#define FAKE_AXES        6
+#define INJECTION_TIME   500
+#define MAX_EVENTS       32767
+
+/**
+ * Latency statistics of one stage of the input path
+ */
+struct Bench_Latency {
+    int count;
+    qint64 sum;
+    qint64 max;
+
+    void reset()
+    {
+        count = 0;
+        sum = 0;
+        max = 0;
+    }
+
+    void add (const qint64 nsecs)
+    {
+        ++count;
+        sum += nsecs;
+        max = qMax (max, nsecs);
+    }
+
+    double meanUsecs() const
+    {
+        return count > 0 ? sum / count / 1000.0 : 0;
+    }
+};
+
+/**
+ * Injection state shared by the pusher thread, the SDL input thread and the
+ * GUI thread. The injection time of each event is stored before the event is
+ * pushed, so the receivers can read it without locking.
+ */
+struct Bench_Injection {
+    int devices;
+    QElapsedTimer clock;
+    QAtomicInt sent;
+    qint64 times [MAX_EVENTS + 1];
+
+    int sequence (const qreal value) const
+    {
+        return qBound (0, qRound (value * 32767), MAX_EVENTS);
+    }
+
+    qint64 latency (const qreal value) const
+    {
+        return clock.nsecsElapsed() - times [sequence (value)];
+    }
+};
+
+/**
+ * Pushes synthetic controller axis events with \c SDL_PushEvent() at a fixed
+ * rate, the events are distributed among the fake devices in turn
+ */
+class Bench_Pusher : public QThread
+{
+public:
+    Bench_Pusher (Bench_Injection* injection, const int rate) :
+        m_rate (rate), m_injection (injection) {}
+
+protected:
+    void run()
+    {
+        const qint64 period = 1000000000LL / m_rate;
+        const int total = qMin (MAX_EVENTS, m_rate * INJECTION_TIME / 1000);
+        const qint64 start = m_injection->clock.nsecsElapsed();
+
+        for (int n = 0; n < total; ++n) {
+            /* Wait for the deadline of this event */
+            qint64 remaining;
+            while ((remaining = start + n * period
+                                - m_injection->clock.nsecsElapsed()) > 0) {
+                if (remaining > 200000)
+                    QThread::usleep ((remaining - 100000) / 1000);
+                else
+                    QThread::yieldCurrentThread();
+            }
+
+            SDL_Event event;
+            SDL_zero (event);
+            event.type = SDL_CONTROLLERAXISMOTION;
+            event.caxis.which = FAKE_INSTANCE_ID + n % m_injection->devices;
+            event.caxis.axis = (n / m_injection->devices) % FAKE_AXES;
+            event.caxis.value = n;
+
+            m_injection->times [n] = m_injection->clock.nsecsElapsed();
+            SDL_PushEvent (&event);
+            m_injection->sent.fetchAndAddOrdered (1);
+        }
+    }
+
+private:
+    int m_rate;
+    Bench_Injection* m_injection;
+};
+
+/**
+ * Receives the events of the fake devices in the SDL input thread and
+ * forwards them to the LibDS (if the harness is built with it)
+ */
+class Bench_InputHandler : public QJoystickInputHandler
+{
+public:
+    Bench_Injection* injection;
+    Bench_Latency latency;
+    QAtomicInt received;
+
+    void povEvent (const QJoystickPOVEvent& event)
+    {
+        Q_UNUSED (event);
+    }
+
+    void axisEvent (const QJoystickAxisEvent& event)
+    {
+#ifdef QJOYSTICKS_BENCH_LIBDS
+        DS_SetJoystickAxis (event.joystick->id, event.axis, (float) event.value);
+#endif
+        latency.add (injection->latency (event.value));
+        received.fetchAndAddOrdered (1);
+    }
+
+    void buttonEvent (const QJoystickButtonEvent& event)
+    {
+        Q_UNUSED (event);
+    }
+};
+
+/**
+ * Measures the cost of the joystick input path:
+ *     - The dispatch cost of a \c QJoysticks axis event and its signal
+ *       fan-out to several receivers
+ *     - The end-to-end delivery of synthetic SDL events (injected at 1-8 kHz
+ *       across several fake devices) to the input handler, which writes them
+ *       to \c DS_SetJoystickAxis(), and to the \c QJoysticks receivers in the
+ *       GUI thread
+ */
+class Bench_QJoysticks : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        joysticks = QJoysticks::getInstance();
+        sdl = joysticks->sdlJoysticks();
+
+        /* SDL is initialized by a background thread */
+        QTRY_VERIFY_WITH_TIMEOUT (sdl->m_initialized, 10000);
+
+        /* Read the events from the input thread */
+        handler.injection = &injection;
+        sdl->setInputHandler (&handler);
+        sdl->setInputThreadEnabled (true);
+
+#ifdef QJOYSTICKS_BENCH_LIBDS
+        DS_Init();
+#endif
+    }
+
+    void cleanupTestCase()
+    {
+        sdl->setInputThreadEnabled (false);
+        sdl->setInputHandler (Q_NULLPTR);
+
+#ifdef QJOYSTICKS_BENCH_LIBDS
+        DS_Close();
+#endif
+    }
+
+    void cleanup()
+    {
+        disconnectReceivers();
+        removeFakeDevices();
+    }
+
+    void dispatchCost_data()
+    {
+        QTest::addColumn<int> ("receivers");
+
+        QTest::newRow ("no receivers") << 0;
+        QTest::newRow ("1 receiver") << 1;
+        QTest::newRow ("8 receivers") << 8;
+    }
+
+    void dispatchCost()
+    {
+        QFETCH (int, receivers);
+
+        addFakeDevices (1);
+        connectReceivers (receivers);
+
+        QJoystickAxisEvent event;
+        event.axis = 0;
+        event.value = 0.5;
+        event.timestamp = QJoystickTimestamp();
+        event.joystick = devices.first();
+
+        QBENCHMARK {
+            emit joysticks->axisEvent (event);
+        }
+    }
+
+    void throughput_data()
+    {
+        QTest::addColumn<int> ("rate");
+        QTest::addColumn<int> ("devices");
+
+        const int rates[] = { 1000, 2000, 4000, 8000 };
+        const int counts[] = { 1, 4, 8 };
+
+        for (int r = 0; r < 4; ++r)
+            for (int d = 0; d < 3; ++d)
+                QTest::newRow (qPrintable (QString ("%1 Hz, %2 devices")
+                                           .arg (rates [r]).arg (counts [d])))
+                        << rates [r] << counts [d];
+    }
+
+    void throughput()
+    {
+        QFETCH (int, rate);
+        QFETCH (int, devices);
+
+        addFakeDevices (devices);
+        connectReceivers (4);
+
+        /* Reset the statistics */
+        injection.devices = devices;
+        injection.sent = 0;
+        injection.clock.start();
+        handler.latency.reset();
+        handler.received = 0;
+        guiLatency.reset();
+
+        /* Inject the events and wait until they are delivered */
+        Bench_Pusher pusher (&injection, rate);
+        pusher.start (QThread::HighPriority);
+        while (!pusher.isFinished())
+            QTest::qWait (10);
+
+        const int sent = injection.sent.load();
+        QTRY_COMPARE_WITH_TIMEOUT (handler.received.load(), sent, 2000);
+        QTRY_COMPARE_WITH_TIMEOUT (guiLatency.count, sent, 2000);
+
+        qDebug ("sent %d events, handler %.1f us (max %.1f us), "
+                "GUI fan-out %.1f us (max %.1f us)", sent,
+                handler.latency.meanUsecs(), handler.latency.max / 1000.0,
+                guiLatency.meanUsecs(), guiLatency.max / 1000.0);
+    }
+
+private:
+    /**
+     * Registers \a count fake devices with the SDL joysticks (as if they
+     * were attached) and with the LibDS
+     */
+    void addFakeDevices (const int count)
+    {
+        sdl->m_mutex.lock();
+        for (int i = 0; i < count; ++i) {
+            QJoystickDevice* device = new QJoystickDevice;
+            device->id = -1;
+            device->name = QString ("Benchmark device %1").arg (i);
+            device->axes.fill (0, FAKE_AXES);
+            device->blacklisted = false;
+
+            devices.append (device);
+            sdl->m_joysticks.append (device);
+            sdl->m_devices.insert (FAKE_INSTANCE_ID + i, device);
+        }
+        sdl->m_mutex.unlock();
+
+        emit sdl->countChanged();
+
+#ifdef QJOYSTICKS_BENCH_LIBDS
+        DS_JoysticksReset();
+        for (int i = 0; i < joysticks->count(); ++i)
+            DS_JoysticksAdd (joysticks->getNumAxes (i),
+                             joysticks->getNumPOVs (i),
+                             joysticks->getNumButtons (i));
+#endif
+    }
+
+    /**
+     * Unregisters and deletes the fake devices
+     */
+    void removeFakeDevices()
+    {
+        sdl->m_mutex.lock();
+        for (int i = 0; i < devices.count(); ++i) {
+            sdl->m_joysticks.removeAll (devices.at (i));
+            sdl->m_devices.remove (FAKE_INSTANCE_ID + i);
+        }
+        sdl->m_mutex.unlock();
+
+        emit sdl->countChanged();
+
+        /* Let queued events for the fake devices be discarded first */
+        QTest::qWait (50);
+        qDeleteAll (devices);
+        devices.clear();
+    }
+
+    /**
+     * Connects \a count receivers to the \c QJoysticks axis signal, the last
+     * receiver measures the latency of the GUI thread delivery
+     */
+    void connectReceivers (const int count)
+    {
+        for (int i = 0; i < count; ++i) {
+            const bool last = (i == count - 1);
+            receivers.append (connect (joysticks, &QJoysticks::axisChanged,
+                                       [this, last] (const int js, const int axis,
+                                                     const qreal value) {
+                Q_UNUSED (js);
+                Q_UNUSED (axis);
+                if (last && injection.clock.isValid())
+                    guiLatency.add (injection.latency (value));
+            }));
+        }
+    }
+
+    /**
+     * Disconnects the receivers of the previous benchmark
+     */
+    void disconnectReceivers()
+    {
+        foreach (const QMetaObject::Connection& connection, receivers)
+            disconnect (connection);
+
+        receivers.clear();
+    }
+
+private:
+    QJoysticks* joysticks;
+    SDL_Joysticks* sdl;
+
+    Bench_Injection injection;
+    Bench_InputHandler handler;
+    Bench_Latency guiLatency;
+
+    QList<QJoystickDevice*> devices;
+    QList<QMetaObject::Connection> receivers;
+};
+
+#endif
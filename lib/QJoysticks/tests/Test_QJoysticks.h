@@ -11,6 +11,7 @@
 
 #include <QtTest>
 #include <QJoysticks.h>
+#include <QJoysticks/JoystickProfiles.h>
 
 class Test_QJoysticks : public QObject
 {
@@ -23,11 +24,10 @@ private slots:
         joysticks = QJoysticks::getInstance();
 
         /* Configure our test device */
-        QJoystickDevice device;
+        device.id = 0;
         device.name = "Test device";
-        device.numAxes = 6;
-        device.numPOVs = 0;
-        device.numButtons = 12;
+        device.axes.fill (0, 6);
+        device.buttons.fill (false, 12);
         device.blacklisted = false;
     }
 
@@ -48,9 +48,9 @@ private slots:
 
         /* Joystick properties should remain the same */
         QVERIFY (joysticks->getName (0) == device.name);
-        QVERIFY (joysticks->getNumAxes (0) == device.numAxes);
-        QVERIFY (joysticks->getNumPOVs (0) == device.numPOVs);
-        QVERIFY (joysticks->getNumButtons (0) == device.numButtons);
+        QVERIFY (joysticks->getNumAxes (0) == device.axes.count());
+        QVERIFY (joysticks->getNumPOVs (0) == device.povs.count());
+        QVERIFY (joysticks->getNumButtons (0) == device.buttons.count());
     }
 
     void checkBlacklistedCount()
@@ -94,6 +94,33 @@ private slots:
         QVERIFY (joysticks->getInputDevice (0) == &device);
     }
 
+    void checkCalibrationProfiles()
+    {
+        QTemporaryDir dir;
+        QString path = dir.path() + "/JoystickProfiles.bin";
+        QByteArray guid (16, 'a');
+        QJoystickAxisCalibration calibration = {0.1f, 0.2f, 0.5f};
+
+        /* Save a profile */
+        JoystickProfiles profiles;
+        QVERIFY (profiles.open (path));
+        profiles.setAxis (guid, 1, calibration);
+        QVERIFY (profiles.save());
+
+        /* The profile must be found in the mapped file */
+        QJoystickProfile profile;
+        JoystickProfiles mapped;
+        QVERIFY (mapped.open (path));
+        QVERIFY (mapped.find (guid, &profile));
+        QVERIFY (profile.axisCount == 2);
+        QVERIFY (qFuzzyCompare (profile.axes [1].deadband, 0.2f));
+        QVERIFY (!mapped.find (QByteArray (16, 'b'), &profile));
+
+        /* Values inside the deadband are reported as 0 */
+        QVERIFY (JoystickProfiles::calibrate (calibration, 0.2) == 0);
+        QVERIFY (qFuzzyCompare (JoystickProfiles::calibrate (calibration, 1.0), 1.0));
+    }
+
     void verifyCrashAvoidance()
     {
         joysticks->resetJoysticks();
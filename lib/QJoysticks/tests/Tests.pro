@@ -27,8 +27,15 @@ TARGET = QJoysticks_Test
 
 include ($$PWD/../QJoysticks.pri)
 
+# Measure the end-to-end delivery into the LibDS when it is available
+exists ($$PWD/../../LibDS/LibDS.pri) {
+    include ($$PWD/../../LibDS/LibDS.pri)
+    DEFINES += QJOYSTICKS_BENCH_LIBDS
+}
+
 SOURCES += \
     $$PWD/main.cpp
 
 HEADERS += \
-    $$PWD/Test_QJoysticks.h
+    $$PWD/Test_QJoysticks.h \
+    $$PWD/Bench_QJoysticks.h
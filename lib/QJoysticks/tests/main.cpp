@@ -21,6 +21,7 @@
  */
 
 #include "Test_QJoysticks.h"
+#include "Bench_QJoysticks.h"
 
 int main (int argc, char* argv[])
 {
@@ -30,6 +31,7 @@ int main (int argc, char* argv[])
     app.setOrganizationName ("The QJoysticks Library");
 
     QTest::qExec (new Test_QJoysticks, argc, argv);
+    QTest::qExec (new Bench_QJoysticks, argc, argv);
     QTimer::singleShot (1000, Qt::PreciseTimer, qApp, SLOT (quit()));
 
     return app.exec();
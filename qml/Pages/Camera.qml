@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+import QtQuick 2.0
+import QtQuick.Layouts 1.0
+import QtQuick.Controls 2.0
+
+import DriverStation 1.0
+
+import "../Widgets"
+import "../Globals.js" as Globals
+
+Pane {
+    //
+    // Default stream of the robot camera server
+    //
+    readonly property string defaultSource: "http://" + DS.appliedRobotAddress
+                                            + ":1181/?action=stream"
+
+    Settings {
+        category: "Camera"
+        property alias url: url.text
+        property alias maxFps: maxFps.value
+    }
+
+    ColumnLayout {
+        anchors.fill: parent
+        spacing: Globals.spacing
+
+        //
+        // Stream URL and frame rate
+        //
+        RowLayout {
+            spacing: Globals.spacing
+            Layout.fillWidth: true
+
+            TextField {
+                id: url
+                Layout.fillWidth: true
+                placeholderText: defaultSource
+            }
+
+            SpinBox {
+                id: maxFps
+                from: 1
+                to: 60
+                value: 30
+            }
+        }
+
+        //
+        // Shows the stream (decoded on a separate thread)
+        //
+        CameraView {
+            id: camera
+            Layout.fillWidth: true
+            Layout.fillHeight: true
+            maxFps: maxFps.value
+            source: url.text.length > 0 ? url.text : defaultSource
+
+            Label {
+                anchors.centerIn: parent
+                visible: !camera.connected
+                text: qsTr ("Waiting for the camera stream...")
+            }
+        }
+
+        //
+        // Stream statistics
+        //
+        Label {
+            Layout.fillWidth: true
+            elide: Text.ElideRight
+            text: camera.fps.toFixed (0) + " FPS, "
+                  + camera.kbps.toFixed (0) + " kbit/s, "
+                  + camera.droppedFrames + " " + qsTr ("dropped")
+                  + (camera.bandwidthLimited ? " (" + qsTr ("bandwidth limited") + ")" : "")
+        }
+    }
+}
@@ -28,6 +28,77 @@ import "../Widgets"
 import "../Globals.js" as Globals
 
 Pane {
+    //
+    // Updates the text of the link quality labels
+    //
+    function updateLinkQuality() {
+        fmsLoss.text = linkText (qsTr ("FMS"), DS.fmsPacketLoss, DS.fmsLossStreak)
+        robotLoss.text = linkText (qsTr ("Robot"), DS.robotPacketLoss, DS.robotLossStreak)
+    }
+
+    //
+    // Returns a formatted string with the given packet loss information
+    //
+    function linkText (name, loss, streak) {
+        return name + ": " + loss + " % " + qsTr ("packet loss") +
+                " (" + streak + " " + qsTr ("lost in a row") + ")"
+    }
+
+    //
+    // Returns the given process value with its unit, or an invalid string
+    // if the value is not available on this OS
+    //
+    function valueText (value, decimals, unit) {
+        return value < 0 ? Globals.invalidStr : value.toFixed (decimals) + unit
+    }
+
+    //
+    // Returns the lines (with their pass/fail state) that describe the
+    // results of the last self-test
+    //
+    function selfTestLines (test) {
+        if (test.completed === undefined)
+            return []
+
+        if (!test.completed)
+            return [ { passed: false, text: qsTr ("The self-test could not run") } ]
+
+        return [
+            { passed: test.timerPassed,
+              text: qsTr ("Timer") + ": " + msText (test.sleepErrorP50, test.sleepErrorP99) +
+                    " " + qsTr ("oversleep") },
+            { passed: test.loopbackPassed,
+              text: qsTr ("Loopback") + ": " + msText (test.loopbackP50, test.loopbackP99) +
+                    " " + qsTr ("round trip") + ", " + test.loopbackLost + " " + qsTr ("lost") },
+            { passed: test.resolvePassed,
+              text: test.robotAddress + ": " + test.resolveTime.toFixed (1) + " ms " +
+                    (test.resolved ? qsTr ("to resolve") : qsTr ("(not found)")) },
+            { passed: test.latenessPassed,
+              text: qsTr ("50 Hz sends") + ": " + msText (test.latenessP50, test.latenessP99) +
+                    " " + qsTr ("late") + " (" + test.latenessMax.toFixed (2) + " ms " + qsTr ("max") + ")" }
+        ]
+    }
+
+    //
+    // Returns the given median and 99th percentile (in milliseconds)
+    //
+    function msText (p50, p99) {
+        return p50.toFixed (2) + " ms (" + p99.toFixed (2) + " ms p99)"
+    }
+
+    //
+    // Update the link quality labels twice per second
+    //
+    Timer {
+        repeat: true
+        interval: 500
+        onTriggered: updateLinkQuality()
+        Component.onCompleted: {
+            start()
+            updateLinkQuality()
+        }
+    }
+
     ColumnLayout {
         anchors.fill: parent
         spacing: Globals.spacing
@@ -67,6 +138,134 @@ Pane {
             checked: DS.connectedToRadio
         }
 
+        //
+        // Link quality label
+        //
+        TitleLabel {
+            spacer: false
+            text: qsTr ("Link Quality")
+        }
+
+        //
+        // FMS packet loss
+        //
+        Label {
+            id: fmsLoss
+            font.pixelSize: 11
+        }
+
+        //
+        // Robot packet loss
+        //
+        Label {
+            id: robotLoss
+            font.pixelSize: 11
+        }
+
+        //
+        // Joystick input label
+        //
+        TitleLabel {
+            spacer: false
+            text: qsTr ("Joystick Input")
+            visible: QJoysticks.statistics.length > 0
+        }
+
+        //
+        // Input statistics of each joystick
+        //
+        Repeater {
+            model: QJoysticks.statistics
+            delegate: Label {
+                font.pixelSize: 11
+                Layout.fillWidth: true
+                elide: Text.ElideRight
+                text: modelData.name + ": " +
+                      Math.round (modelData.eventRate) + " " + qsTr ("events/s") +
+                      ", " + modelData.latency.toFixed (1) + " ms " + qsTr ("latency") +
+                      " (" + modelData.maxLatency.toFixed (1) + " ms " + qsTr ("max") + ")" +
+                      ", " + modelData.droppedEvents + " " + qsTr ("dropped") +
+                      ", " + modelData.coalescedEvents + " " + qsTr ("coalesced")
+            }
+        }
+
+        //
+        // DS process label
+        //
+        TitleLabel {
+            spacer: false
+            text: qsTr ("DS Process")
+        }
+
+        //
+        // CPU, memory and context switches of the DS process
+        //
+        Label {
+            font.pixelSize: 11
+            Layout.fillWidth: true
+            elide: Text.ElideRight
+            text: qsTr ("CPU") + ": " + valueText (ProcessMonitor.cpuUsage, 0, " %") +
+                  ", " + qsTr ("RAM") + ": " + valueText (ProcessMonitor.residentMemory, 1, " MB") +
+                  ", " + valueText (ProcessMonitor.contextSwitches, 0, "") + " " + qsTr ("switches/s")
+        }
+
+        //
+        // Frame times and event loop lag of the GUI
+        //
+        Label {
+            font.pixelSize: 11
+            Layout.fillWidth: true
+            elide: Text.ElideRight
+            text: qsTr ("Frame time") + ": " + ProcessMonitor.frameTime.toFixed (1) + " ms" +
+                  " (" + ProcessMonitor.maxFrameTime.toFixed (1) + " ms " + qsTr ("max") + ")" +
+                  ", " + qsTr ("GUI lag") + ": " + ProcessMonitor.eventLoopLag.toFixed (0) + " ms"
+        }
+
+        //
+        // CPU usage of the busiest threads
+        //
+        Repeater {
+            model: ProcessMonitor.threads
+            delegate: Label {
+                font.pixelSize: 11
+                Layout.fillWidth: true
+                elide: Text.ElideRight
+                text: modelData.name + ": " + modelData.cpu.toFixed (1) + " %"
+            }
+        }
+
+        //
+        // Self-test label
+        //
+        TitleLabel {
+            spacer: false
+            text: qsTr ("Self-Test")
+        }
+
+        //
+        // Result of each self-test check
+        //
+        Repeater {
+            model: selfTestLines (DS.selfTest)
+            delegate: Label {
+                font.pixelSize: 11
+                Layout.fillWidth: true
+                elide: Text.ElideRight
+                text: (modelData.passed ? qsTr ("PASS") : qsTr ("FAIL")) + " - " + modelData.text
+            }
+        }
+
+        //
+        // Self-test button (the test takes about three seconds)
+        //
+        Button {
+            Layout.fillWidth: true
+            enabled: !DS.selfTestRunning
+            onClicked: DS.runSelfTest()
+            text: DS.selfTestRunning ? qsTr ("Running Self-Test...") :
+                                       qsTr ("Run Self-Test")
+        }
+
         //
         // Actions label
         //
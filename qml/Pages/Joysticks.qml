@@ -34,41 +34,28 @@ ColumnLayout {
     spacing: Globals.spacing
 
     //
-    // If set to true, joystick values will not be sent to
-    // the DS, this is good for creating a 'display only'
-    // joystick control
+    // If set to true, the virtual joystick values will not be sent to
+    // the DS, this is good for creating a 'display only' joystick
+    // control (the values of real joysticks are always sent to the DS
+    // by the application)
     //
     property bool simulation: true
 
     //
-    // Automatically configures the jsimoysticks with the DS
+    // Displays the controls of the real joysticks, or the virtual
+    // joystick if no joysticks are attached
     //
     function registerJoysticks() {
-        /* Register joysticks with DS */
-        if (!simulation) {
-            DS.resetJoysticks()
+        if (QJoysticks.count === 0)
+            virtualJoystick.jsId = 0
 
-            if (QJoysticks.count > 0) {
-                for (var i = 0; i < QJoysticks.count; ++i)
-                    DS.addJoystick (QJoysticks.getNumAxes (i),
-                                    QJoysticks.getNumPOVs (i),
-                                    QJoysticks.getNumButtons (i))
-            }
-
-            else {
-                virtualJoystick.jsId = 0
-                DS.addJoystick (6, 0, 10) /* Should be dynamic... */
-            }
-        }
-
-        /* Display the joystick controls */
         stackView.clear()
         stackView.push (QJoysticks.count > 0 ? sdlJoystick : virtualJoystick)
     }
 
     //
-    // Re-configure the joysticks when the user plugs (or unplugs)
-    // a real joystick
+    // Update the controls when the user plugs (or unplugs) a real
+    // joystick
     //
     Connections {
         target: QJoysticks
@@ -76,7 +63,7 @@ ColumnLayout {
     }
 
     //
-    // Configure the DS and UI when creating the widget
+    // Configure the UI when creating the widget
     //
     Component.onCompleted: registerJoysticks()
 
@@ -98,7 +85,6 @@ ColumnLayout {
         SDLJoystick {
             visible: false
             id: sdlJoystick
-            simulation: js.simulation
         }
     }
 }
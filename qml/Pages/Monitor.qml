@@ -27,53 +27,12 @@ import QtQuick.Controls 2.0
 import QtQuick.Controls.Material 2.0
 import QtQuick.Controls.Universal 2.0
 
+import DriverStation 1.0
+
 import "../Widgets"
 import "../Globals.js" as Globals
 
 Pane {
-    //
-    // Updates the text of the sent/recv labels
-    //
-    function updateNetworkUsage() {
-        fmsBytes.text = labelText (DS.sentFMSBytes(), DS.receivedFMSBytes())
-        robotBytes.text = labelText (DS.sentRobotBytes(), DS.receivedRobotBytes())
-    }
-
-    //
-    // Returns a formatted string containing the given data
-    //
-    function labelText (sent, received) {
-        return qsTr ("Sent") + ": " + formatLen (sent) + "<br/>" +
-                qsTr ("Received") + ": " + formatLen (received)
-    }
-
-    //
-    // Obtains the appropiate format for the given size in bytes
-    //
-    function formatLen (bytes) {
-        if (bytes < 1024)
-            return bytes + " bytes"
-
-        else if (bytes < 1024 * 1024)
-            return Math.round ((bytes / 1024)) + " KB"
-
-        var mbytes = bytes / (1024 * 1024)
-        return mbytes.toFixed (2) + " MB"
-    }
-
-    //
-    // Update the network usage labels every second
-    //
-    Timer {
-        repeat: true
-        interval: 1000
-        onTriggered: updateNetworkUsage()
-        Component.onCompleted: {
-            start()
-            updateNetworkUsage()
-        }
-    }
-
     //
     // Layout definition
     //
@@ -125,6 +84,13 @@ Pane {
                         text: DS.connectedToRobot ?
                                   DS.voltageString : Globals.invalidStr
                     }
+
+                    Label {
+                        font.pixelSize: 10
+                        color: "#e4574c"
+                        text: qsTr ("Brownout risk")
+                        visible: DS.connectedToRobot && DS.brownoutWarning
+                    }
                 }
             }
 
@@ -241,8 +207,8 @@ Pane {
                     }
 
                     Label {
-                        id: fmsBytes
                         font.pixelSize: 10
+                        text: DS.fmsNetworkUsage
                     }
                 }
             }
@@ -268,9 +234,136 @@ Pane {
                     }
 
                     Label {
-                        id: robotBytes
                         font.pixelSize: 10
+                        text: DS.robotNetworkUsage
+                    }
+                }
+            }
+
+            //
+            // Bandwidth against the budget
+            //
+            RowLayout {
+                spacing: Globals.spacing * 2
+
+                Image {
+                    fillMode: Image.Pad
+                    verticalAlignment: Image.AlignVCenter
+                    horizontalAlignment: Image.AlignHCenter
+                    source: app.getImage ("network.svg", false)
+                }
+
+                ColumnLayout {
+                    spacing: Globals.spacing / 5
+
+                    Label {
+                        text: qsTr ("Bandwidth")
                     }
+
+                    Label {
+                        font.pixelSize: 10
+                        text: DS.bandwidthUsage
+                    }
+                }
+            }
+
+            //
+            // Live charts title
+            //
+            TitleLabel {
+                spacer: false
+                text: qsTr ("Live charts")
+            }
+
+            //
+            // Robot Voltage chart
+            //
+            ColumnLayout {
+                Layout.fillWidth: true
+                spacing: Globals.spacing / 5
+
+                Label {
+                    font.pixelSize: 11
+                    text: qsTr ("Robot Voltage")
+                }
+
+                TelemetryChart {
+                    clip: true
+                    color: "#6ac259"
+                    minimum: 0
+                    maximum: 13
+                    source: TelemetryChart.Voltage
+                    Layout.fillWidth: true
+                    Layout.preferredHeight: 48
+                }
+            }
+
+            //
+            // Round-trip Latency chart
+            //
+            ColumnLayout {
+                Layout.fillWidth: true
+                spacing: Globals.spacing / 5
+
+                Label {
+                    font.pixelSize: 11
+                    text: qsTr ("Round-trip Latency (ms)")
+                }
+
+                TelemetryChart {
+                    clip: true
+                    color: "#4c9ae4"
+                    minimum: 0
+                    maximum: 50
+                    source: TelemetryChart.RobotLatency
+                    Layout.fillWidth: true
+                    Layout.preferredHeight: 48
+                }
+            }
+
+            //
+            // Packet Loss chart
+            //
+            ColumnLayout {
+                Layout.fillWidth: true
+                spacing: Globals.spacing / 5
+
+                Label {
+                    font.pixelSize: 11
+                    text: qsTr ("Packet Loss (%)")
+                }
+
+                TelemetryChart {
+                    clip: true
+                    color: "#e4574c"
+                    minimum: 0
+                    maximum: 100
+                    source: TelemetryChart.RobotPacketLoss
+                    Layout.fillWidth: true
+                    Layout.preferredHeight: 48
+                }
+            }
+
+            //
+            // CPU Usage chart
+            //
+            ColumnLayout {
+                Layout.fillWidth: true
+                spacing: Globals.spacing / 5
+
+                Label {
+                    font.pixelSize: 11
+                    text: qsTr ("CPU Usage (%)")
+                }
+
+                TelemetryChart {
+                    clip: true
+                    color: "#e4a84c"
+                    minimum: 0
+                    maximum: 100
+                    source: TelemetryChart.CPUUsage
+                    Layout.fillWidth: true
+                    Layout.preferredHeight: 48
                 }
             }
 
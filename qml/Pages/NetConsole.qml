@@ -25,6 +25,9 @@ import QtQuick.Layouts 1.0
 import QtQuick.Controls 2.0
 
 import QtQuick.Controls.Material 2.0
+import QtQuick.Controls.Universal 2.0
+
+import DriverStation 1.0
 
 import "../Widgets"
 import "../Globals.js" as Globals
@@ -34,14 +37,6 @@ Pane {
         anchors.fill: parent
         spacing: Globals.spacing
 
-        //
-        // Display incoming NetConsole messages in the UI
-        //
-        Connections {
-            target: DS
-            onNewMessage: netconsole.append (message)
-        }
-
         //
         // Uneccessary label explaining what is the NetConsole
         //
@@ -54,24 +49,81 @@ Pane {
         }
 
         //
-        // Holds the NetConsole text
+        // Shows only the lines that match the filter (if set)
+        //
+        RowLayout {
+            spacing: Globals.spacing
+            Layout.fillWidth: true
+
+            TextField {
+                id: filter
+                Layout.fillWidth: true
+                placeholderText: qsTr ("Filter")
+                onTextChanged: NetConsoleFilter.filter = text
+            }
+
+            CheckBox {
+                text: qsTr ("Regex")
+                checked: NetConsoleFilter.regex
+                onCheckedChanged: NetConsoleFilter.regex = checked
+            }
+
+            CheckBox {
+                text: qsTr ("Match case")
+                checked: NetConsoleFilter.caseSensitive
+                onCheckedChanged: NetConsoleFilter.caseSensitive = checked
+            }
+        }
+
+        //
+        // Displays the NetConsole lines (only the visible lines are created)
         //
-        Flickable {
-            id: flickable
+        ListView {
+            id: netconsole
+            clip: true
+            model: filter.text.length > 0 ? NetConsoleFilter : NetConsole
             Layout.fillWidth: true
             Layout.fillHeight: true
+            boundsBehavior: Flickable.StopAtBounds
 
-            TextArea.flickable: TextArea {
-                id: netconsole
-                readOnly: true
+            //
+            // Keep showing the newest lines unless the user scrolls up
+            //
+            property bool autoScroll: true
+            onMovementEnded: autoScroll = atYEnd
+            onCountChanged: {
+                if (autoScroll)
+                    positionViewAtEnd()
+            }
+
+            //
+            // Lines are plain text, their color depends on their
+            // severity and on whether they were printed by the robot
+            //
+            delegate: Label {
+                text: model.display
                 font.family: "Mono"
                 wrapMode: Text.Wrap
-                Layout.fillWidth: true
-                Layout.fillHeight: true
-                textFormat: Text.RichText
+                width: netconsole.width
+                textFormat: Text.PlainText
+                color: {
+                    if (model.severity === LibDS.SeverityError)
+                        return "#e4574c"
+                    if (model.severity === LibDS.SeverityWarning)
+                        return "#e4a84c"
+                    if (model.source !== LibDS.NetConsoleRobot)
+                        return "#888"
+
+                    return IsMaterial ? Material.foreground : Universal.foreground
+                }
             }
 
-            ScrollBar.vertical: ScrollBar { }
+            ScrollBar.vertical: ScrollBar {
+                onPressedChanged: {
+                    if (!pressed)
+                        netconsole.autoScroll = netconsole.atYEnd
+                }
+            }
         }
 
         //
@@ -85,15 +137,15 @@ Pane {
                 Layout.fillWidth: true
 
                 onClicked: {
-                    netconsole.copy()
-                    netconsole.append ("** " + qsTr ("NetConsole output copied to clipboard"))
+                    NetConsole.copy()
+                    NetConsole.append (qsTr ("NetConsole output copied to clipboard"))
                 }
             }
 
             Button {
                 text: qsTr ("Clear")
                 Layout.fillWidth: true
-                onClicked: netconsole.clear()
+                onClicked: NetConsole.clear()
             }
         }
     }
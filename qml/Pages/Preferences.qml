@@ -23,9 +23,10 @@
 import QtQuick 2.0
 import QtQuick.Layouts 1.0
 import QtQuick.Controls 2.0
-import Qt.labs.settings 1.0
 import QtQuick.Controls.Universal 2.0
 
+import DriverStation 1.0
+
 import "../Widgets"
 import "../Globals.js" as Globals
 
@@ -36,6 +37,9 @@ Pane {
         property alias robotAddress: robotAddress.text
         property alias protocol: protocols.currentIndex
         property alias enableTriggers: triggers.checked
+        property alias performanceOverlay: overlay.checked
+        property alias performanceMode: performance.checked
+        property alias softwareRenderer: softwareRenderer.checked
     }
 
     Connections {
@@ -108,9 +112,23 @@ Pane {
         Switch {
             id: useMaterial
             checked: IsMaterial
+            enabled: !performance.checked
             text: qsTr ("Use Material style") + " *"
         }
 
+        Switch {
+            id: performance
+            checked: PerformanceMode
+            text: qsTr ("Performance mode (no animations or shadows)") + " *"
+        }
+
+        Switch {
+            id: softwareRenderer
+            checked: false
+            enabled: performance.checked
+            text: qsTr ("Use software renderer") + " *"
+        }
+
         Switch {
             id: triggers
             checked: false
@@ -119,6 +137,14 @@ Pane {
             Component.onCompleted: app.jsTriggersEnabled = checked
         }
 
+        Switch {
+            id: overlay
+            checked: false
+            onCheckedChanged: FrameStats.enabled = checked
+            text: qsTr ("Show performance overlay")
+            Component.onCompleted: FrameStats.enabled = checked
+        }
+
         Item {
             Layout.fillHeight: true
         }
@@ -23,7 +23,6 @@
 import QtQuick 2.0
 import QtQuick.Layouts 1.0
 import QtQuick.Controls 2.0
-import Qt.labs.settings 1.0
 
 import DriverStation 1.0
 
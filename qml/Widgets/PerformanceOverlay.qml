@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+import QtQuick 2.0
+import QtQuick.Layouts 1.0
+import QtQuick.Controls 2.0
+
+import "../Globals.js" as Globals
+
+//
+// Shows the frame times of the window and the DS signals that caused the
+// most binding re-evaluations (emissions x receivers) during the last second
+//
+Rectangle {
+    radius: 2
+    color: "#c0000000"
+    width: layout.implicitWidth + 2 * Globals.spacing
+    height: layout.implicitHeight + 2 * Globals.spacing
+
+    //
+    // Returns the given value with the given number of decimals
+    //
+    function format (value, decimals) {
+        return value.toFixed (decimals)
+    }
+
+    ColumnLayout {
+        id: layout
+        spacing: 2
+        anchors.centerIn: parent
+
+        Label {
+            color: "#fff"
+            font.bold: true
+            font.pixelSize: 11
+            font.family: "Monospace"
+            text: format (FrameStats.fps, 0) + " " + qsTr ("FPS")
+        }
+
+        Label {
+            color: FrameStats.maxFrameTime > 34 ? "#f88" : "#ccc"
+            font.pixelSize: 11
+            font.family: "Monospace"
+            text: qsTr ("Frame") + ": " + format (FrameStats.frameTime, 1) +
+                  " ms (" + qsTr ("max") + " " + format (FrameStats.maxFrameTime, 1) + " ms)"
+        }
+
+        Label {
+            color: "#ccc"
+            font.pixelSize: 11
+            font.family: "Monospace"
+            text: qsTr ("Render") + ": " + format (FrameStats.renderTime, 1) + " ms"
+        }
+
+        Label {
+            color: "#fff"
+            font.bold: true
+            font.pixelSize: 11
+            font.family: "Monospace"
+            visible: FrameStats.signalCosts.length > 0
+            text: qsTr ("Notifications/s (emissions/s x receivers)")
+        }
+
+        Repeater {
+            model: FrameStats.signalCosts
+            delegate: Label {
+                color: "#ccc"
+                font.pixelSize: 11
+                font.family: "Monospace"
+                text: modelData.name + ": " + format (modelData.notifications, 0) +
+                      " (" + format (modelData.rate, 1) + " x " + modelData.receivers + ")"
+            }
+        }
+    }
+}
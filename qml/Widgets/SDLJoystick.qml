@@ -24,15 +24,16 @@ import QtQuick 2.0
 import QtQuick.Layouts 1.0
 import QtQuick.Controls 2.0
 
+import QJoysticks 1.0
 import "../Globals.js" as Globals
 
 ColumnLayout {
     spacing: Globals.spacing
 
     //
-    // Custom properties
+    // Custom properties (joystick values are sent to the DS by the
+    // application, this widget only displays them)
     //
-    property bool simulation: true
     property alias jsId: selector.currentIndex
 
     //
@@ -78,30 +79,21 @@ ColumnLayout {
         columns: numButtons / (numButtons % 2 === 0 ? 2 : 3)
 
         Repeater {
-            model: buttons.numButtons
+            model: JoystickModel {
+                joystick: jsId
+                type: JoystickModel.Buttons
+            }
+
             delegate: Button {
-                id: bt
                 flat: true
                 checkable: true
+                checked: model.value
                 text: qsTr ("" + (index + 1))
                 width: (buttons.width / buttons.columns) - buttons.spacing
 
-                onCheckedChanged: {
-                    if (!simulation)
-                        DS.setJoystickButton (jsId, index, pressed)
-                }
-
                 MouseArea {
                     anchors.fill: parent
                 }
-
-                Connections {
-                    target: QJoysticks
-                    onButtonChanged: {
-                        if (js === jsId && button === index)
-                            bt.checked = pressed
-                    }
-                }
             }
         }
     }
@@ -129,26 +121,20 @@ ColumnLayout {
         columns: numAxes / (numAxes % 2 === 0 ? 2 : 3)
 
         Repeater {
-            model: axes.numAxes
+            model: JoystickModel {
+                joystick: jsId
+                type: JoystickModel.Axes
+            }
+
             delegate: ProgressBar {
-                id: bar
                 to: 100
                 from: -100
+                value: model.value * 100
                 width: (axes.width / axes.columns) - axes.spacing
 
-                onValueChanged: {
-                    if (!simulation)
-                        DS.setJoystickAxis (jsId, index, value / 100)
-                }
-
-                Behavior on value {NumberAnimation{}}
-
-                Connections {
-                    target: QJoysticks
-                    onAxisChanged: {
-                        if (js === jsId && axis === index)
-                            bar.value = value * 100
-                    }
+                Behavior on value {
+                    enabled: !PerformanceMode
+                    NumberAnimation{}
                 }
             }
         }
@@ -177,25 +163,17 @@ ColumnLayout {
         visible: QJoysticks.getNumAxes (jsId) > 0
 
         Repeater {
-            model: hats.numHats
+            model: JoystickModel {
+                joystick: jsId
+                type: JoystickModel.POVs
+            }
+
             delegate: SpinBox {
-                id: hat
                 to: 360
                 from: 0
                 enabled: false
+                value: model.value
                 width: (hats.width / hats.columns) - hats.spacing
-                onValueChanged: {
-                    if (!simulation)
-                        DS.setJoystickHat (jsId, index, value)
-                }
-
-                Connections {
-                    target: QJoysticks
-                    onPovChanged: {
-                        if (js === jsId && pov === index)
-                            hat.value = angle
-                    }
-                }
             }
         }
     }
@@ -34,7 +34,10 @@ ColumnLayout {
     Item {
         id: sp
         height: visible ? Globals.spacing : 0
-        Behavior on height { NumberAnimation{} }
+        Behavior on height {
+            enabled: !PerformanceMode
+            NumberAnimation{}
+        }
     }
 
     Label {
@@ -26,9 +26,12 @@ import QtQuick.Controls 2.0
 import QtQuick.Controls.Material 2.0
 import QtQuick.Controls.Universal 2.0
 
+import DriverStation 1.0
+
 import "../Globals.js" as Globals
 
 ColumnLayout {
+    id: js
     spacing: Globals.spacing
 
     //
@@ -160,111 +163,20 @@ ColumnLayout {
             Layout.minimumHeight: thumbA.height
             anchors.horizontalCenter: parent.horizontalCenter
 
-            //
-            // Moves the appropiate thumbs based on the touch configuration
-            // of the mobile device
-            //
-            function react() {
-                /* Know if one or two fingers are pressing the screen */
-                var aPressed = pointA.pressed
-                var bPressed = pointB.pressed
-
-                /* Get finger positions */
-                var ax = pointA.x
-                var bx = pointB.x
-                var ay = pointA.y * (thumbA.height / height)
-                var by = pointB.y * (thumbB.height / height)
-
-                /* Get position of each thumb */
-                var XposA = (thumbA.x - multitouch.x) + (thumbA.width / 2)
-                var XposB = (thumbB.x - multitouch.x) + (thumbB.width / 2)
-
-                /* Only one finger pressed, decide which thumb to move */
-                if (aPressed !== bPressed) {
-                    /* Get distances between the press and each thumb */
-                    var distanceA = Math.abs (XposA - ax)
-                    var distanceB = Math.abs (XposB - ax)
-
-                    /* Press is closer to first thumb */
-                    if (distanceA < distanceB) {
-                        thumbB.release()
-                        thumbA.press (ax, ay)
-                    }
-
-                    /* Press is closer to second thumb */
-                    else {
-                        thumbA.release()
-                        thumbB.press (ax - XposB + XposA, ay)
-                    }
-                }
-
-                /* Two fingers pressed, move both thumbs */
-                else if (aPressed && bPressed) {
-                    /* Finger A is closer to thumb A */
-                    if (ax < bx) {
-                        thumbA.press (ax, ay)
-                        thumbB.press (bx - XposB + XposA, by)
-                    }
-
-                    /* Finger B is closer to thumb A (press order matters) */
-                    else {
-                        thumbA.press (bx, by)
-                        thumbB.press (ax - XposB + XposA, ay)
-                    }
-                }
-
-                /* No fingers pressed, center thumbs */
-                else {
-                    thumbA.release()
-                    thumbB.release()
-                }
-            }
-
-            //
-            // Multi-touch panel
-            //
-            MultiPointTouchArea {
-                id: multitouch
-                mouseEnabled: true
-                anchors.top: parent.top
-                anchors.left: thumbA.left
-                anchors.right: thumbB.right
-                anchors.bottom: parent.bottom
-
-                touchPoints: [
-                    TouchPoint {
-                        id: pointA
-                        onXChanged: thumbs.react()
-                        onYChanged: thumbs.react()
-                        onPressedChanged: thumbs.react()
-                    },
-                    TouchPoint {
-                        id: pointB
-                        onXChanged: thumbs.react()
-                        onYChanged: thumbs.react()
-                        onPressedChanged: thumbs.react()
-                    }
-                ]
-            }
-
             //
             // First thumb
             //
-            VirtualJoystickAxis {
+            TouchJoystick {
                 id: thumbA
+                xAxis: 0
+                yAxis: 1
+                joystick: jsId
+                simulation: js.simulation
                 anchors.right: center.left
-                anchors.rightMargin: app.width * 0.05              
+                anchors.rightMargin: app.width * 0.05
                 anchors.verticalCenter: parent.verticalCenter
-
-                onXValueChanged: {
-                    if (!simulation)
-                        DS.setJoystickAxis (jsId, 0, xValue)
-                }
-
-                onYValueChanged: {
-                    if (!simulation)
-                        DS.setJoystickAxis (jsId, 1, yValue)
-                }
+                color: IsMaterial ? "#ededed" : "#1f1f1f"
+                knobColor: IsMaterial ? Material.accent : Universal.accent
             }
 
             Item {
@@ -275,21 +187,17 @@ ColumnLayout {
             //
             // Second thumb
             //
-            VirtualJoystickAxis {
+            TouchJoystick {
                 id: thumbB
+                xAxis: 4
+                yAxis: 5
+                joystick: jsId
+                simulation: js.simulation
                 anchors.left: center.right
                 anchors.leftMargin: app.width * 0.05
                 anchors.verticalCenter: parent.verticalCenter
-
-                onXValueChanged: {
-                    if (!simulation)
-                        DS.setJoystickAxis (jsId, 4, xValue)
-                }
-
-                onYValueChanged: {
-                    if (!simulation)
-                        DS.setJoystickAxis (jsId, 5, yValue)
-                }
+                color: IsMaterial ? "#ededed" : "#1f1f1f"
+                knobColor: IsMaterial ? Material.accent : Universal.accent
             }
         }
 
@@ -21,7 +21,6 @@
  */
 
 import QtQuick 2.0
-import QtQml.Models 2.2
 import QtQuick.Layouts 1.0
 import QtQuick.Controls 2.0
 import QtQuick.Controls.Material 2.0
@@ -29,6 +28,7 @@ import QtQuick.Controls.Universal 2.0
 
 import "Pages"
 import "Dialogs"
+import "Widgets"
 import "Globals.js" as Globals
 
 ApplicationWindow {
@@ -43,6 +43,27 @@ ApplicationWindow {
     //
     property bool jsTriggersEnabled: false
 
+    //
+    // Creates the page items (in the same order as the \c titles model)
+    //
+    property list<Component> pages: [
+        Component { Operator {} },
+        Component { Diagnostics {} },
+        Component { Monitor {} },
+        Component { NetConsole {} },
+        Component { Camera {} },
+        Component {
+            Pane {
+                Joysticks {
+                    simulation: true
+                    anchors.fill: parent
+                }
+            }
+        },
+        Component { Preferences {} },
+        Component { Donate {} }
+    ]
+
     //
     // Style options
     //
@@ -62,6 +83,14 @@ ApplicationWindow {
         return "qrc:/images/light/" + image
     }
 
+    //
+    // Returns the operator page (or null if it has not been loaded yet)
+    //
+    function operator() {
+        var loader = loaders.itemAt (0)
+        return loader ? loader.item : null
+    }
+
     //
     // Maximize the window on mobile devices
     //
@@ -204,10 +233,7 @@ ApplicationWindow {
                 // Change toolbar title and current page when user changes the
                 // current page title
                 //
-                onCurrentIndexChanged: {
-                    stackView.push (pages.get (currentIndex))
-                    titleLabel.text = titles.get (currentIndex).title
-                }
+                onCurrentIndexChanged: titleLabel.text = titles.get (currentIndex).title
 
                 //
                 // Open the operator page at launch
@@ -259,7 +285,11 @@ ApplicationWindow {
                 model: titles
 
                 //
-                // Holds the title of each page in the \c pages list
+                // Holds the title of each page in the \c pages list, pages
+                // are created the first time that they are shown. Persistent
+                // pages are kept (hidden) after that, the others are destroyed
+                // when the user switches to another page. Preloaded pages are
+                // created at launch (e.g. to apply the saved settings).
                 //
                 ListModel {
                     id: titles
@@ -267,92 +297,104 @@ ApplicationWindow {
                     ListElement {
                         icon: "operator.svg"
                         title: qsTr ("Operator")
+                        persistent: true
+                        preload: true
                     }
 
                     ListElement {
                         icon: "diagnostics.svg"
                         title: qsTr ("Diagnostics")
+                        persistent: false
+                        preload: false
                     }
 
                     ListElement {
                         icon: "monitor.svg"
                         title: qsTr ("System Monitor")
+                        persistent: true
+                        preload: false
                     }
 
                     ListElement {
                         icon: "netconsole.svg"
                         title: qsTr ("NetConsole")
+                        persistent: false
+                        preload: false
+                    }
+
+                    ListElement {
+                        icon: "camera.svg"
+                        title: qsTr ("Camera")
+                        persistent: false
+                        preload: false
                     }
 
                     ListElement {
                         icon: "joysticks.svg"
                         title: qsTr ("Joysticks")
+                        persistent: false
+                        preload: false
                     }
 
                     ListElement {
                         icon: "settings.svg"
                         title: qsTr ("Preferences")
+                        persistent: true
+                        preload: true
                     }
 
                     ListElement {
                         icon: "donate.svg"
                         title: qsTr ("Donate")
+                        persistent: false
+                        preload: false
                     }
                 }
 
-                //
-                // Holds the page data (to avoid creating duplicate instances)
-                //
-                ObjectModel {
-                    id: pages
-
-                    Operator {
-                        id: operator
-                        visible: false
-                    }
-
-                    Diagnostics {
-                        visible: false
-                    }
-
-                    Monitor {
-                        visible: false
-                    }
+                ScrollIndicator.vertical: ScrollIndicator { }
+            }
+        }
+    }
 
-                    NetConsole {
-                        visible: false
-                    }
+    //
+    // Loads the different pages
+    //
+    Item {
+        anchors.fill: parent
+        anchors.margins: Globals.spacing
 
-                    Pane {
-                        visible: false
+        Repeater {
+            id: loaders
+            model: titles
 
-                        Joysticks {
-                            simulation: true
-                            anchors.fill: parent
-                        }
-                    }
+            delegate: Loader {
+                property bool shown: false
+                readonly property bool current: listView.currentIndex === index
 
-                    Preferences {
-                        visible: false
-                    }
+                anchors.fill: parent
+                asynchronous: true
+                sourceComponent: pages [index]
+                visible: current && status === Loader.Ready
+                active: current || model.preload || (model.persistent && shown)
 
-                    Donate {
-                        visible: false
-                    }
+                onCurrentChanged: {
+                    if (current)
+                        shown = true
                 }
-
-                ScrollIndicator.vertical: ScrollIndicator { }
             }
         }
     }
 
     //
-    // Loads the different pages
+    // Shows the frame statistics when enabled in the preferences
     //
-    StackView {
-        id: stackView
-        anchors.fill: parent
+    Loader {
+        z: 2
+        active: FrameStats.enabled
+        anchors.top: parent.top
+        anchors.right: parent.right
         anchors.margins: Globals.spacing
+        sourceComponent: PerformanceOverlay {}
     }
 
     //
@@ -365,8 +407,8 @@ ApplicationWindow {
                 close.accepted = false
             }
 
-            else if (operator.showingJoysticks) {
-                operator.hideJoysticks()
+            else if (operator() && operator().showingJoysticks) {
+                operator().hideJoysticks()
                 close.accepted = false
             }
 
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "BackgroundService.h"
+
+#include <QDebug>
+#include <DriverStation.h>
+
+#ifdef Q_OS_ANDROID
+    #include <QtAndroidExtras/QtAndroid>
+    #include <QtAndroidExtras/QAndroidJniObject>
+    #include <QtAndroidExtras/QAndroidJniEnvironment>
+#endif
+
+/*
+ * Time (in milliseconds) that the service keeps running after the robot
+ * communications are lost (longer than a robot reboot)
+ */
+static const int RELEASE_DELAY = 60 * 1000;
+
+BackgroundService::BackgroundService()
+{
+    m_active = false;
+
+    m_releaseTimer.setSingleShot (true);
+    m_releaseTimer.setInterval (RELEASE_DELAY);
+    connect (&m_releaseTimer, SIGNAL (timeout()), this, SLOT (release()));
+}
+
+BackgroundService::~BackgroundService()
+{
+    setActive (false);
+}
+
+/**
+ * Returns the only instance of this class
+ */
+BackgroundService* BackgroundService::getInstance()
+{
+    static BackgroundService instance;
+    return &instance;
+}
+
+/**
+ * Returns \c true if the foreground service is running
+ */
+bool BackgroundService::active() const
+{
+    return m_active;
+}
+
+/**
+ * Starts and stops the foreground service with the robot communications of
+ * the given \a driverstation
+ */
+void BackgroundService::watch (DriverStation* driverstation)
+{
+    Q_ASSERT (driverstation);
+
+    connect (driverstation, SIGNAL (robotCommunicationsChanged (bool)),
+             this,            SLOT (onRobotCommunicationsChanged (bool)));
+
+    onRobotCommunicationsChanged (driverstation->connectedToRobot());
+}
+
+/**
+ * Stops the foreground service, the robot did not come back in time
+ */
+void BackgroundService::release()
+{
+    setActive (false);
+}
+
+/**
+ * Starts the service when the robot is found, or schedules its release when
+ * the robot communications are lost
+ */
+void BackgroundService::onRobotCommunicationsChanged (const bool connected)
+{
+    if (connected) {
+        m_releaseTimer.stop();
+        setActive (true);
+    }
+
+    else if (m_active && !m_releaseTimer.isActive())
+        m_releaseTimer.start();
+}
+
+/**
+ * Starts or stops the foreground \c DriverStationService
+ */
+void BackgroundService::setActive (const bool active)
+{
+    if (m_active == active)
+        return;
+
+    m_active = active;
+
+#ifdef Q_OS_ANDROID
+    QAndroidJniEnvironment env;
+    QAndroidJniObject activity = QtAndroid::androidActivity();
+    if (!activity.isValid())
+        return;
+
+    QAndroidJniObject::callStaticMethod<void> ("org/qdriverstation/DriverStationService",
+                                               active ? "start" : "stop",
+                                               "(Landroid/content/Context;)V",
+                                               activity.object());
+
+    /* The service is not declared in the manifest */
+    if (env->ExceptionCheck()) {
+        env->ExceptionClear();
+        qWarning() << Q_FUNC_INFO << "Cannot start the background service";
+    }
+#endif
+}
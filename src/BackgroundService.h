@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _BACKGROUND_SERVICE_H
+#define _BACKGROUND_SERVICE_H
+
+#include <QTimer>
+#include <QObject>
+
+class DriverStation;
+
+/**
+ * Keeps the LibDS running at full speed on Android while the robot is
+ * connected. The foreground \c DriverStationService (which holds a wake
+ * lock and a Wi-Fi lock) is started when the robot communications are
+ * established, and stopped some time after they are lost, so that a robot
+ * reboot does not release the locks.
+ *
+ * The LibDS event loop runs in its own native thread, which keeps its 20 ms
+ * cadence while the service runs, even if the QML interface is throttled
+ * by the OS. On other platforms this class does nothing.
+ */
+class BackgroundService : public QObject
+{
+    Q_OBJECT
+
+public:
+    static BackgroundService* getInstance();
+
+    bool active() const;
+    void watch (DriverStation* driverstation);
+
+private slots:
+    void release();
+    void onRobotCommunicationsChanged (const bool connected);
+
+private:
+    BackgroundService();
+    ~BackgroundService();
+
+    void setActive (const bool active);
+
+private:
+    bool m_active;
+    QTimer m_releaseTimer;
+};
+
+#endif
@@ -0,0 +1,580 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "CameraView.h"
+
+#include <QtQml>
+#include <QBuffer>
+#include <QImageReader>
+#include <QQuickWindow>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSGSimpleTextureNode>
+#include <QNetworkAccessManager>
+#include <DriverStation.h>
+
+/*
+ * Default frame rates (without and with the bandwidth warning), the time
+ * (in msecs) before reconnecting to a closed stream, the size of the read
+ * buffer of the stream and the largest accepted JPEG frame
+ */
+#define DEFAULT_MAX_FPS     30
+#define DEFAULT_LIMITED_FPS 5
+#define RECONNECT_INTERVAL  2000
+#define READ_BUFFER_SIZE    (128 * 1024)
+#define MAX_FRAME_SIZE      (4 * 1024 * 1024)
+
+/*
+ * JPEG start and end of image markers
+ */
+static const char SOI [] = "\xFF\xD8";
+static const char EOI [] = "\xFF\xD9";
+
+/**
+ * Initializes the decoder, the network objects are created on the worker
+ * thread when the stream is opened
+ */
+CameraDecoder::CameraDecoder() :
+    m_resumeTimer (this),
+    m_reconnectTimer (this),
+    m_reply (nullptr),
+    m_manager (nullptr),
+    m_interval (1000 / DEFAULT_MAX_FPS),
+    m_connected (false),
+    m_pending (false),
+    m_frames (0),
+    m_dropped (0),
+    m_bytes (0)
+{
+    m_resumeTimer.setSingleShot (true);
+    m_reconnectTimer.setSingleShot (true);
+
+    connect (&m_resumeTimer, &QTimer::timeout,
+             this,           &CameraDecoder::readStream);
+    connect (&m_reconnectTimer, &QTimer::timeout, this, [this]() {
+        open (m_url);
+    });
+}
+
+/**
+ * Returns the newest decoded frame (or a null image if there is no new
+ * frame), the decoder is then allowed to decode the next frame
+ */
+QImage CameraDecoder::takeFrame()
+{
+    QMutexLocker locker (&m_mutex);
+
+    QImage frame = m_frame;
+    m_frame = QImage();
+    m_pending = false;
+
+    return frame;
+}
+
+/**
+ * Obtains the number of decoded \a frames, of \a dropped frames and of
+ * received \a bytes since the decoder was created
+ */
+void CameraDecoder::readStats (quint64* frames, quint64* dropped,
+                               quint64* bytes)
+{
+    QMutexLocker locker (&m_mutex);
+
+    *frames = m_frames;
+    *dropped = m_dropped;
+    *bytes = m_bytes;
+}
+
+/**
+ * Closes the stream (if any)
+ */
+void CameraDecoder::close()
+{
+    m_resumeTimer.stop();
+    m_reconnectTimer.stop();
+
+    if (m_reply) {
+        m_reply->disconnect (this);
+        m_reply->abort();
+        m_reply->deleteLater();
+        m_reply = nullptr;
+    }
+
+    m_buffer.clear();
+
+    if (m_connected) {
+        m_connected = false;
+        emit connectedChanged (false);
+    }
+}
+
+/**
+ * Closes the current stream and receives the MJPEG stream at the given
+ * \a url instead
+ */
+void CameraDecoder::open (const QUrl& url)
+{
+    close();
+
+    m_url = url;
+    if (!m_url.isValid())
+        return;
+
+    if (!m_manager)
+        m_manager = new QNetworkAccessManager (this);
+
+    m_reply = m_manager->get (QNetworkRequest (m_url));
+    m_reply->setReadBufferSize (READ_BUFFER_SIZE);
+
+    connect (m_reply, &QNetworkReply::readyRead,
+             this,    &CameraDecoder::readStream);
+    connect (m_reply, &QNetworkReply::finished,
+             this,    &CameraDecoder::onFinished);
+}
+
+/**
+ * Limits the number of frames read from the stream per second, \c 0
+ * removes the limit
+ */
+void CameraDecoder::setMaxFps (const int fps)
+{
+    m_interval = (fps > 0) ? 1000 / fps : 0;
+}
+
+/**
+ * Decodes the frames at (about) the given \a size if they are larger, so
+ * that the decoder does not produce pixels that the view would discard
+ */
+void CameraDecoder::setTargetSize (const QSize& size)
+{
+    m_targetSize = size;
+}
+
+/**
+ * Reads the data received since the last call and decodes the newest
+ * complete frame. Nothing is read until the frame interval has elapsed,
+ * so that the stream is throttled by the network stack.
+ */
+void CameraDecoder::readStream()
+{
+    if (!m_reply || m_resumeTimer.isActive())
+        return;
+
+    if (m_lastFrame.isValid()) {
+        const qint64 remaining = m_interval - m_lastFrame.elapsed();
+        if (remaining > 0) {
+            m_resumeTimer.start ((int) remaining);
+            return;
+        }
+    }
+
+    QByteArray data = m_reply->readAll();
+    if (data.isEmpty())
+        return;
+
+    if (!m_connected) {
+        m_connected = true;
+        emit connectedChanged (true);
+    }
+
+    m_buffer.append (data);
+
+    /* Keep the newest complete frame, the older ones are dropped */
+    int skipped = 0;
+    QByteArray jpeg;
+    QByteArray frame;
+    while (extractFrame (&frame)) {
+        if (!jpeg.isEmpty())
+            ++skipped;
+
+        jpeg = frame;
+    }
+
+    if (m_buffer.size() > MAX_FRAME_SIZE)
+        m_buffer.clear();
+
+    /* Do not decode while the view has not taken the previous frame */
+    bool busy;
+    m_mutex.lock();
+    busy = m_pending;
+    m_bytes += (quint64) data.size();
+    m_dropped += (quint64) skipped + (busy && !jpeg.isEmpty() ? 1 : 0);
+    m_mutex.unlock();
+
+    if (!jpeg.isEmpty() && !busy) {
+        decode (jpeg);
+        m_lastFrame.start();
+    }
+}
+
+/**
+ * Reconnects to the stream after it was closed by the camera (or could
+ * not be opened)
+ */
+void CameraDecoder::onFinished()
+{
+    close();
+    m_reconnectTimer.start (RECONNECT_INTERVAL);
+}
+
+/**
+ * Moves the first complete JPEG image of the buffer to \a jpeg, the
+ * multipart headers and boundaries around the image are discarded
+ *
+ * \returns \c true if a complete image was found
+ */
+bool CameraDecoder::extractFrame (QByteArray* jpeg)
+{
+    const int start = m_buffer.indexOf (SOI);
+    if (start < 0) {
+        /* Keep the last byte, it may be the first byte of a marker */
+        m_buffer.remove (0, qMax (0, m_buffer.size() - 1));
+        return false;
+    }
+
+    const int end = m_buffer.indexOf (EOI, start + 2);
+    if (end < 0) {
+        m_buffer.remove (0, start);
+        return false;
+    }
+
+    *jpeg = m_buffer.mid (start, end + 2 - start);
+    m_buffer.remove (0, end + 2);
+    return true;
+}
+
+/**
+ * Decodes the given \a jpeg image (scaled down to the size of the view)
+ * and stores it as the newest frame
+ */
+void CameraDecoder::decode (const QByteArray& jpeg)
+{
+    QByteArray data = jpeg;
+    QBuffer buffer (&data);
+    QImageReader reader (&buffer, "jpeg");
+
+    const QSize size = reader.size();
+    if (m_targetSize.isValid() && size.isValid() &&
+            (size.width() > m_targetSize.width() ||
+             size.height() > m_targetSize.height()))
+        reader.setScaledSize (size.scaled (m_targetSize, Qt::KeepAspectRatio));
+
+    QImage image = reader.read();
+    if (image.isNull())
+        return;
+
+    m_mutex.lock();
+    m_frame = image;
+    m_pending = true;
+    ++m_frames;
+    m_mutex.unlock();
+
+    emit frameReady();
+}
+
+/**
+ * Creates the view and starts its decoder thread
+ */
+CameraView::CameraView (QQuickItem* parent) : QQuickItem (parent),
+    m_active (true),
+    m_maxFps (DEFAULT_MAX_FPS),
+    m_limitedFps (DEFAULT_LIMITED_FPS),
+    m_limited (false),
+    m_connected (false),
+    m_decoder (new CameraDecoder),
+    m_lastFrames (0),
+    m_lastBytes (0),
+    m_dropped (0),
+    m_fps (0),
+    m_kbps (0)
+{
+    setFlag (ItemHasContents, true);
+
+    m_decoder->moveToThread (&m_thread);
+    connect (&m_thread, &QThread::finished,
+             m_decoder, &QObject::deleteLater);
+    connect (m_decoder, &CameraDecoder::frameReady,
+             this,      &QQuickItem::update);
+    connect (m_decoder, &CameraDecoder::connectedChanged,
+             this,      &CameraView::onConnectedChanged);
+    connect (DriverStation::getInstance(), &DriverStation::networkUsageChanged,
+             this,                         &CameraView::updateRate);
+    connect (&m_statsTimer, &QTimer::timeout,
+             this,          &CameraView::updateStats);
+
+    m_thread.start();
+    m_statsTimer.start (1000);
+    m_statsClock.start();
+}
+
+/**
+ * Stops the decoder thread (the decoder and its stream are deleted with it)
+ */
+CameraView::~CameraView()
+{
+    m_thread.quit();
+    m_thread.wait();
+}
+
+/**
+ * Registers the camera view with QML
+ */
+void CameraView::declareQML()
+{
+    qmlRegisterType<CameraView> ("DriverStation", 1, 0, "CameraView");
+}
+
+/**
+ * Returns the URL of the MJPEG stream
+ */
+QUrl CameraView::source() const
+{
+    return m_source;
+}
+
+/**
+ * Returns \c true if the stream is received and shown
+ */
+bool CameraView::active() const
+{
+    return m_active;
+}
+
+/**
+ * Returns the highest frame rate of the stream (\c 0 if it is not limited)
+ */
+int CameraView::maxFps() const
+{
+    return m_maxFps;
+}
+
+/**
+ * Returns the frame rate used while the bandwidth warning is raised
+ */
+int CameraView::limitedFps() const
+{
+    return m_limitedFps;
+}
+
+/**
+ * Returns \c true if the frame rate is reduced because of the bandwidth
+ * budget warning
+ */
+bool CameraView::bandwidthLimited() const
+{
+    return m_limited;
+}
+
+/**
+ * Returns \c true if the stream is being received
+ */
+bool CameraView::connected() const
+{
+    return m_connected;
+}
+
+/**
+ * Returns the number of frames decoded during the last second
+ */
+qreal CameraView::fps() const
+{
+    return m_fps;
+}
+
+/**
+ * Returns the stream bitrate (in kbit/s) during the last second
+ */
+qreal CameraView::kbps() const
+{
+    return m_kbps;
+}
+
+/**
+ * Returns the number of frames that were received but not shown
+ */
+quint64 CameraView::droppedFrames() const
+{
+    return m_dropped;
+}
+
+/**
+ * Changes the URL of the MJPEG stream
+ */
+void CameraView::setSource (const QUrl& source)
+{
+    if (m_source != source) {
+        m_source = source;
+        restartStream();
+        emit sourceChanged();
+    }
+}
+
+/**
+ * Starts or stops receiving the stream
+ */
+void CameraView::setActive (const bool active)
+{
+    if (m_active != active) {
+        m_active = active;
+        restartStream();
+        emit activeChanged();
+    }
+}
+
+/**
+ * Changes the highest frame rate of the stream
+ */
+void CameraView::setMaxFps (const int fps)
+{
+    if (m_maxFps != fps) {
+        m_maxFps = qMax (0, fps);
+        updateRate();
+        emit rateChanged();
+    }
+}
+
+/**
+ * Changes the frame rate used while the bandwidth warning is raised
+ */
+void CameraView::setLimitedFps (const int fps)
+{
+    if (m_limitedFps != fps) {
+        m_limitedFps = qMax (1, fps);
+        updateRate();
+        emit rateChanged();
+    }
+}
+
+/**
+ * Uploads the newest decoded frame (if any) to a texture and fits it in
+ * the item, keeping its aspect ratio
+ */
+QSGNode* CameraView::updatePaintNode (QSGNode* node, UpdatePaintNodeData* data)
+{
+    Q_UNUSED (data);
+
+    QSGSimpleTextureNode* texture = static_cast<QSGSimpleTextureNode*> (node);
+    if (!m_active || m_source.isEmpty()) {
+        delete texture;
+        return nullptr;
+    }
+
+    QImage frame = m_decoder->takeFrame();
+    if (!frame.isNull() && window()) {
+        if (!texture) {
+            texture = new QSGSimpleTextureNode;
+            texture->setOwnsTexture (true);
+            texture->setFiltering (QSGTexture::Linear);
+        }
+
+        texture->setTexture (window()->createTextureFromImage (frame));
+        m_frameSize = frame.size();
+    }
+
+    if (texture && !m_frameSize.isEmpty()) {
+        QSizeF size = QSizeF (m_frameSize).scaled (boundingRect().size(),
+                                                   Qt::KeepAspectRatio);
+        texture->setRect (QRectF ((width() - size.width()) / 2,
+                                  (height() - size.height()) / 2,
+                                  size.width(), size.height()));
+    }
+
+    return texture;
+}
+
+/**
+ * Tells the decoder the size (in pixels) of the item
+ */
+void CameraView::geometryChanged (const QRectF& newGeometry,
+                                  const QRectF& oldGeometry)
+{
+    QQuickItem::geometryChanged (newGeometry, oldGeometry);
+
+    const qreal ratio = window() ? window()->devicePixelRatio() : 1;
+    const QSize size = (newGeometry.size() * ratio).toSize();
+    QMetaObject::invokeMethod (m_decoder, "setTargetSize",
+                               Q_ARG (QSize, size));
+}
+
+/**
+ * Computes the frame rate and bitrate of the last second
+ */
+void CameraView::updateStats()
+{
+    quint64 frames, dropped, bytes;
+    m_decoder->readStats (&frames, &dropped, &bytes);
+
+    const qint64 elapsed = qMax<qint64> (1, m_statsClock.restart());
+    m_fps = (frames - m_lastFrames) * 1000.0 / elapsed;
+    m_kbps = (bytes - m_lastBytes) * 8.0 / elapsed;
+    m_dropped = dropped;
+
+    m_lastFrames = frames;
+    m_lastBytes = bytes;
+
+    emit statsChanged();
+}
+
+/**
+ * Reduces the frame rate while the bandwidth budget warning is raised, the
+ * camera traffic is part of the network usage measured by the DS
+ */
+void CameraView::updateRate()
+{
+    const bool limited = DriverStation::getInstance()->bandwidthWarning();
+    const int fps = limited ? qMin (m_limitedFps, m_maxFps > 0 ? m_maxFps
+                                    : m_limitedFps) : m_maxFps;
+
+    QMetaObject::invokeMethod (m_decoder, "setMaxFps", Q_ARG (int, fps));
+
+    if (m_limited != limited) {
+        m_limited = limited;
+        emit rateChanged();
+    }
+}
+
+/**
+ * Opens the stream if the view is active, or closes it
+ */
+void CameraView::restartStream()
+{
+    m_frameSize = QSize();
+
+    if (m_active && !m_source.isEmpty())
+        QMetaObject::invokeMethod (m_decoder, "open", Q_ARG (QUrl, m_source));
+    else
+        QMetaObject::invokeMethod (m_decoder, "close");
+
+    update();
+}
+
+/**
+ * Updates the connection state reported by the decoder
+ */
+void CameraView::onConnectedChanged (const bool connected)
+{
+    if (m_connected != connected) {
+        m_connected = connected;
+        emit connectedChanged();
+    }
+}
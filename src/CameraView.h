@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef _CAMERA_VIEW_H
+#define _CAMERA_VIEW_H
+
+#include <QUrl>
+#include <QImage>
+#include <QMutex>
+#include <QTimer>
+#include <QThread>
+#include <QByteArray>
+#include <QQuickItem>
+#include <QElapsedTimer>
+
+class QNetworkReply;
+class QNetworkAccessManager;
+
+/**
+ * Receives an MJPEG camera stream (as served by the robot camera server)
+ * and decodes its frames on a worker thread.
+ *
+ * Only the newest decoded frame is kept: if the view did not upload the
+ * previous frame yet, it is replaced (and counted as dropped), and while a
+ * frame is waiting the JPEG data is not decoded at all. The frame rate is
+ * limited by not reading the stream between frames, the read buffer of the
+ * network reply is small, so the camera server is throttled by TCP flow
+ * control instead of the DS downloading frames that it would discard.
+ */
+class CameraDecoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    CameraDecoder();
+
+    QImage takeFrame();
+    void readStats (quint64* frames, quint64* dropped, quint64* bytes);
+
+public slots:
+    void close();
+    void open (const QUrl& url);
+    void setMaxFps (const int fps);
+    void setTargetSize (const QSize& size);
+
+signals:
+    void frameReady();
+    void connectedChanged (const bool connected);
+
+private slots:
+    void readStream();
+    void onFinished();
+
+private:
+    bool extractFrame (QByteArray* jpeg);
+    void decode (const QByteArray& jpeg);
+
+private:
+    QUrl m_url;
+    QSize m_targetSize;
+    QByteArray m_buffer;
+    QTimer m_resumeTimer;
+    QTimer m_reconnectTimer;
+    QElapsedTimer m_lastFrame;
+    QNetworkReply* m_reply;
+    QNetworkAccessManager* m_manager;
+    int m_interval;
+    bool m_connected;
+
+    /* Shared with the GUI and render threads */
+    QMutex m_mutex;
+    QImage m_frame;
+    bool m_pending;
+    quint64 m_frames;
+    quint64 m_dropped;
+    quint64 m_bytes;
+};
+
+/**
+ * Shows a robot camera stream. The frames are decoded by a
+ * \c CameraDecoder on its own thread and uploaded to a scene graph texture
+ * when the item is rendered, so the GUI thread never decodes video.
+ *
+ * While the bandwidth budget warning of the DS is raised, the frame rate is
+ * reduced to \c limitedFps, so that the camera does not starve the robot
+ * packets.
+ */
+class CameraView : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY (QUrl source
+                READ source
+                WRITE setSource
+                NOTIFY sourceChanged)
+    Q_PROPERTY (bool active
+                READ active
+                WRITE setActive
+                NOTIFY activeChanged)
+    Q_PROPERTY (int maxFps
+                READ maxFps
+                WRITE setMaxFps
+                NOTIFY rateChanged)
+    Q_PROPERTY (int limitedFps
+                READ limitedFps
+                WRITE setLimitedFps
+                NOTIFY rateChanged)
+    Q_PROPERTY (bool bandwidthLimited
+                READ bandwidthLimited
+                NOTIFY rateChanged)
+    Q_PROPERTY (bool connected
+                READ connected
+                NOTIFY connectedChanged)
+    Q_PROPERTY (qreal fps
+                READ fps
+                NOTIFY statsChanged)
+    Q_PROPERTY (qreal kbps
+                READ kbps
+                NOTIFY statsChanged)
+    Q_PROPERTY (quint64 droppedFrames
+                READ droppedFrames
+                NOTIFY statsChanged)
+
+public:
+    CameraView (QQuickItem* parent = nullptr);
+    ~CameraView();
+
+    static void declareQML();
+
+    QUrl source() const;
+    bool active() const;
+    int maxFps() const;
+    int limitedFps() const;
+    bool bandwidthLimited() const;
+    bool connected() const;
+    qreal fps() const;
+    qreal kbps() const;
+    quint64 droppedFrames() const;
+
+public slots:
+    void setSource (const QUrl& source);
+    void setActive (const bool active);
+    void setMaxFps (const int fps);
+    void setLimitedFps (const int fps);
+
+signals:
+    void rateChanged();
+    void statsChanged();
+    void activeChanged();
+    void sourceChanged();
+    void connectedChanged();
+
+protected:
+    QSGNode* updatePaintNode (QSGNode* node, UpdatePaintNodeData* data);
+    void geometryChanged (const QRectF& newGeometry,
+                          const QRectF& oldGeometry);
+
+private slots:
+    void updateStats();
+    void updateRate();
+    void restartStream();
+    void onConnectedChanged (const bool connected);
+
+private:
+    QUrl m_source;
+    bool m_active;
+    int m_maxFps;
+    int m_limitedFps;
+    bool m_limited;
+    bool m_connected;
+    QSize m_frameSize;
+
+    QThread m_thread;
+    CameraDecoder* m_decoder;
+
+    /* Statistics of the last second */
+    QTimer m_statsTimer;
+    QElapsedTimer m_statsClock;
+    quint64 m_lastFrames;
+    quint64 m_lastBytes;
+    quint64 m_dropped;
+    qreal m_fps;
+    qreal m_kbps;
+};
+
+#endif
@@ -0,0 +1,400 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "FrameStatistics.h"
+
+#include <algorithm>
+#include <QMetaMethod>
+#include <QQuickWindow>
+
+/*
+ * Update interval of the statistics (in msecs) and number of signals shown
+ * by the overlay
+ */
+#define UPDATE_INTERVAL 1000
+#define MAX_SIGNALS     6
+
+/**
+ * Counts the emissions of a signal. The counter is connected directly to
+ * the signal (like \c QSignalSpy does), so it is called in the thread that
+ * emits the signal and the count must be atomic.
+ */
+class SignalCounter : public QObject
+{
+public:
+    SignalCounter (QObject* object, const QString& name, const QMetaMethod& signal) :
+        object (object),
+        name (name),
+        signature ("2" + signal.methodSignature())
+    {
+        QMetaObject::connect (object, signal.methodIndex(),
+                              this, QObject::staticMetaObject.methodCount(),
+                              Qt::DirectConnection);
+    }
+
+    /**
+     * Returns the number of connections to the signal, without the
+     * connection of the counter itself
+     */
+    int receivers() const
+    {
+        return Receivers::count (object, signature.constData()) - 1;
+    }
+
+    int qt_metacall (QMetaObject::Call call, int id, void** args)
+    {
+        id = QObject::qt_metacall (call, id, args);
+        if (id < 0)
+            return id;
+
+        if (call == QMetaObject::InvokeMetaMethod) {
+            if (id == 0)
+                emissions.ref();
+
+            --id;
+        }
+
+        return id;
+    }
+
+    QObject* object;
+    QString name;
+    QByteArray signature;
+    QAtomicInt emissions;
+
+private:
+    /* Gives access to the protected QObject::receivers() function */
+    struct Receivers : public QObject {
+        static int count (const QObject* object, const char* signal)
+        {
+            return (object->*(&Receivers::receivers)) (signal);
+        }
+    };
+};
+
+/**
+ * Configures the update timer, the statistics are only collected once the
+ * overlay is enabled
+ */
+FrameStatistics::FrameStatistics() :
+    m_enabled (false),
+    m_window (nullptr),
+    m_lastPublish (0),
+    m_lastSwap (-1),
+    m_renderStart (-1),
+    m_intervalSum (0),
+    m_intervalMax (0),
+    m_renderSum (0),
+    m_swaps (0),
+    m_renders (0),
+    m_fps (0),
+    m_frameTime (0),
+    m_maxFrameTime (0),
+    m_renderTime (0)
+{
+    m_timer.setInterval (UPDATE_INTERVAL);
+    connect (&m_timer, &QTimer::timeout, this, &FrameStatistics::publish);
+}
+
+/**
+ * Removes the window hooks and the signal counters
+ */
+FrameStatistics::~FrameStatistics()
+{
+    unhook();
+}
+
+/**
+ * Returns the only instance of the class
+ */
+FrameStatistics* FrameStatistics::getInstance()
+{
+    static FrameStatistics instance;
+    return &instance;
+}
+
+/**
+ * Returns \c true if the statistics are being collected
+ */
+bool FrameStatistics::enabled() const
+{
+    return m_enabled;
+}
+
+/**
+ * Returns the number of frames presented during the last second
+ */
+qreal FrameStatistics::fps() const
+{
+    return m_fps;
+}
+
+/**
+ * Returns the average time between two presented frames (in msecs)
+ */
+qreal FrameStatistics::frameTime() const
+{
+    return m_frameTime;
+}
+
+/**
+ * Returns the longest time between two presented frames during the last
+ * second (in msecs)
+ */
+qreal FrameStatistics::maxFrameTime() const
+{
+    return m_maxFrameTime;
+}
+
+/**
+ * Returns the average time spent by the scene graph to render a frame
+ * (in msecs), without the time spent waiting for the buffer swap
+ */
+qreal FrameStatistics::renderTime() const
+{
+    return m_renderTime;
+}
+
+/**
+ * Returns the signals that caused the most notifications during the last
+ * second, sorted from the most expensive one. Each item is a map with:
+ *
+ *   - \c name:          the object and signal names (e.g. "DS.voltageChanged")
+ *   - \c rate:          the emissions per second
+ *   - \c receivers:     the bindings and handlers connected to the signal
+ *   - \c notifications: the receivers called per second (rate x receivers)
+ */
+QVariantList FrameStatistics::signalCosts() const
+{
+    return m_signalCosts;
+}
+
+/**
+ * Sets the window whose frames are measured
+ */
+void FrameStatistics::setWindow (QQuickWindow* window)
+{
+    if (m_enabled)
+        unhook();
+
+    m_window = window;
+
+    if (m_enabled)
+        hook();
+}
+
+/**
+ * Counts the signals of the given \a object, which are reported with the
+ * given \a name as prefix
+ */
+void FrameStatistics::watch (QObject* object, const QString& name)
+{
+    if (m_enabled)
+        unhook();
+
+    m_objects.append (qMakePair (object, name));
+
+    if (m_enabled)
+        hook();
+}
+
+/**
+ * Starts or stops collecting the statistics
+ */
+void FrameStatistics::setEnabled (const bool enabled)
+{
+    if (m_enabled == enabled)
+        return;
+
+    m_enabled = enabled;
+
+    if (enabled)
+        hook();
+    else
+        unhook();
+
+    emit enabledChanged();
+}
+
+/**
+ * Calculates the statistics of the last second and resets the counters
+ */
+void FrameStatistics::publish()
+{
+    m_mutex.lock();
+    qint64 now = m_clock.elapsed();
+    qint64 elapsed = now - m_lastPublish;
+    m_lastPublish = now;
+    int swaps = m_swaps;
+    int renders = m_renders;
+    qint64 intervalSum = m_intervalSum;
+    qint64 intervalMax = m_intervalMax;
+    qint64 renderSum = m_renderSum;
+    m_swaps = 0;
+    m_renders = 0;
+    m_intervalSum = 0;
+    m_intervalMax = 0;
+    m_renderSum = 0;
+    m_mutex.unlock();
+
+    if (elapsed <= 0)
+        elapsed = UPDATE_INTERVAL;
+
+    m_fps = swaps * 1000.0 / elapsed;
+    m_frameTime = swaps > 0 ? intervalSum / 1e6 / swaps : 0;
+    m_maxFrameTime = intervalMax / 1e6;
+    m_renderTime = renders > 0 ? renderSum / 1e6 / renders : 0;
+
+    /* Rank the signals by the number of receivers that they called */
+    QList<QVariantMap> costs;
+    foreach (SignalCounter* counter, m_counters) {
+        int emissions = counter->emissions.fetchAndStoreRelaxed (0);
+        if (emissions <= 0)
+            continue;
+
+        int receivers = qMax (counter->receivers(), 0);
+        qreal rate = emissions * 1000.0 / elapsed;
+
+        QVariantMap cost;
+        cost.insert ("name", counter->name);
+        cost.insert ("rate", rate);
+        cost.insert ("receivers", receivers);
+        cost.insert ("notifications", rate * receivers);
+        costs.append (cost);
+    }
+
+    std::sort (costs.begin(), costs.end(), [] (const QVariantMap & a, const QVariantMap & b) {
+        return a.value ("notifications").toReal() > b.value ("notifications").toReal();
+    });
+
+    m_signalCosts.clear();
+    for (int i = 0; i < costs.count() && i < MAX_SIGNALS; ++i)
+        m_signalCosts.append (costs.at (i));
+
+    emit updated();
+}
+
+/**
+ * Connects the frame hooks of the window and the signal counters
+ */
+void FrameStatistics::hook()
+{
+    m_mutex.lock();
+    m_clock.start();
+    m_lastPublish = 0;
+    m_lastSwap = -1;
+    m_renderStart = -1;
+    m_swaps = 0;
+    m_renders = 0;
+    m_intervalSum = 0;
+    m_intervalMax = 0;
+    m_renderSum = 0;
+    m_mutex.unlock();
+
+    /* The window signals are emitted by the render thread */
+    if (m_window) {
+        m_connections.append (connect (m_window, &QQuickWindow::frameSwapped,
+                                       this, &FrameStatistics::onFrameSwapped,
+                                       Qt::DirectConnection));
+        m_connections.append (connect (m_window, &QQuickWindow::beforeRendering,
+                                       this, &FrameStatistics::onRenderStarted,
+                                       Qt::DirectConnection));
+        m_connections.append (connect (m_window, &QQuickWindow::afterRendering,
+                                       this, &FrameStatistics::onRenderFinished,
+                                       Qt::DirectConnection));
+    }
+
+    /* Count every signal declared by the watched classes */
+    for (int i = 0; i < m_objects.count(); ++i) {
+        QObject* object = m_objects.at (i).first;
+        const QMetaObject* meta = object->metaObject();
+        for (int j = QObject::staticMetaObject.methodCount(); j < meta->methodCount(); ++j) {
+            QMetaMethod method = meta->method (j);
+            if (method.methodType() != QMetaMethod::Signal)
+                continue;
+
+            m_counters.append (new SignalCounter (object,
+                                                  m_objects.at (i).second + "." + method.name(),
+                                                  method));
+        }
+    }
+
+    m_timer.start();
+}
+
+/**
+ * Removes the frame hooks and the signal counters
+ */
+void FrameStatistics::unhook()
+{
+    m_timer.stop();
+
+    foreach (const QMetaObject::Connection& connection, m_connections)
+        disconnect (connection);
+
+    qDeleteAll (m_counters);
+    m_counters.clear();
+    m_connections.clear();
+    m_signalCosts.clear();
+}
+
+/**
+ * Measures the time since the previous frame was presented
+ */
+void FrameStatistics::onFrameSwapped()
+{
+    QMutexLocker locker (&m_mutex);
+    qint64 now = m_clock.nsecsElapsed();
+
+    if (m_lastSwap >= 0) {
+        qint64 interval = now - m_lastSwap;
+        m_intervalSum += interval;
+        m_intervalMax = qMax (m_intervalMax, interval);
+    }
+
+    m_lastSwap = now;
+    ++m_swaps;
+}
+
+/**
+ * Registers the time at which the scene graph started rendering a frame
+ */
+void FrameStatistics::onRenderStarted()
+{
+    QMutexLocker locker (&m_mutex);
+    m_renderStart = m_clock.nsecsElapsed();
+}
+
+/**
+ * Measures the time spent rendering the frame
+ */
+void FrameStatistics::onRenderFinished()
+{
+    QMutexLocker locker (&m_mutex);
+    if (m_renderStart < 0)
+        return;
+
+    m_renderSum += m_clock.nsecsElapsed() - m_renderStart;
+    m_renderStart = -1;
+    ++m_renders;
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef _FRAME_STATISTICS_H
+#define _FRAME_STATISTICS_H
+
+#include <QMutex>
+#include <QTimer>
+#include <QObject>
+#include <QVariantList>
+#include <QElapsedTimer>
+
+class QQuickWindow;
+class SignalCounter;
+
+/**
+ * Collects the data shown by the performance overlay (enabled from the
+ * preferences): the frame rate and frame times of the window, and the
+ * signals of the DS and QJoysticks objects that caused the most binding
+ * re-evaluations during the last second.
+ *
+ * The window hooks and the signal counters are only installed while the
+ * overlay is enabled, so that the statistics cost nothing otherwise.
+ */
+class FrameStatistics : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY (bool enabled
+                READ enabled
+                WRITE setEnabled
+                NOTIFY enabledChanged)
+    Q_PROPERTY (qreal fps
+                READ fps
+                NOTIFY updated)
+    Q_PROPERTY (qreal frameTime
+                READ frameTime
+                NOTIFY updated)
+    Q_PROPERTY (qreal maxFrameTime
+                READ maxFrameTime
+                NOTIFY updated)
+    Q_PROPERTY (qreal renderTime
+                READ renderTime
+                NOTIFY updated)
+    Q_PROPERTY (QVariantList signalCosts
+                READ signalCosts
+                NOTIFY updated)
+
+public:
+    static FrameStatistics* getInstance();
+
+    bool enabled() const;
+    qreal fps() const;
+    qreal frameTime() const;
+    qreal maxFrameTime() const;
+    qreal renderTime() const;
+    QVariantList signalCosts() const;
+
+    void setWindow (QQuickWindow* window);
+    void watch (QObject* object, const QString& name);
+
+public slots:
+    void setEnabled (const bool enabled);
+
+signals:
+    void updated();
+    void enabledChanged();
+
+private slots:
+    void publish();
+
+private:
+    FrameStatistics();
+    ~FrameStatistics();
+
+    void hook();
+    void unhook();
+    void onFrameSwapped();
+    void onRenderStarted();
+    void onRenderFinished();
+
+private:
+    bool m_enabled;
+    QTimer m_timer;
+    QQuickWindow* m_window;
+    QList<SignalCounter*> m_counters;
+    QList<QPair<QObject*, QString>> m_objects;
+    QList<QMetaObject::Connection> m_connections;
+
+    /* Written by the render thread, read by the update timer */
+    QMutex m_mutex;
+    QElapsedTimer m_clock;
+    qint64 m_lastPublish;
+    qint64 m_lastSwap;
+    qint64 m_renderStart;
+    qint64 m_intervalSum;
+    qint64 m_intervalMax;
+    qint64 m_renderSum;
+    int m_swaps;
+    int m_renders;
+
+    qreal m_fps;
+    qreal m_frameTime;
+    qreal m_maxFrameTime;
+    qreal m_renderTime;
+    QVariantList m_signalCosts;
+};
+
+#endif
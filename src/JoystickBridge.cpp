@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "JoystickBridge.h"
+
+#include <LibDS.h>
+#include <QJoysticks.h>
+#include <Robot.h>
+#include <DriverStation.h>
+#include <QJoysticks/SDL_Joysticks.h>
+#include <QJoysticks/Android_Joystick.h>
+#include <QJoysticks/Windows_Joysticks.h>
+
+/*
+ * Layout of the joystick that is registered when no joysticks are
+ * attached (it is controlled by the virtual joystick widget)
+ */
+#define VIRTUAL_AXES    6
+#define VIRTUAL_HATS    0
+#define VIRTUAL_BUTTONS 10
+
+/**
+ * Reads the state of the SDL joysticks and of the XInput controllers before
+ * the LibDS builds a robot packet
+ */
+static void pollJoysticks (void* data)
+{
+    QJoysticks* joysticks = static_cast<QJoysticks*> (data);
+    joysticks->sdlJoysticks()->pollState();
+    joysticks->windowsJoysticks()->pollState();
+}
+
+/**
+ * Registers the bridge as the input handler of \c QJoysticks and starts
+ * reading the SDL joysticks from a high-priority input thread
+ */
+JoystickBridge::JoystickBridge()
+{
+    m_blacklisted = 0;
+    QJoysticks* joysticks = QJoysticks::getInstance();
+
+    connect (joysticks, &QJoysticks::countChanged,
+             this,      &JoystickBridge::registerJoysticks);
+    connect (joysticks, &QJoysticks::deviceChanged,
+             this,      &JoystickBridge::registerJoysticks);
+    connect (DriverStation::getInstance(), &DriverStation::joystickMappingChanged,
+             this,                         &JoystickBridge::registerJoysticks);
+
+    registerJoysticks();
+
+    /* Receive the SDL input directly from the thread that reads it */
+    joysticks->sdlJoysticks()->setInputHandler (this);
+
+    /* Receive the Android gamepad input directly from the UI thread */
+    joysticks->androidJoysticks()->setInputHandler (this);
+
+    /* Receive the native Windows input directly from its input thread */
+    joysticks->windowsJoysticks()->setInputHandler (this);
+
+    /* Receive the input of the virtual devices without a signal hop */
+    joysticks->setInputHandler (this);
+
+    /* The HID manager of OS X only delivers events to the main thread */
+#ifndef Q_OS_MAC
+    joysticks->sdlJoysticks()->setInputThreadEnabled (true);
+#endif
+}
+
+/**
+ * Stops the input thread before the handler is removed, so that the handler
+ * is not called after the bridge is destroyed
+ */
+JoystickBridge::~JoystickBridge()
+{
+    SDL_Joysticks* sdl = QJoysticks::getInstance()->sdlJoysticks();
+    DS_SetJoystickPollFunc (Q_NULLPTR, Q_NULLPTR);
+    sdl->setInputThreadEnabled (false);
+    sdl->setInputHandler (Q_NULLPTR);
+    QJoysticks::getInstance()->androidJoysticks()->setInputHandler (Q_NULLPTR);
+    QJoysticks::getInstance()->windowsJoysticks()->setInputHandler (Q_NULLPTR);
+    QJoysticks::getInstance()->setInputHandler (Q_NULLPTR);
+}
+
+/**
+ * Returns the only instance of the class
+ */
+JoystickBridge* JoystickBridge::getInstance()
+{
+    static JoystickBridge instance;
+    return &instance;
+}
+
+/**
+ * Registers the attached joysticks with the LibDS, if no joysticks are
+ * attached, a joystick for the virtual joystick widget is registered.
+ *
+ * Only the slots whose device changed are registered again (with neutral
+ * values), so that attaching or removing a joystick does not reset the
+ * other joysticks. The LibDS joysticks are only reset if slots were removed.
+ *
+ * The joysticks assigned to an additional robot (see \c DSRobot) are
+ * registered with the context of that robot instead, in the order of their
+ * \c QJoysticks indexes.
+ */
+void JoystickBridge::registerJoysticks()
+{
+    QJoysticks* joysticks = QJoysticks::getInstance();
+    DriverStation* ds = DriverStation::getInstance();
+    QList<DSRobot*> robots = ds->robotList();
+
+    /* Split the devices between the main robot and the other robots */
+    QList<QJoystickDevice*> all = joysticks->inputDevices();
+    QList<QJoystickDevice*> devices;
+    QHash<DSRobot*, QList<int>> robotIndexes;
+    QHash<DSRobot*, QList<QJoystickDevice*>> robotDevices;
+    QVector<Route> routes (all.count());
+    for (int i = 0; i < all.count(); ++i) {
+        DSRobot* owner = Q_NULLPTR;
+        foreach (DSRobot* robot, robots) {
+            if (robot->hasJoystick (i)) {
+                owner = robot;
+                break;
+            }
+        }
+
+        if (owner) {
+            routes [i].context = owner->context();
+            routes [i].slot = robotDevices [owner].count();
+            robotDevices [owner].append (all.at (i));
+            robotIndexes [owner].append (i);
+        }
+
+        else {
+            routes [i].context = DS_ContextDefault();
+            routes [i].slot = devices.count();
+            devices.append (all.at (i));
+        }
+    }
+
+    /* Stop routing input to the old slots while they are registered */
+    m_routesLock.lockForWrite();
+    m_routes = routes;
+    m_routesLock.unlock();
+
+    /* Register the joysticks of the robots whose devices changed */
+    foreach (DSRobot* robot, robots) {
+        if (robotDevices.value (robot) == m_robotDevices.value (robot))
+            continue;
+
+        robot->resetJoysticks();
+        foreach (int i, robotIndexes.value (robot))
+            robot->addJoystick (joysticks->getNumAxes (i),
+                                joysticks->getNumPOVs (i),
+                                joysticks->getNumButtons (i));
+    }
+
+    m_robotDevices = robotDevices;
+
+    /* The virtual joystick widget is represented by a null device */
+    if (devices.isEmpty())
+        devices.append (Q_NULLPTR);
+
+    /* Slots were removed, register every joystick again */
+    if (devices.count() < m_registered.count()) {
+        ds->resetJoysticks();
+        m_registered.clear();
+    }
+
+    /* Update the changed slots and register the new ones */
+    for (int i = 0; i < devices.count(); ++i) {
+        const bool widget = (devices.at (i) == Q_NULLPTR);
+        const int axes = widget ? VIRTUAL_AXES : joysticks->getNumAxes (i);
+        const int hats = widget ? VIRTUAL_HATS : joysticks->getNumPOVs (i);
+        const int buttons = widget ? VIRTUAL_BUTTONS : joysticks->getNumButtons (i);
+
+        if (i >= m_registered.count())
+            ds->addJoystick (axes, hats, buttons);
+
+        else if (m_registered.at (i) != devices.at (i))
+            ds->replaceJoystick (i, axes, hats, buttons);
+    }
+
+    m_registered = devices;
+
+    /* Update the blacklist used by the input thread */
+    int blacklisted = 0;
+    for (int i = 0; i < qMin (joysticks->count(), 32); ++i)
+        if (joysticks->isBlacklisted (i))
+            blacklisted |= 1 << i;
+
+    m_blacklisted.store (blacklisted);
+}
+
+/**
+ * Enables or disables the state polling of the SDL joysticks and of the
+ * XInput controllers. When enabled, the state of every controller is read in
+ * one pass right before each robot packet is built (instead of writing every
+ * input event to the LibDS), so the packets always carry the current state
+ * of the joysticks.
+ */
+void JoystickBridge::setStatePollingEnabled (const bool enabled)
+{
+    QJoysticks* joysticks = QJoysticks::getInstance();
+    joysticks->sdlJoysticks()->setStatePollingEnabled (enabled);
+    joysticks->windowsJoysticks()->setStatePollingEnabled (enabled);
+    DS_SetJoystickPollFunc (enabled ? &pollJoysticks : Q_NULLPTR, joysticks);
+}
+
+/**
+ * Enables or disables the native Windows backend (XInput and Raw Input),
+ * which reads the controllers instead of SDL. The SDL input is not written
+ * to the LibDS while the native backend is enabled, so that a controller is
+ * never reported twice.
+ *
+ * \note This function does nothing on operating systems other than Windows
+ */
+void JoystickBridge::setNativeInputEnabled (const bool enabled)
+{
+    if (!Windows_Joysticks::isSupported())
+        return;
+
+    QJoysticks* joysticks = QJoysticks::getInstance();
+    joysticks->sdlJoysticks()->setInputHandler (enabled ? Q_NULLPTR : this);
+    joysticks->windowsJoysticks()->setEnabled (enabled);
+}
+
+/**
+ * Returns \c true if the given \a joystick was blacklisted by the user.
+ *
+ * \note This function is called from the input thread
+ */
+bool JoystickBridge::isBlacklisted (const QJoystickDevice* joystick)
+{
+    if (joystick && joystick->id >= 0 && joystick->id < 32)
+        return (m_blacklisted.load() & (1 << joystick->id)) != 0;
+
+    return false;
+}
+
+/**
+ * Obtains the LibDS context and joystick slot of the given \a joystick, the
+ * routes lock must be locked for reading by the calling thread. Joysticks
+ * that are not registered yet use their index in the main robot.
+ *
+ * \returns \c false if the input of the joystick must be discarded
+ */
+bool JoystickBridge::findRoute (const QJoystickDevice* joystick, Route* route)
+{
+    if (isBlacklisted (joystick))
+        return false;
+
+    if (joystick->id >= 0 && joystick->id < m_routes.count())
+        *route = m_routes.at (joystick->id);
+
+    else {
+        route->context = DS_ContextDefault();
+        route->slot = joystick->id;
+    }
+
+    return true;
+}
+
+/**
+ * Sends the POV \a event of a joystick to the LibDS context of its robot
+ *
+ * \note This function is called from the input thread for SDL joysticks
+ */
+void JoystickBridge::povEvent (const QJoystickPOVEvent& event)
+{
+    Route route;
+    QReadLocker locker (&m_routesLock);
+
+    if (findRoute (event.joystick, &route)) {
+        DSContextScope scope (route.context);
+        DS_SetJoystickHat (route.slot, event.pov, event.angle);
+    }
+}
+
+/**
+ * Sends the axis \a event of a joystick to the LibDS context of its robot
+ *
+ * \note This function is called from the input thread for SDL joysticks
+ */
+void JoystickBridge::axisEvent (const QJoystickAxisEvent& event)
+{
+    Route route;
+    QReadLocker locker (&m_routesLock);
+
+    if (findRoute (event.joystick, &route)) {
+        DSContextScope scope (route.context);
+        DS_SetJoystickAxis (route.slot, event.axis, (float) event.value);
+    }
+}
+
+/**
+ * Sends the button \a event of a joystick to the LibDS context of its robot
+ *
+ * \note This function is called from the input thread for SDL joysticks
+ */
+void JoystickBridge::buttonEvent (const QJoystickButtonEvent& event)
+{
+    Route route;
+    QReadLocker locker (&m_routesLock);
+
+    if (findRoute (event.joystick, &route)) {
+        DSContextScope scope (route.context);
+        DS_SetJoystickButton (route.slot, event.button, event.pressed);
+    }
+}
+
+/**
+ * Sends the complete state of a polled joystick to the LibDS context of its
+ * robot with a single update, so that the robot never receives some of the
+ * new values without the others
+ *
+ * \note This function is called from the LibDS thread when state polling
+ *       is enabled (see \c setStatePollingEnabled())
+ */
+bool JoystickBridge::stateEvent (const QJoystickStateEvent& event)
+{
+    Route route;
+    QReadLocker locker (&m_routesLock);
+
+    if (findRoute (event.joystick, &route)) {
+        const QJoystickDevice* state = event.state;
+
+        float axes [DS_MAX_JOYSTICK_AXES];
+        int numAxes = qMin (state->axes.count(), DS_MAX_JOYSTICK_AXES);
+        for (int i = 0; i < numAxes; ++i)
+            axes [i] = (float) state->axes.at (i);
+
+        int hats [DS_MAX_JOYSTICK_HATS];
+        int numHats = qMin (state->povs.count(), DS_MAX_JOYSTICK_HATS);
+        for (int i = 0; i < numHats; ++i)
+            hats [i] = state->povs.at (i);
+
+        uint32_t buttons = 0;
+        int numButtons = qMin (state->buttons.count(), DS_MAX_JOYSTICK_BUTTONS);
+        for (int i = 0; i < numButtons; ++i)
+            if (state->buttons.at (i))
+                buttons |= (uint32_t) 1 << i;
+
+        DSContextScope scope (route.context);
+        DS_SetJoystickState (route.slot, axes, numAxes, buttons, hats, numHats);
+    }
+
+    return true;
+}
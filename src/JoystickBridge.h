@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef _JOYSTICK_BRIDGE_H
+#define _JOYSTICK_BRIDGE_H
+
+#include <QHash>
+#include <QVector>
+#include <QObject>
+#include <QAtomicInt>
+#include <QReadWriteLock>
+#include <DS_Context.h>
+#include <QJoysticks/JoysticksCommon.h>
+
+class DSRobot;
+
+/**
+ * Registers the joysticks managed by \c QJoysticks with the LibDS and sends
+ * their input to the robot as soon as it is received, without going through
+ * the QML interface (which is only used to display the joystick values)
+ *
+ * The input of the SDL joysticks is written to the LibDS directly from the
+ * SDL input thread, while the input of the virtual devices is written as
+ * soon as \c QJoysticks updates their state
+ */
+class JoystickBridge : public QObject, public QJoystickInputHandler
+{
+    Q_OBJECT
+
+public:
+    static JoystickBridge* getInstance();
+
+public slots:
+    void registerJoysticks();
+    void setStatePollingEnabled (const bool enabled);
+    void setNativeInputEnabled (const bool enabled);
+
+private:
+    JoystickBridge();
+    ~JoystickBridge();
+
+    struct Route {
+        DS_Context* context;
+        int slot;
+    };
+
+    bool isBlacklisted (const QJoystickDevice* joystick);
+    bool findRoute (const QJoystickDevice* joystick, Route* route);
+
+    void povEvent (const QJoystickPOVEvent& event);
+    void axisEvent (const QJoystickAxisEvent& event);
+    void buttonEvent (const QJoystickButtonEvent& event);
+    bool stateEvent (const QJoystickStateEvent& event);
+
+    QAtomicInt m_blacklisted;
+    QList<QJoystickDevice*> m_registered;
+    QHash<DSRobot*, QList<QJoystickDevice*>> m_robotDevices;
+
+    /* LibDS context and slot of each joystick, used by the input thread */
+    QReadWriteLock m_routesLock;
+    QVector<Route> m_routes;
+};
+
+#endif
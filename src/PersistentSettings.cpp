@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "PersistentSettings.h"
+
+#include <QtQml>
+#include <QMetaProperty>
+#include <QJoysticks/DeferredSettings.h>
+
+PersistentSettings::PersistentSettings (QObject* parent) : QObject (parent)
+{
+    m_completed = false;
+}
+
+/**
+ * Registers the settings type with QML
+ */
+void PersistentSettings::declareQML()
+{
+    qmlRegisterType<PersistentSettings> ("DriverStation", 1, 0, "Settings");
+}
+
+/**
+ * Returns the group of the settings, the properties are stored at the top
+ * level if the category is empty
+ */
+QString PersistentSettings::category() const
+{
+    return m_category;
+}
+
+void PersistentSettings::classBegin() {}
+
+/**
+ * Loads the saved values of the properties declared in QML and starts
+ * watching their changes
+ */
+void PersistentSettings::componentComplete()
+{
+    m_completed = true;
+
+    const QMetaObject* object = metaObject();
+    const int slot = staticMetaObject.indexOfSlot ("onPropertyChanged()");
+
+    for (int i = staticMetaObject.propertyCount(); i < object->propertyCount(); ++i) {
+        QMetaProperty property = object->property (i);
+
+        QVariant value = DeferredSettings::getInstance()->value (key (property.name()));
+        if (value.isValid())
+            property.write (this, value);
+
+        if (property.hasNotifySignal())
+            QMetaObject::connect (this, property.notifySignalIndex(), this, slot);
+    }
+}
+
+/**
+ * Changes the group of the settings
+ *
+ * \note The category should be set before the component is completed
+ */
+void PersistentSettings::setCategory (const QString& category)
+{
+    if (m_category != category) {
+        if (m_completed)
+            qWarning() << "Settings category changed after loading:" << category;
+
+        m_category = category;
+        emit categoryChanged();
+    }
+}
+
+/**
+ * Stores the value of the property whose notify signal was emitted
+ */
+void PersistentSettings::onPropertyChanged()
+{
+    const QMetaObject* object = metaObject();
+    const int signal = senderSignalIndex();
+
+    for (int i = staticMetaObject.propertyCount(); i < object->propertyCount(); ++i) {
+        QMetaProperty property = object->property (i);
+
+        if (property.notifySignalIndex() == signal)
+            DeferredSettings::getInstance()->setValue (key (property.name()),
+                                                       property.read (this));
+    }
+}
+
+/**
+ * Returns the settings key of the property with the given \a name
+ */
+QString PersistentSettings::key (const char* name) const
+{
+    if (m_category.isEmpty())
+        return QString::fromLatin1 (name);
+
+    return m_category + "/" + QString::fromLatin1 (name);
+}
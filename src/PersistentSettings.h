@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _PERSISTENT_SETTINGS_H
+#define _PERSISTENT_SETTINGS_H
+
+#include <QObject>
+#include <QQmlParserStatus>
+
+/**
+ * A QML replacement of the \c Settings type of \c Qt.labs.settings, which
+ * writes each change with \c QSettings in the GUI thread.
+ *
+ * The properties declared in QML (usually aliases of the controls) are
+ * loaded when the component is completed, and every change is given to the
+ * \c DeferredSettings, which batches the changes in memory and writes them
+ * in a background thread once the settings stop changing (or when the
+ * application quits).
+ */
+class PersistentSettings : public QObject, public QQmlParserStatus
+{
+    Q_OBJECT
+    Q_INTERFACES (QQmlParserStatus)
+    Q_PROPERTY (QString category
+                READ category
+                WRITE setCategory
+                NOTIFY categoryChanged)
+
+signals:
+    void categoryChanged();
+
+public:
+    explicit PersistentSettings (QObject* parent = Q_NULLPTR);
+
+    static void declareQML();
+
+    QString category() const;
+
+    void classBegin();
+    void componentComplete();
+
+public slots:
+    void setCategory (const QString& category);
+
+private slots:
+    void onPropertyChanged();
+
+private:
+    QString key (const char* name) const;
+
+private:
+    bool m_completed;
+    QString m_category;
+};
+
+#endif
@@ -0,0 +1,417 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "TelemetryChart.h"
+
+#include <LibDS.h>
+#include <QtQml>
+#include <QSGGeometryNode>
+#include <QSGTransformNode>
+#include <QSGFlatColorMaterial>
+#include <DriverStation.h>
+
+/*
+ * Default sampling interval (in msecs) and number of samples of a chart
+ */
+#define DEFAULT_INTERVAL 50
+#define DEFAULT_CAPACITY 600
+
+/*
+ * The x coordinates of the vertices are relative to a base sample, which
+ * is moved before the coordinates lose precision as floats
+ */
+#define REBASE_THRESHOLD (1 << 22)
+
+/**
+ * Configures the chart and starts sampling its value
+ */
+TelemetryChart::TelemetryChart (QQuickItem* parent) : QQuickItem (parent),
+    m_source (Voltage),
+    m_color (Qt::white),
+    m_minimum (0),
+    m_maximum (13),
+    m_count (0),
+    m_synced (0),
+    m_base (0),
+    m_reset (true),
+    m_colorChanged (false),
+    m_minimumVoltage (0),
+    m_voltageReported (false)
+{
+    setClip (true);
+    setFlag (ItemHasContents, true);
+
+    m_values.resize (DEFAULT_CAPACITY);
+    m_valid.fill (false, DEFAULT_CAPACITY);
+
+    connect (DriverStation::getInstance(), &DriverStation::voltageChanged,
+             this,                         &TelemetryChart::onVoltageChanged);
+    connect (DriverStation::getInstance(), &DriverStation::foregroundChanged,
+             this,                         &TelemetryChart::onForegroundChanged);
+    connect (&m_timer, &QTimer::timeout, this, &TelemetryChart::sample);
+
+    m_timer.setTimerType (Qt::PreciseTimer);
+    m_timer.start (DEFAULT_INTERVAL);
+}
+
+/**
+ * Registers the chart item with QML
+ */
+void TelemetryChart::declareQML()
+{
+    qmlRegisterType<TelemetryChart> ("DriverStation", 1, 0, "TelemetryChart");
+}
+
+/**
+ * Returns the value that is drawn by the chart
+ */
+TelemetryChart::Source TelemetryChart::source() const
+{
+    return m_source;
+}
+
+/**
+ * Returns the color of the line
+ */
+QColor TelemetryChart::color() const
+{
+    return m_color;
+}
+
+/**
+ * Returns the value drawn at the bottom of the chart
+ */
+qreal TelemetryChart::minimum() const
+{
+    return m_minimum;
+}
+
+/**
+ * Returns the value drawn at the top of the chart
+ */
+qreal TelemetryChart::maximum() const
+{
+    return m_maximum;
+}
+
+/**
+ * Returns the time (in msecs) between two samples
+ */
+int TelemetryChart::interval() const
+{
+    return m_timer.interval();
+}
+
+/**
+ * Returns the number of samples shown by the chart
+ */
+int TelemetryChart::capacity() const
+{
+    return m_values.count();
+}
+
+/**
+ * Returns the newest sampled value (or 0 if it is not valid)
+ */
+qreal TelemetryChart::lastValue() const
+{
+    if (m_count == 0)
+        return 0;
+
+    const int slot = (int) ((m_count - 1) % m_values.count());
+    return m_valid.at (slot) ? m_values.at (slot) : 0;
+}
+
+/**
+ * Removes all the samples of the chart
+ */
+void TelemetryChart::clear()
+{
+    m_count = 0;
+    m_reset = true;
+    m_valid.fill (false);
+    m_voltageReported = false;
+
+    update();
+}
+
+/**
+ * Changes the value drawn by the chart (the samples of the previous value
+ * are removed)
+ */
+void TelemetryChart::setSource (const Source source)
+{
+    if (m_source != source) {
+        m_source = source;
+        clear();
+        emit sourceChanged();
+    }
+}
+
+/**
+ * Changes the color of the line
+ */
+void TelemetryChart::setColor (const QColor& color)
+{
+    if (m_color != color) {
+        m_color = color;
+        m_colorChanged = true;
+        update();
+        emit colorChanged();
+    }
+}
+
+/**
+ * Changes the value drawn at the bottom of the chart
+ */
+void TelemetryChart::setMinimum (const qreal minimum)
+{
+    if (m_minimum != minimum) {
+        m_minimum = minimum;
+        update();
+        emit rangeChanged();
+    }
+}
+
+/**
+ * Changes the value drawn at the top of the chart
+ */
+void TelemetryChart::setMaximum (const qreal maximum)
+{
+    if (m_maximum != maximum) {
+        m_maximum = maximum;
+        update();
+        emit rangeChanged();
+    }
+}
+
+/**
+ * Changes the time (in msecs) between two samples
+ */
+void TelemetryChart::setInterval (const int interval)
+{
+    if (interval > 0 && interval != m_timer.interval()) {
+        m_timer.start (interval);
+        emit intervalChanged();
+    }
+}
+
+/**
+ * Changes the number of samples shown by the chart (the current samples
+ * are removed)
+ */
+void TelemetryChart::setCapacity (const int capacity)
+{
+    if (capacity > 1 && capacity != m_values.count()) {
+        m_values.resize (capacity);
+        m_valid.resize (capacity);
+        clear();
+        emit capacityChanged();
+    }
+}
+
+/**
+ * Writes the segments of the samples taken since the last frame to the
+ * line geometry, and updates the transform that maps the samples to the
+ * chart area. This function is called by the render thread while the GUI
+ * thread is blocked.
+ */
+QSGNode* TelemetryChart::updatePaintNode (QSGNode* node, UpdatePaintNodeData* data)
+{
+    Q_UNUSED (data);
+
+    const int capacity = m_values.count();
+    QSGTransformNode* root = static_cast<QSGTransformNode*> (node);
+    QSGGeometryNode* line;
+    QSGGeometry* geometry;
+
+    /* Create the nodes */
+    if (!root) {
+        root = new QSGTransformNode;
+        line = new QSGGeometryNode;
+        geometry = new QSGGeometry (QSGGeometry::defaultAttributes_Point2D(),
+                                    2 * capacity);
+        geometry->setLineWidth (2);
+        geometry->setDrawingMode (GL_LINES);
+        geometry->setVertexDataPattern (QSGGeometry::StreamPattern);
+
+        QSGFlatColorMaterial* material = new QSGFlatColorMaterial;
+        material->setColor (m_color);
+
+        line->setGeometry (geometry);
+        line->setMaterial (material);
+        line->setFlag (QSGNode::OwnsGeometry);
+        line->setFlag (QSGNode::OwnsMaterial);
+        root->appendChildNode (line);
+
+        m_reset = true;
+        m_colorChanged = false;
+    }
+
+    else {
+        line = static_cast<QSGGeometryNode*> (root->firstChild());
+        geometry = line->geometry();
+    }
+
+    /* Update the color */
+    if (m_colorChanged) {
+        static_cast<QSGFlatColorMaterial*> (line->material())->setColor (m_color);
+        line->markDirty (QSGNode::DirtyMaterial);
+        m_colorChanged = false;
+    }
+
+    /* The capacity or samples were reset, hide all the segments */
+    QSGGeometry::Point2D* vertices = geometry->vertexDataAsPoint2D();
+    if (m_reset || geometry->vertexCount() != 2 * capacity) {
+        geometry->allocate (2 * capacity);
+        vertices = geometry->vertexDataAsPoint2D();
+        for (int i = 0; i < 2 * capacity; ++i)
+            vertices [i].set (-REBASE_THRESHOLD, 0);
+
+        m_reset = false;
+        m_synced = 0;
+        m_base = m_count;
+        line->markDirty (QSGNode::DirtyGeometry);
+    }
+
+    /* Move the x origin before the coordinates lose precision */
+    if (m_count - m_base > REBASE_THRESHOLD) {
+        m_base = m_count;
+        m_synced = 0;
+    }
+
+    /* Write the segments of the new samples */
+    const quint64 oldest = (m_count > (quint64) capacity) ? m_count - capacity : 0;
+    quint64 first = qMax (qMax (m_synced, oldest), (quint64) 1);
+    for (quint64 s = first; s < m_count; ++s) {
+        const int slot = (int) (s % capacity);
+        const int prev = (int) ((s - 1) % capacity);
+        const float x = (float) ((qint64) (s - m_base));
+
+        QSGGeometry::Point2D* segment = &vertices [2 * slot];
+        if (s - 1 >= oldest && m_valid.at (slot) && m_valid.at (prev)) {
+            segment [0].set (x - 1, m_values.at (prev));
+            segment [1].set (x, m_values.at (slot));
+        }
+
+        else {
+            segment [0].set (-REBASE_THRESHOLD, 0);
+            segment [1].set (-REBASE_THRESHOLD, 0);
+        }
+    }
+
+    if (first < m_count)
+        line->markDirty (QSGNode::DirtyGeometry);
+
+    m_synced = m_count;
+
+    /* Map the samples to the chart area (newest sample on the right edge) */
+    const qreal range = qMax (m_maximum - m_minimum, (qreal) 1e-6);
+    QMatrix4x4 matrix;
+    matrix.translate (0, height());
+    matrix.scale (width() / (capacity - 1), -height() / range);
+    matrix.translate ((qreal) m_base - ((qreal) m_count - capacity), -m_minimum);
+    root->setMatrix (matrix);
+
+    return root;
+}
+
+/**
+ * Reads the current value of the chart and adds it to the ring buffer,
+ * the chart is only redrawn if it is visible and the UI is in the
+ * foreground (see \c DriverStation::setForeground())
+ */
+void TelemetryChart::sample()
+{
+    float value = 0;
+    const int slot = (int) (m_count % m_values.count());
+
+    m_valid [slot] = readValue (&value);
+    m_values [slot] = value;
+    ++m_count;
+
+    if (DriverStation::getInstance()->foreground()) {
+        if (isVisible())
+            update();
+
+        emit sampled();
+    }
+}
+
+/**
+ * Keeps the minimum voltage reported during the current sample interval
+ */
+void TelemetryChart::onVoltageChanged (const float voltage)
+{
+    if (!m_voltageReported || voltage < m_minimumVoltage)
+        m_minimumVoltage = voltage;
+
+    m_voltageReported = true;
+}
+
+/**
+ * Draws the samples taken while the UI was in the background
+ */
+void TelemetryChart::onForegroundChanged (const bool foreground)
+{
+    if (foreground) {
+        update();
+        emit sampled();
+    }
+}
+
+/**
+ * Obtains the current value of the chart
+ *
+ * \returns \c false if the value is not available (e.g. no robot)
+ */
+bool TelemetryChart::readValue (float* value)
+{
+    DriverStation* ds = DriverStation::getInstance();
+    if (!ds->connectedToRobot()) {
+        m_voltageReported = false;
+        return false;
+    }
+
+    switch (m_source) {
+    case Voltage:
+        *value = m_voltageReported ? m_minimumVoltage : ds->voltage();
+        m_voltageReported = false;
+        break;
+    case RobotLatency: {
+        DS_LatencyInfo info = DS_GetRobotLatencyInfo();
+        if (info.round_trip.samples == 0)
+            return false;
+
+        *value = info.round_trip.p50 / 1000.0f;
+        break;
+    }
+    case RobotPacketLoss:
+        *value = ds->robotPacketLoss();
+        break;
+    case CPUUsage:
+        *value = ds->cpuUsage();
+        break;
+    }
+
+    return true;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _TELEMETRY_CHART_H
+#define _TELEMETRY_CHART_H
+
+#include <QTimer>
+#include <QColor>
+#include <QVector>
+#include <QQuickItem>
+
+/**
+ * Draws a live chart of a robot value (battery voltage, round-trip latency,
+ * packet loss or CPU usage) with the scene graph.
+ *
+ * The value is sampled every \c interval milliseconds into a ring buffer.
+ * Each sample is uploaded as a line segment of a \c QSGGeometry, in sample
+ * coordinates, and the chart is scrolled and scaled with a transform node,
+ * so only the segments of the new samples are written to the geometry (all
+ * of them are only rewritten when the chart is resized to a new capacity).
+ *
+ * Voltage samples hold the minimum voltage reported during the interval, so
+ * that short brownout dips are always visible.
+ */
+class TelemetryChart : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY (Source source
+                READ source
+                WRITE setSource
+                NOTIFY sourceChanged)
+    Q_PROPERTY (QColor color
+                READ color
+                WRITE setColor
+                NOTIFY colorChanged)
+    Q_PROPERTY (qreal minimum
+                READ minimum
+                WRITE setMinimum
+                NOTIFY rangeChanged)
+    Q_PROPERTY (qreal maximum
+                READ maximum
+                WRITE setMaximum
+                NOTIFY rangeChanged)
+    Q_PROPERTY (int interval
+                READ interval
+                WRITE setInterval
+                NOTIFY intervalChanged)
+    Q_PROPERTY (int capacity
+                READ capacity
+                WRITE setCapacity
+                NOTIFY capacityChanged)
+    Q_PROPERTY (qreal lastValue
+                READ lastValue
+                NOTIFY sampled)
+
+public:
+    enum Source {
+        Voltage,
+        RobotLatency,
+        RobotPacketLoss,
+        CPUUsage,
+    };
+    Q_ENUMS (Source)
+
+    TelemetryChart (QQuickItem* parent = nullptr);
+
+    static void declareQML();
+
+    Source source() const;
+    QColor color() const;
+    qreal minimum() const;
+    qreal maximum() const;
+    int interval() const;
+    int capacity() const;
+    qreal lastValue() const;
+
+public slots:
+    void clear();
+    void setSource (const Source source);
+    void setColor (const QColor& color);
+    void setMinimum (const qreal minimum);
+    void setMaximum (const qreal maximum);
+    void setInterval (const int interval);
+    void setCapacity (const int capacity);
+
+signals:
+    void sampled();
+    void rangeChanged();
+    void colorChanged();
+    void sourceChanged();
+    void capacityChanged();
+    void intervalChanged();
+
+protected:
+    QSGNode* updatePaintNode (QSGNode* node, UpdatePaintNodeData* data);
+
+private slots:
+    void sample();
+    void onVoltageChanged (const float voltage);
+    void onForegroundChanged (const bool foreground);
+
+private:
+    bool readValue (float* value);
+
+private:
+    Source m_source;
+    QColor m_color;
+    qreal m_minimum;
+    qreal m_maximum;
+    QTimer m_timer;
+
+    /* Sampled values (in a ring buffer) and validity of each sample */
+    QVector<float> m_values;
+    QVector<bool> m_valid;
+    quint64 m_count;
+
+    /* Samples already written to the geometry, and their x origin */
+    quint64 m_synced;
+    quint64 m_base;
+    bool m_reset;
+    bool m_colorChanged;
+
+    /* Minimum voltage reported since the last sample */
+    float m_minimumVoltage;
+    bool m_voltageReported;
+};
+
+#endif
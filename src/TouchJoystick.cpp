@@ -0,0 +1,511 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "TouchJoystick.h"
+
+#include <math.h>
+#include <LibDS.h>
+#include <QtQml>
+#include <QJoysticks.h>
+#include <QSGGeometryNode>
+#include <QSGTransformNode>
+#include <QSGFlatColorMaterial>
+
+/*
+ * Number of segments of the circles and size of the knob (relative to the
+ * radius of the stick)
+ */
+#define CIRCLE_SEGMENTS 48
+#define KNOB_RADIUS     0.4
+
+/**
+ * Writes a circle with the given \a center and \a radius to the given
+ * triangle fan \a geometry
+ */
+static void fillCircle (QSGGeometry* geometry, const QPointF& center, const qreal radius)
+{
+    QSGGeometry::Point2D* vertices = geometry->vertexDataAsPoint2D();
+    vertices [0].set (center.x(), center.y());
+
+    for (int i = 0; i <= CIRCLE_SEGMENTS; ++i) {
+        const qreal angle = 2 * M_PI * i / CIRCLE_SEGMENTS;
+        vertices [i + 1].set (center.x() + radius * cos (angle),
+                              center.y() + radius * sin (angle));
+    }
+}
+
+/**
+ * Creates a geometry node that draws a circle with the given \a color
+ */
+static QSGGeometryNode* createCircle (const QColor& color)
+{
+    QSGGeometry* geometry = new QSGGeometry (QSGGeometry::defaultAttributes_Point2D(),
+                                             CIRCLE_SEGMENTS + 2);
+    geometry->setDrawingMode (GL_TRIANGLE_FAN);
+
+    QSGFlatColorMaterial* material = new QSGFlatColorMaterial;
+    material->setColor (color);
+
+    QSGGeometryNode* node = new QSGGeometryNode;
+    node->setGeometry (geometry);
+    node->setMaterial (material);
+    node->setFlag (QSGNode::OwnsGeometry);
+    node->setFlag (QSGNode::OwnsMaterial);
+
+    return node;
+}
+
+/**
+ * Changes the \a color of the given circle \a node
+ */
+static void setCircleColor (QSGGeometryNode* node, const QColor& color)
+{
+    static_cast<QSGFlatColorMaterial*> (node->material())->setColor (color);
+    node->markDirty (QSGNode::DirtyMaterial);
+}
+
+/**
+ * Configures the stick, by default the stick moves the first two axes of the
+ * first LibDS joystick (but the values are not sent, see \c simulation)
+ */
+TouchJoystick::TouchJoystick (QQuickItem* parent) : QQuickItem (parent),
+    m_joystick (0),
+    m_xAxis (0),
+    m_yAxis (1),
+    m_simulation (true),
+    m_standalone (false),
+    m_registered (false),
+    m_color ("#ededed"),
+    m_knobColor ("#009688"),
+    m_colorChanged (false),
+    m_xValue (0),
+    m_yValue (0),
+    m_touchPoint (-1)
+{
+    setFlag (ItemHasContents, true);
+    setAcceptedMouseButtons (Qt::LeftButton);
+#if QT_VERSION >= QT_VERSION_CHECK (5, 10, 0)
+    setAcceptTouchEvents (true);
+#endif
+
+    m_device.id = -1;
+    m_device.blacklisted = false;
+    m_device.name = tr ("Touch Joystick");
+    m_device.axes.append (0);
+    m_device.axes.append (0);
+}
+
+/**
+ * Unregisters the virtual device of the stick (if registered)
+ */
+TouchJoystick::~TouchJoystick()
+{
+    if (m_registered)
+        QJoysticks::getInstance()->removeVirtualDevice (&m_device, this);
+}
+
+/**
+ * Registers the stick item with QML
+ */
+void TouchJoystick::declareQML()
+{
+    qmlRegisterType<TouchJoystick> ("DriverStation", 1, 0, "TouchJoystick");
+}
+
+/**
+ * Returns the LibDS joystick that receives the values of the stick
+ */
+int TouchJoystick::joystick() const
+{
+    return m_joystick;
+}
+
+/**
+ * Returns the LibDS axis that receives the horizontal value of the stick
+ */
+int TouchJoystick::xAxis() const
+{
+    return m_xAxis;
+}
+
+/**
+ * Returns the LibDS axis that receives the vertical value of the stick
+ */
+int TouchJoystick::yAxis() const
+{
+    return m_yAxis;
+}
+
+/**
+ * Returns \c true if the values of the stick are only displayed (and not sent
+ * to the LibDS joystick)
+ */
+bool TouchJoystick::simulation() const
+{
+    return m_simulation;
+}
+
+/**
+ * Returns \c true if the stick is registered as its own virtual device
+ */
+bool TouchJoystick::standalone() const
+{
+    return m_standalone;
+}
+
+/**
+ * Returns the color of the stick area
+ */
+QColor TouchJoystick::color() const
+{
+    return m_color;
+}
+
+/**
+ * Returns the color of the knob
+ */
+QColor TouchJoystick::knobColor() const
+{
+    return m_knobColor;
+}
+
+/**
+ * Returns the horizontal value of the stick (from -1 to 1)
+ */
+qreal TouchJoystick::xValue() const
+{
+    return m_xValue;
+}
+
+/**
+ * Returns the vertical value of the stick (from -1 to 1, down is positive)
+ */
+qreal TouchJoystick::yValue() const
+{
+    return m_yValue;
+}
+
+/**
+ * Centers the stick
+ */
+void TouchJoystick::release()
+{
+    m_touchPoint = -1;
+    setValues (0, 0);
+}
+
+/**
+ * Changes the LibDS joystick that receives the values of the stick
+ */
+void TouchJoystick::setJoystick (const int joystick)
+{
+    if (m_joystick != joystick) {
+        release();
+        m_joystick = joystick;
+        emit configChanged();
+    }
+}
+
+/**
+ * Changes the LibDS axis that receives the horizontal value of the stick
+ */
+void TouchJoystick::setXAxis (const int axis)
+{
+    if (m_xAxis != axis) {
+        release();
+        m_xAxis = axis;
+        emit configChanged();
+    }
+}
+
+/**
+ * Changes the LibDS axis that receives the vertical value of the stick
+ */
+void TouchJoystick::setYAxis (const int axis)
+{
+    if (m_yAxis != axis) {
+        release();
+        m_yAxis = axis;
+        emit configChanged();
+    }
+}
+
+/**
+ * If \a simulation is set to \c true, the values of the stick are not sent
+ * to the LibDS joystick
+ */
+void TouchJoystick::setSimulation (const bool simulation)
+{
+    if (m_simulation != simulation) {
+        release();
+        m_simulation = simulation;
+        emit configChanged();
+    }
+}
+
+/**
+ * If \a standalone is set to \c true, the stick is registered as its own
+ * virtual device (with two axes) while it is visible
+ */
+void TouchJoystick::setStandalone (const bool standalone)
+{
+    if (m_standalone != standalone) {
+        release();
+        m_standalone = standalone;
+        updateRegistration();
+        emit configChanged();
+    }
+}
+
+/**
+ * Changes the color of the stick area
+ */
+void TouchJoystick::setColor (const QColor& color)
+{
+    if (m_color != color) {
+        m_color = color;
+        m_colorChanged = true;
+        update();
+        emit colorChanged();
+    }
+}
+
+/**
+ * Changes the color of the knob
+ */
+void TouchJoystick::setKnobColor (const QColor& color)
+{
+    if (m_knobColor != color) {
+        m_knobColor = color;
+        m_colorChanged = true;
+        update();
+        emit colorChanged();
+    }
+}
+
+/**
+ * Follows the first touch point that is pressed on the stick until it is
+ * released, other touch points are left to the other sticks
+ */
+void TouchJoystick::touchEvent (QTouchEvent* event)
+{
+    foreach (const QTouchEvent::TouchPoint& point, event->touchPoints()) {
+        if (m_touchPoint == -1 && point.state() == Qt::TouchPointPressed)
+            m_touchPoint = point.id();
+
+        if (point.id() == m_touchPoint) {
+            if (point.state() == Qt::TouchPointReleased)
+                release();
+            else
+                moveTo (point.pos());
+        }
+    }
+
+    event->accept();
+}
+
+/**
+ * Moves the knob to the mouse position while the mouse button is pressed
+ */
+void TouchJoystick::mouseMoveEvent (QMouseEvent* event)
+{
+    moveTo (event->localPos());
+    event->accept();
+}
+
+/**
+ * Moves the knob to the mouse position
+ */
+void TouchJoystick::mousePressEvent (QMouseEvent* event)
+{
+    moveTo (event->localPos());
+    event->accept();
+}
+
+/**
+ * Centers the stick when the mouse button is released
+ */
+void TouchJoystick::mouseReleaseEvent (QMouseEvent* event)
+{
+    release();
+    event->accept();
+}
+
+/**
+ * Centers the stick when it is hidden (so that the robot does not keep
+ * moving) and registers or unregisters its virtual device
+ */
+void TouchJoystick::itemChange (ItemChange change, const ItemChangeData& data)
+{
+    if (change == ItemVisibleHasChanged) {
+        if (!data.boolValue)
+            release();
+
+        updateRegistration();
+    }
+
+    QQuickItem::itemChange (change, data);
+}
+
+/**
+ * Draws the stick area and the knob, the knob is moved with a transform
+ * node, so that the circle geometries are only written when the item is
+ * resized
+ */
+QSGNode* TouchJoystick::updatePaintNode (QSGNode* node, UpdatePaintNodeData* data)
+{
+    Q_UNUSED (data);
+
+    QSGGeometryNode* area;
+    QSGGeometryNode* knob;
+    QSGTransformNode* knobTransform;
+
+    /* Create the nodes */
+    if (!node) {
+        node = new QSGNode;
+        area = createCircle (m_color);
+        knob = createCircle (m_knobColor);
+        knobTransform = new QSGTransformNode;
+
+        knobTransform->appendChildNode (knob);
+        node->appendChildNode (area);
+        node->appendChildNode (knobTransform);
+
+        m_paintedSize = QSizeF();
+        m_colorChanged = false;
+    }
+
+    else {
+        area = static_cast<QSGGeometryNode*> (node->firstChild());
+        knobTransform = static_cast<QSGTransformNode*> (area->nextSibling());
+        knob = static_cast<QSGGeometryNode*> (knobTransform->firstChild());
+    }
+
+    /* Update the colors */
+    if (m_colorChanged) {
+        setCircleColor (area, m_color);
+        setCircleColor (knob, m_knobColor);
+        m_colorChanged = false;
+    }
+
+    /* Rewrite the circles when the item is resized */
+    const QPointF center (width() / 2, height() / 2);
+    const qreal radius = qMin (width(), height()) / 2;
+    if (m_paintedSize != size()) {
+        fillCircle (area->geometry(), center, radius);
+        fillCircle (knob->geometry(), QPointF (0, 0), radius * KNOB_RADIUS);
+        area->markDirty (QSGNode::DirtyGeometry);
+        knob->markDirty (QSGNode::DirtyGeometry);
+        m_paintedSize = size();
+    }
+
+    /* Move the knob */
+    QMatrix4x4 matrix;
+    const qreal travel = radius * (1 - KNOB_RADIUS);
+    matrix.translate (center.x() + m_xValue * travel, center.y() + m_yValue * travel);
+    knobTransform->setMatrix (matrix);
+
+    return node;
+}
+
+/**
+ * Registers the virtual device of the stick with \c QJoysticks while the
+ * stick is visible and in standalone mode (and unregisters it otherwise)
+ */
+void TouchJoystick::updateRegistration()
+{
+    const bool registered = m_standalone && isVisible();
+    if (registered == m_registered)
+        return;
+
+    m_registered = registered;
+    if (registered)
+        QJoysticks::getInstance()->addVirtualDevice (&m_device, this);
+    else
+        QJoysticks::getInstance()->removeVirtualDevice (&m_device, this);
+}
+
+/**
+ * Calculates the values of the stick for the given touch \a point (the
+ * values are limited to the circle of the stick)
+ */
+void TouchJoystick::moveTo (const QPointF& point)
+{
+    const qreal radius = qMin (width(), height()) / 2;
+    if (radius <= 0)
+        return;
+
+    qreal x = (point.x() - width() / 2) / radius;
+    qreal y = (point.y() - height() / 2) / radius;
+
+    const qreal length = sqrt (x * x + y * y);
+    if (length > 1) {
+        x /= length;
+        y /= length;
+    }
+
+    setValues (x, y);
+}
+
+/**
+ * Updates the values of the stick and sends them immediately, to the
+ * LibDS joystick or through the virtual device
+ */
+void TouchJoystick::setValues (const qreal x, const qreal y)
+{
+    if (x == m_xValue && y == m_yValue)
+        return;
+
+    const bool xChanged = (x != m_xValue);
+    const bool yChanged = (y != m_yValue);
+
+    m_xValue = x;
+    m_yValue = y;
+
+    if (m_registered) {
+        QJoystickAxisEvent event;
+        event.joystick = &m_device;
+        event.timestamp = QJoystickTimestamp();
+
+        if (xChanged) {
+            event.axis = 0;
+            event.value = x;
+            emit axisEvent (event);
+        }
+
+        if (yChanged) {
+            event.axis = 1;
+            event.value = y;
+            emit axisEvent (event);
+        }
+    }
+
+    else if (!m_simulation && !m_standalone) {
+        if (xChanged)
+            DS_SetJoystickAxis (m_joystick, m_xAxis, (float) x);
+        if (yChanged)
+            DS_SetJoystickAxis (m_joystick, m_yAxis, (float) y);
+    }
+
+    update();
+    emit valueChanged();
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _TOUCH_JOYSTICK_H
+#define _TOUCH_JOYSTICK_H
+
+#include <QColor>
+#include <QQuickItem>
+#include <QJoysticks/JoysticksCommon.h>
+
+/**
+ * An on-screen thumb stick that is operated with touch (or mouse) input and
+ * drawn with the scene graph.
+ *
+ * The touch points are translated to axis values in C++ and sent to the robot
+ * while the touch event is being handled, without waiting for QML bindings
+ * or for the next frame:
+ *
+ *   - By default, the values are written to the \c xAxis and \c yAxis of the
+ *     LibDS \c joystick (unless \c simulation is set).
+ *   - If \c standalone is set, the stick registers itself as a virtual device
+ *     with two axes in \c QJoysticks (while it is visible), and its input is
+ *     sent by the joystick bridge like any other virtual device.
+ *
+ * Each stick follows its own touch point, so several sticks can be used at
+ * the same time.
+ */
+class TouchJoystick : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY (int joystick
+                READ joystick
+                WRITE setJoystick
+                NOTIFY configChanged)
+    Q_PROPERTY (int xAxis
+                READ xAxis
+                WRITE setXAxis
+                NOTIFY configChanged)
+    Q_PROPERTY (int yAxis
+                READ yAxis
+                WRITE setYAxis
+                NOTIFY configChanged)
+    Q_PROPERTY (bool simulation
+                READ simulation
+                WRITE setSimulation
+                NOTIFY configChanged)
+    Q_PROPERTY (bool standalone
+                READ standalone
+                WRITE setStandalone
+                NOTIFY configChanged)
+    Q_PROPERTY (QColor color
+                READ color
+                WRITE setColor
+                NOTIFY colorChanged)
+    Q_PROPERTY (QColor knobColor
+                READ knobColor
+                WRITE setKnobColor
+                NOTIFY colorChanged)
+    Q_PROPERTY (qreal xValue
+                READ xValue
+                NOTIFY valueChanged)
+    Q_PROPERTY (qreal yValue
+                READ yValue
+                NOTIFY valueChanged)
+
+signals:
+    void valueChanged();
+    void colorChanged();
+    void configChanged();
+    void povEvent (const QJoystickPOVEvent& event);
+    void axisEvent (const QJoystickAxisEvent& event);
+    void buttonEvent (const QJoystickButtonEvent& event);
+
+public:
+    TouchJoystick (QQuickItem* parent = nullptr);
+    ~TouchJoystick();
+
+    static void declareQML();
+
+    int joystick() const;
+    int xAxis() const;
+    int yAxis() const;
+    bool simulation() const;
+    bool standalone() const;
+    QColor color() const;
+    QColor knobColor() const;
+    qreal xValue() const;
+    qreal yValue() const;
+
+public slots:
+    void release();
+    void setJoystick (const int joystick);
+    void setXAxis (const int axis);
+    void setYAxis (const int axis);
+    void setSimulation (const bool simulation);
+    void setStandalone (const bool standalone);
+    void setColor (const QColor& color);
+    void setKnobColor (const QColor& color);
+
+protected:
+    void touchEvent (QTouchEvent* event);
+    void mouseMoveEvent (QMouseEvent* event);
+    void mousePressEvent (QMouseEvent* event);
+    void mouseReleaseEvent (QMouseEvent* event);
+    void itemChange (ItemChange change, const ItemChangeData& data);
+    QSGNode* updatePaintNode (QSGNode* node, UpdatePaintNodeData* data);
+
+private:
+    void updateRegistration();
+    void moveTo (const QPointF& point);
+    void setValues (const qreal x, const qreal y);
+
+private:
+    int m_joystick;
+    int m_xAxis;
+    int m_yAxis;
+    bool m_simulation;
+    bool m_standalone;
+    bool m_registered;
+    QColor m_color;
+    QColor m_knobColor;
+    bool m_colorChanged;
+    QSizeF m_paintedSize;
+
+    /* Current values and the touch point that moves the knob */
+    qreal m_xValue;
+    qreal m_yValue;
+    int m_touchPoint;
+
+    /* Device registered with QJoysticks in standalone mode */
+    QJoystickDevice m_device;
+};
+
+#endif
@@ -24,9 +24,26 @@
 #include <QJoysticks.h>
 #include <EventLogger.h>
 #include <DriverStation.h>
+#include <NetConsoleModel.h>
+#include <NetConsoleFilter.h>
+#include <ProcessMonitor.h>
+#include <RemoteServer.h>
+#include <Robot.h>
+#include <TelemetryExport.h>
+#include <TelemetryHistory.h>
+
+#include "CameraView.h"
+#include "BackgroundService.h"
+#include "FrameStatistics.h"
+#include "JoystickBridge.h"
+#include "PersistentSettings.h"
+#include "TelemetryChart.h"
+#include "TouchJoystick.h"
 
 #include <QtQml>
 #include <QQuickStyle>
+#include <QQuickWindow>
+#include <QElapsedTimer>
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
 
@@ -35,8 +52,164 @@ const QString APP_COMPANY = "Alex Spataru";
 const QString APP_DSPNAME = "QDriverStation";
 const QString APP_WEBSITE = "http://frc-utilities.github.io/";
 
+/*
+ * Startup tracing (enabled with the --startup-trace argument), joystick
+ * state polling (enabled with the --poll-joysticks argument), the native
+ * Windows joystick backend (enabled with the --native-joysticks argument,
+ * it reads the controllers with XInput and Raw Input instead of SDL), the
+ * LibDS event thread (enabled with the --event-thread argument), the global
+ * e-stop and disable hotkeys (disabled with the --no-hotkeys argument), the
+ * pipeline trace file (set with the --trace argument), the joystick macro
+ * files (set with the --record-macro and --play-macro arguments), the port
+ * of the remote WebSocket server (set with the --remote argument), the
+ * additional robots (added with --robot <team>[:<joystick>,...] arguments)
+ * and the telemetry logs to convert to Parquet files (added with
+ * --export-telemetry <log> arguments, the files are stored next to the logs
+ * or in the directory set with the --export-dir argument)
+ */
+static bool TRACE_STARTUP = false;
+static bool POLL_JOYSTICKS = false;
+static bool NATIVE_JOYSTICKS = false;
+static bool EVENT_THREAD = false;
+static bool HOTKEYS = true;
+static QString TRACE_FILE;
+static QString RECORD_MACRO_FILE;
+static QString PLAY_MACRO_FILE;
+static quint16 REMOTE_PORT = 0;
+static QStringList EXTRA_ROBOTS;
+static QStringList EXPORT_LOGS;
+static QString EXPORT_DIRECTORY;
+static QElapsedTimer STARTUP_TIMER;
+
+/**
+ * Logs the time elapsed since the application was launched when the
+ * given startup \a stage has finished
+ */
+static void traceStartup (const char* stage)
+{
+    if (TRACE_STARTUP)
+        qDebug() << "Startup:" << stage << "after"
+                 << STARTUP_TIMER.nsecsElapsed() / 1000000.0 << "ms";
+}
+
+/**
+ * Records the trace events of the DS pipeline (LibDS threads, joystick
+ * input, event processing and frame swaps) and saves them to the trace
+ * file when the application quits. The instrumentation is only compiled
+ * in builds with \c CONFIG+=libds_trace.
+ */
+static void startPipelineTrace (QGuiApplication* app)
+{
+#if defined DS_ENABLE_TRACE
+    DS_TRACE_THREAD ("GUI thread");
+    DS_StartTrace();
+
+    QObject::connect (app, &QCoreApplication::aboutToQuit, []() {
+        DS_StopTrace();
+        if (!DS_SaveTrace (TRACE_FILE.toLocal8Bit().constData()))
+            qWarning() << "Cannot save the trace to" << TRACE_FILE;
+    });
+#else
+    Q_UNUSED (app);
+    qWarning() << "Tracing needs a build with CONFIG+=libds_trace";
+#endif
+}
+
+/**
+ * Controls the additional robots given in the command line, each one with
+ * its team number and the (\c QJoysticks) indexes of its joysticks
+ */
+static void addExtraRobots (DriverStation* driverstation)
+{
+    foreach (const QString& spec, EXTRA_ROBOTS) {
+        const QStringList parts = spec.split (':');
+        QObject* object = driverstation->addRobot (parts.first().toInt());
+        DSRobot* robot = qobject_cast<DSRobot*> (object);
+
+        if (robot && parts.count() > 1) {
+            QVariantList joysticks;
+            foreach (const QString& index, parts.at (1).split (',', QString::SkipEmptyParts))
+                joysticks.append (index.toInt());
+
+            robot->setJoysticks (joysticks);
+        }
+    }
+}
+
+/**
+ * Exports the telemetry logs given in the command line (in parallel) and
+ * returns the exit code of the application
+ */
+static int exportTelemetry (int argc, char* argv[])
+{
+    QCoreApplication app (argc, argv);
+    TelemetryExport exporter;
+
+    QObject::connect (&exporter, &TelemetryExport::finished,
+    [&app] (const int exported, const int failed) {
+        qDebug() << "Exported" << exported << "telemetry logs," << failed << "failed";
+        app.exit (failed > 0 ? 1 : 0);
+    });
+
+    exporter.start (EXPORT_LOGS, EXPORT_DIRECTORY);
+    return app.exec();
+}
+
+/**
+ * Records the joystick values sent to the robot and saves them to the macro
+ * file when the application quits, or plays the given macro file instead of
+ * the joystick input
+ */
+static void startJoystickMacros (QGuiApplication* app)
+{
+    if (!RECORD_MACRO_FILE.isEmpty()) {
+        DS_StartMacroRecording();
+        QObject::connect (app, &QCoreApplication::aboutToQuit, []() {
+            DS_StopMacroRecording();
+            if (!DS_SaveMacro (RECORD_MACRO_FILE.toLocal8Bit().constData()))
+                qWarning() << "Cannot save the macro to" << RECORD_MACRO_FILE;
+        });
+    }
+
+    if (!PLAY_MACRO_FILE.isEmpty() &&
+            !DS_StartMacroPlayback (PLAY_MACRO_FILE.toLocal8Bit().constData(), 0))
+        qWarning() << "Cannot play the macro" << PLAY_MACRO_FILE;
+}
+
 int main (int argc, char* argv[])
 {
+    STARTUP_TIMER.start();
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp (argv [i], "--startup-trace") == 0)
+            TRACE_STARTUP = true;
+        else if (qstrcmp (argv [i], "--poll-joysticks") == 0)
+            POLL_JOYSTICKS = true;
+        else if (qstrcmp (argv [i], "--native-joysticks") == 0)
+            NATIVE_JOYSTICKS = true;
+        else if (qstrcmp (argv [i], "--event-thread") == 0)
+            EVENT_THREAD = true;
+        else if (qstrcmp (argv [i], "--no-hotkeys") == 0)
+            HOTKEYS = false;
+        else if (qstrcmp (argv [i], "--trace") == 0 && i + 1 < argc)
+            TRACE_FILE = QString::fromLocal8Bit (argv [++i]);
+        else if (qstrcmp (argv [i], "--record-macro") == 0 && i + 1 < argc)
+            RECORD_MACRO_FILE = QString::fromLocal8Bit (argv [++i]);
+        else if (qstrcmp (argv [i], "--play-macro") == 0 && i + 1 < argc)
+            PLAY_MACRO_FILE = QString::fromLocal8Bit (argv [++i]);
+        else if (qstrcmp (argv [i], "--remote") == 0 && i + 1 < argc)
+            REMOTE_PORT = (quint16) QByteArray (argv [++i]).toUShort();
+        else if (qstrcmp (argv [i], "--robot") == 0 && i + 1 < argc)
+            EXTRA_ROBOTS.append (QString::fromLocal8Bit (argv [++i]));
+        else if (qstrcmp (argv [i], "--export-telemetry") == 0 && i + 1 < argc)
+            EXPORT_LOGS.append (QString::fromLocal8Bit (argv [++i]));
+        else if (qstrcmp (argv [i], "--export-dir") == 0 && i + 1 < argc)
+            EXPORT_DIRECTORY = QString::fromLocal8Bit (argv [++i]);
+    }
+
+    /* Convert the telemetry logs without starting the DS */
+    if (!EXPORT_LOGS.isEmpty())
+        return exportTelemetry (argc, argv);
+
     /* Set application information */
     QGuiApplication::setApplicationName (APP_DSPNAME);
     QGuiApplication::setOrganizationName (APP_COMPANY);
@@ -46,9 +219,35 @@ int main (int argc, char* argv[])
 
     /* Initialize application and DS */
     QGuiApplication app (argc, argv);
+    traceStartup ("QGuiApplication");
+    if (!TRACE_FILE.isEmpty())
+        startPipelineTrace (&app);
     DriverStation* driverstation = DriverStation::getInstance();
+    DriverStation::getInstance()->setEventThreadEnabled (EVENT_THREAD);
+    DriverStation::getInstance()->setHotkeysEnabled (HOTKEYS);
     DriverStation::getInstance()->start();
+    startJoystickMacros (&app);
+    addExtraRobots (driverstation);
+
+    /* Keep the DS awake (on Android) while the robot is connected */
+    BackgroundService::getInstance()->watch (driverstation);
+    traceStartup ("DS_Init");
     DriverStation::declareQML();
+    QJoysticks::declareQML();
+    CameraView::declareQML();
+    TelemetryChart::declareQML();
+    PersistentSettings::declareQML();
+    TouchJoystick::declareQML();
+
+    /* Stream the DS state to the remote clients */
+    if (REMOTE_PORT > 0)
+        DSRemoteServer::getInstance()->start (REMOTE_PORT);
+
+    /* Send joystick input to the DS without going through QML */
+    JoystickBridge::getInstance()->setStatePollingEnabled (POLL_JOYSTICKS);
+    JoystickBridge::getInstance()->setNativeInputEnabled (NATIVE_JOYSTICKS);
+    QJoysticks::getInstance();
+    traceStartup ("SDL init");
 
     /* Use Universal style on Windows Phone */
 #if defined Q_OS_WINRT
@@ -64,25 +263,92 @@ int main (int argc, char* argv[])
     bool mobile = false;
 #endif
 
-    /* Set application style (based on saved settings) */
+    /* Set application style (based on saved settings), the performance mode
+     * uses the flat Universal style and disables the QML animations */
     QSettings settings;
-    material = settings.value ("material", material).toBool();
+    bool performance = settings.value ("performanceMode", false).toBool();
+    material = settings.value ("material", material).toBool() && !performance;
     QQuickStyle::setStyle (material ? "Material" : "Universal");
 
+    /* Render with the CPU when the GPU (or its driver) is too slow */
+#if QT_VERSION >= QT_VERSION_CHECK (5, 8, 0)
+    if (performance && settings.value ("softwareRenderer", false).toBool())
+        QQuickWindow::setSceneGraphBackend (QSGRendererInterface::Software);
+#endif
+
+    /* Count the signals shown by the performance overlay */
+    FrameStatistics::getInstance()->watch (driverstation, "DS");
+    FrameStatistics::getInstance()->watch (QJoysticks::getInstance(), "QJoysticks");
+
     /* Load QML interface */
     QQmlApplicationEngine engine;
     engine.rootContext()->setContextProperty ("DS", driverstation);
     engine.rootContext()->setContextProperty ("IsMobile", mobile);
     engine.rootContext()->setContextProperty ("IsMaterial", material);
+    engine.rootContext()->setContextProperty ("PerformanceMode", performance);
     engine.rootContext()->setContextProperty ("AppDspName", APP_DSPNAME);
     engine.rootContext()->setContextProperty ("AppVersion", APP_VERSION);
     engine.rootContext()->setContextProperty ("QJoysticks", QJoysticks::getInstance());
+    engine.rootContext()->setContextProperty ("NetConsole", NetConsoleModel::getInstance());
+    engine.rootContext()->setContextProperty ("NetConsoleFilter", NetConsoleFilter::getInstance());
+    engine.rootContext()->setContextProperty ("TelemetryHistory", TelemetryHistory::getInstance());
+    engine.rootContext()->setContextProperty ("ProcessMonitor", DSProcessMonitor::getInstance());
+    engine.rootContext()->setContextProperty ("FrameStats", FrameStatistics::getInstance());
     engine.load (QUrl (QStringLiteral ("qrc:/qml/main.qml")));
+    traceStartup ("QML load");
 
     /* Exit if QML fails to load */
     if (engine.rootObjects().isEmpty())
         return EXIT_FAILURE;
 
+    /* Log when the first frame is shown */
+    QQuickWindow* window = qobject_cast<QQuickWindow*> (engine.rootObjects().first());
+    if (TRACE_STARTUP && window) {
+        QMetaObject::Connection* connection = new QMetaObject::Connection;
+        *connection = QObject::connect (window, &QQuickWindow::frameSwapped, [connection]() {
+            traceStartup ("First frame");
+            QObject::disconnect (*connection);
+            delete connection;
+        });
+    }
+
+    /* Mark the frame swaps (on the render thread) in the pipeline trace */
+    if (DS_TraceActive() && window) {
+        QObject::connect (window, &QQuickWindow::frameSwapped, []() {
+            DS_TRACE_INSTANT ("frame swapped");
+        });
+    }
+
+    /* Measure the frame times (on the render thread) */
+    if (window) {
+        DSProcessMonitor* monitor = DSProcessMonitor::getInstance();
+        QObject::connect (window, &QQuickWindow::beforeSynchronizing,
+                          monitor, &DSProcessMonitor::onFrameStarted,
+                          Qt::DirectConnection);
+        QObject::connect (window, &QQuickWindow::afterRendering,
+                          monitor, &DSProcessMonitor::onFrameRendered,
+                          Qt::DirectConnection);
+    }
+
+    /* Measure the frames shown by the performance overlay */
+    FrameStatistics::getInstance()->setWindow (window);
+
+    /* Slow down the UI updates while the window is hidden or not focused */
+    if (window) {
+        auto updateForeground = [window, driverstation]() {
+            driverstation->setForeground (window->isActive()
+                                          && window->visibility() != QWindow::Hidden
+                                          && window->visibility() != QWindow::Minimized);
+        };
+
+        QObject::connect (window, &QQuickWindow::activeChanged, updateForeground);
+        QObject::connect (window, &QQuickWindow::visibilityChanged, updateForeground);
+        updateForeground();
+    }
+
+    /* Update the joystick widgets at most once per frame */
+    QJoysticks::getInstance()->setFrameWindow (engine.rootObjects().first());
+
     /* Stop the DS when the application wants to quit */
     QObject::connect (&engine,     SIGNAL (quit()),
                       driverstation, SLOT (quitDS()));